@@ -84,6 +84,7 @@ check_symbol_exists("clock_gettime"  "time.h"   HAVE_CLOCK_GETTIME)
 # Some platforms (macOS pre 10.15) are non-conformant with C11 and lack timespec_get()
 check_symbol_exists("timespec_get"   "time.h"   HAVE_TIMESPEC_GET)
 check_function_exists("getifaddrs"       HAVE_GETIFADDRS)
+check_symbol_exists("posix_fadvise"  "fcntl.h"  HAVE_POSIX_FADVISE)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
 check_function_exists("setresgid"        HAVE_SETRESGID)
 check_function_exists("setresuid"        HAVE_SETRESUID)
@@ -96,7 +97,9 @@ endif()
 if(UNIX)
 	cmake_push_check_state()
 	list(APPEND CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+	check_symbol_exists("copy_file_range" "unistd.h" HAVE_COPY_FILE_RANGE)
 	check_symbol_exists("memmem"        "string.h"   HAVE_MEMMEM)
+	check_symbol_exists("recvmmsg"      "sys/socket.h" HAVE_RECVMMSG)
 	check_symbol_exists("strcasestr"    "string.h"   HAVE_STRCASESTR)
 	check_symbol_exists("strerrorname_np" "string.h" HAVE_STRERRORNAME_NP)
 	check_symbol_exists("strptime"      "time.h"     HAVE_STRPTIME)
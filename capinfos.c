@@ -155,9 +155,10 @@ static gchar file_sha1[HASH_STR_SIZE];
 static char  *hash_buf = NULL;
 static gcry_md_hd_t hd = NULL;
 
-static guint num_ipv4_addresses;
-static guint num_ipv6_addresses;
-static guint num_decryption_secrets;
+/* Updated atomically, as sections of a file can be read in parallel */
+static gint num_ipv4_addresses;
+static gint num_ipv6_addresses;
+static gint num_decryption_secrets;
 
 /*
  * If we have at least two packets with time stamps, and they're not in
@@ -211,8 +212,53 @@ typedef struct _capture_info {
   GArray               *interface_packet_counts;  /* array of per_packet interface_id counts; one entry per file IDB */
   guint32               pkt_interface_id_unknown; /* counts if packet interface_id didn't match a known one */
   GArray               *idb_info_strings;         /* array of IDB info strings */
+  GArray               *shbs;                     /* array of the SHBs of the file's sections */
 } capture_info;
 
+/* A packet with an encapsulation we don't know */
+typedef struct {
+  guint32               frame;
+  int                   encap;
+} unknown_encap_t;
+
+/*
+ * What reading the records of a file, or of one of its sections, found.
+ */
+typedef struct {
+  guint32               packet;
+  gint64                bytes;
+  guint32               snaplen_min_inferred;
+  guint32               snaplen_max_inferred;
+  gboolean              have_times;
+  gboolean              have_ts;                  /* at least one record has a time stamp */
+  nstime_t              start_time;
+  int                   start_time_tsprec;
+  nstime_t              stop_time;
+  int                   stop_time_tsprec;
+  nstime_t              first_time;               /* time stamps of the first and last records */
+  nstime_t              last_time;                /*  that have them, to check order across sections */
+  order_t               order;
+  int                  *encap_counts;
+  guint                 num_interfaces;
+  GArray               *interface_packet_counts;
+  guint32               pkt_interface_id_unknown;
+  GArray               *unknown_encaps;           /* unknown_encap_t's, or NULL if there are none */
+} record_tally_t;
+
+/* One section of a file, read by a thread of its own */
+typedef struct {
+  const char           *filename;
+  gint64                offset;
+  gboolean              opened;
+  record_tally_t        tally;
+  int                   err;
+  gchar                *err_info;
+  wtap_block_t          shb;
+  GArray               *idb_info_strings;
+  int                   file_encap;
+  int                   file_tsprec;
+} section_task_t;
+
 static char *decimal_point;
 
 static void
@@ -747,10 +793,10 @@ print_stats(const gchar *filename, capture_info *cf_info)
   }
   if (cap_order)          printf     ("Strict time order:   %s\n", order_string(cf_info->order));
 
-  gboolean has_multiple_sections = (wtap_file_get_num_shbs(cf_info->wth) > 1);
+  gboolean has_multiple_sections = (cf_info->shbs->len > 1);
 
   for (guint section_number = 0;
-       section_number < wtap_file_get_num_shbs(cf_info->wth);
+       section_number < cf_info->shbs->len;
        section_number++) {
     wtap_block_t shb;
 
@@ -758,7 +804,7 @@ print_stats(const gchar *filename, capture_info *cf_info)
     if (has_multiple_sections)
       printf("Section %u:\n\n", section_number);
 
-    shb = wtap_file_get_shb(cf_info->wth, section_number);
+    shb = g_array_index(cf_info->shbs, wtap_block_t, section_number);
     if (shb != NULL) {
       if (cap_file_more_info) {
         char *str;
@@ -797,13 +843,13 @@ print_stats(const gchar *filename, capture_info *cf_info)
 
     if (cap_file_nrb) {
       if (num_ipv4_addresses != 0)
-        printf   ("Number of resolved IPv4 addresses in file: %u\n", num_ipv4_addresses);
+        printf   ("Number of resolved IPv4 addresses in file: %d\n", num_ipv4_addresses);
       if (num_ipv6_addresses != 0)
-        printf   ("Number of resolved IPv6 addresses in file: %u\n", num_ipv6_addresses);
+        printf   ("Number of resolved IPv6 addresses in file: %d\n", num_ipv6_addresses);
     }
     if (cap_file_dsb) {
       if (num_decryption_secrets != 0)
-        printf   ("Number of decryption secrets in file: %u\n", num_decryption_secrets);
+        printf   ("Number of decryption secrets in file: %d\n", num_decryption_secrets);
     }
   }
 }
@@ -1045,11 +1091,11 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   }
 
   for (guint section_number = 0;
-       section_number < wtap_file_get_num_shbs(cf_info->wth);
+       section_number < cf_info->shbs->len;
        section_number++) {
     wtap_block_t shb;
 
-    shb = wtap_file_get_shb(cf_info->wth, section_number);
+    shb = g_array_index(cf_info->shbs, wtap_block_t, section_number);
     if (cap_file_more_info) {
       char *str;
 
@@ -1120,7 +1166,8 @@ cleanup_capture_info(capture_info *cf_info)
   g_free(cf_info->encap_counts);
   cf_info->encap_counts = NULL;
 
-  g_array_free(cf_info->interface_packet_counts, TRUE);
+  if (cf_info->interface_packet_counts)
+    g_array_free(cf_info->interface_packet_counts, TRUE);
   cf_info->interface_packet_counts = NULL;
 
   if (cf_info->idb_info_strings) {
@@ -1131,18 +1178,26 @@ cleanup_capture_info(capture_info *cf_info)
     g_array_free(cf_info->idb_info_strings, TRUE);
   }
   cf_info->idb_info_strings = NULL;
+
+  if (cf_info->shbs) {
+    for (i = 0; i < cf_info->shbs->len; i++) {
+      wtap_block_unref(g_array_index(cf_info->shbs, wtap_block_t, i));
+    }
+    g_array_free(cf_info->shbs, TRUE);
+  }
+  cf_info->shbs = NULL;
 }
 
 static void
 count_ipv4_address(const guint addr _U_, const gchar *name _U_)
 {
-  num_ipv4_addresses++;
+  g_atomic_int_inc(&num_ipv4_addresses);
 }
 
 static void
 count_ipv6_address(const void *addrp _U_, const gchar *name _U_)
 {
-  num_ipv6_addresses++;
+  g_atomic_int_inc(&num_ipv6_addresses);
 }
 
 static void
@@ -1150,7 +1205,7 @@ count_decryption_secret(guint32 secrets_type _U_, const void *secrets _U_, guint
 {
   /* XXX - count them based on the secrets type (which is an opaque code,
      not a small integer)? */
-  num_decryption_secrets++;
+  g_atomic_int_inc(&num_decryption_secrets);
 }
 
 static void
@@ -1188,6 +1243,378 @@ calculate_hashes(const char *filename)
   }
 }
 
+static void
+init_record_tally(record_tally_t *tally)
+{
+  tally->packet = 0;
+  tally->bytes = 0;
+  tally->snaplen_min_inferred = 0xffffffff;
+  tally->snaplen_max_inferred = 0;
+  tally->have_times = TRUE;
+  tally->have_ts = FALSE;
+  nstime_set_zero(&tally->start_time);
+  tally->start_time_tsprec = WTAP_TSPREC_UNKNOWN;
+  nstime_set_zero(&tally->stop_time);
+  tally->stop_time_tsprec = WTAP_TSPREC_UNKNOWN;
+  nstime_set_zero(&tally->first_time);
+  nstime_set_zero(&tally->last_time);
+  tally->order = IN_ORDER;
+  tally->encap_counts = g_new0(int, WTAP_NUM_ENCAP_TYPES);
+  tally->num_interfaces = 0;
+  tally->interface_packet_counts = g_array_new(FALSE, TRUE, sizeof(guint32));
+  tally->pkt_interface_id_unknown = 0;
+  tally->unknown_encaps = NULL;
+}
+
+static void
+cleanup_record_tally(record_tally_t *tally)
+{
+  g_free(tally->encap_counts);
+  tally->encap_counts = NULL;
+  if (tally->interface_packet_counts)
+    g_array_free(tally->interface_packet_counts, TRUE);
+  tally->interface_packet_counts = NULL;
+  if (tally->unknown_encaps)
+    g_array_free(tally->unknown_encaps, TRUE);
+  tally->unknown_encaps = NULL;
+}
+
+/* Make the tally's per-interface counts cover all of the file's IDBs so far */
+static void
+update_num_interfaces(wtap *wth, record_tally_t *tally)
+{
+  wtapng_iface_descriptions_t *idb_info;
+
+  idb_info = wtap_file_get_idb_info(wth);
+  ws_assert(idb_info->interface_data != NULL);
+  tally->num_interfaces = idb_info->interface_data->len;
+  g_array_set_size(tally->interface_packet_counts, tally->num_interfaces);
+  g_free(idb_info);
+}
+
+/*
+ * Tally up data that we need to parse through the file, or the
+ * section of it that wth reads, to find. On a read error, returns
+ * FALSE with what was read before the error tallied up.
+ */
+static gboolean
+tally_records(wtap *wth, record_tally_t *tally, int *err, gchar **err_info)
+{
+  wtap_batch            batch;
+  wtap_rec             *rec;
+  guint                 i;
+  nstime_t              cur_time;
+  nstime_t              prev_time;
+  unknown_encap_t       unknown_encap;
+
+  nstime_set_zero(&cur_time);
+  nstime_set_zero(&prev_time);
+
+  update_num_interfaces(wth, tally);
+
+  wtap_batch_init(&batch, 256);
+  while (wtap_read_batch(wth, &batch, err, err_info)) {
+    for (i = 0; i < batch.count; i++) {
+      rec = &batch.recs[i].rec;
+      if (rec->presence_flags & WTAP_HAS_TS) {
+        prev_time = cur_time;
+        cur_time = rec->ts;
+        if (!tally->have_ts) {
+          tally->first_time = rec->ts;
+          tally->have_ts = TRUE;
+        }
+        if (tally->packet == 0) {
+          tally->start_time = rec->ts;
+          tally->start_time_tsprec = rec->tsprec;
+          tally->stop_time  = rec->ts;
+          tally->stop_time_tsprec = rec->tsprec;
+          prev_time  = rec->ts;
+        }
+        if (nstime_cmp(&cur_time, &prev_time) < 0) {
+          tally->order = NOT_IN_ORDER;
+        }
+        if (nstime_cmp(&cur_time, &tally->start_time) < 0) {
+          tally->start_time = cur_time;
+          tally->start_time_tsprec = rec->tsprec;
+        }
+        if (nstime_cmp(&cur_time, &tally->stop_time) > 0) {
+          tally->stop_time = cur_time;
+          tally->stop_time_tsprec = rec->tsprec;
+        }
+      } else {
+        tally->have_times = FALSE; /* at least one packet has no time stamp */
+        if (tally->order != NOT_IN_ORDER)
+          tally->order = ORDER_UNKNOWN;
+      }
+
+      if (rec->rec_type == REC_TYPE_PACKET) {
+        tally->bytes += rec->rec_header.packet_header.len;
+        tally->packet++;
+
+        /* If caplen < len for a rcd, then presumably           */
+        /* 'Limit packet capture length' was done for this rcd. */
+        /* Keep track as to the min/max actual snapshot lengths */
+        /*  seen for this file.                                 */
+        if (rec->rec_header.packet_header.caplen < rec->rec_header.packet_header.len) {
+          if (rec->rec_header.packet_header.caplen < tally->snaplen_min_inferred)
+            tally->snaplen_min_inferred = rec->rec_header.packet_header.caplen;
+          if (rec->rec_header.packet_header.caplen > tally->snaplen_max_inferred)
+            tally->snaplen_max_inferred = rec->rec_header.packet_header.caplen;
+        }
+
+        if ((rec->rec_header.packet_header.pkt_encap > 0) &&
+            (rec->rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
+          tally->encap_counts[rec->rec_header.packet_header.pkt_encap] += 1;
+        } else {
+          /* Reported once we know the frame's number in the whole file */
+          if (tally->unknown_encaps == NULL)
+            tally->unknown_encaps = g_array_new(FALSE, FALSE, sizeof(unknown_encap_t));
+          unknown_encap.frame = tally->packet;
+          unknown_encap.encap = rec->rec_header.packet_header.pkt_encap;
+          g_array_append_val(tally->unknown_encaps, unknown_encap);
+        }
+
+        /* Packet interface_id info */
+        if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
+          /* tally->num_interfaces is size, not index, so it's one more than max index */
+          if (rec->rec_header.packet_header.interface_id >= tally->num_interfaces) {
+            /*
+             * OK, re-fetch the number of interfaces, as there might have
+             * been an interface that was in the middle of packets, and
+             * grow the array to be big enough for the new number of
+             * interfaces.
+             */
+            update_num_interfaces(wth, tally);
+          }
+          if (rec->rec_header.packet_header.interface_id < tally->num_interfaces) {
+            g_array_index(tally->interface_packet_counts, guint32,
+                          rec->rec_header.packet_header.interface_id) += 1;
+          }
+          else {
+            tally->pkt_interface_id_unknown += 1;
+          }
+        }
+        else {
+          /* it's for interface_id 0 */
+          if (tally->num_interfaces != 0) {
+            g_array_index(tally->interface_packet_counts, guint32, 0) += 1;
+          }
+          else {
+            tally->pkt_interface_id_unknown += 1;
+          }
+        }
+      }
+    }
+  } /* while */
+  wtap_batch_cleanup(&batch);
+
+  if (tally->have_ts)
+    tally->last_time = cur_time;
+
+  /*
+   * Count all the IDBs, even those that come after the last packet
+   * record.
+   */
+  update_num_interfaces(wth, tally);
+
+  return *err == 0;
+}
+
+/*
+ * Add the tally for a section to the tally for the sections before it.
+ */
+static void
+merge_record_tally(record_tally_t *total, const record_tally_t *section)
+{
+  guint i;
+  unknown_encap_t unknown_encap;
+
+  if (section->have_ts) {
+    if (total->have_ts) {
+      if (nstime_cmp(&section->first_time, &total->last_time) < 0)
+        total->order = NOT_IN_ORDER;
+      if (nstime_cmp(&section->start_time, &total->start_time) < 0) {
+        total->start_time = section->start_time;
+        total->start_time_tsprec = section->start_time_tsprec;
+      }
+      if (nstime_cmp(&section->stop_time, &total->stop_time) > 0) {
+        total->stop_time = section->stop_time;
+        total->stop_time_tsprec = section->stop_time_tsprec;
+      }
+    } else {
+      total->first_time = section->first_time;
+      total->start_time = section->start_time;
+      total->start_time_tsprec = section->start_time_tsprec;
+      total->stop_time = section->stop_time;
+      total->stop_time_tsprec = section->stop_time_tsprec;
+      total->have_ts = TRUE;
+    }
+    total->last_time = section->last_time;
+  }
+  if (!section->have_times)
+    total->have_times = FALSE;
+  if (section->order == NOT_IN_ORDER)
+    total->order = NOT_IN_ORDER;
+  else if (section->order == ORDER_UNKNOWN && total->order != NOT_IN_ORDER)
+    total->order = ORDER_UNKNOWN;
+
+  if (section->unknown_encaps) {
+    if (total->unknown_encaps == NULL)
+      total->unknown_encaps = g_array_new(FALSE, FALSE, sizeof(unknown_encap_t));
+    for (i = 0; i < section->unknown_encaps->len; i++) {
+      unknown_encap = g_array_index(section->unknown_encaps, unknown_encap_t, i);
+      unknown_encap.frame += total->packet;
+      g_array_append_val(total->unknown_encaps, unknown_encap);
+    }
+  }
+  total->packet += section->packet;
+  total->bytes += section->bytes;
+  if (section->snaplen_min_inferred < total->snaplen_min_inferred)
+    total->snaplen_min_inferred = section->snaplen_min_inferred;
+  if (section->snaplen_max_inferred > total->snaplen_max_inferred)
+    total->snaplen_max_inferred = section->snaplen_max_inferred;
+  for (i = 0; i < WTAP_NUM_ENCAP_TYPES; i++)
+    total->encap_counts[i] += section->encap_counts[i];
+
+  /* Interface IDs in a section are relative to its first IDB */
+  g_array_append_vals(total->interface_packet_counts,
+                      section->interface_packet_counts->data,
+                      section->interface_packet_counts->len);
+  total->num_interfaces += section->num_interfaces;
+  total->pkt_interface_id_unknown += section->pkt_interface_id_unknown;
+}
+
+/*
+ * The file encapsulation, or time stamp precision, of a file made of
+ * sections with the given ones.
+ */
+static int
+merge_per_section_value(int total, int section, int unknown, int per_packet)
+{
+  if (section == unknown)
+    return total;
+  if (total == unknown)
+    return section;
+  if (total != section)
+    return per_packet;
+  return total;
+}
+
+static void
+get_idb_info_strings(wtap *wth, GArray *idb_info_strings)
+{
+  wtapng_iface_descriptions_t *idb_info;
+  guint i;
+
+  idb_info = wtap_file_get_idb_info(wth);
+  for (i = 0; i < idb_info->interface_data->len; i++) {
+    const wtap_block_t if_descr = g_array_index(idb_info->interface_data, wtap_block_t, i);
+    gchar *s = wtap_get_debug_if_descr(if_descr, 21, "\n");
+    g_array_append_val(idb_info_strings, s);
+  }
+  g_free(idb_info);
+}
+
+static void
+process_section(gpointer data, gpointer user_data _U_)
+{
+  section_task_t *task = (section_task_t *)data;
+  wtap *wth;
+
+  wth = wtap_open_offline_section(task->filename, task->offset,
+                                  &task->err, &task->err_info, FALSE);
+  if (wth == NULL)
+    return;
+  task->opened = TRUE;
+
+  wtap_set_cb_new_ipv4(wth, count_ipv4_address);
+  wtap_set_cb_new_ipv6(wth, count_ipv6_address);
+  wtap_set_cb_new_secrets(wth, count_decryption_secret);
+  wtap_set_skip_packet_data(wth, TRUE);
+
+  tally_records(wth, &task->tally, &task->err, &task->err_info);
+
+  get_idb_info_strings(wth, task->idb_info_strings);
+  task->shb = wtap_block_ref(wtap_file_get_shb(wth, 0));
+  task->file_encap = wtap_file_encap(wth);
+  task->file_tsprec = wtap_file_tsprec(wth);
+  wtap_close(wth);
+}
+
+/*
+ * Read the sections of a multi-section file in parallel, and add them
+ * up in file order, stopping after the first one with a read error.
+ * Returns FALSE, having reported the error, if a section couldn't be
+ * opened.
+ */
+static gboolean
+process_sections(const char *filename, GArray *section_offsets,
+                 capture_info *cf_info, record_tally_t *tally,
+                 int *err, gchar **err_info)
+{
+  section_task_t *tasks;
+  GThreadPool   *pool;
+  guint          num_sections = section_offsets->len;
+  guint          i, j;
+  gboolean       ret = TRUE;
+
+  tasks = g_new0(section_task_t, num_sections);
+  pool = g_thread_pool_new(process_section, NULL,
+                           (gint)MIN(num_sections, g_get_num_processors()),
+                           FALSE, NULL);
+  for (i = 0; i < num_sections; i++) {
+    tasks[i].filename = filename;
+    tasks[i].offset = g_array_index(section_offsets, gint64, i);
+    init_record_tally(&tasks[i].tally);
+    tasks[i].idb_info_strings = g_array_new(FALSE, FALSE, sizeof(gchar*));
+    tasks[i].file_encap = WTAP_ENCAP_UNKNOWN;
+    tasks[i].file_tsprec = WTAP_TSPREC_UNKNOWN;
+    g_thread_pool_push(pool, &tasks[i], NULL);
+  }
+  /* Wait for all of them to finish */
+  g_thread_pool_free(pool, FALSE, TRUE);
+
+  cf_info->file_encap = WTAP_ENCAP_UNKNOWN;
+  cf_info->file_tsprec = WTAP_TSPREC_UNKNOWN;
+  *err = 0;
+  for (i = 0; i < num_sections; i++) {
+    if (*err != 0)
+      break;
+    if (!tasks[i].opened) {
+      cfile_open_failure_message(filename, tasks[i].err, tasks[i].err_info);
+      ret = FALSE;
+      break;
+    }
+    merge_record_tally(tally, &tasks[i].tally);
+    g_array_append_vals(cf_info->idb_info_strings, tasks[i].idb_info_strings->data,
+                        tasks[i].idb_info_strings->len);
+    g_array_set_size(tasks[i].idb_info_strings, 0);
+    g_array_append_val(cf_info->shbs, tasks[i].shb);
+    tasks[i].shb = NULL;
+    cf_info->file_encap = merge_per_section_value(cf_info->file_encap,
+        tasks[i].file_encap, WTAP_ENCAP_UNKNOWN, WTAP_ENCAP_PER_PACKET);
+    cf_info->file_tsprec = merge_per_section_value(cf_info->file_tsprec,
+        tasks[i].file_tsprec, WTAP_TSPREC_UNKNOWN, WTAP_TSPREC_PER_PACKET);
+    if (tasks[i].err != 0) {
+      *err = tasks[i].err;
+      *err_info = tasks[i].err_info;
+      tasks[i].err_info = NULL;
+    }
+  }
+
+  for (i = 0; i < num_sections; i++) {
+    cleanup_record_tally(&tasks[i].tally);
+    for (j = 0; j < tasks[i].idb_info_strings->len; j++)
+      g_free(g_array_index(tasks[i].idb_info_strings, gchar*, j));
+    g_array_free(tasks[i].idb_info_strings, TRUE);
+    if (tasks[i].shb != NULL)
+      wtap_block_unref(tasks[i].shb);
+    g_free(tasks[i].err_info);
+  }
+  g_free(tasks);
+  return ret;
+}
+
 static int
 process_cap_file(const char *filename, gboolean need_separator)
 {
@@ -1195,26 +1622,11 @@ process_cap_file(const char *filename, gboolean need_separator)
   int                   err;
   gchar                *err_info;
   gint64                size;
-  gint64                data_offset;
-
-  guint32               packet = 0;
-  gint64                bytes  = 0;
-  guint32               snaplen_min_inferred = 0xffffffff;
-  guint32               snaplen_max_inferred =          0;
-  wtap_rec              rec;
-  Buffer                buf;
   capture_info          cf_info;
-  gboolean              have_times = TRUE;
-  nstime_t              start_time;
-  int                   start_time_tsprec;
-  nstime_t              stop_time;
-  int                   stop_time_tsprec;
-  nstime_t              cur_time;
-  nstime_t              prev_time;
+  record_tally_t        tally;
+  GArray               *section_offsets = NULL;
   gboolean              know_order = FALSE;
-  order_t               order = IN_ORDER;
   guint                 i;
-  wtapng_iface_descriptions_t *idb_info;
 
   cf_info.wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
   if (!cf_info.wth) {
@@ -1233,158 +1645,99 @@ process_cap_file(const char *filename, gboolean need_separator)
     printf("\n");
   }
 
-  nstime_set_zero(&start_time);
-  start_time_tsprec = WTAP_TSPREC_UNKNOWN;
-  nstime_set_zero(&stop_time);
-  stop_time_tsprec = WTAP_TSPREC_UNKNOWN;
-  nstime_set_zero(&cur_time);
-  nstime_set_zero(&prev_time);
-
-  cf_info.encap_counts = g_new0(int,WTAP_NUM_ENCAP_TYPES);
-
-  idb_info = wtap_file_get_idb_info(cf_info.wth);
-
-  ws_assert(idb_info->interface_data != NULL);
-
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  cf_info.interface_packet_counts  = g_array_sized_new(FALSE, TRUE, sizeof(guint32), cf_info.num_interfaces);
-  g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-  cf_info.pkt_interface_id_unknown = 0;
-
-  g_free(idb_info);
-  idb_info = NULL;
-
-  /* Register callbacks for new name<->address maps from the file and
-     decryption secrets from the file. */
-  wtap_set_cb_new_ipv4(cf_info.wth, count_ipv4_address);
-  wtap_set_cb_new_ipv6(cf_info.wth, count_ipv6_address);
-  wtap_set_cb_new_secrets(cf_info.wth, count_decryption_secret);
+  cf_info.encap_counts = NULL;
+  cf_info.interface_packet_counts = NULL;
+  cf_info.idb_info_strings = g_array_new(FALSE, FALSE, sizeof(gchar*));
+  cf_info.shbs = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
 
   /* Zero out the counters for the callbacks. */
   num_ipv4_addresses = 0;
   num_ipv6_addresses = 0;
   num_decryption_secrets = 0;
 
-  /* Tally up data that we need to parse through the file to find */
-  wtap_rec_init(&rec);
-  ws_buffer_init(&buf, 1514);
-  while (wtap_read(cf_info.wth, &rec, &buf, &err, &err_info, &data_offset))  {
-    if (rec.presence_flags & WTAP_HAS_TS) {
-      prev_time = cur_time;
-      cur_time = rec.ts;
-      if (packet == 0) {
-        start_time = rec.ts;
-        start_time_tsprec = rec.tsprec;
-        stop_time  = rec.ts;
-        stop_time_tsprec = rec.tsprec;
-        prev_time  = rec.ts;
-      }
-      if (nstime_cmp(&cur_time, &prev_time) < 0) {
-        order = NOT_IN_ORDER;
-      }
-      if (nstime_cmp(&cur_time, &start_time) < 0) {
-        start_time = cur_time;
-        start_time_tsprec = rec.tsprec;
-      }
-      if (nstime_cmp(&cur_time, &stop_time) > 0) {
-        stop_time = cur_time;
-        stop_time_tsprec = rec.tsprec;
-      }
-    } else {
-      have_times = FALSE; /* at least one packet has no time stamp */
-      if (order != NOT_IN_ORDER)
-        order = ORDER_UNKNOWN;
+  init_record_tally(&tally);
+
+  /*
+   * The sections of an uncompressed pcapng file can be read
+   * independently, so, if there's more than one, read them in
+   * parallel. (Seeking in a compressed file means decompressing
+   * everything before the seek offset, so there'd be little to gain.)
+   * If we can't find the sections, reading the file the usual way
+   * will report why.
+   */
+  if (strcmp(filename, "-") != 0 &&
+      wtap_file_type_subtype(cf_info.wth) == wtap_pcapng_file_type_subtype() &&
+      wtap_get_compression_type(cf_info.wth) == WTAP_UNCOMPRESSED) {
+    if (!wtap_get_section_offsets(cf_info.wth, &section_offsets, &err, &err_info)) {
+      g_free(err_info);
+      section_offsets = NULL;
     }
+  }
 
-    if (rec.rec_type == REC_TYPE_PACKET) {
-      bytes += rec.rec_header.packet_header.len;
-      packet++;
-
-      /* If caplen < len for a rcd, then presumably           */
-      /* 'Limit packet capture length' was done for this rcd. */
-      /* Keep track as to the min/max actual snapshot lengths */
-      /*  seen for this file.                                 */
-      if (rec.rec_header.packet_header.caplen < rec.rec_header.packet_header.len) {
-        if (rec.rec_header.packet_header.caplen < snaplen_min_inferred)
-          snaplen_min_inferred = rec.rec_header.packet_header.caplen;
-        if (rec.rec_header.packet_header.caplen > snaplen_max_inferred)
-          snaplen_max_inferred = rec.rec_header.packet_header.caplen;
-      }
+  if (section_offsets != NULL && section_offsets->len > 1) {
+    if (!process_sections(filename, section_offsets, &cf_info, &tally,
+                          &err, &err_info)) {
+      g_array_free(section_offsets, TRUE);
+      cleanup_record_tally(&tally);
+      cleanup_capture_info(&cf_info);
+      wtap_close(cf_info.wth);
+      return 2;
+    }
+  } else {
+    /* Register callbacks for new name<->address maps from the file and
+       decryption secrets from the file. */
+    wtap_set_cb_new_ipv4(cf_info.wth, count_ipv4_address);
+    wtap_set_cb_new_ipv6(cf_info.wth, count_ipv6_address);
+    wtap_set_cb_new_secrets(cf_info.wth, count_decryption_secret);
 
-      if ((rec.rec_header.packet_header.pkt_encap > 0) &&
-          (rec.rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-        cf_info.encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
-      } else {
-        fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
-                rec.rec_header.packet_header.pkt_encap, packet, filename);
-      }
+    /* We only look at the record metadata, never at the packet data */
+    wtap_set_skip_packet_data(cf_info.wth, TRUE);
 
-      /* Packet interface_id info */
-      if (rec.presence_flags & WTAP_HAS_INTERFACE_ID) {
-        /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-        if (rec.rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
-          /*
-           * OK, re-fetch the number of interfaces, as there might have
-           * been an interface that was in the middle of packets, and
-           * grow the array to be big enough for the new number of
-           * interfaces.
-           */
-          idb_info = wtap_file_get_idb_info(cf_info.wth);
-
-          cf_info.num_interfaces = idb_info->interface_data->len;
-          g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-
-          g_free(idb_info);
-          idb_info = NULL;
-        }
-        if (rec.rec_header.packet_header.interface_id < cf_info.num_interfaces) {
-          g_array_index(cf_info.interface_packet_counts, guint32,
-                        rec.rec_header.packet_header.interface_id) += 1;
-        }
-        else {
-          cf_info.pkt_interface_id_unknown += 1;
-        }
-      }
-      else {
-        /* it's for interface_id 0 */
-        if (cf_info.num_interfaces != 0) {
-          g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
-        }
-        else {
-          cf_info.pkt_interface_id_unknown += 1;
-        }
-      }
-    }
+    tally_records(cf_info.wth, &tally, &err, &err_info);
 
-    wtap_rec_reset(&rec);
-  } /* while */
-  wtap_rec_cleanup(&rec);
-  ws_buffer_free(&buf);
+    /*
+     * Get IDB info strings.
+     * We do this at the end, so we can get information for all IDBs in
+     * the file, even those that come after packet records, and so that
+     * we get, for example, a count of the number of statistics entries
+     * for each interface as of the *end* of the file.
+     */
+    get_idb_info_strings(cf_info.wth, cf_info.idb_info_strings);
 
-  /*
-   * Get IDB info strings.
-   * We do this at the end, so we can get information for all IDBs in
-   * the file, even those that come after packet records, and so that
-   * we get, for example, a count of the number of statistics entries
-   * for each interface as of the *end* of the file.
-   */
-  idb_info = wtap_file_get_idb_info(cf_info.wth);
+    for (i = 0; i < wtap_file_get_num_shbs(cf_info.wth); i++) {
+      wtap_block_t shb = wtap_block_ref(wtap_file_get_shb(cf_info.wth, i));
+      g_array_append_val(cf_info.shbs, shb);
+    }
 
-  cf_info.idb_info_strings = g_array_sized_new(FALSE, FALSE, sizeof(gchar*), cf_info.num_interfaces);
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  for (i = 0; i < cf_info.num_interfaces; i++) {
-    const wtap_block_t if_descr = g_array_index(idb_info->interface_data, wtap_block_t, i);
-    gchar *s = wtap_get_debug_if_descr(if_descr, 21, "\n");
-    g_array_append_val(cf_info.idb_info_strings, s);
-  }
+    /* File Encapsulation */
+    cf_info.file_encap = wtap_file_encap(cf_info.wth);
 
-  g_free(idb_info);
-  idb_info = NULL;
+    cf_info.file_tsprec = wtap_file_tsprec(cf_info.wth);
+  }
+  if (section_offsets != NULL)
+    g_array_free(section_offsets, TRUE);
+
+  /* The tally's counts now belong to cf_info */
+  cf_info.encap_counts = tally.encap_counts;
+  tally.encap_counts = NULL;
+  cf_info.num_interfaces = tally.num_interfaces;
+  cf_info.interface_packet_counts = tally.interface_packet_counts;
+  tally.interface_packet_counts = NULL;
+  cf_info.pkt_interface_id_unknown = tally.pkt_interface_id_unknown;
+  ws_assert(cf_info.num_interfaces == cf_info.idb_info_strings->len);
+
+  if (tally.unknown_encaps) {
+    for (i = 0; i < tally.unknown_encaps->len; i++) {
+      unknown_encap_t *unknown_encap = &g_array_index(tally.unknown_encaps, unknown_encap_t, i);
+      fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
+              unknown_encap->encap, unknown_encap->frame, filename);
+    }
+  }
 
   if (err != 0) {
     fprintf(stderr,
         "capinfos: An error occurred after reading %u packets from \"%s\".\n",
-        packet, filename);
+        tally.packet, filename);
     cfile_read_failure_message(filename, err, err_info);
     if (err == WTAP_ERR_SHORT_READ) {
         /* Don't give up completely with this one. */
@@ -1392,6 +1745,7 @@ process_cap_file(const char *filename, gboolean need_separator)
         fprintf(stderr,
           "  (will continue anyway, checksums might be incorrect)\n");
     } else {
+        cleanup_record_tally(&tally);
         cleanup_capture_info(&cf_info);
         wtap_close(cf_info.wth);
         return 2;
@@ -1404,6 +1758,7 @@ process_cap_file(const char *filename, gboolean need_separator)
     fprintf(stderr,
         "capinfos: Can't get size of \"%s\": %s.\n",
         filename, g_strerror(err));
+    cleanup_record_tally(&tally);
     cleanup_capture_info(&cf_info);
     wtap_close(cf_info.wth);
     return 2;
@@ -1415,11 +1770,6 @@ process_cap_file(const char *filename, gboolean need_separator)
   cf_info.file_type = wtap_file_type_subtype(cf_info.wth);
   cf_info.compression_type = wtap_get_compression_type(cf_info.wth);
 
-  /* File Encapsulation */
-  cf_info.file_encap = wtap_file_encap(cf_info.wth);
-
-  cf_info.file_tsprec = wtap_file_tsprec(cf_info.wth);
-
   /* Packet size limit (snaplen) */
   cf_info.snaplen = wtap_snapshot_length(cf_info.wth);
   if (cf_info.snaplen > 0)
@@ -1427,41 +1777,41 @@ process_cap_file(const char *filename, gboolean need_separator)
   else
     cf_info.snap_set = FALSE;
 
-  cf_info.snaplen_min_inferred = snaplen_min_inferred;
-  cf_info.snaplen_max_inferred = snaplen_max_inferred;
+  cf_info.snaplen_min_inferred = tally.snaplen_min_inferred;
+  cf_info.snaplen_max_inferred = tally.snaplen_max_inferred;
 
   /* # of packets */
-  cf_info.packet_count = packet;
+  cf_info.packet_count = tally.packet;
 
   /* File Times */
-  cf_info.times_known = have_times;
-  cf_info.start_time = start_time;
-  cf_info.start_time_tsprec = start_time_tsprec;
-  cf_info.stop_time = stop_time;
-  cf_info.stop_time_tsprec = stop_time_tsprec;
-  nstime_delta(&cf_info.duration, &stop_time, &start_time);
+  cf_info.times_known = tally.have_times;
+  cf_info.start_time = tally.start_time;
+  cf_info.start_time_tsprec = tally.start_time_tsprec;
+  cf_info.stop_time = tally.stop_time;
+  cf_info.stop_time_tsprec = tally.stop_time_tsprec;
+  nstime_delta(&cf_info.duration, &tally.stop_time, &tally.start_time);
   /* Duration precision is the higher of the start and stop time precisions. */
   if (cf_info.stop_time_tsprec > cf_info.start_time_tsprec)
     cf_info.duration_tsprec = cf_info.stop_time_tsprec;
   else
     cf_info.duration_tsprec = cf_info.start_time_tsprec;
   cf_info.know_order = know_order;
-  cf_info.order = order;
+  cf_info.order = tally.order;
 
   /* Number of packet bytes */
-  cf_info.packet_bytes = bytes;
+  cf_info.packet_bytes = tally.bytes;
 
   cf_info.data_rate   = 0.0;
   cf_info.packet_rate = 0.0;
   cf_info.packet_size = 0.0;
 
-  if (packet > 0) {
-    double delta_time = nstime_to_sec(&stop_time) - nstime_to_sec(&start_time);
+  if (tally.packet > 0) {
+    double delta_time = nstime_to_sec(&tally.stop_time) - nstime_to_sec(&tally.start_time);
     if (delta_time > 0.0) {
-      cf_info.data_rate   = (double)bytes  / delta_time; /* Data rate per second */
-      cf_info.packet_rate = (double)packet / delta_time; /* packet rate per second */
+      cf_info.data_rate   = (double)tally.bytes  / delta_time; /* Data rate per second */
+      cf_info.packet_rate = (double)tally.packet / delta_time; /* packet rate per second */
     }
-    cf_info.packet_size = (double)bytes / packet;                  /* Avg packet size      */
+    cf_info.packet_size = (double)tally.bytes / tally.packet;                  /* Avg packet size      */
   }
 
   if (long_report) {
@@ -1470,6 +1820,7 @@ process_cap_file(const char *filename, gboolean need_separator)
     print_stats_table(filename, &cf_info);
   }
 
+  cleanup_record_tally(&tally);
   cleanup_capture_info(&cf_info);
   wtap_close(cf_info.wth);
 
@@ -314,6 +314,11 @@ sync_pipe_start(capture_options *capture_opts, GPtrArray *capture_comments,
             argv = sync_pipe_add_arg(argv, &argc, nametimenum);
         }
 
+        if (capture_opts->ring_index) {
+            argv = sync_pipe_add_arg(argv, &argc, "-b");
+            argv = sync_pipe_add_arg(argv, &argc, "index:1");
+        }
+
         if (capture_opts->has_autostop_files) {
             char sautostop_files[ARGV_NUMBER_LEN];
             argv = sync_pipe_add_arg(argv, &argc, "-a");
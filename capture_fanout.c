@@ -0,0 +1,762 @@
+/* capture_fanout.c
+ * Additional capture outputs for dumpcap, each with its own filter,
+ * snapshot length and ring buffer, written by their own threads
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Running several dumpcaps on one interface, e.g. one writing whole
+ * packets to a short ring buffer and one writing headers only to a long
+ * one, makes the kernel capture and copy every packet once per dumpcap.
+ * Instead, one dumpcap can write any number of outputs besides its
+ * main one.
+ *
+ * The capture loop copies each packet once and queues it, reference
+ * counted, to every output. Each output has a writer thread that runs
+ * its filter over the packet in userspace with pcap_offline_filter(),
+ * cuts it to its snapshot length and writes it, switching and removing
+ * files the way ringbuffer.c does for the main output. The outputs are
+ * always pcapng.
+ *
+ * If an output falls behind by more than FANOUT_QUEUE_BYTES, packets
+ * are dropped for it alone; the drops are recorded in the ISBs it
+ * writes at the end of each file.
+ */
+
+#include <config.h>
+
+#ifdef HAVE_LIBPCAP
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include <glib.h>
+
+#include "capture_fanout.h"
+
+#include <wsutil/file_util.h>
+#include <wsutil/str_util.h>
+#include <wsutil/strtoi.h>
+#include <wsutil/wslog.h>
+
+#include "writecap/pcapio.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/* Most bytes of packet data an output may have waiting to be written */
+#define FANOUT_QUEUE_BYTES  (64 * 1024 * 1024)
+
+/* How often an idle writer thread checks its duration condition, in us */
+#define FANOUT_IDLE_TIMEOUT G_USEC_PER_SEC
+
+#ifndef PCAP_NETMASK_UNKNOWN
+#define PCAP_NETMASK_UNKNOWN 0xffffffff
+#endif
+
+/* A captured packet, shared by all outputs; the data follows it */
+typedef struct {
+    gint                refcount;
+    guint               interface_id;
+    struct pcap_pkthdr  phdr;
+} fanout_packet_t;
+
+/* Queued to a writer thread to tell it to finish */
+static fanout_packet_t fanout_end_marker;
+
+typedef struct {
+    /* settings */
+    gchar              *file_name;
+    gchar              *fprefix;
+    gchar              *fsuffix;
+    guint32             snaplen;            /**< 0 for whole packets */
+    gchar              *filter;             /**< NULL for all packets */
+    guint64             filesize;           /**< switch after this many bytes; 0 if not */
+    guint32             duration;           /**< switch after this many seconds; 0 if not */
+    guint64             packets;            /**< switch after this many packets; 0 if not */
+    guint32             num_files;          /**< files to keep; 0 for all */
+    gboolean            compress;           /**< gzip each file once it's done */
+    gboolean            ring;               /**< any of the switch conditions is set */
+
+    /* per interface */
+    struct bpf_program *progs;
+    guint64            *ifrecv;             /**< packets handed to this output */
+    guint64            *ifdrop;             /**< packets dropped as the queue was full */
+    gint               *ifdrop_pending;     /**< drops the writer thread hasn't counted yet; atomic */
+
+    /* capture loop side */
+    GAsyncQueue        *queue;
+    gint                queued_bytes;       /**< atomic */
+    GThread            *thread;
+
+    /* writer thread side */
+    FILE               *pdh;
+    char               *io_buffer;
+    gchar              *curr_name;
+    guint               curr_file_num;
+    guint64             bytes_written;
+    guint64             packets_written;
+    gint64              file_start_time;    /**< monotonic */
+    guint64             isb_start_time;     /**< us since the epoch */
+    GQueue             *old_files;          /**< completed files, oldest first */
+    GThread            *compress_thread;
+    gboolean            failed;
+} fanout_output_t;
+
+static GPtrArray *outputs;
+
+static const fanout_interface_t *fanout_ifaces;
+static guint fanout_num_ifaces;
+static const char *fanout_shb_os;
+static const char *fanout_shb_appname;
+static gboolean fanout_group_read_access;
+
+static void
+fanout_output_free(gpointer data)
+{
+    fanout_output_t *output = (fanout_output_t *)data;
+
+    g_free(output->file_name);
+    g_free(output->fprefix);
+    g_free(output->fsuffix);
+    g_free(output->filter);
+    g_free(output);
+}
+
+gboolean
+fanout_add_output(const char *spec, char **err_msg)
+{
+    fanout_output_t *output = g_new0(fanout_output_t, 1);
+    const char *p = spec;
+    char *last_pathsep, *sfx;
+
+    while (*p != '\0') {
+        const char *colon = strchr(p, ':');
+        const char *comma;
+        gchar *key, *value;
+        gboolean ok = TRUE;
+
+        if (colon == NULL) {
+            *err_msg = ws_strdup_printf("Output \"%s\": \"%s\" isn't of the form key:value", spec, p);
+            fanout_output_free(output);
+            return FALSE;
+        }
+        key = g_strndup(p, colon - p);
+        if (strcmp(key, "filter") == 0) {
+            /* the filter is the rest of the argument */
+            comma = colon + 1 + strlen(colon + 1);
+        } else {
+            comma = strchr(colon + 1, ',');
+            if (comma == NULL)
+                comma = colon + 1 + strlen(colon + 1);
+        }
+        value = g_strndup(colon + 1, comma - (colon + 1));
+
+        if (strcmp(key, "file") == 0) {
+            g_free(output->file_name);
+            output->file_name = g_strdup(value);
+            ok = *value != '\0';
+        } else if (strcmp(key, "snaplen") == 0) {
+            ok = ws_strtou32(value, NULL, &output->snaplen);
+        } else if (strcmp(key, "filter") == 0) {
+            g_free(output->filter);
+            output->filter = g_strdup(value);
+        } else if (strcmp(key, "filesize") == 0) {
+            /* in kB, as with -b filesize */
+            ok = ws_strtou64(value, NULL, &output->filesize) && output->filesize > 0 &&
+                 output->filesize <= G_MAXUINT64 / 1000;
+            output->filesize *= 1000;
+        } else if (strcmp(key, "duration") == 0) {
+            ok = ws_strtou32(value, NULL, &output->duration) && output->duration > 0;
+        } else if (strcmp(key, "packets") == 0) {
+            ok = ws_strtou64(value, NULL, &output->packets) && output->packets > 0;
+        } else if (strcmp(key, "files") == 0) {
+            ok = ws_strtou32(value, NULL, &output->num_files);
+        } else if (strcmp(key, "compress") == 0) {
+#ifdef HAVE_ZLIB
+            ok = strcmp(value, "gzip") == 0;
+            output->compress = TRUE;
+#else
+            *err_msg = ws_strdup_printf("Output \"%s\": compression isn't supported by this build", spec);
+            g_free(key);
+            g_free(value);
+            fanout_output_free(output);
+            return FALSE;
+#endif
+        } else {
+            *err_msg = ws_strdup_printf("Output \"%s\": unknown key \"%s\"", spec, key);
+            g_free(key);
+            g_free(value);
+            fanout_output_free(output);
+            return FALSE;
+        }
+        if (!ok) {
+            *err_msg = ws_strdup_printf("Output \"%s\": invalid %s \"%s\"", spec, key, value);
+            g_free(key);
+            g_free(value);
+            fanout_output_free(output);
+            return FALSE;
+        }
+        g_free(key);
+        g_free(value);
+
+        p = (*comma == ',') ? comma + 1 : comma;
+    }
+
+    if (output->file_name == NULL) {
+        *err_msg = ws_strdup_printf("Output \"%s\": no file given", spec);
+        fanout_output_free(output);
+        return FALSE;
+    }
+    if (output->num_files > 0 && output->filesize == 0 && output->duration == 0 &&
+        output->packets == 0) {
+        *err_msg = ws_strdup_printf("Output \"%s\": files needs filesize, duration or packets", spec);
+        fanout_output_free(output);
+        return FALSE;
+    }
+    output->ring = output->filesize != 0 || output->duration != 0 || output->packets != 0;
+
+    /* Split the name as ringbuffer.c does, so the file number goes before the suffix */
+    last_pathsep = strrchr(output->file_name, G_DIR_SEPARATOR);
+    sfx = strrchr(output->file_name, '.');
+    if (sfx != NULL && (last_pathsep == NULL || sfx > last_pathsep)) {
+        output->fprefix = g_strndup(output->file_name, sfx - output->file_name);
+        output->fsuffix = g_strdup(sfx);
+    } else {
+        output->fprefix = g_strdup(output->file_name);
+        output->fsuffix = g_strdup("");
+    }
+
+    if (outputs == NULL)
+        outputs = g_ptr_array_new_with_free_func(fanout_output_free);
+    g_ptr_array_add(outputs, output);
+    return TRUE;
+}
+
+gboolean
+fanout_enabled(void)
+{
+    return outputs != NULL && outputs->len > 0;
+}
+
+/*
+ * gzip a completed file, and remove it if that worked.
+ */
+static gpointer
+fanout_compress_thread(gpointer arg)
+{
+#ifdef HAVE_ZLIB
+    gchar   *name = (gchar *)arg;
+    gchar   *gzname = ws_strdup_printf("%s.gz", name);
+    guint8  *buffer;
+    int      fd;
+    gzFile   gzfh;
+    ssize_t  nread;
+    gboolean ok = TRUE;
+
+    fd = ws_open(name, O_RDONLY | O_BINARY, 0000);
+    if (fd < 0) {
+        g_free(gzname);
+        g_free(name);
+        return NULL;
+    }
+    gzfh = gzopen(gzname, "wb");
+    if (gzfh == NULL) {
+        ws_close(fd);
+        g_free(gzname);
+        g_free(name);
+        return NULL;
+    }
+
+    buffer = (guint8 *)g_malloc(65536);
+    while ((nread = ws_read(fd, buffer, 65536)) > 0) {
+        if (gzwrite(gzfh, buffer, (unsigned int)nread) <= 0) {
+            ok = FALSE;
+            break;
+        }
+    }
+    if (nread < 0)
+        ok = FALSE;
+    ws_close(fd);
+    if (gzclose(gzfh) != Z_OK)
+        ok = FALSE;
+    g_free(buffer);
+
+    if (ok)
+        ws_unlink(name);
+    else
+        ws_unlink(gzname);
+    g_free(gzname);
+    g_free(name);
+#else
+    g_free(arg);
+#endif
+    return NULL;
+}
+
+static void
+fanout_wait_compress(fanout_output_t *output)
+{
+    if (output->compress_thread != NULL) {
+        g_thread_join(output->compress_thread);
+        output->compress_thread = NULL;
+    }
+}
+
+/*
+ * Remove the oldest files until, with the one we're about to open,
+ * there are no more than num_files.
+ */
+static void
+fanout_remove_old_files(fanout_output_t *output)
+{
+    gchar *name;
+
+    if (output->num_files == 0)
+        return;
+
+    while (g_queue_get_length(output->old_files) >= output->num_files) {
+        name = (gchar *)g_queue_pop_head(output->old_files);
+        /* it might be the file that's being compressed */
+        fanout_wait_compress(output);
+        ws_unlink(name);
+        if (output->compress) {
+            gchar *gzname = ws_strdup_printf("%s.gz", name);
+            ws_unlink(gzname);
+            g_free(gzname);
+        }
+        g_free(name);
+    }
+}
+
+static gboolean
+fanout_open_file(fanout_output_t *output, int *err)
+{
+    int      fd;
+    size_t   buffsize = CAPTURE_IO_BUF_SIZE;
+    gboolean successful;
+    guint    i;
+
+    if (output->ring) {
+        char       filenum[5+1];
+        char       timestr[14+1];
+        time_t     current_time = time(NULL);
+        struct tm *tm = localtime(&current_time);
+
+        fanout_remove_old_files(output);
+        output->curr_file_num++;
+        snprintf(filenum, sizeof(filenum), "%05u", output->curr_file_num % 100000);
+        if (tm != NULL)
+            strftime(timestr, sizeof(timestr), "%Y%m%d%H%M%S", tm);
+        else
+            (void) g_strlcpy(timestr, "196912312359", sizeof(timestr));
+        output->curr_name = g_strconcat(output->fprefix, "_", filenum, "_", timestr,
+                                        output->fsuffix, NULL);
+    } else {
+        output->curr_name = g_strdup(output->file_name);
+    }
+
+    fd = ws_open(output->curr_name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
+                 fanout_group_read_access ? 0640 : 0600);
+    if (fd == -1) {
+        *err = errno;
+        return FALSE;
+    }
+    output->pdh = ws_fdopen(fd, "wb");
+    if (output->pdh == NULL) {
+        *err = errno;
+        ws_close(fd);
+        return FALSE;
+    }
+    output->io_buffer = (char *)g_realloc(output->io_buffer, buffsize);
+    setvbuf(output->pdh, output->io_buffer, _IOFBF, buffsize);
+
+    output->bytes_written = 0;
+    output->packets_written = 0;
+    output->file_start_time = g_get_monotonic_time();
+    output->isb_start_time = (guint64)g_get_real_time();
+
+    successful = pcapng_write_section_header_block(output->pdh,
+                                                   NULL,
+                                                   NULL,
+                                                   fanout_shb_os,
+                                                   fanout_shb_appname,
+                                                   -1,
+                                                   &output->bytes_written,
+                                                   err);
+    for (i = 0; successful && i < fanout_num_ifaces; i++) {
+        const fanout_interface_t *iface = &fanout_ifaces[i];
+        int snaplen = iface->snaplen;
+
+        if (output->snaplen != 0 && (snaplen == 0 || (guint32)snaplen > output->snaplen))
+            snaplen = (int)output->snaplen;
+        successful = pcapng_write_interface_description_block(output->pdh,
+                                                              NULL,
+                                                              iface->name,
+                                                              iface->descr,
+                                                              output->filter,
+                                                              fanout_shb_os,
+                                                              NULL,
+                                                              iface->linktype,
+                                                              snaplen,
+                                                              &output->bytes_written,
+                                                              0,
+                                                              iface->ts_nsec ? 9 : 6,
+                                                              err);
+    }
+    return successful;
+}
+
+static gboolean
+fanout_close_file(fanout_output_t *output, int *err)
+{
+    guint64  end_time = (guint64)g_get_real_time();
+    gboolean successful = TRUE;
+    guint    i;
+
+    for (i = 0; i < fanout_num_ifaces; i++) {
+        gint drops = g_atomic_int_get(&output->ifdrop_pending[i]);
+
+        g_atomic_int_add(&output->ifdrop_pending[i], -drops);
+        output->ifdrop[i] += drops;
+        output->ifrecv[i] += drops;
+    }
+    for (i = 0; successful && i < fanout_num_ifaces; i++) {
+        successful = pcapng_write_interface_statistics_block(output->pdh,
+                                                             i,
+                                                             &output->bytes_written,
+                                                             "Counters provided by dumpcap for this output",
+                                                             output->isb_start_time,
+                                                             end_time,
+                                                             output->ifrecv[i],
+                                                             output->ifdrop[i],
+                                                             err);
+    }
+    if (fclose(output->pdh) == EOF && successful) {
+        *err = errno;
+        successful = FALSE;
+    }
+    output->pdh = NULL;
+
+    if (output->ring) {
+        g_queue_push_tail(output->old_files, g_strdup(output->curr_name));
+        if (output->compress) {
+            /* one file at a time, so we don't pile up threads */
+            fanout_wait_compress(output);
+            output->compress_thread = g_thread_new("Output compress", fanout_compress_thread,
+                                                   g_strdup(output->curr_name));
+        }
+    }
+    g_free(output->curr_name);
+    output->curr_name = NULL;
+    return successful;
+}
+
+static void
+fanout_output_error(fanout_output_t *output, int err)
+{
+    ws_warning("Output %s failed: %s; no more packets will be written to it.",
+               output->curr_name ? output->curr_name : output->file_name, g_strerror(err));
+    output->failed = TRUE;
+}
+
+static gboolean
+fanout_switch_due(fanout_output_t *output)
+{
+    if (!output->ring)
+        return FALSE;
+    if (output->filesize != 0 && output->bytes_written >= output->filesize)
+        return TRUE;
+    if (output->packets != 0 && output->packets_written >= output->packets)
+        return TRUE;
+    if (output->duration != 0 &&
+        g_get_monotonic_time() - output->file_start_time >= (gint64)output->duration * G_USEC_PER_SEC)
+        return TRUE;
+    return FALSE;
+}
+
+static void
+fanout_write_packet(fanout_output_t *output, const fanout_packet_t *packet)
+{
+    const guint8 *pd = (const guint8 *)(packet + 1);
+    const fanout_interface_t *iface = &fanout_ifaces[packet->interface_id];
+    guint32 caplen = packet->phdr.caplen;
+    int err;
+
+    if (output->filter != NULL &&
+        !pcap_offline_filter(&output->progs[packet->interface_id], &packet->phdr, pd))
+        return;
+
+    if (output->snaplen != 0 && caplen > output->snaplen)
+        caplen = output->snaplen;
+
+    if (!pcapng_write_enhanced_packet_block(output->pdh,
+                                            NULL,
+                                            packet->phdr.ts.tv_sec, (gint32)packet->phdr.ts.tv_usec,
+                                            caplen, packet->phdr.len,
+                                            packet->interface_id,
+                                            iface->ts_nsec ? 1000000000 : 1000000,
+                                            pd, 0,
+                                            &output->bytes_written, &err)) {
+        fanout_output_error(output, err);
+        return;
+    }
+    output->packets_written++;
+}
+
+static void
+fanout_packet_unref(fanout_packet_t *packet)
+{
+    if (g_atomic_int_dec_and_test(&packet->refcount))
+        g_free(packet);
+}
+
+static gpointer
+fanout_writer_thread(gpointer arg)
+{
+    fanout_output_t *output = (fanout_output_t *)arg;
+    fanout_packet_t *packet;
+    int err;
+
+    for (;;) {
+        packet = (fanout_packet_t *)g_async_queue_timeout_pop(output->queue, FANOUT_IDLE_TIMEOUT);
+        if (packet == &fanout_end_marker)
+            break;
+
+        if (packet != NULL) {
+            g_atomic_int_add(&output->queued_bytes, -(gint)packet->phdr.caplen);
+            output->ifrecv[packet->interface_id]++;
+            if (!output->failed)
+                fanout_write_packet(output, packet);
+            fanout_packet_unref(packet);
+        }
+
+        if (!output->failed && fanout_switch_due(output)) {
+            if (!fanout_close_file(output, &err) || !fanout_open_file(output, &err))
+                fanout_output_error(output, err);
+        }
+    }
+
+    if (output->pdh != NULL && !fanout_close_file(output, &err) && !output->failed)
+        fanout_output_error(output, err);
+    fanout_wait_compress(output);
+    return NULL;
+}
+
+static void
+fanout_output_reset(fanout_output_t *output)
+{
+    guint i;
+
+    if (output->progs != NULL) {
+        for (i = 0; i < fanout_num_ifaces; i++)
+            pcap_freecode(&output->progs[i]);
+        g_free(output->progs);
+        output->progs = NULL;
+    }
+    g_free(output->ifrecv);
+    output->ifrecv = NULL;
+    g_free(output->ifdrop);
+    output->ifdrop = NULL;
+    g_free(output->ifdrop_pending);
+    output->ifdrop_pending = NULL;
+    if (output->queue != NULL) {
+        g_async_queue_unref(output->queue);
+        output->queue = NULL;
+    }
+    g_free(output->io_buffer);
+    output->io_buffer = NULL;
+    g_free(output->curr_name);
+    output->curr_name = NULL;
+    if (output->old_files != NULL) {
+        g_queue_free_full(output->old_files, g_free);
+        output->old_files = NULL;
+    }
+}
+
+/*
+ * Compile an output's filter for every interface. A bpf_program is tied
+ * to a link-layer type, so each interface gets its own.
+ */
+static gboolean
+fanout_compile_filter(fanout_output_t *output, char **err_msg)
+{
+    guint i;
+
+    output->progs = g_new0(struct bpf_program, fanout_num_ifaces);
+    for (i = 0; i < fanout_num_ifaces; i++) {
+        const fanout_interface_t *iface = &fanout_ifaces[i];
+        pcap_t *pc = pcap_open_dead(iface->linktype, iface->snaplen > 0 ? iface->snaplen : 262144);
+
+        if (pc == NULL) {
+            *err_msg = g_strdup("Can't compile output filters: pcap_open_dead() failed");
+            return FALSE;
+        }
+        if (pcap_compile(pc, &output->progs[i], output->filter, 1, PCAP_NETMASK_UNKNOWN) == -1) {
+            *err_msg = ws_strdup_printf("Invalid filter for output %s on interface %s: %s",
+                                        output->file_name, iface->name, pcap_geterr(pc));
+            pcap_close(pc);
+            return FALSE;
+        }
+        pcap_close(pc);
+    }
+    return TRUE;
+}
+
+gboolean
+fanout_start(const fanout_interface_t *ifaces, guint num_ifaces,
+             const char *shb_os, const char *shb_appname,
+             gboolean group_read_access, char **err_msg)
+{
+    fanout_output_t *output;
+    guint i;
+    int err;
+
+    if (!fanout_enabled())
+        return TRUE;
+
+    fanout_ifaces = ifaces;
+    fanout_num_ifaces = num_ifaces;
+    fanout_shb_os = shb_os;
+    fanout_shb_appname = shb_appname;
+    fanout_group_read_access = group_read_access;
+
+    for (i = 0; i < outputs->len; i++) {
+        output = (fanout_output_t *)g_ptr_array_index(outputs, i);
+
+        if (output->filter != NULL && !fanout_compile_filter(output, err_msg))
+            goto error;
+        output->ifrecv = g_new0(guint64, num_ifaces);
+        output->ifdrop = g_new0(guint64, num_ifaces);
+        output->ifdrop_pending = g_new0(gint, num_ifaces);
+        output->old_files = g_queue_new();
+        output->failed = FALSE;
+        output->curr_file_num = 0;
+        if (!fanout_open_file(output, &err)) {
+            *err_msg = ws_strdup_printf("The output file \"%s\" could not be written: %s.",
+                                        output->curr_name, g_strerror(err));
+            if (output->pdh != NULL) {
+                fclose(output->pdh);
+                output->pdh = NULL;
+            }
+            goto error;
+        }
+        output->queue = g_async_queue_new();
+        output->queued_bytes = 0;
+    }
+
+    for (i = 0; i < outputs->len; i++) {
+        output = (fanout_output_t *)g_ptr_array_index(outputs, i);
+        output->thread = g_thread_new("Output writer", fanout_writer_thread, output);
+    }
+    return TRUE;
+
+error:
+    for (i = 0; i < outputs->len; i++) {
+        output = (fanout_output_t *)g_ptr_array_index(outputs, i);
+        if (output->pdh != NULL) {
+            fclose(output->pdh);
+            output->pdh = NULL;
+        }
+        fanout_output_reset(output);
+    }
+    return FALSE;
+}
+
+void
+fanout_packet(guint interface_id, const struct pcap_pkthdr *phdr,
+              const u_char *pd)
+{
+    fanout_packet_t *packet = NULL;
+    guint i;
+
+    if (!fanout_enabled() || interface_id >= fanout_num_ifaces)
+        return;
+
+    for (i = 0; i < outputs->len; i++) {
+        fanout_output_t *output = (fanout_output_t *)g_ptr_array_index(outputs, i);
+
+        if (output->thread == NULL)
+            continue;
+        if (g_atomic_int_get(&output->queued_bytes) + (gint64)phdr->caplen > FANOUT_QUEUE_BYTES) {
+            g_atomic_int_inc(&output->ifdrop_pending[interface_id]);
+            continue;
+        }
+        if (packet == NULL) {
+            packet = (fanout_packet_t *)g_try_malloc(sizeof(fanout_packet_t) + phdr->caplen);
+            if (packet == NULL) {
+                g_atomic_int_inc(&output->ifdrop_pending[interface_id]);
+                continue;
+            }
+            packet->refcount = 1;
+            packet->interface_id = interface_id;
+            packet->phdr = *phdr;
+            memcpy(packet + 1, pd, phdr->caplen);
+        } else {
+            g_atomic_int_inc(&packet->refcount);
+        }
+        g_atomic_int_add(&output->queued_bytes, (gint)phdr->caplen);
+        g_async_queue_push(output->queue, packet);
+    }
+}
+
+gboolean
+fanout_stop(void)
+{
+    gboolean ok = TRUE;
+    guint i;
+
+    if (!fanout_enabled())
+        return TRUE;
+
+    for (i = 0; i < outputs->len; i++) {
+        fanout_output_t *output = (fanout_output_t *)g_ptr_array_index(outputs, i);
+
+        if (output->thread != NULL)
+            g_async_queue_push(output->queue, &fanout_end_marker);
+    }
+    for (i = 0; i < outputs->len; i++) {
+        fanout_output_t *output = (fanout_output_t *)g_ptr_array_index(outputs, i);
+
+        if (output->thread == NULL)
+            continue;
+        g_thread_join(output->thread);
+        output->thread = NULL;
+        if (output->failed)
+            ok = FALSE;
+        fanout_output_reset(output);
+    }
+    return ok;
+}
+
+void
+fanout_cleanup(void)
+{
+    if (outputs != NULL) {
+        g_ptr_array_free(outputs, TRUE);
+        outputs = NULL;
+    }
+}
+
+#endif /* HAVE_LIBPCAP */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
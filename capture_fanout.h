@@ -0,0 +1,85 @@
+/** @file
+ *
+ * Additional capture outputs for dumpcap, each with its own filter,
+ * snapshot length and ring buffer, written by their own threads
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPTURE_FANOUT_H__
+#define __CAPTURE_FANOUT_H__
+
+#include <glib.h>
+
+#include "wspcap.h"
+
+/** An interface we capture on, as the outputs need to know it. */
+typedef struct {
+    const char *name;
+    const char *descr;
+    int         linktype;
+    int         snaplen;
+    gboolean    ts_nsec;
+} fanout_interface_t;
+
+/**
+ * Add an output described by the argument of dumpcap's --output option,
+ * a comma-separated list of key:value pairs: file, snaplen, filesize,
+ * duration, packets, files, compress and filter. As a filter can contain
+ * commas, "filter" must come last.
+ *
+ * Returns FALSE, with an error message to be freed by the caller in
+ * *err_msg, if the argument isn't valid.
+ */
+gboolean fanout_add_output(const char *spec, char **err_msg);
+
+/** TRUE if any outputs have been added. */
+gboolean fanout_enabled(void);
+
+/**
+ * Compile the outputs' filters for the given interfaces, open their
+ * first files and start their writer threads.
+ *
+ * Returns FALSE, with an error message to be freed by the caller in
+ * *err_msg, on failure; nothing has been started then.
+ */
+gboolean fanout_start(const fanout_interface_t *ifaces, guint num_ifaces,
+                      const char *shb_os, const char *shb_appname,
+                      gboolean group_read_access, char **err_msg);
+
+/**
+ * Hand a captured packet to every output. Its data is copied once and
+ * shared by the outputs, which filter and write it in their threads.
+ * Must be called from one thread only.
+ */
+void fanout_packet(guint interface_id, const struct pcap_pkthdr *phdr,
+                   const u_char *pd);
+
+/**
+ * Let the writer threads write out the packets they've been given, wait
+ * for them and close the outputs' files. Returns FALSE if any of the
+ * outputs failed, having logged why.
+ */
+gboolean fanout_stop(void);
+
+/** Free the outputs. */
+void fanout_cleanup(void);
+
+#endif /* __CAPTURE_FANOUT_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
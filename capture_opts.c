@@ -106,6 +106,7 @@ capture_opts_init(capture_options *capture_opts)
     capture_opts->file_duration                   = 60.0;             /* 1 min */
     capture_opts->has_file_interval               = FALSE;
     capture_opts->has_nametimenum                 = FALSE;
+    capture_opts->ring_index                      = FALSE;
     capture_opts->file_interval                   = 60;               /* 1 min */
     capture_opts->has_file_packets                = FALSE;
     capture_opts->file_packets                    = 0;
@@ -263,6 +264,7 @@ capture_opts_log(const char *log_domain, enum ws_log_level log_level, capture_op
     ws_log(log_domain, log_level, "FilePackets     (%u) : %u", capture_opts->has_file_packets, capture_opts->file_packets);
     ws_log(log_domain, log_level, "FileNameType        : %s", (capture_opts->has_nametimenum) ? "prefix_time_num.suffix"  : "prefix_num_time.suffix");
     ws_log(log_domain, log_level, "RingNumFiles    (%u) : %u", capture_opts->has_ring_num_files, capture_opts->ring_num_files);
+    ws_log(log_domain, log_level, "RingIndex           : %u", capture_opts->ring_index);
     ws_log(log_domain, log_level, "RingPrintFiles  (%u) : %s", capture_opts->print_file_names, (capture_opts->print_file_names ? capture_opts->print_name_to : ""));
 
     ws_log(log_domain, log_level, "AutostopFiles   (%u) : %u", capture_opts->has_autostop_files, capture_opts->autostop_files);
@@ -429,6 +431,8 @@ get_ring_arguments(capture_options *capture_opts, const char *arg)
     } else if (strcmp(arg,"nametimenum") == 0) {
         int val = get_positive_int(p, "file name: time before num");
         capture_opts->has_nametimenum = (val > 1);
+    } else if (strcmp(arg,"index") == 0) {
+        capture_opts->ring_index = (get_natural_int(p, "ring buffer index") != 0);
     } else if (strcmp(arg,"packets") == 0) {
         capture_opts->has_file_packets = TRUE;
         capture_opts->file_packets = get_positive_int(p, "ring buffer packet count");
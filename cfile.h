@@ -84,6 +84,7 @@ typedef struct _capture_file {
   guint32                     marked_count;         /* Number of marked frames */
   guint32                     ignored_count;        /* Number of ignored frames */
   guint32                     ref_time_count;       /* Number of time referenced frames */
+  guint32                     sample_skipped;       /* Number of frames not yet dissected in a sampled live capture */
   gboolean                    drops_known;          /* TRUE if we know how many packets were dropped */
   guint32                     drops;                /* Dropped packets */
   nstime_t                    elapsed_time;         /* Elapsed time */
@@ -91,6 +92,7 @@ typedef struct _capture_file {
   dfilter_t                  *rfcode;               /* Compiled read filter program */
   dfilter_t                  *dfcode;               /* Compiled display filter program */
   gchar                      *dfilter;              /* Display filter string */
+  GSList                     *dfilter_results;      /* Frames passed by recently applied display filters */
   gboolean                    redissecting;         /* TRUE if currently redissecting (cf_redissect_packets) */
   gboolean                    read_lock;            /* TRUE if currently processing a file (cf_read) */
   rescan_type                 redissection_queued;  /* Queued redissection type. */
@@ -59,6 +59,7 @@ main(int argc, char **argv)
 	char		*text;
 	dfilter_t	*df;
 	gchar		*err_msg;
+	gboolean	show_unoptimized = FALSE;
 
 	cmdarg_err_init(dftest_cmdarg_err, dftest_cmdarg_err_cont);
 
@@ -121,9 +122,16 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
+	/* "-u" also shows the code generated without optimizations */
+	if (argc > 1 && strcmp(argv[1], "-u") == 0) {
+		show_unoptimized = TRUE;
+		argc--;
+		argv++;
+	}
+
 	/* Check for filter on command line */
 	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+		fprintf(stderr, "Usage: dftest [-u] <filter>\n");
 		exit(1);
 	}
 
@@ -132,6 +140,17 @@ main(int argc, char **argv)
 
 	printf("Filter: %s\n", text);
 
+	if (show_unoptimized) {
+		dfilter_set_optimize(FALSE);
+		if (dfilter_compile(text, &df, NULL) && df != NULL) {
+			printf("\nUnoptimized:\n");
+			dfilter_dump(df);
+			printf("\nOptimized:\n");
+		}
+		dfilter_free(df);
+		dfilter_set_optimize(TRUE);
+	}
+
 	/* Compile it */
 	if (!dfilter_compile(text, &df, &err_msg)) {
 		fprintf(stderr, "dftest: %s\n", err_msg);
@@ -46,6 +46,7 @@
 #endif
 
 #include "ringbuffer.h"
+#include "capture_fanout.h"
 
 #include "capture/capture_ifinfo.h"
 #include "capture/capture-pcap-util.h"
@@ -114,6 +115,8 @@ static gint64 pcap_queue_bytes;
 static gint64 pcap_queue_packets;
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
+static gint64 pcap_queue_bytes_max;
+static gint64 pcap_queue_packets_max;
 
 static gboolean capture_child = FALSE; /* FALSE: standalone call, TRUE: this is an Wireshark capture child */
 static const char *report_capture_filename = NULL; /* capture child file name */
@@ -246,6 +249,8 @@ typedef struct _loop_data {
     int       err;                 /**< if non-zero, error seen while capturing */
     gint      packets_captured;    /**< Number of packets we have already captured */
     guint     inpkts_to_sync_pipe; /**< Packets not already send out to the sync_pipe */
+    gint64    last_sync_time;      /**< When we last sent a packet count to the sync_pipe */
+    gint64    sync_interval;       /**< Current minimum time between packet counts, in us */
 #ifdef SIGINFO
     gboolean  report_packet_count; /**< Set by SIGINFO handler; print packet count */
 #endif
@@ -268,6 +273,11 @@ typedef struct _loop_data {
     int      interval_s;
 } loop_data;
 
+/*
+ * An element of the packet queue. The packet data is allocated along
+ * with the element, directly after it, and pd points to it, so each
+ * queued packet costs one allocation.
+ */
 typedef struct _pcap_queue_element {
     capture_src        *pcap_src;
     union {
@@ -317,6 +327,7 @@ static gboolean need_timeout_workaround;
 #endif
 
 #define WRITER_THREAD_TIMEOUT 100000 /* usecs */
+#define WRITER_DEQUEUE_BATCH 64 /* max packets taken off the queue per lock */
 
 static void
 dumpcap_log_writer(const char *domain, enum ws_log_level level,
@@ -330,6 +341,17 @@ static capture_options global_capture_opts;
 static GPtrArray *capture_comments = NULL;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+
+/*
+ * Limits on how often we tell our parent about new packets; see
+ * capture_loop_sync_packet_count().
+ */
+#define DEFAULT_SYNC_MAX_RATE   20      /* packet counts per second */
+#define DEFAULT_SYNC_LATENCY    500     /* milliseconds */
+#define SYNC_BUSY_PACKETS       1000    /* a packet count this big means we're busy */
+static guint sync_max_rate = DEFAULT_SYNC_MAX_RATE;
+static guint sync_latency = DEFAULT_SYNC_LATENCY;
+
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
@@ -430,11 +452,17 @@ print_usage(FILE *output)
     fprintf(output, "                                          an exact multiple of NUM secs\n");
     fprintf(output, "                          printname:FILE - print filename to FILE when written\n");
     fprintf(output, "                                           (can use 'stdout' or 'stderr')\n");
+    fprintf(output, "                              index:1 - write an index next to each file\n");
     fprintf(output, "  -n                       use pcapng format instead of pcap (default)\n");
     fprintf(output, "  -P                       use libpcap format instead of pcapng\n");
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --output file:FILE[,snaplen:NUM][,filesize:NUM][,duration:NUM][,packets:NUM]\n");
+    fprintf(output, "           [,files:NUM][,compress:gzip][,filter:FILTER]\n");
+    fprintf(output, "                           also write to FILE, in pcapng format, the packets\n");
+    fprintf(output, "                           that match FILTER, cut to NUM bytes, switching\n");
+    fprintf(output, "                           files as with -b; can be given more than once\n");
     fprintf(output, "  --temp-dir <directory>   write temporary files to this directory\n");
     fprintf(output, "                           (default: %s)\n", g_get_tmp_dir());
     fprintf(output, "\n");
@@ -448,6 +476,10 @@ print_usage(FILE *output)
     fprintf(output, "                           within dumpcap\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
     fprintf(output, "  -q                       don't report packet capture counts\n");
+    fprintf(output, "  --update-max-rate <rate> report packet capture counts at most this many\n");
+    fprintf(output, "                           times a second (def: %d)\n", DEFAULT_SYNC_MAX_RATE);
+    fprintf(output, "  --update-latency <ms>    when busy, report packet capture counts at least\n");
+    fprintf(output, "                           every this many milliseconds (def: %d)\n", DEFAULT_SYNC_LATENCY);
     fprintf(output, "  -v, --version            print version information and exit\n");
     fprintf(output, "  -h, --help               display this help and exit\n");
     fprintf(output, "\n");
@@ -1106,6 +1138,7 @@ exit_main(int status)
         global_capture_opts.save_file = NULL;
     }
 
+    fanout_cleanup();
     capture_opts_cleanup(&global_capture_opts);
     exit(status);
 }
@@ -3205,12 +3238,12 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         if (ld->pdh == NULL) {
             err = errno;
         } else {
-            size_t buffsize = IO_BUF_SIZE;
+            size_t buffsize = CAPTURE_IO_BUF_SIZE;
 #ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
             ws_statb64 statb;
 
             if (ws_fstat64(ld->save_file_fd, &statb) == 0) {
-                if (statb.st_blksize > IO_BUF_SIZE) {
+                if (statb.st_blksize > CAPTURE_IO_BUF_SIZE) {
                     buffsize = statb.st_blksize;
                 }
             }
@@ -3535,6 +3568,25 @@ isolate_uuid(const char *iface)
 }
 #endif
 
+/*
+ * TRUE if we see every packet we write as a packet, so we can index the
+ * ring buffer files; we don't when passing through pcapng blocks.
+ */
+static gboolean
+capture_loop_can_index(void)
+{
+    guint i;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+
+        if (pcap_src->from_pcapng) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
 /* open the output file (temporary/specified name/ringbuffer/named pipe/stdout) */
 /* Returns TRUE if the file opened successfully, FALSE otherwise. */
 static gboolean
@@ -3586,7 +3638,8 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
                                              capture_opts->group_read_access,
                                              capture_opts->compress_type,
-                                             capture_opts->has_nametimenum);
+                                             capture_opts->has_nametimenum,
+                                             capture_opts->ring_index && capture_loop_can_index());
 
                 /* capfile_name is unused as the ringbuffer provides its own filename. */
                 if (*save_file_fd != -1) {
@@ -3730,6 +3783,118 @@ static time_t get_next_time_interval(int interval_s) {
     return next_time;
 }
 
+/*
+ * Send our parent a message saying we've written out
+ * "global_ld.inpkts_to_sync_pipe" more packets to the capture file.
+ *
+ * Each message wakes the parent up to read the new packets, so unless
+ * "force" is set we coalesce them: we wait at least sync_interval after
+ * the previous message. The interval starts at 1/sync_max_rate; while
+ * every message reports a big batch it doubles, up to sync_latency, and
+ * when the batches get small again it shrinks back. So a quiet capture
+ * is shown almost at once, and a busy one costs the parent at most a
+ * few wakeups per second.
+ */
+static void
+capture_loop_sync_packet_count(gboolean force)
+{
+    gint64 now = g_get_monotonic_time();
+    gint64 min_interval = G_USEC_PER_SEC / sync_max_rate;
+    gint64 max_interval = MAX((gint64)sync_latency * 1000, min_interval);
+
+    if (global_ld.inpkts_to_sync_pipe == 0)
+        return;
+    if (!force && now - global_ld.last_sync_time < global_ld.sync_interval)
+        return;
+
+    if (!force) {
+        /* make sure the parent can read what we tell it about */
+        fflush(global_ld.pdh);
+    }
+    if (!quiet)
+        report_packet_count(global_ld.inpkts_to_sync_pipe);
+
+    if (global_ld.inpkts_to_sync_pipe >= SYNC_BUSY_PACKETS)
+        global_ld.sync_interval = MIN(global_ld.sync_interval * 2, max_interval);
+    else
+        global_ld.sync_interval = MAX(global_ld.sync_interval / 2, min_interval);
+    global_ld.last_sync_time = now;
+    global_ld.inpkts_to_sync_pipe = 0;
+}
+
+/* The interfaces and OS as the outputs added with --output see them */
+static fanout_interface_t *fanout_ifaces;
+static gchar *fanout_os;
+
+/* Start writing the outputs added with --output, if there are any.
+   Returns TRUE if it succeeds, FALSE otherwise. */
+static gboolean
+capture_loop_start_fanout(capture_options *capture_opts, loop_data *ld,
+                          char *errmsg, size_t errmsg_len)
+{
+    GString *os_info_str;
+    char *err_msg;
+    guint i;
+
+    if (!fanout_enabled())
+        return TRUE;
+
+    fanout_ifaces = g_new0(fanout_interface_t, ld->pcaps->len);
+    for (i = 0; i < ld->pcaps->len; i++) {
+        capture_src *pcap_src = g_array_index(ld->pcaps, capture_src *, i);
+        interface_options *interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
+
+        if (pcap_src->from_pcapng) {
+            snprintf(errmsg, errmsg_len,
+                     "--output can't be used when capturing pcapng data from %s.",
+                     interface_opts->display_name);
+            g_free(fanout_ifaces);
+            fanout_ifaces = NULL;
+            return FALSE;
+        }
+        fanout_ifaces[i].name = (interface_opts->ifname != NULL) ? interface_opts->ifname : interface_opts->name;
+        fanout_ifaces[i].descr = interface_opts->descr;
+        fanout_ifaces[i].linktype = pcap_src->linktype;
+        if (pcap_src->from_cap_pipe) {
+            fanout_ifaces[i].snaplen = pcap_src->cap_pipe_info.pcap.hdr.snaplen;
+        } else {
+            fanout_ifaces[i].snaplen = pcap_snapshot(pcap_src->pcap_h);
+        }
+        fanout_ifaces[i].ts_nsec = pcap_src->ts_nsec;
+    }
+
+    os_info_str = g_string_new("");
+    get_os_version_info(os_info_str);
+    fanout_os = g_string_free(os_info_str, FALSE);
+
+    if (!fanout_start(fanout_ifaces, ld->pcaps->len, fanout_os, get_appname_and_version(),
+                      capture_opts->group_read_access, &err_msg)) {
+        snprintf(errmsg, errmsg_len, "%s", err_msg);
+        g_free(err_msg);
+        g_free(fanout_ifaces);
+        fanout_ifaces = NULL;
+        g_free(fanout_os);
+        fanout_os = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Finish writing the outputs added with --output, if there are any. */
+static void
+capture_loop_stop_fanout(void)
+{
+    if (fanout_ifaces == NULL)
+        return;
+
+    if (!fanout_stop())
+        ws_warning("Not all packets could be written to the outputs given with --output.");
+    g_free(fanout_ifaces);
+    fanout_ifaces = NULL;
+    g_free(fanout_os);
+    fanout_os = NULL;
+}
+
 /* Do the work of handling either the file size or file duration capture
    conditions being reached, and switching files or stopping. */
 static gboolean
@@ -3776,11 +3941,7 @@ do_file_switch_or_stop(capture_options *capture_opts)
                 global_ld.next_interval_time = get_next_time_interval(global_ld.interval_s);
             }
             fflush(global_ld.pdh);
-            if (global_ld.inpkts_to_sync_pipe) {
-                if (!quiet)
-                    report_packet_count(global_ld.inpkts_to_sync_pipe);
-                global_ld.inpkts_to_sync_pipe = 0;
-            }
+            capture_loop_sync_packet_count(TRUE);
             report_new_capture_file(capture_opts->save_file);
         } else {
             /* File switch failed: stop here */
@@ -3814,23 +3975,41 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
-/* Try to pop an item off the packet queue and if it exists, write it */
+static void
+pcap_queue_subtract_element(pcap_queue_element *queue_element)
+{
+    if (queue_element->pcap_src->from_pcapng) {
+        pcap_queue_bytes -= queue_element->u.bh.block_total_length;
+    } else {
+        pcap_queue_bytes -= queue_element->u.phdr.caplen;
+    }
+    pcap_queue_packets -= 1;
+}
+
+/* Try to pop items off the packet queue and if there are any, write them.
+   Up to WRITER_DEQUEUE_BATCH items are taken while holding the queue lock
+   once, so that the capture threads contend for it less often. */
 static gboolean
 capture_loop_dequeue_packet(void) {
+    pcap_queue_element *batch[WRITER_DEQUEUE_BATCH];
     pcap_queue_element *queue_element;
+    guint               count = 0;
+    guint               i;
 
     g_async_queue_lock(pcap_queue);
     queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            pcap_queue_bytes -= queue_element->u.bh.block_total_length;
-        } else {
-            pcap_queue_bytes -= queue_element->u.phdr.caplen;
+    while (queue_element) {
+        pcap_queue_subtract_element(queue_element);
+        batch[count++] = queue_element;
+        if (count == WRITER_DEQUEUE_BATCH) {
+            break;
         }
-        pcap_queue_packets -= 1;
+        queue_element = (pcap_queue_element *)g_async_queue_try_pop_unlocked(pcap_queue);
     }
     g_async_queue_unlock(pcap_queue);
-    if (queue_element) {
+
+    for (i = 0; i < count; i++) {
+        queue_element = batch[i];
         if (queue_element->pcap_src->from_pcapng) {
             ws_info("Dequeued a block of type 0x%08x of length %d captured on interface %d.",
                   queue_element->u.bh.block_type, queue_element->u.bh.block_total_length,
@@ -3847,11 +4026,10 @@ capture_loop_dequeue_packet(void) {
                                         &queue_element->u.phdr,
                                         queue_element->pd);
         }
-        g_free(queue_element->pd);
+        /* pd was allocated along with the element */
         g_free(queue_element);
-        return TRUE;
     }
-    return FALSE;
+    return count > 0;
 }
 
 /*
@@ -3922,6 +4100,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.report_packet_count = FALSE;
 #endif
     global_ld.inpkts_to_sync_pipe = 0;
+    global_ld.last_sync_time      = 0;
+    global_ld.sync_interval       = G_USEC_PER_SEC / sync_max_rate;
     global_ld.err                 = 0;  /* no error seen yet */
     global_ld.pdh                 = NULL;
     global_ld.save_file_fd        = -1;
@@ -3972,6 +4152,11 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         }
     }
 
+    /* start the additional outputs, which write what we capture on their own */
+    if (!capture_loop_start_fanout(capture_opts, &global_ld, errmsg, sizeof(errmsg))) {
+        goto error;
+    }
+
     /* If we're supposed to write to a capture file, open it for output
        (temporary/specified name/ringbuffer) */
     if (capture_opts->saving_to_file) {
@@ -4039,6 +4224,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         pcap_queue = g_async_queue_new();
         pcap_queue_bytes = 0;
         pcap_queue_packets = 0;
+        pcap_queue_bytes_max = 0;
+        pcap_queue_packets_max = 0;
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
             /* XXX - Add an interface name here? */
@@ -4096,10 +4283,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             }
         } /* inpkts */
 
-        /* Only update once every 500ms so as not to overload slow displays.
-         * This also prevents too much context-switching between the dumpcap
-         * and wireshark processes.
-         */
+        /* Let the parent process know about new packets, if it's time to. */
+        capture_loop_sync_packet_count(FALSE);
+
+        /* Only check the stop and file switch conditions once every 500ms. */
 #define DUMPCAP_UPD_TIME 500
 
 #ifdef _WIN32
@@ -4119,18 +4306,6 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 *stats_known = TRUE;
             }
 #endif
-            /* Let the parent process know. */
-            if (global_ld.inpkts_to_sync_pipe) {
-                /* do sync here */
-                fflush(global_ld.pdh);
-
-                /* Send our parent a message saying we've written out
-                   "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
-                if (!quiet)
-                    report_packet_count(global_ld.inpkts_to_sync_pipe);
-
-                global_ld.inpkts_to_sync_pipe = 0;
-            }
 
             /* check capture duration condition */
             if (autostop_duration_timer != NULL && g_timer_elapsed(autostop_duration_timer, NULL) >= capture_opts->autostop_duration) {
@@ -4173,8 +4348,13 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 fflush(global_ld.pdh);
             }
         }
+        ws_info("Packet queue high-water mark was %" PRId64 " bytes (%" PRId64 " packets)",
+              pcap_queue_bytes_max, pcap_queue_packets_max);
     }
 
+    /* let the additional outputs write out what they've been given */
+    capture_loop_stop_fanout();
+
 
     /* delete stop conditions */
     if (global_ld.file_duration_timer != NULL)
@@ -4314,11 +4494,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     /* there might be packets not yet notified to the parent */
     /* (do this after closing the file, so all packets are already flushed) */
-    if (global_ld.inpkts_to_sync_pipe) {
-        if (!quiet)
-            report_packet_count(global_ld.inpkts_to_sync_pipe);
-        global_ld.inpkts_to_sync_pipe = 0;
-    }
+    capture_loop_sync_packet_count(TRUE);
 
     /* If we've displayed a message about a write error, there's no point
        in displaying another message about an error on close. */
@@ -4374,6 +4550,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     return write_ok && close_ok;
 
 error:
+    capture_loop_stop_fanout();
     if (capture_opts->multi_files_on) {
         /* cleanup ringbuffer */
         ringbuf_error_cleanup();
@@ -4602,6 +4779,9 @@ capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
         return;
     }
 
+    /* hand it to the additional outputs, if any */
+    fanout_packet(pcap_src->interface_id, phdr, pd);
+
     if (global_ld.pdh) {
         gboolean successful;
 
@@ -4633,6 +4813,13 @@ capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
             ws_info("Wrote a pcap packet of length %d captured on interface %u.",
                    phdr->caplen, pcap_src->interface_id);
 #endif
+            if (global_capture_opts.multi_files_on) {
+                nstime_t ts;
+
+                ts.secs = phdr->ts.tv_sec;
+                ts.nsecs = pcap_src->ts_nsec ? (int)phdr->ts.tv_usec : (int)phdr->ts.tv_usec * 1000;
+                ringbuf_index_packet(&ts, pcap_src->linktype, pd, phdr->caplen);
+            }
             capture_loop_wrote_one_packet(pcap_src);
         }
     }
@@ -4655,19 +4842,14 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
+    queue_element = (pcap_queue_element *)g_try_malloc(sizeof(pcap_queue_element) + phdr->caplen);
     if (queue_element == NULL) {
        pcap_src->dropped++;
        return;
     }
     queue_element->pcap_src = pcap_src;
     queue_element->u.phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
+    queue_element->pd = (u_char *)(queue_element + 1);
     memcpy(queue_element->pd, pd, phdr->caplen);
     g_async_queue_lock(pcap_queue);
     if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
@@ -4676,13 +4858,16 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
         g_async_queue_push_unlocked(pcap_queue, queue_element);
         pcap_queue_bytes += phdr->caplen;
         pcap_queue_packets += 1;
+        if (pcap_queue_bytes > pcap_queue_bytes_max)
+            pcap_queue_bytes_max = pcap_queue_bytes;
+        if (pcap_queue_packets > pcap_queue_packets_max)
+            pcap_queue_packets_max = pcap_queue_packets;
     } else {
         limit_reached = TRUE;
     }
     g_async_queue_unlock(pcap_queue);
     if (limit_reached) {
         pcap_src->dropped++;
-        g_free(queue_element->pd);
         g_free(queue_element);
         ws_info("Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
@@ -4712,19 +4897,14 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
+    queue_element = (pcap_queue_element *)g_try_malloc(sizeof(pcap_queue_element) + bh->block_total_length);
     if (queue_element == NULL) {
        pcap_src->dropped++;
        return;
     }
     queue_element->pcap_src = pcap_src;
     queue_element->u.bh = *bh;
-    queue_element->pd = (u_char *)g_malloc(bh->block_total_length);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
+    queue_element->pd = (u_char *)(queue_element + 1);
     memcpy(queue_element->pd, pd, bh->block_total_length);
     g_async_queue_lock(pcap_queue);
     if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
@@ -4733,13 +4913,16 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
         g_async_queue_push_unlocked(pcap_queue, queue_element);
         pcap_queue_bytes += bh->block_total_length;
         pcap_queue_packets += 1;
+        if (pcap_queue_bytes > pcap_queue_bytes_max)
+            pcap_queue_bytes_max = pcap_queue_bytes;
+        if (pcap_queue_packets > pcap_queue_packets_max)
+            pcap_queue_packets_max = pcap_queue_packets;
     } else {
         limit_reached = TRUE;
     }
     g_async_queue_unlock(pcap_queue);
     if (limit_reached) {
         pcap_src->dropped++;
-        g_free(queue_element->pd);
         g_free(queue_element);
         ws_info("Dropped a packet of length %d captured on interface %u.",
               bh->block_total_length, pcap_src->interface_id);
@@ -4832,6 +5015,9 @@ get_dumpcap_runtime_info(GString *str)
 #define LONGOPT_IFNAME             LONGOPT_BASE_APPLICATION+1
 #define LONGOPT_IFDESCR            LONGOPT_BASE_APPLICATION+2
 #define LONGOPT_CAPTURE_COMMENT    LONGOPT_BASE_APPLICATION+3
+#define LONGOPT_UPDATE_MAX_RATE    LONGOPT_BASE_APPLICATION+4
+#define LONGOPT_UPDATE_LATENCY     LONGOPT_BASE_APPLICATION+5
+#define LONGOPT_OUTPUT             LONGOPT_BASE_APPLICATION+6
 
 /* And now our feature presentation... [ fade to music ] */
 int
@@ -4846,6 +5032,9 @@ main(int argc, char *argv[])
         {"ifname", ws_required_argument, NULL, LONGOPT_IFNAME},
         {"ifdescr", ws_required_argument, NULL, LONGOPT_IFDESCR},
         {"capture-comment", ws_required_argument, NULL, LONGOPT_CAPTURE_COMMENT},
+        {"update-max-rate", ws_required_argument, NULL, LONGOPT_UPDATE_MAX_RATE},
+        {"update-latency", ws_required_argument, NULL, LONGOPT_UPDATE_LATENCY},
+        {"output", ws_required_argument, NULL, LONGOPT_OUTPUT},
         {0, 0, 0, 0 }
     };
 
@@ -5207,6 +5396,27 @@ main(int argc, char *argv[])
             }
             g_ptr_array_add(capture_comments, g_strdup(ws_optarg));
             break;
+        case LONGOPT_UPDATE_MAX_RATE:
+            sync_max_rate = get_positive_int(ws_optarg, "maximum update rate");
+            if (sync_max_rate > 1000) {
+                cmdarg_err("The maximum update rate must be at most 1000 per second");
+                exit_main(1);
+            }
+            break;
+        case LONGOPT_UPDATE_LATENCY:
+            sync_latency = get_positive_int(ws_optarg, "update latency");
+            break;
+        case LONGOPT_OUTPUT:
+        {
+            char *err_msg;
+
+            if (!fanout_add_output(ws_optarg, &err_msg)) {
+                cmdarg_err("%s", err_msg);
+                g_free(err_msg);
+                exit_main(1);
+            }
+            break;
+        }
         case 'Z':
             capture_child = TRUE;
 #ifdef _WIN32
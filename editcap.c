@@ -47,6 +47,7 @@
 #include <ui/cmdarg_err.h>
 #include <ui/exit_codes.h>
 #include <wsutil/filesystem.h>
+#include <wsutil/glib-compat.h>
 #include <wsutil/file_util.h>
 #include <wsutil/wsgcrypt.h>
 #include <wsutil/plugins.h>
@@ -89,6 +90,7 @@ typedef struct _fd_hash_t {
     guint8     digest[16];
     guint32    len;
     nstime_t   frame_time;
+    gboolean   in_window;   /* TRUE if this entry holds a packet (-d/-D) */
 } fd_hash_t;
 
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
@@ -98,6 +100,13 @@ static fd_hash_t fd_hash[MAX_DUP_DEPTH];
 static int       dup_window    = DEFAULT_DUP_DEPTH;
 static int       cur_dup_entry = 0;
 
+/*
+ * The length and digest of every packet in the -d/-D window, with the
+ * number of window entries that have them, so that looking for a
+ * duplicate doesn't mean comparing against the whole window.
+ */
+static GHashTable *fd_hash_counts = NULL;
+
 static guint32   ignored_bytes  = 0;  /* Used with -I */
 
 #define ONE_BILLION 1000000000
@@ -140,6 +149,7 @@ static guint                  max_selected              = 0;
 static gboolean               keep_em                   = FALSE;
 static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE_UNKNOWN;
 static int                    out_frame_type            = -2; /* Leave frame type alone */
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 static gboolean               verbose                   = FALSE; /* Not so verbose         */
 static struct time_adjustment time_adj                  = {NSTIME_INIT_ZERO, 0}; /* no adjustment */
 static nstime_t               relative_time_window      = NSTIME_INIT_ZERO; /* de-dup time window */
@@ -155,6 +165,7 @@ static gboolean               dup_detect_by_time        = FALSE;
 static gboolean               skip_radiotap             = FALSE;
 static gboolean               discard_all_secrets       = FALSE;
 static gboolean               discard_cap_comments      = FALSE;
+static gboolean               write_index               = FALSE;
 
 static int                    do_strict_time_adjustment = FALSE;
 static struct time_adjustment strict_time_adj           = {NSTIME_INIT_ZERO, 0}; /* strict time adjustment */
@@ -569,9 +580,57 @@ remove_vlan_info(const wtap_packet_header *phdr, guint8* fd, guint32* len) {
     }
 }
 
+static guint
+fd_hash_key_hash(gconstpointer key)
+{
+    const fd_hash_t *entry = (const fd_hash_t *)key;
+
+    /* The digest is already well mixed */
+    return pntoh32(entry->digest) ^ entry->len;
+}
+
+static gboolean
+fd_hash_key_equal(gconstpointer a, gconstpointer b)
+{
+    const fd_hash_t *entry_a = (const fd_hash_t *)a;
+    const fd_hash_t *entry_b = (const fd_hash_t *)b;
+
+    return entry_a->len == entry_b->len &&
+           memcmp(entry_a->digest, entry_b->digest, 16) == 0;
+}
+
+static void
+fd_hash_count_remove(const fd_hash_t *entry)
+{
+    gpointer key, value;
+    guint count;
+
+    if (!g_hash_table_lookup_extended(fd_hash_counts, entry, &key, &value))
+        return;
+    count = GPOINTER_TO_UINT(value) - 1;
+    if (count == 0)
+        g_hash_table_remove(fd_hash_counts, entry);
+    else
+        g_hash_table_insert(fd_hash_counts, key, GUINT_TO_POINTER(count));
+}
+
+static void
+fd_hash_count_add(const fd_hash_t *entry)
+{
+    gpointer key, value;
+
+    if (g_hash_table_lookup_extended(fd_hash_counts, entry, &key, &value)) {
+        g_hash_table_insert(fd_hash_counts, key,
+                            GUINT_TO_POINTER(GPOINTER_TO_UINT(value) + 1));
+    } else {
+        g_hash_table_insert(fd_hash_counts, g_memdup2(entry, sizeof *entry),
+                            GUINT_TO_POINTER(1));
+    }
+}
+
 static gboolean
 is_duplicate(guint8* fd, guint32 len) {
-    int i;
+    gboolean duplicate;
     const struct ieee80211_radiotap_header* tap_header;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
@@ -598,23 +657,22 @@ is_duplicate(guint8* fd, guint32 len) {
     if (cur_dup_entry >= dup_window)
         cur_dup_entry = 0;
 
+    /* The oldest packet drops out of the window */
+    if (fd_hash[cur_dup_entry].in_window)
+        fd_hash_count_remove(&fd_hash[cur_dup_entry]);
+
     /* Calculate our digest */
     gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
 
     fd_hash[cur_dup_entry].len = len;
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
+    /* Look for duplicates among the rest of the window */
+    duplicate = g_hash_table_contains(fd_hash_counts, &fd_hash[cur_dup_entry]);
 
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
-    }
+    fd_hash_count_add(&fd_hash[cur_dup_entry]);
+    fd_hash[cur_dup_entry].in_window = TRUE;
 
-    return FALSE;
+    return duplicate;
 }
 
 static gboolean
@@ -821,6 +879,10 @@ print_usage(FILE *output)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  --compress <type>      compress the output file(s); <type> is \"none\"\n");
+    fprintf(output, "                         (the default) or \"gzip\".\n");
+    fprintf(output, "  --write-index          write an index of the packets at the end of the\n");
+    fprintf(output, "                         output file(s), if they're uncompressed pcapng.\n");
     fprintf(output, "  --inject-secrets <type>,<file>  Insert decryption secrets from <file>. List\n");
     fprintf(output, "                         supported secret types with \"--inject-secrets help\".\n");
     fprintf(output, "  --discard-all-secrets  Discard all decryption secrets from the input file\n");
@@ -976,10 +1038,10 @@ editcap_dump_open(const char *filename, const wtap_dump_params *params,
 
     if (strcmp(filename, "-") == 0) {
         /* Write to the standard output. */
-        pdh = wtap_dump_open_stdout(out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open_stdout(out_file_type_subtype, out_compression_type,
                                     params, err, err_info);
     } else {
-        pdh = wtap_dump_open(filename, out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open(filename, out_file_type_subtype, out_compression_type,
                              params, err, err_info);
     }
     if (pdh == NULL)
@@ -1099,6 +1161,22 @@ process_new_idbs(wtap *wth, wtap_dumper *pdh, GArray *idbs_seen,
     return TRUE;
 }
 
+/*
+ * Copy the run of consecutive records we've been saving up to copy
+ * unchanged from the input file, if there is one.
+ */
+static gboolean
+flush_raw_run(wtap_dumper *pdh, wtap *wth, gint64 *run_offset,
+              gint64 *run_len, int *err, gchar **err_info)
+{
+    if (*run_len == 0)
+        return TRUE;
+    if (!wtap_dump_copy_raw(pdh, wth, *run_offset, *run_len, err, err_info))
+        return FALSE;
+    *run_len = 0;
+    return TRUE;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -1127,6 +1205,8 @@ main(int argc, char *argv[])
 #define LONGOPT_DISCARD_ALL_SECRETS  LONGOPT_BASE_APPLICATION+5
 #define LONGOPT_CAPTURE_COMMENT      LONGOPT_BASE_APPLICATION+6
 #define LONGOPT_DISCARD_CAPTURE_COMMENT LONGOPT_BASE_APPLICATION+7
+#define LONGOPT_COMPRESS             LONGOPT_BASE_APPLICATION+8
+#define LONGOPT_WRITE_INDEX          LONGOPT_BASE_APPLICATION+9
 
     static const struct ws_option long_options[] = {
         {"novlan", ws_no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1138,6 +1218,8 @@ main(int argc, char *argv[])
         {"version", ws_no_argument, NULL, 'V'},
         {"capture-comment", ws_required_argument, NULL, LONGOPT_CAPTURE_COMMENT},
         {"discard-capture-comment", ws_no_argument, NULL, LONGOPT_DISCARD_CAPTURE_COMMENT},
+        {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
+        {"write-index", ws_no_argument, NULL, LONGOPT_WRITE_INDEX},
         {0, 0, 0, 0 }
     };
 
@@ -1157,6 +1239,10 @@ main(int argc, char *argv[])
     int           written_count      = 0;
     char         *filename           = NULL;
     gboolean      ts_okay;
+    gboolean      raw_copy           = FALSE;
+    guint32       raw_len;
+    gint64        raw_run_offset     = 0;
+    gint64        raw_run_len        = 0;
     nstime_t      secs_per_block     = NSTIME_INIT_UNSET;
     int           block_cnt          = 0;
     nstime_t      block_next         = NSTIME_INIT_UNSET;
@@ -1299,6 +1385,36 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_COMPRESS:
+        {
+            if (strcmp(ws_optarg, "none") == 0) {
+                out_compression_type = WTAP_UNCOMPRESSED;
+            } else if (strcmp(ws_optarg, "gzip") == 0) {
+#ifdef HAVE_ZLIB
+                out_compression_type = WTAP_GZIP_COMPRESSED;
+#else
+                cmdarg_err("'gzip' compression is not supported");
+                ret = INVALID_OPTION;
+                goto clean_exit;
+#endif
+            } else {
+#ifdef HAVE_ZLIB
+                cmdarg_err("parameter of --compress can be 'none' or 'gzip'");
+#else
+                cmdarg_err("parameter of --compress can only be 'none'");
+#endif
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
+        case LONGOPT_WRITE_INDEX:
+        {
+            write_index = TRUE;
+            break;
+        }
+
         case 'a':
         {
             guint frame_number;
@@ -1561,6 +1677,14 @@ main(int argc, char *argv[])
       out_file_type_subtype = wtap_pcapng_file_type_subtype();
     }
 
+    if (out_compression_type != WTAP_UNCOMPRESSED &&
+        !wtap_dump_can_compress(out_file_type_subtype)) {
+        cmdarg_err("The file type %s can't be written compressed.",
+                   wtap_file_type_subtype_name(out_file_type_subtype));
+        ret = INVALID_OPTION;
+        goto clean_exit;
+    }
+
     if (err_prob >= 0.0) {
         if (!valid_seed) {
             seed = (unsigned int) (time(NULL) + ws_getpid());
@@ -1712,6 +1836,8 @@ main(int argc, char *argv[])
     if (snaplen != 0 && snaplen < wtap_snapshot_length(wth))
         params.snaplen = snaplen;
 
+    params.write_index = write_index;
+
     /*
      * Now process the arguments following the input and output file
      * names, if any; they specify packets to include/exclude.
@@ -1728,12 +1854,39 @@ main(int argc, char *argv[])
             memset(&fd_hash[i].digest, 0, 16);
             fd_hash[i].len = 0;
             nstime_set_unset(&fd_hash[i].frame_time);
+            fd_hash[i].in_window = FALSE;
         }
+        if (dup_detect)
+            fd_hash_counts = g_hash_table_new_full(fd_hash_key_hash,
+                                                   fd_hash_key_equal,
+                                                   g_free, NULL);
     }
 
     /* Set up an array of all IDBs seen */
     idbs_seen = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
 
+    /*
+     * If we only want the packets from a start time on, and the input
+     * file has an index, skip the packets before that time. Splitting by
+     * time and duplicate detection look at every packet, so not then.
+     */
+    if (have_starttime && nstime_is_unset(&secs_per_block) &&
+        !dup_detect && !dup_detect_by_time) {
+        guint64 first_frame;
+
+        if (wtap_seek_to_time(wth, &starttime, &first_frame, &read_err, &read_err_info)) {
+            if (verbose)
+                fprintf(stderr, "Skipping to packet %" PRIu64 " using the index of %s\n",
+                        first_frame, argv[ws_optind]);
+            read_count = (guint32)(first_frame - 1);
+            count = (unsigned int)first_frame;
+        } else if (read_err != 0) {
+            cfile_read_failure_message(argv[ws_optind], read_err, read_err_info);
+            ret = INVALID_FILE;
+            goto clean_exit;
+        }
+    }
+
     /* Read all of the packets in turn */
     wtap_rec_init(&read_rec);
     ws_buffer_init(&read_buf, 1514);
@@ -1752,7 +1905,7 @@ main(int argc, char *argv[])
         rec = &read_rec;
 
         /* Extra actions for the first packet */
-        if (read_count == 1) {
+        if (pdh == NULL) {
             if (split_packet_count != 0 || !nstime_is_unset(&secs_per_block)) {
                 if (!fileset_extract_prefix_suffix(argv[ws_optind+1], &fprefix, &fsuffix)) {
                     ret = CANT_EXTRACT_PREFIX;
@@ -1780,6 +1933,24 @@ main(int argc, char *argv[])
                 ret = INVALID_FILE;
                 goto clean_exit;
             }
+
+            /*
+             * If we're only selecting or splitting, rather than changing
+             * records, and the output file is of the same type as the
+             * input file, copy runs of consecutive records as they are
+             * rather than parsing and rewriting each of them.
+             */
+            raw_copy = snaplen == 0 &&
+                       chop.len_begin == 0 && chop.len_end == 0 &&
+                       !rem_vlan &&
+                       time_adj.tv.secs == 0 && time_adj.tv.nsecs == 0 &&
+                       !do_strict_time_adjustment &&
+                       out_frame_type == -2 &&
+                       err_prob <= 0.0 &&
+                       frames_user_comments == NULL &&
+                       wtap_dump_can_copy_raw(pdh, wth);
+            if (verbose && raw_copy)
+                fprintf(stderr, "Copying records unchanged where possible\n");
         } /* first packet only handling */
 
         /*
@@ -1808,6 +1979,15 @@ main(int argc, char *argv[])
                 }
                 while (nstime_cmp(&rec->ts, &block_next) > 0) { /* time for the next file */
 
+                    if (!flush_raw_run(pdh, wth, &raw_run_offset, &raw_run_len,
+                                       &write_err, &write_err_info)) {
+                        cfile_write_failure_message(argv[ws_optind], filename,
+                                                    write_err, write_err_info,
+                                                    read_count,
+                                                    out_file_type_subtype);
+                        ret = DUMP_ERROR;
+                        goto clean_exit;
+                    }
                     if (!wtap_dump_close(pdh, &write_err, &write_err_info)) {
                         cfile_close_failure_message(filename, write_err,
                                                     write_err_info);
@@ -1840,6 +2020,15 @@ main(int argc, char *argv[])
         if (split_packet_count != 0) {
             /* time for the next file? */
             if (written_count > 0 && (written_count % split_packet_count) == 0) {
+                if (!flush_raw_run(pdh, wth, &raw_run_offset, &raw_run_len,
+                                   &write_err, &write_err_info)) {
+                    cfile_write_failure_message(argv[ws_optind], filename,
+                                                write_err, write_err_info,
+                                                read_count,
+                                                out_file_type_subtype);
+                    ret = DUMP_ERROR;
+                    goto clean_exit;
+                }
                 if (!wtap_dump_close(pdh, &write_err, &write_err_info)) {
                     cfile_close_failure_message(filename, write_err,
                                                 write_err_info);
@@ -2229,14 +2418,38 @@ main(int argc, char *argv[])
                 wtap_dump_discard_decryption_secrets(pdh);
             }
 
-            /* Attempt to dump out current frame to the output file */
-            if (!wtap_dump(pdh, rec, buf, &write_err, &write_err_info)) {
-                cfile_write_failure_message(argv[ws_optind], filename,
-                                            write_err, write_err_info,
-                                            read_count,
-                                            out_file_type_subtype);
-                ret = DUMP_ERROR;
-                goto clean_exit;
+            raw_len = raw_copy ? wtap_raw_record_length(wth, data_offset) : 0;
+            if (raw_len != 0) {
+                /*
+                 * Add this record to the run we'll copy, starting a new
+                 * run if it doesn't follow on from the current one.
+                 */
+                if (raw_run_len != 0 && raw_run_offset + raw_run_len != data_offset) {
+                    if (!flush_raw_run(pdh, wth, &raw_run_offset, &raw_run_len,
+                                       &write_err, &write_err_info)) {
+                        cfile_write_failure_message(argv[ws_optind], filename,
+                                                    write_err, write_err_info,
+                                                    read_count,
+                                                    out_file_type_subtype);
+                        ret = DUMP_ERROR;
+                        goto clean_exit;
+                    }
+                }
+                if (raw_run_len == 0)
+                    raw_run_offset = data_offset;
+                raw_run_len += raw_len;
+            } else {
+                /* Attempt to dump out current frame to the output file */
+                if (!flush_raw_run(pdh, wth, &raw_run_offset, &raw_run_len,
+                                   &write_err, &write_err_info) ||
+                    !wtap_dump(pdh, rec, buf, &write_err, &write_err_info)) {
+                    cfile_write_failure_message(argv[ws_optind], filename,
+                                                write_err, write_err_info,
+                                                read_count,
+                                                out_file_type_subtype);
+                    ret = DUMP_ERROR;
+                    goto clean_exit;
+                }
             }
             written_count++;
         }
@@ -2255,6 +2468,17 @@ main(int argc, char *argv[])
         cfile_read_failure_message(argv[ws_optind], read_err, read_err_info);
     }
 
+    if (pdh != NULL &&
+        !flush_raw_run(pdh, wth, &raw_run_offset, &raw_run_len,
+                       &write_err, &write_err_info)) {
+        cfile_write_failure_message(argv[ws_optind], filename,
+                                    write_err, write_err_info,
+                                    read_count,
+                                    out_file_type_subtype);
+        ret = DUMP_ERROR;
+        goto clean_exit;
+    }
+
     if (!pdh) {
         /* No valid packages found, open the outfile so we can write an
          * empty header */
@@ -2296,6 +2520,8 @@ main(int argc, char *argv[])
     }
 
 clean_exit:
+    if (fd_hash_counts != NULL)
+        g_hash_table_destroy(fd_hash_counts);
     if (dsb_filenames) {
         g_array_free(dsb_types, TRUE);
         g_ptr_array_free(dsb_filenames, TRUE);
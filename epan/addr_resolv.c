@@ -221,9 +221,11 @@ struct cb_serv_data {
 static wmem_map_t *manuf_hashtable = NULL;
 static wmem_map_t *wka_hashtable = NULL;
 static wmem_map_t *eth_hashtable = NULL;
+static gboolean manuf_loaded = FALSE;
 // Maps guint -> serv_port_t*
 static wmem_map_t *serv_port_hashtable = NULL;
 static GHashTable *enterprises_hashtable = NULL;
+static GThread *enterprises_thread = NULL;
 
 static subnet_length_entry_t subnet_length_entries[SUBNETLENGTHSIZE]; /* Ordered array of entries */
 static gboolean have_subnet_entry = FALSE;
@@ -233,6 +235,19 @@ static gboolean new_resolved_objects = FALSE;
 static GPtrArray* extra_hosts_files = NULL;
 
 static hashether_t *add_eth_name(const guint8 *addr, const gchar *name);
+static void load_manuf_files(void);
+
+/*
+ * The manuf and wka files are only read when the first Ethernet or
+ * manufacturer name is needed, so that runs that never need one don't
+ * pay for parsing them.
+ */
+static inline void
+ensure_manuf_loaded(void)
+{
+    if (G_UNLIKELY(!manuf_loaded))
+        load_manuf_files();
+}
 static void add_serv_port_cb(const guint32 port, gpointer ptr);
 
 /* http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing
@@ -521,7 +536,7 @@ sync_lookup_ip6(const ws_in6_addr *addr)
     sdd->family = AF_INET6;
     memcpy(&sdd->addr.ip6, addr, sizeof(sdd->addr.ip6));
     sdd->completed = &completed;
-    ares_gethostbyaddr(ghba_chan, &addr, sizeof(ws_in6_addr), AF_INET6,
+    ares_gethostbyaddr(ghba_chan, addr, sizeof(ws_in6_addr), AF_INET6,
                        c_ares_ghba_sync_cb, sdd);
 
     /*
@@ -866,18 +881,26 @@ parse_enterprises_line (char *line)
         *tok = '\0';
         had_comment = TRUE;
     }
-    /* Get enterprise number */
-    dec_str = strtok(line, " \t");
-    if (!dec_str)
+    /*
+     * Get enterprise number. This runs on the enterprises loading
+     * thread, so split the line by hand instead of with strtok(),
+     * which isn't reentrant.
+     */
+    dec_str = line + strspn(line, " \t");
+    if (*dec_str == '\0')
+        return;
+    tok = dec_str + strcspn(dec_str, " \t");
+    if (*tok == '\0')
         return;
+    *tok = '\0';
     /* Get enterprise name */
-    org_str = strtok(NULL, ""); /* everything else */
-    if (org_str && had_comment) {
+    org_str = tok + 1; /* everything else */
+    if (*org_str == '\0')
+        return;
+    if (had_comment) {
         /* Only need to strip after (between name and where comment was) */
         org_str = g_strchomp(org_str);
     }
-    if (!org_str)
-        return;
 
     /* Add entry using number as key */
     if (!ws_strtou32(dec_str, NULL, &dec))
@@ -904,6 +927,14 @@ parse_enterprises_file(const char * path)
     return TRUE;
 }
 
+static gpointer
+load_enterprises_worker(gpointer data _U_)
+{
+    parse_enterprises_file(g_enterprises_path);
+    parse_enterprises_file(g_penterprises_path);
+    return NULL;
+}
+
 static void
 initialize_enterprises(void)
 {
@@ -913,7 +944,6 @@ initialize_enterprises(void)
     if (g_enterprises_path == NULL) {
         g_enterprises_path = get_datafile_path(ENAME_ENTERPRISES);
     }
-    parse_enterprises_file(g_enterprises_path);
 
     if (g_penterprises_path == NULL) {
         /* Check profile directory before personal configuration */
@@ -923,12 +953,35 @@ initialize_enterprises(void)
             g_penterprises_path = get_persconffile_path(ENAME_ENTERPRISES, FALSE);
         }
     }
-    parse_enterprises_file(g_penterprises_path);
+
+    /*
+     * The enterprises file is large and nothing looks it up while the
+     * protocols are being registered, so parse it on its own thread in
+     * the meantime. epan_init() waits for it with addr_resolv_init_finish()
+     * before returning, so that the thread never survives into a fork()ed
+     * process; lookups before that wait for it too. The worker only
+     * touches enterprises_hashtable and the two paths above.
+     */
+    enterprises_thread = g_thread_try_new("load_enterprises", load_enterprises_worker, NULL, NULL);
+    if (enterprises_thread == NULL) {
+        load_enterprises_worker(NULL);
+    }
+}
+
+/* Wait for the enterprises file to be loaded, if it's still going on */
+static inline void
+wait_for_enterprises(void)
+{
+    if (G_UNLIKELY(enterprises_thread != NULL)) {
+        g_thread_join(enterprises_thread);
+        enterprises_thread = NULL;
+    }
 }
 
 const gchar *
 try_enterprises_lookup(guint32 value)
 {
+    wait_for_enterprises();
     return (const gchar *)g_hash_table_lookup(enterprises_hashtable, GUINT_TO_POINTER(value));
 }
 
@@ -958,6 +1011,7 @@ enterprises_base_custom(char *buf, guint32 value)
 static void
 enterprises_cleanup(void)
 {
+    wait_for_enterprises();
     ws_assert(enterprises_hashtable);
     g_hash_table_destroy(enterprises_hashtable);
     enterprises_hashtable = NULL;
@@ -1613,6 +1667,8 @@ manuf_name_lookup(const guint8 *addr)
     guint8       oct;
     hashmanuf_t  *manuf_value;
 
+    ensure_manuf_loaded();
+
     /* manuf needs only the 3 most significant octets of the ethernet address */
     manuf_key = addr[0];
     manuf_key = manuf_key<<8;
@@ -1658,6 +1714,7 @@ wka_name_lookup(const guint8 *addr, const unsigned int mask)
     if (wka_hashtable == NULL) {
         return NULL;
     }
+    ensure_manuf_loaded();
     /* Get the part of the address covered by the mask. */
     for (i = 0, num = mask; num >= 8; i++, num -= 8)
         masked_addr[i] = addr[i];   /* copy octets entirely covered by the mask */
@@ -1705,9 +1762,6 @@ eth_addr_cmp(gconstpointer a, gconstpointer b)
 static void
 initialize_ethers(void)
 {
-    ether_t *eth;
-    guint    mask = 0;
-
     /* hash table initialization */
     wka_hashtable   = wmem_map_new(wmem_epan_scope(), eth_addr_hash, eth_addr_cmp);
     manuf_hashtable = wmem_map_new(wmem_epan_scope(), g_direct_hash, g_direct_equal);
@@ -1734,25 +1788,39 @@ initialize_ethers(void)
     if (g_manuf_path == NULL)
         g_manuf_path = get_datafile_path(ENAME_MANUF);
 
-    /* Read it and initialize the hash table */
+    /* Compute the pathname of the wka file */
+    if (g_wka_path == NULL)
+        g_wka_path = get_datafile_path(ENAME_WKA);
+
+    /* The files themselves are read by ensure_manuf_loaded() */
+    manuf_loaded = FALSE;
+
+} /* initialize_ethers */
+
+static void
+load_manuf_files(void)
+{
+    ether_t *eth;
+    guint    mask = 0;
+
+    /* Set first, as add_manuf_name() ends up in add_eth_name() */
+    manuf_loaded = TRUE;
+
+    /* Read the manuf file and initialize the hash tables */
     set_ethent(g_manuf_path);
     while ((eth = get_ethent(&mask, TRUE))) {
         add_manuf_name(eth->addr, mask, eth->name, eth->longname);
     }
     end_ethent();
 
-    /* Compute the pathname of the wka file */
-    if (g_wka_path == NULL)
-        g_wka_path = get_datafile_path(ENAME_WKA);
-
-    /* Read it and initialize the hash table */
+    /* Read the wka file and initialize the hash tables */
     set_ethent(g_wka_path);
     while ((eth = get_ethent(&mask, TRUE))) {
         add_manuf_name(eth->addr, mask, eth->name, eth->longname);
     }
     end_ethent();
 
-} /* initialize_ethers */
+} /* load_manuf_files */
 
 static void
 ethers_cleanup(void)
@@ -1765,6 +1833,7 @@ ethers_cleanup(void)
     g_manuf_path = NULL;
     g_free(g_wka_path);
     g_wka_path = NULL;
+    manuf_loaded = FALSE;
 }
 
 /* Resolve ethernet address */
@@ -1901,6 +1970,8 @@ add_eth_name(const guint8 *addr, const gchar *name)
 {
     hashether_t *tp;
 
+    ensure_manuf_loaded();
+
     tp = (hashether_t *)wmem_map_lookup(eth_hashtable, addr);
 
     if (tp == NULL) {
@@ -1921,6 +1992,8 @@ eth_name_lookup(const guint8 *addr, const gboolean resolve)
 {
     hashether_t  *tp;
 
+    ensure_manuf_loaded();
+
     tp = (hashether_t *)wmem_map_lookup(eth_hashtable, addr);
 
     if (tp == NULL) {
@@ -2914,22 +2987,12 @@ disable_name_resolution(void) {
     gbl_resolv_flags.ss7pc_name                         = FALSE;
 }
 
-gboolean
-host_name_lookup_process(void) {
+/* Submit queued asynchronous requests, up to the concurrency limit */
+static void
+submit_async_dns_queue(void) {
     async_dns_queue_msg_t *caqm;
-    struct timeval tv = { 0, 0 };
-    int nfds;
-    fd_set rfds, wfds;
-    gboolean nro = new_resolved_objects;
     wmem_list_frame_t* head;
 
-    new_resolved_objects = FALSE;
-    nro |= maxmind_db_lookup_process();
-
-    if (!async_dns_initialized)
-        /* c-ares not initialized. Bail out and cancel timers. */
-        return nro;
-
     head = wmem_list_head(async_dns_queue_head);
 
     while (head != NULL && async_dns_in_flight <= name_resolve_concurrency) {
@@ -2947,6 +3010,23 @@ host_name_lookup_process(void) {
 
         head = wmem_list_head(async_dns_queue_head);
     }
+}
+
+gboolean
+host_name_lookup_process(void) {
+    struct timeval tv = { 0, 0 };
+    int nfds;
+    fd_set rfds, wfds;
+    gboolean nro = new_resolved_objects;
+
+    new_resolved_objects = FALSE;
+    nro |= maxmind_db_lookup_process();
+
+    if (!async_dns_initialized)
+        /* c-ares not initialized. Bail out and cancel timers. */
+        return nro;
+
+    submit_async_dns_queue();
 
     FD_ZERO(&rfds);
     FD_ZERO(&wfds);
@@ -2965,6 +3045,51 @@ host_name_lookup_process(void) {
     return nro;
 }
 
+void
+host_name_lookup_flush(guint timeout_ms) {
+    struct timeval maxtv, tv, *tvp;
+    int nfds;
+    fd_set rfds, wfds;
+    gint64 deadline, remaining;
+
+    if (!async_dns_initialized)
+        return;
+
+    deadline = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+
+    for (;;) {
+        /*
+         * Keep the pipeline full: every answer makes room for
+         * another queued request.
+         */
+        submit_async_dns_queue();
+        if (async_dns_in_flight == 0)
+            break;
+
+        remaining = deadline - g_get_monotonic_time();
+        if (remaining <= 0)
+            break;
+
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        nfds = ares_fds(ghba_chan, &rfds, &wfds);
+        if (nfds <= 0)
+            break;
+
+        /* Wake up for c-ares' own retransmission timeouts, too */
+        maxtv.tv_sec = (long)(remaining / G_USEC_PER_SEC);
+        maxtv.tv_usec = (long)(remaining % G_USEC_PER_SEC);
+        tvp = ares_timeout(ghba_chan, &maxtv, &tv);
+        if (select(nfds, &rfds, &wfds, NULL, tvp) == -1) { /* call to select() failed */
+            /* If it's interrupted by a signal, no need to put out a message */
+            if (errno != EINTR)
+                fprintf(stderr, "Warning: call to select() failed, error is %s\n", g_strerror(errno));
+            break;
+        }
+        ares_process(ghba_chan, &rfds, &wfds);
+    }
+}
+
 static void
 _host_name_lookup_cleanup(void) {
     async_dns_queue_head = NULL;
@@ -3413,6 +3538,7 @@ get_manuf_name_if_known(const guint8 *addr)
     oct = addr[2];
     manuf_key = manuf_key | oct;
 
+    ensure_manuf_loaded();
     manuf_value = (hashmanuf_t *)wmem_map_lookup(manuf_hashtable, GUINT_TO_POINTER(manuf_key));
     if ((manuf_value == NULL) || (manuf_value->status == HASHETHER_STATUS_UNRESOLVED)) {
         return NULL;
@@ -3427,6 +3553,7 @@ uint_get_manuf_name_if_known(const guint manuf_key)
 {
     hashmanuf_t *manuf_value;
 
+    ensure_manuf_loaded();
     manuf_value = (hashmanuf_t *)wmem_map_lookup(manuf_hashtable, GUINT_TO_POINTER(manuf_key));
     if ((manuf_value == NULL) || (manuf_value->status == HASHETHER_STATUS_UNRESOLVED)) {
         return NULL;
@@ -3605,18 +3732,21 @@ get_host_ipaddr6(const char *host, ws_in6_addr *addrp)
 wmem_map_t *
 get_manuf_hashtable(void)
 {
+    ensure_manuf_loaded();
     return manuf_hashtable;
 }
 
 wmem_map_t *
 get_wka_hashtable(void)
 {
+    ensure_manuf_loaded();
     return wka_hashtable;
 }
 
 wmem_map_t *
 get_eth_hashtable(void)
 {
+    ensure_manuf_loaded();
     return eth_hashtable;
 }
 
@@ -3661,6 +3791,12 @@ addr_resolv_init(void)
     host_name_lookup_init();
 }
 
+void
+addr_resolv_init_finish(void)
+{
+    wait_for_enterprises();
+}
+
 /* Clean up all the address resolution subsystems in this file */
 void
 addr_resolv_cleanup(void)
@@ -194,6 +194,16 @@ WS_DLL_PUBLIC void disable_name_resolution(void);
  */
 WS_DLL_PUBLIC gboolean host_name_lookup_process(void);
 
+/** If we're using c-ares, submit all queued asynchronous host name lookups,
+ *  as many at a time as the concurrency preference allows, and wait for
+ *  their answers. This lets a program that dissects a file twice, such as
+ *  TShark with -2, resolve every address seen in the first pass in a batch
+ *  instead of stopping for each one in the second.
+ *
+ * @param timeout_ms The maximum time to wait, in milliseconds.
+ */
+WS_DLL_PUBLIC void host_name_lookup_flush(guint timeout_ms);
+
 /* get_hostname returns the host name or "%d.%d.%d.%d" if not found */
 WS_DLL_PUBLIC const gchar *get_hostname(const guint addr);
 
@@ -379,6 +389,10 @@ void host_name_lookup_reset(void);
 WS_DLL_LOCAL
 void addr_resolv_init(void);
 
+/* Wait for the parts of addr_resolv_init() done in the background */
+WS_DLL_LOCAL
+void addr_resolv_init_finish(void);
+
 WS_DLL_LOCAL
 void addr_resolv_cleanup(void);
 
@@ -11,6 +11,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <string.h>
 #include <glib.h>
 
 #include <epan/proto.h>
@@ -19,6 +20,13 @@
 #include <wsutil/pint.h>
 #include <wsutil/unicode-utils.h>
 
+/* SSE2 is part of the x86-64 baseline, so this needs no runtime check */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHARSETS_SSE2
+#include <emmintrin.h>
+#include <wsutil/bits_ctz.h>
+#endif
+
 #include "charsets.h"
 
 /* REPLACEMENT CHARACTER */
@@ -55,6 +63,101 @@
  * the code pages don't all work (do *any* work?).
  */
 
+/*
+ * Returns the number of bytes at the start of ptr that are ASCII, checking
+ * 16 bytes at a time with SSE2 or 8 bytes at a time otherwise.
+ */
+gint
+valid_ascii_prefix_length(const guint8 *ptr, gint length)
+{
+    gint i = 0;
+
+#ifdef CHARSETS_SSE2
+    while (length - i >= 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)(ptr + i)));
+
+        if (mask)
+            return i + ws_ctz(mask);
+        i += 16;
+    }
+#else
+    while (length - i >= 8) {
+        guint64 word;
+
+        memcpy(&word, ptr + i, sizeof word);
+        if (word & G_GUINT64_CONSTANT(0x8080808080808080))
+            break;
+        i += 8;
+    }
+#endif
+
+    while (i < length && ptr[i] < 0x80)
+        i++;
+
+    return i;
+}
+
+/*
+ * Returns the number of bytes at the start of ptr that are well-formed
+ * UTF-8, as defined by Table 3-7 "Well-Formed UTF-8 Byte Sequences" in
+ * the Unicode Standard. The result never ends in the middle of a sequence.
+ */
+gint
+valid_utf_8_prefix_length(const guint8 *ptr, gint length)
+{
+    gint i = 0;
+
+    while (i < length) {
+        guint8 ch = ptr[i];
+        guint8 lo = 0x80, hi = 0xbf;
+        gint trailing, k;
+
+        if (ch < 0x80) {
+            i += valid_ascii_prefix_length(ptr + i, length - i);
+            continue;
+        }
+        if (ch < 0xc2 || ch > 0xf4)
+            break;
+        if (ch < 0xe0) {
+            trailing = 1;
+        } else if (ch < 0xf0) {
+            trailing = 2;
+            if (ch == 0xe0)
+                lo = 0xa0;
+            else if (ch == 0xed)
+                hi = 0x9f;
+        } else {
+            trailing = 3;
+            if (ch == 0xf0)
+                lo = 0x90;
+            else if (ch == 0xf4)
+                hi = 0x8f;
+        }
+        if (length - i <= trailing)
+            break;
+        if (ptr[i + 1] < lo || ptr[i + 1] > hi)
+            break;
+        for (k = 2; k <= trailing; k++) {
+            if (ptr[i + k] < 0x80 || ptr[i + k] > 0xbf)
+                return i;
+        }
+        i += trailing + 1;
+    }
+
+    return i;
+}
+
+/* Copies valid ASCII or UTF-8 into a NUL-terminated string */
+static guint8 *
+copy_valid_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
+{
+    guint8 *buf = (guint8 *)wmem_alloc(scope, length + 1);
+
+    memcpy(buf, ptr, length);
+    buf[length] = '\0';
+    return buf;
+}
+
 /*
  * Given a wmem scope, a pointer, and a length, treat the string of bytes
  * referred to by the pointer and length as an ASCII string, with all bytes
@@ -68,8 +171,16 @@ guint8 *
 get_ascii_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
 {
     wmem_strbuf_t *str;
+    gint valid;
+
+    valid = valid_ascii_prefix_length(ptr, length);
+    if (valid == length)
+        return copy_valid_string(scope, ptr, length);
 
     str = wmem_strbuf_sized_new(scope, length+1, 0);
+    wmem_strbuf_append_len(str, (const gchar *)ptr, valid);
+    ptr += valid;
+    length -= valid;
 
     while (length > 0) {
         guint8 ch = *ptr;
@@ -106,8 +217,17 @@ get_utf_8_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
     wmem_strbuf_t *str;
     guint8 ch;
     const guint8 *prev;
+    gint valid;
+
+    /* Most strings are valid; copy those in one go */
+    valid = valid_utf_8_prefix_length(ptr, length);
+    if (valid == length)
+        return copy_valid_string(scope, ptr, length);
 
     str = wmem_strbuf_sized_new(scope, length+1, 0);
+    wmem_strbuf_append_len(str, (const gchar *)ptr, valid);
+    ptr += valid;
+    length -= valid;
 
     /* See the Unicode Standard conformance chapter at
      * https://www.unicode.org/versions/Unicode13.0.0/ch03.pdf especially
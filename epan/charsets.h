@@ -64,6 +64,22 @@ extern const gunichar2 charset_table_iso_646_basic[0x80];
 extern const gunichar2 charset_table_ebcdic[256];
 extern const gunichar2 charset_table_ebcdic_cp037[256];
 
+/*
+ * Given a pointer and a length, return the number of bytes at the start
+ * of the string that are ASCII, i.e. don't have the high-order bit set.
+ */
+WS_DLL_PUBLIC gint
+valid_ascii_prefix_length(const guint8 *ptr, gint length);
+
+/*
+ * Given a pointer and a length, return the number of bytes at the start
+ * of the string that are well-formed UTF-8. This never ends in the middle
+ * of a multi-byte sequence, so if it is less than the length, the byte
+ * it points to starts an ill-formed sequence.
+ */
+WS_DLL_PUBLIC gint
+valid_utf_8_prefix_length(const guint8 *ptr, gint length);
+
 /*
  * Given a wmem scope, a pointer, and a length, treat the string of bytes
  * referred to by the pointer and length as an ASCII string, with all bytes
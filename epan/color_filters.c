@@ -46,6 +46,9 @@ static GSList *color_filter_list = NULL;
 static GSList *color_filter_deleted_list = NULL;
 static GSList *color_filter_valid_list   = NULL;
 
+/* the active filters, applied together so that they share field loads */
+static dfilter_set_t *color_filter_set = NULL;
+
 /* Color Filters can en-/disabled. */
 static gboolean filters_enabled = TRUE;
 
@@ -519,20 +522,25 @@ color_filters_colorize_packet(epan_dissect_t *edt)
 {
     GSList         *curr;
     color_filter_t *colorf;
+    int             match;
 
     /* If we have color filters, "search" for the matching one. */
     if ((edt->tree != NULL) && (color_filters_used())) {
-        curr = color_filter_list;
+        if (color_filter_set == NULL)
+            color_filter_set = dfilter_set_new();
 
-        while(curr != NULL) {
+        /* The list can change between packets, so rebuild the set. The
+         * indices in the set follow the positions in the list. */
+        dfilter_set_clear(color_filter_set);
+        for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
             colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
-            }
-            curr = g_slist_next(curr);
+            dfilter_set_add(color_filter_set,
+                            colorf->disabled ? NULL : colorf->c_colorfilter);
         }
+
+        match = dfilter_set_apply_first_edt(color_filter_set, edt);
+        if (match >= 0)
+            return (color_filter_t *)g_slist_nth_data(color_filter_list, match);
     }
 
     return NULL;
@@ -45,6 +45,7 @@ typedef struct {
   gchar              *col_buf;              /**< Buffer into which to copy data for column */
   int                 col_fence;            /**< Stuff in column buffer before this index is immutable */
   gboolean            writable;             /**< writable or not */
+  int                 col_len;              /**< Length of the string in col_buf, or -1 if unknown */
 } col_item_t;
 
 /** Column info */
@@ -134,6 +134,7 @@ col_init(column_info *cinfo, const struct epan_session *epan)
     col_item = &cinfo->columns[i];
     col_item->col_buf[0] = '\0';
     col_item->col_data = col_item->col_buf;
+    col_item->col_len = 0;
     col_item->col_fence = 0;
     col_item->writable = TRUE;
     cinfo->col_expr.col_expr[i] = "";
@@ -294,6 +295,7 @@ col_clear(column_info *cinfo, const gint el)
          */
         col_item->col_buf[col_item->col_fence] = '\0';
         col_item->col_data = col_item->col_buf;
+        col_item->col_len = col_item->col_fence;
       }
       cinfo->col_expr.col_expr[i] = "";
       cinfo->col_expr.col_expr_val[i][0] = '\0';
@@ -305,10 +307,36 @@ col_clear(column_info *cinfo, const gint el)
   if (col_item->col_data != col_item->col_buf) {        \
     /* This was set with "col_set_str()"; copy the string they  \
        set it to into the buffer, so we can append to it. */    \
-    (void) g_strlcpy(col_item->col_buf, col_item->col_data, max_len);  \
+    col_item->col_len = (int) MIN(g_strlcpy(col_item->col_buf, col_item->col_data, max_len), (gsize) (max_len) - 1); \
     col_item->col_data = col_item->col_buf;         \
   }
 
+/*
+ * col_len is the length of the string in col_buf, so that appending
+ * doesn't have to find the end of the string each time; the functions
+ * that write to col_buf directly, rather than through the functions
+ * below, set it to -1, and it's recomputed on the next append.
+ */
+static inline size_t
+col_buf_len(col_item_t *col_item)
+{
+  if (col_item->col_len < 0)
+    col_item->col_len = (int) strlen(col_item->col_buf);
+  return col_item->col_len;
+}
+
+/*
+ * Appends str at offset len in col_buf, truncating it to fit, and
+ * returns the new length.
+ */
+static inline size_t
+col_buf_append(col_item_t *col_item, size_t len, const gchar *str, size_t max_len)
+{
+  if (len + 1 < max_len)
+    len += g_strlcpy(&col_item->col_buf[len], str, max_len - len);
+  return MIN(len, max_len - 1);
+}
+
 #define COL_CHECK_REF_TIME(fd, buf)         \
   if (fd->ref_time) {                 \
     (void) g_strlcpy(buf, "*REF*", COL_MAX_LEN );  \
@@ -350,6 +378,7 @@ void col_custom_set_edt(epan_dissect_t *edt, column_info *cinfo)
         col_item->col_custom_fields &&
         col_item->col_custom_fields_ids) {
         col_item->col_data = col_item->col_buf;
+        col_item->col_len = -1;
         cinfo->col_expr.col_expr[i] = epan_custom_set(edt, col_item->col_custom_fields_ids,
                                      col_item->col_custom_occurrence,
                                      col_item->col_buf,
@@ -404,9 +433,9 @@ col_append_lstr(column_info *cinfo, const gint el, const gchar *str1, ...)
        */
       COL_CHECK_APPEND(col_item, max_len);
 
-      pos = strlen(col_item->col_buf);
-      if (pos >= max_len)
-         return;
+      pos = col_buf_len(col_item);
+      if (pos + 1 >= max_len)
+         continue;
 
       va_start(ap, str1);
       str = str1;
@@ -418,6 +447,7 @@ col_append_lstr(column_info *cinfo, const gint el, const gchar *str1, ...)
 
       } while (pos < max_len && (str = va_arg(ap, const char *)) != COL_ADD_LSTR_TERMINATOR);
       va_end(ap);
+      col_item->col_len = (int) MIN(pos, max_len - 1);
     }
   }
 }
@@ -466,12 +496,10 @@ col_append_frame_number(packet_info *pinfo, const gint col, const gchar *fmt_str
 static void
 col_do_append_fstr(column_info *cinfo, const int el, const char *separator, const char *format, va_list ap)
 {
-  size_t len, max_len, sep_len;
-  int    i;
+  size_t len, max_len;
+  int    i, n;
   col_item_t* col_item;
 
-  sep_len = (separator) ? strlen(separator) : 0;
-
   if (el == COL_INFO)
     max_len = COL_MAX_INFO_LEN;
   else
@@ -485,23 +513,28 @@ col_do_append_fstr(column_info *cinfo, const int el, const char *separator, cons
        */
       COL_CHECK_APPEND(col_item, max_len);
 
-      len = strlen(col_item->col_buf);
+      len = col_buf_len(col_item);
 
       /*
        * If we have a separator, append it if the column isn't empty.
        */
-      if (sep_len != 0 && len != 0) {
-        (void) g_strlcat(col_item->col_buf, separator, max_len);
-        len += sep_len;
+      if (separator != NULL && len != 0) {
+        len = col_buf_append(col_item, len, separator, max_len);
       }
 
-      if (len < max_len) {
+      if (len + 1 < max_len) {
         va_list ap2;
 
         va_copy(ap2, ap);
-        vsnprintf(&col_item->col_buf[len], max_len - len, format, ap2);
+        n = vsnprintf(&col_item->col_buf[len], max_len - len, format, ap2);
         va_end(ap2);
+        if (n < 0) {
+          col_item->col_len = -1;
+          continue;
+        }
+        len = MIN(len + (size_t) n, max_len - 1);
       }
+      col_item->col_len = (int) len;
     }
   }
 }
@@ -583,6 +616,7 @@ col_prepend_fstr(column_info *cinfo, const gint el, const gchar *format, ...)
 
       (void) g_strlcat(col_item->col_buf, orig, max_len);
       col_item->col_data = col_item->col_buf;
+      col_item->col_len = -1;
     }
   }
 }
@@ -629,6 +663,7 @@ col_prepend_fence_fstr(column_info *cinfo, const gint el, const gchar *format, .
       }
       (void) g_strlcat(col_item->col_buf, orig, max_len);
       col_item->col_data = col_item->col_buf;
+      col_item->col_len = -1;
     }
   }
 }
@@ -665,7 +700,7 @@ col_add_str(column_info *cinfo, const gint el, const gchar* str)
          */
         col_item->col_data = col_item->col_buf;
       }
-      (void) g_strlcpy(&col_item->col_buf[col_item->col_fence], str, max_len - col_item->col_fence);
+      col_item->col_len = (int) col_buf_append(col_item, col_item->col_fence, str, max_len);
     }
   }
 }
@@ -699,7 +734,7 @@ col_set_str(column_info *cinfo, const gint el, const gchar* str)
          */
         COL_CHECK_APPEND(col_item, max_len);
 
-        (void) g_strlcpy(&col_item->col_buf[col_item->col_fence], str, max_len - col_item->col_fence);
+        col_item->col_len = (int) col_buf_append(col_item, col_item->col_fence, str, max_len);
       } else {
         /*
          * There's no fence, so we can just set the column to point
@@ -756,6 +791,7 @@ col_add_lstr(column_info *cinfo, const gint el, const gchar *str1, ...)
 
       } while (pos < max_len && (str = va_arg(ap, const char *)) != COL_ADD_LSTR_TERMINATOR);
       va_end(ap);
+      col_item->col_len = (int) MIN(pos, max_len - 1);
     }
   }
 }
@@ -765,7 +801,7 @@ void
 col_add_fstr(column_info *cinfo, const gint el, const gchar *format, ...)
 {
   va_list ap;
-  int     i;
+  int     i, n;
   int     max_len;
   col_item_t* col_item;
 
@@ -793,8 +829,9 @@ col_add_fstr(column_info *cinfo, const gint el, const gchar *format, ...)
         col_item->col_data = col_item->col_buf;
       }
       va_start(ap, format);
-      vsnprintf(&col_item->col_buf[col_item->col_fence], max_len - col_item->col_fence, format, ap);
+      n = vsnprintf(&col_item->col_buf[col_item->col_fence], max_len - col_item->col_fence, format, ap);
       va_end(ap);
+      col_item->col_len = n < 0 ? -1 : MIN(col_item->col_fence + n, max_len - 1);
     }
   }
 }
@@ -820,17 +857,17 @@ col_do_append_str(column_info *cinfo, const gint el, const gchar* separator,
        */
       COL_CHECK_APPEND(col_item, max_len);
 
-      len = col_item->col_buf[0];
+      len = col_buf_len(col_item);
 
       /*
        * If we have a separator, append it if the column isn't empty.
        */
       if (separator != NULL) {
         if (len != 0) {
-          (void) g_strlcat(col_item->col_buf, separator, max_len);
+          len = col_buf_append(col_item, len, separator, max_len);
         }
       }
-      (void) g_strlcat(col_item->col_buf, str, max_len);
+      col_item->col_len = (int) col_buf_append(col_item, len, str, max_len);
     }
   }
 }
@@ -874,118 +911,154 @@ col_has_time_fmt(column_info *cinfo, const gint col)
           (col_item->fmt_matx[COL_DELTA_TIME_DIS]));
 }
 
-static void
-set_abs_ymd_time(const frame_data *fd, gchar *buf, char *decimal_point, gboolean local)
+/*
+ * Converting a time stamp to broken-down time is expensive, and
+ * consecutive packets are usually within the same second, so remember
+ * the last conversion for local time and for UTC.
+ */
+typedef struct {
+  gboolean valid;
+  time_t then;
+  struct tm tm;
+} tm_cache_t;
+
+static tm_cache_t local_tm_cache;
+static tm_cache_t utc_tm_cache;
+
+static const struct tm *
+abs_time_to_tm(const frame_data *fd, gboolean local)
 {
+  tm_cache_t *cache = local ? &local_tm_cache : &utc_tm_cache;
   struct tm *tmp;
   time_t then;
-  int tsprecision;
 
-  if (fd->has_ts) {
-    then = fd->abs_ts.secs;
-    if (local)
-      tmp = localtime(&then);
-    else
-      tmp = gmtime(&then);
-  } else
-    tmp = NULL;
+  if (!fd->has_ts)
+    return NULL;
+
+  then = fd->abs_ts.secs;
+  if (cache->valid && cache->then == then)
+    return &cache->tm;
+
+  if (local)
+    tmp = localtime(&then);
+  else
+    tmp = gmtime(&then);
+  if (tmp == NULL)
+    return NULL;
+
+  cache->tm = *tmp;
+  cache->then = then;
+  cache->valid = TRUE;
+  return &cache->tm;
+}
+
+static int
+abs_time_precision(const frame_data *fd)
+{
+  switch (timestamp_get_precision()) {
+  case TS_PREC_FIXED_SEC:
+    return WTAP_TSPREC_SEC;
+  case TS_PREC_FIXED_DSEC:
+    return WTAP_TSPREC_DSEC;
+  case TS_PREC_FIXED_CSEC:
+    return WTAP_TSPREC_CSEC;
+  case TS_PREC_FIXED_MSEC:
+    return WTAP_TSPREC_MSEC;
+  case TS_PREC_FIXED_USEC:
+    return WTAP_TSPREC_USEC;
+  case TS_PREC_FIXED_NSEC:
+    return WTAP_TSPREC_NSEC;
+  case TS_PREC_AUTO:
+    return fd->tsprec;
+  default:
+    ws_assert_not_reached();
+  }
+}
+
+/* Write value as exactly digits decimal digits, like "%0<digits>u" */
+static gchar *
+put_digits(gchar *p, guint32 value, int digits)
+{
+  int i;
+
+  for (i = digits - 1; i >= 0; i--) {
+    p[i] = '0' + value % 10;
+    value /= 10;
+  }
+  return p + digits;
+}
+
+static gchar *
+put_year(gchar *p, int year)
+{
+  if (year < 0 || year > 9999)
+    return p + snprintf(p, 12, "%04d", year);
+  return put_digits(p, year, 4);
+}
+
+/* "hh:mm:ss", followed by the fraction of a second to the given precision */
+static gchar *
+put_time_of_day(gchar *p, const struct tm *tmp, const char *decimal_point,
+                int nsecs, int tsprecision)
+{
+  guint32 fraction;
+  int digits;
+
+  p = put_digits(p, tmp->tm_hour, 2);
+  *p++ = ':';
+  p = put_digits(p, tmp->tm_min, 2);
+  *p++ = ':';
+  p = put_digits(p, tmp->tm_sec, 2);
+
+  switch (tsprecision) {
+  case WTAP_TSPREC_SEC:
+    return p;
+  case WTAP_TSPREC_DSEC:
+    fraction = nsecs / 100000000;
+    digits = 1;
+    break;
+  case WTAP_TSPREC_CSEC:
+    fraction = nsecs / 10000000;
+    digits = 2;
+    break;
+  case WTAP_TSPREC_MSEC:
+    fraction = nsecs / 1000000;
+    digits = 3;
+    break;
+  case WTAP_TSPREC_USEC:
+    fraction = nsecs / 1000;
+    digits = 6;
+    break;
+  case WTAP_TSPREC_NSEC:
+    fraction = nsecs;
+    digits = 9;
+    break;
+  default:
+    ws_assert_not_reached();
+  }
+
+  while (*decimal_point)
+    *p++ = *decimal_point++;
+  return put_digits(p, fraction, digits);
+}
+
+static void
+set_abs_ymd_time(const frame_data *fd, gchar *buf, char *decimal_point, gboolean local)
+{
+  const struct tm *tmp;
+  gchar *p = buf;
+
+  tmp = abs_time_to_tm(fd, local);
   if (tmp != NULL) {
-    switch (timestamp_get_precision()) {
-    case TS_PREC_FIXED_SEC:
-      tsprecision = WTAP_TSPREC_SEC;
-      break;
-    case TS_PREC_FIXED_DSEC:
-      tsprecision = WTAP_TSPREC_DSEC;
-      break;
-    case TS_PREC_FIXED_CSEC:
-      tsprecision = WTAP_TSPREC_CSEC;
-      break;
-    case TS_PREC_FIXED_MSEC:
-      tsprecision = WTAP_TSPREC_MSEC;
-      break;
-    case TS_PREC_FIXED_USEC:
-      tsprecision = WTAP_TSPREC_USEC;
-      break;
-    case TS_PREC_FIXED_NSEC:
-      tsprecision = WTAP_TSPREC_NSEC;
-      break;
-    case TS_PREC_AUTO:
-      tsprecision = fd->tsprec;
-      break;
-    default:
-      ws_assert_not_reached();
-    }
-    switch (tsprecision) {
-    case WTAP_TSPREC_SEC:
-      snprintf(buf, COL_MAX_LEN,"%04d-%02d-%02d %02d:%02d:%02d",
-        tmp->tm_year + 1900,
-        tmp->tm_mon + 1,
-        tmp->tm_mday,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec);
-      break;
-    case WTAP_TSPREC_DSEC:
-      snprintf(buf, COL_MAX_LEN,"%04d-%02d-%02d %02d:%02d:%02d%s%01d",
-        tmp->tm_year + 1900,
-        tmp->tm_mon + 1,
-        tmp->tm_mday,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 100000000);
-      break;
-    case WTAP_TSPREC_CSEC:
-      snprintf(buf, COL_MAX_LEN,"%04d-%02d-%02d %02d:%02d:%02d%s%02d",
-        tmp->tm_year + 1900,
-        tmp->tm_mon + 1,
-        tmp->tm_mday,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 10000000);
-      break;
-    case WTAP_TSPREC_MSEC:
-      snprintf(buf, COL_MAX_LEN, "%04d-%02d-%02d %02d:%02d:%02d%s%03d",
-        tmp->tm_year + 1900,
-        tmp->tm_mon + 1,
-        tmp->tm_mday,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 1000000);
-      break;
-    case WTAP_TSPREC_USEC:
-      snprintf(buf, COL_MAX_LEN, "%04d-%02d-%02d %02d:%02d:%02d%s%06d",
-        tmp->tm_year + 1900,
-        tmp->tm_mon + 1,
-        tmp->tm_mday,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 1000);
-      break;
-    case WTAP_TSPREC_NSEC:
-      snprintf(buf, COL_MAX_LEN, "%04d-%02d-%02d %02d:%02d:%02d%s%09d",
-        tmp->tm_year + 1900,
-        tmp->tm_mon + 1,
-        tmp->tm_mday,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs);
-      break;
-    default:
-      ws_assert_not_reached();
-    }
-  } else {
-    buf[0] = '\0';
+    p = put_year(p, tmp->tm_year + 1900);
+    *p++ = '-';
+    p = put_digits(p, tmp->tm_mon + 1, 2);
+    *p++ = '-';
+    p = put_digits(p, tmp->tm_mday, 2);
+    *p++ = ' ';
+    p = put_time_of_day(p, tmp, decimal_point, fd->abs_ts.nsecs, abs_time_precision(fd));
   }
+  *p = '\0';
 }
 
 static void
@@ -1011,109 +1084,18 @@ col_set_utc_ymd_time(const frame_data *fd, column_info *cinfo, const int col)
 static void
 set_abs_ydoy_time(const frame_data *fd, gchar *buf, char *decimal_point, gboolean local)
 {
-  struct tm *tmp;
-  time_t then;
-  int tsprecision;
+  const struct tm *tmp;
+  gchar *p = buf;
 
-  if (fd->has_ts) {
-    then = fd->abs_ts.secs;
-    if (local)
-      tmp = localtime(&then);
-    else
-      tmp = gmtime(&then);
-  } else
-    tmp = NULL;
+  tmp = abs_time_to_tm(fd, local);
   if (tmp != NULL) {
-    switch (timestamp_get_precision()) {
-    case TS_PREC_FIXED_SEC:
-      tsprecision = WTAP_TSPREC_SEC;
-      break;
-    case TS_PREC_FIXED_DSEC:
-      tsprecision = WTAP_TSPREC_DSEC;
-      break;
-    case TS_PREC_FIXED_CSEC:
-      tsprecision = WTAP_TSPREC_CSEC;
-      break;
-    case TS_PREC_FIXED_MSEC:
-      tsprecision = WTAP_TSPREC_MSEC;
-      break;
-    case TS_PREC_FIXED_USEC:
-      tsprecision = WTAP_TSPREC_USEC;
-      break;
-    case TS_PREC_FIXED_NSEC:
-      tsprecision = WTAP_TSPREC_NSEC;
-      break;
-    case TS_PREC_AUTO:
-      tsprecision = fd->tsprec;
-      break;
-    default:
-      ws_assert_not_reached();
-    }
-    switch (tsprecision) {
-    case WTAP_TSPREC_SEC:
-      snprintf(buf, COL_MAX_LEN,"%04d/%03d %02d:%02d:%02d",
-        tmp->tm_year + 1900,
-        tmp->tm_yday + 1,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec);
-      break;
-    case WTAP_TSPREC_DSEC:
-      snprintf(buf, COL_MAX_LEN,"%04d/%03d %02d:%02d:%02d%s%01d",
-        tmp->tm_year + 1900,
-        tmp->tm_yday + 1,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 100000000);
-      break;
-    case WTAP_TSPREC_CSEC:
-      snprintf(buf, COL_MAX_LEN,"%04d/%03d %02d:%02d:%02d%s%02d",
-        tmp->tm_year + 1900,
-        tmp->tm_yday + 1,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 10000000);
-      break;
-    case WTAP_TSPREC_MSEC:
-      snprintf(buf, COL_MAX_LEN, "%04d/%03d %02d:%02d:%02d%s%03d",
-        tmp->tm_year + 1900,
-        tmp->tm_yday + 1,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 1000000);
-      break;
-    case WTAP_TSPREC_USEC:
-      snprintf(buf, COL_MAX_LEN, "%04d/%03d %02d:%02d:%02d%s%06d",
-        tmp->tm_year + 1900,
-        tmp->tm_yday + 1,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 1000);
-      break;
-    case WTAP_TSPREC_NSEC:
-      snprintf(buf, COL_MAX_LEN, "%04d/%03d %02d:%02d:%02d%s%09d",
-        tmp->tm_year + 1900,
-        tmp->tm_yday + 1,
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs);
-      break;
-    default:
-      ws_assert_not_reached();
-    }
-  } else {
-    buf[0] = '\0';
+    p = put_year(p, tmp->tm_year + 1900);
+    *p++ = '/';
+    p = put_digits(p, tmp->tm_yday + 1, 3);
+    *p++ = ' ';
+    p = put_time_of_day(p, tmp, decimal_point, fd->abs_ts.nsecs, abs_time_precision(fd));
   }
+  *p = '\0';
 }
 
 static void
@@ -1469,98 +1451,13 @@ col_set_delta_time_dis(const frame_data *fd, column_info *cinfo, const int col)
 static void
 set_abs_time(const frame_data *fd, gchar *buf, char *decimal_point, gboolean local)
 {
-  struct tm *tmp;
-  time_t then;
-  int tsprecision;
+  const struct tm *tmp;
+  gchar *p = buf;
 
-  if (fd->has_ts) {
-    then = fd->abs_ts.secs;
-    if (local)
-      tmp = localtime(&then);
-    else
-      tmp = gmtime(&then);
-  } else
-    tmp = NULL;
-  if (tmp != NULL) {
-    switch (timestamp_get_precision()) {
-    case TS_PREC_FIXED_SEC:
-      tsprecision = WTAP_TSPREC_SEC;
-      break;
-    case TS_PREC_FIXED_DSEC:
-      tsprecision = WTAP_TSPREC_DSEC;
-      break;
-    case TS_PREC_FIXED_CSEC:
-      tsprecision = WTAP_TSPREC_CSEC;
-      break;
-    case TS_PREC_FIXED_MSEC:
-      tsprecision = WTAP_TSPREC_MSEC;
-      break;
-    case TS_PREC_FIXED_USEC:
-      tsprecision = WTAP_TSPREC_USEC;
-      break;
-    case TS_PREC_FIXED_NSEC:
-      tsprecision = WTAP_TSPREC_NSEC;
-      break;
-    case TS_PREC_AUTO:
-      tsprecision = fd->tsprec;
-      break;
-    default:
-      ws_assert_not_reached();
-    }
-    switch (tsprecision) {
-    case WTAP_TSPREC_SEC:
-      snprintf(buf, COL_MAX_LEN,"%02d:%02d:%02d",
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec);
-      break;
-    case WTAP_TSPREC_DSEC:
-      snprintf(buf, COL_MAX_LEN,"%02d:%02d:%02d%s%01d",
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 100000000);
-      break;
-    case WTAP_TSPREC_CSEC:
-      snprintf(buf, COL_MAX_LEN,"%02d:%02d:%02d%s%02d",
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 10000000);
-      break;
-    case WTAP_TSPREC_MSEC:
-      snprintf(buf, COL_MAX_LEN,"%02d:%02d:%02d%s%03d",
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 1000000);
-      break;
-    case WTAP_TSPREC_USEC:
-      snprintf(buf, COL_MAX_LEN,"%02d:%02d:%02d%s%06d",
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs / 1000);
-      break;
-    case WTAP_TSPREC_NSEC:
-      snprintf(buf, COL_MAX_LEN, "%02d:%02d:%02d%s%09d",
-        tmp->tm_hour,
-        tmp->tm_min,
-        tmp->tm_sec,
-        decimal_point,
-        fd->abs_ts.nsecs);
-      break;
-    default:
-      ws_assert_not_reached();
-    }
-
-  } else {
-    *buf = '\0';
-  }
+  tmp = abs_time_to_tm(fd, local);
+  if (tmp != NULL)
+    p = put_time_of_day(p, tmp, decimal_point, fd->abs_ts.nsecs, abs_time_precision(fd));
+  *p = '\0';
 }
 
 static void
@@ -1922,6 +1819,7 @@ col_set_time(column_info *cinfo, const gint el, const nstime_t *ts, const char *
         ws_assert_not_reached();
       }
       col_item->col_data = col_item->col_buf;
+      col_item->col_len = -1;
       cinfo->col_expr.col_expr[col] = fieldname;
       (void) g_strlcpy(cinfo->col_expr.col_expr_val[col],col_item->col_buf,COL_MAX_LEN);
     }
@@ -1944,6 +1842,7 @@ col_set_addr(packet_info *pinfo, const int col, const address *addr, const gbool
     col_item->col_data = name;
   else {
     col_item->col_data = col_item->col_buf;
+    col_item->col_len = -1;
     address_to_str_buf(addr, col_item->col_buf, COL_MAX_LEN);
   }
 
@@ -1968,6 +1867,8 @@ col_set_port(packet_info *pinfo, const int col, const gboolean is_res, const gbo
   else
     port = pinfo->destport;
 
+  col_item->col_len = -1;
+
   /* TODO: Use fill_col_exprs */
 
   switch (pinfo->ptype) {
@@ -2079,6 +1980,8 @@ col_fill_in_frame_data(const frame_data *fd, column_info *cinfo, const gint col,
 {
   col_item_t* col_item = &cinfo->columns[col];
 
+  col_item->col_len = -1;
+
   switch (col_item->col_fmt) {
   case COL_NUMBER:
     guint32_to_str_buf(fd->num, col_item->col_buf, COL_MAX_LEN);
@@ -855,6 +855,8 @@ col_finalize(column_info *cinfo)
     else
       col_item->col_buf = g_new(gchar, COL_MAX_LEN);
 
+    col_item->col_len = -1;
+
     cinfo->col_expr.col_expr[i] = "";
     cinfo->col_expr.col_expr_val[i] = g_new(gchar, COL_MAX_LEN);
   }
@@ -862,8 +864,22 @@ col_finalize(column_info *cinfo)
   cinfo->col_expr.col_expr[i] = NULL;
   cinfo->col_expr.col_expr_val[i] = NULL;
 
+  col_set_needed_columns(cinfo, NULL);
+}
+
+void
+col_set_needed_columns(column_info *cinfo, const gboolean *needed)
+{
+  int i, j;
+
+  for (j = 0; j < NUM_COL_FMTS; j++) {
+    cinfo->col_first[j] = -1;
+    cinfo->col_last[j] = -1;
+  }
+
   for (i = 0; i < cinfo->num_cols; i++) {
-    int j;
+    if (needed && !needed[i])
+      continue;
 
     for (j = 0; j < NUM_COL_FMTS; j++) {
       if (!cinfo->columns[i].fmt_matx[j])
@@ -70,6 +70,15 @@ WS_DLL_PUBLIC
 void
 col_finalize(column_info *cinfo);
 
+/*
+ * Only fill in the columns for which needed[col] is TRUE; the col_*
+ * calls made by dissectors for formats that only appear in other columns
+ * do nothing. Passing NULL fills in all columns again.
+ */
+WS_DLL_PUBLIC
+void
+col_set_needed_columns(column_info *cinfo, const gboolean *needed);
+
 WS_DLL_PUBLIC
 void
 build_column_format_array(column_info *cinfo, const gint num_cols, const gboolean reset_fences);
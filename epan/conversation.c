@@ -33,6 +33,18 @@ struct endpoint {
 	guint options;
 };
 
+/*
+ * Per-protocol data attached to a conversation. A conversation usually
+ * carries data for only a handful of protocols, so these are kept in a
+ * small array that is searched linearly.
+ */
+struct conversation_proto_data {
+	int	proto;
+	void	*proto_data;
+};
+
+#define CONVERSATION_PROTO_DATA_INITIAL_SIZE 4
+
 struct conversation_key {
 	struct conversation_key *next;
 	address	addr1;
@@ -65,6 +77,41 @@ static wmem_map_t *conversation_hashtable_no_addr2_or_port2 = NULL;
 
 static guint32 new_index;
 
+/*
+ * Incremented whenever a conversation is added to or removed from one of
+ * the hash tables, so that cached lookup results can be invalidated.
+ */
+static guint32 conversation_generation;
+
+/*
+ * A small cache of find_conversation_pinfo() results, allocated from
+ * pinfo->pool and hung off the packet_info so that the lookups done by
+ * each layer of a stacked dissection (TCP, TLS, HTTP2, ...) only search
+ * the hash tables once per packet.
+ */
+#define CONVERSATION_LOOKUP_CACHE_SIZE 4
+
+typedef struct conversation_lookup_cache_entry {
+	const struct endpoint *endpoint;	/* pinfo->conv_endpoint if used, else NULL */
+	address addr_a;
+	address addr_b;
+	endpoint_type etype;
+	guint32 port_a;
+	guint32 port_b;
+	guint options;
+	guint32 generation;
+	conversation_t *conv;
+} conversation_lookup_cache_entry_t;
+
+struct conversation_lookup_cache {
+	conversation_lookup_cache_entry_t entries[CONVERSATION_LOOKUP_CACHE_SIZE];
+	guint count;
+	guint next;
+};
+
+static guint64 conversation_lookup_cache_hits;
+static guint64 conversation_lookup_cache_misses;
+
 /*
  * Placeholder for address-less conversations.
  */
@@ -481,6 +528,10 @@ void conversation_epan_reset(void)
 	 * Start the conversation indices over at 0.
 	 */
 	new_index = 0;
+
+	conversation_generation++;
+	conversation_lookup_cache_hits = 0;
+	conversation_lookup_cache_misses = 0;
 }
 
 /*
@@ -494,6 +545,8 @@ conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *chain_tail, *cur, *prev;
 
+	conversation_generation++;
+
 	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
 
 	if (NULL==chain_head) {
@@ -550,6 +603,8 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *cur, *prev;
 
+	conversation_generation++;
+
 	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
 
 	if (conv == chain_head) {
@@ -744,6 +799,8 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	conversation->conv_index = new_index;
 	conversation->setup_frame = conversation->last_frame = setup_frame;
 	conversation->data_list = NULL;
+	conversation->data_list_len = 0;
+	conversation->data_list_size = 0;
 
 	conversation->dissector_tree = wmem_tree_new(wmem_file_scope());
 
@@ -1294,31 +1351,54 @@ conversation_t *find_conversation_by_id(const guint32 frame, const endpoint_type
 	return find_conversation(frame, &null_address_, &null_address_, etype, id, 0, options|NO_ADDR_B|NO_PORT_B);
 }
 
+static struct conversation_proto_data *
+conversation_find_proto_data(const conversation_t *conv, const int proto)
+{
+	for (guint i = 0; i < conv->data_list_len; i++) {
+		if (conv->data_list[i].proto == proto)
+			return &conv->data_list[i];
+	}
+	return NULL;
+}
+
 void
 conversation_add_proto_data(conversation_t *conv, const int proto, void *proto_data)
 {
-	/* Add it to the list of items for this conversation. */
-	if (conv->data_list == NULL)
-		conv->data_list = wmem_tree_new(wmem_file_scope());
+	struct conversation_proto_data *entry = conversation_find_proto_data(conv, proto);
 
-	wmem_tree_insert32(conv->data_list, proto, proto_data);
+	if (entry != NULL) {
+		entry->proto_data = proto_data;
+		return;
+	}
+
+	/* Add it to the list of items for this conversation. */
+	if (conv->data_list_len == conv->data_list_size) {
+		conv->data_list_size = conv->data_list_size ? conv->data_list_size * 2 : CONVERSATION_PROTO_DATA_INITIAL_SIZE;
+		conv->data_list = (struct conversation_proto_data *)wmem_realloc(wmem_file_scope(), conv->data_list,
+		    conv->data_list_size * sizeof(struct conversation_proto_data));
+	}
+	entry = &conv->data_list[conv->data_list_len++];
+	entry->proto = proto;
+	entry->proto_data = proto_data;
 }
 
 void *
 conversation_get_proto_data(const conversation_t *conv, const int proto)
 {
-	/* No tree created yet */
-	if (conv->data_list == NULL)
-		return NULL;
+	struct conversation_proto_data *entry = conversation_find_proto_data(conv, proto);
 
-	return wmem_tree_lookup32(conv->data_list, proto);
+	return entry ? entry->proto_data : NULL;
 }
 
 void
 conversation_delete_proto_data(conversation_t *conv, const int proto)
 {
-	if (conv->data_list != NULL)
-		wmem_tree_remove32(conv->data_list, proto);
+	struct conversation_proto_data *entry = conversation_find_proto_data(conv, proto);
+
+	if (entry != NULL) {
+		/* Order doesn't matter; move the last entry into the hole. */
+		*entry = conv->data_list[--conv->data_list_len];
+	}
 }
 
 void
@@ -1437,6 +1517,75 @@ try_conversation_dissector_by_id(const endpoint_type etype, const guint32 id, tv
 	return FALSE;
 }
 
+/**  A helper function that calls find_conversation() using data from pinfo
+ *  The frame number and addresses are taken from pinfo.
+ */
+static conversation_lookup_cache_entry_t *
+conversation_lookup_cache_find(packet_info *pinfo, const address *addr_a, const address *addr_b,
+    const endpoint_type etype, const guint32 port_a, const guint32 port_b, const guint options)
+{
+	struct conversation_lookup_cache *cache = pinfo->conv_lookup_cache;
+	const struct endpoint *endpoint = pinfo->use_endpoint ? pinfo->conv_endpoint : NULL;
+
+	if (cache == NULL)
+		return NULL;
+
+	for (guint i = 0; i < cache->count; i++) {
+		conversation_lookup_cache_entry_t *entry = &cache->entries[i];
+
+		if (entry->generation == conversation_generation &&
+		    entry->endpoint == endpoint &&
+		    entry->etype == etype &&
+		    entry->port_a == port_a &&
+		    entry->port_b == port_b &&
+		    entry->options == options &&
+		    addresses_equal(&entry->addr_a, addr_a) &&
+		    addresses_equal(&entry->addr_b, addr_b)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void
+conversation_lookup_cache_add(packet_info *pinfo, const address *addr_a, const address *addr_b,
+    const endpoint_type etype, const guint32 port_a, const guint32 port_b, const guint options,
+    conversation_t *conv)
+{
+	struct conversation_lookup_cache *cache = pinfo->conv_lookup_cache;
+	conversation_lookup_cache_entry_t *entry;
+
+	if (cache == NULL) {
+		cache = wmem_new(pinfo->pool, struct conversation_lookup_cache);
+		cache->count = 0;
+		cache->next = 0;
+		pinfo->conv_lookup_cache = cache;
+	}
+
+	entry = &cache->entries[cache->next];
+	if (cache->count < CONVERSATION_LOOKUP_CACHE_SIZE) {
+		cache->count++;
+	} else {
+		free_address_wmem(pinfo->pool, &entry->addr_a);
+		free_address_wmem(pinfo->pool, &entry->addr_b);
+	}
+	cache->next = (cache->next + 1) % CONVERSATION_LOOKUP_CACHE_SIZE;
+
+	/*
+	 * The addresses may point into buffers that a dissector changes
+	 * later in the packet, so keep our own copies.
+	 */
+	entry->endpoint = pinfo->use_endpoint ? pinfo->conv_endpoint : NULL;
+	copy_address_wmem(pinfo->pool, &entry->addr_a, addr_a);
+	copy_address_wmem(pinfo->pool, &entry->addr_b, addr_b);
+	entry->etype = etype;
+	entry->port_a = port_a;
+	entry->port_b = port_b;
+	entry->options = options;
+	entry->generation = conversation_generation;
+	entry->conv = conv;
+}
+
 /**  A helper function that calls find_conversation() using data from pinfo
  *  The frame number and addresses are taken from pinfo.
  */
@@ -1444,6 +1593,11 @@ conversation_t *
 find_conversation_pinfo(packet_info *pinfo, const guint options)
 {
 	conversation_t *conv=NULL;
+	const address  *addr_a, *addr_b;
+	endpoint_type   etype;
+	guint32         port_a, port_b;
+	guint           find_options;
+	conversation_lookup_cache_entry_t *cached;
 
 	DINSTR(gchar *src_str = address_to_str(NULL, &pinfo->src));
 	DINSTR(gchar *dst_str = address_to_str(NULL, &pinfo->dst));
@@ -1454,27 +1608,40 @@ find_conversation_pinfo(packet_info *pinfo, const guint options)
 	DINSTR(wmem_free(NULL, src_str));
 	DINSTR(wmem_free(NULL, dst_str));
 
-	/* Have we seen this conversation before? */
 	if (pinfo->use_endpoint) {
 		DISSECTOR_ASSERT(pinfo->conv_endpoint);
-		if ((conv = find_conversation(pinfo->num, &pinfo->conv_endpoint->addr1, &pinfo->conv_endpoint->addr2,
-					      pinfo->conv_endpoint->etype, pinfo->conv_endpoint->port1,
-					      pinfo->conv_endpoint->port2, pinfo->conv_endpoint->options)) != NULL) {
-			DPRINT(("found previous conversation for frame #%u (last_frame=%d)",
-					pinfo->num, conv->last_frame));
-			if (pinfo->num > conv->last_frame) {
-				conv->last_frame = pinfo->num;
-			}
-		}
+		addr_a = &pinfo->conv_endpoint->addr1;
+		addr_b = &pinfo->conv_endpoint->addr2;
+		etype = pinfo->conv_endpoint->etype;
+		port_a = pinfo->conv_endpoint->port1;
+		port_b = pinfo->conv_endpoint->port2;
+		find_options = pinfo->conv_endpoint->options;
 	} else {
-		if ((conv = find_conversation(pinfo->num, &pinfo->src, &pinfo->dst,
-					      conversation_pt_to_endpoint_type(pinfo->ptype), pinfo->srcport,
-					      pinfo->destport, options)) != NULL) {
-			DPRINT(("found previous conversation for frame #%u (last_frame=%d)",
-					pinfo->num, conv->last_frame));
-			if (pinfo->num > conv->last_frame) {
-				conv->last_frame = pinfo->num;
-			}
+		addr_a = &pinfo->src;
+		addr_b = &pinfo->dst;
+		etype = conversation_pt_to_endpoint_type(pinfo->ptype);
+		port_a = pinfo->srcport;
+		port_b = pinfo->destport;
+		find_options = options;
+	}
+
+	/* Have we looked this conversation up already for this packet? */
+	cached = conversation_lookup_cache_find(pinfo, addr_a, addr_b, etype, port_a, port_b, find_options);
+	if (cached != NULL) {
+		conversation_lookup_cache_hits++;
+		conv = cached->conv;
+	} else {
+		conversation_lookup_cache_misses++;
+		/* Have we seen this conversation before? */
+		conv = find_conversation(pinfo->num, addr_a, addr_b, etype, port_a, port_b, find_options);
+		conversation_lookup_cache_add(pinfo, addr_a, addr_b, etype, port_a, port_b, find_options, conv);
+	}
+
+	if (conv != NULL) {
+		DPRINT(("found previous conversation for frame #%u (last_frame=%d)",
+				pinfo->num, conv->last_frame));
+		if (pinfo->num > conv->last_frame) {
+			conv->last_frame = pinfo->num;
 		}
 	}
 
@@ -1564,6 +1731,13 @@ guint32 conversation_get_endpoint_by_id(struct _packet_info *pinfo, endpoint_typ
 	return pinfo->conv_endpoint->port1;
 }
 
+void
+conversation_get_lookup_cache_stats(guint64 *hits, guint64 *misses)
+{
+	*hits = conversation_lookup_cache_hits;
+	*misses = conversation_lookup_cache_misses;
+}
+
 wmem_map_t *
 get_conversation_hashtable_exact(void)
 {
@@ -91,6 +91,8 @@ typedef enum {
 struct conversation_key;
 typedef struct conversation_key* conversation_key_t;
 
+struct conversation_proto_data;
+
 typedef struct conversation {
 	struct conversation *next;	/** pointer to next conversation on hash chain */
 	struct conversation *last;	/** pointer to the last conversation on hash chain */
@@ -99,7 +101,9 @@ typedef struct conversation {
 	guint32 setup_frame;		/** frame number that setup this conversation */
 					/* Assume that setup_frame is also the lowest frame number for now. */
 	guint32 last_frame;		/** highest frame number in this conversation */
-	wmem_tree_t *data_list;		/** list of data associated with conversation */
+	struct conversation_proto_data *data_list; /** array of data associated with conversation */
+	guint	data_list_len;		/** number of entries in data_list */
+	guint	data_list_size;		/** number of entries allocated for data_list */
 	wmem_tree_t *dissector_tree;	/** tree containing protocol dissector client associated with conversation */
 	guint	options;		/** wildcard flags */
 	conversation_key_t key_ptr;	/** pointer to the key for this conversation */
@@ -272,6 +276,14 @@ conversation_hash_exact(gconstpointer v);
 WS_DLL_PUBLIC gchar*
 conversation_get_html_hash(const conversation_key_t key);
 
+/**
+ * Get the number of find_conversation_pinfo() calls that were answered from
+ * the per-packet lookup cache (hits) and that had to search the hash tables
+ * (misses) since the last file was loaded.
+ */
+WS_DLL_PUBLIC void
+conversation_get_lookup_cache_stats(guint64 *hits, guint64 *misses);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
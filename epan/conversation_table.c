@@ -11,8 +11,11 @@
 
 #include "config.h"
 
+#include <math.h>
 #include <string.h>
 
+#include <wsutil/bits_ctz.h>
+
 #include "proto.h"
 #include "packet_info.h"
 #include "conversation_table.h"
@@ -188,6 +191,8 @@ guint conversation_table_get_num(void)
 
 /** Compute the hash value for two given address/port pairs.
  * (Parameter type is gconstpointer for GHashTable compatibility.)
+ * The hash does not depend on which endpoint comes first, just like
+ * conversation_equal(), so one lookup finds either direction.
  *
  * @param v Conversation Key. MUST point to a conv_key_t struct.
  * @return Computed key hash.
@@ -196,18 +201,18 @@ static guint
 conversation_hash(gconstpointer v)
 {
     const conv_key_t *key = (const conv_key_t *)v;
-    guint hash_val;
+    guint hash_1, hash_2;
 
-    hash_val = 0;
-    hash_val = add_address_to_hash(hash_val, &key->addr1);
-    hash_val += key->port1;
-    hash_val = add_address_to_hash(hash_val, &key->addr2);
-    hash_val += key->port2;
-    hash_val ^= key->conv_id;
+    hash_1 = add_address_to_hash(0, &key->addr1) + key->port1;
+    hash_2 = add_address_to_hash(0, &key->addr2) + key->port2;
 
-    return hash_val;
+    return (hash_1 + hash_2) ^ key->conv_id;
 }
 
+/* Limit on conversation ids kept in conv_id_index; stream numbers are
+ * dense, anything beyond this just goes through the hash table. */
+#define CONV_ID_INDEX_MAX (1U << 24)
+
 /** Compare two conversation keys for an exact match.
  * (Parameter types are gconstpointer for GHashTable compatibility.)
  *
@@ -244,6 +249,222 @@ conversation_equal(gconstpointer key1, gconstpointer key2)
     return FALSE;
 }
 
+/*
+ * Approximate mode. conv_array holds at most approx_max_items conversations
+ * and works as a space-saving table: a min-heap by frame count finds the
+ * lightest entry, which a new conversation replaces once the Count-Min
+ * sketch says it has more frames. HyperLogLog registers keep the number of
+ * distinct conversations, which the table alone no longer knows.
+ */
+#define CONV_APPROX_HLL_BITS    14
+#define CONV_APPROX_HLL_REGS    (1U << CONV_APPROX_HLL_BITS)
+#define CONV_APPROX_CM_DEPTH    4
+#define CONV_APPROX_CM_WIDTH    8192    /* power of 2 */
+
+typedef struct {
+    guint64 frames;
+    guint64 bytes;
+} conv_approx_cell_t;
+
+typedef struct _conv_approx_t {
+    guint8              hll[CONV_APPROX_HLL_REGS];
+    conv_approx_cell_t  cm[CONV_APPROX_CM_DEPTH][CONV_APPROX_CM_WIDTH];
+    guint64             frames;
+    guint64             bytes;
+    guint64             evictions;
+    guint              *heap;       /* conv_array indexes, lightest first */
+    guint              *heap_pos;   /* heap position by conv_array index */
+    guint               heap_len;
+} conv_approx_t;
+
+static conv_approx_t *
+conv_approx_new(guint max_items)
+{
+    conv_approx_t *approx = g_new0(conv_approx_t, 1);
+
+    approx->heap = g_new(guint, max_items);
+    approx->heap_pos = g_new(guint, max_items);
+    return approx;
+}
+
+static void
+conv_approx_free(conv_approx_t *approx)
+{
+    g_free(approx->heap);
+    g_free(approx->heap_pos);
+    g_free(approx);
+}
+
+/* MurmurHash3 finalizer */
+static guint64
+conv_approx_mix(guint64 h)
+{
+    h ^= h >> 33;
+    h *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+    return h;
+}
+
+static guint64
+conv_approx_endpoint_hash(const address *addr, guint32 port)
+{
+    guint64 h = addr->len ? wmem_strong_hash((const guint8 *)addr->data, addr->len) : 0;
+
+    return conv_approx_mix(((h << 32) | port) ^ ((guint64)addr->type << 56));
+}
+
+/* Like conversation_hash(), both directions hash alike */
+static guint64
+conv_approx_hash(const address *src, const address *dst, guint32 src_port, guint32 dst_port, conv_id_t conv_id)
+{
+    return conv_approx_mix(conv_approx_endpoint_hash(src, src_port) +
+                           conv_approx_endpoint_hash(dst, dst_port) +
+                           conv_id * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15));
+}
+
+/* Count a packet in the sketches and return the estimated totals of its
+ * conversation, this packet included. */
+static void
+conv_approx_add(conv_approx_t *approx, guint64 h, int num_frames, int num_bytes,
+        guint64 *est_frames, guint64 *est_bytes)
+{
+    guint32 lo = (guint32)h;
+    guint32 hi = (guint32)(h >> 32) | 1;
+    guint64 rest = h & ((G_GUINT64_CONSTANT(1) << (64 - CONV_APPROX_HLL_BITS)) - 1);
+    guint reg = (guint)(h >> (64 - CONV_APPROX_HLL_BITS));
+    guint8 rank;
+    guint i;
+
+    rank = rest ? (guint8)(ws_ctz(rest) + 1) : (guint8)(64 - CONV_APPROX_HLL_BITS + 1);
+    if (rank > approx->hll[reg]) {
+        approx->hll[reg] = rank;
+    }
+
+    *est_frames = G_MAXUINT64;
+    *est_bytes = G_MAXUINT64;
+    for (i = 0; i < CONV_APPROX_CM_DEPTH; i++) {
+        conv_approx_cell_t *cell = &approx->cm[i][(lo + i * hi) & (CONV_APPROX_CM_WIDTH - 1)];
+
+        cell->frames += num_frames;
+        cell->bytes += num_bytes;
+        if (cell->frames < *est_frames) {
+            *est_frames = cell->frames;
+        }
+        if (cell->bytes < *est_bytes) {
+            *est_bytes = cell->bytes;
+        }
+    }
+
+    approx->frames += num_frames;
+    approx->bytes += num_bytes;
+}
+
+static guint64
+conv_approx_weight(const conv_hash_t *ch, guint idx)
+{
+    const conv_item_t *conv_item = &g_array_index(ch->conv_array, conv_item_t, idx);
+
+    return conv_item->tx_frames + conv_item->rx_frames;
+}
+
+static void
+conv_approx_heap_set(conv_approx_t *approx, guint pos, guint idx)
+{
+    approx->heap[pos] = idx;
+    approx->heap_pos[idx] = pos;
+}
+
+static void
+conv_approx_heap_push(conv_hash_t *ch, guint idx)
+{
+    conv_approx_t *approx = ch->approx;
+    guint pos = approx->heap_len++;
+    guint64 weight = conv_approx_weight(ch, idx);
+
+    while (pos > 0 && conv_approx_weight(ch, approx->heap[(pos - 1) / 2]) > weight) {
+        conv_approx_heap_set(approx, pos, approx->heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    conv_approx_heap_set(approx, pos, idx);
+}
+
+/* Restore heap order after the frame count of idx went up */
+static void
+conv_approx_heap_update(conv_hash_t *ch, guint idx)
+{
+    conv_approx_t *approx = ch->approx;
+    guint pos = approx->heap_pos[idx];
+    guint64 weight = conv_approx_weight(ch, idx);
+
+    for (;;) {
+        guint child = 2 * pos + 1;
+
+        if (child >= approx->heap_len) {
+            break;
+        }
+        if (child + 1 < approx->heap_len &&
+            conv_approx_weight(ch, approx->heap[child + 1]) < conv_approx_weight(ch, approx->heap[child])) {
+            child++;
+        }
+        if (conv_approx_weight(ch, approx->heap[child]) >= weight) {
+            break;
+        }
+        conv_approx_heap_set(approx, pos, approx->heap[child]);
+        pos = child;
+    }
+    conv_approx_heap_set(approx, pos, idx);
+}
+
+gboolean
+get_conversation_approx_stats(conv_hash_t *ch, conv_approx_stats_t *stats)
+{
+    conv_approx_t *approx;
+    double m = CONV_APPROX_HLL_REGS;
+    double sum = 0.0;
+    double estimate;
+    guint zeros = 0;
+    guint i;
+
+    if (!ch || !ch->approx || !stats) {
+        return FALSE;
+    }
+    approx = ch->approx;
+
+    stats->frames = approx->frames;
+    stats->bytes = approx->bytes;
+    stats->confidence = 1.0 - exp(-(double)CONV_APPROX_CM_DEPTH);
+
+    if (approx->evictions == 0 && ch->conv_array->len < ch->approx_max_items) {
+        /* Nothing was left out, so the table is exact */
+        stats->conversations = ch->conv_array->len;
+        stats->conversations_err = 0.0;
+        stats->frames_err = 0;
+        stats->bytes_err = 0;
+        return TRUE;
+    }
+
+    for (i = 0; i < CONV_APPROX_HLL_REGS; i++) {
+        sum += ldexp(1.0, -approx->hll[i]);
+        if (approx->hll[i] == 0) {
+            zeros++;
+        }
+    }
+    estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros) {
+        /* small range correction */
+        estimate = m * log(m / zeros);
+    }
+    stats->conversations = (guint64)(estimate + 0.5);
+    stats->conversations_err = 1.04 / sqrt(m);
+
+    /* Count-Min: overestimate <= e / width * total, with probability 1 - e^-depth */
+    stats->frames_err = (guint64)ceil(G_E / CONV_APPROX_CM_WIDTH * approx->frames);
+    stats->bytes_err = (guint64)ceil(G_E / CONV_APPROX_CM_WIDTH * approx->bytes);
+    return TRUE;
+}
+
 void
 reset_conversation_table_data(conv_hash_t *ch)
 {
@@ -266,8 +487,18 @@ reset_conversation_table_data(conv_hash_t *ch)
         g_hash_table_destroy(ch->hashtable);
     }
 
+    if (ch->conv_id_index != NULL) {
+        g_array_free(ch->conv_id_index, TRUE);
+    }
+
+    if (ch->approx != NULL) {
+        conv_approx_free(ch->approx);
+    }
+
     ch->conv_array=NULL;
     ch->hashtable=NULL;
+    ch->conv_id_index=NULL;
+    ch->approx=NULL;
 }
 
 void reset_hostlist_table_data(conv_hash_t *ch)
@@ -558,6 +789,59 @@ char *get_hostlist_filter(hostlist_talker_t *host)
     return str;
 }
 
+/* Make conv_array[idx] reachable by its key and conversation id */
+static void
+conv_table_index_item(conv_hash_t *ch, guint idx)
+{
+    conv_item_t *conv_item = &g_array_index(ch->conv_array, conv_item_t, idx);
+    conv_key_t *new_key;
+    conv_id_t conv_id = conv_item->conv_id;
+
+    /* ct->conversations address is not a constant but src/dst_address.data are */
+    new_key = g_new(conv_key_t, 1);
+    set_address(&new_key->addr1, conv_item->src_address.type, conv_item->src_address.len, conv_item->src_address.data);
+    set_address(&new_key->addr2, conv_item->dst_address.type, conv_item->dst_address.len, conv_item->dst_address.data);
+    new_key->port1 = conv_item->src_port;
+    new_key->port2 = conv_item->dst_port;
+    new_key->conv_id = conv_id;
+    g_hash_table_insert(ch->hashtable, new_key, GUINT_TO_POINTER(idx));
+
+    if (conv_id != CONV_ID_UNSET && conv_id < CONV_ID_INDEX_MAX) {
+        if (ch->conv_id_index == NULL) {
+            ch->conv_id_index = g_array_new(FALSE, TRUE, sizeof(guint));
+        }
+        if (conv_id >= ch->conv_id_index->len) {
+            g_array_set_size(ch->conv_id_index, conv_id + 1);
+        }
+        if (g_array_index(ch->conv_id_index, guint, conv_id) == 0) {
+            g_array_index(ch->conv_id_index, guint, conv_id) = idx + 1;
+        }
+    }
+}
+
+/* Undo conv_table_index_item() and release the addresses of conv_array[idx] */
+static void
+conv_table_unindex_item(conv_hash_t *ch, guint idx)
+{
+    conv_item_t *conv_item = &g_array_index(ch->conv_array, conv_item_t, idx);
+    conv_key_t key;
+
+    key.addr1 = conv_item->src_address;
+    key.addr2 = conv_item->dst_address;
+    key.port1 = conv_item->src_port;
+    key.port2 = conv_item->dst_port;
+    key.conv_id = conv_item->conv_id;
+    g_hash_table_remove(ch->hashtable, &key);
+
+    if (ch->conv_id_index != NULL && conv_item->conv_id < ch->conv_id_index->len &&
+        g_array_index(ch->conv_id_index, guint, conv_item->conv_id) == idx + 1) {
+        g_array_index(ch->conv_id_index, guint, conv_item->conv_id) = 0;
+    }
+
+    free_address(&conv_item->src_address);
+    free_address(&conv_item->dst_address);
+}
+
 void
 add_conversation_table_data(conv_hash_t *ch, const address *src, const address *dst, guint32 src_port, guint32 dst_port, int num_frames, int num_bytes,
         nstime_t *ts, nstime_t *abs_ts, ct_dissector_info_t *ct_info, endpoint_type etype)
@@ -582,6 +866,8 @@ add_conversation_table_data_with_conv_id(
 {
     conv_item_t *conv_item = NULL;
     gboolean is_fwd_direction = FALSE; /* direction of any conversation found */
+    guint conversation_idx;
+    guint64 est_frames = 0, est_bytes = 0;
 
     /* if we don't have any entries at all yet */
     if (ch->conv_array == NULL) {
@@ -592,74 +878,104 @@ add_conversation_table_data_with_conv_id(
                                               g_free,             /* key_destroy_func */
                                               NULL);              /* value_destroy_func */
 
+        if (ch->approx_max_items) {
+            ch->approx = conv_approx_new(ch->approx_max_items);
+        }
+
     } else { /* try to find it among the existing known conversations */
-        /* first, check in the fwd conversations */
         conv_key_t existing_key;
         gpointer conversation_idx_hash_val;
 
-        existing_key.addr1 = *src;
-        existing_key.addr2 = *dst;
-        existing_key.port1 = src_port;
-        existing_key.port2 = dst_port;
-        existing_key.conv_id = conv_id;
-        if (g_hash_table_lookup_extended(ch->hashtable, &existing_key, NULL, &conversation_idx_hash_val)) {
-            conv_item = &g_array_index(ch->conv_array, conv_item_t, GPOINTER_TO_UINT(conversation_idx_hash_val));
+        /* stream numbers map straight to their conversation */
+        if (conv_id != CONV_ID_UNSET && ch->conv_id_index != NULL && conv_id < ch->conv_id_index->len) {
+            guint idx = g_array_index(ch->conv_id_index, guint, conv_id);
+            if (idx) {
+                conv_item = &g_array_index(ch->conv_array, conv_item_t, idx - 1);
+                if (conv_item->src_port == src_port && conv_item->dst_port == dst_port &&
+                    addresses_equal(&conv_item->src_address, src) &&
+                    addresses_equal(&conv_item->dst_address, dst)) {
+                    is_fwd_direction = TRUE;
+                } else if (!(conv_item->src_port == dst_port && conv_item->dst_port == src_port &&
+                    addresses_equal(&conv_item->src_address, dst) &&
+                    addresses_equal(&conv_item->dst_address, src))) {
+                    /* same id on other addresses; leave it to the hash table */
+                    conv_item = NULL;
+                }
+            }
         }
+
         if (conv_item == NULL) {
-            /* then, check in the rev conversations if not found in 'fwd' */
-            existing_key.addr1 = *dst;
-            existing_key.addr2 = *src;
-            existing_key.port1 = dst_port;
-            existing_key.port2 = src_port;
+            /* one lookup covers both directions */
+            existing_key.addr1 = *src;
+            existing_key.addr2 = *dst;
+            existing_key.port1 = src_port;
+            existing_key.port2 = dst_port;
+            existing_key.conv_id = conv_id;
             if (g_hash_table_lookup_extended(ch->hashtable, &existing_key, NULL, &conversation_idx_hash_val)) {
                 conv_item = &g_array_index(ch->conv_array, conv_item_t, GPOINTER_TO_UINT(conversation_idx_hash_val));
+                is_fwd_direction = conv_item->src_port == src_port && conv_item->dst_port == dst_port &&
+                    addresses_equal(&conv_item->src_address, src) &&
+                    addresses_equal(&conv_item->dst_address, dst);
             }
-        } else {
-            /* a conversation was found in this same fwd direction */
-            is_fwd_direction = TRUE;
         }
     }
 
+    if (ch->approx) {
+        conv_approx_add(ch->approx, conv_approx_hash(src, dst, src_port, dst_port, conv_id),
+                        num_frames, num_bytes, &est_frames, &est_bytes);
+    }
+
     /* if we still don't know what conversation this is it has to be a new one
        and we have to allocate it and append it to the end of the list */
     if (conv_item == NULL) {
-        conv_key_t *new_key;
-        conv_item_t new_conv_item;
-        unsigned int conversation_idx;
-
-        copy_address(&new_conv_item.src_address, src);
-        copy_address(&new_conv_item.dst_address, dst);
-        new_conv_item.dissector_info = ct_info;
-        new_conv_item.etype = etype;
-        new_conv_item.src_port = src_port;
-        new_conv_item.dst_port = dst_port;
-        new_conv_item.conv_id = conv_id;
-        new_conv_item.rx_frames = 0;
-        new_conv_item.tx_frames = 0;
-        new_conv_item.rx_bytes = 0;
-        new_conv_item.tx_bytes = 0;
+        if (ch->approx && ch->conv_array->len >= ch->approx_max_items) {
+            /* The table is full: take over the lightest entry, but only
+               once this conversation is heavier than it. */
+            conversation_idx = ch->approx->heap[0];
+            if (est_frames <= conv_approx_weight(ch, conversation_idx)) {
+                return;
+            }
+            conv_table_unindex_item(ch, conversation_idx);
+            ch->approx->evictions++;
+        } else {
+            conversation_idx = ch->conv_array->len;
+            g_array_set_size(ch->conv_array, conversation_idx + 1);
+        }
+        conv_item = &g_array_index(ch->conv_array, conv_item_t, conversation_idx);
+
+        copy_address(&conv_item->src_address, src);
+        copy_address(&conv_item->dst_address, dst);
+        conv_item->dissector_info = ct_info;
+        conv_item->etype = etype;
+        conv_item->src_port = src_port;
+        conv_item->dst_port = dst_port;
+        conv_item->conv_id = conv_id;
+        conv_item->rx_frames = 0;
+        conv_item->tx_frames = 0;
+        conv_item->rx_bytes = 0;
+        conv_item->tx_bytes = 0;
 
         if (ts) {
-            memcpy(&new_conv_item.start_time, ts, sizeof(new_conv_item.start_time));
-            memcpy(&new_conv_item.stop_time, ts, sizeof(new_conv_item.stop_time));
-            memcpy(&new_conv_item.start_abs_time, abs_ts, sizeof(new_conv_item.start_abs_time));
+            memcpy(&conv_item->start_time, ts, sizeof(conv_item->start_time));
+            memcpy(&conv_item->stop_time, ts, sizeof(conv_item->stop_time));
+            memcpy(&conv_item->start_abs_time, abs_ts, sizeof(conv_item->start_abs_time));
         } else {
-            nstime_set_unset(&new_conv_item.start_abs_time);
-            nstime_set_unset(&new_conv_item.start_time);
-            nstime_set_unset(&new_conv_item.stop_time);
+            nstime_set_unset(&conv_item->start_abs_time);
+            nstime_set_unset(&conv_item->start_time);
+            nstime_set_unset(&conv_item->stop_time);
         }
-        g_array_append_val(ch->conv_array, new_conv_item);
-        conversation_idx = ch->conv_array->len - 1;
-        conv_item = &g_array_index(ch->conv_array, conv_item_t, conversation_idx);
 
-        /* ct->conversations address is not a constant but src/dst_address.data are */
-        new_key = g_new(conv_key_t, 1);
-        set_address(&new_key->addr1, conv_item->src_address.type, conv_item->src_address.len, conv_item->src_address.data);
-        set_address(&new_key->addr2, conv_item->dst_address.type, conv_item->dst_address.len, conv_item->dst_address.data);
-        new_key->port1 = src_port;
-        new_key->port2 = dst_port;
-        new_key->conv_id = conv_id;
-        g_hash_table_insert(ch->hashtable, new_key, GUINT_TO_POINTER(conversation_idx));
+        conv_table_index_item(ch, conversation_idx);
+
+        if (ch->approx) {
+            if (conversation_idx == ch->approx->heap_len) {
+                conv_approx_heap_push(ch, conversation_idx);
+            } else {
+                /* inherit what the sketch saw of this conversation so far */
+                conv_item->tx_frames = est_frames - num_frames;
+                conv_item->tx_bytes = est_bytes - num_bytes;
+            }
+        }
 
         /* update the conversation struct */
         conv_item->tx_frames += num_frames;
@@ -669,6 +985,7 @@ add_conversation_table_data_with_conv_id(
          * update an existing conversation
          * update the conversation struct
          */
+        conversation_idx = (guint)(conv_item - (conv_item_t *)(void *)ch->conv_array->data);
         if (is_fwd_direction) {
             conv_item->tx_frames += num_frames;
             conv_item->tx_bytes += num_bytes;
@@ -678,6 +995,10 @@ add_conversation_table_data_with_conv_id(
         }
     }
 
+    if (ch->approx) {
+        conv_approx_heap_update(ch, conversation_idx);
+    }
+
     if (ts) {
         if (nstime_cmp(ts, &conv_item->stop_time) > 0) {
             memcpy(&conv_item->stop_time, ts, sizeof(conv_item->stop_time));
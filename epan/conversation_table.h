@@ -47,6 +47,8 @@ typedef enum {
     CONV_DIR_ANY_FROM_B
 } conv_direction_e;
 
+struct _conv_approx_t;
+
 /** Conversation hash + value storage
  * Hash table keys are conv_key_t. Hash table values are indexes into conv_array.
  */
@@ -54,8 +56,25 @@ typedef struct _conversation_hash_t {
     GHashTable  *hashtable;       /**< conversations hash table */
     GArray      *conv_array;      /**< array of conversation values */
     void        *user_data;       /**< "GUI" specifics (if necessary) */
+    GArray      *conv_id_index;   /**< conv_array index + 1 by conversation id, for taps passing stream numbers */
+    guint        approx_max_items; /**< if nonzero, keep only this many conversations, see get_conversation_approx_stats() */
+    struct _conv_approx_t *approx; /**< sketches behind approx_max_items */
 } conv_hash_t;
 
+/** Number of conversations kept by default in approximate mode */
+#define CONV_APPROX_DEFAULT_ITEMS 1000
+
+/** Error bounds of a conversation table in approximate mode */
+typedef struct _conv_approx_stats_t {
+    guint64     conversations;      /**< estimated number of distinct conversations */
+    double      conversations_err;  /**< relative standard error of that estimate */
+    guint64     frames;             /**< total frames seen */
+    guint64     bytes;              /**< total bytes seen */
+    guint64     frames_err;         /**< frame counts in conv_array exceed the real ones by at most this */
+    guint64     bytes_err;          /**< byte counts in conv_array exceed the real ones by at most this */
+    double      confidence;         /**< probability that frames_err and bytes_err hold */
+} conv_approx_stats_t;
+
 /** Key for hash lookups */
 typedef struct _conversation_key_t {
     address     addr1;
@@ -305,6 +324,23 @@ add_conversation_table_data_with_conv_id(conv_hash_t *ch, const address *src, co
     guint32 dst_port, conv_id_t conv_id, int num_frames, int num_bytes,
     nstime_t *ts, nstime_t *abs_ts, ct_dissector_info_t *ct_info, endpoint_type etype);
 
+/** Get the error bounds of a table in approximate mode.
+ *
+ * Setting approx_max_items on an empty conv_hash_t limits conv_array to that
+ * many conversations, which are the heaviest ones by frame count (a
+ * space-saving top-K table). Every packet also goes into a Count-Min sketch
+ * and a HyperLogLog counter, so memory stays fixed however many flows the
+ * capture holds. A conversation that displaces a lighter one starts from the
+ * sketch's estimate of its earlier traffic, which is added to its A to B
+ * counts; those counts may therefore be slightly high, by at most the
+ * bounds returned here.
+ *
+ * @param ch the conversation table
+ * @param stats filled in with the estimates and their error bounds
+ * @return FALSE if the table is not in approximate mode or has no data
+ */
+WS_DLL_PUBLIC gboolean get_conversation_approx_stats(conv_hash_t *ch, conv_approx_stats_t *stats);
+
 /** Add some data to the table.
  *
  * @param ch the table hash to add the data to
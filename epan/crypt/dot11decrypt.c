@@ -1057,6 +1057,72 @@ INT Dot11DecryptDecryptPacket(
     return DOT11DECRYPT_RET_UNSUCCESS;
 }
 
+/* PBKDF2 costs 8192 HMAC-SHA1 rounds per passphrase, so with many
+ * passphrases configured they are spread over a few worker threads. */
+#define DOT11DECRYPT_PSK_MAX_THREADS 8
+
+typedef struct {
+    DOT11DECRYPT_KEY_ITEM *keys;
+    size_t keys_nr;
+    size_t first;
+    size_t step;
+} DOT11DECRYPT_PSK_WORK;
+
+static gpointer
+Dot11DecryptDerivePsksWorker(gpointer data)
+{
+    DOT11DECRYPT_PSK_WORK *work = (DOT11DECRYPT_PSK_WORK *)data;
+
+    for (size_t i = work->first; i < work->keys_nr; i += work->step) {
+        DOT11DECRYPT_KEY_ITEM *key = &work->keys[i];
+
+        if (key->KeyType == DOT11DECRYPT_KEY_TYPE_WPA_PWD) {
+            Dot11DecryptRsnaPwd2Psk(key->UserPwd.Passphrase, key->UserPwd.Ssid, key->UserPwd.SsidLen, key->KeyData.Wpa.Psk);
+            key->KeyData.Wpa.PskLen = DOT11DECRYPT_WPA_PWD_PSK_LEN;
+        }
+    }
+    return NULL;
+}
+
+static void
+Dot11DecryptDerivePsks(
+    DOT11DECRYPT_KEY_ITEM keys[],
+    const size_t keys_nr)
+{
+    DOT11DECRYPT_PSK_WORK work[DOT11DECRYPT_PSK_MAX_THREADS];
+    GThread *threads[DOT11DECRYPT_PSK_MAX_THREADS];
+    size_t pwd_nr = 0;
+    size_t threads_nr;
+
+    for (size_t i = 0; i < keys_nr; i++) {
+        if (keys[i].KeyType == DOT11DECRYPT_KEY_TYPE_WPA_PWD) {
+            pwd_nr++;
+        }
+    }
+
+    threads_nr = MIN(pwd_nr, MIN((size_t)g_get_num_processors(), DOT11DECRYPT_PSK_MAX_THREADS));
+    if (threads_nr <= 1) {
+        work[0].keys = keys;
+        work[0].keys_nr = keys_nr;
+        work[0].first = 0;
+        work[0].step = 1;
+        Dot11DecryptDerivePsksWorker(&work[0]);
+        return;
+    }
+
+    /* Every thread owns every threads_nr-th key, no locking needed */
+    for (size_t t = 0; t < threads_nr; t++) {
+        work[t].keys = keys;
+        work[t].keys_nr = keys_nr;
+        work[t].first = t;
+        work[t].step = threads_nr;
+        threads[t] = g_thread_new("dot11decrypt_psk_worker", Dot11DecryptDerivePsksWorker, &work[t]);
+    }
+    for (size_t t = 0; t < threads_nr; t++) {
+        g_thread_join(threads[t]);
+    }
+}
+
 INT Dot11DecryptSetKeys(
     PDOT11DECRYPT_CONTEXT ctx,
     DOT11DECRYPT_KEY_ITEM keys[],
@@ -1081,16 +1147,16 @@ INT Dot11DecryptSetKeys(
     /* check and insert keys */
     for (i=0, success=0; i<(INT)keys_nr; i++) {
         if (Dot11DecryptValidateKey(keys+i)==TRUE) {
-            if (keys[i].KeyType==DOT11DECRYPT_KEY_TYPE_WPA_PWD) {
-                Dot11DecryptRsnaPwd2Psk(keys[i].UserPwd.Passphrase, keys[i].UserPwd.Ssid, keys[i].UserPwd.SsidLen, keys[i].KeyData.Wpa.Psk);
-                keys[i].KeyData.Wpa.PskLen = DOT11DECRYPT_WPA_PWD_PSK_LEN;
-            }
             memcpy(&ctx->keys[success], &keys[i], sizeof(keys[i]));
             success++;
         }
     }
 
     ctx->keys_nr=success;
+
+    /* derive the PSKs of all passphrases up front */
+    Dot11DecryptDerivePsks(ctx->keys, ctx->keys_nr);
+
     return success;
 }
 
@@ -1106,6 +1172,10 @@ Dot11DecryptCleanKeys(
     memset(ctx->keys, 0, sizeof(DOT11DECRYPT_KEY_ITEM) * DOT11DECRYPT_MAX_KEYS_NR);
 
     ctx->keys_nr=0;
+    if (ctx->psk_cache != NULL) {
+        g_hash_table_destroy(ctx->psk_cache);
+        ctx->psk_cache = NULL;
+    }
     ws_debug("Keys collection cleaned!");
 }
 
@@ -1568,6 +1638,56 @@ Dot11DecryptIsPwdWildcardSsid(const PDOT11DECRYPT_CONTEXT ctx,
     return FALSE;
 }
 
+typedef struct {
+    const DOT11DECRYPT_KEY_ITEM *key;
+    size_t ssid_len;
+    CHAR ssid[DOT11DECRYPT_WPA_SSID_MAX_LEN];
+} DOT11DECRYPT_PSK_CACHE_ID;
+
+static guint
+Dot11DecryptPskCacheHash(gconstpointer key)
+{
+    GBytes *bytes = g_bytes_new_static(key, sizeof(DOT11DECRYPT_PSK_CACHE_ID));
+    guint hash = g_bytes_hash(bytes);
+    g_bytes_unref(bytes);
+    return hash;
+}
+
+static gboolean
+Dot11DecryptIsPskCacheIdEqual(gconstpointer key1, gconstpointer key2)
+{
+    return memcmp(key1, key2, sizeof(DOT11DECRYPT_PSK_CACHE_ID)) == 0;
+}
+
+/* Get the PSK of a wildcard SSID passphrase for the SSID in the packet,
+ * running PBKDF2 only the first time the pair is seen. */
+static void
+Dot11DecryptGetWildcardPsk(
+    PDOT11DECRYPT_CONTEXT ctx,
+    const DOT11DECRYPT_KEY_ITEM *key_item,
+    UCHAR *psk)
+{
+    DOT11DECRYPT_PSK_CACHE_ID id;
+    UCHAR *cached;
+
+    memset(&id, 0, sizeof(id));
+    id.key = key_item;
+    id.ssid_len = ctx->pkt_ssid_len;
+    memcpy(id.ssid, ctx->pkt_ssid, ctx->pkt_ssid_len);
+
+    if (ctx->psk_cache == NULL) {
+        ctx->psk_cache = g_hash_table_new_full(Dot11DecryptPskCacheHash, Dot11DecryptIsPskCacheIdEqual,
+                                               g_free, g_free);
+    }
+    cached = (UCHAR *)g_hash_table_lookup(ctx->psk_cache, &id);
+    if (cached == NULL) {
+        cached = (UCHAR *)g_malloc(DOT11DECRYPT_WPA_PWD_PSK_LEN);
+        Dot11DecryptRsnaPwd2Psk(key_item->UserPwd.Passphrase, id.ssid, id.ssid_len, cached);
+        g_hash_table_insert(ctx->psk_cache, g_memdup2(&id, sizeof(id)), cached);
+    }
+    memcpy(psk, cached, DOT11DECRYPT_WPA_PWD_PSK_LEN);
+}
+
 /* Refer to IEEE 802.11i-2004, 8.5.3, pag. 85 */
 static INT
 Dot11DecryptRsna4WHandshake(
@@ -1619,12 +1739,17 @@ Dot11DecryptRsna4WHandshake(
         sa = Dot11DecryptGetSa(ctx, id);
         if (sa == NULL || sa->handshake >= 2) {
             /* Either no SA exists or one exists but we're reauthenticating */
+            DOT11DECRYPT_KEY_ITEM *prev_key = sa ? sa->key : NULL;
+
             sa = Dot11DecryptNewSa(id);
             if (sa == NULL) {
                 ws_warning("Failed to alloc broadcast sa");
                 return DOT11DECRYPT_RET_NO_VALID_HANDSHAKE;
             }
             sa = Dot11DecryptAddSa(ctx, id, sa);
+            /* A reauthenticating STA almost always uses the same key again,
+             * so try that one first instead of every configured key */
+            sa->key = prev_key;
         }
         memcpy(sa->wpa.nonce, eapol_parsed->nonce, 32);
 
@@ -1688,8 +1813,7 @@ Dot11DecryptRsna4WHandshake(
                 memcpy(&pkt_key, tmp_key, sizeof(pkt_key));
                 memcpy(&pkt_key.UserPwd.Ssid, ctx->pkt_ssid, ctx->pkt_ssid_len);
                 pkt_key.UserPwd.SsidLen = ctx->pkt_ssid_len;
-                Dot11DecryptRsnaPwd2Psk(pkt_key.UserPwd.Passphrase, pkt_key.UserPwd.Ssid,
-                    pkt_key.UserPwd.SsidLen, pkt_key.KeyData.Wpa.Psk);
+                Dot11DecryptGetWildcardPsk(ctx, tmp_key, pkt_key.KeyData.Wpa.Psk);
                 tmp_pkt_key = &pkt_key;
             } else {
                 tmp_pkt_key = tmp_key;
@@ -1899,8 +2023,7 @@ Dot11DecryptScanFtAssocForKeys(
             memcpy(&pkt_key, tmp_key, sizeof(pkt_key));
             memcpy(&pkt_key.UserPwd.Ssid, ctx->pkt_ssid, ctx->pkt_ssid_len);
             pkt_key.UserPwd.SsidLen = ctx->pkt_ssid_len;
-            Dot11DecryptRsnaPwd2Psk(pkt_key.UserPwd.Passphrase, pkt_key.UserPwd.Ssid,
-                pkt_key.UserPwd.SsidLen, pkt_key.KeyData.Wpa.Psk);
+            Dot11DecryptGetWildcardPsk(ctx, tmp_key, pkt_key.KeyData.Wpa.Psk);
             tmp_pkt_key = &pkt_key;
         } else {
             tmp_pkt_key = tmp_key;
@@ -2679,6 +2802,7 @@ Dot11DecryptRsnaPwd2PskStep(
     UCHAR *output)
 {
     UCHAR digest[MAX_SSID_LENGTH+4] = { 0 };  /* SSID plus 4 bytes of count */
+    gcry_md_hd_t hmac_handle;
     INT i, j;
 
     if (ssidLength > MAX_SSID_LENGTH) {
@@ -2686,23 +2810,32 @@ Dot11DecryptRsnaPwd2PskStep(
         return DOT11DECRYPT_RET_UNSUCCESS;
     }
 
+    /* The key is the same for every round; gcry_md_reset() keeps it, so
+     * set it up once rather than opening a new HMAC for each of them */
+    if (gcry_md_open(&hmac_handle, GCRY_MD_SHA1, GCRY_MD_FLAG_HMAC)) {
+        return DOT11DECRYPT_RET_UNSUCCESS;
+    }
+    if (gcry_md_setkey(hmac_handle, ppBytes, ppLength)) {
+        gcry_md_close(hmac_handle);
+        return DOT11DECRYPT_RET_UNSUCCESS;
+    }
+
     /* U1 = PRF(P, S || INT(i)) */
     memcpy(digest, ssid, ssidLength);
     digest[ssidLength] = (UCHAR)((count>>24) & 0xff);
     digest[ssidLength+1] = (UCHAR)((count>>16) & 0xff);
     digest[ssidLength+2] = (UCHAR)((count>>8) & 0xff);
     digest[ssidLength+3] = (UCHAR)(count & 0xff);
-    if (ws_hmac_buffer(GCRY_MD_SHA1, digest, digest, (guint32) ssidLength + 4, ppBytes, ppLength)) {
-      return DOT11DECRYPT_RET_UNSUCCESS;
-    }
+    gcry_md_write(hmac_handle, digest, ssidLength + 4);
+    memcpy(digest, gcry_md_read(hmac_handle, 0), HASH_SHA1_LENGTH);
 
     /* output = U1 */
     memcpy(output, digest, 20);
     for (i = 1; i < iterations; i++) {
         /* Un = PRF(P, Un-1) */
-        if (ws_hmac_buffer(GCRY_MD_SHA1, digest, digest, HASH_SHA1_LENGTH, ppBytes, ppLength)) {
-          return DOT11DECRYPT_RET_UNSUCCESS;
-        }
+        gcry_md_reset(hmac_handle);
+        gcry_md_write(hmac_handle, digest, HASH_SHA1_LENGTH);
+        memcpy(digest, gcry_md_read(hmac_handle, 0), HASH_SHA1_LENGTH);
 
         /* output = output xor Un */
         for (j = 0; j < 20; j++) {
@@ -2710,6 +2843,7 @@ Dot11DecryptRsnaPwd2PskStep(
         }
     }
 
+    gcry_md_close(hmac_handle);
     return DOT11DECRYPT_RET_SUCCESS;
 }
 
@@ -25,11 +25,19 @@ struct epan_dfilter {
 	GList		**registers;
 	gboolean	*attempted_load;
 	gboolean	*owns_memory;
+	gboolean	*shared_load;
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
 };
 
+/* Filters applied together to the same tree. Field values read from the
+ * tree by one filter are kept in field_cache and reused by the others. */
+struct epan_dfilter_set {
+	GPtrArray	*filters;
+	GHashTable	*field_cache;
+};
+
 typedef struct {
 	/* Syntax Tree stuff */
 	stnode_t	*st_root;
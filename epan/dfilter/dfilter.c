@@ -41,6 +41,15 @@ static void*	ParserObj = NULL;
  */
 dfwork_t *global_dfw;
 
+/* Whether dfw_optimize() runs on compiled filters */
+static gboolean optimize = TRUE;
+
+void
+dfilter_set_optimize(gboolean enable)
+{
+	optimize = enable;
+}
+
 void
 dfilter_vfail(dfwork_t *dfw, const char *format, va_list args)
 {
@@ -209,6 +218,7 @@ dfilter_free(dfilter_t *df)
 	g_free(df->registers);
 	g_free(df->attempted_load);
 	g_free(df->owns_memory);
+	g_free(df->shared_load);
 	g_free(df);
 }
 
@@ -444,6 +454,11 @@ dfilter_compile_real(const gchar *text, dfilter_t **dfp,
 
 		log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree after successful semantic check");
 
+		if (optimize) {
+			dfw_optimize(dfw);
+			log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree after optimization");
+		}
+
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
@@ -462,6 +477,7 @@ dfilter_compile_real(const gchar *text, dfilter_t **dfp,
 		dfilter->registers = g_new0(GList*, dfilter->max_registers);
 		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
 		dfilter->owns_memory = g_new0(gboolean, dfilter->max_registers);
+		dfilter->shared_load = g_new0(gboolean, dfilter->max_registers);
 
 		/* Initialize constants */
 		dfvm_init_const(dfilter);
@@ -506,13 +522,76 @@ FAILURE:
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
 {
-	return dfvm_apply(df, tree);
+	return dfvm_apply(df, tree, NULL);
 }
 
 gboolean
 dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 {
-	return dfvm_apply(df, edt->tree);
+	/* Share the fields read from the tree with the other filters applied
+	 * to this dissection (display and read filters, tap filters...).
+	 * The cache is emptied when the dissection is reset. */
+	if (edt->dfilter_field_cache == NULL) {
+		edt->dfilter_field_cache = g_hash_table_new_full(g_direct_hash,
+				g_direct_equal, NULL, (GDestroyNotify)g_list_free);
+	}
+	return dfvm_apply(df, edt->tree, edt->dfilter_field_cache);
+}
+
+dfilter_set_t *
+dfilter_set_new(void)
+{
+	dfilter_set_t	*set;
+
+	set = g_new(dfilter_set_t, 1);
+	set->filters = g_ptr_array_new();
+	set->field_cache = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, (GDestroyNotify)g_list_free);
+	return set;
+}
+
+void
+dfilter_set_free(dfilter_set_t *set)
+{
+	if (!set)
+		return;
+
+	g_ptr_array_free(set->filters, TRUE);
+	g_hash_table_destroy(set->field_cache);
+	g_free(set);
+}
+
+void
+dfilter_set_clear(dfilter_set_t *set)
+{
+	g_ptr_array_set_size(set->filters, 0);
+}
+
+guint
+dfilter_set_add(dfilter_set_t *set, dfilter_t *df)
+{
+	g_ptr_array_add(set->filters, df);
+	return set->filters->len - 1;
+}
+
+int
+dfilter_set_apply_first_edt(dfilter_set_t *set, epan_dissect_t *edt)
+{
+	dfilter_t	*df;
+	guint		i;
+	int		match = -1;
+
+	for (i = 0; i < set->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, i);
+		if (df && dfvm_apply(df, edt->tree, set->field_cache)) {
+			match = (int)i;
+			break;
+		}
+	}
+
+	/* The cached values point into this tree; drop them. */
+	g_hash_table_remove_all(set->field_cache);
+	return match;
 }
 
 
@@ -532,6 +611,33 @@ dfilter_has_interesting_fields(const dfilter_t *df)
 	return (df->num_interesting_fields > 0);
 }
 
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *count)
+{
+	*count = df->num_interesting_fields;
+	return df->interesting_fields;
+}
+
+gboolean
+dfilter_reads_field_value(const dfilter_t *df, int hfid)
+{
+	guint i;
+
+	for (i = 0; i < df->insns->len; i++) {
+		dfvm_insn_t *insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+		header_field_info *hfinfo;
+
+		if (insn->op != READ_TREE)
+			continue;
+
+		for (hfinfo = insn->arg1->value.hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+			if (hfinfo->id == hfid)
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -54,13 +54,22 @@ dfilter_compile_real(const gchar *text, dfilter_t **dfp,
 #define dfilter_compile(text, dfp, err_msg) \
 	dfilter_compile_real(text, dfp, err_msg, __func__)
 
+/* Enables or disables the syntax tree optimizations done when compiling
+ * a filter (on by default). Only useful to compare the generated code. */
+WS_DLL_PUBLIC
+void
+dfilter_set_optimize(gboolean enable);
+
 /* Frees all memory used by dfilter, and frees
  * the dfilter itself. */
 WS_DLL_PUBLIC
 void
 dfilter_free(dfilter_t *df);
 
-/* Apply compiled dfilter */
+/* Apply compiled dfilter. The field values read from the tree are kept
+ * in the epan_dissect_t and reused by the next filters applied to it,
+ * until it is reset, so this must only be called once the dissection
+ * is complete. */
 WS_DLL_PUBLIC
 gboolean
 dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
@@ -69,6 +78,37 @@ dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/* A list of compiled dfilters that are applied to the same tree one after
+ * the other, e.g. the coloring rules. Values of fields used by several
+ * filters are read from the tree only once. The set does not own the
+ * filters. */
+typedef struct epan_dfilter_set dfilter_set_t;
+
+WS_DLL_PUBLIC
+dfilter_set_t *
+dfilter_set_new(void);
+
+WS_DLL_PUBLIC
+void
+dfilter_set_free(dfilter_set_t *set);
+
+/* Removes all the filters from the set. */
+WS_DLL_PUBLIC
+void
+dfilter_set_clear(dfilter_set_t *set);
+
+/* Appends a filter to the set and returns its index. A NULL filter never
+ * matches, which lets the indices follow the caller's own list. */
+WS_DLL_PUBLIC
+guint
+dfilter_set_add(dfilter_set_t *set, dfilter_t *df);
+
+/* Applies the filters in order and returns the index of the first one
+ * that matches, or -1 if none does. */
+WS_DLL_PUBLIC
+int
+dfilter_set_apply_first_edt(dfilter_set_t *set, struct epan_dissect *edt);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
@@ -77,6 +117,18 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 gboolean
 dfilter_has_interesting_fields(const dfilter_t *df);
 
+/* Returns the ids of the fields and protocols looked at by the dfilter,
+ * *count is set to their number. The array belongs to the dfilter. */
+WS_DLL_PUBLIC
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *count);
+
+/* Check if dfilter reads the value of a field or protocol, rather than
+ * only testing whether it is present. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_reads_field_value(const dfilter_t *df, int hfid);
+
 WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
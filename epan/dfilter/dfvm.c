@@ -8,6 +8,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "dfvm.h"
 
 #include <ftypes/ftypes.h>
@@ -40,6 +42,12 @@ dfvm_value_free(dfvm_value_t *v)
 		case PCRE:
 			ws_regex_free(v->value.pcre);
 			break;
+		case FVALUE_SET:
+			dfvm_fvalue_set_free(v->value.fvalue_set);
+			break;
+		case PATTERN_SET:
+			dfvm_pattern_set_free(v->value.pattern_set);
+			break;
 		default:
 			/* nothing */
 			;
@@ -76,6 +84,365 @@ dfvm_value_new(dfvm_value_type_t type)
 	return v;
 }
 
+dfvm_fvalue_set_t*
+dfvm_fvalue_set_new(void)
+{
+	dfvm_fvalue_set_t	*set;
+
+	set = g_new(dfvm_fvalue_set_t, 1);
+	set->intervals = g_array_new(FALSE, FALSE, sizeof(dfvm_interval_t));
+	set->fvalues = g_ptr_array_new_with_free_func((GDestroyNotify)fvalue_free);
+	return set;
+}
+
+void
+dfvm_fvalue_set_free(dfvm_fvalue_set_t *set)
+{
+	g_array_free(set->intervals, TRUE);
+	g_ptr_array_free(set->fvalues, TRUE);
+	g_free(set);
+}
+
+/* Adds a single value (upper == NULL) or an inclusive range to the set.
+ * The set takes ownership of the fvalues. */
+void
+dfvm_fvalue_set_add(dfvm_fvalue_set_t *set, fvalue_t *lower, fvalue_t *upper)
+{
+	dfvm_interval_t	interval;
+
+	g_ptr_array_add(set->fvalues, lower);
+	if (upper) {
+		g_ptr_array_add(set->fvalues, upper);
+		/* An empty range can never match. */
+		if (fvalue_gt(lower, upper))
+			return;
+	}
+	interval.lower = lower;
+	interval.upper = upper;
+	g_array_append_val(set->intervals, interval);
+}
+
+static gint
+compare_interval_lower(gconstpointer a, gconstpointer b)
+{
+	const dfvm_interval_t *ia = (const dfvm_interval_t *)a;
+	const dfvm_interval_t *ib = (const dfvm_interval_t *)b;
+
+	if (fvalue_lt(ia->lower, ib->lower))
+		return -1;
+	if (fvalue_gt(ia->lower, ib->lower))
+		return 1;
+	return 0;
+}
+
+/* Sorts the intervals and merges the ones that overlap, so that
+ * dfvm_fvalue_set_contains() can use a binary search. Must be called
+ * after the last dfvm_fvalue_set_add(). */
+void
+dfvm_fvalue_set_seal(dfvm_fvalue_set_t *set)
+{
+	GArray		*merged;
+	dfvm_interval_t	*cur, *last;
+	fvalue_t	*cur_upper, *last_upper;
+	guint		i;
+
+	g_array_sort(set->intervals, compare_interval_lower);
+
+	merged = g_array_sized_new(FALSE, FALSE, sizeof(dfvm_interval_t),
+			set->intervals->len);
+	for (i = 0; i < set->intervals->len; i++) {
+		cur = &g_array_index(set->intervals, dfvm_interval_t, i);
+		cur_upper = cur->upper ? cur->upper : cur->lower;
+
+		if (merged->len > 0) {
+			last = &g_array_index(merged, dfvm_interval_t, merged->len - 1);
+			last_upper = last->upper ? last->upper : last->lower;
+			if (fvalue_le(cur->lower, last_upper)) {
+				/* Overlaps the previous interval; extend it. */
+				if (fvalue_gt(cur_upper, last_upper))
+					last->upper = cur_upper;
+				continue;
+			}
+		}
+		g_array_append_val(merged, *cur);
+	}
+
+	g_array_free(set->intervals, TRUE);
+	set->intervals = merged;
+}
+
+gboolean
+dfvm_fvalue_set_contains(const dfvm_fvalue_set_t *set, const fvalue_t *fv)
+{
+	const dfvm_interval_t	*interval;
+	guint			low = 0, high = set->intervals->len, mid;
+
+	/* Find the last interval whose lower bound is <= fv. */
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		interval = &g_array_index(set->intervals, dfvm_interval_t, mid);
+		if (fvalue_le(interval->lower, fv))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == 0)
+		return FALSE;
+
+	interval = &g_array_index(set->intervals, dfvm_interval_t, low - 1);
+	return fvalue_le(fv, interval->upper ? interval->upper : interval->lower);
+}
+
+/* A state of the automaton. Its edges are edges[first_edge] up to
+ * edges[first_edge + num_edges - 1], sorted by byte. */
+typedef struct {
+	guint32		fail;
+	guint32		first_edge;
+	guint32		num_edges;
+	gboolean	match;		/* some pattern ends here */
+} dfvm_ac_state_t;
+
+typedef struct {
+	guint8		byte;
+	guint32		next;
+} dfvm_ac_edge_t;
+
+/* Returns TRUE if "contains" tests on values of this type can use a
+ * dfvm_pattern_set_t, setting is_string to the kind of patterns used. */
+gboolean
+dfvm_pattern_type(enum ftenum ftype, gboolean *is_string)
+{
+	switch (ftype) {
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+			*is_string = TRUE;
+			return TRUE;
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+			*is_string = FALSE;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/* The bytes searched in, or searched for; FALSE if fv isn't of the
+ * kind of the set's patterns. */
+static gboolean
+pattern_get_data(const dfvm_pattern_set_t *set, const fvalue_t *fv,
+		const guint8 **data, gsize *len)
+{
+	gboolean	is_string;
+
+	if (!dfvm_pattern_type(fvalue_type_ftenum((fvalue_t *)fv), &is_string) ||
+			is_string != set->is_string)
+		return FALSE;
+
+	if (is_string) {
+		*data = (const guint8 *)(fv->value.string ? fv->value.string : "");
+		*len = strlen((const char *)*data);
+	}
+	else {
+		*data = fv->value.bytes->data;
+		*len = fv->value.bytes->len;
+	}
+	return TRUE;
+}
+
+dfvm_pattern_set_t*
+dfvm_pattern_set_new(gboolean is_string)
+{
+	dfvm_pattern_set_t	*set;
+
+	set = g_new0(dfvm_pattern_set_t, 1);
+	set->fvalues = g_ptr_array_new_with_free_func((GDestroyNotify)fvalue_free);
+	set->is_string = is_string;
+	set->states = g_array_new(FALSE, FALSE, sizeof(dfvm_ac_state_t));
+	set->edges = g_array_new(FALSE, FALSE, sizeof(dfvm_ac_edge_t));
+	return set;
+}
+
+void
+dfvm_pattern_set_free(dfvm_pattern_set_t *set)
+{
+	g_ptr_array_free(set->fvalues, TRUE);
+	g_array_free(set->states, TRUE);
+	g_array_free(set->edges, TRUE);
+	g_free(set);
+}
+
+/* Adds a pattern of the kind given to dfvm_pattern_set_new(). The set
+ * takes ownership of the fvalue. */
+void
+dfvm_pattern_set_add(dfvm_pattern_set_t *set, fvalue_t *pattern)
+{
+	g_ptr_array_add(set->fvalues, pattern);
+}
+
+/* The state reached from state on byte, or 0 if there is no edge. Only
+ * the root has edges back to the root, so 0 is never a real target. */
+static guint32
+ac_next(const dfvm_pattern_set_t *set, guint32 state, guint8 byte)
+{
+	const dfvm_ac_state_t	*s;
+	const dfvm_ac_edge_t	*edge;
+	guint32			low, high, mid;
+
+	if (state == 0)
+		return set->root_next[byte];
+
+	s = &g_array_index(set->states, dfvm_ac_state_t, state);
+	low = s->first_edge;
+	high = s->first_edge + s->num_edges;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		edge = &g_array_index(set->edges, dfvm_ac_edge_t, mid);
+		if (edge->byte == byte)
+			return edge->next;
+		if (edge->byte < byte)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return 0;
+}
+
+static gint
+compare_edge_byte(gconstpointer a, gconstpointer b)
+{
+	return (gint)((const dfvm_ac_edge_t *)a)->byte -
+		(gint)((const dfvm_ac_edge_t *)b)->byte;
+}
+
+/* Builds the automaton. Must be called after the last
+ * dfvm_pattern_set_add(). */
+void
+dfvm_pattern_set_seal(dfvm_pattern_set_t *set)
+{
+	GPtrArray	*trie;		/* a GArray of edges for each state */
+	GArray		*trie_edges;
+	dfvm_ac_state_t	state, *s, *child;
+	dfvm_ac_edge_t	edge, *e;
+	GQueue		queue = G_QUEUE_INIT;
+	const guint8	*data;
+	gsize		len, i;
+	guint32		cur, next, fail, n;
+	guint		p, j;
+
+	/* Build the trie of the patterns. */
+	trie = g_ptr_array_new_with_free_func((GDestroyNotify)g_array_unref);
+	memset(&state, 0, sizeof(state));
+	g_ptr_array_add(trie, g_array_new(FALSE, FALSE, sizeof(dfvm_ac_edge_t)));
+	g_array_append_val(set->states, state);
+
+	for (p = 0; p < set->fvalues->len; p++) {
+		if (!pattern_get_data(set, (fvalue_t *)g_ptr_array_index(set->fvalues, p),
+					&data, &len))
+			ws_assert_not_reached();
+		if (len == 0) {
+			/* A string never "contains" the empty string, but
+			 * every byte string contains the empty one. */
+			if (!set->is_string)
+				set->match_empty = TRUE;
+			continue;
+		}
+		cur = 0;
+		for (i = 0; i < len; i++) {
+			trie_edges = (GArray *)g_ptr_array_index(trie, cur);
+			next = 0;
+			for (j = 0; j < trie_edges->len; j++) {
+				e = &g_array_index(trie_edges, dfvm_ac_edge_t, j);
+				if (e->byte == data[i]) {
+					next = e->next;
+					break;
+				}
+			}
+			if (next == 0) {
+				next = set->states->len;
+				edge.byte = data[i];
+				edge.next = next;
+				g_array_append_val(trie_edges, edge);
+				g_ptr_array_add(trie, g_array_new(FALSE, FALSE, sizeof(dfvm_ac_edge_t)));
+				g_array_append_val(set->states, state);
+			}
+			cur = next;
+		}
+		g_array_index(set->states, dfvm_ac_state_t, cur).match = TRUE;
+	}
+
+	/* Lay the edges out state by state. */
+	for (n = 0; n < set->states->len; n++) {
+		trie_edges = (GArray *)g_ptr_array_index(trie, n);
+		g_array_sort(trie_edges, compare_edge_byte);
+		s = &g_array_index(set->states, dfvm_ac_state_t, n);
+		s->first_edge = set->edges->len;
+		s->num_edges = trie_edges->len;
+		g_array_append_vals(set->edges, trie_edges->data, trie_edges->len);
+	}
+	trie_edges = (GArray *)g_ptr_array_index(trie, 0);
+	for (j = 0; j < trie_edges->len; j++) {
+		e = &g_array_index(trie_edges, dfvm_ac_edge_t, j);
+		set->root_next[e->byte] = e->next;
+		g_queue_push_tail(&queue, GUINT_TO_POINTER(e->next));
+	}
+	g_ptr_array_free(trie, TRUE);
+
+	/* Set the failure links breadth first, so that those of shorter
+	 * prefixes are known when needed. The children of the root fail
+	 * back to it, which they already do. */
+	while (!g_queue_is_empty(&queue)) {
+		cur = GPOINTER_TO_UINT(g_queue_pop_head(&queue));
+		s = &g_array_index(set->states, dfvm_ac_state_t, cur);
+		for (n = s->first_edge; n < s->first_edge + s->num_edges; n++) {
+			e = &g_array_index(set->edges, dfvm_ac_edge_t, n);
+			child = &g_array_index(set->states, dfvm_ac_state_t, e->next);
+			if (cur != 0) {
+				fail = s->fail;
+				while (fail != 0 && ac_next(set, fail, e->byte) == 0)
+					fail = g_array_index(set->states, dfvm_ac_state_t, fail).fail;
+				child->fail = ac_next(set, fail, e->byte);
+				if (g_array_index(set->states, dfvm_ac_state_t, child->fail).match)
+					child->match = TRUE;
+			}
+			g_queue_push_tail(&queue, GUINT_TO_POINTER(e->next));
+		}
+	}
+}
+
+gboolean
+dfvm_pattern_set_matches(const dfvm_pattern_set_t *set, const fvalue_t *fv)
+{
+	const guint8	*data;
+	gsize		len, i;
+	guint32		state = 0, next;
+	guint		p;
+
+	if (!pattern_get_data(set, fv, &data, &len)) {
+		/* A field of the same name but another type; test the
+		 * patterns one by one, as separate tests would. */
+		for (p = 0; p < set->fvalues->len; p++) {
+			if (fvalue_contains(fv, (fvalue_t *)g_ptr_array_index(set->fvalues, p)))
+				return TRUE;
+		}
+		return FALSE;
+	}
+
+	if (set->match_empty)
+		return TRUE;
+
+	for (i = 0; i < len; i++) {
+		while ((next = ac_next(set, state, data[i])) == 0 && state != 0)
+			state = g_array_index(set->states, dfvm_ac_state_t, state).fail;
+		state = next;
+		if (g_array_index(set->states, dfvm_ac_state_t, state).match)
+			return TRUE;
+	}
+	return FALSE;
+}
+
 
 void
 dfvm_dump(FILE *f, dfilter_t *df)
@@ -131,6 +498,8 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_IN_SET:
+			case ANY_CONTAINS_ANY:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -286,6 +655,18 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					arg3->value.numeric);
 				break;
 
+			case ANY_IN_SET:
+				fprintf(f, "%05d ANY_IN_SET\treg#%u in set of %u intervals\n",
+					id, arg1->value.numeric,
+					arg2->value.fvalue_set->intervals->len);
+				break;
+
+			case ANY_CONTAINS_ANY:
+				fprintf(f, "%05d ANY_CONTAINS_ANY\treg#%u contains any of %u patterns\n",
+					id, arg1->value.numeric,
+					arg2->value.pattern_set->fvalues->len);
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -312,15 +693,19 @@ dfvm_dump(FILE *f, dfilter_t *df)
 }
 
 /* Reads a field from the proto_tree and loads the fvalues into a register,
- * if that field has not already been read. */
+ * if that field has not already been read. If a field cache is given, the
+ * lists of fvalues are shared with the other filters using that cache. */
 static gboolean
-read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
+read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg,
+		GHashTable *field_cache)
 {
 	GPtrArray	*finfos;
 	field_info	*finfo;
 	int		i, len;
 	GList		*fvalues = NULL;
 	gboolean	found_something = FALSE;
+	gpointer	cached;
+	header_field_info *first_hfinfo = hfinfo;
 
 	/* Already loaded in this run of the dfilter? */
 	if (df->attempted_load[reg]) {
@@ -334,6 +719,15 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 
 	df->attempted_load[reg] = TRUE;
 
+	/* Already loaded by another filter applied to this tree? */
+	if (field_cache &&
+			g_hash_table_lookup_extended(field_cache, first_hfinfo, NULL, &cached)) {
+		df->registers[reg] = (GList *)cached;
+		df->owns_memory[reg] = FALSE;
+		df->shared_load[reg] = TRUE;
+		return cached != NULL;
+	}
+
 	while (hfinfo) {
 		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
 		if ((finfos == NULL) || (g_ptr_array_len(finfos) == 0)) {
@@ -353,6 +747,12 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 		hfinfo = hfinfo->same_name_next;
 	}
 
+	if (field_cache) {
+		/* The cache owns the list, including the "not found" result. */
+		g_hash_table_insert(field_cache, first_hfinfo, fvalues);
+		df->shared_load[reg] = TRUE;
+	}
+
 	if (!found_something) {
 		return FALSE;
 	}
@@ -512,6 +912,38 @@ any_in_range(dfilter_t *df, int reg1, int reg2, int reg3)
 	return FALSE;
 }
 
+static gboolean
+any_in_set(dfilter_t *df, int reg1, const dfvm_fvalue_set_t *set)
+{
+	GList	*list1;
+
+	list1 = df->registers[reg1];
+
+	while (list1) {
+		if (dfvm_fvalue_set_contains(set, (fvalue_t *)list1->data)) {
+			return TRUE;
+		}
+		list1 = g_list_next(list1);
+	}
+	return FALSE;
+}
+
+static gboolean
+any_contains_any(dfilter_t *df, int reg1, const dfvm_pattern_set_t *set)
+{
+	GList	*list1;
+
+	list1 = df->registers[reg1];
+
+	while (list1) {
+		if (dfvm_pattern_set_matches(set, (fvalue_t *)list1->data)) {
+			return TRUE;
+		}
+		list1 = g_list_next(list1);
+	}
+	return FALSE;
+}
+
 
 static void
 free_owned_register(gpointer data, gpointer user_data _U_)
@@ -529,6 +961,12 @@ free_register_overhead(dfilter_t* df)
 
 	for (i = 0; i < df->num_registers; i++) {
 		df->attempted_load[i] = FALSE;
+		if (df->shared_load[i]) {
+			/* The list belongs to the field cache. */
+			df->shared_load[i] = FALSE;
+			df->registers[i] = NULL;
+			continue;
+		}
 		if (df->registers[i]) {
 			if (df->owns_memory[i]) {
 				g_list_foreach(df->registers[i], free_owned_register, NULL);
@@ -571,7 +1009,7 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 
 
 gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+dfvm_apply(dfilter_t *df, proto_tree *tree, GHashTable *field_cache)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -612,7 +1050,8 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 
 			case READ_TREE:
 				accum = read_tree(df, tree,
-						arg1->value.hfinfo, arg2->value.numeric);
+						arg1->value.hfinfo, arg2->value.numeric,
+						field_cache);
 				break;
 
 			case CALL_FUNCTION:
@@ -697,6 +1136,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg3->value.numeric);
 				break;
 
+			case ANY_IN_SET:
+				accum = any_in_set(df, arg1->value.numeric,
+						arg2->value.fvalue_set);
+				break;
+
+			case ANY_CONTAINS_ANY:
+				accum = any_contains_any(df, arg1->value.numeric,
+						arg2->value.pattern_set);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -786,6 +1235,8 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_IN_SET:
+			case ANY_CONTAINS_ANY:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -26,9 +26,36 @@ typedef enum {
 	INTEGER,
 	DRANGE,
 	FUNCTION_DEF,
-	PCRE
+	PCRE,
+	FVALUE_SET,
+	PATTERN_SET
 } dfvm_value_type_t;
 
+/* One element of a constant set. Single values have upper == NULL. */
+typedef struct {
+	fvalue_t	*lower;
+	fvalue_t	*upper;
+} dfvm_interval_t;
+
+/* Constant set used by "in" membership tests. The intervals are sorted
+ * and disjoint so that lookups can use a binary search. */
+typedef struct {
+	GArray		*intervals;	/* of dfvm_interval_t */
+	GPtrArray	*fvalues;	/* owns every fvalue referenced above */
+} dfvm_fvalue_set_t;
+
+/* Constant substrings used by an OR-ed series of "contains" tests on the
+ * same field. The patterns are compiled into an Aho-Corasick automaton so
+ * that each value of the field is scanned once, however many there are. */
+typedef struct {
+	GPtrArray	*fvalues;	/* the patterns, in the order added */
+	gboolean	is_string;	/* string patterns, else byte patterns */
+	gboolean	match_empty;	/* an empty byte pattern matches anything */
+	GArray		*states;	/* of dfvm_ac_state_t; state 0 is the root */
+	GArray		*edges;		/* of dfvm_ac_edge_t, grouped by state */
+	guint32		root_next[256];	/* transitions out of the root */
+} dfvm_pattern_set_t;
+
 typedef struct {
 	dfvm_value_type_t	type;
 
@@ -39,6 +66,8 @@ typedef struct {
 		header_field_info	*hfinfo;
 		df_func_def_t		*funcdef;
 		ws_regex_t		*pcre;
+		dfvm_fvalue_set_t	*fvalue_set;
+		dfvm_pattern_set_t	*pattern_set;
 	} value;
 
 } dfvm_value_t;
@@ -67,7 +96,9 @@ typedef enum {
 	ANY_MATCHES,
 	MK_RANGE,
 	CALL_FUNCTION,
-	ANY_IN_RANGE
+	ANY_IN_RANGE,
+	ANY_IN_SET,
+	ANY_CONTAINS_ANY
 
 } dfvm_opcode_t;
 
@@ -89,11 +120,44 @@ dfvm_insn_free(dfvm_insn_t *insn);
 dfvm_value_t*
 dfvm_value_new(dfvm_value_type_t type);
 
+dfvm_fvalue_set_t*
+dfvm_fvalue_set_new(void);
+
+void
+dfvm_fvalue_set_free(dfvm_fvalue_set_t *set);
+
+void
+dfvm_fvalue_set_add(dfvm_fvalue_set_t *set, fvalue_t *lower, fvalue_t *upper);
+
+void
+dfvm_fvalue_set_seal(dfvm_fvalue_set_t *set);
+
+gboolean
+dfvm_fvalue_set_contains(const dfvm_fvalue_set_t *set, const fvalue_t *fv);
+
+gboolean
+dfvm_pattern_type(enum ftenum ftype, gboolean *is_string);
+
+dfvm_pattern_set_t*
+dfvm_pattern_set_new(gboolean is_string);
+
+void
+dfvm_pattern_set_free(dfvm_pattern_set_t *set);
+
+void
+dfvm_pattern_set_add(dfvm_pattern_set_t *set, fvalue_t *pattern);
+
+void
+dfvm_pattern_set_seal(dfvm_pattern_set_t *set);
+
+gboolean
+dfvm_pattern_set_matches(const dfvm_pattern_set_t *set, const fvalue_t *fv);
+
 void
 dfvm_dump(FILE *f, dfilter_t *df);
 
 gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree);
+dfvm_apply(dfilter_t *df, proto_tree *tree, GHashTable *field_cache);
 
 void
 dfvm_init_const(dfilter_t *df);
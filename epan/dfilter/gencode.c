@@ -8,6 +8,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "dfilter-int.h"
 #include "gencode.h"
 #include "dfvm.h"
@@ -309,8 +311,73 @@ fixup_jumps(gpointer data, gpointer user_data)
 	}
 }
 
+/* Minimum number of constant elements for which an "in" test uses a
+ * sorted set instead of a series of == tests. */
+#define IN_SET_MIN_ELEMENTS	2
+
+/* Returns TRUE if a set element can be stored in a dfvm_fvalue_set_t.
+ * This requires a constant of a type whose ordering is total and
+ * consistent with equality; IPv4/IPv6 constants with a netmask or prefix
+ * do not qualify because comparisons against them are not transitive. */
+static gboolean
+set_element_is_sortable(stnode_t *node)
+{
+	fvalue_t	*fv;
+
+	if (stnode_type_id(node) != STTYPE_FVALUE)
+		return FALSE;
+
+	fv = (fvalue_t *)stnode_data(node);
+	switch (fvalue_type_ftenum(fv)) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+		case FT_FRAMENUM:
+		case FT_EUI64:
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+			return TRUE;
+		case FT_IPv4:
+			return fv->value.ipv4.nmask == 0xffffffff;
+		case FT_IPv6:
+			return fv->value.ipv6.prefix == 128;
+		default:
+			return FALSE;
+	}
+}
+
+static gboolean
+set_pair_is_sortable(stnode_t *lower, stnode_t *upper)
+{
+	return set_element_is_sortable(lower) &&
+		(upper == NULL || set_element_is_sortable(upper));
+}
+
 /* Generate the code for the in operator.  It behaves much like an OR-ed
- * series of == tests, but without the redundant existence checks. */
+ * series of == tests, but without the redundant existence checks.
+ * Constant elements are collected into a sorted set that is tested
+ * with a single instruction; the remaining elements are tested one
+ * by one. */
 static void
 gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 {
@@ -320,18 +387,71 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 	int		reg1;
 	stnode_t	*node1, *node2;
 	GSList		*nodelist_head, *nodelist;
+	GSList		*chainlist_head = NULL, *chainlist;
 	GSList		*jumplist = NULL;
+	dfvm_fvalue_set_t *set = NULL;
+	int		num_sortable = 0;
 
 	/* Create code for the LHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 
-	/* Create code for the set on the RHS of the relation */
-	nodelist_head = nodelist = (GSList*)stnode_steal_data(st_arg2);
-	while (nodelist) {
+	nodelist_head = (GSList*)stnode_steal_data(st_arg2);
+
+	/* Count the elements that can be put in a sorted set. */
+	for (nodelist = nodelist_head; nodelist; nodelist = nodelist->next->next) {
+		node1 = (stnode_t*)nodelist->data;
+		node2 = (stnode_t*)nodelist->next->data;
+		if (set_pair_is_sortable(node1, node2))
+			num_sortable++;
+	}
+
+	/* Split the elements between the set and the chain of tests. */
+	for (nodelist = nodelist_head; nodelist; nodelist = nodelist->next->next) {
 		node1 = (stnode_t*)nodelist->data;
-		nodelist = g_slist_next(nodelist);
-		node2 = (stnode_t*)nodelist->data;
-		nodelist = g_slist_next(nodelist);
+		node2 = (stnode_t*)nodelist->next->data;
+		if (num_sortable >= IN_SET_MIN_ELEMENTS &&
+				set_pair_is_sortable(node1, node2)) {
+			if (!set)
+				set = dfvm_fvalue_set_new();
+			dfvm_fvalue_set_add(set,
+				(fvalue_t *)stnode_steal_data(node1),
+				node2 ? (fvalue_t *)stnode_steal_data(node2) : NULL);
+		}
+		else {
+			chainlist_head = g_slist_append(chainlist_head, node1);
+			chainlist_head = g_slist_append(chainlist_head, node2);
+		}
+	}
+
+	if (set) {
+		dfvm_fvalue_set_seal(set);
+
+		insn = dfvm_insn_new(ANY_IN_SET);
+		val1 = dfvm_value_new(REGISTER);
+		val1->value.numeric = reg1;
+		val2 = dfvm_value_new(FVALUE_SET);
+		val2->value.fvalue_set = set;
+		insn->arg1 = val1;
+		insn->arg2 = val2;
+		dfw_append_insn(dfw, insn);
+
+		/* Exit as soon as we find a match */
+		if (chainlist_head) {
+			insn = dfvm_insn_new(IF_TRUE_GOTO);
+			val1 = dfvm_value_new(INSN_NUMBER);
+			insn->arg1 = val1;
+			dfw_append_insn(dfw, insn);
+			jumplist = g_slist_prepend(jumplist, val1);
+		}
+	}
+
+	/* Create code for the rest of the set on the RHS of the relation */
+	chainlist = chainlist_head;
+	while (chainlist) {
+		node1 = (stnode_t*)chainlist->data;
+		chainlist = g_slist_next(chainlist);
+		node2 = (stnode_t*)chainlist->data;
+		chainlist = g_slist_next(chainlist);
 
 		if (node2) {
 			int	reg2, reg3;
@@ -363,7 +483,7 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 		}
 
 		/* Exit as soon as we find a match */
-		if (nodelist) {
+		if (chainlist) {
 			insn = dfvm_insn_new(IF_TRUE_GOTO);
 			val1 = dfvm_value_new(INSN_NUMBER);
 			insn->arg1 = val1;
@@ -391,9 +511,156 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 
 	/* Clean up */
 	g_slist_free(jumplist);
+	g_slist_free(chainlist_head);
 	set_nodelist_free(nodelist_head);
 }
 
+/* Minimum number of OR-ed "contains" tests of one field against constants
+ * for which the constants are compiled into a single pattern set. */
+#define CONTAINS_SET_MIN_PATTERNS	2
+
+/* Collects the operands of a chain of OR tests, leaving the chain as is. */
+static void
+collect_or_operands(stnode_t *node, GPtrArray *operands)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+
+	if (stnode_type_id(node) == STTYPE_TEST) {
+		sttype_test_get(node, &op, &arg1, &arg2);
+		if (op == TEST_OP_OR) {
+			collect_or_operands(arg1, operands);
+			collect_or_operands(arg2, operands);
+			return;
+		}
+	}
+	g_ptr_array_add(operands, node);
+}
+
+/* If node is "field contains constant", and the constant can go in a
+ * dfvm_pattern_set_t, returns the first field of that name. */
+static header_field_info *
+contains_pattern_field(stnode_t *node, gboolean *is_string)
+{
+	test_op_t		op;
+	stnode_t		*arg1, *arg2;
+	header_field_info	*hfinfo;
+	gboolean		pattern_is_string;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return NULL;
+	sttype_test_get(node, &op, &arg1, &arg2);
+	if (op != TEST_OP_CONTAINS ||
+			stnode_type_id(arg1) != STTYPE_FIELD ||
+			stnode_type_id(arg2) != STTYPE_FVALUE)
+		return NULL;
+
+	hfinfo = (header_field_info*)stnode_data(arg1);
+	if (!dfvm_pattern_type(hfinfo->type, is_string) ||
+			!dfvm_pattern_type(fvalue_type_ftenum((fvalue_t *)stnode_data(arg2)),
+				&pattern_is_string) ||
+			pattern_is_string != *is_string)
+		return NULL;
+
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+	return hfinfo;
+}
+
+/* Generate the code for a chain of OR tests. "contains" tests of the same
+ * field against constants, e.g. 'http.user_agent contains "curl" ||
+ * http.user_agent contains "wget"', are combined into one instruction that
+ * looks for all the constants in a single pass over each value. */
+static void
+gen_or(dfwork_t *dfw, stnode_t *st_node)
+{
+	GPtrArray	*operands = g_ptr_array_new();
+	header_field_info **fields;
+	gboolean	*is_string, *done;
+	stnode_t	*operand, *arg1, *arg2;
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2, *jmp = NULL;
+	dfvm_pattern_set_t *set;
+	GSList		*jumplist = NULL;
+	gboolean	first = TRUE;
+	guint		i, j, count;
+	int		reg;
+
+	collect_or_operands(st_node, operands);
+
+	fields = g_new0(header_field_info *, operands->len);
+	is_string = g_new0(gboolean, operands->len);
+	done = g_new0(gboolean, operands->len);
+	for (i = 0; i < operands->len; i++) {
+		fields[i] = contains_pattern_field(
+				(stnode_t*)g_ptr_array_index(operands, i), &is_string[i]);
+	}
+
+	for (i = 0; i < operands->len; i++) {
+		if (done[i])
+			continue;
+
+		/* Exit as soon as one of the operands is true */
+		if (!first) {
+			insn = dfvm_insn_new(IF_TRUE_GOTO);
+			val1 = dfvm_value_new(INSN_NUMBER);
+			insn->arg1 = val1;
+			dfw_append_insn(dfw, insn);
+			jumplist = g_slist_prepend(jumplist, val1);
+		}
+		first = FALSE;
+
+		operand = (stnode_t*)g_ptr_array_index(operands, i);
+		count = 0;
+		if (fields[i]) {
+			for (j = i; j < operands->len; j++) {
+				if (fields[j] == fields[i] && is_string[j] == is_string[i])
+					count++;
+			}
+		}
+		if (count < CONTAINS_SET_MIN_PATTERNS) {
+			gencode(dfw, operand);
+			continue;
+		}
+
+		sttype_test_get(operand, NULL, &arg1, NULL);
+		reg = gen_entity(dfw, arg1, &jmp);
+
+		set = dfvm_pattern_set_new(is_string[i]);
+		for (j = i; j < operands->len; j++) {
+			if (fields[j] == fields[i] && is_string[j] == is_string[i]) {
+				sttype_test_get((stnode_t*)g_ptr_array_index(operands, j),
+						NULL, NULL, &arg2);
+				dfvm_pattern_set_add(set, (fvalue_t *)stnode_steal_data(arg2));
+				done[j] = TRUE;
+			}
+		}
+		dfvm_pattern_set_seal(set);
+
+		insn = dfvm_insn_new(ANY_CONTAINS_ANY);
+		val1 = dfvm_value_new(REGISTER);
+		val1->value.numeric = reg;
+		val2 = dfvm_value_new(PATTERN_SET);
+		val2->value.pattern_set = set;
+		insn->arg1 = val1;
+		insn->arg2 = val2;
+		dfw_append_insn(dfw, insn);
+
+		/* Jump here if the field was not present */
+		jmp->value.numeric = dfw->next_insn_id;
+	}
+
+	/* Jump here if any of the operands was true */
+	g_slist_foreach(jumplist, fixup_jumps, dfw);
+
+	g_slist_free(jumplist);
+	g_free(done);
+	g_free(is_string);
+	g_free(fields);
+	g_ptr_array_free(operands, TRUE);
+}
+
 /* Parse an entity, returning the reg that it gets put into.
  * p_jmp will be set if it has to be set by the calling code; it should
  * be set to the place to jump to, to return to the calling code,
@@ -496,15 +763,7 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_OR:
-			gencode(dfw, st_arg1);
-
-			insn = dfvm_insn_new(IF_TRUE_GOTO);
-			val1 = dfvm_value_new(INSN_NUMBER);
-			insn->arg1 = val1;
-			dfw_append_insn(dfw, insn);
-
-			gencode(dfw, st_arg2);
-			val1->value.numeric = dfw->next_insn_id;
+			gen_or(dfw, st_node);
 			break;
 
 		case TEST_OP_ALL_EQ:
@@ -574,6 +833,303 @@ gencode(dfwork_t *dfw, stnode_t *st_node)
 }
 
 
+/*
+ * Syntax tree optimizations, run between the semantic check and code
+ * generation. Display filter tests have no side effects, so operands of
+ * AND and OR can be dropped or reordered freely as long as the truth
+ * value of the whole expression is kept.
+ */
+
+static header_field_info *
+first_hfinfo(header_field_info *hfinfo)
+{
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+	return hfinfo;
+}
+
+/* Conservative structural equality: returns FALSE whenever it isn't sure. */
+static gboolean
+st_equal(stnode_t *a, stnode_t *b)
+{
+	test_op_t	op_a, op_b;
+	stnode_t	*a1, *a2, *b1, *b2;
+	char		*s_a, *s_b;
+	gboolean	equal;
+
+	if (a == NULL || b == NULL)
+		return a == b;
+
+	if (stnode_type_id(a) != stnode_type_id(b))
+		return FALSE;
+
+	switch (stnode_type_id(a)) {
+		case STTYPE_TEST:
+			sttype_test_get(a, &op_a, &a1, &a2);
+			sttype_test_get(b, &op_b, &b1, &b2);
+			return op_a == op_b && st_equal(a1, b1) && st_equal(a2, b2);
+
+		case STTYPE_FIELD:
+			return first_hfinfo(stnode_data(a)) == first_hfinfo(stnode_data(b));
+
+		case STTYPE_FVALUE:
+			/* The debug representation includes the ftype name. */
+			return strcmp(stnode_todebug(a), stnode_todebug(b)) == 0;
+
+		case STTYPE_PCRE:
+			return strcmp(ws_regex_pattern(stnode_data(a)),
+					ws_regex_pattern(stnode_data(b))) == 0;
+
+		case STTYPE_RANGE:
+			if (!st_equal(sttype_range_entity(a), sttype_range_entity(b)))
+				return FALSE;
+			s_a = drange_tostr(sttype_range_drange(a));
+			s_b = drange_tostr(sttype_range_drange(b));
+			equal = strcmp(s_a, s_b) == 0;
+			g_free(s_a);
+			g_free(s_b);
+			return equal;
+
+		default:
+			/* Functions and sets are never compared. */
+			return FALSE;
+	}
+}
+
+/* If node is "field exists", returns the field. */
+static header_field_info *
+st_exists_field(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return NULL;
+	sttype_test_get(node, &op, &arg1, NULL);
+	if (op != TEST_OP_EXISTS)
+		return NULL;
+	return first_hfinfo(stnode_data(arg1));
+}
+
+/* A relation with a field as one of its operands can only be true if the
+ * field is present, since failing to read it fails the whole test. */
+static gboolean
+st_implies_exists(stnode_t *node, header_field_info *hfinfo)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return FALSE;
+	sttype_test_get(node, &op, &arg1, &arg2);
+
+	switch (op) {
+		case TEST_OP_ALL_EQ:
+		case TEST_OP_ANY_EQ:
+		case TEST_OP_ALL_NE:
+		case TEST_OP_ANY_NE:
+		case TEST_OP_GT:
+		case TEST_OP_GE:
+		case TEST_OP_LT:
+		case TEST_OP_LE:
+		case TEST_OP_BITWISE_AND:
+		case TEST_OP_CONTAINS:
+		case TEST_OP_MATCHES:
+			break;
+		default:
+			return FALSE;
+	}
+
+	if (stnode_type_id(arg1) == STTYPE_FIELD &&
+			first_hfinfo(stnode_data(arg1)) == hfinfo)
+		return TRUE;
+	if (stnode_type_id(arg2) == STTYPE_FIELD &&
+			first_hfinfo(stnode_data(arg2)) == hfinfo)
+		return TRUE;
+	return FALSE;
+}
+
+/* Rough relative cost of evaluating a test, used to order operands. */
+static int
+st_cost(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+
+	sttype_test_get(node, &op, &arg1, &arg2);
+
+	switch (op) {
+		case TEST_OP_EXISTS:
+			return 0;
+		case TEST_OP_ALL_EQ:
+		case TEST_OP_ANY_EQ:
+		case TEST_OP_ALL_NE:
+		case TEST_OP_ANY_NE:
+		case TEST_OP_GT:
+		case TEST_OP_GE:
+		case TEST_OP_LT:
+		case TEST_OP_LE:
+		case TEST_OP_BITWISE_AND:
+			if (stnode_type_id(arg1) == STTYPE_FIELD &&
+					(stnode_type_id(arg2) == STTYPE_FIELD ||
+					 stnode_type_id(arg2) == STTYPE_FVALUE))
+				return 1;
+			return 2;
+		default:
+			/* Substring and regex searches, membership tests,
+			 * nested logical expressions. */
+			return 2;
+	}
+}
+
+static stnode_t *
+optimize_test(stnode_t *node);
+
+/* Detaches the operands of a chain of op tests, freeing the chain nodes. */
+static void
+flatten_chain(stnode_t *node, test_op_t op, GPtrArray *operands)
+{
+	test_op_t	node_op;
+	stnode_t	*arg1, *arg2;
+
+	if (stnode_type_id(node) == STTYPE_TEST) {
+		sttype_test_get(node, &node_op, &arg1, &arg2);
+		if (node_op == op) {
+			sttype_test_set2_args(node, NULL, NULL);
+			stnode_free(node);
+			flatten_chain(arg1, op, operands);
+			flatten_chain(arg2, op, operands);
+			return;
+		}
+	}
+	g_ptr_array_add(operands, optimize_test(node));
+}
+
+static stnode_t *
+optimize_chain(stnode_t *node, test_op_t op)
+{
+	GPtrArray	*operands = g_ptr_array_new();
+	stnode_t	*operand, *other = NULL, *result;
+	header_field_info *hfinfo;
+	guint		i, j;
+	int		cost;
+
+	flatten_chain(node, op, operands);
+
+	/* Flattening may have exposed more operands of the same kind,
+	 * e.g. "a && !!(b && c)". */
+	for (i = 0; i < operands->len; i++) {
+		operand = g_ptr_array_index(operands, i);
+		if (stnode_type_id(operand) == STTYPE_TEST &&
+				sttype_test_get_op(stnode_data(operand)) == op) {
+			g_ptr_array_remove_index(operands, i);
+			flatten_chain(operand, op, operands);
+			i--;
+		}
+	}
+
+	/* "a && a" is "a", and so is "a || a". */
+	for (i = 0; i < operands->len; i++) {
+		operand = g_ptr_array_index(operands, i);
+		for (j = i + 1; j < operands->len; ) {
+			if (st_equal(operand, g_ptr_array_index(operands, j))) {
+				stnode_free(g_ptr_array_index(operands, j));
+				g_ptr_array_remove_index(operands, j);
+			}
+			else {
+				j++;
+			}
+		}
+	}
+
+	/* "f && f == x" is "f == x", and "f || f == x" is "f". */
+	for (i = 0; i < operands->len && operands->len > 1; ) {
+		operand = g_ptr_array_index(operands, i);
+		hfinfo = st_exists_field(operand);
+		for (j = 0; hfinfo != NULL && j < operands->len; j++) {
+			other = g_ptr_array_index(operands, j);
+			if (j != i && st_implies_exists(other, hfinfo))
+				break;
+		}
+		if (hfinfo == NULL || j == operands->len) {
+			i++;
+			continue;
+		}
+		if (op == TEST_OP_AND) {
+			stnode_free(operand);
+			g_ptr_array_remove_index(operands, i);
+		}
+		else {
+			stnode_free(other);
+			g_ptr_array_remove_index(operands, j);
+			if (j < i)
+				i--;
+		}
+	}
+
+	/* Cheap tests first; keep the user's order otherwise. */
+	result = NULL;
+	for (cost = 0; cost <= 2; cost++) {
+		for (i = 0; i < operands->len; i++) {
+			operand = g_ptr_array_index(operands, i);
+			if (st_cost(operand) != cost)
+				continue;
+			if (result == NULL) {
+				result = operand;
+			}
+			else {
+				other = stnode_new_test(op, NULL);
+				sttype_test_set2_args(other, result, operand);
+				result = other;
+			}
+		}
+	}
+
+	g_ptr_array_free(operands, TRUE);
+	return result;
+}
+
+/* Returns the optimized node, which replaces node in the tree. */
+static stnode_t *
+optimize_test(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return node;
+
+	sttype_test_get(node, &op, &arg1, NULL);
+
+	switch (op) {
+		case TEST_OP_NOT:
+			if (stnode_type_id(arg1) == STTYPE_TEST &&
+					sttype_test_get_op(stnode_data(arg1)) == TEST_OP_NOT) {
+				/* "!!a" is "a" */
+				sttype_test_get(arg1, NULL, &arg2, NULL);
+				sttype_test_set1_args(arg1, NULL);
+				stnode_free(node);
+				return optimize_test(arg2);
+			}
+			sttype_test_set1_args(node, optimize_test(arg1));
+			return node;
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return optimize_chain(node, op);
+
+		default:
+			return node;
+	}
+}
+
+void
+dfw_optimize(dfwork_t *dfw)
+{
+	dfw->st_root = optimize_test(dfw->st_root);
+}
+
 void
 dfw_gencode(dfwork_t *dfw)
 {
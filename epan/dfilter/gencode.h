@@ -10,6 +10,10 @@
 #ifndef GENCODE_H
 #define GENCODE_H
 
+/* Simplifies the syntax tree after a successful semantic check. */
+void
+dfw_optimize(dfwork_t *dfw);
+
 void
 dfw_gencode(dfwork_t *dfw);
 
@@ -0,0 +1,195 @@
+/* dissector_table_test.c
+ * Tests and a dispatch cost benchmark for uint dissector tables
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/packet.h>
+#include <wiretap/wtap.h>
+
+static dissector_handle_t handle_a;
+static dissector_handle_t handle_b;
+
+static int
+dummy_dissector(tvbuff_t *tvb _U_, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+    return 0;
+}
+
+/* Values on both sides of every level of the direct index, and past it */
+static const guint32 test_patterns[] = {
+    0, 1, 255, 256, 0x0800, 0x86DD, 65534, 65535, 65536, 0x01000000, G_MAXUINT32
+};
+
+static void
+check_table(const char *name, ftenum_t type)
+{
+    dissector_table_t table;
+    guint i;
+
+    table = register_dissector_table(name, name, -1, type, BASE_DEC);
+    g_assert_nonnull(table);
+
+    for (i = 0; i < G_N_ELEMENTS(test_patterns); i++) {
+        g_assert_null(dissector_get_uint_handle(table, test_patterns[i]));
+        dissector_add_uint(name, test_patterns[i], handle_a);
+    }
+    for (i = 0; i < G_N_ELEMENTS(test_patterns); i++) {
+        g_assert_true(dissector_get_uint_handle(table, test_patterns[i]) == handle_a);
+        g_assert_null(dissector_get_uint_handle(table, test_patterns[i] ^ 0x10));
+    }
+
+    /* Decode As style override and reset */
+    dissector_change_uint(name, 0x0800, handle_b);
+    g_assert_true(dissector_get_uint_handle(table, 0x0800) == handle_b);
+    g_assert_true(dissector_is_uint_changed(table, 0x0800));
+    dissector_reset_uint(name, 0x0800);
+    g_assert_true(dissector_get_uint_handle(table, 0x0800) == handle_a);
+
+    /* An override with no initial entry goes away on reset */
+    dissector_change_uint(name, 4242, handle_b);
+    g_assert_true(dissector_get_uint_handle(table, 4242) == handle_b);
+    dissector_reset_uint(name, 4242);
+    g_assert_null(dissector_get_uint_handle(table, 4242));
+
+    /* Re-adding replaces the entry */
+    dissector_add_uint(name, 256, handle_b);
+    g_assert_true(dissector_get_uint_handle(table, 256) == handle_b);
+
+    dissector_delete_uint(name, 65536, handle_a);
+    g_assert_null(dissector_get_uint_handle(table, 65536));
+    dissector_delete_uint(name, 1, handle_a);
+    g_assert_null(dissector_get_uint_handle(table, 1));
+
+    /* Removes everything for handle_a's protocol, keeping 256 */
+    dissector_delete_all(name, handle_a);
+    for (i = 0; i < G_N_ELEMENTS(test_patterns); i++) {
+        if (test_patterns[i] == 256)
+            g_assert_true(dissector_get_uint_handle(table, 256) == handle_b);
+        else
+            g_assert_null(dissector_get_uint_handle(table, test_patterns[i]));
+    }
+}
+
+static void
+dissector_table_test_uint16(void)
+{
+    check_table("test.uint16", FT_UINT16);
+}
+
+static void
+dissector_table_test_uint32(void)
+{
+    check_table("test.uint32", FT_UINT32);
+}
+
+#define BENCH_ROUNDS 256
+
+/* Look up every value of a 16-bit domain, as a stream of packets with
+ * assorted ports / ethertypes would, and compare against a bare
+ * GHashTable holding the same entries. */
+static void
+bench_table(const char *name)
+{
+    dissector_table_t table = find_dissector_table(name);
+    GHashTable *hash;
+    volatile gconstpointer sink = NULL;
+    double elapsed;
+    guint32 pattern;
+    guint i;
+
+    if (table == NULL) {
+        g_test_message("no %s table, skipped", name);
+        return;
+    }
+
+    hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (pattern = 0; pattern <= G_MAXUINT16; pattern++) {
+        dissector_handle_t handle = dissector_get_uint_handle(table, pattern);
+        if (handle)
+            g_hash_table_insert(hash, GUINT_TO_POINTER(pattern), handle);
+    }
+
+    g_test_timer_start();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        for (pattern = 0; pattern <= G_MAXUINT16; pattern++)
+            sink = dissector_get_uint_handle(table, pattern);
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "%s: dissector table %.2f ns/lookup",
+                            name, elapsed * 1e9 / (BENCH_ROUNDS * 65536.0));
+
+    g_test_timer_start();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        for (pattern = 0; pattern <= G_MAXUINT16; pattern++)
+            sink = g_hash_table_lookup(hash, GUINT_TO_POINTER(pattern));
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "%s: GHashTable %.2f ns/lookup",
+                            name, elapsed * 1e9 / (BENCH_ROUNDS * 65536.0));
+
+    (void)sink;
+    g_hash_table_destroy(hash);
+}
+
+static void
+dissector_table_test_dispatch_perf(void)
+{
+    bench_table("ethertype");
+    bench_table("ip.proto");
+    bench_table("udp.port");
+    bench_table("tcp.port");
+    bench_table("sctp.ppi");
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/dissector_table/uint16", dissector_table_test_uint16);
+    g_test_add_func("/dissector_table/uint32", dissector_table_test_uint32);
+    if (g_test_perf()) {
+        g_test_add_func("/dissector_table/dispatch", dissector_table_test_dispatch_perf);
+    }
+
+    wtap_init(FALSE);
+    if (!epan_init(NULL, NULL, FALSE))
+        return 2;
+
+    handle_a = create_dissector_handle(dummy_dissector, proto_get_id_by_filter_name("frame"));
+    handle_b = create_dissector_handle(dummy_dissector, proto_get_id_by_filter_name("data"));
+
+    result = g_test_run();
+
+    epan_cleanup();
+    wtap_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -905,6 +905,31 @@ ldap_match_call_response(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, gu
     return lcrp;
 }
 
+/* Fields that never occur within a search result's attributes; filtering on
+ * nothing but these lets the BER runtime step over the attribute list. */
+static int * const ldap_attributes_outside_hfs[] = {
+  &hf_ldap_LDAPMessage_PDU,
+  &hf_ldap_messageID,
+  &hf_ldap_protocolOp,
+  &hf_ldap_searchRequest,
+  &hf_ldap_searchResEntry,
+  &hf_ldap_searchResDone,
+  &hf_ldap_baseObject,
+  &hf_ldap_scope,
+  &hf_ldap_derefAliases,
+  &hf_ldap_sizeLimit,
+  &hf_ldap_timeLimit,
+  &hf_ldap_typesOnly,
+  &hf_ldap_objectName,
+  &hf_ldap_resultCode,
+  &hf_ldap_matchedDN,
+  &hf_ldap_errorMessage,
+  &hf_ldap_response_in,
+  &hf_ldap_response_to,
+  &hf_ldap_time,
+  NULL
+};
+
 #include "packet-ldap-fn.c"
 static int dissect_LDAPMessage_PDU(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, ldap_conv_info_t *ldap_info) {
 
@@ -51,6 +51,7 @@
 #include <epan/oids.h>
 #include <epan/expert.h>
 #include <epan/uat.h>
+#include <epan/tap.h>
 #include <epan/decode_as.h>
 #include <wiretap/wtap.h>
 #ifdef DEBUG_BER
@@ -187,6 +188,9 @@ static gboolean decode_octetstring_as_ber        = FALSE;
 static gboolean decode_primitive_as_ber          = FALSE;
 static gboolean decode_unexpected                = FALSE;
 static gboolean decode_warning_leading_zero_bits = FALSE;
+static gboolean skip_unneeded_ber_contents       = TRUE;
+
+static int ber_expert_tap = -1;
 
 static gchar *decode_as_syntax = NULL;
 
@@ -1395,6 +1399,122 @@ proto_tree_add_debug_text(tree, "dissect BER length %d, offset %d (remaining %d)
     return offset;
 }
 
+/* The "skip unneeded contents" mode: once the tree is not going to be shown,
+ * a constructed element whose contents no filter, column or tap asks for is
+ * stepped over by its length instead of being decoded.
+ *
+ * BER tables do not record which fields can turn up beneath a type, so the
+ * caller names the fields of its protocol that are known to lie outside the
+ * element; any other referenced field of that protocol, or any referenced
+ * protocol that is not below the caller in this frame (the element may carry
+ * certificates, SIDs, nested BER and so on), means the contents are needed.
+ * The answer is kept until the frame, the tree or the set of primed fields
+ * changes.
+ */
+static struct {
+    guint        prime_serial;
+    const tree_data_t *tree_data;
+    guint32      frame_num;
+    int          proto_id;
+    int * const *outside_hfs;
+    gboolean     needed;
+} ber_contents_needed_cache = { 0, NULL, 0, -1, NULL, TRUE };
+
+static gboolean
+ber_hf_in_list(int hfid, int * const *hfs)
+{
+    for (; *hfs; hfs++) {
+        if (**hfs == hfid)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean
+ber_proto_below(packet_info *pinfo, int proto_id)
+{
+    wmem_list_frame_t *frame;
+    guint8 layer = 1;
+
+    for (frame = wmem_list_head(pinfo->layers); frame && layer < pinfo->curr_layer_num;
+         frame = wmem_list_frame_next(frame), layer++) {
+        if (GPOINTER_TO_INT(wmem_list_frame_data(frame)) == proto_id)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean
+ber_contents_needed(packet_info *pinfo, proto_tree *tree, int proto_id, int * const *outside_hfs)
+{
+    header_field_info *hfinfo;
+    void *cookie, *field_cookie;
+    int id;
+
+    if (have_tap_listener(ber_expert_tap) || (union_of_tap_listener_flags() & TL_REQUIRES_PROTO_TREE))
+        return TRUE;
+
+    for (id = proto_get_first_protocol(&cookie); id != -1; id = proto_get_next_protocol(&cookie)) {
+        if (proto_tree_get_ref_type(tree, id) == HF_REF_TYPE_NONE)
+            continue;
+
+        if (id != proto_id) {
+            if (id == proto_ber || !ber_proto_below(pinfo, id))
+                return TRUE;
+            continue;
+        }
+
+        for (hfinfo = proto_get_first_protocol_field(id, &field_cookie); hfinfo != NULL;
+             hfinfo = proto_get_next_protocol_field(id, &field_cookie)) {
+            if (proto_tree_get_ref_type(tree, hfinfo->id) != HF_REF_TYPE_NONE && !ber_hf_in_list(hfinfo->id, outside_hfs))
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+int
+dissect_ber_skip_unneeded(asn1_ctx_t *actx, proto_tree *tree, tvbuff_t *tvb, int offset, int proto_id, int * const *outside_hfs)
+{
+    packet_info *pinfo = actx->pinfo;
+    int      end_offset;
+    guint32  len;
+    gboolean ind;
+
+    if (!skip_unneeded_ber_contents)
+        return offset;
+
+    if (tree) {
+        if (PTREE_DATA(tree)->visible || !PTREE_DATA(tree)->fake_protocols)
+            return offset;
+    }
+
+    if (ber_contents_needed_cache.prime_serial != proto_get_prime_serial() ||
+        ber_contents_needed_cache.tree_data != (tree ? PTREE_DATA(tree) : NULL) ||
+        ber_contents_needed_cache.frame_num != pinfo->num ||
+        ber_contents_needed_cache.proto_id != proto_id ||
+        ber_contents_needed_cache.outside_hfs != outside_hfs) {
+        ber_contents_needed_cache.prime_serial = proto_get_prime_serial();
+        ber_contents_needed_cache.tree_data = tree ? PTREE_DATA(tree) : NULL;
+        ber_contents_needed_cache.frame_num = pinfo->num;
+        ber_contents_needed_cache.proto_id = proto_id;
+        ber_contents_needed_cache.outside_hfs = outside_hfs;
+        ber_contents_needed_cache.needed = ber_contents_needed(pinfo, tree, proto_id, outside_hfs);
+    }
+    if (ber_contents_needed_cache.needed)
+        return offset;
+
+    end_offset = get_ber_identifier(tvb, offset, NULL, NULL, NULL);
+    end_offset = get_ber_length(tvb, end_offset, &len, &ind);
+    /* Leave indefinite and overlong lengths to the regular code and its
+     * expert infos. */
+    if (ind || len > (guint32)tvb_reported_length_remaining(tvb, end_offset))
+        return offset;
+
+    return end_offset + len;
+}
+
 static reassembly_table octet_segment_reassembly_table;
 
 static int
@@ -4518,6 +4638,12 @@ proto_register_ber(void)
                                    "Whether the dissector should try decoding unknown primitive as"
                                    " constructed ASN.1 BER encoded data", &decode_primitive_as_ber);
 
+    prefs_register_bool_preference(ber_module, "skip_unneeded",
+                                   "Skip contents no filter or column needs",
+                                   "Whether the dissector may step over constructed elements"
+                                   " whose fields are not referenced when the packet details"
+                                   " are not being shown", &skip_unneeded_ber_contents);
+
     prefs_register_bool_preference(ber_module, "warn_too_many_bytes",
                                    "Warn if too many leading zero bits in encoded data",
                                    "Whether the dissector should warn if excessive leading zero (0) bits",
@@ -4567,6 +4693,8 @@ proto_reg_handoff_ber(void)
 
     ber_file_handle = create_dissector_handle(dissect_ber_file, proto_ber);
     dissector_add_uint("wtap_encap", WTAP_ENCAP_BER, ber_file_handle);
+
+    ber_expert_tap = find_tap_id("expert");
 }
 
 /*
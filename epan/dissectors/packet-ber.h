@@ -85,6 +85,13 @@ WS_DLL_PUBLIC int dissect_unknown_ber(packet_info *pinfo, tvbuff_t *tvb, int off
 WS_DLL_PUBLIC int get_ber_length(tvbuff_t *tvb, int offset, guint32 *length, gboolean *ind);
 WS_DLL_PUBLIC int dissect_ber_length(packet_info *pinfo, proto_tree *tree, tvbuff_t *tvb, int offset, guint32 *length, gboolean *ind);
 
+/* Returns the offset past the element at offset when the current dissection
+ * needs nothing beneath it, or offset itself when it has to be dissected.
+ * outside_hfs is a NULL terminated list of the fields of proto_id that never
+ * occur within the element.
+ */
+WS_DLL_PUBLIC int dissect_ber_skip_unneeded(asn1_ctx_t *actx, proto_tree *tree, tvbuff_t *tvb, int offset, int proto_id, int * const *outside_hfs);
+
 WS_DLL_PUBLIC int dissect_ber_tagged_type(gboolean implicit_tag, asn1_ctx_t *actx, proto_tree *tree, tvbuff_t *tvb, int offset, gint hf_id, gint8 tag_cls, gint32 tag_tag, gboolean tag_impl, ber_type_fn type);
 
 extern int dissect_ber_constrained_octet_string(gboolean implicit_tag, asn1_ctx_t *actx, proto_tree *tree, tvbuff_t *tvb, int offset, gint32 min_len, gint32 max_len, gint hf_id, tvbuff_t **out_tvb);
@@ -2064,6 +2064,39 @@ ddict_cleanup_cb(wmem_allocator_t* allocator _U_, wmem_cb_event_t event _U_, voi
 /*       value_string arrays created at compile time. Since the last entry in a            */
 /*       value_string array must be {0, NULL}, we are assuming that NULL == 0 (hackish).   */
 
+/*
+ * dictionary.xml and the files it includes take a while to parse, so it's
+ * only done when the Diameter fields are first needed (see
+ * proto_register_prefix() below). If the protocol is enabled, the parsing
+ * is started in the background when a file is opened, so that it's likely
+ * to be done by then.
+ */
+static GThread *ddict_scan_thread = NULL;
+static gboolean dictionary_loaded = FALSE;
+
+static gpointer
+ddict_scan_worker(gpointer data)
+{
+	char *dir = (char *)data;
+	gboolean do_debug_parser = getenv("WIRESHARK_DEBUG_DIAM_DICT_PARSER") ? TRUE : FALSE;
+	ddict_t *d;
+
+	d = ddict_scan(dir,"dictionary.xml",do_debug_parser);
+	g_free(dir);
+	return d;
+}
+
+static void
+diameter_init(void)
+{
+	if (dictionary_loaded || ddict_scan_thread ||
+	    !proto_is_protocol_enabled(find_protocol_by_id(proto_diameter)))
+		return;
+
+	ddict_scan_thread = g_thread_new("diameter_dictionary_scan", ddict_scan_worker,
+	    g_strdup_printf("%s" G_DIR_SEPARATOR_S "diameter" G_DIR_SEPARATOR_S, get_datafile_dir()));
+}
+
 static int
 dictionary_load(void)
 {
@@ -2115,10 +2148,15 @@ dictionary_load(void)
 		g_hash_table_insert(build_dict.types,(gchar *)type->name,(void *)type);
 	}
 
-	/* load the dictionary */
-	dir = wmem_strdup_printf(NULL, "%s" G_DIR_SEPARATOR_S "diameter" G_DIR_SEPARATOR_S, get_datafile_dir());
-	d = ddict_scan(dir,"dictionary.xml",do_debug_parser);
-	wmem_free(NULL, dir);
+	/* load the dictionary, or pick it up if it was parsed in the background */
+	if (ddict_scan_thread) {
+		d = (ddict_t *)g_thread_join(ddict_scan_thread);
+		ddict_scan_thread = NULL;
+	} else {
+		dir = wmem_strdup_printf(NULL, "%s" G_DIR_SEPARATOR_S "diameter" G_DIR_SEPARATOR_S, get_datafile_dir());
+		d = ddict_scan(dir,"dictionary.xml",do_debug_parser);
+		wmem_free(NULL, dir);
+	}
 	if (d == NULL) {
 		g_hash_table_destroy(vendors);
 		g_array_free(vnd_shrt_arr, TRUE);
@@ -2556,6 +2594,7 @@ register_diameter_fields(const char *unused _U_)
 	 * call a routine that defines hf_base[] and does all
 	 * the registration work.
 	 */
+	dictionary_loaded = TRUE;
 	dictionary_load();
 	real_register_diameter_fields();
 }
@@ -2574,6 +2613,7 @@ proto_register_diameter(void)
 
 	/* Delay registration of Diameter fields */
 	proto_register_prefix("diameter", register_diameter_fields);
+	register_init_routine(diameter_init);
 
 	/* Register dissector table(s) to do sub dissection of AVPs (OctetStrings) */
 	diameter_dissector_table = register_dissector_table("diameter.base", "Diameter Base AVP", proto_diameter, FT_UINT32, BASE_DEC);
@@ -517,6 +517,11 @@ static gboolean dns_desegment = TRUE;
  */
 static guint32 retransmission_timer = 5;
 
+/* Number of seconds after a request until its transaction can no longer be
+ * matched by a response (0 = never)
+ */
+static guint32 transaction_expiry = 120;
+
 /* Dissector handle for GSSAPI */
 static dissector_handle_t gssapi_handle;
 static dissector_handle_t ntlmssp_handle;
@@ -529,18 +534,34 @@ enum DnsTransport {
   DNS_TRANSPORT_QUIC
 };
 
+/* Identifies a transaction within a conversation: the transaction ID,
+ * qualified by the first question so that resolvers which multiplex many
+ * queries over a few ports don't get theirs mixed up when IDs are reused.
+ * Only 32 bit members, as the whole struct is hashed. */
+typedef struct _dns_transaction_key_t {
+  guint32 id;
+  guint32 qname_hash;
+  guint32 qtype;
+} dns_transaction_key_t;
+
 /* Structure containing transaction specific information */
 typedef struct _dns_transaction_t {
+  dns_transaction_key_t key;
   guint32 req_frame;
   guint32 rep_frame;
   nstime_t req_time;
-  guint id;
   gboolean multiple_responds;
 } dns_transaction_t;
 
 /* Structure containing conversation specific information */
 typedef struct _dns_conv_info_t {
-  wmem_tree_t *pdus;
+  /* The latest transaction for each key, and for each transaction ID for
+   * messages without a question.  They are only consulted in the first pass;
+   * afterwards every frame finds its transaction in its proto data. */
+  wmem_map_t *transactions;
+  wmem_map_t *transactions_by_id;
+  /* When the maps were last swept for expired transactions */
+  nstime_t last_expiry;
 } dns_conv_info_t;
 
 /* DNS structs and definitions */
@@ -4088,6 +4109,92 @@ dissect_dso_data(tvbuff_t *tvb, int offset, packet_info *pinfo _U_, proto_tree *
   return offset - start_offset;
 }
 
+static guint
+dns_transaction_key_hash(gconstpointer k)
+{
+  return wmem_strong_hash((const guint8 *)k, sizeof(dns_transaction_key_t));
+}
+
+static gboolean
+dns_transaction_key_equal(gconstpointer k1, gconstpointer k2)
+{
+  const dns_transaction_key_t *key1 = (const dns_transaction_key_t *)k1;
+  const dns_transaction_key_t *key2 = (const dns_transaction_key_t *)k2;
+
+  return key1->id == key2->id && key1->qname_hash == key2->qname_hash &&
+         key1->qtype == key2->qtype;
+}
+
+/* Fills in the question part of a transaction key straight from the wire:
+ * a case-insensitive hash of the first question's name, and its type.  This
+ * runs before the message is dissected, so it must not throw on truncated or
+ * malformed data; a name that can't be followed is hashed as far as it goes.
+ */
+static void
+dns_question_key(tvbuff_t *tvb, int offset, dns_transaction_key_t *key)
+{
+  gint          remaining = tvb_captured_length_remaining(tvb, offset);
+  const guint8 *p;
+  guint32       hash = 2166136261U;
+  gint          i = 0, end;
+
+  if (remaining <= 0)
+    return;
+
+  p = tvb_get_ptr(tvb, offset, remaining);
+  while (i < remaining) {
+    guint8 label_len = p[i++];
+
+    if (label_len == 0) {
+      if (remaining - i >= 2)
+        key->qtype = pntoh16(p + i);
+      break;
+    }
+    if ((label_len & 0xC0) || label_len > remaining - i)
+      break;
+
+    hash = (hash ^ label_len) * 16777619U;
+    for (end = i + label_len; i < end; i++)
+      hash = (hash ^ g_ascii_tolower(p[i])) * 16777619U;
+  }
+  key->qname_hash = hash;
+}
+
+static void
+dns_expire_transactions(dns_conv_info_t *dns_info, const nstime_t *now)
+{
+  wmem_list_t       *keys;
+  wmem_list_frame_t *frame;
+  nstime_t           delta;
+
+  nstime_delta(&delta, now, &dns_info->last_expiry);
+  if (nstime_to_sec(&delta) < (double)transaction_expiry)
+    return;
+  dns_info->last_expiry = *now;
+
+  keys = wmem_map_get_keys(wmem_packet_scope(), dns_info->transactions);
+  for (frame = wmem_list_head(keys); frame; frame = wmem_list_frame_next(frame)) {
+    const dns_transaction_key_t *key = (const dns_transaction_key_t *)wmem_list_frame_data(frame);
+    dns_transaction_t *dns_trans = (dns_transaction_t *)wmem_map_lookup(dns_info->transactions, key);
+
+    nstime_delta(&delta, now, &dns_trans->req_time);
+    if (nstime_to_sec(&delta) < (double)transaction_expiry)
+      continue;
+
+    if (wmem_map_lookup(dns_info->transactions_by_id, GUINT_TO_POINTER(key->id)) == dns_trans)
+      wmem_map_remove(dns_info->transactions_by_id, GUINT_TO_POINTER(key->id));
+    wmem_map_remove(dns_info->transactions, key);
+  }
+}
+
+static dns_transaction_t *
+dns_lookup_transaction(dns_conv_info_t *dns_info, const dns_transaction_key_t *key, gboolean has_question)
+{
+  if (has_question)
+    return (dns_transaction_t *)wmem_map_lookup(dns_info->transactions, key);
+  return (dns_transaction_t *)wmem_map_lookup(dns_info->transactions_by_id, GUINT_TO_POINTER(key->id));
+}
+
 static void
 dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
     enum DnsTransport transport, gboolean is_mdns, gboolean is_llmnr)
@@ -4104,7 +4211,8 @@ dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
   conversation_t    *conversation;
   dns_conv_info_t   *dns_info;
   dns_transaction_t *dns_trans = NULL;
-  wmem_tree_key_t    key[3];
+  dns_transaction_key_t trans_key;
+  gboolean           has_question;
   struct DnsTap     *dns_stats;
   guint16            qtype = 0;
   guint16            qclass = 0;
@@ -4181,26 +4289,33 @@ dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
      * it to the list of information structures.
      */
     dns_info = wmem_new(wmem_file_scope(), dns_conv_info_t);
-    dns_info->pdus=wmem_tree_new(wmem_file_scope());
+    dns_info->transactions = wmem_map_new_flat(wmem_file_scope(), dns_transaction_key_hash, dns_transaction_key_equal);
+    dns_info->transactions_by_id = wmem_map_new_flat(wmem_file_scope(), g_direct_hash, g_direct_equal);
+    dns_info->last_expiry = pinfo->abs_ts;
     conversation_add_proto_data(conversation, proto_dns, dns_info);
   }
 
-  key[0].length = 1;
-  key[0].key = &reqresp_id;
-  key[1].length = 1;
-  key[1].key = &pinfo->num;
-  key[2].length = 0;
-  key[2].key = NULL;
+  memset(&trans_key, 0, sizeof(trans_key));
+  trans_key.id = reqresp_id;
+  has_question = tvb_captured_length_remaining(tvb, offset) >= DNS_HDRLEN &&
+                 tvb_get_ntohs(tvb, offset + DNS_QUEST) > 0;
+  if (has_question) {
+    dns_question_key(tvb, offset + DNS_HDRLEN, &trans_key);
+  }
 
   if (!pinfo->flags.in_error_pkt) {
     if (!pinfo->fd->visited) {
+      if (transaction_expiry > 0) {
+        dns_expire_transactions(dns_info, &pinfo->abs_ts);
+      }
+
       if (!(flags&F_RESPONSE)) {
         /* This is a request */
         gboolean new_transaction = FALSE;
 
         /* Check if we've seen this transaction before */
-        dns_trans=(dns_transaction_t *)wmem_tree_lookup32_array_le(dns_info->pdus, key);
-        if ((dns_trans == NULL) || (dns_trans->id != reqresp_id) || (dns_trans->rep_frame > 0)) {
+        dns_trans = dns_lookup_transaction(dns_info, &trans_key, has_question);
+        if ((dns_trans == NULL) || (dns_trans->rep_frame > 0)) {
           new_transaction = TRUE;
         } else {
           nstime_t request_delta;
@@ -4216,31 +4331,33 @@ dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 
         if (new_transaction) {
           dns_trans=wmem_new(wmem_file_scope(), dns_transaction_t);
+          dns_trans->key = trans_key;
           dns_trans->req_frame=pinfo->num;
           dns_trans->rep_frame=0;
           dns_trans->req_time=pinfo->abs_ts;
-          dns_trans->id = reqresp_id;
           dns_trans->multiple_responds=FALSE;
-          wmem_tree_insert32_array(dns_info->pdus, key, (void *)dns_trans);
+          if (has_question) {
+            wmem_map_insert(dns_info->transactions, &dns_trans->key, dns_trans);
+          }
+          wmem_map_insert(dns_info->transactions_by_id, GUINT_TO_POINTER(reqresp_id), dns_trans);
         }
       } else {
-        dns_trans=(dns_transaction_t *)wmem_tree_lookup32_array_le(dns_info->pdus, key);
+        dns_trans = dns_lookup_transaction(dns_info, &trans_key, has_question);
         if (dns_trans) {
-          if (dns_trans->id != reqresp_id) {
-            dns_trans = NULL;
-          } else if (dns_trans->rep_frame == 0) {
+          if (dns_trans->rep_frame == 0) {
             dns_trans->rep_frame=pinfo->num;
           } else if (!dns_trans->multiple_responds) {
             retransmission = TRUE;
           }
         }
       }
+      if (dns_trans) {
+        p_add_proto_data(wmem_file_scope(), pinfo, proto_dns, reqresp_id, dns_trans);
+      }
     } else {
-      dns_trans=(dns_transaction_t *)wmem_tree_lookup32_array_le(dns_info->pdus, key);
+      dns_trans = (dns_transaction_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_dns, reqresp_id);
       if (dns_trans) {
-        if (dns_trans->id != reqresp_id) {
-          dns_trans = NULL;
-        } else if ((!(flags & F_RESPONSE)) && (dns_trans->req_frame != pinfo->num)) {
+        if ((!(flags & F_RESPONSE)) && (dns_trans->req_frame != pinfo->num)) {
           /* This is a request retransmission, create a "fake" dns_trans structure*/
           dns_transaction_t *retrans_dns = wmem_new(wmem_packet_scope(), dns_transaction_t);
           retrans_dns->req_frame=dns_trans->req_frame;
@@ -6436,6 +6553,12 @@ proto_register_dns(void)
                                   " Otherwise its considered a new request.",
                                   10, &retransmission_timer);
 
+  prefs_register_uint_preference(dns_module, "transaction_expiry",
+                                  "Number of seconds a request waits for its response",
+                                  "Number of seconds after which a DNS request can no longer be matched by a response,"
+                                  " so that the transactions of long captures don't pile up. 0 keeps them forever.",
+                                  10, &transaction_expiry);
+
   prefs_register_obsolete_preference(dns_module, "use_for_addr_resolution");
 
   prefs_register_static_text_preference(dns_module, "text_use_for_addr_resolution",
@@ -735,6 +735,8 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 			proto_tree_add_int(fh_tree, hf_frame_wtap_encap, tvb, 0, 0, pinfo->rec->rec_header.packet_header.pkt_encap);
 
 		if (pinfo->presence_flags & PINFO_HAS_TS) {
+			nstime_t shift_offset;
+
 			proto_tree_add_time(fh_tree, hf_frame_arrival_time, tvb,
 					    0, 0, &(pinfo->abs_ts));
 			if (pinfo->abs_ts.nsecs < 0 || pinfo->abs_ts.nsecs >= 1000000000) {
@@ -743,8 +745,14 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 								  " the valid range is 0-1000000000",
 								  (long) pinfo->abs_ts.nsecs);
 			}
+			/*
+			 * The record holds the time stamp read from the file,
+			 * so any difference from the frame's time stamp is a
+			 * time shift applied by the user.
+			 */
+			nstime_delta(&shift_offset, &(pinfo->abs_ts), &(pinfo->rec->ts));
 			item = proto_tree_add_time(fh_tree, hf_frame_shift_offset, tvb,
-					    0, 0, &(pinfo->fd->shift_offset));
+					    0, 0, &shift_offset);
 			proto_item_set_generated(item);
 
 			if (generate_epoch_time) {
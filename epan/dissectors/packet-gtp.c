@@ -2486,6 +2486,12 @@ guint32 gtp_session_count;
 GHashTable* session_table;
 /* Relation between <teid,ip> -> frame */
 wmem_tree_t* frame_tree;
+/* Relation between IMSI -> sessions and session -> frames, so that one
+ * subscriber can be followed without filtering the whole capture again */
+static wmem_map_t *gtp_imsi_sessions;
+static wmem_map_t *gtp_session_frames;
+/* IMSIs seen in frames which do not have a session yet */
+static wmem_map_t *gtp_pending_imsi;
 
 typedef struct {
     guint32 teid;
@@ -2551,15 +2557,119 @@ remove_frame_info(guint32 *f) {
     wmem_tree_foreach(frame_tree, call_foreach_ip, (void *)f);
 }
 
+static void
+gtp_link_imsi_session(const gchar *imsi, guint32 session)
+{
+    wmem_array_t *sessions;
+    guint i, count;
+
+    sessions = (wmem_array_t *)wmem_map_lookup(gtp_imsi_sessions, imsi);
+    if (!sessions) {
+        sessions = wmem_array_new(wmem_file_scope(), sizeof(guint32));
+        wmem_map_insert(gtp_imsi_sessions, wmem_strdup(wmem_file_scope(), imsi), sessions);
+    }
+
+    /* A subscriber rarely has more than a handful of sessions */
+    count = wmem_array_get_count(sessions);
+    for (i = 0; i < count; i++) {
+        if (*(guint32 *)wmem_array_index(sessions, i) == session)
+            return;
+    }
+    wmem_array_append_one(sessions, session);
+}
+
 void
 add_gtp_session(guint32 frame, guint32 session) {
     guint32 *f, *session_count;
+    wmem_array_t *frames;
+    const gchar *imsi;
+    guint count;
 
     f = wmem_new0(wmem_file_scope(), guint32);
     session_count = wmem_new0(wmem_file_scope(), guint32);
     *f = frame;
     *session_count = session;
     g_hash_table_insert(session_table, f, session_count);
+
+    frames = (wmem_array_t *)wmem_map_lookup(gtp_session_frames, GUINT_TO_POINTER(session));
+    if (!frames) {
+        frames = wmem_array_new(wmem_file_scope(), sizeof(guint32));
+        wmem_map_insert(gtp_session_frames, GUINT_TO_POINTER(session), frames);
+    }
+    /* Frames are added during the first pass, so they arrive in order */
+    count = wmem_array_get_count(frames);
+    if (count == 0 || *(guint32 *)wmem_array_index(frames, count - 1) != frame) {
+        wmem_array_append_one(frames, frame);
+    }
+
+    imsi = (const gchar *)wmem_map_remove(gtp_pending_imsi, GUINT_TO_POINTER(frame));
+    if (imsi) {
+        gtp_link_imsi_session(imsi, session);
+    }
+}
+
+void
+gtp_session_set_imsi(packet_info *pinfo, const gchar *imsi)
+{
+    guint32 *session;
+
+    if (!g_gtp_session || PINFO_FD_VISITED(pinfo) || !imsi || !*imsi)
+        return;
+
+    session = (guint32 *)g_hash_table_lookup(session_table, &pinfo->num);
+    if (session) {
+        gtp_link_imsi_session(imsi, *session);
+    } else {
+        /* The session is only assigned once the whole message has been seen */
+        wmem_map_insert(gtp_pending_imsi, GUINT_TO_POINTER(pinfo->num), wmem_strdup(wmem_file_scope(), imsi));
+    }
+}
+
+static int
+gtp_frame_compare(const void *a, const void *b)
+{
+    guint32 fa = *(const guint32 *)a;
+    guint32 fb = *(const guint32 *)b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+wmem_array_t *
+gtp_subscriber_frames(wmem_allocator_t *scope, const gchar *imsi)
+{
+    wmem_array_t *sessions, *frames, *all, *result;
+    guint32 *data;
+    guint i, count;
+
+    if (!gtp_imsi_sessions || !imsi)
+        return NULL;
+
+    sessions = (wmem_array_t *)wmem_map_lookup(gtp_imsi_sessions, imsi);
+    if (!sessions)
+        return NULL;
+
+    all = wmem_array_new(scope, sizeof(guint32));
+    for (i = 0; i < wmem_array_get_count(sessions); i++) {
+        guint32 session = *(guint32 *)wmem_array_index(sessions, i);
+
+        frames = (wmem_array_t *)wmem_map_lookup(gtp_session_frames, GUINT_TO_POINTER(session));
+        if (frames) {
+            wmem_array_append(all, wmem_array_get_raw(frames), wmem_array_get_count(frames));
+        }
+    }
+
+    /* Sessions interleave in time, and a frame may belong to several */
+    wmem_array_sort(all, gtp_frame_compare);
+    count = wmem_array_get_count(all);
+    data = (guint32 *)wmem_array_get_raw(all);
+    result = wmem_array_sized_new(scope, sizeof(guint32), count);
+    for (i = 0; i < count; i++) {
+        if (i == 0 || data[i - 1] != data[i])
+            wmem_array_append_one(result, data[i]);
+    }
+    wmem_destroy_array(all);
+
+    return result;
 }
 
 gboolean
@@ -4480,10 +4590,11 @@ decode_gtp_cause(tvbuff_t * tvb, int offset, packet_info * pinfo _U_, proto_tree
 static int
 decode_gtp_imsi(tvbuff_t * tvb, int offset, packet_info * pinfo, proto_tree * tree, session_args_t * args _U_)
 {
-    /* const gchar *imsi_str; */
+    const gchar *imsi_str;
 
     /* Octets 2 - 9 IMSI */
-    /* imsi_str = */ dissect_e212_imsi(tvb, pinfo, tree,  offset+1, 8, FALSE);
+    imsi_str = dissect_e212_imsi(tvb, pinfo, tree,  offset+1, 8, FALSE);
+    gtp_session_set_imsi(pinfo, imsi_str);
 
     return 9;
 }
@@ -12838,6 +12949,10 @@ proto_register_gtp(void)
     gtp_cdr_fmt_dissector_table = register_dissector_table("gtp.cdr_fmt", "GTP Data Record Type", proto_gtp, FT_UINT16, BASE_DEC);
     gtp_hdr_ext_dissector_table = register_dissector_table("gtp.hdr_ext", "GTP Header Extension", proto_gtp, FT_UINT16, BASE_DEC);
 
+    gtp_imsi_sessions = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), wmem_str_hash, g_str_equal);
+    gtp_session_frames = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), g_direct_hash, g_direct_equal);
+    gtp_pending_imsi = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), g_direct_hash, g_direct_equal);
+
     register_init_routine(gtp_init);
     register_cleanup_routine(gtp_cleanup);
     gtp_tap = register_tap("gtp");
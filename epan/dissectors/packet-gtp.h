@@ -9,6 +9,9 @@
 
 #ifndef __PACKET_GTP_H
 #define __PACKET_GTP_H
+
+#include "ws_symbol_export.h"
+
 /*structure used to track responses to requests using sequence number*/
 typedef struct gtp_msg_hash_entry {
     gboolean is_request;    /*TRUE/FALSE*/
@@ -172,6 +175,20 @@ void remove_frame_info(guint32 *f);
 
 void add_gtp_session(guint32 frame, guint32 session);
 
+/* Record the IMSI carried by the current frame, linking it to the frame's
+ * session once that is known. Only acts during the first pass. */
+void gtp_session_set_imsi(packet_info *pinfo, const gchar *imsi);
+
+/** Return the frames of every session seen for a subscriber, in ascending
+ * order and without duplicates, or NULL if the IMSI is unknown. Requires
+ * the "gtp.track_gtp_session" preference; the index is built during the
+ * first pass, so no frame has to be dissected again to answer.
+ *
+ * @param scope allocator for the returned array of guint32 frame numbers
+ * @param imsi  the subscriber's IMSI as displayed by the dissector
+ */
+WS_DLL_PUBLIC wmem_array_t *gtp_subscriber_frames(wmem_allocator_t *scope, const gchar *imsi);
+
 gboolean teid_exists(guint32 teid, wmem_list_t *teid_list);
 
 gboolean ip_exists(address ip, wmem_list_t *ip_list);
@@ -1580,6 +1580,7 @@ dissect_gtpv2_imsi(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree, prot
      */
     imsi_str =  dissect_e212_imsi(tvb, pinfo, tree,  offset, length, FALSE);
     proto_item_append_text(item, "%s", imsi_str);
+    gtp_session_set_imsi(pinfo, imsi_str);
 
 }
 
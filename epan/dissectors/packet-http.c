@@ -253,6 +253,12 @@ static gboolean http_dechunk_body = TRUE;
  */
 #if defined(HAVE_ZLIB) || defined(HAVE_BROTLI)
 static gboolean http_decompress_body = TRUE;
+
+/*
+ * Limit, in MiB, on the size of an uncompressed entity body; 0 means
+ * no limit.
+ */
+static guint http_decompress_max_mib = 0;
 #endif
 
 /* Simple Service Discovery Protocol
@@ -3885,6 +3891,9 @@ static void reinit_http(void) {
 	wmem_free(wmem_epan_scope(), http_tls_range);
 	http_tls_range = range_copy(wmem_epan_scope(), global_http_tls_range);
 	range_foreach(http_tls_range, range_add_http_tls_callback, NULL);
+
+	tvb_set_uncompress_max_length(http_decompress_max_mib > G_MAXUINT / (1024 * 1024) ?
+	    G_MAXUINT : http_decompress_max_mib * 1024 * 1024);
 }
 
 void
@@ -4251,6 +4260,12 @@ proto_register_http(void)
 	    "Whether to uncompress entity bodies that are compressed "
 	    "using \"Content-Encoding: \"",
 	    &http_decompress_body);
+	prefs_register_uint_preference(http_module, "decompress_max_mib",
+	    "Maximum uncompressed body size (MiB)",
+	    "Uncompressed data beyond this many MiB is discarded, as if "
+	    "the compressed body had been truncated there. "
+	    "0 means no limit.",
+	    10, &http_decompress_max_mib);
 #endif
 	prefs_register_obsolete_preference(http_module, "tcp_alternate_port");
 
@@ -4282,6 +4297,8 @@ proto_register_http(void)
 			      header_fields_reset_cb,
 			      custom_header_uat_fields
 	);
+	/* The header fields are registered when HTTP or an http.header.* field is first used */
+	uat_set_deferred_load(headers_uat, proto_http);
 
 	prefs_register_uat_preference(http_module, "custom_http_header_fields", "Custom HTTP header fields",
 	    "A table to define custom HTTP header for which fields can be setup and used for filtering/data extraction etc.",
@@ -117,10 +117,8 @@ typedef struct {
     gint length;
     union {
         struct {
-            /* header data */
-            char *data;
-            /* length of data */
-            guint datalen;
+            /* index of the header data in http2_hdrcache_strings */
+            guint32 str_idx;
             /* name index or name/value index if type is one of
                HTTP2_HD_INDEXED and HTTP2_HD_*_INDEXED_NAMEs */
             guint idx;
@@ -542,6 +540,10 @@ static const fragment_items http2_body_fragment_items = {
    wmem_map_t to reuse its memory region when we see the same header
    field next time. */
 static wmem_map_t *http2_hdrcache_map = NULL;
+/* The distinct header fields, in order of appearance.  The map above
+   holds the index of each one plus one, and decoded header blocks
+   only keep these indexes. */
+static wmem_array_t *http2_hdrcache_strings = NULL;
 /* Header name_length + name + value_length + value */
 static char *http2_header_pstr = NULL;
 #endif
@@ -1303,6 +1305,7 @@ hd_inflate_del_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_, vo
 {
     nghttp2_hd_inflate_del((nghttp2_hd_inflater*)user_data);
     http2_hdrcache_map = NULL;
+    http2_hdrcache_strings = NULL;
     http2_header_pstr = NULL;
 
     return FALSE;
@@ -1628,15 +1631,13 @@ process_http2_header_repr_info(wmem_array_t *headers,
 
         if(header_repr_info->complete) {
             if(header_repr_info->type == HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
-                http2_header_t *out;
+                http2_header_t out;
 
-                out = wmem_new(wmem_file_scope(), http2_header_t);
+                out.type = header_repr_info->type;
+                out.length = i - start;
+                out.table.header_table_size = header_repr_info->integer;
 
-                out->type = header_repr_info->type;
-                out->length = i - start;
-                out->table.header_table_size = header_repr_info->integer;
-
-                wmem_array_append(headers, out, 1);
+                wmem_array_append_one(headers, out);
 
                 reset_http2_header_repr_info(header_repr_info);
                 /* continue to decode header table size update or
@@ -1678,6 +1679,28 @@ static gboolean http2_hdrcache_equal(gconstpointer lhs, gconstpointer rhs)
     return alen == blen && memcmp(a, b, alen) == 0;
 }
 
+/* Returns the index of the header field in http2_header_pstr in
+   http2_hdrcache_strings, taking over the buffer if it is new. */
+static guint32 http2_hdrcache_intern(void)
+{
+    guint32 idx;
+
+    idx = GPOINTER_TO_UINT(wmem_map_lookup(http2_hdrcache_map, http2_header_pstr));
+    if (idx == 0) {
+        wmem_array_append_one(http2_hdrcache_strings, http2_header_pstr);
+        idx = wmem_array_get_count(http2_hdrcache_strings);
+        wmem_map_insert(http2_hdrcache_map, http2_header_pstr, GUINT_TO_POINTER(idx));
+        http2_header_pstr = NULL;
+    }
+
+    return idx - 1;
+}
+
+static const char *http2_hdrcache_get(guint32 idx)
+{
+    return *(const char **)wmem_array_index(http2_hdrcache_strings, idx);
+}
+
 static int
 is_in_header_context(tvbuff_t *tvb, packet_info *pinfo, http2_session_t* h2session)
 {
@@ -1933,7 +1956,7 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
     const guint8 *header_value;
     int hoffset = 0;
     nghttp2_hd_inflater *hd_inflater;
-    tvbuff_t *header_tvb = tvb_new_composite();
+    tvbuff_t *header_tvb;
     int rv;
     int header_len = 0;
     int final;
@@ -1949,7 +1972,8 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
     gchar *header_unescaped = NULL;
 
     if (!http2_hdrcache_map) {
-        http2_hdrcache_map = wmem_map_new(wmem_file_scope(), http2_hdrcache_hash, http2_hdrcache_equal);
+        http2_hdrcache_map = wmem_map_new_flat(wmem_file_scope(), http2_hdrcache_hash, http2_hdrcache_equal);
+        http2_hdrcache_strings = wmem_array_new(wmem_file_scope(), sizeof(char *));
     }
 
     header_data = (http2_header_data_t*)p_get_proto_data(wmem_file_scope(), pinfo, proto_http2, 0);
@@ -2001,10 +2025,9 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
             rv -= process_http2_header_repr_info(headers, header_repr_info, headbuf - rv, rv);
 
             if(inflate_flags & NGHTTP2_HD_INFLATE_EMIT) {
-                char *cached_pstr;
                 guint32 len;
                 guint datalen = (guint)(4 + nv.namelen + 4 + nv.valuelen);
-                http2_header_t *out;
+                http2_header_t out;
 
                 if (decompressed_bytes + datalen >= MAX_HTTP2_HEADER_SIZE) {
                     header_data->header_size_reached = decompressed_bytes;
@@ -2012,13 +2035,10 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
                     break;
                 }
 
-                out = wmem_new(wmem_file_scope(), http2_header_t);
-
-                out->type = header_repr_info->type;
-                out->length = rv;
-                out->table.data.idx = header_repr_info->integer;
+                out.type = header_repr_info->type;
+                out.length = rv;
+                out.table.data.idx = header_repr_info->integer;
 
-                out->table.data.datalen = datalen;
                 decompressed_bytes += datalen;
 
                 /* Prepare buffer... with the following format
@@ -2027,7 +2047,7 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
                    value length (uint32)
                    value (string)
                 */
-                http2_header_pstr = (char *)wmem_realloc(wmem_file_scope(), http2_header_pstr, out->table.data.datalen);
+                http2_header_pstr = (char *)wmem_realloc(wmem_file_scope(), http2_header_pstr, datalen);
 
                 /* nv.namelen and nv.valuelen are of size_t.  In order
                    to get length in 4 bytes, we have to copy it to
@@ -2040,16 +2060,9 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
                 phton32(&http2_header_pstr[4 + nv.namelen], len);
                 memcpy(&http2_header_pstr[4 + nv.namelen + 4], nv.value, nv.valuelen);
 
-                cached_pstr = (char *)wmem_map_lookup(http2_hdrcache_map, http2_header_pstr);
-                if (cached_pstr) {
-                    out->table.data.data = cached_pstr;
-                } else {
-                    wmem_map_insert(http2_hdrcache_map, http2_header_pstr, http2_header_pstr);
-                    out->table.data.data = http2_header_pstr;
-                    http2_header_pstr = NULL;
-                }
+                out.table.data.str_idx = http2_hdrcache_intern();
 
-                wmem_array_append(headers, out, 1);
+                wmem_array_append_one(headers, out);
 
                 reset_http2_header_repr_info(header_repr_info);
             }
@@ -2091,9 +2104,13 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
         return;
     }
 
+    header_tvb = tvb_new_composite();
+
     for(i = 0; i < wmem_array_get_count(headers); ++i) {
         http2_header_t *in;
         tvbuff_t *next_tvb;
+        const char *data;
+        guint datalen;
 
         in = (http2_header_t*)wmem_array_index(headers, i);
 
@@ -2101,10 +2118,12 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
             continue;
         }
 
-        header_len += in->table.data.datalen;
+        data = http2_hdrcache_get(in->table.data.str_idx);
+        datalen = (guint)http2_hdrcache_length(data);
+        header_len += datalen;
 
         /* Now setup the tvb buffer to have the new data */
-        next_tvb = tvb_new_child_real_data(tvb, in->table.data.data, in->table.data.datalen, in->table.data.datalen);
+        next_tvb = tvb_new_child_real_data(tvb, data, datalen, datalen);
         tvb_composite_append(header_tvb, next_tvb);
     }
 
@@ -3138,7 +3157,7 @@ get_real_header_value(packet_info* pinfo, const gchar* name, gboolean the_other_
     guint32 name_len;
     guint32 value_len;
     http2_header_t *hdr;
-    gchar* data;
+    const gchar* data;
 
     conversation_t* conversation = find_or_create_conversation(pinfo);
     header_stream_info = get_header_stream_info(pinfo, get_http2_session(pinfo, conversation), the_other_direction);
@@ -3167,17 +3186,12 @@ get_real_header_value(packet_info* pinfo, const gchar* name, gboolean the_other_
                    value length (uint32)
                    value (string)
             */
-            data = (gchar*) hdr->table.data.data;
+            data = http2_hdrcache_get(hdr->table.data.str_idx);
             name_len = pntoh32(data);
             if (strlen(name) == name_len && strncmp(data + 4, name, name_len) == 0) {
                 value_len = pntoh32(data + 4 + name_len);
-                if (4 + name_len + 4 + value_len == hdr->table.data.datalen) {
-                    /* return value */
-                    return wmem_strndup(pinfo->pool, data + 4 + name_len + 4, value_len);
-                }
-                else {
-                    return NULL; /* unexpected error */
-                }
+                /* return value */
+                return wmem_strndup(pinfo->pool, data + 4 + name_len + 4, value_len);
             }
         }
     }
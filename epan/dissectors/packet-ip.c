@@ -60,6 +60,10 @@ static gboolean g_ip_dscp_actif = TRUE;
 /* Defragment fragmented IP datagrams */
 static gboolean ip_defragment = TRUE;
 
+/* Limits on the datagrams being reassembled, so fragment floods stay bounded */
+static guint ip_reassembly_max_pending = 100000;
+static guint ip_reassembly_timeout = 60;
+
 /* Place IP summary in proto tree */
 static gboolean ip_summary_in_tree = TRUE;
 
@@ -2437,6 +2441,13 @@ dissect_ip_heur(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data
     return TRUE;
 }
 
+static void
+apply_ip_prefs(void)
+{
+  reassembly_table_set_limits(&ip_reassembly_table, ip_reassembly_max_pending,
+                              ip_reassembly_timeout);
+}
+
 void
 proto_register_ip(void)
 {
@@ -2951,7 +2962,7 @@ proto_register_ip(void)
   register_capture_dissector_table("ip.proto", "IP protocol");
 
   /* Register configuration options */
-  ip_module = prefs_register_protocol(proto_ip, NULL);
+  ip_module = prefs_register_protocol(proto_ip, apply_ip_prefs);
   prefs_register_bool_preference(ip_module, "decode_tos_as_diffserv",
     "Decode IPv4 TOS field as DiffServ field",
     "Whether the IPv4 type-of-service field should be decoded as a "
@@ -2959,6 +2970,17 @@ proto_register_ip(void)
   prefs_register_bool_preference(ip_module, "defragment",
     "Reassemble fragmented IPv4 datagrams",
     "Whether fragmented IPv4 datagrams should be reassembled", &ip_defragment);
+  prefs_register_uint_preference(ip_module, "reassembly_max_pending",
+    "Maximum datagrams being reassembled",
+    "The most fragmented IPv4 datagrams to hold on to while waiting for "
+    "their remaining fragments; the least recently seen are given up on "
+    "first (0 for no limit)",
+    10, &ip_reassembly_max_pending);
+  prefs_register_uint_preference(ip_module, "reassembly_timeout",
+    "Reassembly timeout (seconds)",
+    "How long after its first fragment to give up on reassembling an "
+    "IPv4 datagram (0 to wait until the end of the capture)",
+    10, &ip_reassembly_timeout);
   prefs_register_bool_preference(ip_module, "summary_in_tree",
     "Show IPv4 summary in protocol tree",
     "Whether the IPv4 summary line should be shown in the protocol tree",
@@ -2986,6 +3008,7 @@ proto_register_ip(void)
   ip_handle = register_dissector("ip", dissect_ip, proto_ip);
   reassembly_table_register(&ip_reassembly_table,
                         &addresses_reassembly_table_functions);
+  apply_ip_prefs();
   ip_tap = register_tap("ip");
 
   register_decode_as(&ip_da);
@@ -68,6 +68,7 @@ ADD: Additional generic (non-checked) ICV length of 128, 192 and 256.
 #include <epan/proto_data.h>
 #include <epan/decode_as.h>
 #include <epan/capture_dissectors.h>
+#include <epan/secrets.h>
 
 #include <stdio.h>    /* for sscanf() */
 #include <epan/uat.h>
@@ -266,6 +267,36 @@ typedef struct {
 
 static uat_esp_sa_record_t *uat_esp_sa_records = NULL;
 
+/* Result of decrypting an ESP payload, kept with the frame so that later
+ * passes over it (filtering, selecting the packet) do not decrypt again. */
+typedef struct {
+  guint8 *data;
+  gint len;
+  gboolean icv_checked;
+  gboolean icv_correct;
+  gchar *icv_expected;
+} esp_decrypted_t;
+
+/*
+ * Identifies what a payload decrypted for the secrets cache depends on besides
+ * the packet bytes: the algorithms (the ICV length changes the ciphertext
+ * length), the key with its salt, and whether the AEAD tag was verified, as
+ * only payloads with a verified (or unchecked) tag are cached.
+ */
+static guint8 *
+esp_secret_id(wmem_allocator_t *scope, gint encr_algo, gint auth_algo, gboolean aead_check,
+              const gchar *key, guint key_len, guint *id_len)
+{
+  guint8 *id = (guint8 *)wmem_alloc(scope, 3 + key_len);
+
+  id[0] = (guint8)encr_algo;
+  id[1] = (guint8)auth_algo;
+  id[2] = aead_check;
+  memcpy(id + 3, key, key_len);
+  *id_len = 3 + key_len;
+  return id;
+}
+
 /* Extra SA records that may be set programmatically */
 /* 'records' array is now allocated on the heap */
 #define MAX_EXTRA_SA_RECORDS 16
@@ -536,6 +567,9 @@ static gboolean g_esp_enable_encryption_decode = FALSE;
 /* Default ESP payload Authentication Checking to off */
 static gboolean g_esp_enable_authentication_check = FALSE;
 
+/* Keep decrypted payloads when the packets are redissected */
+static gboolean g_esp_keep_decrypted = TRUE;
+
 /**************************************************/
 /* Sequence number analysis                       */
 
@@ -1313,6 +1347,10 @@ dissect_esp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
   guint8 *esp_decr_data = NULL;
   guint8 *esp_icv = NULL;
   tvbuff_t *tvb_decrypted = NULL;
+  esp_decrypted_t *decrypted = NULL;
+  guint8 *secret_id = NULL;
+  guint secret_id_len = 0;
+  gboolean aead_check = FALSE;
 
   /* IPSEC encryption Variables related */
   gint protocol_typ = IPSEC_SA_UNKNOWN;
@@ -1947,6 +1985,43 @@ dissect_esp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
         }
 
         if (decrypt_using_libgcrypt)
+        {
+          decrypted = (esp_decrypted_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_esp, pinfo->curr_layer_num);
+
+          if (!decrypted && g_esp_keep_decrypted)
+          {
+            const guint8 *cached;
+            guint cached_len;
+
+            aead_check = g_esp_enable_authentication_check && icv_type == ICV_TYPE_AEAD;
+            secret_id = esp_secret_id(pinfo->pool, esp_encr_algo, esp_auth_algo, aead_check,
+                                      esp_encr_key, esp_encr_key_len + esp_salt_len, &secret_id_len);
+            cached = secrets_cache_lookup(proto_esp, pinfo->num, pinfo->curr_layer_num,
+                                          secret_id, secret_id_len, &cached_len);
+            if (cached)
+            {
+              /* Decrypted before the last redissection */
+              decrypted = wmem_new0(wmem_file_scope(), esp_decrypted_t);
+              decrypted->data = (guint8 *)cached;
+              decrypted->len = (gint)cached_len;
+              decrypted->icv_checked = aead_check ? TRUE : icv_checked;
+              decrypted->icv_correct = aead_check ? TRUE : icv_correct;
+              p_add_proto_data(wmem_file_scope(), pinfo, proto_esp, pinfo->curr_layer_num, decrypted);
+            }
+          }
+        }
+
+        if (decrypted)
+        {
+          /* Decrypted on an earlier pass */
+          esp_decr_data = decrypted->data;
+          esp_decr_data_len = decrypted->len;
+          icv_checked = decrypted->icv_checked;
+          icv_correct = decrypted->icv_correct;
+          esp_icv_expected = decrypted->icv_expected;
+          decrypt_ok = TRUE;
+        }
+        else if (decrypt_using_libgcrypt)
         {
           /*
            * Allocate buffer for decrypted data.
@@ -2082,6 +2157,20 @@ dissect_esp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
               }
             }
 #endif
+
+            decrypted = wmem_new(wmem_file_scope(), esp_decrypted_t);
+            if (secret_id && (!icv_checked || icv_correct)) {
+              decrypted->data = (guint8 *)secrets_cache_add(proto_esp, pinfo->num, pinfo->curr_layer_num,
+                                                            secret_id, secret_id_len,
+                                                            esp_decr_data, esp_decr_data_len);
+            } else {
+              decrypted->data = (guint8 *)wmem_memdup(wmem_file_scope(), esp_decr_data, esp_decr_data_len);
+            }
+            decrypted->len = esp_decr_data_len;
+            decrypted->icv_checked = icv_checked;
+            decrypted->icv_correct = icv_correct;
+            decrypted->icv_expected = wmem_strdup(wmem_file_scope(), esp_icv_expected);
+            p_add_proto_data(wmem_file_scope(), pinfo, proto_esp, pinfo->curr_layer_num, decrypted);
           }
         }
       }
@@ -2509,6 +2598,13 @@ proto_register_ipsec(void)
                                  "Attempt to Check ESP Authentication based on the SAD described hereafter.",
                                  &g_esp_enable_authentication_check);
 
+  prefs_register_bool_preference(esp_module, "keep_decrypted",
+                                 "Keep decrypted payloads across redissections",
+                                 "Keep the payloads decrypted with the SAD until the capture file is closed, "
+                                 "so that changing a preference does not decrypt them again. "
+                                 "A changed SA key or algorithm is decrypted again.",
+                                 &g_esp_keep_decrypted);
+
   esp_uat = uat_new("ESP SAs",
             sizeof(uat_esp_sa_record_t),    /* record size */
             "esp_sa",                       /* filename */
@@ -2523,6 +2619,7 @@ proto_register_ipsec(void)
             NULL,                           /* post update callback */
             NULL,                           /* reset callback */
             esp_uat_flds);                  /* UAT field definitions */
+  uat_set_deferred_load(esp_uat, proto_esp);
 
   prefs_register_uat_preference(esp_module,
                                 "sa_table",
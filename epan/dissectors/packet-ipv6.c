@@ -606,6 +606,10 @@ static dissector_table_t ipv6_routing_dissector_table;
 /* Reassemble fragmented datagrams */
 static gboolean ipv6_reassemble = TRUE;
 
+/* Limits on the datagrams being reassembled, so fragment floods stay bounded */
+static guint ipv6_reassembly_max_pending = 100000;
+static guint ipv6_reassembly_timeout = 60;
+
 /* Place IPv6 summary in proto tree */
 static gboolean ipv6_summary_in_tree = TRUE;
 
@@ -3090,6 +3094,13 @@ ipv6_dissect_next(guint nxt, tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree
     call_data_dissector(tvb, pinfo, tree);
 }
 
+static void
+apply_ipv6_prefs(void)
+{
+    reassembly_table_set_limits(&ipv6_reassembly_table, ipv6_reassembly_max_pending,
+                                ipv6_reassembly_timeout);
+}
+
 void
 proto_register_ipv6(void)
 {
@@ -4453,11 +4464,22 @@ proto_register_ipv6(void)
     proto_register_subtree_array(ett_ipv6_dstopts, array_length(ett_ipv6_dstopts));
 
     /* Register configuration options */
-    ipv6_module = prefs_register_protocol(proto_ipv6, NULL);
+    ipv6_module = prefs_register_protocol(proto_ipv6, apply_ipv6_prefs);
     prefs_register_bool_preference(ipv6_module, "defragment",
                                    "Reassemble fragmented IPv6 datagrams",
                                    "Whether fragmented IPv6 datagrams should be reassembled",
                                    &ipv6_reassemble);
+    prefs_register_uint_preference(ipv6_module, "reassembly_max_pending",
+                                   "Maximum datagrams being reassembled",
+                                   "The most fragmented IPv6 datagrams to hold on to while waiting for "
+                                   "their remaining fragments; the least recently seen are given up on "
+                                   "first (0 for no limit)",
+                                   10, &ipv6_reassembly_max_pending);
+    prefs_register_uint_preference(ipv6_module, "reassembly_timeout",
+                                   "Reassembly timeout (seconds)",
+                                   "How long after its first fragment to give up on reassembling an "
+                                   "IPv6 datagram (0 to wait until the end of the capture)",
+                                   10, &ipv6_reassembly_timeout);
     prefs_register_bool_preference(ipv6_module, "summary_in_tree",
                                    "Show IPv6 summary in protocol tree",
                                    "Whether the IPv6 summary line should be shown in the protocol tree",
@@ -4496,6 +4518,7 @@ proto_register_ipv6(void)
     ipv6_handle = register_dissector("ipv6", dissect_ipv6, proto_ipv6);
     reassembly_table_register(&ipv6_reassembly_table,
                           &addresses_reassembly_table_functions);
+    apply_ipv6_prefs();
     ipv6_tap = register_tap("ipv6");
 
     register_decode_as(&ipv6_da);
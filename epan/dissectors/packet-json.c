@@ -15,12 +15,12 @@
 #include "config.h"
 
 #include <epan/packet.h>
-#include <epan/tvbparse.h>
 #include <epan/proto_data.h>
 #include <wsutil/wsjson.h>
 
 #include <wsutil/str_util.h>
 #include <wsutil/unicode-utils.h>
+#include <wsutil/ws_mempbrk.h>
 
 #include <wiretap/wtap.h>
 
@@ -31,7 +31,6 @@
 
 void proto_register_json(void);
 void proto_reg_handoff_json(void);
-static char* json_string_unescape(tvbparse_elem_t *tok, gboolean enclose_in_quotation_marks);
 
 
 static dissector_handle_t json_handle;
@@ -203,8 +202,10 @@ static gboolean ignore_leading_bytes = FALSE;
 
 static gboolean hide_extended_path_based_filtering = FALSE;
 
-static tvbparse_wanted_t* want;
-static tvbparse_wanted_t* want_ignore;
+static gboolean skip_unreferenced = FALSE;
+
+/* The characters that end a run of plain characters in a string */
+static ws_mempbrk_pattern json_string_pbrk;
 
 static dissector_handle_t text_lines_handle;
 
@@ -219,10 +220,25 @@ typedef enum {
 
 	/* not really tokens ... */
 	JSON_OBJECT,
-	JSON_ARRAY
+	JSON_ARRAY,
+	JSON_MEMBER
 
 } json_token_type_t;
 
+/*
+ * A token found by json_tokenize(). Objects, arrays and members (a key
+ * string token follows each member) span everything up to their end, and
+ * next is the index of the token after them, so the tokens can be walked
+ * as a tree without looking at the bytes again.
+ */
+typedef struct {
+	tvbuff_t *tvb;
+	int offset;
+	int len;
+	json_token_type_t id;
+	guint next;
+} json_token_t;
+
 typedef struct {
 	wmem_stack_t *stack;
 	wmem_stack_t *stack_compact; /* Used for compact json form only */
@@ -239,9 +255,9 @@ typedef struct {
 #define JSON_COMPACT_OBJECT_WITHOUT_KEY -1
 #define JSON_COMPACT_ARRAY 0
 
-#define JSON_ARRAY_BEGIN(json_tvbparse_data) wmem_stack_push(json_tvbparse_data->array_idx, GINT_TO_POINTER(JSON_COMPACT_ARRAY))
-#define JSON_OBJECT_BEGIN(json_tvbparse_data) wmem_stack_push(json_tvbparse_data->array_idx, GINT_TO_POINTER(JSON_COMPACT_OBJECT_WITHOUT_KEY))
-#define JSON_ARRAY_OBJECT_END(json_tvbparse_data) wmem_stack_pop(json_tvbparse_data->array_idx)
+#define JSON_ARRAY_BEGIN(data) wmem_stack_push(data->array_idx, GINT_TO_POINTER(JSON_COMPACT_ARRAY))
+#define JSON_OBJECT_BEGIN(data) wmem_stack_push(data->array_idx, GINT_TO_POINTER(JSON_COMPACT_OBJECT_WITHOUT_KEY))
+#define JSON_ARRAY_OBJECT_END(data) wmem_stack_pop(data->array_idx)
 #define JSON_INSIDE_ARRAY(idx) (idx >= JSON_COMPACT_ARRAY)
 #define JSON_OBJECT_SET_HAS_KEY(idx) (idx == JSON_COMPACT_OBJECT_WITH_KEY)
 
@@ -261,7 +277,7 @@ json_object_add_key(json_parser_data_t *data)
 }
 
 static char*
-json_string_unescape(tvbparse_elem_t* tok, gboolean enclose_in_quotation_marks)
+json_string_unescape(json_token_t* tok, gboolean enclose_in_quotation_marks)
 {
 	int read_index = 0;
 
@@ -529,7 +545,7 @@ json_string_unescape(tvbparse_elem_t* tok, gboolean enclose_in_quotation_marks)
 			}
 			else
 			{
-				/* not valid by JSON grammar (tvbparse rules should not allow it) */
+				/* not valid by JSON grammar (json_tokenize() should not allow it) */
 				DISSECTOR_ASSERT_NOT_REACHED();
 			}
 		}
@@ -548,7 +564,7 @@ json_string_unescape(tvbparse_elem_t* tok, gboolean enclose_in_quotation_marks)
 static GHashTable* header_fields_hash = NULL;
 
 static proto_item*
-json_key_lookup(proto_tree* tree, tvbparse_elem_t* tok, char* key_str, packet_info* pinfo, gboolean use_compact)
+json_key_lookup(proto_tree* tree, json_token_t* tok, char* key_str, packet_info* pinfo, gboolean use_compact)
 {
 	proto_item* ti;
 	int hf_id = -1;
@@ -602,6 +618,9 @@ join_strings(char* string_a, char* string_b, char separator)
 	return output_string;
 }
 
+static int json_tokenize(tvbuff_t *tvb, const guint8 *buf, int offset, int end, wmem_array_t *tokens);
+static void json_dissect_tokens(json_parser_data_t *data, wmem_array_t *tokens);
+
 static int
 dissect_json(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data)
 {
@@ -609,7 +628,10 @@ dissect_json(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data)
 	proto_item *ti = NULL;
 
 	json_parser_data_t parser_data;
-	tvbparse_t *tt;
+	const guint8 *buf;
+	wmem_array_t *tokens;
+	int end;
+	gboolean skip_tree;
 
 	http_message_info_t *message_info;
 	const char *data_name;
@@ -705,13 +727,26 @@ dissect_json(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data)
 		wmem_stack_push(parser_data.array_idx, GINT_TO_POINTER(JSON_COMPACT_TOP_ITEM)); /* top element */
 	}
 
-	tt = tvbparse_init(pinfo->pool, tvb, offset, buffer_length - offset, &parser_data, want_ignore);
+	/*
+	 * If nothing will look at the tree, we only need to know where the
+	 * JSON ends.
+	 */
+	skip_tree = skip_unreferenced &&
+		!proto_field_is_referenced(tree, proto_json) &&
+		!proto_field_is_referenced(tree, proto_json_3gpp);
 
-	/* XXX, only one json in packet? */
-	while (tvbparse_get(tt, want))
-	{ }
+	buf = tvb_get_ptr(tvb, 0, buffer_length);
 
-	offset = tvbparse_curr_offset(tt);
+	/* XXX, only one json in packet? */
+	for (;;) {
+		tokens = wmem_array_new(pinfo->pool, sizeof(json_token_t));
+		end = json_tokenize(tvb, buf, offset, buffer_length, tokens);
+		if (end < 0)
+			break;
+		if (!skip_tree)
+			json_dissect_tokens(&parser_data, tokens);
+		offset = end;
+	}
 
 	proto_item_set_len(ti, offset);
 
@@ -739,9 +774,7 @@ dissect_json_file(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* dat
 }
 
 static void
-before_object(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *tok) {
-	json_parser_data_t *data = (json_parser_data_t *) tvbparse_data;
-
+before_object(json_parser_data_t *data, json_token_t *tok) {
 	proto_tree *tree = (proto_tree *)wmem_stack_peek(data->stack);
 	proto_tree *subtree;
 	proto_item *ti;
@@ -772,9 +805,7 @@ before_object(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t
 }
 
 static void
-after_object(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *elem _U_) {
-	json_parser_data_t *data = (json_parser_data_t *) tvbparse_data;
-
+after_object(json_parser_data_t *data) {
 	wmem_stack_pop(data->stack);
 
 	if (json_compact) {
@@ -795,20 +826,18 @@ after_object(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *
 }
 
 static void
-before_member(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *tok) {
-	json_parser_data_t *data = (json_parser_data_t *) tvbparse_data;
-
+before_member(json_parser_data_t *data, json_token_t *tok, json_token_t *key_tok) {
 	proto_tree *tree = (proto_tree *)wmem_stack_peek(data->stack);
 	proto_tree *subtree;
 	proto_item *ti;
 
-	// tvb parse element covers the qutation marks which we don't want
-	tvbparse_elem_t key_parse_element = tok->sub[0];
+	// the key token covers the qutation marks which we don't want
+	json_token_t key_parse_element = *key_tok;
 	key_parse_element.offset += 1;
 	key_parse_element.len -= 2;
 	char* key_string_without_quotation_marks = json_string_unescape(&key_parse_element, FALSE);
 
-	char* key_string_with_quotation_marks = json_string_unescape(tok->sub, FALSE);
+	char* key_string_with_quotation_marks = json_string_unescape(key_tok, FALSE);
 
 	ti = proto_tree_add_string(tree, hf_json_member, tok->tvb, tok->offset, tok->len, key_string_without_quotation_marks);
 
@@ -830,8 +859,6 @@ before_member(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t
 		proto_tree *subtree_compact;
 		proto_item *ti_compact = NULL;
 
-		tvbparse_elem_t *key_tok = tok->sub;
-
 		if (key_tok && key_tok->id == JSON_TOKEN_STRING) {
 			ti_compact = json_key_lookup(tree_compact, tok, key_string_without_quotation_marks, data->pinfo, TRUE);
 			if (!ti_compact) {
@@ -847,15 +874,12 @@ before_member(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t
 }
 
 static void
-after_member(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *tok) {
-	json_parser_data_t *data = (json_parser_data_t *) tvbparse_data;
-
+after_member(json_parser_data_t *data, json_token_t *tok, json_token_t *key_tok) {
 	proto_tree *tree = (proto_tree *)wmem_stack_pop(data->stack);
 
-	tvbparse_elem_t* key_tok = tok->sub;
 	if (tree && key_tok && key_tok->id == JSON_TOKEN_STRING) {
 
-		tvbparse_elem_t key_parse_element = key_tok[0];
+		json_token_t key_parse_element = *key_tok;
 		key_parse_element.offset += 1;
 		key_parse_element.len -= 2;
 		char* key_string_without_quotation_marks = json_string_unescape(&key_parse_element, FALSE);
@@ -883,9 +907,7 @@ after_member(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *
 }
 
 static void
-before_array(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *tok) {
-	json_parser_data_t *data = (json_parser_data_t *) tvbparse_data;
-
+before_array(json_parser_data_t *data, json_token_t *tok) {
 	proto_tree *tree = (proto_tree *)wmem_stack_peek(data->stack);
 	proto_tree *subtree;
 	proto_item *ti;
@@ -915,9 +937,7 @@ before_array(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *
 }
 
 static void
-after_array(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *elem _U_) {
-	json_parser_data_t *data = (json_parser_data_t *) tvbparse_data;
-
+after_array(json_parser_data_t *data) {
 	wmem_stack_pop(data->stack);
 
 	// extended path based filtering
@@ -939,11 +959,9 @@ after_array(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *e
 }
 
 static void
-after_value(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *tok) {
-	json_parser_data_t *data = (json_parser_data_t *) tvbparse_data;
-
+after_value(json_parser_data_t *data, json_token_t *tok) {
 	proto_tree *tree = (proto_tree *)wmem_stack_peek(data->stack);
-	json_token_type_t value_id = tok->sub ? (json_token_type_t)tok->sub->id : JSON_TOKEN_INVALID;
+	json_token_type_t value_id = tok->id;
 
 	if (!(value_id == JSON_TOKEN_STRING || value_id == JSON_TOKEN_NUMBER || value_id == JSON_TOKEN_FALSE
 		|| value_id == JSON_TOKEN_NULL || value_id == JSON_TOKEN_TRUE || value_id == JSON_TOKEN_NAN))
@@ -958,8 +976,8 @@ after_value(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *t
 	char* value_str = NULL;
 	if (value_id == JSON_TOKEN_STRING && tok->len >= 2)
 	{
-		// tvb parse element covers the qutation marks which we don't want
-		tvbparse_elem_t key_parse_element = tok[0];
+		// the token covers the qutation marks which we don't want
+		json_token_t key_parse_element = *tok;
 		key_parse_element.offset += 1;
 		key_parse_element.len -= 2;
 
@@ -1052,139 +1070,336 @@ after_value(void *tvbparse_data, const void *wanted_data _U_, tvbparse_elem_t *t
 	}
 }
 
-static void
-init_json_parser(void) {
-	static tvbparse_wanted_t _want_object;
-	static tvbparse_wanted_t _want_array;
-
-	tvbparse_wanted_t *want_object, *want_array;
-	tvbparse_wanted_t *want_member;
-	tvbparse_wanted_t *want_string;
-	tvbparse_wanted_t *want_number, *want_int;
-	tvbparse_wanted_t *want_value;
-	tvbparse_wanted_t *want_value_separator;
-
-#define tvbparse_optional(id, private_data, before_cb, after_cb, wanted) \
-	tvbparse_some(id, 0, 1, private_data, before_cb, after_cb, wanted)
-
-	tvbparse_wanted_t *want_quot = tvbparse_char(-1,"\"",NULL,NULL,NULL);
-
-	want_string = tvbparse_set_seq(JSON_TOKEN_STRING, NULL, NULL, NULL,
-			want_quot,
-			tvbparse_some(-1, 0, G_MAXINT, NULL, NULL, NULL,
-				tvbparse_set_oneof(-1, NULL, NULL, NULL,
-					tvbparse_not_chars(-1, 0, 0, "\"" "\\", NULL, NULL, NULL), /* XXX, without invalid unicode characters */
-					tvbparse_set_seq(-1, NULL, NULL, NULL,
-						tvbparse_char(-1, "\\", NULL, NULL, NULL),
-						tvbparse_set_oneof(-1, NULL, NULL, NULL,
-							tvbparse_chars(-1, 0, 1, "\"" "\\" "/bfnrt", NULL, NULL, NULL),
-							tvbparse_set_seq(-1, NULL, NULL, NULL,
-								tvbparse_char(-1, "u", NULL, NULL, NULL),
-								tvbparse_chars(-1, 4, 4, "0123456789abcdefABCDEF", NULL, NULL, NULL),
-								NULL),
-							NULL),
-						NULL),
-					NULL)
-				),
-			want_quot,
-			NULL);
-
-	want_value_separator = tvbparse_char(-1, ",", NULL, NULL, NULL);
+static inline int
+json_skip_ws(const guint8 *buf, int pos, int end)
+{
+	while (pos < end && (buf[pos] == ' ' || buf[pos] == '\t' || buf[pos] == '\r' || buf[pos] == '\n'))
+		pos++;
+	return pos;
+}
+
+/* Returns the offset just past the string whose opening quote is at pos, or -1 */
+static int
+json_scan_string(const guint8 *buf, int pos, int end)
+{
+	guchar found;
+	const guint8 *p;
+	int i;
+
+	pos++;
+	while (pos < end) {
+		/* Skip to the next quote or backslash, many bytes at a time */
+		p = ws_mempbrk_exec(buf + pos, end - pos, &json_string_pbrk, &found);
+		if (p == NULL)
+			return -1;
+		pos = (int)(p - buf);
+		if (found == '"')
+			return pos + 1;
+
+		if (pos + 1 >= end)
+			return -1;
+		switch (buf[pos + 1]) {
+			case '"': case '\\': case '/':
+			case 'b': case 'f': case 'n': case 'r': case 't':
+				pos += 2;
+				break;
+
+			case 'u':
+				if (pos + 6 > end)
+					return -1;
+				for (i = 2; i < 6; i++) {
+					if (!g_ascii_isxdigit(buf[pos + i]))
+						return -1;
+				}
+				pos += 6;
+				break;
+
+			default:
+				return -1;
+		}
+	}
+	return -1;
+}
+
+/* number = [ minus ] int [ frac ] [ exp ]; returns the offset just past it, or -1 */
+static int
+json_scan_number(const guint8 *buf, int pos, int end)
+{
+	int exp;
+
+	if (pos < end && buf[pos] == '-')
+		pos++;
+	if (pos >= end)
+		return -1;
 
 	/* int = zero / ( digit1-9 *DIGIT ) */
-	want_int = tvbparse_set_oneof(-1, NULL, NULL, NULL,
-			tvbparse_char(-1, "0", NULL, NULL, NULL),
-			tvbparse_set_seq(-1, NULL, NULL, NULL,
-				tvbparse_chars(-1, 1, 1, "123456789", NULL, NULL, NULL),
-				tvbparse_optional(-1, NULL, NULL, NULL, /* tvbparse_chars() don't respect 0 as min_len ;/ */
-					tvbparse_chars(-1, 0, 0, "0123456789", NULL, NULL, NULL)),
-				NULL),
-			NULL);
-
-	/* number = [ minus ] int [ frac ] [ exp ] */
-	want_number = tvbparse_set_seq(JSON_TOKEN_NUMBER, NULL, NULL, NULL,
-			tvbparse_optional(-1, NULL, NULL, NULL, /* tvbparse_chars() don't respect 0 as min_len ;/ */
-				tvbparse_chars(-1, 0, 1, "-", NULL, NULL, NULL)),
-			want_int,
-			/* frac = decimal-point 1*DIGIT */
-			tvbparse_optional(-1, NULL, NULL, NULL,
-				tvbparse_set_seq(-1, NULL, NULL, NULL,
-					tvbparse_char(-1, ".", NULL, NULL, NULL),
-					tvbparse_chars(-1, 1, 0, "0123456789", NULL, NULL, NULL),
-					NULL)),
-			/* exp = e [ minus / plus ] 1*DIGIT */
-			tvbparse_optional(-1, NULL, NULL, NULL,
-				tvbparse_set_seq(-1, NULL, NULL, NULL,
-					tvbparse_char(-1, "eE", NULL, NULL, NULL),
-					tvbparse_optional(-1, NULL, NULL, NULL, /* tvbparse_chars() don't respect 0 as min_len ;/ */
-						tvbparse_chars(-1, 0, 1, "-+", NULL, NULL, NULL)),
-					tvbparse_chars(-1, 1, 0, "0123456789", NULL, NULL, NULL),
-					NULL)),
-			NULL);
-
-	/* value = false / null / true / object / array / number / string */
-	want_value = tvbparse_set_oneof(-1, NULL, NULL, after_value,
-			tvbparse_string(JSON_TOKEN_FALSE, "false", NULL, NULL, NULL),
-			tvbparse_string(JSON_TOKEN_NULL, "null", NULL, NULL, NULL),
-			tvbparse_string(JSON_TOKEN_TRUE, "true", NULL, NULL, NULL),
-			tvbparse_string(JSON_TOKEN_NAN, "NaN", NULL, NULL, NULL),
-			&_want_object,
-			&_want_array,
-			want_number,
-			want_string,
-			NULL);
-
-	/* array = begin-array [ value *( value-separator value ) ] end-array */
-	want_array = tvbparse_set_seq(JSON_ARRAY, NULL, before_array, after_array,
-			tvbparse_char(-1, "[", NULL, NULL, NULL),
-			tvbparse_optional(-1, NULL, NULL, NULL,
-				tvbparse_set_seq(-1, NULL, NULL, NULL,
-					want_value,
-					tvbparse_some(-1, 0, G_MAXINT, NULL, NULL, NULL,
-						tvbparse_set_seq(-1, NULL, NULL, NULL,
-							want_value_separator,
-							want_value,
-							NULL)),
-					NULL)
-				),
-			tvbparse_char(-1, "]", NULL, NULL, NULL),
-			NULL);
-	_want_array = *want_array;
-
-	/* member = string name-separator value */
-	want_member = tvbparse_set_seq(-1, NULL, before_member, after_member,
-			want_string,
-			tvbparse_char(-1, ":", NULL, NULL, NULL),
-			want_value,
-			NULL);
-
-	/* object = begin-object [ member *( value-separator member ) ] end-object */
-	want_object = tvbparse_set_seq(JSON_OBJECT, NULL, before_object, after_object,
-			tvbparse_char(-1, "{", NULL, NULL, NULL),
-			tvbparse_optional(-1, NULL, NULL, NULL,
-				tvbparse_set_seq(-1, NULL, NULL, NULL,
-					want_member,
-					tvbparse_some(-1, 0, G_MAXINT, NULL, NULL, NULL,
-						tvbparse_set_seq(-1, NULL, NULL, NULL,
-							want_value_separator,
-							want_member,
-							NULL)),
-					NULL)
-				),
-			tvbparse_char(-1, "}", NULL, NULL, NULL),
-			NULL);
-	_want_object = *want_object;
-
-	want_ignore = tvbparse_chars(-1, 1, 0, " \t\r\n", NULL, NULL, NULL);
-
-	/* JSON-text = object / array */
-	want = tvbparse_set_oneof(-1, NULL, NULL, NULL,
-		want_object,
-		want_array,
-		/* tvbparse_not_chars(-1, 1, 0, " \t\r\n", NULL, NULL, NULL), */
-		NULL);
-
-	/* XXX, heur? */
+	if (buf[pos] == '0') {
+		pos++;
+	} else if (buf[pos] >= '1' && buf[pos] <= '9') {
+		do
+			pos++;
+		while (pos < end && g_ascii_isdigit(buf[pos]));
+	} else {
+		return -1;
+	}
+
+	/* frac = decimal-point 1*DIGIT */
+	if (pos + 1 < end && buf[pos] == '.' && g_ascii_isdigit(buf[pos + 1])) {
+		pos += 2;
+		while (pos < end && g_ascii_isdigit(buf[pos]))
+			pos++;
+	}
+
+	/* exp = e [ minus / plus ] 1*DIGIT */
+	if (pos < end && (buf[pos] == 'e' || buf[pos] == 'E')) {
+		exp = pos + 1;
+		if (exp < end && (buf[exp] == '-' || buf[exp] == '+'))
+			exp++;
+		if (exp < end && g_ascii_isdigit(buf[exp])) {
+			pos = exp + 1;
+			while (pos < end && g_ascii_isdigit(buf[pos]))
+				pos++;
+		}
+	}
+
+	return pos;
+}
+
+static int
+json_scan_literal(const guint8 *buf, int pos, int end, const char *literal)
+{
+	int len = (int)strlen(literal);
+
+	if (end - pos < len || memcmp(buf + pos, literal, len) != 0)
+		return -1;
+	return pos + len;
+}
+
+static guint
+json_add_token(wmem_array_t *tokens, tvbuff_t *tvb, json_token_type_t id, int offset, int len)
+{
+	json_token_t tok;
+	guint idx = wmem_array_get_count(tokens);
+
+	tok.tvb = tvb;
+	tok.offset = offset;
+	tok.len = len;
+	tok.id = id;
+	tok.next = idx + 1;
+	wmem_array_append_one(tokens, tok);
+
+	return idx;
+}
+
+/* Finish the innermost open object, array or member, which ends just before end */
+static json_token_t *
+json_close_token(wmem_array_t *tokens, wmem_stack_t *open, int end)
+{
+	json_token_t *tok = (json_token_t *)wmem_array_index(tokens, GPOINTER_TO_UINT(wmem_stack_pop(open)));
+
+	tok->len = end - tok->offset;
+	tok->next = wmem_array_get_count(tokens);
+
+	return tok;
+}
+
+static json_token_t *
+json_open_token(wmem_array_t *tokens, wmem_stack_t *open)
+{
+	return (json_token_t *)wmem_array_index(tokens, GPOINTER_TO_UINT(wmem_stack_peek(open)));
+}
+
+/*
+ * Find the JSON text (an object or an array) that starts, after any white
+ * space, at offset, appending its tokens to tokens in document order.
+ * Runs of plain characters in strings, where most of the bytes usually
+ * are, are skipped with ws_mempbrk_exec() rather than looked at one by
+ * one. Returns the offset just past the text, or -1 if there isn't a
+ * complete, valid one there.
+ */
+static int
+json_tokenize(tvbuff_t *tvb, const guint8 *buf, int offset, int end, wmem_array_t *tokens)
+{
+	enum { EXPECT_VALUE, EXPECT_FIRST_VALUE, EXPECT_KEY, EXPECT_FIRST_KEY, EXPECT_SEPARATOR } expect;
+	wmem_stack_t *open = wmem_stack_new(wmem_packet_scope());
+	json_token_type_t id;
+	json_token_t *tok;
+	int pos, value_end = -1;
+
+	pos = json_skip_ws(buf, offset, end);
+	if (pos >= end || (buf[pos] != '{' && buf[pos] != '['))
+		return -1;
+
+	expect = EXPECT_VALUE;
+	for (;;) {
+		pos = json_skip_ws(buf, pos, end);
+		if (pos >= end)
+			return -1;
+
+		switch (expect) {
+			case EXPECT_FIRST_KEY:
+				if (buf[pos] == '}') {
+					value_end = pos + 1;
+					json_close_token(tokens, open, value_end);
+					break;
+				}
+				/* FALL THROUGH */
+			case EXPECT_KEY:
+				if (buf[pos] != '"')
+					return -1;
+				wmem_stack_push(open, GUINT_TO_POINTER(json_add_token(tokens, tvb, JSON_MEMBER, pos, 0)));
+				value_end = json_scan_string(buf, pos, end);
+				if (value_end < 0)
+					return -1;
+				json_add_token(tokens, tvb, JSON_TOKEN_STRING, pos, value_end - pos);
+				pos = json_skip_ws(buf, value_end, end);
+				if (pos >= end || buf[pos] != ':')
+					return -1;
+				pos++;
+				expect = EXPECT_VALUE;
+				continue;
+
+			case EXPECT_SEPARATOR:
+				tok = json_open_token(tokens, open);
+				if (buf[pos] == ',') {
+					pos++;
+					expect = tok->id == JSON_OBJECT ? EXPECT_KEY : EXPECT_VALUE;
+					continue;
+				}
+				if (buf[pos] != (tok->id == JSON_OBJECT ? '}' : ']'))
+					return -1;
+				value_end = pos + 1;
+				json_close_token(tokens, open, value_end);
+				break;
+
+			case EXPECT_FIRST_VALUE:
+				if (buf[pos] == ']') {
+					value_end = pos + 1;
+					json_close_token(tokens, open, value_end);
+					break;
+				}
+				/* FALL THROUGH */
+			case EXPECT_VALUE:
+			default:
+				switch (buf[pos]) {
+					case '{':
+						wmem_stack_push(open, GUINT_TO_POINTER(json_add_token(tokens, tvb, JSON_OBJECT, pos, 0)));
+						pos++;
+						expect = EXPECT_FIRST_KEY;
+						continue;
+
+					case '[':
+						wmem_stack_push(open, GUINT_TO_POINTER(json_add_token(tokens, tvb, JSON_ARRAY, pos, 0)));
+						pos++;
+						expect = EXPECT_FIRST_VALUE;
+						continue;
+
+					case '"':
+						id = JSON_TOKEN_STRING;
+						value_end = json_scan_string(buf, pos, end);
+						break;
+
+					case 'f':
+						id = JSON_TOKEN_FALSE;
+						value_end = json_scan_literal(buf, pos, end, "false");
+						break;
+
+					case 'n':
+						id = JSON_TOKEN_NULL;
+						value_end = json_scan_literal(buf, pos, end, "null");
+						break;
+
+					case 't':
+						id = JSON_TOKEN_TRUE;
+						value_end = json_scan_literal(buf, pos, end, "true");
+						break;
+
+					case 'N':
+						id = JSON_TOKEN_NAN;
+						value_end = json_scan_literal(buf, pos, end, "NaN");
+						break;
+
+					default:
+						id = JSON_TOKEN_NUMBER;
+						value_end = json_scan_number(buf, pos, end);
+						break;
+				}
+				if (value_end < 0)
+					return -1;
+				json_add_token(tokens, tvb, id, pos, value_end - pos);
+				break;
+		}
+
+		/* A value has ended; so has the member it's the value of, if any */
+		pos = value_end;
+		if (wmem_stack_count(open) > 0 && json_open_token(tokens, open)->id == JSON_MEMBER)
+			json_close_token(tokens, open, value_end);
+		if (wmem_stack_count(open) == 0)
+			return value_end;
+		expect = EXPECT_SEPARATOR;
+	}
+}
+
+/* Build the tree from the tokens of one JSON text. */
+static void
+json_dissect_tokens(json_parser_data_t *data, wmem_array_t *tokens)
+{
+	json_token_t *toks = (json_token_t *)wmem_array_get_raw(tokens);
+	guint count = wmem_array_get_count(tokens);
+	wmem_stack_t *open = wmem_stack_new(wmem_packet_scope());
+	json_token_t *tok;
+	guint i = 0;
+
+	for (;;) {
+		/* Finish everything that ends before this token */
+		while (wmem_stack_count(open) > 0) {
+			tok = (json_token_t *)wmem_stack_peek(open);
+			if (tok->next != i)
+				break;
+			wmem_stack_pop(open);
+
+			if (tok->id == JSON_OBJECT)
+				after_object(data);
+			else if (tok->id == JSON_ARRAY)
+				after_array(data);
+			else
+				after_member(data, tok, tok + 1);
+		}
+		if (i == count)
+			break;
+
+		tok = &toks[i];
+		switch (tok->id) {
+			case JSON_OBJECT:
+				before_object(data, tok);
+				wmem_stack_push(open, tok);
+				i++;
+				break;
+
+			case JSON_ARRAY:
+				before_array(data, tok);
+				wmem_stack_push(open, tok);
+				i++;
+				break;
+
+			case JSON_MEMBER:
+				/* The key follows its member */
+				before_member(data, tok, tok + 1);
+				wmem_stack_push(open, tok);
+				i += 2;
+				break;
+
+			default:
+				after_value(data, tok);
+				i++;
+				break;
+		}
+	}
+}
+
+static void
+init_json_parser(void) {
+	ws_mempbrk_compile(&json_string_pbrk, "\"\\");
 }
 
 /* This function tries to understand if the payload is json or not */
@@ -2099,6 +2314,13 @@ proto_register_json(void)
 		"Hide extended path based filtering",
 		&hide_extended_path_based_filtering);
 
+	prefs_register_bool_preference(json_module, "skip_unreferenced",
+		"Skip JSON not needed by a filter",
+		"When the packet details aren't shown and no filter refers to a JSON field, "
+		"only find where the JSON ends rather than adding it to the tree. Fields "
+		"decoded from JSON values, such as 3GPP information elements, aren't dissected then.",
+		&skip_unreferenced);
+
 	proto_json_3gpp = proto_register_protocol("JSON 3GPP", "JSON_3GPP", "json_3gpp");
 
 	/* Fill hash table with static headers */
@@ -705,6 +705,10 @@ static const value_string election_types[] = {
  * by default */
 static gboolean kafka_show_string_bytes_lengths = FALSE;
 
+/* How much decompressed record batch data to keep, in megabytes, so that
+ * dissecting a frame again doesn't decompress its batches again */
+static guint kafka_decompress_cache_size = 64;
+
 typedef struct _kafka_query_response_t {
     kafka_api_key_t     api_key;
     kafka_api_version_t api_version;
@@ -1541,6 +1545,24 @@ dissect_kafka_record_headers(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *
     return offset;
 }
 
+/*
+ * Whether the records of a batch are worth decompressing and dissecting:
+ * the tree is being shown, or a filter or column looks at one of the
+ * fields of a record. Otherwise only the batch header is dissected.
+ */
+static gboolean
+kafka_records_wanted(proto_tree *tree)
+{
+    return proto_field_is_referenced(tree, hf_kafka_record_attributes) ||
+           proto_field_is_referenced(tree, hf_kafka_message_timestamp) ||
+           proto_field_is_referenced(tree, hf_kafka_offset) ||
+           proto_field_is_referenced(tree, hf_kafka_message_key) ||
+           proto_field_is_referenced(tree, hf_kafka_message_value) ||
+           proto_field_is_referenced(tree, hf_kafka_record_header_key) ||
+           proto_field_is_referenced(tree, hf_kafka_record_header_value) ||
+           proto_field_is_referenced(tree, hf_kafka_message_compression_reduction);
+}
+
 static int
 dissect_kafka_record(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree, int start_offset, guint64 base_offset, guint64 first_timestamp)
 {
@@ -1864,31 +1886,183 @@ decompress_zstd(tvbuff_t *tvb _U_, packet_info *pinfo, int offset _U_, guint32 l
 }
 #endif /* HAVE_ZSTD */
 
+/*
+ * Decompressed record batches, by the frame and the place in it of the
+ * compressed data, so that dissecting a frame again (refiltering,
+ * selecting it) doesn't decompress the same batches again. The oldest
+ * entries are dropped once kafka_decompress_cache_size is exceeded.
+ */
+#define KAFKA_DECOMPRESSED_KEY_BYTES 16
+
+typedef struct _kafka_decompressed_t {
+    guint32  frame;
+    gint     offset;
+    guint32  length;        /* of the compressed data */
+    guint32  tvb_length;    /* of the tvb holding it, which may itself be decompressed */
+    guint8   codec;
+    guint8   key_bytes[KAFKA_DECOMPRESSED_KEY_BYTES];  /* the first bytes of the compressed data */
+    guint8  *data;
+    guint    data_length;
+} kafka_decompressed_t;
+
+static GHashTable *kafka_decompressed_table = NULL;
+static GQueue kafka_decompressed_queue = G_QUEUE_INIT;  /* oldest first */
+static guint64 kafka_decompressed_bytes = 0;
+
+static guint
+kafka_decompressed_hash(gconstpointer key)
+{
+    const kafka_decompressed_t *entry = (const kafka_decompressed_t *)key;
+
+    return entry->frame ^ ((guint)entry->offset * 31) ^ (entry->length * 17) ^ entry->codec;
+}
+
+static gboolean
+kafka_decompressed_equal(gconstpointer key1, gconstpointer key2)
+{
+    const kafka_decompressed_t *e1 = (const kafka_decompressed_t *)key1;
+    const kafka_decompressed_t *e2 = (const kafka_decompressed_t *)key2;
+
+    return e1->frame == e2->frame && e1->offset == e2->offset &&
+           e1->length == e2->length && e1->tvb_length == e2->tvb_length &&
+           e1->codec == e2->codec &&
+           memcmp(e1->key_bytes, e2->key_bytes, KAFKA_DECOMPRESSED_KEY_BYTES) == 0;
+}
+
+static void
+kafka_decompressed_free(gpointer data)
+{
+    kafka_decompressed_t *entry = (kafka_decompressed_t *)data;
+
+    g_free(entry->data);
+    g_free(entry);
+}
+
+static void
+kafka_decompressed_init(void)
+{
+    kafka_decompressed_table = g_hash_table_new_full(kafka_decompressed_hash, kafka_decompressed_equal,
+                                                     kafka_decompressed_free, NULL);
+}
+
+static void
+kafka_decompressed_cleanup(void)
+{
+    g_queue_clear(&kafka_decompressed_queue);
+    g_hash_table_destroy(kafka_decompressed_table);
+    kafka_decompressed_table = NULL;
+    kafka_decompressed_bytes = 0;
+}
+
+static void
+kafka_decompressed_set_key(kafka_decompressed_t *key, tvbuff_t *tvb, packet_info *pinfo, int offset, guint32 length, int codec)
+{
+    memset(key, 0, sizeof(*key));
+    key->frame = pinfo->num;
+    key->offset = offset;
+    key->length = length;
+    key->tvb_length = tvb_captured_length(tvb);
+    key->codec = (guint8)codec;
+    tvb_memcpy(tvb, key->key_bytes, offset, MIN(length, KAFKA_DECOMPRESSED_KEY_BYTES));
+}
+
+/* A copy of a batch decompressed earlier, that lasts as long as the packet. */
+static tvbuff_t *
+kafka_decompressed_lookup(tvbuff_t *tvb, packet_info *pinfo, int offset, guint32 length, int codec)
+{
+    kafka_decompressed_t key, *entry;
+
+    if (kafka_decompressed_table == NULL || length == 0 || !tvb_bytes_exist(tvb, offset, length))
+        return NULL;
+
+    kafka_decompressed_set_key(&key, tvb, pinfo, offset, length, codec);
+    entry = (kafka_decompressed_t *)g_hash_table_lookup(kafka_decompressed_table, &key);
+    if (entry == NULL)
+        return NULL;
+
+    /* Copy it, as the entry could be dropped while the packet is still around */
+    return tvb_new_child_real_data(tvb, (const guint8 *)wmem_memdup(pinfo->pool, entry->data, entry->data_length),
+                                   entry->data_length, entry->data_length);
+}
+
+static void
+kafka_decompressed_add(tvbuff_t *tvb, packet_info *pinfo, int offset, guint32 length, int codec,
+                       tvbuff_t *decompressed_tvb, int decompressed_offset)
+{
+    guint64 budget = (guint64)kafka_decompress_cache_size * 1024 * 1024;
+    kafka_decompressed_t *entry;
+    guint data_length;
+
+    if (kafka_decompressed_table == NULL || length == 0 || !tvb_bytes_exist(tvb, offset, length))
+        return;
+
+    data_length = tvb_captured_length_remaining(decompressed_tvb, decompressed_offset);
+    if (data_length == 0 || data_length > budget)
+        return;
+
+    entry = g_new(kafka_decompressed_t, 1);
+    kafka_decompressed_set_key(entry, tvb, pinfo, offset, length, codec);
+    if (g_hash_table_contains(kafka_decompressed_table, entry)) {
+        g_free(entry);
+        return;
+    }
+    entry->data = (guint8 *)tvb_memdup(NULL, decompressed_tvb, decompressed_offset, data_length);
+    entry->data_length = data_length;
+
+    while (kafka_decompressed_bytes + data_length > budget) {
+        kafka_decompressed_t *oldest = (kafka_decompressed_t *)g_queue_pop_head(&kafka_decompressed_queue);
+
+        kafka_decompressed_bytes -= oldest->data_length;
+        g_hash_table_remove(kafka_decompressed_table, oldest);
+    }
+
+    g_hash_table_insert(kafka_decompressed_table, entry, entry);
+    g_queue_push_tail(&kafka_decompressed_queue, entry);
+    kafka_decompressed_bytes += data_length;
+}
+
 // Max is currently 2^22 in
 // https://github.com/apache/kafka/blob/trunk/clients/src/main/java/org/apache/kafka/common/record/KafkaLZ4BlockOutputStream.java
 #define MAX_DECOMPRESSION_SIZE (1 << 22)
 static gboolean
 decompress(tvbuff_t *tvb, packet_info *pinfo, int offset, guint32 length, int codec, tvbuff_t **decompressed_tvb, int *decompressed_offset)
 {
+    gboolean ret;
+
     if (length > MAX_DECOMPRESSION_SIZE) {
         expert_add_info(pinfo, NULL, &ei_kafka_bad_decompression_length);
         return FALSE;
     }
+    if (codec != KAFKA_MESSAGE_CODEC_NONE) {
+        *decompressed_tvb = kafka_decompressed_lookup(tvb, pinfo, offset, length, codec);
+        if (*decompressed_tvb) {
+            *decompressed_offset = 0;
+            return TRUE;
+        }
+    }
     switch (codec) {
         case KAFKA_MESSAGE_CODEC_SNAPPY:
-            return decompress_snappy(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            ret = decompress_snappy(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            break;
         case KAFKA_MESSAGE_CODEC_LZ4:
-            return decompress_lz4(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            ret = decompress_lz4(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            break;
         case KAFKA_MESSAGE_CODEC_ZSTD:
-            return decompress_zstd(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            ret = decompress_zstd(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            break;
         case KAFKA_MESSAGE_CODEC_GZIP:
-            return decompress_gzip(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            ret = decompress_gzip(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
+            break;
         case KAFKA_MESSAGE_CODEC_NONE:
             return decompress_none(tvb, pinfo, offset, length, decompressed_tvb, decompressed_offset);
         default:
             col_append_str(pinfo->cinfo, COL_INFO, " [unsupported compression type]");
             return FALSE;
     }
+    if (ret) {
+        kafka_decompressed_add(tvb, pinfo, offset, length, codec, *decompressed_tvb, *decompressed_offset);
+    }
+    return ret;
 }
 
 /*
@@ -2060,7 +2234,9 @@ dissect_kafka_message_new(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, i
 
     length = start_offset + 8 /*base offset*/ + 4 /*message size*/ + message_size - offset;
 
-    if (decompress(tvb, pinfo, offset, length, codec, &decompressed_tvb, &decompressed_offset)==1) {
+    if (!kafka_records_wanted(tree)) {
+        /* nothing would show them */
+    } else if (decompress(tvb, pinfo, offset, length, codec, &decompressed_tvb, &decompressed_offset)==1) {
         if (codec != 0) {
             add_new_data_source(pinfo, decompressed_tvb, "Decompressed Records");
             show_compression_reduction(tvb, subtree, length, tvb_captured_length(decompressed_tvb));
@@ -10269,6 +10445,11 @@ proto_register_kafka_preferences(const int proto)
                                    "Show length for string and bytes fields in the protocol tree",
                                    "",
                                    &kafka_show_string_bytes_lengths);
+    prefs_register_uint_preference(kafka_module, "decompress_cache_size",
+                                   "Decompressed record batch cache size (MB)",
+                                   "How much decompressed record batch data to keep, so that a frame dissected"
+                                   " again doesn't have its batches decompressed again; 0 disables this",
+                                   10, &kafka_decompress_cache_size);
 }
 
 
@@ -10290,6 +10471,9 @@ proto_register_kafka(void)
     proto_register_kafka_expert_module(protocol_handle);
     proto_register_kafka_preferences(protocol_handle);
 
+    register_init_routine(kafka_decompressed_init);
+    register_cleanup_routine(kafka_decompressed_cleanup);
+
     proto_kafka = protocol_handle;
 
 }
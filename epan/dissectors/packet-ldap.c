@@ -1120,6 +1120,32 @@ ldap_match_call_response(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, gu
 }
 
 
+/* Fields that never occur within a search result's attributes; filtering on
+ * nothing but these lets the BER runtime step over the attribute list. */
+static int * const ldap_attributes_outside_hfs[] = {
+  &hf_ldap_LDAPMessage_PDU,
+  &hf_ldap_messageID,
+  &hf_ldap_protocolOp,
+  &hf_ldap_searchRequest,
+  &hf_ldap_searchResEntry,
+  &hf_ldap_searchResDone,
+  &hf_ldap_baseObject,
+  &hf_ldap_scope,
+  &hf_ldap_derefAliases,
+  &hf_ldap_sizeLimit,
+  &hf_ldap_timeLimit,
+  &hf_ldap_typesOnly,
+  &hf_ldap_objectName,
+  &hf_ldap_resultCode,
+  &hf_ldap_matchedDN,
+  &hf_ldap_errorMessage,
+  &hf_ldap_response_in,
+  &hf_ldap_response_to,
+  &hf_ldap_time,
+  NULL
+};
+
+
 /*--- Included file: packet-ldap-fn.c ---*/
 #line 1 "./asn1/ldap/packet-ldap-fn.c"
 /*--- Cyclic dependencies ---*/
@@ -2417,9 +2443,19 @@ static const ber_sequence_t PartialAttributeList_sequence_of[1] = {
 
 static int
 dissect_ldap_PartialAttributeList(gboolean implicit_tag _U_, tvbuff_t *tvb _U_, int offset _U_, asn1_ctx_t *actx _U_, proto_tree *tree _U_, int hf_index _U_) {
+#line 802 "./asn1/ldap/ldap.cnf"
+  int end_offset;
+
+  end_offset = dissect_ber_skip_unneeded(actx, tree, tvb, offset, proto_ldap, ldap_attributes_outside_hfs);
+  if (end_offset != offset)
+    return end_offset;
+
   offset = dissect_ber_sequence_of(implicit_tag, actx, tree, tvb, offset,
                                       PartialAttributeList_sequence_of, hf_index, ett_ldap_PartialAttributeList);
 
+
+
+
   return offset;
 }
 
@@ -3815,7 +3851,7 @@ static int dissect_PasswordPolicyResponseValue_PDU(tvbuff_t *tvb _U_, packet_inf
 
 
 /*--- End of included file: packet-ldap-fn.c ---*/
-#line 909 "./asn1/ldap/packet-ldap-template.c"
+#line 934 "./asn1/ldap/packet-ldap-template.c"
 static int dissect_LDAPMessage_PDU(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, ldap_conv_info_t *ldap_info) {
 
   int offset = 0;
@@ -5632,7 +5668,7 @@ void proto_register_ldap(void) {
         NULL, HFILL }},
 
 /*--- End of included file: packet-ldap-hfarr.c ---*/
-#line 2157 "./asn1/ldap/packet-ldap-template.c"
+#line 2182 "./asn1/ldap/packet-ldap-template.c"
   };
 
   /* List of subtrees */
@@ -5706,7 +5742,7 @@ void proto_register_ldap(void) {
     &ett_ldap_T_warning,
 
 /*--- End of included file: packet-ldap-ettarr.c ---*/
-#line 2171 "./asn1/ldap/packet-ldap-template.c"
+#line 2196 "./asn1/ldap/packet-ldap-template.c"
   };
   /* UAT for header fields */
   static uat_field_t custom_attribute_types_uat_fields[] = {
@@ -5917,7 +5953,7 @@ proto_reg_handoff_ldap(void)
 
 
 /*--- End of included file: packet-ldap-dis-tab.c ---*/
-#line 2365 "./asn1/ldap/packet-ldap-template.c"
+#line 2390 "./asn1/ldap/packet-ldap-template.c"
 
  dissector_add_uint_range_with_preference("tcp.port", TCP_PORT_RANGE_LDAP, ldap_handle);
 
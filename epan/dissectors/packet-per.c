@@ -20,6 +20,7 @@ proper helper routines
 
 #include <epan/packet.h>
 #include <epan/exceptions.h>
+#include <epan/prefs.h>
 #include <epan/oids.h>
 #include <epan/to_str.h>
 #include <epan/asn1.h>
@@ -114,6 +115,131 @@ static const true_false_string tfs_small_number_bit = {
 
 #define SEQ_MAX_COMPONENTS 128
 
+/* What dissect_per_sequence() and dissect_per_choice() need to know about a
+ * component table besides the encoded data. The tables are static, so this is
+ * computed once per table instead of on every call. */
+typedef struct {
+	guint32 num_opts;	/* OPTIONAL/DEFAULT components of the extension root */
+	guint32 num_opts_all;	/* OPTIONAL/DEFAULT components, including additions */
+	guint32 num_root;	/* components of the extension root */
+	guint32 num_ext;	/* known extension additions */
+	guint32 *root_index;	/* table index of the n:th root component */
+	guint32 *ext_index;	/* table index of the n:th extension addition */
+} per_type_plan_t;
+
+/* component table -> per_type_plan_t */
+static GHashTable *per_type_plans = NULL;
+
+static per_type_plan_t *
+per_type_plan_new(gconstpointer table, guint32 num_root, guint32 num_ext)
+{
+	per_type_plan_t *plan = wmem_new0(wmem_epan_scope(), per_type_plan_t);
+
+	plan->root_index = wmem_alloc_array(wmem_epan_scope(), guint32, num_root + 1);
+	plan->ext_index = wmem_alloc_array(wmem_epan_scope(), guint32, num_ext + 1);
+	if (!per_type_plans) {
+		per_type_plans = g_hash_table_new(g_direct_hash, g_direct_equal);
+	}
+	g_hash_table_insert(per_type_plans, (gpointer)table, plan);
+	return plan;
+}
+
+static const per_type_plan_t *
+per_sequence_plan(const per_sequence_t *sequence)
+{
+	per_type_plan_t *plan = per_type_plans ? (per_type_plan_t *)g_hash_table_lookup(per_type_plans, sequence) : NULL;
+	guint32 i, num_root = 0, num_ext = 0;
+
+	if (plan) {
+		return plan;
+	}
+
+	for (i = 0; sequence[i].p_id; i++) {
+		if (sequence[i].extension == ASN1_NOT_EXTENSION_ROOT) {
+			num_ext++;
+		} else {
+			num_root++;
+		}
+	}
+	plan = per_type_plan_new(sequence, num_root, num_ext);
+	for (i = 0; sequence[i].p_id; i++) {
+		if (sequence[i].optional == ASN1_OPTIONAL) {
+			plan->num_opts_all++;
+		}
+		if (sequence[i].extension == ASN1_NOT_EXTENSION_ROOT) {
+			plan->ext_index[plan->num_ext++] = i;
+		} else {
+			if (sequence[i].optional == ASN1_OPTIONAL) {
+				plan->num_opts++;
+			}
+			plan->root_index[plan->num_root++] = i;
+		}
+	}
+	return plan;
+}
+
+static const per_type_plan_t *
+per_choice_plan(const per_choice_t *choice)
+{
+	per_type_plan_t *plan = per_type_plans ? (per_type_plan_t *)g_hash_table_lookup(per_type_plans, choice) : NULL;
+	guint32 i, num_root = 0, num_ext = 0;
+
+	if (plan) {
+		return plan;
+	}
+
+	for (i = 0; choice[i].p_id; i++) {
+		if (choice[i].extension == ASN1_NOT_EXTENSION_ROOT) {
+			num_ext++;
+		} else {
+			num_root++;
+		}
+	}
+	plan = per_type_plan_new(choice, num_root, num_ext);
+	for (i = 0; choice[i].p_id; i++) {
+		if (choice[i].extension == ASN1_NOT_EXTENSION_ROOT) {
+			plan->ext_index[plan->num_ext++] = i;
+		} else {
+			plan->root_index[plan->num_root++] = i;
+		}
+	}
+	return plan;
+}
+
+static void
+per_shutdown(void)
+{
+	if (per_type_plans) {
+		g_hash_table_destroy(per_type_plans);
+		per_type_plans = NULL;
+	}
+}
+
+/* Whether the preamble bits of a SEQUENCE (optional field and extension
+ * present bits) get items of their own. Unless they are shown or filtered
+ * on, the bits are read a word at a time without adding anything. */
+static gboolean
+per_preamble_items_wanted(proto_tree *tree, int hf_index)
+{
+	return tree && (display_internal_per_fields || prefs.display_hidden_proto_items ||
+			proto_field_is_referenced(tree, hf_index));
+}
+
+/* Reads num_bits (at most SEQ_MAX_COMPONENTS) presence bits into mask, the
+ * first bit in the most significant bit of mask[0]. */
+static guint32
+per_read_presence_bits(tvbuff_t *tvb, guint32 offset, guint32 num_bits, guint32 *mask)
+{
+	guint32 i, n;
+
+	for (i = 0; i < num_bits; i += n) {
+		n = MIN(num_bits - i, 32);
+		mask[i>>5] = tvb_get_bits32(tvb, offset, n, ENC_BIG_ENDIAN) << (32 - n);
+		offset += n;
+	}
+	return offset;
+}
+
 static void per_check_value(guint32 value, guint32 min_len, guint32 max_len, asn1_ctx_t *actx, proto_item *item, gboolean is_signed)
 {
 	if ((is_signed == FALSE) && (value > max_len)) {
@@ -1700,9 +1826,9 @@ dissect_per_choice(tvbuff_t *tvb, guint32 offset, asn1_ctx_t *actx, proto_tree *
 {
 	gboolean /*extension_present,*/ extension_flag;
 	int extension_root_entries;
-	int extension_addition_entries;
+	const per_type_plan_t *plan;
 	guint32 choice_index;
-	int i, idx, cidx;
+	int idx;
 	guint32 ext_length = 0;
 	guint32 old_offset = offset;
 	proto_item *choice_item = NULL;
@@ -1723,19 +1849,8 @@ DEBUG_ENTRY("dissect_per_choice");
 	}
 
 	/* count the number of entries in the extension root and extension addition */
-	extension_root_entries = 0;
-	extension_addition_entries = 0;
-	for (i=0; choice[i].p_id; i++) {
-		switch(choice[i].extension){
-			case ASN1_NO_EXTENSIONS:
-			case ASN1_EXTENSION_ROOT:
-				extension_root_entries++;
-				break;
-			case ASN1_NOT_EXTENSION_ROOT:
-				extension_addition_entries++;
-				break;
-		}
-	}
+	plan = per_choice_plan(choice);
+	extension_root_entries = plan->num_root;
 
 	if (!extension_flag) {  /* 22.6, 22.7 */
 		if (extension_root_entries == 1) {  /* 22.5 */
@@ -1747,24 +1862,12 @@ DEBUG_ENTRY("dissect_per_choice");
 			if (!display_internal_per_fields) proto_item_set_hidden(actx->created_item);
 		}
 
-		idx = -1; cidx = choice_index;
-		for (i=0; choice[i].p_id; i++) {
-			if(choice[i].extension != ASN1_NOT_EXTENSION_ROOT){
-				if (!cidx) { idx = i; break; }
-				cidx--;
-			}
-		}
+		idx = choice_index < plan->num_root ? (int)plan->root_index[choice_index] : -1;
 	} else {  /* 22.8 */
 		offset = dissect_per_normally_small_nonnegative_whole_number(tvb, offset, actx, tree, hf_per_choice_extension_index, &choice_index);
 		offset = dissect_per_length_determinant(tvb, offset, actx, tree, hf_per_open_type_length, &ext_length, NULL);
 
-		idx = -1; cidx = choice_index;
-		for (i=0; choice[i].p_id; i++) {
-			if(choice[i].extension == ASN1_NOT_EXTENSION_ROOT){
-				if (!cidx) { idx = i; break; }
-				cidx--;
-			}
-		}
+		idx = choice_index < plan->num_ext ? (int)plan->ext_index[choice_index] : -1;
 	}
 
 	if (idx != -1) {
@@ -1866,9 +1969,11 @@ dissect_per_sequence(tvbuff_t *tvb, guint32 offset, asn1_ctx_t *actx, proto_tree
 	guint32 old_offset=offset;
 	guint32 i, j, num_opts;
 	guint32 optional_mask[SEQ_MAX_COMPONENTS>>5];
+	const per_type_plan_t *plan;
 
 DEBUG_ENTRY("dissect_per_sequence");
 	DISSECTOR_ASSERT(sequence);
+	plan=per_sequence_plan(sequence);
 
 	item=proto_tree_add_item(parent_tree, hf_index, tvb, offset>>3, 0, ENC_BIG_ENDIAN);
 	tree=proto_item_add_subtree(item, ett_index);
@@ -1887,18 +1992,15 @@ DEBUG_ENTRY("dissect_per_sequence");
 		if (!display_internal_per_fields) proto_item_set_hidden(actx->created_item);
 	}
 	/* 18.2 */
-	num_opts=0;
-	for(i=0;sequence[i].p_id;i++){
-		if((sequence[i].extension!=ASN1_NOT_EXTENSION_ROOT)&&(sequence[i].optional==ASN1_OPTIONAL)){
-			num_opts++;
-		}
-	}
+	num_opts=plan->num_opts;
 	if (num_opts > SEQ_MAX_COMPONENTS) {
 		dissect_per_not_decoded_yet(tree, actx->pinfo, tvb, "too many optional/default components");
 	}
 
 	memset(optional_mask, 0, sizeof(optional_mask));
-	for(i=0;i<num_opts;i++){
+	if (!per_preamble_items_wanted(tree, hf_per_optional_field_bit)) {
+		offset=per_read_presence_bits(tvb, offset, num_opts, optional_mask);
+	} else for(i=0;i<num_opts;i++){
 		offset=dissect_per_boolean(tvb, offset, actx, tree, hf_per_optional_field_bit, &optional_field_flag);
 		if (tree) {
 			proto_item_append_text(actx->created_item, " (%s %s present)",
@@ -1965,7 +2067,10 @@ DEBUG_ENTRY("dissect_per_sequence");
 		}
 
 		extension_mask=0;
-		for(i=0;i<num_extensions;i++){
+		if (!per_preamble_items_wanted(tree, hf_per_extension_present_bit)) {
+			extension_mask=tvb_get_bits32(tvb, offset, num_extensions, ENC_BIG_ENDIAN);
+			offset+=num_extensions;
+		} else for(i=0;i<num_extensions;i++){
 			offset=dissect_per_boolean(tvb, offset, actx, tree, hf_per_extension_present_bit, &extension_bit);
 			if (tree) {
 				proto_item_append_text(actx->created_item, " (%s %s present)",
@@ -1977,12 +2082,7 @@ DEBUG_ENTRY("dissect_per_sequence");
 		}
 
 		/* find how many extensions we know about */
-		num_known_extensions=0;
-		for(i=0;sequence[i].p_id;i++){
-			if(sequence[i].extension==ASN1_NOT_EXTENSION_ROOT){
-				num_known_extensions++;
-			}
-		}
+		num_known_extensions=plan->num_ext;
 
 		/* decode the extensions one by one */
 		for(i=0;i<num_extensions;i++){
@@ -1990,7 +2090,6 @@ DEBUG_ENTRY("dissect_per_sequence");
 			guint32 new_offset;
 			gint32 difference;
 			guint32 extension_index;
-			guint32 k;
 
 			if(!((1U<<(num_extensions-1-i))&extension_mask)){
 				/* this extension is not encoded in this PDU */
@@ -2006,16 +2105,7 @@ DEBUG_ENTRY("dissect_per_sequence");
 				continue;
 			}
 
-			extension_index=0;
-			for(j=0,k=0;sequence[j].p_id;j++){
-				if(sequence[j].extension==ASN1_NOT_EXTENSION_ROOT){
-					if(k==i){
-						extension_index=j;
-						break;
-					}
-					k++;
-				}
-			}
+			extension_index=plan->ext_index[i];
 
 			if(sequence[extension_index].func){
 				new_offset=sequence[extension_index].func(tvb, offset, actx, tree, *sequence[extension_index].p_id);
@@ -2052,18 +2142,15 @@ dissect_per_sequence_eag(tvbuff_t *tvb, guint32 offset, asn1_ctx_t *actx, proto_
 
 DEBUG_ENTRY("dissect_per_sequence_eag");
 
-	num_opts=0;
-	for(i=0;sequence[i].p_id;i++){
-		if(sequence[i].optional==ASN1_OPTIONAL){
-			num_opts++;
-		}
-	}
+	num_opts=per_sequence_plan(sequence)->num_opts_all;
 	if (num_opts > SEQ_MAX_COMPONENTS) {
 		dissect_per_not_decoded_yet(tree, actx->pinfo, tvb, "too many optional/default components");
 	}
 
 	memset(optional_mask, 0, sizeof(optional_mask));
-	for(i=0;i<num_opts;i++){
+	if (!per_preamble_items_wanted(tree, hf_per_optional_field_bit)) {
+		offset=per_read_presence_bits(tvb, offset, num_opts, optional_mask);
+	} else for(i=0;i<num_opts;i++){
 		offset=dissect_per_boolean(tvb, offset, actx, tree, hf_per_optional_field_bit, &optional_field_flag);
 		if (tree) {
 			proto_item_append_text(actx->created_item, " (%s %s present)",
@@ -2906,6 +2993,8 @@ proto_register_per(void)
 
 	per_oid_dissector_table = register_dissector_table("per.oid", "PER OID", proto_per, FT_STRING, BASE_NONE);
 
+	register_shutdown_routine(per_shutdown);
+
 
 }
 
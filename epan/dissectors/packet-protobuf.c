@@ -1468,6 +1468,70 @@ load_all_files_in_dir(PbwDescriptorPool* pool, const gchar* dir_path)
     return TRUE;
 }
 
+/* What pbw_pool was last loaded from without errors: a digest of the search paths
+   and of the name, size and modification time of every .proto file in them.
+   Parsing thousands of .proto files takes a while, so when the search paths are
+   applied again (preferences, profile switch) and nothing has changed, the pool
+   is kept. */
+static gchar* loaded_protos_fingerprint = NULL;
+
+static void
+fingerprint_files_in_dir(GChecksum* checksum, const gchar* dir_path)
+{
+    WS_DIR        *dir;             /* scanned directory */
+    WS_DIRENT     *file;            /* current file */
+    const gchar   *dot;
+    const gchar   *name;            /* current file or dir name (without parent dir path) */
+    gchar         *path;            /* sub file or dir path of dir_path */
+    ws_statb64     file_stat;
+
+    if (g_file_test(dir_path, G_FILE_TEST_IS_DIR)) {
+        if ((dir = ws_dir_open(dir_path, 0, NULL)) != NULL) {
+            while ((file = ws_dir_read_name(dir)) != NULL) {
+                name = ws_dir_get_name(file);
+                path = g_build_filename(dir_path, name, NULL);
+                dot = strrchr(name, '.');
+                if (dot && g_ascii_strcasecmp(dot + 1, "proto") == 0) {
+                    if (ws_stat64(path, &file_stat) == 0) {
+                        g_checksum_update(checksum, (const guchar*)path, strlen(path) + 1);
+                        g_checksum_update(checksum, (const guchar*)&file_stat.st_size, sizeof(file_stat.st_size));
+                        g_checksum_update(checksum, (const guchar*)&file_stat.st_mtime, sizeof(file_stat.st_mtime));
+                    }
+                } else {
+                    fingerprint_files_in_dir(checksum, path);
+                }
+                g_free(path);
+            }
+            ws_dir_close(dir);
+        }
+    }
+}
+
+/* All the files in the search paths count, not just the ones loaded up front,
+   as the others may be imported. */
+static gchar*
+fingerprint_protos(char** source_paths, size_t num_proto_paths)
+{
+    GChecksum* checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    gchar* fingerprint;
+    size_t i;
+
+    for (i = 0; i < num_proto_paths; ++i) {
+        guchar load_all = (i < 2) || protobuf_search_paths[i - 2].load_all;
+
+        if (source_paths[i] == NULL) {
+            continue;
+        }
+        g_checksum_update(checksum, (const guchar*)source_paths[i], strlen(source_paths[i]) + 1);
+        g_checksum_update(checksum, &load_all, 1);
+        fingerprint_files_in_dir(checksum, source_paths[i]);
+    }
+
+    fingerprint = g_strdup(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+    return fingerprint;
+}
+
 /* There might be a lot of errors to be found during parsing .proto files.
    We buffer the errors first, and print them in one list finally. */
 static wmem_strbuf_t* err_msg_buf = NULL;
@@ -1751,6 +1815,8 @@ protobuf_reinit(int target)
     }
 
     if (target & PREFS_UPDATE_PROTOBUF_SEARCH_PATHS) {
+        gchar* fingerprint;
+
         /* convert protobuf_search_path_t array to char* array. should release by g_free().
            Add the global and profile protobuf dirs to the search list, add 1 for the terminating null entry */
         num_proto_paths = (size_t)num_protobuf_search_paths + 2;
@@ -1764,24 +1830,41 @@ protobuf_reinit(int target)
             source_paths[i + 2] = protobuf_search_paths[i].path;
         }
 
-        /* init DescriptorPool of protobuf */
-        pbw_reinit_DescriptorPool(&pbw_pool, (const char **)source_paths, buffer_error);
-
-        /* load all .proto files in the marked search paths, we can invoke FindMethodByName etc later. */
-        for (i = 0; i < num_proto_paths; ++i) {
-            if ((i < 2) || protobuf_search_paths[i - 2].load_all) {
-                if (!load_all_files_in_dir(pbw_pool, source_paths[i])) {
-                    buffer_error("Protobuf: Loading .proto files action stopped!\n");
-                    loading_completed = FALSE;
-                    break; /* stop loading when error occurs */
+        fingerprint = fingerprint_protos(source_paths, num_proto_paths);
+        if (pbw_pool && g_strcmp0(fingerprint, loaded_protos_fingerprint) == 0) {
+            /* Nothing has changed since the pool was loaded */
+            g_free(fingerprint);
+            update_header_fields(FALSE);
+        } else {
+            g_free(loaded_protos_fingerprint);
+            loaded_protos_fingerprint = NULL;
+
+            /* init DescriptorPool of protobuf */
+            pbw_reinit_DescriptorPool(&pbw_pool, (const char **)source_paths, buffer_error);
+
+            /* load all .proto files in the marked search paths, we can invoke FindMethodByName etc later. */
+            for (i = 0; i < num_proto_paths; ++i) {
+                if ((i < 2) || protobuf_search_paths[i - 2].load_all) {
+                    if (!load_all_files_in_dir(pbw_pool, source_paths[i])) {
+                        buffer_error("Protobuf: Loading .proto files action stopped!\n");
+                        loading_completed = FALSE;
+                        break; /* stop loading when error occurs */
+                    }
                 }
             }
+
+            /* Load again next time if there were errors, so that they're reported again */
+            if (loading_completed && err_msg_buf == NULL) {
+                loaded_protos_fingerprint = fingerprint;
+            } else {
+                g_free(fingerprint);
+            }
+            update_header_fields(TRUE);
         }
 
         g_free(source_paths[0]);
         g_free(source_paths[1]);
         g_free(source_paths);
-        update_header_fields(TRUE);
     }
 
     /* check if the message types of UDP port exist */
@@ -962,6 +962,12 @@ static gboolean sip_desegment_body = TRUE;
  */
 static gboolean sip_retrans_the_same_sport = TRUE;
 
+/*
+ * seconds without any message after which a transaction entry is dropped
+ * (0 = keep all of them until the capture is closed)
+ */
+static guint sip_transaction_expiry = 0;
+
 /* whether we hold off tracking RTP conversations until an SDP answer is received */
 static gboolean sip_delay_sdp_changes = FALSE;
 
@@ -1302,6 +1308,7 @@ typedef struct
     nstime_t            request_time;
     guint32             response_code;
     gint                frame_number;
+    nstime_t            last_seen;
 } sip_hash_value;
 
 /* Result to be stored in per-packet info */
@@ -1336,6 +1343,58 @@ static gint sip_equal(gconstpointer v, gconstpointer v2)
 }
 
 
+static void
+sip_hash_key_free(gpointer data)
+{
+    sip_hash_key *key = (sip_hash_key *)data;
+
+    free_address(&key->source_address);
+    free_address(&key->dest_address);
+    g_free(key);
+}
+
+/* When the transaction table was last swept for idle entries */
+static nstime_t sip_last_expiry;
+
+static gboolean
+sip_hash_value_idle(gpointer key _U_, gpointer value, gpointer user_data)
+{
+    const sip_hash_value *p_val = (const sip_hash_value *)value;
+    nstime_t delta;
+
+    nstime_delta(&delta, (const nstime_t *)user_data, &p_val->last_seen);
+    return nstime_to_sec(&delta) >= (double)sip_transaction_expiry;
+}
+
+/* Drops transaction entries that have been idle for longer than
+ * sip_transaction_expiry.  Per-frame results are kept in proto data,
+ * so this only matters for frames that have not been dissected yet. */
+static void
+sip_expire_transactions(packet_info *pinfo)
+{
+    nstime_t delta;
+
+    if (sip_transaction_expiry == 0)
+    {
+        return;
+    }
+
+    if (nstime_is_zero(&sip_last_expiry))
+    {
+        sip_last_expiry = pinfo->abs_ts;
+        return;
+    }
+
+    nstime_delta(&delta, &pinfo->abs_ts, &sip_last_expiry);
+    if (nstime_to_sec(&delta) < (double)sip_transaction_expiry)
+    {
+        return;
+    }
+
+    g_hash_table_foreach_remove(sip_hash, sip_hash_value_idle, &pinfo->abs_ts);
+    sip_last_expiry = pinfo->abs_ts;
+}
+
 /* Initializes the hash table each time a new
  * file is loaded or re-loaded in wireshark */
 static void
@@ -1343,7 +1402,8 @@ sip_init_protocol(void)
 {
     guint i;
     gchar *value_copy;
-    sip_hash = g_hash_table_new(g_str_hash , sip_equal);
+    sip_hash = g_hash_table_new_full(g_str_hash , sip_equal, sip_hash_key_free, g_free);
+    nstime_set_zero(&sip_last_expiry);
 
     /* Hash table for quick lookup of SIP headers names to hf entry (POS_x) */
     sip_headers_hash = g_hash_table_new(g_str_hash , g_str_equal);
@@ -5297,6 +5357,7 @@ guint sip_is_packet_resend(packet_info *pinfo,
     }
 
     /* No packet entry found, consult global hash table */
+    sip_expire_transactions(pinfo);
 
     /* Prepare the key */
     (void) g_strlcpy(key.call_id, call_id, MAX_CALL_ID_SIZE);
@@ -5341,14 +5402,15 @@ guint sip_is_packet_resend(packet_info *pinfo,
     {
         /* Need to create a new table entry */
 
-        /* Allocate a new key and value */
-        p_key = wmem_new(wmem_file_scope(), sip_hash_key);
-        p_val = wmem_new0(wmem_file_scope(), sip_hash_value);
+        /* Allocate a new key and value; they are freed by the table, as
+           entries may be dropped before the end of the capture */
+        p_key = g_new(sip_hash_key, 1);
+        p_val = g_new0(sip_hash_value, 1);
 
         /* Fill in key and value details */
         snprintf(p_key->call_id, MAX_CALL_ID_SIZE, "%s", call_id);
-        copy_address_wmem(wmem_file_scope(), &(p_key->dest_address), &pinfo->net_dst);
-        copy_address_wmem(wmem_file_scope(), &(p_key->source_address), &pinfo->net_src);
+        copy_address(&(p_key->dest_address), &pinfo->net_dst);
+        copy_address(&(p_key->source_address), &pinfo->net_src);
         p_key->dest_port = pinfo->destport;
         if (sip_retrans_the_same_sport) {
             p_key->source_port = pinfo->srcport;
@@ -5372,6 +5434,8 @@ guint sip_is_packet_resend(packet_info *pinfo,
     }
 
 
+    p_val->last_seen = pinfo->abs_ts;
+
     /******************************************/
     /* Is it a resend???                      */
 
@@ -5515,6 +5579,7 @@ guint sip_find_request(packet_info *pinfo,
     {
         /* Table entry found, we'll use its value for comparison */
         cseq_to_compare = p_val->cseq;
+        p_val->last_seen = pinfo->abs_ts;
     }
     else
     {
@@ -5631,6 +5696,7 @@ guint sip_find_invite(packet_info *pinfo,
         /* Table entry found, we'll use its value for comparison */
         cseq_to_compare = p_val->cseq;
 #endif
+        p_val->last_seen = pinfo->abs_ts;
     }
     else
     {
@@ -7675,6 +7741,13 @@ void proto_register_sip(void)
         "Whether retransmissions are detected coming from the same source port only.",
         &sip_retrans_the_same_sport);
 
+    prefs_register_uint_preference(sip_module, "transaction_expiry",
+        "Forget idle transactions after (seconds)",
+        "Drop the retransmission and response matching state of a call after this many seconds"
+        " without any of its messages, so that long captures don't keep every call in memory."
+        " 0 keeps all calls until the capture is closed.",
+        10, &sip_transaction_expiry);
+
     prefs_register_bool_preference(sip_module, "delay_sdp_changes",
         "Delay SDP changes for tracking media",
         "Whether SIP should delay tracking the media (e.g., RTP/RTCP) until an SDP offer "
@@ -4084,6 +4084,10 @@ void proto_register_snmp(void) {
 	proto_snmp = proto_register_protocol(PNAME, PSNAME, PFNAME);
 	snmp_handle = register_dissector("snmp", dissect_snmp, proto_snmp);
 
+	/* Only needed once SNMP is seen; don't read them at startup */
+	uat_set_deferred_load(assocs_uat, proto_snmp);
+	uat_set_deferred_load(specific_traps_uat, proto_snmp);
+
 	/* Register fields and subtrees */
 	proto_register_field_array(proto_snmp, hf, array_length(hf));
 	proto_register_subtree_array(ett, array_length(ett));
@@ -17,9 +17,6 @@
 
 
 /* TODO:
- * - sort out threading/channel-sync so works reliably in tshark
- *    - postponed for now, as Qt crashes if call g_main_context_iteration()
- *      at an inopportune time
  * - have looked into writing a tap that could provide an interface for error messages/events and snort stats,
  *   but not easy as taps are not usually listening when alerts are detected
  * - for a content/pcre match, find all protocol fields that cover same bytes and show in tree
@@ -38,6 +35,7 @@
 #include <epan/prefs.h>
 #include <epan/expert.h>
 #include <epan/wmem_scopes.h>
+#include <epan/crc32-tvb.h>
 #include <wsutil/file_util.h>
 #include <wsutil/report_message.h>
 #include <wiretap/wtap-int.h>
@@ -154,12 +152,30 @@ typedef struct {
 
     GString *buf;       /* Incomplete alert output that has been read */
     wtap_dumper *pdh;   /* wiretap dumper used to deliver packets to 'in' */
+    guint frames_since_flush;   /* written to 'pdh' but maybe not yet to 'in' */
 
-    GIOChannel *channel; /* IO channel used for readimg stdout (alerts) */
+    GIOChannel *channel; /* IO channel used for reading stdout (alerts) */
+    GThread *reader;     /* reads alerts from 'channel' as snort writes them */
+
+    GMutex pending_lock;
+    GPtrArray *pending_alerts;  /* Alert_t* read but not yet in alerts_tree; protected by pending_lock */
 
     wmem_tree_t *alerts_tree;  /* Lookup from frame-number -> Alerts_t* */
+    gboolean pass_started;     /* whether we've decided to run snort, or reuse alerts_tree, in this pass */
+
+    /* What alerts_tree was made from, so that a redissection of the same file can reuse it */
+    gboolean alerts_complete;  /* snort saw every frame and exited */
+    nstime_t first_frame_ts;
+    guint    first_frame_len;
+    guint32  first_frame_crc;
+    gchar   *alerts_binary_filename;
+    gchar   *alerts_config_filename;
+    gboolean alerts_ignored_checksum_errors;
 } snort_session_t;
 
+/* Frames written to snort between flushes; it reads them in bulk, and the alerts come back on their own thread */
+#define SNORT_FLUSH_FRAMES 1000
+
 /* Global instance of the snort session */
 static snort_session_t current_session;
 
@@ -202,6 +218,36 @@ typedef struct Alerts_t {
 } Alerts_t;
 
 
+static void free_alert_strings(Alert_t *alert)
+{
+    g_free(alert->raw_alert);
+    g_free(alert->msg);
+    g_free(alert->classification);
+}
+
+static gboolean free_alerts_cb(const void *key _U_, void *value, void *userdata _U_)
+{
+    Alerts_t *alerts = (Alerts_t *)value;
+    guint n;
+
+    for (n = 0; n < alerts->num_alerts; n++) {
+        free_alert_strings(&alerts->alerts[n]);
+    }
+    g_free(alerts);
+    return FALSE;
+}
+
+/* Forget all alerts, and start an empty map for new ones. */
+static void discard_session_alerts(void)
+{
+    if (current_session.alerts_tree) {
+        wmem_tree_foreach(current_session.alerts_tree, free_alerts_cb, NULL);
+        wmem_tree_destroy(current_session.alerts_tree, FALSE, FALSE);
+    }
+    current_session.alerts_tree = wmem_tree_new(wmem_epan_scope());
+    current_session.alerts_complete = FALSE;
+}
+
 /* Add an alert to the map stored in current_session.
  * N.B. even if preference 'snort_alert_in_reassembled_frame' is set,
  * need to set to original frame now, and try to update it in the 2nd pass... */
@@ -223,6 +269,9 @@ static void add_alert_to_session_tree(guint frame_number, Alert_t *alert)
             /* Deep copy of alert */
             alerts->alerts[alerts->num_alerts++] = *alert;
         }
+        else {
+            free_alert_strings(alert);
+        }
     }
 }
 
@@ -252,6 +301,18 @@ static void fill_alert_config(SnortConfig_t *snort_config, Alert_t *alert)
     alert->rule_match_number = rule_match_number;
 }
 
+/* Link kept alerts to the newly parsed config, counting them again as we go. */
+static gboolean refill_alerts_cb(const void *key _U_, void *value, void *userdata _U_)
+{
+    Alerts_t *alerts = (Alerts_t *)value;
+    guint n;
+
+    for (n = 0; n < alerts->num_alerts; n++) {
+        fill_alert_config(g_snort_config, &alerts->alerts[n]);
+    }
+    return FALSE;
+}
+
 
 /* Helper functions for matching expected bytes against the packet buffer.
   Case-sensitive comparison - can just memcmp().
@@ -416,7 +477,7 @@ static void snort_reaper(GPid pid, gint status _U_, gpointer data)
     if (session->running && session->pid == pid) {
         session->working = session->running = FALSE;
         /* XXX, cleanup */
-    } else {
+    } else if (session->running) {
         g_print("Errrrmm snort_reaper() %d != %d\n", session->pid, pid);
     }
 
@@ -547,31 +608,30 @@ static gboolean snort_parse_user_comment(const char *line, Alert_t *alert)
     return TRUE;
 }
 
-/* Output data has been received from snort.  Read from channel and look for whole alerts. */
-static gboolean snort_fast_output(GIOChannel *source, GIOCondition condition, gpointer data)
+/* Runs on its own thread, reading snort's output until it exits and queueing each alert it finds.
+   Reading as fast as snort writes means it never blocks on us while we block writing frames to it. */
+static gpointer snort_reader(gpointer data)
 {
     snort_session_t *session = (snort_session_t *)data;
 
-    /* Loop here until all available input read */
-    while (condition & G_IO_IN) {
+    /* Loop here until snort closes its output */
+    for (;;) {
         GIOStatus status;
-        char _buf[1024];
+        char _buf[4096];
         gsize len = 0;
 
         char *old_buf = NULL;
         char *buf = _buf;
         char *line;
 
-        /* Try to read snort output info _buf */
-        status = g_io_channel_read_chars(source, _buf, sizeof(_buf)-1, &len, NULL);
+        /* Wait for snort output into _buf */
+        status = g_io_channel_read_chars(session->channel, _buf, sizeof(_buf)-1, &len, NULL);
+        if (status == G_IO_STATUS_AGAIN) {
+            continue;
+        }
         if (status != G_IO_STATUS_NORMAL) {
-            if (status == G_IO_STATUS_AGAIN) {
-                /* Blocked, so unset G_IO_IN and get out of this function */
-                condition = (GIOCondition)(condition & ~G_IO_IN);
-                break;
-            }
             /* Other conditions here could be G_IO_STATUS_ERROR, G_IO_STATUS_EOF */
-            return FALSE;
+            break;
         }
         /* Terminate buffer */
         buf[len] = '\0';
@@ -595,28 +655,21 @@ static gboolean snort_fast_output(GIOChannel *source, GIOCondition condition, gp
             if (snort_parse_fast_line(buf, &alert)) {
                 /*******************************************************/
                 /* We have an alert line.                              */
-#if 0
-                g_print("%ld.%lu [%u,%u,%u] %s {%s} [%d]\n",
-                        alert.tv.tv_sec, alert.tv.tv_usec,
-                        alert.gen, alert.sid, alert.rev,
-                        alert.msg,
-                        alert.classification ? alert.classification : "(null)",
-                        alert.prio);
-#endif
+                Alert_t *queued = g_new(Alert_t, 1);
 
                 /* Copy the raw alert string itself */
                 alert.raw_alert = g_strdup(buf);
 
-                /* See if we can get more info from the parsed config details */
-                fill_alert_config(g_snort_config, &alert);
-
-                /* Add parsed alert into session->tree */
-                /* Store in tree. Frame number hidden in fraction of second field, so associate
-                   alert with that frame. */
-                add_alert_to_session_tree((guint)alert.original_frame, &alert);
+                /* The dissector matches it with the config and stores it by frame number,
+                   which is hidden in the fraction of second field. */
+                *queued = alert;
+                g_mutex_lock(&session->pending_lock);
+                g_ptr_array_add(session->pending_alerts, queued);
+                g_mutex_unlock(&session->pending_lock);
             }
             else {
-                g_print("snort_fast_output() line: '%s'\n", buf);
+                free_alert_strings(&alert);
+                g_print("snort_reader() line: '%s'\n", buf);
             }
 
             buf = line+1;
@@ -631,15 +684,39 @@ static gboolean snort_fast_output(GIOChannel *source, GIOCondition condition, gp
         g_free(old_buf);
     }
 
-    if ((condition == G_IO_ERR) || (condition == G_IO_HUP) || (condition == G_IO_NVAL)) {
-        /* Will report errors (hung-up, or error) */
+    return NULL;
+}
 
-        /* g_print("snort_fast_output() cond: (h:%d,e:%d,r:%d)\n",
-         *         !!(condition & G_IO_HUP), !!(condition & G_IO_ERR), condition); */
-        return FALSE;
+/* Move the alerts the reader has queued into current_session.alerts_tree. */
+static void collect_session_alerts(void)
+{
+    GPtrArray *alerts;
+    guint n;
+
+    if (!current_session.pending_alerts) {
+        return;
     }
 
-    return TRUE;
+    g_mutex_lock(&current_session.pending_lock);
+    alerts = current_session.pending_alerts;
+    if (alerts->len == 0) {
+        g_mutex_unlock(&current_session.pending_lock);
+        return;
+    }
+    current_session.pending_alerts = g_ptr_array_new();
+    g_mutex_unlock(&current_session.pending_lock);
+
+    for (n = 0; n < alerts->len; n++) {
+        Alert_t *alert = (Alert_t *)g_ptr_array_index(alerts, n);
+
+        /* See if we can get more info from the parsed config details */
+        fill_alert_config(g_snort_config, alert);
+
+        /* Store in tree. */
+        add_alert_to_session_tree((guint)alert->original_frame, alert);
+        g_free(alert);
+    }
+    g_ptr_array_free(alerts, TRUE);
 }
 
 
@@ -1104,6 +1181,8 @@ static const char *get_user_comment_string(proto_tree *tree)
 }
 
 
+static void snort_begin_pass(tvbuff_t *tvb, packet_info *pinfo);
+
 /********************************************************************************/
 /* Main (post-)dissector function.                                              */
 static int
@@ -1139,7 +1218,12 @@ snort_dissector(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data
         }
     }
     else {
-        /* We expect alerts from Snort.  Pass frame into snort on first pass. */
+        /* We expect alerts from Snort.  Pass frame into snort on first pass,
+           unless we already have its alerts for this file. */
+        if (!pinfo->fd->visited && !current_session.pass_started) {
+            current_session.pass_started = TRUE;
+            snort_begin_pass(tvb, pinfo);
+        }
         if (!pinfo->fd->visited && current_session.working) {
             int write_err = 0;
             gchar *err_info;
@@ -1202,17 +1286,21 @@ snort_dissector(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data
                 current_session.working = FALSE;
                 return 0;
             }
-            if (!wtap_dump_flush(current_session.pdh, &write_err)) {
-                /* XXX - report the error somehow? */
-                current_session.working = FALSE;
-                return 0;
+            /* Let snort have frames in batches rather than one at a time */
+            if (++current_session.frames_since_flush >= SNORT_FLUSH_FRAMES) {
+                current_session.frames_since_flush = 0;
+                if (!wtap_dump_flush(current_session.pdh, &write_err)) {
+                    /* XXX - report the error somehow? */
+                    current_session.working = FALSE;
+                    return 0;
+                }
             }
-
-            /* Give the io channel a chance to deliver alerts.
-               TODO: g_main_context_iteration(NULL, FALSE); causes crashes sometimes when Qt events get to execute.. */
         }
     }
 
+    /* Pick up whatever alerts snort has sent back since the last frame */
+    collect_session_alerts();
+
     /* Now look up stored alerts for this packet number, and display if found */
     if (current_session.alerts_tree && (alerts = (Alerts_t*)wmem_tree_lookup32(current_session.alerts_tree, pinfo->fd->num))) {
         guint n;
@@ -1223,7 +1311,8 @@ snort_dissector(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data
     } else {
         /* XXX, here either this frame doesn't generate alerts or we haven't received data from snort (async)
          *
-         *      It's problem when user want to filter tree on initial run, or is running one-pass tshark.
+         *      It's problem when user want to filter tree on initial run, or is running one-pass tshark;
+         *      the alerts are all there once the first pass is over.
          */
     }
 
@@ -1232,11 +1321,10 @@ snort_dissector(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data
 
 
 /*------------------------------------------------------------------*/
-/* Start up Snort. */
-static void snort_start(void)
+/* Run Snort, with a thread to read the alerts it writes. */
+static void snort_spawn(void)
 {
     GIOChannel *channel;
-    /* int snort_output_id; */
     const gchar *argv[] = {
         pref_snort_binary_filename, "-c", pref_snort_config_filename,
         /* read from stdin */
@@ -1257,42 +1345,6 @@ static void snort_start(void)
         argv[10] = NULL;
     }
 
-    /* Enable field priming if required. */
-    if (snort_alert_in_reassembled_frame) {
-        /* Add items we want to try to get to find before we get called.
-           For now, just ask for tcp.reassembled_in, which won't be seen
-           on the first pass through the packets. */
-        GArray *wanted_hfids = g_array_new(FALSE, FALSE, (guint)sizeof(int));
-        int id = proto_registrar_get_id_byname("tcp.reassembled_in");
-        g_array_append_val(wanted_hfids, id);
-        set_postdissector_wanted_hfids(snort_handle, wanted_hfids);
-    }
-
-    /* Nothing to do if not enabled, but registered init function gets called anyway */
-    if ((pref_snort_alerts_source == FromNowhere) ||
-        !proto_is_protocol_enabled(find_protocol_by_id(proto_snort))) {
-        return;
-    }
-
-    /* Create tree mapping packet_number -> Alerts_t*.  It will get recreated when packet list is reloaded */
-    current_session.alerts_tree = wmem_tree_new_autoreset(wmem_epan_scope(), wmem_file_scope());
-
-    /* Create afresh the config object by parsing the same file that snort uses */
-    if (g_snort_config) {
-        delete_config(&g_snort_config);
-    }
-    create_config(&g_snort_config, pref_snort_config_filename);
-
-    /* Don't run Snort if not configured to */
-    if (pref_snort_alerts_source == FromUserComments) {
-        return;
-    }
-
-    /* Don't start if already running */
-    if (current_session.running) {
-        return;
-    }
-
     /* Reset global stats */
     reset_global_rule_stats(g_snort_config);
 
@@ -1359,7 +1411,7 @@ static void snort_start(void)
     g_child_watch_add(current_session.pid, snort_reaper, &current_session);
 
     /******************************************************************/
-    /* Create channel to get notified of snort alert output on stdout */
+    /* Create channel to read snort alert output on stdout */
 
     /* Create channel itself */
     channel = g_io_channel_unix_new(current_session.out);
@@ -1369,30 +1421,21 @@ static void snort_start(void)
     g_io_channel_set_encoding(channel, NULL, NULL);
     /* Don't buffer the channel (settable because encoding set to NULL). */
     g_io_channel_set_buffered(channel, FALSE);
-    /* Set flags */
-    /* TODO: could set to be blocking and get sync that way? */
-    g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
-    /* Try setting a large buffer here. */
-    g_io_channel_set_buffer_size(channel, 256000);
 
     current_session.buf = NULL;
+    current_session.frames_since_flush = 0;
+    if (!current_session.pending_alerts) {
+        current_session.pending_alerts = g_ptr_array_new();
+    }
 
-    /* Set callback for receiving data from the channel */
-    g_io_add_watch_full(channel,
-                        G_PRIORITY_HIGH,
-                        (GIOCondition)(G_IO_IN|G_IO_ERR|G_IO_HUP),
-                        snort_fast_output,  /* Callback upon data being written by snort */
-                        &current_session,   /* User data */
-                        NULL);              /* Destroy notification callback */
-
-    current_session.working = TRUE;
+    /* Read alerts on a thread of their own, so that neither we nor snort wait for the other */
+    current_session.reader = g_thread_new("snort_reader", snort_reader, &current_session);
 }
 
-/* This is the cleanup routine registered with register_postseq_cleanup_routine() */
-static void snort_cleanup(void)
+/* Stop feeding snort, wait for it to finish with what it has had, and collect its last alerts. */
+static void snort_stop(void)
 {
-    /* Only close if we think its running */
-    if (!current_session.running) {
+    if (!current_session.reader) {
         return;
     }
 
@@ -1406,6 +1449,122 @@ static void snort_cleanup(void)
         }
         current_session.pdh = NULL;
     }
+    else {
+        /* Never sent it anything */
+        ws_close(current_session.in);
+    }
+
+    /* Once snort has exited, the reader sees the end of its output */
+    g_thread_join(current_session.reader);
+    current_session.reader = NULL;
+
+    g_io_channel_shutdown(current_session.channel, FALSE, NULL);
+    g_io_channel_unref(current_session.channel);
+    current_session.channel = NULL;
+    ws_close(current_session.err);
+
+    if (current_session.buf) {
+        g_string_free(current_session.buf, TRUE);
+        current_session.buf = NULL;
+    }
+
+    collect_session_alerts();
+
+    current_session.working = FALSE;
+}
+
+/* Called for the first frame of a first pass: either reuse the alerts for this
+   file that we already have, or run snort to get them. */
+static void snort_begin_pass(tvbuff_t *tvb, packet_info *pinfo)
+{
+    guint len = tvb_captured_length(tvb);
+    guint32 crc = crc32_ccitt_tvb(tvb, len);
+
+    /* A redissection of the same file, with the same Snort?  Its alerts still hold.
+       (The file is recognized by its first frame.) */
+    if (current_session.alerts_complete &&
+        nstime_cmp(&pinfo->abs_ts, &current_session.first_frame_ts) == 0 &&
+        len == current_session.first_frame_len &&
+        crc == current_session.first_frame_crc &&
+        g_strcmp0(pref_snort_binary_filename, current_session.alerts_binary_filename) == 0 &&
+        g_strcmp0(pref_snort_config_filename, current_session.alerts_config_filename) == 0 &&
+        snort_ignore_checksum_errors == current_session.alerts_ignored_checksum_errors) {
+        /* The config was parsed afresh, so link the alerts to it again */
+        reset_global_rule_stats(g_snort_config);
+        wmem_tree_foreach(current_session.alerts_tree, refill_alerts_cb, NULL);
+        return;
+    }
+
+    /* Snort may still be running for a pass that never finished */
+    snort_stop();
+    discard_session_alerts();
+
+    current_session.first_frame_ts = pinfo->abs_ts;
+    current_session.first_frame_len = len;
+    current_session.first_frame_crc = crc;
+    g_free(current_session.alerts_binary_filename);
+    current_session.alerts_binary_filename = g_strdup(pref_snort_binary_filename);
+    g_free(current_session.alerts_config_filename);
+    current_session.alerts_config_filename = g_strdup(pref_snort_config_filename);
+    current_session.alerts_ignored_checksum_errors = snort_ignore_checksum_errors;
+
+    snort_spawn();
+}
+
+/* Get ready for a pass through the frames. */
+static void snort_start(void)
+{
+    /* Enable field priming if required. */
+    if (snort_alert_in_reassembled_frame) {
+        /* Add items we want to try to get to find before we get called.
+           For now, just ask for tcp.reassembled_in, which won't be seen
+           on the first pass through the packets. */
+        GArray *wanted_hfids = g_array_new(FALSE, FALSE, (guint)sizeof(int));
+        int id = proto_registrar_get_id_byname("tcp.reassembled_in");
+        g_array_append_val(wanted_hfids, id);
+        set_postdissector_wanted_hfids(snort_handle, wanted_hfids);
+    }
+
+    /* Nothing to do if not enabled, but registered init function gets called anyway */
+    if ((pref_snort_alerts_source == FromNowhere) ||
+        !proto_is_protocol_enabled(find_protocol_by_id(proto_snort))) {
+        return;
+    }
+
+    /* Create afresh the config object by parsing the same file that snort uses */
+    if (g_snort_config) {
+        delete_config(&g_snort_config);
+    }
+    create_config(&g_snort_config, pref_snort_config_filename);
+
+    /* Alerts from user comments are read again on every pass */
+    if (pref_snort_alerts_source == FromUserComments) {
+        discard_session_alerts();
+        return;
+    }
+
+    /* Map of packet_number -> Alerts_t*.  Kept while the same file is redissected;
+       whether snort runs is decided when the first frame turns up. */
+    if (!current_session.alerts_tree) {
+        discard_session_alerts();
+    }
+    current_session.pass_started = FALSE;
+}
+
+/* This is the cleanup routine registered with register_postseq_cleanup_routine() */
+static void snort_cleanup(void)
+{
+    gboolean complete;
+
+    /* Only close if we think its running */
+    if (!current_session.reader) {
+        return;
+    }
+
+    /* If no frame went astray, the alerts are all there is for this file */
+    complete = current_session.working;
+    snort_stop();
+    current_session.alerts_complete = complete;
 }
 
 static void snort_file_cleanup(void)
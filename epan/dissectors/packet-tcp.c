@@ -657,6 +657,10 @@ static dissector_handle_t tcp_opt_unknown_handle;
 static guint32 tcp_stream_count;
 static guint32 mptcp_stream_count;
 
+/* The frames of each TCP stream seen in the first pass, as frame_list_t
+ * pointers indexed by stream number */
+static wmem_array_t *tcp_stream_frames;
+
 
 
 /*
@@ -1111,7 +1115,7 @@ check_follow_fragments(follow_info_t *follow_info, gboolean is_server, guint32 a
                                                               fragment->data->data + new_pos,
                                                               new_frag_size);
 
-                    follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
+                    follow_add_record(follow_info, follow_record);
                 }
 
                 follow_info->seq[is_server] += (fragment->data->len - new_pos);
@@ -1128,12 +1132,12 @@ check_follow_fragments(follow_info_t *follow_info, gboolean is_server, guint32 a
 
         if( EQ_SEQ(fragment->seq, follow_info->seq[is_server]) ) {
             /* this fragment fits the stream */
-            if( fragment->data->len > 0 ) {
-                follow_info->payload = g_list_prepend(follow_info->payload, fragment);
-            }
-
             follow_info->seq[is_server] += fragment->data->len;
             follow_info->fragments[is_server] = g_list_delete_link(follow_info->fragments[is_server], fragment_entry);
+
+            if( fragment->data->len > 0 ) {
+                follow_add_record(follow_info, fragment);
+            }
             return TRUE;
         }
     }
@@ -1158,7 +1162,7 @@ check_follow_fragments(follow_info_t *follow_info, gboolean is_server, guint32 a
         follow_record->seq = lowest_seq;
 
         follow_info->seq[is_server] = lowest_seq;
-        follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
+        follow_add_record(follow_info, follow_record);
         return TRUE;
     }
 
@@ -1248,7 +1252,7 @@ follow_tcp_tap_listener(void *tapdata, packet_info *pinfo,
         /* The segment overlaps or extends the previous end of stream. */
         follow_info->seq[is_server] += length;
         follow_info->bytes_written[is_server] += follow_record->data->len;
-        follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
+        follow_add_record(follow_info, follow_record);
 
         /* done with the packet, see if it caused a fragment to fit */
         while(check_follow_fragments(follow_info, is_server, 0, pinfo->fd->num, FALSE));
@@ -1722,6 +1726,38 @@ guint32 get_tcp_stream_count(void)
     return tcp_stream_count;
 }
 
+static void
+tcp_stream_frames_add(guint32 stream, guint32 frame)
+{
+    frame_list_t *frames;
+
+    while (wmem_array_get_count(tcp_stream_frames) <= stream) {
+        frames = frame_list_new(wmem_file_scope());
+        wmem_array_append_one(tcp_stream_frames, frames);
+    }
+
+    frames = *(frame_list_t **)wmem_array_index(tcp_stream_frames, stream);
+    frame_list_append(frames, frame);
+}
+
+const frame_list_t *get_tcp_stream_frames(guint32 stream)
+{
+    if (!tcp_stream_frames || stream >= wmem_array_get_count(tcp_stream_frames))
+        return NULL;
+
+    return *(frame_list_t **)wmem_array_index(tcp_stream_frames, stream);
+}
+
+gboolean get_tcp_stream_frame_range(guint32 stream, guint32 *first_frame, guint32 *last_frame)
+{
+    const frame_list_t *frames = get_tcp_stream_frames(stream);
+
+    if (!frames)
+        return FALSE;
+
+    return frame_list_bounds(frames, first_frame, last_frame);
+}
+
 /* Return the mptcp current stream count */
 guint32 get_mptcp_stream_count(void)
 {
@@ -2385,11 +2421,10 @@ finished_fwd:
              * go back to the eldest one, which in theory is likely to be the one retransmitted here.
              * It's not always the perfect match, particularly when original captured packet used LSO
              */
-            ual = tcpd->fwd->tcp_analyze_seq_info->segments;
-            while(ual) {
+            ual = tcpd->fwd->tcp_analyze_seq_info->segments_tail;
+            if(ual) {
                 nstime_delta(&tcpd->ta->rto_ts, &pinfo->abs_ts, &ual->ts );
                 tcpd->ta->rto_frame=ual->frame;
-                ual=ual->next;
             }
         }
     }
@@ -2403,6 +2438,9 @@ finished_checking_retransmission_type:
          */
         ual = wmem_new(wmem_file_scope(), tcp_unacked_t);
         ual->next=tcpd->fwd->tcp_analyze_seq_info->segments;
+        if (!ual->next) {
+            tcpd->fwd->tcp_analyze_seq_info->segments_tail=ual;
+        }
         tcpd->fwd->tcp_analyze_seq_info->segments=ual;
         tcpd->fwd->tcp_analyze_seq_info->segment_count++;
         ual->frame=pinfo->num;
@@ -2507,6 +2545,9 @@ finished_checking_retransmission_type:
         else{
             prevual->next = tmpual;
         }
+        if (!tmpual) {
+            tcpd->rev->tcp_analyze_seq_info->segments_tail = prevual;
+        }
         wmem_free(wmem_file_scope(), ual);
         ual = tmpual;
         tcpd->rev->tcp_analyze_seq_info->segment_count--;
@@ -6752,6 +6793,10 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
          */
         tcph->th_stream = tcpd->stream;
 
+        if (!PINFO_FD_VISITED(pinfo)) {
+            tcp_stream_frames_add(tcpd->stream, pinfo->num);
+        }
+
         /* initialize the SACK blocks seen to 0 */
         if(tcp_analyze_seq && tcpd->fwd->tcp_analyze_seq_info) {
             tcpd->fwd->tcp_analyze_seq_info->num_sack_ranges = 0;
@@ -7484,6 +7529,7 @@ static void
 tcp_init(void)
 {
     tcp_stream_count = 0;
+    tcp_stream_frames = wmem_array_new(wmem_file_scope(), sizeof(frame_list_t *));
 
     /* MPTCP init */
     mptcp_stream_count = 0;
@@ -8673,6 +8719,7 @@ proto_register_tcp(void)
     register_conversation_table(proto_mptcp, FALSE, mptcpip_conversation_packet, tcpip_hostlist_packet);
     register_follow_stream(proto_tcp, "tcp_follow", tcp_follow_conv_filter, tcp_follow_index_filter, tcp_follow_address_filter,
                             tcp_port_to_display, follow_tcp_tap_listener);
+    frame_list_register_stream_field("tcp.stream", get_tcp_stream_frames);
 }
 
 void
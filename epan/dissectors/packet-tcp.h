@@ -14,6 +14,7 @@
 
 #include <epan/conversation.h>
 #include <epan/wmem_scopes.h>
+#include <epan/frame_list.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -295,6 +296,7 @@ typedef enum {
  */
 typedef struct tcp_analyze_seq_flow_info_t {
 	tcp_unacked_t *segments;/* List of segments for which we haven't seen an ACK */
+	tcp_unacked_t *segments_tail;/* Last (eldest) entry of segments */
 	guint16 segment_count;	/* How many unacked segments we're currently storing */
     guint32 lastack;	/* Last seen ack for the reverse flow */
 	nstime_t lastacktime;	/* Time of the last ack packet */
@@ -532,6 +534,22 @@ extern void add_tcp_process_info(guint32 frame_num, address *local_addr, address
  */
 WS_DLL_PUBLIC guint32 get_tcp_stream_count(void);
 
+/** Get the first and last frame of a TCP stream seen in the first pass
+ *
+ * @param stream The TCP stream number
+ * @param first_frame Set to the number of the first frame of the stream
+ * @param last_frame Set to the number of the last frame of the stream
+ * @return TRUE if the stream was found, FALSE otherwise
+ */
+WS_DLL_PUBLIC gboolean get_tcp_stream_frame_range(guint32 stream, guint32 *first_frame, guint32 *last_frame);
+
+/** Get the frames of a TCP stream seen in the first pass
+ *
+ * @param stream The TCP stream number
+ * @return The stream's frames, or NULL if the stream wasn't found
+ */
+WS_DLL_PUBLIC const frame_list_t *get_tcp_stream_frames(guint32 stream);
+
 /** Get the current number of MPTCP streams
  *
  * @return The number of MPTCP streams
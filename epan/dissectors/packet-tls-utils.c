@@ -31,6 +31,7 @@
 #include <epan/proto_data.h>
 #include <epan/oids.h>
 #include <epan/secrets.h>
+#include <epan/str_intern.h>
 
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
@@ -2531,23 +2532,31 @@ ssl_data_copy(StringInfo* dst, StringInfo* src)
     return 0;
 }
 
-/* from_hex converts |hex_len| bytes of hex data from |in| and sets |*out| to
- * the result. |out->data| will be allocated using wmem_file_scope. Returns TRUE on
- * success. */
-static gboolean from_hex(StringInfo* out, const char* in, gsize hex_len) {
+/* hex_to_bytes converts |hex_len| (even) bytes of hex data from |in| into
+ * |out|, which must have room for |hex_len| / 2 bytes. */
+static gboolean hex_to_bytes(guchar* out, const char* in, gsize hex_len) {
     gsize i;
 
-    if (hex_len & 1)
-        return FALSE;
-
-    out->data = (guchar *)wmem_alloc(wmem_file_scope(), hex_len / 2);
     for (i = 0; i < hex_len / 2; i++) {
         int a = ws_xton(in[i*2]);
         int b = ws_xton(in[i*2 + 1]);
         if (a == -1 || b == -1)
             return FALSE;
-        out->data[i] = a << 4 | b;
+        out[i] = a << 4 | b;
     }
+    return TRUE;
+}
+
+/* from_hex converts |hex_len| bytes of hex data from |in| and sets |*out| to
+ * the result. |out->data| will be allocated using wmem_file_scope. Returns TRUE on
+ * success. */
+static gboolean from_hex(StringInfo* out, const char* in, gsize hex_len) {
+    if (hex_len & 1)
+        return FALSE;
+
+    out->data = (guchar *)wmem_alloc(wmem_file_scope(), hex_len / 2);
+    if (!hex_to_bytes(out->data, in, hex_len))
+        return FALSE;
     out->data_len = (guint)hex_len / 2;
     return TRUE;
 }
@@ -5554,6 +5563,8 @@ ssl_get_record_info(tvbuff_t *parent_tvb, int proto, packet_info *pinfo, gint re
 /* Links SSL records with the real packet data. }}} */
 
 /* initialize/reset per capture state data (ssl sessions cache). {{{ */
+static void tls_keylog_maps_cleared(FILE **keylog_file);
+
 void
 ssl_common_init(ssl_master_key_map_t *mk_map,
                 StringInfo *decrypted_data, StringInfo *compressed_data)
@@ -5594,12 +5605,10 @@ ssl_common_cleanup(ssl_master_key_map_t *mk_map, FILE **ssl_keylog_file,
     g_free(decrypted_data->data);
     g_free(compressed_data->data);
 
-    /* close the previous keylog file now that the cache are cleared, this
-     * allows the cache to be filled with the full keylog file contents. */
-    if (*ssl_keylog_file) {
-        fclose(*ssl_keylog_file);
-        *ssl_keylog_file = NULL;
-    }
+    /* The keylog file is left open, the records read so far are put back
+     * into the new maps on the next ssl_load_keyfile call and only lines
+     * appended since then are parsed. */
+    tls_keylog_maps_cleared(ssl_keylog_file);
 }
 /* }}} */
 
@@ -6041,27 +6050,150 @@ ssl_compile_keyfile_regex(void)
 
 typedef struct ssl_master_key_match_group {
     const char *re_group_name;
-    GHashTable *master_key_ht;
+    size_t      master_key_ht_offset;   /* GHashTable * in ssl_master_key_map_t */
 } ssl_master_key_match_group_t;
 
-void
-tls_keylog_process_lines(const ssl_master_key_map_t *mk_map, const guint8 *data, guint datalen)
+static const ssl_master_key_match_group_t mk_groups[] = {
+    { "encrypted_pmk",  G_STRUCT_OFFSET(ssl_master_key_map_t, pre_master) },
+    { "session_id",     G_STRUCT_OFFSET(ssl_master_key_map_t, session) },
+    { "client_random",  G_STRUCT_OFFSET(ssl_master_key_map_t, crandom) },
+    { "client_random_pms",  G_STRUCT_OFFSET(ssl_master_key_map_t, pms) },
+    /* TLS 1.3 map from Client Random to derived secret. */
+    { "client_early",       G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_client_early) },
+    { "client_handshake",   G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_client_handshake) },
+    { "server_handshake",   G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_server_handshake) },
+    { "client_appdata",     G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_client_appdata) },
+    { "server_appdata",     G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_server_appdata) },
+    { "early_exporter",     G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_early_exporter) },
+    { "exporter",           G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_exporter) },
+};
+
+static GHashTable *
+mk_group_ht(const ssl_master_key_map_t *mk_map, guint group)
 {
-    ssl_master_key_match_group_t mk_groups[] = {
-        { "encrypted_pmk",  mk_map->pre_master },
-        { "session_id",     mk_map->session },
-        { "client_random",  mk_map->crandom },
-        { "client_random_pms",  mk_map->pms },
-        /* TLS 1.3 map from Client Random to derived secret. */
-        { "client_early",       mk_map->tls13_client_early },
-        { "client_handshake",   mk_map->tls13_client_handshake },
-        { "server_handshake",   mk_map->tls13_server_handshake },
-        { "client_appdata",     mk_map->tls13_client_appdata },
-        { "server_appdata",     mk_map->tls13_server_appdata },
-        { "early_exporter",     mk_map->tls13_early_exporter },
-        { "exporter",           mk_map->tls13_exporter },
-    };
+    return *(GHashTable * const *)((const char *)mk_map + mk_groups[group].master_key_ht_offset);
+}
+
+/* A parsed keylog record. The key and secret bytes follow the structure in
+ * the same allocation. */
+typedef struct tls_keylog_entry {
+    StringInfo  key;
+    StringInfo  secret;
+    guint       group;      /* index in mk_groups */
+} tls_keylog_entry_t;
+
+/*
+ * Records read from tls.keylog_file. They outlive the capture file so that a
+ * redissection (or the next capture file) only has to put them back into the
+ * fresh master key maps instead of parsing the whole keylog again; the file
+ * itself stays open and only lines appended since the last read are parsed.
+ */
+static struct {
+    wmem_allocator_t   *scope;      /* owns all entries */
+    GPtrArray          *entries;    /* tls_keylog_entry_t, in file order */
+    FILE               *file;       /* keylog the entries were read from */
+    gboolean            in_map;     /* entries are in the current mk_map */
+    GSList             *retired;    /* scopes of a replaced keylog, still in mk_map */
+} tls_keylog_store;
+
+static void
+tls_keylog_store_reset(void)
+{
+    if (tls_keylog_store.scope) {
+        g_ptr_array_free(tls_keylog_store.entries, TRUE);
+        if (tls_keylog_store.in_map) {
+            /* The maps are only cleared by ssl_common_cleanup. */
+            tls_keylog_store.retired = g_slist_prepend(tls_keylog_store.retired, tls_keylog_store.scope);
+        } else {
+            wmem_destroy_allocator(tls_keylog_store.scope);
+        }
+    }
+    tls_keylog_store.scope = NULL;
+    tls_keylog_store.entries = NULL;
+    tls_keylog_store.file = NULL;
+    tls_keylog_store.in_map = FALSE;
+}
+
+static void
+tls_keylog_maps_cleared(FILE **keylog_file)
+{
+    g_slist_free_full(tls_keylog_store.retired, (GDestroyNotify)wmem_destroy_allocator);
+    tls_keylog_store.retired = NULL;
+    tls_keylog_store.in_map = FALSE;
+
+    if (tls_keylog_store.file != *keylog_file) {
+        ssl_close_keyfile(keylog_file);
+    }
+}
+
+/* Parses a single record (without line terminator), returns NULL if the line
+ * is not a valid record. */
+static tls_keylog_entry_t *
+tls_keylog_parse_line(GRegex *regex, const char *line, gssize linelen, wmem_allocator_t *scope)
+{
+    GMatchInfo *mi;
+    tls_keylog_entry_t *entry = NULL;
+
+    if (g_regex_match_full(regex, line, linelen, 0, G_REGEX_MATCH_ANCHORED, &mi, NULL)) {
+        gchar *hex_key = NULL, *hex_pre_ms_or_ms;
+        guint group = 0;
 
+        /* Is the PMS being supplied with the PMS_CLIENT_RANDOM
+         * otherwise we will use the Master Secret
+         */
+        hex_pre_ms_or_ms = g_match_info_fetch_named(mi, "master_secret");
+        if (hex_pre_ms_or_ms == NULL || !*hex_pre_ms_or_ms) {
+            g_free(hex_pre_ms_or_ms);
+            hex_pre_ms_or_ms = g_match_info_fetch_named(mi, "pms");
+        }
+        if (hex_pre_ms_or_ms == NULL || !*hex_pre_ms_or_ms) {
+            g_free(hex_pre_ms_or_ms);
+            hex_pre_ms_or_ms = g_match_info_fetch_named(mi, "derived_secret");
+        }
+        /* There is always a match, otherwise the regex is wrong. */
+        DISSECTOR_ASSERT(hex_pre_ms_or_ms && strlen(hex_pre_ms_or_ms));
+
+        /* Find a master key from any format (CLIENT_RANDOM, SID, ...) */
+        for (group = 0; group < G_N_ELEMENTS(mk_groups); group++) {
+            hex_key = g_match_info_fetch_named(mi, mk_groups[group].re_group_name);
+            if (hex_key && *hex_key) {
+                ssl_debug_printf("    matched %s\n", mk_groups[group].re_group_name);
+                break;
+            }
+            g_free(hex_key);
+            hex_key = NULL;
+        }
+        DISSECTOR_ASSERT(hex_key); /* Cannot be reached, or regex is wrong. */
+
+        /* convert from hex to bytes, both behind the entry */
+        gsize key_len = strlen(hex_key) / 2;
+        gsize secret_len = strlen(hex_pre_ms_or_ms) / 2;
+        entry = (tls_keylog_entry_t *)wmem_alloc(scope, sizeof(*entry) + key_len + secret_len);
+        entry->group = group;
+        entry->key.data = (guchar *)(entry + 1);
+        entry->key.data_len = (guint)key_len;
+        entry->secret.data = entry->key.data + key_len;
+        entry->secret.data_len = (guint)secret_len;
+        hex_to_bytes(entry->key.data, hex_key, key_len * 2);
+        hex_to_bytes(entry->secret.data, hex_pre_ms_or_ms, secret_len * 2);
+        g_free(hex_key);
+        g_free(hex_pre_ms_or_ms);
+
+    } else if (linelen > 0 && line[0] != '#') {
+        ssl_debug_printf("    unrecognized line\n");
+    }
+    /* always free match info even if there is no match. */
+    g_match_info_free(mi);
+
+    return entry;
+}
+
+/* Parses the records in data into mk_map. If entries is not NULL, the parsed
+ * records are also appended to it. */
+static void
+tls_keylog_process_data(const ssl_master_key_map_t *mk_map, const guint8 *data, guint datalen,
+                        wmem_allocator_t *scope, GPtrArray *entries)
+{
     /* The format of the file is a series of records with one of the following formats:
      *   - "RSA xxxx yyyy"
      *     Where xxxx are the first 8 bytes of the encrypted pre-master secret (hex-encoded)
@@ -6122,58 +6254,23 @@ tls_keylog_process_lines(const ssl_master_key_map_t *mk_map, const guint8 *data,
         }
 
         ssl_debug_printf("  checking keylog line: %.*s\n", (int)linelen, line);
-        GMatchInfo *mi;
-        if (g_regex_match_full(regex, line, linelen, 0, G_REGEX_MATCH_ANCHORED, &mi, NULL)) {
-            gchar *hex_key, *hex_pre_ms_or_ms;
-            StringInfo *key = wmem_new(wmem_file_scope(), StringInfo);
-            StringInfo *pre_ms_or_ms = NULL;
-            GHashTable *ht = NULL;
-
-            /* Is the PMS being supplied with the PMS_CLIENT_RANDOM
-             * otherwise we will use the Master Secret
-             */
-            hex_pre_ms_or_ms = g_match_info_fetch_named(mi, "master_secret");
-            if (hex_pre_ms_or_ms == NULL || !*hex_pre_ms_or_ms) {
-                g_free(hex_pre_ms_or_ms);
-                hex_pre_ms_or_ms = g_match_info_fetch_named(mi, "pms");
+        tls_keylog_entry_t *entry = tls_keylog_parse_line(regex, line, linelen, scope);
+        if (entry) {
+            g_hash_table_insert(mk_group_ht(mk_map, entry->group), &entry->key, &entry->secret);
+            if (entries) {
+                g_ptr_array_add(entries, entry);
             }
-            if (hex_pre_ms_or_ms == NULL || !*hex_pre_ms_or_ms) {
-                g_free(hex_pre_ms_or_ms);
-                hex_pre_ms_or_ms = g_match_info_fetch_named(mi, "derived_secret");
-            }
-            /* There is always a match, otherwise the regex is wrong. */
-            DISSECTOR_ASSERT(hex_pre_ms_or_ms && strlen(hex_pre_ms_or_ms));
-
-            /* convert from hex to bytes and save to hashtable */
-            pre_ms_or_ms = wmem_new(wmem_file_scope(), StringInfo);
-            from_hex(pre_ms_or_ms, hex_pre_ms_or_ms, strlen(hex_pre_ms_or_ms));
-            g_free(hex_pre_ms_or_ms);
-
-            /* Find a master key from any format (CLIENT_RANDOM, SID, ...) */
-            for (unsigned i = 0; i < G_N_ELEMENTS(mk_groups); i++) {
-                ssl_master_key_match_group_t *g = &mk_groups[i];
-                hex_key = g_match_info_fetch_named(mi, g->re_group_name);
-                if (hex_key && *hex_key) {
-                    ssl_debug_printf("    matched %s\n", g->re_group_name);
-                    ht = g->master_key_ht;
-                    from_hex(key, hex_key, strlen(hex_key));
-                    g_free(hex_key);
-                    break;
-                }
-                g_free(hex_key);
-            }
-            DISSECTOR_ASSERT(ht); /* Cannot be reached, or regex is wrong. */
-
-            g_hash_table_insert(ht, key, pre_ms_or_ms);
-
-        } else if (linelen > 0 && line[0] != '#') {
-            ssl_debug_printf("    unrecognized line\n");
         }
-        /* always free match info even if there is no match. */
-        g_match_info_free(mi);
     }
 }
 
+void
+tls_keylog_process_lines(const ssl_master_key_map_t *mk_map, const guint8 *data, guint datalen)
+{
+    /* Secrets embedded in the capture file only live as long as that file. */
+    tls_keylog_process_data(mk_map, data, datalen, wmem_file_scope(), NULL);
+}
+
 void
 ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
                  const ssl_master_key_map_t *mk_map)
@@ -6182,6 +6279,7 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
     if (!tls_keylog_filename || !*tls_keylog_filename) {
         ssl_debug_printf("%s dtls/tls.keylog_file is not configured!\n",
                          G_STRFUNC);
+        ssl_close_keyfile(keylog_file);
         return;
     }
 
@@ -6195,8 +6293,7 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
     /* if the keylog file was deleted/overwritten, re-open it */
     if (*keylog_file && file_needs_reopen(ws_fileno(*keylog_file), tls_keylog_filename)) {
         ssl_debug_printf("%s file got deleted, trying to re-open\n", G_STRFUNC);
-        fclose(*keylog_file);
-        *keylog_file = NULL;
+        ssl_close_keyfile(keylog_file);
     }
 
     if (*keylog_file == NULL) {
@@ -6207,6 +6304,24 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
         }
     }
 
+    if (tls_keylog_store.file != *keylog_file) {
+        tls_keylog_store_reset();
+        tls_keylog_store.scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+        tls_keylog_store.entries = g_ptr_array_new();
+        tls_keylog_store.file = *keylog_file;
+    }
+
+    /* Put back what was read before the maps were last cleared. */
+    if (!tls_keylog_store.in_map) {
+        ssl_debug_printf("%s restoring %u entries read before\n", G_STRFUNC,
+                         tls_keylog_store.entries->len);
+        for (guint i = 0; i < tls_keylog_store.entries->len; i++) {
+            tls_keylog_entry_t *entry = (tls_keylog_entry_t *)g_ptr_array_index(tls_keylog_store.entries, i);
+            g_hash_table_insert(mk_group_ht(mk_map, entry->group), &entry->key, &entry->secret);
+        }
+        tls_keylog_store.in_map = TRUE;
+    }
+
     for (;;) {
         char buf[1110], *line;
         line = fgets(buf, sizeof(buf), *keylog_file);
@@ -6216,12 +6331,24 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
                 clearerr(*keylog_file);
             } else if (ferror(*keylog_file)) {
                 ssl_debug_printf("%s Error while reading key log file, closing it!\n", G_STRFUNC);
-                fclose(*keylog_file);
-                *keylog_file = NULL;
+                ssl_close_keyfile(keylog_file);
             }
             break;
         }
-        tls_keylog_process_lines(mk_map, (guint8 *)line, (int)strlen(line));
+        tls_keylog_process_data(mk_map, (guint8 *)line, (int)strlen(line),
+                                tls_keylog_store.scope, tls_keylog_store.entries);
+    }
+}
+
+void
+ssl_close_keyfile(FILE **keylog_file)
+{
+    if (*keylog_file) {
+        if (tls_keylog_store.file == *keylog_file) {
+            tls_keylog_store_reset();
+        }
+        fclose(*keylog_file);
+        *keylog_file = NULL;
     }
 }
 /** SSL keylog file handling. }}} */
@@ -6910,7 +7037,7 @@ ssl_dissect_hnd_hello_ext_alpn(ssl_common_dissect_t *hf, tvbuff_t *tvb,
     if (proto_name) {
         dissector_handle_t handle;
 
-        session->alpn_name = wmem_strdup(wmem_file_scope(), proto_name);
+        session->alpn_name = str_intern(proto_name);
 
         if (is_dtls) {
             handle = dissector_get_string_handle(dtls_alpn_dissector_table,
@@ -320,6 +320,12 @@ ssl_cleanup(void)
     ssl_crandom_hash = NULL;
 }
 
+static void
+ssl_shutdown(void)
+{
+    ssl_close_keyfile(&ssl_keylog_file);
+}
+
 ssl_master_key_map_t *
 tls_get_master_key_map(gboolean load_secrets)
 {
@@ -472,7 +478,7 @@ ssl_follow_tap_listener(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _
                                               appl_data->data_len);
 
         /* Add the record to the follow_info structure. */
-        follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
+        follow_add_record(follow_info, follow_record);
         follow_info->bytes_written[from] += appl_data->data_len;
     }
 
@@ -4574,6 +4580,7 @@ proto_register_tls(void)
 
     register_init_routine(ssl_init);
     register_cleanup_routine(ssl_cleanup);
+    register_shutdown_routine(ssl_shutdown);
     reassembly_table_register(&ssl_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
     reassembly_table_register(&tls_hs_reassembly_table,
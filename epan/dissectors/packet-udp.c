@@ -106,6 +106,10 @@ static dissector_table_t udp_dissector_table;
 static heur_dissector_list_t heur_subdissector_list;
 static guint32 udp_stream_count;
 
+/* The frames of each UDP stream seen in the first pass, as frame_list_t
+ * pointers indexed by stream number */
+static wmem_array_t *udp_stream_frames;
+
 /* Determine if there is a sub-dissector and call it.  This has been */
 /* separated into a stand alone routine so other protocol dissectors */
 /* can call to it, ie. socks */
@@ -464,6 +468,28 @@ guint32 get_udp_stream_count(void)
     return udp_stream_count;
 }
 
+static void
+udp_stream_frames_add(guint32 stream, guint32 frame)
+{
+    frame_list_t *frames;
+
+    while (wmem_array_get_count(udp_stream_frames) <= stream) {
+        frames = frame_list_new(wmem_file_scope());
+        wmem_array_append_one(udp_stream_frames, frames);
+    }
+
+    frames = *(frame_list_t **)wmem_array_index(udp_stream_frames, stream);
+    frame_list_append(frames, frame);
+}
+
+const frame_list_t *get_udp_stream_frames(guint32 stream)
+{
+    if (!udp_stream_frames || stream >= wmem_array_get_count(udp_stream_frames))
+        return NULL;
+
+    return *(frame_list_t **)wmem_array_index(udp_stream_frames, stream);
+}
+
 static void
 handle_export_pdu_dissection_table(packet_info *pinfo, tvbuff_t *tvb, guint32 port)
 {
@@ -537,9 +563,28 @@ handle_export_pdu_conversation(packet_info *pinfo, tvbuff_t *tvb, int uh_dport,
     }
 }
 
-void
-decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
-             proto_tree *udp_tree, int uh_sport, int uh_dport, int uh_ulen)
+/*
+ * Call the dissector registered for a port, and, if it accepts the packet,
+ * remember it in the conversation.
+ */
+static gboolean
+try_udp_port(int port, tvbuff_t *next_tvb, packet_info *pinfo,
+             proto_tree *tree, struct udp_analysis *udpd)
+{
+    if (!dissector_try_uint(udp_dissector_table, port, next_tvb, pinfo, tree))
+        return FALSE;
+    if (udpd != NULL && udpd->port_handle == NULL) {
+        udpd->port_handle = dissector_get_uint_handle(udp_dissector_table, port);
+        udpd->port_handle_port = port;
+    }
+    handle_export_pdu_dissection_table(pinfo, next_tvb, port);
+    return TRUE;
+}
+
+static void
+decode_udp_ports_internal(tvbuff_t *tvb, int offset, packet_info *pinfo,
+             proto_tree *udp_tree, int uh_sport, int uh_dport, int uh_ulen,
+             struct udp_analysis *udpd)
 {
     tvbuff_t *next_tvb;
     int low_port, high_port;
@@ -596,6 +641,23 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
         return;
     }
 
+    /* If a port dissector took an earlier packet of this conversation,
+       go straight to it; the ports and the preferences that would make
+       the lookups below choose differently can't have changed since,
+       as changing them means redissecting, with new conversations. */
+    if (udpd != NULL && udpd->port_handle != NULL && !try_heuristic_first) {
+        guint32 saved_match_uint = pinfo->match_uint;
+        int     port_len;
+
+        pinfo->match_uint = udpd->port_handle_port;
+        port_len = call_dissector_only(udpd->port_handle, next_tvb, pinfo, tree, NULL);
+        pinfo->match_uint = saved_match_uint;
+        if (port_len != 0) {
+            handle_export_pdu_dissection_table(pinfo, next_tvb, udpd->port_handle_port);
+            return;
+        }
+    }
+
     /* XXX - we ignore port numbers of 0, as some dissectors use a port
          number of 0 to disable the port, and as RFC 768 says that the source
          port in UDP datagrams is optional and is 0 if not used. */
@@ -612,10 +674,8 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
     try_low_port = FALSE;
     if (low_port != 0) {
         if (dissector_is_uint_changed(udp_dissector_table, low_port)) {
-            if (dissector_try_uint(udp_dissector_table, low_port, next_tvb, pinfo, tree)) {
-                handle_export_pdu_dissection_table(pinfo, next_tvb, low_port);
+            if (try_udp_port(low_port, next_tvb, pinfo, tree, udpd))
                 return;
-            }
         }
         else {
             /* The default; try it later */
@@ -626,10 +686,8 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
     try_high_port = FALSE;
     if (high_port != 0) {
         if (dissector_is_uint_changed(udp_dissector_table, high_port)) {
-            if (dissector_try_uint(udp_dissector_table, high_port, next_tvb, pinfo, tree)) {
-                handle_export_pdu_dissection_table(pinfo, next_tvb, high_port);
+            if (try_udp_port(high_port, next_tvb, pinfo, tree, udpd))
                 return;
-            }
         }
         else {
             /* The default; try it later */
@@ -666,14 +724,10 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
          will always pick the right port number.
      */
 
-    if ((try_low_port) && dissector_try_uint(udp_dissector_table, low_port, next_tvb, pinfo, tree)) {
-        handle_export_pdu_dissection_table(pinfo, next_tvb, low_port);
+    if ((try_low_port) && try_udp_port(low_port, next_tvb, pinfo, tree, udpd))
         return;
-    }
-    if ((try_high_port) && dissector_try_uint(udp_dissector_table, high_port, next_tvb, pinfo, tree)) {
-        handle_export_pdu_dissection_table(pinfo, next_tvb, high_port);
+    if ((try_high_port) && try_udp_port(high_port, next_tvb, pinfo, tree, udpd))
         return;
-    }
 
     if (!try_heuristic_first) {
         /* Do lookup with the heuristic subdissector table */
@@ -702,6 +756,13 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
     }
 }
 
+void
+decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
+             proto_tree *udp_tree, int uh_sport, int uh_dport, int uh_ulen)
+{
+    decode_udp_ports_internal(tvb, offset, pinfo, udp_tree, uh_sport, uh_dport, uh_ulen, NULL);
+}
+
 int
 udp_dissect_pdus(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
          guint fixed_len,  gboolean (*heuristic_check)(packet_info *, tvbuff_t *, int, void*),
@@ -1187,6 +1248,10 @@ dissect(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, guint32 ip_proto)
         * to tap listeners.
         */
         udph->uh_stream = udpd->stream;
+
+        if (!PINFO_FD_VISITED(pinfo)) {
+            udp_stream_frames_add(udpd->stream, pinfo->num);
+        }
     }
 
     tap_queue_packet(udp_tap, pinfo, udph);
@@ -1236,7 +1301,8 @@ dissect(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, guint32 ip_proto)
      * nothing left in the packet.
      */
     if (!pinfo->flags.in_error_pkt || (tvb_captured_length_remaining(tvb, offset) > 0))
-        decode_udp_ports(tvb, offset, pinfo, udp_tree, udph->uh_sport, udph->uh_dport, udph->uh_ulen);
+        decode_udp_ports_internal(tvb, offset, pinfo, udp_tree, udph->uh_sport, udph->uh_dport, udph->uh_ulen,
+                                  pinfo->flags.in_error_pkt ? NULL : udpd);
 }
 
 static int
@@ -1257,6 +1323,7 @@ static void
 udp_init(void)
 {
     udp_stream_count = 0;
+    udp_stream_frames = wmem_array_new(wmem_file_scope(), sizeof(frame_list_t *));
 }
 
 void
@@ -1465,6 +1532,7 @@ proto_register_udp(void)
     register_conversation_filter("udp", "UDP", udp_filter_valid, udp_build_filter);
     register_follow_stream(proto_udp, "udp_follow", udp_follow_conv_filter, udp_follow_index_filter, udp_follow_address_filter,
                         udp_port_to_display, follow_tvb_tap_listener);
+    frame_list_register_stream_field("udp.stream", get_udp_stream_frames);
 
     register_init_routine(udp_init);
 }
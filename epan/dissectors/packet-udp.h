@@ -14,6 +14,8 @@
 #include "ws_symbol_export.h"
 
 #include <epan/conversation.h>
+#include <epan/packet.h>
+#include <epan/frame_list.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -81,6 +83,14 @@ struct udp_analysis {
      * to previous frame in this conversation
      */
     nstime_t    ts_prev;
+
+    /* The dissector that the port table gave us for this conversation,
+     * and the port it was registered for, so that later packets, such as
+     * all those of a flow in a VXLAN or GENEVE tunnel, don't have to look
+     * the ports up again; NULL until a port dissector accepts a packet.
+     */
+    dissector_handle_t port_handle;
+    guint32     port_handle_port;
 };
 
 /** Associate process information with a given flow
@@ -108,6 +118,14 @@ add_udp_process_info(guint32 frame_num, address *local_addr, address *remote_add
 WS_DLL_PUBLIC guint32
 get_udp_stream_count(void);
 
+/** Get the frames of a UDP stream seen in the first pass
+ *
+ * @param stream The UDP stream number
+ * @return The stream's frames, or NULL if the stream wasn't found
+ */
+WS_DLL_PUBLIC const frame_list_t *
+get_udp_stream_frames(guint32 stream);
+
 WS_DLL_PUBLIC void
 decode_udp_ports(tvbuff_t *, int, packet_info *, proto_tree *, int, int, int);
 
@@ -52,13 +52,16 @@
 #include "disabled_protos.h"
 #include "decode_as.h"
 #include "conversation_filter.h"
+#include "frame_list.h"
 #include "conversation_table.h"
 #include "reassemble.h"
 #include "srt_table.h"
 #include "stats_tree.h"
+#include "str_intern.h"
 #include "secrets.h"
 #include "funnel.h"
 #include "wscbor.h"
+#include "app_mem_usage.h"
 #include <dtd.h>
 
 #ifdef HAVE_PLUGINS
@@ -225,6 +228,45 @@ static void epan_plugin_register_all_tap_listeners(gpointer data, gpointer user_
 		plug->register_all_tap_listeners();
 }
 
+static gsize
+file_scope_mem_usage(void)
+{
+	wmem_allocator_stats_t stats;
+
+	if (!wmem_allocator_get_stats(wmem_file_scope(), &stats))
+		return 0;
+	return stats.bytes_live;
+}
+
+static gsize
+packet_scope_mem_usage(void)
+{
+	wmem_allocator_stats_t stats;
+
+	if (!wmem_allocator_get_stats(wmem_packet_scope(), &stats))
+		return 0;
+	return stats.bytes_live;
+}
+
+static const ws_mem_usage_t file_scope_usage = { "File scope", file_scope_mem_usage, NULL };
+static const ws_mem_usage_t packet_scope_usage = { "Packet scope", packet_scope_mem_usage, NULL };
+
+/*
+ * Only allocators that keep statistics (e.g. with
+ * WIRESHARK_DEBUG_WMEM_OVERRIDE=slab) can report how much
+ * they hold.
+ */
+static void
+epan_register_scope_mem_usage(void)
+{
+	wmem_allocator_stats_t stats;
+
+	if (wmem_allocator_get_stats(wmem_file_scope(), &stats))
+		memory_usage_component_register(&file_scope_usage);
+	if (wmem_allocator_get_stats(wmem_packet_scope(), &stats))
+		memory_usage_component_register(&packet_scope_usage);
+}
+
 gboolean
 epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 {
@@ -255,6 +297,8 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 	 */
 	/* initialize memory allocation subsystem */
 	wmem_init_scopes();
+	epan_register_scope_mem_usage();
+	str_intern_init();
 
 	/* initialize the GUID to name mapping table */
 	guids_init();
@@ -301,6 +345,7 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 		reassembly_tables_init();
 		g_slist_foreach(epan_plugins, epan_plugin_init, NULL);
 		proto_init(epan_plugin_register_all_procotols, epan_plugin_register_all_handoffs, cb, client_data);
+		addr_resolv_init_finish();
 		g_slist_foreach(epan_plugins, epan_plugin_register_all_tap_listeners, NULL);
 		packet_cache_proto_handles();
 		dfilter_init();
@@ -396,6 +441,7 @@ epan_cleanup(void)
 
 	secrets_cleanup();
 	conversation_filters_cleanup();
+	frame_list_stream_fields_cleanup();
 	reassembly_table_cleanup();
 	tap_cleanup();
 	expert_cleanup();
@@ -548,6 +594,7 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const gboolean create_pr
 	}
 
 	edt->tvb = NULL;
+	edt->dfilter_field_cache = NULL;
 
 	g_slist_foreach(epan_plugins, epan_plugin_dissect_init, edt);
 }
@@ -562,7 +609,6 @@ epan_dissect_reset(epan_dissect_t *edt)
 
 	wtap_block_unref(edt->pi.rec->block);
 
-	g_slist_free(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
@@ -574,6 +620,10 @@ epan_dissect_reset(epan_dissect_t *edt)
 		edt->tvb = NULL;
 	}
 
+	/* The cached field values point into the tree */
+	if (edt->dfilter_field_cache)
+		g_hash_table_remove_all(edt->dfilter_field_cache);
+
 	if (edt->tree)
 		proto_tree_reset(edt->tree);
 
@@ -673,7 +723,6 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 
 	g_slist_foreach(epan_plugins, epan_plugin_dissect_cleanup, edt);
 
-	g_slist_free(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
@@ -684,6 +733,10 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 		tvb_free_chain(edt->tvb);
 	}
 
+	if (edt->dfilter_field_cache) {
+		g_hash_table_destroy(edt->dfilter_field_cache);
+	}
+
 	if (edt->tree) {
 		proto_tree_free(edt->tree);
 	}
@@ -30,6 +30,9 @@ struct epan_dissect {
 	tvbuff_t	*tvb;
 	proto_tree	*tree;
 	packet_info	pi;
+	/* Field values read from the tree by the display filters applied
+	 * to this dissection, shared between them; see dfilter_apply_edt() */
+	GHashTable	*dfilter_field_cache;
 };
 
 #ifdef __cplusplus
@@ -42,6 +42,21 @@
 #define XCEPT_CODE_ANY  0
 #define XCEPT_BAD_ALLOC 1
 
+/*
+ * On some UN*Xes, such as macOS and the BSDs, setjmp() saves and
+ * longjmp() restores the signal mask, which takes a system call, and
+ * dissection enters a try block for every dissector it calls.  Nothing
+ * changes the signal mask inside one, so use _setjmp() and _longjmp(),
+ * which don't; on Windows, setjmp() never did.
+ */
+#ifdef _WIN32
+#define except_setjmp(env)          setjmp(env)
+#define except_longjmp(env, val)    longjmp(env, val)
+#else
+#define except_setjmp(env)          _setjmp(env)
+#define except_longjmp(env, val)    _longjmp(env, val)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -174,7 +189,7 @@ WS_DLL_PUBLIC void except_free(void *);
         struct except_stacknode except_sn;                      \
         struct except_catch except_ch;                          \
         except_setup_try(&except_sn, &except_ch, ID, NUM);      \
-        if (setjmp(except_ch.except_jmp))                       \
+        if (except_setjmp(except_ch.except_jmp))                \
             *(PPE) = &except_ch.except_obj;                     \
         else                                                    \
             *(PPE) = 0
@@ -101,6 +101,15 @@
 **/
 #define ReassemblyError         9
 
+/**
+    Dissection of the current packet exceeded one of the per-packet
+    budgets (wall time, pinfo->pool bytes or tree items) set in the
+    "protocols" preferences. The packet isn't necessarily malformed,
+    but the rest of it is skipped so that one pathological packet
+    can't stall the whole capture.
+**/
+#define DissectionBudgetError   10
+
 /*
  * Catch errors that, if you're calling a subdissector and catching
  * exceptions from the subdissector, and possibly dissecting more
@@ -140,9 +149,9 @@
  * go all the way to the top level and get reported immediately.
  */
 #define CATCH_BOUNDS_AND_DISSECTOR_ERRORS \
-	CATCH7(BoundsError, FragmentBoundsError, ContainedBoundsError, \
+	CATCH8(BoundsError, FragmentBoundsError, ContainedBoundsError, \
 	       ReportedBoundsError, ScsiBoundsError, DissectorError, \
-	       ReassemblyError)
+	       ReassemblyError, DissectionBudgetError)
 
 /* Usage:
  *
@@ -366,6 +375,19 @@
 	    (except_state|=EXCEPT_CAUGHT)) \
 		/* user's code goes here */
 
+#define CATCH8(s,t,u,v,w,x,y,z) \
+	if (except_state == 0 && exc != 0 && \
+	    (exc->except_id.except_code == (s) || \
+	     exc->except_id.except_code == (t) || \
+	     exc->except_id.except_code == (u) || \
+	     exc->except_id.except_code == (v) || \
+	     exc->except_id.except_code == (w) || \
+	     exc->except_id.except_code == (x) || \
+	     exc->except_id.except_code == (y) || \
+	     exc->except_id.except_code == (z)) && \
+	    (except_state|=EXCEPT_CAUGHT)) \
+		/* user's code goes here */
+
 #define CATCH_ALL \
 	if (except_state == 0 && exc != 0 && \
 	    (except_state|=EXCEPT_CAUGHT)) \
@@ -417,7 +439,7 @@
 	 * about with except_state in here would indicate that THROW is \
 	 * doing the wrong thing.                   \
 	 */					    \
-        longjmp(except_ch.except_jmp,1);            \
+        except_longjmp(except_ch.except_jmp,1);     \
     }
 
 #define EXCEPT_CODE			except_code(exc)
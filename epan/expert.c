@@ -15,6 +15,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "packet.h"
 #include "expert.h"
@@ -63,6 +64,9 @@ static GHashTable *gpa_name_map = NULL;
 /* Deregistered expert infos */
 static GPtrArray *deregistered_expertinfos = NULL;
 
+/* Number of expert_aggregate_t among the listeners of the expert tap */
+static guint expert_aggregate_listeners = 0;
+
 const value_string expert_group_vals[] = {
 	{ PI_CHECKSUM,          "Checksum" },
 	{ PI_SEQUENCE,          "Sequence" },
@@ -536,6 +540,7 @@ expert_set_info_vformat(packet_info *pinfo, proto_item *pi, int group, int sever
 {
 	char           formatted[ITEM_LABEL_LENGTH];
 	int            tap;
+	gboolean       need_summary;
 	expert_info_t *ei;
 	proto_tree    *tree;
 	proto_item    *ti;
@@ -563,36 +568,44 @@ expert_set_info_vformat(packet_info *pinfo, proto_item *pi, int group, int sever
 		col_add_str(pinfo->cinfo, COL_EXPERT, val_to_str(severity, expert_severity_vals, "Unknown (%u)"));
 	}
 
-	if (use_vaformat) {
-		vsnprintf(formatted, ITEM_LABEL_LENGTH, format, ap);
-	} else {
-		(void) g_strlcpy(formatted, format, ITEM_LABEL_LENGTH);
+	tap = have_tap_listener(expert_tap);
+
+	/* Aggregates only count expert infos; unless some other listener
+	 * wants the message, it is only formatted for the tree. */
+	need_summary = tap && num_tap_listeners(expert_tap) > expert_aggregate_listeners;
+
+	if (pi != NULL || need_summary) {
+		if (use_vaformat) {
+			vsnprintf(formatted, ITEM_LABEL_LENGTH, format, ap);
+		} else {
+			(void) g_strlcpy(formatted, format, ITEM_LABEL_LENGTH);
+		}
 	}
 
-	tree = expert_create_tree(pi, group, severity, formatted);
+	if (pi != NULL) {
+		tree = expert_create_tree(pi, group, severity, formatted);
+
+		if (hf_index == -1) {
+			/* If no filterable expert info, just add the message */
+			ti = proto_tree_add_string(tree, hf_expert_msg, NULL, 0, 0, formatted);
+			proto_item_set_generated(ti);
+		} else {
+			/* If filterable expert info, hide the "generic" form of the message,
+			   and generate the formatted filterable expert info */
+			ti = proto_tree_add_none_format(tree, hf_index, NULL, 0, 0, "%s", formatted);
+			proto_item_set_generated(ti);
+			ti = proto_tree_add_string(tree, hf_expert_msg, NULL, 0, 0, formatted);
+			proto_item_set_hidden(ti);
+		}
 
-	if (hf_index == -1) {
-		/* If no filterable expert info, just add the message */
-		ti = proto_tree_add_string(tree, hf_expert_msg, NULL, 0, 0, formatted);
+		ti = proto_tree_add_uint_format_value(tree, hf_expert_severity, NULL, 0, 0, severity,
+						      "%s", val_to_str_const(severity, expert_severity_vals, "Unknown"));
 		proto_item_set_generated(ti);
-	} else {
-		/* If filterable expert info, hide the "generic" form of the message,
-		   and generate the formatted filterable expert info */
-		ti = proto_tree_add_none_format(tree, hf_index, NULL, 0, 0, "%s", formatted);
+		ti = proto_tree_add_uint_format_value(tree, hf_expert_group, NULL, 0, 0, group,
+						      "%s", val_to_str_const(group, expert_group_vals, "Unknown"));
 		proto_item_set_generated(ti);
-		ti = proto_tree_add_string(tree, hf_expert_msg, NULL, 0, 0, formatted);
-		proto_item_set_hidden(ti);
 	}
 
-	ti = proto_tree_add_uint_format_value(tree, hf_expert_severity, NULL, 0, 0, severity,
-					      "%s", val_to_str_const(severity, expert_severity_vals, "Unknown"));
-	proto_item_set_generated(ti);
-	ti = proto_tree_add_uint_format_value(tree, hf_expert_group, NULL, 0, 0, group,
-					      "%s", val_to_str_const(group, expert_group_vals, "Unknown"));
-	proto_item_set_generated(ti);
-
-	tap = have_tap_listener(expert_tap);
-
 	if (!tap)
 		return;
 
@@ -603,7 +616,7 @@ expert_set_info_vformat(packet_info *pinfo, proto_item *pi, int group, int sever
 	ei->severity    = severity;
 	ei->hf_index    = hf_index;
 	ei->protocol    = pinfo->current_proto;
-	ei->summary     = wmem_strdup(pinfo->pool, formatted);
+	ei->summary     = need_summary ? wmem_strdup(pinfo->pool, formatted) : NULL;
 
 	/* if we have a proto_item (not a faked item), set expert attributes to it */
 	if (pi != NULL && PITEM_FINFO(pi) != NULL) {
@@ -617,6 +630,126 @@ expert_set_info_vformat(packet_info *pinfo, proto_item *pi, int group, int sever
 	tap_queue_packet(expert_tap, pinfo, ei);
 }
 
+static guint
+expert_aggregate_hash(gconstpointer key)
+{
+	const expert_aggregate_entry_t *entry = (const expert_aggregate_entry_t *)key;
+
+	return g_str_hash(entry->protocol) ^ ((guint)entry->hf_index * 31) ^
+	       (guint)entry->group ^ (guint)entry->severity;
+}
+
+static gboolean
+expert_aggregate_equal(gconstpointer key1, gconstpointer key2)
+{
+	const expert_aggregate_entry_t *e1 = (const expert_aggregate_entry_t *)key1;
+	const expert_aggregate_entry_t *e2 = (const expert_aggregate_entry_t *)key2;
+
+	return e1->hf_index == e2->hf_index && e1->group == e2->group &&
+	       e1->severity == e2->severity && strcmp(e1->protocol, e2->protocol) == 0;
+}
+
+static void
+expert_aggregate_reset(void *tapdata)
+{
+	expert_aggregate_t *agg = (expert_aggregate_t *)tapdata;
+
+	g_hash_table_remove_all(agg->table);
+	g_ptr_array_set_size(agg->entries, 0);
+}
+
+static tap_packet_status
+expert_aggregate_packet(void *tapdata, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *data)
+{
+	expert_aggregate_t            *agg = (expert_aggregate_t *)tapdata;
+	const expert_info_t           *ei  = (const expert_info_t *)data;
+	expert_aggregate_entry_t       key;
+	expert_aggregate_entry_t      *entry;
+
+	key.hf_index = ei->hf_index;
+	key.group    = ei->group;
+	key.severity = ei->severity;
+	key.protocol = ei->protocol ? ei->protocol : "";
+
+	entry = (expert_aggregate_entry_t *)g_hash_table_lookup(agg->table, &key);
+	if (entry == NULL) {
+		entry = g_new0(expert_aggregate_entry_t, 1);
+		entry->hf_index = key.hf_index;
+		entry->group    = key.group;
+		entry->severity = key.severity;
+		entry->protocol = g_intern_string(key.protocol);
+		g_ptr_array_add(agg->entries, entry);
+		g_hash_table_insert(agg->table, entry, entry);
+	}
+
+	entry->count++;
+	if (entry->num_samples < EXPERT_AGGREGATE_SAMPLES &&
+	    (entry->num_samples == 0 || entry->samples[entry->num_samples - 1] != ei->packet_num)) {
+		entry->samples[entry->num_samples++] = ei->packet_num;
+	}
+
+	return TAP_PACKET_REDRAW;
+}
+
+static void
+expert_aggregate_draw(void *tapdata)
+{
+	expert_aggregate_t *agg = (expert_aggregate_t *)tapdata;
+
+	if (agg->draw)
+		agg->draw(agg);
+}
+
+static void
+expert_aggregate_finish(void *tapdata)
+{
+	expert_aggregate_t *agg = (expert_aggregate_t *)tapdata;
+
+	g_hash_table_destroy(agg->table);
+	g_ptr_array_free(agg->entries, TRUE);
+	agg->table = NULL;
+	agg->entries = NULL;
+	expert_aggregate_listeners--;
+}
+
+GString *
+register_expert_aggregate(expert_aggregate_t *agg, const char *fstring)
+{
+	GString *error_string;
+
+	agg->entries = g_ptr_array_new_with_free_func(g_free);
+	agg->table = g_hash_table_new(expert_aggregate_hash, expert_aggregate_equal);
+
+	error_string = register_tap_listener("expert", agg, fstring, TL_REQUIRES_NOTHING,
+					     expert_aggregate_reset, expert_aggregate_packet,
+					     expert_aggregate_draw, expert_aggregate_finish);
+	if (error_string) {
+		g_hash_table_destroy(agg->table);
+		g_ptr_array_free(agg->entries, TRUE);
+		agg->table = NULL;
+		agg->entries = NULL;
+		return error_string;
+	}
+
+	expert_aggregate_listeners++;
+	return NULL;
+}
+
+const gchar *
+expert_aggregate_summary(const expert_aggregate_entry_t *entry)
+{
+	header_field_info *hfinfo;
+	expert_field_info *eiinfo = NULL;
+
+	if (entry->hf_index >= 0) {
+		hfinfo = proto_registrar_get_nth(entry->hf_index);
+		if (hfinfo)
+			eiinfo = expert_registrar_get_byname(hfinfo->abbrev);
+	}
+
+	return (eiinfo && eiinfo->summary) ? eiinfo->summary : "";
+}
+
 /* Helper function for expert_add_info() to work around compiler's special needs on ARM */
 static inline void
 expert_add_info_internal(packet_info *pinfo, proto_item *pi, expert_field *expindex, ...)
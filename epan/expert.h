@@ -182,6 +182,47 @@ void expert_free_deregistered_expertinfos (void);
  */
 WS_DLL_PUBLIC const gchar* expert_get_summary(expert_field *eiindex);
 
+/** Number of frames kept per aggregated expert info entry */
+#define EXPERT_AGGREGATE_SAMPLES 8
+
+/** Expert infos of one field, protocol, group and severity, counted */
+typedef struct expert_aggregate_entry_s {
+	int          hf_index;  /**< hf_index of the expert items. Might be -1. */
+	int          group;
+	int          severity;
+	const gchar *protocol;
+	guint64      count;     /**< number of expert items */
+	guint        num_samples;
+	guint32      samples[EXPERT_AGGREGATE_SAMPLES]; /**< first frames they were seen in */
+} expert_aggregate_entry_t;
+
+/** Expert info counts, for listeners that do not need every message.
+ *
+ * While all listeners of the "expert" tap are aggregates, expert infos
+ * added without a tree are neither formatted nor copied. The message of
+ * an entry can be looked at by dissecting one of its sample frames.
+ */
+typedef struct expert_aggregate_s {
+	GPtrArray   *entries;   /**< expert_aggregate_entry_t pointers, in order of appearance */
+	GHashTable  *table;     /**< the same entries, by field, protocol, group and severity */
+	void       (*draw)(struct expert_aggregate_s *agg); /**< optional, called when the tap draws */
+	void        *user_data;
+} expert_aggregate_t;
+
+/** Attach an aggregate to the "expert" tap; entries and table are set up
+ *  here. Detach it with remove_tap_listener(agg), which frees the entries.
+ @param agg the aggregate, with draw and user_data filled in
+ @param fstring display filter for the packets to count, or NULL
+ @return NULL on success, otherwise an error message to be freed with
+         g_string_free() */
+WS_DLL_PUBLIC GString *
+register_expert_aggregate(expert_aggregate_t *agg, const char *fstring);
+
+/** The registered summary of the expert field behind an aggregated entry,
+ *  or an empty string if there is none. */
+WS_DLL_PUBLIC const gchar *
+expert_aggregate_summary(const expert_aggregate_entry_t *entry);
+
 /** Register a expert field array.
  @param module the protocol handle from expert_register_protocol()
  @param ei the ei_register_info array
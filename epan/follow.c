@@ -176,6 +176,20 @@ follow_info_free(follow_info_t* follow_info)
     g_free(follow_info);
 }
 
+void
+follow_add_record(follow_info_t *follow_info, follow_record_t *follow_record)
+{
+    if (follow_info->record_cb) {
+        follow_info->record_cb(follow_info, follow_record);
+        if (follow_record->data)
+            g_byte_array_free(follow_record->data, TRUE);
+        g_free(follow_record);
+        return;
+    }
+
+    follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
+}
+
 tap_packet_status
 follow_tvb_tap_listener(void *tapdata, packet_info *pinfo,
                       epan_dissect_t *edt _U_, const void *data)
@@ -208,7 +222,7 @@ follow_tvb_tap_listener(void *tapdata, packet_info *pinfo,
     /* update stream counter */
     follow_info->bytes_written[follow_record->is_server] += follow_record->data->len;
 
-    follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
+    follow_add_record(follow_info, follow_record);
     return TAP_PACKET_DONT_REDRAW;
 }
 
@@ -88,6 +88,11 @@ typedef struct {
     GByteArray *data;
 } follow_record_t;
 
+/** Called for each record as it is produced when follow_info_t::record_cb
+ * is set. The record is freed when the callback returns.
+ */
+typedef void (*follow_record_func)(struct _follow_info *follow_info, follow_record_t *follow_record);
+
 typedef struct _follow_info {
     show_stream_t   show_stream;
     char            *filter_out_filter;
@@ -101,6 +106,7 @@ typedef struct _follow_info {
     address         server_ip;
     void*           gui_data;
     guint64         substream_id;  /**< Sub-stream; used only by HTTP2 and QUIC */
+    follow_record_func record_cb;  /**< If set, records are passed here instead of being kept in payload */
 } follow_info_t;
 
 struct register_follow;
@@ -179,6 +185,16 @@ WS_DLL_PUBLIC tap_packet_cb get_follow_tap_handler(register_follow_t* follower);
 WS_DLL_PUBLIC tap_packet_status
 follow_tvb_tap_listener(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _U_, const void *data);
 
+/** Hand a completed record to the follower. Without a record_cb the
+ * record is prepended to follow_info->payload, otherwise it is passed
+ * to the callback and freed.
+ * Used by the tap handlers of the followers.
+ *
+ * @param follow_info [in] follower info
+ * @param follow_record [in] record to add; ownership is taken
+ */
+WS_DLL_PUBLIC void follow_add_record(follow_info_t *follow_info, follow_record_t *follow_record);
+
 /** Interator to walk all registered followers and execute func
  *
  * @param func action to be performed on all converation tables
@@ -70,7 +70,7 @@ typedef struct _frame_data {
   /* These two are pointers, meaning 64-bit on LP64 (64-bit UN*X) and
      LLP64 (64-bit Windows) platforms.  Put them here, one after the
      other, so they don't require padding between them. */
-  GSList      *pfd;          /**< Per frame proto data */
+  struct _proto_data_table *pfd; /**< Per frame proto data, in file scope */
   const struct _color_filter *color_filter;  /**< Per-packet matching color_filter_t object */
   guint16      subnum;       /**< subframe number, for protocols that require this */
   /* Keep the bitfields below to 16 bits, so this plus the previous field
@@ -88,7 +88,8 @@ typedef struct _frame_data {
   unsigned int need_colorize    : 1; /**< 1 = need to (re-)calculate packet color */
   unsigned int tsprec           : 4; /**< Time stamp precision -2^tsprec gives up to femtoseconds */
   nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
+  /* The time shift applied by the user, if any, is not stored here to
+     keep this structure small; see frame_data_sequence_get_shift_offset(). */
   guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
   guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
 } frame_data;
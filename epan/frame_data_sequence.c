@@ -16,6 +16,8 @@
 
 #include "frame_data_sequence.h"
 
+#include <wsutil/glib-compat.h>
+
 /*
  * We store the frame_data structures in a radix tree, with 1024
  * elements per level.  The leaf nodes are arrays of 1024 frame_data
@@ -32,6 +34,7 @@
 struct _frame_data_sequence {
   guint32      count;           /* Total number of frames */
   void        *ptree_root;      /* Pointer to the root node */
+  GHashTable  *shift_offsets;   /* Frame number -> nstime_t time shift, or NULL */
 };
 
 /*
@@ -55,6 +58,7 @@ new_frame_data_sequence(void)
   fds = (frame_data_sequence *)g_malloc(sizeof *fds);
   fds->count = 0;
   fds->ptree_root = NULL;
+  fds->shift_offsets = NULL;
   return fds;
 }
 
@@ -307,10 +311,44 @@ free_frame_data_sequence(frame_data_sequence *fds)
     free_frame_data_array(fds->ptree_root, fds->count, levels, TRUE);
   }
 
+  if (fds->shift_offsets)
+    g_hash_table_destroy(fds->shift_offsets);
+
   /* free the header struct */
   g_free(fds);
 }
 
+void
+frame_data_sequence_get_shift_offset(frame_data_sequence *fds, guint32 num,
+                                     nstime_t *offset)
+{
+  nstime_t *shift = NULL;
+
+  if (fds->shift_offsets)
+    shift = (nstime_t *)g_hash_table_lookup(fds->shift_offsets, GUINT_TO_POINTER(num));
+  if (shift)
+    nstime_copy(offset, shift);
+  else
+    nstime_set_zero(offset);
+}
+
+void
+frame_data_sequence_set_shift_offset(frame_data_sequence *fds, guint32 num,
+                                     const nstime_t *offset)
+{
+  if (nstime_is_zero(offset)) {
+    if (fds->shift_offsets)
+      g_hash_table_remove(fds->shift_offsets, GUINT_TO_POINTER(num));
+    return;
+  }
+
+  if (!fds->shift_offsets)
+    fds->shift_offsets = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                               NULL, g_free);
+  g_hash_table_insert(fds->shift_offsets, GUINT_TO_POINTER(num),
+                      g_memdup2(offset, sizeof *offset));
+}
+
 void
 find_and_mark_frame_depended_upon(gpointer data, gpointer user_data)
 {
@@ -28,6 +28,20 @@ WS_DLL_PUBLIC frame_data *frame_data_sequence_add(frame_data_sequence *fds,
 WS_DLL_PUBLIC frame_data *frame_data_sequence_find(frame_data_sequence *fds,
     guint32 num);
 
+/*
+ * Get the time shift applied to the specified frame, or zero if it hasn't
+ * been shifted. Only a few captures are ever time shifted, so the offsets
+ * are kept in a table here rather than in every frame_data.
+ */
+WS_DLL_PUBLIC void frame_data_sequence_get_shift_offset(frame_data_sequence *fds,
+    guint32 num, nstime_t *offset);
+
+/*
+ * Set the time shift applied to the specified frame.
+ */
+WS_DLL_PUBLIC void frame_data_sequence_set_shift_offset(frame_data_sequence *fds,
+    guint32 num, const nstime_t *offset);
+
 /*
  * Free a frame_data_sequence and all the frame_data structures in it.
  */
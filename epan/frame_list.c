@@ -0,0 +1,228 @@
+/* frame_list.c
+ * Compact, append-only lists of frame numbers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/strtoi.h>
+
+#include "frame_list.h"
+
+struct _frame_list {
+    wmem_allocator_t *scope;
+    guint8           *data;         /* deltas, 7 bits per byte, low bits first */
+    guint             len;
+    guint             alloc;
+    guint32           count;
+    guint32           first_frame;
+    guint32           last_frame;
+};
+
+typedef struct {
+    const char            *field;
+    frame_list_stream_func get_stream_frames;
+} stream_field_t;
+
+static GList *stream_fields = NULL;
+
+frame_list_t *
+frame_list_new(wmem_allocator_t *scope)
+{
+    frame_list_t *list = wmem_new0(scope, frame_list_t);
+
+    list->scope = scope;
+    return list;
+}
+
+void
+frame_list_append(frame_list_t *list, guint32 frame)
+{
+    guint32 delta;
+
+    if (list->count != 0 && frame <= list->last_frame)
+        return;
+
+    /* A guint32 takes at most 5 bytes */
+    if (list->len + 5 > list->alloc) {
+        guint new_alloc = list->alloc ? list->alloc * 2 : 16;
+
+        list->data = (guint8 *)wmem_realloc(list->scope, list->data, new_alloc);
+        list->alloc = new_alloc;
+    }
+
+    delta = list->count != 0 ? frame - list->last_frame : frame;
+    while (delta >= 0x80) {
+        list->data[list->len++] = (guint8)(delta | 0x80);
+        delta >>= 7;
+    }
+    list->data[list->len++] = (guint8)delta;
+
+    if (list->count == 0)
+        list->first_frame = frame;
+    list->last_frame = frame;
+    list->count++;
+}
+
+guint32
+frame_list_count(const frame_list_t *list)
+{
+    return list->count;
+}
+
+gboolean
+frame_list_bounds(const frame_list_t *list, guint32 *first_frame, guint32 *last_frame)
+{
+    if (list->count == 0)
+        return FALSE;
+
+    *first_frame = list->first_frame;
+    *last_frame = list->last_frame;
+    return TRUE;
+}
+
+void
+frame_list_iter_init(frame_list_iter_t *iter, const frame_list_t *list)
+{
+    iter->p = list->data;
+    iter->end = list->data + list->len;
+    iter->frame = 0;
+}
+
+gboolean
+frame_list_iter_next(frame_list_iter_t *iter, guint32 *frame)
+{
+    guint32 delta = 0;
+    guint   shift = 0;
+
+    if (iter->p >= iter->end)
+        return FALSE;
+
+    while (iter->p < iter->end) {
+        guint8 b = *iter->p++;
+
+        delta |= (guint32)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+        shift += 7;
+    }
+
+    iter->frame += delta;
+    *frame = iter->frame;
+    return TRUE;
+}
+
+static void
+range_str_append(GString *str, guint32 run_start, guint32 run_end)
+{
+    if (str->len != 0)
+        g_string_append_c(str, ',');
+
+    if (run_start == run_end)
+        g_string_append_printf(str, "%u", run_start);
+    else
+        g_string_append_printf(str, "%u-%u", run_start, run_end);
+}
+
+gchar *
+frame_list_to_range_str(const frame_list_t *list)
+{
+    GString *str = g_string_new(NULL);
+    frame_list_iter_t iter;
+    guint32 frame, run_start, run_end;
+
+    frame_list_iter_init(&iter, list);
+    if (frame_list_iter_next(&iter, &frame)) {
+        run_start = run_end = frame;
+        while (frame_list_iter_next(&iter, &frame)) {
+            if (frame != run_end + 1) {
+                range_str_append(str, run_start, run_end);
+                run_start = frame;
+            }
+            run_end = frame;
+        }
+        range_str_append(str, run_start, run_end);
+    }
+
+    return g_string_free(str, FALSE);
+}
+
+void
+frame_list_register_stream_field(const char *field, frame_list_stream_func get_stream_frames)
+{
+    stream_field_t *entry;
+
+    entry = g_new(stream_field_t, 1);
+    entry->field = field;
+    entry->get_stream_frames = get_stream_frames;
+
+    stream_fields = g_list_append(stream_fields, entry);
+}
+
+const frame_list_t *
+frame_list_for_filter(const char *filter)
+{
+    gchar **tokens;
+    guint n_tokens = 0;
+    guint32 stream;
+    GList *entry;
+    const frame_list_t *frames = NULL;
+
+    if (!stream_fields || !filter)
+        return NULL;
+
+    /* Split on white space, dropping the empty strings between runs of it */
+    tokens = g_strsplit_set(filter, " \t\r\n", -1);
+    for (guint i = 0; tokens[i]; i++) {
+        if (tokens[i][0] != '\0')
+            tokens[n_tokens++] = tokens[i];
+        else
+            g_free(tokens[i]);
+    }
+    tokens[n_tokens] = NULL;
+
+    if (n_tokens == 3 &&
+        (strcmp(tokens[1], "==") == 0 || strcmp(tokens[1], "eq") == 0) &&
+        ws_strtou32(tokens[2], NULL, &stream)) {
+        for (entry = stream_fields; entry; entry = g_list_next(entry)) {
+            stream_field_t *stream_field = (stream_field_t *)entry->data;
+
+            if (strcmp(stream_field->field, tokens[0]) == 0) {
+                frames = stream_field->get_stream_frames(stream);
+                break;
+            }
+        }
+    }
+    g_strfreev(tokens);
+
+    return frames;
+}
+
+void
+frame_list_stream_fields_cleanup(void)
+{
+    g_list_free_full(stream_fields, g_free);
+    stream_fields = NULL;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
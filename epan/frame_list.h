@@ -0,0 +1,92 @@
+/** @file
+ * Compact, append-only lists of frame numbers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_LIST_H__
+#define __FRAME_LIST_H__
+
+#include "ws_symbol_export.h"
+
+#include <wsutil/wmem/wmem.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A list of frame numbers in ascending order, stored as the differences
+ * between successive frames, each as a variable-length integer. The frames
+ * of a conversation are usually close together, so most of them take a
+ * single byte.
+ *
+ * Dissectors that number streams in the first pass (TCP, UDP) keep one of
+ * these per stream, so that following a stream or filtering on its index
+ * only has to look at the stream's own frames.
+ */
+typedef struct _frame_list frame_list_t;
+
+typedef struct {
+    const guint8 *p;
+    const guint8 *end;
+    guint32       frame;
+} frame_list_iter_t;
+
+/** Create an empty list whose memory belongs to scope. */
+WS_DLL_PUBLIC frame_list_t *frame_list_new(wmem_allocator_t *scope);
+
+/**
+ * Append a frame. Frames that aren't greater than the last one appended
+ * are ignored, so adding the same frame twice is harmless.
+ */
+WS_DLL_PUBLIC void frame_list_append(frame_list_t *list, guint32 frame);
+
+/** The number of frames in the list. */
+WS_DLL_PUBLIC guint32 frame_list_count(const frame_list_t *list);
+
+/** The first and last frame in the list; FALSE if it's empty. */
+WS_DLL_PUBLIC gboolean frame_list_bounds(const frame_list_t *list,
+    guint32 *first_frame, guint32 *last_frame);
+
+/** Start iterating over a list. */
+WS_DLL_PUBLIC void frame_list_iter_init(frame_list_iter_t *iter, const frame_list_t *list);
+
+/** Get the next frame; FALSE at the end of the list. */
+WS_DLL_PUBLIC gboolean frame_list_iter_next(frame_list_iter_t *iter, guint32 *frame);
+
+/**
+ * The list as a packet range string, e.g. "1-3,7,10-12", to be freed
+ * with g_free().
+ */
+WS_DLL_PUBLIC gchar *frame_list_to_range_str(const frame_list_t *list);
+
+/** Look up the frame list of one stream, or NULL if there's no such stream. */
+typedef const frame_list_t *(*frame_list_stream_func)(guint32 stream);
+
+/**
+ * Register the field that holds a dissector's stream index, e.g.
+ * "tcp.stream", along with the function that returns a stream's frames.
+ */
+WS_DLL_PUBLIC void frame_list_register_stream_field(const char *field,
+    frame_list_stream_func get_stream_frames);
+
+/**
+ * If filter is exactly "<field> == <N>" or "<field> eq <N>" for a
+ * registered stream field, return the frames of that stream; the frames
+ * that match the filter are exactly those. Otherwise return NULL.
+ */
+WS_DLL_PUBLIC const frame_list_t *frame_list_for_filter(const char *filter);
+
+/** Forget the registered stream fields, at epan cleanup. */
+extern void frame_list_stream_fields_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_LIST_H__ */
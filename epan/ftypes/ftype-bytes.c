@@ -18,19 +18,51 @@
 
 #define CMP_MATCHES cmp_matches
 
+/* The GByteArray was allocated by fvalue_set_bytes_data_scoped() */
+#define bytes_is_scoped	fvalue_gboolean1
+
 static void
 bytes_fvalue_new(fvalue_t *fv)
 {
 	fv->value.bytes = NULL;
+	fv->bytes_is_scoped = FALSE;
 }
 
 static void
 bytes_fvalue_free(fvalue_t *fv)
 {
 	if (fv->value.bytes) {
-		g_byte_array_free(fv->value.bytes, TRUE);
+		if (!fv->bytes_is_scoped)
+			g_byte_array_free(fv->value.bytes, TRUE);
 		fv->value.bytes=NULL;
 	}
+	fv->bytes_is_scoped = FALSE;
+}
+
+/*
+ * Sets the value to a copy of the data allocated in scope, and freed
+ * along with it, rather than by fvalue_cleanup(). The GByteArray and the
+ * data are a single allocation; only its data and len members are valid,
+ * so it mustn't be handed to the g_byte_array_* functions.
+ */
+void
+fvalue_set_bytes_data_scoped(fvalue_t *fv, wmem_allocator_t *scope, const guint8 *data, gsize len)
+{
+	GByteArray *bytes;
+
+	ws_assert(fv->ftype->free_value == bytes_fvalue_free);
+
+	/* Free up the old value, if we have one */
+	bytes_fvalue_free(fv);
+
+	bytes = (GByteArray *)wmem_alloc(scope, sizeof(GByteArray) + len);
+	bytes->data = (guint8 *)(bytes + 1);
+	bytes->len = (guint)len;
+	if (len)
+		memcpy(bytes->data, data, len);
+
+	fv->value.bytes = bytes;
+	fv->bytes_is_scoped = TRUE;
 }
 
 
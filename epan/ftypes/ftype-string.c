@@ -17,16 +17,53 @@
 #include <strutil.h>
 #include <wsutil/ws_assert.h>
 
+/* The string was set by fvalue_set_string_scoped() or fvalue_set_string_borrowed() */
+#define string_is_scoped	fvalue_gboolean1
+
 static void
 string_fvalue_new(fvalue_t *fv)
 {
 	fv->value.string = NULL;
+	fv->string_is_scoped = FALSE;
 }
 
 static void
 string_fvalue_free(fvalue_t *fv)
 {
-	g_free(fv->value.string);
+	if (!fv->string_is_scoped)
+		g_free(fv->value.string);
+	fv->value.string = NULL;
+	fv->string_is_scoped = FALSE;
+}
+
+/*
+ * Sets the value to a copy of the string allocated in scope, and freed
+ * along with it, rather than by fvalue_cleanup().
+ */
+void
+fvalue_set_string_scoped(fvalue_t *fv, wmem_allocator_t *scope, const gchar *value)
+{
+	DISSECTOR_ASSERT(value != NULL);
+
+	fvalue_set_string_borrowed(fv, wmem_strdup(scope, value));
+}
+
+/*
+ * Sets the value to the string itself, without copying it; it has to
+ * stay valid for as long as the fvalue does, e.g. by being allocated in
+ * the same wmem scope.
+ */
+void
+fvalue_set_string_borrowed(fvalue_t *fv, const gchar *value)
+{
+	ws_assert(fv->ftype->free_value == string_fvalue_free);
+	DISSECTOR_ASSERT(value != NULL);
+
+	/* Free up the old value, if we have one */
+	string_fvalue_free(fv);
+
+	fv->value.string = (gchar *)value;
+	fv->string_is_scoped = TRUE;
 }
 
 static void
@@ -278,6 +278,12 @@ fvalue_set_byte_array(fvalue_t *fv, GByteArray *value);
 void
 fvalue_set_bytes(fvalue_t *fv, const guint8 *value);
 
+/* Sets a byte-array-based value (FT_BYTES, FT_ETHER, FT_OID, ...) to a
+ * copy of len bytes of data, allocated in scope and freed with it rather
+ * than by fvalue_cleanup(). */
+void
+fvalue_set_bytes_data_scoped(fvalue_t *fv, wmem_allocator_t *scope, const guint8 *data, gsize len);
+
 void
 fvalue_set_guid(fvalue_t *fv, const e_guid_t *value);
 
@@ -287,6 +293,16 @@ fvalue_set_time(fvalue_t *fv, const nstime_t *value);
 void
 fvalue_set_string(fvalue_t *fv, const gchar *value);
 
+/* Like fvalue_set_string(), but the copy is allocated in scope and freed
+ * with it rather than by fvalue_cleanup(). */
+void
+fvalue_set_string_scoped(fvalue_t *fv, wmem_allocator_t *scope, const gchar *value);
+
+/* Like fvalue_set_string(), but doesn't copy the string, which has to stay
+ * valid for as long as the fvalue does. */
+void
+fvalue_set_string_borrowed(fvalue_t *fv, const gchar *value);
+
 void
 fvalue_set_protocol(fvalue_t *fv, tvbuff_t *value, const gchar *name);
 
@@ -13,6 +13,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/tvbuff.h>
@@ -28,6 +30,33 @@
 #define ADDCARRY(x)  {if ((x) > 65535) (x) -= 65535;}
 #define REDUCE {l_util.l = sum; sum = l_util.s[0] + l_util.s[1]; ADDCARRY(sum);}
 
+/*
+ * One's complement sum of the 16-bit words in len bytes (a multiple of 8),
+ * folded to 16 bits. Summing native 32-bit words into a 64-bit accumulator
+ * and folding the carries back in at the end gives the same result as
+ * summing native 16-bit words (RFC 1071, section 2), with a quarter of the
+ * carry handling; compilers also vectorize this loop well.
+ */
+static inline guint32
+in_cksum_blocks(const guint8 *p, int len)
+{
+	guint64 sum = 0;
+	guint32 a, b;
+
+	for (; len > 0; len -= 8, p += 8) {
+		memcpy(&a, p, sizeof a);
+		memcpy(&b, p + 4, sizeof b);
+		sum += a;
+		sum += b;
+	}
+
+	sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+	sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	return (guint32)sum;
+}
+
 int
 in_cksum(const vec_t *vec, int veclen)
 {
@@ -76,22 +105,16 @@ in_cksum(const vec_t *vec, int veclen)
 			byte_swapped = 1;
 		}
 		/*
-		 * Unroll the loop to make overhead from
-		 * branches &c small.
+		 * Do all whole 8-byte blocks at once.
 		 */
-		while ((mlen -= 32) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			sum += w[4]; sum += w[5]; sum += w[6]; sum += w[7];
-			sum += w[8]; sum += w[9]; sum += w[10]; sum += w[11];
-			sum += w[12]; sum += w[13]; sum += w[14]; sum += w[15];
-			w += 16;
-		}
-		mlen += 32;
-		while ((mlen -= 8) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			w += 4;
+		if (mlen >= 8) {
+			int blen = mlen & ~7;
+
+			REDUCE;
+			sum += in_cksum_blocks((const guint8 *)w, blen);
+			w += blen / 2;
+			mlen -= blen;
 		}
-		mlen += 8;
 		if (mlen == 0 && byte_swapped == 0)
 			continue;
 		REDUCE;
@@ -68,6 +68,7 @@ static wmem_map_t *mmdb_ipv4_map;
 static wmem_map_t *mmdb_ipv6_map;
 static GAsyncQueue *mmdbr_response_q; // g_allocated mmdbr_response_t *
 static GThread *read_mmdbr_stdout_thread;
+static gint mmdbr_outstanding; // Requests without a response yet. Atomic.
 
 // Interned strings
 static wmem_map_t *mmdb_str_chunk;
@@ -197,11 +198,11 @@ write_mmdbr_stdin_worker(gpointer data _U_) {
     return NULL;
 }
 
-static ssize_t mmdbr_pipe_read_one(char *ch_p) {
+static ssize_t mmdbr_pipe_read(char *buf, size_t len) {
     ssize_t status = -1;
     g_rw_lock_reader_lock(&mmdbr_pipe_mtx);
     if (ws_pipe_valid(&mmdbr_pipe) && ws_pipe_data_available(mmdbr_pipe.stdout_fd)) {
-        status = ws_read(mmdbr_pipe.stdout_fd, ch_p, 1);
+        status = ws_read(mmdbr_pipe.stdout_fd, buf, (unsigned int) len);
     }
     g_rw_lock_reader_unlock(&mmdbr_pipe_mtx);
     return status;
@@ -213,15 +214,22 @@ static ssize_t mmdbr_pipe_read_one(char *ch_p) {
 // thread calls fclose while fgets is blocking, it will block as well. The
 // same happens for plain close+read.
 //
-// Read our input one character at a time and only after we've ensured
-// that data is available. If this is too inefficient we could try one
-// of the following:
+// Only read after we've ensured that data is available, and then read
+// whatever is there in one go instead of a character at a time. A line
+// can be split across reads; the partial line is kept until the rest of
+// it arrives. If this is still too inefficient we could try one of the
+// following:
 // - Use overlapped I/O, which implies adding ws_pipe_set_nonblock and
 //   ws_pipe_read_nonblock routines.
 // - Stash our worker thread handles on Windows and call CancelSynchronousIo
 //   before shutting down our threads.
+//
+// While requests are outstanding we poll with a short wait so that a
+// batch of lookups doesn't trickle in at one response per MMDB_WAIT_TIME.
 #define MAX_MMDB_LINE_LEN 2000
+#define MMDB_READ_BUF_LEN 4096
 #define MMDB_WAIT_TIME (150 * 1000) // microseconds
+#define MMDB_BUSY_WAIT_TIME (1 * 1000) // microseconds
 static gpointer
 read_mmdbr_stdout_worker(gpointer data _U_) {
     mmdb_response_t *response = g_new0(mmdb_response_t, 1);
@@ -230,30 +238,47 @@ read_mmdbr_stdout_worker(gpointer data _U_) {
     GString *country = g_string_new("");
     GString *city = g_string_new("");
     GString *as_org = g_string_new("");
+    char *read_buf = (char *) g_malloc(MMDB_READ_BUF_LEN);
+    ssize_t read_pos = 0;
+    ssize_t read_len = 0;
+    gboolean line_complete = FALSE;
     char cur_addr[WS_INET6_ADDRSTRLEN] = { 0 };
 
     MMDB_DEBUG("starting read worker");
 
     while (1) { // Start of line
-        char ch;
-        ssize_t status;
-
-        g_string_truncate(line_buf, 0);
+        if (line_complete) {
+            g_string_truncate(line_buf, 0);
+            line_complete = FALSE;
+        }
 
-        while((status = mmdbr_pipe_read_one(&ch)) == 1) {
-            if (ch == '\n') {
-                break;
+        while (!line_complete) {
+            if (read_pos >= read_len) {
+                read_len = mmdbr_pipe_read(read_buf, MMDB_READ_BUF_LEN);
+                read_pos = 0;
+                if (read_len < 1) {
+                    break;
+                }
             }
 
-            g_string_append_c(line_buf, ch);
+            while (read_pos < read_len) {
+                char ch = read_buf[read_pos++];
+
+                if (ch == '\n') {
+                    line_complete = TRUE;
+                    break;
+                }
+
+                g_string_append_c(line_buf, ch);
 
-            if (line_buf->len > MAX_MMDB_LINE_LEN) {
-                MMDB_DEBUG("long line");
-                g_string_assign(line_buf, RES_INVALID_LINE);
+                if (line_buf->len > MAX_MMDB_LINE_LEN) {
+                    MMDB_DEBUG("long line");
+                    g_string_assign(line_buf, RES_INVALID_LINE);
+                }
             }
         }
 
-        if (status != 1) {
+        if (!line_complete) {
             if (!mmdbr_pipe_valid()) {
                 // Should be due to mmdb_resolve_stop.
                 MMDB_DEBUG("invalid mmdbr stdout pipe. exiting thread.");
@@ -261,13 +286,13 @@ read_mmdbr_stdout_worker(gpointer data _U_) {
             }
 
             MMDB_DEBUG("no pipe data");
-            g_usleep(MMDB_WAIT_TIME);
+            g_usleep(g_atomic_int_get(&mmdbr_outstanding) > 0 ? MMDB_BUSY_WAIT_TIME : MMDB_WAIT_TIME);
             continue;
         }
 
         char *line = g_strstrip(line_buf->str);
         size_t line_len = strlen(line);
-        MMDB_DEBUG("read %zd bytes, status %zd: %s", line_len, status, line);
+        MMDB_DEBUG("read %zd bytes: %s", line_len, line);
         if (line_len < 1) continue;
 
         char *val_start = strchr(line, ':');
@@ -345,6 +370,7 @@ read_mmdbr_stdout_worker(gpointer data _U_) {
                 MMDB_DEBUG("queued %p %s %s: city %s country %s", response, response->is_ipv4 ? "v4" : "v6", cur_addr, response->mmdb_val.city, response->mmdb_val.country);
                 g_async_queue_push(mmdbr_response_q, response); // Will be freed by maxmind_db_lookup_process.
                 response = g_new0(mmdb_response_t, 1);
+                g_atomic_int_add(&mmdbr_outstanding, -1);
             } else if (strcmp(cur_addr, "init") != 0) {
                 if (resolve_synchronously) {
                     // Synchronous lookups expect a 1-in 1-out resolution.
@@ -355,6 +381,7 @@ read_mmdbr_stdout_worker(gpointer data _U_) {
                 else {
                     MMDB_DEBUG("Discarded previous values due to bad address");
                 }
+                g_atomic_int_add(&mmdbr_outstanding, -1);
             }
             cur_addr[0] = '\0';
             init_lookup(&response->mmdb_val);
@@ -366,6 +393,7 @@ read_mmdbr_stdout_worker(gpointer data _U_) {
     g_string_free(country, TRUE);
     g_string_free(city, TRUE);
     g_string_free(as_org, TRUE);
+    g_free(read_buf);
     g_free(response);
     return NULL;
 }
@@ -410,6 +438,8 @@ static void mmdb_resolve_stop(void) {
     g_thread_join(read_mmdbr_stdout_thread);
     read_mmdbr_stdout_thread = NULL;
 
+    g_atomic_int_set(&mmdbr_outstanding, 0);
+
     while (mmdbr_response_q && (response = (mmdb_response_t *) g_async_queue_try_pop(mmdbr_response_q)) != NULL) {
         g_free((char *) response->mmdb_val.country_iso);
         g_free((char *) response->mmdb_val.country);
@@ -676,6 +706,33 @@ gboolean maxmind_db_lookup_process(void)
     return new_entries;
 }
 
+gboolean maxmind_db_lookup_flush(guint timeout_ms)
+{
+    gint64 deadline = g_get_monotonic_time() + (gint64) timeout_ms * 1000;
+    gboolean new_entries = maxmind_db_lookup_process();
+    mmdb_response_t *response;
+
+    while (mmdbr_response_q && mmdbr_pipe_valid() && g_atomic_int_get(&mmdbr_outstanding) > 0) {
+        gint64 remaining = deadline - g_get_monotonic_time();
+        if (remaining <= 0) {
+            MMDB_DEBUG("timed out with %d requests outstanding", g_atomic_int_get(&mmdbr_outstanding));
+            break;
+        }
+        response = (mmdb_response_t *) g_async_queue_timeout_pop(mmdbr_response_q, (guint64) remaining);
+        if (response) {
+            new_entries = TRUE;
+            maxmind_db_pop_response(response);
+        }
+    }
+
+    // Responses are counted after they are queued, pick up the last ones.
+    if (maxmind_db_lookup_process()) {
+        new_entries = TRUE;
+    }
+
+    return new_entries;
+}
+
 const mmdb_lookup_t *
 maxmind_db_lookup_ipv4(const ws_in4_addr *addr) {
     mmdb_lookup_t *result = (mmdb_lookup_t *) wmem_map_lookup(mmdb_ipv4_map, GUINT_TO_POINTER(*addr));
@@ -688,6 +745,7 @@ maxmind_db_lookup_ipv4(const ws_in4_addr *addr) {
             char addr_str[WS_INET_ADDRSTRLEN];
             ws_inet_ntop4(addr, addr_str, WS_INET_ADDRSTRLEN);
             MMDB_DEBUG("looking up %s", addr_str);
+            g_atomic_int_inc(&mmdbr_outstanding);
             g_async_queue_push(mmdbr_request_q, ws_strdup_printf("%s\n", addr_str));
             if (resolve_synchronously) {
                 maxmind_db_await_response();
@@ -711,6 +769,7 @@ maxmind_db_lookup_ipv6(const ws_in6_addr *addr) {
             char addr_str[WS_INET6_ADDRSTRLEN];
             ws_inet_ntop6(addr, addr_str, WS_INET6_ADDRSTRLEN);
             MMDB_DEBUG("looking up %s", addr_str);
+            g_atomic_int_inc(&mmdbr_outstanding);
             g_async_queue_push(mmdbr_request_q, ws_strdup_printf("%s\n", addr_str));
             if (resolve_synchronously) {
                 maxmind_db_await_response();
@@ -766,6 +825,12 @@ maxmind_db_lookup_process(void)
     return FALSE;
 }
 
+gboolean
+maxmind_db_lookup_flush(guint timeout_ms _U_)
+{
+    return FALSE;
+}
+
 const mmdb_lookup_t *
 maxmind_db_lookup_ipv4(const ws_in4_addr *addr _U_) {
     return &mmdb_not_found;
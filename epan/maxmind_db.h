@@ -76,6 +76,18 @@ WS_DLL_PUBLIC gchar *maxmind_db_get_paths(void);
  */
 WS_DLL_LOCAL gboolean maxmind_db_lookup_process(void);
 
+/**
+ * Wait for the answers to all asynchronous lookups issued so far.
+ * Callers that are about to show results for many addresses at once can
+ * look all of them up first and then call this, so that the whole batch
+ * is resolved in one round instead of trickling in.
+ *
+ * @param timeout_ms Maximum time to wait, in milliseconds.
+ *
+ * @return True if any new addresses were resolved.
+ */
+WS_DLL_PUBLIC gboolean maxmind_db_lookup_flush(guint timeout_ms);
+
 /**
  * Checks whether the lookup result was successful and has valid coordinates.
  */
@@ -36,6 +36,7 @@
 #include <epan/reassemble.h>
 #include <epan/stream.h>
 #include <epan/expert.h>
+#include <epan/conversation.h>
 #include <epan/prefs.h>
 #include <epan/range.h>
 
@@ -48,6 +49,30 @@ static dissector_handle_t frame_handle = NULL;
 static dissector_handle_t file_handle = NULL;
 static dissector_handle_t data_handle = NULL;
 
+/*
+ * Dissector profiling state; see dissector_profiling_enable().
+ *
+ * "dissector_profile_child_ns[n]" accumulates the time spent in the
+ * subdissectors of the profiled call at depth n, so that self time can
+ * be computed when that call returns.
+ */
+#define DISSECTOR_PROFILE_MAX_DEPTH 512
+static gboolean dissector_profiling = FALSE;
+static GHashTable *dissector_profiles = NULL;	/* proto id -> dissector_profile_t */
+static guint64 dissector_profile_child_ns[DISSECTOR_PROFILE_MAX_DEPTH];
+static guint dissector_profile_depth = 0;
+
+/*
+ * Per-packet dissection budget state; see the "protocols.dissection_budget_*"
+ * preferences. The budget is checked whenever a dissector is called
+ * through a handle or tried as a heuristic, and is only enforced once per
+ * packet, so the handlers that report it don't trip it again.
+ */
+static gboolean dissection_budget_active = FALSE;
+static gboolean dissection_budget_tripped = FALSE;
+static gint64 dissection_budget_deadline = 0;	/* monotonic usec, 0 = none */
+static guint64 dissection_budget_exceeded = 0;
+
 /**
  * A data source.
  * Has a tvbuff and a name.
@@ -81,9 +106,17 @@ struct data_source {
  *
  * "protocol" is the protocol associated with the dissector table. Used
  * for determining dependencies.
+ *
+ * "dense" is, for uint tables, a direct-index copy of the hash table
+ * entries for values up to DTBL_DENSE_MAX, which covers ethertypes, IP
+ * protocol numbers and port numbers. It is an array of DTBL_DENSE_PAGES
+ * pointers to pages of DTBL_DENSE_PAGE_SIZE entries; both levels are only
+ * allocated once an entry in their range is added. Values above
+ * DTBL_DENSE_MAX are only in the hash table.
  */
 struct dissector_table {
 	GHashTable	*hash_table;
+	dtbl_entry_t	***dense;
 	GSList		*dissector_handles;
 	const char	*ui_name;
 	ftenum_t	type;
@@ -93,6 +126,11 @@ struct dissector_table {
 	gboolean	supports_decode_as;
 };
 
+#define DTBL_DENSE_PAGE_BITS	8
+#define DTBL_DENSE_PAGE_SIZE	(1U << DTBL_DENSE_PAGE_BITS)
+#define DTBL_DENSE_PAGES	256
+#define DTBL_DENSE_MAX		(DTBL_DENSE_PAGES * DTBL_DENSE_PAGE_SIZE - 1)
+
 /*
  * Dissector tables. const char * -> dissector_table *
  */
@@ -159,6 +197,7 @@ destroy_depend_dissector_list(void *data)
 struct heur_dissector_list {
 	protocol_t	*protocol;
 	GSList		*dissectors;
+	wmem_map_t	*conversation_memo;	/* conversation_t * -> heur_dtbl_entry_t * */
 };
 
 static GHashTable *heur_dissector_lists = NULL;
@@ -191,6 +230,13 @@ destroy_dissector_table(void *data)
 	struct dissector_table *table = (struct dissector_table *)data;
 
 	g_hash_table_destroy(table->hash_table);
+	if (table->dense) {
+		guint i;
+
+		for (i = 0; i < DTBL_DENSE_PAGES; i++)
+			g_free(table->dense[i]);
+		g_free(table->dense);
+	}
 	g_slist_free(table->dissector_handles);
 	g_slice_free(struct dissector_table, data);
 }
@@ -261,6 +307,10 @@ packet_cleanup(void)
 	g_hash_table_destroy(depend_dissector_lists);
 	g_hash_table_destroy(heur_dissector_lists);
 	g_hash_table_destroy(heuristic_short_names);
+	if (dissector_profiles) {
+		g_hash_table_destroy(dissector_profiles);
+		dissector_profiles = NULL;
+	}
 	g_slist_foreach(shutdown_routines, &call_routine, NULL);
 	g_slist_free(shutdown_routines);
 	if (postdissectors) {
@@ -477,6 +527,64 @@ final_registration_all_protocols(void)
 }
 
 
+static void
+dissection_budget_start(void)
+{
+	dissection_budget_tripped = FALSE;
+	dissection_budget_active = prefs.dissect_budget_msec != 0 ||
+	    prefs.dissect_budget_pool_kib != 0 ||
+	    prefs.dissect_budget_tree_items != 0;
+	if (dissection_budget_active && prefs.dissect_budget_msec != 0)
+		dissection_budget_deadline = g_get_monotonic_time() +
+		    (gint64)prefs.dissect_budget_msec * 1000;
+	else
+		dissection_budget_deadline = 0;
+}
+
+/*
+ * Throws DissectionBudgetError if the packet being dissected has gone
+ * over one of its budgets. Only called below the top-level frame or
+ * file dissector, whose exception handlers report it.
+ */
+static void
+dissection_budget_check(packet_info *pinfo, proto_tree *tree)
+{
+	wmem_allocator_stats_t stats;
+	const char *what;
+
+	if (G_LIKELY(!dissection_budget_active) || dissection_budget_tripped)
+		return;
+
+	if (dissection_budget_deadline != 0 &&
+	    g_get_monotonic_time() > dissection_budget_deadline) {
+		what = wmem_strdup_printf(pinfo->pool, "more than %u ms",
+		    prefs.dissect_budget_msec);
+	} else if (prefs.dissect_budget_tree_items != 0 && tree &&
+	    tree->tree_data->count > prefs.dissect_budget_tree_items) {
+		what = wmem_strdup_printf(pinfo->pool, "more than %u tree items",
+		    prefs.dissect_budget_tree_items);
+	} else if (prefs.dissect_budget_pool_kib != 0 &&
+	    wmem_allocator_get_stats(pinfo->pool, &stats) &&
+	    stats.bytes_live > (size_t)prefs.dissect_budget_pool_kib * 1024) {
+		what = wmem_strdup_printf(pinfo->pool, "more than %u KiB of memory",
+		    prefs.dissect_budget_pool_kib);
+	} else {
+		return;
+	}
+
+	dissection_budget_tripped = TRUE;
+	dissection_budget_exceeded++;
+	THROW_MESSAGE(DissectionBudgetError,
+	    wmem_strdup_printf(pinfo->pool, "Dissection stopped in %s after %s",
+	        pinfo->current_proto, what));
+}
+
+guint64
+dissection_budget_exceeded_count(void)
+{
+	return dissection_budget_exceeded;
+}
+
 /* Creates the top-most tvbuff and calls dissect_frame() */
 void
 dissect_record(epan_dissect_t *edt, int file_type_subtype,
@@ -485,6 +593,10 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 	const char *volatile record_type;
 	frame_data_t frame_dissector_data;
 
+	/* A previous record may have unwound profiled calls with an exception. */
+	dissector_profile_depth = 0;
+	dissection_budget_start();
+
 	switch (rec->rec_type) {
 
 	case REC_TYPE_PACKET:
@@ -645,6 +757,9 @@ dissect_file(epan_dissect_t *edt, wtap_rec *rec,
 {
 	file_data_t file_dissector_data;
 
+	dissector_profile_depth = 0;
+	dissection_budget_start();
+
 	if (cinfo != NULL)
 		col_init(cinfo, edt->session);
 	edt->pi.epan = edt->session;
@@ -729,6 +844,115 @@ struct dissector_handle {
 	protocol_t	*protocol;
 };
 
+/*
+ * Dissector profiling.
+ */
+typedef struct dissector_profile_frame {
+	guint64	start_ns;
+	guint	depth;
+	guint	tree_count;
+} dissector_profile_frame_t;
+
+static guint64
+dissector_profile_now(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (guint64)ts.tv_sec * 1000000000 + (guint64)ts.tv_nsec;
+#endif
+	return (guint64)g_get_monotonic_time() * 1000;
+}
+
+static void
+dissector_profile_enter(dissector_profile_frame_t *frame, proto_tree *tree)
+{
+	frame->depth = dissector_profile_depth;
+	if (frame->depth < DISSECTOR_PROFILE_MAX_DEPTH)
+		dissector_profile_child_ns[frame->depth] = 0;
+	dissector_profile_depth++;
+	frame->tree_count = tree ? tree->tree_data->count : 0;
+	frame->start_ns = dissector_profile_now();
+}
+
+static void
+dissector_profile_leave(const dissector_profile_frame_t *frame, protocol_t *protocol,
+			proto_tree *tree, int len, gboolean heuristic)
+{
+	guint64              elapsed = dissector_profile_now() - frame->start_ns;
+	guint64              child_ns = 0;
+	int                  proto_id = protocol ? proto_get_id(protocol) : -1;
+	dissector_profile_t *profile;
+
+	if (dissector_profiles == NULL)
+		dissector_profiles = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+	profile = (dissector_profile_t *)g_hash_table_lookup(dissector_profiles, GINT_TO_POINTER(proto_id));
+	if (profile == NULL) {
+		profile = g_new0(dissector_profile_t, 1);
+		profile->proto_id = proto_id;
+		g_hash_table_insert(dissector_profiles, GINT_TO_POINTER(proto_id), profile);
+	}
+
+	profile->calls++;
+	if (len != 0)
+		profile->accepted++;
+	if (heuristic) {
+		profile->heur_attempts++;
+		if (len != 0)
+			profile->heur_accepted++;
+	}
+
+	if (frame->depth < DISSECTOR_PROFILE_MAX_DEPTH)
+		child_ns = dissector_profile_child_ns[frame->depth];
+	profile->inclusive_ns += elapsed;
+	profile->self_ns += elapsed > child_ns ? elapsed - child_ns : 0;
+	if (tree && tree->tree_data->count > frame->tree_count)
+		profile->tree_items += tree->tree_data->count - frame->tree_count;
+
+	/* Also pops any deeper calls that were unwound by an exception. */
+	dissector_profile_depth = frame->depth;
+	if (frame->depth > 0 && frame->depth <= DISSECTOR_PROFILE_MAX_DEPTH)
+		dissector_profile_child_ns[frame->depth - 1] += elapsed;
+}
+
+void
+dissector_profiling_enable(gboolean enable)
+{
+	dissector_profiling = enable;
+	dissector_profile_depth = 0;
+}
+
+gboolean
+dissector_profiling_enabled(void)
+{
+	return dissector_profiling;
+}
+
+void
+dissector_profiling_reset(void)
+{
+	if (dissector_profiles)
+		g_hash_table_remove_all(dissector_profiles);
+	dissector_profile_depth = 0;
+}
+
+void
+dissector_profiling_foreach(dissector_profile_func func, void *user_data)
+{
+	GHashTableIter iter;
+	gpointer       value;
+
+	if (dissector_profiles == NULL)
+		return;
+
+	g_hash_table_iter_init(&iter, dissector_profiles);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		func((const dissector_profile_t *)value, user_data);
+	}
+}
+
 /* This function will return
  * old style dissector :
  *   length of the payload or 1 of the payload is empty
@@ -748,9 +972,12 @@ call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 
 	saved_proto = pinfo->current_proto;
 
-	if ((handle->protocol != NULL) && (!proto_is_pino(handle->protocol))) {
-		pinfo->current_proto =
-			proto_get_protocol_short_name(handle->protocol);
+	if (handle->protocol != NULL) {
+		proto_register_deferred_fields(handle->protocol);
+		if (!proto_is_pino(handle->protocol)) {
+			pinfo->current_proto =
+				proto_get_protocol_short_name(handle->protocol);
+		}
 	}
 
 	if (handle->dissector_type == DISSECTOR_TYPE_SIMPLE) {
@@ -797,6 +1024,8 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 	int          len;
 	guint        saved_layers_len = 0;
 	guint        saved_tree_count = tree ? tree->tree_data->count : 0;
+	gboolean     profiled;
+	dissector_profile_frame_t profile_frame;
 
 	if (handle->protocol != NULL &&
 	    !proto_is_protocol_enabled(handle->protocol)) {
@@ -810,6 +1039,8 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 	saved_can_desegment = pinfo->can_desegment;
 	saved_layers_len = wmem_list_count(pinfo->layers);
 	DISSECTOR_ASSERT(saved_layers_len < PINFO_LAYER_MAX_RECURSION_DEPTH);
+	if (saved_layers_len > 0)
+		dissection_budget_check(pinfo, tree);
 
 	/*
 	 * can_desegment is set to 2 by anyone which offers the
@@ -841,6 +1072,9 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		}
 	}
 
+	profiled = dissector_profiling;
+	if (G_UNLIKELY(profiled))
+		dissector_profile_enter(&profile_frame, tree);
 	if (pinfo->flags.in_error_pkt) {
 		len = call_dissector_work_error(handle, tvb, pinfo, tree, data);
 	} else {
@@ -849,6 +1083,8 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		 */
 		len = call_dissector_through_handle(handle, tvb, pinfo, tree, data);
 	}
+	if (G_UNLIKELY(profiled))
+		dissector_profile_leave(&profile_frame, handle->protocol, tree, len, FALSE);
 	if (handle->protocol != NULL && !proto_is_pino(handle->protocol) && add_proto_name &&
 		(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
 		/*
@@ -1035,10 +1271,93 @@ find_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern)
 	/*
 	 * Find the entry.
 	 */
+	if (pattern <= DTBL_DENSE_MAX) {
+		dtbl_entry_t **page;
+
+		if (sub_dissectors->dense == NULL)
+			return NULL;
+		page = sub_dissectors->dense[pattern >> DTBL_DENSE_PAGE_BITS];
+		return page ? page[pattern & (DTBL_DENSE_PAGE_SIZE - 1)] : NULL;
+	}
 	return (dtbl_entry_t *)g_hash_table_lookup(sub_dissectors->hash_table,
 				   GUINT_TO_POINTER(pattern));
 }
 
+/* Mirror a change to a uint table's hash table in its dense index. */
+static void
+uint_dtbl_dense_set(dissector_table_t sub_dissectors, const guint32 pattern,
+		    dtbl_entry_t *dtbl_entry)
+{
+	dtbl_entry_t **page;
+
+	if (pattern > DTBL_DENSE_MAX)
+		return;
+
+	if (sub_dissectors->dense == NULL) {
+		if (dtbl_entry == NULL)
+			return;
+		sub_dissectors->dense = g_new0(dtbl_entry_t **, DTBL_DENSE_PAGES);
+	}
+
+	page = sub_dissectors->dense[pattern >> DTBL_DENSE_PAGE_BITS];
+	if (page == NULL) {
+		if (dtbl_entry == NULL)
+			return;
+		page = g_new0(dtbl_entry_t *, DTBL_DENSE_PAGE_SIZE);
+		sub_dissectors->dense[pattern >> DTBL_DENSE_PAGE_BITS] = page;
+	}
+	page[pattern & (DTBL_DENSE_PAGE_SIZE - 1)] = dtbl_entry;
+}
+
+/* Add or replace an entry in a uint dissector table. */
+static void
+uint_dtbl_insert(dissector_table_t sub_dissectors, const guint32 pattern,
+		 dtbl_entry_t *dtbl_entry)
+{
+	g_hash_table_insert(sub_dissectors->hash_table,
+			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	uint_dtbl_dense_set(sub_dissectors, pattern, dtbl_entry);
+}
+
+/* Remove (and free) an entry from a uint dissector table. */
+static void
+uint_dtbl_remove(dissector_table_t sub_dissectors, const guint32 pattern)
+{
+	uint_dtbl_dense_set(sub_dissectors, pattern, NULL);
+	g_hash_table_remove(sub_dissectors->hash_table,
+			    GUINT_TO_POINTER(pattern));
+}
+
+static void
+uint_dtbl_dense_add(gpointer key, gpointer value, gpointer user_data)
+{
+	uint_dtbl_dense_set((dissector_table_t)user_data, GPOINTER_TO_UINT(key),
+			    (dtbl_entry_t *)value);
+}
+
+/* g_hash_table_foreach_remove() for any kind of dissector table, keeping
+   the dense index of uint tables in sync. */
+static void
+dissector_table_foreach_remove(dissector_table_t sub_dissectors,
+			       GHRFunc func, gpointer user_data)
+{
+	guint i;
+
+	if (g_hash_table_foreach_remove(sub_dissectors->hash_table, func, user_data) == 0)
+		return;
+
+	if (sub_dissectors->dense == NULL)
+		return;
+
+	/* Rare; just rebuild the index from what is left */
+	for (i = 0; i < DTBL_DENSE_PAGES; i++) {
+		if (sub_dissectors->dense[i])
+			memset(sub_dissectors->dense[i], 0,
+			       DTBL_DENSE_PAGE_SIZE * sizeof(dtbl_entry_t *));
+	}
+	g_hash_table_foreach(sub_dissectors->hash_table, uint_dtbl_dense_add, sub_dissectors);
+}
+
 #if 0
 static void
 dissector_add_uint_sanity_check(const char *name, guint32 pattern, dissector_handle_t handle, dissector_table_t sub_dissectors)
@@ -1116,8 +1435,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 	dtbl_entry->initial = dtbl_entry->current;
 
 	/* do the table insertion */
-	g_hash_table_insert(sub_dissectors->hash_table,
-			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	uint_dtbl_insert(sub_dissectors, pattern, dtbl_entry);
 
 	/*
 	 * Now, if this table supports "Decode As", add this handle
@@ -1277,8 +1595,7 @@ dissector_delete_uint(const char *name, const guint32 pattern,
 		/*
 		 * Found - remove it.
 		 */
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		uint_dtbl_remove(sub_dissectors, pattern);
 	}
 }
 
@@ -1319,7 +1636,7 @@ void dissector_delete_all(const char *name, dissector_handle_t handle)
 	dissector_table_t sub_dissectors = find_dissector_table(name);
 	ws_assert (sub_dissectors);
 
-	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, handle);
+	dissector_table_foreach_remove(sub_dissectors, dissector_delete_all_check, handle);
 }
 
 static void
@@ -1328,7 +1645,7 @@ dissector_delete_from_table(gpointer key _U_, gpointer value, gpointer user_data
 	dissector_table_t sub_dissectors = (dissector_table_t) value;
 	ws_assert (sub_dissectors);
 
-	g_hash_table_foreach_remove(sub_dissectors->hash_table, dissector_delete_all_check, user_data);
+	dissector_table_foreach_remove(sub_dissectors, dissector_delete_all_check, user_data);
 	sub_dissectors->dissector_handles = g_slist_remove(sub_dissectors->dissector_handles, user_data);
 }
 
@@ -1372,8 +1689,7 @@ dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_
 	dtbl_entry->current = handle;
 
 	/* do the table insertion */
-	g_hash_table_insert(sub_dissectors->hash_table,
-			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	uint_dtbl_insert(sub_dissectors, pattern, dtbl_entry);
 }
 
 /* Reset an entry in a uint dissector table to its initial value. */
@@ -1400,8 +1716,7 @@ dissector_reset_uint(const char *name, const guint32 pattern)
 	if (dtbl_entry->initial != NULL) {
 		dtbl_entry->current = dtbl_entry->initial;
 	} else {
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		uint_dtbl_remove(sub_dissectors, pattern);
 	}
 }
 
@@ -2568,6 +2883,7 @@ register_dissector_table(const char *name, const char *ui_name, const int proto,
 		ws_error("The dissector table %s (%s) is registering an unsupported type - are you using a buggy plugin?", name, ui_name);
 		ws_assert_not_reached();
 	}
+	sub_dissectors->dense = NULL;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->ui_name = ui_name;
 	sub_dissectors->type    = type;
@@ -2597,6 +2913,7 @@ dissector_table_t register_custom_dissector_table(const char *name,
 							       &g_free,
 							       &g_free);
 
+	sub_dissectors->dense = NULL;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->ui_name = ui_name;
 	sub_dissectors->type    = FT_BYTES; /* Consider key a "blob" of data, no need to really create new type */
@@ -2758,6 +3075,8 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->short_name = g_strdup(internal_name);
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
+	hdtbl_entry->attempts  = 0;
+	hdtbl_entry->accepted  = 0;
 
 	/* do the table insertion */
 	g_hash_table_insert(heuristic_short_names, (gpointer)hdtbl_entry->short_name, hdtbl_entry);
@@ -2812,6 +3131,84 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 	}
 }
 
+/*
+ * Try a single heuristic dissector on behalf of dissector_try_heuristic().
+ * Returns the dissector's result, or 0 if the dissector is disabled.
+ */
+static int
+try_heur_dtbl_entry(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+		    packet_info *pinfo, proto_tree *tree, void *data,
+		    guint16 saved_can_desegment, guint saved_layers_len,
+		    guint saved_tree_count)
+{
+	int                proto_id;
+	int                len;
+	gboolean           profiled;
+	dissector_profile_frame_t profile_frame;
+
+	dissection_budget_check(pinfo, tree);
+
+	/* XXX - why set this now and in dissector_try_heuristic()? */
+	pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+
+	if (hdtbl_entry->protocol != NULL &&
+		(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
+		/*
+		 * No - don't try this dissector.
+		 */
+		return 0;
+	}
+
+	if (hdtbl_entry->protocol != NULL) {
+		proto_register_deferred_fields(hdtbl_entry->protocol);
+		proto_id = proto_get_id(hdtbl_entry->protocol);
+		/* do NOT change this behavior - wslua uses the protocol short name set here in order
+		   to determine which Lua-based heurisitc dissector to call */
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		pinfo->curr_layer_num++;
+		wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	}
+
+	pinfo->heur_list_name = hdtbl_entry->list_name;
+
+	hdtbl_entry->attempts++;
+	profiled = dissector_profiling;
+	if (G_UNLIKELY(profiled))
+		dissector_profile_enter(&profile_frame, tree);
+	len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+	if (G_UNLIKELY(profiled))
+		dissector_profile_leave(&profile_frame, hdtbl_entry->protocol, tree, len, TRUE);
+	if (len)
+		hdtbl_entry->accepted++;
+	if (hdtbl_entry->protocol != NULL &&
+		(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
+		/*
+		 * We added a protocol layer above. The dissector
+		 * didn't accept the packet or it didn't add any
+		 * items to the tree so remove it from the list.
+		 */
+		while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+			if (len == 0) {
+				/*
+				 * Only reduce the layer number if the dissector
+				 * rejected the data. Since tree can be NULL on
+				 * the first pass, we cannot check it or it will
+				 * break dissectors that rely on a stable value.
+				 */
+				pinfo->curr_layer_num--;
+			}
+			wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+		}
+	}
+	return len;
+}
+
 gboolean
 dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **heur_dtbl_entry, void *data)
@@ -2824,8 +3221,8 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	guint16            saved_can_desegment;
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
-	int                proto_id;
-	int                len;
+	heur_dtbl_entry_t *memo_entry = NULL;
+	conversation_t    *conv = NULL;
 	guint              saved_tree_count = tree ? tree->tree_data->count : 0;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
@@ -2850,59 +3247,41 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 	DISSECTOR_ASSERT(saved_layers_len < PINFO_LAYER_MAX_RECURSION_DEPTH);
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
+	/*
+	 * If enabled, first try the heuristic dissector that last accepted
+	 * data from this conversation, so that the common case of a
+	 * conversation carrying a single protocol doesn't run through every
+	 * heuristic in the list for every packet.
+	 */
+	if (prefs.heur_conversation_memo) {
+		conv = find_conversation_pinfo(pinfo, 0);
+		if (conv != NULL) {
+			if (sub_dissectors->conversation_memo == NULL) {
+				sub_dissectors->conversation_memo =
+					wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), g_direct_hash, g_direct_equal);
+			}
+			memo_entry = (heur_dtbl_entry_t *)wmem_map_lookup(sub_dissectors->conversation_memo, conv);
+			if (memo_entry != NULL &&
+			    try_heur_dtbl_entry(memo_entry, tvb, pinfo, tree, data,
+						saved_can_desegment, saved_layers_len, saved_tree_count)) {
+				*heur_dtbl_entry = memo_entry;
+				status = TRUE;
+			}
+		}
+	}
+
+	for (entry = sub_dissectors->dissectors; entry != NULL && !status;
 	    entry = g_slist_next(entry)) {
-		/* XXX - why set this now and above? */
-		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
 		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
 
-		if (hdtbl_entry->protocol != NULL &&
-			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
-			/*
-			 * No - don't try this dissector.
-			 */
+		if (hdtbl_entry == memo_entry) {
+			/* Already tried above. */
+			prev_entry = entry;
 			continue;
 		}
 
-		if (hdtbl_entry->protocol != NULL) {
-			proto_id = proto_get_id(hdtbl_entry->protocol);
-			/* do NOT change this behavior - wslua uses the protocol short name set here in order
-			   to determine which Lua-based heurisitc dissector to call */
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
-
-			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
-			 */
-			pinfo->curr_layer_num++;
-			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
-		}
-
-		pinfo->heur_list_name = hdtbl_entry->list_name;
-
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
-		if (hdtbl_entry->protocol != NULL &&
-			(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
-			/*
-			 * We added a protocol layer above. The dissector
-			 * didn't accept the packet or it didn't add any
-			 * items to the tree so remove it from the list.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				if (len == 0) {
-					/*
-					 * Only reduce the layer number if the dissector
-					 * rejected the data. Since tree can be NULL on
-					 * the first pass, we cannot check it or it will
-					 * break dissectors that rely on a stable value.
-					 */
-					pinfo->curr_layer_num--;
-				}
-				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
-			}
-		}
-		if (len) {
+		if (try_heur_dtbl_entry(hdtbl_entry, tvb, pinfo, tree, data,
+					saved_can_desegment, saved_layers_len, saved_tree_count)) {
 			*heur_dtbl_entry = hdtbl_entry;
 
 			/* Bubble the matched entry to the top for faster search next time. */
@@ -2910,6 +3289,8 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 				sub_dissectors->dissectors = g_slist_remove_link(sub_dissectors->dissectors, entry);
 				sub_dissectors->dissectors = g_slist_concat(entry, sub_dissectors->dissectors);
 			}
+			if (conv != NULL)
+				wmem_map_insert(sub_dissectors->conversation_memo, conv, hdtbl_entry);
 			status = TRUE;
 			break;
 		}
@@ -3070,6 +3451,7 @@ register_heur_dissector_list(const char *name, const int proto)
 	sub_dissectors = g_slice_new(struct heur_dissector_list);
 	sub_dissectors->protocol  = find_protocol_by_id(proto);
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->conversation_memo = NULL;
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
 	return sub_dissectors;
@@ -3365,6 +3747,7 @@ void call_heur_dissector_direct(heur_dtbl_entry_t *heur_dtbl_entry, tvbuff_t *tv
 	}
 
 	if (heur_dtbl_entry->protocol != NULL) {
+		proto_register_deferred_fields(heur_dtbl_entry->protocol);
 		/* do NOT change this behavior - wslua uses the protocol short name set here in order
 			to determine which Lua-based heuristic dissector to call */
 		pinfo->current_proto = proto_get_protocol_short_name(heur_dtbl_entry->protocol);
@@ -453,6 +453,8 @@ typedef struct heur_dtbl_entry {
 	const gchar *display_name;     /* the string used to present heuristic to user */
 	gchar *short_name;     /* string used for "internal" use to uniquely identify heuristic */
 	gboolean enabled;
+	guint64 attempts;      /* number of times this heuristic was tried */
+	guint64 accepted;      /* number of times this heuristic accepted the data */
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
@@ -856,6 +858,45 @@ WS_DLL_PUBLIC gboolean postdissectors_want_hfids(void);
 WS_DLL_PUBLIC void
 prime_epan_dissect_with_postdissector_wanted_hfids(epan_dissect_t *edt);
 
+/*
+ * Per-protocol dissector profiling.
+ *
+ * When enabled, every dissector called through a handle or tried as a
+ * heuristic dissector is timed and counted against its protocol.
+ * Inclusive time covers the dissector and everything it calls; self time
+ * excludes the time spent in subdissectors. Times are approximate for
+ * calls that are unwound by an exception. When disabled the cost is a
+ * single test per call.
+ */
+typedef struct dissector_profile {
+    int      proto_id;          /* -1 for handles without a protocol */
+    guint64  calls;             /* calls, including heuristic attempts */
+    guint64  accepted;          /* calls that returned a non-zero length */
+    guint64  heur_attempts;     /* calls made as a heuristic dissector */
+    guint64  heur_accepted;     /* heuristic calls that accepted the packet */
+    guint64  inclusive_ns;
+    guint64  self_ns;
+    guint64  tree_items;        /* proto_tree items added while running */
+} dissector_profile_t;
+
+typedef void (*dissector_profile_func)(const dissector_profile_t *profile, void *user_data);
+
+/** Turn dissector profiling on or off. Existing results are kept. */
+WS_DLL_PUBLIC void dissector_profiling_enable(gboolean enable);
+
+/** Return TRUE if dissector profiling is enabled. */
+WS_DLL_PUBLIC gboolean dissector_profiling_enabled(void);
+
+/** Discard all accumulated profiling results. */
+WS_DLL_PUBLIC void dissector_profiling_reset(void);
+
+/** Call func for the accumulated results of each protocol, in no particular order. */
+WS_DLL_PUBLIC void dissector_profiling_foreach(dissector_profile_func func, void *user_data);
+
+/** Return the number of packets whose dissection was cut short because
+ * they went over one of the "protocols.dissection_budget_*" limits. */
+WS_DLL_PUBLIC guint64 dissection_budget_exceeded_count(void);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -72,6 +72,7 @@ typedef struct _packet_info {
   const char *match_string;         /**< matched string for calling subdissector from table */
   gboolean use_endpoint;            /**< TRUE if endpoint member should be used for conversations */
   struct endpoint* conv_endpoint;   /**< Data that can be used for conversations */
+  struct conversation_lookup_cache *conv_lookup_cache; /**< Recent find_conversation_pinfo() results for this packet */
   guint16 can_desegment;            /**< >0 if this segment could be desegmented.
                                          A dissector that can offer this API (e.g.
                                          TCP) sets can_desegment=2, then
@@ -144,7 +145,7 @@ typedef struct _packet_info {
   gint16 src_win_scale;        /**< Rcv.Wind.Shift src applies when sending segments; -1 unknown; -2 disabled */
   gint16 dst_win_scale;        /**< Rcv.Wind.Shift dst applies when sending segments; -1 unknown; -2 disabled */
 
-  GSList* proto_data;          /**< Per packet proto data */
+  struct _proto_data_table *proto_data; /**< Per packet proto data */
 
   GSList* dependent_frames;     /**< A list of frames which this one depends on */
 
@@ -34,6 +34,7 @@
 #include "print.h"
 #include <wsutil/file_util.h>
 #include <wsutil/report_message.h>
+#include <wsutil/task_pool.h>
 #include <wsutil/wslog.h>
 #include <wsutil/ws_assert.h>
 
@@ -3008,6 +3009,12 @@ static module_t *gui_module = NULL;
 static module_t *gui_color_module = NULL;
 static module_t *nameres_module = NULL;
 
+static void
+protocols_prefs_apply(void)
+{
+    task_pool_set_max_threads(prefs.worker_threads);
+}
+
 static void
 prefs_register_modules(void)
 {
@@ -3338,6 +3345,13 @@ prefs_register_modules(void)
                                    "The maximum depth of the dissection tree (Increase with caution)",
                                    10,
                                    &prefs.gui_max_tree_depth);
+    prefs_register_uint_preference(gui_module, "packet_details_cache",
+                                   "Dissected packets to keep",
+                                   "The number of recently selected packets whose dissection is kept in "
+                                   "memory, so that selecting one of them again shows its details at once. "
+                                   "Each one keeps its whole protocol tree and data. 0 keeps none.",
+                                   10,
+                                   &prefs.gui_packet_details_cache);
 
 
     /* User Interface : Layout */
@@ -3569,6 +3583,12 @@ prefs_register_modules(void)
     prefs_register_bool_preference(capture_module, "real_time_update", "Update packet list in real time during capture",
         "Update packet list in real time during capture?", &prefs.capture_real_time);
 
+    prefs_register_uint_preference(capture_module, "sample_interval", "Dissect every Nth packet during capture",
+        "When updating the packet list in real time, only dissect and show every Nth packet "
+        "until the capture is stopped. All packets are written to the capture file and are "
+        "dissected when the capture stops. 1 dissects every packet.",
+        10, &prefs.capture_sample_interval);
+
     prefs_register_bool_preference(capture_module, "no_interface_load", "Don't load interfaces on startup",
         "Don't automatically load capture interfaces on startup", &prefs.capture_no_interface_load);
 
@@ -3695,7 +3715,7 @@ prefs_register_modules(void)
 
     /* Protocols */
     protocols_module = prefs_register_module(NULL, "protocols", "Protocols",
-                                             "Protocols", NULL, TRUE);
+                                             "Protocols", protocols_prefs_apply, TRUE);
 
     prefs_register_bool_preference(protocols_module, "display_hidden_proto_items",
                                    "Display hidden protocol items",
@@ -3718,6 +3738,43 @@ prefs_register_modules(void)
                                    "Currently ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking, and IPv4 uses this preference to take VLAN ID into account during reassembly",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_bool_preference(protocols_module, "heuristic_conversation_memo",
+                                   "Try the last accepted heuristic dissector of a conversation first",
+                                   "Remember which heuristic dissector accepted a conversation and try it before the "
+                                   "rest of the heuristic list for later packets of that conversation. This reduces "
+                                   "the number of heuristics run per packet, but a conversation whose packets match "
+                                   "several heuristics may be dissected differently than in list order.",
+                                   &prefs.heur_conversation_memo);
+
+    prefs_register_uint_preference(protocols_module, "dissection_budget_msec",
+                                   "Per-packet dissection time limit (ms)",
+                                   "Stop dissecting a packet once it has taken this many milliseconds and mark it "
+                                   "with a \"Dissection budget exceeded\" expert item. 0 means no limit.",
+                                   10,
+                                   &prefs.dissect_budget_msec);
+
+    prefs_register_uint_preference(protocols_module, "dissection_budget_pool_kib",
+                                   "Per-packet dissection memory limit (KiB)",
+                                   "Stop dissecting a packet once its packet-lifetime memory exceeds this many KiB. "
+                                   "0 means no limit.",
+                                   10,
+                                   &prefs.dissect_budget_pool_kib);
+
+    prefs_register_uint_preference(protocols_module, "dissection_budget_tree_items",
+                                   "Per-packet dissection tree item limit",
+                                   "Stop dissecting a packet once its tree has this many items. Unlike "
+                                   "gui.max_tree_items this is reported as an exceeded budget rather than a "
+                                   "dissector bug. 0 means no limit.",
+                                   10,
+                                   &prefs.dissect_budget_tree_items);
+
+    prefs_register_uint_preference(protocols_module, "worker_threads",
+                                   "Worker threads",
+                                   "The number of threads shared by everything that is done in parallel. "
+                                   "0 means one per processor; 1 does all the work on the main thread.",
+                                   10,
+                                   &prefs.worker_threads);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -4177,6 +4234,7 @@ pre_init_prefs(void)
     prefs.gui_max_export_objects     = 1000;
     prefs.gui_max_tree_items = 1 * 1000 * 1000;
     prefs.gui_max_tree_depth = 5 * 100;
+    prefs.gui_packet_details_cache = 0;
     prefs.gui_decimal_places1 = DEF_GUI_DECIMAL_PLACES1;
     prefs.gui_decimal_places2 = DEF_GUI_DECIMAL_PLACES2;
     prefs.gui_decimal_places3 = DEF_GUI_DECIMAL_PLACES3;
@@ -4203,6 +4261,7 @@ pre_init_prefs(void)
     prefs.capture_real_time             = TRUE;
     prefs.capture_no_extcap             = FALSE;
     prefs.capture_auto_scroll           = TRUE;
+    prefs.capture_sample_interval       = 1;
     prefs.capture_show_info             = FALSE;
 
     if (!prefs.capture_columns) {
@@ -182,6 +182,7 @@ typedef struct _e_prefs {
   guint        gui_max_export_objects;
   guint        gui_max_tree_items;
   guint        gui_max_tree_depth;
+  guint        gui_packet_details_cache;
   layout_type_e gui_layout_type;
   layout_pane_content_e gui_layout_content_1;
   layout_pane_content_e gui_layout_content_2;
@@ -204,6 +205,7 @@ typedef struct _e_prefs {
   gboolean     capture_pcap_ng;
   gboolean     capture_real_time;
   gboolean     capture_auto_scroll; /* XXX - Move to recent */
+  guint        capture_sample_interval;
   gboolean     capture_no_interface_load;
   gboolean     capture_no_extcap;
   gboolean     capture_show_info;
@@ -214,6 +216,11 @@ typedef struct _e_prefs {
   gboolean     enable_incomplete_dissectors_check;
   gboolean     incomplete_dissectors_check_debug;
   gboolean     strict_conversation_tracking_heuristics;
+  gboolean     heur_conversation_memo;
+  guint        dissect_budget_msec;       /* Per-packet dissection budgets, 0 = no limit */
+  guint        dissect_budget_pool_kib;
+  guint        dissect_budget_tree_items;
+  guint        worker_threads;            /* Threads for parallel work, 0 = one per processor */
   gboolean     filter_expressions_old;  /* TRUE if old filter expressions preferences were loaded. */
   gboolean     gui_update_enabled;
   software_update_channel_e gui_update_channel;
@@ -78,9 +78,16 @@ struct _output_fields {
     gchar         aggregator;
     GPtrArray    *fields;
     GHashTable   *field_indicies;
+    guint        *hfid_slots;      /* field index + 1 by hfid, 0 if not requested */
+    guint         hfid_slots_len;
+    gboolean      has_unresolved;  /* some field name had no hfinfo when planned */
     GPtrArray   **field_values;
+    GPtrArray   **field_infos;     /* field_info pointers per field, for CBOR output */
     gchar         quote;
     gboolean      includes_col_fields;
+    GArray       *prime_hfids;     /* hfids to prime an invisible tree with */
+    gboolean      needs_labels;    /* some field is printed from its label */
+    gchar         aggregator_str[2];
 };
 
 static gchar *get_field_hex_value(GSList *src_list, field_info *fi);
@@ -123,6 +130,7 @@ static void print_pdml_geninfo(epan_dissect_t *edt, FILE *fh);
 static void write_ek_summary(column_info *cinfo, write_json_data *pdata);
 
 static void proto_tree_get_node_field_values(proto_node *node, gpointer data);
+static void output_fields_build_indicies(output_fields_t *fields);
 
 /* Cache the protocols and field handles that the print functionality needs
    This helps break explicit dependency on the dissectors. */
@@ -1944,9 +1952,15 @@ json_write_field_hex_value(write_json_data *pdata, field_info *fi)
 
     if (pd) {
         gint i;
-        guint len = fi->length * 2 + 1;
-        gchar* str = (gchar*)g_malloc0(len);
+        /* Used fixed buffer where can, otherwise temp malloc */
+        gchar str_stack[129];
+        gchar *str = str_stack;
+        gchar *str_heap = NULL;
         static const char hex[] = "0123456789abcdef";
+        if (fi->length > 64) {
+            str_heap = (gchar*)g_malloc(fi->length * 2 + 1);
+            str = str_heap;
+        }
         /* Print a simple hex dump */
         for (i = 0; i < fi->length; i++) {
             guint8 c = pd[i];
@@ -1955,7 +1969,7 @@ json_write_field_hex_value(write_json_data *pdata, field_info *fi)
         }
         str[2 * fi->length] = '\0';
         json_dumper_value_string(pdata->dumper, str);
-        g_free(str);
+        g_free(str_heap);
     } else {
         json_dumper_value_string(pdata->dumper, "");
     }
@@ -2033,7 +2047,7 @@ static gboolean
 print_hex_data_buffer(print_stream_t *stream, const guchar *cp,
                       guint length, packet_char_enc encoding, guint ascii_option)
 {
-    register unsigned int ad, i, j, k, l;
+    register unsigned int ad, i, j, k, l, n;
     guchar                c;
     gchar                 line[MAX_LINE_LEN + 1];
     unsigned int          use_digits;
@@ -2058,58 +2072,49 @@ print_hex_data_buffer(print_stream_t *stream, const guchar *cp,
     else
         use_digits = 4; /* we'll supply 4 digits */
 
-    ad = 0;
-    i = 0;
-    j = 0;
-    k = 0;
-    while (i < length) {
-        if ((i & 15) == 0) {
-            /*
-             * Start of a new line.
-             */
-            j = 0;
-            l = use_digits;
-            do {
-                l--;
-                c = (ad >> (l*4)) & 0xF;
-                line[j++] = binhex[c];
-            } while (l != 0);
-            line[j++] = ' ';
-            line[j++] = ' ';
-            memset(line+j, ' ', DATA_DUMP_LEN);
+    for (ad = 0; ad < length; ad += n) {
+        /*
+         * Start of a new line.
+         */
+        n = MIN(length - ad, BYTES_PER_LINE);
+
+        j = 0;
+        l = use_digits;
+        do {
+            l--;
+            c = (ad >> (l*4)) & 0xF;
+            line[j++] = binhex[c];
+        } while (l != 0);
+        line[j++] = ' ';
+        line[j++] = ' ';
+        memset(line+j, ' ', DATA_DUMP_LEN);
 
-            /*
-             * Offset in line of ASCII dump.
-             */
-            k = j + HEX_DUMP_LEN + 2;
-            if (ascii_option == HEXDUMP_ASCII_DELIMIT)
-                line[k++] = '|';
-        }
-        c = *cp++;
-        line[j++] = binhex[c>>4];
-        line[j++] = binhex[c&0xf];
-        j++;
-        if (ascii_option != HEXDUMP_ASCII_EXCLUDE ) {
-            if (encoding == PACKET_CHAR_ENC_CHAR_EBCDIC) {
-                c = EBCDIC_to_ASCII1(c);
+        /*
+         * Offset in line of ASCII dump.
+         */
+        k = j + HEX_DUMP_LEN + 2;
+        if (ascii_option == HEXDUMP_ASCII_DELIMIT)
+            line[k++] = '|';
+
+        /* The hex digits of the whole line, separated by blanks */
+        bytes_to_hexstr_punct(line+j, cp, n, ' ');
+
+        if (ascii_option != HEXDUMP_ASCII_EXCLUDE) {
+            for (i = 0; i < n; i++) {
+                c = cp[i];
+                if (encoding == PACKET_CHAR_ENC_CHAR_EBCDIC) {
+                    c = EBCDIC_to_ASCII1(c);
+                }
+                line[k++] = ((c >= ' ') && (c < 0x7f)) ? c : '.';
             }
-            line[k++] = ((c >= ' ') && (c < 0x7f)) ? c : '.';
-        }
-        i++;
-        if (((i & 15) == 0) || (i == length)) {
-            /*
-             * We'll be starting a new line, or
-             * we're finished printing this buffer;
-             * dump out the line we've constructed,
-             * and advance the offset.
-             */
-            if (ascii_option == HEXDUMP_ASCII_DELIMIT)
-                line[k++] = '|';
-            line[k] = '\0';
-            if (!print_line(stream, 0, line))
-                return FALSE;
-            ad += 16;
         }
+        cp += n;
+
+        if (ascii_option == HEXDUMP_ASCII_DELIMIT)
+            line[k++] = '|';
+        line[k] = '\0';
+        if (!print_line(stream, 0, line))
+            return FALSE;
     }
     return TRUE;
 }
@@ -2139,10 +2144,24 @@ void output_fields_free(output_fields_t* fields)
             g_hash_table_destroy(fields->field_indicies);
         }
 
+        g_free(fields->hfid_slots);
+
         if (NULL != fields->field_values) {
+            for (i = 0; i < fields->fields->len; ++i) {
+                if (NULL != fields->field_values[i])
+                    g_ptr_array_free(fields->field_values[i], TRUE);
+            }
             g_free(fields->field_values);
         }
 
+        if (NULL != fields->field_infos) {
+            for (i = 0; i < fields->fields->len; ++i) {
+                if (NULL != fields->field_infos[i])
+                    g_ptr_array_free(fields->field_infos[i], TRUE);
+            }
+            g_free(fields->field_infos);
+        }
+
         for (i = 0; i < fields->fields->len; ++i) {
             gchar* field = (gchar *)g_ptr_array_index(fields->fields,i);
             g_free(field);
@@ -2150,6 +2169,10 @@ void output_fields_free(output_fields_t* fields)
         g_ptr_array_free(fields->fields, TRUE);
     }
 
+    if (NULL != fields->prime_hfids) {
+        g_array_free(fields->prime_hfids, TRUE);
+    }
+
     g_free(fields);
 }
 
@@ -2338,6 +2361,96 @@ gboolean output_fields_has_cols(output_fields_t* fields)
     return fields->includes_col_fields;
 }
 
+void output_fields_set_needed_cols(output_fields_t* fields, column_info *cinfo)
+{
+    gboolean *needed;
+    gsize i;
+    gint col;
+
+    ws_assert(fields);
+
+    needed = g_new0(gboolean, cinfo->num_cols);
+    for (col = 0; col < cinfo->num_cols; col++) {
+        if (!get_column_visible(col))
+            continue;
+        for (i = 0; fields->fields && i < fields->fields->len; i++) {
+            const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+            if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)) &&
+                !strcmp(field + strlen(COLUMN_FIELD_FILTER), cinfo->columns[col].col_title)) {
+                needed[col] = TRUE;
+                break;
+            }
+        }
+    }
+    col_set_needed_columns(cinfo, needed);
+    g_free(needed);
+}
+
+/*
+ * Work out, once, which hfids the requested fields map to. Fields are
+ * extracted from their values, so a tree primed with these hfids is
+ * enough, except for protocols and text items that are printed using
+ * their label.
+ */
+static void
+output_fields_build_plan(output_fields_t* fields)
+{
+    gsize i;
+
+    fields->prime_hfids = g_array_new(FALSE, FALSE, sizeof(int));
+    fields->needs_labels = FALSE;
+
+    if (fields->fields == NULL)
+        return;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+        header_field_info *hfinfo;
+
+        /* Columns come from the column info, not the tree */
+        if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)))
+            continue;
+
+        hfinfo = proto_registrar_get_byname(field);
+        if (!hfinfo) {
+            fields->needs_labels = TRUE;
+            continue;
+        }
+
+        /* Start with the first field registered with this name */
+        while (hfinfo->same_name_prev_id != -1)
+            hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+
+        for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+            if (hfinfo->id == hf_text_only ||
+                (hfinfo->type == FT_PROTOCOL && hfinfo->id != proto_data))
+                fields->needs_labels = TRUE;
+            g_array_append_val(fields->prime_hfids, hfinfo->id);
+        }
+    }
+}
+
+gboolean output_fields_need_visible_tree(output_fields_t* fields)
+{
+    ws_assert(fields);
+
+    if (fields->prime_hfids == NULL)
+        output_fields_build_plan(fields);
+
+    return fields->needs_labels;
+}
+
+void output_fields_prime_edt(output_fields_t* fields, epan_dissect_t *edt)
+{
+    ws_assert(fields);
+
+    if (fields->prime_hfids == NULL)
+        output_fields_build_plan(fields);
+
+    epan_dissect_prime_with_hfid_array(edt, fields->prime_hfids);
+}
+
 void write_fields_preamble(output_fields_t* fields, FILE *fh)
 {
     gsize i;
@@ -2365,7 +2478,7 @@ void write_fields_preamble(output_fields_t* fields, FILE *fh)
     fputc('\n', fh);
 }
 
-static void format_field_values(output_fields_t* fields, gpointer field_index, gchar* value)
+static void format_field_values(output_fields_t* fields, guint field_index, gchar* value)
 {
     guint      indx;
     GPtrArray* fv_p;
@@ -2374,7 +2487,7 @@ static void format_field_values(output_fields_t* fields, gpointer field_index, g
         return;
 
     /* Unwrap change made to disambiguiate zero / null */
-    indx = GPOINTER_TO_UINT(field_index) - 1;
+    indx = field_index - 1;
 
     if (fields->field_values[indx] == NULL) {
         fields->field_values[indx] = g_ptr_array_new();
@@ -2416,9 +2529,10 @@ static void format_field_values(output_fields_t* fields, gpointer field_index, g
             /*
              * This isn't the first occurrence. so add the "aggregator"
              * character as a separator between the previous element
-             * and this element.
+             * and this element. All separators share one string, which
+             * is not freed; they are always at odd indices.
              */
-            g_ptr_array_add(fv_p, (gpointer)ws_strdup_printf("%c", fields->aggregator));
+            g_ptr_array_add(fv_p, (gpointer)fields->aggregator_str);
         }
         break;
     default:
@@ -2429,11 +2543,30 @@ static void format_field_values(output_fields_t* fields, gpointer field_index, g
     g_ptr_array_add(fv_p, (gpointer)value);
 }
 
+/*
+ * Map a field in the tree to the index + 1 of the -e field it is printed
+ * as, or 0 if it wasn't requested.
+ */
+static inline guint output_fields_slot(output_fields_t *fields, header_field_info *hfinfo)
+{
+    if ((guint)hfinfo->id < fields->hfid_slots_len)
+        return fields->hfid_slots[hfinfo->id];
+
+    /*
+     * Every hfid of the names that were known when the indices were
+     * built is in the table; only fall back to the names for fields
+     * that might have been registered since.
+     */
+    if (!fields->has_unresolved)
+        return 0;
+    return GPOINTER_TO_UINT(g_hash_table_lookup(fields->field_indicies, hfinfo->abbrev));
+}
+
 static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
 {
     write_field_data_t *call_data;
     field_info *fi;
-    gpointer    field_index;
+    guint       field_index;
 
     call_data = (write_field_data_t *)data;
     fi = PNODE_FINFO(node);
@@ -2441,8 +2574,8 @@ static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
     /* dissection with an invisible proto tree? */
     ws_assert(fi);
 
-    field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
-    if (NULL != field_index) {
+    field_index = output_fields_slot(call_data->fields, fi->hfinfo);
+    if (0 != field_index) {
         format_field_values(call_data->fields, field_index,
                             get_node_field_value(fi, call_data->edt) /* g_ alloc'd string */
             );
@@ -2455,12 +2588,71 @@ static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
     }
 }
 
+static void output_fields_build_indicies(output_fields_t *fields)
+{
+    gsize i;
+    guint max_hfid = 0;
+    header_field_info *hfinfo;
+
+    if (NULL != fields->field_indicies)
+        return;
+
+    /* Prepare a lookup table from string abbreviation for field to its index. */
+    fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
+
+    i = 0;
+    while (i < fields->fields->len) {
+        gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+        /* Store field indicies +1 so that zero is not a valid value,
+         * and can be distinguished from NULL as a pointer.
+         */
+        ++i;
+        g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
+
+        /* Columns come from the column info, not the tree */
+        if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)))
+            continue;
+
+        hfinfo = proto_registrar_get_byname(field);
+        if (!hfinfo) {
+            fields->has_unresolved = TRUE;
+            continue;
+        }
+        while (hfinfo->same_name_prev_id != -1)
+            hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+        for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+            if ((guint)hfinfo->id > max_hfid)
+                max_hfid = hfinfo->id;
+        }
+    }
+
+    /*
+     * The tree walk looks every node up, so map hfids straight to field
+     * indices rather than hashing the abbreviation of each node. Later
+     * entries win, as with the hash table above.
+     */
+    fields->hfid_slots_len = max_hfid + 1;
+    fields->hfid_slots = g_new0(guint, fields->hfid_slots_len);
+    for (i = 0; i < fields->fields->len; i++) {
+        hfinfo = proto_registrar_get_byname((const gchar *)g_ptr_array_index(fields->fields, i));
+        if (!hfinfo)
+            continue;
+        while (hfinfo->same_name_prev_id != -1)
+            hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+        for (; hfinfo; hfinfo = hfinfo->same_name_next)
+            fields->hfid_slots[hfinfo->id] = (guint)i + 1;
+    }
+
+    fields->aggregator_str[0] = fields->aggregator;
+    fields->aggregator_str[1] = '\0';
+}
+
 static void write_specified_fields(fields_format format, output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh, json_dumper *dumper)
 {
     gsize     i;
     gint      col;
     gchar    *col_name;
-    gpointer  field_index;
+    guint     field_index;
 
     write_field_data_t data;
 
@@ -2477,20 +2669,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
     data.fields = fields;
     data.edt = edt;
 
-    if (NULL == fields->field_indicies) {
-        /* Prepare a lookup table from string abbreviation for field to its index. */
-        fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
-
-        i = 0;
-        while (i < fields->fields->len) {
-            gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
-            /* Store field indicies +1 so that zero is not a valid value,
-             * and can be distinguished from NULL as a pointer.
-             */
-            ++i;
-            g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
-        }
-    }
+    output_fields_build_indicies(fields);
 
     /* Array buffer to store values for this packet              */
     /*  Allocate an array for the 'GPtrarray *' the first time   */
@@ -2511,10 +2690,10 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
                 continue;
             /* Prepend COLUMN_FIELD_FILTER as the field name */
             col_name = ws_strdup_printf("%s%s", COLUMN_FIELD_FILTER, cinfo->columns[col].col_title);
-            field_index = g_hash_table_lookup(fields->field_indicies, col_name);
+            field_index = GPOINTER_TO_UINT(g_hash_table_lookup(fields->field_indicies, col_name));
             g_free(col_name);
 
-            if (NULL != field_index) {
+            if (0 != field_index) {
                 format_field_values(fields, field_index, g_strdup(cinfo->columns[col].col_data));
             }
         }
@@ -2526,7 +2705,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
             if (0 != i) {
                 fputc(fields->separator, fh);
             }
-            if (NULL != fields->field_values[i]) {
+            if (NULL != fields->field_values[i] && g_ptr_array_len(fields->field_values[i]) != 0) {
                 GPtrArray *fv_p;
                 gchar * str;
                 gsize j;
@@ -2539,13 +2718,14 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
                 for (j = 0; j < g_ptr_array_len(fv_p); j++ ) {
                     str = (gchar *)g_ptr_array_index(fv_p, j);
                     print_escaped_csv(fh, str);
-                    g_free(str);
+                    /* Odd entries are the shared aggregator string */
+                    if (j % 2 == 0)
+                        g_free(str);
                 }
                 if (fields->quote != '\0') {
                     fputc(fields->quote, fh);
                 }
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
+                g_ptr_array_set_size(fv_p, 0);  /* get ready for the next packet */
             }
         }
         break;
@@ -2553,7 +2733,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
         for(i = 0; i < fields->fields->len; ++i) {
             gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
 
-            if (NULL != fields->field_values[i]) {
+            if (NULL != fields->field_values[i] && g_ptr_array_len(fields->field_values[i]) != 0) {
                 GPtrArray *fv_p;
                 gchar * str;
                 gsize j;
@@ -2569,8 +2749,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
                     fputs("\"/>\n", fh);
                     g_free(str);
                 }
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
+                g_ptr_array_set_size(fv_p, 0);  /* get ready for the next packet */
             }
         }
         break;
@@ -2579,7 +2758,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
         for(i = 0; i < fields->fields->len; ++i) {
             gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
 
-            if (NULL != fields->field_values[i]) {
+            if (NULL != fields->field_values[i] && g_ptr_array_len(fields->field_values[i]) != 0) {
                 GPtrArray *fv_p;
                 gchar * str;
                 gsize j;
@@ -2597,8 +2776,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
 
                 json_dumper_end_array(dumper);
 
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
+                g_ptr_array_set_size(fv_p, 0);  /* get ready for the next packet */
             }
         }
         json_dumper_end_object(dumper);
@@ -2607,7 +2785,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
         for(i = 0; i < fields->fields->len; ++i) {
             gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
 
-            if (NULL != fields->field_values[i]) {
+            if (NULL != fields->field_values[i] && g_ptr_array_len(fields->field_values[i]) != 0) {
                 GPtrArray *fv_p;
                 gchar * str;
                 gsize j;
@@ -2625,8 +2803,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
 
                 json_dumper_end_array(dumper);
 
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
+                g_ptr_array_set_size(fv_p, 0);  /* get ready for the next packet */
             }
         }
         break;
@@ -2643,6 +2820,202 @@ void write_fields_finale(output_fields_t* fields _U_ , FILE *fh _U_)
     /* Nothing to do */
 }
 
+/*
+ * CBOR output of the -e fields. The output is a CBOR sequence (RFC 8742):
+ * the first item is an array with the field names, every following item is
+ * an array with one entry per field for a packet. The entry is null if the
+ * field is absent, otherwise an array with the values of its occurrences
+ * (subject to the occurrence setting), typed after the field:
+ *
+ *   - integers, including frame numbers and EUI-64: integer
+ *   - booleans: true/false
+ *   - floating point: float
+ *   - absolute and relative times: integer nanoseconds (since the epoch
+ *     for absolute times)
+ *   - IPv4 and IPv6 addresses, Ethernet addresses, byte arrays: byte string
+ *   - anything else, and columns: the text written by -T fields
+ */
+json_dumper write_cbor_fields_preamble(output_fields_t* fields, FILE *fh)
+{
+    json_dumper dumper = {
+        .output_file = fh,
+        .flags = JSON_DUMPER_FLAGS_CBOR
+    };
+    gsize i;
+
+    ws_assert(fields);
+    ws_assert(fields->fields);
+
+    json_dumper_begin_array(&dumper);
+    for (i = 0; i < fields->fields->len; i++) {
+        json_dumper_value_string(&dumper, (const gchar *)g_ptr_array_index(fields->fields, i));
+    }
+    json_dumper_end_array(&dumper);
+    json_dumper_finish(&dumper);
+    return dumper;
+}
+
+static void proto_tree_get_node_field_infos(proto_node *node, gpointer data)
+{
+    output_fields_t *fields = (output_fields_t *)data;
+    field_info *fi;
+    guint       field_index;
+
+    fi = PNODE_FINFO(node);
+
+    /* dissection with an invisible proto tree? */
+    ws_assert(fi);
+
+    field_index = output_fields_slot(fields, fi->hfinfo);
+    if (0 != field_index) {
+        guint      indx = field_index - 1;
+        GPtrArray *fi_p = fields->field_infos[indx];
+
+        if (fi_p == NULL) {
+            fi_p = g_ptr_array_new();
+            fields->field_infos[indx] = fi_p;
+        }
+
+        switch (fields->occurrence) {
+        case 'f':
+            if (g_ptr_array_len(fi_p) == 0)
+                g_ptr_array_add(fi_p, fi);
+            break;
+        case 'l':
+            g_ptr_array_set_size(fi_p, 0);
+            g_ptr_array_add(fi_p, fi);
+            break;
+        default:
+            g_ptr_array_add(fi_p, fi);
+            break;
+        }
+    }
+
+    /* Recurse here. */
+    if (node->first_child != NULL) {
+        proto_tree_children_foreach(node, proto_tree_get_node_field_infos,
+                                    data);
+    }
+}
+
+static void write_cbor_bytes(json_dumper *dumper, const guint8 *data, size_t len)
+{
+    json_dumper_begin_base64(dumper);
+    json_dumper_write_base64(dumper, data, len);
+    json_dumper_end_base64(dumper);
+}
+
+static void write_cbor_field_value(json_dumper *dumper, field_info *fi, epan_dissect_t *edt)
+{
+    ftenum_t        type = fi->hfinfo->type;
+    const nstime_t *t;
+    guint32         ipv4;
+    gchar          *str;
+
+    if (IS_FT_UINT32(type)) {
+        json_dumper_value_anyf(dumper, "%u", fvalue_get_uinteger(&fi->value));
+        return;
+    }
+    if (IS_FT_UINT64(type) || type == FT_EUI64) {
+        json_dumper_value_anyf(dumper, "%" PRIu64, fvalue_get_uinteger64(&fi->value));
+        return;
+    }
+    if (IS_FT_INT32(type)) {
+        json_dumper_value_anyf(dumper, "%d", fvalue_get_sinteger(&fi->value));
+        return;
+    }
+    if (IS_FT_INT64(type)) {
+        json_dumper_value_anyf(dumper, "%" PRId64, fvalue_get_sinteger64(&fi->value));
+        return;
+    }
+
+    switch (type) {
+    case FT_BOOLEAN:
+        json_dumper_value_anyf(dumper, fvalue_get_uinteger64(&fi->value) ? "true" : "false");
+        break;
+    case FT_FLOAT:
+    case FT_DOUBLE:
+        json_dumper_value_double(dumper, fvalue_get_floating(&fi->value));
+        break;
+    case FT_ABSOLUTE_TIME:
+    case FT_RELATIVE_TIME:
+        t = (const nstime_t *)fvalue_get(&fi->value);
+        json_dumper_value_anyf(dumper, "%" PRId64, (gint64)t->secs * 1000000000 + t->nsecs);
+        break;
+    case FT_IPv4:
+        /* fvalue_get_uinteger() returns the address in network byte order */
+        ipv4 = fvalue_get_uinteger(&fi->value);
+        write_cbor_bytes(dumper, (const guint8 *)&ipv4, sizeof(ipv4));
+        break;
+    case FT_IPv6:
+    case FT_ETHER:
+    case FT_BYTES:
+    case FT_UINT_BYTES:
+        write_cbor_bytes(dumper, (const guint8 *)fvalue_get(&fi->value), fvalue_length(&fi->value));
+        break;
+    default:
+        str = get_node_field_value(fi, edt);
+        json_dumper_value_string(dumper, str);
+        g_free(str);
+        break;
+    }
+}
+
+void write_cbor_fields_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, json_dumper *dumper)
+{
+    gsize i;
+    guint j;
+    gint  col;
+
+    ws_assert(fields);
+    ws_assert(fields->fields);
+    ws_assert(edt);
+    ws_assert(dumper);
+
+    output_fields_build_indicies(fields);
+    if (NULL == fields->field_infos)
+        fields->field_infos = g_new0(GPtrArray*, fields->fields->len);  /* free'd in output_fields_free() */
+
+    proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_infos, fields);
+
+    json_dumper_begin_array(dumper);
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+        GPtrArray   *fi_p = fields->field_infos[i];
+
+        if (fi_p != NULL && g_ptr_array_len(fi_p) != 0) {
+            json_dumper_begin_array(dumper);
+            for (j = 0; j < g_ptr_array_len(fi_p); j++) {
+                write_cbor_field_value(dumper, (field_info *)g_ptr_array_index(fi_p, j), edt);
+            }
+            json_dumper_end_array(dumper);
+            /* Keep the array for the next packet */
+            g_ptr_array_set_size(fi_p, 0);
+            continue;
+        }
+
+        if (fields->includes_col_fields && cinfo &&
+            !strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER))) {
+            const gchar *col_title = field + strlen(COLUMN_FIELD_FILTER);
+
+            for (col = 0; col < cinfo->num_cols; col++) {
+                if (get_column_visible(col) && !strcmp(cinfo->columns[col].col_title, col_title))
+                    break;
+            }
+            if (col < cinfo->num_cols) {
+                json_dumper_begin_array(dumper);
+                json_dumper_value_string(dumper, cinfo->columns[col].col_data);
+                json_dumper_end_array(dumper);
+                continue;
+            }
+        }
+
+        json_dumper_value_anyf(dumper, "null");
+    }
+    json_dumper_end_array(dumper);
+    json_dumper_finish(dumper);
+}
+
 /* Returns an g_malloced string */
 gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
 {
@@ -2718,11 +3091,10 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
             }
             break;
         default:
+            /* A NULL scope allocates with g_malloc(), so this is returned as is */
             dfilter_string = fvalue_to_string_repr(NULL, &fi->value, FTREPR_DISPLAY, fi->hfinfo->display);
             if (dfilter_string != NULL) {
-                gchar* ret = g_strdup(dfilter_string);
-                wmem_free(NULL, dfilter_string);
-                return ret;
+                return dfilter_string;
             } else {
                 return get_field_hex_value(edt->pi.data_src, fi);
             }
@@ -2777,9 +3149,15 @@ output_fields_t* output_fields_new(void)
     fields->aggregator          = ',';
     fields->fields              = NULL; /*Do lazy initialisation */
     fields->field_indicies      = NULL;
+    fields->hfid_slots          = NULL;
+    fields->hfid_slots_len      = 0;
+    fields->has_unresolved      = FALSE;
     fields->field_values        = NULL;
+    fields->field_infos         = NULL;
     fields->quote               ='\0';
     fields->includes_col_fields = FALSE;
+    fields->prime_hfids         = NULL;
+    fields->needs_labels        = FALSE;
     return fields;
 }
 
@@ -70,6 +70,17 @@ WS_DLL_PUBLIC gsize output_fields_num_fields(output_fields_t* info);
 WS_DLL_PUBLIC gboolean output_fields_set_option(output_fields_t* info, gchar* option);
 WS_DLL_PUBLIC void output_fields_list_options(FILE *fh);
 WS_DLL_PUBLIC gboolean output_fields_has_cols(output_fields_t* info);
+/** Only fill in the columns that are output as "_ws.col.<title>" fields,
+ * for when nothing else looks at the columns. */
+WS_DLL_PUBLIC void output_fields_set_needed_cols(output_fields_t* info, column_info *cinfo);
+/** TRUE if some of the fields can only be printed from a visible tree,
+ * i.e. they are protocols or text items that are output as their label.
+ * Otherwise the fields can be extracted from a tree that isn't visible
+ * and was primed with output_fields_prime_edt(). */
+WS_DLL_PUBLIC gboolean output_fields_need_visible_tree(output_fields_t* info);
+/** Mark the fields as interesting in the dissection, so they are built
+ * even if the tree isn't visible. */
+WS_DLL_PUBLIC void output_fields_prime_edt(output_fields_t* info, epan_dissect_t *edt);
 
 /*
  * Higher-level packet-printing code.
@@ -147,6 +158,9 @@ WS_DLL_PUBLIC void write_fields_preamble(output_fields_t* fields, FILE *fh);
 WS_DLL_PUBLIC void write_fields_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh);
 WS_DLL_PUBLIC void write_fields_finale(output_fields_t* fields, FILE *fh);
 
+WS_DLL_PUBLIC json_dumper write_cbor_fields_preamble(output_fields_t* fields, FILE *fh);
+WS_DLL_PUBLIC void write_cbor_fields_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, json_dumper *dumper);
+
 WS_DLL_PUBLIC gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt);
 
 extern void print_cache_field_handles(void);
@@ -124,7 +124,7 @@ struct ptvcursor {
 	}								\
 	if (!(PTREE_DATA(tree)->visible)) {				\
 		if (PTREE_FINFO(tree)) {				\
-			if ((hfinfo->ref_type != HF_REF_TYPE_DIRECT)	\
+			if (!tree_data_ref_is_direct(PTREE_DATA(tree), hfindex) \
 			    && (hfinfo->type != FT_PROTOCOL ||		\
 				PTREE_DATA(tree)->fake_protocols)) {	\
 				free_block;				\
@@ -198,6 +198,9 @@ struct ptvcursor {
 
 
 static const char *hf_try_val_to_str(guint32 value, const header_field_info *hfinfo);
+static void hf_strings_index_forget(int hf_id);
+static void hf_strings_index_cleanup(void);
+static header_field_info *hfinfo_same_name_get_prev(const header_field_info *hfinfo);
 static const char *hf_try_val64_to_str(guint64 value, const header_field_info *hfinfo);
 static int hfinfo_bitoffset(const header_field_info *hfinfo);
 static int hfinfo_mask_bitwidth(const header_field_info *hfinfo);
@@ -255,15 +258,15 @@ proto_tree_set_representation(proto_item *pi, const char *format, va_list ap);
 static void
 proto_tree_set_protocol_tvb(field_info *fi, tvbuff_t *tvb, const char* field_data);
 static void
-proto_tree_set_bytes(field_info *fi, const guint8* start_ptr, gint length);
+proto_tree_set_bytes(field_info *fi, wmem_allocator_t *scope, const guint8* start_ptr, gint length);
 static void
-proto_tree_set_bytes_tvb(field_info *fi, tvbuff_t *tvb, gint offset, gint length);
+proto_tree_set_bytes_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint offset, gint length);
 static void
-proto_tree_set_bytes_gbytearray(field_info *fi, const GByteArray *value);
+proto_tree_set_bytes_gbytearray(field_info *fi, wmem_allocator_t *scope, const GByteArray *value);
 static void
 proto_tree_set_time(field_info *fi, const nstime_t *value_ptr);
 static void
-proto_tree_set_string(field_info *fi, const char* value);
+proto_tree_set_string(field_info *fi, wmem_allocator_t *scope, const char* value);
 static void
 proto_tree_set_ax25(field_info *fi, const guint8* value);
 static void
@@ -273,9 +276,9 @@ proto_tree_set_vines(field_info *fi, const guint8* value);
 static void
 proto_tree_set_vines_tvb(field_info *fi, tvbuff_t *tvb, gint start);
 static void
-proto_tree_set_ether(field_info *fi, const guint8* value);
+proto_tree_set_ether(field_info *fi, wmem_allocator_t *scope, const guint8* value);
 static void
-proto_tree_set_ether_tvb(field_info *fi, tvbuff_t *tvb, gint start);
+proto_tree_set_ether_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint start);
 static void
 proto_tree_set_ipxnet(field_info *fi, guint32 value);
 static void
@@ -291,13 +294,13 @@ proto_tree_set_guid(field_info *fi, const e_guid_t *value_ptr);
 static void
 proto_tree_set_guid_tvb(field_info *fi, tvbuff_t *tvb, gint start, const guint encoding);
 static void
-proto_tree_set_oid(field_info *fi, const guint8* value_ptr, gint length);
+proto_tree_set_oid(field_info *fi, wmem_allocator_t *scope, const guint8* value_ptr, gint length);
 static void
-proto_tree_set_oid_tvb(field_info *fi, tvbuff_t *tvb, gint start, gint length);
+proto_tree_set_oid_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint start, gint length);
 static void
-proto_tree_set_system_id(field_info *fi, const guint8* value_ptr, gint length);
+proto_tree_set_system_id(field_info *fi, wmem_allocator_t *scope, const guint8* value_ptr, gint length);
 static void
-proto_tree_set_system_id_tvb(field_info *fi, tvbuff_t *tvb, gint start, gint length);
+proto_tree_set_system_id_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint start, gint length);
 static void
 proto_tree_set_boolean(field_info *fi, guint64 value);
 static void
@@ -356,6 +359,7 @@ struct _protocol {
                                        can be added to a dissector table, but use the
                                        parent_proto_id for things like enable/disable */
 	GList      *heur_list;          /* Heuristic dissectors associated with this protocol */
+	GSList     *deferred_fields;    /* field arrays not registered until first needed */
 };
 
 /* List of all protocols */
@@ -375,10 +379,48 @@ static GPtrArray *deregistered_slice = NULL;
 /* indexed by prefix, contains initializers */
 static GHashTable* prefixes = NULL;
 
+/* Bumped every time a field is newly primed, see proto_get_prime_serial() */
+static guint prime_serial = 0;
+
+#define REF_BIT_IS_SET(bits, words, hfid) \
+	((bits) != NULL && (guint)(hfid) / 32 < (words) && \
+	 ((bits)[(guint)(hfid) / 32] & (1U << ((guint)(hfid) % 32))))
+
+static inline gboolean
+tree_data_ref_is_direct(const tree_data_t *tree_data, int hfid)
+{
+	return REF_BIT_IS_SET(tree_data->ref_direct, tree_data->ref_words, hfid);
+}
+
+/* A field array handed to proto_register_field_array_deferred(), or a
+ * routine handed to proto_register_deferred_routine() */
+typedef struct {
+	int               parent;
+	hf_register_info *hf;
+	int               num_records;
+	void            (*routine)(void *data);
+	void             *routine_data;
+} deferred_field_array_t;
+
+/* Protocols that still have deferred field arrays */
+static GSList *deferred_protocols = NULL;
+
+/* An item's proto_node and its field_info are allocated as one chunk.
+ * The pinfo pool hands out memory sequentially, so the items of a packet,
+ * added (mostly) in preorder, end up packed one after the other, and a
+ * tree walk touches one contiguous region instead of hopping between
+ * separately allocated nodes and field_infos. */
+typedef struct {
+	proto_node node;
+	field_info finfo;
+} proto_item_chunk_t;
+
+#define ITEM_CHUNK_FROM_FINFO(fi) \
+	((proto_item_chunk_t *)(void *)((char *)(fi) - offsetof(proto_item_chunk_t, finfo)))
+
 /* Contains information about a field when a dissector calls
- * proto_tree_add_item.  */
-#define FIELD_INFO_NEW(pool, fi)  fi = wmem_new(pool, field_info)
-#define FIELD_INFO_FREE(pool, fi) wmem_free(pool, fi)
+ * proto_tree_add_item.  The proto_node that will hold it comes along. */
+#define FIELD_INFO_NEW(pool, fi)  fi = &(wmem_new(pool, proto_item_chunk_t)->finfo)
 
 /* Contains the space for proto_nodes. */
 #define PROTO_NODE_INIT(node)			\
@@ -420,11 +462,30 @@ static GHashTable *gpa_protocol_aliases = NULL;
 
 /*
  * We're called repeatedly with the same field name when sorting a column.
- * Cache our last gpa_name_map hit for faster lookups.
+ * Cache our last gpa_name_map hit for faster lookups. This points to the
+ * abbreviation of the hfinfo, so it must be forgotten whenever a field is
+ * deregistered.
  */
-static char *last_field_name = NULL;
+static const char *last_field_name = NULL;
 static header_field_info *last_hfinfo;
 
+/*
+ * Every registered abbreviation, sorted ignoring ASCII case, for prefix
+ * lookups. Built on first use and thrown away whenever a field is
+ * registered or deregistered.
+ */
+static header_field_info **abbrev_index = NULL;
+static guint abbrev_index_len;
+
+static void
+forget_field_names(void)
+{
+	last_field_name = NULL;
+	g_free(abbrev_index);
+	abbrev_index = NULL;
+	abbrev_index_len = 0;
+}
+
 static void save_same_name_hfinfo(gpointer data)
 {
 	same_name_hfinfo = (header_field_info*)data;
@@ -609,8 +670,7 @@ proto_cleanup_base(void)
 		g_hash_table_destroy(gpa_protocol_aliases);
 		gpa_protocol_aliases = NULL;
 	}
-	g_free(last_field_name);
-	last_field_name = NULL;
+	forget_field_names();
 
 	while (protocols) {
 		protocol = (protocol_t *)protocols->data;
@@ -628,10 +688,14 @@ proto_cleanup_base(void)
 			}
 			g_list_free(protocol->heur_list);
 		}
+		g_slist_free_full(protocol->deferred_fields, g_free);
 		protocols = g_list_remove(protocols, protocol);
 		g_free(protocol);
 	}
 
+	g_slist_free(deferred_protocols);
+	deferred_protocols = NULL;
+
 	if (proto_names) {
 		g_hash_table_destroy(proto_names);
 		proto_names = NULL;
@@ -652,6 +716,8 @@ proto_cleanup_base(void)
 		proto_reserved_filter_names = NULL;
 	}
 
+	hf_strings_index_cleanup();
+
 	if (gpa_hfinfo.allocated_len) {
 		gpa_hfinfo.len           = 0;
 		gpa_hfinfo.allocated_len = 0;
@@ -763,27 +829,18 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+free_GPtrArray_value(gpointer key _U_, gpointer value, gpointer user_data _U_)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	gint               hfid = GPOINTER_TO_UINT(key);
-	header_field_info *hfinfo;
-
-	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
-	if (hfinfo->ref_type != HF_REF_TYPE_NONE) {
-		/* when a field is referenced by a filter this also
-		   affects the refcount for the parent protocol so we need
-		   to adjust the refcount for the parent as well
-		*/
-		if (hfinfo->parent != -1) {
-			header_field_info *parent_hfinfo;
-			PROTO_REGISTRAR_GET_NTH(hfinfo->parent, parent_hfinfo);
-			parent_hfinfo->ref_type = HF_REF_TYPE_NONE;
-		}
-		hfinfo->ref_type = HF_REF_TYPE_NONE;
-	}
+	g_ptr_array_free((GPtrArray *)value, TRUE);
+}
 
-	g_ptr_array_free(ptrs, TRUE);
+/* Empty a GPtrArray in the interesting_hfids hash but keep it, and its
+ * hash entry, around for the next packet; a filter that's applied to
+ * every packet will usually want the same fields again. */
+static void
+truncate_GPtrArray_value(gpointer key _U_, gpointer value, gpointer user_data _U_)
+{
+	g_ptr_array_set_size((GPtrArray *)value, 0);
 }
 
 static void
@@ -803,14 +860,12 @@ proto_tree_reset(proto_tree *tree)
 
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
-	/* free tree data */
+	/* reset tree data */
 	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
+		/* Empty all the GPtrArray's in the interesting_hfids hash,
+		 * keeping them allocated for the next packet. */
 		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then remove all values. */
-		g_hash_table_remove_all(tree_data->interesting_hfids);
+			truncate_GPtrArray_value, NULL);
 	}
 
 	/* Reset track of the number of children */
@@ -837,6 +892,9 @@ proto_tree_free(proto_tree *tree)
 		g_hash_table_destroy(tree_data->interesting_hfids);
 	}
 
+	g_free(tree_data->ref_direct);
+	g_free(tree_data->ref_any);
+
 	g_slice_free(tree_data_t, tree_data);
 
 	g_slice_free(proto_tree, tree);
@@ -882,7 +940,7 @@ proto_field_is_referenced(proto_tree *tree, int proto_id)
 		return TRUE;
 
 	PROTO_REGISTRAR_GET_NTH(proto_id, hfinfo);
-	if (hfinfo->ref_type != HF_REF_TYPE_NONE)
+	if (REF_BIT_IS_SET(PTREE_DATA(tree)->ref_any, PTREE_DATA(tree)->ref_words, proto_id))
 		return TRUE;
 
 	if (hfinfo->type == FT_PROTOCOL && !PTREE_DATA(tree)->fake_protocols)
@@ -967,10 +1025,65 @@ initialize_prefix(gpointer k, gpointer v, gpointer u _U_) {
 	return TRUE;
 }
 
+/* Register the deferred field arrays of a protocol and run its deferred
+ * routines, in registration order */
+static void
+register_deferred_fields(protocol_t *protocol)
+{
+	GSList *arrays = g_slist_reverse(protocol->deferred_fields);
+	GSList *item;
+
+	protocol->deferred_fields = NULL;
+	deferred_protocols = g_slist_remove(deferred_protocols, protocol);
+
+	for (item = arrays; item != NULL; item = item->next) {
+		deferred_field_array_t *deferred = (deferred_field_array_t *)item->data;
+
+		if (deferred->routine)
+			deferred->routine(deferred->routine_data);
+		else
+			proto_register_field_array(deferred->parent, deferred->hf, deferred->num_records);
+	}
+	g_slist_free_full(arrays, g_free);
+}
+
+/* Register the deferred fields of every protocol whose filter name is
+ * field_name or a dotted prefix of it; returns TRUE if there were any. */
+static gboolean
+register_deferred_fields_byname(const char *field_name)
+{
+	GSList  *item, *next;
+	gboolean found = FALSE;
+
+	for (item = deferred_protocols; item != NULL; item = next) {
+		protocol_t *protocol = (protocol_t *)item->data;
+		size_t      len = strlen(protocol->filter_name);
+
+		next = item->next;
+		if (strncmp(protocol->filter_name, field_name, len) == 0 &&
+		    (field_name[len] == '.' || field_name[len] == '\0')) {
+			register_deferred_fields(protocol);
+			found = TRUE;
+		}
+	}
+	return found;
+}
+
+void
+proto_register_deferred_fields(protocol_t *protocol)
+{
+	if (protocol->deferred_fields != NULL)
+		register_deferred_fields(protocol);
+}
+
 /** Initialize every remaining uninitialized prefix. */
 void
 proto_initialize_all_prefixes(void) {
-	g_hash_table_foreach_remove(prefixes, initialize_prefix, NULL);
+	while (deferred_protocols != NULL)
+		register_deferred_fields((protocol_t *)deferred_protocols->data);
+
+	if (prefixes)
+		g_hash_table_foreach_remove(prefixes, initialize_prefix, NULL);
 }
 
 /* Finds a record in the hfinfo array by name.
@@ -995,16 +1108,15 @@ proto_registrar_get_byname(const char *field_name)
 	hfinfo = (header_field_info *)g_hash_table_lookup(gpa_name_map, field_name);
 
 	if (hfinfo) {
-		g_free(last_field_name);
-		last_field_name = g_strdup(field_name);
+		last_field_name = hfinfo->abbrev;
 		last_hfinfo = hfinfo;
 		return hfinfo;
 	}
 
-	if (!prefixes)
-		return NULL;
-
-	if ((pi = (prefix_initializer_t)g_hash_table_lookup(prefixes, field_name) ) != NULL) {
+	if (deferred_protocols && register_deferred_fields_byname(field_name)) {
+		/* Look again below */
+	} else if (prefixes &&
+	    (pi = (prefix_initializer_t)g_hash_table_lookup(prefixes, field_name) ) != NULL) {
 		pi(field_name);
 		g_hash_table_remove(prefixes, field_name);
 	} else {
@@ -1014,8 +1126,7 @@ proto_registrar_get_byname(const char *field_name)
 	hfinfo = (header_field_info *)g_hash_table_lookup(gpa_name_map, field_name);
 
 	if (hfinfo) {
-		g_free(last_field_name);
-		last_field_name = g_strdup(field_name);
+		last_field_name = hfinfo->abbrev;
 		last_hfinfo = hfinfo;
 	}
 	return hfinfo;
@@ -1052,6 +1163,82 @@ proto_registrar_get_byalias(const char *alias_name)
 	return hfinfo;
 }
 
+static gint
+abbrev_index_compare(gconstpointer a, gconstpointer b)
+{
+	const header_field_info *hfinfo_a = *(const header_field_info * const *)a;
+	const header_field_info *hfinfo_b = *(const header_field_info * const *)b;
+	gint ret;
+
+	ret = g_ascii_strcasecmp(hfinfo_a->abbrev, hfinfo_b->abbrev);
+	if (ret == 0)
+		ret = strcmp(hfinfo_a->abbrev, hfinfo_b->abbrev);
+	return ret;
+}
+
+static void
+abbrev_index_build(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	header_field_info *hfinfo;
+	guint i = 0;
+
+	/* Fields that haven't been registered yet can't be found by prefix */
+	proto_initialize_all_prefixes();
+
+	abbrev_index_len = g_hash_table_size(gpa_name_map);
+	abbrev_index = g_new(header_field_info *, abbrev_index_len + 1);
+	g_hash_table_iter_init(&iter, gpa_name_map);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		/* The map has the latest hfinfo with a given name, use the first */
+		hfinfo = (header_field_info *)value;
+		while (hfinfo->same_name_prev_id != -1)
+			hfinfo = hfinfo_same_name_get_prev(hfinfo);
+		abbrev_index[i++] = hfinfo;
+	}
+	abbrev_index[i] = NULL;
+	qsort(abbrev_index, abbrev_index_len, sizeof(header_field_info *), abbrev_index_compare);
+}
+
+header_field_info * const *
+proto_registrar_get_byprefix(const char *prefix, guint *count)
+{
+	size_t prefix_len;
+	guint low, high, mid, first;
+
+	*count = 0;
+	if (!prefix)
+		return NULL;
+
+	if (!abbrev_index)
+		abbrev_index_build();
+
+	/* Matches are contiguous in the index: find the first and the last */
+	prefix_len = strlen(prefix);
+	low = 0;
+	high = abbrev_index_len;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (g_ascii_strncasecmp(abbrev_index[mid]->abbrev, prefix, prefix_len) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	first = low;
+	high = abbrev_index_len;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (g_ascii_strncasecmp(abbrev_index[mid]->abbrev, prefix, prefix_len) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	*count = low - first;
+	return &abbrev_index[first];
+}
+
 int
 proto_registrar_get_id_byname(const char *field_name)
 {
@@ -2483,7 +2670,7 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 {
 	const header_field_info *hfinfo = fi->hfinfo;
 
-	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
+	if (tree_data_ref_is_direct(tree_data, hfinfo->id)) {
 		GPtrArray *ptrs = NULL;
 
 		if (tree_data->interesting_hfids == NULL) {
@@ -2588,12 +2775,12 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 			break;
 
 		case FT_BYTES:
-			proto_tree_set_bytes_tvb(new_fi, tvb, start, length);
+			proto_tree_set_bytes_tvb(new_fi, PNODE_POOL(tree), tvb, start, length);
 			break;
 
 		case FT_UINT_BYTES:
 			n = get_uint_value(tree, tvb, start, length, encoding);
-			proto_tree_set_bytes_tvb(new_fi, tvb, start + length, n);
+			proto_tree_set_bytes_tvb(new_fi, PNODE_POOL(tree), tvb, start + length, n);
 
 			/* Instead of calling proto_item_set_len(), since we don't yet
 			 * have a proto_item, we set the field_info's length ourselves. */
@@ -2758,7 +2945,7 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 				length_error = length < FT_ETHER_LEN ? TRUE : FALSE;
 				report_type_length_mismatch(tree, "a MAC address", length, length_error);
 			}
-			proto_tree_set_ether_tvb(new_fi, tvb, start);
+			proto_tree_set_ether_tvb(new_fi, PNODE_POOL(tree), tvb, start);
 			break;
 
 		case FT_EUI64:
@@ -2790,11 +2977,11 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 
 		case FT_OID:
 		case FT_REL_OID:
-			proto_tree_set_oid_tvb(new_fi, tvb, start, length);
+			proto_tree_set_oid_tvb(new_fi, PNODE_POOL(tree), tvb, start, length);
 			break;
 
 		case FT_SYSTEM_ID:
-			proto_tree_set_system_id_tvb(new_fi, tvb, start, length);
+			proto_tree_set_system_id_tvb(new_fi, PNODE_POOL(tree), tvb, start, length);
 			break;
 
 		case FT_FLOAT:
@@ -2854,7 +3041,8 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 		case FT_STRING:
 			stringval = get_string_value(PNODE_POOL(tree),
 			    tvb, start, length, &length, encoding);
-			proto_tree_set_string(new_fi, stringval);
+			/* stringval is already in the tree's scope */
+			fvalue_set_string_borrowed(&new_fi->value, stringval);
 
 			/* Instead of calling proto_item_set_len(), since we
 			 * don't yet have a proto_item, we set the
@@ -2871,7 +3059,8 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 		case FT_STRINGZ:
 			stringval = get_stringz_value(PNODE_POOL(tree),
 			    tree, tvb, start, length, &length, encoding);
-			proto_tree_set_string(new_fi, stringval);
+			/* stringval is already in the tree's scope */
+			fvalue_set_string_borrowed(&new_fi->value, stringval);
 
 			/* Instead of calling proto_item_set_len(),
 			 * since we don't yet have a proto_item, we
@@ -2902,7 +3091,8 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 				encoding = ENC_ASCII|ENC_LITTLE_ENDIAN;
 			stringval = get_uint_string_value(PNODE_POOL(tree),
 			    tree, tvb, start, length, &length, encoding);
-			proto_tree_set_string(new_fi, stringval);
+			/* stringval is already in the tree's scope */
+			fvalue_set_string_borrowed(&new_fi->value, stringval);
 
 			/* Instead of calling proto_item_set_len(), since we
 			 * don't yet have a proto_item, we set the
@@ -2919,7 +3109,8 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 		case FT_STRINGZPAD:
 			stringval = get_stringzpad_value(PNODE_POOL(tree),
 			    tvb, start, length, &length, encoding);
-			proto_tree_set_string(new_fi, stringval);
+			/* stringval is already in the tree's scope */
+			fvalue_set_string_borrowed(&new_fi->value, stringval);
 
 			/* Instead of calling proto_item_set_len(), since we
 			 * don't yet have a proto_item, we set the
@@ -2936,7 +3127,8 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 		case FT_STRINGZTRUNC:
 			stringval = get_stringztrunc_value(PNODE_POOL(tree),
 			    tvb, start, length, &length, encoding);
-			proto_tree_set_string(new_fi, stringval);
+			/* stringval is already in the tree's scope */
+			fvalue_set_string_borrowed(&new_fi->value, stringval);
 
 			/* Instead of calling proto_item_set_len(), since we
 			 * don't yet have a proto_item, we set the
@@ -3725,7 +3917,7 @@ proto_tree_add_item_ret_string_and_length(proto_tree *tree, int hfindex,
 
 	new_fi = new_field_info(tree, hfinfo, tvb, start, *lenretval);
 
-	proto_tree_set_string(new_fi, value);
+	proto_tree_set_string(new_fi, PNODE_POOL(tree), value);
 
 	new_fi->flags |= (encoding & ENC_LITTLE_ENDIAN) ? FI_LITTLE_ENDIAN : FI_BIG_ENDIAN;
 
@@ -3827,15 +4019,15 @@ proto_tree_add_item_ret_display_string_and_length(proto_tree *tree, int hfindex,
 	case FT_UINT_STRING:
 	case FT_STRINGZPAD:
 	case FT_STRINGZTRUNC:
-		proto_tree_set_string(new_fi, value);
+		proto_tree_set_string(new_fi, PNODE_POOL(tree), value);
 		break;
 
 	case FT_BYTES:
-		proto_tree_set_bytes(new_fi, value, length);
+		proto_tree_set_bytes(new_fi, PNODE_POOL(tree), value, length);
 		break;
 
 	case FT_UINT_BYTES:
-		proto_tree_set_bytes(new_fi, value, n);
+		proto_tree_set_bytes(new_fi, PNODE_POOL(tree), value, n);
 		break;
 
 	default:
@@ -4164,16 +4356,16 @@ proto_tree_add_bytes_item(proto_tree *tree, int hfindex, tvbuff_t *tvb,
 		    expert_add_info(NULL, tree, &ei_number_string_decoding_failed_error);
 
 		if (bytes)
-		    proto_tree_set_bytes_gbytearray(new_fi, bytes);
+		    proto_tree_set_bytes_gbytearray(new_fi, PNODE_POOL(tree), bytes);
 		else
-		    proto_tree_set_bytes(new_fi, NULL, 0);
+		    proto_tree_set_bytes(new_fi, PNODE_POOL(tree), NULL, 0);
 
 		if (created_bytes)
 		    g_byte_array_free(created_bytes, TRUE);
 	}
 	else {
 		/* n will be zero except when it's a FT_UINT_BYTES */
-		proto_tree_set_bytes_tvb(new_fi, tvb, start + n, length);
+		proto_tree_set_bytes_tvb(new_fi, PNODE_POOL(tree), tvb, start + n, length);
 
 		FI_SET_FLAG(new_fi,
 			(encoding & ENC_LITTLE_ENDIAN) ? FI_LITTLE_ENDIAN : FI_BIG_ENDIAN);
@@ -4369,7 +4561,7 @@ proto_tree_add_bytes(proto_tree *tree, int hfindex, tvbuff_t *tvb, gint start,
 	DISSECTOR_ASSERT_FIELD_TYPE(hfinfo, FT_BYTES);
 
 	pi = proto_tree_add_pi(tree, hfinfo, tvb, start, &length);
-	proto_tree_set_bytes(PNODE_FINFO(pi), start_ptr, length);
+	proto_tree_set_bytes(PNODE_FINFO(pi), PNODE_POOL(pi), start_ptr, length);
 
 	return pi;
 }
@@ -4394,7 +4586,7 @@ proto_tree_add_bytes_with_length(proto_tree *tree, int hfindex, tvbuff_t *tvb, g
 	DISSECTOR_ASSERT_FIELD_TYPE(hfinfo, FT_BYTES);
 
 	pi = proto_tree_add_pi(tree, hfinfo, tvb, start, &tvbuff_length);
-	proto_tree_set_bytes(PNODE_FINFO(pi), start_ptr, ptr_length);
+	proto_tree_set_bytes(PNODE_FINFO(pi), PNODE_POOL(pi), start_ptr, ptr_length);
 
 	return pi;
 }
@@ -4445,36 +4637,26 @@ proto_tree_add_bytes_format(proto_tree *tree, int hfindex, tvbuff_t *tvb,
 }
 
 static void
-proto_tree_set_bytes(field_info *fi, const guint8* start_ptr, gint length)
+proto_tree_set_bytes(field_info *fi, wmem_allocator_t *scope, const guint8* start_ptr, gint length)
 {
-	GByteArray *bytes;
-
 	DISSECTOR_ASSERT(start_ptr != NULL || length == 0);
 
-	bytes = g_byte_array_new();
-	if (length > 0) {
-		g_byte_array_append(bytes, start_ptr, length);
-	}
-	fvalue_set_byte_array(&fi->value, bytes);
+	fvalue_set_bytes_data_scoped(&fi->value, scope, start_ptr, length > 0 ? length : 0);
 }
 
 
 static void
-proto_tree_set_bytes_tvb(field_info *fi, tvbuff_t *tvb, gint offset, gint length)
+proto_tree_set_bytes_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint offset, gint length)
 {
-	proto_tree_set_bytes(fi, tvb_get_ptr(tvb, offset, length), length);
+	proto_tree_set_bytes(fi, scope, tvb_get_ptr(tvb, offset, length), length);
 }
 
 static void
-proto_tree_set_bytes_gbytearray(field_info *fi, const GByteArray *value)
+proto_tree_set_bytes_gbytearray(field_info *fi, wmem_allocator_t *scope, const GByteArray *value)
 {
-	GByteArray *bytes;
-
 	DISSECTOR_ASSERT(value != NULL);
 
-	bytes = byte_array_dup(value);
-
-	fvalue_set_byte_array(&fi->value, bytes);
+	fvalue_set_bytes_data_scoped(&fi->value, scope, value->data, value->len);
 }
 
 /* Add a FT_*TIME to a proto_tree */
@@ -4854,7 +5036,7 @@ proto_tree_add_oid(proto_tree *tree, int hfindex, tvbuff_t *tvb, gint start,
 	DISSECTOR_ASSERT_FIELD_TYPE(hfinfo, FT_OID);
 
 	pi = proto_tree_add_pi(tree, hfinfo, tvb, start, &length);
-	proto_tree_set_oid(PNODE_FINFO(pi), value_ptr, length);
+	proto_tree_set_oid(PNODE_FINFO(pi), PNODE_POOL(pi), value_ptr, length);
 
 	return pi;
 }
@@ -4900,44 +5082,32 @@ proto_tree_add_oid_format(proto_tree *tree, int hfindex, tvbuff_t *tvb,
 
 /* Set the FT_OID value */
 static void
-proto_tree_set_oid(field_info *fi, const guint8* value_ptr, gint length)
+proto_tree_set_oid(field_info *fi, wmem_allocator_t *scope, const guint8* value_ptr, gint length)
 {
-	GByteArray *bytes;
-
 	DISSECTOR_ASSERT(value_ptr != NULL || length == 0);
 
-	bytes = g_byte_array_new();
-	if (length > 0) {
-		g_byte_array_append(bytes, value_ptr, length);
-	}
-	fvalue_set_byte_array(&fi->value, bytes);
+	fvalue_set_bytes_data_scoped(&fi->value, scope, value_ptr, length > 0 ? length : 0);
 }
 
 static void
-proto_tree_set_oid_tvb(field_info *fi, tvbuff_t *tvb, gint start, gint length)
+proto_tree_set_oid_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint start, gint length)
 {
-	proto_tree_set_oid(fi, tvb_get_ptr(tvb, start, length), length);
+	proto_tree_set_oid(fi, scope, tvb_get_ptr(tvb, start, length), length);
 }
 
 /* Set the FT_SYSTEM_ID value */
 static void
-proto_tree_set_system_id(field_info *fi, const guint8* value_ptr, gint length)
+proto_tree_set_system_id(field_info *fi, wmem_allocator_t *scope, const guint8* value_ptr, gint length)
 {
-	GByteArray *bytes;
-
 	DISSECTOR_ASSERT(value_ptr != NULL || length == 0);
 
-	bytes = g_byte_array_new();
-	if (length > 0) {
-		g_byte_array_append(bytes, value_ptr, length);
-	}
-	fvalue_set_byte_array(&fi->value, bytes);
+	fvalue_set_bytes_data_scoped(&fi->value, scope, value_ptr, length > 0 ? length : 0);
 }
 
 static void
-proto_tree_set_system_id_tvb(field_info *fi, tvbuff_t *tvb, gint start, gint length)
+proto_tree_set_system_id_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint start, gint length)
 {
-	proto_tree_set_system_id(fi, tvb_get_ptr(tvb, start, length), length);
+	proto_tree_set_system_id(fi, scope, tvb_get_ptr(tvb, start, length), length);
 }
 
 /* Add a FT_STRING, FT_STRINGZ, FT_STRINGZPAD, or FT_STRINGZTRUNC to a
@@ -4970,7 +5140,7 @@ proto_tree_add_string(proto_tree *tree, int hfindex, tvbuff_t *tvb, gint start,
 
 	pi = proto_tree_add_pi(tree, hfinfo, tvb, start, &length);
 	DISSECTOR_ASSERT(length >= 0);
-	proto_tree_set_string(PNODE_FINFO(pi), value);
+	proto_tree_set_string(PNODE_FINFO(pi), PNODE_POOL(pi), value);
 
 	return pi;
 }
@@ -5016,16 +5186,16 @@ proto_tree_add_string_format(proto_tree *tree, int hfindex, tvbuff_t *tvb,
 
 /* Set the FT_STRING value */
 static void
-proto_tree_set_string(field_info *fi, const char* value)
+proto_tree_set_string(field_info *fi, wmem_allocator_t *scope, const char* value)
 {
 	if (value) {
-		fvalue_set_string(&fi->value, value);
+		fvalue_set_string_scoped(&fi->value, scope, value);
 	} else {
 		/*
 		 * XXX - why is a null value for a string field
 		 * considered valid?
 		 */
-		fvalue_set_string(&fi->value, "[ Null ]");
+		fvalue_set_string_scoped(&fi->value, scope, "[ Null ]");
 	}
 }
 
@@ -5070,7 +5240,7 @@ proto_tree_add_ether(proto_tree *tree, int hfindex, tvbuff_t *tvb, gint start,
 	DISSECTOR_ASSERT_FIELD_TYPE(hfinfo, FT_ETHER);
 
 	pi = proto_tree_add_pi(tree, hfinfo, tvb, start, &length);
-	proto_tree_set_ether(PNODE_FINFO(pi), value);
+	proto_tree_set_ether(PNODE_FINFO(pi), PNODE_POOL(pi), value);
 
 	return pi;
 }
@@ -5115,15 +5285,15 @@ proto_tree_add_ether_format(proto_tree *tree, int hfindex, tvbuff_t *tvb,
 
 /* Set the FT_ETHER value */
 static void
-proto_tree_set_ether(field_info *fi, const guint8* value)
+proto_tree_set_ether(field_info *fi, wmem_allocator_t *scope, const guint8* value)
 {
-	fvalue_set_bytes(&fi->value, value);
+	fvalue_set_bytes_data_scoped(&fi->value, scope, value, FT_ETHER_LEN);
 }
 
 static void
-proto_tree_set_ether_tvb(field_info *fi, tvbuff_t *tvb, gint start)
+proto_tree_set_ether_tvb(field_info *fi, wmem_allocator_t *scope, tvbuff_t *tvb, gint start)
 {
-	proto_tree_set_ether(fi, tvb_get_ptr(tvb, start, FT_ETHER_LEN));
+	proto_tree_set_ether(fi, scope, tvb_get_ptr(tvb, start, FT_ETHER_LEN));
 }
 
 /* Add a FT_BOOLEAN to a proto_tree */
@@ -5928,7 +6098,8 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 		/* XXX - is it safe to continue here? */
 	}
 
-	pnode = wmem_new(PNODE_POOL(tree), proto_node);
+	/* new_field_info() allocated the node along with fi */
+	pnode = &ITEM_CHUNK_FROM_FINFO(fi)->node;
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = tnode;
 	PNODE_FINFO(pnode) = fi;
@@ -6286,6 +6457,23 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	return fi;
 }
 
+/*
+ * Format a label into label_str. Labels have to be formatted when the
+ * item is added: the arguments may point into buffers that don't outlive
+ * the call, so the va_list can't be kept for later. What we can do is
+ * avoid going through vsnprintf() for the common plain "%s" format.
+ */
+static int
+label_vformat(char *label_str, gsize size, const char *format, va_list ap)
+{
+	if (format[0] == '%' && format[1] == 's' && format[2] == '\0') {
+		const char *str = va_arg(ap, const char *);
+
+		return (int) g_strlcpy(label_str, str ? str : "(null)", size);
+	}
+	return vsnprintf(label_str, size, format, ap);
+}
+
 /* If the protocol tree is to be visible, set the representation of a
    proto_tree entry with the name of the field for the item and with
    the value formatted with the supplied printf-style format and
@@ -6327,7 +6515,7 @@ proto_tree_set_representation_value(proto_item *pi, const char *format, va_list
 
 		/* If possible, Put in the value of the string */
 		if (ret < ITEM_LABEL_LENGTH) {
-			ret += vsnprintf(fi->rep->representation + ret,
+			ret += label_vformat(fi->rep->representation + ret,
 					  ITEM_LABEL_LENGTH - ret, format, ap);
 		}
 		if (ret >= ITEM_LABEL_LENGTH) {
@@ -6352,7 +6540,7 @@ proto_tree_set_representation(proto_item *pi, const char *format, va_list ap)
 
 	if (!proto_item_is_hidden(pi)) {
 		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-		ret = vsnprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
+		ret = label_vformat(fi->rep->representation, ITEM_LABEL_LENGTH,
 				  format, ap);
 		if (ret >= ITEM_LABEL_LENGTH) {
 			/* Uh oh, we don't have enough room.  Tell the user
@@ -6387,8 +6575,7 @@ hfinfo_same_name_get_prev(const header_field_info *hfinfo)
 static void
 hfinfo_remove_from_gpa_name_map(const header_field_info *hfinfo)
 {
-	g_free(last_field_name);
-	last_field_name = NULL;
+	forget_field_names();
 
 	if (!hfinfo->same_name_next && hfinfo->same_name_prev_id == -1) {
 		/* No hfinfo with the same name */
@@ -7182,6 +7369,11 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
+	/* Nothing is referenced until the tree is primed */
+	pnode->tree_data->ref_direct = NULL;
+	pnode->tree_data->ref_any = NULL;
+	pnode->tree_data->ref_words = 0;
+
 	return (proto_tree *)pnode;
 }
 
@@ -7189,29 +7381,67 @@ proto_tree_create_root(packet_info *pinfo)
 /* "prime" a proto_tree with a single hfid that a dfilter
  * is interested in. */
 void
-proto_tree_prime_with_hfid(proto_tree *tree _U_, const gint hfid)
+proto_tree_prime_with_hfid(proto_tree *tree, const gint hfid)
 {
 	header_field_info *hfinfo;
+	tree_data_t       *tree_data;
+	guint              words;
+
+	if (!tree)
+		return;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
-	/* this field is referenced by a filter so increase the refcount.
-	   also increase the refcount for the parent, i.e the protocol.
-	*/
-	hfinfo->ref_type = HF_REF_TYPE_DIRECT;
-	/* only increase the refcount if there is a parent.
-	   if this is a protocol and not a field then parent will be -1
-	   and there is no parent to add any refcounting for.
-	*/
-	if (hfinfo->parent != -1) {
-		header_field_info *parent_hfinfo;
-		PROTO_REGISTRAR_GET_NTH(hfinfo->parent, parent_hfinfo);
+	tree_data = PTREE_DATA(tree);
 
-		/* Mark parent as indirectly referenced unless it is already directly
-		 * referenced, i.e. the user has specified the parent in a filter.
-		 */
-		if (parent_hfinfo->ref_type != HF_REF_TYPE_DIRECT)
-			parent_hfinfo->ref_type = HF_REF_TYPE_INDIRECT;
+	/* Primed for an earlier packet; nothing to do. */
+	if (tree_data_ref_is_direct(tree_data, hfid))
+		return;
+
+	/* The bitsets only cover the highest hfid primed so far */
+	words = (MAX(hfid, hfinfo->parent) / 32) + 1;
+	if (words > tree_data->ref_words) {
+		tree_data->ref_direct = (guint32 *)g_realloc(tree_data->ref_direct, words * sizeof(guint32));
+		tree_data->ref_any = (guint32 *)g_realloc(tree_data->ref_any, words * sizeof(guint32));
+		memset(tree_data->ref_direct + tree_data->ref_words, 0,
+		    (words - tree_data->ref_words) * sizeof(guint32));
+		memset(tree_data->ref_any + tree_data->ref_words, 0,
+		    (words - tree_data->ref_words) * sizeof(guint32));
+		tree_data->ref_words = words;
 	}
+
+	prime_serial++;
+
+	/* this field is referenced by a filter, and so is its parent,
+	   i.e the protocol. if this is a protocol and not a field then
+	   parent will be -1 and there is no parent to mark.
+	*/
+	tree_data->ref_direct[hfid / 32] |= 1U << (hfid % 32);
+	tree_data->ref_any[hfid / 32] |= 1U << (hfid % 32);
+	if (hfinfo->parent != -1)
+		tree_data->ref_any[hfinfo->parent / 32] |= 1U << (hfinfo->parent % 32);
+}
+
+hf_ref_type
+proto_tree_get_ref_type(const proto_tree *tree, const int hfid)
+{
+	const tree_data_t *tree_data;
+
+	if (!tree)
+		return HF_REF_TYPE_NONE;
+
+	tree_data = PTREE_DATA(tree);
+	if (tree_data_ref_is_direct(tree_data, hfid))
+		return HF_REF_TYPE_DIRECT;
+	if (REF_BIT_IS_SET(tree_data->ref_any, tree_data->ref_words, hfid))
+		return HF_REF_TYPE_INDIRECT;
+
+	return HF_REF_TYPE_NONE;
+}
+
+guint
+proto_get_prime_serial(void)
+{
+	return prime_serial;
 }
 
 proto_tree *
@@ -7425,6 +7655,7 @@ proto_register_protocol(const char *name, const char *short_name,
 	protocol->can_toggle = TRUE;
 	protocol->parent_proto_id = -1;
 	protocol->heur_list = NULL;
+	protocol->deferred_fields = NULL;
 
 	/* List will be sorted later by name, when all protocols completed registering */
 	protocols = g_list_prepend(protocols, protocol);
@@ -7484,6 +7715,7 @@ proto_register_protocol_in_name_only(const char *name, const char *short_name, c
 
 	protocol->parent_proto_id = parent_proto;
 	protocol->heur_list = NULL;
+	protocol->deferred_fields = NULL;
 
 	/* List will be sorted later by name, when all protocols completed registering */
 	protocols = g_list_prepend(protocols, protocol);
@@ -7543,8 +7775,7 @@ proto_deregister_protocol(const char *short_name)
 	g_ptr_array_add(deregistered_fields, gpa_hfinfo.hfi[proto_id]);
 	g_hash_table_steal(gpa_name_map, protocol->filter_name);
 
-	g_free(last_field_name);
-	last_field_name = NULL;
+	forget_field_names();
 
 	return TRUE;
 }
@@ -7607,6 +7838,9 @@ proto_get_first_protocol_field(const int proto_id, void **cookie)
 {
 	protocol_t *protocol = find_protocol_by_id(proto_id);
 
+	if (protocol != NULL && protocol->deferred_fields != NULL)
+		register_deferred_fields(protocol);
+
 	if ((protocol == NULL) || (protocol->fields == NULL) || (protocol->fields->len == 0))
 		return NULL;
 
@@ -7950,6 +8184,42 @@ proto_register_field_array(const int parent, hf_register_info *hf, const int num
 	}
 }
 
+void
+proto_register_field_array_deferred(const int parent, hf_register_info *hf, const int num_records)
+{
+	deferred_field_array_t *deferred;
+	protocol_t	       *proto;
+
+	proto = find_protocol_by_id(parent);
+
+	deferred = g_new0(deferred_field_array_t, 1);
+	deferred->parent      = parent;
+	deferred->hf          = hf;
+	deferred->num_records = num_records;
+
+	if (proto->deferred_fields == NULL)
+		deferred_protocols = g_slist_prepend(deferred_protocols, proto);
+	proto->deferred_fields = g_slist_prepend(proto->deferred_fields, deferred);
+}
+
+void
+proto_register_deferred_routine(const int parent, void (*routine)(void *data), void *data)
+{
+	deferred_field_array_t *deferred;
+	protocol_t	       *proto;
+
+	proto = find_protocol_by_id(parent);
+
+	deferred = g_new0(deferred_field_array_t, 1);
+	deferred->parent       = parent;
+	deferred->routine      = routine;
+	deferred->routine_data = data;
+
+	if (proto->deferred_fields == NULL)
+		deferred_protocols = g_slist_prepend(deferred_protocols, proto);
+	proto->deferred_fields = g_slist_prepend(proto->deferred_fields, deferred);
+}
+
 /* deregister already registered fields */
 void
 proto_deregister_field (const int parent, gint hf_id)
@@ -7958,8 +8228,7 @@ proto_deregister_field (const int parent, gint hf_id)
 	protocol_t       *proto;
 	guint             i;
 
-	g_free(last_field_name);
-	last_field_name = NULL;
+	forget_field_names();
 
 	if (hf_id == -1 || hf_id == 0)
 		return;
@@ -7976,6 +8245,7 @@ proto_deregister_field (const int parent, gint hf_id)
 			g_hash_table_steal(gpa_name_map, hfi->abbrev);
 			g_ptr_array_remove_index_fast(proto->fields, i);
 			g_ptr_array_add(deregistered_fields, gpa_hfinfo.hfi[hf_id]);
+			hf_strings_index_forget(hf_id);
 			return;
 		}
 	}
@@ -8852,6 +9122,8 @@ proto_register_field_init(header_field_info *hfinfo, const int parent)
 
 		same_name_hfinfo = NULL;
 
+		if (abbrev_index)
+			forget_field_names();
 		g_hash_table_insert(gpa_name_map, (gpointer) (hfinfo->abbrev), hfinfo);
 		/* GLIB 2.x - if it is already present
 		 * the previous hfinfo with the same name is saved
@@ -9366,11 +9638,204 @@ fill_label_boolean(field_info *fi, gchar *label_str)
 	label_fill(label_str, bitfield_byte_length, hfinfo, tfs_get_string(!!value, tfstring));
 }
 
+/*
+ * try_val_to_str() and try_rval_to_str() search their tables linearly,
+ * which shows up in profiles for fields with hundreds of values (message
+ * types, error and status codes, ...) that haven't been converted to
+ * value_string_ext by hand. The first time such a field's table is looked
+ * up, make a sorted copy of it and search that instead: value_strings get
+ * a value_string_ext, which uses direct indexing or a binary search, and
+ * range_strings without overlapping ranges get a binary search.
+ * For duplicate values the first entry is kept, so the results are the
+ * same as those of the linear search.
+ */
+#define HF_STRINGS_INDEX_MIN_ENTRIES 16
+
+typedef struct {
+	const void       *strings;	/* the table the index was made from */
+	value_string_ext  vse;		/* _vs_p is NULL if there is no index */
+	range_string     *rs;		/* NULL if there is no index */
+	guint             rs_num_entries;
+} hf_strings_index_t;
+
+static hf_strings_index_t **hf_strings_index = NULL;
+static guint32 hf_strings_index_len = 0;
+
+static gint
+hf_strings_index_vs_cmp(gconstpointer a, gconstpointer b, gpointer user_data _U_)
+{
+	guint32 val_a = ((const value_string *)a)->value;
+	guint32 val_b = ((const value_string *)b)->value;
+
+	return (val_a > val_b) - (val_a < val_b);
+}
+
+static gint
+hf_strings_index_rs_cmp(gconstpointer a, gconstpointer b, gpointer user_data _U_)
+{
+	guint64 min_a = ((const range_string *)a)->value_min;
+	guint64 min_b = ((const range_string *)b)->value_min;
+
+	return (min_a > min_b) - (min_a < min_b);
+}
+
+static void
+hf_strings_index_build_vs(hf_strings_index_t *idx, const header_field_info *hfinfo)
+{
+	const value_string *vs = (const value_string *)hfinfo->strings;
+	value_string *sorted;
+	guint num_entries = 0, i, n;
+
+	while (vs[num_entries].strptr != NULL)
+		num_entries++;
+	if (num_entries < HF_STRINGS_INDEX_MIN_ENTRIES)
+		return;
+
+	/* g_qsort_with_data() is stable, so the first of any duplicates stays first */
+	sorted = g_new(value_string, num_entries + 1);
+	memcpy(sorted, vs, num_entries * sizeof(value_string));
+	g_qsort_with_data(sorted, num_entries, sizeof(value_string), hf_strings_index_vs_cmp, NULL);
+	for (i = 1, n = 1; i < num_entries; i++) {
+		if (sorted[i].value != sorted[n - 1].value)
+			sorted[n++] = sorted[i];
+	}
+	sorted[n].value = 0;
+	sorted[n].strptr = NULL;
+
+	idx->vse._vs_match2 = _try_val_to_str_ext_init;
+	idx->vse._vs_first_value = 0;
+	idx->vse._vs_num_entries = n;
+	idx->vse._vs_p = sorted;
+	idx->vse._vs_name = hfinfo->abbrev;
+}
+
+static void
+hf_strings_index_build_rs(hf_strings_index_t *idx, const header_field_info *hfinfo)
+{
+	const range_string *rs = (const range_string *)hfinfo->strings;
+	range_string *sorted;
+	guint num_entries = 0, i;
+
+	while (rs[num_entries].strptr != NULL)
+		num_entries++;
+	if (num_entries < HF_STRINGS_INDEX_MIN_ENTRIES)
+		return;
+
+	sorted = g_new(range_string, num_entries);
+	memcpy(sorted, rs, num_entries * sizeof(range_string));
+	g_qsort_with_data(sorted, num_entries, sizeof(range_string), hf_strings_index_rs_cmp, NULL);
+
+	/* With overlapping ranges, the first match depends on the table order */
+	for (i = 0; i < num_entries; i++) {
+		if (sorted[i].value_min > sorted[i].value_max ||
+		    (i > 0 && sorted[i].value_min <= sorted[i - 1].value_max)) {
+			g_free(sorted);
+			return;
+		}
+	}
+
+	idx->rs = sorted;
+	idx->rs_num_entries = num_entries;
+}
+
+static void
+hf_strings_index_free(hf_strings_index_t *idx)
+{
+	if (idx) {
+		g_free((value_string *)idx->vse._vs_p);
+		g_free(idx->rs);
+		g_free(idx);
+	}
+}
+
+static void
+hf_strings_index_forget(int hf_id)
+{
+	if (hf_id >= 0 && (guint32)hf_id < hf_strings_index_len) {
+		hf_strings_index_free(hf_strings_index[hf_id]);
+		hf_strings_index[hf_id] = NULL;
+	}
+}
+
+static void
+hf_strings_index_cleanup(void)
+{
+	guint32 i;
+
+	for (i = 0; i < hf_strings_index_len; i++)
+		hf_strings_index_free(hf_strings_index[i]);
+	g_free(hf_strings_index);
+	hf_strings_index = NULL;
+	hf_strings_index_len = 0;
+}
+
+static hf_strings_index_t *
+hf_strings_index_get(const header_field_info *hfinfo)
+{
+	hf_strings_index_t *idx;
+
+	if (hfinfo->id < 0)
+		return NULL;
+
+	if ((guint32)hfinfo->id >= hf_strings_index_len) {
+		guint32 new_len = gpa_hfinfo.allocated_len;
+
+		if (new_len <= (guint32)hfinfo->id)
+			new_len = hfinfo->id + 1;
+		hf_strings_index = g_renew(hf_strings_index_t *, hf_strings_index, new_len);
+		memset(hf_strings_index + hf_strings_index_len, 0,
+		    (new_len - hf_strings_index_len) * sizeof(hf_strings_index_t *));
+		hf_strings_index_len = new_len;
+	}
+
+	idx = hf_strings_index[hfinfo->id];
+	if (idx && idx->strings == hfinfo->strings)
+		return idx;
+
+	/* First lookup, or the field's table has been replaced */
+	hf_strings_index_free(idx);
+	idx = g_new0(hf_strings_index_t, 1);
+	idx->strings = hfinfo->strings;
+	if (hfinfo->display & BASE_RANGE_STRING)
+		hf_strings_index_build_rs(idx, hfinfo);
+	else
+		hf_strings_index_build_vs(idx, hfinfo);
+	hf_strings_index[hfinfo->id] = idx;
+
+	return idx;
+}
+
+static const char *
+hf_strings_index_try_rval_to_str(guint32 value, const hf_strings_index_t *idx)
+{
+	guint low = 0, high = idx->rs_num_entries;
+
+	/* Find the last range starting at or below the value */
+	while (low < high) {
+		guint mid = low + (high - low) / 2;
+
+		if (idx->rs[mid].value_min <= value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low > 0 && value <= idx->rs[low - 1].value_max)
+		return idx->rs[low - 1].strptr;
+
+	return NULL;
+}
+
 static const char *
 hf_try_val_to_str(guint32 value, const header_field_info *hfinfo)
 {
-	if (hfinfo->display & BASE_RANGE_STRING)
+	hf_strings_index_t *idx;
+
+	if (hfinfo->display & BASE_RANGE_STRING) {
+		idx = hf_strings_index_get(hfinfo);
+		if (idx && idx->rs)
+			return hf_strings_index_try_rval_to_str(value, idx);
 		return try_rval_to_str(value, (const range_string *) hfinfo->strings);
+	}
 
 	if (hfinfo->display & BASE_EXT_STRING) {
 		if (hfinfo->display & BASE_VAL64_STRING)
@@ -9385,6 +9850,10 @@ hf_try_val_to_str(guint32 value, const header_field_info *hfinfo)
 	if (hfinfo->display & BASE_UNIT_STRING)
 		return unit_name_string_get_value(value, (const struct unit_name_string*) hfinfo->strings);
 
+	idx = hf_strings_index_get(hfinfo);
+	if (idx && idx->vse._vs_p)
+		return try_val_to_str_ext(value, &idx->vse);
+
 	return try_val_to_str(value, (const value_string *) hfinfo->strings);
 }
 
@@ -10298,14 +10767,28 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	GPtrArray *ptrs;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
+	if (PTREE_DATA(tree)->interesting_hfids == NULL)
 		return NULL;
+
+	/* Arrays are kept, empty, across proto_tree_reset(); callers
+	 * expect NULL for a field that isn't in this tree. */
+	ptrs = (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
+				   GINT_TO_POINTER(id));
+	if (ptrs == NULL || ptrs->len == 0)
+		return NULL;
+
+	return ptrs;
+}
+
+static gboolean
+ptr_array_is_nonempty(gpointer key _U_, gpointer value, gpointer user_data _U_)
+{
+	return ((GPtrArray *)value)->len != 0;
 }
 
 gboolean
@@ -10318,7 +10801,8 @@ proto_tracking_interesting_fields(const proto_tree *tree)
 
 	interesting_hfids = PTREE_DATA(tree)->interesting_hfids;
 
-	return (interesting_hfids != NULL) && g_hash_table_size(interesting_hfids);
+	return (interesting_hfids != NULL) &&
+		(g_hash_table_find(interesting_hfids, ptr_array_is_nonempty, NULL) != NULL);
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
@@ -12810,7 +13294,7 @@ proto_tree_add_ts_23_038_7bits_packed_item(proto_tree *tree, const int hfindex,
 
 	pi = proto_tree_add_pi(tree, hfinfo, tvb, byte_offset, &byte_length);
 	DISSECTOR_ASSERT(byte_length >= 0);
-	proto_tree_set_string(PNODE_FINFO(pi), string);
+	proto_tree_set_string(PNODE_FINFO(pi), PNODE_POOL(pi), string);
 
 	return pi;
 }
@@ -12838,7 +13322,7 @@ proto_tree_add_ascii_7bits_item(proto_tree *tree, const int hfindex, tvbuff_t *t
 
 	pi = proto_tree_add_pi(tree, hfinfo, tvb, byte_offset, &byte_length);
 	DISSECTOR_ASSERT(byte_length >= 0);
-	proto_tree_set_string(PNODE_FINFO(pi), string);
+	proto_tree_set_string(PNODE_FINFO(pi), PNODE_POOL(pi), string);
 
 	return pi;
 }
@@ -752,7 +752,8 @@ struct _header_field_info {
     /* ------- set by proto routines (prefilled by HFILL macro, see below) ------ */
     int                id;                /**< Field ID */
     int                parent;            /**< parent protocol tree */
-    hf_ref_type        ref_type;          /**< is this field referenced by a filter */
+    hf_ref_type        ref_type;          /**< unused; whether a field is referenced is kept per tree,
+                                               see proto_tree_get_ref_type() */
     int                same_name_prev_id; /**< ID of previous hfinfo with same abbrev */
     header_field_info *same_name_next;    /**< Link to next hfinfo with same abbrev */
 };
@@ -866,6 +867,9 @@ typedef struct {
     gboolean             fake_protocols;
     guint                count;
     struct _packet_info *pinfo;
+    guint32             *ref_direct;        /**< bitset of the hfids primed for this tree */
+    guint32             *ref_any;           /**< ref_direct, plus the protocols of those hfids */
+    guint                ref_words;         /**< number of guint32s in each bitset */
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -1189,13 +1193,32 @@ proto_tree_set_visible(proto_tree *tree, gboolean visible);
 extern void
 proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 
-/** Mark a field/protocol ID as "interesting".
- @param tree the tree to be set (currently ignored)
- @param hfid the interesting field id
- @todo what *does* interesting mean? */
+/** Mark a field/protocol ID as "interesting", i.e. referenced by a filter,
+ so that it isn't faked and its field_info's can be found with
+ proto_get_finfo_ptr_array(). The mark belongs to the tree and stays
+ across proto_tree_reset(), so priming a tree again for every packet with
+ the same filters is cheap.
+ @param tree the tree to be set
+ @param hfid the interesting field id */
 extern void
 proto_tree_prime_with_hfid(proto_tree *tree, const int hfid);
 
+/** Find out whether a field/protocol ID was marked as "interesting" for
+ a tree.
+ @param tree the tree, or any item in it; may be NULL
+ @param hfid the field id
+ @return HF_REF_TYPE_DIRECT if the field was primed, HF_REF_TYPE_INDIRECT if
+ it's the protocol of a primed field, or HF_REF_TYPE_NONE */
+WS_DLL_PUBLIC hf_ref_type
+proto_tree_get_ref_type(const proto_tree *tree, const int hfid);
+
+/** Get a counter that changes every time a field/protocol ID is newly marked
+ as "interesting" for some tree, so anything derived from the set of
+ referenced fields can be cached until the next priming.
+ @return the current priming serial number */
+WS_DLL_PUBLIC guint
+proto_get_prime_serial(void);
+
 /** Get a parent item of a subtree.
  @param tree the tree to get the parent from
  @return parent item */
@@ -2476,6 +2499,37 @@ WS_DLL_PUBLIC void proto_initialize_all_prefixes(void);
 WS_DLL_PUBLIC void
 proto_register_field_array(const int parent, hf_register_info *hf, const int num_records);
 
+/** Register a header_field array, but postpone the actual registration until
+ the fields are first needed: when a dissector handle or heuristic dissector
+ of the protocol is first called, when a field name starting with the
+ protocol's filter name is looked up (e.g. by a display filter or a custom
+ column), when the protocol's fields are enumerated, or when
+ proto_initialize_all_prefixes() is called. This saves startup time for
+ protocols with very large field arrays. Until then the field ids stay -1, so
+ the fields must only be used from code reached through the protocol's own
+ dissectors. The array must remain valid, i.e. be static.
+ @param parent the protocol handle from proto_register_protocol()
+ @param hf the hf_register_info array
+ @param num_records the number of records in hf */
+WS_DLL_PUBLIC void
+proto_register_field_array_deferred(const int parent, hf_register_info *hf, const int num_records);
+
+/** Arrange for a routine to be called the first time the protocol's fields
+ are needed, under the same conditions as proto_register_field_array_deferred().
+ The routine is called at most once per registration; it may register fields.
+ @param parent the protocol handle from proto_register_protocol()
+ @param routine the routine to call
+ @param data passed to routine */
+WS_DLL_PUBLIC void
+proto_register_deferred_routine(const int parent, void (*routine)(void *data), void *data);
+
+/** Register the field arrays that the protocol postponed with
+ proto_register_field_array_deferred(), and run the routines registered with
+ proto_register_deferred_routine(), if it has not been done yet.
+ @param protocol the protocol */
+WS_DLL_PUBLIC void
+proto_register_deferred_fields(protocol_t *protocol);
+
 /** Deregister an already registered field.
  @param parent the protocol handle from proto_register_protocol()
  @param hf_id the field to deregister */
@@ -2535,6 +2589,15 @@ WS_DLL_PUBLIC header_field_info* proto_registrar_get_byname(const char *field_na
  @return the registered item */
 WS_DLL_PUBLIC header_field_info* proto_registrar_get_byalias(const char *alias_name);
 
+/** Get the registered fields and protocols whose names start with a prefix,
+ ignoring ASCII case. Where several fields share a name only the first one
+ registered is included.
+ @param prefix the prefix to search for
+ @param count set to the number of matches
+ @return an array of the matches, sorted by name, which is valid until a
+ field is registered or deregistered */
+WS_DLL_PUBLIC header_field_info * const *proto_registrar_get_byprefix(const char *prefix, guint *count);
+
 /** Get the header_field id based upon a field name.
  @param field_name the field name to search for
  @return the field id for the registered item */
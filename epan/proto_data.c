@@ -23,76 +23,157 @@
 typedef struct _proto_data {
   int   proto;
   guint32 key;
+  guint32 seq;          /* when it was added; newer entries have larger values */
+  guint8 state;         /* PROTO_DATA_SLOT_ value */
   void *proto_data;
 } proto_data_t;
 
-static gint
-p_compare(gconstpointer a, gconstpointer b)
+#define PROTO_DATA_SLOT_EMPTY   0
+#define PROTO_DATA_SLOT_USED    1
+#define PROTO_DATA_SLOT_REMOVED 2
+
+/* The protocol data for a packet or frame: an open-addressed hash table,
+   probed linearly and allocated in the same scope as the data.  There
+   can be several entries with the same protocol and key; they're kept
+   in the order of the probe sequence from newest to oldest, so that a
+   lookup finds the one added most recently and removing it uncovers
+   the one before. */
+struct _proto_data_table {
+  proto_data_t *slots;
+  guint         size;   /* number of slots, a power of 2 */
+  guint         used;   /* slots that aren't empty, including removed entries */
+  guint         count;  /* entries that haven't been removed */
+  guint32       next_seq;
+};
+
+#define PROTO_DATA_TABLE_MIN_SIZE 8
+
+static inline guint
+p_hash(int proto, guint32 key)
 {
-  const proto_data_t *ap = (const proto_data_t *)a;
-  const proto_data_t *bp = (const proto_data_t *)b;
-
-  if (ap -> proto > bp -> proto) {
-    return 1;
-  } else if (ap -> proto == bp -> proto) {
-    if (ap->key > bp->key){
-      return 1;
-    } else if (ap -> key == bp -> key) {
-      return 0;
-    }
-    return -1;
-  } else {
-    return -1;
-  }
+  guint32 h = ((guint32)proto * 0x9e3779b1U) ^ key;
+
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  return h;
 }
 
-void
-p_add_proto_data(wmem_allocator_t *tmp_scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
+static proto_data_table_t **
+p_get_table(wmem_allocator_t *scope, struct _packet_info* pinfo)
 {
-  proto_data_t     *p1;
-  GSList          **proto_list;
-  wmem_allocator_t *scope;
-
-  if (tmp_scope == pinfo->pool) {
-    scope = tmp_scope;
-    proto_list = &pinfo->proto_data;
-  } else if (tmp_scope == wmem_file_scope()) {
-    scope = wmem_file_scope();
-    proto_list = &pinfo->fd->pfd;
+  if (scope == pinfo->pool) {
+    return &pinfo->proto_data;
+  } else if (scope == wmem_file_scope()) {
+    return &pinfo->fd->pfd;
   } else {
     DISSECTOR_ASSERT(!"invalid wmem scope");
   }
+  return NULL;
+}
 
-  p1 = wmem_new(scope, proto_data_t);
+static proto_data_t *
+p_find(proto_data_table_t *table, int proto, guint32 key)
+{
+  proto_data_t *slot;
+  guint         mask, i;
+
+  if (table == NULL)
+    return NULL;
+
+  /* There's always an empty slot, so this ends. */
+  mask = table->size - 1;
+  for (i = p_hash(proto, key) & mask; ; i = (i + 1) & mask) {
+    slot = &table->slots[i];
+    if (slot->state == PROTO_DATA_SLOT_EMPTY)
+      return NULL;
+    if (slot->state == PROTO_DATA_SLOT_USED &&
+        slot->proto == proto && slot->key == key)
+      return slot;
+  }
+}
 
-  p1->proto = proto;
-  p1->key = key;
-  p1->proto_data = proto_data;
+/* Put an entry in the first free slot of its probe sequence, in front
+   of any older entries with the same protocol and key. */
+static void
+p_insert(proto_data_table_t *table, proto_data_t entry)
+{
+  proto_data_t *slot, tmp;
+  guint         mask, i;
+
+  mask = table->size - 1;
+  for (i = p_hash(entry.proto, entry.key) & mask; ; i = (i + 1) & mask) {
+    slot = &table->slots[i];
+    if (slot->state != PROTO_DATA_SLOT_USED) {
+      if (slot->state == PROTO_DATA_SLOT_EMPTY)
+        table->used++;
+      *slot = entry;
+      table->count++;
+      return;
+    }
+    if (slot->proto == entry.proto && slot->key == entry.key &&
+        slot->seq < entry.seq) {
+      /* Take its place, and find a slot further on for it. */
+      tmp = *slot;
+      *slot = entry;
+      entry = tmp;
+    }
+  }
+}
 
-  /* Add it to the GSLIST */
-  *proto_list = g_slist_prepend(*proto_list, p1);
+static void
+p_resize(wmem_allocator_t *scope, proto_data_table_t *table)
+{
+  proto_data_t *old_slots = table->slots;
+  guint         old_size = table->size;
+  guint         i;
+
+  /* Leave room to grow; if it's mostly removed entries, just drop them. */
+  table->size = PROTO_DATA_TABLE_MIN_SIZE;
+  while (table->size < (table->count + 1) * 2)
+    table->size *= 2;
+  table->slots = wmem_alloc0_array(scope, proto_data_t, table->size);
+  table->used = 0;
+  table->count = 0;
+
+  for (i = 0; i < old_size; i++) {
+    if (old_slots[i].state == PROTO_DATA_SLOT_USED)
+      p_insert(table, old_slots[i]);
+  }
+  wmem_free(scope, old_slots);
 }
 
 void
-p_set_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
+p_add_proto_data(wmem_allocator_t *tmp_scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
 {
-  proto_data_t  temp;
-  GSList       *item;
+  proto_data_table_t **tablep = p_get_table(tmp_scope, pinfo);
+  proto_data_table_t  *table = *tablep;
+  proto_data_t         entry;
+
+  if (table == NULL) {
+    table = wmem_new0(tmp_scope, proto_data_table_t);
+    table->size = PROTO_DATA_TABLE_MIN_SIZE;
+    table->slots = wmem_alloc0_array(tmp_scope, proto_data_t, table->size);
+    *tablep = table;
+  } else if ((table->used + 1) * 4 > table->size * 3) {
+    /* Keep at least a quarter of the slots empty */
+    p_resize(tmp_scope, table);
+  }
 
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
+  entry.proto = proto;
+  entry.key = key;
+  entry.seq = table->next_seq++;
+  entry.state = PROTO_DATA_SLOT_USED;
+  entry.proto_data = proto_data;
+  p_insert(table, entry);
+}
 
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, &temp, p_compare);
-  } else if (scope == wmem_file_scope()) {
-    item = g_slist_find_custom(pinfo->fd->pfd, &temp, p_compare);
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
+void
+p_set_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
+{
+  proto_data_t *pd = p_find(*p_get_table(scope, pinfo), proto, key);
 
-  if (item) {
-    proto_data_t *pd = (proto_data_t *)item->data;
+  if (pd) {
     pd->proto_data = proto_data;
     return;
   }
@@ -103,24 +184,10 @@ p_set_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto,
 void *
 p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
 {
-  proto_data_t  temp, *p1;
-  GSList       *item;
-
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
-
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, &temp, p_compare);
-  } else if (scope == wmem_file_scope()) {
-    item = g_slist_find_custom(pinfo->fd->pfd, &temp, p_compare);
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
+  proto_data_t *pd = p_find(*p_get_table(scope, pinfo), proto, key);
 
-  if (item) {
-    p1 = (proto_data_t *)item->data;
-    return p1->proto_data;
+  if (pd) {
+    return pd->proto_data;
   }
 
   return NULL;
@@ -129,40 +196,41 @@ p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto,
 void
 p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
 {
-  proto_data_t  temp;
-  GSList       *item;
-  GSList      **proto_list;
-
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
-
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, &temp, p_compare);
-    proto_list = &pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    item = g_slist_find_custom(pinfo->fd->pfd, &temp, p_compare);
-    proto_list = &pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
+  proto_data_table_t *table = *p_get_table(scope, pinfo);
+  proto_data_t       *pd = p_find(table, proto, key);
+
+  if (pd) {
+    /* Leave it in the probe sequence, so older entries can be found */
+    pd->state = PROTO_DATA_SLOT_REMOVED;
+    pd->proto_data = NULL;
+    table->count--;
   }
+}
 
-  if (item) {
-    *proto_list = g_slist_remove(*proto_list, item->data);
-  }
+guint
+p_get_proto_data_count(wmem_allocator_t *scope, struct _packet_info* pinfo)
+{
+  proto_data_table_t *table = *p_get_table(scope, pinfo);
+
+  return table ? table->count : 0;
 }
 
 gchar *
 p_get_proto_name_and_key(wmem_allocator_t *scope, struct _packet_info* pinfo, guint pfd_index){
-  proto_data_t  *temp;
-
-  if (scope == pinfo->pool) {
-    temp = (proto_data_t *)g_slist_nth_data(pinfo->proto_data, pfd_index);
-  } else if (scope == wmem_file_scope()) {
-    temp = (proto_data_t *)g_slist_nth_data(pinfo->fd->pfd, pfd_index);
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
+  proto_data_table_t *table = *p_get_table(scope, pinfo);
+  proto_data_t       *temp = NULL;
+  guint               i;
+
+  for (i = 0; table != NULL && i < table->size; i++) {
+    if (table->slots[i].state != PROTO_DATA_SLOT_USED)
+      continue;
+    if (pfd_index == 0) {
+      temp = &table->slots[i];
+      break;
+    }
+    pfd_index--;
   }
+  DISSECTOR_ASSERT(temp != NULL);
 
   return wmem_strdup_printf(pinfo->pool, "[%s, key %u]",proto_get_protocol_name(temp->proto), temp->key);
 }
@@ -28,6 +28,9 @@ extern "C" {
 
 /* Allocator should be either pinfo->pool or wmem_file_scope() */
 
+/** The protocol data of a packet (pinfo->proto_data) or frame (fd->pfd). */
+typedef struct _proto_data_table proto_data_table_t;
+
 /**
  * Add data associated with a protocol.
  *
@@ -86,6 +89,15 @@ WS_DLL_PUBLIC void *p_get_proto_data(wmem_allocator_t *scope, struct _packet_inf
  */
 WS_DLL_PUBLIC void p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key);
 
+/**
+ * Get the number of protocol data entries.
+ *
+ * @param scope The memory scope, typically pinfo->pool or wmem_file_scope().
+ * @param pinfo This dissection's packet info.
+ * @return The number of entries, as enumerated by p_get_proto_name_and_key().
+ */
+guint p_get_proto_data_count(wmem_allocator_t *scope, struct _packet_info* pinfo);
+
 gchar *p_get_proto_name_and_key(wmem_allocator_t *scope, struct _packet_info* pinfo, guint pfd_index);
 
 /**
@@ -436,6 +436,7 @@ reassembly_table_init(reassembly_table *table,
 		table->persistent_key_func = funcs->persistent_key_func;
 	if (table->free_temporary_key_func == NULL)
 		table->free_temporary_key_func = funcs->free_temporary_key_func;
+	table->last_expiry = 0;
 	if (table->fragment_table != NULL) {
 		/*
 		 * The fragment hash table exists.
@@ -533,6 +534,81 @@ reassembly_table_destroy(reassembly_table *table)
 	}
 }
 
+void
+reassembly_table_set_limits(reassembly_table *table, const guint max_pending,
+			    const guint timeout)
+{
+	table->max_pending = max_pending;
+	table->pending_timeout = timeout;
+}
+
+typedef struct {
+	gint64 now;
+	guint timeout;
+	guint32 oldest_frame;
+	guint32 evict_before;
+} expiry_data_t;
+
+static gboolean
+free_expired_fragments(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	fragment_head *fd_head = (fragment_head *)value;
+	expiry_data_t *expiry = (expiry_data_t *)user_data;
+
+	if (expiry->timeout != 0 &&
+	    expiry->now - fd_head->first_seen > expiry->timeout)
+		return free_all_fragments(key_arg, value, NULL);
+	if (fd_head->frame < expiry->evict_before)
+		return free_all_fragments(key_arg, value, NULL);
+	return FALSE;
+}
+
+static void
+find_oldest_fragment(gpointer key_arg _U_, gpointer value, gpointer user_data)
+{
+	fragment_head *fd_head = (fragment_head *)value;
+	expiry_data_t *expiry = (expiry_data_t *)user_data;
+
+	if (fd_head->frame < expiry->oldest_frame)
+		expiry->oldest_frame = fd_head->frame;
+}
+
+/*
+ * Drop the reassemblies in progress that are past the table's limits,
+ * before a new one is added. This is done at most once a second of capture
+ * time for the timeout, as it has to look at every reassembly in progress.
+ *
+ * To stay under max_pending, everything not added to since halfway between
+ * the oldest reassembly's last fragment and this frame goes, so that a
+ * flood doesn't make us look at every reassembly for every fragment.
+ */
+static void
+expire_fd_heads(reassembly_table *table, const packet_info *pinfo)
+{
+	expiry_data_t expiry;
+
+	expiry.now = (gint64)pinfo->abs_ts.secs;
+	expiry.timeout = 0;
+	expiry.oldest_frame = pinfo->num;
+	expiry.evict_before = 0;
+
+	if (table->pending_timeout != 0 && expiry.now != table->last_expiry) {
+		table->last_expiry = expiry.now;
+		expiry.timeout = table->pending_timeout;
+	}
+	if (table->max_pending != 0 &&
+	    g_hash_table_size(table->fragment_table) >= table->max_pending) {
+		g_hash_table_foreach(table->fragment_table,
+				     find_oldest_fragment, &expiry);
+		expiry.evict_before = expiry.oldest_frame +
+		    (pinfo->num - expiry.oldest_frame) / 2 + 1;
+	}
+
+	if (expiry.timeout != 0 || expiry.evict_before != 0)
+		g_hash_table_foreach_remove(table->fragment_table,
+					    free_expired_fragments, &expiry);
+}
+
 /*
  * Look up an fd_head in the fragment table, optionally returning the key
  * for it.
@@ -568,6 +644,15 @@ insert_fd_head(reassembly_table *table, fragment_head *fd_head,
 {
 	gpointer key;
 
+	/*
+	 * Make room for it, if the table is limited. Nobody is holding
+	 * on to any other reassembly in progress when we're called.
+	 */
+	if (!pinfo->fd->visited &&
+	    (table->max_pending != 0 || table->pending_timeout != 0))
+		expire_fd_heads(table, pinfo);
+	fd_head->first_seen = (guint32)pinfo->abs_ts.secs;
+
 	/*
 	 * We're going to use the key to insert the fragment,
 	 * so make a persistent version of it.
@@ -1171,8 +1256,15 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	max = 0;
 	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if ( ((fd_i->offset)<=max) &&
-			((fd_i->offset+fd_i->len)>max) ){
+		if (fd_i->offset > max) {
+			/*
+			 * There's a gap before this fragment, and as
+			 * the list is sorted by offset, past all the
+			 * remaining ones too.
+			 */
+			break;
+		}
+		if ((fd_i->offset+fd_i->len)>max) {
 			max = fd_i->offset+fd_i->len;
 		}
 	}
@@ -83,6 +83,9 @@ typedef struct _fragment_item {
 	 * reassembly and for the fragments in a reassembly.
 	 */
 	const char *error;
+	guint32 first_seen;		/**< capture time, in seconds, of the first
+					 * fragment; only valid in the first item
+					 * of the list */
 } fragment_item, fragment_head;
 
 
@@ -130,6 +133,9 @@ typedef struct {
 	fragment_temporary_key temporary_key_func;
 	fragment_persistent_key persistent_key_func;
 	GDestroyNotify free_temporary_key_func;		/* temporary key destruction function */
+	guint max_pending;				/* most reassemblies in progress, 0 for no limit */
+	guint pending_timeout;				/* seconds before a reassembly in progress is dropped, 0 for never */
+	gint64 last_expiry;				/* capture time of the last check for timed out reassemblies */
 } reassembly_table;
 
 /*
@@ -175,6 +181,21 @@ reassembly_table_init(reassembly_table *table,
 WS_DLL_PUBLIC void
 reassembly_table_destroy(reassembly_table *table);
 
+/*
+ * Limit the reassemblies a table has in progress, so that a capture full
+ * of fragments that never complete (a fragment flood, say) doesn't use
+ * memory without bound.
+ *
+ * On the first pass, a reassembly that hasn't completed within timeout
+ * seconds of capture time of its first fragment is dropped, and when a new
+ * one would take the table past max_pending reassemblies in progress, the
+ * least recently added to are dropped to make room. A dropped reassembly's
+ * fragments are never reassembled. Zero means no limit for either.
+ */
+WS_DLL_PUBLIC void
+reassembly_table_set_limits(reassembly_table *table, const guint max_pending,
+			    const guint timeout);
+
 /*
  * This function adds a new fragment to the reassembly table
  * If this is the first fragment seen for this datagram, a new entry
@@ -15,6 +15,7 @@
 
 #include "secrets.h"
 #include <wiretap/wtap.h>
+#include <wsutil/wmem/wmem.h>
 #include <wsutil/glib-compat.h>
 #include <wsutil/wslog.h>
 
@@ -36,6 +37,26 @@
 /** Maps guint32 secrets_type -> secrets_block_callback_t. */
 static GHashTable *secrets_callbacks;
 
+typedef struct {
+    int         proto;
+    guint32     frame_num;
+    guint32     index;
+} decrypted_key_t;
+
+typedef struct {
+    decrypted_key_t key;
+    GBytes     *secret_id;      /**< Interned in decrypted_secret_ids. */
+    guint       len;
+    guint8     *data;
+} decrypted_entry_t;
+
+/** Owns the decrypted_entry_t and their data. */
+static wmem_allocator_t *decrypted_scope;
+/** Maps decrypted_key_t -> decrypted_entry_t. */
+static GHashTable *decrypted_cache;
+/** Set of GBytes secret IDs, so that entries can compare them by pointer. */
+static GHashTable *decrypted_secret_ids;
+
 #ifdef HAVE_LIBGNUTLS
 /** Maps public key IDs (cert_key_id_t) -> gnutls_privkey_t.  */
 static GHashTable *rsa_privkeys;
@@ -78,6 +99,7 @@ secrets_init(void)
 void
 secrets_cleanup(void)
 {
+    secrets_cache_clear();
     g_hash_table_destroy(secrets_callbacks);
     secrets_callbacks = NULL;
 #ifdef HAVE_LIBGNUTLS
@@ -106,6 +128,97 @@ secrets_wtap_callback(guint32 secrets_type, const void *secrets, guint size)
     }
 }
 
+static guint
+decrypted_key_hash(gconstpointer key)
+{
+    const decrypted_key_t *k = (const decrypted_key_t *)key;
+    return (k->frame_num * 31 + k->index) * 31 + (guint)k->proto;
+}
+
+static gboolean
+decrypted_key_equal(gconstpointer a, gconstpointer b)
+{
+    const decrypted_key_t *ka = (const decrypted_key_t *)a;
+    const decrypted_key_t *kb = (const decrypted_key_t *)b;
+    return ka->frame_num == kb->frame_num && ka->index == kb->index && ka->proto == kb->proto;
+}
+
+/* Returns the interned copy of a secret ID, optionally adding it. */
+static GBytes *
+decrypted_secret_id(const guint8 *secret_id, guint secret_id_len, gboolean add)
+{
+    GBytes *id = g_bytes_new_static(secret_id, secret_id_len);
+    GBytes *interned = (GBytes *)g_hash_table_lookup(decrypted_secret_ids, id);
+    g_bytes_unref(id);
+
+    if (!interned && add) {
+        interned = g_bytes_new(secret_id, secret_id_len);
+        g_hash_table_add(decrypted_secret_ids, interned);
+    }
+    return interned;
+}
+
+const guint8 *
+secrets_cache_add(int proto, guint32 frame_num, guint32 index,
+                  const guint8 *secret_id, guint secret_id_len,
+                  const guint8 *data, guint len)
+{
+    decrypted_entry_t *entry;
+
+    if (!decrypted_cache) {
+        decrypted_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+        decrypted_cache = g_hash_table_new(decrypted_key_hash, decrypted_key_equal);
+        decrypted_secret_ids = g_hash_table_new_full(g_bytes_hash, g_bytes_equal,
+                (GDestroyNotify)g_bytes_unref, NULL);
+    }
+
+    /* A replaced entry stays in decrypted_scope until the cache is cleared,
+     * this only happens for a frame that is decrypted with a new key. */
+    entry = wmem_new(decrypted_scope, decrypted_entry_t);
+    entry->key.proto = proto;
+    entry->key.frame_num = frame_num;
+    entry->key.index = index;
+    entry->secret_id = decrypted_secret_id(secret_id, secret_id_len, TRUE);
+    entry->len = len;
+    entry->data = (guint8 *)wmem_memdup(decrypted_scope, data, len);
+    g_hash_table_insert(decrypted_cache, &entry->key, entry);
+
+    return entry->data;
+}
+
+const guint8 *
+secrets_cache_lookup(int proto, guint32 frame_num, guint32 index,
+                     const guint8 *secret_id, guint secret_id_len, guint *len)
+{
+    decrypted_key_t key = { proto, frame_num, index };
+    decrypted_entry_t *entry;
+
+    if (!decrypted_cache) {
+        return NULL;
+    }
+
+    entry = (decrypted_entry_t *)g_hash_table_lookup(decrypted_cache, &key);
+    if (!entry || entry->secret_id != decrypted_secret_id(secret_id, secret_id_len, FALSE)) {
+        return NULL;
+    }
+
+    *len = entry->len;
+    return entry->data;
+}
+
+void
+secrets_cache_clear(void)
+{
+    if (decrypted_cache) {
+        g_hash_table_destroy(decrypted_cache);
+        g_hash_table_destroy(decrypted_secret_ids);
+        wmem_destroy_allocator(decrypted_scope);
+        decrypted_cache = NULL;
+        decrypted_secret_ids = NULL;
+        decrypted_scope = NULL;
+    }
+}
+
 #ifdef HAVE_LIBGNUTLS
 static guint
 key_id_hash(gconstpointer key)
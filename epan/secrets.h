@@ -79,6 +79,44 @@ typedef void (*secrets_block_callback_t)(const void *secrets, guint size);
  */
 void secrets_register_type(guint32 secrets_type, secrets_block_callback_t cb);
 
+/**
+ * Stores decrypted data for a frame so that it survives redissection. The
+ * data stays until secrets_cache_clear() is called, which happens when the
+ * capture file is closed.
+ * @param proto Protocol of the caller.
+ * @param frame_num Frame the data was decrypted from.
+ * @param index Distinguishes several decrypted items of the same frame and
+ * protocol (record index, layer number, ...).
+ * @param secret_id Identifies everything the plaintext depends on besides the
+ * frame contents (key material, algorithms, ...). A lookup with a different
+ * secret_id fails, so a changed key cannot hit stale data.
+ * @param secret_id_len Size of secret_id.
+ * @param data The decrypted data.
+ * @param len Size of data.
+ * @return The stored copy of data, valid until secrets_cache_clear().
+ */
+WS_DLL_PUBLIC const guint8 *
+secrets_cache_add(int proto, guint32 frame_num, guint32 index,
+                  const guint8 *secret_id, guint secret_id_len,
+                  const guint8 *data, guint len);
+
+/**
+ * Looks up data stored with secrets_cache_add().
+ * @param len Set to the size of the returned data.
+ * @return The stored data, or NULL if nothing was stored for the frame with
+ * the same secret_id.
+ */
+WS_DLL_PUBLIC const guint8 *
+secrets_cache_lookup(int proto, guint32 frame_num, guint32 index,
+                     const guint8 *secret_id, guint secret_id_len, guint *len);
+
+/**
+ * Drops all data stored with secrets_cache_add(). Must be called when the
+ * frame numbers no longer refer to the same capture file.
+ */
+WS_DLL_PUBLIC void
+secrets_cache_clear(void);
+
 #ifdef HAVE_LIBGNUTLS
 /**
  * Retrieve a list of available key URIs. PKCS #11 token URIs begin with
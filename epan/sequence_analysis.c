@@ -12,6 +12,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "sequence_analysis.h"
 
 #include "addr_resolv.h"
@@ -95,6 +97,58 @@ void sequence_analysis_table_iterate_tables(wmem_foreach_func func, gpointer use
     wmem_tree_foreach(registered_seq_analysis, func, user_data);
 }
 
+static guint
+sequence_analysis_address_hash(gconstpointer key)
+{
+    return add_address_to_hash(0, (const address *)key);
+}
+
+static gboolean
+sequence_analysis_address_equal(gconstpointer a, gconstpointer b)
+{
+    return addresses_equal((const address *)a, (const address *)b);
+}
+
+static void
+sequence_analysis_address_free(gpointer data)
+{
+    free_address((address *)data);
+    g_free(data);
+}
+
+/* A flow graph has a handful of nodes and can have millions of items,
+ * so keep one copy of each address and point the items at it. */
+static void
+sequence_analysis_set_addresses(seq_analysis_info_t *sainfo, seq_analysis_item_t *sai,
+                                const address *src, const address *dst)
+{
+    address *addr;
+
+    if (!sainfo->addresses) {
+        copy_address(&(sai->src_addr), src);
+        copy_address(&(sai->dst_addr), dst);
+        return;
+    }
+
+    addr = (address *)g_hash_table_lookup(sainfo->addresses, src);
+    if (!addr) {
+        addr = g_new(address, 1);
+        copy_address(addr, src);
+        g_hash_table_insert(sainfo->addresses, addr, addr);
+    }
+    copy_address_shallow(&(sai->src_addr), addr);
+
+    addr = (address *)g_hash_table_lookup(sainfo->addresses, dst);
+    if (!addr) {
+        addr = g_new(address, 1);
+        copy_address(addr, dst);
+        g_hash_table_insert(sainfo->addresses, addr, addr);
+    }
+    copy_address_shallow(&(sai->dst_addr), addr);
+
+    sai->shared |= SAI_SHARED_ADDRESSES;
+}
+
 seq_analysis_item_t* sequence_analysis_create_sai_with_addresses(packet_info *pinfo, seq_analysis_info_t *sainfo)
 {
     seq_analysis_item_t *sai = NULL;
@@ -103,22 +157,26 @@ seq_analysis_item_t* sequence_analysis_create_sai_with_addresses(packet_info *pi
     if (sainfo->any_addr) {
         if (pinfo->net_src.type!=AT_NONE && pinfo->net_dst.type!=AT_NONE) {
             sai = g_new0(seq_analysis_item_t, 1);
-            copy_address(&(sai->src_addr),&(pinfo->net_src));
-            copy_address(&(sai->dst_addr),&(pinfo->net_dst));
+            sequence_analysis_set_addresses(sainfo, sai, &(pinfo->net_src), &(pinfo->net_dst));
         }
 
     } else {
         if (pinfo->src.type!=AT_NONE && pinfo->dst.type!=AT_NONE) {
             sai = g_new0(seq_analysis_item_t, 1);
-            copy_address(&(sai->src_addr),&(pinfo->src));
-            copy_address(&(sai->dst_addr),&(pinfo->dst));
+            sequence_analysis_set_addresses(sainfo, sai, &(pinfo->src), &(pinfo->dst));
         }
     }
 
     if (sai) {
-        /* Fill in the timestamps */
+        /* Fill in the timestamps. They are all about the same size, so
+           packing them in a string chunk saves a malloc header each. */
         set_fd_time(pinfo->epan, pinfo->fd, time_str);
-        sai->time_str = g_strdup(time_str);
+        if (sainfo->strings) {
+            sai->time_str = g_string_chunk_insert(sainfo->strings, time_str);
+            sai->shared |= SAI_SHARED_TIME_STR;
+        } else {
+            sai->time_str = g_strdup(time_str);
+        }
     }
 
     return sai;
@@ -144,12 +202,15 @@ void sequence_analysis_use_col_info_as_label_comment(packet_info *pinfo, seq_ana
     }
 
     if (colinfo != NULL) {
-        sai->frame_label = g_strdup(colinfo);
+        /* The label is the tail of the comment; don't copy it twice */
         if (protocol != NULL) {
             sai->comment = ws_strdup_printf("%s: %s", protocol, colinfo);
+            sai->frame_label = sai->comment + strlen(protocol) + 2;
         } else {
             sai->comment = g_strdup(colinfo);
+            sai->frame_label = sai->comment;
         }
+        sai->shared |= SAI_LABEL_IN_COMMENT;
     } else {
         /* This will probably never happen...*/
         if (protocol != NULL) {
@@ -167,6 +228,9 @@ sequence_analysis_info_new(void)
     /* SEQ_ANALYSIS_DEBUG("adding new item"); */
     sainfo->items = g_queue_new();
     sainfo->ht= g_hash_table_new(g_direct_hash, g_direct_equal);
+    sainfo->addresses = g_hash_table_new_full(sequence_analysis_address_hash, sequence_analysis_address_equal,
+                                              sequence_analysis_address_free, NULL);
+    sainfo->strings = g_string_chunk_new(4096);
     return sainfo;
 }
 
@@ -180,6 +244,10 @@ void sequence_analysis_info_free(seq_analysis_info_t *sainfo)
     g_queue_free(sainfo->items);
     if (sainfo->ht != NULL)
         g_hash_table_destroy(sainfo->ht);
+    if (sainfo->addresses != NULL)
+        g_hash_table_destroy(sainfo->addresses);
+    if (sainfo->strings != NULL)
+        g_string_chunk_free(sainfo->strings);
 
     g_free(sainfo);
 }
@@ -187,11 +255,15 @@ void sequence_analysis_info_free(seq_analysis_info_t *sainfo)
 static void sequence_analysis_item_free(gpointer data)
 {
     seq_analysis_item_t *seq_item = (seq_analysis_item_t *)data;
-    g_free(seq_item->frame_label);
-    g_free(seq_item->time_str);
+    if (!(seq_item->shared & SAI_LABEL_IN_COMMENT))
+        g_free(seq_item->frame_label);
+    if (!(seq_item->shared & SAI_SHARED_TIME_STR))
+        g_free(seq_item->time_str);
     g_free(seq_item->comment);
-    free_address(&seq_item->src_addr);
-    free_address(&seq_item->dst_addr);
+    if (!(seq_item->shared & SAI_SHARED_ADDRESSES)) {
+        free_address(&seq_item->src_addr);
+        free_address(&seq_item->dst_addr);
+    }
     if (seq_item->info_ptr) {
         g_free(seq_item->info_ptr);
     }
@@ -238,6 +310,13 @@ sequence_analysis_list_free(seq_analysis_info_t *sainfo)
     if (NULL != sainfo->ht) {
         g_hash_table_remove_all(sainfo->ht);
     }
+    /* Nothing points into these any more */
+    if (NULL != sainfo->addresses) {
+        g_hash_table_remove_all(sainfo->addresses);
+    }
+    if (NULL != sainfo->strings) {
+        g_string_chunk_clear(sainfo->strings);
+    }
     sainfo->nconv = 0;
 
     sequence_analysis_free_nodes(sainfo);
@@ -52,10 +52,18 @@ typedef struct _seq_analysis_item {
     guint src_node;                     /**< this is used by graph_analysis.c to identify the node */
     guint dst_node;                     /**< a node is an IP address that will be displayed in columns */
     guint16 line_style;                 /**< the arrow line width in pixels*/
+    guint16 shared;                     /**< SAI_SHARED_* flags, set by the sequence_analysis_* helpers */
     guint32  info_type;                 /**< type of info for item */
     gpointer info_ptr;                  /**< ptr to info for item */
 } seq_analysis_item_t;
 
+/* Storage of an item that it doesn't own, and that sequence_analysis_list_free()
+ * must not free with it. Anything setting these fields by hand must clear the
+ * corresponding flag. */
+#define SAI_SHARED_ADDRESSES 0x0001     /**< src_addr and dst_addr data belong to the seq_analysis_info_t */
+#define SAI_SHARED_TIME_STR  0x0002     /**< time_str belongs to the seq_analysis_info_t */
+#define SAI_LABEL_IN_COMMENT 0x0004     /**< frame_label points into comment */
+
 /** defines the graph analysis structure */
 typedef struct _seq_analysis_info {
     const char* name;  /**< Name of sequence analysis */
@@ -65,6 +73,8 @@ typedef struct _seq_analysis_info {
     GHashTable *ht;          /**< hash table of seq_analysis_info_t */
     address nodes[MAX_NUM_NODES]; /**< horizontal node list */
     guint32 num_nodes;       /**< actual number of nodes */
+    GHashTable *addresses;   /**< addresses of the items, one copy each */
+    GStringChunk *strings;   /**< time strings of the items */
 } seq_analysis_info_t;
 
 /** Structure for information about a registered sequence analysis function */
@@ -120,6 +130,8 @@ WS_DLL_PUBLIC guint sequence_analysis_get_tap_flags(register_analysis_t* analysi
 /** Helper function to create a sequence analysis item with address fields populated
  * Allocate a seq_analysis_item_t to return and populate the time_str and src_addr and dst_addr
  * members based on seq_analysis_info_t any_addr member
+ * The addresses and the time string are stored once in sainfo for all of its
+ * items rather than per item, see SAI_SHARED_ADDRESSES and SAI_SHARED_TIME_STR
  *
  * @param pinfo packet info
  * @param sainfo info determining address type
@@ -138,6 +150,8 @@ WS_DLL_PUBLIC void sequence_analysis_use_color_filter(packet_info *pinfo, seq_an
  *
  * @param pinfo packet info
  * @param sai item to set label and comments
+ *
+ * The label and the comment share one allocation, see SAI_LABEL_IN_COMMENT
  */
 WS_DLL_PUBLIC void sequence_analysis_use_col_info_as_label_comment(packet_info *pinfo, seq_analysis_item_t *sai);
 
@@ -26,10 +26,12 @@
 static int proto_short = -1;
 static int proto_malformed = -1;
 static int proto_unreassembled = -1;
+static int proto_budget = -1;
 
 static expert_field ei_malformed_dissector_bug = EI_INIT;
 static expert_field ei_malformed_reassembly = EI_INIT;
 static expert_field ei_malformed = EI_INIT;
+static expert_field ei_budget_exceeded = EI_INIT;
 
 void
 register_show_exception(void)
@@ -39,8 +41,12 @@ register_show_exception(void)
 		{ &ei_malformed_reassembly, { "_ws.malformed.reassembly", PI_MALFORMED, PI_ERROR, "Reassembly error", EXPFILL }},
 		{ &ei_malformed, { "_ws.malformed.expert", PI_MALFORMED, PI_ERROR, "Malformed Packet (Exception occurred)", EXPFILL }},
 	};
+	static ei_register_info ei_budget[] = {
+		{ &ei_budget_exceeded, { "_ws.budget.exceeded", PI_UNDECODED, PI_WARN, "Dissection budget exceeded", EXPFILL }},
+	};
 
 	expert_module_t* expert_malformed;
+	expert_module_t* expert_budget;
 
 	proto_short = proto_register_protocol("Short Frame", "Short frame", "_ws.short");
 	proto_malformed = proto_register_protocol("Malformed Packet",
@@ -49,8 +55,13 @@ register_show_exception(void)
 	    "Unreassembled Fragmented Packet",
 	    "Unreassembled fragmented packet", "_ws.unreassembled");
 
+	proto_budget = proto_register_protocol("Dissection Budget Exceeded",
+	    "Dissection budget exceeded", "_ws.budget");
+
 	expert_malformed = expert_register_protocol(proto_malformed);
 	expert_register_field_array(expert_malformed, ei, array_length(ei));
+	expert_budget = expert_register_protocol(proto_budget);
+	expert_register_field_array(expert_budget, ei_budget, array_length(ei_budget));
 
 	/* "Short Frame", "Malformed Packet", and "Unreassembled Fragmented
 	   Packet" aren't really protocols, they're error indications;
@@ -58,6 +69,7 @@ register_show_exception(void)
 	proto_set_cant_toggle(proto_short);
 	proto_set_cant_toggle(proto_malformed);
 	proto_set_cant_toggle(proto_unreassembled);
+	proto_set_cant_toggle(proto_budget);
 }
 
 void
@@ -169,6 +181,17 @@ show_exception(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 		        dissector_error_nomsg : exception_message);
 		break;
 
+	case DissectionBudgetError:
+		col_append_fstr(pinfo->cinfo, COL_INFO,
+		    "[Dissection budget exceeded: %s]",
+		    exception_message == NULL ? pinfo->current_proto : exception_message);
+		item = proto_tree_add_protocol_format(tree, proto_budget, tvb, 0, 0,
+		    "[Dissection budget exceeded: %s]",
+		    exception_message == NULL ? pinfo->current_proto : exception_message);
+		expert_add_info_format(pinfo, item, &ei_budget_exceeded, "%s",
+		    exception_message == NULL ? pinfo->current_proto : exception_message);
+		break;
+
 	default:
 		/* XXX - we want to know, if an unknown exception passed until here, don't we? */
 		ws_assert_not_reached();
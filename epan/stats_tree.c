@@ -114,6 +114,7 @@ free_stat_node(stat_node *node)
         g_free(bucket);
     }
 
+    g_free(node->rng_index);
     g_free(node->rng);
     g_free(node->name);
     g_free(node);
@@ -216,6 +217,13 @@ stats_tree_reinit(void *p)
     }
 
     st->root.children = NULL;
+    st->root.last_child = NULL;
+    if (st->root.hash) {
+        g_hash_table_destroy(st->root.hash);
+        st->root.hash = NULL;
+    }
+    g_free(st->root.rng_index);
+    st->root.rng_index = NULL;
     st->root.counter = 0;
     switch (st->root.datatype)
     {
@@ -464,7 +472,6 @@ new_stat_node(stats_tree *st, const gchar *name, int parent_id, stat_node_dataty
 {
 
     stat_node *node = g_new0(stat_node, 1);
-    stat_node *last_chld = NULL;
 
     node->datatype = datatype;
     switch (datatype)
@@ -487,6 +494,7 @@ new_stat_node(stats_tree *st, const gchar *name, int parent_id, stat_node_dataty
     node->name = g_strdup(name);
     node->st = st;
     node->hash = with_hash ? g_hash_table_new(g_str_hash,g_str_equal) : NULL;
+    node->with_hash = with_hash;
 
     if (as_parent_node) {
         g_hash_table_insert(st->names,
@@ -509,21 +517,21 @@ new_stat_node(stats_tree *st, const gchar *name, int parent_id, stat_node_dataty
 
     if (node->parent->children) {
         /* insert as last child */
-
-        for (last_chld = node->parent->children;
-             last_chld->next;
-             last_chld = last_chld->next ) ;
-
-        last_chld->next = node;
-
+        node->parent->last_child->next = node;
     } else {
         /* insert as first child */
         node->parent->children = node;
     }
+    node->parent->last_child = node;
 
-    if(node->parent->hash) {
-        g_hash_table_replace(node->parent->hash,node->name,node);
+    if (!node->parent->hash) {
+        node->parent->hash = g_hash_table_new(g_str_hash,g_str_equal);
     }
+    g_hash_table_replace(node->parent->hash,node->name,node);
+
+    /* the sorted ranges no longer cover all children */
+    g_free(node->parent->rng_index);
+    node->parent->rng_index = NULL;
 
     if (st->cfg->setup_node_pr) {
         st->cfg->setup_node_pr(node);
@@ -535,6 +543,56 @@ new_stat_node(stats_tree *st, const gchar *name, int parent_id, stat_node_dataty
 }
 /***/
 
+/* finds the child of parent with the given name */
+static stat_node*
+stats_tree_find_child(stats_tree *st, stat_node *parent, const gchar *name)
+{
+    stat_node *node = NULL;
+
+    if (parent->hash) {
+        node = (stat_node *)g_hash_table_lookup(parent->hash,name);
+    }
+    if (node == NULL && !parent->with_hash) {
+        /* without a hash of its own, names used to be looked up among all
+         * named nodes of the tree; keep finding those */
+        node = (stat_node *)g_hash_table_lookup(st->names,name);
+    }
+    return node;
+}
+
+/* For a parent with max_children set that is full, take over its leaf
+ * with the lowest counter for the new name (Space-Saving). The counts it
+ * already has are kept, so those of a new name are an upper bound, off by
+ * at most the count of the name it replaced. Returns NULL if the parent is
+ * not full or has no leaf that can be replaced. */
+static stat_node*
+stats_tree_replace_min_child(stat_node *parent, const gchar *name)
+{
+    stat_node *child;
+    stat_node *victim = NULL;
+
+    if (!parent->max_children || !parent->hash ||
+        g_hash_table_size(parent->hash) < parent->max_children) {
+        return NULL;
+    }
+
+    for (child = parent->children; child; child = child->next) {
+        if (child->children || child->id >= 0)
+            continue;
+        if (!victim || child->counter < victim->counter)
+            victim = child;
+    }
+    if (!victim)
+        return NULL;
+
+    g_hash_table_remove(parent->hash,victim->name);
+    g_free(victim->name);
+    victim->name = g_strdup(name);
+    g_hash_table_replace(parent->hash,victim->name,victim);
+
+    return victim;
+}
+
 extern int
 stats_tree_create_node(stats_tree *st, const gchar *name, int parent_id, stat_node_datatype datatype, gboolean with_hash)
 {
@@ -546,6 +604,15 @@ stats_tree_create_node(stats_tree *st, const gchar *name, int parent_id, stat_no
         return 0;
 }
 
+extern int
+stats_tree_create_topk_node(stats_tree *st, const gchar *name, int parent_id, stat_node_datatype datatype, guint max_children)
+{
+    stat_node *node = new_stat_node(st,name,parent_id,datatype,TRUE,TRUE);
+
+    node->max_children = max_children;
+    return node->id;
+}
+
 /* XXX: should this be a macro? */
 extern int
 stats_tree_create_node_by_pname(stats_tree *st, const gchar *name,
@@ -554,6 +621,81 @@ stats_tree_create_node_by_pname(stats_tree *st, const gchar *name,
     return stats_tree_create_node(st,name,stats_tree_parent_id_by_name(st,parent_name),datatype,with_children);
 }
 
+/* adds the values of src (from another tree) and of its descendants to node */
+static void
+merge_stat_node(stats_tree *st, stat_node *node, const stat_node *src)
+{
+    const stat_node *src_child;
+
+    node->counter += src->counter;
+    switch (node->datatype)
+    {
+    case STAT_DT_INT:
+        node->total.int_total += src->total.int_total;
+        if (src->minvalue.int_min < node->minvalue.int_min)
+            node->minvalue.int_min = src->minvalue.int_min;
+        if (src->maxvalue.int_max > node->maxvalue.int_max)
+            node->maxvalue.int_max = src->maxvalue.int_max;
+        break;
+    case STAT_DT_FLOAT:
+        node->total.float_total += src->total.float_total;
+        if (src->minvalue.float_min < node->minvalue.float_min)
+            node->minvalue.float_min = src->minvalue.float_min;
+        if (src->maxvalue.float_max > node->maxvalue.float_max)
+            node->maxvalue.float_max = src->maxvalue.float_max;
+        break;
+    }
+    node->st_flags |= src->st_flags & ~ST_FLG_ROOTCHILD;
+
+    /* a burst spanning the shard boundary is not seen, keep the larger one */
+    if (src->max_burst > node->max_burst) {
+        node->max_burst = src->max_burst;
+        node->burst_time = src->burst_time;
+    }
+
+    for (src_child = src->children; src_child; src_child = src_child->next) {
+        stat_node *child = stats_tree_find_child(st,node,src_child->name);
+
+        if (child == NULL && src_child->id < 0)
+            child = stats_tree_replace_min_child(node,src_child->name);
+        if (child == NULL) {
+            if (node->id < 0)
+                continue;
+            child = new_stat_node(st,src_child->name,node->id,src_child->datatype,
+                                  src_child->with_hash,src_child->id >= 0);
+        }
+        merge_stat_node(st,child,src_child);
+    }
+}
+
+/* will be the tap merge cb */
+extern void
+stats_tree_merge(void *p, const void *p_shard)
+{
+    stats_tree *st = (stats_tree *)p;
+    const stats_tree *shard = (const stats_tree *)p_shard;
+    double end;
+
+    if (shard->start < 0.0)
+        return;
+
+    end = shard->start + shard->elapsed;
+    if (st->start < 0.0) {
+        st->start = shard->start;
+        st->elapsed = shard->elapsed;
+    } else {
+        if (st->start + st->elapsed > end)
+            end = st->start + st->elapsed;
+        if (shard->start < st->start)
+            st->start = shard->start;
+        st->elapsed = end - st->start;
+    }
+    if (shard->now > st->now)
+        st->now = shard->now;
+
+    merge_stat_node(st,&st->root,&shard->root);
+}
+
 /* Internal function to update the burst calculation data - add entry to bucket */
 static void
 update_burst_calc(stat_node *node, gint value)
@@ -658,12 +800,10 @@ stats_tree_manip_node_int(manip_node_mode mode, stats_tree *st, const char *name
 
     parent = (stat_node *)g_ptr_array_index(st->parents,parent_id);
 
-    if( parent->hash ) {
-        node = (stat_node *)g_hash_table_lookup(parent->hash,name);
-    } else {
-        node = (stat_node *)g_hash_table_lookup(st->names,name);
-    }
+    node = stats_tree_find_child(st,parent,name);
 
+    if ( node == NULL && !with_hash )
+        node = stats_tree_replace_min_child(parent,name);
     if ( node == NULL )
         node = new_stat_node(st,name,parent_id,STAT_DT_INT,with_hash,with_hash);
 
@@ -720,13 +860,10 @@ stats_tree_manip_node_float(manip_node_mode mode, stats_tree *st, const char *na
 
     parent = (stat_node *)g_ptr_array_index(st->parents, parent_id);
 
-    if (parent->hash) {
-        node = (stat_node *)g_hash_table_lookup(parent->hash, name);
-    }
-    else {
-        node = (stat_node *)g_hash_table_lookup(st->names, name);
-    }
+    node = stats_tree_find_child(st, parent, name);
 
+    if (node == NULL && !with_hash)
+        node = stats_tree_replace_min_child(parent, name);
     if (node == NULL)
         node = new_stat_node(st, name, parent_id, STAT_DT_FLOAT, with_hash, with_hash);
 
@@ -910,6 +1047,45 @@ stats_tree_range_node_with_pname(stats_tree *st, const gchar *name,
 }
 
 
+static int
+compare_range_floor(const void *a, const void *b)
+{
+    const stat_node *na = *(const stat_node * const *)a;
+    const stat_node *nb = *(const stat_node * const *)b;
+
+    return (na->rng->floor > nb->rng->floor) - (na->rng->floor < nb->rng->floor);
+}
+
+/* sort the range children of node by floor, so a value can be placed by
+ * binary search; overlapping ranges keep the first-match list walk */
+static void
+build_range_index(stat_node *node)
+{
+    stat_node *child;
+    guint i, n = 0;
+
+    for (child = node->children; child; child = child->next) {
+        if (child->rng)
+            n++;
+    }
+
+    node->rng_index = g_new(stat_node *, n ? n : 1);
+    node->rng_index_len = n;
+    n = 0;
+    for (child = node->children; child; child = child->next) {
+        if (child->rng)
+            node->rng_index[n++] = child;
+    }
+    qsort(node->rng_index, n, sizeof(stat_node *), compare_range_floor);
+
+    for (i = 1; i < n; i++) {
+        if (node->rng_index[i]->rng->floor <= node->rng_index[i - 1]->rng->ceil) {
+            node->rng_index_len = G_MAXUINT;
+            break;
+        }
+    }
+}
+
 extern int
 stats_tree_tick_range(stats_tree *st, const gchar *name, int parent_id,
               int value_in_range)
@@ -918,7 +1094,6 @@ stats_tree_tick_range(stats_tree *st, const gchar *name, int parent_id,
     stat_node *node = NULL;
     stat_node *parent = NULL;
     stat_node *child = NULL;
-    gint stat_floor, stat_ceil;
 
     if (parent_id >= 0 && parent_id < (int) st->parents->len) {
         parent = (stat_node *)g_ptr_array_index(st->parents,parent_id);
@@ -926,11 +1101,7 @@ stats_tree_tick_range(stats_tree *st, const gchar *name, int parent_id,
         ws_assert_not_reached();
     }
 
-    if( parent->hash ) {
-        node = (stat_node *)g_hash_table_lookup(parent->hash,name);
-    } else {
-        node = (stat_node *)g_hash_table_lookup(st->names,name);
-    }
+    node = stats_tree_find_child(st,parent,name);
 
     if ( node == NULL )
         ws_assert_not_reached();
@@ -945,23 +1116,40 @@ stats_tree_tick_range(stats_tree *st, const gchar *name, int parent_id,
     }
     node->st_flags |= ST_FLG_AVERAGE;
 
-    for ( child = node->children; child; child = child->next) {
-        stat_floor =  child->rng->floor;
-        stat_ceil = child->rng->ceil;
+    if (!node->rng_index)
+        build_range_index(node);
 
-        if ( value_in_range >= stat_floor && value_in_range <= stat_ceil ) {
-            child->counter++;
-            child->total.int_total += value_in_range;
-            if (child->minvalue.int_min > value_in_range) {
-                child->minvalue.int_min = value_in_range;
-            }
-            if (child->maxvalue.int_max < value_in_range) {
-                child->maxvalue.int_max = value_in_range;
-            }
-            child->st_flags |= ST_FLG_AVERAGE;
-            update_burst_calc(child, 1);
-            return node->id;
+    if (node->rng_index_len != G_MAXUINT) {
+        /* disjoint ranges: find the last one starting at or below the value */
+        guint lo = 0, hi = node->rng_index_len;
+
+        while (lo < hi) {
+            guint mid = lo + (hi - lo) / 2;
+            if (node->rng_index[mid]->rng->floor <= value_in_range)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        child = (lo > 0 && value_in_range <= node->rng_index[lo - 1]->rng->ceil) ? node->rng_index[lo - 1] : NULL;
+    } else {
+        /* overlapping ranges: the first matching child wins */
+        for ( child = node->children; child; child = child->next) {
+            if ( child->rng && value_in_range >= child->rng->floor && value_in_range <= child->rng->ceil )
+                break;
+        }
+    }
+
+    if (child) {
+        child->counter++;
+        child->total.int_total += value_in_range;
+        if (child->minvalue.int_min > value_in_range) {
+            child->minvalue.int_min = value_in_range;
+        }
+        if (child->maxvalue.int_max < value_in_range) {
+            child->maxvalue.int_max = value_in_range;
         }
+        child->st_flags |= ST_FLG_AVERAGE;
+        update_burst_calc(child, 1);
     }
 
     return node->id;
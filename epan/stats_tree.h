@@ -127,6 +127,19 @@ WS_DLL_PUBLIC int stats_tree_create_node(stats_tree *st,
                                          stat_node_datatype datatype,
                                          gboolean with_children);
 
+/* Creates a node like stats_tree_create_node(), but one that keeps at most
+ * max_children of the leaf children ticked under it: once full, a new name
+ * takes over the leaf with the lowest count (Space-Saving heavy hitters).
+ * Meant for children keyed on unbounded values such as host names; the busiest
+ * names are kept and memory stays bounded, at the cost of approximate counts
+ * for names that came in late.
+ */
+WS_DLL_PUBLIC int stats_tree_create_topk_node(stats_tree *st,
+                                              const gchar *name,
+                                              int parent_id,
+                                              stat_node_datatype datatype,
+                                              guint max_children);
+
 /* creates a node using its parent's tree name */
 WS_DLL_PUBLIC int stats_tree_create_node_by_pname(stats_tree *st,
                                                   const gchar *name,
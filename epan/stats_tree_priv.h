@@ -81,8 +81,13 @@ struct _stat_node {
 	gint			max_burst;
 	double			burst_time;
 
-	/** children nodes by name */
+	/** children nodes by name; created with the first child even when
+	 *  not asked for, so looking up a child never walks the list */
 	GHashTable		*hash;
+	/** whether the hash was asked for when the node was created */
+	gboolean		with_hash;
+	/** if non-zero, keep at most this many leaf children (Space-Saving) */
+	guint			max_children;
 
 	/** the owner of this node */
 	stats_tree		*st;
@@ -90,10 +95,15 @@ struct _stat_node {
 	/** relatives */
 	stat_node		*parent;
 	stat_node		*children;
+	stat_node		*last_child;
 	stat_node		*next;
 
 	/** used to check if value is within range */
 	range_pair_t		*rng;
+	/** range children sorted by floor, built by the first tick_range;
+	 *  rng_index_len is G_MAXUINT if the ranges overlap */
+	stat_node		**rng_index;
+	guint			rng_index_len;
 
 	/** node presentation data */
 	st_node_pres		*pr;
@@ -183,6 +193,10 @@ WS_DLL_PUBLIC tap_packet_status stats_tree_packet(void*, packet_info*, epan_diss
 /** callback for reset */
 WS_DLL_PUBLIC void stats_tree_reset(void *p_st);
 
+/** callback for merge: adds in the results of another tree of the
+ *  same kind that tapped a later range of frames */
+WS_DLL_PUBLIC void stats_tree_merge(void *p_st, const void *p_shard);
+
 /** callback for clear */
 WS_DLL_PUBLIC void stats_tree_reinit(void *p_st);
 
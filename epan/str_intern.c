@@ -0,0 +1,139 @@
+/* str_intern.c
+ * Interned strings, shared by everything that dissects the same file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/wmem_scopes.h>
+
+#include "str_intern.h"
+
+/*
+ * Both the keys of the table and the keys we look up with. A lookup key
+ * points into the caller's buffer, e.g. a tvbuff, so that a string that
+ * has been seen before can be found without copying it first; a key in
+ * the table is followed by its null-terminated string.
+ */
+typedef struct {
+    const gchar *str;
+    gsize len;
+    guint hash;
+} str_intern_key_t;
+
+static wmem_map_t *interned_strings;
+
+static guint
+str_intern_hash_bytes(const gchar *str, gsize len)
+{
+    /* The same hash as g_str_hash(), without stopping at a null */
+    guint32 hash = 5381;
+    gsize i;
+
+    for (i = 0; i < len; i++)
+        hash = (hash << 5) + hash + (guint8)str[i];
+    return hash;
+}
+
+static guint
+str_intern_key_hash(gconstpointer key)
+{
+    return ((const str_intern_key_t *)key)->hash;
+}
+
+static gboolean
+str_intern_key_equal(gconstpointer a, gconstpointer b)
+{
+    const str_intern_key_t *key_a = (const str_intern_key_t *)a;
+    const str_intern_key_t *key_b = (const str_intern_key_t *)b;
+
+    return key_a->hash == key_b->hash && key_a->len == key_b->len &&
+        memcmp(key_a->str, key_b->str, key_a->len) == 0;
+}
+
+void
+str_intern_init(void)
+{
+    /* The entries go away with the file scope, the table with epan */
+    interned_strings = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+                                              str_intern_key_hash, str_intern_key_equal);
+}
+
+const gchar *
+str_intern_len(const gchar *str, gsize len)
+{
+    str_intern_key_t key;
+    str_intern_key_t *interned;
+    gchar *interned_str;
+
+    if (str == NULL)
+        return NULL;
+
+    key.str = str;
+    key.len = len;
+    key.hash = str_intern_hash_bytes(str, len);
+
+    interned = (str_intern_key_t *)wmem_map_lookup(interned_strings, &key);
+    if (interned != NULL)
+        return interned->str;
+
+    interned = (str_intern_key_t *)wmem_alloc(wmem_file_scope(), sizeof(str_intern_key_t) + len + 1);
+    interned_str = (gchar *)(interned + 1);
+    memcpy(interned_str, str, len);
+    interned_str[len] = '\0';
+    interned->str = interned_str;
+    interned->len = len;
+    interned->hash = key.hash;
+    wmem_map_insert(interned_strings, interned, interned);
+
+    return interned_str;
+}
+
+const gchar *
+str_intern(const gchar *str)
+{
+    if (str == NULL)
+        return NULL;
+    return str_intern_len(str, strlen(str));
+}
+
+const gchar *
+tvb_get_string_enc_interned(tvbuff_t *tvb, const gint offset, const gint length,
+                            const guint encoding)
+{
+    const guint8 *ptr;
+    guint8 *str;
+    const gchar *interned;
+
+    /* The common case: valid ASCII or UTF-8, interned straight from the tvbuff */
+    ptr = tvb_get_string_enc_ptr(tvb, offset, length, encoding);
+    if (ptr != NULL)
+        return str_intern_len((const gchar *)ptr, (gsize)length);
+
+    str = tvb_get_string_enc(NULL, tvb, offset, length, encoding);
+    interned = str_intern((const gchar *)str);
+    wmem_free(NULL, str);
+    return interned;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
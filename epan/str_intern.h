@@ -0,0 +1,68 @@
+/** @file
+ *
+ * Interned strings, shared by everything that dissects the same file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __STR_INTERN_H__
+#define __STR_INTERN_H__
+
+#include <epan/tvbuff.h>
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Field values such as host names, DNS query names or topic names repeat
+ * across a capture. Dissectors and taps that keep such a value beyond
+ * the current packet can intern it instead of copying it: every distinct
+ * string is stored only once, and interning an equal string again returns
+ * the same pointer, so two interned strings are equal if and only if the
+ * pointers are.
+ *
+ * Interned strings are allocated in file scope and must not be freed;
+ * they are all released, and the table emptied, when the file scope is.
+ * They can therefore only be interned while a file is being dissected.
+ */
+
+/** Intern a null-terminated string. Returns NULL if str is NULL. */
+WS_DLL_PUBLIC const gchar *str_intern(const gchar *str);
+
+/** Intern the first len bytes of str, which need not be null-terminated.
+ * The interned copy is null-terminated. */
+WS_DLL_PUBLIC const gchar *str_intern_len(const gchar *str, gsize len);
+
+/** Intern a string from a tvbuff, as tvb_get_string_enc() would return it.
+ * If the string is valid ASCII or UTF-8 and has been interned before,
+ * nothing is allocated. */
+WS_DLL_PUBLIC const gchar *tvb_get_string_enc_interned(tvbuff_t *tvb,
+    const gint offset, const gint length, const guint encoding);
+
+/* For epan.c */
+extern void str_intern_init(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __STR_INTERN_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -74,10 +74,26 @@ typedef struct _tap_packet_t {
 
 #define TAP_PACKET_IS_ERROR_PACKET	0x00000001	/* packet being queued is an error packet */
 
-#define TAP_PACKET_QUEUE_LEN 5000
-static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
+/* The queue starts out with room for this many packets and grows as
+ * needed; it is reused for every packet so it only grows a few times. */
+#define TAP_PACKET_QUEUE_LEN 64
+static tap_packet_t *tap_packet_array;
+static guint tap_packet_array_len;
 static guint tap_packet_index;
 
+/*
+ * Listeners with the same filter string share one of these, so that the
+ * filter is only run once per packet however many listeners use it; IO
+ * graphs and "limit to display filter" taps tend to repeat filters.
+ */
+typedef struct _tap_filter_group_t {
+	gchar *fstring;
+	guint refcount;
+	guint64 serial;		/* packet the cached result belongs to */
+	gboolean passed;
+	guint64 primed;		/* tap_build_interesting() call that primed it */
+} tap_filter_group_t;
+
 typedef struct _tap_listener_t {
 	struct _tap_listener_t *next;
 	int tap_id;
@@ -86,17 +102,116 @@ typedef struct _tap_listener_t {
 	guint flags;
 	gchar *fstring;
 	dfilter_t *code;
+	tap_filter_group_t *filter_group;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
 	tap_draw_cb draw;
 	tap_finish_cb finish;
+	tap_merge_cb merge;
 } tap_listener_t;
 
 static tap_listener_t *tap_listener_queue=NULL;
 
+/* The listeners of tap_listener_queue again, as one GPtrArray per tap id
+ * (oldest first, so walked backwards to keep the queue order), so that
+ * pushing a tapped packet only looks at the listeners of its own tap. */
+static GPtrArray *tap_listener_index=NULL;
+
 static GSList *tap_plugins = NULL;
 
+static GHashTable *tap_filter_groups = NULL;
+/* Bumped for every packet handed to the tap listeners */
+static guint64 tap_packet_serial;
+static guint64 tap_prime_serial;
+
+static void
+tap_listener_set_filter_group(tap_listener_t *tl)
+{
+	tap_filter_group_t *group;
+
+	if(tl->filter_group){
+		group=tl->filter_group;
+		tl->filter_group=NULL;
+		if(--group->refcount==0){
+			/* frees the group and its fstring as well */
+			g_hash_table_remove(tap_filter_groups, group->fstring);
+		}
+	}
+
+	if(!tl->fstring || !tl->code){
+		return;
+	}
+
+	if(!tap_filter_groups){
+		tap_filter_groups=g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+	}
+	group=(tap_filter_group_t *)g_hash_table_lookup(tap_filter_groups, tl->fstring);
+	if(!group){
+		group=(tap_filter_group_t *)g_malloc0(sizeof(tap_filter_group_t) + strlen(tl->fstring) + 1);
+		group->fstring=(gchar *)(group + 1);
+		strcpy(group->fstring, tl->fstring);
+		g_hash_table_insert(tap_filter_groups, group->fstring, group);
+	}
+	group->refcount++;
+	tl->filter_group=group;
+}
+
+/* Run the listener's filter, or reuse the result another listener with
+ * the same filter already got for this packet */
+static gboolean
+tap_listener_filter_passes(tap_listener_t *tl, epan_dissect_t *edt)
+{
+	tap_filter_group_t *group=tl->filter_group;
+
+	if(!group){
+		return dfilter_apply_edt(tl->code, edt);
+	}
+	if(group->serial!=tap_packet_serial){
+		group->passed=dfilter_apply_edt(tl->code, edt);
+		group->serial=tap_packet_serial;
+	}
+	return group->passed;
+}
+
+static GPtrArray *
+tap_listeners_for_id(int tap_id)
+{
+	if(!tap_listener_index || tap_id < 0 || (guint)tap_id >= tap_listener_index->len){
+		return NULL;
+	}
+	return (GPtrArray *)g_ptr_array_index(tap_listener_index, tap_id);
+}
+
+static void
+tap_listener_index_add(tap_listener_t *tl)
+{
+	GPtrArray *listeners;
+
+	if(!tap_listener_index){
+		tap_listener_index=g_ptr_array_new();
+	}
+	if((guint)tl->tap_id >= tap_listener_index->len){
+		g_ptr_array_set_size(tap_listener_index, tl->tap_id + 1);
+	}
+	listeners=tap_listeners_for_id(tl->tap_id);
+	if(!listeners){
+		listeners=g_ptr_array_new();
+		g_ptr_array_index(tap_listener_index, tl->tap_id)=listeners;
+	}
+	g_ptr_array_add(listeners, tl);
+}
+
+static void
+tap_listener_index_remove(tap_listener_t *tl)
+{
+	GPtrArray *listeners=tap_listeners_for_id(tl->tap_id);
+
+	if(listeners){
+		g_ptr_array_remove(listeners, tl);
+	}
+}
+
 #ifdef HAVE_PLUGINS
 void
 tap_register_plugin(const tap_plugin *plug)
@@ -233,13 +348,9 @@ tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
 	if(!tapping_is_active){
 		return;
 	}
-	/*
-	 * XXX - should we allocate this with an ep_allocator,
-	 * rather than having a fixed maximum number of entries?
-	 */
-	if(tap_packet_index >= TAP_PACKET_QUEUE_LEN){
-		ws_warning("Too many taps queued");
-		return;
+	if(tap_packet_index >= tap_packet_array_len){
+		tap_packet_array_len = tap_packet_array_len ? tap_packet_array_len * 2 : TAP_PACKET_QUEUE_LEN;
+		tap_packet_array = g_renew(tap_packet_t, tap_packet_array, tap_packet_array_len);
 	}
 
 	tpt=&tap_packet_array[tap_packet_index];
@@ -270,9 +381,16 @@ void tap_build_interesting (epan_dissect_t *edt)
 	}
 
 	/* loop over all tap listeners and build the list of all
-	   interesting hf_fields */
+	   interesting hf_fields, once per distinct filter */
+	tap_prime_serial++;
 	for(tl=tap_listener_queue;tl;tl=tl->next){
 		if(tl->code){
+			if(tl->filter_group){
+				if(tl->filter_group->primed==tap_prime_serial){
+					continue;
+				}
+				tl->filter_group->primed=tap_prime_serial;
+			}
 			epan_dissect_prime_with_dfilter(edt, tl->code);
 		}
 	}
@@ -293,6 +411,7 @@ tap_queue_init(epan_dissect_t *edt)
 	tapping_is_active=TRUE;
 
 	tap_packet_index=0;
+	tap_packet_serial++;
 
 	tap_build_interesting (edt);
 }
@@ -305,7 +424,8 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 {
 	tap_packet_t *tp;
 	tap_listener_t *tl;
-	guint i;
+	GPtrArray *listeners;
+	guint i, j;
 
 	/* nothing to do, just return */
 	if(!tapping_is_active){
@@ -322,58 +442,61 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 	/* loop over all tap listeners and call the listener callback
 	   for all packets that match the filter. */
 	for(i=0;i<tap_packet_index;i++){
-		for(tl=tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
+		tp=&tap_packet_array[i];
+		listeners=tap_listeners_for_id(tp->tap_id);
+		if(!listeners){
+			continue;
+		}
+		for(j=listeners->len;j>0;j--){
+			tl=(tap_listener_t *)g_ptr_array_index(listeners, j-1);
 			/* Don't tap the packet if it's an "error packet"
 			 * unless the listener has requested that we do so.
 			 */
 			if (!(tp->flags & TAP_PACKET_IS_ERROR_PACKET) || (tl->flags & TL_REQUIRES_ERROR_PACKETS))
 			{
-				if(tp->tap_id==tl->tap_id){
-					if(!tl->packet){
-						/* There isn't a per-packet
-						 * routine for this tap.
-						 */
-						continue;
-					}
-					if(tl->failed){
-						/* A previous call failed,
-						 * meaning "stop running this
-						 * tap", so don't call the
-						 * packet routine.
-						 */
-						continue;
-					}
-
-					/* If we have a filter, see if the
-					 * packet passes.
+				if(!tl->packet){
+					/* There isn't a per-packet
+					 * routine for this tap.
+					 */
+					continue;
+				}
+				if(tl->failed){
+					/* A previous call failed,
+					 * meaning "stop running this
+					 * tap", so don't call the
+					 * packet routine.
 					 */
-					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
-							/* The packet didn't
-							 * pass the filter. */
-							continue;
-						}
+					continue;
+				}
+
+				/* If we have a filter, see if the
+				 * packet passes.
+				 */
+				if(tl->code){
+					if (!tap_listener_filter_passes(tl, edt)){
+						/* The packet didn't
+						 * pass the filter. */
+						continue;
 					}
+				}
 
-					/* So call the per-packet routine. */
-					tap_packet_status status;
+				/* So call the per-packet routine. */
+				tap_packet_status status;
 
-					status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+				status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
 
-					switch (status) {
+				switch (status) {
 
-					case TAP_PACKET_DONT_REDRAW:
-						break;
+				case TAP_PACKET_DONT_REDRAW:
+					break;
 
-					case TAP_PACKET_REDRAW:
-						tl->needs_redraw=TRUE;
-						break;
+				case TAP_PACKET_REDRAW:
+					tl->needs_redraw=TRUE;
+					break;
 
-					case TAP_PACKET_FAILED:
-						tl->failed=TRUE;
-						break;
-					}
+				case TAP_PACKET_FAILED:
+					tl->failed=TRUE;
+					break;
 				}
 			}
 		}
@@ -465,6 +588,21 @@ draw_tap_listeners(gboolean draw_all)
 	}
 }
 
+void
+draw_tap_listener(void *tapdata)
+{
+	tap_listener_t *tl;
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(tl->tapdata==tapdata){
+			if(tl->draw){
+				tl->draw(tl->tapdata);
+			}
+			tl->needs_redraw=FALSE;
+		}
+	}
+}
+
 /* Gets a GList of the tap names. The content of the list
    is owned by the tap table and should not be modified or freed.
    Use g_list_free() when done using the list. */
@@ -517,8 +655,10 @@ free_tap_listener(tap_listener_t *tl)
 	if (tl->finish) {
 		tl->finish(tl->tapdata);
 	}
-	dfilter_free(tl->code);
 	g_free(tl->fstring);
+	tl->fstring=NULL;
+	tap_listener_set_filter_group(tl);
+	dfilter_free(tl->code);
 	g_free(tl);
 }
 
@@ -563,6 +703,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	}
 	tl->fstring=g_strdup(fstring);
 	tl->code=code;
+	tap_listener_set_filter_group(tl);
 
 	tl->tap_id=tap_id;
 	tl->tapdata=tapdata;
@@ -573,6 +714,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	tap_listener_index_add(tl);
 
 	return NULL;
 }
@@ -613,6 +755,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 		if(fstring){
 			if(!dfilter_compile(fstring, &code, &err_msg)){
 				tl->fstring=NULL;
+				tap_listener_set_filter_group(tl);
 				error_string = g_string_new("");
 				g_string_printf(error_string,
 						 "Filter \"%s\" is invalid - %s",
@@ -623,11 +766,62 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 		}
 		tl->fstring=g_strdup(fstring);
 		tl->code=code;
+		tap_listener_set_filter_group(tl);
 	}
 
 	return NULL;
 }
 
+static tap_listener_t *
+find_tap_listener(const void *tapdata)
+{
+	tap_listener_t *tl;
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(tl->tapdata==tapdata){
+			return tl;
+		}
+	}
+	return NULL;
+}
+
+void
+set_tap_merge(void *tapdata, tap_merge_cb merge)
+{
+	tap_listener_t *tl=find_tap_listener(tapdata);
+
+	if(tl){
+		tl->merge=merge;
+	}
+}
+
+void
+merge_tap_listener(void *tapdata, const void *shard_tapdata)
+{
+	tap_listener_t *tl=find_tap_listener(tapdata);
+
+	if(tl && tl->merge){
+		tl->merge(tl->tapdata, shard_tapdata);
+		tl->needs_redraw=TRUE;
+	}
+}
+
+/*
+ * Return TRUE if every listener that requires dissection can merge shard
+ * results, FALSE otherwise.
+ */
+gboolean
+tap_listeners_mergeable(void)
+{
+	tap_listener_t *tl;
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(!tl->merge && !(tl->flags & TL_IS_DISSECTOR_HELPER))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /* this function recompiles dfilter for all registered tap listeners
  */
 void
@@ -685,6 +879,7 @@ remove_tap_listener(void *tapdata)
 			return;
 		}
 	}
+	tap_listener_index_remove(tl);
 	free_tap_listener(tl);
 }
 
@@ -712,16 +907,18 @@ tap_listeners_require_dissection(void)
 gboolean
 have_tap_listener(int tap_id)
 {
-	tap_listener_t *tap_queue = tap_listener_queue;
+	GPtrArray *listeners = tap_listeners_for_id(tap_id);
 
-	while(tap_queue) {
-		if(tap_queue->tap_id == tap_id)
-			return TRUE;
+	return listeners && listeners->len > 0;
+}
 
-		tap_queue = tap_queue->next;
-	}
+/* Returns the number of active tap listeners for the specified tap id. */
+guint
+num_tap_listeners(int tap_id)
+{
+	GPtrArray *listeners = tap_listeners_for_id(tap_id);
 
-	return FALSE;
+	return listeners ? listeners->len : 0;
 }
 
 /*
@@ -769,6 +966,22 @@ void tap_cleanup(void)
 		free_tap_listener(elem_lq);
 	}
 	tap_listener_queue = NULL;
+	if (tap_listener_index) {
+		for (guint i = 0; i < tap_listener_index->len; i++) {
+			if (g_ptr_array_index(tap_listener_index, i))
+				g_ptr_array_free((GPtrArray *)g_ptr_array_index(tap_listener_index, i), TRUE);
+		}
+		g_ptr_array_free(tap_listener_index, TRUE);
+		tap_listener_index = NULL;
+	}
+	if (tap_filter_groups) {
+		g_hash_table_destroy(tap_filter_groups);
+		tap_filter_groups = NULL;
+	}
+	g_free(tap_packet_array);
+	tap_packet_array = NULL;
+	tap_packet_array_len = 0;
+	tap_packet_index = 0;
 
 	while(head_dl){
 		elem_dl = head_dl;
@@ -32,6 +32,7 @@ typedef void (*tap_reset_cb)(void *tapdata);
 typedef tap_packet_status (*tap_packet_cb)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data);
 typedef void (*tap_draw_cb)(void *tapdata);
 typedef void (*tap_finish_cb)(void *tapdata);
+typedef void (*tap_merge_cb)(void *tapdata, const void *shard_tapdata);
 
 /**
  * Flags to indicate what a tap listener's packet routine requires.
@@ -145,6 +146,11 @@ WS_DLL_PUBLIC void reset_tap_listeners(void);
  */
 WS_DLL_PUBLIC void draw_tap_listeners(gboolean draw_all);
 
+/** Draws only the tap listener(s) registered with tapdata, e.g. to output
+ * the results of several requests served by the same rescan one by one.
+ */
+WS_DLL_PUBLIC void draw_tap_listener(void *tapdata);
+
 /** this function attaches the tap_listener to the named tap.
  * function returns :
  *     NULL: ok.
@@ -229,6 +235,30 @@ WS_DLL_PUBLIC GString *register_tap_listener(const char *tapname, void *tapdata,
 /** This function sets a new dfilter to a tap listener */
 WS_DLL_PUBLIC GString *set_tap_dfilter(void *tapdata, const char *fstring);
 
+/** Declare that the results of a tap listener merge cleanly.
+ *
+ * A listener whose statistics only add up (counts, sums, minima and
+ * maxima, ...) can have a capture retapped in shards: a second instance
+ * of the same kind, registered with the same filter, is reset and fed a
+ * disjoint range of frames that comes after those of this one, and
+ * tap_merge then folds its results into tapdata. The shard instance is
+ * not modified and is removed by the caller afterwards.
+ *
+ * @param tapdata the listener, as passed to register_tap_listener()
+ * @param tap_merge void (*merge)(void *tapdata, const void *shard_tapdata)
+ */
+WS_DLL_PUBLIC void set_tap_merge(void *tapdata, tap_merge_cb tap_merge);
+
+/** Fold the results of shard_tapdata into those of tapdata using the merge
+ *  callback set with set_tap_merge(), and mark tapdata for redraw. */
+WS_DLL_PUBLIC void merge_tap_listener(void *tapdata, const void *shard_tapdata);
+
+/**
+ * Return TRUE if every tap listener that requires dissection has a merge
+ * callback, i.e. a retap could be split into shards, FALSE otherwise.
+ */
+WS_DLL_PUBLIC gboolean tap_listeners_mergeable(void);
+
 /** This function recompiles dfilter for all registered tap listeners */
 WS_DLL_PUBLIC void tap_listeners_dfilter_recompile(void);
 
@@ -244,6 +274,9 @@ WS_DLL_PUBLIC gboolean tap_listeners_require_dissection(void);
 /** Returns TRUE there is an active tap listener for the specified tap id. */
 WS_DLL_PUBLIC gboolean have_tap_listener(int tap_id);
 
+/** Returns the number of active tap listeners for the specified tap id. */
+WS_DLL_PUBLIC guint num_tap_listeners(int tap_id);
+
 /** Return TRUE if we have any tap listeners with filters, FALSE otherwise. */
 WS_DLL_PUBLIC gboolean have_filtering_tap_listeners(void);
 
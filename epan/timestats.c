@@ -13,6 +13,51 @@
 
 #include "timestats.h"
 
+#include <string.h>
+
+#include <wsutil/bits_ctz.h>
+
+#define TIME_STAT_HIST_SUB_BUCKETS (1 << TIME_STAT_HIST_SUB_BITS)
+
+/* Histogram bucket of a sample */
+static guint
+time_stat_bucket(const nstime_t *delta)
+{
+	guint64 usecs;
+	int exp;
+
+	if (delta->secs < 0 || (delta->secs == 0 && delta->nsecs <= 0))
+		return 0;
+
+	usecs = (guint64)delta->secs * 1000000 + delta->nsecs / 1000;
+	if (usecs < TIME_STAT_HIST_SUB_BUCKETS)
+		return (guint)usecs;
+
+	exp = ws_ilog2(usecs);
+	if (exp > TIME_STAT_HIST_MAX_EXP)
+		return TIME_STAT_HIST_BUCKETS - 1;
+
+	return (exp - TIME_STAT_HIST_SUB_BITS + 1) * TIME_STAT_HIST_SUB_BUCKETS +
+		(guint)((usecs >> (exp - TIME_STAT_HIST_SUB_BITS)) - TIME_STAT_HIST_SUB_BUCKETS);
+}
+
+/* Middle of a histogram bucket, in microseconds */
+static gdouble
+time_stat_bucket_value(guint bucket)
+{
+	guint octave, sub;
+	int shift;
+
+	if (bucket < TIME_STAT_HIST_SUB_BUCKETS)
+		return bucket + 0.5;
+
+	octave = bucket >> TIME_STAT_HIST_SUB_BITS;
+	sub = bucket & (TIME_STAT_HIST_SUB_BUCKETS - 1);
+	shift = octave - 1;
+
+	return ((gdouble)(TIME_STAT_HIST_SUB_BUCKETS + sub) + 0.5) * (gdouble)((guint64)1 << shift);
+}
+
 /* Initialize a timestat_t struct */
 void
 time_stat_init(timestat_t *stats)
@@ -24,6 +69,7 @@ time_stat_init(timestat_t *stats)
 	nstime_set_zero(&stats->max);
 	nstime_set_zero(&stats->tot);
 	stats->variance = 0.0;
+	memset(stats->hist, 0, sizeof stats->hist);
 }
 
 /* Update a timestat_t struct with a new sample */
@@ -53,6 +99,8 @@ time_stat_update(timestat_t *stats, const nstime_t *delta, packet_info *pinfo)
 
 	nstime_add(&stats->tot, delta);
 
+	stats->hist[time_stat_bucket(delta)]++;
+
 	stats->num++;
 }
 
@@ -77,6 +125,47 @@ gdouble get_average(const nstime_t *sum, guint32 num)
 	return average;
 }
 
+gdouble
+time_stat_percentile(const timestat_t *stats, gdouble percentile)
+{
+	guint64 rank, seen = 0;
+	gdouble value, min, max;
+	guint i;
+
+	if (stats->num == 0)
+		return 0;
+
+	min = nstime_to_msec(&stats->min);
+	max = nstime_to_msec(&stats->max);
+	if (percentile <= 0)
+		return min;
+	if (percentile >= 100)
+		return max;
+
+	/* Nearest rank: the smallest sample with at least percentile% of
+	   the samples at or below it. */
+	rank = (guint64)(percentile * stats->num / 100.0);
+	if ((gdouble)rank < percentile * stats->num / 100.0)
+		rank++;
+	if (rank == 0)
+		rank = 1;
+
+	for (i = 0; i < TIME_STAT_HIST_BUCKETS - 1; i++) {
+		seen += stats->hist[i];
+		if (seen >= rank)
+			break;
+	}
+	value = time_stat_bucket_value(i) / 1000.0;
+
+	/* The exact extremes are known; an estimate can't be outside them */
+	if (value < min)
+		value = min;
+	if (value > max)
+		value = max;
+
+	return value;
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
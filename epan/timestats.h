@@ -20,6 +20,18 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/*
+ * Log-linear histogram of the samples, in microseconds, used for the
+ * percentiles. Samples below 2^TIME_STAT_HIST_SUB_BITS usecs get a bucket
+ * each; above that every power of two is split in 2^TIME_STAT_HIST_SUB_BITS
+ * equal buckets, so an estimate is never off by more than half a bucket,
+ * about 3% of the value. Samples of 2^(TIME_STAT_HIST_MAX_EXP+1) usecs
+ * (about 19 hours) and more all go in the last bucket.
+ */
+#define TIME_STAT_HIST_SUB_BITS 4
+#define TIME_STAT_HIST_MAX_EXP 35
+#define TIME_STAT_HIST_BUCKETS ((TIME_STAT_HIST_MAX_EXP - TIME_STAT_HIST_SUB_BITS + 2) << TIME_STAT_HIST_SUB_BITS)
+
  /* Summary of time statistics*/
 typedef struct _timestat_t {
 	guint32 num;	 /* number of samples */
@@ -29,6 +41,7 @@ typedef struct _timestat_t {
 	nstime_t max;
 	nstime_t tot;
 	gdouble variance;
+	guint32 hist[TIME_STAT_HIST_BUCKETS]; /* sample counts, see above */
 } timestat_t;
 
 /* functions */
@@ -41,6 +54,10 @@ WS_DLL_PUBLIC void time_stat_update(timestat_t *stats, const nstime_t *delta, pa
 
 WS_DLL_PUBLIC gdouble get_average(const nstime_t *sum, guint32 num);
 
+/* Estimate the given percentile (0-100) of the samples, in milliseconds
+   like get_average(). 0 if there are no samples. */
+WS_DLL_PUBLIC gdouble time_stat_percentile(const timestat_t *stats, gdouble percentile);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -183,15 +183,22 @@ static int cond_chars_common(tvbparse_t* tt, int offset, const tvbparse_wanted_t
 
     left = left < (int) wanted->max ? left :  (int) wanted->max;
 
-    while( left > 0 ) {
-        guint8 t = tvb_get_guint8(tt->tvb,offset++);
-
-        if (!wanted->control.str[t])
-            break;
-
-        length++;
-        left--;
-    };
+    if (left > 0) {
+        /*
+         * Look at the bytes in place rather than fetching each one from
+         * the tvb; runs of text in XML are often thousands of bytes long.
+         */
+        int avail = tvb_captured_length_remaining(tt->tvb, offset);
+        int n = avail < left ? (avail > 0 ? avail : 0) : left;
+        const guint8 *p = tvb_get_ptr(tt->tvb, offset, n);
+
+        while (length < (guint)n && wanted->control.str[p[length]])
+            length++;
+
+        /* Running past the captured data throws, as it always has */
+        if (length == (guint)n && n < left)
+            tvb_get_guint8(tt->tvb, offset + n);
+    }
 
     if (length < wanted->min) {
         return  -1;
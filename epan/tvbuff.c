@@ -33,6 +33,7 @@
 #include "wsutil/nstime.h"
 #include "wsutil/time_util.h"
 #include <wsutil/ws_assert.h>
+#include "ws_attributes.h"
 #include "tvbuff.h"
 #include "tvbuff-int.h"
 #include "strutil.h"
@@ -58,15 +59,58 @@ ensure_contiguous(tvbuff_t *tvb, const gint offset, const gint length);
 static inline guint8 *
 tvb_get_raw_string(wmem_allocator_t *scope, tvbuff_t *tvb, const gint offset, const gint length);
 
+/*
+ * Freed tvbuffs, kept for reuse; dissecting a packet creates dozens of
+ * tvbuffs, mostly subsets, and frees them all at the end, so, most of
+ * the time, a new tvbuff is just taken off a list. Each list holds
+ * tvbuffs of one size, linked through their "next" pointers. The lists
+ * are per thread, so they need no locking.
+ */
+#define TVB_FREELIST_COUNT	4
+#define TVB_FREELIST_MAX_LEN	1024
+
+typedef struct {
+	gsize     size;		/* 0 if the list hasn't been used */
+	guint     len;
+	tvbuff_t *head;
+} tvb_freelist_t;
+
+static WS_THREAD_LOCAL tvb_freelist_t tvb_freelists[TVB_FREELIST_COUNT];
+
+/* Get the free list for tvbuffs of this size, or NULL if there isn't one */
+static inline tvb_freelist_t *
+tvb_get_freelist(gsize size)
+{
+	guint i;
+
+	for (i = 0; i < TVB_FREELIST_COUNT; i++) {
+		if (tvb_freelists[i].size == size)
+			return &tvb_freelists[i];
+		if (tvb_freelists[i].size == 0) {
+			tvb_freelists[i].size = size;
+			return &tvb_freelists[i];
+		}
+	}
+	return NULL;
+}
+
 tvbuff_t *
 tvb_new(const struct tvb_ops *ops)
 {
-	tvbuff_t *tvb;
-	gsize     size = ops->tvb_size;
+	tvbuff_t       *tvb;
+	gsize           size = ops->tvb_size;
+	tvb_freelist_t *freelist;
 
 	ws_assert(size >= sizeof(*tvb));
 
-	tvb = (tvbuff_t *) g_slice_alloc(size);
+	freelist = tvb_get_freelist(size);
+	if (freelist != NULL && freelist->head != NULL) {
+		tvb = freelist->head;
+		freelist->head = tvb->next;
+		freelist->len--;
+	} else {
+		tvb = (tvbuff_t *) g_slice_alloc(size);
+	}
 
 	tvb->next		 = NULL;
 	tvb->ops		 = ops;
@@ -85,7 +129,8 @@ tvb_new(const struct tvb_ops *ops)
 static void
 tvb_free_internal(tvbuff_t *tvb)
 {
-	gsize     size;
+	gsize           size;
+	tvb_freelist_t *freelist;
 
 	DISSECTOR_ASSERT(tvb);
 
@@ -94,6 +139,14 @@ tvb_free_internal(tvbuff_t *tvb)
 
 	size = tvb->ops->tvb_size;
 
+	freelist = tvb_get_freelist(size);
+	if (freelist != NULL && freelist->len < TVB_FREELIST_MAX_LEN) {
+		tvb->next = freelist->head;
+		freelist->head = tvb;
+		freelist->len++;
+		return;
+	}
+
 	g_slice_free1(size, tvb);
 }
 
@@ -2283,7 +2336,7 @@ tvb_find_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 	if (tvb->ops->tvb_find_guint8)
 		return tvb->ops->tvb_find_guint8(tvb, abs_offset, limit, needle);
 
-	return tvb_find_guint8_generic(tvb, offset, limit, needle);
+	return tvb_find_guint8_generic(tvb, abs_offset, limit, needle);
 }
 
 /* Same as tvb_find_guint8() with 16bit needle. */
@@ -3290,6 +3343,45 @@ tvb_get_string_enc(wmem_allocator_t *scope, tvbuff_t *tvb, const gint offset,
 	return strptr;
 }
 
+/*
+ * If the string is ASCII or UTF-8 and already valid, return a pointer to
+ * it in the tvbuff rather than a copy; otherwise return NULL, and the caller
+ * has to use tvb_get_string_enc().
+ */
+const guint8 *
+tvb_get_string_enc_ptr(tvbuff_t *tvb, const gint offset, const gint length,
+			     const guint encoding)
+{
+	const guint8 *ptr;
+
+	DISSECTOR_ASSERT(tvb && tvb->initialized);
+
+	/* make sure length = -1 fails */
+	if (length < 0) {
+		THROW(ReportedBoundsError);
+	}
+
+	switch (encoding & ENC_CHARENCODING_MASK) {
+
+	case ENC_ASCII:
+		ptr = ensure_contiguous(tvb, offset, length);
+		if (valid_ascii_prefix_length(ptr, length) == length)
+			return ptr;
+		break;
+
+	case ENC_UTF_8:
+		ptr = ensure_contiguous(tvb, offset, length);
+		if (valid_utf_8_prefix_length(ptr, length) == length)
+			return ptr;
+		break;
+
+	default:
+		break;
+	}
+
+	return NULL;
+}
+
 /*
  * This is like tvb_get_string_enc(), except that it handles null-padded
  * strings.
@@ -602,6 +602,26 @@ extern gchar *tvb_format_stringzpad_wsp(wmem_allocator_t* allocator, tvbuff_t *t
 WS_DLL_PUBLIC guint8 *tvb_get_string_enc(wmem_allocator_t *scope,
     tvbuff_t *tvb, const gint offset, const gint length, const guint encoding);
 
+/**
+ * Given a tvbuff, a byte offset, a byte length, and a string encoding,
+ * with the specified offset and length referring to a string in the
+ * specified encoding:
+ *
+ *    if the encoding is ENC_ASCII or ENC_UTF_8 and the string is
+ *    valid in that encoding, return a pointer to the string in the
+ *    tvbuff, without copying it;
+ *
+ *    otherwise return NULL.
+ *
+ * The string is *not* null-terminated, and may contain null characters.
+ * It is only valid for as long as the tvbuff is. If NULL is returned,
+ * use tvb_get_string_enc(), which replaces invalid octet sequences.
+ *
+ * Throws an exception if the tvbuff ends before the string does.
+ */
+WS_DLL_PUBLIC const guint8 *tvb_get_string_enc_ptr(tvbuff_t *tvb,
+    const gint offset, const gint length, const guint encoding);
+
 /**
  * Given an allocator scope, a tvbuff, a bit offset, and a length in
  * 7-bit characters (not octets!), with the specified offset and
@@ -1007,6 +1027,17 @@ WS_DLL_PUBLIC gint tvb_find_tvb(tvbuff_t *haystack_tvb, tvbuff_t *needle_tvb,
 
 /* From tvbuff_zlib.c */
 
+/**
+ * Sets the maximum number of bytes that tvb_uncompress(),
+ * tvb_uncompress_brotli() and their child variants will produce.
+ * Output beyond the limit is discarded as if the compressed data had
+ * been truncated there. 0, the default, means no limit.
+ */
+WS_DLL_PUBLIC void tvb_set_uncompress_max_length(guint max_length);
+
+/** Returns the limit set by tvb_set_uncompress_max_length(). */
+WS_DLL_PUBLIC guint tvb_get_uncompress_max_length(void);
+
 /**
  * Uncompresses a zlib compressed packet inside a tvbuff at offset with
  * length comprlen.  Returns an uncompressed tvbuffer if uncompression
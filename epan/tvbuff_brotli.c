@@ -49,13 +49,15 @@ tvbuff_t *
 tvb_uncompress_brotli(tvbuff_t *tvb, const int offset, int comprlen)
 {
     guint8              *compr;
-    guint8              *uncompr        = NULL;
+    GByteArray          *uncompr        = NULL;
+    guint8              *data;
     tvbuff_t            *uncompr_tvb;
     BrotliDecoderState  *decoder;
     guint8              *strmbuf;
     const size_t         bufsiz         = TVB_BROTLI_BUFSIZ;
     size_t               available_in;
     const guint8        *next_in;
+    const size_t         max_out        = tvb_get_uncompress_max_length();
     size_t               available_out;
     guint8              *next_out;
     size_t               total_out;
@@ -128,9 +130,22 @@ tvb_uncompress_brotli(tvbuff_t *tvb, const int offset, int comprlen)
          * to the buffer in this pass, so we calculate pass_out.
          */
         size_t pass_out = bufsiz - available_out;
+        if (max_out && total_out > max_out) {
+            /*
+             * Keep what fits under the limit and treat the rest
+             * as if it hadn't been captured.
+             */
+            pass_out -= total_out - max_out;
+            total_out = max_out;
+            needs_more_output = 0;
+            available_in = 0;
+        }
         if (pass_out > 0) {
-            uncompr = (guint8 *)g_realloc(uncompr, total_out);
-            memcpy(uncompr + (total_out - pass_out), strmbuf, pass_out);
+            /* Grows geometrically, so copying stays linear. */
+            if (uncompr == NULL) {
+                uncompr = g_byte_array_sized_new((guint)pass_out);
+            }
+            g_byte_array_append(uncompr, strmbuf, (guint)pass_out);
         }
     }
 
@@ -140,13 +155,15 @@ tvb_uncompress_brotli(tvbuff_t *tvb, const int offset, int comprlen)
          * length is 0.
          */
         if (finished) {
-            uncompr = (guint8 *)g_strdup("");
+            data = (guint8 *)g_strdup("");
         } else {
             goto cleanup;
         }
+    } else {
+        data = g_byte_array_free(uncompr, FALSE);
     }
 
-    uncompr_tvb = tvb_new_real_data((guint8 *)uncompr, (guint)total_out, (gint)total_out);
+    uncompr_tvb = tvb_new_real_data(data, (guint)total_out, (gint)total_out);
     tvb_set_free_cb(uncompr_tvb, g_free);
 
     g_free(strmbuf);
@@ -156,7 +173,9 @@ tvb_uncompress_brotli(tvbuff_t *tvb, const int offset, int comprlen)
 
 cleanup:
     g_free(strmbuf);
-    g_free(uncompr);
+    if (uncompr != NULL) {
+        g_byte_array_free(uncompr, TRUE);
+    }
     wmem_free(NULL, compr);
     BrotliDecoderDestroyInstance(decoder);
     return NULL;
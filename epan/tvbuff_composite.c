@@ -167,6 +167,73 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	DISSECTOR_ASSERT_NOT_REACHED();
 }
 
+/* Search the members in place for the first match found by find(), rather
+ * than having composite_get_ptr() flatten the whole composite. */
+typedef gint (*composite_find_func)(tvbuff_t *member_tvb, guint member_offset,
+		guint member_limit, const void *needle, guchar *found_needle);
+
+static gint
+composite_find(tvbuff_t *tvb, guint abs_offset, guint limit,
+		composite_find_func find, const void *needle, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i, num_members;
+	tvbuff_t   *member_tvb;
+	guint	    member_offset, member_limit;
+	GSList	   *slist;
+	gint	    result;
+
+	num_members = g_slist_length(composite->tvbs);
+
+	for (i = 0; i < num_members; i++) {
+		if (abs_offset <= composite->end_offsets[i])
+			break;
+	}
+
+	for (slist = g_slist_nth(composite->tvbs, i); slist && limit > 0; slist = slist->next, i++) {
+		member_tvb    = (tvbuff_t *)slist->data;
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_limit  = MIN(limit, member_tvb->length - member_offset);
+
+		result = find(member_tvb, member_offset, member_limit, needle, found_needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+
+		abs_offset += member_limit;
+		limit      -= member_limit;
+	}
+
+	return -1;
+}
+
+static gint
+composite_find_guint8_member(tvbuff_t *member_tvb, guint member_offset,
+		guint member_limit, const void *needle, guchar *found_needle _U_)
+{
+	return tvb_find_guint8(member_tvb, member_offset, member_limit, *(const guint8 *)needle);
+}
+
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
+{
+	return composite_find(tvb, abs_offset, limit, composite_find_guint8_member, &needle, NULL);
+}
+
+static gint
+composite_pbrk_guint8_member(tvbuff_t *member_tvb, guint member_offset,
+		guint member_limit, const void *needle, guchar *found_needle)
+{
+	return tvb_ws_mempbrk_pattern_guint8(member_tvb, member_offset, member_limit,
+			(const ws_mempbrk_pattern *)needle, found_needle);
+}
+
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle)
+{
+	return composite_find(tvb, abs_offset, limit, composite_pbrk_guint8_member, pattern, found_needle);
+}
+
 static const struct tvb_ops tvb_composite_ops = {
 	sizeof(struct tvb_composite), /* size */
 
@@ -174,8 +241,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
 };
 
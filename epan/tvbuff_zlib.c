@@ -25,6 +25,24 @@
 #include "tvbuff.h"
 #include <wsutil/wslog.h>
 
+/*
+ * Upper bound on the size of the data produced by tvb_uncompress() and
+ * the other tvb decompression routines; 0 means no limit.
+ */
+static guint uncompress_max_length;
+
+void
+tvb_set_uncompress_max_length(guint max_length)
+{
+	uncompress_max_length = max_length;
+}
+
+guint
+tvb_get_uncompress_max_length(void)
+{
+	return uncompress_max_length;
+}
+
 #ifdef HAVE_ZLIB
 /*
  * Uncompresses a zlib compressed packet inside a message of tvb at offset with
@@ -40,7 +58,7 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 	gint       err;
 	guint      bytes_out      = 0;
 	guint8    *compr;
-	guint8    *uncompr        = NULL;
+	GByteArray *uncompr       = NULL;
 	tvbuff_t  *uncompr_tvb    = NULL;
 	z_streamp  strm;
 	Bytef     *strmbuf;
@@ -75,7 +93,7 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 	strm->next_in   = next;
 	strm->avail_in  = comprlen;
 
-	strmbuf         = (Bytef *)g_malloc0(bufsiz);
+	strmbuf         = (Bytef *)g_malloc(bufsiz);
 	strm->next_out  = strmbuf;
 	strm->avail_out = bufsiz;
 
@@ -90,7 +108,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 	}
 
 	while (1) {
-		memset(strmbuf, '\0', bufsiz);
 		strm->next_out  = strmbuf;
 		strm->avail_out = bufsiz;
 
@@ -101,26 +118,30 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 
 			++inflate_passes;
 
-			if (uncompr == NULL) {
+			if (uncompress_max_length &&
+			    bytes_pass > uncompress_max_length - bytes_out) {
 				/*
-				 * This is ugly workaround for bug #6480
-				 * (https://gitlab.com/wireshark/wireshark/-/issues/6480)
-				 *
-				 * g_memdup2(..., 0) returns NULL (g_malloc(0) also)
-				 * when uncompr is NULL logic below doesn't create tvb
-				 * which is later interpreted as decompression failed.
+				 * Keep what fits under the limit and stop;
+				 * the result is treated like a truncated
+				 * stream.
 				 */
-				uncompr = (guint8 *)((bytes_pass || err != Z_STREAM_END) ?
-						g_memdup2(strmbuf, bytes_pass) :
-						g_strdup(""));
-			} else {
-				guint8 *new_data = (guint8 *)g_malloc0(bytes_out + bytes_pass);
-
-				memcpy(new_data, uncompr, bytes_out);
-				memcpy(new_data + bytes_out, strmbuf, bytes_pass);
+				bytes_pass = uncompress_max_length - bytes_out;
+				err = Z_STREAM_END;
+			}
 
-				g_free(uncompr);
-				uncompr = new_data;
+			/*
+			 * The output grows geometrically, so the total
+			 * amount of copying stays linear in its size.
+			 * A stream that ends without producing any output
+			 * still gets an array, so that it isn't taken for
+			 * a failure (bug #6480,
+			 * https://gitlab.com/wireshark/wireshark/-/issues/6480).
+			 */
+			if (uncompr == NULL && (bytes_pass || err == Z_STREAM_END)) {
+				uncompr = g_byte_array_sized_new(bytes_pass);
+			}
+			if (bytes_pass) {
+				g_byte_array_append(uncompr, strmbuf, bytes_pass);
 			}
 
 			bytes_out += bytes_pass;
@@ -266,7 +287,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 			strm->avail_in  = comprlen;
 
 			inflateEnd(strm);
-			memset(strmbuf, '\0', bufsiz);
 			strm->next_out  = strmbuf;
 			strm->avail_out = bufsiz;
 
@@ -278,7 +298,9 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 				g_free(strm);
 				g_free(strmbuf);
 				wmem_free(NULL, compr);
-				g_free(uncompr);
+				if (uncompr != NULL) {
+					g_byte_array_free(uncompr, TRUE);
+				}
 
 				return NULL;
 			}
@@ -300,7 +322,15 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 	ws_debug("bytes  in: %u\nbytes out: %u\n\n", bytes_in, bytes_out);
 
 	if (uncompr != NULL) {
-		uncompr_tvb =  tvb_new_real_data(uncompr, bytes_out, bytes_out);
+		guint8 *data;
+
+		if (uncompr->len == 0) {
+			g_byte_array_free(uncompr, TRUE);
+			data = (guint8 *)g_strdup("");
+		} else {
+			data = g_byte_array_free(uncompr, FALSE);
+		}
+		uncompr_tvb =  tvb_new_real_data(data, bytes_out, bytes_out);
 		tvb_set_free_cb(uncompr_tvb, g_free);
 	}
 	wmem_free(NULL, compr);
@@ -61,6 +61,8 @@ struct epan_uat {
     uat_rep_free_cb_t free_rep;
     gboolean loaded;
     gboolean from_global;
+    int deferred_proto; /**< Protocol whose first use loads this UAT, or -1 */
+    gboolean load_pending; /**< Loading is waiting for deferred_proto */
 };
 
 WS_DLL_PUBLIC
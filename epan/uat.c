@@ -92,6 +92,8 @@ uat_t* uat_new(const char* name,
     uat->changed = FALSE;
     uat->loaded = FALSE;
     uat->from_global = FALSE;
+    uat->deferred_proto = -1;
+    uat->load_pending = FALSE;
     uat->rep = NULL;
     uat->free_rep = NULL;
     uat->help = g_strdup(help);
@@ -253,12 +255,42 @@ gchar* uat_get_actual_filename(uat_t* uat, gboolean for_writing) {
     return pers_fname;
 }
 
+static void uat_load_reporting(uat_t* u) {
+    gchar* err = NULL;
+
+    if (!uat_load(u, NULL, &err)) {
+        report_failure("Error loading table '%s': %s",u->name,err);
+        g_free(err);
+    }
+}
+
+/*
+ * Load a UAT whose loading was deferred, because something other than its
+ * protocol's dissector (a dialog, "-o uat:...", saving) needs its contents.
+ */
+static void uat_load_if_pending(uat_t* u) {
+    if (u->load_pending) {
+        u->load_pending = FALSE;
+        if (!u->loaded)
+            uat_load_reporting(u);
+    }
+}
+
+static void uat_deferred_load_cb(void* data) {
+    uat_load_if_pending((uat_t *)data);
+}
+
+void uat_set_deferred_load(uat_t* uat, int proto_id) {
+    uat->deferred_proto = proto_id;
+}
+
 uat_t* uat_get_table_by_name(const char* name) {
     guint i;
 
     for (i=0; i < all_uats->len; i++) {
         uat_t* u = (uat_t *)g_ptr_array_index(all_uats,i);
         if ( g_str_equal(u->name,name) ) {
+            uat_load_if_pending(u);
             return (u);
         }
     }
@@ -365,9 +397,13 @@ static void putfld(FILE* fp, void* rec, uat_field_t* f) {
 
 gboolean uat_save(uat_t* uat, char** error) {
     guint i;
-    gchar* fname = uat_get_actual_filename(uat,TRUE);
+    gchar* fname;
     FILE* fp;
 
+    /* Don't overwrite the file with a table that was never read */
+    uat_load_if_pending(uat);
+
+    fname = uat_get_actual_filename(uat,TRUE);
     if (! fname ) return FALSE;
 
     fp = ws_fopen(fname,"w");
@@ -451,6 +487,7 @@ uat_t *uat_find(gchar *name) {
         uat_t* u = (uat_t *)g_ptr_array_index(all_uats,i);
 
         if (strcmp(u->name, name) == 0 || strcmp(u->filename, name) == 0) {
+            uat_load_if_pending(u);
             return u;
         }
     }
@@ -522,24 +559,29 @@ void uat_cleanup(void) {
 void uat_foreach_table(uat_cb_t cb,void* user_data) {
     guint i;
 
-    for (i=0; i < all_uats->len; i++)
-        cb(g_ptr_array_index(all_uats,i), user_data);
+    for (i=0; i < all_uats->len; i++) {
+        uat_t* u = (uat_t *)g_ptr_array_index(all_uats,i);
+
+        uat_load_if_pending(u);
+        cb(u, user_data);
+    }
 
 }
 
 void uat_load_all(void) {
     guint i;
-    gchar* err;
 
     for (i=0; i < all_uats->len; i++) {
         uat_t* u = (uat_t *)g_ptr_array_index(all_uats,i);
 
-        if (!u->loaded) {
-            err = NULL;
-            if (!uat_load(u, NULL, &err)) {
-                report_failure("Error loading table '%s': %s",u->name,err);
-                g_free(err);
-            }
+        if (u->loaded || u->load_pending)
+            continue;
+
+        if (u->deferred_proto != -1) {
+            u->load_pending = TRUE;
+            proto_register_deferred_routine(u->deferred_proto, uat_deferred_load_cb, u);
+        } else {
+            uat_load_reporting(u);
         }
     }
 }
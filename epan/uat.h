@@ -292,6 +292,23 @@ uat_t* uat_new(const char* name,
 			   uat_reset_cb_t reset_cb,
 			   uat_field_t* flds_array);
 
+/** Postpone loading a UAT until its protocol is first used, instead of
+ * loading it with all the other UATs when the preferences are read.
+ * "First used" is as for proto_register_field_array_deferred(): a dissector
+ * of the protocol is called, one of its fields is looked up by name, etc.
+ * The UAT is also loaded as soon as it is looked up by name, saved or
+ * enumerated, so dialogs and "-o uat:" see its contents as before.
+ *
+ * Only use this for tables that are consulted by the protocol's own
+ * dissectors and whose post_update_cb does not add dissector table entries
+ * or anything else needed to reach the protocol in the first place.
+ *
+ * @param uat Pointer to a uat. Must not be NULL.
+ * @param proto_id The protocol that uses the table.
+ */
+WS_DLL_PUBLIC
+void uat_set_deferred_load(uat_t *uat, int proto_id);
+
 /** Cleanup all UATs.
  *
  */
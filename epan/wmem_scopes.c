@@ -9,11 +9,14 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 
+#include <stdlib.h>
+
 #include <glib.h>
 
 #include "wmem_scopes.h"
 
 #include <wsutil/ws_assert.h>
+#include <wsutil/wslog.h>
 
 /* One of the supposed benefits of wmem over the old emem was going to be that
  * the scoping of the various memory pools would be obvious, since they would
@@ -40,12 +43,25 @@ static wmem_allocator_t *packet_scope = NULL;
 static wmem_allocator_t *file_scope   = NULL;
 static wmem_allocator_t *epan_scope   = NULL;
 
+/* None of the allocators behind the scopes do any locking, so they must
+ * only be used by the thread that set them up. Setting the environment
+ * variable WIRESHARK_DEBUG_WMEM_SCOPE_THREAD makes every scope access
+ * check that; this is the first thing to fix before any of the scopes
+ * can be made per-thread. */
+static gboolean  check_scope_thread = FALSE;
+static GThread  *scope_thread       = NULL;
+
+#define CHECK_SCOPE_THREAD(name) \
+    if (G_UNLIKELY(check_scope_thread) && g_thread_self() != scope_thread) \
+        ws_error("%s used from a thread other than the one that created it", name)
+
 /* Packet Scope */
 
 wmem_allocator_t *
 wmem_packet_scope(void)
 {
     ws_assert(packet_scope);
+    CHECK_SCOPE_THREAD("wmem_packet_scope()");
 
     return packet_scope;
 }
@@ -54,6 +70,7 @@ void
 wmem_enter_packet_scope(void)
 {
     ws_assert(packet_scope);
+    CHECK_SCOPE_THREAD("wmem_packet_scope()");
     ws_assert(wmem_in_scope(file_scope));
     ws_assert(!wmem_in_scope(packet_scope));
 
@@ -64,6 +81,7 @@ void
 wmem_leave_packet_scope(void)
 {
     ws_assert(packet_scope);
+    CHECK_SCOPE_THREAD("wmem_packet_scope()");
     ws_assert(wmem_in_scope(packet_scope));
 
     wmem_leave_scope(packet_scope);
@@ -75,6 +93,7 @@ wmem_allocator_t *
 wmem_file_scope(void)
 {
     ws_assert(file_scope);
+    CHECK_SCOPE_THREAD("wmem_file_scope()");
 
     return file_scope;
 }
@@ -83,6 +102,7 @@ void
 wmem_enter_file_scope(void)
 {
     ws_assert(file_scope);
+    CHECK_SCOPE_THREAD("wmem_file_scope()");
     ws_assert(!wmem_in_scope(file_scope));
 
     wmem_enter_scope(file_scope);
@@ -92,6 +112,7 @@ void
 wmem_leave_file_scope(void)
 {
     ws_assert(file_scope);
+    CHECK_SCOPE_THREAD("wmem_file_scope()");
     ws_assert(wmem_in_scope(file_scope));
     ws_assert(!wmem_in_scope(packet_scope));
 
@@ -108,6 +129,7 @@ wmem_allocator_t *
 wmem_epan_scope(void)
 {
     ws_assert(epan_scope);
+    CHECK_SCOPE_THREAD("wmem_epan_scope()");
 
     return epan_scope;
 }
@@ -127,6 +149,9 @@ wmem_init_scopes(void)
     file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
     epan_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
 
+    scope_thread       = g_thread_self();
+    check_scope_thread = getenv("WIRESHARK_DEBUG_WMEM_SCOPE_THREAD") != NULL;
+
     /* Scopes are initialized to TRUE by default on creation */
     wmem_leave_scope(packet_scope);
     wmem_leave_scope(file_scope);
@@ -151,6 +176,9 @@ wmem_cleanup_scopes(void)
     packet_scope = NULL;
     file_scope   = NULL;
     epan_scope   = NULL;
+
+    scope_thread       = NULL;
+    check_scope_thread = FALSE;
 }
 
 /*
@@ -137,10 +137,16 @@ static expert_field ei_lua_proto_deprecated_note    = EI_INIT;
 static expert_field ei_lua_proto_deprecated_warn    = EI_INIT;
 static expert_field ei_lua_proto_deprecated_error   = EI_INIT;
 
+/* The packet scope lua_pinfo_end() is currently registered with, if any */
+static wmem_allocator_t *lua_pinfo_end_pool = NULL;
+
 static gboolean
-lua_pinfo_end(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_,
+lua_pinfo_end(wmem_allocator_t *allocator, wmem_cb_event_t event _U_,
         void *user_data _U_)
 {
+    if (allocator == lua_pinfo_end_pool)
+        lua_pinfo_end_pool = NULL;
+
     clear_outstanding_Tvb();
     clear_outstanding_TvbRange();
     clear_outstanding_Pinfo();
@@ -151,10 +157,145 @@ lua_pinfo_end(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_,
     clear_outstanding_FieldInfo();
     clear_outstanding_FuncSavers();
 
+    /*
+     * The wrappers for this packet are garbage now. Do a step of the
+     * incremental collector here, between packets, so that less of that
+     * work lands in the middle of the next packet's dissection.
+     */
+    if (L)
+        lua_gc(L, LUA_GCSTEP, 0);
+
     /* keep invoking this callback later? */
     return FALSE;
 }
 
+/* Arrange for lua_pinfo_end() to run once when this packet is done */
+static void
+lua_pinfo_end_register(packet_info *pinfo)
+{
+    if (pinfo->pool != lua_pinfo_end_pool) {
+        wmem_register_callback(pinfo->pool, lua_pinfo_end, NULL);
+        lua_pinfo_end_pool = pinfo->pool;
+    }
+}
+
+/*
+ * Lua dissector profiling; see wslua_profiling_enable().
+ *
+ * Allocations are counted in wslua_allocf, so they cover everything the
+ * Lua state allocates while a dissector runs: tables, strings, closures
+ * and the userdata that wraps Tvbs, TvbRanges, TreeItems and the like.
+ */
+static gboolean wslua_profiling = FALSE;
+static GHashTable *wslua_profiles = NULL;     /* dissector name -> wslua_profile_t */
+static guint64 wslua_alloc_bytes = 0;
+static guint64 wslua_alloc_userdata = 0;
+
+typedef struct _wslua_profile_frame {
+    gint64  start_us;
+    guint64 alloc_bytes;
+    guint64 alloc_userdata;
+} wslua_profile_frame_t;
+
+static void
+wslua_profile_enter(wslua_profile_frame_t *frame)
+{
+    frame->alloc_bytes = wslua_alloc_bytes;
+    frame->alloc_userdata = wslua_alloc_userdata;
+    frame->start_us = g_get_monotonic_time();
+}
+
+static void
+wslua_profile_leave(const wslua_profile_frame_t *frame, const char *name)
+{
+    gint64 elapsed = g_get_monotonic_time() - frame->start_us;
+    wslua_profile_t *profile;
+
+    if (wslua_profiles == NULL)
+        wslua_profiles = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+
+    profile = (wslua_profile_t *)g_hash_table_lookup(wslua_profiles, name);
+    if (profile == NULL) {
+        profile = g_new0(wslua_profile_t, 1);
+        /* Protocol names live as long as the protocol registration. */
+        profile->name = name;
+        g_hash_table_insert(wslua_profiles, (gpointer)name, profile);
+    }
+
+    profile->calls++;
+    profile->time_us += elapsed > 0 ? (guint64)elapsed : 0;
+    profile->alloc_bytes += wslua_alloc_bytes - frame->alloc_bytes;
+    profile->userdata_allocs += wslua_alloc_userdata - frame->alloc_userdata;
+}
+
+void wslua_profiling_enable(gboolean enable) {
+    wslua_profiling = enable;
+}
+
+gboolean wslua_profiling_enabled(void) {
+    return wslua_profiling;
+}
+
+void wslua_profiling_reset(void) {
+    if (wslua_profiles)
+        g_hash_table_remove_all(wslua_profiles);
+}
+
+void wslua_profiling_foreach(wslua_profile_func func, void *user_data) {
+    GHashTableIter iter;
+    gpointer value;
+
+    if (wslua_profiles == NULL)
+        return;
+
+    g_hash_table_iter_init(&iter, wslua_profiles);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        func((const wslua_profile_t *)value, user_data);
+    }
+}
+
+/* Most expensive first */
+static gint
+wslua_profile_compare(gconstpointer a, gconstpointer b)
+{
+    const wslua_profile_t *pa = *(const wslua_profile_t * const *)a;
+    const wslua_profile_t *pb = *(const wslua_profile_t * const *)b;
+
+    if (pa->time_us != pb->time_us)
+        return pa->time_us < pb->time_us ? 1 : -1;
+    return strcmp(pa->name, pb->name);
+}
+
+static void
+wslua_profile_collect(const wslua_profile_t *profile, void *user_data)
+{
+    g_ptr_array_add((GPtrArray *)user_data, (gpointer)profile);
+}
+
+gchar *wslua_profiling_format(void) {
+    GString *report = g_string_new("");
+    GPtrArray *profiles = g_ptr_array_new();
+    guint i;
+
+    wslua_profiling_foreach(wslua_profile_collect, profiles);
+    g_ptr_array_sort(profiles, wslua_profile_compare);
+
+    g_string_append(report, "Dissector                   Calls    Time ms   us/call  Alloc bytes  Bytes/call  Userdata/call\n");
+    for (i = 0; i < profiles->len; i++) {
+        const wslua_profile_t *p = (const wslua_profile_t *)g_ptr_array_index(profiles, i);
+
+        g_string_append_printf(report, "%-24s %8" PRIu64 " %10.3f %9.2f %12" PRIu64 " %11.1f %14.2f\n",
+                               p->name, p->calls, p->time_us / 1000.0,
+                               (double)p->time_us / (double)p->calls,
+                               p->alloc_bytes,
+                               (double)p->alloc_bytes / (double)p->calls,
+                               (double)p->userdata_allocs / (double)p->calls);
+    }
+
+    g_ptr_array_free(profiles, TRUE);
+    return g_string_free(report, FALSE);
+}
+
 static int wslua_not_register_menu(lua_State* LS) {
     luaL_error(LS,"too late to register a menu");
     return 0;
@@ -167,6 +308,8 @@ int get_hf_wslua_text(void) {
 
 int dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, void* data _U_) {
     int consumed_bytes = tvb_captured_length(tvb);
+    wslua_profile_frame_t profile_frame;
+    int error;
     tvbuff_t *saved_lua_tvb = lua_tvb;
     packet_info *saved_lua_pinfo = lua_pinfo;
     struct _wslua_treeitem *saved_lua_tree = lua_tree;
@@ -195,7 +338,15 @@ int dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, void* data
         lua_tree = push_TreeItem(L, tree, proto_tree_add_item(tree, hf_wslua_fake, tvb, 0, 0, ENC_NA));
         proto_item_set_hidden(lua_tree->item);
 
-        if  ( lua_pcall(L,3,1,0) ) {
+        if (wslua_profiling)
+            wslua_profile_enter(&profile_frame);
+
+        error = lua_pcall(L,3,1,0);
+
+        if (wslua_profiling)
+            wslua_profile_leave(&profile_frame, pinfo->current_proto);
+
+        if  ( error ) {
             proto_tree_add_expert_format(tree, pinfo, &ei_lua_error, tvb, 0, 0, "Lua Error: %s", lua_tostring(L,-1));
         } else {
 
@@ -212,7 +363,7 @@ int dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, void* data
                     "Lua Error: did not find the %s dissector in the dissectors table", pinfo->current_proto);
     }
 
-    wmem_register_callback(pinfo->pool, lua_pinfo_end, NULL);
+    lua_pinfo_end_register(pinfo);
 
     lua_pinfo = saved_lua_pinfo;
     lua_tree = saved_lua_tree;
@@ -231,6 +382,8 @@ int dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, void* data
  */
 gboolean heur_dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, void* data _U_) {
     gboolean result = FALSE;
+    wslua_profile_frame_t profile_frame;
+    int error;
     tvbuff_t *saved_lua_tvb = lua_tvb;
     packet_info *saved_lua_pinfo = lua_pinfo;
     struct _wslua_treeitem *saved_lua_tree = lua_tree;
@@ -294,7 +447,15 @@ gboolean heur_dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, v
     lua_tree = push_TreeItem(L, tree, proto_tree_add_item(tree, hf_wslua_fake, tvb, 0, 0, ENC_NA));
     proto_item_set_hidden(lua_tree->item);
 
-    if  ( lua_pcall(L,3,1,0) ) {
+    if (wslua_profiling)
+        wslua_profile_enter(&profile_frame);
+
+    error = lua_pcall(L,3,1,0);
+
+    if (wslua_profiling)
+        wslua_profile_leave(&profile_frame, pinfo->current_proto);
+
+    if  ( error ) {
         proto_tree_add_expert_format(tree, pinfo, &ei_lua_error, tvb, 0, 0,
                 "Lua Error: error calling %s heuristic dissector: %s", pinfo->current_proto, lua_tostring(L,-1));
         lua_settop(L,0);
@@ -310,7 +471,7 @@ gboolean heur_dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, v
         lua_pop(L, 1);
     }
 
-    wmem_register_callback(pinfo->pool, lua_pinfo_end, NULL);
+    lua_pinfo_end_register(pinfo);
 
     lua_pinfo = saved_lua_pinfo;
     lua_tree = saved_lua_tree;
@@ -821,8 +982,21 @@ wslua_get_expert_field(const int group, const int severity)
 }
 
 static void *
-wslua_allocf(void *ud _U_, void *ptr, size_t osize _U_, size_t nsize)
+wslua_allocf(void *ud _U_, void *ptr, size_t osize, size_t nsize)
 {
+    if (wslua_profiling && nsize > 0) {
+        if (ptr == NULL) {
+            wslua_alloc_bytes += nsize;
+#if LUA_VERSION_NUM >= 502
+            /* For new objects osize is the type of the object */
+            if (osize == LUA_TUSERDATA)
+                wslua_alloc_userdata++;
+#endif
+        } else if (nsize > osize) {
+            wslua_alloc_bytes += nsize - osize;
+        }
+    }
+
     /* g_realloc frees ptr if nsize==0 and returns NULL (as desired).
      * Furthermore it simplifies error handling by aborting on OOM */
     return g_realloc(ptr, nsize);
@@ -1144,6 +1318,11 @@ void wslua_reload_plugins (register_cb cb, gpointer client_data) {
 }
 
 void wslua_cleanup(void) {
+    if (wslua_profiles) {
+        g_hash_table_destroy(wslua_profiles);
+        wslua_profiles = NULL;
+    }
+
     /* cleanup lua */
     if (L) {
         lua_close(L);
@@ -26,6 +26,41 @@ WS_DLL_PUBLIC void wslua_plugins_get_descriptions(wslua_plugin_description_callb
 WS_DLL_PUBLIC void wslua_plugins_dump_all(void);
 WS_DLL_PUBLIC const char *wslua_plugin_type_name(void);
 
+/*
+ * Lua dissector profiling.
+ *
+ * When enabled, every call into a Lua dissector or Lua heuristic dissector
+ * is timed and the memory allocated by the Lua state during the call is
+ * counted against the dissector. Times and allocations are inclusive of
+ * other Lua dissectors it calls. When disabled the cost is a single test
+ * per call and per allocation.
+ */
+typedef struct wslua_profile {
+    const char *name;           /* dissector (protocol) name */
+    guint64     calls;
+    guint64     time_us;
+    guint64     alloc_bytes;    /* bytes allocated by the Lua state */
+    guint64     userdata_allocs;/* full userdata objects created (Lua 5.2+) */
+} wslua_profile_t;
+
+typedef void (*wslua_profile_func)(const wslua_profile_t *profile, void *user_data);
+
+/** Turn Lua dissector profiling on or off. Existing results are kept. */
+WS_DLL_PUBLIC void wslua_profiling_enable(gboolean enable);
+
+/** Return TRUE if Lua dissector profiling is enabled. */
+WS_DLL_PUBLIC gboolean wslua_profiling_enabled(void);
+
+/** Discard all accumulated profiling results. */
+WS_DLL_PUBLIC void wslua_profiling_reset(void);
+
+/** Call func for the accumulated results of each dissector, in no particular order. */
+WS_DLL_PUBLIC void wslua_profiling_foreach(wslua_profile_func func, void *user_data);
+
+/** Return a printable table of the accumulated results, most expensive
+ * first. Free with g_free(). */
+WS_DLL_PUBLIC gchar *wslua_profiling_format(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -277,6 +277,12 @@ struct _wslua_const_phdr {
     gboolean expired;
 };
 
+struct _wslua_framebatch {
+    struct _wslua_batch *batch; /* owned by the file's private data, not by this */
+    FILE_T file;
+    gboolean expired;
+};
+
 struct _wslua_filehandler {
     struct file_type_subtype_info finfo;
     gboolean is_reader;
@@ -287,6 +293,7 @@ struct _wslua_filehandler {
     lua_State* L;
     int read_open_ref;
     int read_ref;
+    int read_batch_ref;
     int seek_read_ref;
     int read_close_ref;
     int seq_read_close_ref;
@@ -343,6 +350,7 @@ typedef struct _wslua_captureinfo* CaptureInfo;
 typedef struct _wslua_captureinfo* CaptureInfoConst;
 typedef struct _wslua_phdr* FrameInfo;
 typedef struct _wslua_const_phdr* FrameInfoConst;
+typedef struct _wslua_framebatch* FrameBatch;
 typedef struct _wslua_filehandler* FileHandler;
 typedef wtap_dumper* Dumper;
 typedef struct lua_pseudo_header* PseudoHeader;
@@ -667,6 +675,22 @@ extern int wslua_reg_attributes(lua_State *L, const wslua_attribute_table *t, gb
     }
 
 /* Clears or marks references that connects Lua to Wireshark structures */
+/*
+ * A free list for the fixed-size structs behind wrapper objects that are
+ * created and thrown away for every packet (Tvb, TvbRange, TreeItem).
+ * Freed structs are kept for the next packet instead of going back to
+ * the heap; anything past WSLUA_FREE_LIST_MAX is g_free()d as before.
+ * Everything on a list must have been allocated with g_malloc().
+ */
+#define WSLUA_FREE_LIST_MAX 256
+typedef struct _wslua_free_list {
+    size_t size;
+    guint count;
+    void* items[WSLUA_FREE_LIST_MAX];
+} wslua_free_list_t;
+
+#define WSLUA_FREE_LIST_INIT(type) { sizeof(type), 0, { NULL } }
+
 #define CLEAR_OUTSTANDING(C, marker, marker_val) void clear_outstanding_##C(void) { \
     while (outstanding_##C->len) { \
         C p = (C)g_ptr_array_remove_index_fast(outstanding_##C,0); \
@@ -751,6 +775,8 @@ extern const gchar* wslua_typeof_unknown;
 extern const gchar* wslua_typeof(lua_State *L, int idx);
 extern gboolean wslua_get_table(lua_State *L, int idx, const gchar *name);
 extern gboolean wslua_get_field(lua_State *L, int idx, const gchar *name);
+extern void* wslua_free_list_alloc(wslua_free_list_t* list);
+extern void wslua_free_list_free(wslua_free_list_t* list, void* p);
 extern int dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, void* data);
 extern int heur_dissect_lua(tvbuff_t* tvb, packet_info* pinfo, proto_tree* tree, void* data);
 extern expert_field* wslua_get_expert_field(const int group, const int severity);
@@ -39,6 +39,7 @@ void create_wth_priv(lua_State* L, wtap *wth) {
         return;
     }
     priv->table_ref = LUA_NOREF;
+    priv->batch = NULL;
     wth->priv = (void*) priv;
 }
 
@@ -101,6 +102,7 @@ void remove_wth_priv(lua_State* L, wtap *wth) {
     }
 
     luaL_unref(L, LUA_REGISTRYINDEX, priv->table_ref);
+    wslua_batch_free(priv->batch);
 
     g_free(wth->priv);
     wth->priv = NULL;
@@ -116,6 +118,7 @@ void create_wdh_priv(lua_State* L, wtap_dumper *wdh) {
         return;
     }
     priv->table_ref = LUA_NOREF;
+    priv->batch = NULL;
     wdh->priv = (void*) priv;
 }
 
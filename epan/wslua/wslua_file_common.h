@@ -19,10 +19,27 @@
 #include <wiretap/wtap_opttypes.h>
 #include <wiretap/wtap-int.h>
 
-/* this is way overkill for this one member, but in case we need to add
-   more in the future, the plumbing will be here */
+/* One record queued by a FileHandler's read_batch routine */
+typedef struct _wslua_batch_rec {
+    gint64 offset;          /* file offset, as returned by a read routine */
+    gsize data_offset;      /* start of the record's data in the batch's data buffer */
+    guint32 caplen;
+    guint32 len;
+    guint32 presence_flags;
+    int encap;              /* WTAP_ENCAP_UNKNOWN to keep the file's encapsulation */
+    nstime_t ts;
+} wslua_batch_rec_t;
+
+/* The records read by the last read_batch call, handed out one per read */
+typedef struct _wslua_batch {
+    GArray *recs;           /* of wslua_batch_rec_t */
+    Buffer data;            /* the records' data, back to back; kept between batches */
+    guint next;             /* the next record to hand out */
+} wslua_batch_t;
+
 typedef struct _file_priv_t {
     int table_ref;
+    wslua_batch_t *batch;   /* NULL until the first read_batch call */
 } file_priv_t;
 
 /* create and set the wtap->priv private data for the file instance */
@@ -56,6 +73,9 @@ extern File* push_File(lua_State* L, FILE_T ft);
 extern File* push_Wdh(lua_State* L, wtap_dumper *wdh);
 extern FrameInfo* push_FrameInfo(lua_State* L, wtap_rec *rec, Buffer* buf);
 extern FrameInfoConst* push_FrameInfoConst(lua_State* L, const wtap_rec *rec, const guint8 *pd);
+extern FrameBatch* push_FrameBatch(lua_State* L, wslua_batch_t *batch, FILE_T ft);
+extern wslua_batch_t* wslua_batch_new(void);
+extern void wslua_batch_free(wslua_batch_t *batch);
 
 
 /*
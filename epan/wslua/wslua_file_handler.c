@@ -202,8 +202,9 @@ wslua_filehandler_open(wtap *wth, int *err, gchar **err_info)
         else
             wth->subtype_close = NULL;
 
-        /* it's ok to not have a sequential close routine */
-        if (fh->seq_read_close_ref != LUA_NOREF)
+        /* it's ok to not have a sequential close routine; we need one
+           of our own to free the records queued by read_batch */
+        if (fh->seq_read_close_ref != LUA_NOREF || fh->read_batch_ref != LUA_NOREF)
             wth->subtype_sequential_close = wslua_filehandler_sequential_close;
         else
             wth->subtype_sequential_close = NULL;
@@ -287,6 +288,101 @@ wslua_filehandler_read_packet(wtap *wth, FILE_T wth_fh, wtap_rec *rec, Buffer *b
     return (retval == 1);
 }
 
+/* Calls the Lua read_batch routine to queue up the next run of records.
+ * Returns FALSE on an error or when the routine returns false; a batch
+ * with no records in it means the end of the file.
+ */
+static gboolean
+wslua_filehandler_read_batch(wtap *wth, wslua_batch_t *batch, int *err, gchar **err_info)
+{
+    FileHandler fh = (FileHandler)(wth->wslua_data);
+    int retval = -1;
+    lua_State* L = NULL;
+    File *fp = NULL;
+    CaptureInfo *fc = NULL;
+    FrameBatch *fb = NULL;
+
+    g_array_set_size(batch->recs, 0);
+    ws_buffer_clean(&batch->data);
+    batch->next = 0;
+
+    INIT_FILEHANDLER_ROUTINE(read_batch,FALSE,err,err_info);
+
+    /* Reset errno */
+    if (err) {
+        *err = errno = 0;
+    }
+
+    fp = push_File(L, wth->fh);
+    fc = push_CaptureInfo(L, wth, FALSE);
+    fb = push_FrameBatch(L, batch, wth->fh);
+
+    switch ( lua_pcall(L,3,1,1) ) {
+        case 0:
+            /*
+             * Return values for FileHandler:read_batch():
+             * Boolean false/nil indicates an error, anything else success.
+             */
+            retval = lua_toboolean(L, -1);
+            break;
+        CASE_ERROR("read_batch",err,err_info)
+    }
+
+    END_FILEHANDLER_ROUTINE();
+
+    (*fp)->expired = TRUE;
+    (*fc)->expired = TRUE;
+    (*fb)->expired = TRUE;
+    lua_settop(L,0);
+
+    if (retval != 1) {
+        g_array_set_size(batch->recs, 0);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Hands out the next record queued by read_batch, reading another batch
+ * once they've all been handed out.
+ */
+static gboolean
+wslua_filehandler_read_batched(wtap *wth, wtap_rec *rec, Buffer *buf,
+                               int *err, gchar **err_info, gint64 *offset)
+{
+    file_priv_t *priv = (file_priv_t*) wth->priv;
+    wslua_batch_rec_t *r;
+
+    if (!priv->batch)
+        priv->batch = wslua_batch_new();
+
+    if (priv->batch->next >= priv->batch->recs->len) {
+        if (!wslua_filehandler_read_batch(wth, priv->batch, err, err_info))
+            return FALSE;
+        if (priv->batch->recs->len == 0)
+            return FALSE;   /* end of file; *err is 0 */
+    }
+
+    r = &g_array_index(priv->batch->recs, wslua_batch_rec_t, priv->batch->next++);
+
+    wtap_block_unref(rec->block);
+    rec->block = NULL;
+
+    rec->rec_type = REC_TYPE_PACKET;
+    rec->presence_flags = r->presence_flags;
+    if (r->presence_flags & WTAP_HAS_TS)
+        rec->ts = r->ts;
+    rec->rec_header.packet_header.caplen = r->caplen;
+    rec->rec_header.packet_header.len = r->len;
+    if (r->encap != WTAP_ENCAP_UNKNOWN)
+        rec->rec_header.packet_header.pkt_encap = r->encap;
+
+    ws_buffer_assure_space(buf, r->caplen);
+    memcpy(ws_buffer_start_ptr(buf), ws_buffer_start_ptr(&priv->batch->data) + r->data_offset, r->caplen);
+
+    *offset = r->offset;
+    return TRUE;
+}
+
 /* The classic wtap read routine.  This returns TRUE if it found the next packet,
  * else FALSE.
  * If it finds a frame/packet, it should set the pseudo-header info (ie, let Lua set it).
@@ -297,6 +393,11 @@ static gboolean
 wslua_filehandler_read(wtap *wth, wtap_rec *rec, Buffer *buf,
                        int *err, gchar **err_info, gint64 *offset)
 {
+    FileHandler fh = (FileHandler)(wth->wslua_data);
+
+    if (fh && fh->read_batch_ref != LUA_NOREF && !fh->removed)
+        return wslua_filehandler_read_batched(wth, rec, buf, err, err_info, offset);
+
     return wslua_filehandler_read_packet(wth, wth->fh, rec, buf, err, err_info, offset);
 }
 
@@ -426,10 +527,20 @@ static void
 wslua_filehandler_sequential_close(wtap *wth)
 {
     FileHandler fh = (FileHandler)(wth->wslua_data);
+    file_priv_t *priv = (file_priv_t*) wth->priv;
     lua_State* L = NULL;
     File *fp = NULL;
     CaptureInfo *fc = NULL;
 
+    /* there'll be no more sequential reads */
+    if (priv) {
+        wslua_batch_free(priv->batch);
+        priv->batch = NULL;
+    }
+
+    if (fh && fh->seq_read_close_ref == LUA_NOREF)
+        return;
+
     INIT_FILEHANDLER_ROUTINE(seq_read_close,,NULL,NULL);
 
     fp = push_File(L, wth->fh);
@@ -735,6 +846,7 @@ WSLUA_CONSTRUCTOR FileHandler_new(lua_State* L) {
     fh->L = L;
     fh->read_open_ref = LUA_NOREF;
     fh->read_ref = LUA_NOREF;
+    fh->read_batch_ref = LUA_NOREF;
     fh->seek_read_ref = LUA_NOREF;
     fh->read_close_ref = LUA_NOREF;
     fh->seq_read_close_ref = LUA_NOREF;
@@ -894,6 +1006,7 @@ WSLUA_FUNCTION wslua_deregister_filehandler(lua_State* L) {
    function references in _wslua_filehandler struct:
     int read_open_ref;
     int read_ref;
+    int read_batch_ref;
     int seek_read_ref;
     int read_close_ref;
     int seq_read_close_ref;
@@ -935,6 +1048,26 @@ WSLUA_ATTRIBUTE_FUNC_SETTER(FileHandler,read_open);
     */
 WSLUA_ATTRIBUTE_FUNC_SETTER(FileHandler,read);
 
+/* WSLUA_ATTRIBUTE FileHandler_read_batch WO The Lua function to be called when Wireshark wants the next packets from the file,
+    in place of `read()` during the first, sequential, pass through the file.
+
+    When later called by Wireshark, the Lua function will be given:
+        1. A `File` object
+        2. A `CaptureInfo` object
+        3. A `FrameBatch` object
+
+    The purpose of the Lua function set to this `read_batch` field is to read as many of the following packets as is convenient,
+    adding each one with `FrameBatch:add(file, offset, data)`.  Wireshark then hands those packets out one at a time without calling
+    back into Lua, which is much cheaper than calling `read()` for every packet of a large file.
+
+    The called Lua function should return true if it succeeded, or false if it hit an error.  Adding no packets signals the end of
+    the file.  The `read()` function must still be set; it's used by the default `seek_read()`, and the file offsets given to
+    `FrameBatch:add()` are the ones passed to `seek_read()` later.
+
+    @since 3.7.0
+    */
+WSLUA_ATTRIBUTE_FUNC_SETTER(FileHandler,read_batch);
+
 /* WSLUA_ATTRIBUTE FileHandler_seek_read WO The Lua function to be called when Wireshark wants to read a packet from the file at the given offset.
 
     When later called by Wireshark, the Lua function will be given:
@@ -1296,6 +1429,7 @@ WSLUA_ATTRIBUTE_SET(FileHandler,supported_comment_types, { \
 WSLUA_ATTRIBUTES FileHandler_attributes[] = {
     WSLUA_ATTRIBUTE_WOREG(FileHandler,read_open),
     WSLUA_ATTRIBUTE_WOREG(FileHandler,read),
+    WSLUA_ATTRIBUTE_WOREG(FileHandler,read_batch),
     WSLUA_ATTRIBUTE_WOREG(FileHandler,seek_read),
     WSLUA_ATTRIBUTE_WOREG(FileHandler,read_close),
     WSLUA_ATTRIBUTE_WOREG(FileHandler,seq_read_close),
@@ -487,6 +487,165 @@ int FrameInfoConst_register(lua_State* L) {
     return 0;
 }
 
+WSLUA_CLASS_DEFINE(FrameBatch,FAIL_ON_NULL_OR_EXPIRED("FrameBatch"));
+/*
+    A FrameBatch object, passed into Lua as an argument by the FileHandler `read_batch`
+    callback function.
+
+    Records added to it are queued by Wireshark and handed out one at a time,
+    so that the Lua reader is called once for a whole run of records rather
+    than once for each of them. The buffer holding the records' data is kept
+    for the next batch, so reading the data straight from the file with
+    `FrameBatch:add(file, offset, length)` doesn't create any Lua strings.
+
+    @since 3.7.0
+ */
+
+wslua_batch_t* wslua_batch_new(void) {
+    wslua_batch_t *batch = g_new0(wslua_batch_t, 1);
+    batch->recs = g_array_new(FALSE, FALSE, sizeof(wslua_batch_rec_t));
+    ws_buffer_init(&batch->data, 65536);
+    return batch;
+}
+
+void wslua_batch_free(wslua_batch_t *batch) {
+    if (!batch) return;
+    g_array_free(batch->recs, TRUE);
+    ws_buffer_free(&batch->data);
+    g_free(batch);
+}
+
+FrameBatch* push_FrameBatch(lua_State* L, wslua_batch_t *batch, FILE_T ft) {
+    FrameBatch fb = (FrameBatch) g_malloc0(sizeof(struct _wslua_framebatch));
+    fb->batch = batch;
+    fb->file = ft;
+    fb->expired = FALSE;
+    return pushFrameBatch(L,fb);
+}
+
+WSLUA_METAMETHOD FrameBatch__tostring(lua_State* L) {
+    /* Generates a string of debug info for the FrameBatch */
+    FrameBatch fb = toFrameBatch(L,1);
+
+    if (!fb) {
+        lua_pushstring(L,"FrameBatch pointer is NULL!");
+    } else if (!fb->batch) {
+        lua_pushstring(L,"FrameBatch batch pointer is NULL!");
+    } else {
+        lua_pushfstring(L, "FrameBatch: records=%d, data=%d bytes",
+            fb->batch->recs->len, (int) ws_buffer_length(&fb->batch->data));
+    }
+
+    WSLUA_RETURN(1); /* String of debug information. */
+}
+
+WSLUA_METAMETHOD FrameBatch__len(lua_State* L) {
+    /* The number of records added to the batch so far. */
+    FrameBatch fb = checkFrameBatch(L,1);
+
+    lua_pushinteger(L, (lua_Integer) fb->batch->recs->len);
+    WSLUA_RETURN(1); /* The number of records. */
+}
+
+WSLUA_METHOD FrameBatch_add(lua_State* L) {
+    /* Adds a packet record to the batch. Returns true if succeeded, else false. */
+#define WSLUA_ARG_FrameBatch_add_FILE 2 /* The `File` object given to `read_batch`. */
+#define WSLUA_ARG_FrameBatch_add_OFFSET 3 /* The file offset where the record begins, which is passed to `seek_read()` later. */
+#define WSLUA_ARG_FrameBatch_add_DATA 4 /* Either a Lua string of the packet data, or the number of bytes to read
+                                           from the file at its current position. */
+#define WSLUA_OPTARG_FrameBatch_add_TIME 5 /* The packet timestamp as an `NSTime` object. */
+#define WSLUA_OPTARG_FrameBatch_add_ENCAP 6 /* The packet encapsulation type, if the file has per-packet types.
+                                               See `wtap_encaps` in `init.lua`. */
+#define WSLUA_OPTARG_FrameBatch_add_ORIGINAL_LENGTH 7 /* The on-the-wire packet length, if longer than the data. */
+    FrameBatch fb = checkFrameBatch(L,1);
+    File fh = checkFile(L,WSLUA_ARG_FrameBatch_add_FILE);
+    gint64 offset = wslua_checkgint64(L,WSLUA_ARG_FrameBatch_add_OFFSET);
+    wslua_batch_t *batch = fb->batch;
+    wslua_batch_rec_t r;
+
+    if (!batch || !fh->file) {
+        luaL_error(L, "FrameBatch add() got null batch or file pointer internally");
+        return 0;
+    }
+
+    memset(&r, 0, sizeof r);
+    r.offset = offset;
+    r.data_offset = ws_buffer_length(&batch->data);
+    r.encap = WTAP_ENCAP_UNKNOWN;
+
+    if (lua_type(L,WSLUA_ARG_FrameBatch_add_DATA) == LUA_TSTRING) {
+        size_t len = 0;
+        const gchar* s = lua_tolstring(L,WSLUA_ARG_FrameBatch_add_DATA,&len);
+
+        ws_buffer_append(&batch->data, (guint8 *) s, len);
+        r.caplen = (guint32) len;
+    } else {
+        guint32 len = wslua_checkguint32(L,WSLUA_ARG_FrameBatch_add_DATA);
+        int err = 0;
+        gchar *err_info = NULL;
+
+        ws_buffer_assure_space(&batch->data, len);
+        if (!wtap_read_bytes(fh->file, ws_buffer_end_ptr(&batch->data), len, &err, &err_info)) {
+            lua_pushboolean(L, FALSE);
+            if (err_info) {
+                lua_pushstring(L, err_info);
+                g_free(err_info);
+            }
+            else lua_pushnil(L);
+            lua_pushnumber(L, err);
+            return 3;
+        }
+        ws_buffer_increase_length(&batch->data, len);
+        r.caplen = len;
+    }
+    r.len = r.caplen;
+
+    if (!lua_isnoneornil(L,WSLUA_OPTARG_FrameBatch_add_TIME)) {
+        NSTime nstime = checkNSTime(L,WSLUA_OPTARG_FrameBatch_add_TIME);
+        r.ts = *nstime;
+        r.presence_flags |= WTAP_HAS_TS;
+    }
+
+    r.encap = wslua_optgint(L,WSLUA_OPTARG_FrameBatch_add_ENCAP,WTAP_ENCAP_UNKNOWN);
+
+    if (!lua_isnoneornil(L,WSLUA_OPTARG_FrameBatch_add_ORIGINAL_LENGTH)) {
+        r.len = wslua_checkguint32(L,WSLUA_OPTARG_FrameBatch_add_ORIGINAL_LENGTH);
+        if (r.len < r.caplen) {
+            WSLUA_OPTARG_ERROR(FrameBatch_add,ORIGINAL_LENGTH,"must not be less than the data length");
+            return 0;
+        }
+        r.presence_flags |= WTAP_HAS_CAP_LEN;
+    }
+
+    g_array_append_val(batch->recs, r);
+
+    lua_pushboolean(L, TRUE);
+    WSLUA_RETURN(1); /* True if succeeded, else returns false along with the error number and string error description. */
+}
+
+/* free the struct we created, but not the batch it points to */
+static int FrameBatch__gc(lua_State* L) {
+    FrameBatch fb = toFrameBatch(L,1);
+    g_free(fb);
+    return 0;
+}
+
+WSLUA_METHODS FrameBatch_methods[] = {
+    WSLUA_CLASS_FNREG(FrameBatch,add),
+    { NULL, NULL }
+};
+
+WSLUA_META FrameBatch_meta[] = {
+    WSLUA_CLASS_MTREG(FrameBatch,tostring),
+    WSLUA_CLASS_MTREG(FrameBatch,len),
+    { NULL, NULL }
+};
+
+int FrameBatch_register(lua_State* L) {
+    WSLUA_REGISTER_CLASS(FrameBatch);
+    return 0;
+}
+
 
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
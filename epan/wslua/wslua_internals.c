@@ -232,6 +232,19 @@ gboolean wslua_get_field(lua_State *L, int idx, const gchar *name) {
 /**
  * The __index metamethod for classes. Expected upvalues: class name.
  */
+void* wslua_free_list_alloc(wslua_free_list_t* list) {
+    if (list->count > 0)
+        return list->items[--list->count];
+    return g_malloc(list->size);
+}
+
+void wslua_free_list_free(wslua_free_list_t* list, void* p) {
+    if (list->count < WSLUA_FREE_LIST_MAX)
+        list->items[list->count++] = p;
+    else
+        g_free(p);
+}
+
 static int wslua_classmeta_index(lua_State *L) {
     const char *fieldname = luaL_checkstring(L, 2);
     const char *classname = luaL_checkstring(L, lua_upvalueindex(1));
@@ -24,11 +24,12 @@
 static gint wslua_ett = -1;
 
 static GPtrArray* outstanding_TreeItem = NULL;
+static wslua_free_list_t free_list_TreeItem = WSLUA_FREE_LIST_INIT(struct _wslua_treeitem);
 
 
 /* pushing a TreeItem with a NULL item or subtree is completely valid for this function */
 TreeItem push_TreeItem(lua_State *L, proto_tree *tree, proto_item *item) {
-    TreeItem ti = g_new(struct _wslua_treeitem, 1);
+    TreeItem ti = (TreeItem)wslua_free_list_alloc(&free_list_TreeItem);
 
     ti->tree = tree;
     ti->item = item;
@@ -50,7 +51,17 @@ TreeItem create_TreeItem(proto_tree* tree, proto_item* item)
     return tree_item;
 }
 
-CLEAR_OUTSTANDING(TreeItem, expired, TRUE)
+void clear_outstanding_TreeItem(void) {
+    while (outstanding_TreeItem->len) {
+        TreeItem ti = (TreeItem)g_ptr_array_remove_index_fast(outstanding_TreeItem,0);
+        if (ti) {
+            if (!ti->expired)
+                ti->expired = TRUE;
+            else
+                wslua_free_list_free(&free_list_TreeItem, ti);
+        }
+    }
+}
 
 WSLUA_CLASS_DEFINE(TreeItem,FAIL_ON_NULL_OR_EXPIRED("TreeItem"));
 /* <<lua_class_TreeItem,`TreeItem`>>s represent information in the https://www.wireshark.org/docs/wsug_html_chunked/ChUsePacketDetailsPaneSection.html[packet details] pane of Wireshark, and the packet details view of TShark.
@@ -973,7 +984,7 @@ static int TreeItem__gc(lua_State* L) {
     if (!ti->expired)
         ti->expired = TRUE;
     else
-        g_free(ti);
+        wslua_free_list_free(&free_list_TreeItem, ti);
     return 0;
 }
 
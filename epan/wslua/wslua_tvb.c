@@ -65,6 +65,9 @@ WSLUA_CLASS_DEFINE(Tvb,FAIL_ON_NULL_OR_EXPIRED("Tvb"));
 static GPtrArray* outstanding_Tvb = NULL;
 static GPtrArray* outstanding_TvbRange = NULL;
 
+static wslua_free_list_t free_list_Tvb = WSLUA_FREE_LIST_INIT(struct _wslua_tvb);
+static wslua_free_list_t free_list_TvbRange = WSLUA_FREE_LIST_INIT(struct _wslua_tvbrange);
+
 /* this is used to push Tvbs that were created brand new by wslua code */
 int push_wsluaTvb(lua_State* L, Tvb t) {
     g_ptr_array_add(outstanding_Tvb,t);
@@ -83,7 +86,7 @@ static void free_Tvb(Tvb tvb) {
     } else {
         if (tvb->need_free)
             tvb_free(tvb->ws_tvb);
-        g_free(tvb);
+        wslua_free_list_free(&free_list_Tvb, tvb);
     }
 }
 
@@ -96,7 +99,7 @@ void clear_outstanding_Tvb(void) {
 
 /* this is used to push Tvbs that just point to pre-existing C-code Tvbs */
 Tvb* push_Tvb(lua_State* L, tvbuff_t* ws_tvb) {
-    Tvb tvb = (Tvb)g_malloc(sizeof(struct _wslua_tvb));
+    Tvb tvb = (Tvb)wslua_free_list_alloc(&free_list_Tvb);
     tvb->ws_tvb = ws_tvb;
     tvb->expired = FALSE;
     tvb->need_free = FALSE;
@@ -273,6 +276,133 @@ WSLUA_METHOD Tvb_raw(lua_State* L) {
     WSLUA_RETURN(1); /* A Lua string of the binary bytes in the <<lua_class_Tvb,`Tvb`>>. */
 }
 
+/*
+ * Reads from a Tvb without going through a TvbRange. Creating a TvbRange
+ * allocates and registers a new object for every field, which dominates
+ * the cost of simple fixed-layout dissectors.
+ */
+static gboolean Tvb_check_bounds(lua_State* L, Tvb tvb, int offset, int len) {
+    if (tvb->expired) {
+        luaL_error(L,"expired tvb");
+        return FALSE;
+    }
+
+    if (offset < 0 || len < 0 || !tvb_bytes_exist(tvb->ws_tvb, offset, len)) {
+        luaL_error(L,"Range is out of bounds");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static guint32 Tvb_get_uint_at(tvbuff_t* ws_tvb, int offset, int len, const guint encoding) {
+    switch (len) {
+        case 1:
+            return tvb_get_guint8(ws_tvb,offset);
+        case 2:
+            return tvb_get_guint16(ws_tvb,offset,encoding);
+        case 3:
+            return tvb_get_guint24(ws_tvb,offset,encoding);
+        default:
+            return tvb_get_guint32(ws_tvb,offset,encoding);
+    }
+}
+
+static int Tvb_uint_any(lua_State* L, const guint encoding) {
+#define WSLUA_ARG_Tvb_uint_OFFSET 2 /* The offset (in octets) from the beginning of the <<lua_class_Tvb,`Tvb`>>. */
+#define WSLUA_OPTARG_Tvb_uint_LENGTH 3 /* The length of the integer, 1-4 octets. Defaults to 1. */
+    Tvb tvb = checkTvb(L,1);
+    int offset = (int) luaL_checkinteger(L,WSLUA_ARG_Tvb_uint_OFFSET);
+    int len = (int) luaL_optinteger(L,WSLUA_OPTARG_Tvb_uint_LENGTH,1);
+
+    if (len < 1 || len > 4) {
+        luaL_error(L,"Tvb:uint() does not handle %d byte integers",len);
+        return 0;
+    }
+
+    if (!Tvb_check_bounds(L,tvb,offset,len)) return 0;
+
+    lua_pushnumber(L,Tvb_get_uint_at(tvb->ws_tvb,offset,len,encoding));
+    return 1;
+}
+
+WSLUA_METHOD Tvb_uint(lua_State* L) {
+    /* Get a Big Endian (network order) unsigned integer directly from a <<lua_class_Tvb,`Tvb`>>.
+       Equivalent to `tvb:range(offset, length):uint()`, without creating a <<lua_class_TvbRange,`TvbRange`>>.
+
+       @since 3.7.0
+     */
+    WSLUA_RETURN(Tvb_uint_any(L,ENC_BIG_ENDIAN)); /* The unsigned integer value. */
+}
+
+WSLUA_METHOD Tvb_le_uint(lua_State* L) {
+    /* Get a Little Endian unsigned integer directly from a <<lua_class_Tvb,`Tvb`>>.
+       Equivalent to `tvb:range(offset, length):le_uint()`, without creating a <<lua_class_TvbRange,`TvbRange`>>.
+
+       @since 3.7.0
+     */
+    WSLUA_RETURN(Tvb_uint_any(L,ENC_LITTLE_ENDIAN)); /* The unsigned integer value. */
+}
+
+static int Tvb_uints_any(lua_State* L, const guint encoding) {
+#define WSLUA_ARG_Tvb_uints_OFFSET 2 /* The offset (in octets) of the first integer. */
+#define WSLUA_ARG_Tvb_uints_SIZE 3 /* The length of each integer, 1-4 octets. */
+#define WSLUA_ARG_Tvb_uints_COUNT 4 /* The number of integers to read. */
+#define WSLUA_OPTARG_Tvb_uints_TABLE 5 /* A table to store the values in. Defaults to a new table. */
+    Tvb tvb = checkTvb(L,1);
+    int offset = (int) luaL_checkinteger(L,WSLUA_ARG_Tvb_uints_OFFSET);
+    int size = (int) luaL_checkinteger(L,WSLUA_ARG_Tvb_uints_SIZE);
+    int count = (int) luaL_checkinteger(L,WSLUA_ARG_Tvb_uints_COUNT);
+    int i;
+
+    if (size < 1 || size > 4) {
+        WSLUA_ARG_ERROR(Tvb_uints,SIZE,"must be 1-4 octets");
+        return 0;
+    }
+
+    if (count < 0 || count > G_MAXINT / size) {
+        WSLUA_ARG_ERROR(Tvb_uints,COUNT,"invalid count");
+        return 0;
+    }
+
+    if (!Tvb_check_bounds(L,tvb,offset,size * count)) return 0;
+
+    if (lua_isnoneornil(L,WSLUA_OPTARG_Tvb_uints_TABLE)) {
+        lua_createtable(L,count,0);
+    } else {
+        luaL_checktype(L,WSLUA_OPTARG_Tvb_uints_TABLE,LUA_TTABLE);
+        lua_pushvalue(L,WSLUA_OPTARG_Tvb_uints_TABLE);
+    }
+
+    for (i = 0; i < count; i++) {
+        lua_pushnumber(L,Tvb_get_uint_at(tvb->ws_tvb,offset + i * size,size,encoding));
+        lua_rawseti(L,-2,i + 1);
+    }
+
+    return 1;
+}
+
+WSLUA_METHOD Tvb_uints(lua_State* L) {
+    /* Read a run of Big Endian (network order) unsigned integers of the same size from a <<lua_class_Tvb,`Tvb`>>
+       into a Lua table, with a single bounds check and without creating any <<lua_class_TvbRange,`TvbRange`>>s.
+
+       The values are stored at indices 1 to `count`. Passing the same table for every packet avoids allocating
+       a new one each time; entries beyond `count` are left untouched.
+
+       @since 3.7.0
+     */
+    WSLUA_RETURN(Tvb_uints_any(L,ENC_BIG_ENDIAN)); /* The table holding the values. */
+}
+
+WSLUA_METHOD Tvb_le_uints(lua_State* L) {
+    /* Read a run of Little Endian unsigned integers of the same size from a <<lua_class_Tvb,`Tvb`>> into a Lua table.
+       See `tvb:uints()`.
+
+       @since 3.7.0
+     */
+    WSLUA_RETURN(Tvb_uints_any(L,ENC_LITTLE_ENDIAN)); /* The table holding the values. */
+}
+
 WSLUA_METAMETHOD Tvb__eq(lua_State* L) {
     /* Checks whether contents of two <<lua_class_Tvb,`Tvb`>>s are equal.
 
@@ -314,6 +444,10 @@ WSLUA_METHODS Tvb_methods[] = {
     WSLUA_CLASS_FNREG(Tvb,captured_len),
     WSLUA_CLASS_FNREG(Tvb,len),
     WSLUA_CLASS_FNREG(Tvb,raw),
+    WSLUA_CLASS_FNREG(Tvb,uint),
+    WSLUA_CLASS_FNREG(Tvb,le_uint),
+    WSLUA_CLASS_FNREG(Tvb,uints),
+    WSLUA_CLASS_FNREG(Tvb,le_uints),
     { NULL, NULL }
 };
 
@@ -348,7 +482,7 @@ static void free_TvbRange(TvbRange tvbr) {
         tvbr->tvb->expired = TRUE;
     } else {
         free_Tvb(tvbr->tvb);
-        g_free(tvbr);
+        wslua_free_list_free(&free_list_TvbRange, tvbr);
     }
 }
 
@@ -379,8 +513,8 @@ gboolean push_TvbRange(lua_State* L, tvbuff_t* ws_tvb, int offset, int len) {
         return FALSE;
     }
 
-    tvbr = (TvbRange)g_malloc(sizeof(struct _wslua_tvbrange));
-    tvbr->tvb = (Tvb)g_malloc(sizeof(struct _wslua_tvb));
+    tvbr = (TvbRange)wslua_free_list_alloc(&free_list_TvbRange);
+    tvbr->tvb = (Tvb)wslua_free_list_alloc(&free_list_Tvb);
     tvbr->tvb->ws_tvb = ws_tvb;
     tvbr->tvb->expired = FALSE;
     tvbr->tvb->need_free = FALSE;
@@ -406,7 +540,7 @@ WSLUA_METHOD TvbRange_tvb(lua_State *L) {
     }
 
     if (tvb_offset_exists(tvbr->tvb->ws_tvb,  tvbr->offset + tvbr->len -1 )) {
-        tvb = (Tvb)g_malloc(sizeof(struct _wslua_tvb));
+        tvb = (Tvb)wslua_free_list_alloc(&free_list_Tvb);
         tvb->expired = FALSE;
         tvb->need_free = FALSE;
         tvb->ws_tvb = tvb_new_subset_length(tvbr->tvb->ws_tvb,tvbr->offset,tvbr->len);
@@ -15,6 +15,7 @@
 /* WSLUA_MODULE Utility Utility Functions */
 
 #include "wslua.h"
+#include "init_wslua.h"
 #include <math.h>
 #include <epan/stat_tap_ui.h>
 #include <epan/prefs.h>
@@ -348,6 +349,50 @@ WSLUA_FUNCTION wslua_report_failure(lua_State* LS) { /* Reports a failure to the
     return 0;
 }
 
+WSLUA_FUNCTION wslua_enable_lua_profiling(lua_State* LS) {
+    /*
+    Turns Lua dissector profiling on or off. While it is on, the time spent in each
+    Lua dissector and the memory the Lua state allocates during each call are recorded.
+    Use <<lua_fn_lua_profiling_report__,`lua_profiling_report()`>> to show the results,
+    or run TShark with `-z lua-profile`.
+
+    @since 3.7.0
+    */
+#define WSLUA_OPTARG_enable_lua_profiling_ENABLE 1 /* Whether to profile. Defaults to `true`. */
+    gboolean enable = TRUE;
+
+    if (!lua_isnoneornil(LS,WSLUA_OPTARG_enable_lua_profiling_ENABLE)) {
+        enable = wslua_checkboolean(LS,WSLUA_OPTARG_enable_lua_profiling_ENABLE);
+    }
+    wslua_profiling_enable(enable);
+    return 0;
+}
+
+WSLUA_FUNCTION wslua_reset_lua_profiling(lua_State* LS _U_) {
+    /*
+    Discards the Lua dissector profiling results collected so far.
+
+    @since 3.7.0
+    */
+    wslua_profiling_reset();
+    return 0;
+}
+
+WSLUA_FUNCTION wslua_lua_profiling_report(lua_State* LS) {
+    /*
+    Gets the Lua dissector profiling results as a table in text form, one line per
+    dissector with its number of calls, time, bytes allocated and userdata objects
+    created, most expensive first.
+
+    @since 3.7.0
+    */
+    gchar *report = wslua_profiling_format();
+
+    lua_pushstring(LS,report);
+    g_free(report);
+    WSLUA_RETURN(1); /* The report. */
+}
+
 /* The returned filename is g_malloc()'d so the caller must free it */
 /* except when NULL is returned if file doesn't exist               */
 char* wslua_get_actual_filename(const char* fname) {
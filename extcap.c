@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -106,6 +107,14 @@ typedef struct thread_pool {
  */
 typedef void (*extcap_run_cb_t)(thread_pool_t *pool, void *data, char *output);
 
+/**
+ * Callback definition for extcap_run_all, invoked on the calling thread for
+ * every program before it is run, with the per-program information. If it
+ * can fill that in by other means, e.g. from the discovery cache, it returns
+ * TRUE and the program is not run.
+ */
+typedef gboolean (*extcap_lookup_cb_t)(void *data, void *user_data);
+
 typedef struct extcap_run_task {
     const char     *extcap_path;
     char          **argv;       /**< NULL-terminated arguments list, freed when the task is completed. */
@@ -123,8 +132,39 @@ typedef struct extcap_run_extcaps_info {
     char    *output;                    /**< Output of --extcap-interfaces. */
     guint   num_interfaces;             /**< Number of discovered interfaces. */
     extcap_iface_info_t *iface_infos;   /**< Per-interface information. */
+    gboolean cached;                    /**< The above came from the discovery cache. */
 } extcap_run_extcaps_info_t;
 
+/*
+ * Running every extcap program with --extcap-interfaces, and then once more
+ * with --extcap-config for every interface it has, takes a while; a Python
+ * extcap can take most of a second on its own. The results are therefore
+ * cached on disk, keyed by the path, modification time and size of the
+ * program, and reused at the next start. Results that are older than
+ * EXTCAP_CACHE_REFRESH_AGE are still used, but the cache is refreshed in the
+ * background for the next start; extcaps whose interfaces depend on attached
+ * hardware pick up changes then or when the interfaces are refreshed, which
+ * bypasses the cache.
+ */
+#define EXTCAP_CACHE_FILE_NAME      "extcap_cache"
+#define EXTCAP_CACHE_VERSION_GROUP  "Wireshark"
+#define EXTCAP_CACHE_REFRESH_AGE    (60 * 60)
+
+/* How long an extcap program may take to list its interfaces or a configuration. */
+#define EXTCAP_DISCOVERY_TIMEOUT_MS 5000
+
+/* Protects the cache file and extcap_cache_refreshing. */
+static GMutex extcap_cache_mutex;
+static gboolean extcap_cache_refreshing = FALSE;
+
+/* Set by extcap_clear_interfaces(), so that the next load runs every program. */
+static gboolean extcap_cache_bypass = FALSE;
+
+typedef struct extcap_cache {
+    GKeyFile *key_file;
+    gboolean stale;                     /**< Some results used need to be refreshed. */
+} extcap_cache_t;
+
 
 static void extcap_load_interface_list(void);
 
@@ -174,6 +214,8 @@ extcap_clear_interfaces(void)
     if ( _tool_for_ifname )
         g_hash_table_destroy(_tool_for_ifname);
     _tool_for_ifname = NULL;
+
+    extcap_cache_bypass = TRUE;
 }
 
 static gint
@@ -427,7 +469,8 @@ extcap_thread_callback(gpointer data, gpointer user_data)
     const char *dirname = get_extcap_dir();
 
     char *command_output;
-    if (ws_pipe_spawn_sync(dirname, task->extcap_path, g_strv_length(task->argv), task->argv, &command_output)) {
+    if (ws_pipe_spawn_sync_timeout(dirname, task->extcap_path, g_strv_length(task->argv), task->argv,
+                                   &command_output, EXTCAP_DISCOVERY_TIMEOUT_MS)) {
         task->output_cb(pool, task->data, command_output);
     } else {
         task->output_cb(pool, task->data, NULL);
@@ -450,12 +493,16 @@ extcap_thread_callback(gpointer data, gpointer user_data)
  * @param [IN] argv NULL-terminated arguments list.
  * @param [IN] output_cb Thread callback function that receives the output.
  * @param [IN] data_size Size of the per-program information that will be returned.
+ * @param [IN] lookup_cb Optional callback that can provide the information
+ * without running the program.
+ * @param [IN] lookup_data Parameter to be passed to lookup_cb.
  * @param [OUT] count Size of the returned array.
  * @return Array of information or NULL if there are none. The first member of
  * each element (char *extcap_path) must be freed.
  */
 static gpointer
-extcap_run_all(const char *argv[], extcap_run_cb_t output_cb, gsize data_size, guint *count)
+extcap_run_all(const char *argv[], extcap_run_cb_t output_cb, gsize data_size,
+               extcap_lookup_cb_t lookup_cb, void *lookup_data, guint *count)
 {
     /* Need enough space for at least 'extcap_path'. */
     ws_assert(data_size >= sizeof(char *));
@@ -481,13 +528,19 @@ extcap_run_all(const char *argv[], extcap_run_cb_t output_cb, gsize data_size, g
     g_mutex_init(&pool.data_mutex);
 
     for (GSList *path = paths; path; path = g_slist_next(path), i++) {
+        void *data = ((char *)infos) + (i * data_size);
+        *((char **)data) = (char *)path->data;
+
+        if (lookup_cb && lookup_cb(data, lookup_data)) {
+            continue;
+        }
+
         extcap_run_task_t *task = g_new0(extcap_run_task_t, 1);
 
         task->extcap_path = (char *)path->data;
         task->argv = g_strdupv((char **)argv);
         task->output_cb = output_cb;
-        task->data = ((char *)infos) + (i * data_size);
-        *((char **)task->data) = (char *)path->data;
+        task->data = data;
 
         thread_pool_push(&pool, task, NULL);
     }
@@ -2008,6 +2061,241 @@ extcap_list_interfaces_cb(thread_pool_t *pool, void *data, char *output)
 }
 
 
+static gboolean
+extcap_cache_stat(const char *extcap_path, gint64 *mtime, gint64 *size)
+{
+    ws_statb64 statb;
+
+    /* GKeyFile can't have these in group names. */
+    if (strpbrk(extcap_path, "[]\r\n") != NULL) {
+        return FALSE;
+    }
+    if (ws_stat64(extcap_path, &statb) != 0) {
+        return FALSE;
+    }
+    *mtime = (gint64)statb.st_mtime;
+    *size = (gint64)statb.st_size;
+    return TRUE;
+}
+
+/* Returns the cache, or an empty one if there is none or it is from another version. */
+static GKeyFile *
+extcap_cache_load(void)
+{
+    GKeyFile *key_file = g_key_file_new();
+    char *cache_path = get_persconffile_path(EXTCAP_CACHE_FILE_NAME, FALSE);
+
+    g_mutex_lock(&extcap_cache_mutex);
+    if (g_key_file_load_from_file(key_file, cache_path, G_KEY_FILE_NONE, NULL)) {
+        char *version = g_key_file_get_string(key_file, EXTCAP_CACHE_VERSION_GROUP, "version", NULL);
+        if (g_strcmp0(version, get_ws_vcs_version_info()) != 0) {
+            g_key_file_free(key_file);
+            key_file = g_key_file_new();
+        }
+        g_free(version);
+    }
+    g_mutex_unlock(&extcap_cache_mutex);
+
+    g_free(cache_path);
+    return key_file;
+}
+
+/* Must be called with extcap_cache_mutex held. */
+static void
+extcap_cache_save(GKeyFile *key_file)
+{
+    char *pf_dir_path = NULL;
+    char *cache_path;
+    char *data;
+    gsize length;
+    GError *error = NULL;
+
+    if (create_persconffile_dir(&pf_dir_path) == -1) {
+        ws_debug("Can't create directory %s for the extcap cache: %s", pf_dir_path, g_strerror(errno));
+        g_free(pf_dir_path);
+        return;
+    }
+
+    g_key_file_set_string(key_file, EXTCAP_CACHE_VERSION_GROUP, "version", get_ws_vcs_version_info());
+    data = g_key_file_to_data(key_file, &length, NULL);
+    cache_path = get_persconffile_path(EXTCAP_CACHE_FILE_NAME, FALSE);
+    if (!g_file_set_contents(cache_path, data, length, &error)) {
+        ws_debug("Can't write the extcap cache: %s", error->message);
+        g_error_free(error);
+    }
+    g_free(cache_path);
+    g_free(data);
+}
+
+/**
+ * extcap_run_all lookup callback, which fills in the results for a program
+ * from the cache if they are there and the program hasn't changed.
+ */
+static gboolean
+extcap_cache_lookup(void *data, void *user_data)
+{
+    extcap_run_extcaps_info_t *info = (extcap_run_extcaps_info_t *)data;
+    extcap_cache_t *cache = (extcap_cache_t *)user_data;
+    GKeyFile *key_file = cache->key_file;
+    const char *group = info->extcap_path;
+    gint64 mtime, size;
+    gsize num_ifnames = 0, num_configs = 0;
+
+    if (!extcap_cache_stat(info->extcap_path, &mtime, &size) ||
+            !g_key_file_has_group(key_file, group) ||
+            g_key_file_get_int64(key_file, group, "mtime", NULL) != mtime ||
+            g_key_file_get_int64(key_file, group, "size", NULL) != size) {
+        return FALSE;
+    }
+
+    char *output = g_key_file_get_string(key_file, group, "interfaces", NULL);
+    char **ifnames = g_key_file_get_string_list(key_file, group, "ifnames", &num_ifnames, NULL);
+    char **configs = g_key_file_get_string_list(key_file, group, "configs", &num_configs, NULL);
+
+    if (!output || num_ifnames != num_configs) {
+        g_free(output);
+        g_strfreev(ifnames);
+        g_strfreev(configs);
+        return FALSE;
+    }
+
+    info->output = output;
+    info->num_interfaces = (guint)num_ifnames;
+    if (num_ifnames > 0) {
+        info->iface_infos = g_new0(extcap_iface_info_t, num_ifnames);
+        for (gsize i = 0; i < num_ifnames; i++) {
+            info->iface_infos[i].ifname = ifnames[i];
+            info->iface_infos[i].output = configs[i];
+        }
+    }
+    /* The strings now belong to info. */
+    g_free(ifnames);
+    g_free(configs);
+    info->cached = TRUE;
+
+    gint64 refreshed = g_key_file_get_int64(key_file, group, "refreshed", NULL);
+    if (refreshed + EXTCAP_CACHE_REFRESH_AGE < g_get_real_time() / G_USEC_PER_SEC) {
+        cache->stale = TRUE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Stores the results for a program in the cache, or removes them if the
+ * program, or its --extcap-config for one of the interfaces, failed; a
+ * program that timed out will then be tried again at the next start.
+ */
+static void
+extcap_cache_store(GKeyFile *key_file, const extcap_run_extcaps_info_t *info)
+{
+    const char *group = info->extcap_path;
+    gint64 mtime, size;
+
+    if (!extcap_cache_stat(info->extcap_path, &mtime, &size)) {
+        return;
+    }
+    g_key_file_remove_group(key_file, group, NULL);
+    if (!info->output) {
+        return;
+    }
+
+    const char **ifnames = g_new0(const char *, info->num_interfaces + 1);
+    const char **configs = g_new0(const char *, info->num_interfaces + 1);
+    for (guint i = 0; i < info->num_interfaces; i++) {
+        if (!info->iface_infos[i].output) {
+            g_free(ifnames);
+            g_free(configs);
+            return;
+        }
+        ifnames[i] = info->iface_infos[i].ifname;
+        configs[i] = info->iface_infos[i].output;
+    }
+
+    g_key_file_set_int64(key_file, group, "mtime", mtime);
+    g_key_file_set_int64(key_file, group, "size", size);
+    g_key_file_set_int64(key_file, group, "refreshed", g_get_real_time() / G_USEC_PER_SEC);
+    g_key_file_set_string(key_file, group, "interfaces", info->output);
+    g_key_file_set_string_list(key_file, group, "ifnames", ifnames, info->num_interfaces);
+    g_key_file_set_string_list(key_file, group, "configs", configs, info->num_interfaces);
+    g_free(ifnames);
+    g_free(configs);
+}
+
+/* Brings the cache up to date with the programs that have just been run. */
+static void
+extcap_cache_update(GKeyFile *key_file, const extcap_run_extcaps_info_t *infos, guint count)
+{
+    GHashTable *paths = g_hash_table_new(g_str_hash, g_str_equal);
+    gboolean changed = FALSE;
+
+    for (guint i = 0; i < count; i++) {
+        g_hash_table_add(paths, infos[i].extcap_path);
+        if (!infos[i].cached) {
+            extcap_cache_store(key_file, &infos[i]);
+            changed = TRUE;
+        }
+    }
+
+    /* Forget the programs that have gone away. */
+    char **groups = g_key_file_get_groups(key_file, NULL);
+    for (char **group = groups; *group; group++) {
+        if (strcmp(*group, EXTCAP_CACHE_VERSION_GROUP) != 0 &&
+                !g_hash_table_contains(paths, *group)) {
+            g_key_file_remove_group(key_file, *group, NULL);
+            changed = TRUE;
+        }
+    }
+    g_strfreev(groups);
+    g_hash_table_destroy(paths);
+
+    if (changed) {
+        g_mutex_lock(&extcap_cache_mutex);
+        extcap_cache_save(key_file);
+        g_mutex_unlock(&extcap_cache_mutex);
+    }
+}
+
+/** Thread that runs every program and replaces the cache with the results. */
+static gpointer
+extcap_cache_refresh_thread(gpointer data)
+{
+    char **argv = (char **)data;
+    guint count = 0;
+    extcap_run_extcaps_info_t *infos;
+    GKeyFile *key_file = g_key_file_new();
+
+    infos = (extcap_run_extcaps_info_t *)extcap_run_all((const char **)argv,
+            extcap_list_interfaces_cb, sizeof(extcap_run_extcaps_info_t),
+            NULL, NULL, &count);
+    for (guint i = 0; i < count; i++) {
+        extcap_cache_store(key_file, &infos[i]);
+    }
+
+    g_mutex_lock(&extcap_cache_mutex);
+    extcap_cache_save(key_file);
+    extcap_cache_refreshing = FALSE;
+    g_mutex_unlock(&extcap_cache_mutex);
+
+    g_key_file_free(key_file);
+    extcap_free_extcaps_info_array(infos, count);
+    g_strfreev(argv);
+    return NULL;
+}
+
+static void
+extcap_cache_refresh(const char *argv[])
+{
+    g_mutex_lock(&extcap_cache_mutex);
+    if (!extcap_cache_refreshing) {
+        extcap_cache_refreshing = TRUE;
+        /* Not joined; if we exit first, the cache is refreshed another time. */
+        g_thread_unref(g_thread_new("extcap cache refresh", extcap_cache_refresh_thread,
+                                    g_strdupv((char **)argv)));
+    }
+    g_mutex_unlock(&extcap_cache_mutex);
+}
+
 /* Handles loading of the interfaces. */
 static void
 extcap_load_interface_list(void)
@@ -2038,6 +2326,7 @@ extcap_load_interface_list(void)
         guint count = 0;
         extcap_run_extcaps_info_t *infos;
         GList *unused_arguments = NULL;
+        extcap_cache_t cache;
 
         _loaded_interfaces = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, extcap_free_interface_info);
         /* Cleanup lookup table */
@@ -2056,9 +2345,19 @@ extcap_load_interface_list(void)
             arg_version,
             NULL
         };
+        cache.key_file = extcap_cache_load();
+        cache.stale = FALSE;
         infos = (extcap_run_extcaps_info_t *)extcap_run_all(argv,
                 extcap_list_interfaces_cb, sizeof(extcap_run_extcaps_info_t),
+                extcap_cache_bypass ? NULL : extcap_cache_lookup, &cache,
                 &count);
+        extcap_cache_bypass = FALSE;
+        extcap_cache_update(cache.key_file, infos, count);
+        if (cache.stale) {
+            extcap_cache_refresh(argv);
+        }
+        g_key_file_free(cache.key_file);
+
         for (guint i = 0; i < count; i++) {
             if (!infos[i].output) {
                 continue;
@@ -40,7 +40,8 @@ enum {
 	OPT_DELAY,
 	OPT_RANDOM_TYPE,
 	OPT_ALL_RANDOM,
-	OPT_TYPE
+	OPT_TYPE,
+	OPT_TEMPLATE
 };
 
 static struct ws_option longopts[] = {
@@ -53,6 +54,7 @@ static struct ws_option longopts[] = {
 	{ "random-type",			ws_no_argument,		NULL, OPT_RANDOM_TYPE},
 	{ "all-random",				ws_no_argument,		NULL, OPT_ALL_RANDOM},
 	{ "type",					ws_required_argument,	NULL, OPT_TYPE},
+	{ "template",				ws_required_argument,	NULL, OPT_TEMPLATE},
     { 0, 0, 0, 0 }
 };
 
@@ -122,6 +124,11 @@ static int list_config(char *interface)
 	g_strfreev(longname_list);
 	inc++;
 
+	printf("arg {number=%u}{call=--template}{display=Template capture file}"
+		"{type=fileselect}{mustexist=true}{required=false}"
+		"{tooltip=Replay the packets of this file, varying their addresses, ports and sequence numbers, instead of generating random ones}\n",
+		inc++);
+
 	extcap_config_debug(&inc);
 
 	return EXIT_SUCCESS;
@@ -143,6 +150,8 @@ int main(int argc, char *argv[])
 	int random_type = FALSE;
 	int all_random = FALSE;
 	char* type = NULL;
+	char* template_filename = NULL;
+	randpkt_template* tmpl;
 	int produce_type = -1;
 	randpkt_example	*example;
 	wtap_dumper* savedump;
@@ -197,6 +206,7 @@ int main(int argc, char *argv[])
 	extcap_help_add_option(extcap_conf, "--random-type", "one random type is chosen for all packets");
 	extcap_help_add_option(extcap_conf, "--all-random", "a random type is chosen for each packet");
 	extcap_help_add_option(extcap_conf, "--type <type>", "the packet type");
+	extcap_help_add_option(extcap_conf, "--template <file>", "replay and vary the packets of a capture file");
 
 	if (argc == 1) {
 		help(extcap_conf);
@@ -250,6 +260,11 @@ int main(int argc, char *argv[])
 			type = g_strdup(ws_optarg);
 			break;
 
+		case OPT_TEMPLATE:
+			g_free(template_filename);
+			template_filename = g_strdup(ws_optarg);
+			break;
+
 		case ':':
 			/* missing option argument */
 			ws_warning("Option '%s' requires an argument", argv[ws_optind - 1]);
@@ -306,7 +321,15 @@ int main(int argc, char *argv[])
 
 		wtap_init(FALSE);
 
-		if (!all_random) {
+		if (template_filename && *template_filename) {
+			ws_debug("Replaying packets from %s", template_filename);
+
+			tmpl = randpkt_template_open(template_filename, extcap_conf->fifo);
+			if (!tmpl)
+				goto end;
+			randpkt_template_loop(tmpl, count, packet_delay_ms);
+			randpkt_template_close(tmpl);
+		} else if (!all_random) {
 			produce_type = randpkt_parse_type(type);
 
 			example = randpkt_find_example(produce_type);
@@ -344,6 +367,7 @@ int main(int argc, char *argv[])
 end:
 	/* clean up stuff */
 	g_free(type);
+	g_free(template_filename);
 	extcap_base_cleanup(&extcap_conf);
 
 	return ret;
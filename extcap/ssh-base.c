@@ -83,6 +83,13 @@ ssh_session create_ssh_connection(const ssh_params_t* ssh_params, char** err_inf
 		}
 	}
 
+	if (ssh_params->compression) {
+		if (ssh_options_set(sshs, SSH_OPTIONS_COMPRESSION, "yes")) {
+			*err_info = g_strdup("Can't enable compression");
+			goto failure;
+		}
+	}
+
 	if (ssh_params->username) {
 		if (ssh_options_set(sshs, SSH_OPTIONS_USER, ssh_params->username)) {
 			*err_info = ws_strdup_printf("Can't set the username: %s", ssh_params->username);
@@ -48,6 +48,7 @@ typedef struct _ssh_params {
 	gchar* sshkey_path;
 	gchar* sshkey_passphrase;
 	gchar* proxycommand;
+	gboolean compression;
 	gboolean debug;
 } ssh_params_t;
 
@@ -26,6 +26,20 @@
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
+#include <signal.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+
+#if LZ4_VERSION_NUMBER >= 10703
+#define USE_LZ4
+#include <lz4frame.h>
+#endif
+#endif
 
 #include <cli_main.h>
 
@@ -40,7 +54,46 @@ static gchar* sshdump_extcap_interface;
 #define SSHDUMP_VERSION_MINOR "0"
 #define SSHDUMP_VERSION_RELEASE "0"
 
-#define SSH_READ_BLOCK_SIZE 256
+#define SSH_READ_BLOCK_SIZE (64 * 1024)
+
+/* Decompressed data is written in pieces of this size */
+#define SSH_DECOMPRESS_BLOCK_SIZE (128 * 1024)
+
+/* How much of the remote spool file we receive before freeing it */
+#define SSH_SPOOL_RELEASE_SIZE (16 * 1024 * 1024)
+
+#define SSH_DEFAULT_RESUME_TIMEOUT 60
+
+/* How often the read loop checks whether we have been asked to stop, in ms */
+#define SSH_READ_TIMEOUT 1000
+
+typedef enum {
+	REMOTE_COMPRESSION_NONE,
+	REMOTE_COMPRESSION_SSH,         /* The SSH transport's own (zlib) */
+	REMOTE_COMPRESSION_ZSTD,        /* zstd on the remote host */
+	REMOTE_COMPRESSION_LZ4          /* lz4 on the remote host */
+} remote_compression_e;
+
+/* What we read from the channel: the capture, maybe compressed */
+typedef struct {
+	remote_compression_e compression;
+#ifdef HAVE_ZSTD
+	ZSTD_DStream* zstd_dctx;
+#endif
+#ifdef USE_LZ4
+	LZ4F_dctx* lz4_dctx;
+#endif
+	char* buffer;
+	guint64 written;        /* Bytes of capture written, i.e. the offset into the remote capture */
+	guint64 released;       /* Bytes of the remote spool file freed, in resumable mode */
+} capture_stream_t;
+
+/* How ssh_loop_read() ended */
+typedef enum {
+	READ_LOOP_EOF,          /* The remote command finished */
+	READ_LOOP_ERROR,        /* We couldn't write or decompress the capture */
+	READ_LOOP_DISCONNECTED  /* Reading from the channel failed, e.g. the connection dropped */
+} read_loop_result_e;
 
 enum {
 	EXTCAP_BASE_OPTIONS_ENUM,
@@ -58,7 +111,10 @@ enum {
 	OPT_PROXYCOMMAND,
 	OPT_REMOTE_COUNT,
 	OPT_REMOTE_SUDO,
-	OPT_REMOTE_NOPROM
+	OPT_REMOTE_NOPROM,
+	OPT_REMOTE_COMPRESSION,
+	OPT_REMOTE_RESUME,
+	OPT_REMOTE_RESUME_TIMEOUT
 };
 
 static struct ws_option longopts[] = {
@@ -69,40 +125,335 @@ static struct ws_option longopts[] = {
 	{ "remote-capture-command", ws_required_argument, NULL, OPT_REMOTE_CAPTURE_COMMAND},
 	{ "remote-sudo", ws_no_argument, NULL, OPT_REMOTE_SUDO },
 	{ "remote-noprom", ws_no_argument, NULL, OPT_REMOTE_NOPROM },
+	{ "remote-compression", ws_required_argument, NULL, OPT_REMOTE_COMPRESSION },
+	{ "remote-resume", ws_no_argument, NULL, OPT_REMOTE_RESUME },
+	{ "remote-resume-timeout", ws_required_argument, NULL, OPT_REMOTE_RESUME_TIMEOUT },
 	{ 0, 0, 0, 0}
 };
 
 static char* interfaces_list_to_filter(GSList* if_list, unsigned int remote_port);
 
-static int ssh_loop_read(ssh_channel channel, FILE* fp)
+static volatile gboolean run_loop = TRUE;
+
+static void exit_from_loop(int signo _U_)
+{
+	run_loop = FALSE;
+}
+
+static const char* remote_compression_names[] = { "none", "ssh", "zstd", "lz4" };
+
+static gboolean remote_compression_from_name(const char* name, remote_compression_e* compression)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(remote_compression_names); i++) {
+		if (!g_strcmp0(name, remote_compression_names[i]))
+			break;
+	}
+	if (i == G_N_ELEMENTS(remote_compression_names))
+		return FALSE;
+
+	*compression = (remote_compression_e)i;
+	switch (*compression) {
+#ifndef HAVE_ZSTD
+		case REMOTE_COMPRESSION_ZSTD:
+			return FALSE;
+#endif
+#ifndef USE_LZ4
+		case REMOTE_COMPRESSION_LZ4:
+			return FALSE;
+#endif
+		default:
+			return TRUE;
+	}
+}
+
+/* The command that compresses the capture on the remote host, if any */
+static const char* remote_compressor(const remote_compression_e compression)
+{
+	switch (compression) {
+		case REMOTE_COMPRESSION_ZSTD:
+			return "zstd -q -c";
+		case REMOTE_COMPRESSION_LZ4:
+			return "lz4 -q -c";
+		default:
+			return NULL;
+	}
+}
+
+static void capture_stream_free_contexts(capture_stream_t* stream)
+{
+#ifdef HAVE_ZSTD
+	if (stream->zstd_dctx) {
+		ZSTD_freeDStream(stream->zstd_dctx);
+		stream->zstd_dctx = NULL;
+	}
+#endif
+#ifdef USE_LZ4
+	if (stream->lz4_dctx) {
+		LZ4F_freeDecompressionContext(stream->lz4_dctx);
+		stream->lz4_dctx = NULL;
+	}
+#endif
+}
+
+/* Gets ready for a new compressed stream, i.e. for a new remote command */
+static int capture_stream_reset(capture_stream_t* stream)
 {
+	capture_stream_free_contexts(stream);
+
+	switch (stream->compression) {
+#ifdef HAVE_ZSTD
+		case REMOTE_COMPRESSION_ZSTD:
+			stream->zstd_dctx = ZSTD_createDStream();
+			if (!stream->zstd_dctx || ZSTD_isError(ZSTD_initDStream(stream->zstd_dctx))) {
+				ws_warning("Can't create zstd decompression context");
+				return EXIT_FAILURE;
+			}
+			break;
+#endif
+#ifdef USE_LZ4
+		case REMOTE_COMPRESSION_LZ4:
+			if (LZ4F_isError(LZ4F_createDecompressionContext(&stream->lz4_dctx, LZ4F_VERSION))) {
+				ws_warning("Can't create lz4 decompression context");
+				return EXIT_FAILURE;
+			}
+			break;
+#endif
+		default:
+			break;
+	}
+	return EXIT_SUCCESS;
+}
+
+static void capture_stream_init(capture_stream_t* stream, const remote_compression_e compression)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->compression = compression;
+	stream->buffer = (char*)g_malloc(SSH_DECOMPRESS_BLOCK_SIZE);
+}
+
+static void capture_stream_cleanup(capture_stream_t* stream)
+{
+	capture_stream_free_contexts(stream);
+	g_free(stream->buffer);
+}
+
+static int capture_stream_output(capture_stream_t* stream, const char* buf, size_t len, FILE* fp)
+{
+	if (fwrite(buf, 1, len, fp) != len) {
+		ws_warning("Error writing to fifo");
+		return EXIT_FAILURE;
+	}
+	stream->written += len;
+	return EXIT_SUCCESS;
+}
+
+/* Decompresses what was read from the channel, if needed, and writes it to fp */
+static int capture_stream_write(capture_stream_t* stream, const char* buf, size_t len, FILE* fp)
+{
+	switch (stream->compression) {
+#ifdef HAVE_ZSTD
+		case REMOTE_COMPRESSION_ZSTD:
+		{
+			ZSTD_inBuffer input = { buf, len, 0 };
+			ZSTD_outBuffer output;
+
+			do {
+				output.dst = stream->buffer;
+				output.size = SSH_DECOMPRESS_BLOCK_SIZE;
+				output.pos = 0;
+				size_t ret = ZSTD_decompressStream(stream->zstd_dctx, &output, &input);
+				if (ZSTD_isError(ret)) {
+					ws_warning("Can't decompress the capture: %s", ZSTD_getErrorName(ret));
+					return EXIT_FAILURE;
+				}
+				if (capture_stream_output(stream, stream->buffer, output.pos, fp) != EXIT_SUCCESS)
+					return EXIT_FAILURE;
+			} while (input.pos < input.size || output.pos == output.size);
+			return EXIT_SUCCESS;
+		}
+#endif
+#ifdef USE_LZ4
+		case REMOTE_COMPRESSION_LZ4:
+		{
+			size_t consumed = 0;
+			size_t out_size;
+
+			do {
+				size_t in_size = len - consumed;
+				out_size = SSH_DECOMPRESS_BLOCK_SIZE;
+				size_t ret = LZ4F_decompress(stream->lz4_dctx, stream->buffer, &out_size,
+					buf + consumed, &in_size, NULL);
+				if (LZ4F_isError(ret)) {
+					ws_warning("Can't decompress the capture: %s", LZ4F_getErrorName(ret));
+					return EXIT_FAILURE;
+				}
+				consumed += in_size;
+				if (capture_stream_output(stream, stream->buffer, out_size, fp) != EXIT_SUCCESS)
+					return EXIT_FAILURE;
+			} while (consumed < len || out_size == SSH_DECOMPRESS_BLOCK_SIZE);
+			return EXIT_SUCCESS;
+		}
+#endif
+		default:
+			return capture_stream_output(stream, buf, len, fp);
+	}
+}
+
+/*
+ * Runs a command in a channel of its own and waits for it to finish.
+ * Anything it writes to stderr is passed on. Returns its exit status, or
+ * -1 if it couldn't be run.
+ */
+static int ssh_exec_command(ssh_session sshs, const char* cmdline)
+{
+	ssh_channel channel;
+	char buffer[1024];
 	int nbytes;
-	int ret = EXIT_SUCCESS;
-	char buffer[SSH_READ_BLOCK_SIZE];
+	int status = -1;
 
-	/* read from stdin until data are available */
-	while (ssh_channel_is_open(channel) && !ssh_channel_is_eof(channel)) {
-		nbytes = ssh_channel_read(channel, buffer, SSH_READ_BLOCK_SIZE, 0);
+	channel = ssh_channel_new(sshs);
+	if (!channel)
+		return -1;
+
+	ws_debug("Running: %s", cmdline);
+	if (ssh_channel_open_session(channel) == SSH_OK && ssh_channel_request_exec(channel, cmdline) == SSH_OK) {
+		while ((nbytes = ssh_channel_read(channel, buffer, sizeof(buffer), 1)) > 0) {
+			if (fwrite(buffer, 1, nbytes, stderr) != (guint)nbytes)
+				break;
+		}
+		ssh_channel_send_eof(channel);
+		status = ssh_channel_get_exit_status(channel);
+	}
+	ssh_channel_close(channel);
+	ssh_channel_free(channel);
+	return status;
+}
+
+/*
+ * Resumable mode
+ *
+ * The capture runs in the background on the remote host, detached from the
+ * connection, and writes to a spool file in a private directory. Every
+ * connection streams the spool file from where the last one stopped, so a
+ * dropped connection loses nothing as long as we're back before the
+ * capture has ended and the directory is removed. This needs GNU tail on
+ * the remote host.
+ *
+ * As we go, the part of the spool file we have received is freed with
+ * "fallocate --punch-hole", where the remote host has that, so that the
+ * spool file only takes up the space of what we haven't received yet.
+ */
+
+#define REMOTE_SPOOL_DIR "d=\"${TMPDIR:-/tmp}/sshdump-%s\"; "
+
+/* Streams the spool file from the given offset, compressing it if asked to */
+static char* remote_spool_tail(const guint64 offset, const remote_compression_e compression)
+{
+	const char* compressor = remote_compressor(compression);
+
+	return ws_strdup_printf("tail -c +%" PRIu64 " --pid=\"$(cat \"$d/pid\")\" -f \"$d/spool\"%s%s",
+		offset + 1, compressor ? " | " : "", compressor ? compressor : "");
+}
+
+static char* remote_spool_stream_cmdline(const char* session_id, const guint64 offset, const remote_compression_e compression)
+{
+	gchar* tail = remote_spool_tail(offset, compression);
+	gchar* cmdline = ws_strdup_printf(REMOTE_SPOOL_DIR "%s", session_id, tail);
+
+	g_free(tail);
+	return cmdline;
+}
+
+/* Starts the capture in the background, then streams the spool file */
+static char* remote_spool_start_cmdline(const char* session_id, const char* capture_cmdline, const remote_compression_e compression)
+{
+	gchar* capture;
+	gchar* quoted_capture;
+	gchar* tail;
+	gchar* cmdline;
+
+	capture = ws_strdup_printf("exec %s > \"$0/spool\" 2> \"$0/stderr\"", capture_cmdline);
+	quoted_capture = g_shell_quote(capture);
+	tail = remote_spool_tail(0, compression);
+	cmdline = ws_strdup_printf(REMOTE_SPOOL_DIR "umask 077 && mkdir \"$d\" && : > \"$d/spool\" && "
+		"{ nohup sh -c %s \"$d\" > /dev/null 2>&1 & echo $! > \"$d/pid\"; } && %s",
+		session_id, quoted_capture, tail);
+
+	g_free(capture);
+	g_free(quoted_capture);
+	g_free(tail);
+	return cmdline;
+}
+
+/* Frees the part of the spool file that we have received */
+static void remote_spool_release(ssh_session sshs, const char* session_id, capture_stream_t* stream)
+{
+	guint64 release = stream->written & ~(guint64)(SSH_SPOOL_RELEASE_SIZE - 1);
+	gchar* cmdline;
+
+	if (release <= stream->released)
+		return;
+
+	cmdline = ws_strdup_printf(REMOTE_SPOOL_DIR "fallocate -p -o 0 -l %" PRIu64 " \"$d/spool\" 2> /dev/null",
+		session_id, release);
+	ssh_exec_command(sshs, cmdline);
+	g_free(cmdline);
+	stream->released = release;
+}
+
+/* Stops the capture, passes on what it wrote to stderr and removes the spool directory */
+static void remote_spool_cleanup(ssh_session sshs, const char* session_id)
+{
+	gchar* cmdline;
+
+	cmdline = ws_strdup_printf(REMOTE_SPOOL_DIR "kill \"$(cat \"$d/pid\")\" 2> /dev/null; "
+		"cat \"$d/stderr\" >&2; rm -rf \"$d\"", session_id);
+	ssh_exec_command(sshs, cmdline);
+	g_free(cmdline);
+}
+
+static read_loop_result_e ssh_loop_read(ssh_channel channel, capture_stream_t* stream, FILE* fp,
+		const char* session_id)
+{
+	int nbytes;
+	read_loop_result_e ret = READ_LOOP_EOF;
+	char* buffer = (char*)g_malloc(SSH_READ_BLOCK_SIZE);
+
+	/*
+	 * Read from stdin until data are available. The timeout lets us stop
+	 * the remote capture when we're asked to stop, which matters when it
+	 * runs in the background.
+	 */
+	while (run_loop && ssh_channel_is_open(channel) && !ssh_channel_is_eof(channel)) {
+		nbytes = ssh_channel_read_timeout(channel, buffer, SSH_READ_BLOCK_SIZE, 0, SSH_READ_TIMEOUT);
 		if (nbytes < 0) {
 			ws_warning("Error reading from channel");
+			ret = READ_LOOP_DISCONNECTED;
 			goto end;
 		}
 		if (nbytes == 0) {
-			break;
+			continue;
 		}
-		if (fwrite(buffer, 1, nbytes, fp) != (guint)nbytes) {
-			ws_warning("Error writing to fifo");
-			ret = EXIT_FAILURE;
+		if (capture_stream_write(stream, buffer, nbytes, fp) != EXIT_SUCCESS) {
+			ret = READ_LOOP_ERROR;
 			goto end;
 		}
 		fflush(fp);
+		if (session_id && stream->written - stream->released >= 2 * SSH_SPOOL_RELEASE_SIZE)
+			remote_spool_release(ssh_channel_get_session(channel), session_id, stream);
 	}
 
+	if (!run_loop)
+		goto end;
+
 	/* read loop finished... maybe something wrong happened. Read from stderr */
 	while (ssh_channel_is_open(channel) && !ssh_channel_is_eof(channel)) {
 		nbytes = ssh_channel_read(channel, buffer, SSH_READ_BLOCK_SIZE, 1);
 		if (nbytes < 0) {
 			ws_warning("Error reading from channel");
+			ret = READ_LOOP_DISCONNECTED;
 			goto end;
 		}
 		if (fwrite(buffer, 1, nbytes, stderr) != (guint)nbytes) {
@@ -111,10 +462,14 @@ static int ssh_loop_read(ssh_channel channel, FILE* fp)
 		}
 	}
 
+	if (!ssh_is_connected(ssh_channel_get_session(channel)))
+		ret = READ_LOOP_DISCONNECTED;
+
 end:
-	if (ssh_channel_send_eof(channel) != SSH_OK) {
+	g_free(buffer);
+	if (ret != READ_LOOP_DISCONNECTED && ssh_channel_send_eof(channel) != SSH_OK) {
 		ws_warning("Error sending EOF in ssh channel");
-		ret = EXIT_FAILURE;
+		ret = READ_LOOP_ERROR;
 	}
 	return ret;
 }
@@ -127,28 +482,15 @@ static char* local_interfaces_to_filter(const guint16 remote_port)
 	return filter;
 }
 
-static ssh_channel run_ssh_command(ssh_session sshs, const char* capture_command, const gboolean use_sudo, gboolean noprom,
+static char* capture_cmdline(ssh_session sshs, const char* capture_command, const gboolean use_sudo, gboolean noprom,
 		const char* iface, const char* cfilter, const guint32 count)
 {
 	gchar* cmdline;
-	ssh_channel channel;
 	char* quoted_iface = NULL;
 	char* quoted_filter = NULL;
 	char* count_str = NULL;
 	unsigned int remote_port = 22;
 
-	channel = ssh_channel_new(sshs);
-	if (!channel) {
-		ws_warning("Can't create channel");
-		return NULL;
-	}
-
-	if (ssh_channel_open_session(channel) != SSH_OK) {
-		ws_warning("Can't open session");
-		ssh_channel_free(channel);
-		return NULL;
-	}
-
 	ssh_options_get_port(sshs, &remote_port);
 
 	/* escape parameters to go save with the shell */
@@ -170,6 +512,29 @@ static ssh_channel run_ssh_command(ssh_session sshs, const char* capture_command
 			quoted_filter);
 	}
 
+	g_free(quoted_iface);
+	g_free(quoted_filter);
+	g_free(count_str);
+
+	return cmdline;
+}
+
+static ssh_channel run_ssh_command(ssh_session sshs, const char* cmdline)
+{
+	ssh_channel channel;
+
+	channel = ssh_channel_new(sshs);
+	if (!channel) {
+		ws_warning("Can't create channel");
+		return NULL;
+	}
+
+	if (ssh_channel_open_session(channel) != SSH_OK) {
+		ws_warning("Can't open session");
+		ssh_channel_free(channel);
+		return NULL;
+	}
+
 	ws_debug("Running: %s", cmdline);
 	if (ssh_channel_request_exec(channel, cmdline) != SSH_OK) {
 		ws_warning("Can't request exec");
@@ -178,22 +543,42 @@ static ssh_channel run_ssh_command(ssh_session sshs, const char* capture_command
 		channel = NULL;
 	}
 
-	g_free(quoted_iface);
-	g_free(quoted_filter);
-	g_free(cmdline);
-	g_free(count_str);
-
 	return channel;
 }
 
+/* Keeps trying to connect again until the timeout, in seconds, is over */
+static ssh_session ssh_reconnect(const ssh_params_t* params, const guint timeout)
+{
+	gint64 deadline = g_get_monotonic_time() + (gint64)timeout * G_USEC_PER_SEC;
+	ssh_session sshs;
+	char* err_info = NULL;
+
+	do {
+		g_usleep(G_USEC_PER_SEC);
+		sshs = create_ssh_connection(params, &err_info);
+		if (sshs)
+			return sshs;
+		ws_debug("Can't reconnect: %s", err_info);
+		g_free(err_info);
+		err_info = NULL;
+	} while (run_loop && g_get_monotonic_time() < deadline);
+
+	return NULL;
+}
+
 static int ssh_open_remote_connection(const ssh_params_t* params, const char* iface, const char* cfilter,
-	const char* capture_command, const gboolean use_sudo, gboolean noprom, const guint32 count, const char* fifo)
+	const char* capture_command, const gboolean use_sudo, gboolean noprom, const guint32 count, const char* fifo,
+	const remote_compression_e compression, const gboolean resume, const guint resume_timeout)
 {
 	ssh_session sshs = NULL;
 	ssh_channel channel = NULL;
 	FILE* fp = stdout;
 	int ret = EXIT_FAILURE;
 	char* err_info = NULL;
+	char* cmdline = NULL;
+	char* session_id = NULL;
+	capture_stream_t stream;
+	read_loop_result_e result;
 
 	if (g_strcmp0(fifo, "-")) {
 		/* Open or create the output file */
@@ -204,6 +589,13 @@ static int ssh_open_remote_connection(const ssh_params_t* params, const char* if
 		}
 	}
 
+	capture_stream_init(&stream, compression);
+
+#ifndef _WIN32
+	signal(SIGTERM, exit_from_loop);
+#endif
+	signal(SIGINT, exit_from_loop);
+
 	sshs = create_ssh_connection(params, &err_info);
 
 	if (!sshs) {
@@ -211,18 +603,51 @@ static int ssh_open_remote_connection(const ssh_params_t* params, const char* if
 		goto cleanup;
 	}
 
-	channel = run_ssh_command(sshs, capture_command, use_sudo, noprom, iface, cfilter, count);
-
-	if (!channel) {
-		ws_warning("Can't run ssh command.");
-		goto cleanup;
+	{
+		char* capture = capture_cmdline(sshs, capture_command, use_sudo, noprom, iface, cfilter, count);
+		const char* compressor = remote_compressor(compression);
+
+		if (resume) {
+			session_id = ws_strdup_printf("%08x%08x", g_random_int(), g_random_int());
+			cmdline = remote_spool_start_cmdline(session_id, capture, compression);
+		} else if (compressor) {
+			cmdline = ws_strdup_printf("%s | %s", capture, compressor);
+		} else {
+			cmdline = g_strdup(capture);
+		}
+		g_free(capture);
 	}
 
-	/* read from channel and write into fp */
-	if (ssh_loop_read(channel, fp) != EXIT_SUCCESS) {
-		ws_warning("Error in read loop.");
-		ret = EXIT_FAILURE;
-		goto cleanup;
+	for (;;) {
+		if (capture_stream_reset(&stream) != EXIT_SUCCESS)
+			goto cleanup;
+
+		channel = run_ssh_command(sshs, cmdline);
+
+		if (!channel) {
+			ws_warning("Can't run ssh command.");
+			goto cleanup;
+		}
+
+		/* read from channel and write into fp */
+		result = ssh_loop_read(channel, &stream, fp, session_id);
+		if (result == READ_LOOP_ERROR) {
+			ws_warning("Error in read loop.");
+			ret = EXIT_FAILURE;
+			goto cleanup;
+		}
+		if (result == READ_LOOP_EOF || !session_id)
+			break;
+
+		ws_warning("Connection lost after %" PRIu64 " bytes of capture, reconnecting", stream.written);
+		ssh_cleanup(&sshs, &channel);
+		sshs = ssh_reconnect(params, resume_timeout);
+		if (!sshs) {
+			ws_warning("Can't reconnect within %u seconds, giving up", resume_timeout);
+			goto cleanup;
+		}
+		g_free(cmdline);
+		cmdline = remote_spool_stream_cmdline(session_id, stream.written, compression);
 	}
 
 	ret = EXIT_SUCCESS;
@@ -231,8 +656,14 @@ cleanup:
 		ws_warning("%s", err_info);
 	g_free(err_info);
 
+	if (session_id && sshs && ssh_is_connected(sshs))
+		remote_spool_cleanup(sshs, session_id);
+
 	/* clean up and exit */
 	ssh_cleanup(&sshs, &channel);
+	capture_stream_cleanup(&stream);
+	g_free(cmdline);
+	g_free(session_id);
 
 	if (g_strcmp0(fifo, "-"))
 		fclose(fp);
@@ -322,6 +753,25 @@ static int list_config(char *interface, unsigned int remote_port)
 	printf("arg {number=%u}{call=--remote-count}{display=Packets to capture}"
 		"{type=unsigned}{default=0}{tooltip=The number of remote packets to capture. (Default: inf)}"
 		"{group=Capture}\n", inc++);
+	printf("arg {number=%u}{call=--remote-compression}{display=Compression}"
+		"{type=selector}{tooltip=How to compress the capture on its way from the remote host. "
+		"zstd and lz4 need the command of that name on the remote host, and send the capture in blocks}"
+		"{group=Capture}\n", inc);
+	printf("value {arg=%u}{value=none}{display=None}{default=true}\n", inc);
+	printf("value {arg=%u}{value=ssh}{display=SSH (zlib)}\n", inc);
+#ifdef HAVE_ZSTD
+	printf("value {arg=%u}{value=zstd}{display=zstd}\n", inc);
+#endif
+#ifdef USE_LZ4
+	printf("value {arg=%u}{value=lz4}{display=lz4}\n", inc);
+#endif
+	inc++;
+	printf("arg {number=%u}{call=--remote-resume}{display=Resume after a disconnect}"
+		"{type=boolflag}{tooltip=Keep capturing on the remote host while the connection is down, "
+		"and reconnect to get the rest. Needs GNU tail on the remote host}{group=Capture}\n", inc++);
+	printf("arg {number=%u}{call=--remote-resume-timeout}{display=Reconnect timeout}"
+		"{type=unsigned}{default=%u}{tooltip=How long to keep trying to reconnect, in seconds}"
+		"{group=Capture}\n", inc++, SSH_DEFAULT_RESUME_TIMEOUT);
 
 	extcap_config_debug(&inc);
 
@@ -360,6 +810,9 @@ int main(int argc, char *argv[])
 	char* help_header = NULL;
 	gboolean use_sudo = FALSE;
 	gboolean noprom = FALSE;
+	remote_compression_e compression = REMOTE_COMPRESSION_NONE;
+	gboolean resume = FALSE;
+	guint32 resume_timeout = SSH_DEFAULT_RESUME_TIMEOUT;
 	gchar* interface_description = g_strdup("SSH remote capture");
 
 	/* Initialize log handler early so we can have proper logging during startup. */
@@ -422,6 +875,11 @@ int main(int argc, char *argv[])
 	extcap_help_add_option(extcap_conf, "--remote-filter <filter>", "a filter for remote capture (default: don't "
 		"listen on local interfaces IPs)");
 	extcap_help_add_option(extcap_conf, "--remote-count <count>", "the number of packets to capture");
+	extcap_help_add_option(extcap_conf, "--remote-compression <none|ssh|zstd|lz4>", "how to compress the capture "
+		"on its way from the remote host (default: none)");
+	extcap_help_add_option(extcap_conf, "--remote-resume", "keep capturing on the remote host while the "
+		"connection is down, and reconnect to get the rest");
+	extcap_help_add_option(extcap_conf, "--remote-resume-timeout <seconds>", "how long to keep trying to reconnect");
 
 	ws_opterr = 0;
 	ws_optind = 0;
@@ -514,6 +972,24 @@ int main(int argc, char *argv[])
 			noprom = TRUE;
 			break;
 
+		case OPT_REMOTE_COMPRESSION:
+			if (!remote_compression_from_name(ws_optarg, &compression)) {
+				ws_warning("Unsupported compression: %s", ws_optarg);
+				goto end;
+			}
+			break;
+
+		case OPT_REMOTE_RESUME:
+			resume = TRUE;
+			break;
+
+		case OPT_REMOTE_RESUME_TIMEOUT:
+			if (!ws_strtou32(ws_optarg, NULL, &resume_timeout)) {
+				ws_warning("Invalid value for the reconnect timeout: %s", ws_optarg);
+				goto end;
+			}
+			break;
+
 		case ':':
 			/* missing option argument */
 			ws_warning("Option '%s' requires an argument", argv[ws_optind - 1]);
@@ -556,8 +1032,10 @@ int main(int argc, char *argv[])
 		}
 		filter = concat_filters(extcap_conf->capture_filter, remote_filter);
 		ssh_params->debug = extcap_conf->debug;
+		ssh_params->compression = (compression == REMOTE_COMPRESSION_SSH);
 		ret = ssh_open_remote_connection(ssh_params, remote_interface,
-			filter, remote_capture_command, use_sudo, noprom, count, extcap_conf->fifo);
+			filter, remote_capture_command, use_sudo, noprom, count, extcap_conf->fifo,
+			compression, resume, resume_timeout);
 		g_free(filter);
 	} else {
 		ws_debug("You should not come here... maybe some parameter missing?");
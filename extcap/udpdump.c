@@ -11,6 +11,7 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 
+#define _GNU_SOURCE /* for recvmmsg */
 #include "config.h"
 #define WS_LOG_DOMAIN "udpdump"
 
@@ -46,6 +47,7 @@
 #include <wsutil/wslog.h>
 #include <wsutil/pint.h>
 #include <wsutil/exported_pdu_tlvs.h>
+#include <wsutil/ws_assert.h>
 
 #include <cli_main.h>
 
@@ -62,14 +64,44 @@
 
 #define UDPDUMP_EXPORT_HEADER_LEN 40
 
-static gboolean run_loop = TRUE;
+/* Datagrams received at a time, and written to the output before flushing it */
+#ifdef HAVE_RECVMMSG
+#define UDPDUMP_BATCH_SIZE 64
+#else
+#define UDPDUMP_BATCH_SIZE 1
+#endif
+
+/* The socket receive buffer we ask for; Linux caps it at net.core.rmem_max */
+#define UDPDUMP_RCVBUF_SIZE (32 * 1024 * 1024)
+
+#define UDPDUMP_OUTPUT_BUF_SIZE (1024 * 1024)
+
+#define UDPDUMP_MAX_THREADS 64
+
+typedef struct {
+	guint16 port;
+	const char* proto_name;
+	guint header_len;       /* Exported PDU tags in front of every payload */
+	FILE* fp;
+	GMutex fp_mutex;
+} udpdump_output_t;
+
+typedef struct {
+	udpdump_output_t* output;
+	socket_handle_t sock;
+	guint64 received;
+	guint64 dropped;        /* As counted by the kernel up to the last datagram received, if it tells us */
+} udpdump_receiver_t;
+
+static volatile gboolean run_loop = TRUE;
 
 enum {
 	EXTCAP_BASE_OPTIONS_ENUM,
 	OPT_HELP,
 	OPT_VERSION,
 	OPT_PORT,
-	OPT_PAYLOAD
+	OPT_PAYLOAD,
+	OPT_THREADS
 };
 
 static struct ws_option longopts[] = {
@@ -80,6 +112,7 @@ static struct ws_option longopts[] = {
 	/* Interfaces options */
 	{ "port", ws_required_argument, NULL, OPT_PORT},
 	{ "payload", ws_required_argument, NULL, OPT_PAYLOAD},
+	{ "threads", ws_required_argument, NULL, OPT_THREADS},
     { 0, 0, 0, 0 }
 };
 
@@ -98,15 +131,20 @@ static int list_config(char *interface)
 	printf("arg {number=%u}{call=--payload}{display=Payload type}"
 		"{type=string}{default=data}{tooltip=The type used to describe the payload in the exported pdu format}\n",
 		inc++);
+	printf("arg {number=%u}{call=--threads}{display=Receive threads}"
+		"{type=unsigned}{range=1,%u}{default=1}{tooltip=The number of sockets and threads receiving on the port. "
+		"Datagrams from one sender always go to the same one}\n",
+		inc++, UDPDUMP_MAX_THREADS);
 
 	extcap_config_debug(&inc);
 
 	return EXIT_SUCCESS;
 }
 
-static int setup_listener(const guint16 port, socket_handle_t* sock)
+static int setup_listener(const guint16 port, const gboolean reuse_port, socket_handle_t* sock)
 {
 	int optval;
+	socklen_t optlen;
 	struct sockaddr_in serveraddr;
 #ifndef _WIN32
 	struct timeval timeout = { 1, 0 };
@@ -125,6 +163,30 @@ static int setup_listener(const guint16 port, socket_handle_t* sock)
 		goto cleanup_setup_listener;
 	}
 
+#ifdef SO_REUSEPORT
+	/* Lets the kernel spread the datagrams over the sockets of all threads */
+	if (reuse_port && setsockopt(*sock, SOL_SOCKET, SO_REUSEPORT, (char*)&optval, (socklen_t)sizeof(int)) < 0) {
+		ws_warning("Can't set socket option SO_REUSEPORT: %s", strerror(errno));
+		goto cleanup_setup_listener;
+	}
+#else
+	ws_assert(!reuse_port);
+#endif
+
+#ifdef SO_RXQ_OVFL
+	/* Have the kernel tell us how many datagrams it dropped */
+	if (setsockopt(*sock, SOL_SOCKET, SO_RXQ_OVFL, (char*)&optval, (socklen_t)sizeof(int)) < 0)
+		ws_debug("Can't set socket option SO_RXQ_OVFL: %s", strerror(errno));
+#endif
+
+	/* A large receive buffer absorbs bursts while we're writing */
+	optval = UDPDUMP_RCVBUF_SIZE;
+	if (setsockopt(*sock, SOL_SOCKET, SO_RCVBUF, (char*)&optval, (socklen_t)sizeof(int)) < 0)
+		ws_warning("Can't set socket option SO_RCVBUF: %s", strerror(errno));
+	optlen = (socklen_t)sizeof(int);
+	if (getsockopt(*sock, SOL_SOCKET, SO_RCVBUF, (char*)&optval, &optlen) == 0)
+		ws_debug("Socket receive buffer is %d bytes", optval);
+
 #ifndef _WIN32
 	if (setsockopt (*sock, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, (socklen_t)sizeof(timeout)) < 0) {
 		ws_warning("Can't set socket option SO_RCVTIMEO: %s", strerror(errno));
@@ -160,20 +222,52 @@ static int setup_dumpfile(const char* fifo, FILE** fp)
 {
 	guint64 bytes_written = 0;
 	int err;
+	char* appname;
+	gboolean success;
 
 	if (!g_strcmp0(fifo, "-")) {
 		*fp = stdout;
-		return EXIT_SUCCESS;
+	} else {
+		*fp = fopen(fifo, "wb");
+		if (!(*fp)) {
+			ws_warning("Error creating output file: %s", g_strerror(errno));
+			return EXIT_FAILURE;
+		}
 	}
 
-	*fp = fopen(fifo, "wb");
-	if (!(*fp)) {
-		ws_warning("Error creating output file: %s", g_strerror(errno));
+	/* Packets are written a batch at a time, and flushed after each batch */
+	setvbuf(*fp, NULL, _IOFBF, UDPDUMP_OUTPUT_BUF_SIZE);
+
+	appname = ws_strdup_printf(UDPDUMP_EXTCAP_INTERFACE " (Wireshark) %s.%s.%s",
+		UDPDUMP_VERSION_MAJOR, UDPDUMP_VERSION_MINOR, UDPDUMP_VERSION_RELEASE);
+	success = pcapng_write_section_header_block(*fp,
+			NULL,    /* Comment */
+			NULL,    /* HW */
+			NULL,    /* OS */
+			appname,
+			-1,      /* section_length */
+			&bytes_written,
+			&err);
+	g_free(appname);
+	if (!success) {
+		ws_warning("Can't write pcapng file header: %s", g_strerror(err));
 		return EXIT_FAILURE;
 	}
 
-	if (!libpcap_write_file_header(*fp, 252, PCAP_SNAPLEN, FALSE, &bytes_written, &err)) {
-		ws_warning("Can't write pcap file header: %s", g_strerror(err));
+	if (!pcapng_write_interface_description_block(*fp,
+			NULL,    /* OPT_COMMENT       1 */
+			UDPDUMP_EXTCAP_INTERFACE, /* IDB_NAME  2 */
+			NULL,    /* IDB_DESCRIPTION   3 */
+			NULL,    /* IDB_FILTER       11 */
+			NULL,    /* IDB_OS           12 */
+			NULL,    /* IDB_HARDWARE     15 */
+			252,
+			PCAP_SNAPLEN,
+			&bytes_written,
+			0,       /* IDB_IF_SPEED      8 */
+			6,       /* IDB_TSRESOL       9 */
+			&err)) {
+		ws_warning("Can't write pcapng interface description: %s", g_strerror(err));
 		return EXIT_FAILURE;
 	}
 
@@ -244,73 +338,124 @@ static void add_end_options(guint8* mbuf, guint* offset)
 	*offset += 4;
 }
 
-static int dump_packet(const char* proto_name, const guint16 listenport, const char* buf,
-		const ssize_t buflen, const struct sockaddr_in clientaddr, FILE* fp)
+static void add_header(guint8* mbuf, const char* proto_name, const guint16 listenport,
+		const struct sockaddr_in* clientaddr)
 {
-	guint8* mbuf;
 	guint offset = 0;
-	gint64 curtime = g_get_real_time();
-	guint64 bytes_written = 0;
-	int err;
-	int ret = EXIT_SUCCESS;
-
-	/* The space we need is the standard header + variable lengths */
-	mbuf = (guint8*)g_malloc0(UDPDUMP_EXPORT_HEADER_LEN + ((strlen(proto_name) + 3) & 0xfffffffc) + buflen);
 
 	add_proto_name(mbuf, &offset, proto_name);
-	add_ip_source_address(mbuf, &offset, clientaddr.sin_addr.s_addr);
+	add_ip_source_address(mbuf, &offset, clientaddr->sin_addr.s_addr);
 	add_ip_dest_address(mbuf, &offset, WS_IN4_LOOPBACK);
-	add_udp_source_port(mbuf, &offset, clientaddr.sin_port);
+	add_udp_source_port(mbuf, &offset, clientaddr->sin_port);
 	add_udp_dst_port(mbuf, &offset, listenport);
 	add_end_options(mbuf, &offset);
+}
 
-	memcpy(mbuf + offset, buf, buflen);
-	offset += (guint)buflen;
-
-	if (!libpcap_write_packet(fp,
-			(guint32)(curtime / G_USEC_PER_SEC), (guint32)(curtime % G_USEC_PER_SEC),
-			offset, offset, mbuf, &bytes_written, &err)) {
-		ws_warning("Can't write packet: %s", g_strerror(err));
+/*
+ * Each packet buffer has room for the exported PDU tags in front of the
+ * payload, so that a datagram is received straight into the place where
+ * it is written from.
+ */
+static int dump_packets(udpdump_output_t* output, guint8** bufs, const gsize* lens,
+		const struct sockaddr_in* clientaddrs, const int count)
+{
+	gint64 curtime = g_get_real_time();
+	guint64 bytes_written = 0;
+	int err;
+	int ret = EXIT_SUCCESS;
+	int i;
+
+	g_mutex_lock(&output->fp_mutex);
+	for (i = 0; i < count; i++) {
+		guint32 len = output->header_len + (guint32)lens[i];
+
+		add_header(bufs[i], output->proto_name, output->port, &clientaddrs[i]);
+		if (!pcapng_write_enhanced_packet_block(output->fp, NULL,
+				(time_t)(curtime / G_USEC_PER_SEC), (guint32)(curtime % G_USEC_PER_SEC),
+				len, len, 0, 1000000, bufs[i], 0, &bytes_written, &err)) {
+			ws_warning("Can't write packet: %s", g_strerror(err));
+			ret = EXIT_FAILURE;
+			break;
+		}
+	}
+	if (fflush(output->fp) != 0 && ret == EXIT_SUCCESS) {
+		ws_warning("Can't write packet: %s", g_strerror(errno));
 		ret = EXIT_FAILURE;
 	}
+	g_mutex_unlock(&output->fp_mutex);
 
-	fflush(fp);
-
-	g_free(mbuf);
 	return ret;
 }
 
-static void run_listener(const char* fifo, const guint16 port, const char* proto_name)
+/* Returns the number of datagrams received, or -1 on error */
+static int receive_packets(udpdump_receiver_t* receiver, guint8** bufs, gsize* lens,
+		struct sockaddr_in* clientaddrs)
 {
-	struct sockaddr_in clientaddr;
-	socklen_t clientlen = sizeof(clientaddr);
-	socket_handle_t sock;
-	char* buf;
-	ssize_t buflen;
-	FILE* fp = NULL;
-
-	if (signal(SIGINT, exit_from_loop) == SIG_ERR) {
-		ws_warning("Can't set signal handler");
-		return;
+	guint header_len = receiver->output->header_len;
+#ifdef HAVE_RECVMMSG
+	struct mmsghdr msgs[UDPDUMP_BATCH_SIZE];
+	struct iovec iovs[UDPDUMP_BATCH_SIZE];
+	union {
+		char buf[CMSG_SPACE(sizeof(guint32))];
+		struct cmsghdr align;
+	} control[UDPDUMP_BATCH_SIZE];
+	int count;
+	int i;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < UDPDUMP_BATCH_SIZE; i++) {
+		iovs[i].iov_base = bufs[i] + header_len;
+		iovs[i].iov_len = PKT_BUF_SIZE;
+		msgs[i].msg_hdr.msg_name = &clientaddrs[i];
+		msgs[i].msg_hdr.msg_namelen = (socklen_t)sizeof(clientaddrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = control[i].buf;
+		msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
 	}
 
-	if (setup_dumpfile(fifo, &fp) == EXIT_FAILURE) {
-		if (fp)
-			fclose(fp);
-		return;
+	/* Wait for the first datagram only, then take whatever else is queued */
+	count = recvmmsg(receiver->sock, msgs, UDPDUMP_BATCH_SIZE, MSG_WAITFORONE, NULL);
+	for (i = 0; i < count; i++) {
+		lens[i] = msgs[i].msg_len;
+#ifdef SO_RXQ_OVFL
+		for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+				guint32 dropped;
+				memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+				receiver->dropped = dropped;
+			}
+		}
+#endif
 	}
+	return count;
+#else
+	socklen_t clientlen = sizeof(clientaddrs[0]);
+	ssize_t buflen;
 
-	if (setup_listener(port, &sock) == EXIT_FAILURE)
-		return;
+	buflen = recvfrom(receiver->sock, (char*)bufs[0] + header_len, PKT_BUF_SIZE, 0,
+		(struct sockaddr *)&clientaddrs[0], &clientlen);
+	if (buflen < 0)
+		return -1;
+	lens[0] = (gsize)buflen;
+	return 1;
+#endif
+}
 
-	ws_debug("Listener running on port %u", port);
+static void run_receiver(udpdump_receiver_t* receiver)
+{
+	guint8* bufs[UDPDUMP_BATCH_SIZE];
+	gsize lens[UDPDUMP_BATCH_SIZE];
+	struct sockaddr_in clientaddrs[UDPDUMP_BATCH_SIZE];
+	int count;
+	int i;
 
-	buf = (char*)g_malloc(PKT_BUF_SIZE);
-	while(run_loop == TRUE) {
-		memset(buf, 0x0, PKT_BUF_SIZE);
+	for (i = 0; i < UDPDUMP_BATCH_SIZE; i++)
+		bufs[i] = (guint8*)g_malloc(receiver->output->header_len + PKT_BUF_SIZE);
 
-		buflen = recvfrom(sock, buf, PKT_BUF_SIZE, 0, (struct sockaddr *)&clientaddr, &clientlen);
-		if (buflen < 0) {
+	while(run_loop == TRUE) {
+		count = receive_packets(receiver, bufs, lens, clientaddrs);
+		if (count < 0) {
 			switch(errno) {
 				case EAGAIN:
 				case EINTR:
@@ -334,14 +479,99 @@ static void run_listener(const char* fifo, const guint16 port, const char* proto
 					break;
 			}
 		} else {
-			if (dump_packet(proto_name, port, buf, buflen, clientaddr, fp) == EXIT_FAILURE)
+			receiver->received += count;
+			if (dump_packets(receiver->output, bufs, lens, clientaddrs, count) == EXIT_FAILURE)
 				run_loop = FALSE;
 		}
 	}
 
+	for (i = 0; i < UDPDUMP_BATCH_SIZE; i++)
+		g_free(bufs[i]);
+}
+
+static gpointer receiver_thread(gpointer data)
+{
+	run_receiver((udpdump_receiver_t*)data);
+	return NULL;
+}
+
+static void run_listener(const char* fifo, const guint16 port, const char* proto_name, guint num_threads)
+{
+	udpdump_output_t output;
+	udpdump_receiver_t* receivers;
+	GThread** threads;
+	gint64 start_time;
+	guint64 received = 0;
+	guint64 dropped = 0;
+	guint64 isb_ifrecv, isb_ifdrop;
+	guint64 bytes_written = 0;
+	int err;
+	guint i;
+	FILE* fp = NULL;
+
+	if (signal(SIGINT, exit_from_loop) == SIG_ERR) {
+		ws_warning("Can't set signal handler");
+		return;
+	}
+
+	if (setup_dumpfile(fifo, &fp) == EXIT_FAILURE) {
+		if (fp)
+			fclose(fp);
+		return;
+	}
+
+	output.port = port;
+	output.proto_name = proto_name;
+	output.header_len = UDPDUMP_EXPORT_HEADER_LEN + (guint)((strlen(proto_name) + 3) & 0xfffffffc);
+	output.fp = fp;
+	g_mutex_init(&output.fp_mutex);
+
+	receivers = g_new0(udpdump_receiver_t, num_threads);
+	threads = g_new0(GThread*, num_threads);
+	for (i = 0; i < num_threads; i++) {
+		receivers[i].output = &output;
+		if (setup_listener(port, num_threads > 1, &receivers[i].sock) == EXIT_FAILURE) {
+			while (i-- > 0)
+				closesocket(receivers[i].sock);
+			goto cleanup;
+		}
+	}
+
+	ws_debug("Listener running on port %u with %u thread(s)", port, num_threads);
+
+	start_time = g_get_real_time();
+	for (i = 1; i < num_threads; i++)
+		threads[i] = g_thread_new("udpdump receiver", receiver_thread, &receivers[i]);
+	run_receiver(&receivers[0]);
+	for (i = 1; i < num_threads; i++)
+		g_thread_join(threads[i]);
+
+	for (i = 0; i < num_threads; i++) {
+		received += receivers[i].received;
+		dropped += receivers[i].dropped;
+		closesocket(receivers[i].sock);
+	}
+
+#ifdef SO_RXQ_OVFL
+	isb_ifrecv = received + dropped;
+	isb_ifdrop = dropped;
+#else
+	/* We don't know how many were dropped */
+	isb_ifrecv = G_MAXUINT64;
+	isb_ifdrop = G_MAXUINT64;
+#endif
+	if (!pcapng_write_interface_statistics_block(fp, 0, &bytes_written,
+			"Counters provided by udpdump",
+			(guint64)start_time, (guint64)g_get_real_time(),
+			isb_ifrecv, isb_ifdrop, &err))
+		ws_warning("Can't write interface statistics: %s", g_strerror(err));
+	ws_debug("Received %" PRIu64 " datagrams, the kernel dropped %" PRIu64, received, dropped);
+
+cleanup:
 	fclose(fp);
-	closesocket(sock);
-	g_free(buf);
+	g_mutex_clear(&output.fp_mutex);
+	g_free(threads);
+	g_free(receivers);
 }
 
 int main(int argc, char *argv[])
@@ -356,6 +586,7 @@ int main(int argc, char *argv[])
 	char* help_header = NULL;
 	char* payload = NULL;
 	char* port_msg = NULL;
+	guint32 num_threads = 1;
 
 	/* Initialize log handler early so we can have proper logging during startup. */
 	extcap_log_init("udpdump");
@@ -395,6 +626,8 @@ int main(int argc, char *argv[])
 	port_msg = ws_strdup_printf("the port to listens on. Default: %u", UDPDUMP_DEFAULT_PORT);
 	extcap_help_add_option(extcap_conf, "--port <port>", port_msg);
 	g_free(port_msg);
+	extcap_help_add_option(extcap_conf, "--payload <type>", "the type used to describe the payload. Default: data");
+	extcap_help_add_option(extcap_conf, "--threads <count>", "the number of receive threads. Default: 1");
 
 	ws_opterr = 0;
 	ws_optind = 0;
@@ -428,6 +661,13 @@ int main(int argc, char *argv[])
 			payload = g_strdup(ws_optarg);
 			break;
 
+		case OPT_THREADS:
+			if (!ws_strtou32(ws_optarg, NULL, &num_threads) || num_threads < 1 || num_threads > UDPDUMP_MAX_THREADS) {
+				ws_warning("Invalid number of threads: %s", ws_optarg);
+				goto end;
+			}
+			break;
+
 		case ':':
 			/* missing option argument */
 			ws_warning("Option '%s' requires an argument", argv[ws_optind - 1]);
@@ -472,8 +712,15 @@ int main(int argc, char *argv[])
 	if (port == 0)
 		port = UDPDUMP_DEFAULT_PORT;
 
+#ifndef SO_REUSEPORT
+	if (num_threads > 1) {
+		ws_warning("More than one receive thread isn't supported on this platform");
+		num_threads = 1;
+	}
+#endif
+
 	if (extcap_conf->capture)
-		run_listener(extcap_conf->fifo, port, payload);
+		run_listener(extcap_conf->fifo, port, payload, num_threads);
 
 end:
 	/* clean up stuff */
@@ -22,6 +22,8 @@
 #include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/json_dumper.h>
+#include <wsutil/str_util.h>
+#include <wsutil/ws_mempbrk.h>
 #include <wsutil/wslog.h>
 #include <wsutil/ws_assert.h>
 #include <ui/version_info.h>
@@ -74,9 +76,11 @@
 #endif
 
 static gboolean read_record(capture_file *cf, wtap_rec *rec, Buffer *buf,
-    dfilter_t *dfcode, epan_dissect_t *edt, column_info *cinfo, gint64 offset);
+    dfilter_t *dfcode, epan_dissect_t *edt, column_info *cinfo, gint64 offset,
+    gboolean dissect);
 
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect);
+static void clear_dfilter_results(capture_file *cf);
 
 typedef enum {
   MR_NOTMATCHED,
@@ -111,6 +115,10 @@ static gboolean find_packet(capture_file *cf, ws_match_function match_function,
 
 static void cf_rename_failure_alert_box(const char *filename, int err);
 
+static cf_read_status_t cf_retap_packets_in(capture_file *cf, const gchar *range_str);
+
+static void dissected_frames_flush(void);
+
 /* Seconds spent processing packets between pushing UI updates. */
 #define PROGBAR_UPDATE_INTERVAL 0.150
 
@@ -306,6 +314,7 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   cf->marked_count = 0;
   cf->ignored_count = 0;
   cf->ref_time_count = 0;
+  cf->sample_skipped = 0;
   cf->drops_known = FALSE;
   cf->drops     = 0;
   cf->snap      = wtap_snapshot_length(cf->provider.wth);
@@ -368,6 +377,9 @@ cf_close(capture_file *cf)
 
   cf_callback_invoke(cf_cb_file_closing, cf);
 
+  /* The kept dissections refer to the frames and to the session. */
+  dissected_frames_flush();
+
   /* close things, if not already closed before */
   color_filters_cleanup();
 
@@ -402,10 +414,13 @@ cf_close(capture_file *cf)
 
   dfilter_free(cf->rfcode);
   cf->rfcode = NULL;
+  clear_dfilter_results(cf);
   if (cf->provider.frames != NULL) {
     free_frame_data_sequence(cf->provider.frames);
     cf->provider.frames = NULL;
   }
+  /* Decrypted data kept across redissections refers to these frames. */
+  secrets_cache_clear();
   if (cf->provider.frames_modified_blocks) {
     g_tree_destroy(cf->provider.frames_modified_blocks);
     cf->provider.frames_modified_blocks = NULL;
@@ -651,7 +666,7 @@ cf_read(capture_file *cf, gboolean reloading)
            hours even on fast machines) just to see that it was the wrong file. */
         break;
       }
-      read_record(cf, &rec, &buf, dfcode, &edt, cinfo, data_offset);
+      read_record(cf, &rec, &buf, dfcode, &edt, cinfo, data_offset, TRUE);
       wtap_rec_reset(&rec);
     }
   }
@@ -783,6 +798,7 @@ cf_continue_tail(capture_file *cf, volatile int to_read, wtap_rec *rec,
   gboolean          create_proto_tree;
   guint             tap_flags;
   gboolean          compiled _U_;
+  guint             sample_interval = prefs.capture_sample_interval;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -837,7 +853,13 @@ cf_continue_tail(capture_file *cf, volatile int to_read, wtap_rec *rec,
            aren't any packets left to read) exit. */
         break;
       }
-      if (read_record(cf, rec, buf, dfcode, &edt, cinfo, data_offset)) {
+      /*
+       * If the user only wants to see a sample of the packets while
+       * capturing, just add the others to the frame list; they're
+       * dissected when the capture stops.
+       */
+      if (read_record(cf, rec, buf, dfcode, &edt, cinfo, data_offset,
+                      sample_interval <= 1 || cf->count % sample_interval == 0)) {
         newly_displayed_packets++;
       }
       to_read--;
@@ -968,7 +990,10 @@ cf_finish_tail(capture_file *cf, wtap_rec *rec, Buffer *buf, int *err)
          aren't any packets left to read) exit. */
       break;
     }
-    read_record(cf, rec, buf, dfcode, &edt, cinfo, data_offset);
+    /* If we skipped packets while capturing, everything gets dissected
+       again below, so don't bother dissecting the rest now. */
+    read_record(cf, rec, buf, dfcode, &edt, cinfo, data_offset,
+                cf->sample_skipped == 0);
     wtap_rec_reset(rec);
   }
 
@@ -1009,6 +1034,12 @@ cf_finish_tail(capture_file *cf, wtap_rec *rec, Buffer *buf, int *err)
    * has likely grown since we first stat-ed it */
   fileset_update_file(cf->filename);
 
+  /* Some packets were only added to the frame list while capturing;
+     dissect all of them in order now. */
+  if (cf->sample_skipped != 0) {
+    rescan_packets(cf, "Reprocessing", "all packets", TRUE);
+  }
+
   if (*err != 0) {
     /* We got an error reading the capture file.
        XXX - pop up a dialog box? */
@@ -1242,12 +1273,15 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
 
 /*
  * Read in a new record.
+ * If "dissect" is FALSE, it is only added to the frame list, and is
+ * left for the redissection at the end of a sampled live capture.
  * Returns TRUE if the packet was added to the packet (record) list,
  * FALSE otherwise.
  */
 static gboolean
 read_record(capture_file *cf, wtap_rec *rec, Buffer *buf, dfilter_t *dfcode,
-            epan_dissect_t *edt, column_info *cinfo, gint64 offset)
+            epan_dissect_t *edt, column_info *cinfo, gint64 offset,
+            gboolean dissect)
 {
   frame_data    fdlocal;
   frame_data   *fdata;
@@ -1293,7 +1327,9 @@ read_record(capture_file *cf, wtap_rec *rec, Buffer *buf, dfilter_t *dfcode,
 
     /* When a redissection is in progress (or queued), do not process packets.
      * This will be done once all (new) packets have been scanned. */
-    if (!cf->redissecting && cf->redissection_queued == RESCAN_NONE) {
+    if (!dissect) {
+      cf->sample_skipped++;
+    } else if (!cf->redissecting && cf->redissection_queued == RESCAN_NONE) {
       add_packet_to_packet_list(fdata, cf, edt, dfcode, cinfo, rec, buf, TRUE);
     }
   }
@@ -1416,6 +1452,7 @@ cf_merge_files_to_tempfile(gpointer pd_window, const char *temp_dir, char **out_
   cb_data->pd_window = pd_window;
   cb.callback_func = merge_callback;
   cb.data = cb_data;
+  cb.record_filter = NULL;
 
   cf_callback_invoke(cf_cb_file_merge_started, NULL);
 
@@ -1608,6 +1645,201 @@ cf_read_current_record(capture_file *cf)
   return cf_read_record(cf, cf->current_frame, &cf->rec, &cf->buf);
 }
 
+/*
+ * The frames that passed each of the last few display filters applied to
+ * the whole file, and the frames those depend upon. Switching back to one
+ * of those filters then needs no dissection at all, and a filter that only
+ * adds conditions to one of them ("A" -> "A && B") only has to look at the
+ * frames that passed it.
+ */
+#define DFILTER_RESULTS_MAX 8
+
+typedef struct {
+  gchar   *text;
+  guint32  count;
+  guint8  *passed;
+  guint8  *depended;
+} dfilter_result_t;
+
+#define DFILTER_RESULT_BIT(bits, num) \
+  (((bits)[((num) - 1) >> 3] >> (((num) - 1) & 7)) & 1)
+
+static void
+dfilter_result_free(gpointer data)
+{
+  dfilter_result_t *result = (dfilter_result_t *)data;
+
+  g_free(result->text);
+  g_free(result->passed);
+  g_free(result->depended);
+  g_free(result);
+}
+
+static void
+clear_dfilter_results(capture_file *cf)
+{
+  g_slist_free_full(cf->dfilter_results, dfilter_result_free);
+  cf->dfilter_results = NULL;
+}
+
+/*
+ * Fields whose value can change without the frames being redissected,
+ * e.g. by marking a frame or setting a time reference. Results of filters
+ * that use them can't be reused.
+ */
+static const char *dfilter_volatile_fields[] = {
+  "frame.marked",
+  "frame.ignored",
+  "frame.ref_time",
+  "frame.time_relative",
+  "frame.time_delta_displayed",
+  "frame.time_reference",
+  "frame.comment",
+  "frame.coloring_rule.name",
+  "frame.coloring_rule.string",
+};
+
+static gboolean
+dfilter_result_reusable(const dfilter_t *dfcode)
+{
+  const int *fields;
+  int count, i;
+  guint j;
+
+  fields = dfilter_interesting_fields(dfcode, &count);
+  for (i = 0; i < count; i++) {
+    header_field_info *hfinfo = proto_registrar_get_nth(fields[i]);
+
+    for (j = 0; j < G_N_ELEMENTS(dfilter_volatile_fields); j++) {
+      if (strcmp(hfinfo->abbrev, dfilter_volatile_fields[j]) == 0)
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/*
+ * Is "text" made of "base" followed by "&&" or "and" and something else?
+ * "&&" has the lowest precedence of all operators and "base" compiled on
+ * its own, so the rest can't bind to anything inside it, and "text" can
+ * only match frames that "base" matches.
+ */
+static gboolean
+dfilter_text_narrows(const char *text, const char *base)
+{
+  size_t len = strlen(base);
+  const char *p;
+
+  if (len == 0 || strncmp(text, base, len) != 0)
+    return FALSE;
+
+  p = text + len;
+  if (p[0] == '&' && p[1] == '&')
+    return TRUE;
+  if (!g_ascii_isspace(*p))
+    return FALSE;
+  while (g_ascii_isspace(*p))
+    p++;
+  if (p[0] == '&' && p[1] == '&')
+    return TRUE;
+  return strncmp(p, "and", 3) == 0 &&
+         (g_ascii_isspace(p[3]) || p[3] == '(' || p[3] == '!');
+}
+
+/* Find the result of filter "text", making it the most recent one. */
+static dfilter_result_t *
+find_dfilter_result(capture_file *cf, const char *text)
+{
+  GSList *item;
+
+  for (item = cf->dfilter_results; item; item = item->next) {
+    dfilter_result_t *result = (dfilter_result_t *)item->data;
+
+    if (strcmp(result->text, text) == 0) {
+      cf->dfilter_results = g_slist_remove_link(cf->dfilter_results, item);
+      cf->dfilter_results = g_slist_concat(item, cf->dfilter_results);
+      return result;
+    }
+  }
+  return NULL;
+}
+
+/* Find the result of a filter that "text" adds conditions to. */
+static dfilter_result_t *
+find_narrowed_dfilter_result(capture_file *cf, const char *text)
+{
+  GSList *item;
+  dfilter_result_t *best = NULL;
+
+  /* The longest base rejects the most frames. */
+  for (item = cf->dfilter_results; item; item = item->next) {
+    dfilter_result_t *result = (dfilter_result_t *)item->data;
+
+    if (dfilter_text_narrows(text, result->text) &&
+        (best == NULL || strlen(result->text) > strlen(best->text)))
+      best = result;
+  }
+  return best;
+}
+
+static void
+save_dfilter_result(capture_file *cf, const char *text, guint32 frames_count)
+{
+  dfilter_result_t *result;
+  GSList *item;
+  guint32 framenum;
+
+  result = find_dfilter_result(cf, text);
+  if (result) {
+    cf->dfilter_results = g_slist_remove(cf->dfilter_results, result);
+    dfilter_result_free(result);
+  }
+
+  result = g_new(dfilter_result_t, 1);
+  result->text = g_strdup(text);
+  result->count = frames_count;
+  result->passed = (guint8 *)g_malloc0(frames_count / 8 + 1);
+  result->depended = (guint8 *)g_malloc0(frames_count / 8 + 1);
+  for (framenum = 1; framenum <= frames_count; framenum++) {
+    frame_data *fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+    guint8 bit = 1 << ((framenum - 1) & 7);
+
+    if (fdata->passed_dfilter)
+      result->passed[(framenum - 1) >> 3] |= bit;
+    if (fdata->dependent_of_displayed)
+      result->depended[(framenum - 1) >> 3] |= bit;
+  }
+  cf->dfilter_results = g_slist_prepend(cf->dfilter_results, result);
+
+  item = g_slist_nth(cf->dfilter_results, DFILTER_RESULTS_MAX - 1);
+  if (item && item->next) {
+    g_slist_free_full(item->next, dfilter_result_free);
+    item->next = NULL;
+  }
+}
+
+/*
+ * Like add_packet_to_packet_list(), for a frame whose display filter
+ * result we already know.
+ */
+static void
+set_packet_filter_result(frame_data *fdata, capture_file *cf, gboolean passed)
+{
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &cf->provider.ref, cf->provider.prev_dis);
+  cf->provider.prev_cap = fdata;
+
+  fdata->passed_dfilter = passed ? 1 : 0;
+  if (fdata->passed_dfilter || fdata->ref_time) {
+    cf->displayed_count++;
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->provider.prev_dis = fdata;
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+  }
+}
+
 /* Rescan the list of packets, reconstructing the CList.
 
    "action" describes why we're doing this; it's used in the progress
@@ -1646,12 +1878,27 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    compiled _U_;
   guint32     frames_count;
   gboolean    queued_rescan_type = RESCAN_NONE;
+  gboolean    skip_dissection;
+  gboolean    dissect_frame;
+  dfilter_result_t *known_result = NULL;
+  dfilter_result_t *narrowed_result = NULL;
 
   /* Rescan in progress, clear pending actions. */
   cf->redissection_queued = RESCAN_NONE;
   ws_assert(!cf->read_lock);
   cf->read_lock = TRUE;
 
+  /* Kept dissections show times relative to the previously displayed
+     frame, and maybe preferences that are about to change. */
+  dissected_frames_flush();
+
+  /* Frames skipped during a sampled live capture were never dissected
+     or added to the packet list, so they need a full redissection. */
+  if (cf->sample_skipped != 0) {
+    redissect = TRUE;
+    cf->sample_skipped = 0;
+  }
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
@@ -1686,6 +1933,28 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
      (tap_flags & TL_REQUIRES_PROTO_TREE) ||
      (redissect && postdissectors_want_hfids()));
 
+  /*
+   * If nothing but the display filter needs the frames, we can skip
+   * dissecting the ones whose result we already know: all of them if
+   * there's no filter or we've applied this one before, or the ones a
+   * filter it narrows rejected.
+   */
+  if (redissect) {
+    clear_dfilter_results(cf);
+    skip_dissection = FALSE;
+  } else if (tap_listeners_require_dissection()) {
+    skip_dissection = FALSE;
+  } else if (dfcode == NULL) {
+    skip_dissection = TRUE;
+  } else {
+    known_result = find_dfilter_result(cf, cf->dfilter);
+    if (known_result && known_result->count != cf->count)
+      known_result = NULL;
+    if (known_result == NULL)
+      narrowed_result = find_narrowed_dfilter_result(cf, cf->dfilter);
+    skip_dissection = known_result != NULL || narrowed_result != NULL;
+  }
+
   reset_tap_listeners();
   /* Which frame, if any, is the currently selected frame?
      XXX - should the selected frame or the focus frame be the "current"
@@ -1858,7 +2127,15 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
     fdata->dependent_of_displayed = 0;
 
-    if (!cf_read_record(cf, fdata, &rec, &buf))
+    if (!skip_dissection)
+      dissect_frame = TRUE;
+    else if (narrowed_result)
+      dissect_frame = framenum > narrowed_result->count ||
+                      DFILTER_RESULT_BIT(narrowed_result->passed, framenum);
+    else
+      dissect_frame = FALSE;
+
+    if (dissect_frame && !cf_read_record(cf, fdata, &rec, &buf))
       break; /* error reading the frame */
 
     /* If the previous frame is displayed, and we haven't yet seen the
@@ -1869,9 +2146,18 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &rec, &buf,
-                                    add_to_packet_list);
+    if (dissect_frame) {
+      add_packet_to_packet_list(fdata, cf, &edt, dfcode,
+                                      cinfo, &rec, &buf,
+                                      add_to_packet_list);
+    } else if (known_result) {
+      fdata->dependent_of_displayed = DFILTER_RESULT_BIT(known_result->depended, framenum);
+      set_packet_filter_result(fdata, cf, DFILTER_RESULT_BIT(known_result->passed, framenum));
+    } else {
+      /* With no filter every frame passes; a narrower filter rejects
+         whatever the filter it narrows rejected. */
+      set_packet_filter_result(fdata, cf, narrowed_result == NULL);
+    }
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -1901,6 +2187,12 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   /* We are done redissecting the packet list. */
   cf->redissecting = FALSE;
 
+  /* Remember which frames this filter passed if we looked at all of them. */
+  if (framenum > frames_count && dfcode != NULL && known_result == NULL &&
+      dfilter_result_reusable(dfcode)) {
+    save_dfilter_result(cf, cf->dfilter, frames_count);
+  }
+
   if (redissect) {
       frames_count = cf->count;
     /* Clear out what remains of the visited flags and per-frame data
@@ -2010,6 +2302,63 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
 }
 
 
+/*
+ * Recalculate one frame's ref time and cumulative byte count, given the
+ * reference frame and byte count so far in cf->provider.ref and
+ * cf->cum_bytes, and update those.
+ */
+static void
+reftime_packet(capture_file *cf, frame_data *fdata)
+{
+  nstime_t rel_ts;
+
+  /* just add some value here until we know if it is being displayed or not */
+  fdata->cum_bytes = cf->cum_bytes + fdata->pkt_len;
+
+  /*
+   *Timestamps
+   */
+
+  /* If we don't have the time stamp of the first packet in the
+   capture, it's because this is the first packet.  Save the time
+   stamp of this packet as the time stamp of the first packet. */
+  if (cf->provider.ref == NULL)
+      cf->provider.ref = fdata;
+    /* if this frames is marked as a reference time frame, reset
+      firstsec and firstusec to this frame */
+  if (fdata->ref_time)
+      cf->provider.ref = fdata;
+
+  /* Get the time elapsed between the first packet and this packet. */
+  fdata->frame_ref_num = (fdata != cf->provider.ref) ? cf->provider.ref->num : 0;
+  nstime_delta(&rel_ts, &fdata->abs_ts, &cf->provider.ref->abs_ts);
+
+  /* If it's greater than the current elapsed time, set the elapsed time
+   to it (we check for "greater than" so as not to be confused by
+   time moving backwards). */
+  if ((gint32)cf->elapsed_time.secs < rel_ts.secs
+      || ((gint32)cf->elapsed_time.secs == rel_ts.secs && (gint32)cf->elapsed_time.nsecs < rel_ts.nsecs)) {
+      cf->elapsed_time = rel_ts;
+  }
+
+  /*
+   * Byte counts
+   */
+  if ( (fdata->passed_dfilter) || (fdata->ref_time) ) {
+      /* This frame either passed the display filter list or is marked as
+      a time reference frame.  All time reference frames are displayed
+      even if they don't pass the display filter */
+      if (fdata->ref_time) {
+          /* if this was a TIME REF frame we should reset the cum_bytes field */
+          cf->cum_bytes = fdata->pkt_len;
+          fdata->cum_bytes = cf->cum_bytes;
+      } else {
+          /* increase cum_bytes with this packets length */
+          cf->cum_bytes += fdata->pkt_len;
+      }
+  }
+}
+
 /*
  * Scan through all frame data and recalculate the ref time
  * without rereading the file.
@@ -2020,31 +2369,18 @@ cf_reftime_packets(capture_file* cf)
 {
   guint32     framenum;
   frame_data *fdata;
-  nstime_t rel_ts;
 
   cf->provider.ref = NULL;
   cf->provider.prev_dis = NULL;
   cf->cum_bytes = 0;
 
+  /* Kept dissections show times relative to the old reference frames. */
+  dissected_frames_flush();
+
   for (framenum = 1; framenum <= cf->count; framenum++) {
     fdata = frame_data_sequence_find(cf->provider.frames, framenum);
 
-    /* just add some value here until we know if it is being displayed or not */
-    fdata->cum_bytes = cf->cum_bytes + fdata->pkt_len;
-
-    /*
-     *Timestamps
-     */
-
-    /* If we don't have the time stamp of the first packet in the
-     capture, it's because this is the first packet.  Save the time
-     stamp of this packet as the time stamp of the first packet. */
-    if (cf->provider.ref == NULL)
-        cf->provider.ref = fdata;
-      /* if this frames is marked as a reference time frame, reset
-        firstsec and firstusec to this frame */
-    if (fdata->ref_time)
-        cf->provider.ref = fdata;
+    reftime_packet(cf, fdata);
 
     /* If we don't have the time stamp of the previous displayed packet,
      it's because this is the first displayed packet.  Save the time
@@ -2054,42 +2390,58 @@ cf_reftime_packets(capture_file* cf)
         cf->provider.prev_dis = fdata;
     }
 
-    /* Get the time elapsed between the first packet and this packet. */
-    fdata->frame_ref_num = (fdata != cf->provider.ref) ? cf->provider.ref->num : 0;
-    nstime_delta(&rel_ts, &fdata->abs_ts, &cf->provider.ref->abs_ts);
-
-    /* If it's greater than the current elapsed time, set the elapsed time
-     to it (we check for "greater than" so as not to be confused by
-     time moving backwards). */
-    if ((gint32)cf->elapsed_time.secs < rel_ts.secs
-        || ((gint32)cf->elapsed_time.secs == rel_ts.secs && (gint32)cf->elapsed_time.nsecs < rel_ts.nsecs)) {
-        cf->elapsed_time = rel_ts;
-    }
-
     /* If this frame is displayed, get the time elapsed between the
      previous displayed packet and this packet. */
     if ( fdata->passed_dfilter ) {
         fdata->prev_dis_num = cf->provider.prev_dis->num;
         cf->provider.prev_dis = fdata;
     }
+  }
+}
+
+guint32
+cf_reftime_packet_changed(capture_file *cf, frame_data *fdata)
+{
+  guint32     framenum, last_framenum;
+  frame_data *cur;
+  frame_data *end_ref = cf->provider.ref;
+  guint32     end_cum_bytes = cf->cum_bytes;
+
+  /* Kept dissections show times relative to the old reference frames. */
+  dissected_frames_flush();
+
+  /* Start from the reference frame and byte count in effect just before
+     this frame; the frames before it don't depend on it. */
+  cf->provider.ref = NULL;
+  cf->cum_bytes = 0;
+  if (fdata->num > 1) {
+    cur = frame_data_sequence_find(cf->provider.frames, fdata->num - 1);
+    cf->provider.ref = cur->frame_ref_num ?
+        frame_data_sequence_find(cf->provider.frames, cur->frame_ref_num) : cur;
+
+    for (framenum = fdata->num - 1; framenum >= 1; framenum--) {
+      cur = frame_data_sequence_find(cf->provider.frames, framenum);
+      if (cur->passed_dfilter || cur->ref_time) {
+        cf->cum_bytes = cur->cum_bytes;
+        break;
+      }
+    }
+  }
 
-    /*
-     * Byte counts
-     */
-    if ( (fdata->passed_dfilter) || (fdata->ref_time) ) {
-        /* This frame either passed the display filter list or is marked as
-        a time reference frame.  All time reference frames are displayed
-        even if they don't pass the display filter */
-        if (fdata->ref_time) {
-            /* if this was a TIME REF frame we should reset the cum_bytes field */
-            cf->cum_bytes = fdata->pkt_len;
-            fdata->cum_bytes = cf->cum_bytes;
-        } else {
-            /* increase cum_bytes with this packets length */
-            cf->cum_bytes += fdata->pkt_len;
-        }
+  /* The next time reference starts over, so stop there. */
+  last_framenum = fdata->num;
+  for (framenum = fdata->num; framenum <= cf->count; framenum++) {
+    cur = frame_data_sequence_find(cf->provider.frames, framenum);
+    if (cur != fdata && cur->ref_time) {
+      cf->provider.ref = end_ref;
+      cf->cum_bytes = end_cum_bytes;
+      break;
     }
+    reftime_packet(cf, cur);
+    last_framenum = framenum;
   }
+
+  return last_framenum;
 }
 
 typedef enum {
@@ -2248,6 +2600,39 @@ retap_packet(capture_file *cf, frame_data *fdata, wtap_rec *rec, Buffer *buf,
 
 cf_read_status_t
 cf_retap_packets(capture_file *cf)
+{
+  return cf_retap_packets_in(cf, NULL);
+}
+
+cf_read_status_t
+cf_retap_packet_range(capture_file *cf, guint32 first_frame, guint32 last_frame)
+{
+  gchar            *range_str;
+  cf_read_status_t  status;
+
+  range_str = g_strdup_printf("%u-%u", first_frame, last_frame);
+  status = cf_retap_packets_in(cf, range_str);
+  g_free(range_str);
+
+  return status;
+}
+
+cf_read_status_t
+cf_retap_frame_list(capture_file *cf, const frame_list_t *frames)
+{
+  gchar            *range_str;
+  cf_read_status_t  status;
+
+  range_str = frame_list_to_range_str(frames);
+  status = cf_retap_packets_in(cf, range_str);
+  g_free(range_str);
+
+  return status;
+}
+
+/* A NULL range_str means all packets. */
+static cf_read_status_t
+cf_retap_packets_in(capture_file *cf, const gchar *range_str)
 {
   packet_range_t        range;
   retap_callback_args_t callback_args;
@@ -2287,11 +2672,15 @@ cf_retap_packets(capture_file *cf)
   /* Iterate through the list of packets, dissecting all packets and
      re-running the taps. */
   packet_range_init(&range, cf);
+  if (range_str != NULL) {
+    packet_range_convert_str(&range, range_str);
+    range.process = range_process_user_range;
+  }
   packet_range_process_init(&range);
 
   ret = process_specified_records(cf, &range, "Recalculating statistics on",
-                                  "all packets", TRUE, retap_packet,
-                                  &callback_args, TRUE);
+                                  range_str != NULL ? "packets in range" : "all packets",
+                                  TRUE, retap_packet, &callback_args, TRUE);
 
   packet_range_cleanup(&range);
   epan_dissect_cleanup(&callback_args.edt);
@@ -3248,8 +3637,9 @@ match_summary_line(capture_file *cf, frame_data *fdata,
 }
 
 typedef struct {
-    const guint8 *data;
-    size_t        data_len;
+    const guint8      *data;
+    size_t             data_len;
+    ws_mempbrk_pattern first_char;  /* Bytes that can start a string match */
 } cbs_t;    /* "Counted byte string" */
 
 
@@ -3272,6 +3662,24 @@ cf_find_packet_data(capture_file *cf, const guint8 *string, size_t string_size,
   info.data = string;
   info.data_len = string_size;
 
+  if (cf->string && string_size > 0) {
+    gchar first_char[3];
+
+    /*
+     * The string search routines let ws_mempbrk_exec() skip ahead to
+     * the bytes that could start a match, and only compare the rest of
+     * the string there. For a case insensitive search the string has
+     * already been upper cased, so look for both cases of its first
+     * character.
+     */
+    first_char[0] = (gchar)string[0];
+    first_char[1] = g_ascii_tolower(first_char[0]);
+    first_char[2] = '\0';
+    if (!cf->case_type || first_char[1] == first_char[0])
+      first_char[1] = '\0';
+    ws_mempbrk_compile(&info.first_char, first_char);
+  }
+
   /* Regex, String or hex search? */
   if (cf->regex) {
     /* Regular Expression search */
@@ -3307,9 +3715,11 @@ match_narrow_and_wide(capture_file *cf, frame_data *fdata,
   match_result  result;
   guint32       buf_len;
   guint8       *pd;
+  const guint8 *start;
   guint32       i;
+  guint32       j;
   guint8        c_char;
-  size_t        c_match    = 0;
+  size_t        c_match;
 
   /* Load the frame's data. */
   if (!cf_read_record(cf, fdata, rec, buf)) {
@@ -3320,27 +3730,33 @@ match_narrow_and_wide(capture_file *cf, frame_data *fdata,
   result = MR_NOTMATCHED;
   buf_len = fdata->cap_len;
   pd = ws_buffer_start_ptr(buf);
+  if (textlen == 0 || textlen > buf_len)
+    return result;
   i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = g_ascii_toupper(c_char);
-    if (c_char != '\0') {
-      if (c_char == ascii_text[c_match]) {
-        c_match += 1;
-        if (c_match == textlen) {
-          result = MR_MATCHED;
-          cf->search_pos = i; /* Save the position of the last character
+  while ((start = ws_mempbrk_exec(pd + i, buf_len - i, &info->first_char, NULL)) != NULL) {
+    /* Compare the rest of the string, skipping any '\0' bytes. */
+    i = (guint32)(start - pd);
+    c_match = 1;
+    for (j = i + 1; c_match < textlen && j < buf_len; j++) {
+      c_char = pd[j];
+      if (cf->case_type)
+        c_char = g_ascii_toupper(c_char);
+      if (c_char == '\0')
+        continue;
+      if (c_char != ascii_text[c_match])
+        break;
+      c_match += 1;
+    }
+    if (c_match == textlen) {
+      result = MR_MATCHED;
+      cf->search_pos = j - 1; /* Save the position of the last character
                                  for highlighting the field. */
-          cf->search_len = (guint32)textlen;
-          break;
-        }
-      }
-      else {
-        ws_assert(i>=c_match);
-        i -= (guint32)c_match;
-        c_match = 0;
-      }
+      cf->search_len = (guint32)textlen;
+      break;
+    }
+    if (j == buf_len) {
+      /* Not enough data left for any later start to match either. */
+      break;
     }
     i += 1;
   }
@@ -3357,9 +3773,9 @@ match_narrow(capture_file *cf, frame_data *fdata,
   match_result  result;
   guint32       buf_len;
   guint8       *pd;
+  const guint8 *start;
   guint32       i;
-  guint8        c_char;
-  size_t        c_match    = 0;
+  size_t        c_match;
 
   /* Load the frame's data. */
   if (!cf_read_record(cf, fdata, rec, buf)) {
@@ -3370,25 +3786,31 @@ match_narrow(capture_file *cf, frame_data *fdata,
   result = MR_NOTMATCHED;
   buf_len = fdata->cap_len;
   pd = ws_buffer_start_ptr(buf);
+  if (textlen == 0 || textlen > buf_len)
+    return result;
+  if (!cf->case_type) {
+    start = ws_memmem(pd, buf_len, ascii_text, textlen);
+    if (start != NULL) {
+      result = MR_MATCHED;
+      cf->search_pos = (guint32)(start - pd + textlen - 1); /* Save the position of the last character
+                                                               for highlighting the field. */
+      cf->search_len = (guint32)textlen;
+    }
+    return result;
+  }
   i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = g_ascii_toupper(c_char);
-    if (c_char == ascii_text[c_match]) {
-      c_match += 1;
-      if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        cf->search_len = (guint32)textlen;
+  while ((start = ws_mempbrk_exec(pd + i, buf_len - textlen + 1 - i, &info->first_char, NULL)) != NULL) {
+    i = (guint32)(start - pd);
+    for (c_match = 1; c_match < textlen; c_match++) {
+      if (g_ascii_toupper(pd[i + c_match]) != ascii_text[c_match])
         break;
-      }
     }
-    else {
-      ws_assert(i>=c_match);
-      i -= (guint32)c_match;
-      c_match = 0;
+    if (c_match == textlen) {
+      result = MR_MATCHED;
+      cf->search_pos = (guint32)(i + textlen - 1); /* Save the position of the last character
+                                                      for highlighting the field. */
+      cf->search_len = (guint32)textlen;
+      break;
     }
     i += 1;
   }
@@ -3406,9 +3828,11 @@ match_wide(capture_file *cf, frame_data *fdata,
   match_result  result;
   guint32       buf_len;
   guint8       *pd;
+  const guint8 *start;
   guint32       i;
   guint8        c_char;
-  size_t        c_match    = 0;
+  size_t        c_match;
+  size_t        span;
 
   /* Load the frame's data. */
   if (!cf_read_record(cf, fdata, rec, buf)) {
@@ -3419,26 +3843,26 @@ match_wide(capture_file *cf, frame_data *fdata,
   result = MR_NOTMATCHED;
   buf_len = fdata->cap_len;
   pd = ws_buffer_start_ptr(buf);
+  /* The characters are matched at every other byte. */
+  span = textlen * 2 - 1;
+  if (textlen == 0 || span > buf_len)
+    return result;
   i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = g_ascii_toupper(c_char);
-    if (c_char == ascii_text[c_match]) {
-      c_match += 1;
-      if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        cf->search_len = (guint32)textlen;
+  while ((start = ws_mempbrk_exec(pd + i, buf_len - span + 1 - i, &info->first_char, NULL)) != NULL) {
+    i = (guint32)(start - pd);
+    for (c_match = 1; c_match < textlen; c_match++) {
+      c_char = pd[i + c_match * 2];
+      if (cf->case_type)
+        c_char = g_ascii_toupper(c_char);
+      if (c_char != ascii_text[c_match])
         break;
-      }
-      i += 1;
     }
-    else {
-      ws_assert(i>=(c_match*2));
-      i -= (guint32)c_match*2;
-      c_match = 0;
+    if (c_match == textlen) {
+      result = MR_MATCHED;
+      cf->search_pos = (guint32)(i + span - 1); /* Save the position of the last character
+                                                   for highlighting the field. */
+      cf->search_len = (guint32)textlen;
+      break;
     }
     i += 1;
   }
@@ -3455,8 +3879,7 @@ match_binary(capture_file *cf, frame_data *fdata,
   match_result  result;
   guint32       buf_len;
   guint8       *pd;
-  guint32       i;
-  size_t        c_match     = 0;
+  const guint8 *start;
 
   /* Load the frame's data. */
   if (!cf_read_record(cf, fdata, rec, buf)) {
@@ -3467,24 +3890,14 @@ match_binary(capture_file *cf, frame_data *fdata,
   result = MR_NOTMATCHED;
   buf_len = fdata->cap_len;
   pd = ws_buffer_start_ptr(buf);
-  i = 0;
-  while (i < buf_len) {
-    if (pd[i] == binary_data[c_match]) {
-      c_match += 1;
-      if (c_match == datalen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        cf->search_len = (guint32)datalen;
-        break;
-      }
-    }
-    else {
-      ws_assert(i>=c_match);
-      i -= (guint32)c_match;
-      c_match = 0;
-    }
-    i += 1;
+  if (datalen == 0)
+    return result;
+  start = ws_memmem(pd, buf_len, binary_data, datalen);
+  if (start != NULL) {
+    result = MR_MATCHED;
+    cf->search_pos = (guint32)(start - pd + datalen - 1); /* Save the position of the last character
+                                                             for highlighting the field. */
+    cf->search_len = (guint32)datalen;
   }
   return result;
 }
@@ -3830,12 +4243,88 @@ cf_goto_framenum(capture_file *cf)
   return FALSE;
 }
 
+/*
+ * Dissections of recently selected frames, most recent first, kept so that
+ * going back to one of them doesn't read and dissect it again; see the
+ * gui.packet_details_cache preference. Each has its own copy of the
+ * record, as the tvbuffs of its tree point into it. The selected frame's
+ * dissection isn't in the list; it's added when another frame is
+ * selected.
+ */
+typedef struct {
+  frame_data     *fdata;
+  epan_dissect_t *edt;
+  wtap_rec        rec;
+  Buffer          buf;
+  gboolean        stale;    /* flushed while selected; don't keep it */
+} dissected_frame_t;
+
+static GQueue dissected_frames = G_QUEUE_INIT;
+static dissected_frame_t *selected_dissection = NULL;
+
+static void
+dissected_frame_free(dissected_frame_t *df)
+{
+  epan_dissect_free(df->edt);
+  wtap_rec_cleanup(&df->rec);
+  ws_buffer_free(&df->buf);
+  g_free(df);
+}
+
+/* Forget all kept dissections, e.g. because the frames will be dissected
+   differently from now on. */
+static void
+dissected_frames_flush(void)
+{
+  dissected_frame_t *df;
+
+  while ((df = (dissected_frame_t *)g_queue_pop_head(&dissected_frames)) != NULL)
+    dissected_frame_free(df);
+
+  if (selected_dissection != NULL)
+    selected_dissection->stale = TRUE;
+}
+
+/* Take a frame's kept dissection, if there is one, out of the list. */
+static dissected_frame_t *
+dissected_frames_take(frame_data *fdata)
+{
+  GList *link;
+
+  for (link = dissected_frames.head; link != NULL; link = link->next) {
+    dissected_frame_t *df = (dissected_frame_t *)link->data;
+
+    if (df->fdata == fdata) {
+      g_queue_delete_link(&dissected_frames, link);
+      return df;
+    }
+  }
+  return NULL;
+}
+
+/* Keep the dissection of a frame that's no longer selected, dropping the
+   least recently selected ones beyond the preference's limit. */
+static void
+dissected_frames_keep(dissected_frame_t *df)
+{
+  if (df->stale || prefs.gui_packet_details_cache == 0) {
+    dissected_frame_free(df);
+  } else {
+    g_queue_push_head(&dissected_frames, df);
+  }
+
+  while (g_queue_get_length(&dissected_frames) > prefs.gui_packet_details_cache)
+    dissected_frame_free((dissected_frame_t *)g_queue_pop_tail(&dissected_frames));
+}
+
 /* Select the packet on a given row. */
 void
 cf_select_packet(capture_file *cf, int row)
 {
-  epan_dissect_t *old_edt;
-  frame_data     *fdata;
+  epan_dissect_t    *old_edt;
+  dissected_frame_t *old_dissection;
+  dissected_frame_t *df = NULL;
+  frame_data        *fdata;
 
   /* Get the frame data struct pointer for this frame */
   fdata = packet_list_get_row_data(row);
@@ -3873,18 +4362,60 @@ cf_select_packet(capture_file *cf, int row)
    * we replace it?
    */
   old_edt = cf->edt;
-  /* Create the logical protocol tree. */
-  /* We don't need the columns here. */
-  cf->edt = epan_dissect_new(cf->epan, TRUE, TRUE);
+  old_dissection = selected_dissection;
+
+  if (prefs.gui_packet_details_cache != 0) {
+    if (old_dissection != NULL && !old_dissection->stale &&
+        old_dissection->fdata == fdata) {
+      /* Selected again; keep what we have. */
+      df = old_dissection;
+      old_dissection = NULL;
+      old_edt = NULL;
+    } else {
+      df = dissected_frames_take(fdata);
+    }
+    if (df == NULL) {
+      /* Dissect it from a copy of the record that it can keep. */
+      df = g_new0(dissected_frame_t, 1);
+      df->fdata = fdata;
+      wtap_rec_init(&df->rec);
+      ws_buffer_init(&df->buf, 1514);
+      if (!cf_read_record(cf, fdata, &df->rec, &df->buf)) {
+        wtap_rec_cleanup(&df->rec);
+        ws_buffer_free(&df->buf);
+        g_free(df);
+        df = NULL;
+      }
+    }
+  }
 
-  tap_build_interesting(cf->edt);
-  epan_dissect_run(cf->edt, cf->cd_t, &cf->rec,
-                   frame_tvbuff_new_buffer(&cf->provider, cf->current_frame, &cf->buf),
-                   cf->current_frame, NULL);
+  if (df != NULL && df->edt != NULL) {
+    /* Selected before; no need to dissect it again. */
+    cf->edt = df->edt;
+  } else {
+    /* Create the logical protocol tree. */
+    /* We don't need the columns here. */
+    cf->edt = epan_dissect_new(cf->epan, TRUE, TRUE);
+
+    tap_build_interesting(cf->edt);
+    if (df != NULL) {
+      epan_dissect_run(cf->edt, cf->cd_t, &df->rec,
+                       frame_tvbuff_new_buffer(&cf->provider, cf->current_frame, &df->buf),
+                       cf->current_frame, NULL);
+      df->edt = cf->edt;
+    } else {
+      epan_dissect_run(cf->edt, cf->cd_t, &cf->rec,
+                       frame_tvbuff_new_buffer(&cf->provider, cf->current_frame, &cf->buf),
+                       cf->current_frame, NULL);
+    }
+  }
+  selected_dissection = df;
 
   dfilter_macro_build_ftv_cache(cf->edt->tree);
 
-  if (old_edt != NULL)
+  if (old_dissection != NULL)
+    dissected_frames_keep(old_dissection);
+  else if (old_edt != NULL)
     epan_dissect_free(old_edt);
 }
 
@@ -3892,20 +4423,24 @@ cf_select_packet(capture_file *cf, int row)
 void
 cf_unselect_packet(capture_file *cf)
 {
-  epan_dissect_t *old_edt = cf->edt;
+  epan_dissect_t    *old_edt = cf->edt;
+  dissected_frame_t *old_dissection = selected_dissection;
 
   /*
    * See the comment in cf_select_packet() about deferring the freeing
    * of the old cf->edt.
    */
   cf->edt = NULL;
+  selected_dissection = NULL;
 
   /* No packet is selected. */
   cf->current_frame = NULL;
   cf->current_row = 0;
 
-  /* Destroy the epan_dissect_t for the unselected packet. */
-  if (old_edt != NULL)
+  /* Keep or destroy the epan_dissect_t for the unselected packet. */
+  if (old_dissection != NULL)
+    dissected_frames_keep(old_dissection);
+  else if (old_edt != NULL)
     epan_dissect_free(old_edt);
 }
 
@@ -3942,6 +4477,7 @@ void
 cf_ignore_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->ignored) {
+    dissected_frames_flush();
     frame->ignored = TRUE;
     if (cf->count > cf->ignored_count)
       cf->ignored_count++;
@@ -3955,6 +4491,7 @@ void
 cf_unignore_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->ignored) {
+    dissected_frames_flush();
     frame->ignored = FALSE;
     if (cf->ignored_count > 0)
       cf->ignored_count--;
@@ -4034,6 +4571,9 @@ cf_set_modified_block(capture_file *cf, frame_data *fd, const wtap_block_t new_b
 {
   wtap_block_t pkt_block = cf_get_packet_block(cf, fd);
 
+  /* The frame's kept dissection shows its old comments. */
+  dissected_frames_flush();
+
   /* It's possible to further modify the modified block "in place" by doing
    * a call to cf_get_packet_block() that returns an already created modified
    * block, modifying that, and calling this function.
@@ -4120,6 +4660,7 @@ typedef struct {
   wtap_dumper *pdh;
   const char  *fname;
   int          file_type;
+  GArray      *offsets;   /* offset of each record written, or NULL */
 } save_callback_args_t;
 
 /*
@@ -4159,6 +4700,18 @@ save_record(capture_file *cf, frame_data *fdata, wtap_rec *rec,
     return FALSE;
   }
 
+  /* Remember where it went, as long as the writer can tell us */
+  if (args->offsets != NULL) {
+    gint64 offset = wtap_dump_last_record_offset(args->pdh);
+
+    if (offset >= 0) {
+      g_array_append_val(args->offsets, offset);
+    } else {
+      g_array_free(args->offsets, TRUE);
+      args->offsets = NULL;
+    }
+  }
+
   return TRUE;
 }
 
@@ -4435,6 +4988,80 @@ rescan_file(capture_file *cf, const char *fname, gboolean is_tempfile)
     return CF_READ_OK;
 }
 
+/*
+ * Open a file we've just written out with Wiretap, given the offset
+ * at which each of our records was written, rather than reading through
+ * it to find them; if that's not possible, fall back on rescan_file().
+ */
+static cf_read_status_t
+reopen_saved_file(capture_file *cf, const char *fname, GArray *offsets)
+{
+  wtap                        *wth;
+  wtapng_iface_descriptions_t *idb_info;
+  guint                        num_idbs;
+  int                          err;
+  gchar                       *err_info;
+  gint64                       size;
+  guint32                      framenum;
+  frame_data                  *fdata;
+
+  if (offsets->len != cf->count)
+    return rescan_file(cf, fname, FALSE);
+
+  wth = wtap_open_offline(fname, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+  if (wth == NULL) {
+    wtap_close(cf->provider.wth);
+    cf->provider.wth = NULL;
+    cfile_open_failure_alert_box(fname, err, err_info);
+    return CF_READ_ERROR;
+  }
+
+  /* Random access to a record needs its interface, so unless all the
+     interfaces precede the records, we have to read through the file. */
+  idb_info = wtap_file_get_idb_info(cf->provider.wth);
+  num_idbs = idb_info->interface_data->len;
+  g_free(idb_info);
+  idb_info = wtap_file_get_idb_info(wth);
+  if (idb_info->interface_data->len != num_idbs) {
+    g_free(idb_info);
+    wtap_close(wth);
+    return rescan_file(cf, fname, FALSE);
+  }
+  g_free(idb_info);
+
+  /* Close the old handle. */
+  wtap_close(cf->provider.wth);
+  cf->provider.wth = wth;
+
+  /* As in rescan_file(), the records are the ones we already have, so
+     the dissection state, the list of encapsulation types, and the file
+     encapsulation all still apply. */
+  cf->filename = g_strdup(fname);
+  cf->is_tempfile = FALSE;
+  cf->unsaved_changes = FALSE;
+  cf->cd_t = wtap_file_type_subtype(wth);
+  cf->snap = wtap_snapshot_length(wth);
+  cf->compression_type = wtap_get_compression_type(wth);
+
+  cf_callback_invoke(cf_cb_file_rescan_started, cf);
+
+  for (framenum = 1; framenum <= cf->count; framenum++) {
+    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+    fdata->file_off = g_array_index(offsets, gint64, framenum - 1);
+  }
+
+  size = wtap_file_size(wth, NULL);
+  cf->f_datalen = size >= 0 ? size : 0;
+
+  /* We have no reason to read sequentially through the file. */
+  cf->state = FILE_READ_DONE;
+  wtap_sequential_close(wth);
+
+  cf_callback_invoke(cf_cb_file_rescan_finished, cf);
+
+  return CF_READ_OK;
+}
+
 cf_write_status_t
 cf_save_records(capture_file *cf, const char *fname, guint save_format,
                 wtap_compression_type compression_type,
@@ -4456,6 +5083,7 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
      SAVE_WITH_WTAP
   }                    how_to_save;
   save_callback_args_t callback_args;
+  GArray          *saved_offsets = NULL;
   gboolean needs_reload = FALSE;
 
   /* XXX caller should avoid saving the file while a read is pending
@@ -4592,10 +5220,16 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
     /* Add address resolution */
     wtap_dump_set_addrinfo_list(pdh, addr_lists);
 
-    /* Iterate through the list of packets, processing all the packets. */
+    /* Iterate through the list of packets, processing all the packets.
+       If the file isn't compressed, note where each record is written,
+       so that we can open the new file without reading through it. */
     callback_args.pdh = pdh;
     callback_args.fname = fname;
     callback_args.file_type = save_format;
+    if (compression_type == WTAP_UNCOMPRESSED && !dont_reopen)
+      callback_args.offsets = g_array_sized_new(FALSE, FALSE, (guint) sizeof(gint64), cf->count);
+    else
+      callback_args.offsets = NULL;
     switch (process_specified_records(cf, NULL, "Saving", "packets",
                                       TRUE, save_record, &callback_args, TRUE)) {
 
@@ -4608,6 +5242,8 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
          If we're writing to a temporary file, remove it.
          XXX - should we do so even if we're not writing to a
          temporary file? */
+      if (callback_args.offsets != NULL)
+        g_array_free(callback_args.offsets, TRUE);
       wtap_dump_close(pdh, &err, &err_info);
       if (fname_new != NULL)
         ws_unlink(fname_new);
@@ -4630,6 +5266,7 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
       goto fail;
     }
 
+    saved_offsets = callback_args.offsets;
     how_to_save = SAVE_WITH_WTAP;
   }
 
@@ -4708,24 +5345,19 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
       break;
 
     case SAVE_WITH_WTAP:
-      /* Open and read the file we saved to.
-
-         XXX - this is somewhat of a waste; we already have the
-         packets, all this gets us is updated file type information
-         (which we could just stuff into "cf"), and having the new
-         file be the one we have opened and from which we're reading
-         the data, and it means we have to spend time opening and
-         reading the file, which could be a significant amount of
-         time if the file is large.
-
-         If the capture-file-writing code were to return the
-         seek offset of each packet it writes, we could save that
-         in the frame_data structure for the frame, and just open
-         the file without reading it again...
-
-         ...as long as, for gzipped files, the process of writing
-         out the file *also* generates the information needed to
-         support fast random access to the compressed file. */
+      /* Open the file we saved to.
+
+         If the writer told us the seek offset of each record it
+         wrote, we save that in the frame_data structure for the
+         frame, and just open the file without reading it again;
+         otherwise we have to spend time reading through the file,
+         which could be a significant amount of time if the file
+         is large.
+
+         XXX - for gzipped files, that would need the process of
+         writing out the file to *also* generate the information
+         needed to support fast random access to the compressed
+         file. */
       /* rescan_file will cause us to try all open_routines, so
          reset cfile's open_type */
       cf->open_type = WTAP_TYPE_AUTO;
@@ -4744,6 +5376,12 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
           }
         }
       }
+      else if (saved_offsets != NULL) {
+        if (reopen_saved_file(cf, fname, saved_offsets) != CF_READ_OK) {
+          /* As below. */
+          cf_close(cf);
+        }
+      }
       else {
         if (rescan_file(cf, fname, FALSE) != CF_READ_OK) {
            /* The rescan failed; just close the file.  Either
@@ -4777,9 +5415,13 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
       cf->packet_comment_count = 0;
     }
   }
+  if (saved_offsets != NULL)
+    g_array_free(saved_offsets, TRUE);
   return CF_WRITE_OK;
 
 fail:
+  if (saved_offsets != NULL)
+    g_array_free(saved_offsets, TRUE);
   if (fname_new != NULL) {
     /* We were trying to write to a temporary file; get rid of it if it
        exists.  (We don't care whether this fails, as, if it fails,
@@ -4861,6 +5503,7 @@ cf_export_specified_packets(capture_file *cf, const char *fname,
   callback_args.pdh = pdh;
   callback_args.fname = fname;
   callback_args.file_type = save_format;
+  callback_args.offsets = NULL;
   switch (process_specified_records(cf, range, "Writing", "specified records",
                                     TRUE, save_record, &callback_args, TRUE)) {
 
@@ -17,6 +17,7 @@
 #include <wiretap/wtap.h>
 #include <epan/epan.h>
 #include <epan/print.h>
+#include <epan/frame_list.h>
 #include <ui/packet_range.h>
 
 #ifdef __cplusplus
@@ -404,6 +405,17 @@ cf_status_t cf_filter_packets(capture_file *cf, gchar *dfilter, gboolean force);
  */
 void cf_reftime_packets(capture_file *cf);
 
+/**
+ * Recalculate the ref time after the time reference flag of one frame
+ * has been set or cleared. Only the frames from that one up to the next
+ * time reference are affected, so only those are scanned.
+ *
+ * @param cf the capture file
+ * @param fdata the frame whose flag changed
+ * @return the number of the last frame recalculated
+ */
+guint32 cf_reftime_packet_changed(capture_file *cf, frame_data *fdata);
+
 /**
  * Return the time it took to load the file (in msec).
  */
@@ -424,6 +436,28 @@ void cf_redissect_packets(capture_file *cf);
  */
 cf_read_status_t cf_retap_packets(capture_file *cf);
 
+/**
+ * Rescan the packets between two frames, inclusive, and just run taps.
+ * For tap listeners that are only interested in a conversation whose
+ * frames are known to lie in that range.
+ *
+ * @param cf the capture file
+ * @param first_frame the number of the first frame to rescan
+ * @param last_frame the number of the last frame to rescan
+ * @return one of cf_read_status_t
+ */
+cf_read_status_t cf_retap_packet_range(capture_file *cf, guint32 first_frame, guint32 last_frame);
+
+/**
+ * Rescan the packets in a frame list, e.g. the frames of a TCP or UDP
+ * stream, and just run taps.
+ *
+ * @param cf the capture file
+ * @param frames the frames to rescan
+ * @return one of cf_read_status_t
+ */
+cf_read_status_t cf_retap_frame_list(capture_file *cf, const frame_list_t *frames);
+
 /**
  * Adjust timestamp precision if auto is selected.
  *
@@ -50,6 +50,24 @@ static column_info fuzz_cinfo;
 static epan_t *fuzz_epan;
 static epan_dissect_t *fuzz_edt;
 
+/*
+ * Performance mode, enabled with FUZZSHARK_PERF=<repeat count>: every
+ * input is dissected that many times and its cost is recorded. At exit
+ * the inputs are listed along with those whose cost per byte is more
+ * than FUZZSHARK_PERF_SLOW_FACTOR (default 10) times the median.
+ */
+typedef struct {
+	char    *name;
+	guint32  len;
+	double   ns_per_packet;
+	double   allocs_per_packet;
+	size_t   pool_bytes;
+} fuzz_perf_result_t;
+
+static guint fuzz_perf_repeat;
+static double fuzz_perf_slow_factor = 10.0;
+static GArray *fuzz_perf_results;
+
 /*
  * Report an error in command-line arguments.
  */
@@ -135,6 +153,66 @@ get_dissector_handle(const char *table, const char *target)
 	return fuzz_handle;
 }
 
+static guint64
+fuzz_allocs(wmem_allocator_t *allocator)
+{
+	wmem_allocator_stats_t stats;
+
+	if (!wmem_allocator_get_stats(allocator, &stats))
+		return 0;
+	return stats.allocs;
+}
+
+static int
+fuzz_perf_cost_cmp(gconstpointer a, gconstpointer b)
+{
+	double cost_a = *(const double *)a;
+	double cost_b = *(const double *)b;
+
+	return (cost_a > cost_b) - (cost_a < cost_b);
+}
+
+static double
+fuzz_perf_cost(const fuzz_perf_result_t *result)
+{
+	return result->ns_per_packet / MAX(result->len, 1);
+}
+
+static void
+fuzz_perf_report(void)
+{
+	double *costs;
+	double median;
+	guint i, slow = 0;
+
+	if (fuzz_perf_results == NULL || fuzz_perf_results->len == 0)
+		return;
+
+	costs = g_new(double, fuzz_perf_results->len);
+	for (i = 0; i < fuzz_perf_results->len; i++)
+		costs[i] = fuzz_perf_cost(&g_array_index(fuzz_perf_results, fuzz_perf_result_t, i));
+	qsort(costs, fuzz_perf_results->len, sizeof(double), fuzz_perf_cost_cmp);
+	median = costs[fuzz_perf_results->len / 2];
+	g_free(costs);
+
+	fprintf(stderr, "oss-fuzzshark: %u inputs, median %.1f ns/byte\n",
+	    fuzz_perf_results->len, median);
+	for (i = 0; i < fuzz_perf_results->len; i++) {
+		fuzz_perf_result_t *result = &g_array_index(fuzz_perf_results, fuzz_perf_result_t, i);
+		double cost = fuzz_perf_cost(result);
+
+		if (median > 0 && cost > median * fuzz_perf_slow_factor) {
+			fprintf(stderr, "SLOW: %s: %.1f ns/byte (%.1fx median), %u bytes, %.0f ns/packet\n",
+			    result->name, cost, cost / median, result->len, result->ns_per_packet);
+			slow++;
+		}
+		g_free(result->name);
+	}
+	fprintf(stderr, "oss-fuzzshark: %u slow input(s)\n", slow);
+	g_array_free(fuzz_perf_results, TRUE);
+	fuzz_perf_results = NULL;
+}
+
 static void
 fuzz_prefs_apply(void)
 {
@@ -208,6 +286,11 @@ fuzz_init(int argc _U_, char **argv)
 "crash. Mode (2) can be used if a dissector (such as 'ospf') is not available\n"
 "through (1).\n"
 "\n"
+"Set FUZZSHARK_PERF=N to dissect each input N times and report its cost in\n"
+"ns/packet, allocations/packet and pinfo->pool bytes. Inputs that cost more\n"
+"per byte than FUZZSHARK_PERF_SLOW_FACTOR (default 10) times the median are\n"
+"reported as slow at exit.\n"
+"\n"
 "For best results, build dedicated fuzzshark_* targets with:\n"
 "    cmake -GNinja -DCMAKE_C_COMPILER=clang -DCMAKE_CXX_COMPILER=clang++\\\n"
 "      -DENABLE_FUZZER=1 -DENABLE_ASAN=1 -DENABLE_UBSAN=1\n"
@@ -232,6 +315,20 @@ fuzz_init(int argc _U_, char **argv)
 	g_setenv("XDG_CONFIG_HOME", "/not/existing/directory", 0); /* g_get_user_config_dir() */
 	g_setenv("XDG_DATA_HOME", "/not/existing/directory", 0);   /* g_get_user_data_dir() */
 
+	if (getenv("FUZZSHARK_PERF")) {
+		const char *slow_factor = getenv("FUZZSHARK_PERF_SLOW_FACTOR");
+
+		fuzz_perf_repeat = (guint) strtoul(getenv("FUZZSHARK_PERF"), NULL, 10);
+		if (fuzz_perf_repeat == 0)
+			fuzz_perf_repeat = 1;
+		if (slow_factor && g_ascii_strtod(slow_factor, NULL) > 0)
+			fuzz_perf_slow_factor = g_ascii_strtod(slow_factor, NULL);
+		fuzz_perf_results = g_array_new(FALSE, FALSE, sizeof(fuzz_perf_result_t));
+		atexit(fuzz_perf_report);
+
+		/* The slab allocator is the one that keeps statistics. */
+		g_setenv("WIRESHARK_DEBUG_WMEM_OVERRIDE", "slab", 0);
+	}
 	g_setenv("WIRESHARK_DEBUG_WMEM_OVERRIDE", "simple", 0);
 	g_setenv("G_SLICE", "always-malloc", 0);
 
@@ -373,6 +470,42 @@ LLVMFuzzerTestOneInput(const guint8 *buf, size_t real_len)
 	rec.rec_header.packet_header.pkt_encap = G_MAXINT16;
 	rec.presence_flags = WTAP_HAS_TS | WTAP_HAS_CAP_LEN; /* most common flags... */
 
+	if (fuzz_perf_repeat) {
+		fuzz_perf_result_t result;
+		guint64 allocs = 0;
+		size_t pool_bytes = 0;
+		gint64 start;
+		guint i;
+
+		start = g_get_monotonic_time();
+		for (i = 0; i < fuzz_perf_repeat; i++) {
+			wmem_allocator_stats_t stats;
+			guint64 allocs_before = fuzz_allocs(wmem_packet_scope()) + fuzz_allocs(edt->pi.pool);
+
+			frame_data_init(&fdlocal, ++framenum, &rec, /* offset */ 0, /* cum_bytes */ 0);
+			epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec, tvb_new_real_data(buf, len, len), &fdlocal, NULL /* &fuzz_cinfo */);
+			frame_data_destroy(&fdlocal);
+
+			allocs += fuzz_allocs(wmem_packet_scope()) + fuzz_allocs(edt->pi.pool) - allocs_before;
+			/* The pool is only emptied by epan_dissect_reset(). */
+			if (wmem_allocator_get_stats(edt->pi.pool, &stats))
+				pool_bytes = MAX(pool_bytes, stats.bytes_live);
+
+			epan_dissect_reset(edt);
+		}
+
+		result.name = g_strdup_printf("input #%u", fuzz_perf_results->len + 1);
+		result.len = len;
+		result.ns_per_packet = (double) (g_get_monotonic_time() - start) * 1000.0 / fuzz_perf_repeat;
+		result.allocs_per_packet = (double) allocs / fuzz_perf_repeat;
+		result.pool_bytes = pool_bytes;
+		g_array_append_val(fuzz_perf_results, result);
+
+		fprintf(stderr, "oss-fuzzshark: %s: %u bytes, %.0f ns/packet, %.1f allocs/packet, %zu pool bytes\n",
+		    result.name, len, result.ns_per_packet, result.allocs_per_packet, pool_bytes);
+		return 0;
+	}
+
 	frame_data_init(&fdlocal, ++framenum, &rec, /* offset */ 0, /* cum_bytes */ 0);
 	/* frame_data_set_before_dissect() not needed */
 	epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec, tvb_new_real_data(buf, len, len), &fdlocal, NULL /* &fuzz_cinfo */);
@@ -23,11 +23,14 @@
 #include <string.h>
 
 #include <wiretap/wtap.h>
+#include <wiretap/pcap-encap.h>
 
 #include <ui/clopts_common.h>
 #include <ui/cmdarg_err.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
+#include <wsutil/inet_addr.h>
+#include <wsutil/nstime.h>
 #include <wsutil/privileges.h>
 #include <wsutil/strnatcmp.h>
 #include <wsutil/ws_assert.h>
@@ -46,6 +49,24 @@
 
 #include "ui/failure_message.h"
 
+#include "writecap/capindex.h"
+
+/*
+ * The packets to extract, if -A, -B, --host or --port was given, and
+ * whether we're verbose
+ */
+typedef struct {
+  gboolean  verbose;
+  gboolean  have_starttime;
+  nstime_t  starttime;
+  gboolean  have_stoptime;
+  nstime_t  stoptime;
+  size_t    host_len;       /* 4 or 16 for an IPv4 or IPv6 address, 0 for none */
+  guint8    host[16];
+  gboolean  have_port;
+  guint16   port;
+} extract_t;
+
 /*
  * Show the usage
  */
@@ -65,6 +86,17 @@ print_usage(FILE *output)
   fprintf(output, "  -I <IDB merge mode> set the merge mode for Interface Description Blocks; default is 'all'.\n");
   fprintf(output, "                    an empty \"-I\" option will list the merge modes.\n");
   fprintf(output, "\n");
+  fprintf(output, "Packet selection:\n");
+  fprintf(output, "  -A <start time>   only read packets whose timestamp is after (or equal\n");
+  fprintf(output, "                    to) the given time.\n");
+  fprintf(output, "  -B <stop time>    only read packets whose timestamp is before the\n");
+  fprintf(output, "                    given time.\n");
+  fprintf(output, "                    Time is in the format YYYY-MM-DD HH:MM:SS or a Unix epoch timestamp.\n");
+  fprintf(output, "  --host <address>  only read IP packets to or from the given address.\n");
+  fprintf(output, "  --port <port>     only read TCP, UDP or SCTP packets to or from the given port.\n");
+  fprintf(output, "                    Input files with an index written by dumpcap that\n");
+  fprintf(output, "                    can't have such packets are skipped.\n");
+  fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                display this help and exit.\n");
   fprintf(output, "  -v                verbose output.\n");
@@ -119,10 +151,14 @@ list_idb_merge_modes(void) {
 static gboolean
 merge_callback(merge_event event, int num,
                const merge_in_file_t in_files[], const guint in_file_count,
-               void *data _U_)
+               void *data)
 {
+  const extract_t *extract = (const extract_t *)data;
   guint i;
 
+  if (!extract->verbose)
+    return FALSE;
+
   switch (event) {
 
     case MERGE_EVENT_INPUT_FILES_OPENED:
@@ -181,6 +217,79 @@ merge_callback(merge_event event, int num,
   return FALSE;
 }
 
+static gboolean
+extracting(const extract_t *extract)
+{
+  return extract->have_starttime || extract->have_stoptime ||
+         extract->host_len != 0 || extract->have_port;
+}
+
+/*
+ * Returns FALSE if the index of the given file, if it has one, shows
+ * that it can't have any of the packets to be extracted.
+ */
+static gboolean
+file_may_have_packets(const char *filename, const extract_t *extract)
+{
+  capindex_t *index;
+  gboolean may_have = TRUE;
+
+  index = g_new(capindex_t, 1);
+  if (capindex_read(index, filename)) {
+    if (index->packets == 0)
+      may_have = FALSE;
+    else if (extract->have_starttime && nstime_cmp(&index->last, &extract->starttime) < 0)
+      may_have = FALSE;
+    else if (extract->have_stoptime && nstime_cmp(&index->first, &extract->stoptime) >= 0)
+      may_have = FALSE;
+    else if (extract->host_len != 0 &&
+             !capindex_may_have_address(index, extract->host, extract->host_len))
+      may_have = FALSE;
+    else if (extract->have_port && !capindex_may_have_port(index, extract->port))
+      may_have = FALSE;
+  }
+  g_free(index);
+  return may_have;
+}
+
+static gboolean
+extract_record_filter(const wtap_rec *rec, const guint8 *pd, void *data)
+{
+  const extract_t *extract = (const extract_t *)data;
+  capindex_summary_t summary;
+
+  if (rec->presence_flags & WTAP_HAS_TS) {
+    if (extract->have_starttime && nstime_cmp(&rec->ts, &extract->starttime) < 0)
+      return FALSE;
+    if (extract->have_stoptime && nstime_cmp(&rec->ts, &extract->stoptime) >= 0)
+      return FALSE;
+  }
+
+  if (extract->host_len == 0 && !extract->have_port)
+    return TRUE;
+
+  if (!capindex_summarize(wtap_wtap_encap_to_pcap_encap(rec->rec_header.packet_header.pkt_encap),
+                          pd, rec->rec_header.packet_header.caplen, &summary))
+    return FALSE;
+  if (extract->host_len != 0) {
+    if ((size_t)(summary.ip_version == 4 ? 4 : 16) != extract->host_len)
+      return FALSE;
+    if (memcmp(summary.src, extract->host, extract->host_len) != 0 &&
+        memcmp(summary.dst, extract->host, extract->host_len) != 0)
+      return FALSE;
+  }
+  if (extract->have_port) {
+    if (!summary.has_ports)
+      return FALSE;
+    if (summary.srcport != extract->port && summary.dstport != extract->port)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+#define LONGOPT_HOST    LONGOPT_BASE_APPLICATION+1
+#define LONGOPT_PORT    LONGOPT_BASE_APPLICATION+2
+
 int
 main(int argc, char *argv[])
 {
@@ -201,11 +310,14 @@ main(int argc, char *argv[])
   static const struct ws_option long_options[] = {
       {"help", ws_no_argument, NULL, 'h'},
       {"version", ws_no_argument, NULL, 'V'},
+      {"host", ws_required_argument, NULL, LONGOPT_HOST},
+      {"port", ws_required_argument, NULL, LONGOPT_PORT},
       {0, 0, 0, 0 }
   };
   gboolean            do_append          = FALSE;
-  gboolean            verbose            = FALSE;
+  extract_t           extract;
   int                 in_file_count      = 0;
+  GPtrArray          *in_filenames       = NULL;
   guint32             snaplen            = 0;
   int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_UNKNOWN;
   int                 err                = 0;
@@ -217,6 +329,8 @@ main(int argc, char *argv[])
   idb_merge_mode      mode               = IDB_MERGE_MODE_MAX;
   merge_progress_callback_t cb;
 
+  memset(&extract, 0, sizeof(extract));
+
   cmdarg_err_init(mergecap_cmdarg_err, mergecap_cmdarg_err_cont);
 
   /* Initialize log handler early so we can have proper logging during startup. */
@@ -254,13 +368,35 @@ main(int argc, char *argv[])
   wtap_init(TRUE);
 
   /* Process the options first */
-  while ((opt = ws_getopt_long(argc, argv, "aF:hI:s:vVw:", long_options, NULL)) != -1) {
+  while ((opt = ws_getopt_long(argc, argv, "aA:B:F:hI:s:vVw:", long_options, NULL)) != -1) {
 
     switch (opt) {
     case 'a':
       do_append = !do_append;
       break;
 
+    case 'A':
+    case 'B':
+    {
+      nstime_t in_time;
+
+      if ((0 < iso8601_to_nstime(&in_time, ws_optarg, ISO8601_DATETIME)) || (0 < unix_epoch_to_nstime(&in_time, ws_optarg))) {
+        if (opt == 'A') {
+          nstime_copy(&extract.starttime, &in_time);
+          extract.have_starttime = TRUE;
+        } else {
+          nstime_copy(&extract.stoptime, &in_time);
+          extract.have_stoptime = TRUE;
+        }
+      } else {
+        fprintf(stderr, "mergecap: \"%s\" isn't a valid date and time\n",
+                ws_optarg);
+        status = MERGE_ERR_INVALID_OPTION;
+        goto clean_exit;
+      }
+      break;
+    }
+
     case 'F':
       file_type = wtap_name_to_file_type_subtype(ws_optarg);
       if (file_type < 0) {
@@ -294,7 +430,7 @@ main(int argc, char *argv[])
       break;
 
     case 'v':
-      verbose = TRUE;
+      extract.verbose = TRUE;
       break;
 
     case 'V':
@@ -306,6 +442,33 @@ main(int argc, char *argv[])
       out_filename = ws_optarg;
       break;
 
+    case LONGOPT_HOST:
+      if (ws_inet_pton4(ws_optarg, (ws_in4_addr *)extract.host)) {
+        extract.host_len = 4;
+      } else if (ws_inet_pton6(ws_optarg, (ws_in6_addr *)extract.host)) {
+        extract.host_len = 16;
+      } else {
+        fprintf(stderr, "mergecap: \"%s\" isn't a valid IPv4 or IPv6 address\n",
+                ws_optarg);
+        status = MERGE_ERR_INVALID_OPTION;
+        goto clean_exit;
+      }
+      break;
+
+    case LONGOPT_PORT:
+    {
+      guint32 port = get_guint32(ws_optarg, "port");
+
+      if (port > 65535) {
+        fprintf(stderr, "mergecap: %u isn't a valid port\n", port);
+        status = MERGE_ERR_INVALID_OPTION;
+        goto clean_exit;
+      }
+      extract.port = (guint16)port;
+      extract.have_port = TRUE;
+      break;
+    }
+
     case '?':              /* Bad options if GNU getopt */
       switch(ws_optopt) {
       case'F':
@@ -328,7 +491,8 @@ main(int argc, char *argv[])
     file_type = wtap_pcapng_file_type_subtype();
 
   cb.callback_func = merge_callback;
-  cb.data = NULL;
+  cb.data = &extract;
+  cb.record_filter = extracting(&extract) ? extract_record_filter : NULL;
 
   /* check for proper args; at a minimum, must have an output
    * filename and one input file
@@ -345,6 +509,22 @@ main(int argc, char *argv[])
     return 1;
   }
 
+  /* Leave out the files whose indexes show they don't have what we want */
+  in_filenames = g_ptr_array_new();
+  for (int i = ws_optind; i < argc; i++) {
+    if (extracting(&extract) && !file_may_have_packets(argv[i], &extract)) {
+      if (extract.verbose)
+        fprintf(stderr, "mergecap: skipping %s, its index shows no matching packets\n", argv[i]);
+      continue;
+    }
+    g_ptr_array_add(in_filenames, argv[i]);
+  }
+  if (in_filenames->len == 0) {
+    /* Merge one of them anyway, so that we write a valid empty file */
+    g_ptr_array_add(in_filenames, argv[ws_optind]);
+  }
+  in_file_count = in_filenames->len;
+
   /*
    * Setting IDB merge mode must use a file format that supports
    * (and thus requires) interface ID and information blocks.
@@ -365,17 +545,17 @@ main(int argc, char *argv[])
   if (strcmp(out_filename, "-") == 0) {
     /* merge the files to the standard output */
     status = merge_files_to_stdout(file_type,
-                                   (const char *const *) &argv[ws_optind],
+                                   (const char *const *) in_filenames->pdata,
                                    in_file_count, do_append, mode, snaplen,
                                    get_appname_and_version(),
-                                   verbose ? &cb : NULL,
+                                   (extract.verbose || extracting(&extract)) ? &cb : NULL,
                                    &err, &err_info, &err_fileno, &err_framenum);
   } else {
     /* merge the files to the outfile */
     status = merge_files(out_filename, file_type,
-                         (const char *const *) &argv[ws_optind], in_file_count,
+                         (const char *const *) in_filenames->pdata, in_file_count,
                          do_append, mode, snaplen, get_appname_and_version(),
-                         verbose ? &cb : NULL,
+                         (extract.verbose || extracting(&extract)) ? &cb : NULL,
                          &err, &err_info, &err_fileno, &err_framenum);
   }
 
@@ -389,7 +569,7 @@ main(int argc, char *argv[])
       break;
 
     case MERGE_ERR_CANT_OPEN_INFILE:
-      cfile_open_failure_message(argv[ws_optind + err_fileno], err, err_info);
+      cfile_open_failure_message((const char *)g_ptr_array_index(in_filenames, err_fileno), err, err_info);
       break;
 
     case MERGE_ERR_CANT_OPEN_OUTFILE:
@@ -397,16 +577,16 @@ main(int argc, char *argv[])
       break;
 
     case MERGE_ERR_CANT_READ_INFILE:
-      cfile_read_failure_message(argv[ws_optind + err_fileno], err, err_info);
+      cfile_read_failure_message((const char *)g_ptr_array_index(in_filenames, err_fileno), err, err_info);
       break;
 
     case MERGE_ERR_BAD_PHDR_INTERFACE_ID:
       cmdarg_err("Record %u of \"%s\" has an interface ID that does not match any IDB in its file.",
-                 err_framenum, argv[ws_optind + err_fileno]);
+                 err_framenum, (const char *)g_ptr_array_index(in_filenames, err_fileno));
       break;
 
     case MERGE_ERR_CANT_WRITE_OUTFILE:
-       cfile_write_failure_message(argv[ws_optind + err_fileno], out_filename,
+       cfile_write_failure_message((const char *)g_ptr_array_index(in_filenames, err_fileno), out_filename,
                                    err, err_info, err_framenum, file_type);
        break;
 
@@ -420,6 +600,8 @@ main(int argc, char *argv[])
   }
 
 clean_exit:
+  if (in_filenames != NULL)
+    g_ptr_array_free(in_filenames, TRUE);
   wtap_cleanup();
   free_progdirs();
   return (status == MERGE_OK) ? 0 : 2;
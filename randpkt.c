@@ -77,9 +77,11 @@ usage(gboolean is_error)
 	}
 
 	fprintf(output, "Usage: randpkt [-b maxbytes] [-c count] [-t type] [-r] filename\n");
+	fprintf(output, "       randpkt -T template [-c count] filename\n");
 	fprintf(output, "Default max bytes (per packet) is 5000\n");
 	fprintf(output, "Default count is 1000.\n");
 	fprintf(output, "-r: random packet type selection\n");
+	fprintf(output, "-T: replay the packets of a capture file, varying their flows\n");
 	fprintf(output, "\n");
 	fprintf(output, "Types:\n");
 
@@ -118,6 +120,8 @@ main(int argc, char *argv[])
 	int produce_max_bytes = 5000;
 	int produce_count = 1000;
 	randpkt_example *example;
+	randpkt_template *tmpl;
+	char *template_filename = NULL;
 	guint8* type = NULL;
 	int allrandom = FALSE;
 	wtap_dumper *savedump;
@@ -160,7 +164,7 @@ main(int argc, char *argv[])
 	create_app_running_mutex();
 #endif /* _WIN32 */
 
-	while ((opt = ws_getopt_long(argc, argv, "b:c:ht:r", long_options, NULL)) != -1) {
+	while ((opt = ws_getopt_long(argc, argv, "b:c:ht:rT:", long_options, NULL)) != -1) {
 		switch (opt) {
 			case 'b':	/* max bytes */
 				produce_max_bytes = get_positive_int(ws_optarg, "max bytes");
@@ -188,6 +192,10 @@ main(int argc, char *argv[])
 				allrandom = TRUE;
 				break;
 
+			case 'T':	/* capture file to replay */
+				template_filename = ws_optarg;
+				break;
+
 			default:
 				usage(TRUE);
 				ret = INVALID_OPTION;
@@ -205,6 +213,26 @@ main(int argc, char *argv[])
 		goto clean_exit;
 	}
 
+	if (template_filename) {
+		if (type || allrandom) {
+			fprintf(stderr, "Can't set type or random mode with a template\n");
+			g_free(type);
+			ret = INVALID_TYPE;
+			goto clean_exit;
+		}
+
+		tmpl = randpkt_template_open(template_filename, produce_filename);
+		if (!tmpl) {
+			ret = INVALID_FILE;
+			goto clean_exit;
+		}
+		randpkt_template_loop(tmpl, produce_count, 0);
+		if (!randpkt_template_close(tmpl)) {
+			ret = CLOSE_ERROR;
+		}
+		goto clean_exit;
+	}
+
 	if (!allrandom) {
 		produce_type = randpkt_parse_type(type);
 		g_free(type);
@@ -19,8 +19,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
 #include <wsutil/wslog.h>
 #include <wiretap/wtap_opttypes.h>
+#include <epan/etypes.h>
+#include <epan/ipproto.h>
 
 #include "ui/failure_message.h"
 
@@ -703,6 +706,383 @@ int randpkt_example_init(randpkt_example* example, char* produce_filename, int p
 	return EXIT_SUCCESS;
 }
 
+/* Template replay */
+
+#define NO_L3_OFFSET	G_MAXUINT32
+
+typedef struct {
+	guint32     data_offset;
+	guint32     caplen;
+	guint32     len;
+	guint32     presence_flags;
+	guint32     interface_id;
+	int         encap;
+	nstime_t    ts;
+	guint32     l3_offset;	/* of the IPv4 or IPv6 header, or NO_L3_OFFSET */
+	union wtap_pseudo_header pseudo_header;
+} template_pkt;
+
+struct _randpkt_template {
+	wtap*            wth;
+	wtap_dump_params params;
+	wtap_dumper*     dump;
+	const char*      filename;
+	GArray*          pkts;		/* of template_pkt */
+	GByteArray*      data;
+	guint32          max_caplen;
+	guint64          pass_ns;	/* how far each pass is shifted in time */
+};
+
+/* Where the IP header starts, for the link-layer types we can see through */
+static guint32
+template_l3_offset(const guint8* pd, guint32 caplen, int encap)
+{
+	guint32 offset;
+	guint16 etype;
+
+	switch (encap) {
+
+	case WTAP_ENCAP_ETHERNET:
+		offset = 12;
+		if (caplen < offset + 2)
+			return NO_L3_OFFSET;
+		etype = pntoh16(&pd[offset]);
+		while (etype == ETHERTYPE_VLAN || etype == ETHERTYPE_IEEE_802_1AD) {
+			offset += 4;
+			if (caplen < offset + 2)
+				return NO_L3_OFFSET;
+			etype = pntoh16(&pd[offset]);
+		}
+		offset += 2;
+		break;
+
+	case WTAP_ENCAP_SLL:
+		offset = 16;
+		if (caplen < offset)
+			return NO_L3_OFFSET;
+		etype = pntoh16(&pd[14]);
+		break;
+
+	case WTAP_ENCAP_RAW_IP:
+	case WTAP_ENCAP_RAW_IP4:
+	case WTAP_ENCAP_RAW_IP6:
+		offset = 0;
+		if (caplen < 1)
+			return NO_L3_OFFSET;
+		etype = (pd[0] >> 4) == 6 ? ETHERTYPE_IPv6 : ETHERTYPE_IP;
+		break;
+
+	default:
+		return NO_L3_OFFSET;
+	}
+
+	if (etype != ETHERTYPE_IP && etype != ETHERTYPE_IPv6)
+		return NO_L3_OFFSET;
+	if (caplen <= offset || (pd[offset] >> 4) != (etype == ETHERTYPE_IP ? 4 : 6))
+		return NO_L3_OFFSET;
+	return offset;
+}
+
+/*
+ * Replace the 16-bit word at p, and fix up the checksums at csum1 and
+ * csum2, either of which may be NULL, to match (RFC 1624).
+ */
+static void
+replace16(guint8* p, guint16 val, guint8* csum1, guint8* csum2)
+{
+	guint16 old = pntoh16(p);
+	guint8* csums[2] = { csum1, csum2 };
+	unsigned i;
+
+	phton16(p, val);
+	for (i = 0; i < array_length(csums); i++) {
+		guint32 sum;
+
+		if (!csums[i])
+			continue;
+		sum = (guint16)~pntoh16(csums[i]) + (guint16)~old + (guint32)val;
+		sum = (sum & 0xffff) + (sum >> 16);
+		sum = (sum & 0xffff) + (sum >> 16);
+		phton16(csums[i], (guint16)~sum);
+	}
+}
+
+static void
+replace32(guint8* p, guint32 val, guint8* csum)
+{
+	replace16(p, (guint16)(val >> 16), csum, NULL);
+	replace16(p + 2, (guint16)val, csum, NULL);
+}
+
+/*
+ * Make a template packet belong to a different set of flows on each pass.
+ * Every change depends only on the old value and the pass, so both
+ * directions of a flow change alike and the flow stays a flow. The low
+ * 16 bits of the addresses change on every pass, ephemeral ports (32768
+ * and up) every 65536 passes; well-known ports are left alone so that the
+ * packets still dissect as what they were. TCP sequence and acknowledgment
+ * numbers are all shifted by the same amount. Checksums are fixed up
+ * rather than recomputed, which only needs the changed words; a zero
+ * (absent) UDP checksum over IPv4 stays zero.
+ */
+static void
+template_mutate(guint8* pd, guint32 caplen, guint32 l3, guint32 pass)
+{
+	guint8* ip_csum = NULL;
+	guint8* l4_csum = NULL;
+	guint8* addrs[2];
+	guint32 l4;
+	guint8 proto;
+	gboolean udp_csum_zero_ok;
+	unsigned i;
+
+	if ((pd[l3] >> 4) == 4) {
+		guint32 ihl;
+
+		if (caplen < l3 + 20)
+			return;
+		ihl = (pd[l3] & 0x0f) * 4;
+		if (ihl < 20 || caplen < l3 + ihl)
+			return;
+		ip_csum = &pd[l3 + 10];
+		addrs[0] = &pd[l3 + 12 + 2];
+		addrs[1] = &pd[l3 + 16 + 2];
+		proto = pd[l3 + 9];
+		l4 = l3 + ihl;
+		/* Only the first fragment has the transport header */
+		if ((pntoh16(&pd[l3 + 6]) & 0x1fff) != 0)
+			proto = 0;
+		udp_csum_zero_ok = TRUE;
+	} else {
+		if (caplen < l3 + 40)
+			return;
+		addrs[0] = &pd[l3 + 8 + 14];
+		addrs[1] = &pd[l3 + 24 + 14];
+		proto = pd[l3 + 6];
+		l4 = l3 + 40;
+		udp_csum_zero_ok = FALSE;
+	}
+
+	if (proto == IP_PROTO_TCP && caplen >= l4 + 20) {
+		l4_csum = &pd[l4 + 16];
+	} else if (proto == IP_PROTO_UDP && caplen >= l4 + 8) {
+		if (!udp_csum_zero_ok || pntoh16(&pd[l4 + 6]) != 0)
+			l4_csum = &pd[l4 + 6];
+	} else {
+		proto = 0;
+	}
+
+	for (i = 0; i < array_length(addrs); i++)
+		replace16(addrs[i], (guint16)(pntoh16(addrs[i]) ^ pass), ip_csum, l4_csum);
+
+	if (proto == 0)
+		return;
+
+	for (i = 0; i < 2; i++) {
+		guint16 port = pntoh16(&pd[l4 + 2 * i]);
+
+		if (port >= 0x8000)
+			replace16(&pd[l4 + 2 * i], (guint16)(0x8000 | ((port + (pass >> 16)) & 0x7fff)), l4_csum, NULL);
+	}
+
+	if (proto == IP_PROTO_TCP) {
+		guint32 shift = pass * 0x9e3779b9;
+
+		replace32(&pd[l4 + 4], pntoh32(&pd[l4 + 4]) + shift, l4_csum);
+		replace32(&pd[l4 + 8], pntoh32(&pd[l4 + 8]) + shift, l4_csum);
+	} else if (l4_csum && pntoh16(l4_csum) == 0) {
+		/* 0 means "no checksum" for UDP; its ones' complement stands in */
+		phton16(l4_csum, 0xffff);
+	}
+}
+
+randpkt_template* randpkt_template_open(const char* template_filename, const char* produce_filename)
+{
+	randpkt_template* tmpl;
+	wtap_rec rec;
+	Buffer buf;
+	gint64 data_offset;
+	int err;
+	gchar* err_info;
+	int file_type_subtype;
+	nstime_t first_ts, last_ts;
+	guint64 span_ns;
+
+	tmpl = g_new0(randpkt_template, 1);
+	tmpl->wth = wtap_open_offline(template_filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+	if (!tmpl->wth) {
+		cfile_open_failure_message(template_filename, err, err_info);
+		g_free(tmpl);
+		return NULL;
+	}
+
+	/* Load every packet into one buffer; templates are meant to be short */
+	tmpl->pkts = g_array_new(FALSE, FALSE, sizeof(template_pkt));
+	tmpl->data = g_byte_array_new();
+	wtap_rec_init(&rec);
+	ws_buffer_init(&buf, 1514);
+	while (wtap_read(tmpl->wth, &rec, &buf, &err, &err_info, &data_offset)) {
+		template_pkt pkt;
+
+		if (rec.rec_type != REC_TYPE_PACKET) {
+			wtap_rec_reset(&rec);
+			continue;
+		}
+		pkt.data_offset = tmpl->data->len;
+		pkt.caplen = rec.rec_header.packet_header.caplen;
+		pkt.len = rec.rec_header.packet_header.len;
+		pkt.presence_flags = rec.presence_flags;
+		pkt.interface_id = rec.rec_header.packet_header.interface_id;
+		pkt.encap = rec.rec_header.packet_header.pkt_encap;
+		pkt.ts = rec.ts;
+		pkt.l3_offset = template_l3_offset(ws_buffer_start_ptr(&buf), pkt.caplen, pkt.encap);
+		pkt.pseudo_header = rec.rec_header.packet_header.pseudo_header;
+		g_byte_array_append(tmpl->data, ws_buffer_start_ptr(&buf), pkt.caplen);
+		g_array_append_val(tmpl->pkts, pkt);
+		if (pkt.caplen > tmpl->max_caplen)
+			tmpl->max_caplen = pkt.caplen;
+		wtap_rec_reset(&rec);
+	}
+	wtap_rec_cleanup(&rec);
+	ws_buffer_free(&buf);
+	if (err != 0) {
+		cfile_read_failure_message(template_filename, err, err_info);
+		randpkt_template_close(tmpl);
+		return NULL;
+	}
+	if (tmpl->pkts->len == 0) {
+		fprintf(stderr, "randpkt: The template %s has no packets in it.\n", template_filename);
+		randpkt_template_close(tmpl);
+		return NULL;
+	}
+
+	/*
+	 * Each pass starts where the last one ended, plus the average gap
+	 * between packets, so the timing of the template is kept.
+	 */
+	first_ts = g_array_index(tmpl->pkts, template_pkt, 0).ts;
+	last_ts = g_array_index(tmpl->pkts, template_pkt, tmpl->pkts->len - 1).ts;
+	if (nstime_cmp(&last_ts, &first_ts) > 0) {
+		nstime_t span;
+
+		nstime_delta(&span, &last_ts, &first_ts);
+		span_ns = (guint64)span.secs * 1000000000 + (guint64)span.nsecs;
+	} else {
+		span_ns = 0;
+	}
+	if (tmpl->pkts->len > 1 && span_ns >= tmpl->pkts->len - 1)
+		tmpl->pass_ns = span_ns + span_ns / (tmpl->pkts->len - 1);
+	else
+		tmpl->pass_ns = span_ns + 1000;
+
+	/* pcapng, so that a template with several interfaces can be replayed */
+	wtap_dump_params_init(&tmpl->params, tmpl->wth);
+	file_type_subtype = wtap_pcapng_file_type_subtype();
+	if (strcmp(produce_filename, "-") == 0) {
+		tmpl->dump = wtap_dump_open_stdout(file_type_subtype,
+			WTAP_UNCOMPRESSED, &tmpl->params, &err, &err_info);
+		tmpl->filename = "the standard output";
+	} else {
+		tmpl->dump = wtap_dump_open(produce_filename, file_type_subtype,
+			WTAP_UNCOMPRESSED, &tmpl->params, &err, &err_info);
+		tmpl->filename = produce_filename;
+	}
+	g_free(tmpl->params.idb_inf);
+	tmpl->params.idb_inf = NULL;
+	if (!tmpl->dump) {
+		cfile_dump_open_failure_message(produce_filename,
+			err, err_info, file_type_subtype);
+		randpkt_template_close(tmpl);
+		return NULL;
+	}
+
+	return tmpl;
+}
+
+void randpkt_template_loop(randpkt_template* tmpl, guint64 produce_count, guint64 packet_delay_ms)
+{
+	guint64 i;
+	guint32 n_pkts = tmpl->pkts->len;
+	guint32 idx = 0;
+	guint32 pass = 0;
+	guint8* buffer;
+	wtap_rec rec;
+	int err;
+	gchar* err_info;
+
+	/* One record and one buffer, refilled for every packet */
+	buffer = (guint8*)g_malloc(tmpl->max_caplen ? tmpl->max_caplen : 1);
+	memset(&rec, 0, sizeof rec);
+	rec.rec_type = REC_TYPE_PACKET;
+
+	for (i = 0; i < produce_count; i++) {
+		const template_pkt* pkt = &g_array_index(tmpl->pkts, template_pkt, idx);
+		guint64 shift_ns = pass * tmpl->pass_ns;
+
+		memcpy(buffer, tmpl->data->data + pkt->data_offset, pkt->caplen);
+		if (pass != 0 && pkt->l3_offset != NO_L3_OFFSET)
+			template_mutate(buffer, pkt->caplen, pkt->l3_offset, pass);
+
+		rec.presence_flags = pkt->presence_flags;
+		rec.rec_header.packet_header.caplen = pkt->caplen;
+		rec.rec_header.packet_header.len = pkt->len;
+		rec.rec_header.packet_header.pkt_encap = pkt->encap;
+		rec.rec_header.packet_header.interface_id = pkt->interface_id;
+		rec.rec_header.packet_header.pseudo_header = pkt->pseudo_header;
+		rec.ts.secs = pkt->ts.secs + (time_t)(shift_ns / 1000000000);
+		rec.ts.nsecs = pkt->ts.nsecs + (int)(shift_ns % 1000000000);
+		if (rec.ts.nsecs >= 1000000000) {
+			rec.ts.secs++;
+			rec.ts.nsecs -= 1000000000;
+		}
+
+		if (!wtap_dump(tmpl->dump, &rec, buffer, &err, &err_info)) {
+			/* Most likely the reader of a pipe went away; stop */
+			cfile_write_failure_message(NULL,
+			    tmpl->filename, err, err_info, 0,
+			    wtap_dump_file_type_subtype(tmpl->dump));
+			break;
+		}
+		if (packet_delay_ms) {
+			g_usleep(1000 * (gulong)packet_delay_ms);
+			if (!wtap_dump_flush(tmpl->dump, &err)) {
+				cfile_write_failure_message(NULL,
+				    tmpl->filename, err, NULL, 0,
+				    wtap_dump_file_type_subtype(tmpl->dump));
+				break;
+			}
+		}
+
+		if (++idx == n_pkts) {
+			idx = 0;
+			pass++;
+		}
+	}
+
+	g_free(buffer);
+}
+
+gboolean randpkt_template_close(randpkt_template* tmpl)
+{
+	int err;
+	gchar *err_info;
+	gboolean ok = TRUE;
+
+	if (tmpl->dump && !wtap_dump_close(tmpl->dump, &err, &err_info)) {
+		cfile_close_failure_message(tmpl->filename, err, err_info);
+		ok = FALSE;
+	}
+	wtap_dump_params_cleanup(&tmpl->params);
+	wtap_close(tmpl->wth);
+	if (tmpl->pkts)
+		g_array_free(tmpl->pkts, TRUE);
+	if (tmpl->data)
+		g_byte_array_free(tmpl->data, TRUE);
+	g_free(tmpl);
+
+	return ok;
+}
+
 /* Parse command-line option "type" and return enum type */
 int randpkt_parse_type(char *string)
 {
@@ -52,6 +52,23 @@ void randpkt_loop(randpkt_example* example, guint64 produce_count, guint64 packe
 /* Close the current example */
 gboolean randpkt_example_close(randpkt_example* example);
 
+/*
+ * A capture file whose packets are replayed over and over, each pass
+ * with different addresses, ports and TCP sequence numbers, so that
+ * the output looks like many flows of real traffic rather than noise.
+ */
+typedef struct _randpkt_template randpkt_template;
+
+/* Load the packets of template_filename and open produce_filename ("-"
+ * for the standard output) as a pcapng file; NULL on failure */
+randpkt_template* randpkt_template_open(const char* template_filename, const char* produce_filename);
+
+/* Write produce_count packets from the template */
+void randpkt_template_loop(randpkt_template* tmpl, guint64 produce_count, guint64 packet_delay_ms);
+
+/* Close the output and free the template */
+gboolean randpkt_template_close(randpkt_template* tmpl);
+
 #endif
 
 /*
@@ -126,10 +126,38 @@ static print_format_e print_format = PR_FMT_TEXT;
 
 static gboolean want_pcap_pkthdr;
 
+/*
+ * Input is read through this buffer, so that a read() can pick up as many
+ * records as the pipe has ready rather than two reads for every record.
+ */
+#define RAW_PIPE_BUFSIZE (256 * 1024)
+static guint8 *pipe_buf;
+static size_t pipe_buf_size;
+static size_t pipe_buf_start;   /* first byte not yet used */
+static size_t pipe_buf_end;     /* first free byte */
+
+/*
+ * The -F fields, in command-line order. They're looked up in the tree after
+ * each dissection, which is primed with all of them, rather than each field
+ * having a tap listener with the field's name as its filter.
+ */
+typedef struct _pci_t {
+    char *filter;
+    header_field_info *hfi;
+    int cmd_line_index;
+} pci_t;
+
+static GArray *field_plan;              /* of pci_t */
+static output_fields_t *output_fields;  /* the same fields, for priming and CBOR output */
+
+static gboolean cbor_output;            /* -T cbor */
+static json_dumper cbor_dumper;
+
 cf_status_t raw_cf_open(capture_file *cf, const char *fname);
 static gboolean load_cap_file(capture_file *cf);
 static gboolean process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
                                wtap_rec *rec, Buffer *buf);
+static void print_field_values(epan_dissect_t *edt);
 static void show_print_file_io_error(int err);
 
 static void rawshark_cmdarg_err(const char *fmt, va_list ap);
@@ -189,6 +217,7 @@ print_usage(FILE *output)
     fprintf(output, "  -S                       format string for fields\n");
     fprintf(output, "                           (%%D - name, %%S - stringval, %%N numval)\n");
     fprintf(output, "  -t ad|a|r|d|dd|e         output format of time stamps (def: r: rel. to first)\n");
+    fprintf(output, "  -T text|cbor             format of the output (def: text)\n");
     fprintf(output, "\n");
 
     ws_log_print_usage(output);
@@ -414,7 +443,7 @@ main(int argc, char *argv[])
       {0, 0, 0, 0 }
     };
 
-#define OPTSTRING_INIT "d:F:hlm:nN:o:pr:R:sS:t:v"
+#define OPTSTRING_INIT "d:F:hlm:nN:o:pr:R:sS:t:T:v"
 
     static const char    optstring[] = OPTSTRING_INIT;
     static const struct report_message_routines rawshark_report_routines = {
@@ -682,6 +711,18 @@ main(int argc, char *argv[])
                     goto clean_exit;
                 }
                 break;
+            case 'T':        /* Output format */
+                if (strcmp(ws_optarg, "text") == 0)
+                    cbor_output = FALSE;
+                else if (strcmp(ws_optarg, "cbor") == 0)
+                    cbor_output = TRUE;
+                else {
+                    cmdarg_err("Invalid output format \"%s\"", ws_optarg);
+                    cmdarg_err_cont("It must be \"text\" or \"cbor\".");
+                    ret = INVALID_OPTION;
+                    goto clean_exit;
+                }
+                break;
             case 'v':        /* Show version and exit */
             {
                 show_version();
@@ -703,11 +744,16 @@ main(int argc, char *argv[])
     prefs_apply_all();
 
     /* Initialize our display fields */
+    field_plan = g_array_new(FALSE, FALSE, sizeof(pci_t));
+    output_fields = output_fields_new();
     for (fc = 0; fc < disp_fields->len; fc++) {
         protocolinfo_init((char *)g_ptr_array_index(disp_fields, fc));
     }
     g_ptr_array_free(disp_fields, TRUE);
-    printf("\n");
+    if (cbor_output)
+        cbor_dumper = write_cbor_fields_preamble(output_fields, stdout);
+    else
+        printf("\n");
     fflush(stdout);
 
     /* If no capture filter or read filter has been specified, and there are
@@ -810,6 +856,9 @@ main(int argc, char *argv[])
 
 clean_exit:
     g_free(pipe_name);
+    g_free(pipe_buf);
+    if (output_fields)
+        output_fields_free(output_fields);
     epan_free(cfile.epan);
     epan_cleanup();
     extcap_cleanup();
@@ -817,6 +866,42 @@ clean_exit:
     return ret;
 }
 
+/**
+ * Make sure at least "needed" bytes of input are buffered, reading more from
+ * the pipe if necessary. A read takes whatever the pipe has ready, up to the
+ * size of the buffer, so it doesn't wait for more records than the one being
+ * read.
+ * @return 1 on success, 0 at the end of the input, -1 on a read error (in *err).
+ */
+static int
+raw_pipe_fill(size_t needed, int *err)
+{
+    ssize_t bytes_read;
+
+    while (pipe_buf_end - pipe_buf_start < needed) {
+        if (pipe_buf_start + needed > pipe_buf_size) {
+            /* Move what's left to the front, growing the buffer if that's not enough */
+            memmove(pipe_buf, pipe_buf + pipe_buf_start, pipe_buf_end - pipe_buf_start);
+            pipe_buf_end -= pipe_buf_start;
+            pipe_buf_start = 0;
+            if (needed > pipe_buf_size) {
+                pipe_buf_size = MAX(needed, RAW_PIPE_BUFSIZE);
+                pipe_buf = (guint8 *)g_realloc(pipe_buf, pipe_buf_size);
+            }
+        }
+
+        bytes_read = ws_read(fd, pipe_buf + pipe_buf_end, (unsigned int)(pipe_buf_size - pipe_buf_end));
+        if (bytes_read == 0) {
+            return 0;
+        } else if (bytes_read < 0) {
+            *err = errno;
+            return -1;
+        }
+        pipe_buf_end += (size_t)bytes_read;
+    }
+    return 1;
+}
+
 /**
  * Read data from a raw pipe.  The "raw" data consists of a libpcap
  * packet header followed by the payload.
@@ -831,7 +916,6 @@ static gboolean
 raw_pipe_read(wtap_rec *rec, Buffer *buf, int *err, gchar **err_info, gint64 *data_offset) {
     struct pcap_pkthdr mem_hdr;
     struct pcaprec_hdr disk_hdr;
-    ssize_t bytes_read = 0;
     unsigned int bytes_needed = (unsigned int) sizeof(disk_hdr);
     guchar *ptr = (guchar*) &disk_hdr;
 
@@ -859,22 +943,14 @@ raw_pipe_read(wtap_rec *rec, Buffer *buf, int *err, gchar **err_info, gint64 *da
     }
 #endif
 
-    /* Copied from capture_loop.c */
-    while (bytes_needed > 0) {
-        bytes_read = ws_read(fd, ptr, bytes_needed);
-        if (bytes_read == 0) {
-            *err = 0;
-            *err_info = NULL;
-            return FALSE;
-        } else if (bytes_read < 0) {
-            *err = errno;
-            *err_info = NULL;
-            return FALSE;
-        }
-        bytes_needed -= (unsigned int)bytes_read;
-        *data_offset += bytes_read;
-        ptr += bytes_read;
+    if (raw_pipe_fill(bytes_needed, err) <= 0) {
+        /* The end of the input, even in the middle of a header, isn't an error */
+        *err_info = NULL;
+        return FALSE;
     }
+    memcpy(ptr, pipe_buf + pipe_buf_start, bytes_needed);
+    pipe_buf_start += bytes_needed;
+    *data_offset += bytes_needed;
 
     rec->rec_type = REC_TYPE_PACKET;
     rec->presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN;
@@ -907,23 +983,19 @@ raw_pipe_read(wtap_rec *rec, Buffer *buf, int *err, gchar **err_info, gint64 *da
         return FALSE;
     }
 
-    ws_buffer_assure_space(buf, bytes_needed);
-    ptr = ws_buffer_start_ptr(buf);
-    while (bytes_needed > 0) {
-        bytes_read = ws_read(fd, ptr, bytes_needed);
-        if (bytes_read == 0) {
-            *err = WTAP_ERR_SHORT_READ;
-            *err_info = NULL;
-            return FALSE;
-        } else if (bytes_read < 0) {
-            *err = errno;
-            *err_info = NULL;
-            return FALSE;
-        }
-        bytes_needed -= (unsigned int)bytes_read;
-        *data_offset += bytes_read;
-        ptr += bytes_read;
+    switch (raw_pipe_fill(bytes_needed, err)) {
+    case 0:
+        *err = WTAP_ERR_SHORT_READ;
+        *err_info = NULL;
+        return FALSE;
+    case -1:
+        *err_info = NULL;
+        return FALSE;
     }
+    ws_buffer_assure_space(buf, bytes_needed);
+    memcpy(ws_buffer_start_ptr(buf), pipe_buf + pipe_buf_start, bytes_needed);
+    pipe_buf_start += bytes_needed;
+    *data_offset += bytes_needed;
     return TRUE;
 }
 
@@ -973,8 +1045,16 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
         /* The user sends an empty packet when he wants to get output from us even if we don't currently have
            packets to process. We spit out a line with the timestamp and the text "void"
         */
-        printf("%lu %" PRIu64 " %d void -\n", (unsigned long int)cf->count,
-               (guint64)rec->ts.secs, rec->ts.nsecs);
+        if (cbor_output) {
+            json_dumper_begin_array(&cbor_dumper);
+            json_dumper_value_anyf(&cbor_dumper, "%lu", (unsigned long int)cf->count);
+            json_dumper_value_anyf(&cbor_dumper, "null");
+            json_dumper_end_array(&cbor_dumper);
+            json_dumper_finish(&cbor_dumper);
+        } else {
+            printf("%lu %" PRIu64 " %d void -\n", (unsigned long int)cf->count,
+                   (guint64)rec->ts.secs, rec->ts.nsecs);
+        }
 
         fflush(stdout);
 
@@ -999,7 +1079,9 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
         }
     }
 
-    printf("%lu", (unsigned long int) cf->count);
+    /* Likewise with the fields we're going to print. */
+    if (field_plan->len > 0)
+        output_fields_prime_edt(output_fields, edt);
 
     frame_data_set_before_dissect(&fdata, &cf->elapsed_time,
                                   &cf->provider.ref, cf->provider.prev_dis);
@@ -1023,6 +1105,14 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
     prev_cap_frame = fdata;
     cf->provider.prev_cap = &prev_cap_frame;
 
+    if (cbor_output) {
+        json_dumper_begin_array(&cbor_dumper);
+        json_dumper_value_anyf(&cbor_dumper, "%lu", (unsigned long int) cf->count);
+    } else {
+        printf("%lu", (unsigned long int) cf->count);
+        print_field_values(edt);
+    }
+
     for(i = 0; i < n_rfilters; i++) {
         /* Run the read filter if we have one. */
         if (rfcodes[i])
@@ -1031,10 +1121,19 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
             passed = TRUE;
 
         /* Print a one-line summary */
-        printf(" %d", passed ? 1 : 0);
+        if (cbor_output)
+            json_dumper_value_anyf(&cbor_dumper, passed ? "true" : "false");
+        else
+            printf(" %d", passed ? 1 : 0);
     }
 
-    printf(" -\n");
+    if (cbor_output) {
+        json_dumper_end_array(&cbor_dumper);
+        json_dumper_finish(&cbor_dumper);
+        write_cbor_fields_proto_tree(output_fields, edt, NULL, &cbor_dumper);
+    } else {
+        printf(" -\n");
+    }
 
     /* The ANSI C standard does not appear to *require* that a line-buffered
        stream be flushed to the host environment whenever a newline is
@@ -1073,11 +1172,6 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
 /****************************************************************************************
  * FIELD EXTRACTION ROUTINES
  ****************************************************************************************/
-typedef struct _pci_t {
-    char *filter;
-    int hf_index;
-    int cmd_line_index;
-} pci_t;
 
 static const char* ftenum_to_string(header_field_info *hfi)
 {
@@ -1252,27 +1346,48 @@ static gboolean print_field_value(field_info *finfo, int cmd_line_index)
     return TRUE;
 }
 
-static tap_packet_status
-protocolinfo_packet(void *prs, packet_info *pinfo _U_, epan_dissect_t *edt, const void *dummy _U_)
+/* Like the field name used as a filter, this matches any field with that name */
+static gboolean
+field_is_present(proto_tree *tree, header_field_info *hfi)
 {
-    pci_t *rs=(pci_t *)prs;
     GPtrArray *gp;
-    guint i;
 
-    gp=proto_get_finfo_ptr_array(edt->tree, rs->hf_index);
-    if(!gp){
-        printf(" n.a.");
-        return TAP_PACKET_DONT_REDRAW;
-    }
+    while (hfi->same_name_prev_id != -1)
+        hfi = proto_registrar_get_nth(hfi->same_name_prev_id);
 
-    /*
-     * Print each occurrence of the field
-     */
-    for (i = 0; i < gp->len; i++) {
-        print_field_value((field_info *)gp->pdata[i], rs->cmd_line_index);
+    for (; hfi; hfi = hfi->same_name_next) {
+        gp = proto_get_finfo_ptr_array(tree, hfi->id);
+        if (gp && gp->len > 0)
+            return TRUE;
     }
+    return FALSE;
+}
+
+static void
+print_field_values(epan_dissect_t *edt)
+{
+    GPtrArray *gp;
+    guint i, j;
+
+    for (i = 0; i < field_plan->len; i++) {
+        pci_t *rs = &g_array_index(field_plan, pci_t, i);
+
+        if (!field_is_present(edt->tree, rs->hfi))
+            continue;
 
-    return TAP_PACKET_DONT_REDRAW;
+        gp=proto_get_finfo_ptr_array(edt->tree, rs->hfi->id);
+        if(!gp){
+            printf(" n.a.");
+            continue;
+        }
+
+        /*
+         * Print each occurrence of the field
+         */
+        for (j = 0; j < gp->len; j++) {
+            print_field_value((field_info *)gp->pdata[j], rs->cmd_line_index);
+        }
+    }
 }
 
 int g_cmd_line_index = 0;
@@ -1283,9 +1398,8 @@ int g_cmd_line_index = 0;
 static void
 protocolinfo_init(char *field)
 {
-    pci_t *rs;
+    pci_t rs;
     header_field_info *hfi;
-    GString *error_string;
     char hfibuf[100];
 
     hfi=proto_registrar_get_byname(field);
@@ -1294,30 +1408,20 @@ protocolinfo_init(char *field)
         exit(1);
     }
 
-    field_display_to_string(hfi, hfibuf, sizeof(hfibuf));
-    printf("%d %s %s - ",
-            g_cmd_line_index,
-            ftenum_to_string(hfi),
-            hfibuf);
-
-    rs=g_new(pci_t, 1);
-    rs->hf_index=hfi->id;
-    rs->filter=field;
-    rs->cmd_line_index = g_cmd_line_index++;
-
-    error_string=register_tap_listener("frame", rs, rs->filter, TL_REQUIRES_PROTO_TREE, NULL, protocolinfo_packet, NULL, NULL);
-    if(error_string){
-        /* error, we failed to attach to the tap. complain and clean up */
-        fprintf(stderr, "rawshark: Couldn't register field extraction tap: %s\n",
-                error_string->str);
-        g_string_free(error_string, TRUE);
-        if(rs->filter){
-            g_free(rs->filter);
-        }
-        g_free(rs);
-
-        exit(1);
+    if (!cbor_output) {
+        field_display_to_string(hfi, hfibuf, sizeof(hfibuf));
+        printf("%d %s %s - ",
+                g_cmd_line_index,
+                ftenum_to_string(hfi),
+                hfibuf);
     }
+
+    rs.hfi=hfi;
+    rs.filter=field;
+    rs.cmd_line_index = g_cmd_line_index++;
+    g_array_append_val(field_plan, rs);
+
+    output_fields_add(output_fields, field);
 }
 
 /*
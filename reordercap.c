@@ -62,6 +62,13 @@ typedef struct FrameRecord_t {
 } FrameRecord_t;
 
 
+/*
+ * Largest reorder window, in frames, for which the frames are read back
+ * in file order and held until they are written, rather than being
+ * re-read with one seek each.
+ */
+#define REORDER_WINDOW_MAX 16384
+
 /**************************************************/
 /* Debugging only                                 */
 
@@ -77,19 +84,14 @@ typedef struct FrameRecord_t {
 
 
 static void
-frame_write(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
-            wtap_rec *rec, Buffer *buf, const char *infile,
-            const char *outfile)
+frame_read(gint64 offset, wtap *wth, wtap_rec *rec, Buffer *buf,
+           const char *infile)
 {
     int    err;
     gchar  *err_info;
 
-    DEBUG_PRINT("\nDumping frame (offset=%" PRIu64 ")\n",
-                frame->offset);
-
-
     /* Re-read the frame from the stored location */
-    if (!wtap_seek_read(wth, frame->offset, rec, buf, &err, &err_info)) {
+    if (!wtap_seek_read(wth, offset, rec, buf, &err, &err_info)) {
         if (err != 0) {
             /* Print a message noting that the read failed somewhere along the line. */
             fprintf(stderr,
@@ -99,6 +101,15 @@ frame_write(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
             exit(1);
         }
     }
+}
+
+static void
+frame_dump(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
+           wtap_rec *rec, Buffer *buf, const char *infile,
+           const char *outfile)
+{
+    int    err;
+    gchar  *err_info;
 
     /* Copy, and set length and timestamp from item. */
     /* TODO: remove when wtap_seek_read() fills in rec,
@@ -114,6 +125,85 @@ frame_write(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
     wtap_rec_reset(rec);
 }
 
+static void
+frame_write(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
+            wtap_rec *rec, Buffer *buf, const char *infile,
+            const char *outfile)
+{
+    DEBUG_PRINT("\nDumping frame (offset=%" PRIu64 ")\n",
+                frame->offset);
+
+    frame_read(frame->offset, wth, rec, buf, infile);
+    frame_dump(frame, wth, pdh, rec, buf, infile, outfile);
+}
+
+/*
+ * Work out how many frames have to be held to write the sorted frames
+ * while reading the input in file order: when the frame at sorted
+ * position i is written, every frame up to the furthest one needed so
+ * far has been read, and none of the frames read in the meantime may
+ * have reused its slot.
+ */
+static guint
+reorder_window(GArray *frames)
+{
+    guint max_read = 0;
+    guint window = 1;
+    guint i;
+
+    for (i = 0; i < frames->len; i++) {
+        guint idx = g_array_index(frames, FrameRecord_t, i).num - 1;
+
+        if (idx > max_read)
+            max_read = idx;
+        if (max_read - idx + 1 > window)
+            window = max_read - idx + 1;
+    }
+    return window;
+}
+
+/*
+ * Write out the sorted frames, reading the input sequentially into a
+ * ring of window slots indexed by frame number.
+ */
+static void
+frames_write_windowed(GArray *frames, const gint64 *offsets, guint window,
+                      wtap *wth, wtap_dumper *pdh, const char *infile,
+                      const char *outfile)
+{
+    wtap_rec *recs = g_new(wtap_rec, window);
+    Buffer   *bufs = g_new(Buffer, window);
+    guint     next_read = 0;
+    guint     i;
+
+    for (i = 0; i < window; i++) {
+        wtap_rec_init(&recs[i]);
+        ws_buffer_init(&bufs[i], 1514);
+    }
+
+    for (i = 0; i < frames->len; i++) {
+        FrameRecord_t *frame = &g_array_index(frames, FrameRecord_t, i);
+        guint idx = frame->num - 1;
+
+        while (next_read <= idx) {
+            frame_read(offsets[next_read], wth, &recs[next_read % window],
+                       &bufs[next_read % window], infile);
+            next_read++;
+        }
+        DEBUG_PRINT("\nDumping frame (offset=%" PRIu64 ")\n",
+                    frame->offset);
+        frame_dump(frame, wth, pdh, &recs[idx % window], &bufs[idx % window],
+                   infile, outfile);
+    }
+
+    for (i = 0; i < window; i++) {
+        wtap_rec_cleanup(&recs[i]);
+        ws_buffer_free(&bufs[i]);
+    }
+    g_free(recs);
+    g_free(bufs);
+}
+
 /* Comparing timestamps between 2 frames.
    negative if (t1 < t2)
    zero     if (t1 == t2)
@@ -122,8 +212,8 @@ frame_write(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
 static int
 frames_compare(gconstpointer a, gconstpointer b)
 {
-    const FrameRecord_t *frame1 = *(const FrameRecord_t *const *) a;
-    const FrameRecord_t *frame2 = *(const FrameRecord_t *const *) b;
+    const FrameRecord_t *frame1 = (const FrameRecord_t *) a;
+    const FrameRecord_t *frame2 = (const FrameRecord_t *) b;
 
     const nstime_t *time1 = &frame1->frame_time;
     const nstime_t *time2 = &frame2->frame_time;
@@ -182,11 +272,14 @@ main(int argc, char *argv[])
     guint wrong_order_count = 0;
     gboolean write_output_regardless = TRUE;
     guint i;
+    guint window;
     wtap_dump_params params;
     int                          ret = EXIT_SUCCESS;
 
-    GPtrArray *frames;
-    FrameRecord_t *prevFrame = NULL;
+    GArray *frames;
+    gint64 *offsets = NULL;
+    FrameRecord_t newFrameRecord;
+    nstime_t prevTime = NSTIME_INIT_ZERO;
 
     int opt;
     static const struct ws_option long_options[] = {
@@ -294,30 +387,28 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
-    /* Allocate the array of frame pointers. */
-    frames = g_ptr_array_new();
+    /* Allocate the array of frame records. */
+    frames = g_array_new(FALSE, FALSE, sizeof(FrameRecord_t));
 
-    /* Read each frame from infile */
+    /* Read each frame from infile, only needing its metadata */
+    wtap_set_skip_packet_data(wth, TRUE);
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
     while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
-        FrameRecord_t *newFrameRecord;
-
-        newFrameRecord = g_slice_new(FrameRecord_t);
-        newFrameRecord->num = frames->len + 1;
-        newFrameRecord->offset = data_offset;
+        newFrameRecord.num = frames->len + 1;
+        newFrameRecord.offset = data_offset;
         if (rec.presence_flags & WTAP_HAS_TS) {
-            newFrameRecord->frame_time = rec.ts;
+            newFrameRecord.frame_time = rec.ts;
         } else {
-            nstime_set_unset(&newFrameRecord->frame_time);
+            nstime_set_unset(&newFrameRecord.frame_time);
         }
 
-        if (prevFrame && frames_compare(&newFrameRecord, &prevFrame) < 0) {
+        if (frames->len != 0 && nstime_cmp(&newFrameRecord.frame_time, &prevTime) < 0) {
            wrong_order_count++;
         }
 
-        g_ptr_array_add(frames, newFrameRecord);
-        prevFrame = newFrameRecord;
+        g_array_append_val(frames, newFrameRecord);
+        prevTime = newFrameRecord.frame_time;
         wtap_rec_reset(&rec);
     }
     wtap_rec_cleanup(&rec);
@@ -329,32 +420,46 @@ main(int argc, char *argv[])
 
     printf("%u frames, %u out of order\n", frames->len, wrong_order_count);
 
-    /* Sort the frames */
+    /* Sort the frames (the sort is stable, so frames with equal
+       timestamps stay in file order) */
     if (wrong_order_count > 0) {
-        g_ptr_array_sort(frames, frames_compare);
+        offsets = g_new(gint64, frames->len);
+        for (i = 0; i < frames->len; i++) {
+            offsets[i] = g_array_index(frames, FrameRecord_t, i).offset;
+        }
+        g_array_sort(frames, frames_compare);
     }
 
-    /* Write out each sorted frame in turn */
-    wtap_rec_init(&rec);
-    ws_buffer_init(&buf, 1514);
-    for (i = 0; i < frames->len; i++) {
-        FrameRecord_t *frame = (FrameRecord_t *)frames->pdata[i];
+    /* Avoid writing if already sorted and configured to */
+    if (wrong_order_count > 0 &&
+        (window = reorder_window(frames)) <= REORDER_WINDOW_MAX) {
+        /*
+         * The input is only locally out of order; read it in file order
+         * and hold the frames that can't be written yet, which avoids
+         * seeking back and forth, especially in compressed files.
+         */
+        DEBUG_PRINT("Reorder window is %u frames\n", window);
+        frames_write_windowed(frames, offsets, window, wth, pdh, infile, outfile);
+    } else if (write_output_regardless || (wrong_order_count > 0)) {
+        /* Write out each sorted frame in turn */
+        wtap_rec_init(&rec);
+        ws_buffer_init(&buf, 1514);
+        for (i = 0; i < frames->len; i++) {
+            FrameRecord_t *frame = &g_array_index(frames, FrameRecord_t, i);
 
-        /* Avoid writing if already sorted and configured to */
-        if (write_output_regardless || (wrong_order_count > 0)) {
             frame_write(frame, wth, pdh, &rec, &buf, infile, outfile);
         }
-        g_slice_free(FrameRecord_t, frame);
+        wtap_rec_cleanup(&rec);
+        ws_buffer_free(&buf);
     }
-    wtap_rec_cleanup(&rec);
-    ws_buffer_free(&buf);
+    g_free(offsets);
 
     if (!write_output_regardless && (wrong_order_count == 0)) {
         printf("Not writing output file because input file is already in order.\n");
     }
 
     /* Free the whole array */
-    g_ptr_array_free(frames, TRUE);
+    g_array_free(frames, TRUE);
 
     /* Close outfile */
     if (!wtap_dump_close(pdh, &err, &err_info)) {
@@ -52,7 +52,9 @@
 #endif
 
 #include "ringbuffer.h"
+#include "writecap/capindex.h"
 #include <wsutil/file_util.h>
+#include <wsutil/wslog.h>
 
 #ifdef HAVE_ZLIB
 #include <zlib.h>
@@ -61,6 +63,7 @@
 /* Ringbuffer file structure */
 typedef struct _rb_file {
   gchar         *name;
+  GThread       *compress_thread;    /**< compressing this file, if still running */
 } rb_file;
 
 #define MAX_FILENAME_QUEUE  100
@@ -81,6 +84,7 @@ typedef struct _ringbuf_data {
   gboolean      group_read_access;   /**< TRUE if files need to be opened with group read access */
   FILE         *name_h;              /**< write names of completed files to this handle */
   gchar        *compress_type;       /**< compress type */
+  capindex_t   *index;               /**< index of the current file, if we're indexing */
 
   GMutex        mutex;               /**< mutex for oldnames */
   gchar        *oldnames[MAX_FILENAME_QUEUE];       /**< filename list of pending to be deleted */
@@ -194,15 +198,44 @@ static void* exec_compress_thread(void* arg)
 
 /*
  * start a thread to compress capture file
+ *
+ * With a limited number of files, the thread is kept so that it can be
+ * waited for before the file is removed to make room for a new one.
  */
 static int ringbuf_start_compress_file(rb_file* rfile)
 {
   gchar* name = g_strdup(rfile->name);
-  g_thread_new("exec_compress", &exec_compress_thread, name);
+  GThread *thread = g_thread_new("exec_compress", &exec_compress_thread, name);
+
+  if (rb_data.unlimited) {
+    g_thread_unref(thread);
+  } else {
+    rfile->compress_thread = thread;
+  }
   return 0;
 }
 #endif
 
+static gboolean ringbuf_is_compressing(void)
+{
+#ifdef HAVE_ZLIB
+  return rb_data.compress_type != NULL && strcmp(rb_data.compress_type, "gzip") == 0;
+#else
+  return FALSE;
+#endif
+}
+
+/*
+ * wait for a file's compression, if any, to finish
+ */
+static void ringbuf_wait_compress_file(rb_file *rfile)
+{
+  if (rfile->compress_thread != NULL) {
+    g_thread_join(rfile->compress_thread);
+    rfile->compress_thread = NULL;
+  }
+}
+
 /*
  * create the next filename and open a new binary file with that name
  */
@@ -216,13 +249,17 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
   if (rfile->name != NULL) {
     if (rb_data.unlimited == FALSE) {
       /* remove old file (if any, so ignore error) */
+      ringbuf_wait_compress_file(rfile);
       ws_unlink(rfile->name);
+      if (rb_data.index != NULL) {
+        capindex_remove(rfile->name);
+      }
+      if (ringbuf_is_compressing()) {
+        gchar *gzname = ws_strdup_printf("%s.gz", rfile->name);
+        ws_unlink(gzname);
+        g_free(gzname);
+      }
     }
-#ifdef HAVE_ZLIB
-    else if (rb_data.compress_type != NULL && strcmp(rb_data.compress_type, "gzip") == 0) {
-      ringbuf_start_compress_file(rfile);
-    }
-#endif
     g_free(rfile->name);
   }
 
@@ -264,7 +301,7 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
  */
 int
 ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access,
-             gchar *compress_type, gboolean has_nametimenum)
+             gchar *compress_type, gboolean has_nametimenum, gboolean indexed)
 {
   unsigned int i;
   char        *pfx, *last_pathsep;
@@ -282,6 +319,11 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.group_read_access = group_read_access;
   rb_data.name_h = NULL;
   rb_data.compress_type = compress_type;
+  rb_data.index = NULL;
+  if (indexed) {
+    rb_data.index = g_new(capindex_t, 1);
+    capindex_init(rb_data.index);
+  }
   g_mutex_init(&rb_data.mutex);
 
   /* just to be sure ... */
@@ -341,6 +383,7 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
 
   for (i=0; i < rb_data.num_files; i++) {
     rb_data.files[i].name = NULL;
+    rb_data.files[i].compress_thread = NULL;
   }
 
   /* create the first file */
@@ -395,6 +438,35 @@ const gchar *ringbuf_current_filename(void)
   return rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
 }
 
+/*
+ * Add a packet written to the current file to its index, if we're indexing
+ */
+void
+ringbuf_index_packet(const nstime_t *ts, int linktype, const guint8 *pd, guint32 caplen)
+{
+  if (rb_data.index != NULL) {
+    capindex_add_packet(rb_data.index, ts, linktype, pd, caplen);
+  }
+}
+
+/*
+ * Write the index of the file we just closed, and start a new one
+ */
+static void
+ringbuf_write_index(void)
+{
+  char *err_msg;
+
+  if (rb_data.index == NULL) {
+    return;
+  }
+  if (!capindex_write(rb_data.index, ringbuf_current_filename(), &err_msg)) {
+    ws_warning("Can't write the index of %s: %s", ringbuf_current_filename(), err_msg);
+    g_free(err_msg);
+  }
+  capindex_init(rb_data.index);
+}
+
 /*
  * Calls ws_fdopen() for the current ringbuffer file
  */
@@ -407,12 +479,12 @@ ringbuf_init_libpcap_fdopen(int *err)
       *err = errno;
     }
   } else {
-    size_t buffsize = IO_BUF_SIZE;
+    size_t buffsize = CAPTURE_IO_BUF_SIZE;
 #ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
     ws_statb64 statb;
 
     if (ws_fstat64(rb_data.fd, &statb) == 0) {
-      if (statb.st_blksize > IO_BUF_SIZE) {
+      if (statb.st_blksize > CAPTURE_IO_BUF_SIZE) {
         buffsize = statb.st_blksize;
       }
     }
@@ -451,11 +523,20 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
   rb_data.pdh = NULL;
   rb_data.fd  = -1;
 
+  ringbuf_write_index();
+
   if (rb_data.name_h != NULL) {
     fprintf(rb_data.name_h, "%s\n", ringbuf_current_filename());
     fflush(rb_data.name_h);
   }
 
+#ifdef HAVE_ZLIB
+  /* compress the file we just closed in the background */
+  if (ringbuf_is_compressing()) {
+    ringbuf_start_compress_file(&rb_data.files[rb_data.curr_file_num % rb_data.num_files]);
+  }
+#endif
+
   /* get the next file number and open it */
 
   rb_data.curr_file_num++ /* = next_file_num*/;
@@ -500,6 +581,7 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
     g_free(rb_data.io_buffer);
     rb_data.io_buffer = NULL;
 
+    ringbuf_write_index();
   }
 
   if (rb_data.name_h != NULL) {
@@ -526,6 +608,7 @@ ringbuf_free(void)
 
   if (rb_data.files != NULL) {
     for (i=0; i < rb_data.num_files; i++) {
+      ringbuf_wait_compress_file(&rb_data.files[i]);
       if (rb_data.files[i].name != NULL) {
         g_free(rb_data.files[i].name);
         rb_data.files[i].name = NULL;
@@ -542,6 +625,8 @@ ringbuf_free(void)
     g_free(rb_data.fsuffix);
     rb_data.fsuffix = NULL;
   }
+  g_free(rb_data.index);
+  rb_data.index = NULL;
 
   CleanupOldCap(NULL);
 }
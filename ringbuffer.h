@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include "wiretap/wtap.h"
+#include <wsutil/nstime.h>
 
 #define RINGBUFFER_UNLIMITED_FILES 0
 /* Minimum number of ringbuffer files */
@@ -25,9 +26,10 @@
 #define RINGBUFFER_WARN_NUM_FILES 65535
 
 int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access, gchar* compress_type,
-                 gboolean nametimenum);
+                 gboolean nametimenum, gboolean indexed);
 gboolean ringbuf_is_initialized(void);
 const gchar *ringbuf_current_filename(void);
+void ringbuf_index_packet(const nstime_t *ts, int linktype, const guint8 *pd, guint32 caplen);
 FILE *ringbuf_init_libpcap_fdopen(int *err);
 gboolean ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd,
                              int *err);
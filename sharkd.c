@@ -247,6 +247,294 @@ sharkd_epan_new(capture_file *cf)
   return epan_new(&cf->provider, &funcs);
 }
 
+/* Set by load_cap_file() while there are tap listeners to run */
+static gboolean first_pass_taps = FALSE;
+static column_info *first_pass_cinfo = NULL;
+
+/*
+ * Hot fields: the values of a few fields, recorded one column per field
+ * while loading. Filters that look at nothing else are evaluated over
+ * trees rebuilt from these values, without reading and dissecting the
+ * frames again.
+ */
+union hot_value {
+  guint64     u;
+  gint64      i;
+  nstime_t    ts;
+  ws_in6_addr ipv6;
+  guint8      ether[FT_ETHER_LEN];
+};
+
+struct hot_field {
+  header_field_info *hfinfo;
+  GArray *values;       /* union hot_value, in frame order */
+  GArray *first;        /* guint32, index of the first value of each frame */
+};
+
+static GPtrArray *hot_fields = NULL;          /* struct hot_field * */
+static GHashTable *hot_fields_by_id = NULL;   /* hfid -> struct hot_field * */
+static gboolean hot_fields_loaded = FALSE;
+
+static void
+hot_field_free(gpointer data)
+{
+  struct hot_field *field = (struct hot_field *) data;
+
+  g_array_free(field->values, TRUE);
+  g_array_free(field->first, TRUE);
+  g_free(field);
+}
+
+static gboolean
+hot_field_supported(const header_field_info *hfinfo)
+{
+  if (hfinfo->bitmask != 0)
+    return FALSE;
+
+  switch (hfinfo->type) {
+    case FT_CHAR:
+    case FT_UINT8:
+    case FT_UINT16:
+    case FT_UINT24:
+    case FT_UINT32:
+    case FT_UINT40:
+    case FT_UINT48:
+    case FT_UINT56:
+    case FT_UINT64:
+    case FT_INT8:
+    case FT_INT16:
+    case FT_INT24:
+    case FT_INT32:
+    case FT_INT40:
+    case FT_INT48:
+    case FT_INT56:
+    case FT_INT64:
+    case FT_BOOLEAN:
+    case FT_FRAMENUM:
+    case FT_IPv4:
+    case FT_IPv6:
+    case FT_ETHER:
+    case FT_ABSOLUTE_TIME:
+    case FT_RELATIVE_TIME:
+    case FT_PROTOCOL:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/*
+ * Adds a field to the hot fields recorded by the next load, with all the
+ * fields sharing its name. Returns -1 for an unknown field and -2 for one
+ * whose type isn't supported.
+ */
+int
+sharkd_hot_fields_add(const char *name)
+{
+  header_field_info *hfinfo = proto_registrar_get_byname(name);
+  header_field_info *same;
+
+  if (!hfinfo)
+    return -1;
+
+  for (same = hfinfo; same; same = same->same_name_next) {
+    if (!hot_field_supported(same))
+      return -2;
+  }
+
+  if (!hot_fields) {
+    hot_fields = g_ptr_array_new_with_free_func(hot_field_free);
+    hot_fields_by_id = g_hash_table_new(g_direct_hash, g_direct_equal);
+  }
+
+  for (same = hfinfo; same; same = same->same_name_next) {
+    struct hot_field *field;
+
+    if (g_hash_table_contains(hot_fields_by_id, GINT_TO_POINTER(same->id)))
+      continue;
+
+    field = g_new(struct hot_field, 1);
+    field->hfinfo = same;
+    field->values = g_array_new(FALSE, FALSE, sizeof(union hot_value));
+    field->first = g_array_new(FALSE, FALSE, sizeof(guint32));
+    g_ptr_array_add(hot_fields, field);
+    g_hash_table_insert(hot_fields_by_id, GINT_TO_POINTER(same->id), field);
+  }
+
+  return 0;
+}
+
+/*
+ * Forgets the hot fields and their values, e.g. when the preferences
+ * changed and they may not be what a dissection gives anymore.
+ */
+void
+sharkd_hot_fields_reset(void)
+{
+  if (hot_fields) {
+    g_hash_table_destroy(hot_fields_by_id);
+    g_ptr_array_free(hot_fields, TRUE);
+    hot_fields_by_id = NULL;
+    hot_fields = NULL;
+  }
+  hot_fields_loaded = FALSE;
+}
+
+static void
+hot_fields_prime(epan_dissect_t *edt)
+{
+  for (guint i = 0; i < hot_fields->len; i++) {
+    struct hot_field *field = (struct hot_field *) g_ptr_array_index(hot_fields, i);
+
+    epan_dissect_prime_with_hfid(edt, field->hfinfo->id);
+  }
+}
+
+/* Appends the values of the hot fields in the tree of the next frame */
+static void
+hot_fields_record(proto_tree *tree)
+{
+  for (guint i = 0; i < hot_fields->len; i++) {
+    struct hot_field *field = (struct hot_field *) g_ptr_array_index(hot_fields, i);
+    GPtrArray *finfos = proto_get_finfo_ptr_array(tree, field->hfinfo->id);
+    guint32 end;
+
+    for (guint j = 0; finfos && j < finfos->len; j++) {
+      field_info *finfo = (field_info *) g_ptr_array_index(finfos, j);
+      union hot_value value;
+
+      memset(&value, 0, sizeof(value));
+      switch (field->hfinfo->type) {
+        case FT_UINT40:
+        case FT_UINT48:
+        case FT_UINT56:
+        case FT_UINT64:
+        case FT_BOOLEAN:
+          value.u = fvalue_get_uinteger64(&finfo->value);
+          break;
+        case FT_INT8:
+        case FT_INT16:
+        case FT_INT24:
+        case FT_INT32:
+          value.i = fvalue_get_sinteger(&finfo->value);
+          break;
+        case FT_INT40:
+        case FT_INT48:
+        case FT_INT56:
+        case FT_INT64:
+          value.i = fvalue_get_sinteger64(&finfo->value);
+          break;
+        case FT_IPv6:
+          memcpy(&value.ipv6, fvalue_get(&finfo->value), sizeof(value.ipv6));
+          break;
+        case FT_ETHER:
+          memcpy(value.ether, fvalue_get(&finfo->value), sizeof(value.ether));
+          break;
+        case FT_ABSOLUTE_TIME:
+        case FT_RELATIVE_TIME:
+          value.ts = *(const nstime_t *) fvalue_get(&finfo->value);
+          break;
+        case FT_PROTOCOL:
+          /* only its presence is recorded */
+          break;
+        default:
+          /* FT_CHAR, FT_UINT8...FT_UINT32, FT_FRAMENUM, FT_IPv4 */
+          value.u = fvalue_get_uinteger(&finfo->value);
+          break;
+      }
+      g_array_append_val(field->values, value);
+    }
+
+    end = field->values->len;
+    g_array_append_val(field->first, end);
+  }
+}
+
+/* Adds the recorded hot field values of a frame to an empty tree */
+static void
+hot_fields_add_to_tree(proto_tree *tree, guint32 framenum)
+{
+  for (guint i = 0; i < hot_fields->len; i++) {
+    struct hot_field *field = (struct hot_field *) g_ptr_array_index(hot_fields, i);
+    header_field_info *hfinfo = field->hfinfo;
+    guint32 j = g_array_index(field->first, guint32, framenum - 1);
+    guint32 end = g_array_index(field->first, guint32, framenum);
+
+    for (; j < end; j++) {
+      const union hot_value *value = &g_array_index(field->values, union hot_value, j);
+
+      switch (hfinfo->type) {
+        case FT_UINT40:
+        case FT_UINT48:
+        case FT_UINT56:
+        case FT_UINT64:
+          proto_tree_add_uint64(tree, hfinfo->id, NULL, 0, 0, value->u);
+          break;
+        case FT_BOOLEAN:
+          proto_tree_add_boolean(tree, hfinfo->id, NULL, 0, 0, value->u != 0);
+          break;
+        case FT_INT8:
+        case FT_INT16:
+        case FT_INT24:
+        case FT_INT32:
+          proto_tree_add_int(tree, hfinfo->id, NULL, 0, 0, (gint32) value->i);
+          break;
+        case FT_INT40:
+        case FT_INT48:
+        case FT_INT56:
+        case FT_INT64:
+          proto_tree_add_int64(tree, hfinfo->id, NULL, 0, 0, value->i);
+          break;
+        case FT_IPv4:
+          proto_tree_add_ipv4(tree, hfinfo->id, NULL, 0, 0, (ws_in4_addr) value->u);
+          break;
+        case FT_IPv6:
+          proto_tree_add_ipv6(tree, hfinfo->id, NULL, 0, 0, &value->ipv6);
+          break;
+        case FT_ETHER:
+          proto_tree_add_ether(tree, hfinfo->id, NULL, 0, 0, value->ether);
+          break;
+        case FT_ABSOLUTE_TIME:
+        case FT_RELATIVE_TIME:
+          proto_tree_add_time(tree, hfinfo->id, NULL, 0, 0, &value->ts);
+          break;
+        case FT_PROTOCOL:
+          proto_tree_add_protocol_format(tree, hfinfo->id, NULL, 0, 0, "%s", hfinfo->name);
+          break;
+        default:
+          proto_tree_add_uint(tree, hfinfo->id, NULL, 0, 0, (guint32) value->u);
+          break;
+      }
+    }
+  }
+}
+
+/*
+ * Can the filter be evaluated from the hot fields? A protocol is only
+ * recorded as present, so its value (e.g. "tcp contains ...") can't be.
+ */
+static gboolean
+hot_fields_cover(const dfilter_t *dfcode)
+{
+  const int *ids;
+  int count;
+
+  if (!hot_fields_loaded)
+    return FALSE;
+
+  ids = dfilter_interesting_fields(dfcode, &count);
+  for (int i = 0; i < count; i++) {
+    struct hot_field *field = (struct hot_field *) g_hash_table_lookup(hot_fields_by_id, GINT_TO_POINTER(ids[i]));
+
+    if (!field)
+      return FALSE;
+
+    if (field->hfinfo->type == FT_PROTOCOL && dfilter_reads_field_value(dfcode, ids[i]))
+      return FALSE;
+  }
+  return TRUE;
+}
+
 static gboolean
 process_packet(capture_file *cf, epan_dissect_t *edt,
                gint64 offset, wtap_rec *rec, Buffer *buf)
@@ -284,6 +572,9 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
        with the hfids postdissectors want on the first pass. */
     prime_epan_dissect_with_postdissector_wanted_hfids(edt);
 
+    if (hot_fields)
+      hot_fields_prime(edt);
+
     frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
                                   &cf->provider.ref, cf->provider.prev_dis);
     if (cf->provider.ref == &fdlocal) {
@@ -291,9 +582,16 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
       cf->provider.ref = &ref_frame;
     }
 
-    epan_dissect_run(edt, cf->cd_t, rec,
-                     frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
-                     &fdlocal, NULL);
+    /* Tap listeners registered before loading collect their statistics
+       on this pass, saving a retap later. */
+    if (first_pass_taps)
+      epan_dissect_run_with_taps(edt, cf->cd_t, rec,
+                                 frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
+                                 &fdlocal, first_pass_cinfo);
+    else
+      epan_dissect_run(edt, cf->cd_t, rec,
+                       frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
+                       &fdlocal, NULL);
 
     /* Run the read filter if we have one. */
     if (cf->rfcode)
@@ -301,6 +599,9 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
   }
 
   if (passed) {
+    if (edt && hot_fields)
+      hot_fields_record(edt->tree);
+
     frame_data_set_after_dissect(&fdlocal, &cum_bytes);
     cf->provider.prev_cap = cf->provider.prev_dis = frame_data_sequence_add(cf->provider.frames, &fdlocal);
 
@@ -356,10 +657,31 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
        *    we're going to apply a display filter;
        *
        *    a postdissector wants field values or protocols
-       *    on the first pass.
+       *    on the first pass;
+       *
+       *    a tap listener applies a filter or requires a protocol tree.
        */
+      guint tap_flags = union_of_tap_listener_flags();
+
+      first_pass_taps = tap_listeners_require_dissection();
+      first_pass_cinfo = (tap_flags & TL_REQUIRES_COLUMNS) ? &cf->cinfo : NULL;
+
       create_proto_tree =
-        (cf->rfcode != NULL || cf->dfcode != NULL || postdissectors_want_hfids());
+        (cf->rfcode != NULL || cf->dfcode != NULL || postdissectors_want_hfids() ||
+         have_filtering_tap_listeners() || (tap_flags & TL_REQUIRES_PROTO_TREE) ||
+         hot_fields != NULL);
+
+      if (hot_fields) {
+        guint32 none = 0;
+
+        for (guint i = 0; i < hot_fields->len; i++) {
+          struct hot_field *field = (struct hot_field *) g_ptr_array_index(hot_fields, i);
+
+          g_array_set_size(field->values, 0);
+          g_array_set_size(field->first, 0);
+          g_array_append_val(field->first, none);
+        }
+      }
 
       /* We're not going to display the protocol tree on this pass,
          so it's not going to be "visible". */
@@ -392,6 +714,11 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
     wtap_rec_cleanup(&rec);
     ws_buffer_free(&buf);
 
+    first_pass_taps = FALSE;
+    first_pass_cinfo = NULL;
+
+    hot_fields_loaded = (hot_fields != NULL);
+
     /* Close the sequential I/O side, to free up memory it requires. */
     wtap_sequential_close(cf->provider.wth);
 
@@ -562,10 +889,21 @@ sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num,
   return DISSECT_REQUEST_SUCCESS;
 }
 
-int
-sharkd_retap(void)
+/*
+ * Rescans the given frames, or the whole file if frames is NULL, for the
+ * registered tap listeners, without drawing them. If progress is not NULL
+ * it's called about once a second.
+ */
+static int
+sharkd_retap_frames_nodraw(const frame_list_t *frames,
+                           sharkd_progress_func_t progress, void *progress_data)
 {
-  guint32          framenum;
+  frame_list_iter_t iter;
+  guint32          framenum = 0;
+  guint32          prev_framenum = 0;
+  guint32          frames_done = 0;
+  guint32          frames_count = frames ? frame_list_count(frames) : cfile.count;
+  gint64           last_progress = g_get_monotonic_time();
   frame_data      *fdata;
   Buffer           buf;
   wtap_rec         rec;
@@ -600,15 +938,38 @@ sharkd_retap(void)
 
   reset_tap_listeners();
 
-  for (framenum = 1; framenum <= cfile.count; framenum++) {
+  if (frames)
+    frame_list_iter_init(&iter, frames);
+
+  for (;;) {
+    if (frames) {
+      if (!frame_list_iter_next(&iter, &framenum) || framenum > cfile.count)
+        break;
+    } else if (++framenum > cfile.count) {
+      break;
+    }
     fdata = sharkd_get_frame(framenum);
 
+    if ((++frames_done & 1023) == 0) {
+      gint64 now;
+
+      if (sharkd_session_request_aborted())
+        break;
+
+      now = g_get_monotonic_time();
+      if (progress && now - last_progress >= G_USEC_PER_SEC) {
+        progress(frames_done, frames_count, progress_data);
+        last_progress = now;
+      }
+    }
+
     if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
       break;
 
     fdata->ref_time = FALSE;
     fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
-    fdata->prev_dis_num = framenum - 1;
+    fdata->prev_dis_num = prev_framenum;
+    prev_framenum = framenum;
     epan_dissect_run_with_taps(&edt, cfile.cd_t, &rec,
                                frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
                                fdata, cinfo);
@@ -620,16 +981,90 @@ sharkd_retap(void)
   ws_buffer_free(&buf);
   epan_dissect_cleanup(&edt);
 
+  return 0;
+}
+
+/*
+ * Rescans the whole file for the registered tap listeners, without drawing
+ * them. If progress is not NULL it's called about once a second.
+ */
+int
+sharkd_retap_nodraw(sharkd_progress_func_t progress, void *progress_data)
+{
+  return sharkd_retap_frames_nodraw(NULL, progress, progress_data);
+}
+
+int
+sharkd_retap(void)
+{
+  int ret = sharkd_retap_nodraw(NULL, NULL);
+
   draw_tap_listeners(TRUE);
 
-  return 0;
+  return ret;
 }
 
+/*
+ * Like sharkd_retap(), for tap listeners that can only match the given
+ * frames, e.g. ones whose filter is frame_list_for_filter()'s.
+ */
 int
-sharkd_filter(const char *dftext, guint8 **result)
+sharkd_retap_frames(const frame_list_t *frames)
 {
-  dfilter_t  *dfcode = NULL;
+  int ret = sharkd_retap_frames_nodraw(frames, NULL, NULL);
 
+  draw_tap_listeners(TRUE);
+
+  return ret;
+}
+
+/*
+ * sharkd_filter() for a filter only looking at hot fields: every frame
+ * gets a tree holding just their recorded values.
+ */
+static int
+hot_fields_filter(dfilter_t *dfcode, const guint8 *frames, guint8 **result)
+{
+  guint32 framenum;
+  guint32 frames_count = cfile.count;
+  guint8 *result_bits;
+  epan_dissect_t edt;
+
+  epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
+
+  result_bits = (guint8 *) g_malloc0(2 + (frames_count / 8));
+
+  for (framenum = 1; framenum <= frames_count; framenum++) {
+    if ((framenum & 1023) == 0 && sharkd_session_request_aborted())
+      break;
+
+    if (frames && !(frames[framenum / 8] & (1 << (framenum % 8))))
+      continue;
+
+    epan_dissect_prime_with_dfilter(&edt, dfcode);
+    hot_fields_add_to_tree(edt.tree, framenum);
+
+    if (dfilter_apply_edt(dfcode, &edt))
+      result_bits[framenum / 8] |= (1 << (framenum % 8));
+
+    epan_dissect_reset(&edt);
+  }
+
+  epan_dissect_cleanup(&edt);
+
+  *result = result_bits;
+
+  return frames_count;
+}
+
+/*
+ * Runs a display filter over the frames of the capture and returns a bitmap
+ * of the matching ones (NULL if the filter is empty). If frames is not NULL
+ * only the frames set in that bitmap are dissected, the others don't match.
+ */
+int
+sharkd_filter(dfilter_t *dfcode, const guint8 *frames, guint8 **result)
+{
   guint32 framenum, prev_dis_num = 0;
   guint32 frames_count;
   Buffer buf;
@@ -642,17 +1077,15 @@ sharkd_filter(const char *dftext, guint8 **result)
 
   epan_dissect_t edt;
 
-  if (!dfilter_compile(dftext, &dfcode, &err_info)) {
-    g_free(err_info);
-    return -1;
-  }
-
-  /* if dfilter_compile() success, but (dfcode == NULL) all frames are matching */
+  /* An empty filter (dfcode == NULL) matches all frames */
   if (dfcode == NULL) {
     *result = NULL;
     return 0;
   }
 
+  if (hot_fields_cover(dfcode))
+    return hot_fields_filter(dfcode, frames, result);
+
   frames_count = cfile.count;
 
   wtap_rec_init(&rec);
@@ -660,16 +1093,22 @@ sharkd_filter(const char *dftext, guint8 **result)
   epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
 
   passed_bits = 0;
-  result_bits = (guint8 *) g_malloc(2 + (frames_count / 8));
+  result_bits = (guint8 *) g_malloc0(2 + (frames_count / 8));
 
   for (framenum = 1; framenum <= frames_count; framenum++) {
     frame_data *fdata = sharkd_get_frame(framenum);
 
+    if ((framenum & 1023) == 0 && sharkd_session_request_aborted())
+      break;
+
     if ((framenum & 7) == 0) {
       result_bits[(framenum / 8) - 1] = passed_bits;
       passed_bits = 0;
     }
 
+    if (frames && !(frames[framenum / 8] & (1 << (framenum % 8))))
+      continue;
+
     if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
       break;
 
@@ -702,8 +1141,6 @@ sharkd_filter(const char *dftext, guint8 **result)
   ws_buffer_free(&buf);
   epan_dissect_cleanup(&edt);
 
-  dfilter_free(dfcode);
-
   *result = result_bits;
 
   return framenum;
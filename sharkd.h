@@ -14,6 +14,7 @@
 
 #include <file.h>
 #include <wiretap/wtap_opttypes.h>
+#include <epan/frame_list.h>
 
 #define SHARKD_DISSECT_FLAG_NULL       0x00u
 #define SHARKD_DISSECT_FLAG_BYTES      0x01u
@@ -26,13 +27,19 @@
 #define SHARKD_MODE_GOLD_CONSOLE       3
 #define SHARKD_MODE_GOLD_DAEMON        4
 
+typedef void (*sharkd_progress_func_t)(guint32 framenum, guint32 frames_count, void *data);
+
 typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, struct epan_column_info *cinfo, const GSList *data_src, void *data);
 
 /* sharkd.c */
 cf_status_t sharkd_cf_open(const char *fname, unsigned int type, gboolean is_tempfile, int *err);
 int sharkd_load_cap_file(void);
 int sharkd_retap(void);
-int sharkd_filter(const char *dftext, guint8 **result);
+int sharkd_retap_nodraw(sharkd_progress_func_t progress, void *progress_data);
+int sharkd_retap_frames(const frame_list_t *frames);
+int sharkd_filter(dfilter_t *dfcode, const guint8 *frames, guint8 **result);
+int sharkd_hot_fields_add(const char *name);
+void sharkd_hot_fields_reset(void);
 frame_data *sharkd_get_frame(guint32 framenum);
 enum dissect_request_status {
   DISSECT_REQUEST_SUCCESS,
@@ -56,6 +63,8 @@ int sharkd_loop(int argc _U_, char* argv[] _U_);
 
 /* sharkd_session.c */
 int sharkd_session_main(int mode_setting);
+int sharkd_session_preload(const char *filename);
+gboolean sharkd_session_request_aborted(void);
 
 #endif /* __SHARKD_H */
 
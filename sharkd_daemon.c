@@ -52,6 +52,7 @@
 
 static int mode = 0;
 static socket_handle_t _server_fd = INVALID_SOCKET;
+static char *preload_file = NULL;
 
 static socket_handle_t
 socket_init(char *path)
@@ -179,6 +180,9 @@ print_usage(FILE* output)
 	fprintf(output, "Gold (gold_options):\n");
 	fprintf(output, "  -a <socket>, --api <socket>\n");
 	fprintf(output, "                           listen on this socket\n");
+	fprintf(output, "  -l <file>, --load <file>\n");
+	fprintf(output, "                           load this capture file on start, sessions\n");
+	fprintf(output, "                           asking for it get the already loaded one\n");
 	fprintf(output, "  -h, --help               show this help information\n");
 	fprintf(output, "  -v, --version            show version information\n");
 	fprintf(output, "  -C <config profile>, --config-profile <config profile>\n");
@@ -188,6 +192,7 @@ print_usage(FILE* output)
 	fprintf(output, "  Examples:\n");
 	fprintf(output, "    sharkd -C myprofile\n");
 	fprintf(output, "    sharkd -a tcp:127.0.0.1:4446 -C myprofile\n");
+	fprintf(output, "    sharkd -a tcp:127.0.0.1:4446 -l /captures/big.pcapng\n");
 
 	fprintf(output, "\n");
 	fprintf(output, "See the sharkd page of the Wireshark wiki for full details.\n");
@@ -217,7 +222,7 @@ sharkd_init(int argc, char **argv)
 	 * platform-dependent.
 	 */
 
-#define OPTSTRING "+" "a:hmvC:"
+#define OPTSTRING "+" "a:hl:mvC:"
 
 	static const char    optstring[] = OPTSTRING;
 
@@ -225,6 +230,7 @@ sharkd_init(int argc, char **argv)
 	static const struct ws_option long_options[] = {
 	  {"api", ws_required_argument, NULL, 'a'},
 	  {"help", ws_no_argument, NULL, 'h'},
+	  {"load", ws_required_argument, NULL, 'l'},
 	  {"version", ws_no_argument, NULL, 'v'},
 	  {"config-profile", ws_required_argument, NULL, 'C'},
 	  {0, 0, 0, 0 }
@@ -316,6 +322,11 @@ sharkd_init(int argc, char **argv)
 				exit(0);
 				break;
 
+			case 'l':
+				g_free(preload_file);
+				preload_file = g_strdup(ws_optarg);
+				break;
+
 			case 'm':
 				// m is an internal-only option used when the daemon session process is created
 				mode = SHARKD_MODE_GOLD_CONSOLE;
@@ -362,6 +373,19 @@ sharkd_loop(int argc _U_, char* argv[] _U_)
 sharkd_loop(int argc _U_, char* argv[])
 #endif
 {
+	/*
+	 * Load the file once, before accepting connections: the session
+	 * processes forked afterwards share its frames and first pass state
+	 * copy-on-write, and opening it again is a no-op for them.
+	 */
+	if (preload_file)
+	{
+		if (sharkd_session_preload(preload_file) != 0)
+			return -1;
+		g_free(preload_file);
+		preload_file = NULL;
+	}
+
 	if (mode == SHARKD_MODE_CLASSIC_CONSOLE || mode == SHARKD_MODE_GOLD_CONSOLE)
 	{
 		return sharkd_session_main(mode);
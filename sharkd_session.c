@@ -18,6 +18,15 @@
 #include <string.h>
 #include <errno.h>
 
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include <glib.h>
 
 #include <wsutil/wsjson.h>
@@ -45,9 +54,11 @@
 #include <epan/expert.h>
 #include <epan/export_object.h>
 #include <epan/follow.h>
+#include <epan/frame_list.h>
 #include <epan/rtd_table.h>
 #include <epan/srt_table.h>
 
+#include <epan/dissectors/packet-gtp.h>
 #include <epan/dissectors/packet-h225.h>
 #include <epan/rtp_pt.h>
 #include <ui/voip_calls.h>
@@ -56,6 +67,7 @@
 #include <ui/tap-rtp-analysis.h>
 #include <ui/version_info.h>
 #include <epan/to_str.h>
+#include <epan/app_mem_usage.h>
 
 #include <epan/addr_resolv.h>
 #include <epan/dissectors/packet-rtp.h>
@@ -75,18 +87,368 @@
 
 #include "sharkd.h"
 
+/* Memory the cached filter results may use before the least recently used
+ * ones are dropped. */
+#define SHARKD_FILTER_CACHE_BUDGET (64 * 1024 * 1024)
+
 struct sharkd_filter_item
 {
 	guint8 *filtered; /* can be NULL if all frames are matching for given filter. */
+	gsize size;       /* memory accounted for this entry */
+	GList *lru_link;  /* in filter_lru, data is the key in filter_table */
 };
 
 static GHashTable *filter_table = NULL;
+static GQueue filter_lru = G_QUEUE_INIT;
+static gsize filter_table_size = 0;
+
+/* Number of compiled filters kept before the least recently used ones are
+ * freed. The web UI checks the filter on every keystroke and then asks for
+ * the frames matching it, so the last few are likely to be used again. */
+#define SHARKD_DFILTER_CACHE_MAX 64
+
+struct sharkd_dfilter_item
+{
+	gboolean valid;
+	dfilter_t *dfcode; /* NULL if the filter is empty or invalid */
+	char *err_msg;     /* why it is invalid, or deprecation warnings */
+	GList *lru_link;   /* in dfilter_lru, data is the key in dfilter_table */
+};
+
+static GHashTable *dfilter_table = NULL;
+static GQueue dfilter_lru = G_QUEUE_INIT;
+
+/* Memory the cached column strings of the frames listing may use before
+ * they are all dropped. */
+#define SHARKD_COLUMN_CACHE_BUDGET (32 * 1024 * 1024)
+
+struct sharkd_column_row
+{
+	gboolean has_comment;    /* the record's own block has a comment */
+	int num_cols;
+	const char *col_data[];  /* strings in column_cache.strings */
+};
+
+/*
+ * Column strings of the frames already sent by sharkd_session_process_frames(),
+ * so that paging through the same rows again doesn't need dissections. The
+ * rows are only valid for one column set, identified by columns.
+ */
+static struct
+{
+	char *columns;           /* column set (and time references) of the rows */
+	GStringChunk *strings;
+	GHashTable *rows;        /* frame number -> struct sharkd_column_row */
+	gsize size;              /* memory accounted for the rows and strings */
+} column_cache;
+
+/* Resolutions of the time index levels, in ms */
+static const guint32 time_index_res[] = { 1, 10, 100, 1000, 10000, 60000, 600000, 3600000 };
+
+struct sharkd_time_bucket
+{
+	gint64 idx;     /* time since the first frame / level resolution */
+	guint32 frames;
+	guint64 bytes;
+};
+
+/*
+ * Frames and bytes per time bucket at several resolutions, so that the
+ * intervals and the packets/bytes/bits I/O graphs don't need to look at
+ * every frame. Built from the frame data on first use for a file.
+ */
+static struct
+{
+	gboolean built;
+	GArray *levels[G_N_ELEMENTS(time_index_res)]; /* NULL if not worth it */
+} time_index;
+
+/* File loaded by sharkd_session_preload() and still the current one */
+static char *preloaded_file = NULL;
 
 static int mode;
 static guint32 rpcid;
 
 static json_dumper dumper = {0};
 
+/*
+ * With the "cbor" transport every message is a frame: a 32-bit big-endian
+ * header holding the payload length, with SHARKD_FRAME_ZSTD set if the
+ * payload is zstd compressed, followed by the CBOR encoded payload.
+ *
+ * With "stream" enabled a large message is cut into several frames as it
+ * is produced. All but the last have SHARKD_FRAME_MORE set, the message is
+ * the concatenation of their (decompressed) payloads.
+ */
+#define SHARKD_FRAME_ZSTD           0x80000000U
+#define SHARKD_FRAME_MORE           0x40000000U
+#define SHARKD_FRAME_LENGTH_MASK    0x3fffffffU
+
+/* Payloads smaller than this are never compressed */
+#define SHARKD_COMPRESS_MIN         (16 * 1024)
+
+/* Size at which a streamed message is cut into a frame */
+#define SHARKD_STREAM_CHUNK         (256 * 1024)
+
+static gboolean transport_compress = FALSE;
+static gboolean transport_stream = FALSE;
+
+/* Longest request line, longer ones are split like fgets() does */
+#define SHARKD_INPUT_LINE_MAX (2 * 1024)
+
+#ifndef _WIN32
+/*
+ * Requests are read from stdin with read() rather than stdio, so that we can
+ * tell whether the next one has been received already without waiting.
+ */
+static char input_buf[2 * SHARKD_INPUT_LINE_MAX];
+static gsize input_len = 0;
+
+/* Reads more input. If wait is FALSE, only reads what is available. */
+static gboolean
+sharkd_session_input_fill(gboolean wait)
+{
+	ssize_t n;
+
+	if (input_len == sizeof(input_buf))
+		return FALSE;
+
+	if (!wait)
+	{
+		struct pollfd pfd;
+
+		pfd.fd = 0;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 0) <= 0)
+			return FALSE;
+	}
+
+	do
+		n = read(0, input_buf + input_len, sizeof(input_buf) - input_len);
+	while (n < 0 && errno == EINTR);
+
+	if (n <= 0)
+		return FALSE;
+
+	input_len += (gsize) n;
+	return TRUE;
+}
+
+/* Length of the complete line at the start of input_buf, or 0 */
+static gsize
+sharkd_session_input_line_len(void)
+{
+	const char *nl = (const char *) memchr(input_buf, '\n', input_len);
+
+	if (nl)
+		return MIN((gsize) (nl - input_buf) + 1, SHARKD_INPUT_LINE_MAX - 1);
+	if (input_len >= SHARKD_INPUT_LINE_MAX - 1)
+		return SHARKD_INPUT_LINE_MAX - 1;
+	return 0;
+}
+
+static void
+sharkd_session_consume_line(void)
+{
+	gsize len = sharkd_session_input_line_len();
+
+	memmove(input_buf, input_buf + len, input_len - len);
+	input_len -= len;
+}
+
+/* Returns a copy of the next line if it has been received already. */
+static char *
+sharkd_session_peek_line(void)
+{
+	gsize len;
+
+	while ((len = sharkd_session_input_line_len()) == 0)
+	{
+		if (!sharkd_session_input_fill(FALSE))
+			return NULL;
+	}
+
+	return g_strndup(input_buf, len);
+}
+
+/* Reads the next line, like fgets(buf, SHARKD_INPUT_LINE_MAX, stdin) */
+static char *
+sharkd_session_read_line(char *buf)
+{
+	gsize len;
+
+	while ((len = sharkd_session_input_line_len()) == 0)
+	{
+		if (!sharkd_session_input_fill(TRUE))
+		{
+			/* Last line without a newline */
+			if (input_len == 0)
+				return NULL;
+			len = input_len;
+			break;
+		}
+	}
+
+	memcpy(buf, input_buf, len);
+	buf[len] = '\0';
+	memmove(input_buf, input_buf + len, input_len - len);
+	input_len -= len;
+	return buf;
+}
+
+static gboolean
+json_tok_equal(const char *buf, const jsmntok_t *tok, const char *str)
+{
+	size_t len = strlen(str);
+
+	return tok->type == JSMN_STRING && (size_t) (tok->end - tok->start) == len &&
+	    !memcmp(&buf[tok->start], str, len);
+}
+
+/*
+ * Looks for a cancel request among the lines received already, and
+ * removes the first one found from the input. Other requests are left
+ * in place, to be processed in order afterwards.
+ */
+static gboolean
+sharkd_session_take_cancel(guint32 *cancel_id)
+{
+	gsize off = 0;
+
+	while (sharkd_session_input_fill(FALSE))
+		;
+
+	while (off < input_len)
+	{
+		const char *nl = (const char *) memchr(input_buf + off, '\n', input_len - off);
+		gsize len;
+		char *line;
+		jsmntok_t *tokens;
+		int ret;
+		gboolean is_cancel = FALSE;
+
+		if (!nl)
+			break;
+		len = (gsize) (nl - (input_buf + off)) + 1;
+
+		if (!g_strstr_len(input_buf + off, len, "cancel"))
+		{
+			off += len;
+			continue;
+		}
+
+		line = g_strndup(input_buf + off, len);
+		ret = json_parse(line, NULL, 0);
+		if (ret > 0)
+		{
+			tokens = g_new0(jsmntok_t, ret);
+			ret = json_parse(line, tokens, ret);
+			*cancel_id = 0;
+			for (int i = 1; i + 1 < ret; i++)
+			{
+				if (json_tok_equal(line, &tokens[i], "method") && json_tok_equal(line, &tokens[i + 1], "cancel"))
+					is_cancel = TRUE;
+				else if (json_tok_equal(line, &tokens[i], "id") && tokens[i + 1].type == JSMN_PRIMITIVE)
+				{
+					line[tokens[i + 1].end] = '\0';
+					if (!ws_strtou32(&line[tokens[i + 1].start], NULL, cancel_id))
+						*cancel_id = 0;
+				}
+			}
+			g_free(tokens);
+		}
+		g_free(line);
+
+		if (is_cancel)
+		{
+			memmove(input_buf + off, input_buf + off + len, input_len - off - len);
+			input_len -= len;
+			return TRUE;
+		}
+		off += len;
+	}
+
+	return FALSE;
+}
+#else
+/* stdin may be a socket handle, keep using stdio and don't look ahead */
+static void
+sharkd_session_consume_line(void)
+{
+}
+
+static char *
+sharkd_session_peek_line(void)
+{
+	return NULL;
+}
+
+static char *
+sharkd_session_read_line(char *buf)
+{
+	return fgets(buf, SHARKD_INPUT_LINE_MAX, stdin);
+}
+
+static gboolean
+sharkd_session_take_cancel(guint32 *cancel_id _U_)
+{
+	return FALSE;
+}
+#endif
+
+/*
+ * Limits of the request being processed. sharkd_session_request_aborted()
+ * is polled by the frame loops of sharkd.c, which stop early once the
+ * request is cancelled or over its limits.
+ */
+#define SHARKD_ABORT_CANCELLED  1
+#define SHARKD_ABORT_TIMEOUT    2
+#define SHARKD_ABORT_MEMORY     3
+
+static struct {
+	gint64 deadline;        /* monotonic time, 0 if none */
+	gsize memory_base;
+	gsize memory_limit;     /* growth allowed over memory_base, 0 if none */
+	int aborted;            /* SHARKD_ABORT_*, 0 while running */
+	gboolean reported;      /* error already sent for the request */
+	gboolean cancel_seen;   /* a cancel request was taken from the input */
+	guint32 cancel_id;
+	GString *real_output;   /* dumper.output_string while output is discarded */
+	GString *discard;
+} request_limits;
+
+struct sharkd_tap_request
+{
+	guint32 rpcid;
+	char *buf;           /* the request, if it isn't the current one */
+	jsmntok_t *tokens;
+	gboolean progress;
+	gboolean registered; /* FALSE once the taps of the loading pass are done */
+	int taps_count;
+	void *taps_data[16];
+	GFreeFunc taps_free[16];
+	tap_draw_cb taps_draw[16];
+	const char *taps_name[16];
+	guint16 taps_loaded; /* taps collected while loading, one bit per tap */
+	rtpstream_tapinfo_t rtp_tapinfo;
+};
+
+/* Taps registered by the load request, only their results are still used */
+static struct sharkd_tap_request *load_taps = NULL;
+
+/* Protocols and times seen while loading, if the load request asked for them */
+struct sharkd_load_analyse
+{
+	GHashTable *protocols_set;
+	GArray *protocols;       /* protocol ids, in order of appearance */
+	gboolean have_time;
+	nstime_t first_time;
+	nstime_t last_time;
+};
+
+static struct sharkd_load_analyse *load_analyse = NULL;
+
 
 static const char *
 json_find_attr(const char *buf, const jsmntok_t *tokens, int count, const char *attr)
@@ -105,10 +467,19 @@ json_find_attr(const char *buf, const jsmntok_t *tokens, int count, const char *
 	return NULL;
 }
 
+static void sharkd_json_stream(void);
+
 static void
 json_print_base64(const guint8 *data, size_t len)
 {
 	json_dumper_begin_base64(&dumper);
+	while (len > SHARKD_STREAM_CHUNK)
+	{
+		json_dumper_write_base64(&dumper, data, SHARKD_STREAM_CHUNK);
+		sharkd_json_stream();
+		data += SHARKD_STREAM_CHUNK;
+		len -= SHARKD_STREAM_CHUNK;
+	}
 	json_dumper_write_base64(&dumper, data, len);
 	json_dumper_end_base64(&dumper);
 }
@@ -182,11 +553,61 @@ sharkd_json_response_open(guint32 id)
 	sharkd_json_value_anyf("id", "%d", id);
 }
 
+static void
+sharkd_write_frame(gboolean more)
+{
+	const guint8 *payload = (const guint8 *) dumper.output_string->str;
+	gsize len = dumper.output_string->len;
+	guint32 header;
+	guint8 header_buf[4];
+#ifdef HAVE_ZSTD
+	void *compressed = NULL;
+
+	if (transport_compress && len >= SHARKD_COMPRESS_MIN)
+	{
+		size_t bound = ZSTD_compressBound(len);
+		size_t ret;
+
+		compressed = g_malloc(bound);
+		ret = ZSTD_compress(compressed, bound, payload, len, 1);
+		if (!ZSTD_isError(ret) && ret < len)
+		{
+			payload = (const guint8 *) compressed;
+			len = ret | SHARKD_FRAME_ZSTD;
+		}
+	}
+#endif
+
+	header = (guint32) len;
+	if (more)
+		header |= SHARKD_FRAME_MORE;
+	header_buf[0] = (guint8) (header >> 24);
+	header_buf[1] = (guint8) (header >> 16);
+	header_buf[2] = (guint8) (header >> 8);
+	header_buf[3] = (guint8) header;
+	fwrite(header_buf, 1, sizeof(header_buf), stdout);
+	fwrite(payload, 1, header & SHARKD_FRAME_LENGTH_MASK, stdout);
+
+#ifdef HAVE_ZSTD
+	g_free(compressed);
+#endif
+	g_string_truncate(dumper.output_string, 0);
+}
+
 static void
 sharkd_json_response_close(void)
 {
 	json_dumper_finish(&dumper);
 
+	if (request_limits.discard && dumper.output_string == request_limits.discard)
+	{
+		g_string_truncate(dumper.output_string, 0);
+		return;
+	}
+
+	if (dumper.output_string)
+		sharkd_write_frame(FALSE);
+
 	/*
 	 * We do an explicit fflush after every line, because
 	 * we want output to be written to the socket as soon
@@ -204,6 +625,26 @@ sharkd_json_response_close(void)
 	fflush(stdout);
 }
 
+/*
+ * Called between the items of a potentially large response. Line JSON goes
+ * straight to stdout anyway, a buffered CBOR message is sent as a frame once
+ * it has grown past SHARKD_STREAM_CHUNK, so that it never has to be held in
+ * memory as a whole and the reader can start early. The blocking write
+ * meanwhile holds back the producer when the reader does not keep up.
+ */
+static void
+sharkd_json_stream(void)
+{
+	if (!dumper.output_string || !transport_stream || dumper.output_string == request_limits.discard)
+		return;
+
+	if (dumper.output_string->len < SHARKD_STREAM_CHUNK)
+		return;
+
+	sharkd_write_frame(TRUE);
+	fflush(stdout);
+}
+
 static void
 sharkd_json_result_prologue(guint32 id)
 {
@@ -283,6 +724,114 @@ sharkd_json_error(guint32 id, int code, char* data, char* format, ...)
 	sharkd_json_response_close();
 }
 
+/* Resident memory of the process, 0 if unknown */
+static gsize
+sharkd_session_memory_used(void)
+{
+	const char *name;
+	gsize value, total = 0;
+
+	for (guint i = 0; (name = memory_usage_get(i, &value)) != NULL; i++)
+	{
+		if (!strcmp(name, "RSS"))
+			return value;
+		if (!strcmp(name, "Total"))
+			total = value;
+	}
+	return total;
+}
+
+static void
+sharkd_session_limits_start(const char *tok_timeout, const char *tok_max_memory)
+{
+	guint32 value;
+
+	memset(&request_limits, 0, sizeof(request_limits));
+
+	if (tok_timeout && ws_strtou32(tok_timeout, NULL, &value) && value)
+		request_limits.deadline = g_get_monotonic_time() + (gint64) value * 1000;
+
+	if (tok_max_memory && ws_strtou32(tok_max_memory, NULL, &value) && value)
+	{
+		request_limits.memory_base = sharkd_session_memory_used();
+		request_limits.memory_limit = (gsize) value * 1024 * 1024;
+	}
+}
+
+/*
+ * Returns TRUE once the current request has to stop. The output of the
+ * request is discarded from then on, its reply is the error sent by
+ * sharkd_session_abort_error(). Limits are only checked between replies,
+ * a partly written one can't be taken back.
+ */
+gboolean
+sharkd_session_request_aborted(void)
+{
+	if (request_limits.aborted)
+		return TRUE;
+
+	if (dumper.current_depth != 0)
+		return FALSE;
+
+	if (request_limits.deadline && g_get_monotonic_time() >= request_limits.deadline)
+		request_limits.aborted = SHARKD_ABORT_TIMEOUT;
+	else if (request_limits.memory_limit &&
+	         sharkd_session_memory_used() > request_limits.memory_base + request_limits.memory_limit)
+		request_limits.aborted = SHARKD_ABORT_MEMORY;
+	else if (sharkd_session_take_cancel(&request_limits.cancel_id))
+	{
+		request_limits.cancel_seen = TRUE;
+		request_limits.aborted = SHARKD_ABORT_CANCELLED;
+	}
+	else
+		return FALSE;
+
+	request_limits.real_output = dumper.output_string;
+	request_limits.discard = g_string_new(NULL);
+	dumper.output_string = request_limits.discard;
+	return TRUE;
+}
+
+/* Sends the error reply of an aborted request */
+static void
+sharkd_session_abort_error(guint32 id)
+{
+	static const char *messages[] = {
+		NULL,
+		"Request cancelled",
+		"Request timed out",
+		"Request over its memory limit"
+	};
+
+	dumper.output_string = request_limits.real_output;
+	sharkd_json_error(
+		id, -15000 - request_limits.aborted, NULL,
+		"%s", messages[request_limits.aborted]
+	);
+	dumper.output_string = request_limits.discard;
+
+	if (id == rpcid)
+		request_limits.reported = TRUE;
+}
+
+static void
+sharkd_session_limits_done(void)
+{
+	if (request_limits.aborted)
+	{
+		if (!request_limits.reported)
+			sharkd_session_abort_error(rpcid);
+
+		dumper.output_string = request_limits.real_output;
+		g_string_free(request_limits.discard, TRUE);
+	}
+
+	if (request_limits.cancel_seen)
+		sharkd_json_simple_ok(request_limits.cancel_id);
+
+	memset(&request_limits, 0, sizeof(request_limits));
+}
+
 static gboolean
 is_param_match(const char *param_in, const char *valid_param)
 {
@@ -360,10 +909,13 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 		{NULL,         "id",         1, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, MANDATORY},
 		{NULL,         "method",     1, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
 		{NULL,         "params",     1, JSMN_OBJECT,       SHARKD_JSON_OBJECT,   OPTIONAL},
+		{NULL,         "timeout",    1, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, OPTIONAL},
+		{NULL,         "max_memory", 1, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, OPTIONAL},
 
 		// Valid methods
 		{"method",     "analyse",    1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "bye",        1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"method",     "cancel",     1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "check",      1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "complete",   1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "download",   1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
@@ -378,7 +930,9 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 		{"method",     "setcomment", 1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "setconf",    1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "status",     1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"method",     "subscriber", 1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "tap",        1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"method",     "transport",  1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 
 		// Parameters and their method context
 		{"check",      "field",      2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
@@ -427,10 +981,14 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 		{"iograph",    "filter8",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"iograph",    "filter9",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"load",       "file",       2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
+		{"load",       "tap*",       2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"load",       "analyse",    2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
+		{"load",       "hot_fields", 2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"setcomment", "frame",      2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, MANDATORY},
 		{"setcomment", "comment",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"setconf",    "name",       2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
 		{"setconf",    "value",      2, JSMN_UNDEFINED,    SHARKD_JSON_ANY,      MANDATORY},
+		{"subscriber", "imsi",       2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
 		{"tap",        "tap0",       2, JSMN_STRING,       SHARKD_JSON_STRING, MANDATORY},
 		{"tap",        "tap1",       2, JSMN_STRING,       SHARKD_JSON_STRING, OPTIONAL},
 		{"tap",        "tap2",       2, JSMN_STRING,       SHARKD_JSON_STRING, OPTIONAL},
@@ -447,6 +1005,10 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 		{"tap",        "tap13",      2, JSMN_STRING,       SHARKD_JSON_STRING, OPTIONAL},
 		{"tap",        "tap14",      2, JSMN_STRING,       SHARKD_JSON_STRING, OPTIONAL},
 		{"tap",        "tap15",      2, JSMN_STRING,       SHARKD_JSON_STRING, OPTIONAL},
+		{"tap",        "progress",   2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN, OPTIONAL},
+		{"transport",  "encoding",   2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
+		{"transport",  "compress",   2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
+		{"transport",  "stream",     2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
 
 		// End of the name_array
 		{NULL,         NULL,         0, JSMN_STRING,       SHARKD_ARRAY_END,   OPTIONAL},
@@ -678,56 +1240,419 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 	// check that the current request contains the mandatory parameters
 	j = 0;
 
-	while (name_array[j].value_type != SHARKD_ARRAY_END)
-	{
-		if (name_array[j].is_mandatory && name_array[j].level == 2 && !strcmp(method, name_array[j].parent_ctx))
+	while (name_array[j].value_type != SHARKD_ARRAY_END)
+	{
+		if (name_array[j].is_mandatory && name_array[j].level == 2 && !strcmp(method, name_array[j].parent_ctx))
+		{
+			if (!json_find_attr(buf, tokens, count, name_array[j].name))
+			{
+				sharkd_json_error(
+					rpcid, -32600, NULL,
+					"Mandatory parameter %s is missing", name_array[j].name
+				);
+				return FALSE;
+			}
+		}
+		j++;
+	}
+
+
+	// check that the parameters for the current request are valid for the method and that the data type for the value is valid
+
+	return TRUE;
+}
+
+static void
+sharkd_session_filter_free(gpointer data)
+{
+	struct sharkd_filter_item *l = (struct sharkd_filter_item *) data;
+
+	g_queue_delete_link(&filter_lru, l->lru_link);
+	filter_table_size -= l->size;
+
+	g_free(l->filtered);
+	g_free(l);
+}
+
+static void
+sharkd_session_dfilter_free(gpointer data)
+{
+	struct sharkd_dfilter_item *d = (struct sharkd_dfilter_item *) data;
+
+	g_queue_delete_link(&dfilter_lru, d->lru_link);
+	dfilter_free(d->dfcode);
+	g_free(d->err_msg);
+	g_free(d);
+}
+
+/*
+ * Returns the compiled filter for the given text, compiling it unless it
+ * was compiled recently. Filters that differ only in leading and trailing
+ * blanks share an entry. The result is valid until the next call.
+ */
+static const struct sharkd_dfilter_item *
+sharkd_session_dfilter_get(const char *filter)
+{
+	struct sharkd_dfilter_item *d;
+	char *key = g_strstrip(g_strdup(filter));
+
+	d = (struct sharkd_dfilter_item *) g_hash_table_lookup(dfilter_table, key);
+	if (d)
+	{
+		g_free(key);
+		g_queue_unlink(&dfilter_lru, d->lru_link);
+		g_queue_push_head_link(&dfilter_lru, d->lru_link);
+		return d;
+	}
+
+	while (g_hash_table_size(dfilter_table) >= SHARKD_DFILTER_CACHE_MAX)
+		g_hash_table_remove(dfilter_table, g_queue_peek_tail(&dfilter_lru));
+
+	d = g_new0(struct sharkd_dfilter_item, 1);
+	d->valid = dfilter_compile(key, &d->dfcode, &d->err_msg);
+
+	g_queue_push_head(&dfilter_lru, key);
+	d->lru_link = g_queue_peek_head_link(&dfilter_lru);
+	g_hash_table_insert(dfilter_table, key, d);
+	return d;
+}
+
+/* Runs a filter over the frames, see sharkd_filter(). */
+static int
+sharkd_session_filter_run(const char *filter, const guint8 *frames, guint8 **result)
+{
+	const struct sharkd_dfilter_item *d = sharkd_session_dfilter_get(filter);
+
+	if (!d->valid)
+		return -1;
+	return sharkd_filter(d->dfcode, frames, result);
+}
+
+/* Size of the frame bitmaps returned by sharkd_filter(). */
+static gsize
+sharkd_session_filter_bits_size(void)
+{
+	return 2 + (cfile.count / 8);
+}
+
+/* dst = dst & src, or dst = dst | src, a 64-bit word at a time */
+static void
+sharkd_session_filter_bits_combine(guint8 *dst, const guint8 *src, gsize size, gboolean is_or)
+{
+	gsize i = 0;
+
+	for (; i + sizeof(guint64) <= size; i += sizeof(guint64))
+	{
+		guint64 a, b;
+
+		memcpy(&a, dst + i, sizeof(a));
+		memcpy(&b, src + i, sizeof(b));
+		a = is_or ? (a | b) : (a & b);
+		memcpy(dst + i, &a, sizeof(a));
+	}
+
+	for (; i < size; i++)
+		dst[i] = is_or ? (dst[i] | src[i]) : (dst[i] & src[i]);
+}
+
+/* Returns a new bitmap of the frames not set in bits (NULL means all). */
+static guint8 *
+sharkd_session_filter_bits_not(const guint8 *bits, gsize size)
+{
+	guint32 last = cfile.count;
+	guint8 *res = (guint8 *) g_malloc0(size);
+	gsize i = 0;
+
+	if (!bits)
+		return res;
+
+	for (; i + sizeof(guint64) <= size; i += sizeof(guint64))
+	{
+		guint64 a;
+
+		memcpy(&a, bits + i, sizeof(a));
+		a = ~a;
+		memcpy(res + i, &a, sizeof(a));
+	}
+
+	for (; i < size; i++)
+		res[i] = ~bits[i];
+
+	/* There is no frame 0, nor frames after the last one. */
+	res[0] &= ~1;
+	res[last / 8] &= (guint8) ((2 << (last % 8)) - 1);
+	for (i = last / 8 + 1; i < size; i++)
+		res[i] = 0;
+
+	return res;
+}
+
+static gboolean
+sharkd_session_filter_is_word_char(char c)
+{
+	return g_ascii_isalnum(c) || c == '_' || c == '.' || c == '-' || c == ':';
+}
+
+/*
+ * Finds the last top level (outside of parentheses, brackets, braces and
+ * quotes) "||" / "or" operator of a filter, or "&&" / "and" if !is_or.
+ * Returns its offset and length in *len, or -1 if there is none.
+ */
+static gssize
+sharkd_session_filter_find_op(const char *text, gboolean is_or, gsize *len)
+{
+	const char *sym = is_or ? "||" : "&&";
+	const char *word = is_or ? "or" : "and";
+	gsize word_len = strlen(word);
+	gssize found = -1;
+	int depth = 0;
+	char quote = '\0';
+	gsize i;
+
+	for (i = 0; text[i] != '\0'; i++)
+	{
+		char c = text[i];
+
+		if (quote)
+		{
+			if (c == '\\' && text[i + 1] != '\0')
+				i++;
+			else if (c == quote)
+				quote = '\0';
+			continue;
+		}
+
+		if (c == '"' || c == '\'')
+			quote = c;
+		else if (c == '(' || c == '[' || c == '{')
+			depth++;
+		else if (c == ')' || c == ']' || c == '}')
+			depth--;
+		else if (depth != 0)
+			continue;
+		else if (strncmp(text + i, sym, 2) == 0)
+		{
+			found = i;
+			*len = 2;
+			i++;
+		}
+		else if (g_ascii_strncasecmp(text + i, word, word_len) == 0 &&
+				(i == 0 || !sharkd_session_filter_is_word_char(text[i - 1])) &&
+				!sharkd_session_filter_is_word_char(text[i + word_len]))
+		{
+			found = i;
+			*len = word_len;
+			i += word_len - 1;
+		}
+	}
+
+	return found;
+}
+
+/* "(X)" -> "X" */
+static gboolean
+sharkd_session_filter_is_parenthesized(const char *text)
+{
+	gsize len = strlen(text);
+	gsize i;
+	int depth = 0;
+	char quote = '\0';
+
+	if (len < 2 || text[0] != '(' || text[len - 1] != ')')
+		return FALSE;
+
+	/* The first parenthesis must close at the end. */
+	for (i = 0; i < len; i++)
+	{
+		char c = text[i];
+
+		if (quote)
+		{
+			if (c == '\\' && text[i + 1] != '\0')
+				i++;
+			else if (c == quote)
+				quote = '\0';
+		}
+		else if (c == '"' || c == '\'')
+			quote = c;
+		else if (c == '(')
+			depth++;
+		else if (c == ')' && --depth == 0)
+			return i == len - 1;
+	}
+
+	return FALSE;
+}
+
+static struct sharkd_filter_item *
+sharkd_session_filter_insert(const char *filter, guint8 *filtered)
+{
+	struct sharkd_filter_item *l;
+	char *key = g_strdup(filter);
+
+	l = g_new(struct sharkd_filter_item, 1);
+	l->filtered = filtered;
+	l->size = strlen(key) + (filtered ? sharkd_session_filter_bits_size() : 0);
+
+	g_queue_push_head(&filter_lru, key);
+	l->lru_link = g_queue_peek_head_link(&filter_lru);
+	filter_table_size += l->size;
+
+	g_hash_table_insert(filter_table, key, l);
+	return l;
+}
+
+static const struct sharkd_filter_item *sharkd_session_filter_eval(const char *filter);
+
+/* Evaluates a part of a filter, with leading and trailing blanks removed. */
+static const struct sharkd_filter_item *
+sharkd_session_filter_eval_part(const char *text, gsize len)
+{
+	const struct sharkd_filter_item *l;
+	char *part = g_strstrip(g_strndup(text, len));
+
+	l = sharkd_session_filter_eval(part);
+	g_free(part);
+	return l;
+}
+
+/*
+ * Returns the cached result of a filter, or computes it. A filter whose
+ * top level is made of "||", "&&" and "!" is computed from the results of
+ * its subfilters, which are cached as well, so that refining a filter step
+ * by step ("http", then "http && ip.src == 1.2.3.4") only dissects the
+ * frames that matched the previous step. The cached entries are evicted
+ * by sharkd_session_filter_data().
+ */
+static const struct sharkd_filter_item *
+sharkd_session_filter_eval(const char *filter)
+{
+	struct sharkd_filter_item *l;
+	const struct sharkd_filter_item *l1, *l2;
+	gsize size = sharkd_session_filter_bits_size();
+	guint8 *filtered = NULL;
+	gsize op_len = 0;
+	gssize op;
+	gboolean is_or = FALSE;
+
+	l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, filter);
+	if (l)
+	{
+		g_queue_unlink(&filter_lru, l->lru_link);
+		g_queue_push_head_link(&filter_lru, l->lru_link);
+		return l;
+	}
+
+	/*
+	 * Macros can expand to anything, and the *_displayed fields depend on
+	 * the frames matched before by the same filter; run those filters as
+	 * a whole.
+	 */
+	if (strchr(filter, '$') || strstr(filter, "_displayed"))
+		op = -1;
+	else if ((op = sharkd_session_filter_find_op(filter, TRUE, &op_len)) != -1)
+		is_or = TRUE;
+	else
+		op = sharkd_session_filter_find_op(filter, FALSE, &op_len);
+
+	if (op > 0 && is_or)
+	{
+		/* A || B */
+		if (!(l1 = sharkd_session_filter_eval_part(filter, op)))
+			return NULL;
+		filtered = l1->filtered ? (guint8 *) g_memdup2(l1->filtered, size) : NULL;
+
+		if (!(l2 = sharkd_session_filter_eval_part(filter + op + op_len, strlen(filter + op + op_len))))
+		{
+			g_free(filtered);
+			return NULL;
+		}
+
+		if (!filtered || !l2->filtered)
+		{
+			g_free(filtered);
+			filtered = NULL;
+		}
+		else
+			sharkd_session_filter_bits_combine(filtered, l2->filtered, size, TRUE);
+	}
+	else if (op > 0)
+	{
+		/* A && B: B only needs to be run on the frames matching A */
+		const char *rest = filter + op + op_len;
+		char *rest_part;
+
+		if (!(l1 = sharkd_session_filter_eval_part(filter, op)))
+			return NULL;
+
+		rest_part = g_strstrip(g_strdup(rest));
+		l2 = (const struct sharkd_filter_item *) g_hash_table_lookup(filter_table, rest_part);
+		if (l2)
 		{
-			if (!json_find_attr(buf, tokens, count, name_array[j].name))
+			filtered = l2->filtered ? (guint8 *) g_memdup2(l2->filtered, size) : NULL;
+			if (!filtered)
+				filtered = l1->filtered ? (guint8 *) g_memdup2(l1->filtered, size) : NULL;
+			else if (l1->filtered)
+				sharkd_session_filter_bits_combine(filtered, l1->filtered, size, FALSE);
+		}
+		else
+		{
+			if (sharkd_session_filter_run(rest_part, l1->filtered, &filtered) == -1)
 			{
-				sharkd_json_error(
-					rpcid, -32600, NULL,
-					"Mandatory parameter %s is missing", name_array[j].name
-				);
-				return FALSE;
+				g_free(rest_part);
+				return NULL;
 			}
+			/* Empty B, A is the result */
+			if (!filtered && l1->filtered)
+				filtered = (guint8 *) g_memdup2(l1->filtered, size);
 		}
-		j++;
+		g_free(rest_part);
 	}
+	else if ((filter[0] == '!' && filter[1] != '=') ||
+			(g_ascii_strncasecmp(filter, "not", 3) == 0 &&
+			 filter[3] != '\0' && !sharkd_session_filter_is_word_char(filter[3])))
+	{
+		/* !A */
+		const char *rest = filter + (filter[0] == '!' ? 1 : 3);
 
+		if (!(l1 = sharkd_session_filter_eval_part(rest, strlen(rest))))
+			return NULL;
+		filtered = sharkd_session_filter_bits_not(l1->filtered, size);
+	}
+	else if (sharkd_session_filter_is_parenthesized(filter))
+	{
+		/* (A) is A, no need to keep another copy */
+		return sharkd_session_filter_eval_part(filter + 1, strlen(filter) - 2);
+	}
+	else if (sharkd_session_filter_run(filter, NULL, &filtered) == -1)
+	{
+		return NULL;
+	}
 
-	// check that the parameters for the current request are valid for the method and that the data type for the value is valid
-
-	return TRUE;
-}
-
-static void
-sharkd_session_filter_free(gpointer data)
-{
-	struct sharkd_filter_item *l = (struct sharkd_filter_item *) data;
+	/* Stopped early, the result is incomplete */
+	if (request_limits.aborted)
+	{
+		g_free(filtered);
+		return NULL;
+	}
 
-	g_free(l->filtered);
-	g_free(l);
+	return sharkd_session_filter_insert(filter, filtered);
 }
 
 static const struct sharkd_filter_item *
 sharkd_session_filter_data(const char *filter)
 {
-	struct sharkd_filter_item *l;
+	const struct sharkd_filter_item *l;
 
-	l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, filter);
+	l = sharkd_session_filter_eval(filter);
 	if (!l)
-	{
-		guint8 *filtered = NULL;
-
-		int ret = sharkd_filter(filter, &filtered);
-
-		if (ret == -1)
-			return NULL;
+		return NULL;
 
-		l = g_new(struct sharkd_filter_item, 1);
-		l->filtered = filtered;
-
-		g_hash_table_insert(filter_table, g_strdup(filter), l);
+	/* Drop the least recently used results over budget, but not this one */
+	while (filter_table_size > SHARKD_FILTER_CACHE_BUDGET &&
+			g_queue_peek_tail_link(&filter_lru) != l->lru_link)
+	{
+		g_hash_table_remove(filter_table, g_queue_peek_tail(&filter_lru));
 	}
 
 	return l;
@@ -1043,6 +1968,191 @@ sharkd_session_process_info(void)
 	sharkd_json_result_epilogue();
 }
 
+static void
+sharkd_session_column_cache_clear(void)
+{
+	if (column_cache.rows)
+		g_hash_table_remove_all(column_cache.rows);
+	if (column_cache.strings)
+		g_string_chunk_clear(column_cache.strings);
+	column_cache.size = 0;
+}
+
+/* Selects the column set for the next lookups and inserts. */
+static void
+sharkd_session_column_cache_use(const char *columns)
+{
+	if (!column_cache.rows)
+	{
+		column_cache.rows = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+		column_cache.strings = g_string_chunk_new(64 * 1024);
+	}
+
+	if (g_strcmp0(column_cache.columns, columns) != 0)
+	{
+		sharkd_session_column_cache_clear();
+		g_free(column_cache.columns);
+		column_cache.columns = g_strdup(columns);
+	}
+}
+
+static const struct sharkd_column_row *
+sharkd_session_column_cache_lookup(guint32 framenum)
+{
+	return (const struct sharkd_column_row *) g_hash_table_lookup(column_cache.rows, GUINT_TO_POINTER(framenum));
+}
+
+static const struct sharkd_column_row *
+sharkd_session_column_cache_insert(guint32 framenum, const column_info *cinfo, gboolean has_comment)
+{
+	struct sharkd_column_row *row;
+	gsize size;
+
+	/* Like the GStringChunk itself, the budget is all or nothing */
+	if (column_cache.size >= SHARKD_COLUMN_CACHE_BUDGET)
+		sharkd_session_column_cache_clear();
+
+	size = sizeof(*row) + cinfo->num_cols * sizeof(row->col_data[0]);
+	row = (struct sharkd_column_row *) g_malloc(size);
+	row->has_comment = has_comment;
+	row->num_cols = cinfo->num_cols;
+
+	/* hash table node */
+	size += 3 * sizeof(void *);
+
+	for (int col = 0; col < cinfo->num_cols; ++col)
+	{
+		const char *col_data = cinfo->columns[col].col_data;
+
+		if (col_data)
+		{
+			/* deduplicated, so protocol names and the like are stored once */
+			row->col_data[col] = g_string_chunk_insert_const(column_cache.strings, col_data);
+			size += strlen(col_data) + 1;
+		}
+		else
+			row->col_data[col] = NULL;
+	}
+
+	g_hash_table_replace(column_cache.rows, GUINT_TO_POINTER(framenum), row);
+	column_cache.size += size;
+
+	return row;
+}
+
+/* Time of ts since start_ts in ms, rounded down like get_io_graph_index() */
+static gint64
+sharkd_rel_msec(const nstime_t *ts, const nstime_t *start_ts)
+{
+	gint64 nsec = (ts->secs - start_ts->secs) * (gint64) 1000000000 + (ts->nsecs - start_ts->nsecs);
+
+	if (nsec >= 0)
+		return nsec / 1000000;
+	return -((-nsec + 999999) / 1000000);
+}
+
+static void
+sharkd_session_time_index_clear(void)
+{
+	for (guint i = 0; i < G_N_ELEMENTS(time_index.levels); i++)
+	{
+		if (time_index.levels[i])
+			g_array_free(time_index.levels[i], TRUE);
+		time_index.levels[i] = NULL;
+	}
+	time_index.built = FALSE;
+}
+
+static void
+sharkd_session_time_index_build(void)
+{
+	const nstime_t *start_ts;
+	gint64 prev_msec = 0;
+	guint max_buckets;
+	guint i;
+
+	time_index.built = TRUE;
+
+	if (cfile.count == 0)
+		return;
+
+	/* With more buckets than this, looking at the frames is about as fast */
+	max_buckets = cfile.count / 4;
+
+	for (i = 0; i < G_N_ELEMENTS(time_index.levels); i++)
+		time_index.levels[i] = g_array_new(FALSE, FALSE, sizeof(struct sharkd_time_bucket));
+
+	start_ts = &(sharkd_get_frame(1)->abs_ts);
+
+	for (guint32 framenum = 1; framenum <= cfile.count; framenum++)
+	{
+		const frame_data *fdata = sharkd_get_frame(framenum);
+		gint64 msec = sharkd_rel_msec(&fdata->abs_ts, start_ts);
+
+		if (msec < prev_msec)
+		{
+			/* Frames out of time order, buckets would be out of order too */
+			sharkd_session_time_index_clear();
+			time_index.built = TRUE;
+			return;
+		}
+		prev_msec = msec;
+
+		for (i = 0; i < G_N_ELEMENTS(time_index.levels); i++)
+		{
+			GArray *level = time_index.levels[i];
+			struct sharkd_time_bucket *bucket;
+			gint64 idx = msec / time_index_res[i];
+
+			if (!level)
+				continue;
+
+			bucket = level->len ? &g_array_index(level, struct sharkd_time_bucket, level->len - 1) : NULL;
+			if (!bucket || bucket->idx != idx)
+			{
+				struct sharkd_time_bucket new_bucket = { idx, 0, 0 };
+
+				if (level->len >= max_buckets)
+				{
+					g_array_free(level, TRUE);
+					time_index.levels[i] = NULL;
+					continue;
+				}
+				g_array_append_val(level, new_bucket);
+				bucket = &g_array_index(level, struct sharkd_time_bucket, level->len - 1);
+			}
+
+			bucket->frames += 1;
+			bucket->bytes  += fdata->pkt_len;
+		}
+	}
+}
+
+/*
+ * Returns the coarsest time index level usable for interval_ms, or NULL if
+ * the frames have to be looked at.
+ */
+static const GArray *
+sharkd_session_time_index_level(guint32 interval_ms, guint32 *res)
+{
+	if (!time_index.built)
+		sharkd_session_time_index_build();
+
+	for (guint i = G_N_ELEMENTS(time_index.levels); i-- > 0; )
+	{
+		if (time_index.levels[i] && interval_ms % time_index_res[i] == 0)
+		{
+			*res = time_index_res[i];
+			return time_index.levels[i];
+		}
+	}
+	return NULL;
+}
+
+static gboolean sharkd_session_load_taps_register(const char *buf, const jsmntok_t *tokens, int count);
+static void sharkd_session_load_taps_done(void);
+static void sharkd_session_load_taps_free(void);
+
 /**
  * sharkd_session_process_load()
  *
@@ -1050,6 +2160,14 @@ sharkd_session_process_info(void)
  *
  * Input:
  *   (m) file - file to be loaded
+ *   (o) tap0...tap15 - taps to run while loading, later tap requests for them
+ *                      are answered without a retap
+ *   (o) analyse - if true, collect what the analyse request returns while loading
+ *   (o) hot_fields - space or comma separated fields whose values are recorded
+ *                    while loading, filters only using them are then evaluated
+ *                    without dissecting, e.g. "ip.addr tcp.port tcp.stream".
+ *                    Fields whose value depends on the displayed frames, like
+ *                    frame.time_delta_displayed, should not be given.
  *
  * Output object with attributes:
  *   (m) err - error code
@@ -1058,6 +2176,8 @@ static void
 sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 {
 	const char *tok_file = json_find_attr(buf, tokens, count, "file");
+
+	const char *tok_hot_fields = json_find_attr(buf, tokens, count, "hot_fields");
 	int err = 0;
 
 	if (!tok_file)
@@ -1065,8 +2185,63 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
 	fprintf(stderr, "load: filename=%s\n", tok_file);
 
+	if (preloaded_file && !strcmp(tok_file, preloaded_file))
+	{
+		sharkd_json_simple_ok(rpcid);
+		return;
+	}
+	g_free(preloaded_file);
+	preloaded_file = NULL;
+
+	/* The cached filter results, columns and time index are for the previous file */
+	g_hash_table_remove_all(filter_table);
+	sharkd_session_column_cache_clear();
+	sharkd_session_time_index_clear();
+	sharkd_hot_fields_reset();
+
+	if (tok_hot_fields)
+	{
+		gchar **fields = g_strsplit_set(tok_hot_fields, " ,", -1);
+
+		for (int i = 0; fields[i]; i++)
+		{
+			if (!*fields[i])
+				continue;
+
+			switch (sharkd_hot_fields_add(fields[i]))
+			{
+			case -1:
+				sharkd_json_error(
+					rpcid, -2002, NULL,
+					"Unknown hot field: %s", fields[i]
+				);
+				break;
+			case -2:
+				sharkd_json_error(
+					rpcid, -2003, NULL,
+					"Type of hot field %s not supported", fields[i]
+				);
+				break;
+			default:
+				continue;
+			}
+
+			g_strfreev(fields);
+			sharkd_hot_fields_reset();
+			return;
+		}
+		g_strfreev(fields);
+	}
+
+	if (!sharkd_session_load_taps_register(buf, tokens, count))
+	{
+		sharkd_hot_fields_reset();
+		return;
+	}
+
 	if (sharkd_cf_open(tok_file, WTAP_TYPE_AUTO, FALSE, &err) != CF_OK)
 	{
+		sharkd_session_load_taps_free();
 		sharkd_json_error(
 			rpcid, -2001, NULL,
 			"Unable to open the file"
@@ -1089,10 +2264,46 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 	}
 	ENDTRY;
 
+	sharkd_session_load_taps_done();
+
 	if (err == 0)
 		sharkd_json_simple_ok(rpcid);
 }
 
+/**
+ * Loads a capture file before any session starts, see the -l option.
+ */
+int
+sharkd_session_preload(const char *filename)
+{
+	int err = 0;
+
+	fprintf(stderr, "preload: filename=%s\n", filename);
+
+	if (sharkd_cf_open(filename, WTAP_TYPE_AUTO, FALSE, &err) != CF_OK)
+	{
+		fprintf(stderr, "preload: unable to open the file\n");
+		return -1;
+	}
+
+	TRY
+	{
+		err = sharkd_load_cap_file();
+	}
+	CATCH(OutOfMemoryError)
+	{
+		fprintf(stderr, "preload: OutOfMemoryError\n");
+		err = ENOMEM;
+	}
+	ENDTRY;
+
+	if (err != 0)
+		return -1;
+
+	preloaded_file = g_strdup(filename);
+	return 0;
+}
+
 /**
  * sharkd_session_process_status()
  *
@@ -1188,6 +2399,28 @@ sharkd_session_process_analyse(void)
 	wtap_rec rec; /* Record metadata */
 	Buffer rec_buf;   /* Record data */
 
+	if (load_analyse)
+	{
+		/* Collected while loading */
+		sharkd_json_result_prologue(rpcid);
+
+		sharkd_json_value_anyf("frames", "%u", cfile.count);
+
+		sharkd_json_array_open("protocols");
+		for (guint i = 0; i < load_analyse->protocols->len; i++)
+			sharkd_json_value_string(NULL, proto_get_protocol_filter_name(g_array_index(load_analyse->protocols, int, i)));
+		sharkd_json_array_close();
+
+		if (load_analyse->have_time)
+		{
+			sharkd_json_value_anyf("first", "%.9f", nstime_to_sec(&load_analyse->first_time));
+			sharkd_json_value_anyf("last", "%.9f", nstime_to_sec(&load_analyse->last_time));
+		}
+
+		sharkd_json_result_epilogue();
+		return;
+	}
+
 	analyser.first_time = NULL;
 	analyser.last_time  = NULL;
 	analyser.protocols_set = g_hash_table_new(NULL /* g_direct_hash() */, NULL /* g_direct_equal */);
@@ -1320,40 +2553,34 @@ sharkd_session_create_columns(column_info *cinfo, const char *buf, const jsmntok
 }
 
 static void
-sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
-    struct epan_column_info *cinfo, const GSList *data_src _U_, void *data _U_)
+sharkd_session_process_frames_row(frame_data *fdata, const struct sharkd_column_row *row)
 {
-	packet_info *pi = &edt->pi;
-	frame_data *fdata = pi->fd;
-	wtap_block_t pkt_block = NULL;
+	wtap_block_t pkt_block;
 	char *comment;
+	gboolean has_comment;
 
 	json_dumper_begin_object(&dumper);
 
 	sharkd_json_array_open("c");
-	for (int col = 0; col < cinfo->num_cols; ++col)
-	{
-		const col_item_t *col_item = &cinfo->columns[col];
-
-		sharkd_json_value_string(NULL, col_item->col_data);
-	}
+	for (int col = 0; col < row->num_cols; ++col)
+		sharkd_json_value_string(NULL, row->col_data[col]);
 	sharkd_json_array_close();
 
-	sharkd_json_value_anyf("num", "%u", pi->num);
+	sharkd_json_value_anyf("num", "%u", fdata->num);
 
 	/*
-	 * Get the block for this record, if it has one.
+	 * Does this record have any comments?
 	 */
 	if (fdata->has_modified_block)
+	{
 		pkt_block = sharkd_get_modified_block(fdata);
+		has_comment = pkt_block != NULL &&
+		    WTAP_OPTTYPE_SUCCESS == wtap_block_get_nth_string_option_value(pkt_block, OPT_COMMENT, 0, &comment);
+	}
 	else
-		pkt_block = pi->rec->block;
+		has_comment = row->has_comment;
 
-	/*
-	 * Does this record have any comments?
-	 */
-	if (pkt_block != NULL &&
-	    WTAP_OPTTYPE_SUCCESS == wtap_block_get_nth_string_option_value(pkt_block, OPT_COMMENT, 0, &comment))
+	if (has_comment)
 		sharkd_json_value_anyf("ct", "true");
 
 	if (fdata->ignored)
@@ -1369,6 +2596,23 @@ sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
 	}
 
 	json_dumper_end_object(&dumper);
+	sharkd_json_stream();
+}
+
+static void
+sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
+    struct epan_column_info *cinfo, const GSList *data_src _U_, void *data _U_)
+{
+	packet_info *pi = &edt->pi;
+	wtap_block_t pkt_block = pi->rec->block;
+	char *comment;
+	gboolean has_comment;
+
+	has_comment = pkt_block != NULL &&
+	    WTAP_OPTTYPE_SUCCESS == wtap_block_get_nth_string_option_value(pkt_block, OPT_COMMENT, 0, &comment);
+
+	sharkd_session_process_frames_row(pi->fd,
+	    sharkd_session_column_cache_insert(pi->num, cinfo, has_comment));
 }
 
 /**
@@ -1392,6 +2636,10 @@ sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
  *   (o) ct  - if frame is commented
  *   (o) bg  - color filter - background color in hex
  *   (o) fg  - color filter - foreground color in hex
+ *
+ * Note:
+ *   Column strings are cached, frames sent before with the same columns
+ *   and refs are not dissected again.
  */
 static void
 sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int count)
@@ -1412,6 +2660,29 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 	Buffer rec_buf;   /* Record data */
 	column_info *cinfo = &cfile.cinfo;
 	column_info user_cinfo;
+	GString *columns_key;
+
+	/*
+	 * The cached columns depend on the requested columns and on the time
+	 * references; sharkd_session_create_columns() modifies the tokens.
+	 */
+	columns_key = g_string_new(NULL);
+	for (int i = 0; i < 32; i++)
+	{
+		const char *tok_col;
+		char tok_column_name[64];
+
+		snprintf(tok_column_name, sizeof(tok_column_name), "column%d", i);
+		tok_col = json_find_attr(buf, tokens, count, tok_column_name);
+		if (tok_col == NULL)
+			break;
+		g_string_append_printf(columns_key, "%s\n", tok_col);
+	}
+	if (tok_refs)
+		g_string_append_printf(columns_key, "refs=%s", tok_refs);
+
+	sharkd_session_column_cache_use(columns_key->str);
+	g_string_free(columns_key, TRUE);
 
 	if (tok_column)
 	{
@@ -1472,6 +2743,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 	for (guint32 framenum = 1; framenum <= cfile.count; framenum++)
 	{
 		frame_data *fdata;
+		const struct sharkd_column_row *row;
 		enum dissect_request_status status;
 		int err;
 		gchar *err_info;
@@ -1509,6 +2781,16 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 		}
 
 		fdata = sharkd_get_frame(framenum);
+
+		row = sharkd_session_column_cache_lookup(framenum);
+		if (row)
+		{
+			sharkd_session_process_frames_row(fdata, row);
+			if (limit && --limit == 0)
+				break;
+			continue;
+		}
+
 		status = sharkd_dissect_request(framenum,
 		    (framenum != 1) ? 1 : 0, framenum - 1,
 		    &rec, &rec_buf, cinfo,
@@ -1823,6 +3105,18 @@ struct sharkd_conv_tap_data
 	gboolean resolve_port;
 };
 
+/* How long a conversation or endpoint report waits for GeoIP answers */
+#define SHARKD_GEOIP_FLUSH_TIMEOUT 2000
+
+static void
+sharkd_session_geoip_prefetch(const address *addr)
+{
+	if (addr->type == AT_IPv4)
+		(void) maxmind_db_lookup_ipv4((const ws_in4_addr *) addr->data);
+	else if (addr->type == AT_IPv6)
+		(void) maxmind_db_lookup_ipv6((const ws_in6_addr *) addr->data);
+}
+
 static gboolean
 sharkd_session_geoip_addr(address *addr, const char *suffix)
 {
@@ -2166,7 +3460,33 @@ sharkd_session_process_tap_conv_cb(void *arg)
 		proto = "";
 	}
 
-	proto_with_port = (!strcmp(proto, "TCP") || !strcmp(proto, "UDP") || !strcmp(proto, "SCTP"));
+	proto_with_port = (!strcmp(proto, "TCP") || !strcmp(proto, "UDP") || !strcmp(proto, "SCTP"));
+
+	/* Send every address to the GeoIP resolver up front and wait for the
+	 * whole batch, rather than reporting an address only once a later
+	 * request happens to find it resolved. */
+	if (iu->hash.conv_array != NULL && (!strncmp(iu->type, "conv:", 5) || !strncmp(iu->type, "endpt:", 6)))
+	{
+		gboolean is_conv = !strncmp(iu->type, "conv:", 5);
+
+		for (i = 0; i < iu->hash.conv_array->len; i++)
+		{
+			if (is_conv)
+			{
+				conv_item_t *iui = &g_array_index(iu->hash.conv_array, conv_item_t, i);
+
+				sharkd_session_geoip_prefetch(&iui->src_address);
+				sharkd_session_geoip_prefetch(&iui->dst_address);
+			}
+			else
+			{
+				hostlist_talker_t *host = &g_array_index(iu->hash.conv_array, hostlist_talker_t, i);
+
+				sharkd_session_geoip_prefetch(&host->myaddress);
+			}
+		}
+		maxmind_db_lookup_flush(SHARKD_GEOIP_FLUSH_TIMEOUT);
+	}
 
 	if (iu->hash.conv_array != NULL && !strncmp(iu->type, "conv:", 5))
 	{
@@ -2386,6 +3706,16 @@ sharkd_session_free_tap_nstat_cb(void *arg)
 	free_stat_tables(stat_data->stat_tap_data);
 }
 
+static void
+sharkd_session_time_stat_percentiles(const timestat_t *stats)
+{
+	/* time_stat_percentile() is in msec, the other times are in seconds */
+	sharkd_json_value_anyf("p50", "%.9f", time_stat_percentile(stats, 50.0) / 1000.0);
+	sharkd_json_value_anyf("p90", "%.9f", time_stat_percentile(stats, 90.0) / 1000.0);
+	sharkd_json_value_anyf("p99", "%.9f", time_stat_percentile(stats, 99.0) / 1000.0);
+	sharkd_json_value_anyf("p999", "%.9f", time_stat_percentile(stats, 99.9) / 1000.0);
+}
+
 /**
  * sharkd_session_process_tap_rtd_cb()
  *
@@ -2400,6 +3730,7 @@ sharkd_session_free_tap_nstat_cb(void *arg)
  *                  (m) tot - total SRT time
  *                  (m) min_frame - minimal SRT
  *                  (m) max_frame - maximum SRT
+ *                  (m) p50, p90, p99, p999 - estimated percentiles of the SRT time
  *                  (o) open_req - Open Requests
  *                  (o) disc_rsp - Discarded Responses
  *                  (o) req_dup  - Duplicated Requests
@@ -2467,6 +3798,7 @@ sharkd_session_process_tap_rtd_cb(void *arg)
 			sharkd_json_value_anyf("tot", "%.9f", nstime_to_sec(&(ms->rtd[j].tot)));
 			sharkd_json_value_anyf("min_frame", "%u", ms->rtd[j].min_num);
 			sharkd_json_value_anyf("max_frame", "%u", ms->rtd[j].max_num);
+			sharkd_session_time_stat_percentiles(&ms->rtd[j]);
 
 			if (rtd_data->stat_table.num_rtds != 1)
 			{
@@ -2512,6 +3844,7 @@ sharkd_session_free_tap_rtd_cb(void *arg)
  *                            (m) min - minimum SRT time
  *                            (m) max - maximum SRT time
  *                            (m) tot - total SRT time
+ *                            (m) p50, p90, p99, p999 - estimated percentiles of the SRT time
  */
 static void
 sharkd_session_process_tap_srt_cb(void *arg)
@@ -2571,6 +3904,7 @@ sharkd_session_process_tap_srt_cb(void *arg)
 			sharkd_json_value_anyf("min", "%.9f", nstime_to_sec(&proc->stats.min));
 			sharkd_json_value_anyf("max", "%.9f", nstime_to_sec(&proc->stats.max));
 			sharkd_json_value_anyf("tot", "%.9f", nstime_to_sec(&proc->stats.tot));
+			sharkd_session_time_stat_percentiles(&proc->stats);
 
 			json_dumper_end_object(&dumper);
 		}
@@ -2754,45 +4088,16 @@ sharkd_session_process_tap_rtp_cb(void *arg)
 	json_dumper_end_object(&dumper);
 }
 
-/**
- * sharkd_session_process_tap()
- *
- * Process tap request
- *
- * Input:
- *   (m) tap0         - First tap request
- *   (o) tap1...tap15 - Other tap requests
- *
- * Output object with attributes:
- *   (m) taps  - array of object with attributes:
- *                  (m) tap  - tap name
- *                  (m) type - tap output type
- *                  ...
- *                  for type:stats see sharkd_session_process_tap_stats_cb()
- *                  for type:nstat see sharkd_session_process_tap_nstat_cb()
- *                  for type:conv see sharkd_session_process_tap_conv_cb()
- *                  for type:host see sharkd_session_process_tap_conv_cb()
- *                  for type:rtp-streams see sharkd_session_process_tap_rtp_cb()
- *                  for type:rtp-analyse see sharkd_session_process_tap_rtp_analyse_cb()
- *                  for type:eo see sharkd_session_process_tap_eo_cb()
- *                  for type:expert see sharkd_session_process_tap_expert_cb()
- *                  for type:rtd see sharkd_session_process_tap_rtd_cb()
- *                  for type:srt see sharkd_session_process_tap_srt_cb()
- *                  for type:flow see sharkd_session_process_tap_flow_cb()
- *
- *   (m) err   - error code
+/*
+ * Registers the tap listeners of a tap request. On error, the error response
+ * is sent and FALSE is returned; the listeners registered so far are left in
+ * req for sharkd_session_tap_request_free().
  */
-static void
-sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
+static gboolean
+sharkd_session_tap_register(char *buf, const jsmntok_t *tokens, int count, struct sharkd_tap_request *req)
 {
-	void *taps_data[16];
-	GFreeFunc taps_free[16];
-	int taps_count = 0;
 	int i;
 
-	rtpstream_tapinfo_t rtp_tapinfo =
-		{ NULL, NULL, NULL, NULL, 0, NULL, NULL, 0, TAP_ANALYSE, NULL, NULL, NULL, FALSE, FALSE};
-
 	for (i = 0; i < 16; i++)
 	{
 		char tapbuf[32];
@@ -2800,6 +4105,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 		void *tap_data = NULL;
 		GFreeFunc tap_free = NULL;
+		tap_draw_cb tap_draw = NULL;
 		const char *tap_filter = "";
 		GString *tap_error = NULL;
 
@@ -2808,6 +4114,28 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 		if (!tok_tap)
 			break;
 
+		/* Already collected while loading? */
+		if (load_taps && req != load_taps)
+		{
+			int j;
+
+			for (j = 0; j < load_taps->taps_count; j++)
+			{
+				if (!strcmp(load_taps->taps_name[j], tok_tap))
+					break;
+			}
+
+			if (j < load_taps->taps_count)
+			{
+				req->taps_data[req->taps_count] = load_taps->taps_data[j];
+				req->taps_draw[req->taps_count] = load_taps->taps_draw[j];
+				req->taps_name[req->taps_count] = tok_tap;
+				req->taps_loaded |= 1 << req->taps_count;
+				req->taps_count++;
+				continue;
+			}
+		}
+
 		if (!strncmp(tok_tap, "stat:", 5))
 		{
 			stats_tree_cfg *cfg = stats_tree_get_cfg_by_abbr(tok_tap + 5);
@@ -2819,18 +4147,21 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					rpcid, -11001, NULL,
 					"sharkd_session_process_tap() stat %s not found", tok_tap + 5
 				);
-				return;
+				return FALSE;
 			}
 
 			st = stats_tree_new(cfg, NULL, tap_filter);
 
 			tap_error = register_tap_listener(st->cfg->tapname, st, st->filter, st->cfg->flags, stats_tree_reset, stats_tree_packet, sharkd_session_process_tap_stats_cb, NULL);
 
+			if (!tap_error)
+				set_tap_merge(st, stats_tree_merge);
 			if (!tap_error && cfg->init)
 				cfg->init(st);
 
 			tap_data = st;
 			tap_free = sharkd_session_free_tap_stats_cb;
+			tap_draw = sharkd_session_process_tap_stats_cb;
 		}
 		else if (!strcmp(tok_tap, "expert"))
 		{
@@ -2843,6 +4174,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			tap_data = expert_tap;
 			tap_free = sharkd_session_free_tap_expert_cb;
+			tap_draw = sharkd_session_process_tap_expert_cb;
 		}
 		else if (!strncmp(tok_tap, "seqa:", 5))
 		{
@@ -2859,7 +4191,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					rpcid, -11002, NULL,
 					"sharkd_session_process_tap() seq analysis %s not found", tok_tap + 5
 				);
-				return;
+				return FALSE;
 			}
 
 			graph_analysis = sequence_analysis_info_new();
@@ -2875,6 +4207,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			tap_data = graph_analysis;
 			tap_free = sharkd_session_free_tap_flow_cb;
+			tap_draw = sharkd_session_process_tap_flow_cb;
 		}
 		else if (!strncmp(tok_tap, "conv:", 5) || !strncmp(tok_tap, "endpt:", 6))
 		{
@@ -2893,7 +4226,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 						rpcid, -11003, NULL,
 						"sharkd_session_process_tap() conv %s not found", tok_tap + 5
 					);
-					return;
+					return FALSE;
 				}
 			}
 			else if (!strncmp(tok_tap, "endpt:", 6))
@@ -2906,7 +4239,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 						rpcid, -11004, NULL,
 						"sharkd_session_process_tap() endpt %s not found", tok_tap + 6
 					);
-					return;
+					return FALSE;
 				}
 			}
 			else
@@ -2915,7 +4248,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					rpcid, -11005, NULL,
 					"sharkd_session_process_tap() conv/endpt(?): %s not found", tok_tap
 				);
-				return;
+				return FALSE;
 			}
 
 			ct_tapname = proto_get_protocol_filter_name(get_conversation_proto_id(ct));
@@ -2932,6 +4265,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			tap_data = &ct_data->hash;
 			tap_free = sharkd_session_free_tap_conv_cb;
+			tap_draw = sharkd_session_process_tap_conv_cb;
 		}
 		else if (!strncmp(tok_tap, "nstat:", 6))
 		{
@@ -2944,7 +4278,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					rpcid, -11006, NULL,
 					"sharkd_session_process_tap() nstat=%s not found", tok_tap + 6
 				);
-				return;
+				return FALSE;
 			}
 
 			stat_tap->stat_tap_init_cb(stat_tap);
@@ -2957,6 +4291,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			tap_data = stat_data;
 			tap_free = sharkd_session_free_tap_nstat_cb;
+			tap_draw = sharkd_session_process_tap_nstat_cb;
 		}
 		else if (!strncmp(tok_tap, "rtd:", 4))
 		{
@@ -2970,7 +4305,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					rpcid, -11007, NULL,
 					"sharkd_session_process_tap() rtd=%s not found", tok_tap + 4
 				);
-				return;
+				return FALSE;
 			}
 
 			rtd_table_get_filter(rtd, "", &tap_filter, &err);
@@ -2981,7 +4316,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					"sharkd_session_process_tap() rtd=%s err=%s", tok_tap + 4, err
 				);
 				g_free(err);
-				return;
+				return FALSE;
 			}
 
 			rtd_data = g_new0(rtd_data_t, 1);
@@ -2992,6 +4327,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			tap_data = rtd_data;
 			tap_free = sharkd_session_free_tap_rtd_cb;
+			tap_draw = sharkd_session_process_tap_rtd_cb;
 		}
 		else if (!strncmp(tok_tap, "srt:", 4))
 		{
@@ -3005,7 +4341,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					rpcid, -11009, NULL,
 					"sharkd_session_process_tap() srt=%s not found", tok_tap + 4
 				);
-				return;
+				return FALSE;
 			}
 
 			srt_table_get_filter(srt, "", &tap_filter, &err);
@@ -3016,7 +4352,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					"sharkd_session_process_tap() srt=%s err=%s", tok_tap + 4, err
 				);
 				g_free(err);
-				return;
+				return FALSE;
 			}
 
 			srt_data = g_new0(srt_data_t, 1);
@@ -3028,6 +4364,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			tap_data = srt_data;
 			tap_free = sharkd_session_free_tap_srt_cb;
+			tap_draw = sharkd_session_process_tap_srt_cb;
 		}
 		else if (!strncmp(tok_tap, "eo:", 3))
 		{
@@ -3041,7 +4378,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 					rpcid, -11011, NULL,
 					"sharkd_session_process_tap() eo=%s not found", tok_tap + 3
 				);
-				return;
+				return FALSE;
 			}
 
 			for (object_list = sharkd_eo_list; object_list; object_list = object_list->next)
@@ -3073,85 +4410,434 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			tap_data = eo_object;
 			tap_free = g_free; /* need to free only eo_object, object_list need to be kept for potential download */
+			tap_draw = sharkd_session_process_tap_eo_cb;
 		}
 		else if (!strcmp(tok_tap, "rtp-streams"))
 		{
-			tap_error = register_tap_listener("rtp", &rtp_tapinfo, tap_filter, 0, rtpstream_reset_cb, rtpstream_packet_cb, sharkd_session_process_tap_rtp_cb, NULL);
+			tap_error = register_tap_listener("rtp", &req->rtp_tapinfo, tap_filter, 0, rtpstream_reset_cb, rtpstream_packet_cb, sharkd_session_process_tap_rtp_cb, NULL);
 
-			tap_data = &rtp_tapinfo;
+			tap_data = &req->rtp_tapinfo;
 			tap_free = rtpstream_reset_cb;
+			tap_draw = sharkd_session_process_tap_rtp_cb;
 		}
 		else if (!strncmp(tok_tap, "rtp-analyse:", 12))
 		{
 			struct sharkd_analyse_rtp *rtp_req;
 
-			rtp_req = (struct sharkd_analyse_rtp *) g_malloc0(sizeof(*rtp_req));
-			if (!sharkd_rtp_match_init(&rtp_req->id, tok_tap + 12))
-			{
-				rtpstream_id_free(&rtp_req->id);
-				g_free(rtp_req);
-				continue;
-			}
+			rtp_req = (struct sharkd_analyse_rtp *) g_malloc0(sizeof(*rtp_req));
+			if (!sharkd_rtp_match_init(&rtp_req->id, tok_tap + 12))
+			{
+				rtpstream_id_free(&rtp_req->id);
+				g_free(rtp_req);
+				continue;
+			}
+
+			rtp_req->tap_name = tok_tap;
+			rtp_req->statinfo.first_packet = TRUE;
+			rtp_req->statinfo.reg_pt = PT_UNDEFINED;
+
+			tap_error = register_tap_listener("rtp", rtp_req, tap_filter, 0, NULL, sharkd_session_packet_tap_rtp_analyse_cb, sharkd_session_process_tap_rtp_analyse_cb, NULL);
+
+			tap_data = rtp_req;
+			tap_free = sharkd_session_process_tap_rtp_free_cb;
+			tap_draw = sharkd_session_process_tap_rtp_analyse_cb;
+		}
+		else
+		{
+			sharkd_json_error(
+				rpcid, -11012, NULL,
+				"sharkd_session_process_tap() %s not recognized", tok_tap
+			);
+			return FALSE;
+		}
+
+		if (tap_error)
+		{
+			sharkd_json_error(
+				rpcid, -11013, NULL,
+				"sharkd_session_process_tap() name=%s error=%s", tok_tap, tap_error->str
+			);
+			g_string_free(tap_error, TRUE);
+			if (tap_free)
+				tap_free(tap_data);
+			return FALSE;
+		}
+
+		req->taps_data[req->taps_count] = tap_data;
+		req->taps_free[req->taps_count] = tap_free;
+		req->taps_draw[req->taps_count] = tap_draw;
+		req->taps_name[req->taps_count] = tok_tap;
+		req->taps_count++;
+	}
+
+	return TRUE;
+}
+
+static struct sharkd_tap_request *
+sharkd_session_tap_request_new(guint32 id)
+{
+	struct sharkd_tap_request *req = g_new0(struct sharkd_tap_request, 1);
+	rtpstream_tapinfo_t rtp_tapinfo =
+		{ NULL, NULL, NULL, NULL, 0, NULL, NULL, 0, TAP_ANALYSE, NULL, NULL, NULL, FALSE, FALSE};
+
+	req->rpcid = id;
+	req->registered = TRUE;
+	req->rtp_tapinfo = rtp_tapinfo;
+	return req;
+}
+
+static void
+sharkd_session_tap_request_free(struct sharkd_tap_request *req)
+{
+	int i;
+
+	for (i = 0; i < req->taps_count; i++)
+	{
+		/* owned by load_taps */
+		if (req->taps_loaded & (1 << i))
+			continue;
+
+		if (req->registered && req->taps_data[i])
+			remove_tap_listener(req->taps_data[i]);
+
+		if (req->taps_free[i])
+			req->taps_free[i](req->taps_data[i]);
+	}
+
+	g_free(req->tokens);
+	g_free(req->buf);
+	g_free(req);
+}
+
+static tap_packet_status
+sharkd_session_packet_load_analyse_cb(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _U_, const void *data _U_)
+{
+	struct sharkd_load_analyse *analyse = (struct sharkd_load_analyse *) tapdata;
+
+	if (!analyse->have_time || nstime_cmp(&pinfo->abs_ts, &analyse->first_time) < 0)
+		analyse->first_time = pinfo->abs_ts;
+
+	if (!analyse->have_time || nstime_cmp(&pinfo->abs_ts, &analyse->last_time) > 0)
+		analyse->last_time = pinfo->abs_ts;
+
+	analyse->have_time = TRUE;
+
+	if (pinfo->layers)
+	{
+		wmem_list_frame_t *frame;
+
+		for (frame = wmem_list_head(pinfo->layers); frame; frame = wmem_list_frame_next(frame))
+		{
+			int proto_id = GPOINTER_TO_UINT(wmem_list_frame_data(frame));
+
+			if (!g_hash_table_lookup_extended(analyse->protocols_set, GUINT_TO_POINTER(proto_id), NULL, NULL))
+			{
+				g_hash_table_insert(analyse->protocols_set, GUINT_TO_POINTER(proto_id), GUINT_TO_POINTER(proto_id));
+				g_array_append_val(analyse->protocols, proto_id);
+			}
+		}
+	}
+
+	return TAP_PACKET_DONT_REDRAW;
+}
+
+static void
+sharkd_session_load_taps_free(void)
+{
+	if (load_taps)
+	{
+		sharkd_session_tap_request_free(load_taps);
+		load_taps = NULL;
+	}
+
+	if (load_analyse)
+	{
+		if (load_analyse->protocols_set)
+		{
+			remove_tap_listener(load_analyse);
+			g_hash_table_destroy(load_analyse->protocols_set);
+		}
+		g_array_free(load_analyse->protocols, TRUE);
+		g_free(load_analyse);
+		load_analyse = NULL;
+	}
+}
+
+/*
+ * Registers the taps asked for by a load request, so that they collect
+ * their statistics while the file is loaded.
+ */
+static gboolean
+sharkd_session_load_taps_register(const char *buf, const jsmntok_t *tokens, int count)
+{
+	const char *tok_analyse = json_find_attr(buf, tokens, count, "analyse");
+	GString *tap_error;
+	int len = 0;
+	int i;
+
+	sharkd_session_load_taps_free();
+
+	if (tok_analyse && !strcmp(tok_analyse, "true"))
+	{
+		load_analyse = g_new0(struct sharkd_load_analyse, 1);
+		load_analyse->protocols_set = g_hash_table_new(NULL /* g_direct_hash() */, NULL /* g_direct_equal */);
+		load_analyse->protocols = g_array_new(FALSE, FALSE, sizeof(int));
+
+		tap_error = register_tap_listener("frame", load_analyse, NULL, 0, NULL, sharkd_session_packet_load_analyse_cb, NULL, NULL);
+		if (tap_error)
+		{
+			/* can't happen, "frame" is always there */
+			g_string_free(tap_error, TRUE);
+			g_hash_table_destroy(load_analyse->protocols_set);
+			load_analyse->protocols_set = NULL;
+		}
+	}
+
+	if (!json_find_attr(buf, tokens, count, "tap0"))
+		return TRUE;
+
+	/* The taps keep pointers to their names, keep a copy of the request */
+	for (i = 0; i < count; i++)
+		len = MAX(len, tokens[i].end);
+
+	load_taps = sharkd_session_tap_request_new(rpcid);
+	load_taps->buf = (char *) g_memdup2(buf, len + 1);
+	load_taps->tokens = (jsmntok_t *) g_memdup2(tokens, count * sizeof(*tokens));
+
+	if (!sharkd_session_tap_register(load_taps->buf, load_taps->tokens, count, load_taps))
+	{
+		/* the error response has been sent */
+		sharkd_session_tap_request_free(load_taps);
+		load_taps = NULL;
+		sharkd_session_load_taps_free();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Unregisters the taps of the load request, keeping their results */
+static void
+sharkd_session_load_taps_done(void)
+{
+	int i;
+
+	if (load_taps)
+	{
+		for (i = 0; i < load_taps->taps_count; i++)
+			remove_tap_listener(load_taps->taps_data[i]);
+		load_taps->registered = FALSE;
+	}
+
+	if (load_analyse && load_analyse->protocols_set)
+	{
+		remove_tap_listener(load_analyse);
+		g_hash_table_destroy(load_analyse->protocols_set);
+		load_analyse->protocols_set = NULL;
+	}
+}
+
+static void
+sharkd_session_tap_progress_cb(guint32 framenum, guint32 frames_count, void *data)
+{
+	GPtrArray *batch = (GPtrArray *) data;
+	guint i;
+
+	for (i = 0; i < batch->len; i++)
+	{
+		struct sharkd_tap_request *req = (struct sharkd_tap_request *) g_ptr_array_index(batch, i);
+
+		if (!req->progress)
+			continue;
+
+		/* JSON-RPC notification, no id */
+		json_dumper_begin_object(&dumper);
+		sharkd_json_value_string("jsonrpc", "2.0");
+		sharkd_json_value_string("method", "progress");
+		sharkd_json_value_anyf("params", NULL);
+		json_dumper_begin_object(&dumper);
+		sharkd_json_value_anyf("id", "%u", req->rpcid);
+		sharkd_json_value_anyf("frames", "%u", framenum);
+		sharkd_json_value_anyf("total", "%u", frames_count);
+		json_dumper_end_object(&dumper);
+		json_dumper_end_object(&dumper);
+		sharkd_json_response_close();
+	}
+}
+
+/*
+ * Returns the next request if it's a tap request which has already been
+ * received, so that it can share the rescan of the current one.
+ */
+static char *
+sharkd_session_next_tap_request(void)
+{
+	char *line;
+	jsmntok_t *tokens;
+	int ret, i;
+	gboolean is_tap = FALSE;
+
+	line = sharkd_session_peek_line();
+	if (!line)
+		return NULL;
+
+	ret = json_parse(line, NULL, 0);
+	if (ret > 0)
+	{
+		tokens = g_new0(jsmntok_t, ret);
+		ret = json_parse(line, tokens, ret);
+
+		for (i = 1; i + 1 < ret; i++)
+		{
+			if (tokens[i].type == JSMN_STRING && tokens[i].size == 1 &&
+					tokens[i].end - tokens[i].start == 6 &&
+					!strncmp(line + tokens[i].start, "method", 6))
+			{
+				is_tap = tokens[i + 1].type == JSMN_STRING &&
+					tokens[i + 1].end - tokens[i + 1].start == 3 &&
+					!strncmp(line + tokens[i + 1].start, "tap", 3);
+				break;
+			}
+		}
+		g_free(tokens);
+	}
+
+	if (!is_tap)
+	{
+		g_free(line);
+		return NULL;
+	}
+
+	sharkd_session_consume_line();
+	return line;
+}
+
+/**
+ * sharkd_session_process_tap()
+ *
+ * Process tap request
+ *
+ * Input:
+ *   (m) tap0         - First tap request
+ *   (o) tap1...tap15 - Other tap requests
+ *   (o) progress     - true to get "progress" notifications during the rescan
+ *
+ * Output object with attributes:
+ *   (m) taps  - array of object with attributes:
+ *                  (m) tap  - tap name
+ *                  (m) type - tap output type
+ *                  ...
+ *                  for type:stats see sharkd_session_process_tap_stats_cb()
+ *                  for type:nstat see sharkd_session_process_tap_nstat_cb()
+ *                  for type:conv see sharkd_session_process_tap_conv_cb()
+ *                  for type:host see sharkd_session_process_tap_conv_cb()
+ *                  for type:rtp-streams see sharkd_session_process_tap_rtp_cb()
+ *                  for type:rtp-analyse see sharkd_session_process_tap_rtp_analyse_cb()
+ *                  for type:eo see sharkd_session_process_tap_eo_cb()
+ *                  for type:expert see sharkd_session_process_tap_expert_cb()
+ *                  for type:rtd see sharkd_session_process_tap_rtd_cb()
+ *                  for type:srt see sharkd_session_process_tap_srt_cb()
+ *                  for type:flow see sharkd_session_process_tap_flow_cb()
+ *
+ *   (m) err   - error code
+ *
+ * Tap requests which have already been received when one is processed
+ * share its rescan of the file, and are then answered in order. With
+ * "progress", a notification with the request id, and the frames scanned
+ * so far and total is sent about once a second during the rescan.
+ */
+static void
+sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
+{
+	GPtrArray *batch = g_ptr_array_new();
+	struct sharkd_tap_request *req;
+	const char *tok_progress;
+	char *line;
+	guint i;
+
+	req = sharkd_session_tap_request_new(rpcid);
+	tok_progress = json_find_attr(buf, tokens, count, "progress");
+	req->progress = tok_progress && !strcmp(tok_progress, "true");
+	if (!sharkd_session_tap_register(buf, tokens, count, req))
+	{
+		sharkd_session_tap_request_free(req);
+		g_ptr_array_free(batch, TRUE);
+		return;
+	}
+	g_ptr_array_add(batch, req);
 
-			rtp_req->tap_name = tok_tap;
-			rtp_req->statinfo.first_packet = TRUE;
-			rtp_req->statinfo.reg_pt = PT_UNDEFINED;
+	while ((line = sharkd_session_next_tap_request()) != NULL)
+	{
+		jsmntok_t *line_tokens;
+		int ret;
 
-			tap_error = register_tap_listener("rtp", rtp_req, tap_filter, 0, NULL, sharkd_session_packet_tap_rtp_analyse_cb, sharkd_session_process_tap_rtp_analyse_cb, NULL);
+		ret = json_parse(line, NULL, 0) + 1;
+		line_tokens = g_new0(jsmntok_t, ret);
+		ret = json_parse(line, line_tokens, ret);
 
-			tap_data = rtp_req;
-			tap_free = sharkd_session_process_tap_rtp_free_cb;
-		}
-		else
+		if (!json_prep(line, line_tokens, ret))
 		{
-			sharkd_json_error(
-				rpcid, -11012, NULL,
-				"sharkd_session_process_tap() %s not recognized", tok_tap
-			);
-			return;
+			/* the error response has been sent */
+			g_free(line_tokens);
+			g_free(line);
+			continue;
 		}
 
-		if (tap_error)
+		req = sharkd_session_tap_request_new(rpcid);
+		req->buf = line;
+		req->tokens = line_tokens;
+		tok_progress = json_find_attr(line, line_tokens + 1, ret - 1, "progress");
+		req->progress = tok_progress && !strcmp(tok_progress, "true");
+		if (!sharkd_session_tap_register(line, line_tokens + 1, ret - 1, req))
 		{
-			sharkd_json_error(
-				rpcid, -11013, NULL,
-				"sharkd_session_process_tap() name=%s error=%s", tok_tap, tap_error->str
-			);
-			g_string_free(tap_error, TRUE);
-			if (tap_free)
-				tap_free(tap_data);
-			return;
+			sharkd_session_tap_request_free(req);
+			continue;
 		}
+		g_ptr_array_add(batch, req);
+	}
+
+	fprintf(stderr, "sharkd_session_process_tap() requests=%u\n", batch->len);
 
-		taps_data[taps_count] = tap_data;
-		taps_free[taps_count] = tap_free;
-		taps_count++;
+	/* No retap needed if all taps were collected while loading */
+	for (i = 0; i < batch->len; i++)
+	{
+		req = (struct sharkd_tap_request *) g_ptr_array_index(batch, i);
+		if (req->taps_loaded != (1U << req->taps_count) - 1)
+			break;
 	}
+	if (i < batch->len)
+		sharkd_retap_nodraw(sharkd_session_tap_progress_cb, batch);
 
-	fprintf(stderr, "sharkd_session_process_tap() count=%d\n", taps_count);
-	if (taps_count == 0)
+	for (i = 0; i < batch->len; i++)
 	{
-		sharkd_json_result_prologue(rpcid);
+		int j;
+
+		req = (struct sharkd_tap_request *) g_ptr_array_index(batch, i);
+
+		/* The batch runs within the limits of its first request */
+		if (request_limits.aborted)
+		{
+			sharkd_session_abort_error(req->rpcid);
+			sharkd_session_tap_request_free(req);
+			continue;
+		}
+
+		sharkd_json_result_prologue(req->rpcid);
 		sharkd_json_array_open("taps");
+		/* newest first, the order draw_tap_listeners() used */
+		for (j = req->taps_count - 1; j >= 0; j--)
+		{
+			if (req->taps_loaded & (1 << j))
+				req->taps_draw[j](req->taps_data[j]);
+			else
+				draw_tap_listener(req->taps_data[j]);
+		}
 		sharkd_json_array_close();
 		sharkd_json_result_epilogue();
-		return;
-	}
-
-	sharkd_json_result_prologue(rpcid);
-	sharkd_json_array_open("taps");
-	sharkd_retap();
-	sharkd_json_array_close();
-	sharkd_json_result_epilogue();
 
-	for (i = 0; i < taps_count; i++)
-	{
-		if (taps_data[i])
-			remove_tap_listener(taps_data[i]);
-
-		if (taps_free[i])
-			taps_free[i](taps_data[i]);
+		sharkd_session_tap_request_free(req);
 	}
+
+	g_ptr_array_free(batch, TRUE);
 }
 
 /**
@@ -3187,6 +4873,7 @@ sharkd_session_process_follow(char *buf, const jsmntok_t *tokens, int count)
 	GString *tap_error;
 
 	follow_info_t *follow_info;
+	const frame_list_t *stream_frames;
 	const char *host;
 	char *port;
 
@@ -3216,7 +4903,12 @@ sharkd_session_process_follow(char *buf, const jsmntok_t *tokens, int count)
 		return;
 	}
 
-	sharkd_retap();
+	/* "tcp.stream eq N" and the like only match the stream's frames */
+	stream_frames = frame_list_for_filter(tok_filter);
+	if (stream_frames)
+		sharkd_retap_frames(stream_frames);
+	else
+		sharkd_retap();
 
 	sharkd_json_result_prologue(rpcid);
 
@@ -3376,6 +5068,7 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 		}
 
 		json_dumper_end_object(&dumper);
+		sharkd_json_stream();
 	}
 	sharkd_json_array_close();
 }
@@ -3587,28 +5280,25 @@ struct sharkd_iograph
 	guint32 interval;
 
 	/* result */
+	gboolean tapped;   /* FALSE if filled by sharkd_iograph_from_frames() */
 	int space_items;
 	int num_items;
 	io_graph_item_t *items;
 	GString *error;
 };
 
-static tap_packet_status
-sharkd_iograph_packet(void *g, packet_info *pinfo, epan_dissect_t *edt, const void *dummy _U_)
+/* Makes sure graph->items has an item for idx, returns FALSE if out of range */
+static gboolean
+sharkd_iograph_grow(struct sharkd_iograph *graph, gint64 idx)
 {
-	struct sharkd_iograph *graph = (struct sharkd_iograph *) g;
-	int idx;
-	gboolean update_succeeded;
-
-	idx = get_io_graph_index(pinfo, graph->interval);
 	if (idx < 0 || idx >= SHARKD_IOGRAPH_MAX_ITEMS)
-		return TAP_PACKET_DONT_REDRAW;
+		return FALSE;
 
 	if (idx + 1 > graph->num_items)
 	{
 		if (idx + 1 > graph->space_items)
 		{
-			int new_size = idx + 1024;
+			int new_size = (int) idx + 1024;
 
 			graph->items = (io_graph_item_t *) g_realloc(graph->items, sizeof(io_graph_item_t) * new_size);
 			reset_io_graph_items(&graph->items[graph->space_items], new_size - graph->space_items);
@@ -3621,14 +5311,87 @@ sharkd_iograph_packet(void *g, packet_info *pinfo, epan_dissect_t *edt, const vo
 			reset_io_graph_items(graph->items, graph->space_items);
 		}
 
-		graph->num_items = idx + 1;
+		graph->num_items = (int) idx + 1;
 	}
 
+	return TRUE;
+}
+
+static tap_packet_status
+sharkd_iograph_packet(void *g, packet_info *pinfo, epan_dissect_t *edt, const void *dummy _U_)
+{
+	struct sharkd_iograph *graph = (struct sharkd_iograph *) g;
+	int idx;
+	gboolean update_succeeded;
+
+	idx = get_io_graph_index(pinfo, graph->interval);
+	if (!sharkd_iograph_grow(graph, idx))
+		return TAP_PACKET_DONT_REDRAW;
+
 	update_succeeded = update_io_graph_item(graph->items, idx, pinfo, edt, graph->hf_index, graph->calc_type, graph->interval);
 	/* XXX - TAP_PACKET_FAILED if the item couldn't be updated, with an error message? */
 	return update_succeeded ? TAP_PACKET_REDRAW : TAP_PACKET_DONT_REDRAW;
 }
 
+/*
+ * Fills a packets, bytes or bits graph without dissecting, from the time
+ * index or the frame data and the filter results (NULL for all frames).
+ */
+static void
+sharkd_iograph_from_frames(struct sharkd_iograph *graph, const guint8 *filter_data)
+{
+	const nstime_t *start_ts;
+	const GArray *level = NULL;
+	guint32 res;
+
+	if (cfile.count == 0)
+		return;
+
+	if (!filter_data)
+		level = sharkd_session_time_index_level(graph->interval, &res);
+
+	if (level)
+	{
+		for (guint i = 0; i < level->len; i++)
+		{
+			const struct sharkd_time_bucket *bucket = &g_array_index(level, struct sharkd_time_bucket, i);
+			gint64 idx = bucket->idx * res / graph->interval;
+
+			/* buckets are in time order */
+			if (!sharkd_iograph_grow(graph, idx))
+				break;
+
+			graph->items[idx].frames += bucket->frames;
+			graph->items[idx].bytes  += bucket->bytes;
+		}
+		return;
+	}
+
+	start_ts = &(sharkd_get_frame(1)->abs_ts);
+
+	for (guint32 framenum = 1; framenum <= cfile.count; framenum++)
+	{
+		const frame_data *fdata;
+		io_graph_item_t *item;
+		gint64 msec;
+
+		if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
+			continue;
+
+		fdata = sharkd_get_frame(framenum);
+		msec = sharkd_rel_msec(&fdata->abs_ts, start_ts);
+		if (msec < 0 || !sharkd_iograph_grow(graph, msec / graph->interval))
+			continue;
+
+		item = &graph->items[msec / graph->interval];
+		if (item->first_frame_in_invl == 0)
+			item->first_frame_in_invl = framenum;
+		item->last_frame_in_invl = framenum;
+		item->frames += 1;
+		item->bytes  += fdata->pkt_len;
+	}
+}
+
 /**
  * sharkd_session_process_iograph()
  *
@@ -3715,9 +5478,33 @@ sharkd_session_process_iograph(char *buf, const jsmntok_t *tokens, int count)
 		graph->space_items = 0; /* TODO, can avoid realloc()s in sharkd_iograph_packet() by calculating: capture_time / interval */
 		graph->num_items = 0;
 		graph->items = NULL;
+		graph->tapped = FALSE;
+
+		if (!graph->error && graph->calc_type < IOG_ITEM_UNIT_CALC_SUM)
+		{
+			const struct sharkd_filter_item *filter_item = NULL;
+
+			/*
+			 * No fields needed, so no dissection either. The filter results
+			 * can be dropped by the next graph's filter, use them right away.
+			 * An invalid filter goes to the tap, which reports the error.
+			 */
+			if (tok_filter && *tok_filter)
+				filter_item = sharkd_session_filter_data(tok_filter);
+
+			if (!(tok_filter && *tok_filter) || filter_item)
+			{
+				sharkd_iograph_from_frames(graph, filter_item ? filter_item->filtered : NULL);
+				graph_count++;
+				continue;
+			}
+		}
 
 		if (!graph->error)
+		{
 			graph->error = register_tap_listener("frame", graph, tok_filter, TL_REQUIRES_PROTO_TREE, NULL, sharkd_iograph_packet, NULL, NULL);
+			graph->tapped = (graph->error == NULL);
+		}
 
 		graph_count++;
 
@@ -3728,6 +5515,12 @@ sharkd_session_process_iograph(char *buf, const jsmntok_t *tokens, int count)
 				"%s", graph->error->str
 			);
 			g_string_free(graph->error, TRUE);
+			for (i = 0; i < graph_count - 1; i++)
+			{
+				if (graphs[i].tapped)
+					remove_tap_listener(&graphs[i]);
+				g_free(graphs[i].items);
+			}
 			return;
 		}
 
@@ -3781,7 +5574,8 @@ sharkd_session_process_iograph(char *buf, const jsmntok_t *tokens, int count)
 		}
 		json_dumper_end_object(&dumper);
 
-		remove_tap_listener(graph);
+		if (graph->tapped)
+			remove_tap_listener(graph);
 		g_free(graph->items);
 	}
 	sharkd_json_array_close();
@@ -3825,6 +5619,9 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 	} st, st_total;
 
 	nstime_t *start_ts;
+	const GArray *level = NULL;
+	guint32 res = 1;
+	guint32 steps;
 
 	guint32 interval_ms = 1000; /* default: one per second */
 
@@ -3861,21 +5658,44 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 	sharkd_json_result_prologue(rpcid);
 	sharkd_json_array_open("intervals");
 
+	if (!filter_data)
+		level = sharkd_session_time_index_level(interval_ms, &res);
+
 	start_ts = (cfile.count >= 1) ? &(sharkd_get_frame(1)->abs_ts) : NULL;
 
-	for (guint32 framenum = 1; framenum <= cfile.count; framenum++)
+	/* With the time index, each step adds up a bucket instead of a frame */
+	steps = level ? level->len : cfile.count;
+
+	for (guint32 step = 0; step < steps; step++)
 	{
-		frame_data *fdata;
-		gint64 msec_rel;
 		gint64 new_idx;
+		guint32 frames;
+		guint64 bytes;
 
-		if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
-			continue;
+		if (level)
+		{
+			const struct sharkd_time_bucket *bucket = &g_array_index(level, struct sharkd_time_bucket, step);
 
-		fdata = sharkd_get_frame(framenum);
+			new_idx = bucket->idx * res / interval_ms;
+			frames  = bucket->frames;
+			bytes   = bucket->bytes;
+		}
+		else
+		{
+			guint32 framenum = step + 1;
+			frame_data *fdata;
+			gint64 msec_rel;
 
-		msec_rel = (fdata->abs_ts.secs - start_ts->secs) * (gint64) 1000 + (fdata->abs_ts.nsecs - start_ts->nsecs) / 1000000;
-		new_idx  = msec_rel / interval_ms;
+			if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
+				continue;
+
+			fdata = sharkd_get_frame(framenum);
+
+			msec_rel = sharkd_rel_msec(&fdata->abs_ts, start_ts);
+			new_idx  = msec_rel / interval_ms;
+			frames   = 1;
+			bytes    = fdata->pkt_len;
+		}
 
 		if (idx != new_idx)
 		{
@@ -3892,11 +5712,11 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 			st.bytes  = 0;
 		}
 
-		st.frames += 1;
-		st.bytes  += fdata->pkt_len;
+		st.frames += frames;
+		st.bytes  += bytes;
 
-		st_total.frames += 1;
-		st_total.bytes  += fdata->pkt_len;
+		st_total.frames += frames;
+		st_total.bytes  += bytes;
 	}
 
 	if (st.frames != 0)
@@ -4072,25 +5892,23 @@ sharkd_session_process_check(char *buf, const jsmntok_t *tokens, int count)
 
 	if (tok_filter != NULL)
 	{
-		char *err_msg = NULL;
-		dfilter_t *dfp;
+		/* Kept compiled for the frames or iograph request that likely follows */
+		const struct sharkd_dfilter_item *d = sharkd_session_dfilter_get(tok_filter);
 
-		if (dfilter_compile(tok_filter, &dfp, &err_msg))
+		if (d->valid)
 		{
-			if (dfp && dfilter_deprecated_tokens(dfp))
-				sharkd_json_warning(rpcid, err_msg);
+			if (d->dfcode && dfilter_deprecated_tokens(d->dfcode))
+				sharkd_json_warning(rpcid, d->err_msg);
 			else
 				sharkd_json_simple_ok(rpcid);
 
-			dfilter_free(dfp);
-			g_free(err_msg);
 			return 0;
 		}
 		else
 		{
 			sharkd_json_error(
 				rpcid, -5001, NULL,
-				"Filter invalid - %s", err_msg
+				"Filter invalid - %s", d->err_msg
 			);
 			return -5001;
 		}
@@ -4188,63 +6006,38 @@ sharkd_session_process_complete(char *buf, const jsmntok_t *tokens, int count)
 
 	if (tok_field != NULL && tok_field[0])
 	{
-		const size_t filter_length = strlen(tok_field);
 		const int filter_with_dot = !!strchr(tok_field, '.');
 
-		void *proto_cookie;
-		void *field_cookie;
-		int proto_id;
+		header_field_info * const *matches;
+		guint match_count;
+		guint i;
 
 		sharkd_json_array_open("field");
 
-		for (proto_id = proto_get_first_protocol(&proto_cookie); proto_id != -1; proto_id = proto_get_next_protocol(&proto_cookie))
+		matches = proto_registrar_get_byprefix(tok_field, &match_count);
+		for (i = 0; i < match_count; i++)
 		{
-			protocol_t *protocol = find_protocol_by_id(proto_id);
-			const char *protocol_filter;
-			const char *protocol_name;
-			header_field_info *hfinfo;
+			header_field_info *hfinfo = matches[i];
+			gboolean is_protocol = (hfinfo->parent == -1);
 
-			if (!proto_is_protocol_enabled(protocol))
+			if (!is_protocol && !filter_with_dot)
 				continue;
 
-			protocol_name   = proto_get_protocol_long_name(protocol);
-			protocol_filter = proto_get_protocol_filter_name(proto_id);
-
-			if (strlen(protocol_filter) >= filter_length && !g_ascii_strncasecmp(tok_field, protocol_filter, filter_length))
-			{
-				json_dumper_begin_object(&dumper);
-				{
-					sharkd_json_value_string("f", protocol_filter);
-					sharkd_json_value_anyf("t", "%d", FT_PROTOCOL);
-					sharkd_json_value_string("n", protocol_name);
-				}
-				json_dumper_end_object(&dumper);
-			}
-
-			if (!filter_with_dot)
+			if (!proto_is_protocol_enabled(find_protocol_by_id(is_protocol ? hfinfo->id : hfinfo->parent)))
 				continue;
 
-			for (hfinfo = proto_get_first_protocol_field(proto_id, &field_cookie); hfinfo != NULL; hfinfo = proto_get_next_protocol_field(proto_id, &field_cookie))
+			json_dumper_begin_object(&dumper);
 			{
-				if (hfinfo->same_name_prev_id != -1) /* ignore duplicate names */
-					continue;
+				sharkd_json_value_string("f", hfinfo->abbrev);
 
-				if (strlen(hfinfo->abbrev) >= filter_length && !g_ascii_strncasecmp(tok_field, hfinfo->abbrev, filter_length))
+				/* XXX, skip displaying name, if there are multiple (to not confuse user) */
+				if (hfinfo->same_name_next == NULL)
 				{
-					json_dumper_begin_object(&dumper);
-					{
-						sharkd_json_value_string("f", hfinfo->abbrev);
-
-						/* XXX, skip displaying name, if there are multiple (to not confuse user) */
-						if (hfinfo->same_name_next == NULL)
-						{
-							sharkd_json_value_anyf("t", "%d", hfinfo->type);
-							sharkd_json_value_string("n", hfinfo->name);
-						}
-					}
-					json_dumper_end_object(&dumper);
+					sharkd_json_value_anyf("t", "%d", hfinfo->type);
+					sharkd_json_value_string("n", hfinfo->name);
 				}
 			}
+			json_dumper_end_object(&dumper);
 		}
 
 		sharkd_json_array_close();
@@ -4394,6 +6187,10 @@ sharkd_session_process_setconf(char *buf, const jsmntok_t *tokens, int count)
 	switch (ret)
 	{
 	case PREFS_SET_OK:
+		/* Preferences can change how any column is shown, and the dissected values */
+		sharkd_session_column_cache_clear();
+		g_hash_table_remove_all(dfilter_table);
+		sharkd_hot_fields_reset();
 		sharkd_json_simple_ok(rpcid);
 		break;
 
@@ -4788,6 +6585,7 @@ sharkd_rtp_download_decode(struct sharkd_download_rtp *req)
 
 		/* Write the decoded, possibly-resampled audio */
 		json_dumper_write_base64(&dumper, write_buff, write_bytes);
+		sharkd_json_stream();
 
 		g_free(decode_buff);
 	}
@@ -4822,13 +6620,66 @@ sharkd_session_packet_download_tap_rtp_cb(void *tapdata, packet_info *pinfo, epa
 		rtp_packet->frame_num = pinfo->num;
 		rtp_packet->arrive_offset = nstime_to_sec(&pinfo->abs_ts) - req_rtp->start_time;
 
-		/* XXX, O(n) optimize */
-		req_rtp->packets = g_slist_append(req_rtp->packets, rtp_packet);
+		/* reversed in sharkd_session_process_download() */
+		req_rtp->packets = g_slist_prepend(req_rtp->packets, rtp_packet);
 	}
 
 	return TAP_PACKET_DONT_REDRAW;
 }
 
+/**
+ * sharkd_session_process_subscriber()
+ *
+ * Process subscriber request
+ *
+ * Input:
+ *   (m) imsi - IMSI of the subscriber to follow
+ *
+ * Output object with attributes:
+ *   (m) frames - array of frame numbers belonging to the subscriber's GTP sessions
+ *
+ * Note:
+ *   Answered from the index built by the GTP dissectors during the first pass,
+ *   which requires the gtp.track_gtp_session preference to be set before the
+ *   file is loaded.
+ */
+static void
+sharkd_session_process_subscriber(char *buf, const jsmntok_t *tokens, int count)
+{
+	const char *tok_imsi = json_find_attr(buf, tokens, count, "imsi");
+	pref_t *tracking = prefs_find_preference(prefs_find_module("gtp"), "track_gtp_session");
+	wmem_array_t *frames;
+	guint i;
+
+	if (!tracking || !prefs_get_bool_value(tracking, pref_current))
+	{
+		sharkd_json_error(
+			rpcid, -16001, NULL,
+			"GTP session tracking is disabled"
+		);
+		return;
+	}
+
+	frames = gtp_subscriber_frames(NULL, tok_imsi);
+	if (!frames)
+	{
+		sharkd_json_error(
+			rpcid, -16002, NULL,
+			"No sessions found for subscriber %s", tok_imsi
+		);
+		return;
+	}
+
+	sharkd_json_result_prologue(rpcid);
+	sharkd_json_array_open("frames");
+	for (i = 0; i < wmem_array_get_count(frames); i++)
+		sharkd_json_value_anyf(NULL, "%u", *(guint32 *)wmem_array_index(frames, i));
+	sharkd_json_array_close();
+	sharkd_json_result_epilogue();
+
+	wmem_destroy_array(frames);
+}
+
 /**
  * sharkd_session_process_download()
  *
@@ -4934,6 +6785,7 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 
 		sharkd_retap();
 		remove_tap_listener(&rtp_req);
+		rtp_req.packets = g_slist_reverse(rtp_req.packets);
 
 		if (rtp_req.packets)
 		{
@@ -4956,6 +6808,89 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 	}
 }
 
+/**
+ * sharkd_session_process_transport()
+ *
+ * Process transport request
+ *
+ * Input:
+ *   (m) encoding - "json" for line separated JSON (default),
+ *                  "cbor" for length prefixed CBOR frames
+ *   (o) compress - if true, large "cbor" frames are zstd compressed
+ *   (o) stream   - if true, large "cbor" messages are sent in several
+ *                  frames while they are produced
+ *
+ * Output object with attributes:
+ *   (m) status - "OK", sent with the previous encoding
+ *
+ * Note:
+ *   Requests are still read as line separated JSON. In CBOR responses
+ *   "bytes" and other binary data are raw byte strings, not base64.
+ */
+static void
+sharkd_session_process_transport(char *buf, const jsmntok_t *tokens, int count)
+{
+	const char *tok_encoding = json_find_attr(buf, tokens, count, "encoding");
+	const char *tok_compress = json_find_attr(buf, tokens, count, "compress");
+	const char *tok_stream   = json_find_attr(buf, tokens, count, "stream");
+	gboolean use_cbor;
+	gboolean compress = tok_compress && !strcmp(tok_compress, "true");
+	gboolean stream = tok_stream && !strcmp(tok_stream, "true");
+
+	if (!strcmp(tok_encoding, "json"))
+		use_cbor = FALSE;
+	else if (!strcmp(tok_encoding, "cbor"))
+		use_cbor = TRUE;
+	else
+	{
+		sharkd_json_error(
+			rpcid, -14001, NULL,
+			"Unknown encoding: %s", tok_encoding
+		);
+		return;
+	}
+
+	if (compress)
+	{
+#ifdef HAVE_ZSTD
+		if (!use_cbor)
+		{
+			sharkd_json_error(
+				rpcid, -14002, NULL,
+				"Compression requires the cbor encoding"
+			);
+			return;
+		}
+#else
+		sharkd_json_error(
+			rpcid, -14003, NULL,
+			"zstd compression is not supported"
+		);
+		return;
+#endif
+	}
+
+	sharkd_json_simple_ok(rpcid);
+
+	if (use_cbor)
+	{
+		dumper.flags |= JSON_DUMPER_FLAGS_CBOR;
+		if (!dumper.output_string)
+			dumper.output_string = g_string_sized_new(64 * 1024);
+	}
+	else
+	{
+		dumper.flags &= ~JSON_DUMPER_FLAGS_CBOR;
+		if (dumper.output_string)
+		{
+			g_string_free(dumper.output_string, TRUE);
+			dumper.output_string = NULL;
+		}
+	}
+	transport_compress = compress;
+	transport_stream = stream;
+}
+
 static void
 sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 {
@@ -4973,6 +6908,11 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 				"No method found");
 			return;
 		}
+
+		sharkd_session_limits_start(
+			json_find_attr(buf, tokens, count, "timeout"),
+			json_find_attr(buf, tokens, count, "max_memory"));
+
 		if (!strcmp(tok_method, "load"))
 			sharkd_session_process_load(buf, tokens, count);
 		else if (!strcmp(tok_method, "status"))
@@ -5005,6 +6945,18 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 			sharkd_session_process_dumpconf(buf, tokens, count);
 		else if (!strcmp(tok_method, "download"))
 			sharkd_session_process_download(buf, tokens, count);
+		else if (!strcmp(tok_method, "subscriber"))
+			sharkd_session_process_subscriber(buf, tokens, count);
+		else if (!strcmp(tok_method, "transport"))
+			sharkd_session_process_transport(buf, tokens, count);
+		else if (!strcmp(tok_method, "cancel"))
+		{
+			/* Cancel requests are taken from the input while the request runs */
+			sharkd_json_error(
+				rpcid, -15004, NULL,
+				"No request to cancel"
+			);
+		}
 		else if (!strcmp(tok_method, "bye"))
 		{
 			sharkd_json_simple_ok(rpcid);
@@ -5017,13 +6969,15 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 				"The method \"%s\" is unknown", tok_method
 			);
 		}
+
+		sharkd_session_limits_done();
 	}
 }
 
 int
 sharkd_session_main(int mode_setting)
 {
-	char buf[2 * 1024];
+	char buf[SHARKD_INPUT_LINE_MAX];
 	jsmntok_t *tokens = NULL;
 	int tokens_max = -1;
 
@@ -5034,13 +6988,14 @@ sharkd_session_main(int mode_setting)
 	dumper.output_file = stdout;
 
 	filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sharkd_session_filter_free);
+	dfilter_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sharkd_session_dfilter_free);
 
 #ifdef HAVE_MAXMINDDB
 	/* mmdbresolve was stopped before fork(), force starting it */
 	uat_get_table_by_name("MaxMind Database Paths")->post_update_cb();
 #endif
 
-	while (fgets(buf, sizeof(buf), stdin))
+	while (sharkd_session_read_line(buf))
 	{
 		/* every command is line seperated JSON */
 		int ret;
@@ -5076,12 +7031,22 @@ sharkd_session_main(int mode_setting)
 			continue;
 		}
 
-		host_name_lookup_process();
+		/* Newly resolved names change the address columns */
+		if (host_name_lookup_process())
+			sharkd_session_column_cache_clear();
 
 		sharkd_session_process(buf, tokens, ret);
 	}
 
 	g_hash_table_destroy(filter_table);
+	g_hash_table_destroy(dfilter_table);
+	sharkd_session_column_cache_clear();
+	if (column_cache.rows)
+	{
+		g_hash_table_destroy(column_cache.rows);
+		g_string_chunk_free(column_cache.strings);
+	}
+	g_free(column_cache.columns);
 	g_free(tokens);
 
 	return 0;
@@ -54,7 +54,7 @@ end
 --     number of verifyFields() * (1 + number of fields) +
 --     number of verifyResults() * (1 + 2 * number of values)
 --
-local taptests = { [FRAME]=4, [OTHER]=413 }
+local taptests = { [FRAME]=4, [OTHER]=419 }
 
 local function getResults()
     print("\n-----------------------------\n")
@@ -1017,6 +1017,26 @@ function test_proto.dissector(tvbuf,pktinfo,root)
     execute ("tvbrange_offset_len_raw_offset_len", range_raw == expected,
         string.format('range_raw="%s" expected="%s"', range_raw, expected))
 
+----------------------------------------
+    testing(OTHER, "Tvb direct reads")
+
+    local values
+
+    execute ("tvb_uint", bytestvb1:uint(0, 4) == 0xdeadbeef)
+    execute ("tvb_uint_default_len", bytestvb1:uint(4) == 0x01)
+    execute ("tvb_le_uint", bytestvb1:le_uint(0, 2) == 0xadde)
+
+    values = bytestvb1:uints(0, 2, 4)
+    execute ("tvb_uints", #values == 4 and values[1] == 0xdead and values[2] == 0xbeef and
+        values[3] == 0x0123 and values[4] == 0x4567)
+
+    local reused = { 0, 0, 0, 42 }
+    values = bytestvb1:le_uints(1, 1, 3, reused)
+    execute ("tvb_le_uints_reuse", values == reused and reused[1] == 0xad and reused[3] == 0xef and
+        reused[4] == 42)
+
+    execute ("tvb_uint_out_of_bounds", not pcall(bytestvb1.uint, bytestvb1, 15, 2))
+
 ----------------------------------------
 
     setPassed(FRAME)
@@ -90,3 +90,27 @@ class case_membership(unittest.TestCase):
     def test_membership_12_value_string(self, checkDFilterCount):
         dfilter = 'tcp.checksum.status in {"Unverified", "Good"}'
         checkDFilterCount(dfilter, 1)
+
+    def test_membership_13_many_values(self, checkDFilterCount):
+        dfilter = 'tcp.port in {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 3267, 11, 12}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_14_many_values_no_match(self, checkDFilterCount):
+        dfilter = 'tcp.port in {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_15_overlapping_ranges(self, checkDFilterCount):
+        dfilter = 'tcp.port in {70 .. 79, 75 .. 80, 80, 1 .. 2}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_16_empty_range(self, checkDFilterCount):
+        dfilter = 'tcp.port in {81 .. 79, 1, 2}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_17_ip_subnet_and_hosts(self, checkDFilterCount):
+        dfilter = 'ip.addr in {10.0.0.0/24, 192.0.2.1, 192.0.2.2}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_18_strings(self, checkDFilterCount):
+        dfilter = 'http.request.method in {"PUT", "POST", "GET", "DELETE"}'
+        checkDFilterCount(dfilter, 1)
@@ -136,6 +136,18 @@ class case_string(unittest.TestCase):
         dfilter = 'http.request.method contains 48:45:41:44' # "48:45:41:44"
         checkDFilterCount(dfilter, 0)
 
+    def test_contains_any_1(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "POST" || http.request.method contains "EA"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_any_2(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "POST" || http.request.method contains "GET" || http.request.method contains ""'
+        checkDFilterCount(dfilter, 0)
+
+    def test_contains_any_3(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "HEX" || tcp.port == 1 || http.request.method contains "AD"'
+        checkDFilterCount(dfilter, 1)
+
     def test_contains_fail_0(self, checkDFilterCount):
         dfilter = 'http.user_agent contains "update"'
         checkDFilterCount(dfilter, 0)
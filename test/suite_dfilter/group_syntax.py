@@ -108,6 +108,43 @@ class case_syntax(unittest.TestCase):
         dfilter = "'H' == frame[54]"
         checkDFilterCount(dfilter, 1)
 
+    def test_optimize_not_not(self, checkDFilterCount):
+        dfilter = "!!tcp"
+        checkDFilterCount(dfilter, 1)
+
+    def test_optimize_duplicate_1(self, checkDFilterCount):
+        dfilter = "tcp && ip && tcp"
+        checkDFilterCount(dfilter, 1)
+
+    def test_optimize_duplicate_2(self, checkDFilterCount):
+        dfilter = "ip.addr == 10.0.0.5 || udp || ip.addr == 10.0.0.5"
+        checkDFilterCount(dfilter, 1)
+
+    def test_optimize_exists_1(self, checkDFilterCount):
+        dfilter = "ip.proto && ip.proto == 6"
+        checkDFilterCount(dfilter, 1)
+
+    def test_optimize_exists_2(self, checkDFilterCount):
+        dfilter = "ip.proto == 17 || ip.proto"
+        checkDFilterCount(dfilter, 1)
+
+    def test_optimize_exists_3(self, checkDFilterCount):
+        dfilter = "ip.proto == 17 && ip.proto"
+        checkDFilterCount(dfilter, 0)
+
+    def test_optimize_reorder(self, checkDFilterCount):
+        dfilter = 'frame contains "HTTP" && !(udp || !tcp) && ip'
+        checkDFilterCount(dfilter, 1)
+
+    def test_optimize_unoptimized(self, cmd_dftest, base_env):
+        proc = subprocess.Popen([cmd_dftest, '-u', 'tcp && tcp'],
+            stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+            universal_newlines=True, env=base_env)
+        outs, errs = proc.communicate()
+        self.assertEqual(proc.returncode, 0)
+        self.assertIn('Unoptimized:', outs)
+        self.assertIn('Optimized:', outs)
+
 @fixtures.uses_fixtures
 class case_equality(unittest.TestCase):
     trace_file = "sip.pcapng"
@@ -251,6 +251,54 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             }},
         ))
 
+    def test_sharkd_req_load_taps(self, check_sharkd_session, capture_file):
+        # Taps and analyse collected while loading give the same results
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "tap0": "conv:Ethernet", "analyse": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"analyse"},
+            {"jsonrpc":"2.0", "id":3, "method":"tap", "params":{"tap0": "conv:Ethernet"}},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"frames": 4, "protocols": ["frame", "eth", "ethertype", "ip", "udp",
+                                        "dhcp"], "first": 1102274184.317452908, "last": 1102274184.387798071}},
+            {"jsonrpc":"2.0","id":3,"result":{
+                "taps": [
+                    {
+                        "tap": "conv:Ethernet",
+                        "type": "conv",
+                        "proto": "Ethernet",
+                        "geoip": MatchAny(bool),
+                        "convs": [
+                            {
+                                "saddr": MatchAny(str),
+                                "daddr": "Broadcast",
+                                "txf": 2,
+                                "txb": 628,
+                                "rxf": 0,
+                                "rxb": 0,
+                                "start": 0,
+                                "stop": 0.070031,
+                                "filter": "eth.addr==00:0b:82:01:fc:42 && eth.addr==ff:ff:ff:ff:ff:ff",
+                            },
+                            {
+                                "saddr": MatchAny(str),
+                                "daddr": MatchAny(str),
+                                "rxf": 0,
+                                "rxb": 0,
+                                "txf": 2,
+                                "txb": 684,
+                                "start": 0.000295,
+                                "stop": 0.070345,
+                                "filter": "eth.addr==00:08:74:ad:f1:9b && eth.addr==00:0b:82:01:fc:42",
+                            }
+                        ],
+                    },
+                ]
+            }},
+        ))
+
     def test_sharkd_req_follow_bad(self, check_sharkd_session, capture_file):
         # Unrecognized taps currently produce no output (not even err).
         check_sharkd_session((
@@ -344,6 +392,24 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             {"jsonrpc":"2.0","id":3,"error":{"code":-6001,"message":"Filter \"garbage filter\" is invalid - \"filter\" was unexpected in this context."}},
         ))
 
+    def test_sharkd_req_iograph_no_dissection(self, check_sharkd_session, capture_file):
+        # packets/bytes/bits graphs are computed from the frame data
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"iograph",
+            "params":{"graph0": "packets", "filter0": "frame.number <= 2", "graph1": "bits"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"iograph",
+            "params":{"interval": 10, "graph0": "packets"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"iograph": [{"items": [2.000000]}, {"items": [10496.000000]}]}},
+            {"jsonrpc":"2.0","id":3,"result":{"iograph": [{"items": [2.000000, "7", 2.000000]}]}},
+        ))
+
     def test_sharkd_req_intervals_bad(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -376,6 +442,41 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             {"jsonrpc":"2.0","id":4,"result":{"intervals":[[0,2,656]],"last":0,"frames":2,"bytes":656}},
         ))
 
+    def test_sharkd_req_intervals_hot_fields(self, check_sharkd_session, capture_file):
+        # The filters only use hot fields and are evaluated without dissecting.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "hot_fields": "frame.number, udp.srcport ip"}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"intervals",
+            "params":{"filter": "frame.number <= 2"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"intervals",
+            "params":{"filter": "ip && udp.srcport == 68"}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"intervals",
+            "params":{"filter": "udp.dstport == 68"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"intervals":[[0,2,656]],"last":0,"frames":2,"bytes":656}},
+            {"jsonrpc":"2.0","id":3,"result":{"intervals":[[0,2,628]],"last":0,"frames":2,"bytes":628}},
+            {"jsonrpc":"2.0","id":4,"result":{"intervals":[[0,2,684]],"last":0,"frames":2,"bytes":684}},
+        ))
+
+    def test_sharkd_req_load_hot_fields_bad(self, check_sharkd_session, capture_file):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "hot_fields": "ip.addr garbage.field"}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "hot_fields": "http.host"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"error":{"code":-2002,"message":"Unknown hot field: garbage.field"}},
+            {"jsonrpc":"2.0","id":2,"error":{"code":-2003,"message":"Type of hot field http.host not supported"}},
+        ))
+
     def test_sharkd_req_frame_basic(self, check_sharkd_session, capture_file):
         # XXX add more tests for other options (ref_frame, prev_frame, columns, color, bytes, hidden)
         check_sharkd_session((
@@ -499,6 +600,47 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
         ))
 
+    def test_sharkd_req_transport_cbor(self, cmd_sharkd):
+        sharkd_commands = (
+            {"jsonrpc":"2.0", "id":1, "method":"transport", "params":{"encoding":"cbor"}},
+            {"jsonrpc":"2.0", "id":2, "method":"bye"},
+        )
+        sharkd_input = '\n'.join(json.dumps(x) for x in sharkd_commands).encode('utf8')
+        sharkd_proc = subprocess.run((cmd_sharkd, '-'), input=sharkd_input,
+            stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        # The reply to the transport request still uses the line JSON encoding.
+        first_line, _, frame = sharkd_proc.stdout.partition(b'\n')
+        self.assertEqual(json.loads(first_line),
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}})
+        # {"jsonrpc":"2.0","id":2,"result":{"status":"OK"}} as CBOR
+        payload = (b'\xbf\x67jsonrpc\x632.0\x62id\x02'
+            b'\x66result\xbf\x66status\x62OK\xff\xff')
+        self.assertEqual(frame, len(payload).to_bytes(4, 'big') + payload)
+
+    def test_sharkd_req_transport_bad(self, check_sharkd_session):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"transport", "params":{"encoding":"xml"}},
+        ), (
+            {"jsonrpc":"2.0","id":1,"error":{"code":-14001,"message":"Unknown encoding: xml"}},
+        ))
+
+    def test_sharkd_req_limits(self, check_sharkd_session, capture_file):
+        # Limits a request stays within are invisible, a cancel request
+        # without a running request is refused.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"intervals", "timeout": 60000, "max_memory": 1024,
+            "params":{"filter": "frame.number <= 2"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"cancel"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"intervals":[[0,2,656]],"last":0,"frames":2,"bytes":656}},
+            {"jsonrpc":"2.0","id":3,"error":{"code":-15004,"message":"No request to cancel"}},
+        ))
+
     def test_sharkd_bad_request(self, check_sharkd_session):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"dud"},
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+'''Run dissection benchmarks and compare them against a baseline.
+
+This times tshark over a corpus of capture files in several output modes,
+and times a set of micro-benchmarks (display filter compilation, the wmem
+performance tests, tvbtest and reassemble_test). Each case is run several
+times and its median wall clock time is recorded.
+
+Results are written as JSON. If a baseline produced by an earlier run is
+given, every case that got slower by more than the threshold is reported
+and the script exits with status 1.
+
+The captures in test/captures are small, so by default they mostly measure
+start-up cost. Pass --corpus with a directory of larger captures (TLS,
+NGAP, 802.11, SMB2, DNS floods, ...) to get representative numbers; every
+capture file found in it is benchmarked.
+
+Usage:
+    run-benchmarks.py --program-path <build>/run [--corpus DIR]
+        [--output results.json] [--baseline baseline.json]
+'''
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import time
+
+# Captures from test/captures that are benchmarked by default.
+default_captures = [
+    'dhcp.pcap',
+    'dns+icmp.pcapng.gz',
+    'http.pcap',
+    'http2-data-reassembly.pcap',
+    'tls-fragmented-handshakes.pcap.gz',
+    'tls12-aes256gcm.pcap',
+    'smb311-lz77-lz77huff-lznt1.pcap.gz',
+    'wpa-Induction.pcap.gz',
+]
+
+capture_extensions = ('.pcap', '.pcapng', '.pcap.gz', '.pcapng.gz', '.cap', '.erf')
+
+# tshark modes. Each is a list of extra arguments.
+tshark_modes = {
+    'summary': [],
+    'fields': ['-T', 'fields', '-e', 'frame.number', '-e', 'ip.src', '-e', 'ip.dst', '-e', '_ws.col.Protocol'],
+    'filter': ['-Y', 'tcp.port == 443 || dns.qry.name contains "example" || http.request'],
+    'verbose': ['-V'],
+    'two-pass': ['-2', '-R', 'frame'],
+}
+
+# Display filters that are compiled by the dftest micro-benchmark.
+dfilter_benchmarks = [
+    'ip.addr == 192.0.2.1',
+    'tcp.port in {80 443 8000..8080} && !(tcp.flags.reset == 1)',
+    'http.request.uri matches "^/api/v[0-9]+/" || dns.qry.name contains "example"',
+    'frame[20:4] == 01:02:03:04 && eth.addr[0:3] == 00:11:22',
+    'len(http.host) > 10 && upper(http.host) contains "EXAMPLE"',
+]
+
+def find_program(program_path, name):
+    exe = os.path.join(program_path, name)
+    if sys.platform.startswith('win32'):
+        exe += '.exe'
+    if os.path.isfile(exe) and os.access(exe, os.X_OK):
+        return exe
+    return None
+
+def time_command(cmd, runs, env):
+    '''Returns the median wall clock time of cmd over runs runs, or None if it failed.'''
+    samples = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, env=env)
+        elapsed = time.perf_counter() - start
+        if proc.returncode != 0:
+            return None
+        samples.append(elapsed)
+    return statistics.median(samples)
+
+def corpus_files(args):
+    files = []
+    capture_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'test', 'captures')
+    if not args.no_default_corpus:
+        for name in default_captures:
+            path = os.path.normpath(os.path.join(capture_dir, name))
+            if os.path.isfile(path):
+                files.append(path)
+    for corpus in args.corpus:
+        for root, _, names in os.walk(corpus):
+            for name in sorted(names):
+                if name.endswith(capture_extensions):
+                    files.append(os.path.join(root, name))
+    return files
+
+def run_benchmarks(args):
+    env = os.environ.copy()
+    # Keep personal preferences from skewing the results.
+    env['WIRESHARK_CONFIG_DIR'] = os.path.join(args.work_dir, 'config')
+    os.makedirs(env['WIRESHARK_CONFIG_DIR'], exist_ok=True)
+    env['WIRESHARK_QUIT_AFTER_CAPTURE'] = '1'
+
+    results = {}
+
+    def record(name, cmd, size=None):
+        if args.match and args.match not in name:
+            return
+        elapsed = time_command(cmd, args.runs, env)
+        if elapsed is None:
+            print('{:<60} FAILED'.format(name))
+            return
+        result = { 'seconds': elapsed }
+        line = '{:<60} {:10.3f} s'.format(name, elapsed)
+        if size:
+            result['mb_per_second'] = size / elapsed / 1e6
+            line += ' {:10.2f} MB/s'.format(result['mb_per_second'])
+        results[name] = result
+        print(line)
+
+    tshark = find_program(args.program_path, 'tshark')
+    if tshark:
+        for capture in corpus_files(args):
+            size = os.path.getsize(capture)
+            for mode, mode_args in tshark_modes.items():
+                cmd = [tshark, '-n', '-r', capture] + mode_args
+                record('tshark/{}/{}'.format(mode, os.path.basename(capture)), cmd, size)
+    else:
+        print('tshark not found in {}; skipping dissection benchmarks.'.format(args.program_path))
+
+    rawshark = find_program(args.program_path, 'rawshark')
+    if rawshark:
+        # rawshark can skip a pcap file header (-s) but can't read
+        # pcapng or compressed files, and it has to be told the
+        # encapsulation, which we assume is Ethernet.
+        for capture in corpus_files(args):
+            if not capture.endswith('.pcap'):
+                continue
+            cmd = [rawshark, '-n', '-s', '-d', 'encap:1', '-F', 'frame.len', '-r', capture]
+            record('rawshark/{}'.format(os.path.basename(capture)), cmd, os.path.getsize(capture))
+
+    dftest = find_program(args.program_path, 'dftest')
+    if dftest:
+        for i, dfilter in enumerate(dfilter_benchmarks):
+            record('micro/dfilter/{}'.format(i), [dftest, dfilter])
+
+    micro = [
+        ('micro/wmem', 'wmem_test', ['-m', 'perf', '-p', '/wmem/utils/stringperf', '-p', '/wmem/datastruct/mapperf']),
+        ('micro/tvb', 'tvbtest', []),
+        ('micro/reassembly', 'reassemble_test', []),
+    ]
+    for name, program, program_args in micro:
+        exe = find_program(args.program_path, program)
+        if exe:
+            record(name, [exe] + program_args)
+
+    return results
+
+def compare(results, baseline, threshold):
+    '''Prints the cases that regressed, and returns how many there were.'''
+    regressions = 0
+    for name, result in sorted(results.items()):
+        if name not in baseline:
+            continue
+        old = baseline[name]['seconds']
+        new = result['seconds']
+        if old <= 0:
+            continue
+        change = (new - old) / old * 100
+        if change > threshold:
+            print('REGRESSION {:<60} {:8.3f} s -> {:8.3f} s ({:+.1f}%)'.format(name, old, new, change))
+            regressions += 1
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description='Run Wireshark dissection benchmarks.')
+    parser.add_argument('-p', '--program-path', default=os.path.join(os.getcwd(), 'run'),
+                        help='Directory containing tshark and the test programs.')
+    parser.add_argument('--corpus', action='append', default=[],
+                        help='Directory of additional captures to benchmark. May be given more than once.')
+    parser.add_argument('--no-default-corpus', action='store_true',
+                        help="Don't benchmark the captures in test/captures.")
+    parser.add_argument('--runs', type=int, default=3,
+                        help='Number of times each case is run. The median is reported.')
+    parser.add_argument('--match', default=None,
+                        help='Only run cases whose name contains this string.')
+    parser.add_argument('--output', default=None,
+                        help='Write the results to this JSON file.')
+    parser.add_argument('--baseline', default=None,
+                        help='Compare against the results in this JSON file.')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='Slowdown, in percent, that counts as a regression.')
+    parser.add_argument('--work-dir', default=os.path.join(os.getcwd(), 'benchmarks'),
+                        help='Directory for temporary files.')
+    args = parser.parse_args()
+
+    os.makedirs(args.work_dir, exist_ok=True)
+    results = run_benchmarks(args)
+
+    if args.output:
+        with open(args.output, 'w') as output_fd:
+            json.dump({
+                'platform': platform.platform(),
+                'runs': args.runs,
+                'results': results,
+            }, output_fd, indent=2, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as baseline_fd:
+            baseline = json.load(baseline_fd)['results']
+        regressions = compare(results, baseline, args.threshold)
+        if regressions:
+            print('{} case(s) regressed by more than {:.0f}%.'.format(regressions, args.threshold))
+            sys.exit(1)
+        print('No regressions.')
+
+if __name__ == '__main__':
+    main()
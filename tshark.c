@@ -76,6 +76,7 @@
 #include "ui/filter_files.h"
 #include "ui/cli/tshark-tap.h"
 #include "ui/cli/tap-exportobject.h"
+#include "ui/cli/tap-pipeline-latency.h"
 #include "ui/tap_export_pdu.h"
 #include "ui/dissect_opts.h"
 #include "ui/ssl_key_export.h"
@@ -135,6 +136,11 @@
 #define LONGOPT_EXPORT_TLS_SESSION_KEYS LONGOPT_BASE_APPLICATION+5
 #define LONGOPT_CAPTURE_COMMENT         LONGOPT_BASE_APPLICATION+6
 #define LONGOPT_HEXDUMP                 LONGOPT_BASE_APPLICATION+7
+#define LONGOPT_EK_BATCH                LONGOPT_BASE_APPLICATION+8
+#define LONGOPT_TAP_INTERVAL            LONGOPT_BASE_APPLICATION+9
+#define LONGOPT_EXPORT_OBJECTS_DEDUP    LONGOPT_BASE_APPLICATION+10
+#define LONGOPT_READ_SNAPLEN            LONGOPT_BASE_APPLICATION+11
+#define LONGOPT_MEMORY_RING             LONGOPT_BASE_APPLICATION+12
 
 capture_file cfile;
 
@@ -157,7 +163,8 @@ typedef enum {
   WRITE_FIELDS,   /* User defined list of fields */
   WRITE_JSON,     /* JSON */
   WRITE_JSON_RAW, /* JSON only raw hex */
-  WRITE_EK        /* JSON bulk insert to Elasticsearch */
+  WRITE_EK,       /* JSON bulk insert to Elasticsearch */
+  WRITE_CBOR      /* User defined list of fields, as typed CBOR */
   /* Add CSV and the like here */
 } output_action_e;
 
@@ -166,8 +173,21 @@ static gboolean do_dissection;     /* TRUE if we have to dissect each packet */
 static gboolean print_packet_info; /* TRUE if we're to print packet information */
 static gboolean print_summary;     /* TRUE if we're to print packet summary information */
 static gboolean print_details;     /* TRUE if we're to print packet details information */
+static gboolean fields_from_values; /* TRUE if -T fields output doesn't need a visible tree */
 static gboolean print_hex;         /* TRUE if we're to print hex/ascii information */
 static gboolean line_buffered;
+static guint ek_batch_size;        /* flush -T ek output every this many packets, 0 if not */
+static guint ek_batch_count;
+static guint tap_interval;         /* live capture: draw -z statistics every this many seconds, 0 if not */
+static guint read_snaplen;         /* read at most this many bytes of each packet from a file, 0 for all */
+#ifdef HAVE_LIBPCAP
+static guint memory_ring_kb;       /* live capture without -w: hand packets over in files of this size in memory */
+#endif
+/* Size of the standard output buffer when not line-buffered */
+#define STDOUT_BUFFER_SIZE (256 * 1024)
+/* How long to wait, in milliseconds, for the host names looked up
+   between the two passes */
+#define HOST_NAME_PREFETCH_TIMEOUT 10000
 static gboolean quiet = FALSE;
 static gboolean really_quiet = FALSE;
 static gchar* delimiter_char = " ";
@@ -212,6 +232,14 @@ static gboolean infodelay;      /* if TRUE, don't print capture info in SIGINFO
 static gboolean infoprint;      /* if TRUE, print capture info after clearing infodelay */
 #endif /* SIGINFO */
 
+/* -z pipeline-latency: when the current packet finished dissection and output */
+static gboolean measure_latency;
+static gint64 latency_dissected_time;
+static gint64 latency_output_time;
+#ifdef SIGUSR1
+static volatile sig_atomic_t latency_print_requested; /* set by SIGUSR1 */
+#endif
+
 static gboolean capture(void);
 static gboolean capture_input_new_file(capture_session *cap_session,
                                        gchar *new_file);
@@ -233,6 +261,9 @@ static void capture_cleanup(int);
 #ifdef SIGINFO
 static void report_counts_siginfo(int);
 #endif /* SIGINFO */
+#ifdef SIGUSR1
+static void report_latency_sigusr1(int);
+#endif /* SIGUSR1 */
 #endif /* _WIN32 */
 #endif /* HAVE_LIBPCAP */
 
@@ -252,6 +283,8 @@ static gboolean process_packet_single_pass(capture_file *cf,
 static void show_print_file_io_error(void);
 static gboolean write_preamble(capture_file *cf);
 static gboolean print_packet(capture_file *cf, epan_dissect_t *edt);
+static gboolean print_packet_locked(capture_file *cf, epan_dissect_t *edt);
+static void ek_batch_done(void);
 static gboolean write_finale(void);
 
 static void tshark_cmdarg_err(const char *msg_format, va_list ap);
@@ -415,6 +448,8 @@ print_usage(FILE *output)
   fprintf(output, "                           enable dissection of heuristic protocol\n");
   fprintf(output, "  --disable-heuristic <short_name>\n");
   fprintf(output, "                           disable dissection of heuristic protocol\n");
+  fprintf(output, "  --worker-threads <count>\n");
+  fprintf(output, "                           threads for parallel work; 0 for one per processor\n");
 
   /*fprintf(output, "\n");*/
   fprintf(output, "Output:\n");
@@ -438,7 +473,7 @@ print_usage(FILE *output)
   fprintf(output, "     delimit               delimit ASCII dump text with '|' characters\n");
   fprintf(output, "     noascii               exclude ASCII dump text\n");
   fprintf(output, "     help                  display help for --hexdump and exit\n");
-  fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|?\n");
+  fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|cbor|?\n");
   fprintf(output, "                           format of text output (def: text)\n");
   fprintf(output, "  -j <protocolfilter>      protocols layers filter if -T ek|pdml|json selected\n");
   fprintf(output, "                           (e.g. \"ip ip.flags text\", filter does not expand child\n");
@@ -471,6 +506,7 @@ print_usage(FILE *output)
   fprintf(output, "  --export-objects <protocol>,<destdir>\n");
   fprintf(output, "                           save exported objects for a protocol to a directory\n");
   fprintf(output, "                           named \"destdir\"\n");
+  fprintf(output, "  --export-objects-dedup   don't save objects whose contents were already saved\n");
   fprintf(output, "  --export-tls-session-keys <keyfile>\n");
   fprintf(output, "                           export TLS Session Keys to a file named \"keyfile\"\n");
   fprintf(output, "  --color                  color output text similarly to the Wireshark GUI,\n");
@@ -482,6 +518,16 @@ print_usage(FILE *output)
   fprintf(output, "                           values\n");
   fprintf(output, "  --elastic-mapping-filter <protocols> If -G elastic-mapping is specified, put only the\n");
   fprintf(output, "                           specified protocols within the mapping file\n");
+  fprintf(output, "  --ek-batch <count>       If -T ek is specified, flush the output after every\n");
+  fprintf(output, "                           <count> packets, as one bulk request body\n");
+  fprintf(output, "  --tap-interval <seconds> when capturing, print the -z statistics every <seconds>\n");
+  fprintf(output, "                           seconds as well as at the end\n");
+  fprintf(output, "  --read-snaplen <bytes>   when reading a file, read only the first <bytes> bytes\n");
+  fprintf(output, "                           of each packet\n");
+#ifdef HAVE_LIBPCAP
+  fprintf(output, "  --memory-ring <kB>       when capturing without -w, pass packets from dumpcap\n");
+  fprintf(output, "                           through <kB>-sized files in memory instead of on disk\n");
+#endif
   fprintf(output, "  --temp-dir <directory>   write temporary files to this directory\n");
   fprintf(output, "                           (default: %s)\n", g_get_tmp_dir());
   fprintf(output, "\n");
@@ -739,12 +785,19 @@ main(int argc, char *argv[])
     LONGOPT_DISSECT_COMMON
     {"print", ws_no_argument, NULL, 'P'},
     {"export-objects", ws_required_argument, NULL, LONGOPT_EXPORT_OBJECTS},
+    {"export-objects-dedup", ws_no_argument, NULL, LONGOPT_EXPORT_OBJECTS_DEDUP},
     {"export-tls-session-keys", ws_required_argument, NULL, LONGOPT_EXPORT_TLS_SESSION_KEYS},
     {"color", ws_no_argument, NULL, LONGOPT_COLOR},
     {"no-duplicate-keys", ws_no_argument, NULL, LONGOPT_NO_DUPLICATE_KEYS},
     {"elastic-mapping-filter", ws_required_argument, NULL, LONGOPT_ELASTIC_MAPPING_FILTER},
     {"capture-comment", ws_required_argument, NULL, LONGOPT_CAPTURE_COMMENT},
     {"hexdump", ws_required_argument, NULL, LONGOPT_HEXDUMP},
+    {"ek-batch", ws_required_argument, NULL, LONGOPT_EK_BATCH},
+    {"tap-interval", ws_required_argument, NULL, LONGOPT_TAP_INTERVAL},
+    {"read-snaplen", ws_required_argument, NULL, LONGOPT_READ_SNAPLEN},
+#ifdef HAVE_LIBPCAP
+    {"memory-ring", ws_required_argument, NULL, LONGOPT_MEMORY_RING},
+#endif
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -777,6 +830,7 @@ main(int argc, char *argv[])
   gchar               *output_only = NULL;
   gchar               *volatile pdu_export_arg = NULL;
   char                *volatile exp_pdu_filename = NULL;
+  wtap_compression_type exp_pdu_compression_type;
   const gchar         *volatile tls_session_keys_file = NULL;
   exp_pdu_t            exp_pdu_tap_data;
   const gchar*         elastic_mapping_filter = NULL;
@@ -966,6 +1020,33 @@ main(int argc, char *argv[])
   timestamp_set_precision(TS_PREC_AUTO);
   timestamp_set_seconds_type(TS_SECONDS_DEFAULT);
 
+  /* The "-G" reports that don't depend on anything the dissectors
+     register are produced before libwiretap and libwireshark are
+     initialized, as that is nearly all of TShark's startup time. */
+  if (argc >= 3 && strcmp(argv[1], "-G") == 0) {
+    gboolean dumped = TRUE;
+
+    if (strcmp(argv[2], "column-formats") == 0)
+      column_dump_column_formats();
+    else if (strcmp(argv[2], "help") == 0)
+      glossary_option_help();
+    /* These are supported only for backwards compatibility and may or may not work
+     * for a given user in a given directory on a given operating system with a given
+     * command-line interpreter.
+     */
+    else if (strcmp(argv[2], "?") == 0)
+      glossary_option_help();
+    else if (strcmp(argv[2], "-?") == 0)
+      glossary_option_help();
+    else
+      dumped = FALSE;
+
+    if (dumped) {
+      exit_status = EXIT_SUCCESS;
+      goto clean_exit;
+    }
+  }
+
   /*
    * Libwiretap must be initialized before libwireshark is, so that
    * dissection-time handlers for file-type-dependent blocks can
@@ -1015,9 +1096,7 @@ main(int argc, char *argv[])
     if (argc == 2)
       proto_registrar_dump_fields();
     else {
-      if (strcmp(argv[2], "column-formats") == 0)
-        column_dump_column_formats();
-      else if (strcmp(argv[2], "currentprefs") == 0) {
+      if (strcmp(argv[2], "currentprefs") == 0) {
         epan_load_settings();
         write_prefs(NULL);
       }
@@ -1055,16 +1134,6 @@ main(int argc, char *argv[])
         proto_registrar_dump_protocols();
       else if (strcmp(argv[2], "values") == 0)
         proto_registrar_dump_values();
-      else if (strcmp(argv[2], "help") == 0)
-        glossary_option_help();
-      /* These are supported only for backwards compatibility and may or may not work
-       * for a given user in a given directory on a given operating system with a given
-       * command-line interpreter.
-       */
-      else if (strcmp(argv[2], "?") == 0)
-        glossary_option_help();
-      else if (strcmp(argv[2], "-?") == 0)
-        glossary_option_help();
       else {
         cmdarg_err("Invalid \"%s\" option for -G flag, enter -G help for more help.", argv[2]);
         exit_status = INVALID_OPTION;
@@ -1378,6 +1447,10 @@ main(int argc, char *argv[])
         output_action = WRITE_FIELDS;
         print_details = TRUE;   /* Need full tree info */
         print_summary = FALSE;  /* Don't allow summary */
+      } else if (strcmp(ws_optarg, "cbor") == 0) {
+        output_action = WRITE_CBOR;
+        print_details = TRUE;   /* Need full tree info */
+        print_summary = FALSE;  /* Don't allow summary */
       } else if (strcmp(ws_optarg, "json") == 0) {
         output_action = WRITE_JSON;
         print_details = TRUE;   /* Need details */
@@ -1395,6 +1468,8 @@ main(int argc, char *argv[])
         cmdarg_err("Invalid -T parameter \"%s\"; it must be one of:", ws_optarg);                   /* x */
         cmdarg_err_cont("\t\"fields\"  The values of fields specified with the -e option, in a form\n"
                         "\t          specified by the -E option.\n"
+                        "\t\"cbor\"    The values of fields specified with the -e option, as\n"
+                        "\t          a sequence of CBOR arrays with typed values.\n"
                         "\t\"pdml\"    Packet Details Markup Language, an XML-based format for the\n"
                         "\t          details of a decoded packet. This information is equivalent to\n"
                         "\t          the packet details printed with the -V flag.\n"
@@ -1488,6 +1563,7 @@ main(int argc, char *argv[])
     case LONGOPT_ENABLE_HEURISTIC: /* enable heuristic dissection of protocol */
     case LONGOPT_DISABLE_HEURISTIC: /* disable heuristic dissection of protocol */
     case LONGOPT_ENABLE_PROTOCOL: /* enable dissection of protocol (that is disabled by default) */
+    case LONGOPT_WORKER_THREADS: /* threads for parallel work */
       if (!dissect_opts_handle_opt(opt, ws_optarg)) {
         exit_status = INVALID_OPTION;
         goto clean_exit;
@@ -1505,12 +1581,29 @@ main(int argc, char *argv[])
         goto clean_exit;
       }
       break;
+    case LONGOPT_EXPORT_OBJECTS_DEDUP:   /* --export-objects-dedup */
+      eo_set_dedup(TRUE);
+      break;
     case LONGOPT_EXPORT_TLS_SESSION_KEYS:   /* --export-tls-session-keys */
       tls_session_keys_file = ws_optarg;
       break;
     case LONGOPT_COLOR: /* print in color where appropriate */
       dissect_color = TRUE;
       break;
+    case LONGOPT_EK_BATCH: /* flush -T ek output in batches of packets */
+      ek_batch_size = get_positive_int(ws_optarg, "EK batch size");
+      break;
+    case LONGOPT_TAP_INTERVAL: /* draw -z statistics periodically while capturing */
+      tap_interval = get_positive_int(ws_optarg, "tap interval");
+      break;
+    case LONGOPT_READ_SNAPLEN: /* deliver only the start of each packet read from a file */
+      read_snaplen = get_positive_int(ws_optarg, "read snapshot length");
+      break;
+#ifdef HAVE_LIBPCAP
+    case LONGOPT_MEMORY_RING: /* hand live packets over through memory-backed files */
+      memory_ring_kb = get_positive_int(ws_optarg, "memory ring file size");
+      break;
+#endif
     case LONGOPT_NO_DUPLICATE_KEYS:
       no_duplicate_keys = TRUE;
       node_children_grouper = proto_node_group_children_by_json_key;
@@ -1583,15 +1676,21 @@ main(int argc, char *argv[])
     goto clean_exit;
   }
 
+  if (ek_batch_size != 0 && output_action != WRITE_EK) {
+    cmdarg_err("--ek-batch can only be used with \"-T ek\"");
+    exit_status = INVALID_OPTION;
+    goto clean_exit;
+  }
+
   /* If we specified output fields, but not the output field type... */
-  if ((WRITE_FIELDS != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
+  if ((WRITE_FIELDS != output_action && WRITE_CBOR != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
         cmdarg_err("Output fields were specified with \"-e\", "
-            "but \"-Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
+            "but \"-Tcbor, -Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
         exit_status = INVALID_OPTION;
         goto clean_exit;
-  } else if (WRITE_FIELDS == output_action && 0 == output_fields_num_fields(output_fields)) {
-        cmdarg_err("\"-Tfields\" was specified, but no fields were "
-                    "specified with \"-e\".");
+  } else if ((WRITE_FIELDS == output_action || WRITE_CBOR == output_action) && 0 == output_fields_num_fields(output_fields)) {
+        cmdarg_err("\"-T%s\" was specified, but no fields were "
+                    "specified with \"-e\".", WRITE_CBOR == output_action ? "cbor" : "fields");
 
         exit_status = INVALID_OPTION;
         goto clean_exit;
@@ -1879,6 +1978,34 @@ main(int argc, char *argv[])
           exit_status = INVALID_OPTION;
           goto clean_exit;
         }
+        if (memory_ring_kb != 0) {
+          /*
+           * Have dumpcap write a series of files of at most memory_ring_kb
+           * to a memory-backed directory; we delete each one as soon as
+           * we've moved on to the next, so the packets never reach the
+           * disk and only the ones we haven't read yet take up memory.
+           */
+          const char *ring_dir = global_capture_opts.temp_dir;
+          gchar *ring_name;
+
+#ifndef _WIN32
+          if (ring_dir == NULL && g_file_test("/dev/shm", G_FILE_TEST_IS_DIR))
+            ring_dir = "/dev/shm";
+#endif
+          if (ring_dir == NULL) {
+            cmdarg_err("--memory-ring needs a memory-backed directory; specify one with --temp-dir.");
+            exit_status = INVALID_OPTION;
+            goto clean_exit;
+          }
+          ring_name = ws_strdup_printf("tshark_%08x.pcapng", g_random_int());
+          global_capture_opts.save_file = g_build_filename(ring_dir, ring_name, NULL);
+          g_free(ring_name);
+          global_capture_opts.multi_files_on = TRUE;
+          global_capture_opts.has_autostop_filesize = TRUE;
+          global_capture_opts.autostop_filesize = memory_ring_kb;
+          global_capture_opts.has_ring_num_files = FALSE;
+          global_capture_opts.use_pcapng = TRUE;
+        }
       }
     }
   }
@@ -1954,6 +2081,13 @@ main(int argc, char *argv[])
       goto clean_exit;
     }
   }
+
+  /* -T fields only prints the values of the requested fields. Unless
+     one of them is printed from its label, prime the dissection with
+     those fields rather than building and labelling the whole tree. */
+  if ((output_action == WRITE_FIELDS || output_action == WRITE_CBOR) &&
+      !output_fields_need_visible_tree(output_fields))
+    fields_from_values = TRUE;
 #ifdef HAVE_LIBPCAP
   /* We currently don't support taps, or printing dissected packets,
      if we're writing to a pipe. */
@@ -2057,6 +2191,13 @@ main(int argc, char *argv[])
   cfile.dfcode = dfcode;
 
   if (print_packet_info) {
+    /* Unless we're flushing after every packet anyway, give the standard
+       output a buffer big enough to hold several fully-dissected packets,
+       so that "-V", "-T pdml" and "-T json" output go out in a few large
+       writes rather than one per stdio buffer's worth of a packet. */
+    if (!line_buffered)
+      setvbuf(stdout, NULL, _IOFBF, STDOUT_BUFFER_SIZE);
+
     /* If we're printing as text or PostScript, we have
        to create a print stream. */
     if (output_action == WRITE_TEXT) {
@@ -2112,6 +2253,16 @@ main(int argc, char *argv[])
           goto clean_exit;
       }
 
+      /* Compress the output if its name asks for it, e.g. "pdus.pcapng.gz" */
+      exp_pdu_compression_type = WTAP_UNCOMPRESSED;
+      if (wtap_dump_can_compress(out_file_type)) {
+        gchar *gz_suffix = ws_strdup_printf(".%s",
+            wtap_compression_type_extension(WTAP_GZIP_COMPRESSED));
+        if (g_str_has_suffix(exp_pdu_filename, gz_suffix))
+          exp_pdu_compression_type = WTAP_GZIP_COMPRESSED;
+        g_free(gz_suffix);
+      }
+
       if (strcmp(exp_pdu_filename, "-") == 0) {
         /* Write to the standard output. */
         exp_fd = 1;
@@ -2129,8 +2280,8 @@ main(int argc, char *argv[])
        * otherwise exp_pdu_open() will ignore the comment) */
       comment = ws_strdup_printf("Dump of PDUs from %s", cf_name);
       exp_pdu_status = exp_pdu_open(&exp_pdu_tap_data, exp_pdu_filename,
-                                    out_file_type, exp_fd, comment,
-                                    &err, &err_info);
+                                    out_file_type, exp_pdu_compression_type,
+                                    exp_fd, comment, &err, &err_info);
       g_free(comment);
       if (!exp_pdu_status) {
           cfile_dump_open_failure_message(exp_pdu_filename, err, err_info,
@@ -2153,6 +2304,7 @@ main(int argc, char *argv[])
       exit_status = INVALID_FILE;
       goto clean_exit;
     }
+    wtap_set_read_snaplen(cfile.provider.wth, read_snaplen);
 
     /* Start statistics taps; we do so after successfully opening the
        capture file, so we know we have something to compute stats
@@ -2387,6 +2539,13 @@ main(int argc, char *argv[])
   if (draw_taps)
     draw_tap_listeners(TRUE);
 
+  if (!really_quiet && dissection_budget_exceeded_count() > 0) {
+    /* Not an error; the packets are marked with _ws.budget.exceeded. */
+    fprintf(stderr, "%" PRIu64 " packet%s exceeded the per-packet dissection budget.\n",
+            dissection_budget_exceeded_count(),
+            plurality(dissection_budget_exceeded_count(), "", "s"));
+  }
+
   if (tls_session_keys_file) {
     gsize keylist_length;
     gchar *keylist = ssl_export_sessions(&keylist_length);
@@ -2554,6 +2713,20 @@ tshark_epan_new(capture_file *cf)
   return epan_new(&cf->provider, &funcs);
 }
 
+/*
+ * If the only columns we output are "-e _ws.col.<title>" fields, and no
+ * tap wants the columns, don't bother filling in the others.
+ */
+static void
+set_needed_columns(capture_file *cf, guint tap_flags)
+{
+  if (print_packet_info && !print_summary && !(tap_flags & TL_REQUIRES_COLUMNS) &&
+      output_fields != NULL && output_fields_has_cols(output_fields))
+    output_fields_set_needed_cols(output_fields, &cf->cinfo);
+  else
+    col_set_needed_columns(&cf->cinfo, NULL);
+}
+
 #ifdef HAVE_LIBPCAP
 static gboolean
 capture(void)
@@ -2606,7 +2779,16 @@ capture(void)
   sigemptyset(&action.sa_mask);
   sigaction(SIGINFO, &action, NULL);
 #endif /* SIGINFO */
+
+  /* With -z pipeline-latency, print the latency histograms on SIGUSR1. */
+  if (pipeline_latency_enabled()) {
+    action.sa_handler = report_latency_sigusr1;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+  }
 #endif /* _WIN32 */
+  measure_latency = pipeline_latency_enabled();
 
   global_capture_session.state = CAPTURE_PREPARING;
 
@@ -2767,10 +2949,14 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
     /* we start a new capture file, close the old one (if we had one before) */
     if (cf->state != FILE_CLOSED) {
       cf_close(cf);
+    } else if (memory_ring_kb != 0) {
+      /* We didn't read it, but we don't want it either. */
+      ws_unlink(capture_opts->save_file);
     }
 
     g_free(capture_opts->save_file);
-    is_tempfile = FALSE;
+    /* --memory-ring files are ours to delete once read */
+    is_tempfile = (memory_ring_kb != 0);
 
     epan_free(cf->epan);
     cf->epan = tshark_epan_new(cf);
@@ -2810,6 +2996,7 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
 
 
 /* capture child tells us we have new packets to read */
+
 static void
 capture_input_new_packets(capture_session *cap_session, int to_read)
 {
@@ -2820,6 +3007,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
   capture_file *cf = cap_session->cf;
   gboolean      filtering_tap_listeners;
   guint         tap_flags;
+  static gint64 next_tap_draw;
 
 #ifdef SIGINFO
   /*
@@ -2830,11 +3018,15 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
   infodelay = TRUE;
 #endif /* SIGINFO */
 
+  if (measure_latency)
+    pipeline_latency_packets_written(to_read);
+
   /* Do we have any tap listeners with filters? */
   filtering_tap_listeners = have_filtering_tap_listeners();
 
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
+  set_needed_columns(cf, tap_flags);
 
   if (do_dissection) {
     gboolean create_proto_tree;
@@ -2870,8 +3062,9 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
     /* The protocol tree will be "visible", i.e., printed, only if we're
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
-       ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+       ("packet_details" is true), and the fields being printed
+       can't simply be taken from their values. */
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details && !fields_from_values);
 
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
@@ -2879,15 +3072,20 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
     while (to_read-- && cf->provider.wth) {
       wtap_cleareof(cf->provider.wth);
       ret = wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset);
-      reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+      reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details && !fields_from_values);
       if (ret == FALSE) {
         /* read from file failed, tell the capture child to stop */
         sync_pipe_stop(cap_session);
         wtap_close(cf->provider.wth);
         cf->provider.wth = NULL;
       } else {
+        gint64 read_time = measure_latency ? g_get_monotonic_time() : 0;
+
         ret = process_packet_single_pass(cf, edt, data_offset, &rec, &buf,
                                          tap_flags);
+        if (measure_latency && ret)
+          pipeline_latency_packet(&rec.ts, read_time, latency_dissected_time,
+                                  latency_output_time);
       }
       if (ret != FALSE) {
         /* packet successfully read and gone through the "Read Filter" */
@@ -2909,6 +3107,23 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
     packet_count += to_read;
   }
 
+  /*
+   * The tap listeners have been accumulating as packets arrived; if
+   * asked to, print what they have so far, drawing only the ones that
+   * saw something new since the last time.
+   */
+  if (tap_interval != 0 && do_dissection) {
+    gint64 now = g_get_monotonic_time();
+
+    if (next_tap_draw == 0) {
+      next_tap_draw = now + (gint64)tap_interval * G_USEC_PER_SEC;
+    } else if (now >= next_tap_draw) {
+      draw_tap_listeners(FALSE);
+      fflush(stdout);
+      next_tap_draw = now + (gint64)tap_interval * G_USEC_PER_SEC;
+    }
+  }
+
   if (print_packet_counts) {
       /* We're printing packet counts. */
       if (packet_count != 0) {
@@ -2918,6 +3133,14 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
       }
   }
 
+#ifdef SIGUSR1
+  if (latency_print_requested) {
+    latency_print_requested = FALSE;
+    pipeline_latency_print();
+    fflush(stdout);
+  }
+#endif /* SIGUSR1 */
+
 #ifdef SIGINFO
   /*
    * Allow SIGINFO handlers to write.
@@ -2962,6 +3185,15 @@ report_counts_siginfo(int signum _U_)
 }
 #endif /* SIGINFO */
 
+#ifdef SIGUSR1
+static void
+report_latency_sigusr1(int signum _U_)
+{
+  /* Printing isn't async-signal-safe; do it after the current batch. */
+  latency_print_requested = TRUE;
+}
+#endif /* SIGUSR1 */
+
 
 /* capture child detected any packet drops? */
 static void
@@ -3053,6 +3285,29 @@ capture_cleanup(int signum _U_)
 #endif /* _WIN32 */
 #endif /* HAVE_LIBPCAP */
 
+/*
+ * Queue lookups of the packet's network addresses, so that the names
+ * can be resolved all at once between the two passes. (The dissectors
+ * only look them up when building a protocol tree, which the first
+ * pass often doesn't.)
+ */
+static void
+prefetch_host_names(const packet_info *pinfo)
+{
+  const address *addrs[2] = { &pinfo->net_src, &pinfo->net_dst };
+  guint32 ip4;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(addrs); i++) {
+    if (addrs[i]->type == AT_IPv4) {
+      memcpy(&ip4, addrs[i]->data, sizeof ip4);
+      get_hostname(ip4);
+    } else if (addrs[i]->type == AT_IPv6) {
+      get_hostname6((const ws_in6_addr *)addrs[i]->data);
+    }
+  }
+}
+
 static gboolean
 process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
                           gint64 offset, wtap_rec *rec, Buffer *buf)
@@ -3122,6 +3377,9 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
       }
     }
 
+    if (edt && gbl_resolv_flags.network_name)
+      prefetch_host_names(&edt->pi);
+
     cf->count++;
   } else {
     /* if we don't add it to the frame_data_sequence, clean it up right now
@@ -3299,6 +3557,9 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
     if (cf->dfcode)
       epan_dissect_prime_with_dfilter(edt, cf->dfcode);
 
+    if (print_packet_info && fields_from_values)
+      output_fields_prime_edt(output_fields, edt);
+
     col_custom_prime_edt(edt, &cf->cinfo);
 
     /* We only need the columns if either
@@ -3339,13 +3600,15 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
     if (print_packet_info) {
       /* We're printing packet information; print the information for
          this packet. */
-      print_packet(cf, edt);
+      print_packet_locked(cf, edt);
 
       /* If we're doing "line-buffering", flush the standard output
          after every packet.  See the comment above, for the "-l"
          option, for an explanation of why we do that. */
       if (line_buffered)
         fflush(stdout);
+      else
+        ek_batch_done();
 
       if (ferror(stdout)) {
         show_print_file_io_error();
@@ -3419,6 +3682,7 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
 
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
+  set_needed_columns(cf, tap_flags);
 
   if (do_dissection) {
     gboolean create_proto_tree;
@@ -3445,8 +3709,9 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
     /* The protocol tree will be "visible", i.e., printed, only if we're
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
-       ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+       ("packet_details" is true), and the fields being printed
+       can't simply be taken from their values. */
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details && !fields_from_values);
   }
 
   /*
@@ -3528,6 +3793,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
 
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
+  set_needed_columns(cf, tap_flags);
 
   if (do_dissection) {
     /*
@@ -3560,8 +3826,9 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     /* The protocol tree will be "visible", i.e., printed, only if we're
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
-       ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+       ("packet_details" is true), and the fields being printed
+       can't simply be taken from their values. */
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details && !fields_from_values);
   }
 
   /*
@@ -3590,7 +3857,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
 
     ws_debug("tshark: processing packet #%d", framenum);
 
-    reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+    reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details && !fields_from_values);
 
     if (process_packet_single_pass(cf, edt, data_offset, &rec, &buf, tap_flags)) {
       /* Either there's no read filtering or this packet passed the
@@ -3765,6 +4032,14 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
          It won't be run, so it won't get an error. */
       second_pass_status = PASS_SUCCEEDED;
     } else {
+      /*
+       * Resolve the addresses queued up on the first pass in parallel
+       * batches now; the second pass resolves synchronously, one
+       * address at a time.
+       */
+      if (gbl_resolv_flags.network_name)
+        host_name_lookup_flush(HOST_NAME_PREFETCH_TIMEOUT);
+
       /*
        * If we got a read error on the first pass, we still do the second
        * pass, so we can at least process the packets we read, and then
@@ -3944,6 +4219,9 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
     if (cf->dfcode)
       epan_dissect_prime_with_dfilter(edt, cf->dfcode);
 
+    if (print_packet_info && fields_from_values)
+      output_fields_prime_edt(output_fields, edt);
+
     /* This is the first and only pass, so prime the epan_dissect_t
        with the hfids postdissectors want on the first pass. */
     prime_epan_dissect_with_postdissector_wanted_hfids(edt);
@@ -3983,6 +4261,9 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
       passed = dfilter_apply_edt(cf->dfcode, edt);
   }
 
+  if (measure_latency)
+    latency_dissected_time = g_get_monotonic_time();
+
   if (passed) {
     frame_data_set_after_dissect(&fdata, &cum_bytes);
 
@@ -3991,13 +4272,15 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
       /* We're printing packet information; print the information for
          this packet. */
       ws_assert(edt);
-      print_packet(cf, edt);
+      print_packet_locked(cf, edt);
 
       /* If we're doing "line-buffering", flush the standard output
          after every packet.  See the comment above, for the "-l"
          option, for an explanation of why we do that. */
       if (line_buffered)
         fflush(stdout);
+      else
+        ek_batch_done();
 
       if (ferror(stdout)) {
         show_print_file_io_error();
@@ -4010,6 +4293,9 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
     cf->provider.prev_dis = &prev_dis_frame;
   }
 
+  if (measure_latency)
+    latency_output_time = g_get_monotonic_time();
+
   prev_cap_frame = fdata;
   cf->provider.prev_cap = &prev_cap_frame;
 
@@ -4047,6 +4333,10 @@ write_preamble(capture_file *cf)
   case WRITE_EK:
     return TRUE;
 
+  case WRITE_CBOR:
+    jdumper = write_cbor_fields_preamble(output_fields, stdout);
+    return !ferror(stdout);
+
   default:
     ws_assert_not_reached();
     return FALSE;
@@ -4344,6 +4634,46 @@ print_columns(capture_file *cf, const epan_dissect_t *edt)
     return print_line(print_stream, 0, line_bufp);
 }
 
+/*
+ * Print a packet while holding the lock on the standard output, so that
+ * the many small stdio calls made while formatting a protocol tree don't
+ * each have to take and release it.
+ */
+/*
+ * With --ek-batch, write out the bulk index lines of every <count>
+ * packets in one go, so that whatever posts them to Elasticsearch gets
+ * whole batches, and the stdio buffer doesn't split a batch.
+ */
+static void
+ek_batch_done(void)
+{
+  if (ek_batch_size == 0)
+    return;
+  if (++ek_batch_count >= ek_batch_size) {
+    fflush(stdout);
+    ek_batch_count = 0;
+  }
+}
+
+static gboolean
+print_packet_locked(capture_file *cf, epan_dissect_t *edt)
+{
+  gboolean ret;
+
+#ifdef _WIN32
+  _lock_file(stdout);
+#else
+  flockfile(stdout);
+#endif
+  ret = print_packet(cf, edt);
+#ifdef _WIN32
+  _unlock_file(stdout);
+#else
+  funlockfile(stdout);
+#endif
+  return ret;
+}
+
 static gboolean
 print_packet(capture_file *cf, epan_dissect_t *edt)
 {
@@ -4419,6 +4749,10 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
                         protocolfilter_flags, edt, &cf->cinfo, stdout);
     return !ferror(stdout);
 
+  case WRITE_CBOR:
+    write_cbor_fields_proto_tree(output_fields, edt, &cf->cinfo, &jdumper);
+    return !ferror(stdout);
+
   default:
     ws_assert_not_reached();
   }
@@ -4461,6 +4795,7 @@ write_finale(void)
     return !ferror(stdout);
 
   case WRITE_EK:
+  case WRITE_CBOR:
     return TRUE;
 
   default:
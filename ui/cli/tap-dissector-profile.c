@@ -0,0 +1,136 @@
+/* tap-dissector-profile.c
+ * Per-protocol dissector time and call counts for tshark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+
+void register_tap_listener_dissector_profile(void);
+
+static void
+dissector_profile_collect(const dissector_profile_t *profile, void *user_data)
+{
+    g_ptr_array_add((GPtrArray *)user_data, (gpointer)profile);
+}
+
+/* Most expensive (self time) first */
+static gint
+dissector_profile_compare(gconstpointer a, gconstpointer b)
+{
+    const dissector_profile_t *pa = *(const dissector_profile_t * const *)a;
+    const dissector_profile_t *pb = *(const dissector_profile_t * const *)b;
+
+    if (pa->self_ns != pb->self_ns)
+        return pa->self_ns < pb->self_ns ? 1 : -1;
+    if (pa->calls != pb->calls)
+        return pa->calls < pb->calls ? 1 : -1;
+    return pa->proto_id - pb->proto_id;
+}
+
+static void
+dissector_profile_reset(void *tapdata _U_)
+{
+    dissector_profiling_reset();
+}
+
+static void
+dissector_profile_draw(void *tapdata _U_)
+{
+    GPtrArray *profiles = g_ptr_array_new();
+    guint64    total_self_ns = 0;
+    guint      i;
+
+    dissector_profiling_foreach(dissector_profile_collect, profiles);
+    g_ptr_array_sort(profiles, dissector_profile_compare);
+
+    for (i = 0; i < profiles->len; i++) {
+        total_self_ns += ((const dissector_profile_t *)g_ptr_array_index(profiles, i))->self_ns;
+    }
+
+    printf("\n");
+    printf("===================================================================================================\n");
+    printf("Dissector Profile\n");
+    printf("Total dissector time: %.3f ms\n", total_self_ns / 1000000.0);
+    printf("                                                   Heuristic\n");
+    printf("Protocol                 Calls   Accepted    Tried Accepted  Self ms   Self %%  Incl ms     Items\n");
+    printf("---------------------------------------------------------------------------------------------------\n");
+
+    for (i = 0; i < profiles->len; i++) {
+        const dissector_profile_t *p = (const dissector_profile_t *)g_ptr_array_index(profiles, i);
+        const char *name = "(none)";
+
+        if (p->proto_id != -1)
+            name = proto_get_protocol_filter_name(p->proto_id);
+
+        printf("%-20s %9" PRIu64 " %10" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8.3f %7.2f%% %8.3f %9" PRIu64 "\n",
+               name, p->calls, p->accepted, p->heur_attempts, p->heur_accepted,
+               p->self_ns / 1000000.0,
+               total_self_ns ? 100.0 * p->self_ns / total_self_ns : 0.0,
+               p->inclusive_ns / 1000000.0,
+               p->tree_items);
+    }
+    printf("===================================================================================================\n");
+
+    g_ptr_array_free(profiles, TRUE);
+}
+
+static void
+dissector_profile_finish(void *tapdata _U_)
+{
+    dissector_profiling_enable(FALSE);
+}
+
+static void
+dissector_profile_init(const char *opt_arg _U_, void *userdata _U_)
+{
+    GString *error_string;
+
+    /*
+     * The "frame" tap is only used to get reset and draw callbacks at
+     * the right times; the numbers themselves are collected by
+     * libwireshark while profiling is enabled.
+     */
+    error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING,
+                                         dissector_profile_reset,
+                                         NULL,
+                                         dissector_profile_draw,
+                                         dissector_profile_finish);
+    if (error_string) {
+        fprintf(stderr, "tshark: Couldn't register dissector-profile tap: %s\n",
+                error_string->str);
+        g_string_free(error_string, TRUE);
+        exit(1);
+    }
+
+    dissector_profiling_reset();
+    dissector_profiling_enable(TRUE);
+}
+
+static stat_tap_ui dissector_profile_ui = {
+    REGISTER_STAT_GROUP_GENERIC,
+    NULL,
+    "dissector-profile",
+    dissector_profile_init,
+    0,
+    NULL
+};
+
+void
+register_tap_listener_dissector_profile(void)
+{
+    register_stat_tap_ui(&dissector_profile_ui, NULL);
+}
@@ -82,25 +82,10 @@ expert_stat_packet(void *tapdata, packet_info *pinfo _U_, epan_dissect_t *edt _U
     expert_entry        *entry;
     guint                n;
 
-    switch (ei->severity) {
-        case PI_COMMENT:
-            severity_level = comment_level;
-            break;
-        case PI_CHAT:
-            severity_level = chat_level;
-            break;
-        case PI_NOTE:
-            severity_level = note_level;
-            break;
-        case PI_WARN:
-            severity_level = warn_level;
-            break;
-        case PI_ERROR:
-            severity_level = error_level;
-            break;
-        default:
-            ws_assert_not_reached();
-            return TAP_PACKET_DONT_REDRAW;
+    severity_level = expert_severity_level(ei->severity);
+    if (severity_level == max_level) {
+        ws_assert_not_reached();
+        return TAP_PACKET_DONT_REDRAW;
     }
 
     /* Don't store details at a lesser severity than we are interested in */
@@ -184,6 +169,83 @@ expert_stat_draw(void *phs _U_)
     draw_items_for_severity(hs->ei_array[comment_level],  "Comments");
 }
 
+/* Severity level of an expert info severity, max_level if unknown */
+static severity_level_t
+expert_severity_level(int severity)
+{
+    switch (severity) {
+        case PI_COMMENT:
+            return comment_level;
+        case PI_CHAT:
+            return chat_level;
+        case PI_NOTE:
+            return note_level;
+        case PI_WARN:
+            return warn_level;
+        case PI_ERROR:
+            return error_level;
+        default:
+            return max_level;
+    }
+}
+
+static void draw_aggregate_for_severity(expert_aggregate_t *agg, severity_level_t level, const gchar *label)
+{
+    guint                     n, i;
+    expert_aggregate_entry_t *entry;
+    guint64                   total = 0;
+    gchar                    *tmp_str;
+
+    if (level < lowest_report_level) {
+        return;
+    }
+
+    for (n=0; n < agg->entries->len; n++) {
+        entry = (expert_aggregate_entry_t *)g_ptr_array_index(agg->entries, n);
+        if (expert_severity_level(entry->severity) == level) {
+            total += entry->count;
+        }
+    }
+
+    /* Don't print title if no items */
+    if (total == 0) {
+        return;
+    }
+
+    printf("\n%s (%" G_GUINT64_FORMAT ")\n", label, total);
+    printf("=============\n");
+
+    printf("   Frequency      Group           Protocol  Summary [Frames]\n");
+
+    for (n=0; n < agg->entries->len; n++) {
+        entry = (expert_aggregate_entry_t *)g_ptr_array_index(agg->entries, n);
+        if (expert_severity_level(entry->severity) != level) {
+            continue;
+        }
+        tmp_str = val_to_str_wmem(NULL, entry->group, expert_group_vals, "Unknown (%d)");
+        printf("%12" G_GUINT64_FORMAT " %10s %18s  %s [",
+              entry->count,
+              tmp_str,
+              entry->protocol, expert_aggregate_summary(entry));
+        wmem_free(NULL, tmp_str);
+        for (i=0; i < entry->num_samples; i++) {
+            printf("%s%u", i ? "," : "", entry->samples[i]);
+        }
+        printf("%s]\n", entry->count > entry->num_samples ? ",..." : "");
+    }
+}
+
+/* (Re)draw aggregated expert stats */
+static void
+expert_aggregate_stat_draw(expert_aggregate_t *agg)
+{
+    draw_aggregate_for_severity(agg, error_level, "Errors");
+    draw_aggregate_for_severity(agg, warn_level,  "Warns");
+    draw_aggregate_for_severity(agg, note_level,  "Notes");
+    draw_aggregate_for_severity(agg, chat_level,  "Chats");
+    draw_aggregate_for_severity(agg, comment_level,  "Comments");
+}
+
 static void
 expert_tapdata_free(expert_tapdata_t* hs)
 {
@@ -201,6 +263,7 @@ static void expert_stat_init(const char *opt_arg, void *userdata _U_)
     const char       *filter = NULL;
     GString          *error_string;
     expert_tapdata_t *hs;
+    gboolean          aggregate = FALSE;
     int               n;
 
     /* Check for args. */
@@ -234,13 +297,34 @@ static void expert_stat_init(const char *opt_arg, void *userdata _U_)
         }
     }
 
-    /* Second (optional) arg is a filter string */
+    /* Then (optional) "aggregate": count by expert field, without messages */
+    if (args != NULL && g_ascii_strncasecmp(args, ",aggregate", 10) == 0 &&
+        (args[10] == '\0' || args[10] == ',')) {
+        aggregate = TRUE;
+        args += 10;
+    }
+
+    /* Last (optional) arg is a filter string */
     if (args != NULL) {
         if (args[0] == ',') {
             filter = args+1;
         }
     }
 
+    if (aggregate) {
+        expert_aggregate_t *agg = g_new0(expert_aggregate_t, 1);
+
+        agg->draw = expert_aggregate_stat_draw;
+        error_string = register_expert_aggregate(agg, filter);
+        if (error_string) {
+            printf("Expert tap error (%s)!\n", error_string->str);
+            g_string_free(error_string, TRUE);
+            g_free(agg);
+            exit(1);
+        }
+        return;
+    }
+
     /* Create top-level struct */
     hs = g_new0(expert_tapdata_t, 1);
 
@@ -19,6 +19,7 @@
 
 #include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
+#include <wsutil/str_util.h>
 #include <ui/cmdarg_err.h>
 
 #include <epan/packet_info.h>
@@ -26,12 +27,46 @@
 #include <epan/export_object.h>
 #include "tap-exportobject.h"
 
+/*
+ * Objects are written out as soon as the dissector reports them, by a
+ * small pool of writer threads, and then freed. Only the names handed
+ * out so far (and, with deduplication, the digests of the contents
+ * written so far) are kept, so memory use doesn't grow with the size of
+ * the objects.
+ *
+ * Protocols that register a reset callback keep building their objects
+ * after reporting them (SMB fills them in chunk by chunk through
+ * get_entry), so their objects are kept until the end as before.
+ */
+#define EO_WRITER_THREADS 4
+
 typedef struct _export_object_list_gui_t {
-    GSList *entries;
     register_eo_t* eo;
+    gchar *save_in_path;
+    gboolean dir_ok;
+    gboolean streaming;
+    GPtrArray *entries;         /* entries kept until eo_draw() when not streaming */
+    GHashTable *used_names;     /* file names handed out so far */
+    GThreadPool *writers;
+    GMutex digest_lock;
+    GHashTable *digests;        /* SHA-256 of the contents written, when deduplicating */
+    gint written;
+    guint duplicates;
 } export_object_list_gui_t;
 
+typedef struct _eo_write_job_t {
+    export_object_list_gui_t *object_list;
+    export_object_entry_t *entry;
+    gchar *path;
+} eo_write_job_t;
+
 static GHashTable* eo_opts = NULL;
+static gboolean eo_dedup = FALSE;
+
+void eo_set_dedup(gboolean dedup)
+{
+    eo_dedup = dedup;
+}
 
 static gboolean
 list_exportobject_protocol(const void *key, void *value _U_, void *userdata _U_)
@@ -82,72 +117,150 @@ gboolean eo_tap_opt_add(const char *option_string)
     return FALSE;
 }
 
+/* Runs in a writer thread. */
+static void
+eo_write_entry(gpointer data, gpointer user_data _U_)
+{
+    eo_write_job_t *job = (eo_write_job_t *)data;
+    export_object_list_gui_t *object_list = job->object_list;
+    gboolean write = TRUE;
+
+    if (object_list->digests) {
+        gchar *digest = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+            job->entry->payload_data, job->entry->payload_len);
+
+        g_mutex_lock(&object_list->digest_lock);
+        if (g_hash_table_contains(object_list->digests, digest)) {
+            object_list->duplicates++;
+            write = FALSE;
+            g_free(digest);
+        } else {
+            g_hash_table_add(object_list->digests, digest);
+        }
+        g_mutex_unlock(&object_list->digest_lock);
+    }
+
+    if (write) {
+        write_file_binary_mode(job->path, job->entry->payload_data, job->entry->payload_len);
+        g_atomic_int_inc(&object_list->written);
+    }
+
+    eo_free_entry(job->entry);
+    g_free(job->path);
+    g_free(job);
+}
+
+/*
+ * Picks a file name in the destination directory that is neither on
+ * disk nor already handed to a writer thread.
+ */
+static gchar *
+object_list_reserve_path(export_object_list_gui_t *object_list, export_object_entry_t *entry)
+{
+    GString *safe_filename = NULL;
+    gchar *save_as_fullpath = NULL;
+    guint count = 0;
+
+    do {
+        g_free(save_as_fullpath);
+        if (entry->filename) {
+            safe_filename = eo_massage_str(entry->filename,
+                EXPORT_OBJECT_MAXFILELEN, count);
+        } else {
+            char generic_name[EXPORT_OBJECT_MAXFILELEN+1];
+            const char *ext;
+            ext = eo_ct2ext(entry->content_type);
+            snprintf(generic_name, sizeof(generic_name),
+                "object%u%s%s", entry->pkt_num, ext ? "." : "", ext ? ext : "");
+            safe_filename = eo_massage_str(generic_name,
+                EXPORT_OBJECT_MAXFILELEN, count);
+        }
+        save_as_fullpath = g_build_filename(object_list->save_in_path, safe_filename->str, NULL);
+        g_string_free(safe_filename, TRUE);
+    } while ((g_hash_table_contains(object_list->used_names, save_as_fullpath) ||
+              g_file_test(save_as_fullpath, G_FILE_TEST_EXISTS)) &&
+             ++count < prefs.gui_max_export_objects);
+
+    g_hash_table_add(object_list->used_names, g_strdup(save_as_fullpath));
+    return save_as_fullpath;
+}
+
+static void
+object_list_write_entry(export_object_list_gui_t *object_list, export_object_entry_t *entry)
+{
+    eo_write_job_t *job;
+
+    if (!object_list->dir_ok) {
+        eo_free_entry(entry);
+        return;
+    }
+
+    if (object_list->writers == NULL) {
+        object_list->writers = g_thread_pool_new(eo_write_entry, NULL,
+            EO_WRITER_THREADS, FALSE, NULL);
+    }
+
+    job = g_new(eo_write_job_t, 1);
+    job->object_list = object_list;
+    job->entry = entry;
+    job->path = object_list_reserve_path(object_list, entry);
+    g_thread_pool_push(object_list->writers, job, NULL);
+}
+
 static void
 object_list_add_entry(void *gui_data, export_object_entry_t *entry)
 {
     export_object_list_gui_t *object_list = (export_object_list_gui_t*)gui_data;
 
-    object_list->entries = g_slist_append(object_list->entries, entry);
+    if (object_list->streaming)
+        object_list_write_entry(object_list, entry);
+    else
+        g_ptr_array_add(object_list->entries, entry);
 }
 
+/*
+ * When streaming, entries are freed once they have been written, so
+ * they can't be looked up again.
+ */
 static export_object_entry_t*
 object_list_get_entry(void *gui_data, int row) {
     export_object_list_gui_t *object_list = (export_object_list_gui_t*)gui_data;
 
-    return (export_object_entry_t *)g_slist_nth_data(object_list->entries, row);
+    if (object_list->streaming || row < 0 || (guint)row >= object_list->entries->len)
+        return NULL;
+    return (export_object_entry_t *)g_ptr_array_index(object_list->entries, row);
 }
 
-/* This is just for writing Exported Objects to a file */
+/* Waits for the objects reported so far to be written. */
 static void
 eo_draw(void *tapdata)
 {
     export_object_list_t *tap_object = (export_object_list_t *)tapdata;
     export_object_list_gui_t *object_list = (export_object_list_gui_t*)tap_object->gui_data;
-    GSList *slist = object_list->entries;
-    export_object_entry_t *entry;
-    gchar* save_in_path = (gchar*)g_hash_table_lookup(eo_opts, proto_get_protocol_filter_name(get_eo_proto_id(object_list->eo)));
-    GString *safe_filename = NULL;
-    gchar *save_as_fullpath = NULL;
-    guint count = 0;
+    guint i;
 
-    if (!g_file_test(save_in_path, G_FILE_TEST_IS_DIR)) {
-        /* If the destination directory (or its parents) do not exist, create them. */
-        if (g_mkdir_with_parents(save_in_path, 0755) == -1) {
-            fprintf(stderr, "Failed to create export objects output directory \"%s\": %s\n",
-                    save_in_path, g_strerror(errno));
-            return;
-        }
+    if (!object_list->streaming) {
+        for (i = 0; i < object_list->entries->len; i++)
+            object_list_write_entry(object_list,
+                (export_object_entry_t *)g_ptr_array_index(object_list->entries, i));
+        g_ptr_array_set_size(object_list->entries, 0);
     }
 
-    while (slist) {
-        entry = (export_object_entry_t *)slist->data;
-        do {
-            g_free(save_as_fullpath);
-            if (entry->filename) {
-                safe_filename = eo_massage_str(entry->filename,
-                    EXPORT_OBJECT_MAXFILELEN, count);
-            } else {
-                char generic_name[EXPORT_OBJECT_MAXFILELEN+1];
-                const char *ext;
-                ext = eo_ct2ext(entry->content_type);
-                snprintf(generic_name, sizeof(generic_name),
-                    "object%u%s%s", entry->pkt_num, ext ? "." : "", ext ? ext : "");
-                safe_filename = eo_massage_str(generic_name,
-                    EXPORT_OBJECT_MAXFILELEN, count);
-            }
-            save_as_fullpath = g_build_filename(save_in_path, safe_filename->str, NULL);
-            g_string_free(safe_filename, TRUE);
-        } while (g_file_test(save_as_fullpath, G_FILE_TEST_EXISTS) && ++count < prefs.gui_max_export_objects);
-        count = 0;
-        write_file_binary_mode(save_as_fullpath, entry->payload_data, entry->payload_len);
-        g_free(save_as_fullpath);
-        save_as_fullpath = NULL;
-        slist = slist->next;
+    if (object_list->writers) {
+        g_thread_pool_free(object_list->writers, FALSE, TRUE);
+        object_list->writers = NULL;
+    }
+
+    if (object_list->duplicates) {
+        fprintf(stderr, "%s: %d object%s written, %u duplicate%s skipped\n",
+                proto_get_protocol_filter_name(get_eo_proto_id(object_list->eo)),
+                object_list->written, plurality(object_list->written, "", "s"),
+                object_list->duplicates, plurality(object_list->duplicates, "", "s"));
     }
 }
 
 static void
-exportobject_handler(gpointer key, gpointer value _U_, gpointer user_data _U_)
+exportobject_handler(gpointer key, gpointer value, gpointer user_data _U_)
 {
     GString *error_msg;
     export_object_list_t *tap_data;
@@ -169,6 +282,23 @@ exportobject_handler(gpointer key, gpointer value _U_, gpointer user_data _U_)
     tap_data->gui_data = (void*)object_list;
 
     object_list->eo = eo;
+    object_list->save_in_path = (gchar*)value;
+    object_list->streaming = get_eo_reset_func(eo) == NULL;
+    object_list->entries = g_ptr_array_new();
+    object_list->used_names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    if (eo_dedup) {
+        g_mutex_init(&object_list->digest_lock);
+        object_list->digests = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    /* If the destination directory (or its parents) do not exist, create them. */
+    object_list->dir_ok = TRUE;
+    if (!g_file_test(object_list->save_in_path, G_FILE_TEST_IS_DIR) &&
+        g_mkdir_with_parents(object_list->save_in_path, 0755) == -1) {
+        fprintf(stderr, "Failed to create export objects output directory \"%s\": %s\n",
+                object_list->save_in_path, g_strerror(errno));
+        object_list->dir_ok = FALSE;
+    }
 
     /* Data will be gathered via a tap callback */
     error_msg = register_tap_listener(get_eo_tap_listener_name(eo), tap_data, NULL, 0,
@@ -177,6 +307,12 @@ exportobject_handler(gpointer key, gpointer value _U_, gpointer user_data _U_)
     if (error_msg) {
         cmdarg_err("Can't register %s tap: %s", (const char*)key, error_msg->str);
         g_string_free(error_msg, TRUE);
+        g_ptr_array_free(object_list->entries, TRUE);
+        g_hash_table_destroy(object_list->used_names);
+        if (object_list->digests) {
+            g_hash_table_destroy(object_list->digests);
+            g_mutex_clear(&object_list->digest_lock);
+        }
         g_free(tap_data);
         g_free(object_list);
         return;
@@ -19,6 +19,9 @@ void eo_list_object_types(void);
 /* will be called by main each time a --export-objects option is found */
 gboolean eo_tap_opt_add(const char *ws_optarg);
 
+/* Skip objects whose contents were already written; --export-objects-dedup */
+void eo_set_dedup(gboolean dedup);
+
 void start_exportobjects(void);
 
 #ifdef __cplusplus
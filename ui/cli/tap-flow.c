@@ -78,7 +78,7 @@ flow_arg_mode(const char **opt_argp, seq_analysis_info_t *flow_info)
 static void
 flow_init(const char *opt_argp, void *userdata)
 {
-    seq_analysis_info_t *flow_info = g_new0(seq_analysis_info_t, 1);
+    seq_analysis_info_t *flow_info = sequence_analysis_info_new();
     GString  *errp;
     register_analysis_t* analysis = (register_analysis_t*)userdata;
     const char *filter=NULL;
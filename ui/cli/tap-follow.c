@@ -45,6 +45,11 @@ typedef struct _cli_follow_info {
     guint32           addrBuf_v4;
     ws_in6_addr addrBuf_v6;
   }             addrBuf[2];
+
+  /* output state, records are formatted as they arrive */
+  guint         chunk;
+  guint32       global_pos[2];
+  FILE         *spool;
 } cli_follow_info_t;
 
 
@@ -86,6 +91,8 @@ follow_free(follow_info_t *follow_info)
 {
   cli_follow_info_t* cli_follow_info = (cli_follow_info_t*)follow_info->gui_data;
 
+  if (cli_follow_info->spool)
+    fclose(cli_follow_info->spool);
   g_free(cli_follow_info);
   follow_info_free(follow_info);
 }
@@ -103,7 +110,7 @@ follow_free(follow_info_t *follow_info)
 static const char       bin2hex[] = {'0', '1', '2', '3', '4', '5', '6', '7',
                                      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
 
-static void follow_print_hex(const char *prefixp, guint32 offset, void *datap, int len)
+static void follow_print_hex(FILE *fp, const char *prefixp, guint32 offset, void *datap, int len)
 {
   int           ii;
   int           jj;
@@ -150,12 +157,137 @@ static void follow_print_hex(const char *prefixp, guint32 offset, void *datap, i
         kk--;
       }
       line[kk] = 0;
-      printf("%s%s\n", prefixp, line);
+      fprintf(fp, "%s%s\n", prefixp, line);
       offset += BYTES_PER_LINE;
     }
   }
 }
 
+static void follow_print_record(FILE *fp, cli_follow_info_t *cli_follow_info, follow_record_t *follow_record)
+{
+  guint32          *global_pos;
+  guint32           ii, jj;
+  char              *buffer;
+  gchar             *b64encoded;
+  const guint32     base64_raw_len = 57; /* Encodes to 76 bytes, common in RFCs */
+
+  cli_follow_info->chunk++;
+  global_pos = &cli_follow_info->global_pos[follow_record->is_server ? 1 : 0];
+
+  /* ignore chunks not in range */
+  if ((cli_follow_info->chunk < cli_follow_info->chunkMin) || (cli_follow_info->chunk > cli_follow_info->chunkMax)) {
+    (*global_pos) += follow_record->data->len;
+    return;
+  }
+
+  /* Print start of line */
+  switch (cli_follow_info->show_type)
+  {
+  case SHOW_HEXDUMP:
+  case SHOW_YAML:
+    break;
+
+  case SHOW_ASCII:
+  case SHOW_EBCDIC:
+    fprintf(fp, "%s%u\n", follow_record->is_server ? "\t" : "", follow_record->data->len);
+    break;
+
+  case SHOW_RAW:
+    if (follow_record->is_server)
+    {
+      putc('\t', fp);
+    }
+    break;
+
+  default:
+    ws_assert_not_reached();
+  }
+
+  /* Print data */
+  switch (cli_follow_info->show_type)
+  {
+  case SHOW_HEXDUMP:
+    follow_print_hex(fp, follow_record->is_server ? "\t" : "", *global_pos, follow_record->data->data, follow_record->data->len);
+    (*global_pos) += follow_record->data->len;
+    break;
+
+  case SHOW_ASCII:
+  case SHOW_EBCDIC:
+    buffer = (char *)g_malloc(follow_record->data->len+2);
+
+    for (ii = 0; ii < follow_record->data->len; ii++)
+    {
+      switch (follow_record->data->data[ii])
+      {
+      case '\r':
+      case '\n':
+        buffer[ii] = follow_record->data->data[ii];
+        break;
+      default:
+        buffer[ii] = g_ascii_isprint(follow_record->data->data[ii]) ? follow_record->data->data[ii] : '.';
+        break;
+      }
+    }
+
+    buffer[ii++] = '\n';
+    buffer[ii] = 0;
+    if (cli_follow_info->show_type == SHOW_EBCDIC) {
+      EBCDIC_to_ASCII(buffer, ii);
+    }
+    fputs(buffer, fp);
+    g_free(buffer);
+    break;
+
+  case SHOW_RAW:
+    buffer = (char *)g_malloc((follow_record->data->len*2)+2);
+
+    for (ii = 0, jj = 0; ii < follow_record->data->len; ii++)
+    {
+      buffer[jj++] = bin2hex[follow_record->data->data[ii] >> 4];
+      buffer[jj++] = bin2hex[follow_record->data->data[ii] & 0xf];
+    }
+
+    buffer[jj++] = '\n';
+    buffer[jj] = 0;
+    fputs(buffer, fp);
+    g_free(buffer);
+    break;
+
+  case SHOW_YAML:
+    fprintf(fp, "  - packet: %d\n", follow_record->packet_num);
+    fprintf(fp, "    peer: %d\n", follow_record->is_server ? 1 : 0);
+    fprintf(fp, "    timestamp: %.9f\n", nstime_to_sec(&follow_record->abs_ts));
+    fprintf(fp, "    data: !!binary |\n");
+    ii = 0;
+    while (ii < follow_record->data->len) {
+        guint32 len = ii + base64_raw_len < follow_record->data->len
+              ? base64_raw_len
+              : follow_record->data->len - ii;
+        b64encoded = g_base64_encode(&follow_record->data->data[ii], len);
+        fprintf(fp, "      %s\n", b64encoded);
+        g_free(b64encoded);
+        ii += len;
+    }
+    break;
+
+  default:
+    ws_assert_not_reached();
+  }
+}
+
+/*
+ * Records are formatted into a temporary file as the tap delivers them,
+ * so the payload of a long stream isn't kept in memory until the end of
+ * the capture. The header needs the peer addresses, so the spool is
+ * copied to stdout when drawing.
+ */
+static void follow_spool_record(follow_info_t *follow_info, follow_record_t *follow_record)
+{
+  cli_follow_info_t* cli_follow_info = (cli_follow_info_t*)follow_info->gui_data;
+
+  follow_print_record(cli_follow_info->spool, cli_follow_info, follow_record);
+}
+
 static void follow_draw(void *contextp)
 {
   static const char     separator[] =
@@ -164,15 +296,9 @@ static void follow_draw(void *contextp)
   follow_info_t *follow_info = (follow_info_t*)contextp;
   cli_follow_info_t* cli_follow_info = (cli_follow_info_t*)follow_info->gui_data;
   gchar             buf[WS_INET6_ADDRSTRLEN];
-  guint32 global_client_pos = 0, global_server_pos = 0;
-  guint32 *global_pos;
-  guint32           ii, jj;
-  char              *buffer;
   GList             *cur;
-  follow_record_t   *follow_record;
-  guint             chunk;
-  gchar             *b64encoded;
-  const guint32     base64_raw_len = 57; /* Encodes to 76 bytes, common in RFCs */
+  char              copybuf[8192];
+  size_t            nread;
 
   /* Print header */
   switch (cli_follow_info->show_type)
@@ -209,115 +335,24 @@ static void follow_draw(void *contextp)
       break;
   }
 
-  for (cur = g_list_last(follow_info->payload), chunk = 1;
-       cur != NULL;
-       cur = g_list_previous(cur), chunk++)
+  if (cli_follow_info->spool)
   {
-    follow_record = (follow_record_t *)cur->data;
-    if (!follow_record->is_server) {
-      global_pos = &global_client_pos;
-    } else {
-      global_pos = &global_server_pos;
-    }
-
-    /* ignore chunks not in range */
-    if ((chunk < cli_follow_info->chunkMin) || (chunk > cli_follow_info->chunkMax)) {
-      (*global_pos) += follow_record->data->len;
-      continue;
-    }
-
-    /* Print start of line */
-    switch (cli_follow_info->show_type)
+    fflush(cli_follow_info->spool);
+    rewind(cli_follow_info->spool);
+    while ((nread = fread(copybuf, 1, sizeof copybuf, cli_follow_info->spool)) > 0)
     {
-    case SHOW_HEXDUMP:
-    case SHOW_YAML:
-      break;
-
-    case SHOW_ASCII:
-    case SHOW_EBCDIC:
-      printf("%s%u\n", follow_record->is_server ? "\t" : "", follow_record->data->len);
-      break;
-
-    case SHOW_RAW:
-      if (follow_record->is_server)
-      {
-        putchar('\t');
-      }
-      break;
-
-    default:
-      ws_assert_not_reached();
+      fwrite(copybuf, 1, nread, stdout);
     }
-
-    /* Print data */
-    switch (cli_follow_info->show_type)
+    /* Keep appending if more records arrive after this draw */
+    fseek(cli_follow_info->spool, 0, SEEK_END);
+  }
+  else
+  {
+    cli_follow_info->chunk = 0;
+    cli_follow_info->global_pos[0] = cli_follow_info->global_pos[1] = 0;
+    for (cur = g_list_last(follow_info->payload); cur != NULL; cur = g_list_previous(cur))
     {
-    case SHOW_HEXDUMP:
-      follow_print_hex(follow_record->is_server ? "\t" : "", *global_pos, follow_record->data->data, follow_record->data->len);
-      (*global_pos) += follow_record->data->len;
-      break;
-
-    case SHOW_ASCII:
-    case SHOW_EBCDIC:
-      buffer = (char *)g_malloc(follow_record->data->len+2);
-
-      for (ii = 0; ii < follow_record->data->len; ii++)
-      {
-        switch (follow_record->data->data[ii])
-        {
-        case '\r':
-        case '\n':
-          buffer[ii] = follow_record->data->data[ii];
-          break;
-        default:
-          buffer[ii] = g_ascii_isprint(follow_record->data->data[ii]) ? follow_record->data->data[ii] : '.';
-          break;
-        }
-      }
-
-      buffer[ii++] = '\n';
-      buffer[ii] = 0;
-      if (cli_follow_info->show_type == SHOW_EBCDIC) {
-        EBCDIC_to_ASCII(buffer, ii);
-      }
-      printf("%s", buffer);
-      g_free(buffer);
-      break;
-
-    case SHOW_RAW:
-      buffer = (char *)g_malloc((follow_record->data->len*2)+2);
-
-      for (ii = 0, jj = 0; ii < follow_record->data->len; ii++)
-      {
-        buffer[jj++] = bin2hex[follow_record->data->data[ii] >> 4];
-        buffer[jj++] = bin2hex[follow_record->data->data[ii] & 0xf];
-      }
-
-      buffer[jj++] = '\n';
-      buffer[jj] = 0;
-      printf("%s", buffer);
-      g_free(buffer);
-      break;
-
-    case SHOW_YAML:
-      printf("  - packet: %d\n", follow_record->packet_num);
-      printf("    peer: %d\n", follow_record->is_server ? 1 : 0);
-      printf("    timestamp: %.9f\n", nstime_to_sec(&follow_record->abs_ts));
-      printf("    data: !!binary |\n");
-      ii = 0;
-      while (ii < follow_record->data->len) {
-          guint32 len = ii + base64_raw_len < follow_record->data->len
-                ? base64_raw_len
-                : follow_record->data->len - ii;
-          b64encoded = g_base64_encode(&follow_record->data->data[ii], len);
-          printf("      %s\n", b64encoded);
-          g_free(b64encoded);
-          ii += len;
-      }
-      break;
-
-    default:
-      ws_assert_not_reached();
+      follow_print_record(stdout, cli_follow_info, (follow_record_t *)cur->data);
     }
   }
 
@@ -530,6 +565,13 @@ static void follow_stream(const char *opt_argp, void *userdata)
   follow_arg_range(&opt_argp, cli_follow_info);
   follow_arg_done(opt_argp);
 
+  /* Fall back to keeping the records in memory if there's no temporary file */
+  cli_follow_info->spool = tmpfile();
+  if (cli_follow_info->spool)
+  {
+    follow_info->record_cb = follow_spool_record;
+  }
+
   if (cli_follow_info->stream_index >= 0)
   {
     index_filter = get_follow_index_func(follower);
@@ -17,6 +17,7 @@
 #include <epan/packet.h>
 #include <epan/timestamp.h>
 #include <wsutil/str_util.h>
+#include <wsutil/strtoi.h>
 #include <ui/cmdarg_err.h>
 #include <ui/cli/tshark-tap.h>
 
@@ -35,6 +36,7 @@ iousers_draw(void *arg)
 	guint64 last_frames, max_frames;
 	struct tm * tm_time;
 	guint i;
+	conv_approx_stats_t approx;
 	gboolean display_ports = (!strncmp(iu->type, "TCP", 3) || !strncmp(iu->type, "UDP", 3) || !strncmp(iu->type, "SCTP", 4)) ? TRUE : FALSE;
 
 	printf("================================================================================\n");
@@ -229,6 +231,13 @@ iousers_draw(void *arg)
 		}
 		max_frames = last_frames;
 	} while (last_frames);
+	if (get_conversation_approx_stats(&iu->hash, &approx)) {
+		printf("Approximate: %u of ~%" G_GUINT64_FORMAT " conversations (+/-%.1f%%),"
+			" counts high by at most %" G_GUINT64_FORMAT " frames / %" G_GUINT64_FORMAT " bytes (%.0f%% confidence)\n",
+			iu->hash.conv_array ? iu->hash.conv_array->len : 0, approx.conversations,
+			approx.conversations_err * 100.0, approx.frames_err, approx.bytes_err,
+			approx.confidence * 100.0);
+	}
 	printf("================================================================================\n");
 }
 
@@ -236,11 +245,28 @@ void init_iousers(struct register_ct *ct, const char *filter)
 {
 	io_users_t *iu;
 	GString *error_string;
+	guint32 approx_items = 0;
+
+	/* conv,<type>,approx[=<items>][,<filter>] */
+	if (filter && strncmp(filter, "approx", 6) == 0 &&
+	    (filter[6] == '\0' || filter[6] == ',' || filter[6] == '=')) {
+		approx_items = CONV_APPROX_DEFAULT_ITEMS;
+		filter += 6;
+		if (*filter == '=') {
+			if (!ws_strtou32(filter + 1, &filter, &approx_items) || approx_items == 0 ||
+			    (*filter != '\0' && *filter != ',')) {
+				cmdarg_err("Invalid \"-z conv,...,approx=<items>\" argument");
+				exit(1);
+			}
+		}
+		filter = (*filter == ',') ? filter + 1 : NULL;
+	}
 
 	iu = g_new0(io_users_t, 1);
 	iu->type = proto_get_protocol_short_name(find_protocol_by_id(get_conversation_proto_id(ct)));
 	iu->filter = g_strdup(filter);
 	iu->hash.user_data = iu;
+	iu->hash.approx_max_items = approx_items;
 
 	error_string = register_tap_listener(proto_get_protocol_filter_name(get_conversation_proto_id(ct)), &iu->hash, filter, 0, NULL, get_conversation_packet_func(ct), iousers_draw, NULL);
 	if (error_string) {
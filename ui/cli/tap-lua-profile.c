@@ -0,0 +1,95 @@
+/* tap-lua-profile.c
+ * Per-dissector time and allocations of Lua dissectors for tshark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+#ifdef HAVE_LUA
+#include <epan/wslua/init_wslua.h>
+#endif
+
+void register_tap_listener_lua_profile(void);
+
+#ifdef HAVE_LUA
+static void
+lua_profile_reset(void *tapdata _U_)
+{
+    wslua_profiling_reset();
+}
+
+static void
+lua_profile_draw(void *tapdata _U_)
+{
+    gchar *report = wslua_profiling_format();
+
+    printf("\n");
+    printf("==================================================================================================\n");
+    printf("Lua Dissector Profile\n");
+    printf("--------------------------------------------------------------------------------------------------\n");
+    printf("%s", report);
+    printf("==================================================================================================\n");
+
+    g_free(report);
+}
+
+static void
+lua_profile_finish(void *tapdata _U_)
+{
+    wslua_profiling_enable(FALSE);
+}
+
+static void
+lua_profile_init(const char *opt_arg _U_, void *userdata _U_)
+{
+    GString *error_string;
+
+    /*
+     * As with dissector-profile, the "frame" tap only provides the reset
+     * and draw callbacks; wslua collects the numbers itself.
+     */
+    error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING,
+                                         lua_profile_reset,
+                                         NULL,
+                                         lua_profile_draw,
+                                         lua_profile_finish);
+    if (error_string) {
+        fprintf(stderr, "tshark: Couldn't register lua-profile tap: %s\n",
+                error_string->str);
+        g_string_free(error_string, TRUE);
+        exit(1);
+    }
+
+    wslua_profiling_reset();
+    wslua_profiling_enable(TRUE);
+}
+
+static stat_tap_ui lua_profile_ui = {
+    REGISTER_STAT_GROUP_GENERIC,
+    NULL,
+    "lua-profile",
+    lua_profile_init,
+    0,
+    NULL
+};
+#endif /* HAVE_LUA */
+
+void
+register_tap_listener_lua_profile(void)
+{
+#ifdef HAVE_LUA
+    register_stat_tap_ui(&lua_profile_ui, NULL);
+#endif
+}
@@ -0,0 +1,267 @@
+/* tap-pipeline-latency.c
+ * Per-stage packet latency histograms for tshark live captures
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+
+#include "tap-pipeline-latency.h"
+
+void register_tap_listener_pipeline_latency(void);
+
+/*
+ * A packet goes through these stages in a live capture:
+ *
+ *   captured  -> written:   dumpcap reads it and writes it to the capture
+ *                           file, and tells us over the sync pipe
+ *   written   -> read:      waiting for us to read it back
+ *   read      -> dissected
+ *   dissected -> output:    printing it
+ *
+ * "captured" is the packet's time stamp and "written" is when we heard
+ * from dumpcap, so the first stage is only as good as the clock sync
+ * between the capture device and us.
+ */
+typedef enum {
+    STAGE_WRITTEN,
+    STAGE_READ,
+    STAGE_DISSECTED,
+    STAGE_OUTPUT,
+    STAGE_TOTAL,
+    NUM_STAGES
+} pipeline_stage_e;
+
+static const char *stage_names[NUM_STAGES] = {
+    "capture->write",
+    "write->read",
+    "read->dissect",
+    "dissect->output",
+    "total"
+};
+
+/* Bucket i counts latencies in [2^(i-1), 2^i) microseconds; bucket 0 is < 1 us */
+#define NUM_BUCKETS 32
+
+typedef struct {
+    guint64 buckets[NUM_BUCKETS];
+    guint64 count;
+    guint64 sum;
+    guint64 max;
+} latency_hist_t;
+
+static gboolean enabled;
+static latency_hist_t stages[NUM_STAGES];
+
+/* Packets dumpcap reported in one go, i.e. waiting to be read */
+static latency_hist_t queue_depth;
+
+static gint64 written_real_time;
+static gint64 written_time;
+
+static void
+hist_add(latency_hist_t *hist, guint64 value)
+{
+    int bucket = 0;
+
+    while (bucket < NUM_BUCKETS - 1 && value >= (G_GUINT64_CONSTANT(1) << bucket))
+        bucket++;
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+/* Upper bound of the bucket holding the given fraction of the values */
+static guint64
+hist_percentile(const latency_hist_t *hist, double fraction)
+{
+    guint64 wanted = (guint64)(hist->count * fraction);
+    guint64 seen = 0;
+    int bucket;
+
+    for (bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+        seen += hist->buckets[bucket];
+        if (seen > wanted)
+            break;
+    }
+    if (bucket >= NUM_BUCKETS - 1)
+        return hist->max;
+    return MIN(G_GUINT64_CONSTANT(1) << bucket, hist->max);
+}
+
+gboolean
+pipeline_latency_enabled(void)
+{
+    return enabled;
+}
+
+void
+pipeline_latency_packets_written(int count)
+{
+    if (!enabled)
+        return;
+
+    written_real_time = g_get_real_time();
+    written_time = g_get_monotonic_time();
+    hist_add(&queue_depth, count > 0 ? (guint64)count : 0);
+}
+
+static void
+stage_add(pipeline_stage_e stage, gint64 from, gint64 to)
+{
+    hist_add(&stages[stage], to > from ? (guint64)(to - from) : 0);
+}
+
+void
+pipeline_latency_packet(const nstime_t *capture_ts, gint64 read_time,
+                        gint64 dissected_time, gint64 output_time)
+{
+    gint64 captured_real_time;
+
+    if (!enabled || written_time == 0)
+        return;
+
+    captured_real_time = (gint64)capture_ts->secs * G_USEC_PER_SEC + capture_ts->nsecs / 1000;
+
+    stage_add(STAGE_WRITTEN, captured_real_time, written_real_time);
+    stage_add(STAGE_READ, written_time, read_time);
+    stage_add(STAGE_DISSECTED, read_time, dissected_time);
+    stage_add(STAGE_OUTPUT, dissected_time, output_time);
+    stage_add(STAGE_TOTAL, captured_real_time, written_real_time + (output_time - written_time));
+}
+
+static void
+print_bucket_label(int bucket)
+{
+    char label[32];
+
+    if (bucket == 0)
+        snprintf(label, sizeof(label), "< 1");
+    else if (bucket == NUM_BUCKETS - 1)
+        snprintf(label, sizeof(label), ">= %" PRIu64, G_GUINT64_CONSTANT(1) << (bucket - 1));
+    else
+        snprintf(label, sizeof(label), "%" PRIu64 "-%" PRIu64,
+                 G_GUINT64_CONSTANT(1) << (bucket - 1), (G_GUINT64_CONSTANT(1) << bucket) - 1);
+    printf("%-22s", label);
+}
+
+void
+pipeline_latency_print(void)
+{
+    int stage, bucket, first = NUM_BUCKETS, last = -1;
+
+    printf("\n");
+    printf("=================================================================================================\n");
+    printf("Pipeline Latency (microseconds)\n");
+    if (stages[STAGE_TOTAL].count == 0) {
+        printf("No packets read from a live capture yet.\n");
+        printf("=================================================================================================\n");
+        return;
+    }
+
+    printf("Stage                   Packets        Mean         p50         p90         p99         Max\n");
+    printf("-------------------------------------------------------------------------------------------------\n");
+    for (stage = 0; stage < NUM_STAGES; stage++) {
+        const latency_hist_t *hist = &stages[stage];
+
+        printf("%-16s %14" PRIu64 " %11.1f %11" PRIu64 " %11" PRIu64 " %11" PRIu64 " %11" PRIu64 "\n",
+               stage_names[stage], hist->count,
+               hist->count ? (double)hist->sum / hist->count : 0.0,
+               hist_percentile(hist, 0.5), hist_percentile(hist, 0.9),
+               hist_percentile(hist, 0.99), hist->max);
+    }
+
+    for (stage = 0; stage < NUM_STAGES; stage++) {
+        for (bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+            if (stages[stage].buckets[bucket]) {
+                first = MIN(first, bucket);
+                last = MAX(last, bucket);
+            }
+        }
+    }
+    printf("\n");
+    printf("Latency              ");
+    for (stage = 0; stage < NUM_STAGES; stage++)
+        printf(" %16s", stage_names[stage]);
+    printf("\n");
+    for (bucket = first; bucket <= last; bucket++) {
+        print_bucket_label(bucket);
+        for (stage = 0; stage < NUM_STAGES; stage++)
+            printf(" %16" PRIu64, stages[stage].buckets[bucket]);
+        printf("\n");
+    }
+
+    printf("\n");
+    printf("Read queue depth: %" PRIu64 " batches, mean %.1f, p99 %" PRIu64 ", max %" PRIu64 " packets\n",
+           queue_depth.count,
+           queue_depth.count ? (double)queue_depth.sum / queue_depth.count : 0.0,
+           hist_percentile(&queue_depth, 0.99), queue_depth.max);
+    printf("=================================================================================================\n");
+}
+
+static void
+pipeline_latency_reset(void *tapdata _U_)
+{
+    memset(stages, 0, sizeof(stages));
+    memset(&queue_depth, 0, sizeof(queue_depth));
+}
+
+static void
+pipeline_latency_draw(void *tapdata _U_)
+{
+    pipeline_latency_print();
+}
+
+static void
+pipeline_latency_init(const char *opt_arg _U_, void *userdata _U_)
+{
+    GString *error_string;
+
+    /*
+     * As with dissector-profile, the "frame" tap only provides the reset
+     * and draw callbacks; tshark hands us the time stamps directly.
+     */
+    error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING,
+                                         pipeline_latency_reset,
+                                         NULL,
+                                         pipeline_latency_draw,
+                                         NULL);
+    if (error_string) {
+        fprintf(stderr, "tshark: Couldn't register pipeline-latency tap: %s\n",
+                error_string->str);
+        g_string_free(error_string, TRUE);
+        exit(1);
+    }
+
+    enabled = TRUE;
+}
+
+static stat_tap_ui pipeline_latency_ui = {
+    REGISTER_STAT_GROUP_GENERIC,
+    NULL,
+    "pipeline-latency",
+    pipeline_latency_init,
+    0,
+    NULL
+};
+
+void
+register_tap_listener_pipeline_latency(void)
+{
+    register_stat_tap_ui(&pipeline_latency_ui, NULL);
+}
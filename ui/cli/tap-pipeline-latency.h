@@ -0,0 +1,56 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __TAP_PIPELINE_LATENCY_H__
+#define __TAP_PIPELINE_LATENCY_H__
+
+#include <wsutil/nstime.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* TRUE if "-z pipeline-latency" was given */
+gboolean pipeline_latency_enabled(void);
+
+/*
+ * Called by tshark when dumpcap reports that it has written count more
+ * packets, before they are read.
+ */
+void pipeline_latency_packets_written(int count);
+
+/*
+ * Called by tshark for each packet read during a live capture, with the
+ * packet's capture time stamp and the g_get_monotonic_time() times at
+ * which it was read, dissected and output.
+ */
+void pipeline_latency_packet(const nstime_t *capture_ts, gint64 read_time,
+                             gint64 dissected_time, gint64 output_time);
+
+/* Print the histograms so far, e.g. on SIGUSR1 */
+void pipeline_latency_print(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TAP_PIPELINE_LATENCY_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
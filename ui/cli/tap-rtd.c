@@ -29,6 +29,18 @@ typedef struct _rtd_t {
 	rtd_data_t rtd;
 } rtd_t;
 
+static const gdouble rtd_percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+static void
+print_rtd_percentiles(const timestat_t *stats)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(rtd_percentiles); i++)
+		printf(" %8.2f msec |", time_stat_percentile(stats, rtd_percentiles[i]));
+	printf("\n");
+}
+
 static void
 rtd_draw(void *arg)
 {
@@ -48,28 +60,29 @@ rtd_draw(void *arg)
 		printf("Duplicate responses: %u\n", rtd_data->stat_table.time_stats[0].rsp_dup_num);
 		printf("Open requests: %u\n", rtd_data->stat_table.time_stats[0].open_req_num);
 		printf("Discarded responses: %u\n", rtd_data->stat_table.time_stats[0].disc_rsp_num);
-		printf("Type    | Messages   |    Min RTD    |    Max RTD    |    Avg RTD    | Min in Frame | Max in Frame |\n");
+		printf("Type    | Messages   |    Min RTD    |    Max RTD    |    Avg RTD    | Min in Frame | Max in Frame |    p50 RTD    |    p90 RTD    |    p99 RTD    |   p99.9 RTD   |\n");
 		for (i=0; i<rtd_data->stat_table.time_stats[0].num_timestat; i++) {
 			if (rtd_data->stat_table.time_stats[0].rtd[i].num) {
 				tmp_str = val_to_str_wmem(NULL, i, rtd->vs_type, "Other (%d)");
-				printf("%s | %7u    | %8.2f msec | %8.2f msec | %8.2f msec |  %10u  |  %10u  |\n",
+				printf("%s | %7u    | %8.2f msec | %8.2f msec | %8.2f msec |  %10u  |  %10u  |",
 						tmp_str, rtd_data->stat_table.time_stats[0].rtd[i].num,
 						nstime_to_msec(&(rtd_data->stat_table.time_stats[0].rtd[i].min)), nstime_to_msec(&(rtd_data->stat_table.time_stats[0].rtd[i].max)),
 						get_average(&(rtd_data->stat_table.time_stats[0].rtd[i].tot), rtd_data->stat_table.time_stats[0].rtd[i].num),
 						rtd_data->stat_table.time_stats[0].rtd[i].min_num, rtd_data->stat_table.time_stats[0].rtd[i].max_num
 				);
+				print_rtd_percentiles(&rtd_data->stat_table.time_stats[0].rtd[i]);
 				wmem_free(NULL, tmp_str);
 			}
 		}
 	}
 	else
 	{
-		printf("Type    | Messages   |    Min RTD    |    Max RTD    |    Avg RTD    | Min in Frame | Max in Frame | Open Requests | Discarded responses | Duplicate requests | Duplicate responses\n");
+		printf("Type    | Messages   |    Min RTD    |    Max RTD    |    Avg RTD    | Min in Frame | Max in Frame | Open Requests | Discarded responses | Duplicate requests | Duplicate responses |    p50 RTD    |    p90 RTD    |    p99 RTD    |   p99.9 RTD   |\n");
 		for (i=0; i<rtd_data->stat_table.num_rtds; i++) {
 			for (j=0; j<rtd_data->stat_table.time_stats[i].num_timestat; j++) {
 				if (rtd_data->stat_table.time_stats[i].rtd[j].num) {
 					tmp_str = val_to_str_wmem(NULL, i, rtd->vs_type, "Other (%d)");
-					printf("%s | %7u    | %8.2f msec | %8.2f msec | %8.2f msec |  %10u  |  %10u  |  %10u  |  %10u  | %4u (%4.2f%%) | %4u (%4.2f%%)  |\n",
+					printf("%s | %7u    | %8.2f msec | %8.2f msec | %8.2f msec |  %10u  |  %10u  |  %10u  |  %10u  | %4u (%4.2f%%) | %4u (%4.2f%%)  |",
 							tmp_str, rtd_data->stat_table.time_stats[i].rtd[j].num,
 							nstime_to_msec(&(rtd_data->stat_table.time_stats[i].rtd[j].min)), nstime_to_msec(&(rtd_data->stat_table.time_stats[i].rtd[j].max)),
 							get_average(&(rtd_data->stat_table.time_stats[i].rtd[j].tot), rtd_data->stat_table.time_stats[i].rtd[j].num),
@@ -80,6 +93,7 @@ rtd_draw(void *arg)
 							rtd_data->stat_table.time_stats[i].rsp_dup_num,
 							rtd_data->stat_table.time_stats[i].rtd[j].num?((double)rtd_data->stat_table.time_stats[i].rsp_dup_num*100)/(double)rtd_data->stat_table.time_stats[i].rtd[j].num:0
 					);
+					print_rtd_percentiles(&rtd_data->stat_table.time_stats[i].rtd[j]);
 					wmem_free(NULL, tmp_str);
 				}
 			}
@@ -28,16 +28,19 @@ typedef struct _srt_t {
 	srt_data_t data;
 } srt_t;
 
+static const gdouble srt_percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
 static void
 draw_srt_table_data(srt_stat_table *rst, gboolean draw_footer)
 {
 	int i;
 	guint64 td;
 	guint64 sum;
+	guint j;
 
 	if (rst->num_procs > 0) {
 		printf("Filter: %s\n", rst->filter_string ? rst->filter_string : "");
-		printf("Index  %-22s Calls    Min SRT    Max SRT    Avg SRT    Sum SRT\n", (rst->proc_column_name != NULL) ? rst->proc_column_name : "Procedure");
+		printf("Index  %-22s Calls    Min SRT    Max SRT    Avg SRT    Sum SRT    p50 SRT    p90 SRT    p99 SRT  p99.9 SRT\n", (rst->proc_column_name != NULL) ? rst->proc_column_name : "Procedure");
 	}
 	for(i=0;i<rst->num_procs;i++){
 		/* ignore procedures with no calls (they don't have rows) */
@@ -53,7 +56,7 @@ draw_srt_table_data(srt_stat_table *rst, gboolean draw_footer)
 		sum = (td + 500) / 1000;
 		td = ((td / rst->procedures[i].stats.num) + 500) / 1000;
 
-		printf("%5d  %-22s %6u %3d.%06d %3d.%06d %3d.%06d %3d.%06d\n",
+		printf("%5d  %-22s %6u %3d.%06d %3d.%06d %3d.%06d %3d.%06d",
 		       i, rst->procedures[i].procedure,
 		       rst->procedures[i].stats.num,
 		       (int)rst->procedures[i].stats.min.secs, (rst->procedures[i].stats.min.nsecs+500)/1000,
@@ -61,6 +64,12 @@ draw_srt_table_data(srt_stat_table *rst, gboolean draw_footer)
 		       (int)(td/1000000), (int)(td%1000000),
 		       (int)(sum/1000000), (int)(sum%1000000)
 		);
+		for (j = 0; j < G_N_ELEMENTS(srt_percentiles); j++) {
+			/* msec, rounded to the nearest us */
+			td = (guint64)(time_stat_percentile(&rst->procedures[i].stats, srt_percentiles[j]) * 1000 + 0.5);
+			printf(" %3d.%06d", (int)(td/1000000), (int)(td%1000000));
+		}
+		printf("\n");
 	}
 
 	if (draw_footer)
@@ -97,6 +97,7 @@ init_stats_tree(const char *opt_arg, void *userdata _U_)
 		report_failure("stats_tree for: %s failed to attach to the tap: %s", cfg->name, error_string->str);
 		return;
 	}
+	set_tap_merge(st, stats_tree_merge);
 
 	if (cfg->init) cfg->init(st);
 
@@ -142,6 +142,8 @@ commandline_print_usage(gboolean for_help_option) {
     fprintf(output, "                           enable dissection of heuristic protocol\n");
     fprintf(output, "  --disable-heuristic <short_name>\n");
     fprintf(output, "                           disable dissection of heuristic protocol\n");
+    fprintf(output, "  --worker-threads <count>\n");
+    fprintf(output, "                           threads for parallel work; 0 for one per processor\n");
 
     fprintf(output, "\n");
     fprintf(output, "User interface:\n");
@@ -578,6 +580,7 @@ void commandline_other_options(int argc, char *argv[], gboolean opt_reset)
             case LONGOPT_ENABLE_HEURISTIC: /* enable heuristic dissection of protocol */
             case LONGOPT_DISABLE_HEURISTIC: /* disable heuristic dissection of protocol */
             case LONGOPT_ENABLE_PROTOCOL: /* enable dissection of protocol (that is disabled by default) */
+            case LONGOPT_WORKER_THREADS: /* threads for parallel work */
                 if (!dissect_opts_handle_opt(opt, ws_optarg))
                    exit_application(1);
                 break;
@@ -33,6 +33,7 @@
 #include <ui/clopts_common.h>
 #include <ui/cmdarg_err.h>
 #include <wsutil/file_util.h>
+#include <wsutil/task_pool.h>
 #include <wsutil/ws_assert.h>
 
 #include "ui/dissect_opts.h"
@@ -145,6 +146,10 @@ dissect_opts_handle_opt(int opt, char *optarg_str_p)
     case LONGOPT_ENABLE_PROTOCOL: /* enable dissection of protocol (that is disableed by default) */
         global_dissect_options.enable_protocol_slist = g_slist_append(global_dissect_options.enable_protocol_slist, optarg_str_p);
         break;
+    case LONGOPT_WORKER_THREADS: /* number of threads for parallel work, overriding the preference */
+        prefs.worker_threads = get_natural_int(optarg_str_p, "worker threads");
+        task_pool_set_max_threads(prefs.worker_threads);
+        break;
     default:
         /* the caller is responsible to send us only the right opt's */
         ws_assert_not_reached();
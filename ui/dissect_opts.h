@@ -33,6 +33,7 @@ extern "C" {
 #define LONGOPT_ENABLE_HEURISTIC  LONGOPT_BASE_DISSECTOR+2
 #define LONGOPT_DISABLE_HEURISTIC LONGOPT_BASE_DISSECTOR+3
 #define LONGOPT_ENABLE_PROTOCOL   LONGOPT_BASE_DISSECTOR+4
+#define LONGOPT_WORKER_THREADS    LONGOPT_BASE_DISSECTOR+5
 
 /*
  * Options for dissecting common to all dissecting programs.
@@ -42,6 +43,7 @@ extern "C" {
     {"enable-heuristic", ws_required_argument, NULL, LONGOPT_ENABLE_HEURISTIC }, \
     {"disable-heuristic", ws_required_argument, NULL, LONGOPT_DISABLE_HEURISTIC }, \
     {"enable-protocol", ws_required_argument, NULL, LONGOPT_ENABLE_PROTOCOL }, \
+    {"worker-threads", ws_required_argument, NULL, LONGOPT_WORKER_THREADS }, \
 
 #define OPTSTRING_DISSECT_COMMON \
     "d:K:nN:t:u:"
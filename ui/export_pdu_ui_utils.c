@@ -64,7 +64,8 @@ do_export_pdu(const char *filter, const gchar *temp_dir, const gchar *tap_name)
     /* ...with this comment */
     comment = ws_strdup_printf("Dump of PDUs from %s", cfile.filename);
     status = exp_pdu_open(&exp_pdu_tap_data, capfile_name, file_type_subtype,
-                          import_file_fd, comment, &err, &err_info);
+                          WTAP_UNCOMPRESSED, import_file_fd, comment,
+                          &err, &err_info);
     g_free(comment);
     if (!status) {
         cfile_dump_open_failure_alert_box(capfile_name ? capfile_name : "temporary file",
@@ -188,9 +188,39 @@ process_record(capture_file *cf, frame_data *frame, column_info *cinfo,
 ph_stats_new(capture_file *cf)
 {
     ph_stats_t	*ps;
+
+    if (!cf) return NULL;
+
+    pc_proto_id = proto_registrar_get_id_byname("pkt_comment");
+
+    /* Initialize the data */
+    ps = g_new(ph_stats_t, 1);
+    ps->tot_packets = 0;
+    ps->tot_bytes = 0;
+    ps->stats_tree = g_node_new(NULL);
+    ps->first_time = 0.0;
+    ps->last_time = 0.0;
+    ps->last_frame = 0;
+
+    if (!ph_stats_update(cf, ps)) {
+        /*
+         * We quit in the middle; throw away the statistics
+         * and return NULL, so our caller doesn't pop up a
+         * window with the incomplete statistics.
+         */
+        ph_stats_free(ps);
+        return NULL;
+    }
+
+    return ps;
+}
+
+gboolean
+ph_stats_update(capture_file *cf, ph_stats_t *ps)
+{
     guint32	framenum;
     frame_data	*frame;
-    guint	tot_packets, tot_bytes;
+    guint32	to_process;
     progdlg_t	*progbar = NULL;
     gboolean	stop_flag;
     int		count;
@@ -201,23 +231,17 @@ ph_stats_new(capture_file *cf)
     int		progbar_nextstep;
     int		progbar_quantum;
 
-    if (!cf) return NULL;
-
-    pc_proto_id = proto_registrar_get_id_byname("pkt_comment");
+    if (!cf || !ps) return FALSE;
 
-    /* Initialize the data */
-    ps = g_new(ph_stats_t, 1);
-    ps->tot_packets = 0;
-    ps->tot_bytes = 0;
-    ps->stats_tree = g_node_new(NULL);
-    ps->first_time = 0.0;
-    ps->last_time = 0.0;
+    /* Nothing arrived since the last update. */
+    if (ps->last_frame >= cf->count) return TRUE;
+    to_process = cf->count - ps->last_frame;
 
     /* Update the progress bar when it gets to this value. */
     progbar_nextstep = 0;
     /* When we reach the value that triggers a progress bar update,
        bump that value by this amount. */
-    progbar_quantum = cf->count/N_PROGBAR_UPDATES;
+    progbar_quantum = to_process/N_PROGBAR_UPDATES;
     /* Count of packets at which we've looked. */
     count = 0;
     /* Progress so far. */
@@ -225,13 +249,10 @@ ph_stats_new(capture_file *cf)
 
     stop_flag = FALSE;
 
-    tot_packets = 0;
-    tot_bytes = 0;
-
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
 
-    for (framenum = 1; framenum <= cf->count; framenum++) {
+    for (framenum = ps->last_frame + 1; framenum <= cf->count; framenum++) {
         frame = frame_data_sequence_find(cf->provider.frames, framenum);
 
         /* Create the progress bar if necessary.
@@ -256,13 +277,13 @@ ph_stats_new(capture_file *cf)
             /* let's not divide by zero. I should never be started
              * with count == 0, so let's assert that
              */
-            ws_assert(cf->count > 0);
+            ws_assert(to_process > 0);
 
-            progbar_val = (gfloat) count / cf->count;
+            progbar_val = (gfloat) count / to_process;
 
             if (progbar != NULL) {
                 snprintf(status_str, sizeof(status_str),
-                        "%4u of %u frames", count, cf->count);
+                        "%4u of %u frames", count, to_process);
                 update_progress_dlg(progbar, progbar_val, status_str);
             }
 
@@ -283,7 +304,7 @@ ph_stats_new(capture_file *cf)
         if (frame->passed_dfilter) {
 
             if (frame->has_ts) {
-                if (tot_packets == 0) {
+                if (ps->tot_packets == 0) {
                     double cur_time = nstime_to_sec(&frame->abs_ts);
                     ps->first_time = cur_time;
                     ps->last_time = cur_time;
@@ -301,10 +322,13 @@ ph_stats_new(capture_file *cf)
                 break;
             }
 
-            tot_packets++;
-            tot_bytes += frame->pkt_len;
+            ps->tot_packets++;
+            ps->tot_bytes += frame->pkt_len;
         }
 
+        /* Everything up to here is in the statistics, so a later
+           update can carry on from the next frame. */
+        ps->last_frame = framenum;
         count++;
     }
 
@@ -316,20 +340,7 @@ ph_stats_new(capture_file *cf)
     if (progbar != NULL)
         destroy_progress_dlg(progbar);
 
-    if (stop_flag) {
-        /*
-         * We quit in the middle; throw away the statistics
-         * and return NULL, so our caller doesn't pop up a
-         * window with the incomplete statistics.
-         */
-        ph_stats_free(ps);
-        return NULL;
-    }
-
-    ps->tot_packets = tot_packets;
-    ps->tot_bytes = tot_bytes;
-
-    return ps;
+    return !stop_flag;
 }
 
     static gboolean
@@ -36,10 +36,31 @@ typedef struct {
     GNode	*stats_tree;
     double	first_time;	/* seconds (msec resolution) of first packet */
     double	last_time;	/* seconds (msec resolution) of last packet  */
+    guint32	last_frame;	/* number of the last frame looked at */
 } ph_stats_t;
 
+/** Compute the statistics for all the frames in the capture file.
+ *
+ * @param cf The capture file.
+ * @return The statistics, or NULL if the user aborted the computation
+ * or a frame couldn't be read.
+ */
 ph_stats_t *ph_stats_new(capture_file *cf);
 
+/** Add the frames that were appended to the capture file since the
+ * statistics were computed or last updated, e.g. during a live capture,
+ * without going over the earlier ones again. The frames' display filter
+ * state must not have changed in the meantime; if it has, start over
+ * with ph_stats_new().
+ *
+ * @param cf The capture file the statistics were computed from.
+ * @param ps The statistics to update.
+ * @return TRUE if every new frame was added, FALSE if the user aborted
+ * or a frame couldn't be read. The statistics then cover the frames up
+ * to last_frame and remain usable.
+ */
+gboolean ph_stats_update(capture_file *cf, ph_stats_t *ps);
+
 void ph_stats_free(ph_stats_t *ps);
 
 #ifdef __cplusplus
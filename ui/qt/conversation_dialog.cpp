@@ -68,6 +68,7 @@ ConversationDialog::ConversationDialog(QWidget &parent, CaptureFile &cf, int cli
             this, SLOT(displayFilterSuccess(bool)));
 
     absoluteTimeCheckBox()->show();
+    approximateCheckBox()->show();
 
     addProgressFrame(&parent);
 
@@ -188,6 +189,7 @@ bool ConversationDialog::addTrafficTable(register_ct_t* table)
     }
 
     conv_tree->trafficTreeHash()->user_data = conv_tree;
+    conv_tree->trafficTreeHash()->approx_max_items = approximateCheckBox()->isChecked() ? CONV_APPROX_DEFAULT_ITEMS : 0;
 
     registerTapListener(proto_get_protocol_filter_name(proto_id), conv_tree->trafficTreeHash(), filter, 0,
                         ConversationTreeWidget::tapReset,
@@ -304,6 +306,23 @@ void ConversationDialog::on_displayFilterCheckBox_toggled(bool checked)
     cap_file_.retapPackets();
 }
 
+void ConversationDialog::on_approximateCheckBox_toggled(bool checked)
+{
+    if (file_closed_) {
+        return;
+    }
+
+    // Takes effect on the next (empty) table, i.e. after the retap resets it.
+    for (int i = 0; i < trafficTableTabWidget()->count(); i++) {
+        TrafficTableTreeWidget *cur_tree = qobject_cast<TrafficTableTreeWidget *>(trafficTableTabWidget()->widget(i));
+        if (cur_tree) {
+            cur_tree->trafficTreeHash()->approx_max_items = checked ? CONV_APPROX_DEFAULT_ITEMS : 0;
+        }
+    }
+
+    cap_file_.retapPackets();
+}
+
 void ConversationDialog::on_buttonBox_helpRequested()
 {
     wsApp->helpTopicAction(HELP_STATS_CONVERSATIONS_DIALOG);
@@ -749,7 +768,10 @@ void ConversationTreeWidget::updateItems() {
     bool resize = topLevelItemCount() < resizeThreshold();
     title_ = proto_get_protocol_short_name(find_protocol_by_id(get_conversation_proto_id(table_)));
 
-    if (hash_.conv_array && hash_.conv_array->len > 0) {
+    conv_approx_stats_t approx;
+    if (get_conversation_approx_stats(&hash_, &approx) && approx.conversations > hash_.conv_array->len) {
+        title_.append(QString(" %1 %2 / ~%3").arg(UTF8_MIDDLE_DOT).arg(hash_.conv_array->len).arg(approx.conversations));
+    } else if (hash_.conv_array && hash_.conv_array->len > 0) {
         title_.append(QString(" %1 %2").arg(UTF8_MIDDLE_DOT).arg(hash_.conv_array->len));
     }
     emit titleChanged(this, title_);
@@ -74,6 +74,7 @@ private slots:
     void currentTabChanged();
     void conversationSelectionChanged();
     void on_displayFilterCheckBox_toggled(bool checked);
+    void on_approximateCheckBox_toggled(bool checked);
     void followStream();
     void graphTcp();
     void on_buttonBox_helpRequested();
@@ -33,6 +33,11 @@ ConversationHashTablesDialog::ConversationHashTablesDialog(QWidget *parent) :
 
     html += "<h3>Conversation Hash Tables</h3>\n";
 
+    guint64 cache_hits, cache_misses;
+    conversation_get_lookup_cache_stats(&cache_hits, &cache_misses);
+    html += QString("<p>Per-packet lookup cache: %1 hits, %2 misses</p>\n")
+            .arg(cache_hits).arg(cache_misses);
+
     html += hashTableToHtmlTable("conversation_hashtable_exact", get_conversation_hashtable_exact());
     html += hashTableToHtmlTable("conversation_hashtable_no_addr2", get_conversation_hashtable_no_addr2());
     html += hashTableToHtmlTable("conversation_hashtable_no_port2", get_conversation_hashtable_no_port2());
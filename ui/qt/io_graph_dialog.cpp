@@ -1929,14 +1929,19 @@ void IOGraph::recalcGraphData(capture_file *cap_file, bool enable_scaling)
     QCPAxis *x_axis = nullptr;
 
     if (graph_) {
-        graph_->data()->clear();
         x_axis = graph_->keyAxis();
     }
     if (bars_) {
-        bars_->data()->clear();
         x_axis = bars_->keyAxis();
     }
 
+    // Look up each item once. The moving average needs most of them more
+    // than once, and some value units are expensive to compute.
+    QVector<double> item_values(cur_idx_ + 1);
+    for (int i = 0; i <= cur_idx_; i++) {
+        item_values[i] = getItemValue(i, cap_file);
+    }
+
     if (moving_avg_period_ > 0 && cur_idx_ >= 0) {
         /* "Warm-up phase" - calculate average on some data not displayed;
          * just to make sure average on leftmost and rightmost displayed
@@ -1949,26 +1954,33 @@ void IOGraph::recalcGraphData(capture_file *cap_file, bool enable_scaling)
 //            mavg_in_average_count++;
 //            mavg_left++;
 //        }
-        mavg_cumulated += getItemValue((int)warmup_interval/interval_, cap_file);
+        mavg_cumulated += item_values[(int)warmup_interval/interval_];
         mavg_in_average_count++;
         for (warmup_interval = interval_;
             ((warmup_interval < (0 + (moving_avg_period_ / 2) * (guint64)interval_)) &&
              (warmup_interval <= (cur_idx_ * (guint64)interval_)));
              warmup_interval += interval_) {
 
-            mavg_cumulated += getItemValue((int)warmup_interval / interval_, cap_file);
+            mavg_cumulated += item_values[(int)warmup_interval / interval_];
             mavg_in_average_count++;
             mavg_right++;
         }
         mavg_to_add = (unsigned int)warmup_interval;
     }
 
+    // Hand the points over in one go. Adding them one at a time makes
+    // QCustomPlot check and possibly reallocate its container each time.
+    QVector<double> keys, values;
+    keys.reserve(cur_idx_ + 1);
+    values.reserve(cur_idx_ + 1);
+    bool datetime_ticker = x_axis && qSharedPointerDynamicCast<QCPAxisTickerDateTime>(x_axis->ticker());
+
     for (int i = 0; i <= cur_idx_; i++) {
         double ts = (double) i * interval_ / 1000;
-        if (x_axis && qSharedPointerDynamicCast<QCPAxisTickerDateTime>(x_axis->ticker())) {
+        if (datetime_ticker) {
             ts += start_time_;
         }
-        double val = getItemValue(i, cap_file);
+        double val = item_values[i];
 
         if (moving_avg_period_ > 0) {
             if (i != 0) {
@@ -1976,12 +1988,12 @@ void IOGraph::recalcGraphData(capture_file *cap_file, bool enable_scaling)
                 if (mavg_left > moving_avg_period_ / 2) {
                     mavg_left--;
                     mavg_in_average_count--;
-                    mavg_cumulated -= getItemValue((int)mavg_to_remove / interval_, cap_file);
+                    mavg_cumulated -= item_values[(int)mavg_to_remove / interval_];
                     mavg_to_remove += interval_;
                 }
                 if (mavg_to_add <= (unsigned int) cur_idx_ * interval_) {
                     mavg_in_average_count++;
-                    mavg_cumulated += getItemValue((int)mavg_to_add / interval_, cap_file);
+                    mavg_cumulated += item_values[(int)mavg_to_add / interval_];
                     mavg_to_add += interval_;
                 } else {
                     mavg_right--;
@@ -1996,16 +2008,22 @@ void IOGraph::recalcGraphData(capture_file *cap_file, bool enable_scaling)
 
         if (hasItemToShow(i, val))
         {
-            if (graph_) {
-                graph_->addData(ts, val);
-            }
-            if (bars_) {
-                bars_->addData(ts, val);
-            }
+            keys << ts;
+            values << val;
         }
 //        qDebug() << "=rgd i" << i << ts << val;
     }
 
+    // Keys are in ascending order. Line and scatter graphs keep their
+    // default adaptive sampling, which draws visible points as per pixel
+    // minimum / maximum pairs when there are more intervals than pixels.
+    if (graph_) {
+        graph_->setData(keys, values, true);
+    }
+    if (bars_) {
+        bars_->setData(keys, values, true);
+    }
+
     // attempt to rescale time values to specific units
     if (enable_scaling) {
         calculateScaledValueUnit();
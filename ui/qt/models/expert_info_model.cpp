@@ -10,97 +10,57 @@
 
 #include "expert_info_model.h"
 
+#include <string.h>
+
 #include "file.h"
 #include <epan/proto.h>
 
-ExpertPacketItem::ExpertPacketItem(const expert_info_t& expert_info, column_info *cinfo, ExpertPacketItem* parent) :
-    packet_num_(expert_info.packet_num),
-    group_(expert_info.group),
-    severity_(expert_info.severity),
-    hf_id_(expert_info.hf_index),
-    protocol_(expert_info.protocol),
-    summary_(expert_info.summary),
-    parentItem_(parent)
-{
-    if (cinfo) {
-        info_ = col_get_text(cinfo, COL_INFO);
-    }
-}
-
-ExpertPacketItem::~ExpertPacketItem()
-{
-    for (int row = 0; row < childItems_.count(); row++)
-    {
-        delete childItems_.value(row);
-    }
-
-    childItems_.clear();
-}
-
-QString ExpertPacketItem::groupKey(bool group_by_summary, int severity, int group, QString protocol, int expert_hf)
+ExpertPacketItem::ExpertPacketItem() :
+    packet_num_(0),
+    group_(-1),
+    severity_(-1),
+    hf_id_(-1),
+    protocol_(""),
+    summary_(""),
+    info_("")
 {
-    QString key = QString("%1|%2|%3")
-            .arg(severity)
-            .arg(group)
-            .arg(protocol);
-    if (group_by_summary) {
-        key += QString("|%1").arg(expert_hf);
-    }
-    return key;
-}
-
-QString ExpertPacketItem::groupKey(bool group_by_summary) {
-    return groupKey(group_by_summary, severity_, group_, protocol_, hf_id_);
 }
 
-void ExpertPacketItem::appendChild(ExpertPacketItem* child, QString hash)
+ExpertPacketItem::ExpertPacketItem(unsigned int packet_num, int group, int severity, int hf_id,
+                                   const char *protocol, const char *summary, const char *info) :
+    packet_num_(packet_num),
+    group_(group),
+    severity_(severity),
+    hf_id_(hf_id),
+    protocol_(protocol),
+    summary_(summary),
+    info_(info)
 {
-    childItems_.append(child);
-    hashChild_[hash] = child;
 }
 
-ExpertPacketItem* ExpertPacketItem::child(int row)
-{
-    return childItems_.value(row);
-}
-
-ExpertPacketItem* ExpertPacketItem::child(QString hash)
-{
-    return hashChild_[hash];
-}
-
-int ExpertPacketItem::childCount() const
-{
-    return childItems_.count();
-}
-
-int ExpertPacketItem::row() const
-{
-    if (parentItem_)
-        return parentItem_->childItems_.indexOf(const_cast<ExpertPacketItem*>(this));
-
-    return 0;
-}
-
-ExpertPacketItem* ExpertPacketItem::parentItem()
-{
-    return parentItem_;
-}
 
 
 
+// Top-level rows have an internal ID of 0, and the rows of a group's
+// events the group's row plus one.
 
 ExpertInfoModel::ExpertInfoModel(CaptureFile& capture_file, QObject *parent) :
     QAbstractItemModel(parent),
     capture_file_(capture_file),
     group_by_summary_(true),
-    root_(createRootItem())
+    strings_(g_string_chunk_new(64 * 1024)),
+    last_severity_(-1),
+    last_group_id_(-1),
+    last_hf_id_(-1),
+    last_protocol_(NULL),
+    last_summary_group_(-1),
+    last_group_(-1)
 {
 }
 
 ExpertInfoModel::~ExpertInfoModel()
 {
-    delete root_;
+    g_string_chunk_free(strings_);
 }
 
 void ExpertInfoModel::clear()
@@ -108,27 +68,48 @@ void ExpertInfoModel::clear()
     emit beginResetModel();
 
     eventCounts_.clear();
-    delete root_;
-    root_ = createRootItem();
+    events_.clear();
+    summary_groups_.clear();
+    groups_.clear();
+    summary_group_index_.clear();
+    group_index_.clear();
+    g_string_chunk_clear(strings_);
+    last_protocol_ = NULL;
+    last_summary_group_ = -1;
+    last_group_ = -1;
 
     emit endResetModel();
 }
 
-ExpertPacketItem* ExpertInfoModel::createRootItem()
+int ExpertInfoModel::numEvents(enum ExpertSeverity severity)
 {
-    static const char* rootName = "ROOT";
-DIAG_OFF_CAST_AWAY_CONST
-    static expert_info_t root_expert = { 0, -1, -1, -1, rootName, (gchar*)rootName, NULL };
-DIAG_ON_CAST_AWAY_CONST
-
-    return new ExpertPacketItem(root_expert, NULL, NULL);
+    return eventCounts_[severity];
 }
 
+ExpertPacketItem ExpertInfoModel::item(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return ExpertPacketItem();
 
+    const QVector<ExpertGroup> &groups = topGroups();
+    if (index.internalId() == 0) {
+        if (index.row() >= groups.count())
+            return ExpertPacketItem();
 
-int ExpertInfoModel::numEvents(enum ExpertSeverity severity)
-{
-    return eventCounts_[severity];
+        const ExpertGroup &group = groups.at(index.row());
+        const ExpertEvent &first = events_.at(group.events.first());
+        return ExpertPacketItem(first.packet_num, group.group, group.severity, group.hf_id,
+                                group.protocol, group.summary, first.info);
+    }
+
+    int group_row = (int) index.internalId() - 1;
+    if (group_row >= groups.count() || index.row() >= groups.at(group_row).events.count())
+        return ExpertPacketItem();
+
+    const ExpertEvent &event = events_.at(groups.at(group_row).events.at(index.row()));
+    const ExpertGroup &summary_group = summary_groups_.at(event.summary_group);
+    return ExpertPacketItem(event.packet_num, summary_group.group, summary_group.severity,
+                            summary_group.hf_id, summary_group.protocol, event.summary, event.info);
 }
 
 QModelIndex ExpertInfoModel::index(int row, int column, const QModelIndex& parent) const
@@ -136,91 +117,22 @@ QModelIndex ExpertInfoModel::index(int row, int column, const QModelIndex& paren
     if (!hasIndex(row, column, parent))
         return QModelIndex();
 
-    ExpertPacketItem *parent_item, *child_item;
-
     if (!parent.isValid())
-        parent_item = root_;
-    else
-        parent_item = static_cast<ExpertPacketItem*>(parent.internalPointer());
-
-    Q_ASSERT(parent_item);
-    if (group_by_summary_) {
-        //don't allow group layer
-        if (parent_item == root_) {
-            int row_count = 0;
-            ExpertPacketItem *grandchild_item;
-
-            for (int subrow = 0; subrow < parent_item->childCount(); subrow++) {
-                child_item = parent_item->child(subrow);
-                //summary children are always stored in first child of group
-                grandchild_item = child_item->child(0);
-
-                if (row_count+grandchild_item->childCount() > row) {
-                    return createIndex(row, column, grandchild_item->child(row-row_count));
-                }
-                row_count += grandchild_item->childCount();
-            }
-
-            //shouldn't happen
-            return QModelIndex();
-        }
+        return createIndex(row, column, (quintptr) 0);
 
-        int root_level = 0;
-        ExpertPacketItem *item = parent_item;
-        while (item != root_)
-        {
-            root_level++;
-            item = item->parentItem();
-        }
+    //only allow 2 levels deep
+    if (parent.internalId() == 0)
+        return createIndex(row, column, (quintptr) parent.row() + 1);
 
-        if (root_level == 3) {
-            child_item = parent_item->child(row);
-            if (child_item) {
-                return createIndex(row, column, child_item);
-            }
-        }
-
-    } else {
-        child_item = parent_item->child(row);
-        if (child_item) {
-            //only allow 2 levels deep
-            if (((parent_item == root_) || (parent_item->parentItem() == root_)))
-                return createIndex(row, column, child_item);
-        }
-    }
     return QModelIndex();
 }
 
 QModelIndex ExpertInfoModel::parent(const QModelIndex& index) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || index.internalId() == 0)
         return QModelIndex();
 
-    ExpertPacketItem *item = static_cast<ExpertPacketItem*>(index.internalPointer());
-    ExpertPacketItem *parent_item = item->parentItem();
-
-    if (group_by_summary_)
-    {
-        //don't allow group layer
-        int root_level = 0;
-        item = parent_item;
-        while ((item != root_) && (item != NULL))
-        {
-            root_level++;
-            item = item->parentItem();
-        }
-
-        if (root_level == 3)
-            return createIndex(parent_item->row(), 0, parent_item);
-
-    } else {
-        if (parent_item == root_)
-            return QModelIndex();
-
-        return createIndex(parent_item->row(), 0, parent_item);
-    }
-
-    return QModelIndex();
+    return createIndex((int) index.internalId() - 1, 0, (quintptr) 0);
 }
 
 #if 0
@@ -242,58 +154,57 @@ QVariant ExpertInfoModel::data(const QModelIndex &index, int role) const
     if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::ToolTipRole))
         return QVariant();
 
-    ExpertPacketItem* item = static_cast<ExpertPacketItem*>(index.internalPointer());
-    if (item == NULL)
-        return QVariant();
+    ExpertPacketItem item = this->item(index);
+    bool is_group = index.internalId() == 0;
 
     if (role == Qt::ToolTipRole)
     {
-        QString filterName = proto_registrar_get_abbrev(item->hfId());
+        QString filterName = proto_registrar_get_abbrev(item.hfId());
         return filterName;
     }
     else if (role == Qt::DisplayRole)
     {
         switch ((enum ExpertColumn)index.column()) {
         case colSeverity:
-            return QString(val_to_str_const(item->severity(), expert_severity_vals, "Unknown"));
+            return QString(val_to_str_const(item.severity(), expert_severity_vals, "Unknown"));
         case colSummary:
-            if (index.parent().isValid())
+            if (!is_group)
             {
-                if (item->severity() == PI_COMMENT)
-                    return item->summary().simplified();
+                if (item.severity() == PI_COMMENT)
+                    return item.summary().simplified();
                 if (group_by_summary_)
-                    return item->colInfo().simplified();
+                    return item.colInfo().simplified();
 
-                return item->summary().simplified();
+                return item.summary().simplified();
             }
             else
             {
                 if (group_by_summary_)
                 {
-                    if (item->severity() == PI_COMMENT)
+                    if (item.severity() == PI_COMMENT)
                         return "Packet comments listed below.";
-                    if (item->hfId() != -1) {
-                        return proto_registrar_get_name(item->hfId());
+                    if (item.hfId() != -1) {
+                        return proto_registrar_get_name(item.hfId());
                     } else {
-                        return item->summary().simplified();
+                        return item.summary().simplified();
                     }
                 }
             }
             return QVariant();
         case colGroup:
-            return QString(val_to_str_const(item->group(), expert_group_vals, "Unknown"));
+            return QString(val_to_str_const(item.group(), expert_group_vals, "Unknown"));
         case colProtocol:
-            return item->protocol();
+            return item.protocol();
         case colCount:
-            if (!index.parent().isValid())
+            if (is_group)
             {
-                return item->childCount();
+                return rowCount(index);
             }
             break;
         case colPacket:
-            return item->packetNum();
+            return item.packetNum();
         case colHf:
-            return item->hfId();
+            return item.hfId();
         default:
             break;
         }
@@ -312,38 +223,15 @@ void ExpertInfoModel::setGroupBySummary(bool group_by_summary)
 
 int ExpertInfoModel::rowCount(const QModelIndex &parent) const
 {
-    ExpertPacketItem *parent_item;
     if (parent.column() > 0)
         return 0;
 
     if (!parent.isValid())
-        parent_item = root_;
-    else
-        parent_item = static_cast<ExpertPacketItem*>(parent.internalPointer());
-
-    if (group_by_summary_) {
-        int row_count = 0;
-
-        //don't allow group layer
-        if (parent_item == root_) {
-            ExpertPacketItem *child_item, *grandchild_item;
-
-            for (int row = 0; row < parent_item->childCount(); row++) {
-                child_item = parent_item->child(row);
-                grandchild_item = child_item->child(0);
-                row_count += grandchild_item->childCount();
-            }
+        return topGroups().count();
 
-            return row_count;
-        }
-
-        return parent_item->childCount();
-
-    } else {
-        //only allow 2 levels deep
-        if ((parent_item == root_) || (parent_item->parentItem() == root_))
-            return parent_item->childCount();
-    }
+    //only allow 2 levels deep
+    if (parent.internalId() == 0 && parent.row() < topGroups().count())
+        return topGroups().at(parent.row()).events.count();
 
     return 0;
 }
@@ -353,37 +241,68 @@ int ExpertInfoModel::columnCount(const QModelIndex&) const
     return colLast;
 }
 
-void ExpertInfoModel::addExpertInfo(const struct expert_info_s& expert_info)
+int ExpertInfoModel::findGroup(QVector<ExpertGroup> &groups, QHash<GroupKey, int> &index,
+                               const GroupKey &key, int hf_id, const char *summary)
 {
-    QString groupKey = ExpertPacketItem::groupKey(FALSE, expert_info.severity, expert_info.group, QString(expert_info.protocol), expert_info.hf_index);
-    QString summaryKey = ExpertPacketItem::groupKey(TRUE, expert_info.severity, expert_info.group, QString(expert_info.protocol), expert_info.hf_index);
-
-    ExpertPacketItem* expert_root = root_->child(groupKey);
-    if (expert_root == NULL) {
-        ExpertPacketItem *new_item = new ExpertPacketItem(expert_info, &(capture_file_.capFile()->cinfo), root_);
-
-        root_->appendChild(new_item, groupKey);
+    QHash<GroupKey, int>::const_iterator it = index.constFind(key);
+    if (it != index.constEnd())
+        return it.value();
+
+    ExpertGroup group;
+    group.severity = key.first.first;
+    group.group = key.first.second;
+    group.hf_id = hf_id;
+    group.protocol = (const char *) key.second.second;
+    group.summary = summary;
+    groups.append(group);
+    index.insert(key, groups.count() - 1);
+    return groups.count() - 1;
+}
 
-        expert_root = new_item;
+void ExpertInfoModel::addExpertInfo(const struct expert_info_s& expert_info)
+{
+    ExpertEvent event;
+    const char *summary = expert_info.summary ? expert_info.summary : "";
+    const char *info = "";
+
+    if (capture_file_.capFile()) {
+        info = col_get_text(&capture_file_.capFile()->cinfo, COL_INFO);
+        if (!info)
+            info = "";
     }
 
-    ExpertPacketItem *expert = new ExpertPacketItem(expert_info, &(capture_file_.capFile()->cinfo), expert_root);
-    expert_root->appendChild(expert, groupKey);
-
-    //add the summary children off of the first child of the root children
-    ExpertPacketItem* summary_root = expert_root->child(0);
-
-    //make a summary child
-    ExpertPacketItem* expert_summary_root = summary_root->child(summaryKey);
-    if (expert_summary_root == NULL) {
-        ExpertPacketItem *new_summary = new ExpertPacketItem(expert_info, &(capture_file_.capFile()->cinfo), summary_root);
+    event.packet_num = expert_info.packet_num;
+    // Summaries repeat a lot; the Info column is the same for all the
+    // expert infos of a packet.
+    event.summary = g_string_chunk_insert_const(strings_, summary);
+    if (!events_.isEmpty() && events_.last().packet_num == event.packet_num &&
+            strcmp(events_.last().info, info) == 0) {
+        event.info = events_.last().info;
+    } else {
+        event.info = g_string_chunk_insert(strings_, info);
+    }
 
-        summary_root->appendChild(new_summary, summaryKey);
-        expert_summary_root = new_summary;
+    if (last_summary_group_ < 0 || expert_info.severity != last_severity_ ||
+            expert_info.group != last_group_id_ || expert_info.hf_index != last_hf_id_ ||
+            expert_info.protocol != last_protocol_) {
+        const char *protocol = g_intern_string(expert_info.protocol ? expert_info.protocol : "");
+        GroupKey key(qMakePair(expert_info.severity, expert_info.group),
+                     qMakePair(expert_info.hf_index, (quintptr) protocol));
+
+        last_summary_group_ = findGroup(summary_groups_, summary_group_index_, key,
+                                        expert_info.hf_index, event.summary);
+        key.second.first = -1;
+        last_group_ = findGroup(groups_, group_index_, key, expert_info.hf_index, event.summary);
+        last_severity_ = expert_info.severity;
+        last_group_id_ = expert_info.group;
+        last_hf_id_ = expert_info.hf_index;
+        last_protocol_ = expert_info.protocol;
     }
 
-    ExpertPacketItem *expert_summary = new ExpertPacketItem(expert_info, &(capture_file_.capFile()->cinfo), expert_summary_root);
-    expert_summary_root->appendChild(expert_summary, summaryKey);
+    event.summary_group = last_summary_group_;
+    events_.append(event);
+    summary_groups_[last_summary_group_].events.append(events_.count() - 1);
+    groups_[last_group_].events.append(events_.count() - 1);
 }
 
 void ExpertInfoModel::tapReset(void *eid_ptr)
@@ -15,8 +15,9 @@
 #include <config.h>
 
 #include <QAbstractItemModel>
-#include <QList>
-#include <QMap>
+#include <QHash>
+#include <QPair>
+#include <QVector>
 
 #include <ui/qt/capture_file.h>
 
@@ -24,11 +25,15 @@
 #include <epan/tap.h>
 #include <epan/column-utils.h>
 
+// One row of the model, as looked at by the proxy model and the view:
+// a group, standing for its first item, or a single item. Rows are made
+// up from the model's compact storage when they're asked for.
 class ExpertPacketItem
 {
 public:
-    ExpertPacketItem(const expert_info_t& expert_info, column_info *cinfo, ExpertPacketItem* parent);
-    virtual ~ExpertPacketItem();
+    ExpertPacketItem();
+    ExpertPacketItem(unsigned int packet_num, int group, int severity, int hf_id,
+                     const char *protocol, const char *summary, const char *info);
 
     unsigned int packetNum() const { return packet_num_; }
     int group() const { return group_; }
@@ -38,30 +43,14 @@ public:
     QString summary() const { return summary_; }
     QString colInfo() const { return info_; }
 
-    static QString groupKey(bool group_by_summary, int severity, int group, QString protocol, int expert_hf);
-    QString groupKey(bool group_by_summary);
-
-    void appendChild(ExpertPacketItem* child, QString hash);
-    ExpertPacketItem* child(int row);
-    ExpertPacketItem* child(QString hash);
-    int childCount() const;
-    int row() const;
-    ExpertPacketItem* parentItem();
-
 private:
     unsigned int packet_num_;
     int group_;
     int severity_;
     int hf_id_;
-    // Half-hearted attempt at conserving memory. If this isn't sufficient,
-    // PacketListRecord interns column strings in a GStringChunk.
-    QByteArray protocol_;
-    QByteArray summary_;
-    QByteArray info_;
-
-    QList<ExpertPacketItem*> childItems_;
-    ExpertPacketItem* parentItem_;
-    QHash<QString, ExpertPacketItem*> hashChild_;    //optimization for insertion
+    const char *protocol_;
+    const char *summary_;
+    const char *info_;
 };
 
 class ExpertInfoModel : public QAbstractItemModel
@@ -102,6 +91,9 @@ public:
 
     int numEvents(enum ExpertSeverity severity);
 
+    // The row at index, or an empty item if there's none.
+    ExpertPacketItem item(const QModelIndex &index) const;
+
     void clear();
 
     //GUI helpers
@@ -116,13 +108,54 @@ public:
     static void tapDraw(void *eid_ptr);
 
 private:
-    CaptureFile& capture_file_;
+    // Expert infos are kept as an array of these, rather than as a tree
+    // of objects; a capture can have tens of millions of them.
+    struct ExpertEvent {
+        guint32 packet_num;
+        int summary_group;          // index in summary_groups_
+        const char *summary;        // in strings_
+        const char *info;           // in strings_
+    };
 
-    ExpertPacketItem* createRootItem();
+    // Expert infos with the same severity, group and protocol, and,
+    // when grouping by summary, the same expert field. Each is a
+    // top-level row; the rows of its events are only made up when
+    // it's expanded.
+    struct ExpertGroup {
+        int severity;
+        int group;
+        int hf_id;                  // of the first event
+        const char *protocol;       // interned
+        const char *summary;        // of the first event
+        QVector<quint32> events;    // indices in events_, in frame order
+    };
+
+    // Severity and group, expert field (-1 when not grouping by
+    // summary), and interned protocol name.
+    typedef QPair<QPair<int, int>, QPair<int, quintptr> > GroupKey;
+
+    CaptureFile& capture_file_;
 
     bool group_by_summary_;
-    ExpertPacketItem* root_;
+    struct _GStringChunk *strings_;
+    QVector<ExpertEvent> events_;
+    QVector<ExpertGroup> summary_groups_;
+    QVector<ExpertGroup> groups_;
+    QHash<GroupKey, int> summary_group_index_;
+    QHash<GroupKey, int> group_index_;
+    // The last event added, whose groups are usually also those of the
+    // next one.
+    int last_severity_;
+    int last_group_id_;
+    int last_hf_id_;
+    const char *last_protocol_;
+    int last_summary_group_;
+    int last_group_;
 
     QHash<enum ExpertSeverity, int> eventCounts_;
+
+    const QVector<ExpertGroup> &topGroups() const { return group_by_summary_ ? summary_groups_ : groups_; }
+    static int findGroup(QVector<ExpertGroup> &groups, QHash<GroupKey, int> &index,
+                         const GroupKey &key, int hf_id, const char *summary);
 };
 #endif // EXPERT_INFO_MODEL_H
@@ -21,32 +21,25 @@ ExpertInfoProxyModel::ExpertInfoProxyModel(QObject *parent) : QSortFilterProxyMo
 
 bool ExpertInfoProxyModel::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const
 {
-    ExpertPacketItem *left_item,
-                     *right_item;
-    QString leftStr, rightStr;
+    ExpertInfoModel *model = static_cast<ExpertInfoModel*>(sourceModel());
     bool checkPacketNumber = false;
     int compare_ret;
 
-    if (source_left.parent().isValid() && source_right.parent().isValid()) {
-        left_item = static_cast<ExpertPacketItem*>(source_left.parent().internalPointer());
-        right_item = static_cast<ExpertPacketItem*>(source_right.parent().internalPointer());
-    } else {
-        left_item = static_cast<ExpertPacketItem*>(source_left.internalPointer());
-        right_item = static_cast<ExpertPacketItem*>(source_right.internalPointer());
-    }
+    if (model != NULL) {
+        ExpertPacketItem left_item = model->item(source_left),
+                         right_item = model->item(source_right);
 
-    if ((left_item != NULL) && (right_item != NULL)) {
         switch (source_left.column())
         {
         case colProxySeverity:
-            if (left_item->severity() != right_item->severity()) {
-                return (left_item->severity() < right_item->severity());
+            if (left_item.severity() != right_item.severity()) {
+                return (left_item.severity() < right_item.severity());
             }
 
             checkPacketNumber = true;
             break;
         case colProxySummary:
-            compare_ret = left_item->summary().compare(right_item->summary());
+            compare_ret = left_item.summary().compare(right_item.summary());
             if (compare_ret < 0)
                 return true;
             if (compare_ret > 0)
@@ -55,14 +48,14 @@ bool ExpertInfoProxyModel::lessThan(const QModelIndex &source_left, const QModel
             checkPacketNumber = true;
             break;
         case colProxyGroup:
-            if (left_item->group() != right_item->group()) {
-                return (left_item->group() < right_item->group());
+            if (left_item.group() != right_item.group()) {
+                return (left_item.group() < right_item.group());
             }
 
             checkPacketNumber = true;
             break;
         case colProxyProtocol:
-            compare_ret = left_item->protocol().compare(right_item->protocol());
+            compare_ret = left_item.protocol().compare(right_item.protocol());
             if (compare_ret < 0)
                 return true;
             if (compare_ret > 0)
@@ -77,7 +70,7 @@ bool ExpertInfoProxyModel::lessThan(const QModelIndex &source_left, const QModel
         }
 
         if (checkPacketNumber) {
-            return (left_item->packetNum() < right_item->packetNum());
+            return (left_item.packetNum() < right_item.packetNum());
         }
     }
 
@@ -99,12 +92,10 @@ QVariant ExpertInfoProxyModel::data(const QModelIndex &proxy_index, int role) co
         if (!source_index.isValid() || source_index.parent().isValid())
             return QVariant();
 
-        ExpertPacketItem* item = static_cast<ExpertPacketItem*>(source_index.internalPointer());
-        if (item == NULL)
-            return QVariant();
+        ExpertPacketItem item = static_cast<ExpertInfoModel*>(sourceModel())->item(source_index);
 
         // provide background color for groups
-        switch(item->severity()) {
+        switch(item.severity()) {
         case(PI_COMMENT):
             return QBrush(ColorUtils::expert_color_comment);
         case(PI_CHAT):
@@ -126,12 +117,10 @@ QVariant ExpertInfoProxyModel::data(const QModelIndex &proxy_index, int role) co
         if (!source_index.isValid() || source_index.parent().isValid())
             return QVariant();
 
-        ExpertPacketItem* item = static_cast<ExpertPacketItem*>(source_index.internalPointer());
-        if (item == NULL)
-            return QVariant();
+        ExpertPacketItem item = static_cast<ExpertInfoModel*>(sourceModel())->item(source_index);
 
         // provide foreground color for groups
-        switch(item->severity()) {
+        switch(item.severity()) {
         case(PI_COMMENT):
         case(PI_CHAT):
         case(PI_NOTE):
@@ -175,15 +164,18 @@ QVariant ExpertInfoProxyModel::data(const QModelIndex &proxy_index, int role) co
         case colProxyCount:
             //only show counts for parent
             if (!source_index.parent().isValid()) {
+                ExpertInfoModel *model = static_cast<ExpertInfoModel*>(sourceModel());
+                int rows = model->rowCount(source_index);
+
+                //the items of a group all have its severity, so only
+                //a text filter can hide some of them
+                if (textFilter_.isEmpty())
+                    return filterAcceptItem(model->item(source_index)) ? rows : 0;
+
                 //because of potential filtering, count is computed manually
                 unsigned int count = 0;
-                ExpertPacketItem *child_item,
-                                 *item = static_cast<ExpertPacketItem*>(source_index.internalPointer());
-                for (int row = 0; row < item->childCount(); row++) {
-                    child_item = item->child(row);
-                    if (child_item == NULL)
-                        continue;
-                    if (filterAcceptItem(*child_item))
+                for (int row = 0; row < rows; row++) {
+                    if (filterAcceptItem(model->item(model->index(row, 0, source_index))))
                         count++;
                 }
 
@@ -226,7 +218,7 @@ int ExpertInfoProxyModel::columnCount(const QModelIndex&) const
     return colProxyLast;
 }
 
-bool ExpertInfoProxyModel::filterAcceptItem(ExpertPacketItem& item) const
+bool ExpertInfoProxyModel::filterAcceptItem(const ExpertPacketItem& item) const
 {
     if (hidden_severities_.contains(item.severity()))
         return false;
@@ -253,11 +245,8 @@ bool ExpertInfoProxyModel::filterAcceptItem(ExpertPacketItem& item) const
 bool ExpertInfoProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
     QModelIndex severityIdx = sourceModel()->index(sourceRow, ExpertInfoModel::colSeverity, sourceParent);
-    ExpertPacketItem* item = static_cast<ExpertPacketItem*>(severityIdx.internalPointer());
-    if (item == NULL)
-        return true;
 
-    return filterAcceptItem(*item);
+    return filterAcceptItem(static_cast<ExpertInfoModel*>(sourceModel())->item(severityIdx));
 }
 
 //GUI helpers
@@ -49,7 +49,7 @@ public:
 
 protected:
     bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const;
-    bool filterAcceptItem(ExpertPacketItem& item) const;
+    bool filterAcceptItem(const ExpertPacketItem& item) const;
 
     enum SeverityMode severityMode_;
     QList<int> hidden_severities_;
@@ -8,6 +8,7 @@
  */
 
 #include <algorithm>
+#include <numeric>
 #include <glib.h>
 
 #include "packet_list_model.h"
@@ -19,6 +20,7 @@
 #include <epan/prefs.h>
 
 #include "ui/packet_list_utils.h"
+#include "ui/progress_dlg.h"
 #include "ui/recent.h"
 
 #include <epan/color_filters.h>
@@ -36,6 +38,10 @@
 #include <QFontMetrics>
 #include <QModelIndex>
 #include <QElapsedTimer>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QtNumeric>
 
 // Print timing information
 //#define DEBUG_PACKET_LIST_MODEL 1
@@ -71,7 +77,16 @@ PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
     number_to_row_(QVector<int>()),
     max_row_height_(0),
     max_line_count_(1),
-    idle_dissection_row_(0)
+    sort_key_column_(-1),
+    sort_key_data_ver_(0),
+    sorting_(false),
+    sort_stop_flag_(FALSE),
+    pending_sort_column_(-1),
+    pending_sort_order_(Qt::AscendingOrder),
+    idle_dissection_row_(0),
+    prefetch_first_(-1),
+    prefetch_row_(0),
+    prefetch_end_(0)
 {
     Q_ASSERT(glbl_plist_model == Q_NULLPTR);
     glbl_plist_model = this;
@@ -108,6 +123,10 @@ PacketListModel::~PacketListModel()
 
 void PacketListModel::setCaptureFile(capture_file *cf)
 {
+    if (cf != cap_file_) {
+        sort_stop_flag_ = TRUE;
+        clearSortKeys();
+    }
     cap_file_ = cf;
 }
 
@@ -158,10 +177,16 @@ guint PacketListModel::recreateVisibleRows()
         endInsertRows();
     }
     idle_dissection_row_ = 0;
+    prefetch_first_ = -1;
+    prefetch_row_ = prefetch_end_ = 0;
     return visible_rows_.count();
 }
 
 void PacketListModel::clear() {
+    // A sort in progress must not touch the records after this.
+    sort_stop_flag_ = TRUE;
+    pending_sort_column_ = -1;
+    clearSortKeys();
     emit beginResetModel();
     qDeleteAll(physical_rows_);
     physical_rows_.resize(0);
@@ -172,6 +197,8 @@ void PacketListModel::clear() {
     max_row_height_ = 0;
     max_line_count_ = 1;
     idle_dissection_row_ = 0;
+    prefetch_first_ = -1;
+    prefetch_row_ = prefetch_end_ = 0;
 }
 
 void PacketListModel::invalidateAllColumnStrings()
@@ -299,11 +326,11 @@ void PacketListModel::toggleFrameRefTime(const QModelIndex &rt_index)
         fdata->ref_time=1;
         cap_file_->ref_time_count++;
     }
-    cf_reftime_packets(cap_file_);
+    guint32 last_frame = cf_reftime_packet_changed(cap_file_, fdata);
     if (!fdata->ref_time && !fdata->passed_dfilter) {
         cap_file_->displayed_count--;
     }
-    record->resetColumns(&cap_file_->cinfo);
+    PacketListRecord::invalidateFrameDataColumns(fdata->num, last_frame);
     emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
 }
 
@@ -342,11 +369,105 @@ capture_file *PacketListModel::sort_cap_file_;
 
 QElapsedTimer busy_timer_;
 const int busy_timeout_ = 65; // ms, approximately 15 fps
+
+namespace {
+
+// A row as sorted by sortTextColumn: the key of the record's column string
+// and its frame number, which breaks ties.
+struct SortEntry {
+    double key;
+    guint32 num;
+    PacketListRecord *record;
+};
+
+// Orders entries the way recordLessThan used to order records: keys that
+// aren't numbers (NaN) before all others, equal keys by frame number.
+struct SortEntryLess {
+    bool ascending;
+
+    bool operator()(const SortEntry &e1, const SortEntry &e2) const {
+        bool ok1 = !qIsNaN(e1.key);
+        bool ok2 = !qIsNaN(e2.key);
+        int cmp_val;
+
+        if (ok1 != ok2) {
+            cmp_val = ok1 ? 1 : -1;
+        } else if (ok1 && e1.key != e2.key) {
+            cmp_val = e1.key < e2.key ? -1 : 1;
+        } else {
+            cmp_val = e1.num < e2.num ? -1 : e1.num > e2.num;
+        }
+        return ascending ? cmp_val < 0 : cmp_val > 0;
+    }
+};
+
+class SortChunkTask : public QRunnable
+{
+public:
+    SortChunkTask(SortEntry *first, SortEntry *last, const SortEntryLess &less) :
+        first_(first), last_(last), less_(less) {}
+
+    void run() {
+        std::sort(first_, last_, less_);
+    }
+
+private:
+    SortEntry *first_;
+    SortEntry *last_;
+    SortEntryLess less_;
+};
+
+// Fewer entries per thread than this aren't worth the overhead.
+const int min_sort_chunk_ = 1 << 16;
+
+// Sorts chunks of the entries on their own threads, then merges them.
+void sortEntries(QVector<SortEntry> &entries, const SortEntryLess &less)
+{
+    int count = entries.count();
+    int chunks = qMin(QThread::idealThreadCount(), count / min_sort_chunk_);
+
+    if (chunks < 2) {
+        std::sort(entries.begin(), entries.end(), less);
+        return;
+    }
+
+    SortEntry *data = entries.data();
+    QVector<int> bounds;
+    for (int i = 0; i <= chunks; i++) {
+        bounds << (int) ((qint64) count * i / chunks);
+    }
+
+    // Our own pool, so that we don't wait for anything else.
+    QThreadPool pool;
+    pool.setMaxThreadCount(chunks);
+    for (int i = 0; i < chunks; i++) {
+        pool.start(new SortChunkTask(data + bounds[i], data + bounds[i + 1], less));
+    }
+    pool.waitForDone();
+
+    for (int step = 1; step < chunks; step *= 2) {
+        for (int i = 0; i + step < chunks; i += 2 * step) {
+            int last = qMin(i + 2 * step, chunks);
+            std::inplace_merge(data + bounds[i], data + bounds[i + step], data + bounds[last], less);
+        }
+    }
+}
+
+} // namespace
 void PacketListModel::sort(int column, Qt::SortOrder order)
 {
     if (!cap_file_ || visible_rows_.count() < 1) return;
     if (column < 0) return;
 
+    if (sorting_) {
+        // Another header was clicked while we were looking up the keys.
+        // Stop and start over with the new column once we're back.
+        pending_sort_column_ = column;
+        pending_sort_order_ = order;
+        sort_stop_flag_ = TRUE;
+        return;
+    }
+
     sort_column_ = column;
     text_sort_column_ = PacketListRecord::textColumn(column);
     sort_order_ = order;
@@ -354,8 +475,6 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
 
     QString col_title = get_column_title(column);
 
-    // XXX Use updateProgress instead. We'd have to switch from std::sort to
-    // something we can interrupt.
     if (!col_title.isEmpty()) {
         QString busy_msg = tr("Sorting \"%1\"…").arg(col_title);
         wsApp->pushStatus(WiresharkApplication::BusyStatus, busy_msg);
@@ -363,7 +482,20 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
 
     busy_timer_.start();
     sort_column_is_numeric_ = isNumericColumn(sort_column_);
-    std::sort(physical_rows_.begin(), physical_rows_.end(), recordLessThan);
+    if (text_sort_column_ < 0) {
+        std::sort(physical_rows_.begin(), physical_rows_.end(), recordLessThan);
+    } else if (!sortTextColumn()) {
+        // Stopped. The rows are as they were.
+        if (!col_title.isEmpty()) {
+            wsApp->popStatus(WiresharkApplication::BusyStatus);
+        }
+        if (cap_file_ && pending_sort_column_ >= 0) {
+            int pending_column = pending_sort_column_;
+            pending_sort_column_ = -1;
+            sort(pending_column, pending_sort_order_);
+        }
+        return;
+    }
 
     emit beginResetModel();
     visible_rows_.resize(0);
@@ -471,47 +603,144 @@ bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
         wsApp->processEvents(QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers, 1);
         busy_timer_.restart();
     }
+    // Text columns are sorted on precomputed keys by sortTextColumn.
     if (sort_column_ < 0) {
         // No column.
         cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
-    } else if (text_sort_column_ < 0) {
+    } else {
         // Column comes directly from frame data
         cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), sort_cap_file_->cinfo.columns[sort_column_].col_fmt);
-    } else  {
-        if (r1->columnString(sort_cap_file_, sort_column_).constData() == r2->columnString(sort_cap_file_, sort_column_).constData()) {
-            cmp_val = 0;
-        } else if (sort_column_is_numeric_) {
-            // Custom column with numeric data (or something like a port number).
-            // Attempt to convert to numbers.
-            // XXX This is slow. Can we avoid doing this?
-            bool ok_r1, ok_r2;
-            double num_r1 = parseNumericColumn(r1->columnString(sort_cap_file_, sort_column_), &ok_r1);
-            double num_r2 = parseNumericColumn(r2->columnString(sort_cap_file_, sort_column_), &ok_r2);
-
-            if (!ok_r1 && !ok_r2) {
-                cmp_val = 0;
-            } else if (!ok_r1 || (ok_r2 && num_r1 < num_r2)) {
-                // either r1 is invalid (and sort it before others) or both
-                // r1 and r2 are valid (sort normally)
-                cmp_val = -1;
-            } else if (!ok_r2 || (num_r1 > num_r2)) {
-                cmp_val = 1;
+    }
+
+    if (sort_order_ == Qt::AscendingOrder) {
+        return cmp_val < 0;
+    } else {
+        return cmp_val > 0;
+    }
+}
+
+// Sorts physical_rows_ on the text column sort_column_. The string of each
+// record is looked up once, dissecting the packet if needed, and turned into
+// a key: its value for numeric columns, otherwise its rank among the distinct
+// strings of the column. Only the keys are compared, on several threads for
+// large captures. The keys are kept for the next sort of the same column.
+//
+// Dissection can't leave the main thread, so the lookup is the part that
+// shows progress and that can be stopped, by the user or by the packet list
+// changing under us. Returns false in that case, with physical_rows_ as it was.
+bool PacketListModel::sortTextColumn()
+{
+    unsigned data_ver = PacketListRecord::columnDataVersion();
+    progdlg_t *progbar = NULL;
+    bool stopped = false;
+
+    if (sort_key_column_ != sort_column_ || sort_key_data_ver_ != data_ver) {
+        clearSortKeys();
+        sort_key_column_ = sort_column_;
+        sort_key_data_ver_ = data_ver;
+    }
+
+    // A finished lookup has a key for every frame up to the last one it saw.
+    int known_keys = sort_keys_.count();
+
+    sorting_ = true;
+    sort_stop_flag_ = FALSE;
+    for (int row = 0; row < physical_rows_.count(); row++) {
+        if (busy_timer_.elapsed() > busy_timeout_) {
+            gfloat progress = (gfloat) row / physical_rows_.count();
+            if (!progbar) {
+                QString col_title = get_column_title(sort_column_);
+                progbar = delayed_create_progress_dlg(cap_file_->window, qUtf8Printable(tr("Sorting")),
+                                                      qUtf8Printable(col_title), TRUE, &sort_stop_flag_, progress);
+            } else {
+                update_progress_dlg(progbar, progress, NULL);
+            }
+            if (!progbar) {
+                wsApp->processEvents(QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers, 1);
             }
+            busy_timer_.restart();
+
+            // Events were processed; the rows and strings may be gone.
+            if (sort_stop_flag_ || cap_file_ != sort_cap_file_ || data_ver != PacketListRecord::columnDataVersion()) {
+                stopped = true;
+                break;
+            }
+        }
+
+        PacketListRecord *record = physical_rows_[row];
+        int idx = record->frameData()->num - 1;
+        if (idx < known_keys) {
+            continue;
+        }
+        if (idx >= sort_keys_.count()) {
+            sort_keys_.resize(idx + 1);
+        }
+
+        const QString col_str = record->columnString(sort_cap_file_, sort_column_);
+        if (sort_column_is_numeric_) {
+            bool ok;
+            double num = parseNumericColumn(col_str, &ok);
+            sort_keys_[idx] = ok ? num : qQNaN();
         } else {
-            cmp_val = r1->columnString(sort_cap_file_, sort_column_).compare(r2->columnString(sort_cap_file_, sort_column_));
+            int id = sort_key_string_ids_.value(col_str, -1);
+            if (id < 0) {
+                id = sort_key_strings_.count();
+                sort_key_strings_ << col_str;
+                sort_key_string_ids_.insert(col_str, id);
+            }
+            sort_keys_[idx] = id;
         }
+    }
+
+    if (progbar) {
+        destroy_progress_dlg(progbar);
+    }
+    sorting_ = false;
 
-        if (cmp_val == 0) {
-            // All else being equal, compare column numbers.
-            cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
+    if (stopped || sort_stop_flag_) {
+        clearSortKeys();
+        return false;
+    }
+
+    QVector<int> string_rank;
+    if (!sort_column_is_numeric_) {
+        QVector<int> by_string(sort_key_strings_.count());
+        std::iota(by_string.begin(), by_string.end(), 0);
+        std::sort(by_string.begin(), by_string.end(), [this](int s1, int s2) {
+            return sort_key_strings_[s1] < sort_key_strings_[s2];
+        });
+        string_rank.resize(by_string.count());
+        for (int i = 0; i < by_string.count(); i++) {
+            string_rank[by_string[i]] = i;
         }
     }
 
-    if (sort_order_ == Qt::AscendingOrder) {
-        return cmp_val < 0;
-    } else {
-        return cmp_val > 0;
+    QVector<SortEntry> entries(physical_rows_.count());
+    for (int row = 0; row < physical_rows_.count(); row++) {
+        SortEntry &entry = entries[row];
+        entry.record = physical_rows_[row];
+        entry.num = entry.record->frameData()->num;
+        entry.key = sort_keys_[entry.num - 1];
+        if (!sort_column_is_numeric_) {
+            entry.key = string_rank[(int) entry.key];
+        }
+    }
+
+    SortEntryLess less = { sort_order_ == Qt::AscendingOrder };
+    sortEntries(entries, less);
+
+    for (int row = 0; row < entries.count(); row++) {
+        physical_rows_[row] = entries[row].record;
     }
+    return true;
+}
+
+void PacketListModel::clearSortKeys()
+{
+    sort_key_column_ = -1;
+    sort_keys_.clear();
+    sort_key_strings_.clear();
+    sort_key_string_ids_.clear();
 }
 
 // Parses a field as a double. Handle values with suffixes ("12ms"), negative
@@ -690,6 +919,13 @@ void PacketListModel::dissectIdle(bool reset)
 
     idle_dissection_timer_->restart();
 
+    // Rows near the viewport first.
+    while (idle_dissection_timer_->elapsed() < idle_dissection_interval_
+           && prefetch_row_ < prefetch_end_) {
+        ensureRowColorized(prefetch_row_);
+        prefetch_row_++;
+    }
+
     int first = idle_dissection_row_;
     while (idle_dissection_timer_->elapsed() < idle_dissection_interval_
            && idle_dissection_row_ < physical_rows_.count()) {
@@ -698,7 +934,7 @@ void PacketListModel::dissectIdle(bool reset)
 //        if (idle_dissection_row_ % 1000 == 0) qDebug() << "=di row" << idle_dissection_row_;
     }
 
-    if (idle_dissection_row_ < physical_rows_.count()) {
+    if (idle_dissection_row_ < physical_rows_.count() || prefetch_row_ < prefetch_end_) {
         QTimer::singleShot(idle_dissection_interval_, this, SLOT(dissectIdle()));
     } else {
         idle_dissection_timer_->invalidate();
@@ -736,6 +972,31 @@ gint PacketListModel::appendPacket(frame_data *fdata)
     return pos;
 }
 
+// Called by the view with the rows it's about to draw. Those are dissected
+// by drawing them; we queue the following pages so that scrolling down
+// doesn't have to wait for them, and one page back. The queue takes
+// precedence over the background colorization in dissectIdle.
+static const int prefetch_pages_ahead_ = 2;
+void PacketListModel::prefetchRows(int first, int last)
+{
+    if (!cap_file_ || cap_file_->state != FILE_READ_DONE || cap_file_->read_lock || cap_file_->redissecting) {
+        return;
+    }
+    if (first < 0 || last < first || first == prefetch_first_) {
+        return;
+    }
+
+    int page = last - first + 1;
+    prefetch_first_ = first;
+    prefetch_row_ = qMax(first - page, 0);
+    prefetch_end_ = qMin(last + 1 + prefetch_pages_ahead_ * page, visible_rows_.count());
+
+    if (!idle_dissection_timer_->isValid()) {
+        idle_dissection_timer_->start();
+        QTimer::singleShot(idle_dissection_interval_, this, SLOT(dissectIdle()));
+    }
+}
+
 frame_data *PacketListModel::getRowFdata(QModelIndex idx)
 {
     if (!idx.isValid())
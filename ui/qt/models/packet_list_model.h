@@ -20,6 +20,7 @@
 
 #include <QAbstractItemModel>
 #include <QFont>
+#include <QHash>
 #include <QVector>
 
 #include "packet_list_record.h"
@@ -51,6 +52,11 @@ public:
     frame_data *getRowFdata(QModelIndex idx);
     frame_data *getRowFdata(int row);
     void ensureRowColorized(int row);
+    /**
+     * @brief Dissect the rows around the given visible rows ahead of the
+     * background colorization, so that they are ready when scrolled to.
+     */
+    void prefetchRows(int first, int last);
     int visibleIndexOf(frame_data *fdata) const;
     /**
      * @brief Invalidate any cached column strings.
@@ -101,8 +107,28 @@ private:
     static bool recordLessThan(PacketListRecord *r1, PacketListRecord *r2);
     static double parseNumericColumn(const QString &val, bool *ok);
 
+    // Sort keys of a text column, indexed by frame number - 1. For numeric
+    // columns this is the value (NaN if there is none), otherwise the index
+    // of the interned string in sort_key_strings_. They are kept until the
+    // column strings change, so sorting the same column again or in the
+    // other direction doesn't have to look at the packets.
+    int sort_key_column_;
+    unsigned sort_key_data_ver_;
+    QVector<double> sort_keys_;
+    QVector<QString> sort_key_strings_;
+    QHash<QString, int> sort_key_string_ids_;
+    bool sorting_;
+    gboolean sort_stop_flag_;
+    int pending_sort_column_;
+    Qt::SortOrder pending_sort_order_;
+    bool sortTextColumn();
+    void clearSortKeys();
+
     QElapsedTimer *idle_dissection_timer_;
     int idle_dissection_row_;
+    int prefetch_first_;
+    int prefetch_row_;
+    int prefetch_end_;
 
     struct _GStringChunk *string_cache_pool_;
 
@@ -28,21 +28,39 @@
 QMap<int, int> PacketListRecord::cinfo_column_;
 unsigned PacketListRecord::col_data_ver_ = 1;
 unsigned PacketListRecord::rows_color_ver_ = 1;
+unsigned PacketListRecord::frame_data_ver_ = 1;
+QVector<PacketListRecord::FrameDataChange> PacketListRecord::frame_data_changes_;
+QVector<PacketListRecord *> PacketListRecord::text_cache_;
+int PacketListRecord::text_cache_next_ = 0;
+QVector<QSet<QString> > PacketListRecord::col_string_pool_;
+
+// Number of records that keep their column text. Text is typically a few
+// hundred bytes per record, so this caps it at roughly a hundred MB no
+// matter how large the file is.
+static const int max_text_cache_records_ = 250000;
+// Past this many distinct strings a column pool starts over. Columns such
+// as Info rarely repeat and would otherwise keep every string alive.
+static const int max_pooled_strings_ = 4096;
 
 PacketListRecord::PacketListRecord(frame_data *frameData) :
     fdata_(frameData),
     lines_(1),
     line_count_changed_(false),
     data_ver_(0),
+    fd_ver_(0),
     color_ver_(0),
     colorized_(false),
     conv_index_(0),
-    read_failed_(false)
+    read_failed_(false),
+    text_cache_slot_(-1)
 {
 }
 
 PacketListRecord::~PacketListRecord()
 {
+    if (text_cache_slot_ >= 0) {
+        text_cache_[text_cache_slot_] = NULL;
+    }
     col_text_.clear();
 }
 
@@ -85,11 +103,19 @@ const QString PacketListRecord::columnString(capture_file *cap_file, int column,
     bool dissect_color = ( colorized && !colorized_ ) || ( color_ver_ != rows_color_ver_ );
     if (column >= col_text_.count() || col_text_.at(column).isNull() || data_ver_ != col_data_ver_ || dissect_color) {
         dissect(cap_file, dissect_color);
+    } else if (fd_ver_ != frame_data_ver_) {
+        refreshFrameDataColumns(&cap_file->cinfo);
     }
 
     return col_text_.at(column);
 }
 
+void PacketListRecord::invalidateFrameDataColumns(guint32 first, guint32 last)
+{
+    FrameDataChange change = { ++frame_data_ver_, first, last };
+    frame_data_changes_ << change;
+}
+
 void PacketListRecord::resetColumns(column_info *cinfo)
 {
     invalidateAllRecords();
@@ -99,6 +125,8 @@ void PacketListRecord::resetColumns(column_info *cinfo)
     }
 
     cinfo_column_.clear();
+    col_string_pool_.clear();
+    col_string_pool_.resize(cinfo->num_cols);
     int i, j;
     for (i = 0, j = 0; i < cinfo->num_cols; i++) {
         if (!col_based_on_frame_data(cinfo, i)) {
@@ -227,6 +255,7 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
     col_text_.clear();
     lines_ = 1;
     line_count_changed_ = false;
+    fd_ver_ = frame_data_ver_;
 
     for (int column = 0; column < cinfo->num_cols; ++column) {
         int col_lines = 1;
@@ -301,6 +330,7 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
             col_str = QString(cinfo->columns[column].col_data);
         }
 
+        col_str = internColumnString(column, col_str);
         col_text_ << col_str;
         col_lines = col_str.count('\n');
         if (col_lines > lines_) {
@@ -309,4 +339,75 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
         }
 #endif // MINIMIZE_STRING_COPYING
     }
+
+    addToTextCache();
+}
+
+// Refill the frame data columns if they changed for our frame since they
+// were cached, e.g. because a time reference before it was set.
+void PacketListRecord::refreshFrameDataColumns(column_info *cinfo)
+{
+    bool changed = false;
+
+    foreach (FrameDataChange change, frame_data_changes_) {
+        if (change.ver > fd_ver_ && fdata_->num >= change.first && fdata_->num <= change.last) {
+            changed = true;
+            break;
+        }
+    }
+    fd_ver_ = frame_data_ver_;
+    if (!changed) {
+        return;
+    }
+
+    for (int column = 0; column < cinfo->num_cols && column < col_text_.count(); ++column) {
+        if (cinfo_column_.value(column, -1) >= 0) {
+            continue;
+        }
+        col_fill_in_frame_data(fdata_, cinfo, column, FALSE);
+        col_text_[column] = internColumnString(column, QString(cinfo->columns[column].col_data));
+    }
+}
+
+void PacketListRecord::addToTextCache()
+{
+    if (text_cache_slot_ >= 0) {
+        return;
+    }
+
+    if (text_cache_.count() < max_text_cache_records_) {
+        text_cache_slot_ = text_cache_.count();
+        text_cache_ << this;
+        return;
+    }
+
+    PacketListRecord *oldest = text_cache_[text_cache_next_];
+    if (oldest) {
+        oldest->col_text_.clear();
+        oldest->text_cache_slot_ = -1;
+    }
+    text_cache_[text_cache_next_] = this;
+    text_cache_slot_ = text_cache_next_;
+    text_cache_next_ = (text_cache_next_ + 1) % max_text_cache_records_;
+}
+
+// Returns a copy of col_str that shares its data with the same string of
+// another record, if we've seen it recently.
+const QString PacketListRecord::internColumnString(int column, const QString &col_str)
+{
+    if (column >= col_string_pool_.count()) {
+        return col_str;
+    }
+
+    QSet<QString> &pool = col_string_pool_[column];
+    QSet<QString>::const_iterator it = pool.constFind(col_str);
+    if (it != pool.constEnd()) {
+        return *it;
+    }
+
+    if (pool.count() >= max_pooled_strings_) {
+        pool.clear();
+    }
+    pool.insert(col_str);
+    return col_str;
 }
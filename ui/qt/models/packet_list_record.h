@@ -21,7 +21,9 @@
 
 #include <QByteArray>
 #include <QList>
+#include <QSet>
 #include <QVariant>
+#include <QVector>
 
 struct conversation;
 struct _GStringChunk;
@@ -43,7 +45,12 @@ public:
     unsigned int conversation() { return conv_index_; }
 
     int columnTextSize(const char *str);
-    static void invalidateAllRecords() { col_data_ver_++; }
+    static void invalidateAllRecords() { col_data_ver_++; frame_data_changes_.clear(); }
+    // The columns based on frame data (times, cumulative bytes) of frames
+    // first through last are stale. They are refilled, without dissecting
+    // again, when next asked for.
+    static void invalidateFrameDataColumns(guint32 first, guint32 last);
+    static unsigned columnDataVersion() { return col_data_ver_; }
     static void resetColumns(column_info *cinfo);
     static void resetColorization() { rows_color_ver_++; }
 
@@ -54,6 +61,18 @@ private:
     /** The column text for some columns */
     QStringList col_text_;
 
+    /**
+     * Records that have column text, in the order it was filled in. The
+     * oldest text is dropped when it's full; columnString dissects the
+     * record again if it's needed.
+     */
+    static QVector<PacketListRecord *> text_cache_;
+    static int text_cache_next_;
+    /** Our index in text_cache_, -1 if col_text_ is empty */
+    int text_cache_slot_;
+    /** Recently seen strings of each column, so that records share them */
+    static QVector<QSet<QString> > col_string_pool_;
+
     frame_data *fdata_;
     int lines_;
     bool line_count_changed_;
@@ -62,6 +81,15 @@ private:
     /** Data versions. Used to invalidate col_text_ */
     static unsigned col_data_ver_;
     unsigned data_ver_;
+    /** Frame data column versions. Used to refresh parts of col_text_ */
+    struct FrameDataChange {
+        unsigned ver;
+        guint32 first;
+        guint32 last;
+    };
+    static unsigned frame_data_ver_;
+    static QVector<FrameDataChange> frame_data_changes_;
+    unsigned fd_ver_;
     /** Has this record been colorized? */
     static unsigned int rows_color_ver_;
     unsigned int color_ver_;
@@ -74,6 +102,9 @@ private:
 
     void dissect(capture_file *cap_file, bool dissect_color = false);
     void cacheColumnStrings(column_info *cinfo);
+    void refreshFrameDataColumns(column_info *cinfo);
+    void addToTextCache();
+    static const QString internColumnString(int column, const QString &col_str);
 };
 
 #endif // PACKET_LIST_RECORD_H
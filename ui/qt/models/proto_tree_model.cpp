@@ -30,7 +30,14 @@ ProtoTreeModel::ProtoTreeModel(QObject * parent) :
 Qt::ItemFlags ProtoTreeModel::flags(const QModelIndex &index) const
 {
     Qt::ItemFlags item_flags = QAbstractItemModel::flags(index);
-    if (rowCount(index) < 1) {
+    ProtoNode index_node(root_node_);
+
+    if (index.isValid()) {
+        index_node = protoNodeFromIndex(index);
+    }
+
+    // Only look for the first child; the view asks this for every row.
+    if (!index_node.isValid() || !index_node.children().element().isValid()) {
         item_flags |= Qt::ItemNeverHasChildren;
     }
 
@@ -39,30 +46,22 @@ Qt::ItemFlags ProtoTreeModel::flags(const QModelIndex &index) const
 
 QModelIndex ProtoTreeModel::index(int row, int, const QModelIndex &parent) const
 {
-    ProtoNode parent_node(root_node_);
+    proto_node *parent_node = root_node_;
 
     if (parent.isValid()) {
         // index is not a top level item.
-        parent_node = protoNodeFromIndex(parent);
+        parent_node = protoNodeFromIndex(parent).protoNode();
     }
 
-    if (! parent_node.isValid())
+    if (!parent_node)
         return QModelIndex();
 
-    int cur_row = 0;
-    ProtoNode::ChildIterator kids = parent_node.children();
-    while (kids.element().isValid())
-    {
-        if (cur_row == row)
-            break;
-        cur_row++;
-        kids.next();
-    }
-    if (! kids.element().isValid()) {
+    const QVector<proto_node *> &kids = childNodes(parent_node);
+    if (row < 0 || row >= kids.count()) {
         return QModelIndex();
     }
 
-    return createIndex(row, 0, static_cast<void *>(kids.element().protoNode()));
+    return createIndex(row, 0, static_cast<void *>(kids.at(row)));
 }
 
 QModelIndex ProtoTreeModel::parent(const QModelIndex &index) const
@@ -73,10 +72,32 @@ QModelIndex ProtoTreeModel::parent(const QModelIndex &index) const
 
 int ProtoTreeModel::rowCount(const QModelIndex &parent) const
 {
+    proto_node *parent_node = root_node_;
+
     if (parent.isValid()) {
-        return protoNodeFromIndex(parent).childrenCount();
+        parent_node = protoNodeFromIndex(parent).protoNode();
+    }
+    if (!parent_node) {
+        return 0;
     }
-    return ProtoNode(root_node_).childrenCount();
+    return childNodes(parent_node).count();
+}
+
+const QVector<proto_node *> &ProtoTreeModel::childNodes(proto_node *parent_node) const
+{
+    QHash<proto_node *, QVector<proto_node *> >::const_iterator it = child_nodes_.constFind(parent_node);
+    if (it != child_nodes_.constEnd()) {
+        return it.value();
+    }
+
+    QVector<proto_node *> &kids = child_nodes_[parent_node];
+    ProtoNode::ChildIterator kid = ProtoNode(parent_node).children();
+    while (kid.element().isValid()) {
+        node_rows_.insert(kid.element().protoNode(), kids.count());
+        kids << kid.element().protoNode();
+        kid.next();
+    }
+    return kids;
 }
 
 // The QItemDelegate documentation says
@@ -149,6 +170,8 @@ void ProtoTreeModel::setRootNode(proto_node *root_node)
 {
     beginResetModel();
     root_node_ = root_node;
+    child_nodes_.clear();
+    node_rows_.clear();
     endResetModel();
     if (!root_node) return;
 
@@ -165,9 +188,14 @@ ProtoNode ProtoTreeModel::protoNodeFromIndex(const QModelIndex &index) const
 
 QModelIndex ProtoTreeModel::indexFromProtoNode(ProtoNode &index_node) const
 {
-    int row = index_node.row();
+    if (!index_node.isChild()) {
+        return QModelIndex();
+    }
 
-    if (!index_node.isValid() || row < 0) {
+    // Make sure we know the rows of its siblings.
+    childNodes(index_node.parentNode().protoNode());
+    int row = node_rows_.value(index_node.protoNode(), -1);
+    if (row < 0) {
         return QModelIndex();
     }
 
@@ -13,7 +13,9 @@
 #include <ui/qt/utils/proto_node.h>
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QModelIndex>
+#include <QVector>
 
 class ProtoTreeModel : public QAbstractItemModel
 {
@@ -39,6 +41,12 @@ public:
 
 private:
     proto_node* root_node_;
+    // The visible children of each node we were asked about and the row of
+    // each of those, so that we don't walk long sibling lists for every
+    // index(), rowCount() and parent() call. Filled in as the view asks.
+    mutable QHash<proto_node *, QVector<proto_node *> > child_nodes_;
+    mutable QHash<proto_node *, int> node_rows_;
+    const QVector<proto_node *> &childNodes(proto_node *parent_node) const;
     static void foreachFindHfid(proto_node *node, gpointer find_hfid_ptr);
     static void foreachFindField(proto_node *node, gpointer find_finfo_ptr);
 };
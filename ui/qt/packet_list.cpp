@@ -788,6 +788,15 @@ void PacketList::paintEvent(QPaintEvent *event)
     // resizing, etc.
     create_near_overlay_ = true;
     QTreeView::paintEvent(event);
+
+    if (!capture_in_progress_) {
+        QModelIndex first_idx = indexAt(viewport()->rect().topLeft());
+        if (first_idx.isValid()) {
+            QModelIndex last_idx = indexAt(viewport()->rect().bottomLeft());
+            int last_row = last_idx.isValid() ? last_idx.row() : packet_list_model_->rowCount() - 1;
+            packet_list_model_->prefetchRows(first_idx.row(), last_row);
+        }
+    }
 }
 
 void PacketList::mousePressEvent (QMouseEvent *event)
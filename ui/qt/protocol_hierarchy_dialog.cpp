@@ -12,7 +12,7 @@
 
 #include "cfile.h"
 
-#include "ui/proto_hier_stats.h"
+#include <epan/prefs.h>
 
 #include <ui/qt/utils/variant_pointer.h>
 
@@ -24,6 +24,7 @@
 #include <QClipboard>
 #include <QPushButton>
 #include <QTextStream>
+#include <QTimer>
 #include <QTreeWidgetItemIterator>
 
 /*
@@ -162,7 +163,9 @@ private:
 
 ProtocolHierarchyDialog::ProtocolHierarchyDialog(QWidget &parent, CaptureFile &cf) :
     WiresharkDialog(parent, cf),
-    ui(new Ui::ProtocolHierarchyDialog)
+    ui(new Ui::ProtocolHierarchyDialog),
+    ph_stats_(NULL),
+    update_timer_(NULL)
 {
     ui->setupUi(this);
     loadGeometry(parent.width() * 4 / 5, parent.height() * 4 / 5);
@@ -170,24 +173,27 @@ ProtocolHierarchyDialog::ProtocolHierarchyDialog(QWidget &parent, CaptureFile &c
 
     ui->hierStatsTreeWidget->setItemDelegateForColumn(pct_packets_col_, &percent_bar_delegate_);
     ui->hierStatsTreeWidget->setItemDelegateForColumn(pct_bytes_col_, &percent_bar_delegate_);
-    ph_stats_t *ph_stats = ph_stats_new(cap_file_.capFile());
-    if (ph_stats) {
-        ui->hierStatsTreeWidget->invisibleRootItem()->setData(0, Qt::UserRole, VariantPointer<ph_stats_t>::asQVariant(ph_stats));
-        g_node_children_foreach(ph_stats->stats_tree, G_TRAVERSE_ALL, addTreeNode, ui->hierStatsTreeWidget->invisibleRootItem());
-        ph_stats_free(ph_stats);
-    }
+    ph_stats_ = ph_stats_new(cap_file_.capFile());
+    fillTree();
 
     ui->hierStatsTreeWidget->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->hierStatsTreeWidget, SIGNAL(customContextMenuRequested(QPoint)),
                 SLOT(showProtoHierMenu(QPoint)));
 
     ui->hierStatsTreeWidget->setSortingEnabled(true);
-    ui->hierStatsTreeWidget->expandAll();
 
     for (int i = 0; i < ui->hierStatsTreeWidget->columnCount(); i++) {
         ui->hierStatsTreeWidget->resizeColumnToContents(i);
     }
 
+    // While capturing, keep adding the packets that arrive instead of
+    // showing a snapshot. ph_stats_update only looks at the new ones.
+    if (ph_stats_ && cap_file_.capFile()->state == FILE_READ_IN_PROGRESS) {
+        update_timer_ = new QTimer(this);
+        connect(update_timer_, SIGNAL(timeout()), this, SLOT(updateStatistics()));
+        update_timer_->start(prefs.tap_update_interval);
+    }
+
     QMenu *submenu;
 
     FilterAction::Action cur_action = FilterAction::ActionApply;
@@ -241,6 +247,9 @@ ProtocolHierarchyDialog::ProtocolHierarchyDialog(QWidget &parent, CaptureFile &c
 
 ProtocolHierarchyDialog::~ProtocolHierarchyDialog()
 {
+    if (ph_stats_) {
+        ph_stats_free(ph_stats_);
+    }
     delete ui;
 }
 
@@ -287,6 +296,47 @@ void ProtocolHierarchyDialog::addTreeNode(GNode *node, gpointer data)
 
 }
 
+void ProtocolHierarchyDialog::fillTree()
+{
+    ui->hierStatsTreeWidget->clear();
+    if (!ph_stats_) return;
+
+    ui->hierStatsTreeWidget->invisibleRootItem()->setData(0, Qt::UserRole, VariantPointer<ph_stats_t>::asQVariant(ph_stats_));
+    g_node_children_foreach(ph_stats_->stats_tree, G_TRAVERSE_ALL, addTreeNode, ui->hierStatsTreeWidget->invisibleRootItem());
+    ui->hierStatsTreeWidget->expandAll();
+}
+
+void ProtocolHierarchyDialog::updateStatistics()
+{
+    capture_file *cf = cap_file_.capFile();
+
+    // The frames' filter state changes when a new display filter is
+    // applied, and the statistics we have can't be carried forward.
+    if (!cf || !ph_stats_ || display_filter_ != cf->dfilter) {
+        update_timer_->stop();
+        return;
+    }
+    if (cf->state != FILE_READ_IN_PROGRESS) {
+        // One last time for the packets read since the previous tick.
+        update_timer_->stop();
+    }
+    if (cf->count == ph_stats_->last_frame) return;
+
+    if (ph_stats_update(cf, ph_stats_)) {
+        fillTree();
+    } else {
+        update_timer_->stop();
+    }
+}
+
+void ProtocolHierarchyDialog::captureFileClosing()
+{
+    if (update_timer_) {
+        update_timer_->stop();
+    }
+    WiresharkDialog::captureFileClosing();
+}
+
 void ProtocolHierarchyDialog::updateWidgets()
 {
     QString hint = "<small><i>";
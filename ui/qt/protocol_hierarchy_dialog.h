@@ -16,7 +16,10 @@
 #include <ui/qt/models/percent_bar_delegate.h>
 #include "wireshark_dialog.h"
 
+#include "ui/proto_hier_stats.h"
+
 class QPushButton;
+class QTimer;
 class QTreeWidgetItem;
 
 namespace Ui {
@@ -40,6 +43,7 @@ private slots:
     void on_actionCopyAsCsv_triggered();
     void on_actionCopyAsYaml_triggered();
     void on_buttonBox_helpRequested();
+    void updateStatistics();
 
 private:
     Ui::ProtocolHierarchyDialog *ui;
@@ -47,10 +51,14 @@ private:
     QMenu ctx_menu_;
     PercentBarDelegate percent_bar_delegate_;
     QString display_filter_;
+    ph_stats_t *ph_stats_;
+    QTimer *update_timer_;
 
     // Callback for g_node_children_foreach
     static void addTreeNode(GNode *node, gpointer data);
+    void fillTree();
     void updateWidgets();
+    void captureFileClosing();
     QList<QVariant> protoHierRowData(QTreeWidgetItem *item) const;
 };
 
@@ -59,6 +59,10 @@ enum {
     col_min_srt_,
     col_max_srt_,
     col_avg_srt_,
+    col_p50_srt_,
+    col_p90_srt_,
+    col_p99_srt_,
+    col_p999_srt_,
     col_min_frame_,
     col_max_frame_,
     col_open_requests,
@@ -72,6 +76,23 @@ enum {
     rtd_time_stat_type_
 };
 
+// Percentile shown in each of the col_p*_srt_ columns
+static double rtd_column_percentile(int col)
+{
+    switch (col) {
+    case col_p50_srt_:
+        return 50.0;
+    case col_p90_srt_:
+        return 90.0;
+    case col_p99_srt_:
+        return 99.0;
+    case col_p999_srt_:
+        return 99.9;
+    default:
+        return 0.0;
+    }
+}
+
 class RtdTimeStatTreeWidgetItem : public QTreeWidgetItem
 {
 public:
@@ -88,6 +109,9 @@ public:
         setText(col_min_srt_, QString::number(nstime_to_sec(&timestat_->rtd->min), 'f', 6));
         setText(col_max_srt_, QString::number(nstime_to_sec(&timestat_->rtd->max), 'f', 6));
         setText(col_avg_srt_, QString::number(get_average(&timestat_->rtd->tot, timestat_->rtd->num) / 1000.0, 'f', 6));
+        for (int col = col_p50_srt_; col <= col_p999_srt_; col++) {
+            setText(col, QString::number(time_stat_percentile(timestat_->rtd, rtd_column_percentile(col)) / 1000.0, 'f', 6));
+        }
         setText(col_min_frame_, QString::number(timestat_->rtd->min_num));
         setText(col_max_frame_, QString::number(timestat_->rtd->max_num));
         setText(col_open_requests, QString::number(timestat_->open_req_num));
@@ -115,6 +139,14 @@ public:
             double other_avg = get_average(&other_row->timestat_->rtd->tot, other_row->timestat_->rtd->num);
             return our_avg < other_avg;
         }
+        case col_p50_srt_:
+        case col_p90_srt_:
+        case col_p99_srt_:
+        case col_p999_srt_:
+        {
+            double percentile = rtd_column_percentile(treeWidget()->sortColumn());
+            return time_stat_percentile(timestat_->rtd, percentile) < time_stat_percentile(other_row->timestat_->rtd, percentile);
+        }
         case col_min_frame_:
             return timestat_->rtd->min_num < other_row->timestat_->rtd->min_num;
         case col_max_frame_:
@@ -137,6 +169,10 @@ public:
         return QList<QVariant>() << type_ << timestat_->rtd->num
                                  << nstime_to_sec(&timestat_->rtd->min) << nstime_to_sec(&timestat_->rtd->max)
                                  << get_average(&timestat_->rtd->tot, timestat_->rtd->num) / 1000.0
+                                 << time_stat_percentile(timestat_->rtd, 50.0) / 1000.0
+                                 << time_stat_percentile(timestat_->rtd, 90.0) / 1000.0
+                                 << time_stat_percentile(timestat_->rtd, 99.0) / 1000.0
+                                 << time_stat_percentile(timestat_->rtd, 99.9) / 1000.0
                                  << timestat_->rtd->min_num << timestat_->rtd->max_num
                                  << timestat_->open_req_num << timestat_->disc_rsp_num
                                  << timestat_->req_dup_num << timestat_->rsp_dup_num;
@@ -159,6 +195,7 @@ ResponseTimeDelayDialog::ResponseTimeDelayDialog(QWidget &parent, CaptureFile &c
     QStringList header_names = QStringList()
             << tr("Type") << tr("Messages")
             << tr("Min SRT") << tr("Max SRT") << tr("Avg SRT")
+            << tr("p50 SRT") << tr("p90 SRT") << tr("p99 SRT") << tr("p99.9 SRT")
             << tr("Min in Frame") << tr("Max in Frame")
             << tr("Open Requests") << tr("Discarded Responses")
             << tr("Repeated Requests") << tr("Repeated Responses");
@@ -77,64 +77,64 @@ enum { rtp_analysis_type_ = 1000 };
 class RtpAnalysisTreeWidgetItem : public QTreeWidgetItem
 {
 public:
-    RtpAnalysisTreeWidgetItem(QTreeWidget *tree, tap_rtp_stat_t *statinfo, packet_info *pinfo, const struct _rtp_info *rtpinfo) :
+    RtpAnalysisTreeWidgetItem(QTreeWidget *tree, const rtp_analysis_row_t *row) :
         QTreeWidgetItem(tree, rtp_analysis_type_)
     {
-        frame_num_ = pinfo->num;
-        sequence_num_ = rtpinfo->info_seq_num;
-        pkt_len_ = pinfo->fd->pkt_len;
-        flags_ = statinfo->flags;
+        frame_num_ = row->frame_num;
+        sequence_num_ = row->sequence_num;
+        pkt_len_ = row->pkt_len;
+        flags_ = row->flags;
         if (flags_ & STAT_FLAG_FIRST) {
             delta_ = 0.0;
             jitter_ = 0.0;
             skew_ = 0.0;
         } else {
-            delta_ = statinfo->delta;
-            jitter_ = statinfo->jitter;
-            skew_ = statinfo->skew;
+            delta_ = row->delta;
+            jitter_ = row->jitter;
+            skew_ = row->skew;
         }
-        bandwidth_ = statinfo->bandwidth;
-        marker_ = rtpinfo->info_marker_set ? true : false;
+        bandwidth_ = row->bandwidth;
+        marker_ = row->marker;
         ok_ = false;
 
         QColor bg_color = QColor();
         QString status;
 
-        if (statinfo->pt == PT_CN) {
+        if (row->pt == PT_CN) {
             status = "Comfort noise (PT=13, RFC 3389)";
             bg_color = color_cn_;
-        } else if (statinfo->pt == PT_CN_OLD) {
+        } else if (row->pt == PT_CN_OLD) {
             status = "Comfort noise (PT=19, reserved)";
             bg_color = color_cn_;
-        } else if (statinfo->flags & STAT_FLAG_WRONG_SEQ) {
+        } else if (flags_ & STAT_FLAG_WRONG_SEQ) {
             status = "Wrong sequence number";
             bg_color = ColorUtils::expert_color_error;
-        } else if (statinfo->flags & STAT_FLAG_DUP_PKT) {
+        } else if (flags_ & STAT_FLAG_DUP_PKT) {
             status = "Suspected duplicate (MAC address) only delta time calculated";
             bg_color = color_rtp_warn_;
-        } else if (statinfo->flags & STAT_FLAG_REG_PT_CHANGE) {
-            status = QString("Payload changed to PT=%1").arg(statinfo->pt);
-            if (statinfo->flags & STAT_FLAG_PT_T_EVENT) {
+        } else if (flags_ & STAT_FLAG_REG_PT_CHANGE) {
+            status = QString("Payload changed to PT=%1").arg(row->pt);
+            if (flags_ & STAT_FLAG_PT_T_EVENT) {
                 status.append(" telephone/event");
             }
             bg_color = color_rtp_warn_;
-        } else if (statinfo->flags & STAT_FLAG_WRONG_TIMESTAMP) {
+        } else if (flags_ & STAT_FLAG_WRONG_TIMESTAMP) {
             status = "Incorrect timestamp";
             /* color = COLOR_WARNING; */
             bg_color = color_rtp_warn_;
-        } else if ((statinfo->flags & STAT_FLAG_PT_CHANGE)
-            &&  !(statinfo->flags & STAT_FLAG_FIRST)
-            &&  !(statinfo->flags & STAT_FLAG_PT_CN)
-            &&  (statinfo->flags & STAT_FLAG_FOLLOW_PT_CN)
-            &&  !(statinfo->flags & STAT_FLAG_MARKER)) {
+        } else if ((flags_ & STAT_FLAG_PT_CHANGE)
+            &&  !(flags_ & STAT_FLAG_FIRST)
+            &&  !(flags_ & STAT_FLAG_PT_CN)
+            &&  (flags_ & STAT_FLAG_FOLLOW_PT_CN)
+            &&  !(flags_ & STAT_FLAG_MARKER)) {
             status = "Marker missing?";
             bg_color = color_rtp_warn_;
-        } else if (statinfo->flags & STAT_FLAG_PT_T_EVENT) {
-            status = QString("PT=%1 telephone/event").arg(statinfo->pt);
+        } else if (flags_ & STAT_FLAG_PT_T_EVENT) {
+            status = QString("PT=%1 telephone/event").arg(row->pt);
             /* XXX add color? */
             bg_color = color_pt_event_;
         } else {
-            if (statinfo->flags & STAT_FLAG_MARKER) {
+            if (flags_ & STAT_FLAG_MARKER) {
                 bg_color = color_rtp_warn_;
             }
         }
@@ -298,6 +298,8 @@ RtpAnalysisDialog::RtpAnalysisDialog(QWidget &parent, CaptureFile &cf) :
 
     connect(ui->tabWidget, SIGNAL(currentChanged(int)),
             this, SLOT(updateWidgets()));
+    connect(ui->tabWidget, SIGNAL(currentChanged(int)),
+            this, SLOT(currentTabChanged()));
     connect(ui->tabWidget->tabBar(), SIGNAL(tabCloseRequested(int)),
             this, SLOT(closeTab(int)));
     connect(this, SIGNAL(updateFilter(QString, bool)),
@@ -327,6 +329,7 @@ RtpAnalysisDialog::~RtpAnalysisDialog()
 
 void RtpAnalysisDialog::deleteTabInfo(tab_info_t *tab_info)
 {
+    delete tab_info->rows;
     delete tab_info->time_vals;
     delete tab_info->jitter_vals;
     delete tab_info->diff_vals;
@@ -686,9 +689,10 @@ tap_packet_status RtpAnalysisDialog::tapPacket(void *tapinfo_ptr, packet_info *p
     /* is it the forward direction?  */
     else {
         // Search tab in hash key, if there are multiple tabs with same hash
-        QList<tab_info_t *> tabs = rtp_analysis_dialog->tab_hash_.values(pinfo_rtp_info_to_hash(pinfo, rtpinfo));
-        for (int i = 0; i < tabs.size(); i++) {
-            tab_info_t *tab = tabs.at(i);
+        guint hash = pinfo_rtp_info_to_hash(pinfo, rtpinfo);
+        QMultiHash<guint, tab_info_t *>::const_iterator it = rtp_analysis_dialog->tab_hash_.constFind(hash);
+        for (; it != rtp_analysis_dialog->tab_hash_.constEnd() && it.key() == hash; ++it) {
+            tab_info_t *tab = it.value();
             if (rtpstream_id_equal_pinfo_rtp_info(&tab->stream.id, pinfo, rtpinfo))  {
                 rtp_analysis_dialog->addPacket(tab, pinfo, rtpinfo);
                 break;
@@ -715,6 +719,8 @@ void RtpAnalysisDialog::resetStatistics()
 
         tab->stream.rtp_stats.first_packet = true;
         tab->stream.rtp_stats.reg_pt = PT_UNDEFINED;
+        tab->rows->clear();
+        tab->rows_in_tree = 0;
         tab->time_vals->clear();
         tab->jitter_vals->clear();
         tab->diff_vals->clear();
@@ -729,14 +735,55 @@ void RtpAnalysisDialog::resetStatistics()
 
 void RtpAnalysisDialog::addPacket(tab_info_t *tab, packet_info *pinfo, const _rtp_info *rtpinfo)
 {
+    const tap_rtp_stat_t *statinfo = &tab->stream.rtp_stats;
+    rtp_analysis_row_t row;
+
     rtppacket_analyse(&tab->stream.rtp_stats, pinfo, rtpinfo);
-    new RtpAnalysisTreeWidgetItem(tab->tree_widget, &tab->stream.rtp_stats, pinfo, rtpinfo);
+    row.frame_num = pinfo->num;
+    row.sequence_num = rtpinfo->info_seq_num;
+    row.pkt_len = pinfo->fd->pkt_len;
+    row.flags = statinfo->flags;
+    row.pt = statinfo->pt;
+    row.delta = statinfo->delta;
+    row.jitter = statinfo->jitter;
+    row.skew = statinfo->skew;
+    row.bandwidth = statinfo->bandwidth;
+    row.marker = rtpinfo->info_marker_set ? true : false;
+    tab->rows->append(row);
+
     tab->time_vals->append(tab->stream.rtp_stats.time / 1000);
     tab->jitter_vals->append(tab->stream.rtp_stats.jitter);
     tab->diff_vals->append(tab->stream.rtp_stats.diff);
     tab->delta_vals->append(tab->stream.rtp_stats.delta);
 }
 
+// Creating a tree item per packet for thousands of streams takes far more
+// time and memory than the analysis itself, so only tabs that have been
+// shown get them.
+void RtpAnalysisDialog::fillTree(tab_info_t *tab)
+{
+    tab->tree_wanted = true;
+    if (tab->rows_in_tree == tab->rows->size()) return;
+
+    const rtp_analysis_row_t *rows = tab->rows->constData();
+    tab->tree_widget->setUpdatesEnabled(false);
+    for (int i = tab->rows_in_tree; i < tab->rows->size(); i++) {
+        new RtpAnalysisTreeWidgetItem(tab->tree_widget, &rows[i]);
+    }
+    tab->rows_in_tree = tab->rows->size();
+
+    for (int col = 0; col < tab->tree_widget->columnCount() - 1; col++) {
+        tab->tree_widget->resizeColumnToContents(col);
+    }
+    tab->tree_widget->setUpdatesEnabled(true);
+}
+
+void RtpAnalysisDialog::currentTabChanged()
+{
+    tab_info_t *tab_data = getTabInfoForCurrentTab();
+    if (tab_data) fillTree(tab_data);
+}
+
 void RtpAnalysisDialog::updateStatistics()
 {
     for(int i=0; i<tabs_.count(); i++) {
@@ -785,8 +832,8 @@ void RtpAnalysisDialog::updateStatistics()
 
         tabs_[i]->statistics_label->setText(stats_tables);
 
-        for (int col = 0; col < tabs_[i]->tree_widget->columnCount() - 1; col++) {
-            tabs_[i]->tree_widget->resizeColumnToContents(col);
+        if (tabs_[i]->tree_wanted) {
+            fillTree(tabs_[i]);
         }
 
         tabs_[i]->jitter_graph->setData(*tabs_[i]->time_vals, *tabs_[i]->jitter_vals);
@@ -794,6 +841,8 @@ void RtpAnalysisDialog::updateStatistics()
         tabs_[i]->delta_graph->setData(*tabs_[i]->time_vals, *tabs_[i]->delta_vals);
     }
 
+    currentTabChanged();
+
     updateGraph();
 
     updateWidgets();
@@ -861,24 +910,39 @@ void RtpAnalysisDialog::saveCsvHeader(QFile *save_file, QTreeWidget *tree)
     save_file->write("\n");
 }
 
-void RtpAnalysisDialog::saveCsvData(QFile *save_file, QTreeWidget *tree)
+void RtpAnalysisDialog::saveCsvRow(QFile *save_file, RtpAnalysisTreeWidgetItem *ra_ti)
 {
+    QStringList values;
+    foreach (QVariant v, ra_ti->rowData()) {
+        if (!v.isValid()) {
+            values << "\"\"";
+        } else if ((int) v.type() == (int) QMetaType::QString) {
+            values << QString("\"%1\"").arg(v.toString());
+        } else {
+            values << v.toString();
+        }
+    }
+    save_file->write(values.join(",").toUtf8());
+    save_file->write("\n");
+}
+
+void RtpAnalysisDialog::saveCsvData(QFile *save_file, tab_info_t *tab)
+{
+    if (!tab->tree_wanted) {
+        // Never shown, so the rows are still in packet order
+        for (int i = 0; i < tab->rows->size(); i++) {
+            RtpAnalysisTreeWidgetItem ra_ti(NULL, &tab->rows->at(i));
+            saveCsvRow(save_file, &ra_ti);
+        }
+        return;
+    }
+
+    QTreeWidget *tree = tab->tree_widget;
     for (int row = 0; row < tree->topLevelItemCount(); row++) {
         QTreeWidgetItem *ti = tree->topLevelItem(row);
         if (ti->type() != rtp_analysis_type_) continue;
         RtpAnalysisTreeWidgetItem *ra_ti = dynamic_cast<RtpAnalysisTreeWidgetItem *>((RtpAnalysisTreeWidgetItem *)ti);
-        QStringList values;
-        foreach (QVariant v, ra_ti->rowData()) {
-            if (!v.isValid()) {
-                values << "\"\"";
-            } else if ((int) v.type() == (int) QMetaType::QString) {
-                values << QString("\"%1\"").arg(v.toString());
-            } else {
-                values << v.toString();
-            }
-        }
-        save_file->write(values.join(",").toUtf8());
-        save_file->write("\n");
+        saveCsvRow(save_file, ra_ti);
     }
 }
 
@@ -919,7 +983,7 @@ void RtpAnalysisDialog::saveCsv(RtpAnalysisDialog::StreamDirection direction)
                 save_file.write("\"");
                 save_file.write(n.toUtf8());
                 save_file.write("\"\n");
-                saveCsvData(&save_file, tab_data->tree_widget);
+                saveCsvData(&save_file, tab_data);
             }
         }
         break;
@@ -935,7 +999,7 @@ void RtpAnalysisDialog::saveCsv(RtpAnalysisDialog::StreamDirection direction)
             save_file.write("\"");
             save_file.write(n.toUtf8());
             save_file.write("\"\n");
-            saveCsvData(&save_file, tabs_[i]->tree_widget);
+            saveCsvData(&save_file, tabs_[i]);
             save_file.write("\n");
         }
         break;
@@ -1059,6 +1123,7 @@ void RtpAnalysisDialog::addRtpStreamsPrivate(QVector<rtpstream_id_t *> stream_id
 
             tab_info_t *new_tab = g_new0(tab_info_t, 1);
             rtpstream_id_copy(id, &(new_tab->stream.id));
+            new_tab->rows = new QVector<rtp_analysis_row_t>();
             new_tab->time_vals = new QVector<double>();
             new_tab->jitter_vals = new QVector<double>();
             new_tab->diff_vals = new QVector<double>();
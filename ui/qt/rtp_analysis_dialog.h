@@ -38,9 +38,28 @@ class RtpAnalysisDialog;
 class QCPGraph;
 class QTemporaryFile;
 class QDialogButtonBox;
+class RtpAnalysisTreeWidgetItem;
+
+// One analyzed packet. Every packet of every stream is kept like this;
+// tree items are only created for the streams whose tab has been shown.
+typedef struct {
+    guint32 frame_num;
+    guint32 sequence_num;
+    guint32 pkt_len;
+    guint32 flags;
+    guint32 pt;
+    double delta;
+    double jitter;
+    double skew;
+    double bandwidth;
+    bool marker;
+} rtp_analysis_row_t;
 
 typedef struct {
     rtpstream_info_t stream;
+    QVector<rtp_analysis_row_t> *rows;
+    int rows_in_tree;       // rows that have a tree item
+    bool tree_wanted;       // the tab has been shown
     QVector<double> *time_vals;
     QVector<double> *jitter_vals;
     QVector<double> *diff_vals;
@@ -120,6 +139,7 @@ private slots:
     void showStreamMenu(QPoint pos);
     void graphClicked(QMouseEvent *event);
     void closeTab(int index);
+    void currentTabChanged();
     void rowCheckboxChanged(int checked);
     void singleCheckboxChanged(int checked);
     void on_actionPrepareFilterOne_triggered();
@@ -153,11 +173,13 @@ private:
 
     void resetStatistics();
     void addPacket(tab_info_t *tab, packet_info *pinfo, const struct _rtp_info *rtpinfo);
+    void fillTree(tab_info_t *tab);
     void updateStatistics();
     void updateGraph();
 
     void saveCsvHeader(QFile *save_file, QTreeWidget *tree);
-    void saveCsvData(QFile *save_file, QTreeWidget *tree);
+    void saveCsvRow(QFile *save_file, RtpAnalysisTreeWidgetItem *ra_ti);
+    void saveCsvData(QFile *save_file, tab_info_t *tab);
     void saveCsv(StreamDirection direction);
 
     bool eventFilter(QObject*, QEvent* event);
@@ -186,7 +186,8 @@ private:
     struct SpeexResamplerState_ *audio_resampler_;
     struct SpeexResamplerState_ *visual_resampler_;
     QAudioOutput *audio_output_;
-    QMap<double, quint32> packet_timestamps_;
+    QVector<double> visual_timestamps_;   // Sorted, one per distinct visual sample time
+    QVector<quint32> visual_frame_nums_;  // Frame number at each of visual_timestamps_
     QVector<qint16> visual_samples_;
     QVector<double> out_of_seq_timestamps_;
     QVector<double> jitter_drop_timestamps_;
@@ -205,6 +206,7 @@ private:
 
     void decodeAudio(QAudioDeviceInfo out_device);
     void decodeVisual();
+    void addVisualTimestamp(double time, guint32 frame_num);
     quint32 calculateAudioOutRate(QAudioDeviceInfo out_device, unsigned int sample_rate, unsigned int requested_out_rate);
     SAMPLE *resizeBufferIfNeeded(SAMPLE *buff, gint32 *buff_bytes, qint64 requested_size);
 
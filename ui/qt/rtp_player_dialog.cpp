@@ -23,6 +23,7 @@
 #ifdef QT_MULTIMEDIA_LIB
 
 #include <epan/dissectors/packet-rtp.h>
+#include <epan/rtp_pt.h>
 #include <epan/to_str.h>
 
 #include <wsutil/report_message.h>
@@ -44,6 +45,8 @@
 #include <QMenu>
 #include <QVBoxLayout>
 #include <QTimer>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <QAudioFormat>
 #include <QAudioOutput>
@@ -57,9 +60,6 @@
 #include <ui/qt/utils/stock_icon.h>
 #include "wireshark_application.h"
 
-// To do:
-// - Threaded decoding?
-
 // Current and former RTP player bugs. Many have attachments that can be usef for testing.
 // Bug 3368 - The timestamp line in a RTP or RTCP packet display's "Not Representable"
 // Bug 3952 - VoIP Call RTP Player: audio played is corrupted when RFC2833 packets are present
@@ -133,6 +133,27 @@ public:
     }
 };
 
+// Each stream has its own decoders, resamplers and audio file, so
+// streams can be decoded on separate threads.
+class RtpStreamDecodeTask : public QRunnable
+{
+public:
+    RtpStreamDecodeTask(RtpAudioStream *audio_stream, QAudioDeviceInfo out_device) :
+        audio_stream_(audio_stream),
+        out_device_(out_device)
+    {
+    }
+
+    void run() override
+    {
+        audio_stream_->decode(out_device_);
+    }
+
+private:
+    RtpAudioStream *audio_stream_;
+    QAudioDeviceInfo out_device_;
+};
+
 RtpPlayerDialog *RtpPlayerDialog::pinstance_{nullptr};
 std::mutex RtpPlayerDialog::mutex_;
 
@@ -467,6 +488,11 @@ void RtpPlayerDialog::rescanPackets(bool rescale_axes)
 
     QAudioDeviceInfo cur_out_device = getCurrentDeviceInfo();
     int row_count = ui->streamTreeWidget->topLevelItemCount();
+    QThreadPool decode_pool;
+
+    // The payload type names are looked up while decoding. Make sure the
+    // lookup table is set up before several threads use it.
+    try_val_to_str_ext(PT_PCMU, &rtp_payload_type_short_vals_ext);
 
     // Reset stream values
     for (int row = 0; row < row_count; row++) {
@@ -490,8 +516,9 @@ void RtpPlayerDialog::rescanPackets(bool rescale_axes)
         }
         audio_stream->setTimingMode(timing_mode);
 
-        audio_stream->decode(cur_out_device);
+        decode_pool.start(new RtpStreamDecodeTask(audio_stream, cur_out_device));
     }
+    decode_pool.waitForDone();
 
     for (int col = 0; col < ui->streamTreeWidget->columnCount() - 1; col++) {
         ui->streamTreeWidget->resizeColumnToContents(col);
@@ -49,7 +49,7 @@ SCTPAssocAnalyseDialog::~SCTPAssocAnalyseDialog()
 const sctp_assoc_info_t* SCTPAssocAnalyseDialog::findAssocForPacket(capture_file* cf)
 {
     frame_data     *fdata;
-    GList          *list, *framelist;
+    GList          *list;
     const sctp_assoc_info_t *assoc;
     bool           frame_found = false;
 
@@ -64,15 +64,18 @@ const sctp_assoc_info_t* SCTPAssocAnalyseDialog::findAssocForPacket(capture_file
     while (list) {
         assoc = gxx_list_data(const sctp_assoc_info_t*, list);
 
-        framelist = g_list_first(assoc->frame_numbers);
-        guint32 fn;
-        while (framelist) {
-            fn = GPOINTER_TO_UINT(framelist->data);
-            if (fn == fdata->num) {
-                frame_found = TRUE;
-                break;
+        guint32 first_fn, last_fn;
+        if (frame_list_bounds(assoc->frame_numbers, &first_fn, &last_fn) &&
+                fdata->num >= first_fn && fdata->num <= last_fn) {
+            frame_list_iter_t iter;
+            guint32 fn;
+            frame_list_iter_init(&iter, assoc->frame_numbers);
+            while (frame_list_iter_next(&iter, &fn) && fn <= fdata->num) {
+                if (fn == fdata->num) {
+                    frame_found = TRUE;
+                    break;
+                }
             }
-            framelist = gxx_list_next(framelist);
         }
         if (frame_found) {
             return assoc;
@@ -21,46 +21,90 @@
 #include <QPalette>
 #include <QPen>
 #include <QPointF>
+#include <QPointer>
+#include <QtMath>
 
 const int max_comment_em_width_ = 20;
 
 // UML-like network node sequence diagrams.
 // https://developer.ibm.com/articles/the-sequence-diagram/
 
-WSCPSeqData::WSCPSeqData() :
-  key(0),
-  value(NULL)
+// Time and comment labels. There is one tick per item and a flow graph can
+// have millions of them, so make the labels of the ticks that are on screen
+// when they are drawn instead of all of them up front.
+class SequenceItemTicker : public QCPAxisTicker
 {
-}
+public:
+    enum LabelType { TimeLabel, CommentLabel };
+
+    SequenceItemTicker(SequenceDiagram *diagram, QCPAxis *axis, LabelType label_type) :
+        diagram_(diagram),
+        axis_(axis),
+        label_type_(label_type),
+        item_count_(0)
+    {}
+
+    void setItemCount(int item_count) { item_count_ = item_count; }
+
+protected:
+    virtual double getTickStep(const QCPRange &) Q_DECL_OVERRIDE { return 1.0; }
+    virtual int getSubTickCount(double) Q_DECL_OVERRIDE { return 0; }
+
+    virtual QVector<double> createTickVector(double, const QCPRange &range) Q_DECL_OVERRIDE
+    {
+        QVector<double> ticks;
+        if (!diagram_) return ticks;
+
+        // One tick outside of the range on each side, like QCPAxisTickerText.
+        double first = qMax(0.0, qFloor(range.lower) - 1.0);
+        double last = qMin(item_count_ - 1.0, qCeil(range.upper) + 1.0);
+        for (double key = first; key <= last; key++) {
+            ticks.append(key);
+        }
+        return ticks;
+    }
 
-WSCPSeqData::WSCPSeqData(double key, struct _seq_analysis_item *value) :
-  key(key),
-  value(value)
-{
-}
+    virtual QString getTickLabel(double tick, const QLocale &, QChar, int) Q_DECL_OVERRIDE
+    {
+        seq_analysis_item_t *sai = diagram_ ? diagram_->itemForKey(tick) : NULL;
+        if (!sai) return QString();
+
+        if (label_type_ == TimeLabel) {
+            return sai->time_str;
+        }
+        QFontMetrics com_fm(axis_->tickLabelFont());
+        return com_fm.elidedText(sai->comment, Qt::ElideRight, com_fm.height() * max_comment_em_width_);
+    }
+
+private:
+    QPointer<SequenceDiagram> diagram_;
+    QCPAxis *axis_;
+    LabelType label_type_;
+    int item_count_;
+};
 
 SequenceDiagram::SequenceDiagram(QCPAxis *keyAxis, QCPAxis *valueAxis, QCPAxis *commentAxis) :
     QCPAbstractPlottable(keyAxis, valueAxis),
     key_axis_(keyAxis),
     value_axis_(valueAxis),
     comment_axis_(commentAxis),
-    data_(NULL),
     sainfo_(NULL),
     selected_packet_(0),
     selected_key_(-1.0)
 {
-    data_ = new WSCPSeqDataMap();
     // xaxis (value): Address
     // yaxis (key): Time
     // yaxis2 (comment): Extra info ("Comment" in GTK+)
 
 //    valueAxis->setAutoTickStep(false);
+    value_axis_->setTicker(QSharedPointer<QCPAxisTicker>(new QCPAxisTickerText));
+    key_axis_->setTicker(QSharedPointer<QCPAxisTicker>(new SequenceItemTicker(this, key_axis_, SequenceItemTicker::TimeLabel)));
+    comment_axis_->setTicker(QSharedPointer<QCPAxisTicker>(new SequenceItemTicker(this, comment_axis_, SequenceItemTicker::CommentLabel)));
+
     QList<QCPAxis *> axes;
     axes << value_axis_ << key_axis_ << comment_axis_;
     QPen no_pen(Qt::NoPen);
     foreach (QCPAxis *axis, axes) {
-        QSharedPointer<QCPAxisTicker> ticker(new QCPAxisTickerText);
-        axis->setTicker(ticker);
         axis->setSubTickPen(no_pen);
         axis->setTickPen(no_pen);
         axis->setBasePen(no_pen);
@@ -88,50 +132,44 @@ SequenceDiagram::SequenceDiagram(QCPAxis *keyAxis, QCPAxis *valueAxis, QCPAxis *
 
 SequenceDiagram::~SequenceDiagram()
 {
-    delete data_;
+}
+
+seq_analysis_item_t *SequenceDiagram::itemForKey(double key) const
+{
+    int key_pos = qRound(key);
+
+    if (key_pos >= 0 && key_pos < items_.size()) {
+        return items_[key_pos];
+    }
+    return NULL;
 }
 
 int SequenceDiagram::adjacentPacket(bool next)
 {
     int adjacent_packet = -1;
-    WSCPSeqDataMap::const_iterator it;
+    int key;
 
-    if (data_->size() < 1) return adjacent_packet;
+    if (items_.size() < 1) return adjacent_packet;
 
     if (selected_packet_ < 1) {
-        if (next) {
-            it = data_->constBegin();
-        } else {
-            it = data_->constEnd();
-            --it;
-        }
-        selected_key_ = it.value().key;
-        return it.value().value->frame_number;
+        key = next ? 0 : items_.size() - 1;
+        selected_key_ = key;
+        return items_[key]->frame_number;
     }
 
-    if (next) {
-        for (it = data_->constBegin(); it != data_->constEnd(); ++it) {
-            if (it.value().value->frame_number == selected_packet_) {
-                ++it;
-                if (it != data_->constEnd()) {
-                    adjacent_packet = it.value().value->frame_number;
-                    selected_key_ = it.value().key;
-                }
-                break;
-            }
-        }
-    } else {
-        it = data_->constEnd();
-        --it;
-        while (it != data_->constBegin()) {
-            guint32 prev_frame = it.value().value->frame_number;
-            --it;
-            if (prev_frame == selected_packet_) {
-                adjacent_packet = it.value().value->frame_number;
-                selected_key_ = it.value().key;
-                break;
-            }
+    // setSelectedPacket normally looked up the selected row already.
+    key = qRound(selected_key_);
+    if (key < 0 || key >= items_.size() || items_[key]->frame_number != selected_packet_) {
+        for (key = 0; key < items_.size(); key++) {
+            if (items_[key]->frame_number == selected_packet_) break;
         }
+        if (key >= items_.size()) return adjacent_packet;
+    }
+
+    key += next ? 1 : -1;
+    if (key >= 0 && key < items_.size()) {
+        adjacent_packet = items_[key]->frame_number;
+        selected_key_ = key;
     }
 
     return adjacent_packet;
@@ -139,34 +177,22 @@ int SequenceDiagram::adjacentPacket(bool next)
 
 void SequenceDiagram::setData(_seq_analysis_info *sainfo)
 {
-    data_->clear();
+    items_.clear();
     sainfo_ = sainfo;
     if (!sainfo) return;
 
-    double cur_key = 0.0;
-    QVector<double> key_ticks, val_ticks;
-    QVector<QString> key_labels, val_labels, com_labels;
-    QFontMetrics com_fm(comment_axis_->tickLabelFont());
-    int elide_w = com_fm.height() * max_comment_em_width_;
+    QVector<double> val_ticks;
+    QVector<QString> val_labels;
     char* addr_str;
 
+    items_.reserve(g_queue_get_length(sainfo->items));
     for (GList *cur = g_queue_peek_nth_link(sainfo->items, 0); cur; cur = gxx_list_next(cur)) {
         seq_analysis_item_t *sai = gxx_list_data(seq_analysis_item_t *, cur);
         if (sai->display) {
-            WSCPSeqData new_data;
-
-            new_data.key = cur_key;
-            new_data.value = sai;
-            data_->insert(new_data.key, new_data);
-
-            key_ticks.append(cur_key);
-            key_labels.append(sai->time_str);
-
-            com_labels.append(com_fm.elidedText(sai->comment, Qt::ElideRight, elide_w));
-
-            cur_key++;
+            items_.append(sai);
         }
     }
+    items_.squeeze();
 
     for (unsigned int i = 0; i < sainfo_->num_nodes; i++) {
         val_ticks.append(i);
@@ -179,12 +205,10 @@ void SequenceDiagram::setData(_seq_analysis_info *sainfo)
         wmem_free(Q_NULLPTR, addr_str);
     }
 
-    QSharedPointer<QCPAxisTickerText> key_ticker = qSharedPointerCast<QCPAxisTickerText>(keyAxis()->ticker());
-    key_ticker->setTicks(key_ticks, key_labels);
     QSharedPointer<QCPAxisTickerText> value_ticker = qSharedPointerCast<QCPAxisTickerText>(valueAxis()->ticker());
     value_ticker->setTicks(val_ticks, val_labels);
-    QSharedPointer<QCPAxisTickerText> comment_ticker = qSharedPointerCast<QCPAxisTickerText>(comment_axis_->ticker());
-    comment_ticker->setTicks(key_ticks, com_labels);
+    qSharedPointerCast<SequenceItemTicker>(keyAxis()->ticker())->setItemCount(items_.size());
+    qSharedPointerCast<SequenceItemTicker>(comment_axis_->ticker())->setItemCount(items_.size());
 }
 
 void SequenceDiagram::setSelectedPacket(int selected_packet)
@@ -192,6 +216,12 @@ void SequenceDiagram::setSelectedPacket(int selected_packet)
     selected_key_ = -1;
     if (selected_packet > 0) {
         selected_packet_ = selected_packet;
+        for (int key = 0; key < items_.size(); key++) {
+            if (items_[key]->frame_number == selected_packet_) {
+                selected_key_ = key;
+                break;
+            }
+        }
     } else {
         selected_packet_ = 0;
     }
@@ -200,19 +230,14 @@ void SequenceDiagram::setSelectedPacket(int selected_packet)
 
 _seq_analysis_item *SequenceDiagram::itemForPosY(int ypos)
 {
-    double key_pos = qRound(key_axis_->pixelToCoord(ypos));
-
-    if (key_pos >= 0 && key_pos < data_->size()) {
-        return data_->value(key_pos).value;
-    }
-    return NULL;
+    return itemForKey(key_axis_->pixelToCoord(ypos));
 }
 
 double SequenceDiagram::selectTest(const QPointF &pos, bool, QVariant *) const
 {
     double key_pos = qRound(key_axis_->pixelToCoord(pos.y()));
 
-    if (key_pos >= 0 && key_pos < data_->size()) {
+    if (key_pos >= 0 && key_pos < items_.size()) {
         return 1.0;
     }
 
@@ -240,10 +265,12 @@ void SequenceDiagram::draw(QCPPainter *painter)
     painter->restore();
     fg_pen = pen();
 
-    WSCPSeqDataMap::const_iterator it;
-    for (it = data_->constBegin(); it != data_->constEnd(); ++it) {
-        double cur_key = it.key();
-        seq_analysis_item_t *sai = it.value().value;
+    // Only the rows that are at least partly on screen.
+    int first_key = qMax(0, qFloor(key_axis_->range().lower));
+    int last_key = qMin(items_.size() - 1, qCeil(key_axis_->range().upper));
+    for (int key = first_key; key <= last_key; key++) {
+        double cur_key = key;
+        seq_analysis_item_t *sai = items_[key];
         QColor bg_color;
 
         if (sai->frame_number == selected_packet_) {
@@ -366,18 +393,10 @@ QCPRange SequenceDiagram::getKeyRange(bool &validRange, QCP::SignDomain) const
     QCPRange range;
     bool valid = false;
 
-    WSCPSeqDataMap::const_iterator it = data_->constBegin();
-    while (it != data_->constEnd()) {
-        double cur_key = it.key();
-        if (!valid) {
-            range.lower = range.upper = cur_key;
-            valid = true;
-        } else if (cur_key < range.lower) {
-            range.lower = cur_key;
-        } else if (cur_key > range.upper) {
-            range.upper = cur_key;
-        }
-        ++it;
+    if (items_.size() > 0) {
+        range.lower = 0;
+        range.upper = items_.size() - 1;
+        valid = true;
     }
     validRange = valid;
     return range;
@@ -390,7 +409,7 @@ QCPRange SequenceDiagram::getValueRange(bool &validRange, QCP::SignDomain, const
 
     if (sainfo_) {
         range.lower = 0;
-        range.upper = data_->size();
+        range.upper = items_.size();
         valid = true;
     }
     validRange = valid;
@@ -17,24 +17,12 @@
 #include <epan/address.h>
 
 #include <QObject>
-#include <QMultiMap>
+#include <QVector>
 #include <ui/qt/widgets/qcustomplot.h>
 
 struct _seq_analysis_info;
 struct _seq_analysis_item;
 
-// Some of this is probably unnecessary
-class WSCPSeqData
-{
-public:
-  WSCPSeqData();
-  WSCPSeqData(double key, _seq_analysis_item *value);
-  double key;
-  struct _seq_analysis_item *value;
-};
-
-typedef QMultiMap<double, WSCPSeqData> WSCPSeqDataMap;
-
 class SequenceDiagram : public QCPAbstractPlottable
 {
     Q_OBJECT
@@ -48,6 +36,9 @@ public:
 
     double selectedKey() { return selected_key_; }
 
+    // The displayed item at a row (key), or NULL.
+    struct _seq_analysis_item *itemForKey(double key) const;
+
     // setters:
     void setData(struct _seq_analysis_info *sainfo);
 
@@ -55,7 +46,7 @@ public:
     struct _seq_analysis_item *itemForPosY(int ypos);
 
     // reimplemented virtual methods:
-    virtual void clearData() { data_->clear(); }
+    virtual void clearData() { items_.clear(); }
     virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=0) const Q_DECL_OVERRIDE;
 
 public slots:
@@ -71,7 +62,8 @@ private:
     QCPAxis *key_axis_;
     QCPAxis *value_axis_;
     QCPAxis *comment_axis_;
-    WSCPSeqDataMap *data_;
+    // Displayed items. The key of an item is its index.
+    QVector<struct _seq_analysis_item *> items_;
     struct _seq_analysis_info *sainfo_;
     guint32 selected_packet_;
     double selected_key_;
@@ -24,6 +24,23 @@
 
 static QHash<const QString, register_srt_t *> cfg_str_to_srt_;
 
+// Percentile shown in each of the SRT_COLUMN_P* columns
+static double srt_column_percentile(int col)
+{
+    switch (col) {
+    case SRT_COLUMN_P50:
+        return 50.0;
+    case SRT_COLUMN_P90:
+        return 90.0;
+    case SRT_COLUMN_P99:
+        return 99.0;
+    case SRT_COLUMN_P999:
+        return 99.9;
+    default:
+        return 0.0;
+    }
+}
+
 extern "C" {
 static void
 srt_init(const char *args, void*) {
@@ -92,6 +109,9 @@ public:
         setText(SRT_COLUMN_MAX, QString::number(nstime_to_sec(&procedure_->stats.max), 'f', 6));
         setText(SRT_COLUMN_AVG, QString::number(get_average(&procedure_->stats.tot, procedure_->stats.num) / 1000.0, 'f', 6));
         setText(SRT_COLUMN_SUM, QString::number(nstime_to_sec(&procedure_->stats.tot), 'f', 6));
+        for (int col = SRT_COLUMN_P50; col <= SRT_COLUMN_P999; col++) {
+            setText(col, QString::number(time_stat_percentile(&procedure_->stats, srt_column_percentile(col)) / 1000.0, 'f', 6));
+        }
 
         for (int col = 0; col < columnCount(); col++) {
             if (col == SRT_COLUMN_PROCEDURE) continue;
@@ -123,6 +143,14 @@ public:
         }
         case SRT_COLUMN_SUM:
             return nstime_cmp(&procedure_->stats.tot, &other_row->procedure_->stats.tot) < 0;
+        case SRT_COLUMN_P50:
+        case SRT_COLUMN_P90:
+        case SRT_COLUMN_P99:
+        case SRT_COLUMN_P999:
+        {
+            double percentile = srt_column_percentile(treeWidget()->sortColumn());
+            return time_stat_percentile(&procedure_->stats, percentile) < time_stat_percentile(&other_row->procedure_->stats, percentile);
+        }
         default:
             break;
         }
@@ -133,7 +161,11 @@ public:
         return QList<QVariant>() << QString(procedure_->procedure) << procedure_->proc_index << procedure_->stats.num
                                  << nstime_to_sec(&procedure_->stats.min) << nstime_to_sec(&procedure_->stats.max)
                                  << get_average(&procedure_->stats.tot, procedure_->stats.num) / 1000.0
-                                 << nstime_to_sec(&procedure_->stats.tot);
+                                 << nstime_to_sec(&procedure_->stats.tot)
+                                 << time_stat_percentile(&procedure_->stats, 50.0) / 1000.0
+                                 << time_stat_percentile(&procedure_->stats, 90.0) / 1000.0
+                                 << time_stat_percentile(&procedure_->stats, 99.0) / 1000.0
+                                 << time_stat_percentile(&procedure_->stats, 99.9) / 1000.0;
     }
 private:
     const srt_procedure_t *procedure_;
@@ -138,6 +138,7 @@ void StatsTreeDialog::fillTree()
         reject(); // XXX Stay open instead?
         return;
     }
+    set_tap_merge(st_, stats_tree_merge);
 
     cap_file_.retapPackets();
     drawTreeItems(st_);
@@ -50,6 +50,7 @@ TrafficTableDialog::TrafficTableDialog(QWidget &parent, CaptureFile &cf, const c
 
     ui->enabledTypesPushButton->setText(tr("%1 Types").arg(table_name));
     ui->absoluteTimeCheckBox->hide();
+    ui->approximateCheckBox->hide();
     setWindowSubtitle(QString("%1s").arg(table_name));
 
     copy_bt_ = ui->buttonBox->addButton(tr("Copy"), QDialogButtonBox::ActionRole);
@@ -163,6 +164,11 @@ QCheckBox *TrafficTableDialog::absoluteTimeCheckBox() const
     return ui->absoluteTimeCheckBox;
 }
 
+QCheckBox *TrafficTableDialog::approximateCheckBox() const
+{
+    return ui->approximateCheckBox;
+}
+
 QPushButton *TrafficTableDialog::enabledTypesPushButton() const
 {
     return ui->enabledTypesPushButton;
@@ -142,6 +142,7 @@ protected:
     QCheckBox *displayFilterCheckBox() const;
     QCheckBox *nameResolutionCheckBox() const;
     QCheckBox *absoluteTimeCheckBox() const;
+    QCheckBox *approximateCheckBox() const;
     QPushButton *enabledTypesPushButton() const;
 
 protected slots:
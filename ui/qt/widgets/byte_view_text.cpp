@@ -207,6 +207,7 @@ void ByteViewText::setMonospaceFont(const QFont &mono_font)
     layout_->setFont(int_font);
 
     updateLayoutMetrics();
+    x_pos_to_column_.clear();
 
     updateScrollbars();
     viewport()->update();
@@ -215,13 +216,14 @@ void ByteViewText::setMonospaceFont(const QFont &mono_font)
 void ByteViewText::updateByteViewSettings()
 {
     row_width_ = recent.gui_bytes_view == BYTES_HEX ? 16 : 8;
+    x_pos_to_column_.clear();
 
     updateContextMenu();
     updateScrollbars();
     viewport()->update();
 }
 
-void ByteViewText::paintEvent(QPaintEvent *)
+void ByteViewText::paintEvent(QPaintEvent *event)
 {
     updateLayoutMetrics();
 
@@ -248,16 +250,20 @@ void ByteViewText::paintEvent(QPaintEvent *)
         return;
     }
 
-    // Data rows
+    // Data rows. Only lay out the ones that need repainting; when
+    // hovering, that's just the rows of the old and new bytes.
     int widget_height = height();
-    int leading = fontMetrics().leading();
+    int row_height = line_height_ + fontMetrics().leading();
+    int first_row = qMax(0, event->rect().top() / qMax(1, row_height));
+    int bottom_y = event->rect().bottom();
     painter.save();
 
-    x_pos_to_column_.clear();
-    while ((int) (row_y + line_height_) < widget_height && offset < (int) data_.count()) {
+    offset += first_row * row_width_;
+    row_y += first_row * row_height;
+    while ((int) (row_y + line_height_) < widget_height && row_y <= bottom_y && offset < (int) data_.count()) {
         drawLine(&painter, offset, row_y);
         offset += row_width_;
-        row_y += line_height_ + leading;
+        row_y += row_height;
     }
 
     painter.restore();
@@ -325,6 +331,7 @@ void ByteViewText::mousePressEvent (QMouseEvent *event) {
         viewport()->update();
     } else {
         // Back to hover mode.
+        hovered_byte_offset_ = -1;
         mouseMoveEvent(event);
     }
     setUpdatesEnabled(true);
@@ -337,17 +344,25 @@ void ByteViewText::mouseMoveEvent(QMouseEvent *event)
         return;
     }
 
-    hovered_byte_offset_ = byteOffsetAtPixel(event->pos());
+    // Looking up the field under the pointer means searching the tree,
+    // which can be large, so only do it when we move to another byte.
+    int byte_offset = byteOffsetAtPixel(event->pos());
+    if (byte_offset == hovered_byte_offset_) {
+        return;
+    }
+
+    updateByteRow(hovered_byte_offset_);
+    hovered_byte_offset_ = byte_offset;
     emit byteHovered(hovered_byte_offset_);
-    viewport()->update();
+    updateByteRow(hovered_byte_offset_);
 }
 
 void ByteViewText::leaveEvent(QEvent *event)
 {
+    updateByteRow(hovered_byte_offset_);
     hovered_byte_offset_ = -1;
     emit byteHovered(hovered_byte_offset_);
 
-    viewport()->update();
     QAbstractScrollArea::leaveEvent(event);
 }
 
@@ -384,9 +399,10 @@ void ByteViewText::drawLine(QPainter *painter, const int offset, const int row_y
         return;
     }
 
-    // Build our pixel to byte offset vector the first time through.
-    bool build_x_pos = x_pos_to_column_.empty() ? true : false;
+    // Build our pixel to byte offset vector the first time through, from
+    // a complete row.
     int tvb_len = data_.count();
+    bool build_x_pos = x_pos_to_column_.empty() && (offset == 0 || offset + row_width_ <= tvb_len);
     int max_tvb_pos = qMin(offset + row_width_, tvb_len) - 1;
     QList<QTextLayout::FormatRange> fmt_list;
 
@@ -420,7 +436,9 @@ void ByteViewText::drawLine(QPainter *painter, const int offset, const int row_y
             /* insert a space every separator_interval_ bytes */
             if ((tvb_pos != offset) && ((tvb_pos % separator_interval_) == 0)) {
                 line += ' ';
-                x_pos_to_column_ += QVector<int>().fill(tvb_pos - offset - 1, font_width_);
+                if (build_x_pos) {
+                    x_pos_to_column_ += QVector<int>().fill(tvb_pos - offset - 1, font_width_);
+                }
             }
 
             switch (recent.gui_bytes_view) {
@@ -609,6 +627,21 @@ void ByteViewText::scrollToByte(int byte)
     verticalScrollBar()->setValue(byte / row_width_);
 }
 
+// Repaint the row holding a byte, if it's visible.
+void ByteViewText::updateByteRow(int byte)
+{
+    if (byte < 0 || line_height_ < 1) {
+        return;
+    }
+
+    int row_height = line_height_ + fontMetrics().leading();
+    int row = byte / row_width_ - verticalScrollBar()->value();
+    if (row < 0 || row * row_height >= viewport()->height()) {
+        return;
+    }
+    viewport()->update(0, row * row_height, viewport()->width(), row_height);
+}
+
 // Offset character width
 int ByteViewText::offsetChars(bool include_pad)
 {
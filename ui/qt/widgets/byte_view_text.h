@@ -84,6 +84,7 @@ private:
     bool addHexFormatRange(QList<QTextLayout::FormatRange> &fmt_list, int mark_start, int mark_length, int tvb_offset, int max_tvb_pos, HighlightMode mode);
     bool addAsciiFormatRange(QList<QTextLayout::FormatRange> &fmt_list, int mark_start, int mark_length, int tvb_offset, int max_tvb_pos, HighlightMode mode);
     void scrollToByte(int byte);
+    void updateByteRow(int byte);
     void updateScrollbars();
     int byteOffsetAtPixel(QPoint pos);
 
@@ -127,7 +128,8 @@ private:
 
     bool allow_hover_selection_;
 
-    // Data selection
+    // Data selection. Pixel to column map of a row, built when a row is
+    // next drawn after the font or format changes.
     QVector<int> x_pos_to_column_;
 
     // Context menu actions
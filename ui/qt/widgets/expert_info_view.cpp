@@ -31,11 +31,9 @@ void ExpertInfoTreeView::currentChanged(const QModelIndex &current, const QModel
         QModelIndex model_index = ((ExpertInfoProxyModel*)model())->mapToSource(current);
 
         if (model_index.parent().isValid()) {
-            ExpertPacketItem* currentItem = static_cast<ExpertPacketItem*>(model_index.internalPointer());
-            if (currentItem != NULL)
-            {
-                emit goToPacket(currentItem->packetNum(), currentItem->hfId());
-            }
+            ExpertInfoModel *source_model = static_cast<ExpertInfoModel*>(((ExpertInfoProxyModel*)model())->sourceModel());
+            ExpertPacketItem currentItem = source_model->item(model_index);
+            emit goToPacket(currentItem.packetNum(), currentItem.hfId());
         }
     }
 
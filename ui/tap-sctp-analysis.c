@@ -15,6 +15,7 @@
 
 #include <glib.h>
 
+#include "epan/frame_list.h"
 #include "epan/packet_info.h"
 #include "epan/tap.h"
 #include "epan/value_string.h"
@@ -37,6 +38,14 @@
 
 static sctp_allassocs_info_t sctp_tapinfo_struct = {0, NULL, FALSE, NULL};
 
+/*
+ * The frame lists and the copies of DATA, SACK and FORWARD-TSN chunks
+ * kept for the graphs; there's one of the latter for every chunk, so
+ * they're carved out of blocks rather than each malloc'd, and all freed
+ * at once when the tap is reset.
+ */
+static wmem_allocator_t *sctp_scope = NULL;
+
 static void
 free_first(gpointer data, gpointer user_data _U_)
 {
@@ -49,10 +58,8 @@ tsn_free(gpointer data)
     tsn_t *tsn;
 
     tsn = (tsn_t *) data;
-    if (tsn->tsns != NULL)
-    {
-        g_list_free_full(tsn->tsns, g_free);
-    }
+    /* The chunk copies themselves belong to sctp_scope */
+    g_list_free(tsn->tsns);
     free_address(&tsn->src);
     free_address(&tsn->dst);
     g_free(tsn);
@@ -106,11 +113,8 @@ reset(void *arg)
             info->error_info_list = NULL;
         }
 
-        if (info->frame_numbers != NULL)
-        {
-            g_list_free(info->frame_numbers);
-            info->frame_numbers = NULL;
-        }
+        /* Allocated from sctp_scope, freed below */
+        info->frame_numbers = NULL;
 
         if (info->tsn1 != NULL)
         {
@@ -136,18 +140,6 @@ reset(void *arg)
             info->sack2 = NULL;
         }
 
-        if (info->sort_tsn1 != NULL)
-            g_ptr_array_free(info->sort_tsn1, TRUE);
-
-        if (info->sort_tsn2 != NULL)
-            g_ptr_array_free(info->sort_tsn2, TRUE);
-
-        if (info->sort_sack1 != NULL)
-            g_ptr_array_free(info->sort_sack1, TRUE);
-
-        if (info->sort_sack2 != NULL)
-            g_ptr_array_free(info->sort_sack2, TRUE);
-
         if (info->min_max != NULL)
         {
             g_slist_foreach(info->min_max, free_first, NULL);
@@ -169,6 +161,9 @@ reset(void *arg)
     g_list_free(tapdata->assoc_info_list);
     tapdata->sum_tvbs = 0;
     tapdata->assoc_info_list = NULL;
+
+    if (sctp_scope)
+        wmem_free_all(sctp_scope);
 }
 
 
@@ -324,7 +319,7 @@ static tap_packet_status
 packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const void *data)
 {
     const struct _sctp_info *sctp_info = (const struct _sctp_info *)data;
-    guint32 chunk_number = 0, tsnumber, framenumber;
+    guint32 chunk_number = 0, tsnumber;
     sctp_tmp_info_t tmp_info;
     sctp_assoc_info_t *info = NULL;
     sctp_error_info_t *error = NULL;
@@ -336,13 +331,12 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
     gboolean sackchunk = FALSE;
     gboolean datachunk = FALSE;
     gboolean forwardchunk = FALSE;
-    struct tsn_sort *tsn_s;
+    guint32 window;
     int i;
     guint8 idx = 0;
     gboolean tsn_used = FALSE;
     gboolean sack_used = FALSE;
 
-    framenumber = pinfo->num;
 
     type = sctp_info->ip_src.type;
 
@@ -437,10 +431,7 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
             info->max_window1       = 0;
             info->max_window2       = 0;
             info->min_max           = NULL;
-            info->sort_tsn1         = g_ptr_array_new_with_free_func(g_free);
-            info->sort_tsn2         = g_ptr_array_new_with_free_func(g_free);
-            info->sort_sack1        = g_ptr_array_new_with_free_func(g_free);
-            info->sort_sack2        = g_ptr_array_new_with_free_func(g_free);
+            info->frame_numbers     = frame_list_new(sctp_scope);
             info->dir1              = g_new0(sctp_init_collision_t, 1);
             info->dir1->init_min_tsn = 0xffffffff;
             info->dir1->initack_min_tsn = 0xffffffff;
@@ -625,29 +616,17 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                             tsn->first_tsn = tsnumber;
                         if (datachunk)
                         {
-                            t_s_n = (guint8 *)g_malloc(16);
+                            t_s_n = (guint8 *)wmem_alloc(sctp_scope, 16);
                             tvb_memcpy(sctp_info->tvb[chunk_number], (guint8 *)(t_s_n),0, 16);
                         }
                         else
                         {
-                            t_s_n = (guint8 *)g_malloc(length);
+                            t_s_n = (guint8 *)wmem_alloc(sctp_scope, length);
                             tvb_memcpy(sctp_info->tvb[chunk_number], (guint8 *)(t_s_n),0, length);
                         }
                         tsn->tsns = g_list_append(tsn->tsns, t_s_n);
-                        tsn_s = g_new(struct tsn_sort, 1);
-                        tsn_s->tsnumber = tsnumber;
-                        tsn_s->secs     = tsn->secs = (guint32)pinfo->rel_ts.secs;
-                        tsn_s->usecs    = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
-                        tsn_s->offset   = 0;
-                        tsn_s->framenumber = framenumber;
-                        if (datachunk)
-                            if (tvb_get_guint8(sctp_info->tvb[chunk_number],0) == SCTP_DATA_CHUNK_ID) {
-                                tsn_s->length   = length - DATA_CHUNK_HEADER_LENGTH;
-                            } else {
-                                tsn_s->length   = length - I_DATA_CHUNK_HEADER_LENGTH;
-                            }
-                            else
-                                tsn_s->length   = length;
+                        tsn->secs  = (guint32)pinfo->rel_ts.secs;
+                        tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
                         if (tsn->secs < info->min_secs)
                         {
                             info->min_secs  = tsn->secs;
@@ -663,7 +642,6 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                         }
                         else if (tsn->secs == info->max_secs && tsn->usecs > info->max_usecs)
                             info->max_usecs = tsn->usecs;
-                        g_ptr_array_add(info->sort_tsn1, tsn_s);
                         info->n_array_tsn1++;
                     }
                     if ((tvb_get_guint8(sctp_info->tvb[chunk_number],0) == SCTP_SACK_CHUNK_ID) ||
@@ -677,19 +655,15 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                         length = tvb_get_ntohs(sctp_info->tvb[chunk_number], CHUNK_LENGTH_OFFSET);
                         if (sack->first_tsn == 0)
                             sack->first_tsn = tsnumber;
-                        t_s_n = (guint8 *)g_malloc(length);
+                        t_s_n = (guint8 *)wmem_alloc(sctp_scope, length);
                         tvb_memcpy(sctp_info->tvb[chunk_number], (guint8 *)(t_s_n),0, length);
                         sack->tsns = g_list_append(sack->tsns, t_s_n);
                         sackchunk = TRUE;
-                        tsn_s = g_new(struct tsn_sort, 1);
-                        tsn_s->tsnumber = tsnumber;
-                        tsn_s->secs     = tsn->secs = (guint32)pinfo->rel_ts.secs;
-                        tsn_s->usecs    = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
-                        tsn_s->offset   = 0;
-                        tsn_s->framenumber = framenumber;
-                        tsn_s->length   =  tvb_get_ntohl(sctp_info->tvb[chunk_number], SACK_CHUNK_ADV_REC_WINDOW_CREDIT_OFFSET);
-                        if (tsn_s->length > info->max_window1)
-                            info->max_window1 = tsn_s->length;
+                        tsn->secs  = (guint32)pinfo->rel_ts.secs;
+                        tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
+                        window = tvb_get_ntohl(sctp_info->tvb[chunk_number], SACK_CHUNK_ADV_REC_WINDOW_CREDIT_OFFSET);
+                        if (window > info->max_window1)
+                            info->max_window1 = window;
                         if (tsn->secs < info->min_secs)
                         {
                             info->min_secs  = tsn->secs;
@@ -705,14 +679,12 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                         }
                         else if (tsn->secs == info->max_secs && tsn->usecs > info->max_usecs)
                             info->max_usecs = tsn->usecs;
-                        g_ptr_array_add(info->sort_sack2, tsn_s);
                         info->n_sack_chunks_ep2++;
                     }
                 }
             }
             if (info->verification_tag1 != 0 || info->verification_tag2 != 0)
             {
-                guint32 number;
                 store = g_new(address, 1);
                 copy_address(store, &tmp_info.src);
                 info  = add_address(store, info, info->direction);
@@ -722,8 +694,7 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                     info = add_address(store, info, 2);
                 else
                     info = add_address(store, info, 1);
-                number = pinfo->num;
-                info->frame_numbers=g_list_prepend(info->frame_numbers, GUINT_TO_POINTER(number));
+                frame_list_append(info->frame_numbers, pinfo->num);
                 if (datachunk || forwardchunk) {
                     info->tsn1 = g_list_prepend(info->tsn1, tsn);
                     tsn_used = TRUE;
@@ -762,7 +733,6 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
     } /* endif (!info) */
     else
     {
-        guint32 number;
         info->direction = sctp_info->direction;
 
         if (info->verification_tag1 == 0 && info->verification_tag2 != sctp_info->verification_tag) {
@@ -813,8 +783,7 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
             }
             sack->frame_number = tsn->frame_number = pinfo->num;
         }
-        number = pinfo->num;
-        info->frame_numbers=g_list_prepend(info->frame_numbers, GUINT_TO_POINTER(number));
+        frame_list_append(info->frame_numbers, pinfo->num);
 
         store = g_new(address, 1);
         copy_address(store, &tmp_info.src);
@@ -984,7 +953,7 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                         tsn->first_tsn = tsnumber;
                     if (datachunk)
                     {
-                        t_s_n = (guint8 *)g_malloc(16);
+                        t_s_n = (guint8 *)wmem_alloc(sctp_scope, 16);
                         tvb_memcpy(sctp_info->tvb[chunk_number], (guint8 *)(t_s_n),0, 16);
                         if (tvb_get_guint8(sctp_info->tvb[chunk_number],0) == SCTP_DATA_CHUNK_ID) {
                             length=tvb_get_ntohs(sctp_info->tvb[chunk_number], CHUNK_LENGTH_OFFSET)-DATA_CHUNK_HEADER_LENGTH;
@@ -997,19 +966,14 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                     else
                     {
                         length=tvb_get_ntohs(sctp_info->tvb[chunk_number], CHUNK_LENGTH_OFFSET);
-                        t_s_n = (guint8 *)g_malloc(length);
+                        t_s_n = (guint8 *)wmem_alloc(sctp_scope, length);
                         tvb_memcpy(sctp_info->tvb[chunk_number], (guint8 *)(t_s_n),0, length);
                         info->n_forward_chunks++;
                     }
                     tsn->tsns = g_list_append(tsn->tsns, t_s_n);
 
-                    tsn_s = g_new0(struct tsn_sort, 1);
-                    tsn_s->tsnumber = tsnumber;
-                    tsn_s->secs  = tsn->secs = (guint32)pinfo->rel_ts.secs;
-                    tsn_s->usecs = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
-                    tsn_s->offset = 0;
-                    tsn_s->framenumber = framenumber;
-                    tsn_s->length = length;
+                    tsn->secs  = (guint32)pinfo->rel_ts.secs;
+                    tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
 
                     if (tsn->secs < info->min_secs)
                     {
@@ -1079,7 +1043,6 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                             }
                         }
 
-                        g_ptr_array_add(info->sort_tsn1, tsn_s);
                         info->n_array_tsn1++;
                     }
                     else if (info->direction == 2)
@@ -1145,7 +1108,6 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                             }
                         }
 
-                        g_ptr_array_add(info->sort_tsn2, tsn_s);
                         info->n_array_tsn2++;
                     }
                 }
@@ -1159,17 +1121,13 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                     if (sack->first_tsn == 0)
                         sack->first_tsn = tsnumber;
 
-                    t_s_n = (guint8 *)g_malloc(length);
+                    t_s_n = (guint8 *)wmem_alloc(sctp_scope, length);
                     tvb_memcpy(sctp_info->tvb[chunk_number], (guint8 *)(t_s_n),0, length);
                     sack->tsns = g_list_append(sack->tsns, t_s_n);
                     sackchunk = TRUE;
-                    tsn_s = g_new0(struct tsn_sort, 1);
-                    tsn_s->tsnumber = tsnumber;
-                    tsn_s->secs   = tsn->secs = (guint32)pinfo->rel_ts.secs;
-                    tsn_s->usecs  = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
-                    tsn_s->offset = 0;
-                    tsn_s->framenumber = framenumber;
-                    tsn_s->length = tvb_get_ntohl(sctp_info->tvb[chunk_number], SACK_CHUNK_ADV_REC_WINDOW_CREDIT_OFFSET);
+                    tsn->secs  = (guint32)pinfo->rel_ts.secs;
+                    tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
+                    window = tvb_get_ntohl(sctp_info->tvb[chunk_number], SACK_CHUNK_ADV_REC_WINDOW_CREDIT_OFFSET);
 
                     if (tsn->secs < info->min_secs)
                     {
@@ -1194,9 +1152,8 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                             info->min_tsn1 = tsnumber;
                         if(tsnumber > info->max_tsn1)
                             info->max_tsn1 = tsnumber;
-                        if (tsn_s->length > info->max_window1)
-                            info->max_window1 = tsn_s->length;
-                        g_ptr_array_add(info->sort_sack1, tsn_s);
+                        if (window > info->max_window1)
+                            info->max_window1 = window;
                         info->n_sack_chunks_ep1++;
                     }
                     else if (info->direction == 1)
@@ -1205,9 +1162,8 @@ packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const voi
                             info->min_tsn2 = tsnumber;
                         if(tsnumber > info->max_tsn2)
                             info->max_tsn2 = tsnumber;
-                        if (tsn_s->length > info->max_window2)
-                            info->max_window2 = tsn_s->length;
-                        g_ptr_array_add(info->sort_sack2, tsn_s);
+                        if (window > info->max_window2)
+                            info->max_window2 = window;
                         info->n_sack_chunks_ep2++;
                     }
                 }
@@ -1284,6 +1240,8 @@ register_tap_listener_sctp_stat(void)
 
     if (!sctp_tapinfo_struct.is_registered)
     {
+        if (!sctp_scope)
+            sctp_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
         if ((error_string = register_tap_listener("sctp", &sctp_tapinfo_struct, NULL, 0, reset, packet, NULL, NULL))) {
             simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK, "%s", error_string->str);
             g_string_free(error_string, TRUE);
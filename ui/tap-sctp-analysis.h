@@ -14,6 +14,7 @@
 
 #include <epan/dissectors/packet-sctp.h>
 #include <epan/address.h>
+#include <epan/frame_list.h>
 #ifdef _WIN32
 #include <winsock2.h>
 #else
@@ -169,15 +170,6 @@ typedef struct _sctp_init_collision {
 	gboolean initack:1;
 } sctp_init_collision_t;
 
-struct tsn_sort{
-	guint32 tsnumber;
-	guint32 secs;
-	guint32 usecs;
-	guint32 offset;
-	guint32 length;
-	guint32 framenumber;
-};
-
 typedef struct _sctp_addr_chunk {
 	guint32	 direction;
 	address addr;
@@ -251,14 +243,10 @@ typedef struct _sctp_assoc_info {
 	sctp_init_collision_t *dir1;
 	sctp_init_collision_t *dir2;
 	GSList	  *min_max;
-	GList	  *frame_numbers;
+	frame_list_t *frame_numbers;
 	GList	  *tsn1;
-	GPtrArray *sort_tsn1;
-	GPtrArray *sort_sack1;
 	GList	  *sack1;
 	GList	  *tsn2;
-	GPtrArray *sort_tsn2;
-	GPtrArray *sort_sack2;
 	GList	  *sack2;
 	gboolean   check_address;
 	GList*	   error_info_list;
@@ -104,6 +104,7 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg)
 {
     GString    *error_string;
     tcp_scan_t  ts;
+    const frame_list_t *stream_frames;
 
     if (!cf || !tg) {
         return;
@@ -123,7 +124,13 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg)
         g_string_free(error_string, TRUE);
         exit(1);   /* XXX: fix this */
     }
-    cf_retap_packets(cf);
+    /* Only the stream's own frames can have its segments. */
+    stream_frames = get_tcp_stream_frames(tg->stream);
+    if (stream_frames && frame_list_count(stream_frames) != 0) {
+        cf_retap_frame_list(cf, stream_frames);
+    } else {
+        cf_retap_packets(cf);
+    }
     remove_tap_listener(&ts);
 }
 
@@ -17,22 +17,201 @@
 #include <wiretap/wtap_opttypes.h>
 #include <wsutil/os_version_info.h>
 #include <wsutil/report_message.h>
+#include <wsutil/task_pool.h>
 
 #include "ui/version_info.h"
 
 #include "tap_export_pdu.h"
 
+/*
+ * When there's more than one worker thread, the tap doesn't write the
+ * records itself: it collects them in batches, and a writer thread writes
+ * each batch with wtap_dump() while the next one is being dissected. At
+ * most EXP_PDU_MAX_PENDING full batches are queued; after that, the tap
+ * waits for the writer, so memory stays bounded if the output is slow.
+ */
+#define EXP_PDU_BATCH_RECORDS   512
+#define EXP_PDU_BATCH_BYTES     (1024 * 1024)
+#define EXP_PDU_MAX_PENDING     8
+
+typedef struct {
+    wtap_rec    rec;
+    guint32     framenum;
+    guint       data_offset;    /* in the batch's data */
+} exp_pdu_rec_t;
+
+typedef struct {
+    GArray     *recs;           /* of exp_pdu_rec_t */
+    GByteArray *data;           /* the records' data, back to back */
+} exp_pdu_batch_t;
+
+struct _exp_pdu_writer {
+    GThread         *thread;
+    wtap_dumper     *wdh;
+    exp_pdu_batch_t *current;   /* being filled by the tap */
+    GMutex           mutex;     /* protects everything below */
+    GCond            cond;
+    GQueue           pending;   /* full batches, oldest first */
+    gboolean         closing;
+    gboolean         failed;
+    int              err;
+    gchar           *err_info;
+    guint32          err_framenum;
+    gboolean         err_reported;
+};
+
+static exp_pdu_batch_t *
+exp_pdu_batch_new(void)
+{
+    exp_pdu_batch_t *batch = g_new(exp_pdu_batch_t, 1);
+
+    batch->recs = g_array_sized_new(FALSE, FALSE, sizeof(exp_pdu_rec_t), EXP_PDU_BATCH_RECORDS);
+    batch->data = g_byte_array_sized_new(EXP_PDU_BATCH_BYTES);
+    return batch;
+}
+
+static void
+exp_pdu_batch_free(exp_pdu_batch_t *batch)
+{
+    for (guint i = 0; i < batch->recs->len; i++)
+        wtap_block_unref(g_array_index(batch->recs, exp_pdu_rec_t, i).rec.block);
+    g_array_free(batch->recs, TRUE);
+    g_byte_array_free(batch->data, TRUE);
+    g_free(batch);
+}
+
+static gpointer
+exp_pdu_writer_thread(gpointer data)
+{
+    struct _exp_pdu_writer *writer = (struct _exp_pdu_writer *)data;
+    exp_pdu_batch_t *batch;
+    gboolean failed;
+    int err;
+    gchar *err_info;
+
+    for (;;) {
+        g_mutex_lock(&writer->mutex);
+        while (g_queue_is_empty(&writer->pending) && !writer->closing)
+            g_cond_wait(&writer->cond, &writer->mutex);
+        batch = (exp_pdu_batch_t *)g_queue_pop_head(&writer->pending);
+        failed = writer->failed;
+        g_cond_broadcast(&writer->cond);
+        g_mutex_unlock(&writer->mutex);
+
+        if (batch == NULL)
+            break;      /* closing, and nothing left to write */
+
+        for (guint i = 0; i < batch->recs->len && !failed; i++) {
+            exp_pdu_rec_t *r = &g_array_index(batch->recs, exp_pdu_rec_t, i);
+
+            err_info = NULL;
+            if (!wtap_dump(writer->wdh, &r->rec, batch->data->data + r->data_offset, &err, &err_info)) {
+                /* Don't write anything more; the tap reports the error */
+                g_mutex_lock(&writer->mutex);
+                writer->failed = failed = TRUE;
+                writer->err = err;
+                writer->err_info = err_info;
+                writer->err_framenum = r->framenum;
+                g_mutex_unlock(&writer->mutex);
+            }
+        }
+        exp_pdu_batch_free(batch);
+    }
+
+    return NULL;
+}
+
+/* Queue the batch being filled, waiting if the writer is too far behind */
+static void
+exp_pdu_writer_push(struct _exp_pdu_writer *writer)
+{
+    exp_pdu_batch_t *batch = writer->current;
+
+    writer->current = NULL;
+    if (batch->recs->len == 0) {
+        exp_pdu_batch_free(batch);
+        return;
+    }
+
+    g_mutex_lock(&writer->mutex);
+    while (g_queue_get_length(&writer->pending) >= EXP_PDU_MAX_PENDING && !writer->failed)
+        g_cond_wait(&writer->cond, &writer->mutex);
+    g_queue_push_tail(&writer->pending, batch);
+    g_cond_broadcast(&writer->cond);
+    g_mutex_unlock(&writer->mutex);
+}
+
+/* Report a write error from the writer thread, once. */
+static gboolean
+exp_pdu_writer_check(exp_pdu_t *exp_pdu_tap_data)
+{
+    struct _exp_pdu_writer *writer = exp_pdu_tap_data->writer;
+    gboolean failed;
+
+    g_mutex_lock(&writer->mutex);
+    failed = writer->failed;
+    g_mutex_unlock(&writer->mutex);
+
+    if (failed && !writer->err_reported) {
+        report_cfile_write_failure(NULL, exp_pdu_tap_data->pathname,
+                                   writer->err, writer->err_info, writer->err_framenum,
+                                   wtap_dump_file_type_subtype(writer->wdh));
+        writer->err_reported = TRUE;
+    }
+    return !failed;
+}
+
+static void
+exp_pdu_writer_start(exp_pdu_t *exp_pdu_tap_data)
+{
+    struct _exp_pdu_writer *writer = g_new0(struct _exp_pdu_writer, 1);
+
+    writer->wdh = exp_pdu_tap_data->wdh;
+    writer->current = exp_pdu_batch_new();
+    g_mutex_init(&writer->mutex);
+    g_cond_init(&writer->cond);
+    g_queue_init(&writer->pending);
+    writer->thread = g_thread_new("Export PDUs writer", exp_pdu_writer_thread, writer);
+
+    exp_pdu_tap_data->writer = writer;
+}
+
+/* Write whatever is still queued, and stop the writer thread. */
+static void
+exp_pdu_writer_finish(exp_pdu_t *exp_pdu_tap_data)
+{
+    struct _exp_pdu_writer *writer = exp_pdu_tap_data->writer;
+
+    exp_pdu_writer_push(writer);
+
+    g_mutex_lock(&writer->mutex);
+    writer->closing = TRUE;
+    g_cond_broadcast(&writer->cond);
+    g_mutex_unlock(&writer->mutex);
+    g_thread_join(writer->thread);
+
+    exp_pdu_writer_check(exp_pdu_tap_data);
+
+    g_free(writer->err_info);
+    g_mutex_clear(&writer->mutex);
+    g_cond_clear(&writer->cond);
+    g_free(writer);
+    exp_pdu_tap_data->writer = NULL;
+}
+
 /* Main entry point to the tap */
 static tap_packet_status
 export_pdu_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data)
 {
     const exp_pdu_data_t *exp_pdu_data = (const exp_pdu_data_t *)data;
     exp_pdu_t  *exp_pdu_tap_data = (exp_pdu_t *)tapdata;
+    struct _exp_pdu_writer *writer = exp_pdu_tap_data->writer;
     wtap_rec rec;
     int err;
     gchar *err_info;
     int buffer_len;
     guint8 *packet_buf;
+    guint data_offset = 0;
     tap_packet_status status = TAP_PACKET_DONT_REDRAW; /* no GUI, nothing to redraw */
 
     /*
@@ -42,7 +221,16 @@ export_pdu_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const
 
     memset(&rec, 0, sizeof rec);
     buffer_len = exp_pdu_data->tvb_captured_length + exp_pdu_data->tlv_buffer_len;
-    packet_buf = (guint8 *)g_malloc(buffer_len);
+    if (writer) {
+        /* Put the data straight into the batch */
+        if (!exp_pdu_writer_check(exp_pdu_tap_data))
+            return TAP_PACKET_FAILED;
+        data_offset = writer->current->data->len;
+        g_byte_array_set_size(writer->current->data, data_offset + buffer_len);
+        packet_buf = writer->current->data->data + data_offset;
+    } else {
+        packet_buf = (guint8 *)g_malloc(buffer_len);
+    }
 
     if(exp_pdu_data->tlv_buffer_len > 0){
         memcpy(packet_buf, exp_pdu_data->tlv_buffer, exp_pdu_data->tlv_buffer_len);
@@ -69,6 +257,24 @@ export_pdu_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const
         rec.block = pinfo->rec->block;
     }
 
+    if (writer) {
+        exp_pdu_rec_t r;
+
+        /* The block is only read by the writer, so it can share it */
+        r.rec = rec;
+        r.rec.block = wtap_block_ref(rec.block);
+        r.framenum = exp_pdu_tap_data->framenum;
+        r.data_offset = data_offset;
+        g_array_append_val(writer->current->recs, r);
+
+        if (writer->current->recs->len >= EXP_PDU_BATCH_RECORDS ||
+            writer->current->data->len >= EXP_PDU_BATCH_BYTES) {
+            exp_pdu_writer_push(writer);
+            writer->current = exp_pdu_batch_new();
+        }
+        return status;
+    }
+
     /* XXX: should the rec.rec_header.packet_header.pseudo_header be set to the pinfo's pseudo-header? */
     if (!wtap_dump(exp_pdu_tap_data->wdh, &rec, packet_buf, &err, &err_info)) {
         report_cfile_write_failure(NULL, exp_pdu_tap_data->pathname,
@@ -84,8 +290,8 @@ export_pdu_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const
 
 gboolean
 exp_pdu_open(exp_pdu_t *exp_pdu_tap_data, char *pathname,
-             int file_type_subtype, int fd, const char *comment,
-             int *err, gchar **err_info)
+             int file_type_subtype, wtap_compression_type compression_type,
+             int fd, const char *comment, int *err, gchar **err_info)
 {
     /* pcapng defs */
     wtap_block_t                 shb_hdr;
@@ -167,16 +373,19 @@ exp_pdu_open(exp_pdu_t *exp_pdu_tap_data, char *pathname,
     };
     if (fd == 1) {
         exp_pdu_tap_data->wdh = wtap_dump_open_stdout(file_type_subtype,
-                WTAP_UNCOMPRESSED, &params, err, err_info);
+                compression_type, &params, err, err_info);
     } else {
         exp_pdu_tap_data->wdh = wtap_dump_fdopen(fd, file_type_subtype,
-                WTAP_UNCOMPRESSED, &params, err, err_info);
+                compression_type, &params, err, err_info);
     }
     if (exp_pdu_tap_data->wdh == NULL)
         return FALSE;
 
     exp_pdu_tap_data->pathname = pathname;
     exp_pdu_tap_data->framenum = 0; /* No frames written yet */
+    exp_pdu_tap_data->writer = NULL;
+    if (task_pool_get_max_threads() > 1)
+        exp_pdu_writer_start(exp_pdu_tap_data);
     return TRUE;
 }
 
@@ -185,6 +394,10 @@ exp_pdu_close(exp_pdu_t *exp_pdu_tap_data, int *err, gchar **err_info)
 {
     gboolean status;
 
+    /* No more records will come from the tap, so wait for them all to be written */
+    if (exp_pdu_tap_data->writer)
+        exp_pdu_writer_finish(exp_pdu_tap_data);
+
     status = wtap_dump_close(exp_pdu_tap_data->wdh, err, err_info);
 
     wtap_block_array_free(exp_pdu_tap_data->shb_hdrs);
@@ -23,6 +23,7 @@ typedef struct _exp_pdu_t {
     GArray* shb_hdrs;
     wtapng_iface_descriptions_t* idb_inf;
     guint32      framenum;
+    struct _exp_pdu_writer* writer; /* NULL if records are written by the tap itself */
 } exp_pdu_t;
 
 /**
@@ -42,15 +43,20 @@ char *exp_pdu_pre_open(const char *tap_name, const char *filter,
 * Use the given file descriptor for writing an output file. Can only be called
 * once and exp_pdu_pre_open() must be called before.
 *
+* If there's more than one worker thread, the records are handed to a
+* writer thread in batches, so that the export isn't held up by the output.
+*
+* @param compression_type Type of compression to use when writing, if any.
 * @param[out] err Will be set to an error code on failure.
 * @param[out] err_info for some errors, a string giving more details of
 * the error
 * @return TRUE on success or FALSE on failure.
 */
 gboolean exp_pdu_open(exp_pdu_t *data, char *pathname, int file_type_subtype,
-    int fd, const char *comment, int *err, gchar **err_info);
+    wtap_compression_type compression_type, int fd, const char *comment,
+    int *err, gchar **err_info);
 
-/* Stops the PDUs export. */
+/* Stops the PDUs export, after writing any records still queued. */
 gboolean exp_pdu_close(exp_pdu_t *exp_pdu_tap_data, int *err, gchar **err_info);
 
 #ifdef __cplusplus
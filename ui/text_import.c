@@ -394,9 +394,17 @@ static import_status_t
 write_byte(const char *str)
 {
     guint32 num;
-
-    if (parse_num(str, FALSE, &num) != IMPORT_SUCCESS)
+    int hi, lo;
+
+    /* The scanner only hands us two hex digits, maybe followed by a
+     * separator; decode those directly rather than through strtoul(). */
+    hi = g_ascii_xdigit_value(str[0]);
+    lo = hi >= 0 ? g_ascii_xdigit_value(str[1]) : -1;
+    if (lo >= 0 && !g_ascii_isxdigit(str[2])) {
+        num = (guint32)(hi << 4 | lo);
+    } else if (parse_num(str, FALSE, &num) != IMPORT_SUCCESS) {
         return IMPORT_FAILURE;
+    }
 
     packet_buf[curr_offset] = (guint8) num;
     curr_offset++;
@@ -931,6 +939,25 @@ static int parse_plain_data(guchar** src, const guchar* src_end,
         wmem_free(NULL, debug_str);
     }
     while (*src < src_end && *dest + encoding->bytes_per_unit <= dest_end) {
+        if (encoding == &hex_decode_info && c_chars == 0) {
+            /* Fast path for the common case: runs of whole hex bytes */
+            const guchar* s = *src;
+            guint8* d = *dest;
+            gint8 hi, lo;
+            while (s + 1 < src_end && d < dest_end &&
+                   (hi = encoding->table[s[0]]) >= 0 && (lo = encoding->table[s[1]]) >= 0) {
+                *d++ = (guint8)(hi << 4 | lo);
+                s += 2;
+            }
+            if (d != *dest) {
+                units += (int)(d - *dest);
+                if (src_last_unit)
+                    *src_last_unit = (guchar*)s - 1;
+                *src = (guchar*)s;
+                *dest = d;
+                continue;
+            }
+        }
         val = encoding->table[**src];
         switch (val) {
           case INVALID_VALUE:
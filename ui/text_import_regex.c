@@ -25,6 +25,146 @@ typedef unsigned int uint;
 
 /*--- Options --------------------------------------------------------------------*/
 
+/*
+ * Matching the regex is most of the work, so large files are split into
+ * chunks that are matched by a pool of threads while the packets are
+ * built and written, in order, by the calling thread.
+ */
+#define REGEX_CHUNK_MIN_SIZE    (4 * 1024 * 1024)
+#define REGEX_CHUNK_MAX_SIZE    (64 * 1024 * 1024)
+/* Chunks matched ahead of the writer, per thread */
+#define REGEX_CHUNKS_AHEAD      2
+
+/* A match, as offsets into the file. Absent fields are -1. */
+typedef struct {
+    gint start, end;
+    gint data_start, data_end;
+    gint time_start, time_end;
+    gint dir_start, dir_end;
+    gint seqno_start, seqno_end;
+} regex_match_t;
+
+typedef struct {
+    GRegex* format;
+    const gchar* content;
+    gssize length;
+    gboolean re_time, re_dir, re_seqno;
+} regex_scan_t;
+
+/* The matches starting in [start, end), as found by searching from start. */
+typedef struct {
+    const regex_scan_t* scan;
+    gint start, end;
+    GArray* matches;
+    gboolean failed;
+    gboolean done;
+    GMutex lock;
+    GCond cond;
+} regex_chunk_t;
+
+static void
+fetch_named_pos(GMatchInfo* match, gboolean present, const gchar* name, gint* field_start, gint* field_end)
+{
+    if (!present || !g_match_info_fetch_named_pos(match, name, field_start, field_end)) {
+        *field_start = -1;
+        *field_end = -1;
+    }
+}
+
+static void
+record_match(const regex_scan_t* scan, GMatchInfo* match, regex_match_t* m)
+{
+    g_match_info_fetch_pos(match, 0, &m->start, &m->end);
+    fetch_named_pos(match, TRUE, "data", &m->data_start, &m->data_end);
+    fetch_named_pos(match, scan->re_time, "time", &m->time_start, &m->time_end);
+    fetch_named_pos(match, scan->re_dir, "dir", &m->dir_start, &m->dir_end);
+    fetch_named_pos(match, scan->re_seqno, "seqno", &m->seqno_start, &m->seqno_end);
+}
+
+/*
+ * Finds the first match at or after pos. Returns FALSE if there is none,
+ * or sets *failed on a matching error.
+ */
+static gboolean
+match_from(const regex_scan_t* scan, gint pos, regex_match_t* m, gboolean* failed)
+{
+    GMatchInfo* match;
+    GError* gerror = NULL;
+    gboolean found;
+
+    found = g_regex_match_full(scan->format, scan->content, scan->length, pos,
+            G_REGEX_MATCH_NOTEMPTY, &match, &gerror);
+    if (gerror) {
+        *failed = TRUE;
+        g_error_free(gerror);
+        found = FALSE;
+    }
+    if (found)
+        record_match(scan, match, m);
+    g_match_info_unref(match);
+    return found;
+}
+
+static void
+match_chunk(gpointer data, gpointer user_data _U_)
+{
+    regex_chunk_t* chunk = (regex_chunk_t*)data;
+    const regex_scan_t* scan = chunk->scan;
+    GMatchInfo* match;
+    GError* gerror = NULL;
+    regex_match_t m;
+
+    g_regex_match_full(scan->format, scan->content, scan->length, chunk->start,
+            G_REGEX_MATCH_NOTEMPTY, &match, &gerror);
+    while (!gerror && g_match_info_matches(match)) {
+        record_match(scan, match, &m);
+        if (m.start >= chunk->end)
+            break;
+        g_array_append_val(chunk->matches, m);
+        g_match_info_next(match, &gerror);
+    }
+    if (gerror) {
+        chunk->failed = TRUE;
+        g_error_free(gerror);
+    }
+    g_match_info_unref(match);
+
+    g_mutex_lock(&chunk->lock);
+    chunk->done = TRUE;
+    g_cond_signal(&chunk->cond);
+    g_mutex_unlock(&chunk->lock);
+}
+
+static void
+import_match(const text_import_info_t* info, guchar* f_content, const regex_match_t* m, int packet)
+{
+    if (m->data_start < 0) {
+        fprintf(stderr, "Warning: could not fetch data on would be packet %d, discarding\n", packet);
+        return;
+    }
+    parse_data(f_content + m->data_start, f_content + m->data_end, info->regex.encoding);
+
+    /* parse the auxillary information if present */
+    if (m->time_start >= 0) {
+        parse_time(f_content + m->time_start, f_content + m->time_end, info->timestamp_format);
+    } else {
+        /* No time present, so add a fixed delta. */
+        parse_time(NULL, NULL, NULL);
+    }
+
+    if (m->dir_start >= 0)
+        parse_dir(f_content + m->dir_start, f_content + m->dir_end, info->regex.in_indication, info->regex.out_indication);
+
+    if (m->seqno_start >= 0)
+        parse_seqno(f_content + m->seqno_start, f_content + m->seqno_end);
+
+    if (ws_log_get_level() == LOG_LEVEL_NOISY) {
+        ws_noisy("Packet %d at %x to %x: %.*s\n", packet,
+                m->start, m->end, m->end - m->start, f_content + m->start);
+    }
+    flush_packet();
+}
+
 int text_import_regex(const text_import_info_t* info) {
     int status = 1;
     int parsed_packets = 0;
@@ -32,7 +172,6 @@ int text_import_regex(const text_import_info_t* info) {
 
     // IO
     GMappedFile* file = g_mapped_file_ref(info->regex.import_text_GMappedFile);
-    GError* gerror = NULL;
     gsize f_size = g_mapped_file_get_length(file);
     guchar* f_content = g_mapped_file_get_contents(file);
     { /* zero terminate the file */
@@ -45,14 +184,14 @@ int text_import_regex(const text_import_info_t* info) {
     }
 
     // Regex result dissecting
-    gboolean re_time, re_dir, re_seqno;
-    GMatchInfo* match;
-    gint field_start;
-    gint field_end;
+    regex_scan_t scan;
     { /* analyze regex */
-        re_time = g_regex_get_string_number(info->regex.format, "time") >= 0;
-        re_dir = g_regex_get_string_number(info->regex.format, "dir") >= 0;
-        re_seqno = g_regex_get_string_number(info->regex.format, "seqno") >= 0;
+        scan.format = info->regex.format;
+        scan.content = (const gchar*)f_content;
+        scan.length = (gssize)f_size;
+        scan.re_time = g_regex_get_string_number(info->regex.format, "time") >= 0;
+        scan.re_dir = g_regex_get_string_number(info->regex.format, "dir") >= 0;
+        scan.re_seqno = g_regex_get_string_number(info->regex.format, "seqno") >= 0;
         if (g_regex_get_string_number(info->regex.format, "data") < 0) {
             /* This should never happen, as the dialog checks for this */
             fprintf(stderr, "Error could not find data in pattern\n");
@@ -61,55 +200,105 @@ int text_import_regex(const text_import_info_t* info) {
         }
     }
 
-    ws_debug("regex has %s%s%s", re_dir ? "dir, " : "",
-                                 re_time ? "time, " : "",
-                                 re_seqno ? "seqno, " : "");
-    g_regex_match(info->regex.format, f_content, G_REGEX_MATCH_NOTEMPTY, &match);
-    while (g_match_info_matches(match)) {
-        /* parse the data */
-        if (!g_match_info_fetch_named_pos(match, "data", &field_start, &field_end)) {
-            fprintf(stderr, "Warning: could not fetch data on would be packet %d, discarding\n", parsed_packets + 1);
-            continue;
-        }
-        parse_data(f_content + field_start, f_content + field_end, info->regex.encoding);
-
-        /* parse the auxillary information if present */
-        if (re_time &&
-                g_match_info_fetch_named_pos(match, "time", &field_start, &field_end)) {
-            parse_time(f_content + field_start, f_content + field_end, info->timestamp_format);
-	} else {
-            /* No time present, so add a fixed delta. */
-            parse_time(NULL, NULL, NULL);
-        }
+    ws_debug("regex has %s%s%s", scan.re_dir ? "dir, " : "",
+                                 scan.re_time ? "time, " : "",
+                                 scan.re_seqno ? "seqno, " : "");
 
-        if (re_dir &&
-                g_match_info_fetch_named_pos(match, "dir", &field_start, &field_end))
-            parse_dir(f_content + field_start, f_content + field_end, info->regex.in_indication, info->regex.out_indication);
+    /*
+     * Split the file into chunks. A chunk's thread searches from the start
+     * of the chunk, which is only where the serial search would be if the
+     * last match of the previous chunk didn't run into this one; when it
+     * did, the serial search is redone from the end of that match until it
+     * lands on a match the thread found, after which the two agree.
+     */
+    guint n_threads = g_get_num_processors();
+    gsize chunk_size = f_size / n_threads + 1;
+    if (chunk_size < REGEX_CHUNK_MIN_SIZE)
+        chunk_size = REGEX_CHUNK_MIN_SIZE;
+    if (chunk_size > REGEX_CHUNK_MAX_SIZE)
+        chunk_size = REGEX_CHUNK_MAX_SIZE;
+    guint n_chunks = (guint)((f_size + chunk_size - 1) / chunk_size);
+    if (n_chunks <= 1)
+        n_threads = 1;
+    ws_debug("matching %u chunk%s on %u thread%s", n_chunks, n_chunks == 1 ? "" : "s",
+             n_threads, n_threads == 1 ? "" : "s");
 
-        if (re_seqno &&
-                g_match_info_fetch_named_pos(match, "seqno", &field_start, &field_end))
-            parse_seqno(f_content + field_start, f_content + field_end);
+    regex_chunk_t* chunks = g_new0(regex_chunk_t, n_chunks);
+    for (guint i = 0; i < n_chunks; i++) {
+        chunks[i].scan = &scan;
+        chunks[i].start = (gint)(i * chunk_size);
+        chunks[i].end = (gint)MIN((i + 1) * chunk_size, f_size);
+        chunks[i].matches = g_array_new(FALSE, FALSE, sizeof(regex_match_t));
+        g_mutex_init(&chunks[i].lock);
+        g_cond_init(&chunks[i].cond);
+    }
 
-        if (ws_log_get_level() == LOG_LEVEL_NOISY) {
-            g_match_info_fetch_pos(match, 0, &field_start, &field_end);
-            ws_noisy("Packet %d at %x to %x: %.*s\n", parsed_packets + 1,
-                    field_start, field_end,
-                    field_end - field_start, f_content + field_start);
+    GThreadPool* pool = NULL;
+    guint pushed = 0;
+    if (n_threads > 1) {
+        pool = g_thread_pool_new(match_chunk, NULL, n_threads, FALSE, NULL);
+        for (; pushed < n_chunks && pushed < n_threads * REGEX_CHUNKS_AHEAD; pushed++)
+            g_thread_pool_push(pool, &chunks[pushed], NULL);
+    }
+
+    gint next_pos = 0;  /* where the serial search would continue */
+    gboolean failed = FALSE;
+    for (guint i = 0; i < n_chunks && !failed; i++) {
+        regex_chunk_t* chunk = &chunks[i];
+        guint j = 0;
+        regex_match_t m;
+
+        if (pool) {
+            g_mutex_lock(&chunk->lock);
+            while (!chunk->done)
+                g_cond_wait(&chunk->cond, &chunk->lock);
+            g_mutex_unlock(&chunk->lock);
+            if (pushed < n_chunks)
+                g_thread_pool_push(pool, &chunks[pushed++], NULL);
+        } else {
+            match_chunk(chunk, NULL);
         }
-        flush_packet();
 
+        while (next_pos > chunk->start && !failed) {
+            if (!match_from(&scan, next_pos, &m, &failed) || m.start >= chunk->end) {
+                j = chunk->matches->len;
+                break;
+            }
+            while (j < chunk->matches->len &&
+                   g_array_index(chunk->matches, regex_match_t, j).start < m.start)
+                j++;
+            if (j < chunk->matches->len &&
+                g_array_index(chunk->matches, regex_match_t, j).start == m.start)
+                break;
+            import_match(info, f_content, &m, ++parsed_packets);
+            next_pos = m.end;
+        }
 
-        /* prepare next packet */
-        ++parsed_packets;
-        g_match_info_next(match, &gerror);
-        if (gerror && gerror->code) {
-            status = -1;
-            g_error_free(gerror);
-            break;
+        for (; j < chunk->matches->len; j++) {
+            const regex_match_t* cm = &g_array_index(chunk->matches, regex_match_t, j);
+            import_match(info, f_content, cm, ++parsed_packets);
+            next_pos = cm->end;
         }
+
+        if (chunk->failed)
+            failed = TRUE;
+        g_array_free(chunk->matches, TRUE);
+        chunk->matches = NULL;
     }
+
+    if (pool)
+        g_thread_pool_free(pool, TRUE, TRUE);
+    for (guint i = 0; i < n_chunks; i++) {
+        if (chunks[i].matches)
+            g_array_free(chunks[i].matches, TRUE);
+        g_mutex_clear(&chunks[i].lock);
+        g_cond_clear(&chunks[i].cond);
+    }
+    g_free(chunks);
+
+    if (failed)
+        status = -1;
     ws_debug("processed %d packets", parsed_packets);
-    g_match_info_unref(match);
     g_mapped_file_unref(file);
     return status * parsed_packets;
 }
@@ -55,23 +55,29 @@
     }
 
 static void
-modify_time_perform(frame_data *fd, int neg, nstime_t *offset, int settozero)
+modify_time_perform(frame_data_sequence *fds, frame_data *fd, int neg, nstime_t *offset, int settozero)
 {
+    nstime_t shift_offset;
+
+    frame_data_sequence_get_shift_offset(fds, fd->num, &shift_offset);
+
     /* The actual shift */
     if (settozero == SHIFT_SETTOZERO) {
-        nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-        nstime_set_zero(&(fd->shift_offset));
+        nstime_subtract(&(fd->abs_ts), &shift_offset);
+        nstime_set_zero(&shift_offset);
     }
 
     if (neg == SHIFT_POS) {
         nstime_add(&(fd->abs_ts), offset);
-        nstime_add(&(fd->shift_offset), offset);
+        nstime_add(&shift_offset, offset);
     } else if (neg == SHIFT_NEG) {
         nstime_subtract(&(fd->abs_ts), offset);
-        nstime_subtract(&(fd->shift_offset), offset);
+        nstime_subtract(&shift_offset, offset);
     } else {
         fprintf(stderr, "Modify_time_perform: neg = %d?\n", neg);
     }
+
+    frame_data_sequence_set_shift_offset(fds, fd->num, &shift_offset);
 }
 
 /*
@@ -287,7 +293,7 @@ time_shift_all(capture_file *cf, const gchar *offset_text)
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->provider.frames, i)) == NULL)
             continue;   /* Shouldn't happen */
-        modify_time_perform(fd, neg ? SHIFT_NEG : SHIFT_POS, &offset, SHIFT_KEEPOFFSET);
+        modify_time_perform(cf->provider.frames, fd, neg ? SHIFT_NEG : SHIFT_POS, &offset, SHIFT_KEEPOFFSET);
     }
     cf->unsaved_changes = TRUE;
     packet_list_queue_draw();
@@ -298,7 +304,7 @@ time_shift_all(capture_file *cf, const gchar *offset_text)
 const gchar *
 time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
 {
-    nstime_t    set_time, diff_time, packet_time;
+    nstime_t    set_time, diff_time, packet_time, shift_offset;
     frame_data  *fd, *packetfd;
     guint32     i;
     const gchar *err_str;
@@ -315,7 +321,8 @@ time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
      */
     if ((packetfd = frame_data_sequence_find(cf->provider.frames, packet_num)) == NULL)
         return "No packets found.";
-    nstime_delta(&packet_time, &(packetfd->abs_ts), &(packetfd->shift_offset));
+    frame_data_sequence_get_shift_offset(cf->provider.frames, packet_num, &shift_offset);
+    nstime_delta(&packet_time, &(packetfd->abs_ts), &shift_offset);
 
     if ((err_str = time_string_to_nstime(time_text, &packet_time, &set_time)) != NULL)
         return err_str;
@@ -332,7 +339,7 @@ time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->provider.frames, i)) == NULL)
             continue;   /* Shouldn't happen */
-        modify_time_perform(fd, SHIFT_POS, &diff_time, SHIFT_SETTOZERO);
+        modify_time_perform(cf->provider.frames, fd, SHIFT_POS, &diff_time, SHIFT_SETTOZERO);
     }
 
     cf->unsaved_changes = TRUE;
@@ -345,6 +352,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
 {
     nstime_t    nt1, nt2, ot1, ot2, nt3;
     nstime_t    dnt, dot, d3t;
+    nstime_t    shift_offset, nulltime = NSTIME_INIT_ZERO;
     frame_data  *fd, *packet1fd, *packet2fd;
     guint32     i;
     const gchar *err_str;
@@ -374,8 +382,9 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
      */
     if ((packet1fd = frame_data_sequence_find(cf->provider.frames, packet1_num)) == NULL)
         return "No frames found.";
+    frame_data_sequence_get_shift_offset(cf->provider.frames, packet1_num, &shift_offset);
     nstime_copy(&ot1, &(packet1fd->abs_ts));
-    nstime_subtract(&ot1, &(packet1fd->shift_offset));
+    nstime_subtract(&ot1, &shift_offset);
 
     if ((err_str = time_string_to_nstime(time1_text, &ot1, &nt1)) != NULL)
         return err_str;
@@ -386,8 +395,9 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
      */
     if ((packet2fd = frame_data_sequence_find(cf->provider.frames, packet2_num)) == NULL)
         return "No frames found.";
+    frame_data_sequence_get_shift_offset(cf->provider.frames, packet2_num, &shift_offset);
     nstime_copy(&ot2, &(packet2fd->abs_ts));
-    nstime_subtract(&ot2, &(packet2fd->shift_offset));
+    nstime_subtract(&ot2, &shift_offset);
 
     if ((err_str = time_string_to_nstime(time2_text, &ot2, &nt2)) != NULL)
         return err_str;
@@ -407,8 +417,9 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
             continue;   /* Shouldn't happen */
 
         /* Set everything back to the original time */
-        nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-        nstime_set_zero(&(fd->shift_offset));
+        frame_data_sequence_get_shift_offset(cf->provider.frames, i, &shift_offset);
+        nstime_subtract(&(fd->abs_ts), &shift_offset);
+        frame_data_sequence_set_shift_offset(cf->provider.frames, i, &nulltime);
 
         /* Add the difference to each packet */
         calcNT3(&ot1, &(fd->abs_ts), &nt1, &nt3, &dot, &dnt);
@@ -416,7 +427,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
         nstime_copy(&d3t, &nt3);
         nstime_subtract(&d3t, &(fd->abs_ts));
 
-        modify_time_perform(fd, SHIFT_POS, &d3t, SHIFT_SETTOZERO);
+        modify_time_perform(cf->provider.frames, fd, SHIFT_POS, &d3t, SHIFT_SETTOZERO);
     }
 
     cf->unsaved_changes = TRUE;
@@ -442,7 +453,7 @@ time_shift_undo(capture_file *cf)
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->provider.frames, i)) == NULL)
             continue;   /* Shouldn't happen */
-        modify_time_perform(fd, SHIFT_NEG, &nulltime, SHIFT_SETTOZERO);
+        modify_time_perform(cf->provider.frames, fd, SHIFT_NEG, &nulltime, SHIFT_SETTOZERO);
     }
     packet_list_queue_draw();
     return NULL;
@@ -64,8 +64,16 @@ typedef struct blf_log_container {
     guint16  compression_method;      /* 0: uncompressed, 2: zlib */
 
     unsigned char  *real_data;        /* cache for decompressed data */
+    GList          *cache_link;       /* our entry in blf_t's cached_containers */
 } blf_log_container_t;
 
+/*
+ * Decompressed log containers are kept, most recently used first, until
+ * together they take up more than this; then the least recently used ones
+ * are dropped, and read and inflated again if they're needed later.
+ */
+#define BLF_CONTAINER_CACHE_MAX_BYTES   (64 * 1024 * 1024)
+
 typedef struct blf_data {
     gint64  start_of_last_obj;
     gint64  current_real_seek_pos;
@@ -74,6 +82,9 @@ typedef struct blf_data {
     guint   current_log_container;
     GArray *log_containers;
 
+    GQueue  cached_containers;        /* indices of containers with real_data, most recent first */
+    guint64 cached_bytes;
+
     GHashTable *channel_to_iface_ht;
     guint32     next_interface_id;
 } blf_t;
@@ -399,6 +410,7 @@ blf_init_logcontainer(blf_log_container_t *tmp) {
     tmp->real_first_object_pos = -1;
     tmp->real_leftover_bytes = G_MAXUINT64;
     tmp->real_data = NULL;
+    tmp->cache_link = NULL;
     tmp->compression_method = 0;
 }
 
@@ -427,64 +439,123 @@ blf_get_logcontainer_by_index(blf_t *blf_data, guint index, blf_log_container_t
 static gboolean
 blf_find_logcontainer_for_address(blf_t *blf_data, gint64 pos, blf_log_container_t **container, gint *container_index) {
     blf_log_container_t *tmp;
+    guint lo, hi;
 
-    if (blf_data == NULL || blf_data->log_containers == NULL) {
+    if (blf_data == NULL || blf_data->log_containers == NULL || blf_data->log_containers->len == 0) {
         return FALSE;
     }
 
-    for (guint i = 0; i < blf_data->log_containers->len; i++) {
-        tmp = &g_array_index(blf_data->log_containers, blf_log_container_t, i);
-        if (tmp->real_start_pos <= pos && pos < tmp->real_start_pos + (gint64)tmp->real_length) {
-            *container = tmp;
-            *container_index = i;
-            return TRUE;
+    /*
+     * The containers were added in file order, so their virtual ranges are
+     * sorted and adjacent; find the last one starting at or before pos.
+     */
+    lo = 0;
+    hi = blf_data->log_containers->len;
+    while (hi - lo > 1) {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (g_array_index(blf_data->log_containers, blf_log_container_t, mid).real_start_pos <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
         }
     }
 
+    tmp = &g_array_index(blf_data->log_containers, blf_log_container_t, lo);
+    if (tmp->real_start_pos <= pos && pos < tmp->real_start_pos + (gint64)tmp->real_length) {
+        *container = tmp;
+        *container_index = lo;
+        return TRUE;
+    }
+
     return FALSE;
 }
 
+static void
+blf_cache_touch(blf_t *blf_data, blf_log_container_t *container) {
+    g_queue_unlink(&blf_data->cached_containers, container->cache_link);
+    g_queue_push_head_link(&blf_data->cached_containers, container->cache_link);
+}
+
+/* Drop the least recently used containers until length more bytes fit. */
+static void
+blf_cache_make_room(blf_t *blf_data, guint64 length) {
+    while (blf_data->cached_bytes + length > BLF_CONTAINER_CACHE_MAX_BYTES &&
+           !g_queue_is_empty(&blf_data->cached_containers)) {
+        guint index = GPOINTER_TO_UINT(g_queue_pop_tail(&blf_data->cached_containers));
+        blf_log_container_t *container = &g_array_index(blf_data->log_containers, blf_log_container_t, index);
+
+        g_free(container->real_data);
+        container->real_data = NULL;
+        container->cache_link = NULL;
+        blf_data->cached_bytes -= container->real_length;
+    }
+}
+
+/* Called after blf_cache_make_room() for the container's length. */
+static void
+blf_cache_add(blf_t *blf_data, guint index, unsigned char *real_data) {
+    blf_log_container_t *container = &g_array_index(blf_data->log_containers, blf_log_container_t, index);
+
+    container->real_data = real_data;
+    g_queue_push_head(&blf_data->cached_containers, GUINT_TO_POINTER(index));
+    container->cache_link = blf_data->cached_containers.head;
+    blf_data->cached_bytes += container->real_length;
+}
+
 static gboolean
 blf_pull_logcontainer_into_memory(blf_params_t *params, guint index_log_container) {
     blf_t *blf_data = params->blf_data;
-    blf_log_container_t tmp;
+    blf_log_container_t *tmp;
 
     if (index_log_container >= blf_data->log_containers->len) {
         ws_debug("cannot pull an unknown log container into memory");
         return FALSE;
     }
 
-    tmp = g_array_index(blf_data->log_containers, blf_log_container_t, index_log_container);
+    tmp = &g_array_index(blf_data->log_containers, blf_log_container_t, index_log_container);
 
-    if (tmp.real_data != NULL) {
+    if (tmp->real_data != NULL) {
+        blf_cache_touch(blf_data, tmp);
         return TRUE;
     }
 
-    if (tmp.compression_method == BLF_COMPRESSION_ZLIB) {
+    if (tmp->compression_method == BLF_COMPRESSION_ZLIB) {
 #ifdef HAVE_ZLIB
         int err = 0;
         gchar *err_info;
 
-        file_seek(params->fh, tmp.infile_data_start, SEEK_SET, &err);
+        file_seek(params->fh, tmp->infile_data_start, SEEK_SET, &err);
         if (err < 0) {
             ws_debug("cannot seek to start of log_container");
             return FALSE;
         }
 
         /* pull compressed data into buffer */
-        unsigned char *compressed_data = g_try_malloc0((gsize)tmp.infile_length);
-        guint64 data_length = (unsigned int)tmp.infile_length - (tmp.infile_data_start - tmp.infile_start_pos);
+        guint64 data_length = (unsigned int)tmp->infile_length - (tmp->infile_data_start - tmp->infile_start_pos);
+        unsigned char *compressed_data = g_try_malloc0((gsize)data_length);
+        if (compressed_data == NULL) {
+            ws_debug("cannot allocate memory for compressed data");
+            return FALSE;
+        }
         if (!wtap_read_bytes_or_eof(params->fh, compressed_data, (unsigned int)data_length, &err, &err_info)) {
             ws_debug("cannot read compressed data");
+            g_free(compressed_data);
             return FALSE;
         }
 
-        unsigned char *buf = g_try_malloc0((gsize)tmp.real_length);
+        blf_cache_make_room(blf_data, tmp->real_length);
+        unsigned char *buf = g_try_malloc0((gsize)tmp->real_length);
+        if (buf == NULL) {
+            ws_debug("cannot allocate memory for LogContainer %d", index_log_container);
+            g_free(compressed_data);
+            return FALSE;
+        }
         z_stream infstream = {0};
 
         infstream.avail_in  = (unsigned int)data_length;
         infstream.next_in   = compressed_data;
-        infstream.avail_out = (unsigned int)tmp.real_length;
+        infstream.avail_out = (unsigned int)tmp->real_length;
         infstream.next_out  = buf;
 
         /* the actual DE-compression work. */
@@ -493,6 +564,8 @@ blf_pull_logcontainer_into_memory(blf_params_t *params, guint index_log_containe
             if (infstream.msg != NULL) {
                 ws_debug("inflateInit returned: \"%s\"", infstream.msg);
             }
+            g_free(compressed_data);
+            g_free(buf);
             return FALSE;
         }
 
@@ -503,19 +576,24 @@ blf_pull_logcontainer_into_memory(blf_params_t *params, guint index_log_containe
             if (infstream.msg != NULL) {
                 ws_debug("inflate returned: \"%s\"", infstream.msg);
             }
+            inflateEnd(&infstream);
+            g_free(compressed_data);
+            g_free(buf);
             return FALSE;
         }
 
+        g_free(compressed_data);
+
         if (Z_OK != inflateEnd(&infstream)) {
             ws_debug("inflateEnd failed for LogContainer %d", index_log_container);
             if (infstream.msg != NULL) {
                 ws_debug("inflateEnd returned: \"%s\"", infstream.msg);
             }
+            g_free(buf);
             return FALSE;
         }
 
-        tmp.real_data = buf;
-        g_array_index(blf_data->log_containers, blf_log_container_t, index_log_container) = tmp;
+        blf_cache_add(blf_data, index_log_container, buf);
         return TRUE;
 #else
         return FALSE;
@@ -1873,6 +1951,11 @@ static void blf_close(wtap *wth) {
         blf->log_containers = NULL;
     }
 
+    if (blf != NULL) {
+        g_queue_clear(&blf->cached_containers);
+        blf->cached_bytes = 0;
+    }
+
     if (blf != NULL && blf->channel_to_iface_ht != NULL) {
         g_hash_table_destroy(blf->channel_to_iface_ht);
         blf->channel_to_iface_ht = NULL;
@@ -1933,6 +2016,8 @@ blf_open(wtap *wth, int *err, gchar **err_info) {
     blf->log_containers = NULL;
     blf->current_log_container = 0;
     blf->current_real_seek_pos = 0;
+    g_queue_init(&blf->cached_containers);
+    blf->cached_bytes = 0;
     blf->start_offset_ns = 1000 * 1000 * 1000 * (guint64)mktime(&timestamp);
     blf->start_offset_ns += 1000 * 1000 * header.start_date.ms;
 
@@ -6,6 +6,7 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 
+#define _GNU_SOURCE /* for copy_file_range */
 #include "config.h"
 #define WS_LOG_DOMAIN LOG_DOMAIN_WIRETAP
 
@@ -14,6 +15,10 @@
 
 #include <errno.h>
 
+#ifdef HAVE_COPY_FILE_RANGE
+#include <unistd.h>
+#endif
+
 #include <wsutil/file_util.h>
 #include <wsutil/tempfile.h>
 #ifdef HAVE_PLUGINS
@@ -905,6 +910,7 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 	wth->subtype_close = NULL;
 	wth->file_tsprec = WTAP_TSPREC_USEC;
 	wth->pathname = g_strdup(filename);
+	wth->raw_copy_fd = -1;
 	wth->priv = NULL;
 	wth->wslua_data = NULL;
 	wth->shb_hdrs = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
@@ -1178,6 +1184,51 @@ success:
 	return wth;
 }
 
+gboolean
+wtap_get_section_offsets(wtap *wth, GArray **offsets, int *err, gchar **err_info)
+{
+	gint64 offset = 0;
+
+	*offsets = g_array_new(FALSE, FALSE, sizeof(gint64));
+	if (wth->file_type_subtype != wtap_pcapng_file_type_subtype()) {
+		g_array_append_val(*offsets, offset);
+		return TRUE;
+	}
+	if (!pcapng_get_section_offsets(wth, *offsets, err, err_info)) {
+		g_array_free(*offsets, TRUE);
+		*offsets = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+wtap *
+wtap_open_offline_section(const char *filename, gint64 section_offset,
+			  int *err, char **err_info, gboolean do_random)
+{
+	wtap	*wth;
+
+	wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, err, err_info,
+	    do_random);
+	if (wth == NULL)
+		return NULL;
+
+	if (wth->file_type_subtype != wtap_pcapng_file_type_subtype()) {
+		if (section_offset != 0) {
+			wtap_close(wth);
+			*err = WTAP_ERR_UNSUPPORTED;
+			*err_info = g_strdup("only pcapng files can have more than one section");
+			return NULL;
+		}
+		return wth;
+	}
+	if (!pcapng_open_section(wth, section_offset, err, err_info)) {
+		wtap_close(wth);
+		return NULL;
+	}
+	return wth;
+}
+
 /*
  * Given the pathname of the file we just closed with wtap_fdclose(), attempt
  * to reopen that file and assign the new file descriptor(s) to the sequential
@@ -2352,6 +2403,7 @@ wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_t
 	/* Set Decryption Secrets Blocks */
 	wdh->dsbs_initial = params->dsbs_initial;
 	wdh->dsbs_growing = params->dsbs_growing;
+	wdh->write_index = params->write_index;
 	return wdh;
 }
 
@@ -2597,6 +2649,7 @@ wtap_dump(wtap_dumper *wdh, const wtap_rec *rec,
 {
 	*err = 0;
 	*err_info = NULL;
+	wdh->last_rec_offset = -1;
 	return (wdh->subtype_write)(wdh, rec, pd, err, err_info);
 }
 
@@ -2620,6 +2673,109 @@ wtap_dump_flush(wtap_dumper *wdh, int *err)
 	return TRUE;
 }
 
+gboolean
+wtap_dump_can_copy_raw(wtap_dumper *wdh, wtap *wth)
+{
+	return wth->subtype_can_copy_raw != NULL &&
+	    wdh->file_type_subtype == wth->file_type_subtype &&
+	    wdh->compression_type == WTAP_UNCOMPRESSED &&
+	    !wdh->write_index &&
+	    !wth->ispipe && strcmp(wth->pathname, "-") != 0;
+}
+
+/* Most bytes to copy at a time when we can't have the kernel do it */
+#define RAW_COPY_CHUNK_SIZE	(1024*1024)
+
+gboolean
+wtap_dump_copy_raw(wtap_dumper *wdh, wtap *wth, gint64 offset, gint64 len,
+		   int *err, gchar **err_info _U_)
+{
+	gint64	remaining = len;
+	guint8	*buf;
+	size_t	chunk;
+	gssize	nread;
+
+	*err = 0;
+	if (wth->raw_copy_fd == -1) {
+		/*
+		 * Use a descriptor of our own, so that we don't disturb
+		 * the position of the sequential or random stream.
+		 */
+		wth->raw_copy_fd = ws_open(wth->pathname, O_RDONLY|O_BINARY, 0000);
+		if (wth->raw_copy_fd == -1) {
+			*err = errno;
+			return FALSE;
+		}
+	}
+
+	/* Anything the dumper has buffered comes first */
+	if (!wtap_dump_flush(wdh, err))
+		return FALSE;
+
+#ifdef HAVE_COPY_FILE_RANGE
+	{
+		loff_t	in_offset = offset;
+		ssize_t	ncopied;
+
+		/*
+		 * Have the kernel copy the bytes, which it might do
+		 * without copying them at all. This doesn't work between
+		 * all kinds of files, e.g. to a pipe, or on all kernels;
+		 * if it doesn't, copy what's left ourselves.
+		 */
+		while (remaining > 0) {
+			ncopied = copy_file_range(wth->raw_copy_fd, &in_offset,
+			    fileno((FILE *)wdh->fh), NULL,
+			    (size_t)MIN(remaining, G_MAXSSIZE), 0);
+			if (ncopied == -1) {
+				if (errno == EINTR)
+					continue;
+				if (remaining == len &&
+				    (errno == EXDEV || errno == EINVAL ||
+				     errno == ENOSYS || errno == EOPNOTSUPP ||
+				     errno == EBADF))
+					break;
+				*err = errno;
+				return FALSE;
+			}
+			if (ncopied == 0) {
+				/* The file got shorter under us */
+				*err = WTAP_ERR_SHORT_READ;
+				return FALSE;
+			}
+			remaining -= ncopied;
+		}
+		offset += len - remaining;
+	}
+#endif
+
+	if (remaining > 0) {
+		if (ws_lseek64(wth->raw_copy_fd, offset, SEEK_SET) == -1) {
+			*err = errno;
+			return FALSE;
+		}
+		buf = (guint8 *)g_malloc((size_t)MIN(remaining, RAW_COPY_CHUNK_SIZE));
+		while (remaining > 0) {
+			chunk = (size_t)MIN(remaining, RAW_COPY_CHUNK_SIZE);
+			nread = ws_read(wth->raw_copy_fd, buf, (unsigned int)chunk);
+			if (nread <= 0) {
+				*err = (nread == 0) ? WTAP_ERR_SHORT_READ : errno;
+				g_free(buf);
+				return FALSE;
+			}
+			if (!wtap_dump_file_write(wdh, buf, (size_t)nread, err)) {
+				g_free(buf);
+				return FALSE;
+			}
+			remaining -= nread;
+		}
+		g_free(buf);
+	}
+
+	wdh->bytes_dumped += len;
+	return TRUE;
+}
+
 gboolean
 wtap_dump_close(wtap_dumper *wdh, int *err, gchar **err_info)
 {
@@ -2713,6 +2869,12 @@ gboolean wtap_dump_get_needs_reload(wtap_dumper *wdh) {
         return wdh->needs_reload;
 }
 
+gint64
+wtap_dump_last_record_offset(wtap_dumper *wdh)
+{
+	return wdh->last_rec_offset;
+}
+
 /* internally open a file for writing (compressed or not) */
 #ifdef HAVE_ZLIB
 static WFILE_T
@@ -22,6 +22,10 @@
 #include <string.h>
 #include "wtap-int.h"
 
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#endif
+
 #include <wsutil/file_util.h>
 
 #ifdef HAVE_ZLIB
@@ -125,6 +129,12 @@ wtap_get_all_compression_type_extensions_list(void)
 /* #define GZBUFSIZE 8192 */
 #define GZBUFSIZE 4096
 
+/*
+ * Buffer size for writing compressed files; deflate()ing and write()ing
+ * larger blocks costs noticeably less per byte than doing it every 4K.
+ */
+#define GZWBUFSIZE 65536
+
 /* values for wtap_reader compression */
 typedef enum {
     UNKNOWN,       /* unknown - look for a compression header */
@@ -861,10 +871,32 @@ gz_head(FILE_T state)
     /* FD 37 7A 58 5A 00 */
 #endif
 
+    /*
+     * Make sure we have the 4 bytes of a zstd or lz4 magic number in
+     * the buffer, even if this frame starts right before the end of
+     * the data we've read so far.
+     */
+    if (state->in.avail < 4 && !state->eof) {
+        memmove(state->in.buf, state->in.next, state->in.avail);
+        state->in.next = state->in.buf;
+        if (fill_in_buffer(state) == -1)
+            return -1;
+    }
+
     if (state->in.avail >= 4
-        && state->in.buf[0] == 0x28 && state->in.buf[1] == 0xb5
-        && state->in.buf[2] == 0x2f && state->in.buf[3] == 0xfd) {
+        && state->in.next[0] == 0x28 && state->in.next[1] == 0xb5
+        && state->in.next[2] == 0x2f && state->in.next[3] == 0xfd) {
 #ifdef HAVE_ZSTD
+        /*
+         * zstd frames are independent, so the start of each one is a
+         * point from which we can resume decompression after a seek.
+         * Files written as a series of frames (e.g. with "zstd
+         * --block-size", pzstd, or the seekable format) thus get
+         * random access.
+         */
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, ZSTD);
+
         const size_t ret = ZSTD_initDStream(state->zstd_dctx);
         if (ZSTD_isError(ret)) {
             state->err = WTAP_ERR_DECOMPRESS;
@@ -883,9 +915,13 @@ gz_head(FILE_T state)
     }
 
     if (state->in.avail >= 4
-        && state->in.buf[0] == 0x04 && state->in.buf[1] == 0x22
-        && state->in.buf[2] == 0x4d && state->in.buf[3] == 0x18) {
+        && state->in.next[0] == 0x04 && state->in.next[1] == 0x22
+        && state->in.next[2] == 0x4d && state->in.next[3] == 0x18) {
 #ifdef USE_LZ4
+        /* As with zstd, each lz4 frame can be decompressed on its own. */
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, LZ4);
+
 #if LZ4_VERSION_NUMBER >= 10800
         LZ4F_resetDecompressionContext(state->lz4_dctx);
 #else
@@ -1116,6 +1152,15 @@ file_fdopen(int fd)
     if (state->start == -1) state->start = 0;
     state->raw_pos = state->start;
 
+#ifdef HAVE_POSIX_FADVISE
+    /*
+     * Most files are read from start to end, so ask the OS to read
+     * ahead aggressively, letting the I/O overlap with the dissection.
+     * This fails harmlessly on pipes.
+     */
+    (void)posix_fadvise(state->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
     /* initialize stream */
     gz_reset(state);
 
@@ -1292,6 +1337,11 @@ void
 file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+#ifdef HAVE_POSIX_FADVISE
+    /* Random reads shouldn't trigger the large sequential read-ahead. */
+    if (random_flag)
+        (void)posix_fadvise(stream->fd, 0, 0, POSIX_FADV_NORMAL);
+#endif
 }
 
 gint64
@@ -1429,6 +1479,11 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off2 = here->out;
         } else
 #endif
+        if (here->compression == ZSTD || here->compression == LZ4) {
+            /* Start of a frame; decompress again from there. */
+            off = here->in;
+            off2 = here->out;
+        } else
         {
             off2 = (file->pos + offset);
             off = here->in + (off2 - here->out);
@@ -1481,6 +1536,12 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             file->compression = ZLIB;
         } else
 #endif
+        if (here->compression == ZSTD || here->compression == LZ4) {
+            /* Let gz_head() parse the frame header and set up the
+               decompression context again. */
+            file->last_compression = here->compression;
+            file->compression = UNKNOWN;
+        } else
             file->compression = here->compression;
 
         offset = (file->pos + offset) - off2;
@@ -1689,6 +1750,34 @@ file_read(void *buf, unsigned int len, FILE_T file)
                we're at the end of the input; just return
                with what we've gotten so far. */
             break;
+        } else if (file->compression == UNCOMPRESSED && buf != NULL &&
+                   len >= file->size) {
+            /* We have nothing in the output buffer, and
+               the caller wants at least a buffer's worth of
+               uncompressed data; read it directly into the
+               caller's buffer rather than copying it through
+               the output buffer. */
+            ssize_t ret;
+
+            /* The output buffer no longer holds the data
+               before the current position. */
+            buf_reset(&file->out);
+
+            ret = ws_read(file->fd, buf, len);
+            if (ret < 0) {
+                file->err = errno;
+                file->err_info = NULL;
+                return -1;
+            }
+            if (ret == 0) {
+                file->eof = TRUE;
+                break;
+            }
+            file->raw_pos += ret;
+            buf = (char *)buf + ret;
+            len -= (guint)ret;
+            got += (guint)ret;
+            file->pos += ret;
         } else {
             /* We have nothing in the output buffer, and
                we can generate more data; get more output,
@@ -1938,7 +2027,7 @@ struct wtap_writer {
     int fd;                 /* file descriptor */
     gint64 pos;             /* current position in uncompressed data */
     guint size;             /* buffer size, zero if not allocated yet */
-    guint want;             /* requested buffer size, default is GZBUFSIZE */
+    guint want;             /* requested buffer size, default is GZWBUFSIZE */
     unsigned char *in;      /* input buffer */
     unsigned char *out;     /* output buffer (double-sized when reading) */
     unsigned char *next;    /* next output data to deliver or write */
@@ -1980,7 +2069,7 @@ gzwfile_fdopen(int fd)
         return NULL;
     state->fd = fd;
     state->size = 0;            /* no buffers allocated yet */
-    state->want = GZBUFSIZE;    /* requested buffer size */
+    state->want = GZWBUFSIZE;   /* requested buffer size */
 
     state->level = Z_DEFAULT_COMPRESSION;
     state->strategy = Z_DEFAULT_STRATEGY;
@@ -15,42 +15,187 @@
 #include "json.h"
 #include <wsutil/wsjson.h>
 
-/* Maximum size of json file. */
-#define MAX_FILE_SIZE  (50*1024*1024)
+/*
+ * How much of the file we look at to decide whether it's JSON. If the
+ * first value ends within it, it has to be valid JSON; if not, what we've
+ * seen of it must at least look like JSON.
+ */
+#define JSON_SNIFF_SIZE         (64*1024)
+
+/*
+ * Each top-level value in the file (one per line in a JSON Lines file) is
+ * a record. Values are read in chunks that start small, so that short
+ * lines don't cost a large read, and double up to a limit.
+ */
+#define JSON_MIN_CHUNK          1024
+#define JSON_MAX_CHUNK          (1024*1024)
+#define JSON_MAX_RECORD_SIZE    (256*1024*1024)
+
+#define JSON_IS_WS(c)   ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+/* Finds where a top-level value ends, a chunk at a time. */
+typedef struct {
+    guint    depth;         /* of open objects and arrays */
+    guint64  objects;       /* bit n set if level n is an object, for the first 64 */
+    gboolean in_string;
+    gboolean escaped;       /* the previous character in a string was a backslash */
+    gboolean in_scalar;     /* in a top-level number or literal */
+    gboolean bad;           /* we've seen something that can't be JSON */
+} json_scanner_t;
 
 static int json_file_type_subtype = -1;
 
 void register_json(void);
 
+static gboolean json_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
+                          gchar **err_info, gint64 *data_offset);
+static gboolean json_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
+                               Buffer *buf, int *err, gchar **err_info);
+
+static gboolean
+json_scalar_char(int c)
+{
+    return g_ascii_isdigit(c) || (c != '\0' && strchr("+-.eEaflnrstu", c) != NULL);
+}
+
+/*
+ * Scan the next len bytes of a value, the first of which (in the first
+ * call) is the value's first character. Returns how many of them are part
+ * of the value if it ends here, -1 if it doesn't. A top-level number or
+ * literal only ends at the character after it, or at the end of the file.
+ */
+static int
+json_scan(json_scanner_t *scan, const guint8 *p, int len)
+{
+    for (int i = 0; i < len; i++) {
+        int c = p[i];
+
+        if (scan->in_string) {
+            if (scan->escaped) {
+                scan->escaped = FALSE;
+            } else if (c == '\\') {
+                scan->escaped = TRUE;
+            } else if (c == '"') {
+                scan->in_string = FALSE;
+                if (scan->depth == 0)
+                    return i + 1;
+            } else if (c < 0x20) {
+                scan->bad = TRUE;
+            }
+            continue;
+        }
+
+        if (scan->in_scalar) {
+            if (JSON_IS_WS(c) || !json_scalar_char(c))
+                return i;
+            continue;
+        }
+
+        switch (c) {
+
+        case '"':
+            scan->in_string = TRUE;
+            break;
+
+        case '{':
+        case '[':
+            if (scan->depth < 64) {
+                if (c == '{')
+                    scan->objects |= G_GUINT64_CONSTANT(1) << scan->depth;
+                else
+                    scan->objects &= ~(G_GUINT64_CONSTANT(1) << scan->depth);
+            }
+            scan->depth++;
+            break;
+
+        case '}':
+        case ']':
+            if (scan->depth == 0) {
+                /* Stray; let it be a record of its own */
+                scan->bad = TRUE;
+                return i + 1;
+            }
+            scan->depth--;
+            if (scan->depth < 64 &&
+                ((scan->objects >> scan->depth) & 1) != (c == '}'))
+                scan->bad = TRUE;
+            if (scan->depth == 0)
+                return i + 1;
+            break;
+
+        case ',':
+        case ':':
+            if (scan->depth == 0) {
+                scan->bad = TRUE;
+                return i + 1;
+            }
+            break;
+
+        default:
+            if (JSON_IS_WS(c))
+                break;
+            if (!json_scalar_char(c))
+                scan->bad = TRUE;
+            if (scan->depth == 0)
+                scan->in_scalar = TRUE;
+            break;
+        }
+    }
+
+    return -1;
+}
+
 wtap_open_return_val json_open(wtap *wth, int *err, gchar **err_info)
 {
     guint8* filebuf;
     int bytes_read;
+    int start, end;
+    json_scanner_t scan;
 
-    /* XXX checking the full file contents might be a bit expensive, maybe
-     * resort to simpler heuristics like '{' or '[' (with some other chars)? */
-    filebuf = (guint8*)g_malloc0(MAX_FILE_SIZE);
-    if (!filebuf)
-        return WTAP_OPEN_ERROR;
+    filebuf = (guint8*)g_malloc(JSON_SNIFF_SIZE + 1);
 
-    bytes_read = file_read(filebuf, MAX_FILE_SIZE, wth->fh);
+    bytes_read = file_read(filebuf, JSON_SNIFF_SIZE, wth->fh);
     if (bytes_read < 0) {
         /* Read error. */
         *err = file_error(wth->fh, err_info);
         g_free(filebuf);
         return WTAP_OPEN_ERROR;
     }
-    if (bytes_read == 0) {
+
+    for (start = 0; start < bytes_read && JSON_IS_WS(filebuf[start]); start++)
+        ;
+    if (start == bytes_read) {
         /* empty file, not *anybody's* */
         g_free(filebuf);
         return WTAP_OPEN_NOT_MINE;
     }
 
-    if (json_validate(filebuf, bytes_read) == FALSE) {
+    if (filebuf[start] != '{' && filebuf[start] != '[') {
         g_free(filebuf);
         return WTAP_OPEN_NOT_MINE;
     }
 
+    memset(&scan, 0, sizeof scan);
+    end = json_scan(&scan, filebuf + start, bytes_read - start);
+    if (scan.bad) {
+        g_free(filebuf);
+        return WTAP_OPEN_NOT_MINE;
+    }
+    if (end < 0) {
+        /* It's all right for the first value not to end in the prefix, but not in the file */
+        if (bytes_read < JSON_SNIFF_SIZE) {
+            g_free(filebuf);
+            return WTAP_OPEN_NOT_MINE;
+        }
+    } else {
+        /* Counting the tokens validates the value without a limit on them */
+        filebuf[start + end] = '\0';
+        if (json_parse((const char *)filebuf + start, NULL, 0) < 0) {
+            g_free(filebuf);
+            return WTAP_OPEN_NOT_MINE;
+        }
+    }
+
     if (file_seek(wth->fh, 0, SEEK_SET, err) == -1) {
         g_free(filebuf);
         return WTAP_OPEN_ERROR;
@@ -59,21 +204,118 @@ wtap_open_return_val json_open(wtap *wth, int *err, gchar **err_info)
     wth->file_type_subtype = json_file_type_subtype;
     wth->file_encap = WTAP_ENCAP_JSON;
     wth->file_tsprec = WTAP_TSPREC_SEC;
-    wth->subtype_read = wtap_full_file_read;
-    wth->subtype_seek_read = wtap_full_file_seek_read;
+    wth->subtype_read = json_read;
+    wth->subtype_seek_read = json_seek_read;
     wth->snapshot_length = 0;
 
     g_free(filebuf);
     return WTAP_OPEN_MINE;
 }
 
+/*
+ * Read the value that starts at or after the current position, leaving
+ * the file just after it.
+ */
+static gboolean
+json_read_value(FILE_T fh, wtap_rec *rec, Buffer *buf, int *err,
+                gchar **err_info, gint64 *value_offset)
+{
+    json_scanner_t scan;
+    guint8 *data;
+    int c;
+    int len, chunk, nread, end;
+
+    /* Skip the white space between values; at the end of the file, we're done */
+    do {
+        c = file_getc(fh);
+    } while (c != EOF && JSON_IS_WS(c));
+    if (c == EOF) {
+        *err = file_error(fh, err_info);
+        return FALSE;
+    }
+    *value_offset = file_tell(fh) - 1;
+
+    memset(&scan, 0, sizeof scan);
+    ws_buffer_assure_space(buf, JSON_MIN_CHUNK);
+    data = ws_buffer_start_ptr(buf);
+    data[0] = (guint8)c;
+    len = 1;
+    end = json_scan(&scan, data, len);
+    chunk = JSON_MIN_CHUNK;
+    while (end < 0) {
+        if (len > JSON_MAX_RECORD_SIZE - chunk) {
+            *err = WTAP_ERR_BAD_FILE;
+            *err_info = ws_strdup_printf("json: Value at offset %" PRId64 " is bigger than maximum of %u bytes",
+                                         *value_offset, JSON_MAX_RECORD_SIZE);
+            return FALSE;
+        }
+        ws_buffer_assure_space(buf, len + chunk);
+        data = ws_buffer_start_ptr(buf);
+        nread = file_read(data + len, chunk, fh);
+        if (nread < 0) {
+            *err = file_error(fh, err_info);
+            if (*err == 0)
+                *err = WTAP_ERR_BAD_FILE;
+            return FALSE;
+        }
+        if (nread == 0) {
+            /* The value runs to the end of the file */
+            end = len;
+            break;
+        }
+        end = json_scan(&scan, data + len, nread);
+        if (end >= 0) {
+            end += len;
+            /* We read past it; go back to just after it */
+            if (end != len + nread &&
+                file_seek(fh, *value_offset + end, SEEK_SET, err) == -1)
+                return FALSE;
+        }
+        len += nread;
+        if (chunk < JSON_MAX_CHUNK)
+            chunk *= 2;
+    }
+
+    rec->rec_type = REC_TYPE_PACKET;
+    rec->block = wtap_block_create(WTAP_BLOCK_PACKET);
+    rec->presence_flags = 0; /* no time stamps in plain JSON */
+    rec->ts.secs = 0;
+    rec->ts.nsecs = 0;
+    rec->rec_header.packet_header.caplen = end;
+    rec->rec_header.packet_header.len = end;
+
+    return TRUE;
+}
+
+static gboolean json_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
+                          gchar **err_info, gint64 *data_offset)
+{
+    return json_read_value(wth->fh, rec, buf, err, err_info, data_offset);
+}
+
+static gboolean json_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
+                               Buffer *buf, int *err, gchar **err_info)
+{
+    gint64 value_offset;
+
+    if (file_seek(wth->random_fh, seek_off, SEEK_SET, err) == -1)
+        return FALSE;
+
+    if (!json_read_value(wth->random_fh, rec, buf, err, err_info, &value_offset)) {
+        if (*err == 0)
+            *err = WTAP_ERR_SHORT_READ;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 static const struct supported_block_type json_blocks_supported[] = {
     /*
-     * This is a file format that we dissect, so we provide only one
-     * "packet" with the file's contents, and don't support any
-     * options.
+     * This is a file format that we dissect, so we provide one "packet"
+     * per top-level value, and don't support any options.
      */
-    { WTAP_BLOCK_PACKET, ONE_BLOCK_SUPPORTED, NO_OPTIONS_SUPPORTED }
+    { WTAP_BLOCK_PACKET, MULTIPLE_BLOCKS_SUPPORTED, NO_OPTIONS_SUPPORTED }
 };
 
 static const struct file_type_subtype_info json_info = {
@@ -68,6 +68,9 @@ static gboolean libpcap_read(wtap *wth, wtap_rec *rec, Buffer *buf,
     int *err, gchar **err_info, gint64 *data_offset);
 static gboolean libpcap_seek_read(wtap *wth, gint64 seek_off,
     wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
+static gboolean libpcap_can_copy_raw(wtap *wth);
+static gboolean libpcap_read_batch(wtap *wth, wtap_batch *batch, int *err,
+    gchar **err_info);
 static gboolean libpcap_read_packet(wtap *wth, FILE_T fh,
     wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
 static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
@@ -238,6 +241,8 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, gchar **err_info)
 	/* This is a libpcap file */
 	wth->subtype_read = libpcap_read;
 	wth->subtype_seek_read = libpcap_seek_read;
+	wth->subtype_can_copy_raw = libpcap_can_copy_raw;
+	wth->subtype_read_batch = libpcap_read_batch;
 	wth->subtype_close = libpcap_close;
 	wth->snapshot_length = hdr.snaplen;
 	libpcap = g_new0(libpcap_t, 1);
@@ -871,6 +876,47 @@ libpcap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
 	return TRUE;
 }
 
+/*
+ * Read packets straight into the batch's buffer; a packet can't be bigger
+ * than the maximum for the file's encapsulation, so leave room for that
+ * much. For the few encapsulations where that's huge, read packets into
+ * the overflow buffer instead.
+ */
+static gboolean libpcap_read_batch(wtap *wth, wtap_batch *batch, int *err,
+    gchar **err_info)
+{
+	guint max_len = wtap_max_snaplen_for_encap(wth->file_encap);
+	gboolean in_place = max_len <= WTAP_MAX_PACKET_SIZE_STANDARD;
+	wtap_batch_rec *brec;
+	Buffer window;
+	Buffer *data_buf;
+
+	while ((brec = wtap_batch_next_rec(wth, batch, &window,
+	    in_place ? max_len : 0)) != NULL) {
+		data_buf = in_place ? &window : &batch->overflow;
+		brec->data_offset = file_tell(wth->fh);
+		if (!libpcap_read_packet(wth, wth->fh, &brec->rec, data_buf,
+		    err, err_info))
+			return FALSE;
+		wtap_batch_add_rec(wth, batch, &window, data_buf);
+	}
+	return TRUE;
+}
+
+/*
+ * We write record headers in our byte order, with the lengths in the
+ * order of version 2.4, so records can only be copied unchanged if
+ * that's how they were written.
+ */
+static gboolean
+libpcap_can_copy_raw(wtap *wth)
+{
+	libpcap_t *libpcap = (libpcap_t *)wth->priv;
+
+	return !libpcap->byte_swapped &&
+	    libpcap->lengths_swapped == NOT_SWAPPED;
+}
+
 static gboolean
 libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
     Buffer *buf, int *err, gchar **err_info)
@@ -960,6 +1006,37 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	rec->rec_header.packet_header.caplen = packet_size;
 	rec->rec_header.packet_header.len = orig_size;
 
+	/*
+	 * If this is a sequential read by a caller that doesn't want the
+	 * packet data, and we don't need it either, skip over it.
+	 */
+	if (fh == wth->fh && wth->skip_packet_data &&
+	    !pcap_read_post_process_needs_data(is_nokia, wth->file_encap,
+	    libpcap->byte_swapped)) {
+		if (!wtap_read_bytes(fh, NULL, packet_size, err, err_info))
+			return FALSE;	/* failed */
+		pcap_read_post_process(is_nokia, wth->file_encap, rec,
+		    NULL, libpcap->byte_swapped, -1);
+		return TRUE;
+	}
+
+	/*
+	 * If the caller wants only the start of each packet, and we don't
+	 * need the rest either, read that much and skip over the rest.
+	 */
+	if (wth->read_snaplen != 0 && packet_size > wth->read_snaplen &&
+	    !pcap_read_post_process_needs_data(is_nokia, wth->file_encap,
+	    libpcap->byte_swapped)) {
+		if (!wtap_read_packet_bytes(fh, buf, wth->read_snaplen, err, err_info))
+			return FALSE;	/* failed */
+		if (!wtap_read_bytes(fh, NULL, packet_size - wth->read_snaplen, err, err_info))
+			return FALSE;	/* failed */
+		rec->rec_header.packet_header.caplen = wth->read_snaplen;
+		pcap_read_post_process(is_nokia, wth->file_encap, rec,
+		    ws_buffer_start_ptr(buf), libpcap->byte_swapped, -1);
+		return TRUE;
+	}
+
 	/*
 	 * Read the packet data.
 	 */
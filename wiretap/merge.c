@@ -204,21 +204,99 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * Min-heap of the input files that have a record available, ordered by
+ * the time stamp of that record, used to pick the next record to write
+ * without looking at every input file.
+ */
+typedef struct {
+    merge_in_file_t **files;    /* heap of files in state RECORD_PRESENT */
+    guint             count;    /* number of files in the heap */
+    gboolean          primed;   /* TRUE once the first record of each file was read */
+} merge_heap_t;
+
+/*
+ * returns TRUE if the record of the first file must be written before
+ * the record of the second one.
+ *
+ * Records without time stamp are treated as earlier than all the other
+ * records, in file order.  Records with the same time stamp are taken
+ * from the file that comes last, as the previous linear search did.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_heap_before(const merge_in_file_t *l, const merge_in_file_t *r)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return FALSE;
-    } else if (l->secs < r->secs) { /* left is earlier */
-        return TRUE;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
-        return FALSE;
+    gboolean l_has_ts = (l->rec.presence_flags & WTAP_HAS_TS) != 0;
+    gboolean r_has_ts = (r->rec.presence_flags & WTAP_HAS_TS) != 0;
+    int cmp;
+
+    if (!l_has_ts || !r_has_ts) {
+        if (l_has_ts != r_has_ts)
+            return !l_has_ts;
+        return l < r;
     }
-    /* either one < two or one == two
-     * either way, return one
-     */
+    cmp = nstime_cmp(&l->rec.ts, &r->rec.ts);
+    if (cmp != 0)
+        return cmp < 0;
+    return l > r;
+}
+
+static void
+merge_heap_sift_down(merge_heap_t *heap, guint i)
+{
+    merge_in_file_t *tmp;
+    guint child;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= heap->count)
+            break;
+        if (child + 1 < heap->count &&
+            merge_heap_before(heap->files[child + 1], heap->files[child]))
+            child++;
+        if (!merge_heap_before(heap->files[child], heap->files[i]))
+            break;
+        tmp = heap->files[i];
+        heap->files[i] = heap->files[child];
+        heap->files[child] = tmp;
+        i = child;
+    }
+}
+
+static void
+merge_heap_sift_up(merge_heap_t *heap, guint i)
+{
+    merge_in_file_t *tmp;
+    guint parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!merge_heap_before(heap->files[i], heap->files[parent]))
+            break;
+        tmp = heap->files[i];
+        heap->files[i] = heap->files[parent];
+        heap->files[parent] = tmp;
+        i = parent;
+    }
+}
+
+/*
+ * Read the next record from a file that has none available.  Returns
+ * FALSE on a read error.
+ */
+static gboolean
+merge_fill_in_file(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+    gint64 data_offset;
+
+    if (!wtap_read(in_file->wth, &in_file->rec, &in_file->frame_buffer,
+                   err, err_info, &data_offset)) {
+        if (*err != 0) {
+            in_file->state = GOT_ERROR;
+            return FALSE;
+        }
+        in_file->state = AT_EOF;
+    } else
+        in_file->state = RECORD_PRESENT;
     return TRUE;
 }
 
@@ -236,6 +314,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param heap heap of the files with a record available
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -244,79 +323,61 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  */
 static merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, gchar **err_info)
+                  merge_heap_t *heap, int *err, gchar **err_info)
 {
     int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
-
-    /*
-     * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
-     */
-    for (i = 0; i < in_file_count; i++) {
-        gint64 data_offset;
+    merge_in_file_t *in_file;
 
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec,
-                           &in_files[i].frame_buffer, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
-        }
-
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
+    if (!heap->primed) {
+        /*
+         * Read the first record from each file and build the heap.
+         */
+        for (i = 0; i < in_file_count; i++) {
+            if (in_files[i].state == RECORD_NOT_PRESENT &&
+                !merge_fill_in_file(&in_files[i], err, err_info))
+                return &in_files[i];
+            if (in_files[i].state == RECORD_PRESENT) {
+                heap->files[heap->count] = &in_files[i];
+                merge_heap_sift_up(heap, heap->count);
+                heap->count++;
             }
         }
+        heap->primed = TRUE;
+    } else if (heap->count > 0 && heap->files[0]->state == RECORD_NOT_PRESENT) {
+        /*
+         * The record at the top of the heap was handed out by the
+         * previous call; replace it with the next record of that file.
+         */
+        in_file = heap->files[0];
+        if (!merge_fill_in_file(in_file, err, err_info))
+            return in_file;
+        if (in_file->state == AT_EOF) {
+            heap->count--;
+            heap->files[0] = heap->files[heap->count];
+        }
+        merge_heap_sift_down(heap, 0);
     }
 
-    if (ei == -1) {
+    if (heap->count == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
+    in_file = heap->files[0];
+
     /* We'll need to read another packet from this file. */
-    in_files[ei].state = RECORD_NOT_PRESENT;
+    in_file->state = RECORD_NOT_PRESENT;
 
     /* Count this packet. */
-    in_files[ei].packet_num++;
+    in_file->packet_num++;
 
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
      */
     *err = 0;
-    return &in_files[ei];
+    return in_file;
 }
 
 /** Read the next packet, in file sequence order, from the set of files
@@ -354,8 +415,10 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
             continue; /* This file is already at EOF */
         if (wtap_read(in_files[i].wth, &in_files[i].rec,
                       &in_files[i].frame_buffer, err, err_info,
-                      &data_offset))
+                      &data_offset)) {
+            in_files[i].data_offset = data_offset;
             break; /* We have a packet */
+        }
         if (*err != 0) {
             /* Read error - quit immediately. */
             in_files[i].state = GOT_ERROR;
@@ -834,6 +897,24 @@ map_rec_interface_id(wtap_rec *rec, const merge_in_file_t *in_file)
     return TRUE;
 }
 
+/*
+ * Copy the run of consecutive records from one input file that we've
+ * been saving up to copy unchanged, if there is one.
+ */
+static gboolean
+merge_flush_raw_run(wtap_dumper *pdh, merge_in_file_t *run_file,
+                    gint64 run_offset, gint64 *run_len,
+                    int *err, gchar **err_info)
+{
+    if (*run_len == 0)
+        return TRUE;
+    if (!wtap_dump_copy_raw(pdh, run_file->wth, run_offset, *run_len,
+                            err, err_info))
+        return FALSE;
+    *run_len = 0;
+    return TRUE;
+}
+
 static merge_result
 merge_process_packets(wtap_dumper *pdh, const int file_type,
                       merge_in_file_t *in_files, const guint in_file_count,
@@ -848,6 +929,16 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     gboolean            stop_flag = FALSE;
     wtap_rec *rec,      snap_rec;
+    merge_heap_t        heap;
+    guint               in_interface_id;
+    guint32             raw_len;
+    merge_in_file_t    *raw_run_file = NULL;
+    gint64              raw_run_offset = 0;
+    gint64              raw_run_len = 0;
+
+    heap.files = g_new(merge_in_file_t *, in_file_count);
+    heap.count = 0;
+    heap.primed = FALSE;
 
     for (;;) {
         *err = 0;
@@ -857,7 +948,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
+            in_file = merge_read_packet(in_file_count, in_files, &heap, err,
                                         err_info);
         }
 
@@ -883,6 +974,14 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         }
 
         rec = &in_file->rec;
+        in_interface_id = (rec->presence_flags & WTAP_HAS_INTERFACE_ID) ?
+            rec->rec_header.packet_header.interface_id : 0;
+
+        if (cb && cb->record_filter && rec->rec_type == REC_TYPE_PACKET &&
+            !cb->record_filter(rec, ws_buffer_start_ptr(&in_file->frame_buffer), cb->data)) {
+            wtap_rec_reset(rec);
+            continue;
+        }
 
         switch (rec->rec_type) {
 
@@ -940,14 +1039,55 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
             }
         }
 
-        if (!wtap_dump(pdh, rec, ws_buffer_start_ptr(&in_file->frame_buffer),
-                       err, err_info)) {
-            status = MERGE_ERR_CANT_WRITE_OUTFILE;
-            break;
+        /*
+         * When appending, a record that we haven't changed, including
+         * its interface ID, can be copied as it is, along with the
+         * records next to it in the same file, if the output file is of
+         * the same type as the input file. (When merging, records are
+         * read ahead, so we can't tell where in the file they were.)
+         */
+        raw_len = 0;
+        if (do_append && rec == &in_file->rec &&
+            (rec->rec_type != REC_TYPE_PACKET ||
+             rec->rec_header.packet_header.interface_id == in_interface_id) &&
+            wtap_dump_can_copy_raw(pdh, in_file->wth))
+            raw_len = wtap_raw_record_length(in_file->wth, in_file->data_offset);
+
+        if (raw_len != 0) {
+            if (raw_run_len != 0 &&
+                (raw_run_file != in_file ||
+                 raw_run_offset + raw_run_len != in_file->data_offset)) {
+                if (!merge_flush_raw_run(pdh, raw_run_file, raw_run_offset,
+                                         &raw_run_len, err, err_info)) {
+                    status = MERGE_ERR_CANT_WRITE_OUTFILE;
+                    break;
+                }
+            }
+            if (raw_run_len == 0) {
+                raw_run_file = in_file;
+                raw_run_offset = in_file->data_offset;
+            }
+            raw_run_len += raw_len;
+        } else {
+            if (!merge_flush_raw_run(pdh, raw_run_file, raw_run_offset,
+                                     &raw_run_len, err, err_info) ||
+                !wtap_dump(pdh, rec, ws_buffer_start_ptr(&in_file->frame_buffer),
+                           err, err_info)) {
+                status = MERGE_ERR_CANT_WRITE_OUTFILE;
+                break;
+            }
         }
         wtap_rec_reset(rec);
     }
 
+    if (status == MERGE_OK || status == MERGE_USER_ABORTED) {
+        if (!merge_flush_raw_run(pdh, raw_run_file, raw_run_offset,
+                                 &raw_run_len, err, err_info))
+            status = MERGE_ERR_CANT_WRITE_OUTFILE;
+    }
+
+    g_free(heap.files);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
@@ -37,6 +37,7 @@ typedef struct merge_in_file_s {
     gint64          size;           /* file size */
     GArray         *idb_index_map;  /* used for mapping the old phdr interface_id values to new during merge */
     guint           dsbs_seen;      /* number of elements processed so far from wth->dsbs */
+    gint64          data_offset;    /* offset of the current record, when appending */
 } merge_in_file_t;
 
 /** Return values from merge_files(). */
@@ -104,12 +105,16 @@ merge_idb_merge_mode_to_string(const int mode);
  * of the created merge info, in_file_count is the size of the array, data is
  * whatever was passed in the data member of this struct. The callback_func
  * routine's return value should be TRUE if merging should be aborted.
+ * If record_filter isn't NULL, it's called with each packet record read,
+ * its data, and data; the record is left out of the merged file if it
+ * returns FALSE.
  */
 typedef struct {
     gboolean (*callback_func)(merge_event event, int num,
                               const merge_in_file_t in_files[], const guint in_file_count,
                               void *data);
     void *data; /**< private data to use for passing through to the callback function */
+    gboolean (*record_filter)(const wtap_rec *rec, const guint8 *pd, void *data);
 } merge_progress_callback_t;
 
 
@@ -20,6 +20,7 @@
 
 #include "wtap-int.h"
 #include <wsutil/buffer.h>
+#include <wsutil/strtoi.h>
 #include "file_wrappers.h"
 #include <errno.h>
 #include <stdlib.h>
@@ -38,32 +39,85 @@
    is actually an mpeg2 ts */
 #define SYNC_STEPS   10
 
+#define MP2T_PID_COUNT      8192
+
+/* most packets we put into one record */
+#define MP2T_MAX_PACKETS_PER_RECORD  (WTAP_MAX_PACKET_SIZE_STANDARD / MP2T_SIZE)
+
 
 typedef struct {
     guint32 start_offset;
     guint64 bitrate;
     /* length of trailing data (e.g. FEC) that's appended after each packet */
     guint8  trailer_len;
+    /* number of TS packets put into each record */
+    guint   packets_per_record;
+    /* if set, only packets whose PID is set in pid_filter are read */
+    gboolean filter_pids;
+    guint8  pid_filter[MP2T_PID_COUNT / 8];
 } mp2t_filetype_t;
 
 static int mp2t_file_type_subtype = -1;
 
 void register_mp2t(void);
 
+static gboolean
+mp2t_pid_wanted(mp2t_filetype_t *mp2t, const guint8 *packet)
+{
+    guint16 pid;
+
+    if (!mp2t->filter_pids)
+        return TRUE;
+    pid = 0x1fff & pntoh16(&packet[1]);
+    return (mp2t->pid_filter[pid / 8] & (1 << (pid % 8))) != 0;
+}
+
+/*
+ * Reads the record starting at offset: packets_per_record packets on the
+ * PIDs we want, or fewer at the end of the file. Packets on other PIDs are
+ * skipped. *first_offset is set to the offset of the record's first packet.
+ */
 static gboolean
 mp2t_read_packet(mp2t_filetype_t *mp2t, FILE_T fh, gint64 offset,
-                 wtap_rec *rec, Buffer *buf, int *err,
+                 wtap_rec *rec, Buffer *buf, gint64 *first_offset, int *err,
                  gchar **err_info)
 {
     guint64 tmp;
+    guint8 *packet;
+    guint n_packets = 0;
 
     /*
-     * MP2T_SIZE will always be less than WTAP_MAX_PACKET_SIZE_STANDARD, so
-     * we don't have to worry about the packet being too big.
+     * MP2T_SIZE * packets_per_record will always be at most
+     * WTAP_MAX_PACKET_SIZE_STANDARD, so we don't have to worry about the
+     * packet being too big.
      */
-    ws_buffer_assure_space(buf, MP2T_SIZE);
-    if (!wtap_read_bytes_or_eof(fh, ws_buffer_start_ptr(buf), MP2T_SIZE, err, err_info))
-        return FALSE;
+    ws_buffer_assure_space(buf, MP2T_SIZE * mp2t->packets_per_record);
+    while (n_packets < mp2t->packets_per_record) {
+        packet = ws_buffer_start_ptr(buf) + n_packets * MP2T_SIZE;
+        if (!wtap_read_bytes_or_eof(fh, packet, MP2T_SIZE, err, err_info)) {
+            /* A partial record at the end of the file is fine. */
+            if (*err == 0 && n_packets > 0)
+                break;
+            return FALSE;
+        }
+        if (mp2t_pid_wanted(mp2t, packet)) {
+            if (n_packets == 0)
+                *first_offset = offset;
+            n_packets++;
+        }
+        offset += MP2T_SIZE;
+
+        /* if there's a trailer, skip it and go to the start of the next packet */
+        if (mp2t->trailer_len!=0) {
+            if (!wtap_read_bytes_or_eof(fh, NULL, mp2t->trailer_len, err, err_info)) {
+                /* The last trailer in the file may be cut short. */
+                if ((*err == 0 || *err == WTAP_ERR_SHORT_READ) && n_packets > 0)
+                    break;
+                return FALSE;
+            }
+            offset += mp2t->trailer_len;
+        }
+    }
 
     rec->rec_type = REC_TYPE_PACKET;
     rec->block = wtap_block_create(WTAP_BLOCK_PACKET);
@@ -85,12 +139,12 @@ mp2t_read_packet(mp2t_filetype_t *mp2t, FILE_T fh, gint64 offset,
      * case our attempt to guess it from the PCRs of one of the programs
      * doesn't get the right answer.
      */
-    tmp = ((guint64)(offset - mp2t->start_offset) * 8); /* offset, in bits */
+    tmp = ((guint64)(*first_offset - mp2t->start_offset) * 8); /* offset, in bits */
     rec->ts.secs = (time_t)(tmp / mp2t->bitrate);
     rec->ts.nsecs = (int)((tmp % mp2t->bitrate) * 1000000000 / mp2t->bitrate);
 
-    rec->rec_header.packet_header.caplen = MP2T_SIZE;
-    rec->rec_header.packet_header.len = MP2T_SIZE;
+    rec->rec_header.packet_header.caplen = MP2T_SIZE * n_packets;
+    rec->rec_header.packet_header.len = MP2T_SIZE * n_packets;
 
     return TRUE;
 }
@@ -103,21 +157,8 @@ mp2t_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 
     mp2t = (mp2t_filetype_t*) wth->priv;
 
-    *data_offset = file_tell(wth->fh);
-
-    if (!mp2t_read_packet(mp2t, wth->fh, *data_offset, rec, buf, err,
-                          err_info)) {
-        return FALSE;
-    }
-
-    /* if there's a trailer, skip it and go to the start of the next packet */
-    if (mp2t->trailer_len!=0) {
-        if (!wtap_read_bytes(wth->fh, NULL, mp2t->trailer_len, err, err_info)) {
-            return FALSE;
-        }
-    }
-
-    return TRUE;
+    return mp2t_read_packet(mp2t, wth->fh, file_tell(wth->fh), rec, buf,
+                            data_offset, err, err_info);
 }
 
 static gboolean
@@ -125,6 +166,7 @@ mp2t_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
         Buffer *buf, int *err, gchar **err_info)
 {
     mp2t_filetype_t *mp2t;
+    gint64 first_offset;
 
     if (-1 == file_seek(wth->random_fh, seek_off, SEEK_SET, err)) {
         return FALSE;
@@ -133,7 +175,7 @@ mp2t_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
     mp2t = (mp2t_filetype_t*) wth->priv;
 
     if (!mp2t_read_packet(mp2t, wth->random_fh, seek_off, rec, buf,
-                          err, err_info)) {
+                          &first_offset, err, err_info)) {
         if (*err == 0)
             *err = WTAP_ERR_SHORT_READ;
         return FALSE;
@@ -141,6 +183,51 @@ mp2t_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
     return TRUE;
 }
 
+/*
+ * Reads the reading options from the environment:
+ *
+ * MP2T_PACKETS_PER_RECORD - number of TS packets in each record (default 1);
+ * the MP2T dissector handles any number of packets in a frame, and putting
+ * several in each frame cuts the per-frame cost of long captures.
+ *
+ * MP2T_PIDS - comma-separated list of the PIDs to read; packets on other
+ * PIDs are skipped here and never reach the dissectors.
+ */
+static void
+mp2t_read_options(mp2t_filetype_t *mp2t)
+{
+    const char *s;
+    gchar **pids;
+    guint32 n;
+    guint16 pid;
+    int i;
+
+    mp2t->packets_per_record = 1;
+    if ((s = getenv("MP2T_PACKETS_PER_RECORD")) != NULL) {
+        if (ws_strtou32(s, NULL, &n) && n >= 1 && n <= MP2T_MAX_PACKETS_PER_RECORD) {
+            mp2t->packets_per_record = n;
+        }
+    }
+
+    mp2t->filter_pids = FALSE;
+    memset(mp2t->pid_filter, 0, sizeof mp2t->pid_filter);
+    if ((s = getenv("MP2T_PIDS")) != NULL) {
+        pids = g_strsplit_set(s, ", ", -1);
+        for (i = 0; pids[i] != NULL; i++) {
+            if (pids[i][0] == '\0')
+                continue;
+            if ((g_ascii_strncasecmp(pids[i], "0x", 2) == 0 ?
+                    ws_hexstrtou16(pids[i] + 2, NULL, &pid) :
+                    ws_strtou16(pids[i], NULL, &pid)) &&
+                    pid < MP2T_PID_COUNT) {
+                mp2t->pid_filter[pid / 8] |= 1 << (pid % 8);
+                mp2t->filter_pids = TRUE;
+            }
+        }
+        g_strfreev(pids);
+    }
+}
+
 static guint64
 mp2t_read_pcr(guint8 *buffer)
 {
@@ -392,6 +479,7 @@ found:
     mp2t->start_offset = first;
     mp2t->trailer_len = trailer_len;
     mp2t->bitrate = bitrate;
+    mp2t_read_options(mp2t);
 
     return WTAP_OPEN_MINE;
 }
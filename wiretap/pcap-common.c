@@ -2417,6 +2417,33 @@ pcap_read_post_process(gboolean is_nokia, int wtap_encap,
 	}
 }
 
+/*
+ * Returns TRUE if pcap_read_post_process() looks at the packet data for
+ * this encapsulation, so that a reader can't skip over the data when
+ * asked for metadata only; if it returns FALSE, pcap_read_post_process()
+ * may be called with a null pd.
+ */
+gboolean
+pcap_read_post_process_needs_data(gboolean is_nokia _U_, int wtap_encap,
+    gboolean bytes_swapped)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_ATM_PDUS:
+		return TRUE;
+
+	case WTAP_ENCAP_SLL:
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+	case WTAP_ENCAP_NFLOG:
+	case WTAP_ENCAP_PFLOG:
+		return bytes_swapped;
+
+	default:
+		return FALSE;
+	}
+}
+
 gboolean
 wtap_encap_requires_phdr(int wtap_encap)
 {
@@ -27,6 +27,9 @@ extern int pcap_process_pseudo_header(FILE_T fh, gboolean is_nokia,
 extern void pcap_read_post_process(gboolean is_nokia, int wtap_encap,
     wtap_rec *rec, guint8 *pd, gboolean bytes_swapped, int fcs_len);
 
+extern gboolean pcap_read_post_process_needs_data(gboolean is_nokia,
+    int wtap_encap, gboolean bytes_swapped);
+
 extern int pcap_get_phdr_size(int encap,
     const union wtap_pseudo_header *pseudo_header);
 
@@ -46,6 +46,14 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 static gboolean
 pcapng_seek_read(wtap *wth, gint64 seek_off,
                  wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
+static gboolean
+pcapng_index_lookup(wtap *wth, guint64 frame_num, const nstime_t *ts,
+                    guint64 *found_frame, gint64 *found_offset,
+                    int *err, gchar **err_info);
+static gboolean
+pcapng_can_copy_raw(wtap *wth);
+static gboolean
+pcapng_read_batch(wtap *wth, wtap_batch *batch, int *err, gchar **err_info);
 static void
 pcapng_close(wtap *wth);
 
@@ -139,6 +147,55 @@ typedef struct pcapng_custom_block_s {
  */
 #define MIN_ISB_SIZE    ((guint32)(MIN_BLOCK_SIZE + sizeof(pcapng_interface_statistics_block_t)))
 
+/*
+ * pcapng: record index block file encoding.
+ *
+ * This is our own block, written as the last block of a file with a
+ * single section when asked for. It gives the offset of every
+ * index_step'th record, starting with the first, and that record's
+ * time stamp, so that a reader can get to a record, or to a time,
+ * without reading the records before it. Readers that don't know it
+ * skip it, as they do with any block type they don't know.
+ *
+ * As the block type is in the local use range, the block starts with a
+ * magic number, and it has its own offset, so that an index left at the
+ * end of a file that was appended to another one isn't used.
+ */
+typedef struct pcapng_record_index_block_s {
+    guint32 magic;              /* PCAPNG_RECORD_INDEX_MAGIC */
+    guint16 version;            /* PCAPNG_RECORD_INDEX_VERSION */
+    guint16 flags;              /* PCAPNG_RECORD_INDEX_TS_IN_ORDER */
+    guint32 index_step;         /* records per entry */
+    guint32 num_entries;
+    guint64 num_records;        /* records in the file */
+    guint64 block_offset;       /* offset of this block in the file */
+    /* ... Entries ... */
+} pcapng_record_index_block_t;
+
+typedef struct pcapng_record_index_entry_s {
+    guint64 offset;             /* offset of the record's block */
+    guint64 secs;               /* its time stamp, as a gint64 */
+    guint32 nsecs;
+    guint32 reserved;
+} pcapng_record_index_entry_t;
+
+#define PCAPNG_RECORD_INDEX_MAGIC       0x58444957  /* "WIDX" in little-endian order */
+#define PCAPNG_RECORD_INDEX_VERSION     1
+#define PCAPNG_RECORD_INDEX_TS_IN_ORDER 0x0001      /* no record's time stamp is earlier than the one before */
+
+/*
+ * Minimum record index block size = minimum block size + size of fixed
+ * length portion of the block.
+ */
+#define MIN_RECORD_INDEX_SIZE   ((guint32)(MIN_BLOCK_SIZE + sizeof(pcapng_record_index_block_t)))
+
+/*
+ * Most entries in a record index; when a file has more records than this,
+ * every other entry is dropped and the step between entries doubled. This
+ * keeps the block under 12 MiB, well below MAX_BLOCK_SIZE.
+ */
+#define PCAPNG_RECORD_INDEX_MAX_ENTRIES (512*1024)
+
 /*
  * Minimum Sysdig size = minimum block size + packed size of sysdig_event_phdr.
  * Minimum Sysdig event v2 header size = minimum block size + packed size of sysdig_event_v2_phdr (which, in addition
@@ -239,13 +296,35 @@ typedef struct interface_info_s {
     int fcslen;
 } interface_info_t;
 
+/* An entry of a record index, in memory */
+typedef struct {
+    gint64 offset;
+    nstime_t ts;
+} record_index_entry_t;
+
 typedef struct {
     guint current_section_number; /**< Section number of the current section being read sequentially */
     GArray *sections;             /**< Sections found in the capture file. */
     wtap_new_ipv4_callback_t add_new_ipv4;
     wtap_new_ipv6_callback_t add_new_ipv6;
+    gboolean index_looked_for;    /**< TRUE if we've looked for a record index */
+    GArray *index;                /**< record_index_entry_t's of the record index, or NULL if there's none */
+    guint32 index_step;           /**< Records per entry of the record index */
+    guint64 index_num_records;    /**< Records in the file, according to the record index */
+    gboolean index_ts_in_order;   /**< TRUE if the time stamps in the file are in order */
+    gboolean single_section;      /**< TRUE if sequential reads stop at the next SHB */
+    guint32 last_block_type;      /**< Type of the block pcapng_read() last returned */
 } pcapng_t;
 
+/* State for writing a record index */
+typedef struct {
+    GArray *index;                /**< record_index_entry_t's, or NULL if we aren't writing an index */
+    guint32 index_step;
+    guint64 num_records;
+    nstime_t last_ts;
+    gboolean ts_in_order;
+} pcapng_dump_t;
+
 /*
  * Table for plugins to handle particular block types.
  *
@@ -287,6 +366,7 @@ register_pcapng_block_type_handler(guint block_type, block_reader reader,
     case BLOCK_TYPE_DSB:
     case BLOCK_TYPE_CB_COPY:
     case BLOCK_TYPE_CB_NO_COPY:
+    case BLOCK_TYPE_RECORD_INDEX:
     case BLOCK_TYPE_SYSDIG_EVENT:
     case BLOCK_TYPE_SYSDIG_EVENT_V2:
     case BLOCK_TYPE_SYSDIG_EVENT_V2_LARGE:
@@ -893,7 +973,14 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
                        pcapng_opt_byte_order_e byte_order,
                        int *err, gchar **err_info)
 {
-    guint8 *option_content; /* Allocate as large as the options block */
+    /*
+     * Most blocks that have options at all have only a few small ones,
+     * such as an EPB's flags; read those into a buffer on the stack
+     * rather than allocating one per block.
+     */
+    guint32 option_stack[64];
+    guint8 *option_heap = NULL;
+    guint8 *option_content; /* As large as the options block */
     guint opt_bytes_remaining;
     const guint8 *option_ptr;
     const pcapng_option_header_t *oh;
@@ -906,24 +993,29 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
         return TRUE;
     }
 
-    /* Allocate enough memory to hold all options */
-    option_content = (guint8 *)g_try_malloc(opt_cont_buf_len);
-    if (option_content == NULL) {
-        *err = ENOMEM;  /* we assume we're out of memory */
-        return FALSE;
+    if (opt_cont_buf_len <= sizeof option_stack) {
+        option_content = (guint8 *)option_stack;
+    } else {
+        /* Allocate enough memory to hold all options */
+        option_heap = (guint8 *)g_try_malloc(opt_cont_buf_len);
+        if (option_heap == NULL) {
+            *err = ENOMEM;  /* we assume we're out of memory */
+            return FALSE;
+        }
+        option_content = option_heap;
     }
 
     /* Read all the options into the buffer */
     if (!wtap_read_bytes(fh, option_content, opt_cont_buf_len, err, err_info)) {
         ws_debug("failed to read options");
-        g_free(option_content);
+        g_free(option_heap);
         return FALSE;
     }
 
     /*
      * Now process them.
      * option_ptr starts out aligned on at least a 4-byte boundary, as
-     * that's what g_try_malloc() gives us, and each option is padded
+     * that's what g_try_malloc() and the guint32 array give us, and each option is padded
      * to a length that's a multiple of 4 bytes, so it remains aligned.
      */
     option_ptr = &option_content[0];
@@ -935,7 +1027,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
         if (sizeof (*oh) > opt_bytes_remaining) {
             *err = WTAP_ERR_BAD_FILE;
             *err_info = ws_strdup_printf("pcapng: Not enough data for option header");
-            g_free(option_content);
+            g_free(option_heap);
             return FALSE;
         }
         option_code = oh->option_code;
@@ -964,6 +1056,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
             *err = WTAP_ERR_INTERNAL;
             *err_info = ws_strdup_printf("pcapng: invalid byte order %d passed to pcapng_process_options()",
                                         byte_order);
+            g_free(option_heap);
             return FALSE;
         }
         option_ptr += sizeof (*oh); /* 4 bytes, so it remains aligned */
@@ -977,7 +1070,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
             *err = WTAP_ERR_BAD_FILE;
             *err_info = ws_strdup_printf("pcapng: Not enough data to handle option of length %u",
                                         option_length);
-            g_free(option_content);
+            g_free(option_heap);
             return FALSE;
         }
 
@@ -1002,7 +1095,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
                                                   option_ptr,
                                                   byte_order,
                                                   err, err_info)) {
-                    g_free(option_content);
+                    g_free(option_heap);
                     return FALSE;
                 }
                 break;
@@ -1012,14 +1105,14 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
                     !(*process_option)(wblock, (const section_info_t *)section_info, option_code,
                                        option_length, option_ptr,
                                        err, err_info)) {
-                    g_free(option_content);
+                    g_free(option_heap);
                     return FALSE;
                 }
         }
         option_ptr += rounded_option_length; /* multiple of 4 bytes, so it remains aligned */
         opt_bytes_remaining -= rounded_option_length;
     }
-    g_free(option_content);
+    g_free(option_heap);
     return TRUE;
 }
 
@@ -1795,6 +1888,26 @@ pcapng_process_packet_block_option(wtapng_block_t *wblock,
     return TRUE;
 }
 
+/*
+ * Convert a timestamp in the interface's time units to an nstime_t.
+ * Nearly all files use microseconds or nanoseconds; spelling those out
+ * lets the compiler replace the 64-bit divisions by constant ones.
+ */
+static inline void
+pcapng_ts_to_nstime(nstime_t *nst, guint64 ts, guint64 time_units_per_second)
+{
+    if (time_units_per_second == 1000000) {
+        nst->secs = (time_t)(ts / 1000000);
+        nst->nsecs = (int)((ts % 1000000) * 1000);
+    } else if (time_units_per_second == 1000000000) {
+        nst->secs = (time_t)(ts / 1000000000);
+        nst->nsecs = (int)(ts % 1000000000);
+    } else {
+        nst->secs = (time_t)(ts / time_units_per_second);
+        nst->nsecs = (int)(((ts % time_units_per_second) * 1000000000) / time_units_per_second);
+    }
+}
+
 static gboolean
 pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
                          section_info_t *section_info,
@@ -1813,6 +1926,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     guint64 ts;
     int pseudo_header_len;
     int fcslen;
+    gboolean skip_data;
 
     wblock->block = wtap_block_create(WTAP_BLOCK_PACKET);
 
@@ -1977,13 +2091,37 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
 
     /* Combine the two 32-bit pieces of the timestamp into one 64-bit value */
     ts = (((guint64)packet.ts_high) << 32) | ((guint64)packet.ts_low);
-    wblock->rec->ts.secs = (time_t)(ts / iface_info.time_units_per_second);
-    wblock->rec->ts.nsecs = (int)(((ts % iface_info.time_units_per_second) * 1000000000) / iface_info.time_units_per_second);
+    pcapng_ts_to_nstime(&wblock->rec->ts, ts, iface_info.time_units_per_second);
 
-    /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                packet.cap_len - pseudo_header_len, err, err_info))
-        return FALSE;
+    /*
+     * "(Enhanced) Packet Block" read capture data, unless the caller
+     * only wants the metadata and we don't need the data either.
+     */
+    skip_data = wblock->skip_data &&
+        !pcap_read_post_process_needs_data(FALSE, iface_info.wtap_encap,
+                                           section_info->byte_swapped);
+    if (skip_data) {
+        if (!wtap_read_bytes(fh, NULL, packet.cap_len - pseudo_header_len,
+                             err, err_info))
+            return FALSE;
+    } else if (wblock->read_snaplen != 0 &&
+               packet.cap_len - pseudo_header_len > wblock->read_snaplen &&
+               !pcap_read_post_process_needs_data(FALSE, iface_info.wtap_encap,
+                                                  section_info->byte_swapped)) {
+        /* Read only the start of the packet, as the caller asked. */
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    wblock->read_snaplen, err, err_info))
+            return FALSE;
+        if (!wtap_read_bytes(fh, NULL,
+                             packet.cap_len - pseudo_header_len - wblock->read_snaplen,
+                             err, err_info))
+            return FALSE;
+        wblock->rec->rec_header.packet_header.caplen = wblock->read_snaplen;
+    } else {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    packet.cap_len - pseudo_header_len, err, err_info))
+            return FALSE;
+    }
     block_read += packet.cap_len - pseudo_header_len;
 
     /* jump over potential padding bytes at end of the packet data */
@@ -2023,7 +2161,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     }
 
     pcap_read_post_process(FALSE, iface_info.wtap_encap,
-                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->rec, skip_data ? NULL : ws_buffer_start_ptr(wblock->frame_buffer),
                            section_info->byte_swapped, fcslen);
 
     /*
@@ -3221,6 +3359,15 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
             return FALSE;
         }
 
+        /*
+         * No block puts more into the frame buffer than the block's
+         * length, so, if we're reading into a buffer that can't grow
+         * and this block might not fit, switch to the one that can.
+         */
+        if (wblock->overflow_buffer != NULL &&
+            bh.block_total_length > wblock->frame_buffer->allocated - wblock->frame_buffer->first_free)
+            wblock->frame_buffer = wblock->overflow_buffer;
+
         /*
          * ***DO NOT*** add any items to this table that are not
          * standardized block types in the current pcapng spec at
@@ -3339,6 +3486,84 @@ pcapng_process_dsb(wtap *wth, wtapng_block_t *wblock)
     g_array_append_val(wth->dsbs, wblock->block);
 }
 
+/*
+ * Read the IDBs at the beginning of the current section, stopping at
+ * the first block that isn't an IDB.
+ */
+static gboolean
+pcapng_read_leading_idbs(wtap *wth, pcapng_t *pcapng, int *err,
+                         gchar **err_info)
+{
+    wtapng_block_t wblock;
+    pcapng_block_header_t bh;
+    gint64 saved_offset;
+    section_info_t new_section, *current_section;
+
+    wblock.type = BLOCK_TYPE_IDB;
+    wblock.block = NULL;
+    /* we don't expect any packet blocks */
+    wblock.frame_buffer = NULL;
+    wblock.rec = NULL;
+    wblock.skip_data = FALSE;
+    wblock.read_snaplen = 0;
+    wblock.overflow_buffer = NULL;
+
+    /* Loop over all IDBs that appear before any packets */
+    while (1) {
+        /* peek at next block */
+        /* Try to read the (next) block header */
+        saved_offset = file_tell(wth->fh);
+        if (!wtap_read_bytes_or_eof(wth->fh, &bh, sizeof bh, err, err_info)) {
+            if (*err == 0) {
+                /* EOF */
+                ws_debug("No more IDBs available...");
+                break;
+            }
+            ws_debug("Check for more IDBs, wtap_read_bytes_or_eof() failed, err = %d.",
+                     *err);
+            return FALSE;
+        }
+
+        /* go back to where we were */
+        file_seek(wth->fh, saved_offset, SEEK_SET, err);
+
+        /*
+         * Get a pointer to the current section's section_info_t.
+         */
+        current_section = &g_array_index(pcapng->sections, section_info_t,
+                                         pcapng->current_section_number);
+
+        if (current_section->byte_swapped) {
+            bh.block_type         = GUINT32_SWAP_LE_BE(bh.block_type);
+        }
+
+        ws_debug("Check for more IDBs, block_type 0x%08x",
+                 bh.block_type);
+
+        /* XXX - This code expects that the PCAPNG Sections start with IDBs but the PCAPNG RFC does not say that!? */
+        if (bh.block_type != BLOCK_TYPE_IDB) {
+            break;  /* No more IDBs */
+        }
+
+        if (!pcapng_read_block(wth, wth->fh, pcapng, current_section,
+                              &new_section, &wblock, err, err_info)) {
+            wtap_block_unref(wblock.block);
+            if (*err == 0) {
+                ws_debug("No more IDBs available...");
+                break;
+            } else {
+                ws_debug("couldn't read IDB");
+                return FALSE;
+            }
+        }
+        pcapng_process_idb(wth, current_section, &wblock);
+        wtap_block_unref(wblock.block);
+        ws_debug("Read IDB number_of_interfaces %u, wtap_encap %i",
+                 wth->interface_data->len, wth->file_encap);
+    }
+    return TRUE;
+}
+
 /* classic wtap: open capture file */
 wtap_open_return_val
 pcapng_open(wtap *wth, int *err, gchar **err_info)
@@ -3346,8 +3571,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     wtapng_block_t wblock;
     pcapng_t *pcapng;
     pcapng_block_header_t bh;
-    gint64 saved_offset;
-    section_info_t first_section, new_section, *current_section;
+    section_info_t first_section;
 
     ws_debug("opening file");
     /*
@@ -3399,6 +3623,9 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     /* we don't expect any packet blocks yet */
     wblock.frame_buffer = NULL;
     wblock.rec = NULL;
+    wblock.skip_data = FALSE;
+    wblock.read_snaplen = 0;
+    wblock.overflow_buffer = NULL;
 
     switch (pcapng_read_section_header_block(wth->fh, &bh, &first_section,
                                              &wblock, err, err_info)) {
@@ -3489,8 +3716,26 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     pcapng->add_new_ipv4 = NULL;
     pcapng->add_new_ipv6 = NULL;
 
+    /*
+     * We look for a record index only if we're asked to use it.
+     */
+    pcapng->index_looked_for = FALSE;
+    pcapng->index = NULL;
+    pcapng->index_step = 0;
+    pcapng->index_num_records = 0;
+    pcapng->index_ts_in_order = FALSE;
+
+    /*
+     * Read all the sections, unless pcapng_open_section() says otherwise.
+     */
+    pcapng->single_section = FALSE;
+    pcapng->last_block_type = 0;
+
     wth->subtype_read = pcapng_read;
     wth->subtype_seek_read = pcapng_seek_read;
+    wth->subtype_index_lookup = pcapng_index_lookup;
+    wth->subtype_can_copy_raw = pcapng_can_copy_raw;
+    wth->subtype_read_batch = pcapng_read_batch;
     wth->subtype_close = pcapng_close;
     wth->file_type_subtype = pcapng_file_type_subtype;
 
@@ -3498,66 +3743,20 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
      * wtap_dumper can refer to it right after opening the capture file. */
     wth->dsbs = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
 
-    /* Loop over all IDBs that appear before any packets */
-    while (1) {
-        /* peek at next block */
-        /* Try to read the (next) block header */
-        saved_offset = file_tell(wth->fh);
-        if (!wtap_read_bytes_or_eof(wth->fh, &bh, sizeof bh, err, err_info)) {
-            if (*err == 0) {
-                /* EOF */
-                ws_debug("No more IDBs available...");
-                break;
-            }
-            ws_debug("Check for more IDBs, wtap_read_bytes_or_eof() failed, err = %d.",
-                     *err);
-            return WTAP_OPEN_ERROR;
-        }
-
-        /* go back to where we were */
-        file_seek(wth->fh, saved_offset, SEEK_SET, err);
-
-        /*
-         * Get a pointer to the current section's section_info_t.
-         */
-        current_section = &g_array_index(pcapng->sections, section_info_t,
-                                         pcapng->current_section_number);
-
-        if (current_section->byte_swapped) {
-            bh.block_type         = GUINT32_SWAP_LE_BE(bh.block_type);
-        }
-
-        ws_debug("Check for more IDBs, block_type 0x%08x",
-                 bh.block_type);
-
-        /* XXX - This code expects that the PCAPNG Sections start with IDBs but the PCAPNG RFC does not say that!? */
-        if (bh.block_type != BLOCK_TYPE_IDB) {
-            break;  /* No more IDBs */
-        }
-
-        if (!pcapng_read_block(wth, wth->fh, pcapng, current_section,
-                              &new_section, &wblock, err, err_info)) {
-            wtap_block_unref(wblock.block);
-            if (*err == 0) {
-                ws_debug("No more IDBs available...");
-                break;
-            } else {
-                ws_debug("couldn't read IDB");
-                return WTAP_OPEN_ERROR;
-            }
-        }
-        pcapng_process_idb(wth, current_section, &wblock);
-        wtap_block_unref(wblock.block);
-        ws_debug("Read IDB number_of_interfaces %u, wtap_encap %i",
-                 wth->interface_data->len, wth->file_encap);
-    }
+    if (!pcapng_read_leading_idbs(wth, pcapng, err, err_info))
+        return WTAP_OPEN_ERROR;
     return WTAP_OPEN_MINE;
 }
 
-/* classic wtap: read packet */
+/*
+ * Read the next record; if overflow_buf isn't NULL, buf can't grow, and
+ * records that might not fit in it are read into overflow_buf. *data_buf
+ * is set to the buffer the record's data was read into.
+ */
 static gboolean
-pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
-            gchar **err_info, gint64 *data_offset)
+pcapng_read_rec(wtap *wth, wtap_rec *rec, Buffer *buf, Buffer *overflow_buf,
+                Buffer **data_buf, int *err, gchar **err_info,
+                gint64 *data_offset)
 {
     pcapng_t *pcapng = (pcapng_t *)wth->priv;
     section_info_t *current_section, new_section;
@@ -3569,6 +3768,9 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 
     wblock.frame_buffer  = buf;
     wblock.rec = rec;
+    wblock.skip_data = wth->skip_packet_data;
+    wblock.read_snaplen = wth->read_snaplen;
+    wblock.overflow_buffer = overflow_buf;
 
     pcapng->add_new_ipv4 = wth->add_new_ipv4;
     pcapng->add_new_ipv6 = wth->add_new_ipv6;
@@ -3600,6 +3802,7 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
              * This is a block type we return to the caller to process.
              */
             ws_debug("rec_type %u", wblock.rec->rec_type);
+            pcapng->last_block_type = wblock.type;
             break;
         }
 
@@ -3612,6 +3815,16 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
             case(BLOCK_TYPE_SHB):
                 ws_debug("another section header block");
 
+                if (pcapng->single_section) {
+                    /*
+                     * We were opened to read only one section, and
+                     * this is the end of it.
+                     */
+                    wtap_block_unref(wblock.block);
+                    *err = 0;
+                    return FALSE;
+                }
+
                 /*
                  * Add this SHB to the table of SHBs.
                  */
@@ -3710,6 +3923,40 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
     /*ws_debug("Read length: %u Packet length: %u", bytes_read, rec->rec_header.packet_header.caplen);*/
     ws_debug("data_offset is finally %" PRId64, *data_offset);
 
+    *data_buf = wblock.frame_buffer;
+    return TRUE;
+}
+
+/* classic wtap: read packet */
+static gboolean
+pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
+            gchar **err_info, gint64 *data_offset)
+{
+    Buffer *data_buf;
+
+    return pcapng_read_rec(wth, rec, buf, NULL, &data_buf, err, err_info,
+                           data_offset);
+}
+
+/*
+ * Read records straight into the batch's buffer, leaving room for a
+ * maximum-sized packet; records in blocks that might not fit in what's
+ * left of it are read into the overflow buffer.
+ */
+static gboolean
+pcapng_read_batch(wtap *wth, wtap_batch *batch, int *err, gchar **err_info)
+{
+    wtap_batch_rec *brec;
+    Buffer window;
+    Buffer *data_buf;
+
+    while ((brec = wtap_batch_next_rec(wth, batch, &window,
+                                       WTAP_MAX_PACKET_SIZE_STANDARD)) != NULL) {
+        if (!pcapng_read_rec(wth, &brec->rec, &window, &batch->overflow,
+                             &data_buf, err, err_info, &brec->data_offset))
+            return FALSE;
+        wtap_batch_add_rec(wth, batch, &window, data_buf);
+    }
     return TRUE;
 }
 
@@ -3763,6 +4010,9 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
 
     wblock.frame_buffer = buf;
     wblock.rec = rec;
+    wblock.skip_data = FALSE;
+    wblock.read_snaplen = wth->read_snaplen;
+    wblock.overflow_buffer = NULL;
 
     /* read the block */
     if (!pcapng_read_block(wth, wth->random_fh, pcapng, section_info,
@@ -3784,6 +4034,192 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
     return TRUE;
 }
 
+/*
+ * Read the record index at the end of the file, if there is one and it
+ * can be used. Anything wrong with it just means we don't use it.
+ */
+static void
+pcapng_read_record_index(wtap *wth, pcapng_t *pcapng)
+{
+    section_info_t *section_info;
+    gint64 saved_offset, file_size, block_offset;
+    pcapng_block_header_t bh;
+    pcapng_record_index_block_t rib;
+    pcapng_record_index_entry_t entry;
+    record_index_entry_t index_entry;
+    guint32 block_total_length;
+    GArray *index;
+    int err;
+    gchar *err_info = NULL;
+
+    /*
+     * The offsets in the index are only of use if we can seek to them
+     * cheaply, and the index only describes files with one section,
+     * which, if this file has only one, is the one we've read.
+     */
+    if (wth->ispipe || file_iscompressed(wth->fh))
+        return;
+    section_info = &g_array_index(pcapng->sections, section_info_t, 0);
+
+    saved_offset = file_tell(wth->fh);
+    file_size = wtap_file_size(wth, &err);
+    if (saved_offset == -1 || file_size < MIN_SHB_SIZE + MIN_RECORD_INDEX_SIZE)
+        return;
+
+    /*
+     * The index is the last block, so the last 4 bytes of the file are
+     * its total length.
+     */
+    if (file_seek(wth->fh, file_size - 4, SEEK_SET, &err) == -1)
+        return;
+    if (!wtap_read_bytes(wth->fh, &block_total_length, sizeof block_total_length,
+                         &err, &err_info))
+        goto done;
+    if (section_info->byte_swapped)
+        block_total_length = GUINT32_SWAP_LE_BE(block_total_length);
+    if (block_total_length < MIN_RECORD_INDEX_SIZE ||
+        block_total_length > MAX_BLOCK_SIZE ||
+        (gint64)block_total_length > file_size - MIN_SHB_SIZE ||
+        (block_total_length - MIN_RECORD_INDEX_SIZE) % sizeof entry != 0)
+        goto done;
+
+    block_offset = file_size - block_total_length;
+    if (file_seek(wth->fh, block_offset, SEEK_SET, &err) == -1)
+        goto done;
+    if (!wtap_read_bytes(wth->fh, &bh, sizeof bh, &err, &err_info) ||
+        !wtap_read_bytes(wth->fh, &rib, sizeof rib, &err, &err_info))
+        goto done;
+    if (section_info->byte_swapped) {
+        bh.block_type         = GUINT32_SWAP_LE_BE(bh.block_type);
+        bh.block_total_length = GUINT32_SWAP_LE_BE(bh.block_total_length);
+        rib.magic             = GUINT32_SWAP_LE_BE(rib.magic);
+        rib.version           = GUINT16_SWAP_LE_BE(rib.version);
+        rib.flags             = GUINT16_SWAP_LE_BE(rib.flags);
+        rib.index_step        = GUINT32_SWAP_LE_BE(rib.index_step);
+        rib.num_entries       = GUINT32_SWAP_LE_BE(rib.num_entries);
+        rib.num_records       = GUINT64_SWAP_LE_BE(rib.num_records);
+        rib.block_offset      = GUINT64_SWAP_LE_BE(rib.block_offset);
+    }
+    if (bh.block_type != BLOCK_TYPE_RECORD_INDEX ||
+        bh.block_total_length != block_total_length ||
+        rib.magic != PCAPNG_RECORD_INDEX_MAGIC ||
+        rib.version != PCAPNG_RECORD_INDEX_VERSION ||
+        rib.block_offset != (guint64)block_offset ||
+        rib.index_step == 0 || rib.num_entries == 0 ||
+        rib.num_entries != (block_total_length - MIN_RECORD_INDEX_SIZE) / sizeof entry ||
+        rib.num_records <= (guint64)(rib.num_entries - 1) * rib.index_step ||
+        rib.num_records > (guint64)rib.num_entries * rib.index_step) {
+        ws_debug("not a usable record index");
+        goto done;
+    }
+
+    index = g_array_sized_new(FALSE, FALSE, sizeof(record_index_entry_t), rib.num_entries);
+    for (guint32 i = 0; i < rib.num_entries; i++) {
+        if (!wtap_read_bytes(wth->fh, &entry, sizeof entry, &err, &err_info)) {
+            g_array_free(index, TRUE);
+            goto done;
+        }
+        if (section_info->byte_swapped) {
+            entry.offset = GUINT64_SWAP_LE_BE(entry.offset);
+            entry.secs   = GUINT64_SWAP_LE_BE(entry.secs);
+            entry.nsecs  = GUINT32_SWAP_LE_BE(entry.nsecs);
+        }
+        /* The records are in the section, in order, before the index */
+        if (entry.offset < (guint64)MIN_SHB_SIZE || entry.offset >= (guint64)block_offset ||
+            (i > 0 && (gint64)entry.offset <= g_array_index(index, record_index_entry_t, i - 1).offset) ||
+            entry.nsecs >= 1000000000) {
+            ws_debug("record index entry %u is bad", i);
+            g_array_free(index, TRUE);
+            goto done;
+        }
+        index_entry.offset = (gint64)entry.offset;
+        index_entry.ts.secs = (time_t)(gint64)entry.secs;
+        index_entry.ts.nsecs = (int)entry.nsecs;
+        g_array_append_val(index, index_entry);
+    }
+
+    ws_debug("record index with %u entries for %" PRIu64 " records",
+             rib.num_entries, rib.num_records);
+    pcapng->index = index;
+    pcapng->index_step = rib.index_step;
+    pcapng->index_num_records = rib.num_records;
+    pcapng->index_ts_in_order = (rib.flags & PCAPNG_RECORD_INDEX_TS_IN_ORDER) != 0;
+
+done:
+    g_free(err_info);
+    file_seek(wth->fh, saved_offset, SEEK_SET, &err);
+}
+
+/*
+ * Find the record in the record index at or before the given record or,
+ * if ts isn't NULL, the last record in the index that's earlier than ts.
+ */
+static gboolean
+pcapng_index_lookup(wtap *wth, guint64 frame_num, const nstime_t *ts,
+                    guint64 *found_frame, gint64 *found_offset,
+                    int *err _U_, gchar **err_info _U_)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    record_index_entry_t *entry;
+    guint lo, hi, mid, i;
+
+    if (!pcapng->index_looked_for) {
+        pcapng_read_record_index(wth, pcapng);
+        pcapng->index_looked_for = TRUE;
+    }
+    if (pcapng->index == NULL)
+        return FALSE;
+
+    if (ts == NULL) {
+        if (frame_num == 0 || frame_num > pcapng->index_num_records)
+            return FALSE;
+        i = (guint)((frame_num - 1) / pcapng->index_step);
+    } else {
+        if (!pcapng->index_ts_in_order)
+            return FALSE;
+        /* Find the first entry at or after ts; we want the one before it */
+        lo = 0;
+        hi = pcapng->index->len;
+        while (lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            entry = &g_array_index(pcapng->index, record_index_entry_t, mid);
+            if (nstime_cmp(&entry->ts, ts) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        i = (lo > 0) ? lo - 1 : 0;
+    }
+
+    entry = &g_array_index(pcapng->index, record_index_entry_t, i);
+    *found_frame = (guint64)i * pcapng->index_step + 1;
+    *found_offset = entry->offset;
+    return TRUE;
+}
+
+/*
+ * A packet block can be copied unchanged into a file we write if it's
+ * in our byte order and its interface ID means the same there, which
+ * is the case in the first section, given that the file we write has
+ * the same IDBs. If there are DSBs, they have to be written before
+ * the packets that follow them, so those packets have to be written
+ * by pcapng_dump().
+ */
+static gboolean
+pcapng_can_copy_raw(wtap *wth)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    section_info_t *current_section;
+
+    if (pcapng->last_block_type != BLOCK_TYPE_EPB &&
+        pcapng->last_block_type != BLOCK_TYPE_SPB)
+        return FALSE;
+    if (pcapng->sections->len != 1 || wth->dsbs->len != 0)
+        return FALSE;
+    current_section = &g_array_index(pcapng->sections, section_info_t, 0);
+    return !current_section->byte_swapped;
+}
+
 /* classic wtap: close capture file */
 static void
 pcapng_close(wtap *wth)
@@ -3801,6 +4237,181 @@ pcapng_close(wtap *wth)
         g_array_free(section_info->interfaces, TRUE);
     }
     g_array_free(pcapng->sections, TRUE);
+    if (pcapng->index != NULL)
+        g_array_free(pcapng->index, TRUE);
+}
+
+/*
+ * Find the offsets of all the SHBs in the file, by walking the block
+ * headers without reading the blocks' contents.
+ */
+gboolean
+pcapng_get_section_offsets(wtap *wth, GArray *offsets, int *err,
+                           gchar **err_info)
+{
+    gint64 saved_offset, block_off;
+    pcapng_block_header_t bh;
+    guint32 magic, block_total_length;
+    gboolean byte_swapped = FALSE;
+    gboolean ret = TRUE;
+    int seek_err;
+
+    saved_offset = file_tell(wth->fh);
+    if (file_seek(wth->fh, 0, SEEK_SET, err) == -1)
+        return FALSE;
+
+    for (;;) {
+        block_off = file_tell(wth->fh);
+        if (!wtap_read_bytes_or_eof(wth->fh, &bh, sizeof bh, err, err_info)) {
+            if (*err == 0 || *err == WTAP_ERR_SHORT_READ) {
+                /*
+                 * EOF, or a partial block at the end of the file;
+                 * reading the file finds the latter, so we don't.
+                 */
+                *err = 0;
+                g_free(*err_info);
+                *err_info = NULL;
+                break;
+            }
+            ret = FALSE;
+            break;
+        }
+        if (bh.block_type == BLOCK_TYPE_SHB) {
+            /*
+             * The byte-order magic number tells us the byte order
+             * of this section, including this block's length.
+             */
+            if (!wtap_read_bytes_or_eof(wth->fh, &magic, sizeof magic, err, err_info)) {
+                if (*err == 0 || *err == WTAP_ERR_SHORT_READ) {
+                    *err = 0;
+                    g_free(*err_info);
+                    *err_info = NULL;
+                    break;
+                }
+                ret = FALSE;
+                break;
+            }
+            if (magic == PCAPNG_MAGIC) {
+                byte_swapped = FALSE;
+            } else if (magic == PCAPNG_SWAPPED_MAGIC) {
+                byte_swapped = TRUE;
+            } else {
+                *err = WTAP_ERR_BAD_FILE;
+                *err_info = ws_strdup_printf("pcapng: unknown byte-order magic number 0x%08x in the section header block at offset %" PRId64,
+                                             magic, block_off);
+                ret = FALSE;
+                break;
+            }
+            g_array_append_val(offsets, block_off);
+        }
+        block_total_length = byte_swapped ?
+            GUINT32_SWAP_LE_BE(bh.block_total_length) : bh.block_total_length;
+        /* As pcapng_read_block() does, allow for missing padding */
+        block_total_length = ROUND_TO_4BYTE(block_total_length);
+        if (block_total_length < MIN_BLOCK_SIZE) {
+            *err = WTAP_ERR_BAD_FILE;
+            *err_info = ws_strdup_printf("pcapng: total block length %u of the block at offset %" PRId64 " is too small (< %u)",
+                                         block_total_length, block_off, MIN_BLOCK_SIZE);
+            ret = FALSE;
+            break;
+        }
+        if (file_seek(wth->fh, block_off + block_total_length, SEEK_SET, err) == -1) {
+            ret = FALSE;
+            break;
+        }
+    }
+
+    if (file_seek(wth->fh, saved_offset, SEEK_SET, &seek_err) == -1) {
+        if (ret) {
+            *err = seek_err;
+            ret = FALSE;
+        }
+    }
+    return ret;
+}
+
+/*
+ * Make a file that pcapng_open() has just opened read only the section
+ * whose SHB is at the given offset, as if that section were the whole
+ * file.
+ */
+gboolean
+pcapng_open_section(wtap *wth, gint64 section_offset, int *err,
+                    gchar **err_info)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    pcapng_block_header_t bh;
+    wtapng_block_t wblock;
+    section_info_t new_section, *current_section;
+    guint i;
+
+    if (file_seek(wth->fh, section_offset, SEEK_SET, err) == -1)
+        return FALSE;
+    if (!wtap_read_bytes(wth->fh, &bh, sizeof bh, err, err_info))
+        return FALSE;
+    if (bh.block_type != BLOCK_TYPE_SHB) {
+        *err = WTAP_ERR_BAD_FILE;
+        *err_info = ws_strdup_printf("pcapng: no section header block at offset %" PRId64,
+                                     section_offset);
+        return FALSE;
+    }
+    if (file_seek(wth->fh, section_offset, SEEK_SET, err) == -1)
+        return FALSE;
+
+    wblock.block = NULL;
+    wblock.frame_buffer = NULL;
+    wblock.rec = NULL;
+    wblock.skip_data = FALSE;
+    wblock.read_snaplen = 0;
+    wblock.overflow_buffer = NULL;
+    current_section = &g_array_index(pcapng->sections, section_info_t, 0);
+    if (!pcapng_read_block(wth, wth->fh, pcapng, current_section,
+                           &new_section, &wblock, err, err_info)) {
+        wtap_block_unref(wblock.block);
+        if (*err == 0)
+            *err = WTAP_ERR_SHORT_READ;
+        return FALSE;
+    }
+
+    /*
+     * Forget the first section, and everything pcapng_open() read
+     * from it.
+     */
+    for (i = 0; i < pcapng->sections->len; i++) {
+        g_array_free(g_array_index(pcapng->sections, section_info_t, i).interfaces, TRUE);
+    }
+    g_array_set_size(pcapng->sections, 0);
+    new_section.interfaces = g_array_new(FALSE, FALSE, sizeof(interface_info_t));
+    new_section.shb_off = section_offset;
+    g_array_append_val(pcapng->sections, new_section);
+    pcapng->current_section_number = 0;
+
+    for (i = 0; i < wth->shb_hdrs->len; i++) {
+        wtap_block_unref(g_array_index(wth->shb_hdrs, wtap_block_t, i));
+    }
+    g_array_set_size(wth->shb_hdrs, 0);
+    g_array_append_val(wth->shb_hdrs, wblock.block);
+
+    for (i = 0; i < wth->interface_data->len; i++) {
+        wtap_block_unref(g_array_index(wth->interface_data, wtap_block_t, i));
+    }
+    g_array_set_size(wth->interface_data, 0);
+    wth->next_interface_data = 0;
+    for (i = 0; i < wth->dsbs->len; i++) {
+        wtap_block_unref(g_array_index(wth->dsbs, wtap_block_t, i));
+    }
+    g_array_set_size(wth->dsbs, 0);
+
+    wth->file_encap = WTAP_ENCAP_UNKNOWN;
+    wth->file_tsprec = WTAP_TSPREC_UNKNOWN;
+
+    /*
+     * A record index describes the whole file, so it's of no use here.
+     */
+    pcapng->index_looked_for = TRUE;
+    pcapng->single_section = TRUE;
+
+    return pcapng_read_leading_idbs(wth, pcapng, err, err_info);
 }
 
 typedef guint32 (*compute_option_size_func)(wtap_block_t, guint, wtap_opttype_e, wtap_optval_t*);
@@ -5885,11 +6496,119 @@ pcapng_write_if_descr_block(wtap_dumper *wdh, wtap_block_t int_data, int *err)
     return TRUE;
 }
 
+/*
+ * Stop writing a record index, as the file has something a reader that
+ * skips to a record would miss.
+ */
+static void
+pcapng_drop_record_index(wtap_dumper *wdh)
+{
+    pcapng_dump_t *pcapng_dump = (pcapng_dump_t *)wdh->priv;
+
+    if (pcapng_dump != NULL && pcapng_dump->index != NULL) {
+        ws_debug("not writing a record index");
+        g_array_free(pcapng_dump->index, TRUE);
+        pcapng_dump->index = NULL;
+    }
+}
+
+/* Add a record that starts at the given offset to the record index */
+static void
+pcapng_add_to_record_index(wtap_dumper *wdh, const wtap_rec *rec, gint64 offset)
+{
+    pcapng_dump_t *pcapng_dump = (pcapng_dump_t *)wdh->priv;
+    record_index_entry_t entry;
+    guint i;
+
+    if (pcapng_dump == NULL || pcapng_dump->index == NULL)
+        return;
+
+    if (rec->presence_flags & WTAP_HAS_TS) {
+        if (pcapng_dump->num_records != 0 &&
+            nstime_cmp(&rec->ts, &pcapng_dump->last_ts) < 0)
+            pcapng_dump->ts_in_order = FALSE;
+        pcapng_dump->last_ts = rec->ts;
+    }
+
+    if (pcapng_dump->num_records % pcapng_dump->index_step == 0) {
+        if (pcapng_dump->index->len == PCAPNG_RECORD_INDEX_MAX_ENTRIES) {
+            /* Full; keep every other entry */
+            for (i = 0; i < PCAPNG_RECORD_INDEX_MAX_ENTRIES / 2; i++) {
+                g_array_index(pcapng_dump->index, record_index_entry_t, i) =
+                    g_array_index(pcapng_dump->index, record_index_entry_t, 2 * i);
+            }
+            g_array_set_size(pcapng_dump->index, PCAPNG_RECORD_INDEX_MAX_ENTRIES / 2);
+            pcapng_dump->index_step *= 2;
+        }
+        /* Records without time stamps get the one before them */
+        entry.offset = offset;
+        entry.ts = pcapng_dump->last_ts;
+        g_array_append_val(pcapng_dump->index, entry);
+    }
+    pcapng_dump->num_records++;
+}
+
+static gboolean
+pcapng_write_record_index_block(wtap_dumper *wdh, int *err)
+{
+    pcapng_dump_t *pcapng_dump = (pcapng_dump_t *)wdh->priv;
+    pcapng_block_header_t bh;
+    pcapng_record_index_block_t rib;
+    pcapng_record_index_entry_t entry;
+    record_index_entry_t *index_entry;
+
+    bh.block_type = BLOCK_TYPE_RECORD_INDEX;
+    bh.block_total_length = MIN_RECORD_INDEX_SIZE +
+        pcapng_dump->index->len * (guint32)sizeof entry;
+    ws_debug("writing a record index with %u entries, %u bytes",
+             pcapng_dump->index->len, bh.block_total_length);
+
+    rib.magic = PCAPNG_RECORD_INDEX_MAGIC;
+    rib.version = PCAPNG_RECORD_INDEX_VERSION;
+    rib.flags = pcapng_dump->ts_in_order ? PCAPNG_RECORD_INDEX_TS_IN_ORDER : 0;
+    rib.index_step = pcapng_dump->index_step;
+    rib.num_entries = pcapng_dump->index->len;
+    rib.num_records = pcapng_dump->num_records;
+    rib.block_offset = (guint64)wdh->bytes_dumped;
+
+    if (!wtap_dump_file_write(wdh, &bh, sizeof bh, err))
+        return FALSE;
+    wdh->bytes_dumped += sizeof bh;
+    if (!wtap_dump_file_write(wdh, &rib, sizeof rib, err))
+        return FALSE;
+    wdh->bytes_dumped += sizeof rib;
+
+    for (guint i = 0; i < pcapng_dump->index->len; i++) {
+        index_entry = &g_array_index(pcapng_dump->index, record_index_entry_t, i);
+        entry.offset = (guint64)index_entry->offset;
+        entry.secs = (guint64)(gint64)index_entry->ts.secs;
+        entry.nsecs = (guint32)index_entry->ts.nsecs;
+        entry.reserved = 0;
+        if (!wtap_dump_file_write(wdh, &entry, sizeof entry, err))
+            return FALSE;
+        wdh->bytes_dumped += sizeof entry;
+    }
+
+    /* write block footer */
+    if (!wtap_dump_file_write(wdh, &bh.block_total_length,
+                              sizeof bh.block_total_length, err))
+        return FALSE;
+    wdh->bytes_dumped += sizeof bh.block_total_length;
+
+    return TRUE;
+}
+
 static gboolean pcapng_add_idb(wtap_dumper *wdh, wtap_block_t idb,
                                int *err, gchar **err_info _U_)
 {
 	wtap_block_t idb_copy;
 
+	/*
+	 * A reader skipping to a record after this IDB wouldn't see it.
+	 */
+	if (wdh->priv != NULL && ((pcapng_dump_t *)wdh->priv)->num_records != 0)
+		pcapng_drop_record_index(wdh);
+
 	/*
 	 * Add a copy of this IDB to our array of IDBs.
 	 */
@@ -5910,6 +6629,7 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
 #ifdef HAVE_PLUGINS
     block_handler *handler;
 #endif
+    gint64 rec_offset;
 
     /* Write (optional) Decryption Secrets Blocks that were collected while
      * reading packet blocks. */
@@ -5917,6 +6637,8 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
         for (guint i = wdh->dsbs_growing_written; i < wdh->dsbs_growing->len; i++) {
             ws_debug("writing DSB %u", i);
             wtap_block_t dsb = g_array_index(wdh->dsbs_growing, wtap_block_t, i);
+            /* A reader skipping to a later record would miss it */
+            pcapng_drop_record_index(wdh);
             if (!pcapng_write_decryption_secrets_block(wdh, dsb, err)) {
                 return FALSE;
             }
@@ -5924,6 +6646,8 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
         }
     }
 
+    rec_offset = wdh->bytes_dumped;
+
 
     ws_debug("encap = %d (%s) rec type = %u",
              rec->rec_header.packet_header.pkt_encap,
@@ -5998,6 +6722,12 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
             return FALSE;
     }
 
+    /* Some records, such as custom blocks that can't be copied, aren't written */
+    if (wdh->bytes_dumped != rec_offset) {
+        pcapng_add_to_record_index(wdh, rec, rec_offset);
+        wdh->last_rec_offset = rec_offset;
+    }
+
     return TRUE;
 }
 
@@ -6006,12 +6736,14 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
 static gboolean pcapng_dump_finish(wtap_dumper *wdh, int *err,
                                    gchar **err_info _U_)
 {
+    pcapng_dump_t *pcapng_dump;
+    gboolean ret = TRUE;
     guint i, j;
 
     /* Flush any hostname resolution info we may have */
     pcapng_write_name_resolution_block(wdh, err);
 
-    for (i = 0; i < wdh->interface_data->len; i++) {
+    for (i = 0; ret && i < wdh->interface_data->len; i++) {
 
         /* Get the interface description */
         wtap_block_t int_data;
@@ -6020,20 +6752,31 @@ static gboolean pcapng_dump_finish(wtap_dumper *wdh, int *err,
         int_data = g_array_index(wdh->interface_data, wtap_block_t, i);
         int_data_mand = (wtapng_if_descr_mandatory_t*)wtap_block_get_mandatory_data(int_data);
 
-        for (j = 0; j < int_data_mand->num_stat_entries; j++) {
+        for (j = 0; ret && j < int_data_mand->num_stat_entries; j++) {
             wtap_block_t if_stats;
 
             if_stats = g_array_index(int_data_mand->interface_statistics, wtap_block_t, j);
             ws_debug("write ISB for interface %u",
                      ((wtapng_if_stats_mandatory_t*)wtap_block_get_mandatory_data(if_stats))->interface_id);
             if (!pcapng_write_interface_statistics_block(wdh, if_stats, err)) {
-                return FALSE;
+                ret = FALSE;
             }
         }
     }
 
+    /* The record index must be the last block */
+    pcapng_dump = (pcapng_dump_t *)wdh->priv;
+    if (pcapng_dump != NULL && pcapng_dump->index != NULL) {
+        if (ret && pcapng_dump->num_records != 0 &&
+            !pcapng_write_record_index_block(wdh, err)) {
+            ret = FALSE;
+        }
+        g_array_free(pcapng_dump->index, TRUE);
+        pcapng_dump->index = NULL;
+    }
+
     ws_debug("leaving function");
-    return TRUE;
+    return ret;
 }
 
 /* Returns TRUE on success, FALSE on failure; sets "*err" to an error code on
@@ -6082,6 +6825,23 @@ pcapng_dump_open(wtap_dumper *wdh, int *err, gchar **err_info _U_)
         }
     }
 
+    /*
+     * The offsets in a record index are only of use in a file that can
+     * be seeked in cheaply, i.e. not a compressed one, and a reader that
+     * skips to a record would miss any decryption secrets before it.
+     */
+    if (wdh->write_index && wdh->compression_type == WTAP_UNCOMPRESSED &&
+        (wdh->dsbs_initial == NULL || wdh->dsbs_initial->len == 0)) {
+        pcapng_dump_t *pcapng_dump = g_new(pcapng_dump_t, 1);
+
+        pcapng_dump->index = g_array_new(FALSE, FALSE, sizeof(record_index_entry_t));
+        pcapng_dump->index_step = 1;
+        pcapng_dump->num_records = 0;
+        nstime_set_zero(&pcapng_dump->last_ts);
+        pcapng_dump->ts_in_order = TRUE;
+        wdh->priv = pcapng_dump;
+    }
+
     return TRUE;
 }
 
@@ -74,4 +74,18 @@ struct pcapng_option_header {
 
 wtap_open_return_val pcapng_open(wtap *wth, int *err, gchar **err_info);
 
+/*
+ * Append the offsets of the file's SHBs to offsets, an array of gint64s.
+ * The sequential read position isn't changed.
+ */
+gboolean pcapng_get_section_offsets(wtap *wth, GArray *offsets, int *err,
+                                    gchar **err_info);
+
+/*
+ * Make a file that has just been opened read only the section whose SHB
+ * is at section_offset.
+ */
+gboolean pcapng_open_section(wtap *wth, gint64 section_offset, int *err,
+                             gchar **err_info);
+
 #endif
@@ -34,6 +34,7 @@
 #define BLOCK_TYPE_SYSDIG_EVF_V2_LARGE    0x00000222 /* Sysdig Event Block with flags version 2 with large payload */
 #define BLOCK_TYPE_CB_COPY                0x00000BAD /* Custom Block which can be copied */
 #define BLOCK_TYPE_CB_NO_COPY             0x40000BAD /* Custom Block which should not be copied */
+#define BLOCK_TYPE_RECORD_INDEX           0x80000A1D /* Record index, written by Wireshark; in the local use range */
 
 /* TODO: the following are not yet well defined in the draft spec,
  * and do not yet have block type values assigned to them:
@@ -52,6 +53,9 @@ typedef struct wtapng_block_s {
     wtap_block_t block;
     wtap_rec     *rec;
     Buffer       *frame_buffer;
+    gboolean     skip_data;      /* TRUE if packet data needn't be read into frame_buffer */
+    guint32      read_snaplen;   /* if non-zero, most packet data to read into frame_buffer */
+    Buffer       *overflow_buffer; /* if not NULL, frame_buffer can't grow; blocks that might not fit in it are read into this */
 } wtapng_block_t;
 
 /* Section data in private struct */
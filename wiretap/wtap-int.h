@@ -29,6 +29,12 @@ typedef gboolean (*subtype_read_func)(struct wtap*, wtap_rec *,
                                       Buffer *, int *, char **, gint64 *);
 typedef gboolean (*subtype_seek_read_func)(struct wtap*, gint64, wtap_rec *,
                                            Buffer *, int *, char **);
+typedef gboolean (*subtype_index_lookup_func)(struct wtap*, guint64,
+                                              const nstime_t *, guint64 *,
+                                              gint64 *, int *, char **);
+typedef gboolean (*subtype_can_copy_raw_func)(struct wtap*);
+typedef gboolean (*subtype_read_batch_func)(struct wtap*, wtap_batch *,
+                                            int *, char **);
 
 /**
  * Struct holding data of the currently read file.
@@ -52,6 +58,9 @@ struct wtap {
 
     subtype_read_func           subtype_read;
     subtype_seek_read_func      subtype_seek_read;
+    subtype_index_lookup_func   subtype_index_lookup;   /**< NULL if the file type has no index of its records */
+    subtype_can_copy_raw_func   subtype_can_copy_raw;   /**< NULL, or whether the record just read can be copied byte for byte to a file of the same type */
+    subtype_read_batch_func     subtype_read_batch;     /**< NULL, or reads records straight into a wtap_batch */
     void                        (*subtype_sequential_close)(struct wtap*);
     void                        (*subtype_close)(struct wtap*);
     int                         file_encap;    /* per-file, for those
@@ -74,6 +83,9 @@ struct wtap {
     wtap_new_ipv6_callback_t    add_new_ipv6;
     wtap_new_secrets_callback_t add_new_secrets;
     GPtrArray                   *fast_seek;
+    gboolean                    skip_packet_data;       /**< TRUE if wtap_read() may skip packet data */
+    guint32                     read_snaplen;           /**< if non-zero, most packet bytes to deliver per record */
+    int                         raw_copy_fd;            /**< descriptor wtap_dump_copy_raw() reads from, or -1 */
 };
 
 struct wtap_dumper;
@@ -99,6 +111,8 @@ struct wtap_dumper {
     wtap_compression_type   compression_type;
     gboolean                needs_reload;    /* TRUE if the file requires re-loading after saving with wtap */
     gint64                  bytes_dumped;
+    gboolean                write_index;     /* TRUE if an index of the records should be written, if supported */
+    gint64                  last_rec_offset; /* offset of the last record written, or -1 if the subtype doesn't say */
 
     void                    *priv;           /* this one holds per-file state and is free'd automatically by wtap_dump_close() */
     void                    *wslua_data;     /* this one holds wslua state info and is not free'd */
@@ -319,6 +333,29 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * For a subtype_read_batch routine: start the next record of a batch,
+ * setting *window to a Buffer for the unused part of the batch's buffer,
+ * with room for at least min_space bytes.  Return NULL if the batch is
+ * full.
+ *
+ * The window can't grow, so don't read more than min_space bytes into
+ * it; read records that might be bigger into another Buffer, such as
+ * the batch's overflow buffer.
+ */
+wtap_batch_rec *
+wtap_batch_next_rec(wtap *wth, wtap_batch *batch, Buffer *window,
+    gsize min_space);
+
+/*
+ * Add the record started by wtap_batch_next_rec() to the batch; its
+ * data was read into data_buf, which is either the window or another
+ * Buffer, from which it's copied.
+ */
+void
+wtap_batch_add_rec(wtap *wth, wtap_batch *batch, Buffer *window,
+    Buffer *data_buf);
+
 /*
  * Implementation of wth->subtype_read that reads the full file contents
  * as a single packet.
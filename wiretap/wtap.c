@@ -1447,6 +1447,9 @@ wtap_close(wtap *wth)
 	if (wth->random_fh != NULL)
 		file_close(wth->random_fh);
 
+	if (wth->raw_copy_fd != -1)
+		ws_close(wth->raw_copy_fd);
+
 	g_free(wth->priv);
 
 	g_free(wth->pathname);
@@ -1480,6 +1483,16 @@ void wtap_set_cb_new_ipv6(wtap *wth, wtap_new_ipv6_callback_t add_new_ipv6) {
 		wth->add_new_ipv6 = add_new_ipv6;
 }
 
+void wtap_set_skip_packet_data(wtap *wth, gboolean skip) {
+	if (wth)
+		wth->skip_packet_data = skip;
+}
+
+void wtap_set_read_snaplen(wtap *wth, guint32 snaplen) {
+	if (wth)
+		wth->read_snaplen = snaplen;
+}
+
 void wtap_set_cb_new_secrets(wtap *wth, wtap_new_secrets_callback_t add_new_secrets) {
 	/* Is a valid wth given that supports DSBs? */
 	if (!wth || !wth->dsbs)
@@ -1582,6 +1595,222 @@ wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	return TRUE;	/* success */
 }
 
+/*
+ * Size of a batch's buffer; we stop adding records to a batch once they
+ * fill it.
+ */
+#define WTAP_BATCH_BUFFER_SIZE	(4*1024*1024)
+
+void
+wtap_batch_init(wtap_batch *batch, guint max_count)
+{
+	guint i;
+
+	ws_assert(max_count != 0);
+	batch->recs = g_new0(wtap_batch_rec, max_count);
+	for (i = 0; i < max_count; i++)
+		wtap_rec_init(&batch->recs[i].rec);
+	batch->count = 0;
+	batch->max_count = max_count;
+	ws_buffer_init(&batch->buf, WTAP_BATCH_BUFFER_SIZE);
+	ws_buffer_init(&batch->overflow, 1514);
+	batch->pending_err = 0;
+	batch->pending_err_info = NULL;
+}
+
+void
+wtap_batch_cleanup(wtap_batch *batch)
+{
+	guint i;
+
+	for (i = 0; i < batch->max_count; i++)
+		wtap_rec_cleanup(&batch->recs[i].rec);
+	g_free(batch->recs);
+	batch->recs = NULL;
+	batch->count = 0;
+	batch->max_count = 0;
+	ws_buffer_free(&batch->buf);
+	ws_buffer_free(&batch->overflow);
+	g_free(batch->pending_err_info);
+	batch->pending_err_info = NULL;
+}
+
+wtap_batch_rec *
+wtap_batch_next_rec(wtap *wth, wtap_batch *batch, Buffer *window,
+    gsize min_space)
+{
+	wtap_batch_rec *brec;
+
+	if (batch->count >= batch->max_count)
+		return NULL;
+	if (batch->buf.allocated - batch->buf.first_free < min_space ||
+	    ws_buffer_length(&batch->buf) >= WTAP_BATCH_BUFFER_SIZE) {
+		/*
+		 * Leave the rest for the next batch, unless this is the
+		 * first record.
+		 */
+		if (batch->count != 0)
+			return NULL;
+		ws_buffer_assure_space(&batch->buf, min_space);
+	}
+
+	brec = &batch->recs[batch->count];
+	wtap_init_rec(wth, &brec->rec);
+	brec->data = NULL;
+	brec->data_len = 0;
+	brec->data_start = batch->buf.first_free;
+
+	window->data = ws_buffer_end_ptr(&batch->buf);
+	window->allocated = batch->buf.allocated - batch->buf.first_free;
+	window->start = 0;
+	window->first_free = 0;
+	return brec;
+}
+
+/*
+ * How much of the buffer passed to the read routine the data of a
+ * record takes up.
+ */
+static guint32
+wtap_rec_data_len(wtap *wth, const wtap_rec *rec)
+{
+	switch (rec->rec_type) {
+
+	case REC_TYPE_PACKET:
+		return wth->skip_packet_data ? 0 : rec->rec_header.packet_header.caplen;
+
+	case REC_TYPE_FT_SPECIFIC_EVENT:
+	case REC_TYPE_FT_SPECIFIC_REPORT:
+		return rec->rec_header.ft_specific_header.record_len;
+
+	case REC_TYPE_SYSCALL:
+		return rec->rec_header.syscall_header.event_filelen;
+
+	case REC_TYPE_SYSTEMD_JOURNAL_EXPORT:
+		return rec->rec_header.systemd_journal_export_header.record_len;
+
+	case REC_TYPE_CUSTOM_BLOCK:
+		return rec->rec_header.custom_block_header.length;
+	}
+	return 0;
+}
+
+void
+wtap_batch_add_rec(wtap *wth, wtap_batch *batch, Buffer *window,
+    Buffer *data_buf)
+{
+	wtap_batch_rec *brec = &batch->recs[batch->count];
+	wtap_rec *rec = &brec->rec;
+	guint32 data_len;
+
+	/* The same checks as wtap_read() */
+	if (rec->rec_type == REC_TYPE_PACKET) {
+		if (rec->rec_header.packet_header.caplen > rec->rec_header.packet_header.len)
+			rec->rec_header.packet_header.caplen = rec->rec_header.packet_header.len;
+		ws_assert(rec->rec_header.packet_header.pkt_encap != WTAP_ENCAP_PER_PACKET);
+	}
+
+	data_len = wtap_rec_data_len(wth, rec);
+	if (data_len > data_buf->allocated)
+		data_len = (guint32)data_buf->allocated;
+	if (data_buf == window) {
+		/* It's already where it belongs */
+		ws_buffer_increase_length(&batch->buf, data_len);
+	} else {
+		ws_buffer_append(&batch->buf, ws_buffer_start_ptr(data_buf),
+		    data_len);
+	}
+	brec->data_len = data_len;
+	batch->count++;
+}
+
+/*
+ * For file types that can't read records straight into a batch, read
+ * each one into the batch's overflow buffer and copy it from there.
+ */
+static gboolean
+wtap_read_batch_generic(wtap *wth, wtap_batch *batch, int *err,
+    gchar **err_info)
+{
+	wtap_batch_rec *brec;
+	Buffer window;
+
+	while ((brec = wtap_batch_next_rec(wth, batch, &window, 0)) != NULL) {
+		if (!wth->subtype_read(wth, &brec->rec, &batch->overflow, err,
+		    err_info, &brec->data_offset))
+			return FALSE;
+		wtap_batch_add_rec(wth, batch, &window, &batch->overflow);
+	}
+	return TRUE;
+}
+
+gboolean
+wtap_read_batch(wtap *wth, wtap_batch *batch, int *err, gchar **err_info)
+{
+	gboolean ok;
+	guint i;
+
+	for (i = 0; i < batch->count; i++)
+		wtap_rec_reset(&batch->recs[i].rec);
+	batch->count = 0;
+	ws_buffer_clean(&batch->buf);
+
+	if (batch->pending_err != 0) {
+		*err = batch->pending_err;
+		*err_info = batch->pending_err_info;
+		batch->pending_err = 0;
+		batch->pending_err_info = NULL;
+		return FALSE;
+	}
+
+	*err = 0;
+	*err_info = NULL;
+	if (wth->subtype_read_batch != NULL)
+		ok = wth->subtype_read_batch(wth, batch, err, err_info);
+	else
+		ok = wtap_read_batch_generic(wth, batch, err, err_info);
+	if (!ok) {
+		/*
+		 * As with wtap_read(), check for a deferred error, and
+		 * unreference any block created for the record we didn't
+		 * finish reading.
+		 */
+		if (*err == 0)
+			*err = file_error(wth->fh, err_info);
+		wtap_rec_reset(&batch->recs[batch->count].rec);
+		if (batch->count == 0)
+			return FALSE;
+
+		/* Hand back what we did read; report the error next time. */
+		batch->pending_err = *err;
+		batch->pending_err_info = *err_info;
+		*err = 0;
+		*err_info = NULL;
+	}
+
+	for (i = 0; i < batch->count; i++)
+		batch->recs[i].data = batch->buf.data + batch->recs[i].data_start;
+	return batch->count != 0;
+}
+
+guint32
+wtap_raw_record_length(wtap *wth, gint64 data_offset)
+{
+	gint64 end_offset;
+
+	if (wth->subtype_can_copy_raw == NULL || wth->ispipe ||
+	    wth->fh == NULL || file_iscompressed(wth->fh))
+		return 0;
+	if (!(*wth->subtype_can_copy_raw)(wth))
+		return 0;
+
+	/* We're just past the record wtap_read() returned */
+	end_offset = file_tell(wth->fh);
+	if (end_offset <= data_offset || end_offset - data_offset > G_MAXUINT32)
+		return 0;
+	return (guint32)(end_offset - data_offset);
+}
+
 /*
  * Read a given number of bytes from a file into a buffer or, if
  * buf is NULL, just discard them.
@@ -1745,6 +1974,69 @@ wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec, Buffer *buf,
 	return TRUE;
 }
 
+gboolean
+wtap_seek_to_frame(wtap *wth, guint64 frame_num, int *err, gchar **err_info)
+{
+	guint64 found_frame;
+	gint64 found_offset;
+	gboolean skip_packet_data;
+	wtap_rec rec;
+	Buffer buf;
+	gint64 data_offset;
+	gboolean ret = TRUE;
+
+	*err = 0;
+	*err_info = NULL;
+	if (wth->fh == NULL || wth->subtype_index_lookup == NULL || frame_num == 0)
+		return FALSE;
+	if (!wth->subtype_index_lookup(wth, frame_num, NULL, &found_frame,
+	    &found_offset, err, err_info))
+		return FALSE;
+	if (file_seek(wth->fh, found_offset, SEEK_SET, err) == -1)
+		return FALSE;
+
+	/*
+	 * Read over the records between the one in the index and the
+	 * one we want, without their data.
+	 */
+	if (found_frame < frame_num) {
+		skip_packet_data = wth->skip_packet_data;
+		wth->skip_packet_data = TRUE;
+		wtap_rec_init(&rec);
+		ws_buffer_init(&buf, 1514);
+		while (found_frame < frame_num) {
+			if (!wtap_read(wth, &rec, &buf, err, err_info, &data_offset)) {
+				ret = FALSE;
+				break;
+			}
+			wtap_rec_reset(&rec);
+			found_frame++;
+		}
+		wtap_rec_cleanup(&rec);
+		ws_buffer_free(&buf);
+		wth->skip_packet_data = skip_packet_data;
+	}
+	return ret;
+}
+
+gboolean
+wtap_seek_to_time(wtap *wth, const nstime_t *ts, guint64 *frame_num,
+    int *err, gchar **err_info)
+{
+	gint64 found_offset;
+
+	*err = 0;
+	*err_info = NULL;
+	if (wth->fh == NULL || wth->subtype_index_lookup == NULL)
+		return FALSE;
+	if (!wth->subtype_index_lookup(wth, 0, ts, frame_num, &found_offset,
+	    err, err_info))
+		return FALSE;
+	if (file_seek(wth->fh, found_offset, SEEK_SET, err) == -1)
+		return FALSE;
+	return TRUE;
+}
+
 static gboolean
 wtap_full_file_read_file(wtap *wth, FILE_T fh, wtap_rec *rec, Buffer *buf, int *err, gchar **err_info)
 {
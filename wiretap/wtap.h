@@ -1435,6 +1435,9 @@ typedef struct wtap_dump_params {
                                                  This array may grow since the dumper was opened and will subsequently
                                                  be written before newer packets are written in wtap_dump. */
     gboolean    dont_copy_idbs;             /**< XXX - don't copy IDBs; this should eventually always be the case. */
+    gboolean    write_index;                /**< Write an index of the records at the end of the file, so that
+                                                 wtap_seek_to_frame() and wtap_seek_to_time() work on it.
+                                                 Currently pcapng only. */
 } wtap_dump_params;
 
 /* Zero-initializer for wtap_dump_params. */
@@ -1690,6 +1693,45 @@ WS_DLL_PUBLIC
 struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err,
     gchar **err_info, gboolean do_random);
 
+/** Get the offsets of the sections of a file, so that they can be read
+ * independently, for example in parallel, with wtap_open_offline_section().
+ * Currently only pcapng files can have more than one section; any other
+ * file has one, at offset 0. This reads through the whole file, but only
+ * looks at the headers of pcapng blocks.
+ *
+ * @param wth a wtap * returned by a call that opened a file for reading;
+ * its sequential read position isn't changed.
+ * @param[out] offsets set to an array of gint64 offsets, in file order, to
+ * be freed with g_array_free() by the caller.
+ * @param[out] err a positive "errno" value, or a negative number indicating
+ * the type of error, on failure.
+ * @param[out] err_info for some errors, a string giving more details of
+ * the error
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_get_section_offsets(wtap *wth, GArray **offsets, int *err,
+    gchar **err_info);
+
+/** Open a file to read only one of its sections, as returned by
+ * wtap_get_section_offsets(), as if that section were the whole file:
+ * the section's SHB and IDBs are the file's only SHB and IDBs, interface
+ * IDs are relative to the section, and the end of the section reads as
+ * the end of the file.
+ *
+ * @param filename Name of the file to open
+ * @param section_offset the offset of the section.
+ * @param[out] err a positive "errno" value if the capture file can't be opened;
+ * a negative number, indicating the type of error, on other failures.
+ * @param[out] err_info for some errors, a string giving more details of
+ * the error
+ * @param do_random TRUE if random access to the file will be done,
+ * FALSE if not
+ */
+WS_DLL_PUBLIC
+struct wtap* wtap_open_offline_section(const char *filename,
+    gint64 section_offset, int *err, gchar **err_info, gboolean do_random);
+
 /**
  * If we were compiled with zlib and we're at EOF, unset EOF so that
  * wtap_read/gzread has a chance to succeed. This is necessary if
@@ -1718,6 +1760,30 @@ typedef void (*wtap_new_secrets_callback_t)(guint32 secrets_type, const void *se
 WS_DLL_PUBLIC
 void wtap_set_cb_new_secrets(wtap *wth, wtap_new_secrets_callback_t add_new_secrets);
 
+/**
+ * Tell the sequential read routine that the caller only wants the record
+ * metadata (lengths, time stamp, encapsulation, interface and options)
+ * and not the packet data, as is the case for capinfos. Readers that
+ * support this skip over the data of packet records rather than copying
+ * it into the Buffer passed to wtap_read(), whose contents are then
+ * unspecified; other readers read the data as usual. It has no effect
+ * on wtap_seek_read(). Currently pcap and pcapng only.
+ */
+WS_DLL_PUBLIC
+void wtap_set_skip_packet_data(wtap *wth, gboolean skip);
+
+/**
+ * Deliver at most snaplen bytes of each packet, as if the file had been
+ * captured with that snapshot length; 0, the default, delivers all of
+ * them. The packet length is unchanged and the captured length is cut
+ * down. Readers that support this skip over the rest of the packet
+ * rather than reading it, which helps jobs that only look at headers.
+ * It applies to both wtap_read() and wtap_seek_read(), so set it before
+ * the first read. Currently pcap and pcapng only.
+ */
+WS_DLL_PUBLIC
+void wtap_set_read_snaplen(wtap *wth, guint32 snaplen);
+
 /** Read the next record in the file, filling in *phdr and *buf.
  *
  * @wth a wtap * returned by a call that opened a file for reading.
@@ -1737,6 +1803,60 @@ WS_DLL_PUBLIC
 gboolean wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
     gchar **err_info, gint64 *offset);
 
+/** A record read by wtap_read_batch(). */
+typedef struct {
+    wtap_rec      rec;
+    gint64        data_offset;  /**< offset to pass to wtap_seek_read() to reread the record */
+    const guint8 *data;         /**< the record's data, in the batch's buffer */
+    guint32       data_len;     /**< length of data; 0 for packets if the data was skipped */
+    gsize         data_start;   /**< offset of data in the batch's buffer */
+} wtap_batch_rec;
+
+/** Records read by wtap_read_batch(), and the buffer holding their data. */
+typedef struct {
+    wtap_batch_rec *recs;
+    guint           count;      /**< number of records in recs */
+    guint           max_count;  /**< number of records recs has room for */
+    Buffer          buf;        /**< the data of all the records */
+    Buffer          overflow;   /**< for records too big for what's left of buf */
+    int             pending_err;        /**< error to report on the next call */
+    gchar          *pending_err_info;
+} wtap_batch;
+
+/**
+ * Set up a batch of up to max_count records for wtap_read_batch().
+ */
+WS_DLL_PUBLIC
+void wtap_batch_init(wtap_batch *batch, guint max_count);
+
+/**
+ * Free the records and data of a batch.
+ */
+WS_DLL_PUBLIC
+void wtap_batch_cleanup(wtap_batch *batch);
+
+/** Read the next records in the file, replacing the ones the batch
+ * held before. Each record's data is in one buffer shared by the whole
+ * batch, so there's no copying for each record, and pcap and pcapng
+ * read their records straight into that buffer; the records and data
+ * are valid until the next call or wtap_batch_cleanup(). If an error
+ * occurs after some records were read, those records are returned and
+ * the error is reported by the next call.
+ *
+ * @wth a wtap * returned by a call that opened a file for reading.
+ * @batch a batch set up with wtap_batch_init(); batch->count is set to
+ * the number of records read.
+ * @param err a positive "errno" value, or a negative number indicating
+ * the type of error, if the read failed, or 0 at the end of the file.
+ * @param err_info for some errors, a string giving more details of
+ * the error
+ * @return TRUE if any records were read, FALSE on error or at the end
+ * of the file.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_read_batch(wtap *wth, wtap_batch *batch, int *err,
+    gchar **err_info);
+
 /** Read the record at a specified offset in a capture file, filling in
  * *phdr and *buf.
  *
@@ -1757,6 +1877,47 @@ WS_DLL_PUBLIC
 gboolean wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
     Buffer *buf, int *err, gchar **err_info);
 
+/** Use the index at the end of a file, if it has one, to make the next
+ * wtap_read() return the given record without reading the ones before it.
+ * The index doesn't have every record of a large file, so up to a few
+ * thousand records may still be read over. Currently pcapng only; see
+ * the write_index member of wtap_dump_params.
+ *
+ * @wth a wtap * returned by a call that opened a file for reading.
+ * @frame_num the number of the record, counting from 1.
+ * @param err a positive "errno" value, or a negative number indicating
+ * the type of error, if the seek failed; 0 if the file has no index or
+ * no such record, in which case the next wtap_read() is unaffected.
+ * @param err_info for some errors, a string giving more details of
+ * the error
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_seek_to_frame(wtap *wth, guint64 frame_num, int *err,
+    gchar **err_info);
+
+/** Use the index at the end of a file, if it has one, to skip over
+ * records that are earlier than the given time. The next wtap_read()
+ * returns a record earlier than the first one at or after that time;
+ * reading on from there finds it. This only works if the time stamps
+ * in the file are in order, which the index records.
+ *
+ * @wth a wtap * returned by a call that opened a file for reading.
+ * @ts the time.
+ * @frame_num set to the number of the record the next wtap_read()
+ * returns, counting from 1.
+ * @param err a positive "errno" value, or a negative number indicating
+ * the type of error, if the seek failed; 0 if the file has no index or
+ * its time stamps aren't in order, in which case the next wtap_read()
+ * is unaffected.
+ * @param err_info for some errors, a string giving more details of
+ * the error
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_seek_to_time(wtap *wth, const nstime_t *ts, guint64 *frame_num,
+    int *err, gchar **err_info);
+
 /*** initialize a wtap_rec structure ***/
 WS_DLL_PUBLIC
 void wtap_rec_init(wtap_rec *rec);
@@ -2091,6 +2252,50 @@ gboolean wtap_dump_add_idb(wtap_dumper *wdh, wtap_block_t idb, int *err,
 WS_DLL_PUBLIC
 gboolean wtap_dump(wtap_dumper *, const wtap_rec *, const guint8 *,
      int *err, gchar **err_info);
+
+/**
+ * Get the length of the record that wtap_read() just returned, at
+ * data_offset, if its bytes in the file can be copied unchanged, with
+ * wtap_dump_copy_raw(), to a file of the same type; otherwise, return 0.
+ * Currently only pcap and pcapng packet records in uncompressed files
+ * can be copied, and, for pcapng, only those in the first section of
+ * a file that has no decryption secrets.
+ *
+ * @param wth a wtap * returned by a call that opened a file for reading.
+ * @param data_offset the offset wtap_read() returned.
+ * @return the length of the record in the file, or 0.
+ */
+WS_DLL_PUBLIC
+guint32 wtap_raw_record_length(wtap *wth, gint64 data_offset);
+
+/**
+ * TRUE if wtap_dump_copy_raw() can copy records from wth to wdh: wdh
+ * must write an uncompressed file of the same type as wth, without a
+ * record index. For pcapng, wdh must also have been opened with the
+ * IDBs of wth, and the caller must add the IDBs wth reads to it as
+ * they're read, so that interface IDs mean the same in both files.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_dump_can_copy_raw(wtap_dumper *wdh, wtap *wth);
+
+/**
+ * Copy len bytes at offset in the file that wth reads to wdh, without
+ * parsing them; they must be one or more consecutive records for each
+ * of which wtap_raw_record_length() was non-zero. Copying a run of
+ * records at once is much cheaper than copying them one at a time.
+ *
+ * @param wdh handle for the file we're writing.
+ * @param wth handle for the file we're reading.
+ * @param offset the offset of the first record.
+ * @param len the total length of the records.
+ * @param[out] err Will be set to an error code on failure.
+ * @param[out] err_info for some errors, a string giving more details of
+ * the error.
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_dump_copy_raw(wtap_dumper *wdh, wtap *wth, gint64 offset,
+     gint64 len, int *err, gchar **err_info);
 WS_DLL_PUBLIC
 gboolean wtap_dump_flush(wtap_dumper *, int *);
 WS_DLL_PUBLIC
@@ -2106,6 +2311,15 @@ WS_DLL_PUBLIC
 gboolean wtap_dump_set_addrinfo_list(wtap_dumper *wdh, addrinfo_lists_t *addrinfo_lists);
 WS_DLL_PUBLIC
 gboolean wtap_dump_get_needs_reload(wtap_dumper *wdh);
+
+/**
+ * Get the offset in the file of the record most recently written by
+ * wtap_dump(), as a reader of the file would report it, or -1 if the
+ * record wasn't written or the file type doesn't keep track of that.
+ * Offsets are only meaningful for uncompressed files.
+ */
+WS_DLL_PUBLIC
+gint64 wtap_dump_last_record_offset(wtap_dumper *wdh);
 WS_DLL_PUBLIC
 void wtap_dump_discard_decryption_secrets(wtap_dumper *wdh);
 
@@ -0,0 +1,447 @@
+/* capindex.c
+ * Summaries of capture files, written next to ring buffer files so that
+ * the files that can't hold the packets being looked for can be skipped.
+ *
+ * An index holds the time stamps of the first and last packets of a file,
+ * its packet count, and a Bloom filter of the IP addresses and TCP, UDP
+ * and SCTP ports in it. It's a key file, so it can be looked at:
+ *
+ *   [Index]
+ *   version=1
+ *   first=1660000000.123456789
+ *   last=1660000059.987654321
+ *   packets=123456
+ *   bloom=<base64 of CAPINDEX_BLOOM_BITS bits>
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+#include <wsutil/str_util.h>
+
+#include "capindex.h"
+
+#define CAPINDEX_GROUP      "Index"
+#define CAPINDEX_VERSION    1
+
+/* Link-layer types we understand; LINKTYPE_ values, and DLT_ ones where they differ */
+#define LT_NULL             0
+#define LT_EN10MB           1
+#define LT_DLT_RAW1         12
+#define LT_DLT_RAW2         14
+#define LT_RAW              101
+#define LT_LOOP             108
+#define LT_LINUX_SLL        113
+#define LT_IPV4             228
+#define LT_IPV6             229
+#define LT_LINUX_SLL2       276
+
+/* Bloom filter keys are a type byte followed by the value */
+#define KEY_ADDRESS         'a'
+#define KEY_PORT            'p'
+
+void
+capindex_init(capindex_t *index)
+{
+    nstime_set_unset(&index->first);
+    nstime_set_unset(&index->last);
+    index->packets = 0;
+    memset(index->bloom, 0, sizeof(index->bloom));
+}
+
+static gboolean
+summarize_ip(const guint8 *pd, guint32 len, capindex_summary_t *summary)
+{
+    guint8   proto;
+    guint32  hdr_len;
+
+    if (len < 1)
+        return FALSE;
+
+    switch (pd[0] >> 4) {
+
+    case 4:
+        if (len < 20)
+            return FALSE;
+        hdr_len = (pd[0] & 0x0f) * 4;
+        if (hdr_len < 20 || len < hdr_len)
+            return FALSE;
+        summary->ip_version = 4;
+        memcpy(summary->src, pd + 12, 4);
+        memcpy(summary->dst, pd + 16, 4);
+        proto = pd[9];
+        if ((pntoh16(pd + 6) & 0x1fff) != 0) {
+            /* not the first fragment; no ports */
+            return TRUE;
+        }
+        break;
+
+    case 6:
+        if (len < 40)
+            return FALSE;
+        summary->ip_version = 6;
+        memcpy(summary->src, pd + 8, 16);
+        memcpy(summary->dst, pd + 24, 16);
+        proto = pd[6];
+        hdr_len = 40;
+        /* skip the extension headers that can come before a transport header */
+        for (;;) {
+            if (proto == 0 || proto == 43 || proto == 60) {
+                /* hop-by-hop, routing, destination options */
+                if (len < hdr_len + 8)
+                    return TRUE;
+                proto = pd[hdr_len];
+                hdr_len += (pd[hdr_len + 1] + 1) * 8;
+            } else if (proto == 44) {
+                /* fragment; only the first one has the ports */
+                if (len < hdr_len + 8 || (pntoh16(pd + hdr_len + 2) & 0xfff8) != 0)
+                    return TRUE;
+                proto = pd[hdr_len];
+                hdr_len += 8;
+            } else {
+                break;
+            }
+        }
+        break;
+
+    default:
+        return FALSE;
+    }
+
+    if ((proto == 6 || proto == 17 || proto == 132) && len >= hdr_len + 4) {
+        /* TCP, UDP and SCTP all start with the ports */
+        summary->has_ports = TRUE;
+        summary->srcport = pntoh16(pd + hdr_len);
+        summary->dstport = pntoh16(pd + hdr_len + 2);
+    }
+    return TRUE;
+}
+
+static gboolean
+summarize_ethertype(guint16 ethertype, const guint8 *pd, guint32 len,
+                    capindex_summary_t *summary)
+{
+    if (ethertype != 0x0800 && ethertype != 0x86dd)
+        return FALSE;
+    return summarize_ip(pd, len, summary);
+}
+
+gboolean
+capindex_summarize(int linktype, const guint8 *pd, guint32 caplen,
+                   capindex_summary_t *summary)
+{
+    guint32 offset;
+    guint16 ethertype;
+    int     tags;
+
+    memset(summary, 0, sizeof(*summary));
+
+    switch (linktype) {
+
+    case LT_EN10MB:
+        if (caplen < 14)
+            return FALSE;
+        ethertype = pntoh16(pd + 12);
+        offset = 14;
+        /* up to two VLAN tags */
+        for (tags = 0; tags < 2 && (ethertype == 0x8100 || ethertype == 0x88a8 ||
+                                    ethertype == 0x9100); tags++) {
+            if (caplen < offset + 4)
+                return FALSE;
+            ethertype = pntoh16(pd + offset + 2);
+            offset += 4;
+        }
+        return summarize_ethertype(ethertype, pd + offset, caplen - offset, summary);
+
+    case LT_DLT_RAW1:
+    case LT_DLT_RAW2:
+    case LT_RAW:
+    case LT_IPV4:
+    case LT_IPV6:
+        return summarize_ip(pd, caplen, summary);
+
+    case LT_NULL:
+    case LT_LOOP:
+        /* a 4-byte address family, in an order we can't be sure of; look at the IP version instead */
+        if (caplen < 4)
+            return FALSE;
+        return summarize_ip(pd + 4, caplen - 4, summary);
+
+    case LT_LINUX_SLL:
+        if (caplen < 16)
+            return FALSE;
+        return summarize_ethertype(pntoh16(pd + 14), pd + 16, caplen - 16, summary);
+
+    case LT_LINUX_SLL2:
+        if (caplen < 20)
+            return FALSE;
+        return summarize_ethertype(pntoh16(pd), pd + 20, caplen - 20, summary);
+
+    default:
+        return FALSE;
+    }
+}
+
+/*
+ * The bits of a key are found by double hashing two FNV-1a hashes with
+ * different offset bases.
+ */
+static void
+bloom_hashes(const guint8 *key, size_t key_len, guint32 *h1, guint32 *h2)
+{
+    guint32 a = 2166136261U;
+    guint32 b = 0x9747b28cU;
+    size_t  i;
+
+    for (i = 0; i < key_len; i++) {
+        a = (a ^ key[i]) * 16777619U;
+        b = (b ^ key[i]) * 16777619U;
+    }
+    *h1 = a;
+    *h2 = b | 1;
+}
+
+static void
+bloom_add(capindex_t *index, const guint8 *key, size_t key_len)
+{
+    guint32 h1, h2, bit;
+    int     i;
+
+    bloom_hashes(key, key_len, &h1, &h2);
+    for (i = 0; i < CAPINDEX_BLOOM_HASHES; i++) {
+        bit = (h1 + i * h2) % CAPINDEX_BLOOM_BITS;
+        index->bloom[bit / 8] |= (guint8)(1 << (bit % 8));
+    }
+}
+
+static gboolean
+bloom_may_have(const capindex_t *index, const guint8 *key, size_t key_len)
+{
+    guint32 h1, h2, bit;
+    int     i;
+
+    bloom_hashes(key, key_len, &h1, &h2);
+    for (i = 0; i < CAPINDEX_BLOOM_HASHES; i++) {
+        bit = (h1 + i * h2) % CAPINDEX_BLOOM_BITS;
+        if (!(index->bloom[bit / 8] & (1 << (bit % 8))))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static size_t
+address_key(guint8 *key, const guint8 *addr, size_t addr_len)
+{
+    key[0] = KEY_ADDRESS;
+    memcpy(key + 1, addr, addr_len);
+    return 1 + addr_len;
+}
+
+static size_t
+port_key(guint8 *key, guint16 port)
+{
+    key[0] = KEY_PORT;
+    phton16(key + 1, port);
+    return 3;
+}
+
+void
+capindex_add_packet(capindex_t *index, const nstime_t *ts, int linktype,
+                    const guint8 *pd, guint32 caplen)
+{
+    capindex_summary_t summary;
+    guint8 key[17];
+    size_t addr_len;
+
+    if (nstime_is_unset(&index->first) || nstime_cmp(ts, &index->first) < 0)
+        index->first = *ts;
+    if (nstime_is_unset(&index->last) || nstime_cmp(ts, &index->last) > 0)
+        index->last = *ts;
+    index->packets++;
+
+    if (!capindex_summarize(linktype, pd, caplen, &summary))
+        return;
+
+    addr_len = summary.ip_version == 4 ? 4 : 16;
+    bloom_add(index, key, address_key(key, summary.src, addr_len));
+    bloom_add(index, key, address_key(key, summary.dst, addr_len));
+    if (summary.has_ports) {
+        bloom_add(index, key, port_key(key, summary.srcport));
+        bloom_add(index, key, port_key(key, summary.dstport));
+    }
+}
+
+gboolean
+capindex_may_have_address(const capindex_t *index, const guint8 *addr,
+                          size_t addr_len)
+{
+    guint8 key[17];
+
+    if (addr_len != 4 && addr_len != 16)
+        return TRUE;
+    return bloom_may_have(index, key, address_key(key, addr, addr_len));
+}
+
+gboolean
+capindex_may_have_port(const capindex_t *index, guint16 port)
+{
+    guint8 key[3];
+
+    return bloom_may_have(index, key, port_key(key, port));
+}
+
+static gchar *
+nstime_to_index_str(const nstime_t *ts)
+{
+    return ws_strdup_printf("%" PRId64 ".%09d", (gint64)ts->secs, ts->nsecs);
+}
+
+static gboolean
+index_str_to_nstime(const gchar *str, nstime_t *ts)
+{
+    gint64 secs;
+    int nsecs;
+
+    if (str == NULL || sscanf(str, "%" SCNd64 ".%d", &secs, &nsecs) != 2 ||
+        nsecs < 0 || nsecs >= 1000000000)
+        return FALSE;
+    ts->secs = (time_t)secs;
+    ts->nsecs = nsecs;
+    return TRUE;
+}
+
+gboolean
+capindex_write(const capindex_t *index, const char *capfile_name, char **err_msg)
+{
+    GKeyFile *key_file = g_key_file_new();
+    gchar    *index_name = g_strconcat(capfile_name, CAPINDEX_SUFFIX, NULL);
+    gchar    *str;
+    gchar    *data;
+    gsize     data_len;
+    GError   *error = NULL;
+    gboolean  ok;
+
+    g_key_file_set_integer(key_file, CAPINDEX_GROUP, "version", CAPINDEX_VERSION);
+    if (index->packets > 0) {
+        str = nstime_to_index_str(&index->first);
+        g_key_file_set_string(key_file, CAPINDEX_GROUP, "first", str);
+        g_free(str);
+        str = nstime_to_index_str(&index->last);
+        g_key_file_set_string(key_file, CAPINDEX_GROUP, "last", str);
+        g_free(str);
+    }
+    g_key_file_set_uint64(key_file, CAPINDEX_GROUP, "packets", index->packets);
+    str = g_base64_encode(index->bloom, sizeof(index->bloom));
+    g_key_file_set_string(key_file, CAPINDEX_GROUP, "bloom", str);
+    g_free(str);
+
+    data = g_key_file_to_data(key_file, &data_len, NULL);
+    ok = g_file_set_contents(index_name, data, data_len, &error);
+    if (!ok) {
+        *err_msg = g_strdup(error->message);
+        g_error_free(error);
+    }
+    g_free(data);
+    g_free(index_name);
+    g_key_file_free(key_file);
+    return ok;
+}
+
+static gboolean
+capindex_read_file(capindex_t *index, const char *index_name)
+{
+    GKeyFile *key_file = g_key_file_new();
+    gchar    *str;
+    guchar   *bloom;
+    gsize     bloom_len = 0;
+    gboolean  ok = FALSE;
+
+    capindex_init(index);
+    if (!g_key_file_load_from_file(key_file, index_name, G_KEY_FILE_NONE, NULL))
+        goto out;
+    if (g_key_file_get_integer(key_file, CAPINDEX_GROUP, "version", NULL) != CAPINDEX_VERSION)
+        goto out;
+
+    index->packets = g_key_file_get_uint64(key_file, CAPINDEX_GROUP, "packets", NULL);
+    if (index->packets > 0) {
+        str = g_key_file_get_string(key_file, CAPINDEX_GROUP, "first", NULL);
+        ok = index_str_to_nstime(str, &index->first);
+        g_free(str);
+        if (!ok)
+            goto out;
+        str = g_key_file_get_string(key_file, CAPINDEX_GROUP, "last", NULL);
+        ok = index_str_to_nstime(str, &index->last);
+        g_free(str);
+        if (!ok)
+            goto out;
+    }
+
+    str = g_key_file_get_string(key_file, CAPINDEX_GROUP, "bloom", NULL);
+    if (str == NULL) {
+        ok = FALSE;
+        goto out;
+    }
+    bloom = g_base64_decode(str, &bloom_len);
+    g_free(str);
+    ok = bloom_len == sizeof(index->bloom);
+    if (ok)
+        memcpy(index->bloom, bloom, sizeof(index->bloom));
+    g_free(bloom);
+
+out:
+    g_key_file_free(key_file);
+    return ok;
+}
+
+gboolean
+capindex_read(capindex_t *index, const char *capfile_name)
+{
+    gchar   *index_name = g_strconcat(capfile_name, CAPINDEX_SUFFIX, NULL);
+    gboolean ok = capindex_read_file(index, index_name);
+
+    g_free(index_name);
+    if (!ok && g_str_has_suffix(capfile_name, ".gz")) {
+        /* ring buffer files are indexed before they're compressed */
+        gchar *base = g_strndup(capfile_name, strlen(capfile_name) - 3);
+
+        index_name = g_strconcat(base, CAPINDEX_SUFFIX, NULL);
+        ok = capindex_read_file(index, index_name);
+        g_free(index_name);
+        g_free(base);
+    }
+    return ok;
+}
+
+void
+capindex_remove(const char *capfile_name)
+{
+    gchar *index_name = g_strconcat(capfile_name, CAPINDEX_SUFFIX, NULL);
+
+    ws_unlink(index_name);
+    g_free(index_name);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,112 @@
+/** @file
+ *
+ * Summaries of capture files, written next to ring buffer files so that
+ * the files that can't hold the packets being looked for can be skipped.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WRITECAP_CAPINDEX_H__
+#define __WRITECAP_CAPINDEX_H__
+
+#include <glib.h>
+
+#include <wsutil/nstime.h>
+
+/* Appended to a capture file's name to get its index file's name */
+#define CAPINDEX_SUFFIX ".idx"
+
+/*
+ * Bits in an index's Bloom filter. With CAPINDEX_BLOOM_HASHES hashes per
+ * key, a file with 10,000 distinct addresses and ports wrongly seems to
+ * have a given other one about 3% of the time.
+ */
+#define CAPINDEX_BLOOM_BITS     65536
+#define CAPINDEX_BLOOM_HASHES   4
+
+typedef struct {
+    nstime_t    first;          /**< time stamp of the earliest packet */
+    nstime_t    last;           /**< time stamp of the latest packet */
+    guint64     packets;
+    guint8      bloom[CAPINDEX_BLOOM_BITS / 8];  /**< IP addresses and TCP/UDP/SCTP ports */
+} capindex_t;
+
+/* What capindex_summarize() found in a packet */
+typedef struct {
+    int         ip_version;     /**< 4 or 6; 0 if it isn't an IP packet we understand */
+    guint8      src[16];
+    guint8      dst[16];
+    gboolean    has_ports;
+    guint16     srcport;
+    guint16     dstport;
+} capindex_summary_t;
+
+/** Start an empty index. */
+extern void
+capindex_init(capindex_t *index);
+
+/**
+ * Find the IP addresses and ports of a packet with the given LINKTYPE_
+ * (or DLT_) link-layer type. Ethernet, with or without VLAN tags, raw IP,
+ * Linux cooked captures and BSD loopback are understood.
+ * Returns FALSE if the packet isn't an IP packet we understand.
+ */
+extern gboolean
+capindex_summarize(int linktype, const guint8 *pd, guint32 caplen,
+                   capindex_summary_t *summary);
+
+/** Add a packet with the given time stamp to an index. */
+extern void
+capindex_add_packet(capindex_t *index, const nstime_t *ts, int linktype,
+                    const guint8 *pd, guint32 caplen);
+
+/**
+ * TRUE if a file with this index might have packets to or from the given
+ * IPv4 (addr_len 4) or IPv6 (addr_len 16) address.
+ */
+extern gboolean
+capindex_may_have_address(const capindex_t *index, const guint8 *addr,
+                          size_t addr_len);
+
+/** TRUE if a file with this index might have packets to or from the given port. */
+extern gboolean
+capindex_may_have_port(const capindex_t *index, guint16 port);
+
+/**
+ * Write the index for capture file capfile_name to capfile_name with
+ * CAPINDEX_SUFFIX appended. Returns FALSE, with an error message to be
+ * freed by the caller in *err_msg, on failure.
+ */
+extern gboolean
+capindex_write(const capindex_t *index, const char *capfile_name, char **err_msg);
+
+/**
+ * Read the index of capture file capfile_name, if it has one. For a file
+ * compressed after it was indexed, the index of the uncompressed name
+ * is used. Returns FALSE if there's no index or it can't be read.
+ */
+extern gboolean
+capindex_read(capindex_t *index, const char *capfile_name);
+
+/** Remove the index of capture file capfile_name, if it has one. */
+extern void
+capindex_remove(const char *capfile_name);
+
+#endif /* __WRITECAP_CAPINDEX_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
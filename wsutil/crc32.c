@@ -18,6 +18,14 @@
 #include <glib.h>
 #include <wsutil/crc32.h>
 
+#ifdef HAVE_SSE4_2
+#include "ws_cpuid.h"
+#include "crc32_int.h"
+
+/* -1 until the CPU has been checked for the crc32 instruction */
+static int crc32c_use_sse42 = -1;
+#endif
+
 #define CRC32_ACCUMULATE(c,d,table) (c=(c>>8)^(table)[(c^(d))&0xFF])
 
 /*****************************************************************/
@@ -368,11 +376,8 @@ crc32_ccitt_table_lookup (guchar pos)
 guint32
 crc32c_calculate(const void *buf, int len, guint32 crc)
 {
-	const guint8 *p = (const guint8 *)buf;
 	crc = CRC32C_SWAP(crc);
-	while (len-- > 0) {
-		CRC32C(crc, *p++);
-	}
+	crc = crc32c_calculate_no_swap(buf, len, crc);
 	return CRC32C_SWAP(crc);
 }
 
@@ -380,6 +385,14 @@ guint32
 crc32c_calculate_no_swap(const void *buf, int len, guint32 crc)
 {
 	const guint8 *p = (const guint8 *)buf;
+
+#ifdef HAVE_SSE4_2
+	if (crc32c_use_sse42 < 0)
+		crc32c_use_sse42 = ws_cpuid_sse42() ? 1 : 0;
+	if (crc32c_use_sse42 && len > 0)
+		return crc32c_sse42_no_swap(p, len, crc);
+#endif
+
 	while (len-- > 0) {
 		CRC32C(crc, *p++);
 	}
@@ -393,13 +406,51 @@ crc32_ccitt(const guint8 *buf, guint len)
 	return (crc32_ccitt_seed(buf, len, CRC32_CCITT_SEED));
 }
 
+/*
+ * crc32_ccitt_slice[k][i] is the CRC of byte i followed by k + 1 zero bytes,
+ * which lets crc32_ccitt_seed() fold in 4 bytes per step ("slicing-by-4")
+ * instead of 1. Derived from crc32_ccitt_table on first use.
+ */
+static guint32 crc32_ccitt_slice[3][256];
+
+static void
+crc32_ccitt_slice_init(void)
+{
+	static gsize initialized = 0;
+	guint32 c;
+	int i, k;
+
+	if (g_once_init_enter(&initialized)) {
+		for (i = 0; i < 256; i++) {
+			c = crc32_ccitt_table[i];
+			for (k = 0; k < 3; k++) {
+				c = (c >> 8) ^ crc32_ccitt_table[c & 0xFF];
+				crc32_ccitt_slice[k][i] = c;
+			}
+		}
+		g_once_init_leave(&initialized, 1);
+	}
+}
+
 guint32
 crc32_ccitt_seed(const guint8 *buf, guint len, guint32 seed)
 {
-	guint i;
+	guint i = 0;
 	guint32 crc32 = seed;
 
-	for (i = 0; i < len; i++)
+	if (len >= 16) {
+		crc32_ccitt_slice_init();
+		for (; len - i >= 4; i += 4) {
+			crc32 ^= (guint32)buf[i] | (guint32)buf[i + 1] << 8 |
+			    (guint32)buf[i + 2] << 16 | (guint32)buf[i + 3] << 24;
+			crc32 = crc32_ccitt_slice[2][crc32 & 0xFF] ^
+			    crc32_ccitt_slice[1][(crc32 >> 8) & 0xFF] ^
+			    crc32_ccitt_slice[0][(crc32 >> 16) & 0xFF] ^
+			    crc32_ccitt_table[crc32 >> 24];
+		}
+	}
+
+	for (; i < len; i++)
 		CRC32_ACCUMULATE(crc32, buf[i], crc32_ccitt_table);
 
 	return ( ~crc32 );
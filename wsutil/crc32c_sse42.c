@@ -0,0 +1,84 @@
+/* crc32c_sse42.c
+ * CRC32C using the SSE4.2 crc32 instruction
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_SSE4_2
+
+#include <string.h>
+
+#include <glib.h>
+#include <nmmintrin.h>
+
+#include "crc32_int.h"
+
+/*
+ * The crc32 instruction implements the reflected Castagnoli polynomial,
+ * i.e. exactly CRC32_ACCUMULATE() with crc32c_table, so this is a drop-in
+ * for the table loop in crc32c_calculate_no_swap(). Callers have already
+ * checked ws_cpuid_sse42().
+ */
+guint32
+crc32c_sse42_no_swap(const guint8 *buf, size_t len, guint32 crc)
+{
+	/* Get to a word boundary so the wide loads below are aligned */
+	while (len > 0 && ((gintptr)buf & 7) != 0) {
+		crc = _mm_crc32_u8(crc, *buf++);
+		len--;
+	}
+
+#if defined(__x86_64__) || defined(_M_X64)
+	{
+		guint64 crc64 = crc;
+		guint64 word;
+
+		while (len >= 8) {
+			memcpy(&word, buf, sizeof word);
+			crc64 = _mm_crc32_u64(crc64, word);
+			buf += 8;
+			len -= 8;
+		}
+		crc = (guint32)crc64;
+	}
+#endif
+
+	{
+		guint32 word;
+
+		while (len >= 4) {
+			memcpy(&word, buf, sizeof word);
+			crc = _mm_crc32_u32(crc, word);
+			buf += 4;
+			len -= 4;
+		}
+	}
+
+	while (len > 0) {
+		crc = _mm_crc32_u8(crc, *buf++);
+		len--;
+	}
+
+	return crc;
+}
+
+#endif /* HAVE_SSE4_2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
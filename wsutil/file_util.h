@@ -37,6 +37,14 @@ extern "C" {
 /* We set a larger IO Buffer size for the capture files */
 #define IO_BUF_SIZE (64 * 1024)
 
+/*
+ * dumpcap writes capture output through a still larger buffer, so that
+ * at high packet rates the per-block fwrite() calls are gathered into
+ * few large write() calls.  The buffer is flushed whenever dumpcap
+ * reports new packets to its parent, so readers don't see added latency.
+ */
+#define CAPTURE_IO_BUF_SIZE (1024 * 1024)
+
 /*
  * Visual C++ on Win32 systems doesn't define these.  (Old UNIX systems don't
  * define them either.)
@@ -14,10 +14,19 @@
 #include "json_dumper.h"
 #define WS_LOG_DOMAIN LOG_DOMAIN_WSUTIL
 
+#include <errno.h>
 #include <math.h>
+#include <string.h>
 
 #include <wsutil/wslog.h>
 
+/* SSE2 is part of the x86-64 baseline, so this needs no runtime check */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_DUMPER_SSE2
+#include <emmintrin.h>
+#include "bits_ctz.h"
+#endif
+
 /*
  * json_dumper.state[current_depth] describes a nested element:
  * - type: none/object/array/value
@@ -45,11 +54,229 @@ enum json_dumper_change {
     JSON_DUMPER_FINISH,
 };
 
+#define JSON_DUMPER_CBOR(dumper)    ((dumper)->flags & JSON_DUMPER_FLAGS_CBOR)
+
+/* CBOR major types (RFC 8949, section 3.1) */
+#define CBOR_TYPE_UINT          0
+#define CBOR_TYPE_NEGINT        1
+#define CBOR_TYPE_BYTES         2
+#define CBOR_TYPE_TEXT          3
+#define CBOR_TYPE_ARRAY         4
+#define CBOR_TYPE_MAP           5
+#define CBOR_TYPE_FLOAT         7
+
+#define CBOR_FALSE              0xf4
+#define CBOR_TRUE               0xf5
+#define CBOR_NULL               0xf6
+#define CBOR_FLOAT64            0xfb
+#define CBOR_INDEFINITE(type)   (((type) << 5) | 31)
+#define CBOR_BREAK              0xff
+
+static void
+jd_putc(const json_dumper *dumper, char c)
+{
+    if (dumper->output_string) {
+        g_string_append_c(dumper->output_string, c);
+    } else {
+        fputc(c, dumper->output_file);
+    }
+}
+
+static void
+jd_puts(const json_dumper *dumper, const char *s)
+{
+    if (dumper->output_string) {
+        g_string_append(dumper->output_string, s);
+    } else {
+        fputs(s, dumper->output_file);
+    }
+}
+
 static void
-json_puts_string(FILE *fp, const char *str, gboolean dot_to_underscore)
+jd_write(const json_dumper *dumper, const void *data, size_t len)
+{
+    if (dumper->output_string) {
+        g_string_append_len(dumper->output_string, (const gchar *)data, len);
+    } else {
+        fwrite(data, 1, len, dumper->output_file);
+    }
+}
+
+/**
+ * Writes a CBOR data item head: the major type and the argument (a value or
+ * a length) in the shortest form.
+ */
+static void
+cbor_put_head(const json_dumper *dumper, guint8 major_type, guint64 value)
+{
+    guint8 buf[9];
+    size_t len;
+
+    if (value < 24) {
+        buf[0] = (guint8)((major_type << 5) | value);
+        len = 1;
+    } else if (value <= G_MAXUINT8) {
+        buf[0] = (guint8)((major_type << 5) | 24);
+        buf[1] = (guint8)value;
+        len = 2;
+    } else if (value <= G_MAXUINT16) {
+        buf[0] = (guint8)((major_type << 5) | 25);
+        buf[1] = (guint8)(value >> 8);
+        buf[2] = (guint8)value;
+        len = 3;
+    } else if (value <= G_MAXUINT32) {
+        buf[0] = (guint8)((major_type << 5) | 26);
+        for (int i = 0; i < 4; i++) {
+            buf[1 + i] = (guint8)(value >> (24 - 8 * i));
+        }
+        len = 5;
+    } else {
+        buf[0] = (guint8)((major_type << 5) | 27);
+        for (int i = 0; i < 8; i++) {
+            buf[1 + i] = (guint8)(value >> (56 - 8 * i));
+        }
+        len = 9;
+    }
+    jd_write(dumper, buf, len);
+}
+
+static void
+cbor_put_text(const json_dumper *dumper, const char *str, size_t len, gboolean dot_to_underscore)
+{
+    cbor_put_head(dumper, CBOR_TYPE_TEXT, len);
+    if (!dot_to_underscore) {
+        jd_write(dumper, str, len);
+        return;
+    }
+    while (len > 0) {
+        const char *dot = (const char *)memchr(str, '.', len);
+        size_t run = dot ? (size_t)(dot - str) : len;
+
+        jd_write(dumper, str, run);
+        if (!dot) {
+            break;
+        }
+        jd_putc(dumper, '_');
+        str = dot + 1;
+        len -= run + 1;
+    }
+}
+
+static void
+cbor_put_double(const json_dumper *dumper, double value)
+{
+    guint8 buf[9];
+    guint64 bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    buf[0] = CBOR_FLOAT64;
+    for (int i = 0; i < 8; i++) {
+        buf[1 + i] = (guint8)(bits >> (56 - 8 * i));
+    }
+    jd_write(dumper, buf, sizeof(buf));
+}
+
+/**
+ * Encodes a literal JSON value (as passed to json_dumper_value_anyf) as the
+ * matching CBOR data item.
+ */
+static void
+cbor_put_literal(const json_dumper *dumper, const char *literal)
+{
+    size_t len = strlen(literal);
+    char *end;
+
+    if (!strcmp(literal, "true")) {
+        jd_putc(dumper, (char)CBOR_TRUE);
+    } else if (!strcmp(literal, "false")) {
+        jd_putc(dumper, (char)CBOR_FALSE);
+    } else if (!strcmp(literal, "null")) {
+        jd_putc(dumper, (char)CBOR_NULL);
+    } else if (len >= 2 && literal[0] == '"' && literal[len - 1] == '"') {
+        /* Already quoted string, the caller did not escape it either. */
+        cbor_put_text(dumper, literal + 1, len - 2, FALSE);
+    } else if (len == 0) {
+        jd_putc(dumper, (char)CBOR_NULL);
+    } else {
+        errno = 0;
+        if (literal[0] == '-') {
+            gint64 value = g_ascii_strtoll(literal, &end, 10);
+            if (*end == '\0' && errno == 0 && value < 0) {
+                cbor_put_head(dumper, CBOR_TYPE_NEGINT, (guint64)(-1 - value));
+                return;
+            }
+        } else {
+            guint64 value = g_ascii_strtoull(literal, &end, 10);
+            if (*end == '\0' && errno == 0) {
+                cbor_put_head(dumper, CBOR_TYPE_UINT, value);
+                return;
+            }
+        }
+        double dvalue = g_ascii_strtod(literal, &end);
+        if (*end == '\0') {
+            cbor_put_double(dumper, dvalue);
+        } else {
+            cbor_put_text(dumper, literal, len, FALSE);
+        }
+    }
+}
+
+/**
+ * Returns the number of bytes at the start of str that can be written to a
+ * JSON string as they are, that is up to the first control character, quote,
+ * backslash or slash (or dot, if those are converted to underscores).
+ */
+static size_t
+json_plain_run(const char *str, size_t len, gboolean dot_to_underscore)
+{
+    size_t i = 0;
+
+#ifdef JSON_DUMPER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i dot = _mm_set1_epi8(dot_to_underscore ? '.' : '"');
+    const __m128i cntrl_max = _mm_set1_epi8(0x1f);
+
+    while (len - i >= 16) {
+        __m128i data = _mm_loadu_si128((const __m128i *)(const void *)(str + i));
+        __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(data, quote), _mm_cmpeq_epi8(data, backslash)),
+                _mm_or_si128(_mm_cmpeq_epi8(data, slash), _mm_cmpeq_epi8(data, dot)));
+        /* Unsigned data <= 0x1f iff min(data, 0x1f) == data */
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(data, cntrl_max), data));
+        int mask = _mm_movemask_epi8(special);
+
+        if (mask) {
+            return i + ws_ctz(mask);
+        }
+        i += 16;
+    }
+#endif
+
+    for (; i < len; i++) {
+        guchar c = (guchar)str[i];
+        if (c < 0x20 || c == '"' || c == '\\' || c == '/' || (dot_to_underscore && c == '.')) {
+            break;
+        }
+    }
+    return i;
+}
+
+static void
+json_puts_string(const json_dumper *dumper, const char *str, gboolean dot_to_underscore)
 {
     if (!str) {
-        fputs("null", fp);
+        if (JSON_DUMPER_CBOR(dumper)) {
+            jd_putc(dumper, (char)CBOR_NULL);
+        } else {
+            jd_puts(dumper, "null");
+        }
+        return;
+    }
+
+    if (JSON_DUMPER_CBOR(dumper)) {
+        cbor_put_text(dumper, str, strlen(str), dot_to_underscore);
         return;
     }
 
@@ -58,25 +285,41 @@ json_puts_string(FILE *fp, const char *str, gboolean dot_to_underscore)
         "u0010", "u0011", "u0012", "u0013", "u0014", "u0015", "u0016", "u0017", "u0018", "u0019", "u001a", "u001b", "u001c", "u001d", "u001e", "u001f"
     };
 
-    fputc('"', fp);
-    for (int i = 0; str[i]; i++) {
+    size_t len = strlen(str);
+    size_t i = 0;
+
+    jd_putc(dumper, '"');
+    while (i < len) {
+        /* Copy everything up to the next special character in one go. */
+        size_t run = json_plain_run(str + i, len - i, dot_to_underscore);
+        if (run > 0) {
+            jd_write(dumper, str + i, run);
+            i += run;
+            if (i == len) {
+                break;
+            }
+        }
+
         if ((guint)str[i] < 0x20) {
-            fputc('\\', fp);
-            fputs(json_cntrl[(guint)str[i]], fp);
-        } else if (i > 0 && str[i - 1] == '<' && str[i] == '/') {
+            jd_putc(dumper, '\\');
+            jd_puts(dumper, json_cntrl[(guint)str[i]]);
+        } else if (str[i] == '/') {
             // Convert </script> to <\/script> to avoid breaking web pages.
-            fputs("\\/", fp);
-        } else {
-            if (str[i] == '\\' || str[i] == '"') {
-                fputc('\\', fp);
+            if (i > 0 && str[i - 1] == '<') {
+                jd_puts(dumper, "\\/");
+            } else {
+                jd_putc(dumper, '/');
             }
-            if (dot_to_underscore && str[i] == '.')
-                fputc('_', fp);
-            else
-                fputc(str[i], fp);
+        } else if (str[i] == '\\' || str[i] == '"') {
+            jd_putc(dumper, '\\');
+            jd_putc(dumper, str[i]);
+        } else {
+            /* A dot in a member name. */
+            jd_putc(dumper, '_');
         }
+        i++;
     }
-    fputc('"', fp);
+    jd_putc(dumper, '"');
 }
 
 /**
@@ -103,7 +346,9 @@ json_dumper_bad(json_dumper *dumper, enum json_dumper_change change,
         /* Console output can be slow, disable log calls to speed up fuzzing. */
         return;
     }
-    fflush(dumper->output_file);
+    if (dumper->output_file) {
+        fflush(dumper->output_file);
+    }
     ws_error("Bad json_dumper state: %s; change=%d type=%d depth=%d prev/curr/next state=%02x %02x %02x",
             what, change, type, dumper->current_depth, states[0], states[1], states[2]);
 }
@@ -172,10 +417,10 @@ json_dumper_check_state(json_dumper *dumper, enum json_dumper_change change, enu
 static void
 print_newline_indent(const json_dumper *dumper, int depth)
 {
-    if ((dumper->flags & JSON_DUMPER_FLAGS_PRETTY_PRINT)) {
-        fputc('\n', dumper->output_file);
+    if ((dumper->flags & JSON_DUMPER_FLAGS_PRETTY_PRINT) && !JSON_DUMPER_CBOR(dumper)) {
+        jd_putc(dumper, '\n');
         for (int i = 0; i < depth; i++) {
-            fputs("  ", dumper->output_file);
+            jd_puts(dumper, "  ");
         }
     }
 }
@@ -210,8 +455,13 @@ prepare_token(json_dumper *dumper)
             return;
     }
 
+    if (JSON_DUMPER_CBOR(dumper)) {
+        // CBOR items are self-delimiting.
+        return;
+    }
+
     if (dumper->state[dumper->current_depth]) {
-        fputc(',', dumper->output_file);
+        jd_putc(dumper, ',');
     }
     print_newline_indent(dumper, dumper->current_depth);
 }
@@ -223,11 +473,31 @@ prepare_token(json_dumper *dumper)
 static void
 finish_token(const json_dumper *dumper, char close_char)
 {
+    if (JSON_DUMPER_CBOR(dumper)) {
+        // Objects and arrays are open-ended, see begin_token().
+        jd_putc(dumper, (char)CBOR_BREAK);
+        return;
+    }
+
     // if the object/array was non-empty, add a newline and indentation.
     if (dumper->state[dumper->current_depth]) {
         print_newline_indent(dumper, dumper->current_depth - 1);
     }
-    fputc(close_char, dumper->output_file);
+    jd_putc(dumper, close_char);
+}
+
+/**
+ * Opens an object/array. CBOR output uses indefinite-length maps and arrays
+ * as the number of members is not known in advance.
+ */
+static void
+begin_token(const json_dumper *dumper, char open_char)
+{
+    if (JSON_DUMPER_CBOR(dumper)) {
+        jd_putc(dumper, (char)CBOR_INDEFINITE(open_char == '{' ? CBOR_TYPE_MAP : CBOR_TYPE_ARRAY));
+    } else {
+        jd_putc(dumper, open_char);
+    }
 }
 
 void
@@ -238,7 +508,7 @@ json_dumper_begin_object(json_dumper *dumper)
     }
 
     prepare_token(dumper);
-    fputc('{', dumper->output_file);
+    begin_token(dumper, '{');
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_OBJECT;
     ++dumper->current_depth;
@@ -253,10 +523,12 @@ json_dumper_set_member_name(json_dumper *dumper, const char *name)
     }
 
     prepare_token(dumper);
-    json_puts_string(dumper->output_file, name, dumper->flags & JSON_DUMPER_DOT_TO_UNDERSCORE);
-    fputc(':', dumper->output_file);
-    if ((dumper->flags & JSON_DUMPER_FLAGS_PRETTY_PRINT)) {
-        fputc(' ', dumper->output_file);
+    json_puts_string(dumper, name, dumper->flags & JSON_DUMPER_DOT_TO_UNDERSCORE);
+    if (!JSON_DUMPER_CBOR(dumper)) {
+        jd_putc(dumper, ':');
+        if ((dumper->flags & JSON_DUMPER_FLAGS_PRETTY_PRINT)) {
+            jd_putc(dumper, ' ');
+        }
     }
 
     dumper->state[dumper->current_depth - 1] |= JSON_DUMPER_HAS_NAME;
@@ -282,7 +554,7 @@ json_dumper_begin_array(json_dumper *dumper)
     }
 
     prepare_token(dumper);
-    fputc('[', dumper->output_file);
+    begin_token(dumper, '[');
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_ARRAY;
     ++dumper->current_depth;
@@ -309,7 +581,7 @@ json_dumper_value_string(json_dumper *dumper, const char *value)
     }
 
     prepare_token(dumper);
-    json_puts_string(dumper->output_file, value, FALSE);
+    json_puts_string(dumper, value, FALSE);
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
 }
@@ -323,10 +595,16 @@ json_dumper_value_double(json_dumper *dumper, double value)
 
     prepare_token(dumper);
     gchar buffer[G_ASCII_DTOSTR_BUF_SIZE] = { 0 };
-    if (isfinite(value) && g_ascii_dtostr(buffer, G_ASCII_DTOSTR_BUF_SIZE, value) && buffer[0]) {
-        fputs(buffer, dumper->output_file);
+    if (JSON_DUMPER_CBOR(dumper)) {
+        if (isfinite(value)) {
+            cbor_put_double(dumper, value);
+        } else {
+            jd_putc(dumper, (char)CBOR_NULL);
+        }
+    } else if (isfinite(value) && g_ascii_dtostr(buffer, G_ASCII_DTOSTR_BUF_SIZE, value) && buffer[0]) {
+        jd_puts(dumper, buffer);
     } else {
-        fputs("null", dumper->output_file);
+        jd_puts(dumper, "null");
     }
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
@@ -340,7 +618,15 @@ json_dumper_value_va_list(json_dumper *dumper, const char *format, va_list ap)
     }
 
     prepare_token(dumper);
-    vfprintf(dumper->output_file, format, ap);
+    if (JSON_DUMPER_CBOR(dumper)) {
+        char *literal = g_strdup_vprintf(format, ap);
+        cbor_put_literal(dumper, literal);
+        g_free(literal);
+    } else if (dumper->output_string) {
+        g_string_append_vprintf(dumper->output_string, format, ap);
+    } else {
+        vfprintf(dumper->output_file, format, ap);
+    }
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
 }
@@ -362,7 +648,9 @@ json_dumper_finish(json_dumper *dumper)
         return FALSE;
     }
 
-    fputc('\n', dumper->output_file);
+    if (!JSON_DUMPER_CBOR(dumper)) {
+        jd_putc(dumper, '\n');
+    }
     dumper->state[0] = 0;
     return TRUE;
 }
@@ -379,7 +667,12 @@ json_dumper_begin_base64(json_dumper *dumper)
 
     prepare_token(dumper);
 
-    fputc('"', dumper->output_file);
+    if (JSON_DUMPER_CBOR(dumper)) {
+        // Raw bytes, written as chunks of an indefinite-length byte string.
+        jd_putc(dumper, (char)CBOR_INDEFINITE(CBOR_TYPE_BYTES));
+    } else {
+        jd_putc(dumper, '"');
+    }
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_BASE64;
     ++dumper->current_depth;
@@ -393,13 +686,22 @@ json_dumper_write_base64(json_dumper* dumper, const guchar *data, size_t len)
         return;
     }
 
+    if (JSON_DUMPER_CBOR(dumper)) {
+        if (len > 0) {
+            cbor_put_head(dumper, CBOR_TYPE_BYTES, len);
+            jd_write(dumper, data, len);
+        }
+        dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_BASE64;
+        return;
+    }
+
     #define CHUNK_SIZE 1024
     gchar buf[(CHUNK_SIZE / 3 + 1) * 4 + 4];
 
     while (len > 0) {
         gsize chunk_size = len < CHUNK_SIZE ? len : CHUNK_SIZE;
         gsize output_size = g_base64_encode_step(data, chunk_size, FALSE, buf, &dumper->base64_state, &dumper->base64_save);
-        fwrite(buf, 1, output_size, dumper->output_file);
+        jd_write(dumper, buf, output_size);
         data += chunk_size;
         len -= chunk_size;
     }
@@ -414,13 +716,19 @@ json_dumper_end_base64(json_dumper *dumper)
         return;
     }
 
+    if (JSON_DUMPER_CBOR(dumper)) {
+        jd_putc(dumper, (char)CBOR_BREAK);
+        --dumper->current_depth;
+        return;
+    }
+
     gchar buf[4];
     gsize wrote;
 
     wrote = g_base64_encode_close(FALSE, buf, &dumper->base64_state, &dumper->base64_save);
-    fwrite(buf, 1, wrote, dumper->output_file);
+    jd_write(dumper, buf, wrote);
 
-    fputc('"', dumper->output_file);
+    jd_putc(dumper, '"');
 
     --dumper->current_depth;
 }
@@ -46,14 +46,23 @@ extern "C" {
  *  json_dumper_end_array(&dumper);
  *  json_dumper_end_object(&dumper);
  *  json_dumper_finish(&dumper);
+ *
+ * With JSON_DUMPER_FLAGS_CBOR the same calls produce the equivalent CBOR data
+ * item instead: objects and arrays become indefinite-length maps and arrays,
+ * values passed to json_dumper_value_anyf() are converted to CBOR numbers,
+ * booleans, null or text strings, and base64 data is written as a raw byte
+ * string. Pretty printing does not apply and json_dumper_finish() does not
+ * add a newline.
  */
 
 /** Maximum object/array nesting depth. */
 #define JSON_DUMPER_MAX_DEPTH   1100
 typedef struct json_dumper {
-    FILE   *output_file;    /**< Output file, must be set. */
+    FILE   *output_file;    /**< Output file, must be set unless output_string is. */
+    GString *output_string; /**< Output buffer, used instead of output_file if set. */
 #define JSON_DUMPER_FLAGS_PRETTY_PRINT  (1 << 0)    /* Enable pretty printing. */
 #define JSON_DUMPER_DOT_TO_UNDERSCORE   (1 << 1)    /* Convert dots to underscores in keys */
+#define JSON_DUMPER_FLAGS_CBOR          (1 << 2)    /* Write CBOR (RFC 8949) instead of JSON text */
     int     flags;
     /* for internal use, initialize with zeroes. */
     int     current_depth;
@@ -161,7 +161,12 @@ scan_plugins_dir(GHashTable *plugins_module, const char *dirpath, plugin_type_e
         }
 
         plugin_file = g_build_filename(plugin_folder, name, (gchar *)NULL);
-        handle = g_module_open(plugin_file, G_MODULE_BIND_LOCAL);
+        /*
+         * Bind lazily: most of a plugin's symbols are only used once it
+         * dissects something, and resolving them all up front makes
+         * startup slower the more plugins there are.
+         */
+        handle = g_module_open(plugin_file, G_MODULE_BIND_LOCAL | G_MODULE_BIND_LAZY);
         g_free(plugin_file);
         if (handle == NULL) {
             /* g_module_error() provides file path. */
@@ -10,13 +10,22 @@
 
 #include "regex.h"
 
+#include <string.h>
+
 #include <wsutil/ws_return.h>
+#include <wsutil/str_util.h>
 #include <pcre2.h>
 
 
 struct _ws_regex {
     pcre2_code *code;
     char *pattern;
+    /* A string that every match contains, or NULL. Subjects without it
+     * are rejected without running the regex. */
+    char *required;
+    size_t required_len;
+    /* The pattern matches exactly the required string. */
+    bool literal_only;
 };
 
 #define ERROR_MAXLEN_IN_CODE_UNITS   128
@@ -66,41 +75,217 @@ compile_pcre2(const char *patt, char **errmsg)
 }
 
 
+/*
+ * Finds the longest run of literal characters that every match of the
+ * pattern must contain, or returns FALSE if there isn't one we can be sure
+ * about. This only looks at the top level of the pattern and gives up on
+ * anything unusual: alternatives, inline options, escapes that take
+ * arguments. *literal_only is set if the whole pattern is that run.
+ */
+static bool
+find_required_literal(const char *patt, size_t *start, size_t *len,
+                        bool *literal_only)
+{
+    size_t i = 0;
+    size_t run_start = 0, run_len = 0;
+    size_t best_start = 0, best_len = 0;
+    int depth = 0;
+    bool all_literal = true;
+
+    if (strstr(patt, "(?") || strstr(patt, "(*"))
+        return false;
+
+#define END_RUN() \
+    do { \
+        if (run_len > best_len) { \
+            best_start = run_start; \
+            best_len = run_len; \
+        } \
+        run_len = 0; \
+    } while (0)
+
+    while (patt[i] != '\0') {
+        switch (patt[i]) {
+
+        case '\\':
+            /* Escaped punctuation and escapes without arguments only */
+            if (patt[i+1] == '\0' ||
+                    (g_ascii_isalnum(patt[i+1]) &&
+                     strchr("dDsSwWbBhHvVRXAzZGK", patt[i+1]) == NULL))
+                return false;
+            all_literal = false;
+            END_RUN();
+            i += 2;
+            break;
+
+        case '[':
+            all_literal = false;
+            END_RUN();
+            i++;
+            if (patt[i] == '^')
+                i++;
+            if (patt[i] == ']')
+                i++;
+            while (patt[i] != '\0' && patt[i] != ']') {
+                if (patt[i] == '\\' && patt[i+1] != '\0')
+                    i++;
+                i++;
+            }
+            if (patt[i] == '\0')
+                return false;
+            i++;
+            break;
+
+        case '(':
+        case ')':
+            all_literal = false;
+            END_RUN();
+            depth += patt[i] == '(' ? 1 : -1;
+            i++;
+            break;
+
+        case '|':
+            if (depth == 0)
+                return false;
+            i++;
+            break;
+
+        case '?':
+        case '*':
+        case '{':
+            /* The character before the quantifier may be absent */
+            all_literal = false;
+            if (run_len > 0)
+                run_len--;
+            END_RUN();
+            if (patt[i] == '{') {
+                while (patt[i] != '\0' && patt[i] != '}')
+                    i++;
+                if (patt[i] == '\0')
+                    return false;
+            }
+            i++;
+            break;
+
+        case '+':
+        case '^':
+        case '$':
+        case '.':
+        case ']':
+        case '}':
+            all_literal = false;
+            END_RUN();
+            i++;
+            break;
+
+        default:
+            if (depth == 0) {
+                if (run_len == 0)
+                    run_start = i;
+                run_len++;
+            }
+            i++;
+            break;
+        }
+    }
+    END_RUN();
+
+#undef END_RUN
+
+    if (best_len == 0)
+        return false;
+
+    *start = best_start;
+    *len = best_len;
+    *literal_only = all_literal && best_len == i;
+    return true;
+}
+
+
 ws_regex_t *
 ws_regex_compile(const char *patt, char **errmsg)
 {
+    size_t required_start, required_len;
+    bool literal_only;
+
     ws_return_val_if_null(patt, NULL);
 
     pcre2_code *code = compile_pcre2(patt, errmsg);
     if (code == NULL)
         return NULL;
 
+    /* Not all platforms support JIT; the interpreter is used then. */
+    pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+
     ws_regex_t *re = g_new(ws_regex_t, 1);
     re->code = code;
     re->pattern = g_strdup(patt);
+    if (find_required_literal(patt, &required_start, &required_len, &literal_only)) {
+        re->required = g_strndup(patt + required_start, required_len);
+        re->required_len = required_len;
+        re->literal_only = literal_only;
+    } else {
+        re->required = NULL;
+        re->required_len = 0;
+        re->literal_only = false;
+    }
     return re;
 }
 
 
+static void
+free_match_data(gpointer data)
+{
+    pcre2_match_data_free((pcre2_match_data *)data);
+}
+
+/*
+ * We don't use the matched substring but pcre2_match requires at least
+ * one pair of offsets. Creating them for every match is expensive, and
+ * they can't be shared between threads, so each thread keeps its own.
+ */
+static GPrivate match_data_key = G_PRIVATE_INIT(free_match_data);
+
+static pcre2_match_data *
+get_match_data(void)
+{
+    pcre2_match_data *match_data = (pcre2_match_data *)g_private_get(&match_data_key);
+
+    if (match_data == NULL) {
+        match_data = pcre2_match_data_create(1, NULL);
+        g_private_set(&match_data_key, match_data);
+    }
+    return match_data;
+}
+
+
 static bool
-match_pcre2(pcre2_code *code, PCRE2_SPTR subject, PCRE2_SIZE length)
+match_pcre2(const ws_regex_t *re, PCRE2_SPTR subject, PCRE2_SIZE length)
 {
-    pcre2_match_data *match_data;
     int rc;
 
-    /* We don't use the matched substring but pcre2_match requires
-     * at least one pair of offsets. */
-    match_data = pcre2_match_data_create(1, NULL);
+    if (re->required != NULL) {
+        if (length == PCRE2_ZERO_TERMINATED)
+            length = strlen((const char *)subject);
+        if (ws_memmem(subject, length, re->required, re->required_len) == NULL)
+            return FALSE;
+        if (re->literal_only)
+            return TRUE;
+    }
 
-    rc = pcre2_match(code,
+    rc = pcre2_match(re->code,
                     subject,
                     length,
                     0,          /* start at offset zero of the subject */
                     0,          /* default options */
-                    match_data,
+                    get_match_data(),
                     NULL);
 
-    pcre2_match_data_free(match_data);
+    if (rc == PCRE2_ERROR_JIT_STACKLIMIT) {
+        /* The interpreter has much larger limits */
+        rc = pcre2_match(re->code, subject, length, 0, PCRE2_NO_JIT,
+                        get_match_data(), NULL);
+    }
 
     if (rc < 0) {
         /* No match */
@@ -125,7 +310,7 @@ ws_regex_matches(const ws_regex_t *re, const char *subj)
     ws_return_val_if_null(re, FALSE);
     ws_return_val_if_null(subj, FALSE);
 
-    return match_pcre2(re->code, (PCRE2_SPTR)subj, PCRE2_ZERO_TERMINATED);
+    return match_pcre2(re, (PCRE2_SPTR)subj, PCRE2_ZERO_TERMINATED);
 }
 
 
@@ -136,7 +321,7 @@ ws_regex_matches_length(const ws_regex_t *re,
     ws_return_val_if_null(re, FALSE);
     ws_return_val_if_null(subj, FALSE);
 
-    return match_pcre2(re->code, (PCRE2_SPTR)subj, (PCRE2_SIZE)subj_length);
+    return match_pcre2(re, (PCRE2_SPTR)subj, (PCRE2_SIZE)subj_length);
 }
 
 
@@ -145,6 +330,7 @@ ws_regex_free(ws_regex_t *re)
 {
     pcre2_code_free(re->code);
     g_free(re->pattern);
+    g_free(re->required);
     g_free(re);
 }
 
@@ -338,10 +338,13 @@ ws_memmem(const void *_haystack, size_t haystack_len,
         return NULL;
     }
 
+    /* Let memchr() skip ahead to each candidate first byte */
     for (begin = haystack ; begin <= last_possible; ++begin) {
-        if (begin[0] == needle[0] &&
-                !memcmp(&begin[1], needle + 1,
-                    needle_len - 1)) {
+        begin = (const guint8 *)memchr(begin, needle[0], last_possible - begin + 1);
+        if (begin == NULL) {
+            break;
+        }
+        if (!memcmp(&begin[1], needle + 1, needle_len - 1)) {
             return begin;
         }
     }
@@ -0,0 +1,277 @@
+/* task_pool.c
+ * A process-wide pool of worker threads, and groups of tasks run on it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "task_pool.h"
+
+typedef enum {
+    TASK_PENDING,
+    TASK_RUNNING,
+    TASK_DONE
+} task_state_e;
+
+typedef struct {
+    task_group_t   *group;
+    gpointer        data;
+    task_state_e    state;
+    gboolean        ran;
+    guint           refs;           /* the group's queue, plus the pool's if pushed there */
+} task_t;
+
+struct _task_group {
+    task_func       func;
+    task_done_func  done;
+    gpointer        user_data;
+    GMutex          mutex;          /* protects everything below */
+    GCond           cond;           /* signalled when a task finishes or is added */
+    GQueue          tasks;          /* tasks not yet finished by the waiter, in order */
+    guint           refs;           /* the owner, plus each task in the pool */
+    gint            cancelled;      /* accessed atomically */
+};
+
+static GMutex pool_mutex;
+static GThreadPool *pool;
+static guint pool_max_threads;      /* 0 until set or first needed */
+
+void
+task_pool_set_max_threads(guint max_threads)
+{
+    if (max_threads == 0)
+        max_threads = g_get_num_processors();
+
+    g_mutex_lock(&pool_mutex);
+    pool_max_threads = max_threads;
+    if (pool)
+        g_thread_pool_set_max_threads(pool, (gint)max_threads, NULL);
+    g_mutex_unlock(&pool_mutex);
+}
+
+guint
+task_pool_get_max_threads(void)
+{
+    guint max_threads;
+
+    g_mutex_lock(&pool_mutex);
+    if (pool_max_threads == 0)
+        pool_max_threads = g_get_num_processors();
+    max_threads = pool_max_threads;
+    g_mutex_unlock(&pool_mutex);
+
+    return max_threads;
+}
+
+static void task_pool_worker(gpointer data, gpointer user_data);
+
+/* The pool, or NULL if the waiting threads are to do all the work. */
+static GThreadPool *
+task_pool_get(void)
+{
+    GThreadPool *ret = NULL;
+
+    g_mutex_lock(&pool_mutex);
+    if (pool_max_threads == 0)
+        pool_max_threads = g_get_num_processors();
+    if (pool_max_threads > 1) {
+        if (!pool)
+            pool = g_thread_pool_new(task_pool_worker, NULL,
+                                     (gint)pool_max_threads, FALSE, NULL);
+        ret = pool;
+    }
+    g_mutex_unlock(&pool_mutex);
+
+    return ret;
+}
+
+/* Called with the group's mutex held; it may free the task. */
+static void
+task_unref_locked(task_t *task)
+{
+    if (--task->refs == 0)
+        g_free(task);
+}
+
+/* Called with the group's mutex held, which is released. */
+static void
+task_group_unref_unlock(task_group_t *group)
+{
+    gboolean last = --group->refs == 0;
+
+    g_mutex_unlock(&group->mutex);
+    if (last) {
+        g_mutex_clear(&group->mutex);
+        g_cond_clear(&group->cond);
+        g_free(group);
+    }
+}
+
+/* Run a task we've marked as running; called with the group's mutex held. */
+static void
+task_run_locked(task_group_t *group, task_t *task)
+{
+    g_mutex_unlock(&group->mutex);
+    group->func(task->data, group->user_data);
+    g_mutex_lock(&group->mutex);
+
+    task->ran = TRUE;
+    task->state = TASK_DONE;
+    g_cond_broadcast(&group->cond);
+}
+
+static void
+task_pool_worker(gpointer data, gpointer user_data _U_)
+{
+    task_t *task = (task_t *)data;
+    task_group_t *group = task->group;
+
+    g_mutex_lock(&group->mutex);
+    /* The waiter may have run it already, or the group been cancelled */
+    if (task->state == TASK_PENDING) {
+        task->state = TASK_RUNNING;
+        task_run_locked(group, task);
+    }
+    task_unref_locked(task);
+    task_group_unref_unlock(group);
+}
+
+task_group_t *
+task_group_new(task_func func, task_done_func done, gpointer user_data)
+{
+    task_group_t *group = g_new0(task_group_t, 1);
+
+    group->func = func;
+    group->done = done;
+    group->user_data = user_data;
+    g_mutex_init(&group->mutex);
+    g_cond_init(&group->cond);
+    g_queue_init(&group->tasks);
+    group->refs = 1;
+
+    return group;
+}
+
+void
+task_group_push(task_group_t *group, gpointer data)
+{
+    task_t *task = g_new0(task_t, 1);
+    GThreadPool *task_pool = NULL;
+
+    task->group = group;
+    task->data = data;
+    task->refs = 1;
+
+    g_mutex_lock(&group->mutex);
+    if (g_atomic_int_get(&group->cancelled)) {
+        task->state = TASK_DONE;
+    } else {
+        task->state = TASK_PENDING;
+        task_pool = task_pool_get();
+        if (task_pool) {
+            task->refs++;
+            group->refs++;
+        }
+    }
+    g_queue_push_tail(&group->tasks, task);
+    g_cond_broadcast(&group->cond);
+    g_mutex_unlock(&group->mutex);
+
+    if (task_pool)
+        g_thread_pool_push(task_pool, task, NULL);
+}
+
+void
+task_group_cancel(task_group_t *group)
+{
+    GList *item;
+
+    g_mutex_lock(&group->mutex);
+    g_atomic_int_set(&group->cancelled, TRUE);
+    for (item = group->tasks.head; item; item = item->next) {
+        task_t *task = (task_t *)item->data;
+
+        if (task->state == TASK_PENDING)
+            task->state = TASK_DONE;
+    }
+    g_cond_broadcast(&group->cond);
+    g_mutex_unlock(&group->mutex);
+}
+
+gboolean
+task_group_is_cancelled(task_group_t *group)
+{
+    return g_atomic_int_get(&group->cancelled) ? TRUE : FALSE;
+}
+
+void
+task_group_wait(task_group_t *group)
+{
+    task_t *task;
+
+    g_mutex_lock(&group->mutex);
+    while ((task = (task_t *)g_queue_peek_head(&group->tasks)) != NULL) {
+        while (task->state != TASK_DONE) {
+            task_t *pending = NULL;
+            GList *item;
+
+            /*
+             * Rather than sit idle until the first task is done, run
+             * the first one nobody has started yet.
+             */
+            for (item = group->tasks.head; item; item = item->next) {
+                if (((task_t *)item->data)->state == TASK_PENDING) {
+                    pending = (task_t *)item->data;
+                    break;
+                }
+            }
+            if (pending) {
+                pending->state = TASK_RUNNING;
+                task_run_locked(group, pending);
+            } else {
+                g_cond_wait(&group->cond, &group->mutex);
+            }
+        }
+
+        g_queue_pop_head(&group->tasks);
+        if (group->done) {
+            g_mutex_unlock(&group->mutex);
+            group->done(task->data, task->ran, group->user_data);
+            g_mutex_lock(&group->mutex);
+        }
+        task_unref_locked(task);
+    }
+    g_mutex_unlock(&group->mutex);
+}
+
+void
+task_group_free(task_group_t *group)
+{
+    if (!group)
+        return;
+
+    task_group_cancel(group);
+    task_group_wait(group);
+
+    /* Tasks the waiter ran may still be waiting for a worker to drop them */
+    g_mutex_lock(&group->mutex);
+    task_group_unref_unlock(group);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,95 @@
+/** @file
+ * A process-wide pool of worker threads, and groups of tasks run on it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WSUTIL_TASK_POOL_H__
+#define __WSUTIL_TASK_POOL_H__
+
+#include "ws_symbol_export.h"
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Work that can be done in parallel is pushed, as tasks, to a task group.
+ * The tasks of every group share one pool of worker threads, whose size is
+ * set once for the whole program (the "protocols.worker_threads"
+ * preference, or --worker-threads), rather than each caller deciding on
+ * its own how many threads to start.
+ *
+ * Example:
+ *
+ *  group = task_group_new(decode_chunk, merge_chunk, &result);
+ *  for (i = 0; i < n_chunks; i++)
+ *      task_group_push(group, &chunks[i]);
+ *  task_group_wait(group);
+ *  task_group_free(group);
+ *
+ * decode_chunk() is called on a worker thread for each chunk, in no
+ * particular order; merge_chunk() is called on the waiting thread for each
+ * chunk, in the order they were pushed.
+ *
+ * A thread waiting for a group runs that group's tasks that haven't been
+ * started yet itself, so tasks can push to and wait for other groups
+ * without running out of worker threads.
+ */
+typedef struct _task_group task_group_t;
+
+/** Do one task. Called on a worker thread, or on the waiting thread. */
+typedef void (*task_func)(gpointer data, gpointer user_data);
+
+/**
+ * Finish one task. Called on the waiting thread, in the order the tasks
+ * were pushed; ran is FALSE if the group was cancelled before the task
+ * was started.
+ */
+typedef void (*task_done_func)(gpointer data, gboolean ran, gpointer user_data);
+
+/**
+ * Set the number of worker threads; 0 means one per processor, which is
+ * the default, and 1 means that tasks are run only by the waiting thread.
+ */
+WS_DLL_PUBLIC void task_pool_set_max_threads(guint max_threads);
+
+/** The number of worker threads tasks may use. */
+WS_DLL_PUBLIC guint task_pool_get_max_threads(void);
+
+/** Create a task group. done may be NULL. */
+WS_DLL_PUBLIC task_group_t *task_group_new(task_func func, task_done_func done,
+    gpointer user_data);
+
+/** Add a task; it may be started at once. Any thread may push tasks. */
+WS_DLL_PUBLIC void task_group_push(task_group_t *group, gpointer data);
+
+/**
+ * Don't start any more of the group's tasks. Tasks already running
+ * aren't interrupted, but they can check task_group_is_cancelled().
+ */
+WS_DLL_PUBLIC void task_group_cancel(task_group_t *group);
+
+/** TRUE if task_group_cancel() has been called for the group. */
+WS_DLL_PUBLIC gboolean task_group_is_cancelled(task_group_t *group);
+
+/**
+ * Wait for all the tasks pushed so far, including those pushed by the
+ * tasks themselves, calling the group's done function for each in turn.
+ */
+WS_DLL_PUBLIC void task_group_wait(task_group_t *group);
+
+/** Cancel the group, wait for its running tasks, and free it. */
+WS_DLL_PUBLIC void task_group_free(task_group_t *group);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WSUTIL_TASK_POOL_H__ */
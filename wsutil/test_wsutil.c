@@ -496,6 +496,113 @@ static void test_int64_to_str_back(void)
     g_assert_cmpstr(str, ==, "9223372036854775807");
 }
 
+static void test_bytes_to_hexstr(void)
+{
+    guint8 buf[41];
+    char str[sizeof(buf) * 2 + 1];
+    char expected[sizeof(buf) * 2 + 1];
+    char *end;
+    size_t i;
+
+    /* Long enough to cover both the vectorized and the bytewise path */
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = (guint8)(i * 37 + 5);
+        snprintf(&expected[i * 2], 3, "%02x", buf[i]);
+    }
+
+    end = bytes_to_hexstr(str, buf, sizeof(buf));
+    g_assert_true(end == str + sizeof(buf) * 2);
+    *end = '\0';
+    g_assert_cmpstr(str, ==, expected);
+}
+
+static void test_ip6_to_str(void)
+{
+    static const struct {
+        const char *in;
+        const char *out;
+    } tests[] = {
+        { "0:0:0:0:0:0:0:0", "::" },
+        { "0:0:0:0:0:0:0:1", "::1" },
+        { "1:0:0:0:0:0:0:0", "1::" },
+        { "2001:0db8:0000:0000:0000:0000:0000:0001", "2001:db8::1" },
+        { "2001:db8:0:0:1:0:0:1", "2001:db8::1:0:0:1" },
+        { "2001:0:0:1:0:0:0:1", "2001:0:0:1::1" },
+        { "2001:db8:0:1:1:1:1:1", "2001:db8:0:1:1:1:1:1" },
+        { "FE80:0:0:0:ABCD:0:0:0", "fe80::abcd:0:0:0" },
+        { "::ffff:192.0.2.1", "::ffff:192.0.2.1" },
+        { "::192.0.2.1", "::192.0.2.1" },
+        { "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff" },
+    };
+    ws_in6_addr addr;
+    char buf[WS_INET6_ADDRSTRLEN];
+    char small[12];
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(tests); i++) {
+        g_assert_true(ws_inet_pton6(tests[i].in, &addr));
+        ip6_to_str_buf(&addr, buf, sizeof(buf));
+        g_assert_cmpstr(buf, ==, tests[i].out);
+    }
+
+    /* A buffer too small for some addresses is fine for short ones */
+    ws_inet_pton6("2001:db8::1", &addr);
+    ip6_to_str_buf(&addr, small, sizeof(small));
+    g_assert_cmpstr(small, ==, "2001:db8::1");
+    ws_inet_pton6("2001:db8::1:2", &addr);
+    ip6_to_str_buf(&addr, small, sizeof(small));
+    g_assert_cmpstr(small, ==, "[Buffer too");
+}
+
+#define TO_STR_PERF_ROUNDS (1024 * 1024)
+
+static void test_to_str_perf(void)
+{
+    guint8 bytes[64];
+    char buf[sizeof(bytes) * 2 + 1];
+    ws_in6_addr addr;
+    double elapsed;
+    size_t i;
+
+    for (i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (guint8)g_random_int();
+    ws_inet_pton6("2001:db8:85a3::8a2e:370:7334", &addr);
+
+    g_test_timer_start();
+    for (i = 0; i < TO_STR_PERF_ROUNDS; i++)
+        guint32_to_str_buf((guint32)i * 2654435761U, buf, sizeof(buf));
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "guint32_to_str_buf: %.1f ns/call",
+                            elapsed * 1e9 / TO_STR_PERF_ROUNDS);
+
+    g_test_timer_start();
+    for (i = 0; i < TO_STR_PERF_ROUNDS; i++) {
+        bytes[0] = (guint8)i;
+        ip_to_str_buf(bytes, buf, sizeof(buf));
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "ip_to_str_buf: %.1f ns/call",
+                            elapsed * 1e9 / TO_STR_PERF_ROUNDS);
+
+    g_test_timer_start();
+    for (i = 0; i < TO_STR_PERF_ROUNDS; i++) {
+        addr.bytes[15] = (guint8)i;
+        ip6_to_str_buf(&addr, buf, sizeof(buf));
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "ip6_to_str_buf: %.1f ns/call",
+                            elapsed * 1e9 / TO_STR_PERF_ROUNDS);
+
+    g_test_timer_start();
+    for (i = 0; i < TO_STR_PERF_ROUNDS; i++) {
+        bytes[0] = (guint8)i;
+        *bytes_to_hexstr(buf, bytes, sizeof(bytes)) = '\0';
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "bytes_to_hexstr: %.3f MB/s",
+                            sizeof(bytes) * (double)TO_STR_PERF_ROUNDS / elapsed / 1e6);
+}
+
 #include "nstime.h"
 #include "time_util.h"
 
@@ -561,6 +668,194 @@ void test_nstime_from_iso8601(void)
     g_assert_cmpint(result.nsecs, ==, expect.nsecs);
 }
 
+#include "crc32.h"
+
+#define CRC_CHECK_STRING "123456789"
+
+/* Byte-at-a-time references built on the exported tables */
+static guint32 crc32c_bytewise(const guint8 *buf, size_t len, guint32 crc)
+{
+    while (len-- > 0)
+        crc = (crc >> 8) ^ crc32c_table_lookup((guchar)(crc ^ *buf++));
+    return crc;
+}
+
+static guint32 crc32_ccitt_bytewise(const guint8 *buf, size_t len, guint32 crc)
+{
+    while (len-- > 0)
+        crc = (crc >> 8) ^ crc32_ccitt_table_lookup((guchar)(crc ^ *buf++));
+    return ~crc;
+}
+
+static void test_crc32c(void)
+{
+    guint8 buf[300];
+    size_t i, len, align;
+
+    g_assert_cmphex(crc32c_calculate_no_swap(CRC_CHECK_STRING, 9, CRC32C_PRELOAD) ^ 0xFFFFFFFF,
+                    ==, 0xE3069283);
+
+    for (i = 0; i < sizeof buf; i++)
+        buf[i] = (guint8)g_random_int();
+
+    /* Cover the unaligned head and the word/byte tails of the fast paths */
+    for (align = 0; align < 8; align++) {
+        for (len = 0; len + align <= sizeof buf; len++) {
+            g_assert_cmphex(crc32c_calculate_no_swap(buf + align, (int)len, 0x12345678),
+                            ==, crc32c_bytewise(buf + align, len, 0x12345678));
+        }
+    }
+}
+
+static void test_crc32_ccitt(void)
+{
+    guint8 buf[300];
+    size_t i, len, align;
+
+    g_assert_cmphex(crc32_ccitt((const guint8 *)CRC_CHECK_STRING, 9), ==, 0xCBF43926);
+
+    for (i = 0; i < sizeof buf; i++)
+        buf[i] = (guint8)g_random_int();
+
+    for (align = 0; align < 4; align++) {
+        for (len = 0; len + align <= sizeof buf; len++) {
+            g_assert_cmphex(crc32_ccitt_seed(buf + align, (guint)len, CRC32_CCITT_SEED),
+                            ==, crc32_ccitt_bytewise(buf + align, len, CRC32_CCITT_SEED));
+        }
+    }
+}
+
+#define CRC_PERF_LEN    1500
+#define CRC_PERF_ROUNDS (64 * 1024)
+
+static void test_crc32_perf(void)
+{
+    guint8 buf[CRC_PERF_LEN];
+    volatile guint32 sink = 0;
+    double elapsed;
+    size_t i;
+
+    for (i = 0; i < sizeof buf; i++)
+        buf[i] = (guint8)g_random_int();
+
+    g_test_timer_start();
+    for (i = 0; i < CRC_PERF_ROUNDS; i++)
+        sink ^= crc32c_bytewise(buf, sizeof buf, CRC32C_PRELOAD);
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "crc32c bytewise: %.3f MB/s",
+                            CRC_PERF_LEN * (double)CRC_PERF_ROUNDS / elapsed / 1e6);
+
+    g_test_timer_start();
+    for (i = 0; i < CRC_PERF_ROUNDS; i++)
+        sink ^= crc32c_calculate_no_swap(buf, sizeof buf, CRC32C_PRELOAD);
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "crc32c_calculate_no_swap: %.3f MB/s",
+                            CRC_PERF_LEN * (double)CRC_PERF_ROUNDS / elapsed / 1e6);
+
+    g_test_timer_start();
+    for (i = 0; i < CRC_PERF_ROUNDS; i++)
+        sink ^= crc32_ccitt_bytewise(buf, sizeof buf, CRC32_CCITT_SEED);
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "crc32 ccitt bytewise: %.3f MB/s",
+                            CRC_PERF_LEN * (double)CRC_PERF_ROUNDS / elapsed / 1e6);
+
+    g_test_timer_start();
+    for (i = 0; i < CRC_PERF_ROUNDS; i++)
+        sink ^= crc32_ccitt_seed(buf, sizeof buf, CRC32_CCITT_SEED);
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "crc32_ccitt_seed: %.3f MB/s",
+                            CRC_PERF_LEN * (double)CRC_PERF_ROUNDS / elapsed / 1e6);
+
+    (void)sink;
+}
+
+#include "regex.h"
+
+static void test_regex_matches(void)
+{
+    /* Patterns with and without a required literal, which is checked
+     * before the regex is run */
+    static const struct {
+        const char *pattern;
+        const char *subject;
+        bool matches;
+    } tests[] = {
+        { "hello", "say hello world", true },
+        { "hello", "say hell world", false },
+        { "foo.bar", "foo-bar", true },
+        { "foo.bar", "fo-bar", false },
+        { "abc*d", "abd", true },
+        { "abc*d", "acd", false },
+        { "ab{0,2}x", "ax", true },
+        { "(foo|bar)baz", "barbaz", true },
+        { "foo|bar", "bar", true },
+        { "^GET /", "GET /index.html", true },
+        { "^GET /", "POST /", false },
+        { "x(?i)abc", "xABC", true },
+        { "a\\.com$", "example.a.com", true },
+        { "a\\.com$", "example.a.company", false },
+    };
+    ws_regex_t *re;
+    char *errmsg = NULL;
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(tests); i++) {
+        re = ws_regex_compile(tests[i].pattern, &errmsg);
+        g_assert_nonnull(re);
+        g_assert_true(ws_regex_matches(re, tests[i].subject) == tests[i].matches);
+        g_assert_true(ws_regex_matches_length(re, tests[i].subject,
+                        strlen(tests[i].subject)) == tests[i].matches);
+        ws_regex_free(re);
+    }
+}
+
+#include "json_dumper.h"
+
+static char *json_string(const char *str, int flags, gboolean as_name)
+{
+    json_dumper dumper = {
+        .output_string = g_string_new(NULL),
+        .flags = flags,
+    };
+
+    if (as_name) {
+        json_dumper_begin_object(&dumper);
+        json_dumper_set_member_name(&dumper, str);
+        json_dumper_value_anyf(&dumper, "0");
+        json_dumper_end_object(&dumper);
+    } else {
+        json_dumper_value_string(&dumper, str);
+    }
+    g_assert_true(json_dumper_finish(&dumper));
+    return g_string_free(dumper.output_string, FALSE);
+}
+
+static void test_json_dumper_string(void)
+{
+    char *str;
+
+    str = json_string("plain", 0, FALSE);
+    g_assert_cmpstr(str, ==, "\"plain\"\n");
+    g_free(str);
+
+    str = json_string("a\"b\\c\td\x01</script>/x\xc3\xa9", 0, FALSE);
+    g_assert_cmpstr(str, ==, "\"a\\\"b\\\\c\\td\\u0001<\\/script>/x\xc3\xa9\"\n");
+    g_free(str);
+
+    /* Longer than one vector, special characters at and across the edges */
+    str = json_string("0123456789abcde\"0123456789abcdef0123456789abcde.\n", 0, FALSE);
+    g_assert_cmpstr(str, ==, "\"0123456789abcde\\\"0123456789abcdef0123456789abcde.\\n\"\n");
+    g_free(str);
+
+    str = json_string("ip.src.0123456789abcdef", JSON_DUMPER_DOT_TO_UNDERSCORE, TRUE);
+    g_assert_cmpstr(str, ==, "{\"ip_src_0123456789abcdef\":0}\n");
+    g_free(str);
+
+    str = json_string("ip.src", 0, TRUE);
+    g_assert_cmpstr(str, ==, "{\"ip.src\":0}\n");
+    g_free(str);
+}
+
 #include "ws_getopt.h"
 
 #define ARGV_MAX 31
@@ -768,9 +1063,24 @@ int main(int argc, char **argv)
     g_test_add_func("/to_str/uint64_to_str_back_len", test_uint64_to_str_back_len);
     g_test_add_func("/to_str/int_to_str_back", test_int_to_str_back);
     g_test_add_func("/to_str/int64_to_str_back", test_int64_to_str_back);
+    g_test_add_func("/to_str/bytes_to_hexstr", test_bytes_to_hexstr);
+    g_test_add_func("/to_str/ip6_to_str", test_ip6_to_str);
+    if (g_test_perf()) {
+        g_test_add_func("/to_str/perf", test_to_str_perf);
+    }
 
     g_test_add_func("/nstime/from_iso8601", test_nstime_from_iso8601);
 
+    g_test_add_func("/crc32/crc32c", test_crc32c);
+    g_test_add_func("/crc32/ccitt", test_crc32_ccitt);
+    if (g_test_perf()) {
+        g_test_add_func("/crc32/perf", test_crc32_perf);
+    }
+
+    g_test_add_func("/regex/matches", test_regex_matches);
+
+    g_test_add_func("/json_dumper/string", test_json_dumper_string);
+
     g_test_add_func("/ws_getopt/basic1", test_getopt_long_basic1);
     g_test_add_func("/ws_getopt/basic2", test_getopt_long_basic2);
     g_test_add_func("/ws_getopt/optional1", test_getopt_optional_argument1);
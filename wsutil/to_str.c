@@ -23,6 +23,12 @@
 #include <wsutil/pint.h>
 #include <wsutil/ws_return.h>
 
+/* SSE2 is part of the x86-64 baseline, so this needs no runtime check */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TO_STR_SSE2
+#include <emmintrin.h>
+#endif
+
 /*
  * If a user _does_ pass in a too-small buffer, this is probably
  * going to be too long to fit.  However, even a partial string
@@ -177,11 +183,38 @@ qword_to_hex_punct(char *out, guint64 qword, char punct)
 char *
 bytes_to_hexstr(char *out, const guint8 *ad, size_t len)
 {
-	size_t i;
+	size_t i = 0;
 
 	ws_return_val_if_null(ad, NULL);
 
-	for (i = 0; i < len; i++)
+#ifdef TO_STR_SSE2
+	/*
+	 * Split 16 bytes into nibbles, interleave the high and low nibbles
+	 * and turn them into digits: '0' + n, plus 'a' - '0' - 10 if n > 9.
+	 */
+	const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i zero_char = _mm_set1_epi8('0');
+	const __m128i letter_offset = _mm_set1_epi8('a' - '0' - 10);
+
+	for (; len - i >= 16; i += 16) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(const void *)(ad + i));
+		__m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask);
+		__m128i low = _mm_and_si128(bytes, nibble_mask);
+		__m128i first = _mm_unpacklo_epi8(high, low);
+		__m128i second = _mm_unpackhi_epi8(high, low);
+
+		first = _mm_add_epi8(_mm_add_epi8(first, zero_char),
+		                     _mm_and_si128(_mm_cmpgt_epi8(first, nine), letter_offset));
+		second = _mm_add_epi8(_mm_add_epi8(second, zero_char),
+		                      _mm_and_si128(_mm_cmpgt_epi8(second, nine), letter_offset));
+		_mm_storeu_si128((__m128i *)(void *)out, first);
+		_mm_storeu_si128((__m128i *)(void *)(out + 16), second);
+		out += 32;
+	}
+#endif
+
+	for (; i < len; i++)
 		out = byte_to_hex(out, ad[i]);
 	return out;
 }
@@ -560,13 +593,10 @@ guint64_to_str_buf(guint64 u, gchar *buf, size_t buf_len)
    This function is very fast and this function is called a lot.
    XXX update the address_to_str stuff to use this function.
    */
-void
-ip_to_str_buf(const guint8 *ad, gchar *buf, const int buf_len)
+static char *
+ip_to_str_fast(const guint8 *ad, char *b)
 {
 	register gchar const *p;
-	register gchar *b=buf;
-
-	_return_if_nospace(WS_INET_ADDRSTRLEN, buf, buf_len);
 
 	p=fast_strings[*ad++];
 	do {
@@ -594,7 +624,15 @@ ip_to_str_buf(const guint8 *ad, gchar *buf, const int buf_len)
 		*b++=*p;
 		p++;
 	} while(*p);
-	*b=0;
+	return b;
+}
+
+void
+ip_to_str_buf(const guint8 *ad, gchar *buf, const int buf_len)
+{
+	_return_if_nospace(WS_INET_ADDRSTRLEN, buf, buf_len);
+
+	*ip_to_str_fast(ad, buf) = '\0';
 }
 
 char *ip_to_str(wmem_allocator_t *scope, const guint8 *ad)
@@ -606,22 +644,81 @@ char *ip_to_str(wmem_allocator_t *scope, const guint8 *ad)
 	return buf;
 }
 
+/*
+ * Formats an IPv6 address as RFC 5952 recommends: lowercase hex without
+ * leading zeroes, and the longest run of two or more zero groups (the
+ * first one if there's a tie) replaced with "::". IPv4-mapped and
+ * IPv4-compatible addresses end in dotted decimal. This is what GNU libc's
+ * inet_ntop() does, without its bounds checking and error handling.
+ */
+static char *
+ip6_to_str_fast(const ws_in6_addr *addr, char *b)
+{
+	guint16 words[8];
+	int best_base = -1, best_len = 0;
+	int cur_base = -1, cur_len = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		words[i] = pntoh16(&addr->bytes[i * 2]);
+		if (words[i] == 0) {
+			if (cur_base == -1) {
+				cur_base = i;
+				cur_len = 0;
+			}
+			cur_len++;
+			if (cur_len > best_len) {
+				best_base = cur_base;
+				best_len = cur_len;
+			}
+		} else {
+			cur_base = -1;
+		}
+	}
+	if (best_len < 2)
+		best_base = -1;
+
+	for (i = 0; i < 8; i++) {
+		if (best_base != -1 && i >= best_base && i < best_base + best_len) {
+			if (i == best_base)
+				*b++ = ':';
+			continue;
+		}
+		if (i != 0)
+			*b++ = ':';
+		if (i == 6 && best_base == 0 &&
+		    (best_len == 6 || (best_len == 5 && words[5] == 0xffff)))
+			return ip_to_str_fast(&addr->bytes[12], b);
+		b = word_to_hex_npad(b, words[i]);
+	}
+	if (best_base != -1 && best_base + best_len == 8)
+		*b++ = ':';
+	return b;
+}
+
 void
 ip6_to_str_buf(const ws_in6_addr *addr, gchar *buf, size_t buf_size)
 {
-	/*
-	 * If there is not enough space then ws_inet_ntop6() will leave
-	 * an error message in the buffer, we don't need
-	 * to use _return_if_nospace().
-	 */
-	ws_inet_ntop6(addr, buf, (guint)buf_size);
+	gchar tmp[WS_INET6_ADDRSTRLEN];
+	size_t len;
+
+	if (buf_size >= WS_INET6_ADDRSTRLEN) {
+		*ip6_to_str_fast(addr, buf) = '\0';
+		return;
+	}
+
+	/* Most addresses are much shorter than the longest possible one */
+	len = ip6_to_str_fast(addr, tmp) - tmp;
+	_return_if_nospace(len + 1, buf, buf_size);
+	memcpy(buf, tmp, len);
+	buf[len] = '\0';
 }
 
 char *ip6_to_str(wmem_allocator_t *scope, const ws_in6_addr *ad)
 {
 	char *buf = wmem_alloc(scope, WS_INET6_ADDRSTRLEN * sizeof(char));
 
-	ws_inet_ntop6(ad, buf, WS_INET6_ADDRSTRLEN);
+	*ip6_to_str_fast(ad, buf) = '\0';
 
 	return buf;
 }
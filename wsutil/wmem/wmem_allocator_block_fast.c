@@ -63,6 +63,12 @@ typedef struct _wmem_block_fast_jumbo {
 typedef struct {
     wmem_block_fast_hdr_t   *block_list;
     wmem_block_fast_jumbo_t *jumbo_list;
+
+    /* Bytes handed out since the last free_all; free is a no-op, so
+     * this only ever grows until then. */
+    size_t                   bytes_live;
+    size_t                   bytes_peak;
+    guint64                  allocs;
 } wmem_block_fast_allocator_t;
 
 /* Creates a new block, and initializes it. */
@@ -89,6 +95,12 @@ wmem_block_fast_alloc(void *private_data, const size_t size)
     wmem_block_fast_chunk_t     *chunk;
     gint32 real_size;
 
+    allocator->allocs++;
+    allocator->bytes_live += size;
+    if (allocator->bytes_live > allocator->bytes_peak) {
+        allocator->bytes_peak = allocator->bytes_live;
+    }
+
     if (size > WMEM_BLOCK_MAX_ALLOC_SIZE) {
         wmem_block_fast_jumbo_t *block;
 
@@ -141,6 +153,13 @@ wmem_block_fast_realloc(void *private_data, void *ptr, const size_t size)
         wmem_block_fast_jumbo_t *block;
 
         block = ((wmem_block_fast_jumbo_t*)((guint8*)(chunk) - WMEM_JUMBO_HEADER_SIZE));
+        {
+            wmem_block_fast_allocator_t *allocator = (wmem_block_fast_allocator_t*) private_data;
+            allocator->bytes_live += size;
+            if (allocator->bytes_live > allocator->bytes_peak) {
+                allocator->bytes_peak = allocator->bytes_live;
+            }
+        }
         block =  (wmem_block_fast_jumbo_t*)wmem_realloc(NULL, block,
                 size + WMEM_JUMBO_HEADER_SIZE + WMEM_CHUNK_HEADER_SIZE);
         if (block->prev) {
@@ -202,6 +221,8 @@ wmem_block_fast_free_all(void *private_data)
         cur_jum = nxt_jum;
     }
     allocator->jumbo_list = NULL;
+
+    allocator->bytes_live = 0;
 }
 
 static void
@@ -242,6 +263,29 @@ wmem_block_fast_allocator_init(wmem_allocator_t *allocator)
 
     block_allocator->block_list = NULL;
     block_allocator->jumbo_list = NULL;
+    block_allocator->bytes_live = 0;
+    block_allocator->bytes_peak = 0;
+    block_allocator->allocs     = 0;
+}
+
+gboolean
+wmem_block_fast_get_stats(wmem_allocator_t *allocator, wmem_allocator_stats_t *stats)
+{
+    wmem_block_fast_allocator_t *block_allocator;
+
+    if (allocator->type != WMEM_ALLOCATOR_BLOCK_FAST) {
+        return FALSE;
+    }
+
+    block_allocator = (wmem_block_fast_allocator_t*) allocator->private_data;
+
+    /* No size classes; only the totals are kept. */
+    memset(stats, 0, sizeof(*stats));
+    stats->bytes_live = block_allocator->bytes_live;
+    stats->bytes_peak = block_allocator->bytes_peak;
+    stats->allocs     = block_allocator->allocs;
+
+    return TRUE;
 }
 
 /*
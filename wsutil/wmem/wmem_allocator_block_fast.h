@@ -21,6 +21,9 @@ extern "C" {
 void
 wmem_block_fast_allocator_init(wmem_allocator_t *allocator);
 
+gboolean
+wmem_block_fast_get_stats(wmem_allocator_t *allocator, wmem_allocator_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,414 @@
+/* wmem_allocator_slab.c
+ * Wireshark Memory Manager Slab Allocator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wmem-int.h"
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_allocator_slab.h"
+
+/* The slab allocator serves every request of up to WMEM_SLAB_MAX_CHUNK bytes
+ * from one of a fixed set of size classes. Each class carves fixed-size
+ * chunks out of 64 KiB blocks and keeps freed chunks on its own free list,
+ * so allocation and free are both O(1) and never search or coalesce.
+ *
+ * Every chunk has a small header that holds the index of its size class
+ * while it is in use, and the free list link while it is not. Larger
+ * requests are "jumbo" allocations taken straight from the system allocator
+ * and tracked on a doubly-linked list so free_all can release them.
+ *
+ * free_all keeps the blocks around for reuse by any class; gc returns them
+ * to the system. */
+
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (gsize))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+#define WMEM_SLAB_BLOCK_SIZE (64 * 1024)
+
+/* Usable bytes of each size class. All are multiples of WMEM_ALIGN_AMOUNT. */
+static const size_t wmem_slab_class_size[] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 2048
+};
+
+#define WMEM_SLAB_NUM_CLASSES G_N_ELEMENTS(wmem_slab_class_size)
+#define WMEM_SLAB_MAX_CHUNK   2048
+#define WMEM_SLAB_JUMBO       WMEM_SLAB_NUM_CLASSES
+
+/* Map a request size, in units of 16 bytes (rounded up), to its class */
+#define WMEM_SLAB_LOOKUP_SHIFT 4
+#define WMEM_SLAB_LOOKUP_LEN   ((WMEM_SLAB_MAX_CHUNK >> WMEM_SLAB_LOOKUP_SHIFT) + 1)
+
+typedef union _wmem_slab_chunk_t {
+    union _wmem_slab_chunk_t *next_free;  /* while on a free list */
+    guint                     size_class; /* while in use */
+} wmem_slab_chunk_t;
+
+#define WMEM_SLAB_CHUNK_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_chunk_t))
+
+#define WMEM_SLAB_CHUNK_TO_DATA(CHUNK) \
+    ((void*)((guint8*)(CHUNK) + WMEM_SLAB_CHUNK_HEADER_SIZE))
+#define WMEM_SLAB_DATA_TO_CHUNK(DATA) \
+    ((wmem_slab_chunk_t*)((guint8*)(DATA) - WMEM_SLAB_CHUNK_HEADER_SIZE))
+
+typedef struct _wmem_slab_block_t {
+    struct _wmem_slab_block_t *next;
+} wmem_slab_block_t;
+
+#define WMEM_SLAB_BLOCK_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_block_t))
+
+typedef struct _wmem_slab_jumbo_t {
+    struct _wmem_slab_jumbo_t *prev, *next;
+    size_t                     size;
+} wmem_slab_jumbo_t;
+
+#define WMEM_SLAB_JUMBO_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_jumbo_t))
+
+#define WMEM_SLAB_JUMBO_TO_CHUNK(JUMBO) \
+    ((wmem_slab_chunk_t*)((guint8*)(JUMBO) + WMEM_SLAB_JUMBO_HEADER_SIZE))
+#define WMEM_SLAB_CHUNK_TO_JUMBO(CHUNK) \
+    ((wmem_slab_jumbo_t*)((guint8*)(CHUNK) - WMEM_SLAB_JUMBO_HEADER_SIZE))
+
+typedef struct _wmem_slab_class_t {
+    wmem_slab_chunk_t *free_list;
+    guint8            *cur;   /* next uncarved chunk in the current block */
+    guint8            *end;   /* end of the current block */
+} wmem_slab_class_t;
+
+typedef struct _wmem_slab_allocator_t {
+    wmem_slab_class_t  classes[WMEM_SLAB_NUM_CLASSES];
+    guint8             lookup[WMEM_SLAB_LOOKUP_LEN];
+    wmem_slab_block_t *blocks;        /* blocks holding chunks */
+    wmem_slab_block_t *spare_blocks;  /* blocks released by free_all */
+    wmem_slab_jumbo_t *jumbo_list;
+
+    /* statistics */
+    size_t             bytes_live;
+    size_t             bytes_peak;
+    guint64            allocs;
+    guint64            class_allocs[WMEM_SLAB_NUM_CLASSES + 1];
+} wmem_slab_allocator_t;
+
+static void
+wmem_slab_account_alloc(wmem_slab_allocator_t *allocator, guint size_class,
+        size_t size)
+{
+    allocator->bytes_live += size;
+    if (allocator->bytes_live > allocator->bytes_peak) {
+        allocator->bytes_peak = allocator->bytes_live;
+    }
+    allocator->allocs++;
+    allocator->class_allocs[size_class]++;
+}
+
+static wmem_slab_block_t *
+wmem_slab_new_block(wmem_slab_allocator_t *allocator)
+{
+    wmem_slab_block_t *block;
+
+    if (allocator->spare_blocks) {
+        block = allocator->spare_blocks;
+        allocator->spare_blocks = block->next;
+    }
+    else {
+        block = (wmem_slab_block_t *)wmem_alloc(NULL, WMEM_SLAB_BLOCK_SIZE);
+    }
+
+    block->next = allocator->blocks;
+    allocator->blocks = block;
+
+    return block;
+}
+
+static void *
+wmem_slab_alloc_jumbo(wmem_slab_allocator_t *allocator, const size_t size)
+{
+    wmem_slab_jumbo_t *jumbo;
+    wmem_slab_chunk_t *chunk;
+
+    jumbo = (wmem_slab_jumbo_t *)wmem_alloc(NULL, size
+            + WMEM_SLAB_JUMBO_HEADER_SIZE + WMEM_SLAB_CHUNK_HEADER_SIZE);
+
+    jumbo->size = size;
+    jumbo->prev = NULL;
+    jumbo->next = allocator->jumbo_list;
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+    allocator->jumbo_list = jumbo;
+
+    chunk = WMEM_SLAB_JUMBO_TO_CHUNK(jumbo);
+    chunk->size_class = WMEM_SLAB_JUMBO;
+
+    wmem_slab_account_alloc(allocator, WMEM_SLAB_JUMBO, size);
+
+    return WMEM_SLAB_CHUNK_TO_DATA(chunk);
+}
+
+static void
+wmem_slab_unlink_jumbo(wmem_slab_allocator_t *allocator,
+        wmem_slab_jumbo_t *jumbo)
+{
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo->next;
+    }
+    else {
+        allocator->jumbo_list = jumbo->next;
+    }
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo->prev;
+    }
+}
+
+static void *
+wmem_slab_alloc(void *private_data, const size_t size)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_class_t     *cls;
+    wmem_slab_chunk_t     *chunk;
+    guint                  size_class;
+
+    if (size > WMEM_SLAB_MAX_CHUNK) {
+        return wmem_slab_alloc_jumbo(allocator, size);
+    }
+
+    size_class = allocator->lookup[(size + (1 << WMEM_SLAB_LOOKUP_SHIFT) - 1) >> WMEM_SLAB_LOOKUP_SHIFT];
+    cls = &allocator->classes[size_class];
+
+    if (cls->free_list) {
+        chunk = cls->free_list;
+        cls->free_list = chunk->next_free;
+    }
+    else {
+        size_t stride = WMEM_SLAB_CHUNK_HEADER_SIZE + wmem_slab_class_size[size_class];
+
+        if (G_UNLIKELY(cls->cur == NULL || (size_t)(cls->end - cls->cur) < stride)) {
+            guint8 *block = (guint8 *)wmem_slab_new_block(allocator);
+
+            cls->cur = block + WMEM_SLAB_BLOCK_HEADER_SIZE;
+            cls->end = block + WMEM_SLAB_BLOCK_SIZE;
+        }
+
+        chunk = (wmem_slab_chunk_t *)cls->cur;
+        cls->cur += stride;
+    }
+
+    chunk->size_class = size_class;
+
+    wmem_slab_account_alloc(allocator, size_class, wmem_slab_class_size[size_class]);
+
+    return WMEM_SLAB_CHUNK_TO_DATA(chunk);
+}
+
+static void
+wmem_slab_free(void *private_data, void *ptr)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_chunk_t     *chunk;
+    guint                  size_class;
+
+    chunk = WMEM_SLAB_DATA_TO_CHUNK(ptr);
+    size_class = chunk->size_class;
+
+    if (size_class == WMEM_SLAB_JUMBO) {
+        wmem_slab_jumbo_t *jumbo = WMEM_SLAB_CHUNK_TO_JUMBO(chunk);
+
+        allocator->bytes_live -= jumbo->size;
+        wmem_slab_unlink_jumbo(allocator, jumbo);
+        wmem_free(NULL, jumbo);
+        return;
+    }
+
+    ASSERT(size_class < WMEM_SLAB_NUM_CLASSES);
+
+    allocator->bytes_live -= wmem_slab_class_size[size_class];
+    chunk->next_free = allocator->classes[size_class].free_list;
+    allocator->classes[size_class].free_list = chunk;
+}
+
+static void *
+wmem_slab_realloc(void *private_data, void *ptr, const size_t size)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_chunk_t     *chunk;
+    guint                  size_class;
+    size_t                 old_size;
+    void                  *new_ptr;
+
+    chunk = WMEM_SLAB_DATA_TO_CHUNK(ptr);
+    size_class = chunk->size_class;
+
+    if (size_class == WMEM_SLAB_JUMBO) {
+        wmem_slab_jumbo_t *jumbo = WMEM_SLAB_CHUNK_TO_JUMBO(chunk);
+
+        if (size > WMEM_SLAB_MAX_CHUNK) {
+            /* Stay a jumbo; relink it in case it moves */
+            allocator->bytes_live -= jumbo->size;
+            wmem_slab_unlink_jumbo(allocator, jumbo);
+            jumbo = (wmem_slab_jumbo_t *)wmem_realloc(NULL, jumbo, size
+                    + WMEM_SLAB_JUMBO_HEADER_SIZE + WMEM_SLAB_CHUNK_HEADER_SIZE);
+            jumbo->size = size;
+            jumbo->prev = NULL;
+            jumbo->next = allocator->jumbo_list;
+            if (jumbo->next) {
+                jumbo->next->prev = jumbo;
+            }
+            allocator->jumbo_list = jumbo;
+
+            allocator->bytes_live += size;
+            if (allocator->bytes_live > allocator->bytes_peak) {
+                allocator->bytes_peak = allocator->bytes_live;
+            }
+            return WMEM_SLAB_CHUNK_TO_DATA(WMEM_SLAB_JUMBO_TO_CHUNK(jumbo));
+        }
+        old_size = jumbo->size;
+    }
+    else {
+        old_size = wmem_slab_class_size[size_class];
+        if (size <= old_size) {
+            /* still fits in its chunk */
+            return ptr;
+        }
+    }
+
+    new_ptr = wmem_slab_alloc(private_data, size);
+    memcpy(new_ptr, ptr, MIN(old_size, size));
+    wmem_slab_free(private_data, ptr);
+
+    return new_ptr;
+}
+
+static void
+wmem_slab_free_all(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_block_t     *block, *next_block;
+    wmem_slab_jumbo_t     *jumbo, *next_jumbo;
+    guint                  i;
+
+    /* keep the blocks for reuse, by any class */
+    for (block = allocator->blocks; block; block = next_block) {
+        next_block = block->next;
+        block->next = allocator->spare_blocks;
+        allocator->spare_blocks = block;
+    }
+    allocator->blocks = NULL;
+
+    for (i = 0; i < WMEM_SLAB_NUM_CLASSES; i++) {
+        allocator->classes[i].free_list = NULL;
+        allocator->classes[i].cur = NULL;
+        allocator->classes[i].end = NULL;
+    }
+
+    for (jumbo = allocator->jumbo_list; jumbo; jumbo = next_jumbo) {
+        next_jumbo = jumbo->next;
+        wmem_free(NULL, jumbo);
+    }
+    allocator->jumbo_list = NULL;
+
+    allocator->bytes_live = 0;
+}
+
+static void
+wmem_slab_gc(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_block_t     *block, *next_block;
+
+    for (block = allocator->spare_blocks; block; block = next_block) {
+        next_block = block->next;
+        wmem_free(NULL, block);
+    }
+    allocator->spare_blocks = NULL;
+}
+
+static void
+wmem_slab_allocator_cleanup(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+
+    /* wmem guarantees free_all has been called, so all blocks are spare */
+    wmem_slab_gc(private_data);
+
+    wmem_free(NULL, allocator);
+}
+
+void
+wmem_slab_allocator_init(wmem_allocator_t *allocator)
+{
+    wmem_slab_allocator_t *slab_allocator;
+    guint                  i, size_class;
+
+    slab_allocator = wmem_new0(NULL, wmem_slab_allocator_t);
+
+    allocator->walloc   = &wmem_slab_alloc;
+    allocator->wrealloc = &wmem_slab_realloc;
+    allocator->wfree    = &wmem_slab_free;
+
+    allocator->free_all = &wmem_slab_free_all;
+    allocator->gc       = &wmem_slab_gc;
+    allocator->cleanup  = &wmem_slab_allocator_cleanup;
+
+    allocator->private_data = (void*) slab_allocator;
+
+    /* smallest class that fits each multiple of 16 bytes */
+    for (i = 0, size_class = 0; i < WMEM_SLAB_LOOKUP_LEN; i++) {
+        while (wmem_slab_class_size[size_class] < ((size_t)i << WMEM_SLAB_LOOKUP_SHIFT)) {
+            size_class++;
+        }
+        slab_allocator->lookup[i] = (guint8)size_class;
+    }
+}
+
+gboolean
+wmem_slab_get_stats(wmem_allocator_t *allocator, wmem_allocator_stats_t *stats)
+{
+    wmem_slab_allocator_t *slab_allocator;
+    guint                  i;
+
+    if (allocator->type != WMEM_ALLOCATOR_SLAB) {
+        return FALSE;
+    }
+
+    slab_allocator = (wmem_slab_allocator_t*) allocator->private_data;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->bytes_live  = slab_allocator->bytes_live;
+    stats->bytes_peak  = slab_allocator->bytes_peak;
+    stats->allocs      = slab_allocator->allocs;
+    stats->num_classes = WMEM_SLAB_NUM_CLASSES + 1;
+    for (i = 0; i < WMEM_SLAB_NUM_CLASSES; i++) {
+        stats->class_size[i]   = wmem_slab_class_size[i];
+        stats->class_allocs[i] = slab_allocator->class_allocs[i];
+    }
+    /* last entry counts the jumbo allocations */
+    stats->class_size[WMEM_SLAB_JUMBO]   = 0;
+    stats->class_allocs[WMEM_SLAB_JUMBO] = slab_allocator->class_allocs[WMEM_SLAB_JUMBO];
+
+    return TRUE;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -22,6 +22,7 @@
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_strict.h"
+#include "wmem_allocator_slab.h"
 
 /* Set according to the WIRESHARK_DEBUG_WMEM_OVERRIDE environment variable in
  * wmem_init. Should not be set again. */
@@ -125,6 +126,19 @@ wmem_destroy_allocator(wmem_allocator_t *allocator)
     wmem_free(NULL, allocator);
 }
 
+gboolean
+wmem_allocator_get_stats(wmem_allocator_t *allocator, wmem_allocator_stats_t *stats)
+{
+    switch (allocator->type) {
+        case WMEM_ALLOCATOR_SLAB:
+            return wmem_slab_get_stats(allocator, stats);
+        case WMEM_ALLOCATOR_BLOCK_FAST:
+            return wmem_block_fast_get_stats(allocator, stats);
+        default:
+            return FALSE;
+    }
+}
+
 wmem_allocator_t *
 wmem_allocator_new(const wmem_allocator_type_t type)
 {
@@ -156,6 +170,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             break;
@@ -192,6 +209,9 @@ wmem_init(void)
         else if (strncmp(override_env, "block_fast", strlen("block_fast")) == 0) {
             override_type = WMEM_ALLOCATOR_BLOCK_FAST;
         }
+        else if (strncmp(override_env, "slab", strlen("slab")) == 0) {
+            override_type = WMEM_ALLOCATOR_SLAB;
+        }
         else {
             g_warning("Unrecognized wmem override");
             do_override = FALSE;
@@ -54,13 +54,33 @@ typedef enum _wmem_allocator_type_t {
                 memory usage via things like canaries and scrubbing freed
                 memory. Valgrind is the better choice on platforms that support
                 it. */
-    WMEM_ALLOCATOR_BLOCK_FAST /**< A block allocator like WMEM_ALLOCATOR_BLOCK
+    WMEM_ALLOCATOR_BLOCK_FAST, /**< A block allocator like WMEM_ALLOCATOR_BLOCK
                 but even faster by tracking absolutely minimal metadata and
                 making 'free' a no-op. Useful only for very short-lived scopes
                 where there's no reason to free individual allocations because
-                the next free_all is always just around the corner. */
+                the next free_all is always just around the corner. Keeps
+                totals of the bytes handed out, see
+                wmem_allocator_get_stats(). */
+    WMEM_ALLOCATOR_SLAB /**< An allocator that serves small requests from
+                fixed size classes, each with its own free list, so that
+                alloc and free are O(1). Suited to long-lived pools holding
+                many objects of a few sizes. Keeps allocation statistics,
+                see wmem_allocator_get_stats(). */
 } wmem_allocator_type_t;
 
+/** The most size classes reported in wmem_allocator_stats_t. */
+#define WMEM_STATS_MAX_CLASSES 16
+
+/** Allocation statistics of a pool, see wmem_allocator_get_stats(). */
+typedef struct _wmem_allocator_stats_t {
+    size_t  bytes_live;   /**< Bytes currently allocated, rounded up to the size class */
+    size_t  bytes_peak;   /**< Highest value of bytes_live so far */
+    guint64 allocs;       /**< Number of allocations so far */
+    guint   num_classes;  /**< Number of entries used in the arrays below */
+    size_t  class_size[WMEM_STATS_MAX_CLASSES];   /**< Bytes per chunk of each class, 0 for oversized requests */
+    guint64 class_allocs[WMEM_STATS_MAX_CLASSES]; /**< Allocations served by each class */
+} wmem_allocator_stats_t;
+
 /** Allocate the requested amount of memory in the given pool.
  *
  * @param allocator The allocator object to use to allocate the memory.
@@ -200,6 +220,20 @@ WS_DLL_PUBLIC
 wmem_allocator_t *
 wmem_allocator_new(const wmem_allocator_type_t type);
 
+/** Get the allocation statistics of a pool. Only pools of type
+ * WMEM_ALLOCATOR_SLAB and WMEM_ALLOCATOR_BLOCK_FAST keep statistics.
+ * The latter never frees individual allocations, so its bytes_live is
+ * the total handed out since the last free_all, and it has no size
+ * classes.
+ *
+ * @param allocator The allocator to query.
+ * @param stats Filled in with the statistics.
+ * @return TRUE if the allocator keeps statistics, FALSE otherwise.
+ */
+WS_DLL_PUBLIC
+gboolean
+wmem_allocator_get_stats(wmem_allocator_t *allocator, wmem_allocator_stats_t *stats);
+
 /** Initialize the wmem subsystem. This must be called before any other wmem
  * function, usually at the very beginning of your program.
  */
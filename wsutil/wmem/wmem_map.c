@@ -10,8 +10,16 @@
  */
 #include "config.h"
 
+#include <string.h>
 #include <glib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WMEM_FLAT_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <wsutil/bits_ctz.h>
+
 #include "wmem_core.h"
 #include "wmem_list.h"
 #include "wmem_map.h"
@@ -41,6 +49,11 @@ typedef struct _wmem_map_item_t {
     struct _wmem_map_item_t *next;
 } wmem_map_item_t;
 
+typedef struct _wmem_map_slot_t {
+    const void *key;
+    void *value;
+} wmem_map_slot_t;
+
 struct _wmem_map_t {
     guint count; /* number of items stored */
 
@@ -52,6 +65,12 @@ struct _wmem_map_t {
 
     wmem_map_item_t **table;
 
+    /* Open-addressed ("flat") maps only, see wmem_map_new_flat() */
+    gboolean         flat;
+    guint            tombstones; /* number of WMEM_FLAT_DELETED slots */
+    guint8          *ctrl;       /* one control byte per slot */
+    wmem_map_slot_t *slots;
+
     GHashFunc  hash_func;
     GEqualFunc eql_func;
 
@@ -76,6 +95,31 @@ struct _wmem_map_t {
 #define HASH(MAP, KEY) \
     ((guint32)(((MAP)->hash_func(KEY) * x) >> (32 - (MAP)->capacity)))
 
+/* Flat maps keep the slots in one array, with a parallel array of control
+ * bytes holding WMEM_FLAT_EMPTY, WMEM_FLAT_DELETED, or (for a full slot) 7
+ * bits of the key's hash taken from just below the bits that pick the home
+ * group. Slots are probed a group of WMEM_FLAT_GROUP at a time, comparing all
+ * the control bytes of a group against the wanted byte at once, so eql_func is
+ * only called for real candidates. A group with an empty slot ends the probe;
+ * removal only turns a slot back to empty when its group had an empty slot
+ * anyway, which keeps that invariant without ever moving entries. */
+#define WMEM_FLAT_GROUP   16
+#define WMEM_FLAT_EMPTY   0x80
+#define WMEM_FLAT_DELETED 0xFE
+
+/* Full slots stay below 7/8 of the capacity, counting tombstones */
+#define WMEM_FLAT_OVERFULL(MAP) \
+    (((size_t)(MAP)->count + (MAP)->tombstones + 1) * 8 > CAPACITY(MAP) * 7)
+
+#define FLAT_HASH(MAP, KEY) \
+    ((guint32)((MAP)->hash_func(KEY) * x))
+
+#define FLAT_GROUP(MAP, H) \
+    (((H) >> (32 - (MAP)->capacity)) / WMEM_FLAT_GROUP)
+
+#define FLAT_H2(MAP, H) \
+    ((guint8)(((MAP)->capacity <= 25 ? (H) >> (25 - (MAP)->capacity) : (H)) & 0x7F))
+
 static void
 wmem_map_init_table(wmem_map_t *map)
 {
@@ -98,6 +142,7 @@ wmem_map_new(wmem_allocator_t *allocator,
     map->data_allocator = allocator;
     map->count = 0;
     map->table = NULL;
+    map->flat  = FALSE;
 
     return map;
 }
@@ -144,6 +189,7 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
     map->data_allocator = data_scope;
     map->count = 0;
     map->table = NULL;
+    map->flat  = FALSE;
 
     map->metadata_scope_cb_id = wmem_register_callback(metadata_scope, wmem_map_destroy_cb, map);
     map->data_scope_cb_id  = wmem_register_callback(data_scope, wmem_map_reset_cb, map);
@@ -183,12 +229,206 @@ wmem_map_grow(wmem_map_t *map)
     wmem_free(map->data_allocator, old_table);
 }
 
+wmem_map_t *
+wmem_map_new_flat(wmem_allocator_t *allocator,
+        GHashFunc hash_func, GEqualFunc eql_func)
+{
+    wmem_map_t *map;
+
+    map = wmem_map_new(allocator, hash_func, eql_func);
+
+    map->flat       = TRUE;
+    map->tombstones = 0;
+    map->ctrl       = NULL;
+    map->slots      = NULL;
+
+    return map;
+}
+
+/* Returns a bitmask with bit i set if control byte i of the group equals c */
+static inline guint32
+wmem_flat_match(const guint8 *group, guint8 c)
+{
+#ifdef WMEM_FLAT_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+
+    return (guint32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)c)));
+#else
+    guint32  mask = 0;
+    unsigned i;
+
+    for (i = 0; i < WMEM_FLAT_GROUP; i++) {
+        if (group[i] == c) {
+            mask |= 1U << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/* As above, for the slots that are empty or deleted (high bit set) */
+static inline guint32
+wmem_flat_match_free(const guint8 *group)
+{
+#ifdef WMEM_FLAT_SSE2
+    return (guint32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    guint32  mask = 0;
+    unsigned i;
+
+    for (i = 0; i < WMEM_FLAT_GROUP; i++) {
+        if (group[i] & 0x80) {
+            mask |= 1U << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+static void
+wmem_flat_alloc_table(wmem_map_t *map)
+{
+    size_t cap = CAPACITY(map);
+
+    /* slots and control bytes share one allocation */
+    map->slots = (wmem_map_slot_t *)wmem_alloc(map->data_allocator,
+            cap * (sizeof(wmem_map_slot_t) + 1));
+    map->ctrl  = (guint8 *)(map->slots + cap);
+    memset(map->ctrl, WMEM_FLAT_EMPTY, cap);
+    map->tombstones = 0;
+}
+
+/* Returns the slot index holding key, or -1 */
+static gssize
+wmem_flat_find(wmem_map_t *map, const void *key)
+{
+    guint32 h      = FLAT_HASH(map, key);
+    guint8  h2     = FLAT_H2(map, h);
+    size_t  groups = CAPACITY(map) / WMEM_FLAT_GROUP;
+    size_t  g      = FLAT_GROUP(map, h);
+    size_t  probe, i;
+    guint32 mask;
+
+    for (probe = 0; probe < groups; probe++) {
+        const guint8 *group = map->ctrl + g * WMEM_FLAT_GROUP;
+
+        for (mask = wmem_flat_match(group, h2); mask; mask &= mask - 1) {
+            i = g * WMEM_FLAT_GROUP + ws_ctz(mask);
+            if (map->eql_func(key, map->slots[i].key)) {
+                return (gssize)i;
+            }
+        }
+        if (wmem_flat_match(group, WMEM_FLAT_EMPTY)) {
+            break;
+        }
+        g = (g + 1) & (groups - 1);
+    }
+
+    return -1;
+}
+
+/* Stores a key that is known not to be in the map yet. There is always a
+ * free slot, since the map is resized before it gets full. */
+static void
+wmem_flat_insert_new(wmem_map_t *map, const void *key, void *value)
+{
+    guint32 h      = FLAT_HASH(map, key);
+    size_t  groups = CAPACITY(map) / WMEM_FLAT_GROUP;
+    size_t  g      = FLAT_GROUP(map, h);
+    size_t  i;
+    guint32 mask;
+
+    while ((mask = wmem_flat_match_free(map->ctrl + g * WMEM_FLAT_GROUP)) == 0) {
+        g = (g + 1) & (groups - 1);
+    }
+
+    i = g * WMEM_FLAT_GROUP + ws_ctz(mask);
+    if (map->ctrl[i] == WMEM_FLAT_DELETED) {
+        map->tombstones--;
+    }
+    map->ctrl[i]        = FLAT_H2(map, h);
+    map->slots[i].key   = key;
+    map->slots[i].value = value;
+}
+
+static void
+wmem_flat_resize(wmem_map_t *map)
+{
+    wmem_map_slot_t *old_slots = map->slots;
+    guint8          *old_ctrl  = map->ctrl;
+    size_t           old_cap   = CAPACITY(map);
+    size_t           i;
+
+    /* If it is mostly tombstones, just clean up at the same size */
+    if ((size_t)map->count * 2 >= old_cap) {
+        map->capacity++;
+    }
+    wmem_flat_alloc_table(map);
+
+    for (i = 0; i < old_cap; i++) {
+        if (!(old_ctrl[i] & 0x80)) {
+            wmem_flat_insert_new(map, old_slots[i].key, old_slots[i].value);
+        }
+    }
+
+    wmem_free(map->data_allocator, old_slots);
+}
+
+static void *
+wmem_flat_insert(wmem_map_t *map, const void *key, void *value)
+{
+    gssize i;
+    void  *old_val;
+
+    /* Make sure we have a table */
+    if (map->ctrl == NULL) {
+        map->count    = 0;
+        map->capacity = WMEM_MAP_DEFAULT_CAPACITY;
+        wmem_flat_alloc_table(map);
+    }
+
+    i = wmem_flat_find(map, key);
+    if (i >= 0) {
+        /* replace and return old value for this key */
+        old_val = map->slots[i].value;
+        map->slots[i].value = value;
+        return old_val;
+    }
+
+    if (WMEM_FLAT_OVERFULL(map)) {
+        wmem_flat_resize(map);
+    }
+
+    wmem_flat_insert_new(map, key, value);
+    map->count++;
+
+    return NULL;
+}
+
+static void
+wmem_flat_erase(wmem_map_t *map, size_t i)
+{
+    const guint8 *group = map->ctrl + (i & ~(size_t)(WMEM_FLAT_GROUP - 1));
+
+    if (wmem_flat_match(group, WMEM_FLAT_EMPTY)) {
+        map->ctrl[i] = WMEM_FLAT_EMPTY;
+    } else {
+        map->ctrl[i] = WMEM_FLAT_DELETED;
+        map->tombstones++;
+    }
+    map->count--;
+}
+
 void *
 wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 {
     wmem_map_item_t **item;
     void *old_val;
 
+    if (map->flat) {
+        return wmem_flat_insert(map, key, value);
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         wmem_map_init_table(map);
@@ -231,6 +471,10 @@ wmem_map_contains(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t *item;
 
+    if (map->flat) {
+        return map->ctrl != NULL && wmem_flat_find(map, key) >= 0;
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         return FALSE;
@@ -255,6 +499,15 @@ wmem_map_lookup(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t *item;
 
+    if (map->flat) {
+        gssize i;
+
+        if (map->ctrl == NULL || (i = wmem_flat_find(map, key)) < 0) {
+            return NULL;
+        }
+        return map->slots[i].value;
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         return NULL;
@@ -279,6 +532,21 @@ wmem_map_lookup_extended(wmem_map_t *map, const void *key, const void **orig_key
 {
     wmem_map_item_t *item;
 
+    if (map->flat) {
+        gssize i;
+
+        if (map->ctrl == NULL || (i = wmem_flat_find(map, key)) < 0) {
+            return FALSE;
+        }
+        if (orig_key) {
+            *orig_key = map->slots[i].key;
+        }
+        if (value) {
+            *value = map->slots[i].value;
+        }
+        return TRUE;
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         return FALSE;
@@ -310,6 +578,16 @@ wmem_map_remove(wmem_map_t *map, const void *key)
     wmem_map_item_t **item, *tmp;
     void *value;
 
+    if (map->flat) {
+        gssize i;
+
+        if (map->ctrl == NULL || (i = wmem_flat_find(map, key)) < 0) {
+            return NULL;
+        }
+        wmem_flat_erase(map, i);
+        return map->slots[i].value;
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         return NULL;
@@ -341,6 +619,16 @@ wmem_map_steal(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t **item, *tmp;
 
+    if (map->flat) {
+        gssize i;
+
+        if (map->ctrl == NULL || (i = wmem_flat_find(map, key)) < 0) {
+            return FALSE;
+        }
+        wmem_flat_erase(map, i);
+        return TRUE;
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         return FALSE;
@@ -372,6 +660,18 @@ wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
     wmem_map_item_t *cur;
     wmem_list_t* list = wmem_list_new(list_allocator);
 
+    if (map->flat) {
+        if (map->ctrl != NULL) {
+            capacity = CAPACITY(map);
+            for (i=0; i<capacity; i++) {
+                if (!(map->ctrl[i] & 0x80)) {
+                    wmem_list_prepend(list, (void*)map->slots[i].key);
+                }
+            }
+        }
+        return list;
+    }
+
     if (map->table != NULL) {
         capacity = CAPACITY(map);
 
@@ -394,6 +694,18 @@ wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, gpointer user_data)
     wmem_map_item_t *cur;
     unsigned i;
 
+    if (map->flat) {
+        if (map->ctrl == NULL) {
+            return;
+        }
+        for (i = 0; i < CAPACITY(map); i++) {
+            if (!(map->ctrl[i] & 0x80)) {
+                foreach_func((gpointer)map->slots[i].key, (gpointer)map->slots[i].value, user_data);
+            }
+        }
+        return;
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         return;
@@ -76,6 +76,27 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
         GHashFunc hash_func, GEqualFunc eql_func)
 G_GNUC_MALLOC;
 
+/** Creates a map like wmem_map_new(), but stores the entries in a single
+ * open-addressed array instead of per-bucket chains. Every entry point of this
+ * API works on it unchanged; the difference is performance only. Lookups probe
+ * a group of 16 one-byte hash fragments at a time (with SSE2 where available)
+ * and only call eql_func for real candidates, and inserts do not allocate a
+ * node per entry, so this is the better choice for large, lookup-heavy maps
+ * such as per-file conversation tables. Removal leaves tombstones behind that
+ * are only reclaimed on the next resize, so maps with heavy insert/remove churn
+ * may prefer the chained variant.
+ *
+ * @param allocator The allocator scope with which to create the map.
+ * @param hash_func The hash function used to place inserted keys.
+ * @param eql_func  The equality function used to compare inserted keys.
+ * @return The newly-allocated map.
+ */
+WS_DLL_PUBLIC
+wmem_map_t *
+wmem_map_new_flat(wmem_allocator_t *allocator,
+        GHashFunc hash_func, GEqualFunc eql_func)
+G_GNUC_MALLOC;
+
 /** Inserts a value into the map.
  *
  * @param map The map to insert into.
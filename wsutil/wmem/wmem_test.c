@@ -20,6 +20,7 @@
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_simple.h"
+#include "wmem_allocator_slab.h"
 #include "wmem_allocator_strict.h"
 
 #include <wsutil/time_util.h>
@@ -57,6 +58,9 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             /* This is necessary to squelch MSVC errors; is there
@@ -369,6 +373,68 @@ wmem_test_allocator_strict(void)
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_STRICT, &wmem_strict_check_canaries);
 }
 
+static void
+wmem_test_allocator_slab(void)
+{
+    wmem_allocator_t       *allocator;
+    wmem_allocator_stats_t  stats;
+    char                   *ptr1, *ptr2;
+
+    wmem_test_allocator(WMEM_ALLOCATOR_SLAB, NULL,
+            MAX_SIMULTANEOUS_ALLOCS*64);
+    wmem_test_allocator_jumbo(WMEM_ALLOCATOR_SLAB, NULL);
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_SLAB);
+
+    /* freed chunks are reused by the same size class */
+    ptr1 = (char *)wmem_alloc(allocator, 40);
+    wmem_free(allocator, ptr1);
+    ptr2 = (char *)wmem_alloc(allocator, 33);
+    g_assert_true(ptr1 == ptr2);
+
+    /* growing within the size class keeps the chunk */
+    ptr2 = (char *)wmem_realloc(allocator, ptr2, 48);
+    g_assert_true(ptr1 == ptr2);
+
+    g_assert_true(wmem_allocator_get_stats(allocator, &stats));
+    g_assert_cmpuint(stats.bytes_live, ==, 48);
+    g_assert_cmpuint(stats.allocs, ==, 2);
+
+    ptr1 = (char *)wmem_alloc(allocator, 100000);
+    g_assert_true(wmem_allocator_get_stats(allocator, &stats));
+    g_assert_cmpuint(stats.bytes_live, ==, 100048);
+    g_assert_cmpuint(stats.bytes_peak, ==, 100048);
+    g_assert_cmpuint(stats.class_allocs[stats.num_classes-1], ==, 1);
+    wmem_free(allocator, ptr1);
+
+    wmem_free_all(allocator);
+    g_assert_true(wmem_allocator_get_stats(allocator, &stats));
+    g_assert_cmpuint(stats.bytes_live, ==, 0);
+    g_assert_cmpuint(stats.bytes_peak, ==, 100048);
+
+    wmem_destroy_allocator(allocator);
+
+    /* block_fast only keeps totals */
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK_FAST);
+    ptr1 = (char *)wmem_alloc(allocator, 40);
+    wmem_free(allocator, ptr1);
+    wmem_alloc(allocator, 4 * 1024 * 1024);
+    g_assert_true(wmem_allocator_get_stats(allocator, &stats));
+    g_assert_cmpuint(stats.bytes_live, ==, 40 + 4 * 1024 * 1024);
+    g_assert_cmpuint(stats.allocs, ==, 2);
+    g_assert_cmpuint(stats.num_classes, ==, 0);
+    wmem_free_all(allocator);
+    g_assert_true(wmem_allocator_get_stats(allocator, &stats));
+    g_assert_cmpuint(stats.bytes_live, ==, 0);
+    g_assert_cmpuint(stats.bytes_peak, ==, 40 + 4 * 1024 * 1024);
+    wmem_destroy_allocator(allocator);
+
+    /* other allocators don't keep statistics */
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK);
+    g_assert_false(wmem_allocator_get_stats(allocator, &stats));
+    wmem_destroy_allocator(allocator);
+}
+
 /* UTILITY TESTING FUNCTIONS (/wmem/utils/) */
 
 static void
@@ -1002,6 +1068,142 @@ wmem_test_map(void)
     wmem_destroy_allocator(allocator);
 }
 
+static void
+wmem_test_map_flat(void)
+{
+    wmem_allocator_t *allocator;
+    wmem_map_t       *map;
+    wmem_list_t      *keys;
+    gchar            *str_key;
+    const void       *str_key_ret;
+    unsigned int      i, j;
+    unsigned int     *value_ret;
+    void             *ret;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+
+    /* insertion, replacement and lookup of simple integer keys */
+    map = wmem_map_new_flat(allocator, g_direct_hash, g_direct_equal);
+    g_assert_true(map);
+    g_assert_true(wmem_map_lookup(map, GINT_TO_POINTER(0)) == NULL);
+    g_assert_true(wmem_map_remove(map, GINT_TO_POINTER(0)) == NULL);
+
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        ret = wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(777777));
+        g_assert_true(ret == NULL);
+        ret = wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+        g_assert_true(ret == GINT_TO_POINTER(777777));
+    }
+    g_assert_true(wmem_map_size(map) == CONTAINER_ITERS);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        ret = wmem_map_lookup(map, GINT_TO_POINTER(i));
+        g_assert_true(ret == GINT_TO_POINTER(i));
+        g_assert_true(wmem_map_contains(map, GINT_TO_POINTER(i)) == TRUE);
+        value_ret = NULL;
+        g_assert_true(wmem_map_lookup_extended(map, GINT_TO_POINTER(i), NULL, GINT_TO_POINTER(&value_ret)));
+        g_assert_true(value_ret == GINT_TO_POINTER(i));
+    }
+    g_assert_true(wmem_map_contains(map, GINT_TO_POINTER(CONTAINER_ITERS)) == FALSE);
+
+    /* removing every other key must not hide the ones probed past it */
+    for (i=0; i<CONTAINER_ITERS; i+=2) {
+        ret = wmem_map_remove(map, GINT_TO_POINTER(i));
+        g_assert_true(ret == GINT_TO_POINTER(i));
+        g_assert_true(wmem_map_remove(map, GINT_TO_POINTER(i)) == NULL);
+    }
+    g_assert_true(wmem_map_size(map) == CONTAINER_ITERS / 2);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(wmem_map_contains(map, GINT_TO_POINTER(i)) == (i % 2 == 1));
+    }
+
+    /* insert/steal churn reuses deleted slots without growing forever */
+    for (j=0; j<10; j++) {
+        for (i=CONTAINER_ITERS; i<2*CONTAINER_ITERS; i++) {
+            g_assert_true(wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i)) == NULL);
+        }
+        for (i=CONTAINER_ITERS; i<2*CONTAINER_ITERS; i++) {
+            g_assert_true(wmem_map_steal(map, GINT_TO_POINTER(i)) == TRUE);
+        }
+    }
+    g_assert_true(wmem_map_size(map) == CONTAINER_ITERS / 2);
+    for (i=1; i<CONTAINER_ITERS; i+=2) {
+        g_assert_true(wmem_map_lookup(map, GINT_TO_POINTER(i)) == GINT_TO_POINTER(i));
+    }
+
+    keys = wmem_map_get_keys(allocator, map);
+    g_assert_true(wmem_list_count(keys) == CONTAINER_ITERS / 2);
+    wmem_free_all(allocator);
+
+    /* string keys and for-each */
+    map = wmem_map_new_flat(allocator, wmem_str_hash, g_str_equal);
+    g_assert_true(map);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        str_key = wmem_test_rand_string(allocator, 1, 64);
+        wmem_map_insert(map, str_key, GINT_TO_POINTER(2));
+        g_assert_true(wmem_map_lookup(map, str_key) == GINT_TO_POINTER(2));
+        str_key_ret = NULL;
+        g_assert_true(wmem_map_lookup_extended(map, str_key, &str_key_ret, NULL) == TRUE);
+        g_assert_true(g_str_equal(str_key_ret, str_key));
+    }
+    wmem_map_foreach(map, check_val_map, GINT_TO_POINTER(2));
+
+    wmem_destroy_allocator(allocator);
+}
+
+static void
+wmem_test_mapperf(void)
+{
+#define MAP_PERF_KEYS   (256 * 1024)
+#define MAP_PERF_ROUNDS 16
+    wmem_allocator_t *allocator;
+    wmem_map_t       *chained, *flat;
+    unsigned          i, r;
+    double            start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+    chained = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    flat = wmem_map_new_flat(allocator, g_direct_hash, g_direct_equal);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < MAP_PERF_KEYS; i++) {
+        wmem_map_insert(chained, GUINT_TO_POINTER(i), GUINT_TO_POINTER(i));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "chained map insert: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < MAP_PERF_KEYS; i++) {
+        wmem_map_insert(flat, GUINT_TO_POINTER(i), GUINT_TO_POINTER(i));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "flat map insert: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    /* half of the lookups miss */
+    RESOURCE_USAGE_START;
+    for (r = 0; r < MAP_PERF_ROUNDS; r++) {
+        for (i = 0; i < MAP_PERF_KEYS; i++) {
+            wmem_map_lookup(chained, GUINT_TO_POINTER(i * 2));
+        }
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "chained map lookup: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (r = 0; r < MAP_PERF_ROUNDS; r++) {
+        for (i = 0; i < MAP_PERF_KEYS; i++) {
+            wmem_map_lookup(flat, GUINT_TO_POINTER(i * 2));
+        }
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "flat map lookup: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    wmem_destroy_allocator(allocator);
+}
+
 static void
 wmem_test_queue(void)
 {
@@ -1437,6 +1639,7 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/allocator/blk_fast",  wmem_test_allocator_block_fast);
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
+    g_test_add_func("/wmem/allocator/slab",      wmem_test_allocator_slab);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
 
     g_test_add_func("/wmem/utils/misc",    wmem_test_miscutls);
@@ -1449,12 +1652,17 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/array",  wmem_test_array);
     g_test_add_func("/wmem/datastruct/list",   wmem_test_list);
     g_test_add_func("/wmem/datastruct/map",    wmem_test_map);
+    g_test_add_func("/wmem/datastruct/map_flat", wmem_test_map_flat);
     g_test_add_func("/wmem/datastruct/queue",  wmem_test_queue);
     g_test_add_func("/wmem/datastruct/stack",  wmem_test_stack);
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);
     g_test_add_func("/wmem/datastruct/tree",   wmem_test_tree);
     g_test_add_func("/wmem/datastruct/itree",  wmem_test_itree);
 
+    if (g_test_perf()) {
+        g_test_add_func("/wmem/datastruct/mapperf", wmem_test_mapperf);
+    }
+
     ret = g_test_run();
 
     wmem_cleanup();
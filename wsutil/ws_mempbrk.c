@@ -22,20 +22,50 @@
 #endif
 #endif
 
+#include <string.h>
+
 #include <glib.h>
 #include "ws_symbol_export.h"
 #include "ws_mempbrk.h"
 #include "ws_mempbrk_int.h"
 
+/* SSE2 is part of the x86-64 baseline, so this needs no runtime check */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WS_MEMPBRK_SSE2
+#include <emmintrin.h>
+#include "bits_ctz.h"
+#endif
+
 void
 ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const gchar *needles)
 {
     const gchar *n = needles;
+    guint num_small = 0;
+    guint i;
+
     while (*n) {
-        pattern->patt[(int)*n] = 1;
+        guint8 c = (guint8)*n;
+
+        if (num_small <= WS_MEMPBRK_MAX_SMALL_SET) {
+            for (i = 0; i < num_small && pattern->small[i] != c; i++)
+                ;
+            if (i == num_small) {
+                if (num_small < WS_MEMPBRK_MAX_SMALL_SET)
+                    pattern->small[num_small] = c;
+                num_small++;
+            }
+        }
+        pattern->patt[c] = 1;
         n++;
     }
 
+    if (num_small > WS_MEMPBRK_MAX_SMALL_SET)
+        num_small = 0;
+    pattern->num_small = (guint8)num_small;
+    /* Pad with the first needle so the SSE2 loop can always compare 4 */
+    for (i = num_small; i < WS_MEMPBRK_MAX_SMALL_SET && num_small > 0; i++)
+        pattern->small[i] = pattern->small[0];
+
 #ifdef HAVE_SSE4_2
     ws_mempbrk_sse42_compile(pattern, needles);
 #endif
@@ -60,9 +90,55 @@ ws_mempbrk_portable_exec(const guint8* haystack, size_t haystacklen, const ws_me
 }
 
 
+#ifdef WS_MEMPBRK_SSE2
+/* Compare 16 bytes at a time against each of up to 4 needles */
+static const guint8 *
+ws_mempbrk_sse2_small_exec(const guint8* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, guchar *found_needle)
+{
+    const guint8 *haystack_end = haystack + haystacklen;
+    const __m128i n0 = _mm_set1_epi8((char)pattern->small[0]);
+    const __m128i n1 = _mm_set1_epi8((char)pattern->small[1]);
+    const __m128i n2 = _mm_set1_epi8((char)pattern->small[2]);
+    const __m128i n3 = _mm_set1_epi8((char)pattern->small[3]);
+
+    while (haystack_end - haystack >= 16) {
+        __m128i data = _mm_loadu_si128((const __m128i *)(const void *)haystack);
+        __m128i eq = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(data, n0), _mm_cmpeq_epi8(data, n1)),
+                _mm_or_si128(_mm_cmpeq_epi8(data, n2), _mm_cmpeq_epi8(data, n3)));
+        int mask = _mm_movemask_epi8(eq);
+
+        if (mask) {
+            haystack += ws_ctz(mask);
+            if (found_needle)
+                *found_needle = *haystack;
+            return haystack;
+        }
+        haystack += 16;
+    }
+
+    return ws_mempbrk_portable_exec(haystack, haystack_end - haystack, pattern, found_needle);
+}
+#endif
+
+
 WS_DLL_PUBLIC const guint8 *
 ws_mempbrk_exec(const guint8* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, guchar *found_needle)
 {
+    if (pattern->num_small == 1) {
+        /* The C library's memchr() is already vectorized where it matters */
+        const guint8 *result = (const guint8 *)memchr(haystack, pattern->small[0], haystacklen);
+
+        if (result && found_needle)
+            *found_needle = *result;
+        return result;
+    }
+
+#ifdef WS_MEMPBRK_SSE2
+    if (haystacklen >= 16 && pattern->num_small)
+        return ws_mempbrk_sse2_small_exec(haystack, haystacklen, pattern, found_needle);
+#endif
+
 #ifdef HAVE_SSE4_2
     if (haystacklen >= 16 && pattern->use_sse42)
         return ws_mempbrk_sse42_exec(haystack, haystacklen, pattern, found_needle);
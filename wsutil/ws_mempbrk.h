@@ -16,10 +16,16 @@
 #include <emmintrin.h>
 #endif
 
+/** Needle sets up to this size are searched for with plain byte compares
+ * (memchr() for a single needle) rather than the 256-entry table. */
+#define WS_MEMPBRK_MAX_SMALL_SET 4
+
 /** The pattern object used for ws_mempbrk_exec().
  */
 typedef struct {
     gchar patt[256];
+    guint8 num_small;    /* number of distinct needles, 0 if more than WS_MEMPBRK_MAX_SMALL_SET */
+    guint8 small[WS_MEMPBRK_MAX_SMALL_SET];
 #ifdef HAVE_SSE4_2
     gboolean use_sse42;
     __m128i mask;
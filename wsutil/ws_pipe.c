@@ -23,6 +23,10 @@
 #include <wsutil/win32-utils.h>
 #else
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
 #ifdef HAVE_SYS_SELECT_H
 #include <sys/select.h>
 #endif
@@ -226,7 +230,85 @@ convert_to_command_line(gchar **argv)
     return g_string_free(command_line, FALSE);
 }
 
+#ifndef _WIN32
+/**
+ * Collect the output of a child started with G_SPAWN_DO_NOT_REAP_CHILD and
+ * reap it. If it is still running at the deadline (a g_get_monotonic_time()
+ * value) it is killed. Returns TRUE if it exited with status 0 in time.
+ */
+static gboolean
+wait_with_deadline(const gchar *command, GPid pid, int stdout_fd, gint64 deadline, gchar **output)
+{
+    GString *output_string = g_string_new(NULL);
+    gboolean timed_out = FALSE;
+    gboolean reaped = FALSE;
+    gchar buffer[4096];
+    gint exit_status = 0;
+
+    for (;;) {
+        struct pollfd pfd;
+        gint64 remaining = deadline - g_get_monotonic_time();
+        ssize_t nread;
+        int ready;
+
+        if (remaining <= 0) {
+            timed_out = TRUE;
+            break;
+        }
+        pfd.fd = stdout_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ready = poll(&pfd, 1, (int)((remaining + 999) / 1000));
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (ready <= 0)
+            continue;
+        nread = read(stdout_fd, buffer, sizeof(buffer));
+        if (nread < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            break;
+        }
+        if (nread == 0)
+            break;
+        g_string_append_len(output_string, buffer, nread);
+    }
+    close(stdout_fd);
+
+    /* The child may close its stdout some time before it exits. */
+    while (!timed_out) {
+        pid_t ret = waitpid(pid, &exit_status, WNOHANG);
+        if (ret == pid) {
+            reaped = TRUE;
+            break;
+        }
+        if (ret < 0 && errno != EINTR)
+            break;
+        if (g_get_monotonic_time() >= deadline)
+            timed_out = TRUE;
+        else
+            g_usleep(1000);
+    }
+
+    if (timed_out) {
+        ws_warning("%s did not finish in time, killing it", command);
+        kill(pid, SIGKILL);
+        while (waitpid(pid, &exit_status, 0) < 0 && errno == EINTR)
+            ;
+    }
+    g_spawn_close_pid(pid);
+
+    *output = g_string_free(output_string, FALSE);
+    return reaped && WIFEXITED(exit_status) && WEXITSTATUS(exit_status) == 0;
+}
+#endif
+
 gboolean ws_pipe_spawn_sync(const gchar *working_directory, const gchar *command, gint argc, gchar **args, gchar **command_output)
+{
+    return ws_pipe_spawn_sync_timeout(working_directory, command, argc, args, command_output, -1);
+}
+
+gboolean ws_pipe_spawn_sync_timeout(const gchar *working_directory, const gchar *command, gint argc, gchar **args, gchar **command_output, gint timeout_ms)
 {
     gboolean status = FALSE;
     gboolean result = FALSE;
@@ -256,6 +338,7 @@ gboolean ws_pipe_spawn_sync(const gchar *working_directory, const gchar *command
     ws_debug("command line: %s", command_line);
 
     guint64 start_time = g_get_monotonic_time();
+    gint64 deadline = timeout_ms >= 0 ? (gint64)start_time + (gint64)timeout_ms * 1000 : 0;
 
 #ifdef _WIN32
     /* Setup overlapped structures. Create Manual Reset events, initially not signalled */
@@ -325,6 +408,7 @@ gboolean ws_pipe_spawn_sync(const gchar *working_directory, const gchar *command
         gboolean process_finished = FALSE;
         gboolean pending_stdout = TRUE;
         gboolean pending_stderr = TRUE;
+        gboolean timed_out = FALSE;
 
         /* Start asynchronous reads from child process stdout and stderr */
         if (!ReadFile(child_stdout_rd, stdout_buffer, BUFFER_SIZE, NULL, &stdout_overlapped))
@@ -368,8 +452,38 @@ gboolean ws_pipe_spawn_sync(const gchar *working_directory, const gchar *command
                 break;
             }
 
-            dw = WaitForMultipleObjects(n_handles, handles, FALSE, INFINITE);
-            if (dw < (WAIT_OBJECT_0 + n_handles))
+            DWORD wait_ms = INFINITE;
+            if (deadline)
+            {
+                gint64 remaining = deadline - g_get_monotonic_time();
+                wait_ms = remaining > 0 ? (DWORD)((remaining + 999) / 1000) : 0;
+            }
+
+            dw = WaitForMultipleObjects(n_handles, handles, FALSE, wait_ms);
+            if (dw == WAIT_TIMEOUT)
+            {
+                ws_warning("%s did not finish in time, terminating it", argv[0]);
+                TerminateProcess(processInfo.hProcess, 1);
+                if (!process_finished)
+                {
+                    CloseHandle(child_stdout_wr);
+                    CloseHandle(child_stderr_wr);
+                }
+                /* The buffers must not be freed while a read is pending. */
+                if (pending_stdout)
+                {
+                    CancelIo(child_stdout_rd);
+                    GetOverlappedResult(child_stdout_rd, &stdout_overlapped, &bytes_read, TRUE);
+                }
+                if (pending_stderr)
+                {
+                    CancelIo(child_stderr_rd);
+                    GetOverlappedResult(child_stderr_rd, &stderr_overlapped, &bytes_read, TRUE);
+                }
+                timed_out = TRUE;
+                break;
+            }
+            else if (dw < (WAIT_OBJECT_0 + n_handles))
             {
                 int i = dw - WAIT_OBJECT_0;
                 if (handles[i] == processInfo.hProcess)
@@ -446,7 +560,7 @@ gboolean ws_pipe_spawn_sync(const gchar *working_directory, const gchar *command
         g_free(stdout_buffer);
         g_free(stderr_buffer);
 
-        status = GetExitCodeProcess(processInfo.hProcess, &dw);
+        status = !timed_out && GetExitCodeProcess(processInfo.hProcess, &dw);
         if (status && dw != 0)
         {
             status = FALSE;
@@ -480,11 +594,22 @@ gboolean ws_pipe_spawn_sync(const gchar *working_directory, const gchar *command
     flags = (GSpawnFlags)(flags | G_SPAWN_LEAVE_DESCRIPTORS_OPEN);
     child_setup = close_non_standard_fds_linux;
 #endif
-    status = g_spawn_sync(working_directory, argv, NULL,
-                          flags, child_setup, NULL, &local_output, NULL, &exit_status, NULL);
+    if (deadline) {
+        GPid pid;
+        gint stdout_fd;
+
+        flags = (GSpawnFlags)(flags | G_SPAWN_DO_NOT_REAP_CHILD);
+        status = g_spawn_async_with_pipes(working_directory, argv, NULL,
+                                          flags, child_setup, NULL, &pid, NULL, &stdout_fd, NULL, NULL);
+        if (status)
+            status = wait_with_deadline(argv[0], pid, stdout_fd, deadline, &local_output);
+    } else {
+        status = g_spawn_sync(working_directory, argv, NULL,
+                              flags, child_setup, NULL, &local_output, NULL, &exit_status, NULL);
 
-    if (status && exit_status != 0)
-        status = FALSE;
+        if (status && exit_status != 0)
+            status = FALSE;
+    }
 #endif
 
     ws_debug("%s finished in %.3fms", argv[0], (g_get_monotonic_time() - start_time) / 1000.0);
@@ -52,6 +52,13 @@ typedef struct _ws_pipe_t {
  */
 WS_DLL_PUBLIC gboolean ws_pipe_spawn_sync(const gchar * working_directory, const gchar * command, gint argc, gchar ** args, gchar ** command_output);
 
+/**
+ * @brief Like ws_pipe_spawn_sync, but kill the process if it has not finished
+ *        within the given time, in which case FALSE is returned.
+ * @param [IN] timeout_ms Time limit in milliseconds, or -1 to wait forever.
+ */
+WS_DLL_PUBLIC gboolean ws_pipe_spawn_sync_timeout(const gchar * working_directory, const gchar * command, gint argc, gchar ** args, gchar ** command_output, gint timeout_ms);
+
 /**
  * @brief Initialize a ws_pipe_t struct. Sets .pid to WS_INVALID_PID and all other members to 0 or NULL.
  * @param ws_pipe [IN] The pipe to initialize.